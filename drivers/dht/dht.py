@@ -4,7 +4,10 @@
 try:
     from esp import dht_readinto
 except:
-    from pyb import dht_readinto
+    try:
+        from pyb import dht_readinto
+    except:
+        from machine import dht_readinto
 
 class DHTBase:
     def __init__(self, pin):
@@ -19,6 +19,12 @@ Maintainer: Miguel Luis and Gregory Cristian
 #define RADIO_IRQ_FLAG_RX_DONE                      ( 0x02 )
 #define RADIO_IRQ_FLAG_RX_ERROR                     ( 0x04 )
 
+/*!
+ * FSK frames have to fit in the 64 byte FIFO together with their length byte,
+ * there's a single DIO line so the FIFO can't be refilled while the frame is on air
+ */
+#define RADIO_FSK_PAYLOAD_MAX                       ( 63 )
+
 /*!
  * Radio driver supported modems
  */
@@ -340,6 +346,18 @@ struct Radio_s
      * \brief Manually resets Lora chip.
      */
     void    ( *Reset )( void );
+    /*!
+     * \brief Prepares the packet to be sent without starting the transmission
+     *
+     * \param [IN]: buffer     Buffer pointer
+     * \param [IN]: size       Buffer size
+     */
+    void    ( *ArmTx )( uint8_t *buffer, uint8_t size );
+    /*!
+     * \brief Starts the transmission prepared by ArmTx, can be called from an
+     *        interrupt
+     */
+    void    ( *FireTx )( void );
 };
 
 /*!
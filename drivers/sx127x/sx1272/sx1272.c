@@ -61,6 +61,13 @@ typedef struct
  */
 void SX1272SetTx( uint32_t timeout );
 
+/*!
+ * \brief Configures the radio for transmission without starting it
+ *
+ * \param [IN] timeout Transmission timeout [ms], counted from SX1272FireTx
+ */
+static void SX1272PrepareTx( uint32_t timeout );
+
 /*!
  * \brief Writes the buffer contents to the SX1272 FIFO
  *
@@ -137,6 +144,43 @@ void SX1272RadioFlagsIrq (void);
  */
 const RadioRegisters_t RadioRegsInit[] = RADIO_INIT_REGISTERS_VALUE;
 
+/*!
+ * FSK bandwidth definition
+ */
+typedef struct
+{
+    uint32_t bandwidth;
+    uint8_t  RegValue;
+}FskBandwidth_t;
+
+/*!
+ * Precomputed FSK bandwidth registers values
+ */
+static const FskBandwidth_t FskBandwidths[] =
+{
+    { 2600  , 0x17 },
+    { 3100  , 0x0F },
+    { 3900  , 0x07 },
+    { 5200  , 0x16 },
+    { 6300  , 0x0E },
+    { 7800  , 0x06 },
+    { 10400 , 0x15 },
+    { 12500 , 0x0D },
+    { 15600 , 0x05 },
+    { 20800 , 0x14 },
+    { 25000 , 0x0C },
+    { 31300 , 0x04 },
+    { 41700 , 0x13 },
+    { 50000 , 0x0B },
+    { 62500 , 0x03 },
+    { 83333 , 0x12 },
+    { 100000, 0x0A },
+    { 125000, 0x02 },
+    { 166700, 0x11 },
+    { 200000, 0x09 },
+    { 250000, 0x01 },
+};
+
 /*!
  * Constant values need to compute the RSSI value
  */
@@ -181,6 +225,22 @@ static TimerEvent_t RadioIrqFlagsTimer;
  * Radio driver functions implementation
  */
 
+/*!
+ * Returns the narrowest FSK channel filter that is at least as wide as bandwidth,
+ * the widest one (250 kHz single side) when nothing is wide enough
+ */
+static uint8_t GetFskBandwidthRegValue( uint32_t bandwidth )
+{
+    for( uint8_t i = 0; i < ( sizeof( FskBandwidths ) / sizeof( FskBandwidth_t ) ); i++ )
+    {
+        if( bandwidth <= FskBandwidths[i].bandwidth )
+        {
+            return FskBandwidths[i].RegValue;
+        }
+    }
+    return FskBandwidths[( sizeof( FskBandwidths ) / sizeof( FskBandwidth_t ) ) - 1].RegValue;
+}
+
 void SX1272Init( RadioEvents_t *events )
 {
     uint8_t i;
@@ -307,6 +367,45 @@ IRAM_ATTR void SX1272SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
     switch( modem )
     {
     case MODEM_FSK:
+        {
+            SX1272.Settings.Fsk.Bandwidth = bandwidth;
+            SX1272.Settings.Fsk.Datarate = datarate;
+            SX1272.Settings.Fsk.BandwidthAfc = bandwidthAfc;
+            SX1272.Settings.Fsk.FixLen = fixLen;
+            SX1272.Settings.Fsk.PayloadLen = payloadLen;
+            SX1272.Settings.Fsk.CrcOn = crcOn;
+            SX1272.Settings.Fsk.RxIqInverted = iqInverted;
+            SX1272.Settings.Fsk.RxContinuous = rxContinuous;
+            SX1272.Settings.Fsk.PreambleLen = preambleLen;
+
+            datarate = ( uint16_t )( ( double )XTAL_FREQ / ( double )datarate );
+            SX1272Write( REG_BITRATEMSB, ( uint8_t )( datarate >> 8 ) );
+            SX1272Write( REG_BITRATELSB, ( uint8_t )( datarate & 0xFF ) );
+
+            SX1272Write( REG_RXBW, GetFskBandwidthRegValue( bandwidth ) );
+            SX1272Write( REG_AFCBW, GetFskBandwidthRegValue( bandwidthAfc ) );
+
+            SX1272Write( REG_PREAMBLEMSB, ( uint8_t )( ( preambleLen >> 8 ) & 0xFF ) );
+            SX1272Write( REG_PREAMBLELSB, ( uint8_t )( preambleLen & 0xFF ) );
+
+            if( fixLen == 1 )
+            {
+                SX1272Write( REG_PAYLOADLENGTH, payloadLen );
+            }
+            else
+            {
+                // the whole frame has to fit in the FIFO
+                SX1272Write( REG_PAYLOADLENGTH, RADIO_FSK_PAYLOAD_MAX );
+            }
+
+            SX1272Write( REG_PACKETCONFIG1,
+                         ( SX1272Read( REG_PACKETCONFIG1 ) &
+                           RF_PACKETCONFIG1_CRC_MASK &
+                           RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
+                           ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
+                           ( crcOn << 4 ) );
+            SX1272Write( REG_PACKETCONFIG2, ( SX1272Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+        }
         break;
     case MODEM_LORA:
         {
@@ -412,6 +511,36 @@ void SX1272SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
     switch( modem )
     {
     case MODEM_FSK:
+        {
+            SX1272.Settings.Fsk.Power = power;
+            SX1272.Settings.Fsk.Fdev = fdev;
+            SX1272.Settings.Fsk.Bandwidth = bandwidth;
+            SX1272.Settings.Fsk.Datarate = datarate;
+            SX1272.Settings.Fsk.PreambleLen = preambleLen;
+            SX1272.Settings.Fsk.FixLen = fixLen;
+            SX1272.Settings.Fsk.CrcOn = crcOn;
+            SX1272.Settings.Fsk.TxIqInverted = iqInverted;
+            SX1272.Settings.Fsk.TxTimeout = timeout;
+
+            fdev = ( uint16_t )( ( double )fdev / ( double )FREQ_STEP );
+            SX1272Write( REG_FDEVMSB, ( uint8_t )( fdev >> 8 ) );
+            SX1272Write( REG_FDEVLSB, ( uint8_t )( fdev & 0xFF ) );
+
+            datarate = ( uint16_t )( ( double )XTAL_FREQ / ( double )datarate );
+            SX1272Write( REG_BITRATEMSB, ( uint8_t )( datarate >> 8 ) );
+            SX1272Write( REG_BITRATELSB, ( uint8_t )( datarate & 0xFF ) );
+
+            SX1272Write( REG_PREAMBLEMSB, ( preambleLen >> 8 ) & 0x00FF );
+            SX1272Write( REG_PREAMBLELSB, preambleLen & 0xFF );
+
+            SX1272Write( REG_PACKETCONFIG1,
+                         ( SX1272Read( REG_PACKETCONFIG1 ) &
+                           RF_PACKETCONFIG1_CRC_MASK &
+                           RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
+                           ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
+                           ( crcOn << 4 ) );
+            SX1272Write( REG_PACKETCONFIG2, ( SX1272Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+        }
         break;
     case MODEM_LORA:
         {
@@ -501,6 +630,15 @@ uint32_t SX1272GetTimeOnAir( RadioModems_t modem, uint8_t pktLen )
     switch( modem )
     {
     case MODEM_FSK:
+        {
+            airTime = round( ( 8 * ( SX1272.Settings.Fsk.PreambleLen +
+                                     ( ( SX1272Read( REG_SYNCCONFIG ) & ~RF_SYNCCONFIG_SYNCSIZE_MASK ) + 1 ) +
+                                     ( ( SX1272.Settings.Fsk.FixLen == 0x01 ) ? 0.0 : 1.0 ) +
+                                     ( ( ( SX1272Read( REG_PACKETCONFIG1 ) & ~RF_PACKETCONFIG1_ADDRSFILTERING_MASK ) != 0x00 ) ? 1.0 : 0 ) +
+                                     pktLen +
+                                     ( ( SX1272.Settings.Fsk.CrcOn == 0x01 ) ? 2.0 : 0 ) ) /
+                                     SX1272.Settings.Fsk.Datarate ) * 1e3 );
+        }
         break;
     case MODEM_LORA:
         {
@@ -543,12 +681,44 @@ uint32_t SX1272GetTimeOnAir( RadioModems_t modem, uint8_t pktLen )
 }
 
 void SX1272Send( uint8_t *buffer, uint8_t size )
+{
+    SX1272ArmTx( buffer, size );
+    SX1272FireTx( );
+}
+
+void SX1272ArmTx( uint8_t *buffer, uint8_t size )
 {
     uint32_t txTimeout = 0;
 
     switch( SX1272.Settings.Modem )
     {
     case MODEM_FSK:
+        {
+            // FIFO operations can not take place in Sleep mode, and a frame half received
+            // before going to standby would still be in there, so flush it
+            if( ( SX1272Read( REG_OPMODE ) & ~RF_OPMODE_MASK ) != RF_OPMODE_STANDBY )
+            {
+                SX1272SetStby( );
+                DelayMs( 1 );
+            }
+            SX1272Write( REG_IRQFLAGS2, RF_IRQFLAGS2_FIFOOVERRUN );
+
+            if( size > RADIO_FSK_PAYLOAD_MAX )
+            {
+                size = RADIO_FSK_PAYLOAD_MAX;
+            }
+
+            if( SX1272.Settings.Fsk.FixLen == false )
+            {
+                SX1272WriteFifo( ( uint8_t* )&size, 1 );
+            }
+            else
+            {
+                SX1272Write( REG_PAYLOADLENGTH, size );
+            }
+            SX1272WriteFifo( buffer, size );
+            txTimeout = SX1272.Settings.Fsk.TxTimeout;
+        }
         break;
     case MODEM_LORA:
         {
@@ -585,7 +755,7 @@ void SX1272Send( uint8_t *buffer, uint8_t size )
         break;
     }
 
-    SX1272SetTx( txTimeout );
+    SX1272PrepareTx( txTimeout );
 }
 
 IRAM_ATTR void SX1272SetSleep( void )
@@ -613,6 +783,12 @@ IRAM_ATTR void SX1272SetRx( uint32_t timeout )
     switch( SX1272.Settings.Modem )
     {
     case MODEM_FSK:
+        {
+            rxContinuous = SX1272.Settings.Fsk.RxContinuous;
+
+            // DIO0=PayloadReady
+            SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK ) | RF_DIOMAPPING1_DIO0_00 );
+        }
         break;
     case MODEM_LORA:
         {
@@ -683,15 +859,28 @@ IRAM_ATTR void SX1272SetRx( uint32_t timeout )
             SX1272SetOpMode( RFLR_OPMODE_RECEIVER_SINGLE );
         }
     }
+    else
+    {
+        // the packet engine restarts the receiver after every frame (AutoRestartRxMode)
+        SX1272SetOpMode( RF_OPMODE_RECEIVER );
+    }
 }
 
 void SX1272SetTx( uint32_t timeout )
+{
+    SX1272PrepareTx( timeout );
+    SX1272FireTx( );
+}
+
+static void SX1272PrepareTx( uint32_t timeout )
 {
     TimerSetValue( &TxTimeoutTimer, timeout );
 
     switch( SX1272.Settings.Modem )
     {
     case MODEM_FSK:
+        // DIO0=PacketSent
+        SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK ) | RF_DIOMAPPING1_DIO0_00 );
         break;
     case MODEM_LORA:
         {
@@ -728,6 +917,10 @@ void SX1272SetTx( uint32_t timeout )
     }
 
     SX1272.Settings.State = RF_TX_RUNNING;
+}
+
+IRAM_ATTR void SX1272FireTx( void )
+{
     TimerStart( &TxTimeoutTimer );
     SX1272SetOpMode( RF_OPMODE_TRANSMITTER );
 }
@@ -789,6 +982,7 @@ int16_t SX1272ReadRssi( RadioModems_t modem )
     switch( modem )
     {
     case MODEM_FSK:
+        rssi = -( SX1272Read( REG_RSSIVALUE ) >> 1 );
         break;
     case MODEM_LORA:
         rssi = RSSI_OFFSET + SX1272Read( REG_LR_RSSIVALUE );
@@ -874,16 +1068,11 @@ IRAM_ATTR uint8_t SX1272Read( uint8_t addr )
 
 IRAM_ATTR void SX1272WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
-
     //NSS = 0;
     GpioWrite( &SX1272.Spi.Nss, 0 );
 
-    SpiInOut( &SX1272.Spi, addr | 0x80 );
-    for( i = 0; i < size; i++ )
-    {
-        SpiInOut( &SX1272.Spi, buffer[i] );
-    }
+    // the address auto increments, except on the FIFO, for the whole burst
+    SpiInOutBurst( &SX1272.Spi, addr | 0x80, buffer, NULL, size );
 
     //NSS = 1;
     GpioWrite( &SX1272.Spi.Nss, 1 );
@@ -891,17 +1080,10 @@ IRAM_ATTR void SX1272WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 
 IRAM_ATTR void SX1272ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
-
     //NSS = 0;
     GpioWrite( &SX1272.Spi.Nss, 0 );
 
-    SpiInOut( &SX1272.Spi, addr & 0x7F );
-
-    for( i = 0; i < size; i++ )
-    {
-        buffer[i] = SpiInOut( &SX1272.Spi, 0 );
-    }
+    SpiInOutBurst( &SX1272.Spi, addr & 0x7F, NULL, buffer, size );
 
     //NSS = 1;
     GpioWrite( &SX1272.Spi.Nss, 1 );
@@ -924,6 +1106,10 @@ IRAM_ATTR void SX1272SetMaxPayloadLength( RadioModems_t modem, uint8_t max )
     switch( modem )
     {
     case MODEM_FSK:
+        if( SX1272.Settings.Fsk.FixLen == false )
+        {
+            SX1272Write( REG_PAYLOADLENGTH, MIN( max, RADIO_FSK_PAYLOAD_MAX ) );
+        }
         break;
     case MODEM_LORA:
         SX1272Write( REG_LR_PAYLOADMAXLENGTH, max );
@@ -1014,7 +1200,7 @@ IRAM_ATTR void SX1272RadioFlagsIrq (void) {
         {
             RadioEvents->RxDone( RxTxBuffer, SX1272.Settings.LoRaPacketHandler.TimeStamp, SX1272.Settings.LoRaPacketHandler.Size,
                                  SX1272.Settings.LoRaPacketHandler.RssiValue, SX1272.Settings.LoRaPacketHandler.SnrValue,
-                                 SX1272.Settings.LoRa.Datarate );
+                                 ( SX1272.Settings.Modem == MODEM_LORA ) ? SX1272.Settings.LoRa.Datarate : 0 );
         }
     }
     if (SX1272.irqFlags & RADIO_IRQ_FLAG_RX_ERROR) {
@@ -1032,6 +1218,10 @@ static IRAM_ATTR void SX1272OnDioIrq (void) {
         uint8_t volatile irqflags1;
         switch (SX1272.Settings.Modem) {
         case MODEM_FSK:
+            irqflags1 = SX1272Read(REG_IRQFLAGS2);
+            if ((irqflags1 & RF_IRQFLAGS2_PAYLOADREADY) || (irqflags1 & RF_IRQFLAGS2_PACKETSENT)) {
+                SX1272OnDio0Irq();
+            }
             break;
         case MODEM_LORA:
             irqflags1 = SX1272Read(REG_LR_IRQFLAGS);
@@ -1065,6 +1255,57 @@ IRAM_ATTR void SX1272OnDio0Irq( void )
             switch( SX1272.Settings.Modem )
             {
             case MODEM_FSK:
+                {
+                    uint8_t size = 0;
+
+                    // Store the packet timestamp, FSK frames are reported through the LoRa packet handler too
+                    SX1272.Settings.LoRaPacketHandler.TimeStamp = mp_hal_ticks_us_non_blocking();
+                    SX1272.Settings.LoRaPacketHandler.RssiValue = -( SX1272Read( REG_RSSIVALUE ) >> 1 );
+                    SX1272.Settings.LoRaPacketHandler.SnrValue = 0;
+
+                    if( SX1272.Settings.Fsk.CrcOn == true )
+                    {
+                        irqFlags = SX1272Read( REG_IRQFLAGS2 );
+                        if( ( irqFlags & RF_IRQFLAGS2_CRCOK ) != RF_IRQFLAGS2_CRCOK )
+                        {
+                            // flush the FIFO, that also restarts the receiver
+                            SX1272Write( REG_IRQFLAGS2, RF_IRQFLAGS2_FIFOOVERRUN );
+
+                            if( SX1272.Settings.Fsk.RxContinuous == false )
+                            {
+                                SX1272.Settings.State = RF_IDLE;
+                            }
+                            TimerStop( &RxTimeoutTimer );
+
+                            // set the flag and trigger the timer to call the handler as soon as possible
+                            SX1272.irqFlags |= RADIO_IRQ_FLAG_RX_ERROR;
+                            TimerStart(&RadioIrqFlagsTimer);
+                            break;
+                        }
+                    }
+
+                    if( SX1272.Settings.Fsk.FixLen == false )
+                    {
+                        SX1272ReadFifo( &size, 1 );
+                    }
+                    else
+                    {
+                        size = SX1272Read( REG_PAYLOADLENGTH );
+                    }
+                    size = MIN( size, RADIO_FSK_PAYLOAD_MAX );
+                    SX1272ReadFifo( RxTxBuffer, size );
+                    SX1272.Settings.LoRaPacketHandler.Size = size;
+
+                    if( SX1272.Settings.Fsk.RxContinuous == false )
+                    {
+                        SX1272.Settings.State = RF_IDLE;
+                    }
+                    TimerStop( &RxTimeoutTimer );
+
+                    // set the flag and trigger the timer to call the handler as soon as possible
+                    SX1272.irqFlags |= RADIO_IRQ_FLAG_RX_DONE;
+                    TimerStart(&RadioIrqFlagsTimer);
+                }
                 break;
             case MODEM_LORA:
                 {
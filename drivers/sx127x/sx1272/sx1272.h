@@ -112,6 +112,7 @@ typedef struct
     RadioState_t             State;
     RadioModems_t            Modem;
     uint32_t                 Channel;
+    RadioFskSettings_t       Fsk;
     RadioLoRaSettings_t      LoRa;
     RadioLoRaPacketHandler_t LoRaPacketHandler;
 }RadioSettings_t;
@@ -315,6 +316,21 @@ uint32_t SX1272GetTimeOnAir( RadioModems_t modem, uint8_t pktLen );
  */
 void SX1272Send( uint8_t *buffer, uint8_t size );
 
+/*!
+ * \brief Does everything of SX1272Send but starting the transmission, the
+ *        radio should be in standby so that it doesn't receive meanwhile
+ *
+ * \param [IN]: buffer     Buffer pointer
+ * \param [IN]: size       Buffer size
+ */
+void SX1272ArmTx( uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Starts the transmission armed by SX1272ArmTx, with a single register
+ *        access so it's cheap enough for a timer interrupt
+ */
+void SX1272FireTx( void );
+
 /*!
  * \brief Sets the radio in sleep mode
  */
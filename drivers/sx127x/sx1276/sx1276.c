@@ -73,6 +73,13 @@ void SX1276Reset( void );
  */
 void SX1276SetTx( uint32_t timeout );
 
+/*!
+ * \brief Configures the radio for transmission without starting it
+ *
+ * \param [IN] timeout Transmission timeout [ms], counted from SX1276FireTx
+ */
+static void SX1276PrepareTx( uint32_t timeout );
+
 /*!
  * \brief Writes the buffer contents to the SX1276 FIFO
  *
@@ -156,6 +163,43 @@ void SX1276RadioFlagsIrq (void);
  */
 const RadioRegisters_t RadioRegsInit[] = RADIO_INIT_REGISTERS_VALUE;
 
+/*!
+ * FSK bandwidth definition
+ */
+typedef struct
+{
+    uint32_t bandwidth;
+    uint8_t  RegValue;
+}FskBandwidth_t;
+
+/*!
+ * Precomputed FSK bandwidth registers values
+ */
+static const FskBandwidth_t FskBandwidths[] =
+{
+    { 2600  , 0x17 },
+    { 3100  , 0x0F },
+    { 3900  , 0x07 },
+    { 5200  , 0x16 },
+    { 6300  , 0x0E },
+    { 7800  , 0x06 },
+    { 10400 , 0x15 },
+    { 12500 , 0x0D },
+    { 15600 , 0x05 },
+    { 20800 , 0x14 },
+    { 25000 , 0x0C },
+    { 31300 , 0x04 },
+    { 41700 , 0x13 },
+    { 50000 , 0x0B },
+    { 62500 , 0x03 },
+    { 83333 , 0x12 },
+    { 100000, 0x0A },
+    { 125000, 0x02 },
+    { 166700, 0x11 },
+    { 200000, 0x09 },
+    { 250000, 0x01 },
+};
+
 /*!
  * Constant values need to compute the RSSI value
  */
@@ -176,6 +220,34 @@ static RadioEvents_t *RadioEvents;
  */
 static uint8_t RxTxBuffer[RX_BUFFER_SIZE];
 
+/*!
+ * Shadow of the register map, a write of the value that is already in a
+ * register is not sent over the SPI bus
+ */
+#define SX1276_SHADOW_SIZE                          0x80
+#define SX1276_SHADOW_WORD( addr )                  ( ( addr ) >> 5 )
+#define SX1276_SHADOW_BIT( addr )                   ( 1UL << ( ( addr ) & 0x1F ) )
+
+static uint8_t SX1276Shadow[SX1276_SHADOW_SIZE];
+static uint32_t SX1276ShadowValid[SX1276_SHADOW_SIZE / 32];
+static int8_t SX1276ShadowLongRangeMode = -1;
+static uint32_t SX1276ShadowWrites;
+static uint32_t SX1276ShadowSkipped;
+
+/*!
+ * Registers that are never shadowed: the FIFO and its pointer, the operating
+ * mode, the IRQ flags and the ones with self clearing trigger bits
+ * (RxConfig, AfcFei, Osc, SeqConfig, ImageCal) or written by the radio (Temp)
+ */
+DRAM_ATTR static const uint32_t SX1276ShadowVolatile[SX1276_SHADOW_SIZE / 32] =
+{
+    ( 1UL << 0x00 ) | ( 1UL << 0x01 ) | ( 1UL << 0x0D ) | ( 1UL << 0x12 ) | ( 1UL << 0x1A ),
+    ( 1UL << ( 0x24 - 0x20 ) ) | ( 1UL << ( 0x36 - 0x20 ) ) | ( 1UL << ( 0x37 - 0x20 ) ) |
+    ( 1UL << ( 0x3B - 0x20 ) ) | ( 1UL << ( 0x3C - 0x20 ) ) | ( 1UL << ( 0x3E - 0x20 ) ) | ( 1UL << ( 0x3F - 0x20 ) ),
+    0,
+    0
+};
+
 /*
  * Public global variables
  */
@@ -201,6 +273,22 @@ static TimerEvent_t RadioIrqFlagsTimer;
  * Radio driver functions implementation
  */
 
+/*!
+ * Returns the narrowest FSK channel filter that is at least as wide as bandwidth,
+ * the widest one (250 kHz single side) when nothing is wide enough
+ */
+static uint8_t GetFskBandwidthRegValue( uint32_t bandwidth )
+{
+    for( uint8_t i = 0; i < ( sizeof( FskBandwidths ) / sizeof( FskBandwidth_t ) ); i++ )
+    {
+        if( bandwidth <= FskBandwidths[i].bandwidth )
+        {
+            return FskBandwidths[i].RegValue;
+        }
+    }
+    return FskBandwidths[( sizeof( FskBandwidths ) / sizeof( FskBandwidth_t ) ) - 1].RegValue;
+}
+
 void SX1276Init( RadioEvents_t *events )
 {
     uint8_t i;
@@ -373,6 +461,45 @@ IRAM_ATTR void SX1276SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
     switch( modem )
     {
     case MODEM_FSK:
+        {
+            SX1276.Settings.Fsk.Bandwidth = bandwidth;
+            SX1276.Settings.Fsk.Datarate = datarate;
+            SX1276.Settings.Fsk.BandwidthAfc = bandwidthAfc;
+            SX1276.Settings.Fsk.FixLen = fixLen;
+            SX1276.Settings.Fsk.PayloadLen = payloadLen;
+            SX1276.Settings.Fsk.CrcOn = crcOn;
+            SX1276.Settings.Fsk.RxIqInverted = iqInverted;
+            SX1276.Settings.Fsk.RxContinuous = rxContinuous;
+            SX1276.Settings.Fsk.PreambleLen = preambleLen;
+
+            datarate = ( uint16_t )( ( double )XTAL_FREQ / ( double )datarate );
+            SX1276Write( REG_BITRATEMSB, ( uint8_t )( datarate >> 8 ) );
+            SX1276Write( REG_BITRATELSB, ( uint8_t )( datarate & 0xFF ) );
+
+            SX1276Write( REG_RXBW, GetFskBandwidthRegValue( bandwidth ) );
+            SX1276Write( REG_AFCBW, GetFskBandwidthRegValue( bandwidthAfc ) );
+
+            SX1276Write( REG_PREAMBLEMSB, ( uint8_t )( ( preambleLen >> 8 ) & 0xFF ) );
+            SX1276Write( REG_PREAMBLELSB, ( uint8_t )( preambleLen & 0xFF ) );
+
+            if( fixLen == 1 )
+            {
+                SX1276Write( REG_PAYLOADLENGTH, payloadLen );
+            }
+            else
+            {
+                // the whole frame has to fit in the FIFO
+                SX1276Write( REG_PAYLOADLENGTH, RADIO_FSK_PAYLOAD_MAX );
+            }
+
+            SX1276Write( REG_PACKETCONFIG1,
+                         ( SX1276Read( REG_PACKETCONFIG1 ) &
+                           RF_PACKETCONFIG1_CRC_MASK &
+                           RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
+                           ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
+                           ( crcOn << 4 ) );
+            SX1276Write( REG_PACKETCONFIG2, ( SX1276Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+        }
         break;
     case MODEM_LORA:
         {
@@ -499,6 +626,36 @@ void SX1276SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
     switch( modem )
     {
     case MODEM_FSK:
+        {
+            SX1276.Settings.Fsk.Power = power;
+            SX1276.Settings.Fsk.Fdev = fdev;
+            SX1276.Settings.Fsk.Bandwidth = bandwidth;
+            SX1276.Settings.Fsk.Datarate = datarate;
+            SX1276.Settings.Fsk.PreambleLen = preambleLen;
+            SX1276.Settings.Fsk.FixLen = fixLen;
+            SX1276.Settings.Fsk.CrcOn = crcOn;
+            SX1276.Settings.Fsk.TxIqInverted = iqInverted;
+            SX1276.Settings.Fsk.TxTimeout = timeout;
+
+            fdev = ( uint16_t )( ( double )fdev / ( double )FREQ_STEP );
+            SX1276Write( REG_FDEVMSB, ( uint8_t )( fdev >> 8 ) );
+            SX1276Write( REG_FDEVLSB, ( uint8_t )( fdev & 0xFF ) );
+
+            datarate = ( uint16_t )( ( double )XTAL_FREQ / ( double )datarate );
+            SX1276Write( REG_BITRATEMSB, ( uint8_t )( datarate >> 8 ) );
+            SX1276Write( REG_BITRATELSB, ( uint8_t )( datarate & 0xFF ) );
+
+            SX1276Write( REG_PREAMBLEMSB, ( preambleLen >> 8 ) & 0x00FF );
+            SX1276Write( REG_PREAMBLELSB, preambleLen & 0xFF );
+
+            SX1276Write( REG_PACKETCONFIG1,
+                         ( SX1276Read( REG_PACKETCONFIG1 ) &
+                           RF_PACKETCONFIG1_CRC_MASK &
+                           RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
+                           ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
+                           ( crcOn << 4 ) );
+            SX1276Write( REG_PACKETCONFIG2, ( SX1276Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+        }
         break;
     case MODEM_LORA:
         {
@@ -596,6 +753,15 @@ uint32_t SX1276GetTimeOnAir( RadioModems_t modem, uint8_t pktLen )
     switch( modem )
     {
     case MODEM_FSK:
+        {
+            airTime = round( ( 8 * ( SX1276.Settings.Fsk.PreambleLen +
+                                     ( ( SX1276Read( REG_SYNCCONFIG ) & ~RF_SYNCCONFIG_SYNCSIZE_MASK ) + 1 ) +
+                                     ( ( SX1276.Settings.Fsk.FixLen == 0x01 ) ? 0.0 : 1.0 ) +
+                                     ( ( ( SX1276Read( REG_PACKETCONFIG1 ) & ~RF_PACKETCONFIG1_ADDRSFILTERING_MASK ) != 0x00 ) ? 1.0 : 0 ) +
+                                     pktLen +
+                                     ( ( SX1276.Settings.Fsk.CrcOn == 0x01 ) ? 2.0 : 0 ) ) /
+                                     SX1276.Settings.Fsk.Datarate ) * 1e3 );
+        }
         break;
     case MODEM_LORA:
         {
@@ -660,12 +826,44 @@ uint32_t SX1276GetTimeOnAir( RadioModems_t modem, uint8_t pktLen )
 }
 
 void SX1276Send( uint8_t *buffer, uint8_t size )
+{
+    SX1276ArmTx( buffer, size );
+    SX1276FireTx( );
+}
+
+void SX1276ArmTx( uint8_t *buffer, uint8_t size )
 {
     uint32_t txTimeout = 0;
 
     switch( SX1276.Settings.Modem )
     {
     case MODEM_FSK:
+        {
+            // FIFO operations can not take place in Sleep mode, and a frame half received
+            // before going to standby would still be in there, so flush it
+            if( ( SX1276Read( REG_OPMODE ) & ~RF_OPMODE_MASK ) != RF_OPMODE_STANDBY )
+            {
+                SX1276SetStby( );
+                DelayMs( 1 );
+            }
+            SX1276Write( REG_IRQFLAGS2, RF_IRQFLAGS2_FIFOOVERRUN );
+
+            if( size > RADIO_FSK_PAYLOAD_MAX )
+            {
+                size = RADIO_FSK_PAYLOAD_MAX;
+            }
+
+            if( SX1276.Settings.Fsk.FixLen == false )
+            {
+                SX1276WriteFifo( ( uint8_t* )&size, 1 );
+            }
+            else
+            {
+                SX1276Write( REG_PAYLOADLENGTH, size );
+            }
+            SX1276WriteFifo( buffer, size );
+            txTimeout = SX1276.Settings.Fsk.TxTimeout;
+        }
         break;
     case MODEM_LORA:
         {
@@ -702,7 +900,7 @@ void SX1276Send( uint8_t *buffer, uint8_t size )
         break;
     }
 
-    SX1276SetTx( txTimeout );
+    SX1276PrepareTx( txTimeout );
 }
 
 IRAM_ATTR void SX1276SetSleep( void )
@@ -730,6 +928,12 @@ IRAM_ATTR void SX1276SetRx( uint32_t timeout )
     switch( SX1276.Settings.Modem )
     {
     case MODEM_FSK:
+        {
+            rxContinuous = SX1276.Settings.Fsk.RxContinuous;
+
+            // DIO0=PayloadReady
+            SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK ) | RF_DIOMAPPING1_DIO0_00 );
+        }
         break;
     case MODEM_LORA:
         {
@@ -847,15 +1051,28 @@ IRAM_ATTR void SX1276SetRx( uint32_t timeout )
             SX1276SetOpMode( RFLR_OPMODE_RECEIVER_SINGLE );
         }
     }
+    else
+    {
+        // the packet engine restarts the receiver after every frame (AutoRestartRxMode)
+        SX1276SetOpMode( RF_OPMODE_RECEIVER );
+    }
 }
 
 void SX1276SetTx( uint32_t timeout )
+{
+    SX1276PrepareTx( timeout );
+    SX1276FireTx( );
+}
+
+static void SX1276PrepareTx( uint32_t timeout )
 {
     TimerSetValue( &TxTimeoutTimer, timeout );
 
     switch( SX1276.Settings.Modem )
     {
     case MODEM_FSK:
+        // DIO0=PacketSent
+        SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RF_DIOMAPPING1_DIO0_MASK ) | RF_DIOMAPPING1_DIO0_00 );
         break;
     case MODEM_LORA:
         {
@@ -892,6 +1109,10 @@ void SX1276SetTx( uint32_t timeout )
     }
 
     SX1276.Settings.State = RF_TX_RUNNING;
+}
+
+IRAM_ATTR void SX1276FireTx( void )
+{
     TimerStart( &TxTimeoutTimer );
     SX1276SetOpMode( RF_OPMODE_TRANSMITTER );
 }
@@ -953,6 +1174,7 @@ int16_t SX1276ReadRssi( RadioModems_t modem )
     switch( modem )
     {
     case MODEM_FSK:
+        rssi = -( SX1276Read( REG_RSSIVALUE ) >> 1 );
         break;
     case MODEM_LORA:
         if( SX1276.Settings.Channel > RF_MID_BAND_THRESH )
@@ -972,6 +1194,8 @@ int16_t SX1276ReadRssi( RadioModems_t modem )
 
 void SX1276Reset( void )
 {
+    SX1276ShadowInvalidate( );
+
     if (micropy_lpwan_use_reset_pin) {
         // Set RESET pin to 0
         GpioInit( &SX1276.Reset, RADIO_RESET, PIN_OUTPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
@@ -1031,9 +1255,45 @@ IRAM_ATTR void SX1276SetModem( RadioModems_t modem )
     }
 }
 
+static IRAM_ATTR void SX1276WriteBurst( uint8_t addr, uint8_t *buffer, uint8_t size )
+{
+    //NSS = 0;
+    GpioWrite( &SX1276.Spi.Nss, 0 );
+
+    // the address auto increments, except on the FIFO, for the whole burst
+    SpiInOutBurst( &SX1276.Spi, addr | 0x80, buffer, NULL, size );
+
+    //NSS = 1;
+    GpioWrite( &SX1276.Spi.Nss, 1 );
+}
+
 IRAM_ATTR void SX1276Write( uint8_t addr, uint8_t data )
 {
-    SX1276WriteBuffer( addr, &data, 1 );
+    if( addr == REG_OPMODE )
+    {
+        int8_t longRangeMode = ( data & RFLR_OPMODE_LONGRANGEMODE_ON ) ? 1 : 0;
+        if( longRangeMode != SX1276ShadowLongRangeMode )
+        {
+            // 0x0D to 0x3F are different registers for each modem
+            SX1276ShadowValid[0] &= SX1276_SHADOW_BIT( 0x0D ) - 1;
+            SX1276ShadowValid[1] = 0;
+            SX1276ShadowLongRangeMode = longRangeMode;
+        }
+    }
+    else if( addr < SX1276_SHADOW_SIZE &&
+             ( SX1276ShadowVolatile[SX1276_SHADOW_WORD( addr )] & SX1276_SHADOW_BIT( addr ) ) == 0 )
+    {
+        if( ( SX1276ShadowValid[SX1276_SHADOW_WORD( addr )] & SX1276_SHADOW_BIT( addr ) ) != 0 &&
+            SX1276Shadow[addr] == data )
+        {
+            SX1276ShadowSkipped++;
+            return;
+        }
+        SX1276Shadow[addr] = data;
+        SX1276ShadowValid[SX1276_SHADOW_WORD( addr )] |= SX1276_SHADOW_BIT( addr );
+    }
+    SX1276ShadowWrites++;
+    SX1276WriteBurst( addr, &data, 1 );
 }
 
 IRAM_ATTR uint8_t SX1276Read( uint8_t addr )
@@ -1045,34 +1305,28 @@ IRAM_ATTR uint8_t SX1276Read( uint8_t addr )
 
 IRAM_ATTR void SX1276WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
-
-    //NSS = 0;
-    GpioWrite( &SX1276.Spi.Nss, 0 );
-
-    SpiInOut( &SX1276.Spi, addr | 0x80 );
-    for( i = 0; i < size; i++ )
+    if( addr != REG_FIFO )
     {
-        SpiInOut( &SX1276.Spi, buffer[i] );
+        // not worth shadowing, just forget what was there
+        for( uint32_t i = addr; i < addr + size && i < SX1276_SHADOW_SIZE; i++ )
+        {
+            SX1276ShadowValid[SX1276_SHADOW_WORD( i )] &= ~SX1276_SHADOW_BIT( i );
+        }
+        if( addr <= REG_OPMODE && addr + size > REG_OPMODE )
+        {
+            SX1276ShadowLongRangeMode = -1;
+        }
     }
-
-    //NSS = 1;
-    GpioWrite( &SX1276.Spi.Nss, 1 );
+    SX1276ShadowWrites += size;
+    SX1276WriteBurst( addr, buffer, size );
 }
 
 IRAM_ATTR void SX1276ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
-
     //NSS = 0;
     GpioWrite( &SX1276.Spi.Nss, 0 );
 
-    SpiInOut( &SX1276.Spi, addr & 0x7F );
-
-    for( i = 0; i < size; i++ )
-    {
-        buffer[i] = SpiInOut( &SX1276.Spi, 0 );
-    }
+    SpiInOutBurst( &SX1276.Spi, addr & 0x7F, NULL, buffer, size );
 
     //NSS = 1;
     GpioWrite( &SX1276.Spi.Nss, 1 );
@@ -1080,7 +1334,19 @@ IRAM_ATTR void SX1276ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size )
 
 IRAM_ATTR void SX1276WriteFifo( uint8_t *buffer, uint8_t size )
 {
-    SX1276WriteBuffer( 0, buffer, size );
+    SX1276WriteBurst( 0, buffer, size );
+}
+
+IRAM_ATTR void SX1276ShadowInvalidate( void )
+{
+    memset( SX1276ShadowValid, 0, sizeof( SX1276ShadowValid ) );
+    SX1276ShadowLongRangeMode = -1;
+}
+
+void SX1276ShadowGetStats( uint32_t *writes, uint32_t *skipped )
+{
+    *writes = SX1276ShadowWrites;
+    *skipped = SX1276ShadowSkipped;
 }
 
 IRAM_ATTR void SX1276ReadFifo( uint8_t *buffer, uint8_t size )
@@ -1095,6 +1361,10 @@ IRAM_ATTR void SX1276SetMaxPayloadLength( RadioModems_t modem, uint8_t max )
     switch( modem )
     {
     case MODEM_FSK:
+        if( SX1276.Settings.Fsk.FixLen == false )
+        {
+            SX1276Write( REG_PAYLOADLENGTH, MIN( max, RADIO_FSK_PAYLOAD_MAX ) );
+        }
         break;
     case MODEM_LORA:
         SX1276Write( REG_LR_PAYLOADMAXLENGTH, max );
@@ -1182,7 +1452,7 @@ IRAM_ATTR void SX1276RadioFlagsIrq (void) {
         {
             RadioEvents->RxDone( RxTxBuffer, SX1276.Settings.LoRaPacketHandler.TimeStamp, SX1276.Settings.LoRaPacketHandler.Size,
                                  SX1276.Settings.LoRaPacketHandler.RssiValue, SX1276.Settings.LoRaPacketHandler.SnrValue,
-                                 SX1276.Settings.LoRa.Datarate );
+                                 ( SX1276.Settings.Modem == MODEM_LORA ) ? SX1276.Settings.LoRa.Datarate : 0 );
         }
     }
     if (SX1276.irqFlags & RADIO_IRQ_FLAG_RX_ERROR) {
@@ -1200,6 +1470,10 @@ static IRAM_ATTR void SX1276OnDioIrq (void) {
         uint8_t volatile irqflags1;
         switch (SX1276.Settings.Modem) {
         case MODEM_FSK:
+            irqflags1 = SX1276Read(REG_IRQFLAGS2);
+            if ((irqflags1 & RF_IRQFLAGS2_PAYLOADREADY) || (irqflags1 & RF_IRQFLAGS2_PACKETSENT)) {
+                SX1276OnDio0Irq();
+            }
             break;
         case MODEM_LORA:
             irqflags1 = SX1276Read(REG_LR_IRQFLAGS);
@@ -1233,6 +1507,57 @@ IRAM_ATTR void SX1276OnDio0Irq( void )
             switch( SX1276.Settings.Modem )
             {
             case MODEM_FSK:
+                {
+                    uint8_t size = 0;
+
+                    // Store the packet timestamp, FSK frames are reported through the LoRa packet handler too
+                    SX1276.Settings.LoRaPacketHandler.TimeStamp = mp_hal_ticks_us_non_blocking();
+                    SX1276.Settings.LoRaPacketHandler.RssiValue = -( SX1276Read( REG_RSSIVALUE ) >> 1 );
+                    SX1276.Settings.LoRaPacketHandler.SnrValue = 0;
+
+                    if( SX1276.Settings.Fsk.CrcOn == true )
+                    {
+                        irqFlags = SX1276Read( REG_IRQFLAGS2 );
+                        if( ( irqFlags & RF_IRQFLAGS2_CRCOK ) != RF_IRQFLAGS2_CRCOK )
+                        {
+                            // flush the FIFO, that also restarts the receiver
+                            SX1276Write( REG_IRQFLAGS2, RF_IRQFLAGS2_FIFOOVERRUN );
+
+                            if( SX1276.Settings.Fsk.RxContinuous == false )
+                            {
+                                SX1276.Settings.State = RF_IDLE;
+                            }
+                            TimerStop( &RxTimeoutTimer );
+
+                            // set the flag and trigger the timer to call the handler as soon as possible
+                            SX1276.irqFlags |= RADIO_IRQ_FLAG_RX_ERROR;
+                            TimerStart(&RadioIrqFlagsTimer);
+                            break;
+                        }
+                    }
+
+                    if( SX1276.Settings.Fsk.FixLen == false )
+                    {
+                        SX1276ReadFifo( &size, 1 );
+                    }
+                    else
+                    {
+                        size = SX1276Read( REG_PAYLOADLENGTH );
+                    }
+                    size = MIN( size, RADIO_FSK_PAYLOAD_MAX );
+                    SX1276ReadFifo( RxTxBuffer, size );
+                    SX1276.Settings.LoRaPacketHandler.Size = size;
+
+                    if( SX1276.Settings.Fsk.RxContinuous == false )
+                    {
+                        SX1276.Settings.State = RF_IDLE;
+                    }
+                    TimerStop( &RxTimeoutTimer );
+
+                    // set the flag and trigger the timer to call the handler as soon as possible
+                    SX1276.irqFlags |= RADIO_IRQ_FLAG_RX_DONE;
+                    TimerStart(&RadioIrqFlagsTimer);
+                }
                 break;
             case MODEM_LORA:
                 {
@@ -112,6 +112,7 @@ typedef struct
     RadioState_t             State;
     RadioModems_t            Modem;
     uint32_t                 Channel;
+    RadioFskSettings_t       Fsk;
     RadioLoRaSettings_t      LoRa;
     RadioLoRaPacketHandler_t LoRaPacketHandler;
 }RadioSettings_t;
@@ -319,6 +320,21 @@ uint32_t SX1276GetTimeOnAir( RadioModems_t modem, uint8_t pktLen );
  */
 void SX1276Send( uint8_t *buffer, uint8_t size );
 
+/*!
+ * \brief Does everything of SX1276Send but starting the transmission, the
+ *        radio should be in standby so that it doesn't receive meanwhile
+ *
+ * \param [IN]: buffer     Buffer pointer
+ * \param [IN]: size       Buffer size
+ */
+void SX1276ArmTx( uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Starts the transmission armed by SX1276ArmTx, with a single register
+ *        access so it's cheap enough for a timer interrupt
+ */
+void SX1276FireTx( void );
+
 /*!
  * \brief Sets the radio in sleep mode
  */
@@ -390,6 +406,23 @@ void SX1276WriteBuffer( uint8_t addr, uint8_t *buffer, uint8_t size );
  */
 void SX1276ReadBuffer( uint8_t addr, uint8_t *buffer, uint8_t size );
 
+/*!
+ * \brief Forgets the shadowed register values, the next write of each one
+ *        goes out over the SPI bus again
+ *
+ * \remark Must be called whenever the radio may have been written without
+ *         going through this driver (e.g. by the Sigfox stack)
+ */
+void SX1276ShadowInvalidate( void );
+
+/*!
+ * \brief Gets the register write statistics
+ *
+ * \param [OUT] writes  Register writes sent over the SPI bus
+ * \param [OUT] skipped Register writes dropped because the value was already there
+ */
+void SX1276ShadowGetStats( uint32_t *writes, uint32_t *skipped );
+
 /*!
  * \brief Sets the maximum payload length.
  *
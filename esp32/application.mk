@@ -144,11 +144,14 @@ APP_MODS_SRC_C = $(addprefix mods/,\
 	modutime.c \
 	modpycom.c \
 	moduqueue.c \
+	modreclog.c \
 	moduhashlib.c \
 	moducrypto.c \
 	machtimer.c \
 	machtimer_alarm.c \
 	machtimer_chrono.c \
+	machtimer_compare.c \
+	machtimer_capture.c \
 	analog.c \
 	pybadc.c \
 	pybdac.c \
@@ -158,10 +161,16 @@ APP_MODS_SRC_C = $(addprefix mods/,\
 	modled.c \
 	machwdt.c \
 	machrmt.c \
+	machi2s.c \
+	modonewire.c \
+	moddsp.c \
+	machcounter.c \
 	lwipsocket.c \
 	machtouch.c \
+	machulp.c \
 	modcoap.c \
 	modmdns.c \
+	modmqtt.c \
 	)
 
 APP_MODS_LORA_SRC_C = $(addprefix mods/,\
@@ -179,13 +188,21 @@ APP_UTIL_SRC_C = $(addprefix util/,\
 	mperror.c \
 	random.c \
 	mpexception.c \
-	fifo.c \
 	socketfifo.c \
 	mpirq.c \
 	mpsleep.c \
+	mpcpufreq.c \
+	mptaskstats.c \
+	mptaskmon.c \
+	mpmetrics.c \
+	mpprofile.c \
+	mptrace.c \
+	mpwakestub.c \
 	timeutils.c \
 	esp32chipinfo.c \
 	pycom_general_util.c \
+	boottime.c \
+	nativecode.c \
 	)
 
 APP_FATFS_SRC_C = $(addprefix fatfs/src/,\
@@ -208,6 +225,7 @@ APP_LORA_SRC_C = $(addprefix lora/,\
 	spi-board.c \
 	sx1276-board.c \
 	sx1272-board.c \
+	radiosched.c \
 	board.c \
 	)
 
@@ -284,10 +302,13 @@ APP_SIGFOX_SPI_SRC_C = $(addprefix lora/,\
 
 APP_LTE_SRC_C = $(addprefix lte/,\
     lteppp.c \
+    ltecmux.c \
+    netfailover.c \
     )
 
 APP_MODS_LTE_SRC_C = $(addprefix mods/,\
     modlte.c \
+    modsqnstp.c \
     )
 
 APP_TELNET_SRC_C = $(addprefix telnet/,\
@@ -341,6 +362,10 @@ OBJ += $(addprefix $(BUILD)/, $(APP_MODS_SRC_C:.c=.o) $(APP_STM_SRC_C:.c=.o))
 OBJ += $(addprefix $(BUILD)/, $(APP_FATFS_SRC_C:.c=.o) $(APP_LITTLEFS_SRC_C:.c=.o) $(APP_UTIL_SRC_C:.c=.o) $(APP_TELNET_SRC_C:.c=.o))
 OBJ += $(addprefix $(BUILD)/, $(APP_FTP_SRC_C:.c=.o) $(APP_CAN_SRC_C:.c=.o))
 OBJ += $(BUILD)/pins.o
+ifeq ($(MICROPY_PY_BTREE),1)
+OBJ += $(addprefix $(BUILD)/, $(filter extmod/modbtree.o $(BTREE_DIR)/%.o, $(SRC_MOD:.c=.o)) lib/embed/abort_.o)
+CFLAGS += $(CFLAGS_MOD) -I$(TOP)/$(BTREE_DIR)/PORT/include
+endif
 
 BOOT_OBJ = $(addprefix $(BUILD)/, $(BOOT_SRC_C:.c=.o))
 
@@ -370,6 +395,8 @@ BOOT_LDFLAGS = $(LDFLAGS) -T esp32.bootloader.ld -T esp32.rom.ld -T esp32.periph
 
 # add the application linker script(s)
 APP_LDFLAGS += $(LDFLAGS) -T esp32_out.ld -T esp32.project.ld -T esp32.rom.ld -T esp32.peripherals.ld
+# machulp.c adds the ULP wake-up trigger the prebuilt libesp32 leaves out
+APP_LDFLAGS += -Wl,--wrap=rtc_sleep_start
 
 # add the application specific CFLAGS
 CFLAGS += $(APP_INC) -DMICROPY_NLR_SETJMP=1 -DMBEDTLS_CONFIG_FILE='"mbedtls/esp_config.h"' -DHAVE_CONFIG_H -DESP_PLATFORM -DFFCONF_H=\"lib/oofatfs/ffconf.h\" -DWITH_POSIX
@@ -24,6 +24,7 @@
 #define MICROPY_LTE_CTS_PIN                                     (&PIN_MODULE_P17)
 
 #define MICROPY_LTE_UART_BAUDRATE                               921600
+#define MICROPY_LTE_UART_BAUDRATE_MAX                           3686400
 
 extern uint32_t micropy_hw_flash_size;
 
@@ -57,10 +57,18 @@
 
 #include "flash_qio_mode.h"
 #include "mperror.h"
+#include "boottime.h"
 
 
 #define MAP_ERR_MSG "Image contains multiple %s segments. Only the last one will be mapped."
 
+// stored in boot_info->signature next to the start of the image digest once the image passed a full check
+#define IMAGE_VERIFIED_MAGIC            0x44465256      // "VRFD"
+#define IMAGE_VERIFIED_DIGEST_LEN       (sizeof(((boot_info_t *)0)->signature) - sizeof(uint32_t))
+#define IMAGE_DIGEST_LEN                32
+// keep the segments loaded into DRAM away from our own stack
+#define IMAGE_STACK_LOAD_HEADROOM       4096
+
 extern int _bss_start;
 extern int _bss_end;
 extern int _data_start;
@@ -71,6 +79,10 @@ static const char* TAG = "boot";
 static const uint8_t empty_signature[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
                                           0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
+// CPU cycle counter and clock when this bootloader was entered
+static uint32_t boottime_start_cycles;
+static uint32_t boottime_rom_mhz;
+
 /*
 We arrive here after the bootloader finished loading the program from flash. The hardware is mostly uninitialized,
 flash cache is down and the app CPU is in reset. We do have a stack, so we can do the initialization in C.
@@ -93,6 +105,10 @@ static void vddsdio_configure();
 static void flash_gpio_configure();
 static void uart_console_configure(void);
 static void wdt_reset_check(void);
+static void boottime_save(void);
+static bool image_scan(const esp_partition_pos_t *partition, esp_image_metadata_t *data, uint8_t *digest);
+static bool image_fast_load(const esp_partition_pos_t *partition, esp_image_metadata_t *data, const boot_info_t *boot_info);
+static void image_mark_verified(bootloader_state_t *bs, const esp_partition_pos_t *partition, boot_info_t *boot_info);
 
 // static void read_mac(uint8_t* mac)
 // {
@@ -130,6 +146,10 @@ void call_start_cpu0()
     //Clear bss
     memset(&_bss_start, 0, (&_bss_end - &_bss_start) * sizeof(_bss_start));
 
+    // the ROM bootloader ran from the XTAL clock so far
+    RSR(CCOUNT, boottime_start_cycles);
+    boottime_rom_mhz = ets_get_cpu_frequency();
+
     /* completely reset MMU for both CPUs
        (in case serial bootloader was running) */
     Cache_Read_Disable(0);
@@ -320,10 +340,9 @@ static bool get_image_from_partition(const esp_partition_pos_t *partition, esp_i
     return false;
 }
 
-static bool find_active_image(bootloader_state_t *bs, esp_partition_pos_t *partition)
+static bool find_active_image(bootloader_state_t *bs, esp_partition_pos_t *partition, boot_info_t *_boot_info)
 {
     boot_info_t *boot_info;
-    boot_info_t _boot_info;
 
     if (bs->ota_info.size < 2 * sizeof(esp_ota_select_entry_t)) {
         ESP_LOGE(TAG, "ERROR: ota_info partition size %d is too small (minimum %d bytes)", bs->ota_info.size, sizeof(esp_ota_select_entry_t));
@@ -335,9 +354,9 @@ static bool find_active_image(bootloader_state_t *bs, esp_partition_pos_t *parti
         ESP_LOGE(TAG, "bootloader_mmap(0x%x, 0x%x) failed", bs->ota_info.offset, bs->ota_info.size);
         return false;
     }
-    memcpy(&_boot_info, boot_info, sizeof(boot_info_t));
+    memcpy(_boot_info, boot_info, sizeof(boot_info_t));
     bootloader_munmap(boot_info);
-    boot_info = &_boot_info;
+    boot_info = _boot_info;
 #ifndef RGB_LED_DISABLE
     mperror_init0();
 #endif
@@ -462,6 +481,7 @@ static void bootloader_main()
     bootloader_state_t bootloader_state __attribute__((aligned (4)));
     esp_partition_pos_t partition __attribute__((aligned (4)));
     esp_image_metadata_t image_data __attribute__((aligned (4)));
+    boot_info_t boot_info __attribute__((aligned (4)));
 
     memset(&bootloader_state, 0, sizeof(bootloader_state));
     ets_set_appcpu_boot_addr(0);
@@ -505,7 +525,7 @@ static void bootloader_main()
     }
 
     // check if the partition table has OTA info partition
-    if (bootloader_state.ota_info.offset == 0 || !find_active_image(&bootloader_state, &partition)) {
+    if (bootloader_state.ota_info.offset == 0 || !find_active_image(&bootloader_state, &partition, &boot_info)) {
         // nothing to load, bail out
         ESP_LOGE(TAG, "nothing to load");
 #ifndef RGB_LED_DISABLE
@@ -514,7 +534,12 @@ static void bootloader_main()
         return;
     }
 
-    get_image_from_partition(&partition, &image_data);
+    // an image that passed the full check once is only loaded again, see image_fast_load()
+    if (!image_fast_load(&partition, &image_data, &boot_info)) {
+        if (get_image_from_partition(&partition, &image_data)) {
+            image_mark_verified(&bootloader_state, &partition, &boot_info);
+        }
+    }
 
 #ifdef CONFIG_SECURE_BOOT_ENABLED
     // Generate secure digest from this bootloader to protect future modifications
@@ -555,6 +580,100 @@ static void bootloader_main()
     unpack_load_app(&image_data);
 }
 
+/* Walks the segment headers of an app image, without checking anything, and reads its appended digest */
+static bool image_scan(const esp_partition_pos_t *partition, esp_image_metadata_t *data, uint8_t *digest)
+{
+    memset(data, 0, sizeof(esp_image_metadata_t));
+    data->start_addr = partition->offset;
+    if (bootloader_flash_read(partition->offset, &data->image, sizeof(esp_image_header_t), true) != ESP_OK ||
+        data->image.magic != ESP_IMAGE_HEADER_MAGIC || !data->image.hash_appended ||
+        data->image.segment_count > ESP_IMAGE_MAX_SEGMENTS) {
+        return false;
+    }
+
+    uint32_t next = partition->offset + sizeof(esp_image_header_t);
+    for (int i = 0; i < data->image.segment_count; i++) {
+        esp_image_segment_header_t *header = &data->segments[i];
+        if (bootloader_flash_read(next, header, sizeof(esp_image_segment_header_t), true) != ESP_OK) {
+            return false;
+        }
+        next += sizeof(esp_image_segment_header_t);
+        data->segment_data[i] = next;
+        next += header->data_len;
+        if (next > partition->offset + partition->size) {
+            return false;
+        }
+    }
+
+    // the checksum byte comes next, padded so that the image is a multiple of 16 bytes, then the digest
+    uint32_t len = ((next - partition->offset) + 1 + 15) & ~15;
+    data->image_len = len + IMAGE_DIGEST_LEN;
+    return bootloader_flash_read(partition->offset + len, digest, IMAGE_DIGEST_LEN, true) == ESP_OK;
+}
+
+/* Loads an image that already passed the full check, skipping the checksum and the SHA-256 of the whole image.
+   Only done when the digest stored at the end of the image still matches the one recorded in the boot info,
+   never with secure boot as the signature must be checked on every boot */
+static bool image_fast_load(const esp_partition_pos_t *partition, esp_image_metadata_t *data, const boot_info_t *boot_info)
+{
+    uint8_t digest[IMAGE_DIGEST_LEN];
+    uint32_t magic;
+
+    memcpy(&magic, boot_info->signature, sizeof(magic));
+    if (esp_secure_boot_enabled() || magic != IMAGE_VERIFIED_MAGIC || !image_scan(partition, data, digest) ||
+        memcmp(&boot_info->signature[sizeof(magic)], digest, IMAGE_VERIFIED_DIGEST_LEN)) {
+        return false;
+    }
+
+    // the RTC memory keeps its contents through deep sleep, don't overwrite them when waking up
+    bool load_rtc_memory = rtc_get_reset_reason(0) != DEEPSLEEP_RESET;
+    intptr_t sp = (intptr_t)get_sp();
+    for (int i = 0; i < data->image.segment_count; i++) {
+        const esp_image_segment_header_t *header = &data->segments[i];
+        uint32_t load_addr = header->load_addr;
+        if ((load_addr >= SOC_IROM_LOW && load_addr < SOC_IROM_HIGH) || (load_addr >= SOC_DROM_LOW && load_addr < SOC_DROM_HIGH)) {
+            continue;   // mapped through the cache by unpack_load_app()
+        }
+        if (load_addr < 0x10000000) {
+            continue;   // padding
+        }
+        if (!load_rtc_memory && ((load_addr >= SOC_RTC_IRAM_LOW && load_addr < SOC_RTC_IRAM_HIGH) ||
+                                 (load_addr >= SOC_RTC_DATA_LOW && load_addr < SOC_RTC_DATA_HIGH))) {
+            continue;
+        }
+        intptr_t load_end = load_addr + header->data_len;
+        if (load_end <= (intptr_t)SOC_DIRAM_DRAM_HIGH && load_end > sp - IMAGE_STACK_LOAD_HEADROOM) {
+            return false;
+        }
+        if (bootloader_flash_read(data->segment_data[i], (void *)load_addr, header->data_len, true) != ESP_OK) {
+            return false;
+        }
+    }
+    ESP_LOGI(TAG, "Loaded verified app from partition at offset 0x%x", partition->offset);
+    return true;
+}
+
+/* Records the digest of an image that has just passed the full check */
+static void image_mark_verified(bootloader_state_t *bs, const esp_partition_pos_t *partition, boot_info_t *boot_info)
+{
+    esp_image_metadata_t data;
+    uint8_t digest[IMAGE_DIGEST_LEN];
+    uint32_t magic = IMAGE_VERIFIED_MAGIC;
+
+    if (esp_secure_boot_enabled() || !image_scan(partition, &data, digest)) {
+        return;
+    }
+    if (!memcmp(boot_info->signature, &magic, sizeof(magic)) &&
+        !memcmp(&boot_info->signature[sizeof(magic)], digest, IMAGE_VERIFIED_DIGEST_LEN)) {
+        return;
+    }
+    memcpy(boot_info->signature, &magic, sizeof(magic));
+    memcpy(&boot_info->signature[sizeof(magic)], digest, IMAGE_VERIFIED_DIGEST_LEN);
+    if (!ota_write_boot_info(boot_info, bs->ota_info.offset)) {
+        ESP_LOGE(TAG, "Error writing boot info");
+    }
+}
+
 static void unpack_load_app(const esp_image_metadata_t* data)
 {
     uint32_t drom_addr = 0;
@@ -641,11 +760,24 @@ static void set_cache_and_start_app(
     typedef void (*entry_t)(void);
     entry_t entry = ((entry_t) entry_addr);
 
+    boottime_save();
+
     // TODO: we have used quite a bit of stack at this point.
     // use "movsp" instruction to reset stack back to where ROM stack starts.
     (*entry)();
 }
 
+/* Hands the time spent since reset over to the application, see boottime.h */
+static void boottime_save(void)
+{
+    uint32_t cycles;
+    RSR(CCOUNT, cycles);
+    // the clock was switched early in bootloader_main(), count everything after the ROM at the new frequency
+    uint32_t us = boottime_start_cycles / MAX(boottime_rom_mhz, 1) +
+                  (cycles - boottime_start_cycles) / MAX(ets_get_cpu_frequency(), 1);
+    REG_WRITE(BOOTTIME_BOOTLOADER_REG, BOOTTIME_BOOTLOADER_TAG | MIN(us, BOOTTIME_BOOTLOADER_US_MASK));
+}
+
 static void update_flash_config(const esp_image_header_t* pfhdr)
 {
     uint32_t size;
@@ -34,7 +34,9 @@
 
 #include "esp_intr.h"
 #include "soc/dport_reg.h"
+#include "rom/ets_sys.h"
 #include <math.h>
+#include <string.h>
 
 #include "driver/gpio.h"
 
@@ -44,11 +46,25 @@
 
 static void CAN_read_frame(void);
 static void CAN_isr(void *arg_p);
+static void CAN_load_frame(const CAN_frame_t* p_frame);
+static void CAN_tx_next(void);
 
 static bool isr_installed = false;
 static CAN_frame_format_t CAN_frame_format;
 static CAN_sw_filters_t *CAN_sw_filters;
 
+// TX queue, a binary heap ordered like the bus arbitration, frames with the same ID stay in order
+#define CAN_TX_QUEUE_LEN    (32)
+
+static CAN_frame_t CAN_tx_heap[CAN_TX_QUEUE_LEN];
+static uint32_t CAN_tx_seq[CAN_TX_QUEUE_LEN];
+static uint32_t CAN_tx_count;
+static uint32_t CAN_tx_next_seq;
+static bool CAN_tx_busy;                    // a frame is in the TX buffer of the controller
+static portMUX_TYPE CAN_tx_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static CAN_stats_t CAN_stats;
+
 extern void can_queue_interrupt(uint32_t events);
 
 static void CAN_isr(void *arg_p){
@@ -61,7 +77,7 @@ static void CAN_isr(void *arg_p){
 
     // Handle TX complete interrupt
     if ((interrupt & __CAN_IRQ_TX) != 0) {
-        /*handler*/
+        CAN_tx_next();
     }
 
     // Handle RX frame available interrupt
@@ -76,8 +92,103 @@ static void CAN_isr(void *arg_p){
                       | __CAN_IRQ_ARB_LOST                //0x40
                       | __CAN_IRQ_BUS_ERR                //0x80
     )) != 0) {
-        /*handler*/
+        if (interrupt & __CAN_IRQ_BUS_ERR) {
+            CAN_stats.errors++;
+            // reading the capture register re-arms it
+            (void)MODULE_CAN->ECC;
+        }
+        if (interrupt & __CAN_IRQ_ARB_LOST) {
+            CAN_stats.arb_lost++;
+            (void)MODULE_CAN->ALC;
+        }
+        if (interrupt & __CAN_IRQ_DATA_OVERRUN) {
+            CAN_stats.overruns++;
+            MODULE_CAN->CMR.B.CDO = 1;
+        }
+        if (interrupt & __CAN_IRQ_ERR_PASSIVE) {
+            CAN_stats.err_passive++;
+        }
+    }
+}
+
+// frame length on the bus without the stuff bits, interframe space included
+static uint32_t CAN_frame_bits(const CAN_frame_t* p_frame) {
+    uint32_t bits = (p_frame->FIR.B.FF == CAN_frame_ext) ? 67 : 47;
+    if (p_frame->FIR.B.RTR == CAN_no_RTR) {
+        bits += 8 * p_frame->FIR.B.DLC;
+    }
+    return bits;
+}
+
+// lower keys win the arbitration: ID, then a standard frame before an extended one, then data before remote
+static uint32_t CAN_tx_key(const CAN_frame_t* p_frame) {
+    uint32_t id = (p_frame->FIR.B.FF == CAN_frame_ext) ? p_frame->MsgID : (p_frame->MsgID << 18);
+    return (id << 2) | (p_frame->FIR.B.FF << 1) | p_frame->FIR.B.RTR;
+}
+
+static bool CAN_tx_before(uint32_t a, uint32_t b) {
+    uint32_t key_a = CAN_tx_key(&CAN_tx_heap[a]);
+    uint32_t key_b = CAN_tx_key(&CAN_tx_heap[b]);
+    return (key_a < key_b) || (key_a == key_b && (int32_t)(CAN_tx_seq[a] - CAN_tx_seq[b]) < 0);
+}
+
+static void CAN_tx_swap(uint32_t a, uint32_t b) {
+    CAN_frame_t frame = CAN_tx_heap[a];
+    uint32_t seq = CAN_tx_seq[a];
+    CAN_tx_heap[a] = CAN_tx_heap[b];
+    CAN_tx_seq[a] = CAN_tx_seq[b];
+    CAN_tx_heap[b] = frame;
+    CAN_tx_seq[b] = seq;
+}
+
+static void CAN_tx_push(const CAN_frame_t* p_frame) {
+    uint32_t i = CAN_tx_count++;
+    CAN_tx_heap[i] = *p_frame;
+    CAN_tx_seq[i] = CAN_tx_next_seq++;
+    while (i > 0 && CAN_tx_before(i, (i - 1) / 2)) {
+        CAN_tx_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void CAN_tx_pop(CAN_frame_t* p_frame) {
+    *p_frame = CAN_tx_heap[0];
+    CAN_tx_count--;
+    CAN_tx_heap[0] = CAN_tx_heap[CAN_tx_count];
+    CAN_tx_seq[0] = CAN_tx_seq[CAN_tx_count];
+    for (uint32_t i = 0; ; ) {
+        uint32_t first = i;
+        uint32_t l = (2 * i) + 1, r = (2 * i) + 2;
+        if (l < CAN_tx_count && CAN_tx_before(l, first)) {
+            first = l;
+        }
+        if (r < CAN_tx_count && CAN_tx_before(r, first)) {
+            first = r;
+        }
+        if (first == i) {
+            break;
+        }
+        CAN_tx_swap(i, first);
+        i = first;
+    }
+}
+
+// the TX buffer has been released, load the next frame if any
+static void CAN_tx_next(void) {
+    CAN_frame_t frame;
+    portENTER_CRITICAL_ISR(&CAN_tx_mux);
+    if (CAN_tx_busy && MODULE_CAN->SR.B.TCS) {
+        CAN_stats.tx_frames++;
     }
+    if (CAN_tx_count > 0) {
+        CAN_tx_pop(&frame);
+        CAN_stats.bus_bits += CAN_frame_bits(&frame);
+        CAN_load_frame(&frame);
+        MODULE_CAN->CMR.B.TR = 1;
+    } else {
+        CAN_tx_busy = false;
+    }
+    portEXIT_CRITICAL_ISR(&CAN_tx_mux);
 }
 
 static bool CAN_filter_message(uint32_t msg_id) {
@@ -121,6 +232,7 @@ static void CAN_read_frame(void) {
 
     //get FIR
     __frame.FIR.U=MODULE_CAN->MBX_CTRL.FCTRL.FIR.U;
+    CAN_stats.bus_bits += CAN_frame_bits(&__frame);
 
     //check if this is a standard or extended CAN frame
     //standard frame
@@ -173,7 +285,11 @@ static void CAN_read_frame(void) {
     can_queue_interrupt(events);
 
     //send frame to input queue
-    xQueueSendFromISR(CAN_cfg.rx_queue,&__frame,0);
+    if (xQueueSendFromISR(CAN_cfg.rx_queue,&__frame,0) == pdTRUE) {
+        CAN_stats.rx_frames++;
+    } else {
+        CAN_stats.rx_dropped++;
+    }
 
 drop_frame:
 
@@ -181,15 +297,12 @@ drop_frame:
     MODULE_CAN->CMR.B.RRB=1;
 }
 
-int CAN_write_frame(const CAN_frame_t* p_frame){
+// copies the frame into the TX buffer of the controller, it must be free
+static void CAN_load_frame(const CAN_frame_t* p_frame){
 
     //byte iterator
     uint8_t __byte_i;
 
-    while (MODULE_CAN->SR.B.TS && !MODULE_CAN->SR.B.TBS) {
-        ets_delay_us(50);
-    }
-
     //copy frame information record
     MODULE_CAN->MBX_CTRL.FCTRL.FIR.U=p_frame->FIR.U;
 
@@ -215,13 +328,51 @@ int CAN_write_frame(const CAN_frame_t* p_frame){
             MODULE_CAN->MBX_CTRL.FCTRL.TX_RX.EXT.data[__byte_i]=p_frame->data.u8[__byte_i];
 
     }
+}
 
-    // Transmit frame
-    MODULE_CAN->CMR.B.TR=1;
+int CAN_write_frame(const CAN_frame_t* p_frame){
+
+    // wait for the queue to be sent, then it goes in the TX buffer right away
+    while (!CAN_queue_frame(p_frame)) {
+        ets_delay_us(50);
+    }
 
     return 0;
 }
 
+bool CAN_queue_frame(const CAN_frame_t* p_frame){
+    bool queued = true;
+
+    portENTER_CRITICAL(&CAN_tx_mux);
+    if (!CAN_tx_busy) {
+        CAN_tx_busy = true;
+        CAN_stats.bus_bits += CAN_frame_bits(p_frame);
+        CAN_load_frame(p_frame);
+        // Transmit frame
+        MODULE_CAN->CMR.B.TR=1;
+    } else if (CAN_tx_count < CAN_TX_QUEUE_LEN) {
+        CAN_tx_push(p_frame);
+    } else {
+        queued = false;
+    }
+    portEXIT_CRITICAL(&CAN_tx_mux);
+
+    return queued;
+}
+
+uint32_t CAN_tx_pending(void) {
+    return CAN_tx_count + (CAN_tx_busy ? 1 : 0);
+}
+
+void CAN_get_stats(CAN_stats_t *stats, bool reset_bits) {
+    portENTER_CRITICAL(&CAN_tx_mux);
+    *stats = CAN_stats;
+    if (reset_bits) {
+        CAN_stats.bus_bits = 0;
+    }
+    portEXIT_CRITICAL(&CAN_tx_mux);
+}
+
 int CAN_init(CAN_mode_t mode, CAN_frame_format_t frame_format) {
 
     //Time quantum
@@ -293,6 +444,11 @@ int CAN_init(CAN_mode_t mode, CAN_frame_format_t frame_format) {
     //no software filters
     CAN_sw_filters = NULL;
 
+    //empty TX queue and new counters
+    CAN_tx_count = 0;
+    CAN_tx_busy = false;
+    memset(&CAN_stats, 0, sizeof(CAN_stats));
+
     //set to normal mode
     MODULE_CAN->OCR.B.OCMODE=__CAN_OC_NOM;
 
@@ -327,6 +483,12 @@ int CAN_stop(void) {
     // enter reset mode
     MODULE_CAN->MOD.B.RM = 1;
 
+    // what hasn't been sent yet is dropped
+    portENTER_CRITICAL(&CAN_tx_mux);
+    CAN_tx_count = 0;
+    CAN_tx_busy = false;
+    portEXIT_CRITICAL(&CAN_tx_mux);
+
     return 0;
 }
 
@@ -335,50 +497,16 @@ void CAN_setup_sw_filters(CAN_sw_filters_t *swfilters) {
 }
 
 void CAN_setup_hw_filters(CAN_hw_filters_t *hwfilters) {
-    uint32_t code, mask;
 
-    // enter reset mode
+    // the acceptance filter can only be changed in reset mode
     MODULE_CAN->MOD.B.RM = 1;
-    if (hwfilters->num_filters == 1) {
-        MODULE_CAN->MOD.B.AFM = 1;
-
-        code = hwfilters->codemask[0][0] << 21;
-        mask = hwfilters->codemask[0][1];
-        MODULE_CAN->MBX_CTRL.ACC.CODE[0] = (code >> 24) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[1] = (code >> 16) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[2] = (code >> 8) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[3] = code & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[0] = (mask >> 24) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[1] = (mask >> 16) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[2] = (mask >> 8) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[3] = mask & 0xFF;
-    } else if (hwfilters->num_filters == 2) {
-        MODULE_CAN->MOD.B.AFM = 0;
-
-        code = hwfilters->codemask[0][0];
-        mask = hwfilters->codemask[0][1];
-        MODULE_CAN->MBX_CTRL.ACC.CODE[0] = (code >> 8) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[1] = code & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[0] = (mask >> 8) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[1] = mask & 0xFF;
-
-        code = hwfilters->codemask[1][0];
-        mask = hwfilters->codemask[1][1];
-        MODULE_CAN->MBX_CTRL.ACC.CODE[2] = (code >> 8) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[3] = code & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[2] = (mask >> 8) & 0xFF;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[3] = mask & 0xFF;
-    } else {
-        // no acceptance filtering, as we want to fetch all messages
-        MODULE_CAN->MBX_CTRL.ACC.CODE[0] = 0;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[1] = 0;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[2] = 0;
-        MODULE_CAN->MBX_CTRL.ACC.CODE[3] = 0;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[0] = 0xff;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[1] = 0xff;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[2] = 0xff;
-        MODULE_CAN->MBX_CTRL.ACC.MASK[3] = 0xff;
+
+    MODULE_CAN->MOD.B.AFM = hwfilters->single ? 1 : 0;
+    for (int i = 0; i < 4; i++) {
+        MODULE_CAN->MBX_CTRL.ACC.CODE[i] = hwfilters->code[i];
+        MODULE_CAN->MBX_CTRL.ACC.MASK[i] = hwfilters->mask[i];
     }
+
     // exit reset mode
     MODULE_CAN->MOD.B.RM = 0;
 }
@@ -30,6 +30,7 @@
 #define __DRIVERS_CAN_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "CAN_config.h"
 
 #define CAN_frame_both            2            /**< Support both frame types, only used for Rx filtering. */
@@ -92,11 +93,25 @@ typedef struct {
     uint8_t num_filters;
 }CAN_sw_filters_t;
 
+/** \brief Acceptance filter registers, a mask bit set to 1 means "don't care" */
 typedef struct {
-    uint32_t codemask[2][2];
-    uint8_t num_filters;
+    uint8_t code[4];
+    uint8_t mask[4];
+    bool single;                            /**< \brief single filter mode (AFM) instead of dual */
 }CAN_hw_filters_t;
 
+/** \brief Counters kept by the driver since CAN_init() */
+typedef struct {
+    uint32_t rx_frames;                     /**< \brief frames put in the RX queue */
+    uint32_t rx_dropped;                    /**< \brief frames lost because the RX queue was full */
+    uint32_t tx_frames;                     /**< \brief frames sent */
+    uint32_t errors;                        /**< \brief bus errors seen by the controller */
+    uint32_t arb_lost;                      /**< \brief arbitrations lost, the frame is sent again by the controller */
+    uint32_t overruns;                      /**< \brief frames lost because the RX FIFO of the controller was full */
+    uint32_t err_passive;                   /**< \brief changes of the error passive state */
+    uint32_t bus_bits;                      /**< \brief bits of the frames read or sent, stuffing not included */
+}CAN_stats_t;
+
 typedef enum {
     CAN_RX_FRAME_EVENT = 1,
     CAN_FIFO_NOT_EMPTY_EVENT = 2,
@@ -119,6 +134,27 @@ int CAN_init(CAN_mode_t mode, CAN_frame_format_t frame_format);
  */
 int CAN_write_frame(const CAN_frame_t* p_frame);
 
+/**
+ * \brief Queue a can frame, the queue is sent in CAN ID priority order from the TX interrupt
+ *
+ * \param    p_frame    Pointer to the frame to be send, see #CAN_frame_t
+ * \return  true if the frame was queued, false if the queue is full
+ */
+bool CAN_queue_frame(const CAN_frame_t* p_frame);
+
+/**
+ * \brief Number of frames waiting to be sent, the one being sent included
+ */
+uint32_t CAN_tx_pending(void);
+
+/**
+ * \brief Copy the driver counters
+ *
+ * \param    stats       Where to copy them
+ * \param    reset_bits  Restart counting the bus bits
+ */
+void CAN_get_stats(CAN_stats_t *stats, bool reset_bits);
+
 /**
  * \brief Stops the CAN Module
  *
@@ -16,6 +16,7 @@
 #include "sdmmc_cmd.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "soc/soc_memory_layout.h"
 #include "lib/oofatfs/ff.h"
 #include "lib/oofatfs/diskio.h"
 #include "sd_diskio.h"
@@ -36,26 +37,40 @@
 #define CARD_VERSION_1              0
 #define CARD_VERSION_2              1
 
+// bounce buffer used when the caller's buffer can't be handed to the SDMMC DMA
+#define SD_DMA_BUFFER_SECTORS       8
+
 //*****************************************************************************
 // Disk Info for attached disk
 //*****************************************************************************
 sdmmc_card_t sdmmc_card_info;
 static DSTATUS sd_card_status = STA_NOINIT;
+static BYTE *sd_dma_buffer = NULL;
+
+//*****************************************************************************
+//
+//! Tells if the buffer can be transferred by the SDMMC DMA as it is
+//
+//*****************************************************************************
+static bool sd_disk_dma_capable (const void *pBuffer) {
+    return esp_ptr_dma_capable(pBuffer) && (((uintptr_t)pBuffer & 0x03) == 0);
+}
 
 //*****************************************************************************
 //
 //! Initializes physical drive
 //!
-//! This function initializes the physical drive
+//! This function initializes the physical drive with the given bus width
+//! (1 or 4 bits) and maximum clock frequency
 //!
 //! \return Returns 0 on succeeded.
 //*****************************************************************************
-DSTATUS sd_disk_init (void) {
+DSTATUS sd_disk_init (uint32_t max_freq_khz, uint8_t width) {
     sdmmc_host_t config =
     {
-        .flags = SDMMC_HOST_FLAG_1BIT,
+        .flags = (width == 4) ? SDMMC_HOST_FLAG_4BIT : SDMMC_HOST_FLAG_1BIT,
         .slot = SDMMC_HOST_SLOT_1,
-        .max_freq_khz = SDMMC_FREQ_DEFAULT,
+        .max_freq_khz = max_freq_khz,
         .io_voltage = 3.3f,
         .init = &sdmmc_host_init,
         .set_bus_width = &sdmmc_host_set_bus_width,
@@ -69,6 +84,16 @@ DSTATUS sd_disk_init (void) {
     gpio_set_pull_mode(2, GPIO_PULLUP_ONLY);
     gpio_set_pull_mode(14, GPIO_PULLUP_ONLY);
     gpio_set_pull_mode(15, GPIO_PULLUP_ONLY);
+    if (width == 4) {
+        // D1, D2 and D3
+        gpio_set_pull_mode(4, GPIO_PULLUP_ONLY);
+        gpio_set_pull_mode(12, GPIO_PULLUP_ONLY);
+        gpio_set_pull_mode(13, GPIO_PULLUP_ONLY);
+    }
+
+    if (sd_dma_buffer == NULL) {
+        sd_dma_buffer = heap_caps_malloc(SD_DMA_BUFFER_SECTORS * SD_SECTOR_SIZE, MALLOC_CAP_DMA);
+    }
 
     if (ESP_OK == sdmmc_card_init(&config, &sdmmc_card_info)) {
         sd_card_status = 0;
@@ -88,6 +113,8 @@ DSTATUS sd_disk_init (void) {
 void sd_disk_deinit (void) {
     sdmmc_card_info.csd.capacity = 0;
     sd_card_status = STA_NOINIT;
+    heap_caps_free(sd_dma_buffer);
+    sd_dma_buffer = NULL;
 }
 
 //*****************************************************************************
@@ -95,14 +122,30 @@ void sd_disk_deinit (void) {
 //! Reads sector(s) from the disk drive.
 //!
 //!
-//! This function reads specified number of sectors from the drive
+//! This function reads specified number of sectors from the drive, DMA
+//! capable buffers are filled directly with a single multi-block command
 //!
 //! \return Returns RES_OK on success.
 //
 //*****************************************************************************
 DRESULT sd_disk_read (BYTE* pBuffer, DWORD ulSectorNumber, UINT SectorCount) {
     if (SectorCount > 0) {
-        if (ESP_OK == sdmmc_read_sectors(&sdmmc_card_info, pBuffer, ulSectorNumber, SectorCount)) {
+        if (sd_disk_dma_capable(pBuffer) || sd_dma_buffer == NULL) {
+            if (ESP_OK == sdmmc_read_sectors(&sdmmc_card_info, pBuffer, ulSectorNumber, SectorCount)) {
+                return RES_OK;
+            }
+        } else {
+            // the driver would bounce every sector on its own, move several per command instead
+            while (SectorCount > 0) {
+                UINT count = (SectorCount > SD_DMA_BUFFER_SECTORS) ? SD_DMA_BUFFER_SECTORS : SectorCount;
+                if (ESP_OK != sdmmc_read_sectors(&sdmmc_card_info, sd_dma_buffer, ulSectorNumber, count)) {
+                    return RES_ERROR;
+                }
+                memcpy(pBuffer, sd_dma_buffer, count * SD_SECTOR_SIZE);
+                pBuffer += count * SD_SECTOR_SIZE;
+                ulSectorNumber += count;
+                SectorCount -= count;
+            }
             return RES_OK;
         }
     }
@@ -114,14 +157,30 @@ DRESULT sd_disk_read (BYTE* pBuffer, DWORD ulSectorNumber, UINT SectorCount) {
 //! Wrties sector(s) to the disk drive.
 //!
 //!
-//! This function writes specified number of sectors to the drive
+//! This function writes specified number of sectors to the drive, DMA
+//! capable buffers are sent directly with a single multi-block command
 //!
 //! \return Returns RES_OK on success.
 //
 //*****************************************************************************
 DRESULT sd_disk_write (const BYTE* pBuffer, DWORD ulSectorNumber, UINT SectorCount) {
     if (SectorCount > 0) {
-        if (ESP_OK == sdmmc_write_sectors(&sdmmc_card_info, pBuffer, ulSectorNumber, SectorCount)) {
+        if (sd_disk_dma_capable(pBuffer) || sd_dma_buffer == NULL) {
+            if (ESP_OK == sdmmc_write_sectors(&sdmmc_card_info, pBuffer, ulSectorNumber, SectorCount)) {
+                return RES_OK;
+            }
+        } else {
+            // the driver would bounce every sector on its own, move several per command instead
+            while (SectorCount > 0) {
+                UINT count = (SectorCount > SD_DMA_BUFFER_SECTORS) ? SD_DMA_BUFFER_SECTORS : SectorCount;
+                memcpy(sd_dma_buffer, pBuffer, count * SD_SECTOR_SIZE);
+                if (ESP_OK != sdmmc_write_sectors(&sdmmc_card_info, sd_dma_buffer, ulSectorNumber, count)) {
+                    return RES_ERROR;
+                }
+                pBuffer += count * SD_SECTOR_SIZE;
+                ulSectorNumber += count;
+                SectorCount -= count;
+            }
             return RES_OK;
         }
     }
@@ -18,7 +18,7 @@
 
 extern sdmmc_card_t sdmmc_card_info;
 
-DSTATUS sd_disk_init (void);
+DSTATUS sd_disk_init (uint32_t max_freq_khz, uint8_t width);
 void sd_disk_deinit (void);
 DRESULT sd_disk_read (BYTE* pBuffer, DWORD ulSectorNumber, UINT bSectorCount);
 DRESULT sd_disk_write (const BYTE* pBuffer, DWORD ulSectorNumber, UINT bSectorCount);
@@ -18,31 +18,102 @@
 #include "esp_flash_encrypt.h"
 #include "esp32chipinfo.h"
 
-static uint8_t *sflash_block_cache;
-static bool sflash_cache_is_dirty;
-static uint32_t sflash_prev_block_addr;
+typedef struct {
+    uint8_t *data;          // allocated on first use
+    uint32_t addr;          // flash address of the cached block, UINT32_MAX if unused
+    uint32_t last_use;      // value of sflash_cache_tick at the latest access
+    bool dirty;
+} sflash_cache_block_t;
+
+static sflash_cache_block_t sflash_cache[SFLASH_CACHE_BLOCKS_PSRAM];
+static uint32_t sflash_cache_blocks;
+static uint32_t sflash_cache_tick;
 static bool sflash_init_done = false;
 
 static uint32_t sflash_start_address;
 static uint32_t sflash_fs_sector_count;
 
 
-static bool sflash_write (void) {
+static bool sflash_write (sflash_cache_block_t *block) {
     esp_err_t wr_result = ESP_FAIL;
 
     // erase the block first
-    if (ESP_OK == spi_flash_erase_sector(sflash_prev_block_addr / SFLASH_BLOCK_SIZE)) {
+    if (ESP_OK == spi_flash_erase_sector(block->addr / SFLASH_BLOCK_SIZE)) {
             // then write it
             if (esp_flash_encryption_enabled()) {
-                // sflash_prev_block_addr being 4KB block address is aligned 32B
-                wr_result = spi_flash_write_encrypted(sflash_prev_block_addr, (void *)sflash_block_cache, SFLASH_BLOCK_SIZE);
+                // the block address being 4KB aligned is aligned 32B
+                wr_result = spi_flash_write_encrypted(block->addr, (void *)block->data, SFLASH_BLOCK_SIZE);
             } else {
-                wr_result = spi_flash_write(sflash_prev_block_addr, (void *)sflash_block_cache, SFLASH_BLOCK_SIZE);
+                wr_result = spi_flash_write(block->addr, (void *)block->data, SFLASH_BLOCK_SIZE);
             }
     }
     return (wr_result == ESP_OK);
 }
 
+static bool sflash_cache_evict (sflash_cache_block_t *block) {
+    if (block->dirty) {
+        if (!sflash_write(block)) {
+            return false;
+        }
+        block->dirty = false;
+    }
+    block->addr = UINT32_MAX;
+    return true;
+}
+
+// returns the cache entry holding the block at sflash_block_addr, loading it if needed,
+// the least recently used entry is written back to make room
+static sflash_cache_block_t *sflash_cache_get (uint32_t sflash_block_addr) {
+    sflash_cache_block_t *unused = NULL;
+    sflash_cache_block_t *unallocated = NULL;
+    sflash_cache_block_t *lru = NULL;
+
+    for (int i = 0; i < sflash_cache_blocks; i++) {
+        sflash_cache_block_t *block = &sflash_cache[i];
+        if (block->addr == sflash_block_addr) {
+            block->last_use = ++sflash_cache_tick;
+            return block;
+        }
+        if (block->data == NULL) {
+            if (unallocated == NULL) {
+                unallocated = block;
+            }
+        } else if (block->addr == UINT32_MAX) {
+            if (unused == NULL) {
+                unused = block;
+            }
+        } else if (lru == NULL || block->last_use < lru->last_use) {
+            lru = block;
+        }
+    }
+
+    sflash_cache_block_t *victim = unused;
+    if (victim == NULL && unallocated != NULL) {
+        uint32_t caps = (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        unallocated->data = (uint8_t *)heap_caps_malloc(SFLASH_BLOCK_SIZE, caps);
+        if (unallocated->data != NULL) {
+            victim = unallocated;
+        }
+    }
+    if (victim == NULL) {
+        // all the entries are in use (or there is no memory for another one), recycle the least recently used
+        victim = lru;
+    }
+    if (victim == NULL) {
+        return NULL;
+    }
+
+    if (!sflash_cache_evict(victim)) {
+        return NULL;
+    }
+    if (ESP_OK != spi_flash_read_encrypted(sflash_block_addr, (void *)victim->data, SFLASH_BLOCK_SIZE)) {
+        return NULL;
+    }
+    victim->addr = sflash_block_addr;
+    victim->last_use = ++sflash_cache_tick;
+    return victim;
+}
+
 DRESULT sflash_disk_init (void) {
 
     if (!sflash_init_done) {
@@ -54,9 +125,13 @@ DRESULT sflash_disk_init (void) {
             sflash_start_address = SFLASH_START_ADDR_4MB;
             sflash_fs_sector_count = SFLASH_FS_SECTOR_COUNT_4MB;
         }
-        sflash_block_cache = (uint8_t *)heap_caps_malloc(SFLASH_BLOCK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-        sflash_prev_block_addr = UINT32_MAX;
-        sflash_cache_is_dirty = false;
+        // the blocks themselves are only allocated once FatFS uses them
+        sflash_cache_blocks = (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) ? SFLASH_CACHE_BLOCKS_PSRAM : SFLASH_CACHE_BLOCKS_DEFAULT;
+        for (int i = 0; i < sflash_cache_blocks; i++) {
+            sflash_cache[i].data = NULL;
+            sflash_cache[i].addr = UINT32_MAX;
+            sflash_cache[i].dirty = false;
+        }
         sflash_init_done = true;
     }
     return RES_OK;
@@ -83,20 +158,13 @@ DRESULT sflash_disk_read(BYTE *buff, DWORD sector, UINT count) {
     for (int index = 0; index < count; index++) {
         secindex = (sector + index) % SFLASH_SECTORS_PER_BLOCK;
         uint32_t sflash_block_addr = sflash_start_address + (((sector + index) / SFLASH_SECTORS_PER_BLOCK) * SFLASH_BLOCK_SIZE);
-        // Check if it's a different block than last time
-        if (sflash_prev_block_addr != sflash_block_addr) {
-            if (sflash_disk_flush() != RES_OK) {
-                // TODO sl_LockObjUnlock (&flash_LockObj);
-                return RES_ERROR;
-            }
-            sflash_prev_block_addr = sflash_block_addr;
-            if (ESP_OK != spi_flash_read_encrypted(sflash_block_addr, (void *)sflash_block_cache, SFLASH_BLOCK_SIZE)) {
-                // TODO sl_LockObjUnlock (&flash_LockObj);
-                return RES_ERROR;
-            }
+        sflash_cache_block_t *block = sflash_cache_get(sflash_block_addr);
+        if (block == NULL) {
+            // TODO sl_LockObjUnlock (&flash_LockObj);
+            return RES_ERROR;
         }
         // Copy the requested sector from the block cache
-        memcpy (buff, (void *)&sflash_block_cache[secindex * SFLASH_FS_SECTOR_SIZE], SFLASH_FS_SECTOR_SIZE);
+        memcpy (buff, (void *)&block->data[secindex * SFLASH_FS_SECTOR_SIZE], SFLASH_FS_SECTOR_SIZE);
         buff += SFLASH_FS_SECTOR_SIZE;
     }
 
@@ -119,37 +187,30 @@ DRESULT sflash_disk_write(const BYTE *buff, DWORD sector, UINT count) {
     do {
         secindex = (sector + index) % SFLASH_SECTORS_PER_BLOCK;
         uint32_t sflash_block_addr = sflash_start_address + (((sector + index) / SFLASH_SECTORS_PER_BLOCK) * SFLASH_BLOCK_SIZE);
-        // Check if it's a different block than last time
-        if (sflash_prev_block_addr != sflash_block_addr) {
-            if (sflash_disk_flush() != RES_OK) {
-                // TODO sl_LockObjUnlock (&flash_LockObj);
-                return RES_ERROR;
-            }
-            sflash_prev_block_addr = sflash_block_addr;
-            if (ESP_OK != spi_flash_read_encrypted(sflash_block_addr, (void *)sflash_block_cache, SFLASH_BLOCK_SIZE)) {
-//                // TODO sl_LockObjUnlock (&flash_LockObj);
-                return RES_ERROR;
-            }
+        sflash_cache_block_t *block = sflash_cache_get(sflash_block_addr);
+        if (block == NULL) {
+            // TODO sl_LockObjUnlock (&flash_LockObj);
+            return RES_ERROR;
         }
-        // copy the input sector to the block cache
-        memcpy ((void *)&sflash_block_cache[secindex * SFLASH_FS_SECTOR_SIZE], buff, SFLASH_FS_SECTOR_SIZE);
+        // copy the input sector to the block cache, it is written back on eviction or flush
+        memcpy ((void *)&block->data[secindex * SFLASH_FS_SECTOR_SIZE], buff, SFLASH_FS_SECTOR_SIZE);
         buff += SFLASH_FS_SECTOR_SIZE;
-        sflash_cache_is_dirty = true;
+        block->dirty = true;
     } while (++index < count);
 
     // TODO sl_LockObjUnlock (&flash_LockObj);
     return RES_OK;
 }
 
-int sflash_disk_read_littlefs(const struct lfs_config *lfscfg, void* buff, uint32_t block, uint32_t size)
+int sflash_disk_read_littlefs(const struct lfs_config *lfscfg, void* buff, uint32_t block, uint32_t offset, uint32_t size)
 {
     // TODO sl_LockObjLock (&flash_LockObj, SL_OS_WAIT_FOREVER);
     int ret = LFS_ERR_OK;
 
-    if(block >= lfscfg->block_count) {
+    if(block >= lfscfg->block_count || offset + size > SFLASH_BLOCK_SIZE) {
         ret = LFS_ERR_IO;
     }
-    else if (ESP_OK != spi_flash_read(sflash_start_address + block*SFLASH_BLOCK_SIZE, buff, size)) {
+    else if (ESP_OK != spi_flash_read(sflash_start_address + block*SFLASH_BLOCK_SIZE + offset, buff, size)) {
         ret = LFS_ERR_IO;
     }
 
@@ -173,15 +234,15 @@ int sflash_disk_erase_littlefs(const struct lfs_config *lfscfg, uint32_t block)
     return ret;
 }
 
-int sflash_disk_write_littlefs(const struct lfs_config *lfscfg, const void *buff, uint32_t block, uint32_t size) {
+int sflash_disk_write_littlefs(const struct lfs_config *lfscfg, const void *buff, uint32_t block, uint32_t offset, uint32_t size) {
 
     // TODO sl_LockObjLock (&flash_LockObj, SL_OS_WAIT_FOREVER);
     int ret = LFS_ERR_OK;
 
-    if(block >= lfscfg->block_count) {
+    if(block >= lfscfg->block_count || offset + size > SFLASH_BLOCK_SIZE) {
         ret = LFS_ERR_IO;
     }
-    else if(ESP_OK != spi_flash_write((sflash_start_address + block*SFLASH_BLOCK_SIZE), buff, size)) {
+    else if(ESP_OK != spi_flash_write((sflash_start_address + block*SFLASH_BLOCK_SIZE + offset), buff, size)) {
         ret = LFS_ERR_IO;
     }
 
@@ -190,12 +251,15 @@ int sflash_disk_write_littlefs(const struct lfs_config *lfscfg, const void *buff
 }
 
 DRESULT sflash_disk_flush (void) {
-    // write back the cache if it's dirty
-    if (sflash_cache_is_dirty) {
-        if (!sflash_write()) {
-            return RES_ERROR;
+    // write back all the dirty blocks, they stay cached for reading
+    for (int i = 0; i < sflash_cache_blocks; i++) {
+        sflash_cache_block_t *block = &sflash_cache[i];
+        if (block->dirty) {
+            if (!sflash_write(block)) {
+                return RES_ERROR;
+            }
+            block->dirty = false;
         }
-        sflash_cache_is_dirty = false;
     }
     return RES_OK;
 }
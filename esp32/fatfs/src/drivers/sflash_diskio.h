@@ -27,6 +27,10 @@
 #define SFLASH_START_BLOCK_8MB          (SFLASH_START_ADDR_8MB / SFLASH_BLOCK_SIZE)
 #define SFLASH_END_BLOCK_8MB            (SFLASH_START_BLOCK_8MB + (SFLASH_BLOCK_COUNT - 1))
 
+// FatFS blocks kept in the write-back cache, a typical append touches the data, FAT and directory blocks
+#define SFLASH_CACHE_BLOCKS_DEFAULT     4
+#define SFLASH_CACHE_BLOCKS_PSRAM       16
+
 DRESULT sflash_disk_init(void);
 DRESULT sflash_disk_status(void);
 DRESULT sflash_disk_read(BYTE *buff, DWORD sector, UINT count);
@@ -34,8 +38,8 @@ DRESULT sflash_disk_write(const BYTE *buff, DWORD sector, UINT count);
 DRESULT sflash_disk_flush(void);
 uint32_t sflash_get_sector_count(void);
 
-extern int sflash_disk_read_littlefs(const struct lfs_config *lfscfg, void* buff, uint32_t block, uint32_t size);
-extern int sflash_disk_write_littlefs(const struct lfs_config *lfscfg, const void* buff, uint32_t block, uint32_t size);
+extern int sflash_disk_read_littlefs(const struct lfs_config *lfscfg, void* buff, uint32_t block, uint32_t offset, uint32_t size);
+extern int sflash_disk_write_littlefs(const struct lfs_config *lfscfg, const void* buff, uint32_t block, uint32_t offset, uint32_t size);
 extern int sflash_disk_erase_littlefs(const struct lfs_config *lfscfg, uint32_t block);
 
 #endif /* SFLASH_DISKIO_H_ */
@@ -0,0 +1,210 @@
+"""
+Reliable multi-packet transfers over a raw LoRa or FSK socket.
+
+Frames are at most 63 bytes, what the FSK FIFO holds, so the same code runs in
+both raw modes. The sender pushes a window of DATA frames and polls on the last
+one, the receiver answers with the next sequence number it expects plus a bitmap
+of the frames it already holds after it, and only the missing ones go out again.
+The transfer ends with the length and the CRC32 of the whole data.
+
+    lora = LoRa(mode=LoRa.FSK, bitrate=250000, fdev=100000, region=LoRa.EU868)
+    s = socket.socket(socket.AF_LORA, socket.SOCK_RAW)
+
+    # on the sender
+    with open('/flash/log.txt', 'rb') as f:
+        lorabulk.send(s, f)
+
+    # on the receiver
+    with open('/flash/log.txt', 'wb') as f:
+        lorabulk.recv(s, f)
+"""
+
+import struct
+import time
+import ubinascii
+import uerrno
+import uio
+from micropython import const
+
+FRAME_MAX = const(63)
+_HEADER = const(4)
+CHUNK = FRAME_MAX - _HEADER
+WINDOW_MAX = const(16)
+
+_START = const(0x01)
+_DATA = const(0x02)
+_ACK = const(0x03)
+_END = const(0x04)
+_DONE = const(0x05)
+_POLL = const(0x80)
+
+_xid = 0
+
+
+def _frame(kind, xid, seq, payload=b''):
+    return struct.pack('>BBH', kind, xid, seq & 0xFFFF) + payload
+
+
+def _parse(frame):
+    if len(frame) < _HEADER:
+        return None
+    kind, xid, seq = struct.unpack_from('>BBH', frame)
+    return kind, xid, seq, frame[_HEADER:]
+
+
+def _unwrap(seq, ref):
+    # the full sequence number closest to ref, frames only carry the low 16 bits
+    delta = (seq - ref) & 0xFFFF
+    return ref + delta - (0x10000 if delta & 0x8000 else 0)
+
+
+def _wait(sock, xid, kind, timeout):
+    # the first reply of the expected kind for this transfer, None on timeout
+    deadline = time.ticks_add(time.ticks_ms(), int(timeout * 1000))
+    while True:
+        left = time.ticks_diff(deadline, time.ticks_ms())
+        if left <= 0:
+            return None
+        sock.settimeout(left / 1000)
+        try:
+            frame = _parse(sock.recv(64))
+        except OSError as e:
+            if e.args[0] in (uerrno.EAGAIN, uerrno.ETIMEDOUT):
+                return None
+            raise
+        if frame and frame[0] == kind and frame[1] == xid:
+            return frame
+
+
+def _call(sock, frame, xid, kind, timeout, retries):
+    for _ in range(retries):
+        sock.send(frame)
+        reply = _wait(sock, xid, kind, timeout)
+        if reply:
+            return reply
+    raise OSError(uerrno.ETIMEDOUT)
+
+
+def send(sock, stream, window=WINDOW_MAX, timeout=0.5, retries=10):
+    """Send the bytes or the stream, returns the number of bytes sent"""
+    global _xid
+    if not 0 < window <= WINDOW_MAX:
+        raise ValueError('window must be 1 to 16 frames')
+    if isinstance(stream, (bytes, bytearray, memoryview)):
+        stream = uio.BytesIO(stream)
+    _xid = (_xid + 1) & 0xFF
+    xid = _xid
+
+    _call(sock, _frame(_START, xid, 0), xid, _ACK, timeout, retries)
+
+    seq = 0
+    crc = 0
+    total = 0
+    while True:
+        chunks = []
+        while len(chunks) < window:
+            chunk = stream.read(CHUNK)
+            if not chunk:
+                break
+            crc = ubinascii.crc32(chunk, crc)
+            total += len(chunk)
+            chunks.append(chunk)
+        if not chunks:
+            break
+
+        pending = list(range(len(chunks)))
+        for _ in range(retries):
+            for n, i in enumerate(pending):
+                kind = _DATA | (_POLL if n == len(pending) - 1 else 0)
+                sock.send(_frame(kind, xid, seq + i, chunks[i]))
+            ack = _wait(sock, xid, _ACK, timeout)
+            if ack is None:
+                continue
+            # the receiver holds everything before next, and the frames set in the bitmap after it
+            nxt = _unwrap(ack[2], seq)
+            bitmap, = struct.unpack('>H', ack[3])
+            pending = [i for i in pending if seq + i >= nxt and not (bitmap >> (seq + i - nxt)) & 1]
+            if not pending:
+                break
+        else:
+            raise OSError(uerrno.ETIMEDOUT)
+        seq += len(chunks)
+
+    done = _call(sock, _frame(_END, xid, seq, struct.pack('>II', total, crc)), xid, _DONE, timeout, retries)
+    if done[3] != b'\x00':
+        raise OSError(uerrno.EIO)
+    return total
+
+
+class Receiver:
+    """The receiving side as a state machine, feed() returns the reply to send (if any)"""
+
+    def __init__(self, stream, window=WINDOW_MAX):
+        self._stream = stream
+        self._window = window
+        self.xid = None
+        self.next = 0
+        self.total = 0
+        self.crc = 0
+        self.done = False
+        self.ok = False
+        self._held = {}
+
+    def _ack(self):
+        bitmap = 0
+        for seq in self._held:
+            bitmap |= 1 << (seq - self.next)
+        return _frame(_ACK, self.xid, self.next, struct.pack('>H', bitmap))
+
+    def feed(self, frame):
+        frame = _parse(frame)
+        if frame is None:
+            return None
+        kind, xid, seq, payload = frame
+        if kind == _START:
+            if self.xid != xid:
+                self.__init__(self._stream, self._window)
+                self.xid = xid
+            return self._ack()
+        if xid != self.xid:
+            return None
+        if kind & ~_POLL == _DATA:
+            seq = _unwrap(seq, self.next)
+            if self.next <= seq < self.next + self._window:
+                self._held[seq] = bytes(payload)
+            # write out what's now in order
+            while self.next in self._held:
+                chunk = self._held.pop(self.next)
+                self._stream.write(chunk)
+                self.crc = ubinascii.crc32(chunk, self.crc)
+                self.total += len(chunk)
+                self.next += 1
+            if kind & _POLL:
+                return self._ack()
+        elif kind == _END:
+            total, crc = struct.unpack('>II', payload)
+            self.done = True
+            self.ok = total == self.total and crc == self.crc
+            return _frame(_DONE, xid, seq, b'\x00' if self.ok else b'\x01')
+        return None
+
+
+def recv(sock, stream, timeout=30, linger=2):
+    """Receive one transfer into the stream, returns the number of bytes received"""
+    rx = Receiver(stream)
+    sock.settimeout(timeout)
+    while True:
+        try:
+            reply = rx.feed(sock.recv(64))
+        except OSError as e:
+            if rx.done and e.args[0] in (uerrno.EAGAIN, uerrno.ETIMEDOUT):
+                break
+            raise
+        if reply:
+            sock.send(reply)
+        if rx.done:
+            # stay around a bit in case the DONE frame got lost and END comes again
+            sock.settimeout(linger)
+    if not rx.ok:
+        raise OSError(uerrno.EIO)
+    return rx.total
@@ -56,3 +56,8 @@ def fletcher32 (data):
     s2 = (s2 & 0xFFFF) + (s2 >> 16)
 
     return (s2 << 16) | s1
+
+try:
+    from usqnstp import fletcher32
+except ImportError:
+    pass
@@ -21,6 +21,12 @@ import struct
 import time
 import os
 
+try:
+    # the block transfer and the CRC in C, on the GPy and the FiPy
+    import usqnstp
+except ImportError:
+    usqnstp = None
+
 try:
     sysname = os.uname().sysname
 except:
@@ -65,6 +71,9 @@ def crc16(s):
         crc = ((crc<<8)&0xff00) ^ table[((crc>>8)&0xff)^ch]
     return crc
 
+if usqnstp is not None:
+    crc16 = usqnstp.crc16
+
 def usleep(x):
     time.sleep(x/1000000.0)
 
@@ -287,6 +296,18 @@ class Master:
                     else: raise
                 return False
 
+        if usqnstp is not None and ('FiPy' in sysname or 'GPy' in sysname):
+            # the whole image in one call, read from the file in large chunks
+            progress = lambda downloaded: self.progress("Sending %d bytes" % filesize, downloaded, filesize)
+            try:
+                self.tid = usqnstp.push(self.dev.serial, blobfile, sid=self.sid, tid=self.tid, max_transfer=self.max_transfer,
+                                        timeout=self.dev.timeout, progress=progress)
+            except OSError as ex:
+                raise MException("Block transfer failed: %s" % ex)
+            blobfile.close()
+            self.progressComplete()
+            return True
+
         trial = Trial(trials)
 
         downloaded = 0
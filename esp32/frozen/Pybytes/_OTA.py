@@ -21,8 +21,6 @@ except:
     import _urequest as urequest
 
 import network
-import socket
-import ssl
 import machine
 import ujson
 import uhashlib
@@ -32,6 +30,10 @@ import pycom
 import os
 from binascii import hexlify
 
+# pycom.ota_write() only copies the data for the updater task, so the socket keeps
+# being read while the flash is programmed; bigger reads keep the TCP window open
+OTA_RECV_SIZE = 1024
+
 # Try to get version number
 # try:
 #     from OTA_VERSION import VERSION
@@ -208,27 +210,16 @@ class WiFiOTA(OTA):
             # Already connected to the correct WiFi
             pass
 
-    def _http_get(self, path, host):
-        req_fmt = 'GET /{} HTTP/1.0\r\nHost: {}\r\n\r\n'
-        req = bytes(req_fmt.format(path, host), 'utf8')
-        return req
-
     def get_data(self, req, dest_path=None, hash=False, firmware=False):
         h = None
 
         useSSL = int(self.port) == 443
 
-        # Connect to server
+        # The manifest and the files come one after the other from the same
+        # server, urequest keeps the connection open between them
         print("Requesting: {} to {}:{} with SSL? {}".format(req, self.ip, self.port, useSSL))
-        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM, socket.IPPROTO_TCP)
-        s.connect(socket.getaddrinfo(self.ip, self.port)[0][-1])
-        if (int(self.port) == 443):
-            print("Wrapping socket")
-            s = ssl.wrap_socket(s)
-
-        print("Sending request")
-        # Request File
-        s.sendall(self._http_get(req, "{}:{}".format(self.ip, self.port)))
+        url = "{}://{}:{}/{}".format("https" if useSSL else "http", self.ip, self.port, req)
+        resp = urequest.get(url)
 
         try:
             content = bytearray()
@@ -245,32 +236,20 @@ class WiFiOTA(OTA):
 
             h = uhashlib.sha1()
 
-            # Get data from server
-            result = s.recv(50)
-            print_debug(4, "Result: {}".format(result))
-
-            start_writing = False
-            while (len(result) > 0):
-                # Ignore the HTTP headers
-                if not start_writing:
-                    if "\r\n\r\n" in result:
-                        start_writing = True
-                        result = result.split(b'\r\n\r\n')[1]
-
-                if start_writing:
-                    if firmware:
-                        pycom.ota_write(result)
-                    elif fp is None:
-                        content.extend(result)
-                    else:
-                        fp.write(result)
-
-                    if hash:
-                        h.update(result)
+            # Get data from server, the headers are already parsed
+            print_debug(4, "Result: {} {}".format(resp.status_code, resp.reason))
+            for result in resp.iter_content(OTA_RECV_SIZE):
+                if firmware:
+                    pycom.ota_write(result)
+                elif fp is None:
+                    content.extend(result)
+                else:
+                    fp.write(result)
 
-                result = s.recv(50)
+                if hash:
+                    h.update(result)
 
-            s.close()
+            resp.close()
 
             if fp is not None:
                 fp.close()
@@ -279,6 +258,7 @@ class WiFiOTA(OTA):
                 pycom.ota_finish()
 
         except Exception as e:
+            resp.close()
             gc.mem_free()
             # Since only one hash operation is allowed at Once
             # ensure we close it if there is an error
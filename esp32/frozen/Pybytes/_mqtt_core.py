@@ -26,8 +26,15 @@ except:
 
 import time
 import struct
+import socket
 import _thread
 
+try:
+    # the MQTT client written in C, with its own keepalive task
+    from network import MQTT as NativeMQTT
+except ImportError:
+    NativeMQTT = None
+
 
 class MQTTMessage:
     def __init__(self):
@@ -41,7 +48,7 @@ class MQTTMessage:
         self.retain = False
 
 
-class MQTTCore:
+class MQTTPythonCore:
 
     def __init__(
                 self,
@@ -403,3 +410,120 @@ class MQTTCore:
         else:
             print_debug(2, 'Unknown message type: %d' % msg_type)
             return False
+
+
+class MQTTNativeCore(MQTTPythonCore):
+
+    def __init__(
+                self,
+                clientID,
+                cleanSession,
+                protocol,
+                receive_timeout=3000,
+                reconnectMethod=None
+            ):
+        # no message handler thread, the native client serves the socket
+        self.client_id = clientID
+        self._cleanSession = cleanSession
+        self._protocol = protocol
+        self._user = ""
+        self._password = ""
+        self._host = ""
+        self._port = -1
+        self._sock = None
+        self._client = None
+        self._connectdisconnectTimeout = 30
+        self._mqttOperationTimeout = 5
+        self._ping_interval = 20
+        self._topic_callback_queue = []
+        self._callback_mutex = _thread.allocate_lock()
+        self._reconnectMethod = reconnectMethod
+
+    def configEndpoint(self, srcHost, srcPort):
+        self._host = srcHost
+        self._port = srcPort
+
+    def _close(self):
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+
+    def connect(self):
+        self._close()
+        self._client = NativeMQTT(
+                self.client_id,
+                keepalive=self._ping_interval,
+                clean_session=self._cleanSession,
+                user=self._user if self._user else None,
+                password=self._password if self._password else None
+            )
+        self._client.set_callback(self._recv_message)
+        self._client.set_lost_callback(self._lost)
+        try:
+            self._sock = socket.socket()
+            self._sock.settimeout(self._connectdisconnectTimeout)
+            self._sock.connect(
+                socket.getaddrinfo(self._host, self._port)[0][-1]
+            )
+            self._client.connect(
+                self._sock,
+                timeout=self._connectdisconnectTimeout
+            )
+        except OSError as err:
+            print_debug(2, "MQTT connect error: {0}".format(err))
+            self._close()
+            return False
+        return True
+
+    def subscribe(self, topic, qos, callback):
+        if (topic is None or callback is None):
+            raise TypeError("Invalid subscribe values.")
+        topic = topic.encode('utf-8')
+        try:
+            self._client.subscribe(
+                topic,
+                qos,
+                timeout=self._mqttOperationTimeout
+            )
+        except OSError:
+            return False
+        self._callback_mutex.acquire()
+        self._topic_callback_queue.append((topic, callback))
+        self._callback_mutex.release()
+        return True
+
+    def publish(self, topic, payload, qos, retain, dup=False, priority=False):
+        # the payload goes out from its buffer, the client sets DUP on a resend
+        self._client.publish(topic, payload, qos, retain)
+
+    def unsubscribe(self, topic):
+        try:
+            self._client.unsubscribe(
+                topic,
+                timeout=self._mqttOperationTimeout
+            )
+        except OSError:
+            return False
+        return self._remove_topic_callback(topic.encode('utf-8'))
+
+    def disconnect(self, force=False):
+        if self._client:
+            self._client.disconnect()
+        self._close()
+        return True
+
+    def _recv_message(self, topic, payload):
+        msg = MQTTMessage()
+        msg.topic = topic
+        msg.payload = payload
+        self._notify_message(msg)
+
+    def _lost(self, client):
+        print_debug(2, "MQTT connection lost")
+        self._close()
+        if self._reconnectMethod is not None:
+            # the callbacks must not block, reconnecting can take long
+            _thread.start_new_thread(self._reconnectMethod, ())
+
+
+MQTTCore = MQTTNativeCore if NativeMQTT is not None else MQTTPythonCore
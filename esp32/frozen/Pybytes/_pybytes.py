@@ -112,6 +112,7 @@ class Pybytes:
 
     def disconnect(self, force=True):
         self.__check_init()
+        self.flush_signals()
         self.__pybytes_connection.disconnect(force=force)
 
     def send_custom_message(self, persistent, message_type, message):
@@ -146,6 +147,10 @@ class Pybytes:
         self.__check_init()
         self.__pybytes_connection.__pybytes_protocol.send_pybytes_custom_method_values(signal_number, [value])
 
+    def flush_signals(self):
+        self.__check_init()
+        self.__pybytes_connection.__pybytes_protocol.flush_signals()
+
     def send_virtual_pin_value(self, persistent, pin, value):
         self.__check_init()
         print("This function is deprecated and will be removed in the future. Use send_signal(signalNumber, value)")
@@ -71,10 +71,18 @@ class constants:
     __TYPE_RELEASE_INFO = 0x0B
     __TYPE_RELEASE_DEPLOY = 0x0A
     __TYPE_DEVICE_NETWORK_DEPLOY = 0x0C
+    __TYPE_PYBYTES_BATCH = 0x0D
     __PYBYTES_PROTOCOL = ">B%ds"
     __PYBYTES_PROTOCOL_PING = ">B"
     __PYBYTES_INTERNAL_PROTOCOL = ">BBH"
     __PYBYTES_INTERNAL_PROTOCOL_VARIABLE = ">BB%ds"
+    # batch of signals: time of the first one, then signal, type, seconds since the first one and value # noqa
+    __PYBYTES_BATCH_PROTOCOL = ">I"
+    __PYBYTES_BATCH_ENTRY = ">BBH"
+    __PYBYTES_BATCH_STRING = ">B%ds"
+    __BATCH_WINDOW_DEFAULT = 10  # in seconds
+    __BATCH_MAX_BYTES_MQTT = 1024
+    __BATCH_MAX_BYTES_LORA = 48
 
     __TERMINAL_PIN = 255
 
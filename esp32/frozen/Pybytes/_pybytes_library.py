@@ -55,6 +55,24 @@ class PybytesLibrary:
                            command, pin, parameters)
         return self.__pack_message(constants.__TYPE_PYBYTES, body)
 
+    def pack_batch_entry(self, signal_number, value, elapsed):
+        elapsed = min(elapsed, 0xFFFF)
+        if isinstance(value, int):
+            return struct.pack(constants.__PYBYTES_BATCH_ENTRY + "i", signal_number, constants.__INTEGER, elapsed, value) # noqa
+        elif isinstance(value, float):
+            return struct.pack(constants.__PYBYTES_BATCH_ENTRY + "f", signal_number, constants.__FLOAT, elapsed, value) # noqa
+        elif isinstance(value, tuple) or isinstance(value, list):
+            value = '[' + ', '.join(map(str, value)) + ']'
+            value_type = constants.__TUPLE
+        else:
+            value_type = constants.__STRING
+        value = str(value).encode()[:255]
+        return struct.pack(constants.__PYBYTES_BATCH_ENTRY, signal_number, value_type, elapsed) + struct.pack(constants.__PYBYTES_BATCH_STRING % len(value), len(value), value) # noqa
+
+    def pack_batch_message(self, first_time, entries):
+        body = struct.pack(constants.__PYBYTES_BATCH_PROTOCOL, first_time) + entries # noqa
+        return self.__pack_message(constants.__TYPE_PYBYTES_BATCH, body)
+
     def pack_ping_message(self):
         return self.__pack_message(constants.__TYPE_PING, None)
 
@@ -73,6 +73,14 @@ class PybytesProtocol:
         self.__connectionAlarm = None
         self.__terminal = Terminal(self)
         self.__FCOTA = FCOTA()
+        # signals sent within the window of the first one go out as one message # noqa
+        batch = config.get('signal_batch')
+        self.__batch_window = batch.get('window', constants.__BATCH_WINDOW_DEFAULT) if batch else 0 # noqa
+        self.__batch_max_bytes = batch.get('max_bytes', 0) if batch else 0
+        self.__batch = bytearray()
+        self.__batch_time = 0
+        self.__batch_alarm = None
+        self.__batch_lock = _thread.allocate_lock()
 
     def start_Lora(self, pybytes_connection):
         print_debug(5, "This is PybytesProtocol.start_Lora()")
@@ -467,7 +475,64 @@ class PybytesProtocol:
         pin = self.__pins[pin_number]
         self.send_pybytes_custom_method_values(signal_number, [pin()])
 
+    def __take_batch(self):
+        if self.__batch_alarm is not None:
+            self.__batch_alarm.cancel()
+            self.__batch_alarm = None
+        message = self.__pybytes_library.pack_batch_message(
+            self.__batch_time, bytes(self.__batch)
+        )
+        self.__batch = bytearray()
+        return message
+
+    def __batch_expired(self, alarm):
+        self.flush_signals()
+
+    def __batch_signal(self, method_id, value):
+        if self.__pybytes_connection.__connection_status == constants.__CONNECTION_STATUS_CONNECTED_LORA: # noqa
+            max_bytes = constants.__BATCH_MAX_BYTES_LORA
+        elif self.__wifi_or_lte_connection():
+            max_bytes = constants.__BATCH_MAX_BYTES_MQTT
+        else:
+            # a Sigfox message has no room for more than one signal
+            return False
+        if self.__batch_max_bytes:
+            max_bytes = self.__batch_max_bytes
+
+        now = time.time()
+        full = None
+        with self.__batch_lock:
+            entry = self.__pybytes_library.pack_batch_entry(
+                method_id, value, now - self.__batch_time if self.__batch else 0 # noqa
+            )
+            # the header byte and the time of the first signal come on top
+            if self.__batch and (len(self.__batch) + len(entry) + 5) > max_bytes: # noqa
+                full = self.__take_batch()
+                entry = self.__pybytes_library.pack_batch_entry(
+                    method_id, value, 0
+                )
+            if not self.__batch:
+                self.__batch_time = now
+                self.__batch_alarm = Timer.Alarm(
+                    self.__batch_expired,
+                    self.__batch_window
+                )
+            self.__batch.extend(entry)
+        if full is not None:
+            self.__send_message(full)
+        return True
+
+    def flush_signals(self):
+        message = None
+        with self.__batch_lock:
+            if self.__batch:
+                message = self.__take_batch()
+        if message is not None:
+            self.__send_message(message)
+
     def send_pybytes_custom_method_values(self, method_id, parameters):
+        if self.__batch_window and method_id != constants.__TERMINAL_PIN and self.__batch_signal(method_id, parameters[0]): # noqa
+            return
         if(isinstance(parameters[0], int)):
             values = bytearray(struct.pack(">i", parameters[0]))
             values.append(constants.__INTEGER)
@@ -1,28 +1,145 @@
 # from https://github.com/micropython/micropython-lib/blob/master/urequests/urequests.py
 # author = Paul Sokolovsky
+#
+# HTTP/1.1 with one kept-alive connection per (protocol, host, port): a response
+# hands its socket back to the pool once the whole body is read, so the next
+# request to the same server skips the connect and the TLS handshake. Bodies
+# with a Content-Length, chunked ones and the ones ending with the connection
+# can be read in pieces with read(), iter_content() or save().
 
 import usocket
 
+READ_SIZE = 1024
+
+_pool = {}
+# the last TLS session of each server, a new connection offers it to resume
+_sessions = {}
+
+
+def _open(key):
+    proto, host, port = key
+    s = usocket.socket()
+    try:
+        s.connect(usocket.getaddrinfo(host, port)[0][-1])
+        if proto == "https:":
+            import ussl
+            s = ussl.wrap_socket(s, server_hostname=host, session=_sessions.get(key))
+            _sessions[key] = s.session
+    except:
+        s.close()
+        raise
+    return s
+
+
+def _release(key, s):
+    old = _pool.pop(key, None)
+    if old is not None:
+        old.close()
+    _pool[key] = s
+
+
+def close_all():
+    """Close the connections kept open for the next requests"""
+    for key in list(_pool):
+        _pool.pop(key).close()
+
+
+def _str(v):
+    return v.decode() if isinstance(v, (bytes, bytearray)) else str(v)
+
 
 class Response:
 
-    def __init__(self, f):
-        self.raw = f
+    def __init__(self, s, key, length, chunked, keep):
+        self.raw = s
         self.encoding = "utf-8"
         self._cached = None
+        self._key = key
+        # bytes left in the body or in the current chunk, None up to the end of the connection
+        self._left = length
+        self._chunked = chunked
+        self._keep = keep
+        if length == 0 and not chunked:
+            self._done()
+
+    def _done(self):
+        if self._keep:
+            _release(self._key, self.raw)
+        else:
+            self.raw.close()
+        self.raw = None
 
     def close(self):
         if self.raw:
+            # the rest of the body is still on the way, the connection can't be reused
             self.raw.close()
             self.raw = None
         self._cached = None
 
+    def read(self, size=READ_SIZE):
+        """Up to size bytes of the body, b'' at its end"""
+        s = self.raw
+        if s is None:
+            return b""
+        if self._chunked and self._left == 0:
+            line = s.readline()
+            try:
+                self._left = int(line.split(b";", 1)[0], 16)
+            except ValueError:
+                self.close()
+                raise OSError("Bad chunk " + str(line))
+            if self._left == 0:
+                # skip the trailers up to the empty line closing the message
+                while True:
+                    line = s.readline()
+                    if not line or line == b"\r\n":
+                        break
+                self._done()
+                return b""
+        if self._left is None:
+            data = s.read(size)
+            if not data:
+                self._done()
+            return data
+        data = s.read(min(size, self._left))
+        if not data:
+            self.close()
+            raise OSError("Connection closed before the end of the body")
+        self._left -= len(data)
+        if self._left == 0:
+            if self._chunked:
+                s.readline()
+            else:
+                self._done()
+        return data
+
+    def iter_content(self, chunk_size=READ_SIZE):
+        while True:
+            data = self.read(chunk_size)
+            if not data:
+                break
+            yield data
+
+    def save(self, dest, chunk_size=READ_SIZE):
+        """Stream the body into a file path, a writable object or a callback, returns its length"""
+        fp = None
+        if isinstance(dest, str):
+            fp = dest = open(dest, "wb")
+        write = dest if callable(dest) else dest.write
+        total = 0
+        try:
+            for data in self.iter_content(chunk_size):
+                write(data)
+                total += len(data)
+        finally:
+            if fp is not None:
+                fp.close()
+        return total
+
     @property
     def content(self):
         if self._cached is None:
-            self._cached = self.raw.read()
-            self.raw.close()
-            self.raw = None
+            self._cached = b"".join(list(self.iter_content()))
         return self._cached
 
     @property
@@ -34,6 +151,13 @@ class Response:
         return ujson.loads(self.content)
 
 
+def _send(s, head, data):
+    s.write(head + data if data and len(data) <= READ_SIZE else head)
+    if data and len(data) > READ_SIZE:
+        s.write(data)
+    return s.readline()
+
+
 def request(method, url, data=None, json=None, headers={}, stream=None):
     try:
         proto, dummy, host, path = url.split("/", 3)
@@ -43,57 +167,90 @@ def request(method, url, data=None, json=None, headers={}, stream=None):
     if proto == "http:":
         port = 80
     elif proto == "https:":
-        import ussl
         port = 443
     else:
         raise ValueError("Unsupported protocol: " + proto)
 
+    hosthdr = host
     if ":" in host:
         host, port = host.split(":", 1)
         port = int(port)
 
-    ai = usocket.getaddrinfo(host, port)
-    addr = ai[0][-1]
-    s = usocket.socket()
-    s.connect(addr)
-    if proto == "https:":
-        s = ussl.wrap_socket(s)
-    s.write(b"%s /%s HTTP/1.0\r\n" % (method, path))
-    if "Host" not in headers:
-        s.write(b"Host: %s\r\n" % host)
-    # Iterate over keys to avoid tuple alloc
-    for k in headers:
-        s.write(k)
-        s.write(b": ")
-        s.write(headers[k])
-        s.write(b"\r\n")
     if json is not None:
         assert data is None
         import ujson
         data = ujson.dumps(json)
+    if isinstance(data, str):
+        data = data.encode()
+
+    # the whole head goes out in one write, a single TLS record
+    head = ["%s /%s HTTP/1.1\r\n" % (method, path)]
+    if "Host" not in headers:
+        head.append("Host: %s\r\n" % hosthdr)
+    # Iterate over keys to avoid tuple alloc
+    for k in headers:
+        head.append("%s: %s\r\n" % (_str(k), _str(headers[k])))
     if data:
-        s.write(b"Content-Length: %d\r\n" % len(data))
-    s.write(b"\r\n")
-    if data:
-        s.write(data)
+        head.append("Content-Length: %d\r\n" % len(data))
+    head.append("\r\n")
+    head = "".join(head).encode()
 
-    lineRead = s.readline()
+    key = (proto, host, port)
+    s = _pool.pop(key, None)
+    lineRead = b""
+    if s is not None:
+        # the server may have dropped the idle connection, retry once on a new one
+        try:
+            lineRead = _send(s, head, data)
+        except OSError:
+            pass
+        if not lineRead:
+            s.close()
+    if not lineRead:
+        s = _open(key)
+        lineRead = _send(s, head, data)
+
+    try:
+        protover, status, msg = lineRead.split(None, 2)
+        status = int(status)
 
-    protover, status, msg = lineRead.split(None, 2)
-    status = int(status)
+        length = None
+        chunked = False
+        # HTTP/1.1 connections stay open unless told otherwise, HTTP/1.0 ones the other way round
+        keep = protover == b"HTTP/1.1"
+        while True:
+            lineRead = s.readline()
 
-    while True:
-        lineRead = s.readline()
+            if not lineRead or lineRead == b"\r\n":
+                break
+            name, value = (lineRead.split(b":", 1) + [b""])[:2]
+            name = name.lower()
+            value = value.strip()
+            if name == b"content-length":
+                length = int(value)
+            elif name == b"transfer-encoding":
+                chunked = b"chunked" in value.lower()
+            elif name == b"connection":
+                value = value.lower()
+                if value == b"close":
+                    keep = False
+                elif value == b"keep-alive":
+                    keep = True
+            elif name == b"location" and not 200 <= status <= 299:
+                raise NotImplementedError("Redirects not yet supported")
+    except:
+        s.close()
+        raise
 
-        if not lineRead or lineRead == b"\r\n":
-            break
-        if lineRead.startswith(b"Transfer-Encoding:"):
-            if b"chunked" in lineRead:
-                raise ValueError("Unsupported " + lineRead)
-        elif lineRead.startswith(b"Location:") and not 200 <= status <= 299:
-            raise NotImplementedError("Redirects not yet supported")
+    if method == "HEAD" or status in (204, 304) or 100 <= status < 200:
+        length = 0
+        chunked = False
+    elif chunked:
+        length = 0
+    elif length is None:
+        keep = False
 
-    resp = Response(s)
+    resp = Response(s, key, length, chunked, keep)
     resp.status_code = status
     resp.reason = msg.rstrip()
     return resp
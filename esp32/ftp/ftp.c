@@ -14,6 +14,7 @@
 
 #include "py/mpstate.h"
 #include "py/obj.h"
+#include "py/mphal.h"
 
 //#include "pybrtc.h"
 #include "ftp.h"
@@ -28,10 +29,10 @@
 #include "extmod/vfs_fat.h"
 #include "vfs_littlefs.h"
 #include "lfs.h"
-#include "fifo.h"
 #include "socketfifo.h"
 #include "timeutils.h"
 #include "moduos.h"
+#include "mpmetrics.h"
 
 #include "esp_heap_caps.h"
 #include "sdkconfig.h"
@@ -58,18 +59,20 @@
 #define FTP_CMD_PORT                        21
 #define FTP_ACTIVE_DATA_PORT                20
 #define FTP_PASIVE_DATA_PORT                2024
-#define FTP_BUFFER_SIZE                     512
+#define FTP_BUFFER_SIZE_DEFAULT             512
+#define FTP_BUFFER_SIZE_PSRAM               (16 * 1024)     // must fit in SocketFifoElement_t.datasize
 #define FTP_TX_RETRIES_MAX                  50
 #define FTP_CMD_SIZE_MAX                    6
-#define FTP_CMD_CLIENTS_MAX                 1
+#define FTP_CMD_CLIENTS_MAX                 3               // concurrent sessions
 #define FTP_DATA_CLIENTS_MAX                1
 #define FTP_MAX_PARAM_SIZE                  (MICROPY_ALLOC_PATH_MAX + 1)
 #define FTP_UNIX_TIME_20000101              946684800ll
 #define FTP_UNIX_TIME_20150101              1420070400ll
 #define FTP_UNIX_SECONDS_180_DAYS           15552000ll
 #define FTP_DATA_TIMEOUT_MS                 10000            // 10 seconds
-#define FTP_SOCKETFIFO_ELEMENTS_MAX         5
+#define FTP_SOCKETFIFO_ELEMENTS_MAX         8   // power of 2
 #define FTP_CYCLE_TIME_MS                   (SERVERS_CYCLE_TIME_MS * 2)
+#define FTP_TRANSFER_BURST_MS               (SERVERS_CYCLE_TIME_MS * 10)
 
 /******************************************************************************
  DEFINE PRIVATE TYPES
@@ -136,18 +139,25 @@ typedef struct {
 
 typedef struct {
     uint8_t             *dBuffer;
-    uint32_t            ctimeout;
+    uint32_t            dbuffer_size;
+    char                *path;
+    char                *scratch_buffer;
+    char                *cmd_buffer;
+    spsc_ring_t         socketfifo;
+    SocketFifoElement_t fifoelements[FTP_SOCKETFIFO_ELEMENTS_MAX];
+    ftp_fileinfo_t      list_fno;   // entry that didn't fit in the previous listing buffer
+    uint32_t            ctimeout;   // ms without commands from the client
     union {
         ftp_file_t fp;
         ftp_dir_t  dp;
     }u;
-    int32_t             lc_sd;
     int32_t             ld_sd;
     int32_t             c_sd;
     int32_t             d_sd;
-    int32_t             dtimeout;
+    int32_t             dtimeout;   // ms without activity on the data connection
     uint32_t            volcount;
     uint32_t            ip_addr;
+    uint16_t            data_port;
     uint8_t             state;
     uint8_t             substate;
     uint8_t             txRetries;
@@ -155,11 +165,20 @@ typedef struct {
     ftp_loggin_t        loggin;
     uint8_t             e_open;
     bool                closechild;
-    bool                enabled;
     bool                special_file;
     bool                listroot;
+    bool                list_pending;
+    bool                mlsd;
 } ftp_data_t;
 
+typedef struct {
+    int32_t             lc_sd;
+    uint32_t            last_run;
+    uint32_t            elapsed;    // ms since the previous run, the servers task sleeps until something happens
+    uint8_t             state;
+    bool                enabled;
+} ftp_server_t;
+
 typedef struct {
     char * cmd;
 } ftp_cmd_t;
@@ -192,32 +211,56 @@ typedef enum {
     E_FTP_CMD_RNTO,
     E_FTP_CMD_NOOP,
     E_FTP_CMD_QUIT,
+    E_FTP_CMD_MLSD,
     E_FTP_NUM_FTP_CMDS
 } ftp_cmd_index_t;
 
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
-static ftp_data_t ftp_data;
-static char *ftp_path;
-static char *ftp_scratch_buffer;
-static char *ftp_cmd_buffer;
+static ftp_server_t ftp_server;
+static ftp_data_t ftp_sessions[FTP_CMD_CLIENTS_MAX];
+// the session being serviced, all the sessions are run from the servers task
+static ftp_data_t *ftp_data = &ftp_sessions[0];
 static const ftp_cmd_t ftp_cmd_table[] = { { "FEAT" }, { "SYST" }, { "CDUP" }, { "CWD"  },
                                            { "PWD"  }, { "XPWD" }, { "SIZE" }, { "MDTM" },
                                            { "TYPE" }, { "USER" }, { "PASS" }, { "PASV" },
                                            { "LIST" }, { "RETR" }, { "STOR" }, { "DELE" },
                                            { "RMD"  }, { "MKD"  }, { "RNFR" }, { "RNTO" },
-                                           { "NOOP" }, { "QUIT" } };
+                                           { "NOOP" }, { "QUIT" }, { "MLSD" } };
 
 static const ftp_month_t ftp_month[] = { { "Jan" }, { "Feb" }, { "Mar" }, { "Apr" },
                                          { "May" }, { "Jun" }, { "Jul" }, { "Ago" },
                                          { "Sep" }, { "Oct" }, { "Nov" }, { "Dec" } };
 
-static SocketFifoElement_t ftp_fifoelements[FTP_SOCKETFIFO_ELEMENTS_MAX];
-static FIFO_t ftp_socketfifo;
-static uint32_t ftp_last_dir_idx;
 static const TCHAR *path_relative;
 
+// only touched by the servers task, read by the snapshots of the metrics registry
+static struct {
+    uint32_t sessions;
+    uint32_t files_sent;
+    uint32_t files_received;
+    uint32_t bytes_sent;
+    uint32_t bytes_received;
+    uint32_t file_errors;
+} ftp_counters;
+
+static void ftp_metrics_collect (uint32_t *values);
+static const mpmetrics_desc_t ftp_metrics[] = {
+    { "sessions",           E_MPMETRICS_COUNTER },
+    { "files_sent",         E_MPMETRICS_COUNTER },
+    { "files_received",     E_MPMETRICS_COUNTER },
+    { "bytes_sent",         E_MPMETRICS_COUNTER },
+    { "bytes_received",     E_MPMETRICS_COUNTER },
+    { "file_errors",        E_MPMETRICS_COUNTER },
+};
+static mpmetrics_source_t ftp_metrics_source = {
+    .name = "ftp",
+    .metrics = ftp_metrics,
+    .n_metrics = MP_ARRAY_SIZE(ftp_metrics),
+    .collect = ftp_metrics_collect,
+};
+
 /******************************************************************************
  DEFINE VFS WRAPPER FUNCTIONS
  ******************************************************************************/
@@ -256,9 +299,9 @@ STATIC FRESULT f_open_helper(ftp_file_t *fp, const TCHAR *path, BYTE mode) {
 
 STATIC FRESULT f_read_helper(ftp_file_t *fp, void* buff, uint32_t desiredsize, uint32_t *actualsize ) {
 
-    if(isLittleFs(ftp_path))
+    if(isLittleFs(ftp_data->path))
     {
-        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_path, &path_relative);
+        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_data->path, &path_relative);
         if (littlefs == NULL) {
             return FR_NO_PATH;
         }
@@ -271,7 +314,7 @@ STATIC FRESULT f_read_helper(ftp_file_t *fp, void* buff, uint32_t desiredsize, u
     }
     else
     {
-        FATFS *fs = lookup_path_fatfs(ftp_path, &path_relative);
+        FATFS *fs = lookup_path_fatfs(ftp_data->path, &path_relative);
         if (fs == NULL) {
             return FR_NO_PATH;
         }
@@ -281,9 +324,9 @@ STATIC FRESULT f_read_helper(ftp_file_t *fp, void* buff, uint32_t desiredsize, u
 
 STATIC FRESULT f_write_helper(ftp_file_t *fp, void* buff, uint32_t desiredsize, uint32_t *actualsize) {
 
-    if(isLittleFs(ftp_path))
+    if(isLittleFs(ftp_data->path))
     {
-        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_path, &path_relative);
+        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_data->path, &path_relative);
         if (littlefs == NULL) {
             return FR_NO_PATH;
         }
@@ -300,7 +343,7 @@ STATIC FRESULT f_write_helper(ftp_file_t *fp, void* buff, uint32_t desiredsize,
     }
     else
     {
-        FATFS *fs = lookup_path_fatfs(ftp_path, &path_relative);
+        FATFS *fs = lookup_path_fatfs(ftp_data->path, &path_relative);
         if (fs == NULL) {
             return FR_NO_PATH;
         }
@@ -310,10 +353,10 @@ STATIC FRESULT f_write_helper(ftp_file_t *fp, void* buff, uint32_t desiredsize,
 
 STATIC FRESULT f_readdir_helper(ftp_dir_t *dp, ftp_fileinfo_t *fno ) {
 
-    if(isLittleFs(ftp_path))
+    if(isLittleFs(ftp_data->path))
     {
 
-        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_path, &path_relative);
+        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_data->path, &path_relative);
         if (littlefs == NULL) {
             return FR_NO_PATH;
         }
@@ -338,28 +381,31 @@ STATIC FRESULT f_readdir_helper(ftp_dir_t *dp, ftp_fileinfo_t *fno ) {
                 if(length_of_relative_path > 1) {
                     path_length++;
                 }
-                char* file_relative_path = m_malloc(path_length);
 
-                // Copy the current working directory (relative path)
-                memcpy(file_relative_path, path_relative, length_of_relative_path);
+                int lfs_getattr_ret = LFS_ERR_NAMETOOLONG;
+                // The scratch buffer is free while listing, no need to allocate a buffer for every entry
+                if (path_length <= FTP_MAX_PARAM_SIZE) {
+                    char* file_relative_path = ftp_data->scratch_buffer;
 
-                // Append the "/" at the end of current working directory path if needed
-                if(length_of_relative_path > 1) {
-                    memcpy(&file_relative_path[length_of_relative_path], "/", 1);
-                    // Modify the length of relative path to include the closing "/"
-                    length_of_relative_path++;
-                }
-                // Copy the name of the file after the current working directory, this will copy the closing /0
-                strcpy(&file_relative_path[length_of_relative_path], fno->u.fpinfo_lfs.info.name);
+                    // Copy the current working directory (relative path)
+                    memcpy(file_relative_path, path_relative, length_of_relative_path);
 
-                int lfs_getattr_ret = lfs_getattr(&littlefs->lfs, file_relative_path, LFS_ATTRIBUTE_TIMESTAMP, &fno->u.fpinfo_lfs.timestamp, sizeof(lfs_timestamp_attribute_t));
+                    // Append the "/" at the end of current working directory path if needed
+                    if(length_of_relative_path > 1) {
+                        memcpy(&file_relative_path[length_of_relative_path], "/", 1);
+                        // Modify the length of relative path to include the closing "/"
+                        length_of_relative_path++;
+                    }
+                    // Copy the name of the file after the current working directory, this will copy the closing /0
+                    strcpy(&file_relative_path[length_of_relative_path], fno->u.fpinfo_lfs.info.name);
+
+                    lfs_getattr_ret = lfs_getattr(&littlefs->lfs, file_relative_path, LFS_ATTRIBUTE_TIMESTAMP, &fno->u.fpinfo_lfs.timestamp, sizeof(lfs_timestamp_attribute_t));
+                }
                 // If no timestamp is saved for this entry, fill it with 0
                 if(lfs_getattr_ret < LFS_ERR_OK) {
                     fno->u.fpinfo_lfs.timestamp.fdate = 0;
                     fno->u.fpinfo_lfs.timestamp.ftime = 0;
                 }
-
-                m_free(file_relative_path);
             }
 
         xSemaphoreGive(littlefs->mutex);
@@ -368,7 +414,7 @@ STATIC FRESULT f_readdir_helper(ftp_dir_t *dp, ftp_fileinfo_t *fno ) {
     }
     else
     {
-        FATFS *fs = lookup_path_fatfs(ftp_path, &path_relative);
+        FATFS *fs = lookup_path_fatfs(ftp_data->path, &path_relative);
         if (fs == NULL) {
             return FR_NO_PATH;
         }
@@ -405,9 +451,9 @@ STATIC FRESULT f_opendir_helper(ftp_dir_t *dp, const TCHAR *path) {
 
 STATIC FRESULT f_closefile_helper(ftp_file_t *fp) {
 
-    if(isLittleFs(ftp_path))
+    if(isLittleFs(ftp_data->path))
     {
-        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_path, &path_relative);
+        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_data->path, &path_relative);
         if (littlefs == NULL) {
             return FR_NO_PATH;
         }
@@ -420,7 +466,7 @@ STATIC FRESULT f_closefile_helper(ftp_file_t *fp) {
     }
     else
     {
-        FATFS *fs = lookup_path_fatfs(ftp_path, &path_relative);
+        FATFS *fs = lookup_path_fatfs(ftp_data->path, &path_relative);
         if (fs == NULL) {
             return FR_NO_PATH;
         }
@@ -430,9 +476,9 @@ STATIC FRESULT f_closefile_helper(ftp_file_t *fp) {
 
 STATIC FRESULT f_closedir_helper(ftp_dir_t *dp) {
 
-    if(isLittleFs(ftp_path))
+    if(isLittleFs(ftp_data->path))
     {
-        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_path, &path_relative);
+        vfs_lfs_struct_t* littlefs = lookup_path_littlefs(ftp_data->path, &path_relative);
         if (littlefs == NULL) {
             return FR_NO_PATH;
         }
@@ -445,7 +491,7 @@ STATIC FRESULT f_closedir_helper(ftp_dir_t *dp) {
     }
     else
     {
-        FATFS *fs = lookup_path_fatfs(ftp_path, &path_relative);
+        FATFS *fs = lookup_path_fatfs(ftp_data->path, &path_relative);
         if (fs == NULL) {
             return FR_NO_PATH;
         }
@@ -584,6 +630,9 @@ STATIC FRESULT f_rename_helper(const TCHAR *path_old, const TCHAR *path_new) {
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
 static void ftp_wait_for_enabled (void);
+static void ftp_run_session (void);
+static void ftp_run_transfers (void);
+static void ftp_close_session (void);
 static bool ftp_create_listening_socket (int32_t *sd, uint32_t port, uint8_t backlog);
 static ftp_result_t ftp_wait_for_connection (int32_t l_sd, int32_t *n_sd, uint32_t *ip_addr);
 static ftp_result_t ftp_send_non_blocking (int32_t sd, void *data, int32_t Len);
@@ -599,6 +648,8 @@ static ftp_cmd_index_t ftp_pop_command (char **str);
 static void ftp_pop_param (char **str, char *param, bool stop_on_space);
 static int ftp_print_eplf_item (char *dest, uint32_t destsize, ftp_fileinfo_t *fno);
 static int ftp_print_eplf_drive (char *dest, uint32_t destsize, const char *name);
+static int ftp_print_mlsd_item (char *dest, uint32_t destsize, ftp_fileinfo_t *fno);
+static int ftp_print_mlsd_drive (char *dest, uint32_t destsize, const char *name);
 static bool ftp_open_file (const char *path, int mode);
 static ftp_result_t ftp_read_file (char *filebuf, uint32_t desiredsize, uint32_t *actualsize);
 static ftp_result_t ftp_write_file (char *filebuf, uint32_t size);
@@ -613,51 +664,193 @@ static void ftp_return_to_previous_path (char *pwd, char *dir);
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
 void ftp_init (void) {
-    // allocate memory for the data buffer, and the file system structs (from the RTOS heap)
-    ftp_data.dBuffer = heap_caps_malloc(FTP_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    ftp_path = heap_caps_malloc(FTP_MAX_PARAM_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    ftp_scratch_buffer = heap_caps_malloc(FTP_MAX_PARAM_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    ftp_cmd_buffer = heap_caps_malloc(FTP_MAX_PARAM_SIZE + FTP_CMD_SIZE_MAX, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    SOCKETFIFO_Init (&ftp_socketfifo, (void *)ftp_fifoelements, FTP_SOCKETFIFO_ELEMENTS_MAX);
-    ftp_data.c_sd  = -1;
-    ftp_data.d_sd  = -1;
-    ftp_data.lc_sd = -1;
-    ftp_data.ld_sd = -1;
-    ftp_data.e_open = E_FTP_NOTHING_OPEN;
-    ftp_data.state = E_FTP_STE_DISABLED;
-    ftp_data.substate = E_FTP_STE_SUB_DISCONNECTED;
-    ftp_data.special_file = false;
-    ftp_data.volcount = 0;
-    ftp_last_dir_idx = 0;
+    // use large transfer buffers when the board has PSRAM, they are only touched by the
+    // servers task so the slower memory doesn't matter compared to the fewer socket calls
+    bool psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
+    for (int i = 0; i < FTP_CMD_CLIENTS_MAX; i++) {
+        ftp_data = &ftp_sessions[i];
+        // allocate memory for the data buffer, and the file system structs (from the RTOS heap)
+        ftp_data->dBuffer = NULL;
+        if (psram) {
+            ftp_data->dbuffer_size = FTP_BUFFER_SIZE_PSRAM;
+            ftp_data->dBuffer = heap_caps_malloc(FTP_BUFFER_SIZE_PSRAM, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        }
+        if (ftp_data->dBuffer == NULL) {
+            ftp_data->dbuffer_size = FTP_BUFFER_SIZE_DEFAULT;
+            ftp_data->dBuffer = heap_caps_malloc(FTP_BUFFER_SIZE_DEFAULT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        ftp_data->path = heap_caps_malloc(FTP_MAX_PARAM_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ftp_data->scratch_buffer = heap_caps_malloc(FTP_MAX_PARAM_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ftp_data->cmd_buffer = heap_caps_malloc(FTP_MAX_PARAM_SIZE + FTP_CMD_SIZE_MAX, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        SOCKETFIFO_Init (&ftp_data->socketfifo, (void *)ftp_data->fifoelements, FTP_SOCKETFIFO_ELEMENTS_MAX);
+        ftp_data->c_sd  = -1;
+        ftp_data->d_sd  = -1;
+        ftp_data->ld_sd = -1;
+        // every session has its own passive data port
+        ftp_data->data_port = FTP_PASIVE_DATA_PORT + i;
+        ftp_data->e_open = E_FTP_NOTHING_OPEN;
+        ftp_data->state = E_FTP_STE_READY;
+        ftp_data->substate = E_FTP_STE_SUB_DISCONNECTED;
+        ftp_data->special_file = false;
+        ftp_data->volcount = 0;
+    }
+    ftp_data = &ftp_sessions[0];
+    ftp_server.lc_sd = -1;
+    ftp_server.state = E_FTP_STE_DISABLED;
+    mpmetrics_register(&ftp_metrics_source);
 }
 
 void ftp_run (void) {
-    switch (ftp_data.state) {
+    uint32_t now = mp_hal_ticks_ms();
+    ftp_server.elapsed = now - ftp_server.last_run;
+    ftp_server.last_run = now;
+
+    switch (ftp_server.state) {
         case E_FTP_STE_DISABLED:
             ftp_wait_for_enabled();
-            break;
+            return;
         case E_FTP_STE_START:
-            if (/*wlan_is_connected() && */ ftp_create_listening_socket(&ftp_data.lc_sd, FTP_CMD_PORT, FTP_CMD_CLIENTS_MAX - 1)) {
-                ftp_data.state = E_FTP_STE_READY;
+            if (/*wlan_is_connected() && */ ftp_create_listening_socket(&ftp_server.lc_sd, FTP_CMD_PORT, FTP_CMD_CLIENTS_MAX - 1)) {
+                ftp_server.state = E_FTP_STE_READY;
+            }
+            return;
+        default:
+            break;
+    }
+
+    for (int i = 0; i < FTP_CMD_CLIENTS_MAX; i++) {
+        ftp_data = &ftp_sessions[i];
+        ftp_run_session();
+        if (ftp_server.state != E_FTP_STE_READY) {
+            // the server has been reset
+            return;
+        }
+    }
+
+    ftp_run_transfers();
+}
+
+int32_t ftp_select_fds (fd_set *rfds, fd_set *wfds, uint32_t *timeout_ms) {
+    int32_t maxfd = -1;
+    bool accept = false;
+
+    switch (ftp_server.state) {
+        case E_FTP_STE_DISABLED:
+            if (ftp_server.enabled) {
+                *timeout_ms = MIN(*timeout_ms, SERVERS_CYCLE_TIME_MS);
             }
+            return -1;
+        case E_FTP_STE_START:
+            // retry creating the socket
+            *timeout_ms = MIN(*timeout_ms, SERVERS_CYCLE_TIME_MS);
+            return -1;
+        default:
             break;
+    }
+
+    for (int i = 0; i < FTP_CMD_CLIENTS_MAX; i++) {
+        ftp_data_t *session = &ftp_sessions[i];
+        SocketFifoElement_t fifoelement;
+        int32_t sd = -1;
+        fd_set *set = rfds;
+
+        if (session->c_sd < 0) {
+            if (session->state == E_FTP_STE_READY && session->substate == E_FTP_STE_SUB_DISCONNECTED) {
+                accept = true;
+            }
+            continue;
+        }
+
+        // the control and data timeouts must still be checked
+        *timeout_ms = MIN(*timeout_ms, SERVERS_IDLE_CHECK_MS);
+
+        if (SOCKETFIFO_Peek (&session->socketfifo, &fifoelement)) {
+            // something waiting to be sent
+            sd = *fifoelement.sd;
+            set = wfds;
+        } else if (session->substate == E_FTP_STE_SUB_LISTEN_FOR_DATA) {
+            sd = session->ld_sd;
+        } else if (session->state == E_FTP_STE_READY) {
+            sd = session->c_sd;
+        } else if (session->d_sd > 0 && session->state == E_FTP_STE_CONTINUE_FILE_RX) {
+            sd = session->d_sd;
+        } else if (session->d_sd > 0 && (session->state == E_FTP_STE_CONTINUE_FILE_TX || session->state == E_FTP_STE_CONTINUE_LISTING)) {
+            sd = session->d_sd;
+            set = wfds;
+        }
+
+        if (sd > 0) {
+            FD_SET(sd, set);
+            maxfd = MAX(maxfd, sd);
+        } else {
+            // the state machine has to move on by itself (closed sockets, end of a transfer)
+            *timeout_ms = MIN(*timeout_ms, SERVERS_CYCLE_TIME_MS);
+        }
+    }
+
+    if (accept && ftp_server.lc_sd > 0) {
+        FD_SET(ftp_server.lc_sd, rfds);
+        maxfd = MAX(maxfd, ftp_server.lc_sd);
+    }
+    return maxfd;
+}
+
+void ftp_enable (void) {
+    ftp_server.enabled = true;
+}
+
+void ftp_disable (void) {
+    ftp_reset();
+    ftp_server.enabled = false;
+    ftp_server.state = E_FTP_STE_DISABLED;
+}
+
+void ftp_reset (void) {
+    // close all connections and start all over again
+    ftp_data_t *current = ftp_data;
+    servers_close_socket(&ftp_server.lc_sd);
+    for (int i = 0; i < FTP_CMD_CLIENTS_MAX; i++) {
+        ftp_data = &ftp_sessions[i];
+        ftp_close_session();
+    }
+    ftp_data = current;
+    ftp_server.state = E_FTP_STE_START;
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static void ftp_wait_for_enabled (void) {
+    // Check if the telnet service has been enabled
+    if (ftp_server.enabled) {
+        ftp_server.state = E_FTP_STE_START;
+    }
+}
+
+static void ftp_run_session (void) {
+    switch (ftp_data->state) {
         case E_FTP_STE_READY:
-            if (ftp_data.c_sd < 0 && ftp_data.substate == E_FTP_STE_SUB_DISCONNECTED) {
-                if (E_FTP_RESULT_OK == ftp_wait_for_connection(ftp_data.lc_sd, &ftp_data.c_sd, &ftp_data.ip_addr)) {
-                    ftp_data.txRetries = 0;
-                    ftp_data.logginRetries = 0;
-                    ftp_data.ctimeout = 0;
-                    ftp_data.loggin.uservalid = false;
-                    ftp_data.loggin.passvalid = false;
-                    strcpy (ftp_path, "/");
+            if (ftp_data->c_sd < 0 && ftp_data->substate == E_FTP_STE_SUB_DISCONNECTED) {
+                ftp_result_t result = ftp_wait_for_connection(ftp_server.lc_sd, &ftp_data->c_sd, &ftp_data->ip_addr);
+                if (result == E_FTP_RESULT_FAILED) {
+                    ftp_reset();
+                    return;
+                } else if (result == E_FTP_RESULT_OK) {
+                    ftp_counters.sessions++;
+                    ftp_data->txRetries = 0;
+                    ftp_data->logginRetries = 0;
+                    ftp_data->ctimeout = 0;
+                    ftp_data->loggin.uservalid = false;
+                    ftp_data->loggin.passvalid = false;
+                    strcpy (ftp_data->path, "/");
                     ftp_send_reply (220, "Micropython FTP Server");
                     break;
                 }
             }
-            if (SOCKETFIFO_IsEmpty()) {
-                if (ftp_data.c_sd > 0 && ftp_data.substate != E_FTP_STE_SUB_LISTEN_FOR_DATA) {
+            if (SOCKETFIFO_IsEmpty(&ftp_data->socketfifo)) {
+                if (ftp_data->c_sd > 0 && ftp_data->substate != E_FTP_STE_SUB_LISTEN_FOR_DATA) {
                     ftp_process_cmd();
-                    if (ftp_data.state != E_FTP_STE_READY) {
+                    if (ftp_data->state != E_FTP_STE_READY) {
                         break;
                     }
                 }
@@ -667,72 +860,74 @@ void ftp_run (void) {
             break;
         case E_FTP_STE_CONTINUE_LISTING:
             // go on with listing only if the transmit buffer is empty
-            if (SOCKETFIFO_IsEmpty()) {
+            if (SOCKETFIFO_IsEmpty(&ftp_data->socketfifo)) {
                 uint32_t listsize;
-                ftp_list_dir((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, &listsize);
+                ftp_list_dir((char *)ftp_data->dBuffer, ftp_data->dbuffer_size, &listsize);
                 if (listsize > 0) {
                     ftp_send_data(listsize);
                 } else {
                     ftp_send_reply(226, NULL);
-                    ftp_data.state = E_FTP_STE_END_TRANSFER;
+                    ftp_data->state = E_FTP_STE_END_TRANSFER;
                 }
-                ftp_data.ctimeout = 0;
+                ftp_data->ctimeout = 0;
             }
             break;
         case E_FTP_STE_CONTINUE_FILE_TX:
             // read the next block from the file only if the previous one has been sent
-            if (SOCKETFIFO_IsEmpty()) {
+            if (SOCKETFIFO_IsEmpty(&ftp_data->socketfifo)) {
                 uint32_t readsize;
                 ftp_result_t result;
-                ftp_data.ctimeout = 0;
-                result = ftp_read_file ((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, &readsize);
+                ftp_data->ctimeout = 0;
+                result = ftp_read_file ((char *)ftp_data->dBuffer, ftp_data->dbuffer_size, &readsize);
                 if (result == E_FTP_RESULT_FAILED) {
                     ftp_send_reply(451, NULL);
-                    ftp_data.state = E_FTP_STE_END_TRANSFER;
+                    ftp_data->state = E_FTP_STE_END_TRANSFER;
                 } else {
                     if (readsize > 0) {
                         ftp_send_data(readsize);
                     }
                     if (result == E_FTP_RESULT_OK) {
                         ftp_send_reply(226, NULL);
-                        ftp_data.state = E_FTP_STE_END_TRANSFER;
+                        ftp_data->state = E_FTP_STE_END_TRANSFER;
                     }
                 }
             }
             break;
         case E_FTP_STE_CONTINUE_FILE_RX:
-            if (SOCKETFIFO_IsEmpty()) {
+            if (SOCKETFIFO_IsEmpty(&ftp_data->socketfifo)) {
                 int32_t len;
                 ftp_result_t result;
-                if (E_FTP_RESULT_OK == (result = ftp_recv_non_blocking(ftp_data.d_sd, ftp_data.dBuffer, FTP_BUFFER_SIZE, &len))) {
-                    ftp_data.dtimeout = 0;
-                    ftp_data.ctimeout = 0;
+                if (E_FTP_RESULT_OK == (result = ftp_recv_non_blocking(ftp_data->d_sd, ftp_data->dBuffer, ftp_data->dbuffer_size, &len))) {
+                    ftp_data->dtimeout = 0;
+                    ftp_data->ctimeout = 0;
                     // its a software update
-                    if (ftp_data.special_file) {
-                        if (updater_write(ftp_data.dBuffer, len)) {
+                    if (ftp_data->special_file) {
+                        if (updater_write(ftp_data->dBuffer, len)) {
                             break;
                         }
                     }
                     // user file being received
-                    else if (E_FTP_RESULT_OK == ftp_write_file ((char *)ftp_data.dBuffer, len)) {
+                    else if (E_FTP_RESULT_OK == ftp_write_file ((char *)ftp_data->dBuffer, len)) {
                         break;
                     }
                     ftp_send_reply(451, NULL);
-                    ftp_data.state = E_FTP_STE_END_TRANSFER;
+                    ftp_data->state = E_FTP_STE_END_TRANSFER;
                 } else if (result == E_FTP_RESULT_CONTINUE) {
-                    if (ftp_data.dtimeout++ > FTP_DATA_TIMEOUT_MS / FTP_CYCLE_TIME_MS) {
+                    ftp_data->dtimeout += ftp_server.elapsed;
+                    if (ftp_data->dtimeout > FTP_DATA_TIMEOUT_MS) {
                         ftp_close_files();
                         ftp_send_reply(426, NULL);
-                        ftp_data.state = E_FTP_STE_END_TRANSFER;
+                        ftp_data->state = E_FTP_STE_END_TRANSFER;
                     }
                 } else {
-                    if (ftp_data.special_file) {
-                        ftp_data.special_file = false;
+                    if (ftp_data->special_file) {
+                        ftp_data->special_file = false;
                         updater_finish();
                     }
                     ftp_close_files();
+                    ftp_counters.files_received++;
                     ftp_send_reply(226, NULL);
-                    ftp_data.state = E_FTP_STE_END_TRANSFER;
+                    ftp_data->state = E_FTP_STE_END_TRANSFER;
                 }
             }
             break;
@@ -740,27 +935,30 @@ void ftp_run (void) {
             break;
     }
 
-    switch (ftp_data.substate) {
+    switch (ftp_data->substate) {
     case E_FTP_STE_SUB_DISCONNECTED:
         break;
     case E_FTP_STE_SUB_LISTEN_FOR_DATA:
-        if (E_FTP_RESULT_OK == ftp_wait_for_connection(ftp_data.ld_sd, &ftp_data.d_sd, NULL)) {
-            ftp_data.dtimeout = 0;
-            ftp_data.substate = E_FTP_STE_SUB_DATA_CONNECTED;
-        } else if (ftp_data.dtimeout++ > FTP_DATA_TIMEOUT_MS / FTP_CYCLE_TIME_MS) {
-            ftp_data.dtimeout = 0;
-            // close the listening socket
-            servers_close_socket(&ftp_data.ld_sd);
-            ftp_data.substate = E_FTP_STE_SUB_DISCONNECTED;
+        {
+            ftp_result_t result = ftp_wait_for_connection(ftp_data->ld_sd, &ftp_data->d_sd, NULL);
+            if (result == E_FTP_RESULT_OK) {
+                ftp_data->dtimeout = 0;
+                ftp_data->substate = E_FTP_STE_SUB_DATA_CONNECTED;
+            } else if (result == E_FTP_RESULT_FAILED || (ftp_data->dtimeout += ftp_server.elapsed) > FTP_DATA_TIMEOUT_MS) {
+                ftp_data->dtimeout = 0;
+                // close the listening socket
+                servers_close_socket(&ftp_data->ld_sd);
+                ftp_data->substate = E_FTP_STE_SUB_DISCONNECTED;
+            }
         }
         break;
     case E_FTP_STE_SUB_DATA_CONNECTED:
-        if (ftp_data.state == E_FTP_STE_READY && ftp_data.dtimeout++ > FTP_DATA_TIMEOUT_MS / FTP_CYCLE_TIME_MS) {
+        if (ftp_data->state == E_FTP_STE_READY && (ftp_data->dtimeout += ftp_server.elapsed) > FTP_DATA_TIMEOUT_MS) {
             // close the listening and the data socket
-            servers_close_socket(&ftp_data.ld_sd);
-            servers_close_socket(&ftp_data.d_sd);
+            servers_close_socket(&ftp_data->ld_sd);
+            servers_close_socket(&ftp_data->d_sd);
             ftp_close_filesystem_on_error ();
-            ftp_data.substate = E_FTP_STE_SUB_DISCONNECTED;
+            ftp_data->substate = E_FTP_STE_SUB_DISCONNECTED;
         }
         break;
     default:
@@ -771,41 +969,66 @@ void ftp_run (void) {
     ftp_send_from_fifo();
 
     // check the state of the data sockets
-    if (ftp_data.d_sd < 0 && (ftp_data.state > E_FTP_STE_READY)) {
-        ftp_data.substate = E_FTP_STE_SUB_DISCONNECTED;
-        ftp_data.state = E_FTP_STE_READY;
+    if (ftp_data->d_sd < 0 && (ftp_data->state > E_FTP_STE_READY)) {
+        ftp_data->substate = E_FTP_STE_SUB_DISCONNECTED;
+        ftp_data->state = E_FTP_STE_READY;
     }
 }
 
-void ftp_enable (void) {
-    ftp_data.enabled = true;
-}
-
-void ftp_disable (void) {
-    ftp_reset();
-    ftp_data.enabled = false;
-    ftp_data.state = E_FTP_STE_DISABLED;
+static void ftp_run_transfers (void) {
+    // instead of moving a single buffer per servers cycle, keep on serving the data
+    // connections for as long as their sockets are ready (within a time budget so
+    // that telnet is not starved)
+    uint32_t start = mp_hal_ticks_ms();
+    // these extra runs are on top of the regular one, the time has already been counted
+    ftp_server.elapsed = 0;
+    do {
+        fd_set rfds;
+        fd_set wfds;
+        int32_t maxfd = -1;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        for (int i = 0; i < FTP_CMD_CLIENTS_MAX; i++) {
+            ftp_data_t *session = &ftp_sessions[i];
+            if (session->d_sd <= 0 || session->substate != E_FTP_STE_SUB_DATA_CONNECTED) {
+                continue;
+            }
+            if (session->state == E_FTP_STE_CONTINUE_FILE_RX) {
+                FD_SET(session->d_sd, &rfds);
+            } else if (session->state == E_FTP_STE_CONTINUE_FILE_TX || session->state == E_FTP_STE_CONTINUE_LISTING) {
+                FD_SET(session->d_sd, &wfds);
+            } else {
+                continue;
+            }
+            maxfd = MAX(maxfd, session->d_sd);
+        }
+        if (maxfd < 0) {
+            break;
+        }
+        struct timeval tv = { .tv_sec = 0, .tv_usec = FTP_CYCLE_TIME_MS * 1000 };
+        if (select(maxfd + 1, &rfds, &wfds, NULL, &tv) <= 0) {
+            break;
+        }
+        for (int i = 0; i < FTP_CMD_CLIENTS_MAX; i++) {
+            ftp_data = &ftp_sessions[i];
+            int32_t sd = ftp_data->d_sd;
+            if (sd > 0 && sd <= maxfd && (FD_ISSET(sd, &rfds) || FD_ISSET(sd, &wfds))) {
+                ftp_run_session();
+                if (ftp_server.state != E_FTP_STE_READY) {
+                    return;
+                }
+            }
+        }
+    } while ((mp_hal_ticks_ms() - start) < FTP_TRANSFER_BURST_MS);
 }
 
-void ftp_reset (void) {
-    // close all connections and start all over again
-    servers_close_socket(&ftp_data.lc_sd);
-    servers_close_socket(&ftp_data.ld_sd);
+static void ftp_close_session (void) {
+    servers_close_socket(&ftp_data->ld_sd);
     ftp_close_cmd_data();
-    ftp_data.state = E_FTP_STE_START;
-    ftp_data.substate = E_FTP_STE_SUB_DISCONNECTED;
-    ftp_data.volcount = 0;
-    SOCKETFIFO_Flush();
-}
-
-/******************************************************************************
- DEFINE PRIVATE FUNCTIONS
- ******************************************************************************/
-static void ftp_wait_for_enabled (void) {
-    // Check if the telnet service has been enabled
-    if (ftp_data.enabled) {
-        ftp_data.state = E_FTP_STE_START;
-    }
+    SOCKETFIFO_Flush(&ftp_data->socketfifo);
+    ftp_data->state = E_FTP_STE_READY;
+    ftp_data->substate = E_FTP_STE_SUB_DISCONNECTED;
+    ftp_data->volcount = 0;
 }
 
 static bool ftp_create_listening_socket (int32_t *sd, uint32_t port, uint8_t backlog) {
@@ -860,8 +1083,7 @@ static ftp_result_t ftp_wait_for_connection (int32_t l_sd, int32_t *n_sd, uint32
         if (errno == EAGAIN) {
             return E_FTP_RESULT_CONTINUE;
         }
-        // error
-        ftp_reset();
+        // error, the caller decides what has to be closed
         return E_FTP_RESULT_FAILED;
     }
 
@@ -911,13 +1133,13 @@ static ftp_result_t ftp_send_non_blocking (int32_t sd, void *data, int32_t Len)
     fcntl(sd, F_SETFL, option);
 
     if (result > 0) {
-        ftp_data.txRetries = 0;
+        ftp_data->txRetries = 0;
         return E_FTP_RESULT_OK;
-    } else if ((FTP_TX_RETRIES_MAX >= ++ftp_data.txRetries) && (errno == EAGAIN)) {
+    } else if ((FTP_TX_RETRIES_MAX >= ++ftp_data->txRetries) && (errno == EAGAIN)) {
         return E_FTP_RESULT_CONTINUE;
     } else {
-        // error
-        ftp_reset();
+        // error, drop only this session
+        ftp_close_session();
         return E_FTP_RESULT_FAILED;
     }
 }
@@ -927,12 +1149,15 @@ static void ftp_send_reply (uint32_t status, char *message) {
     if (!message) {
         message = "";
     }
-    snprintf((char *)ftp_cmd_buffer, 4, "%u", status);
-    strcat ((char *)ftp_cmd_buffer, " ");
-    strcat ((char *)ftp_cmd_buffer, message);
-    strcat ((char *)ftp_cmd_buffer, "\r\n");
-    fifoelement.sd = &ftp_data.c_sd;
-    fifoelement.datasize = strlen((char *)ftp_cmd_buffer);
+    snprintf((char *)ftp_data->cmd_buffer, 4, "%u", status);
+    // a message starting with '-' is the first line of a multi-line reply
+    if (message[0] != '-') {
+        strcat ((char *)ftp_data->cmd_buffer, " ");
+    }
+    strcat ((char *)ftp_data->cmd_buffer, message);
+    strcat ((char *)ftp_data->cmd_buffer, "\r\n");
+    fifoelement.sd = &ftp_data->c_sd;
+    fifoelement.datasize = strlen((char *)ftp_data->cmd_buffer);
     fifoelement.data = pvPortMalloc(fifoelement.datasize);
     if (status == 221) {
         fifoelement.closesockets = E_FTP_CLOSE_CMD_AND_DATA;
@@ -943,8 +1168,8 @@ static void ftp_send_reply (uint32_t status, char *message) {
     }
     fifoelement.freedata = true;
     if (fifoelement.data) {
-        memcpy (fifoelement.data, ftp_cmd_buffer, fifoelement.datasize);
-        if (!SOCKETFIFO_Push (&fifoelement)) {
+        memcpy (fifoelement.data, ftp_data->cmd_buffer, fifoelement.datasize);
+        if (!SOCKETFIFO_Push (&ftp_data->socketfifo, &fifoelement)) {
             vPortFree(fifoelement.data);
         }
     }
@@ -953,28 +1178,28 @@ static void ftp_send_reply (uint32_t status, char *message) {
 static void ftp_send_data (uint32_t datasize) {
     SocketFifoElement_t fifoelement;
 
-    fifoelement.data = ftp_data.dBuffer;
+    fifoelement.data = ftp_data->dBuffer;
     fifoelement.datasize = datasize;
-    fifoelement.sd = &ftp_data.d_sd;
+    fifoelement.sd = &ftp_data->d_sd;
     fifoelement.closesockets = E_FTP_CLOSE_NONE;
     fifoelement.freedata = false;
-    SOCKETFIFO_Push (&fifoelement);
+    SOCKETFIFO_Push (&ftp_data->socketfifo, &fifoelement);
 }
 
 static void ftp_send_from_fifo (void) {
     SocketFifoElement_t fifoelement;
-    if (SOCKETFIFO_Peek (&fifoelement)) {
+    if (SOCKETFIFO_Peek (&ftp_data->socketfifo, &fifoelement)) {
         int32_t _sd = *fifoelement.sd;
         if (_sd > 0) {
             if (E_FTP_RESULT_OK == ftp_send_non_blocking (_sd, fifoelement.data, fifoelement.datasize)) {
-                SOCKETFIFO_Pop (&fifoelement);
+                SOCKETFIFO_Pop (&ftp_data->socketfifo, &fifoelement);
                 if (fifoelement.closesockets != E_FTP_CLOSE_NONE) {
-                    servers_close_socket(&ftp_data.d_sd);
+                    servers_close_socket(&ftp_data->d_sd);
                     if (fifoelement.closesockets == E_FTP_CLOSE_CMD_AND_DATA) {
-                        servers_close_socket(&ftp_data.ld_sd);
+                        servers_close_socket(&ftp_data->ld_sd);
                         // this one is the command socket
                         servers_close_socket(fifoelement.sd);
-                        ftp_data.substate = E_FTP_STE_SUB_DISCONNECTED;
+                        ftp_data->substate = E_FTP_STE_SUB_DISCONNECTED;
                     }
                     ftp_close_filesystem_on_error();
                 }
@@ -983,17 +1208,17 @@ static void ftp_send_from_fifo (void) {
                 }
             }
         } else { // socket closed, remove it from the queue
-            SOCKETFIFO_Pop (&fifoelement);
+            SOCKETFIFO_Pop (&ftp_data->socketfifo, &fifoelement);
             if (fifoelement.freedata) {
                 vPortFree(fifoelement.data);
             }
         }
-    } else if (ftp_data.state == E_FTP_STE_END_TRANSFER && (ftp_data.d_sd > 0)) {
+    } else if (ftp_data->state == E_FTP_STE_END_TRANSFER && (ftp_data->d_sd > 0)) {
         // close the listening and the data sockets
-        servers_close_socket(&ftp_data.ld_sd);
-        servers_close_socket(&ftp_data.d_sd);
-        if (ftp_data.special_file) {
-            ftp_data.special_file = false;
+        servers_close_socket(&ftp_data->ld_sd);
+        servers_close_socket(&ftp_data->d_sd);
+        if (ftp_data->special_file) {
+            ftp_data->special_file = false;
         }
     }
 }
@@ -1011,73 +1236,73 @@ static ftp_result_t ftp_recv_non_blocking (int32_t sd, void *buff, int32_t Maxle
 }
 
 static void ftp_get_param_and_open_child (char **bufptr) {
-    ftp_pop_param (bufptr, ftp_scratch_buffer, false);
-    ftp_open_child (ftp_path, ftp_scratch_buffer);
-    ftp_data.closechild = true;
+    ftp_pop_param (bufptr, ftp_data->scratch_buffer, false);
+    ftp_open_child (ftp_data->path, ftp_data->scratch_buffer);
+    ftp_data->closechild = true;
 }
 
 static void ftp_process_cmd (void) {
     int32_t len;
-    char *bufptr = (char *)ftp_cmd_buffer;
+    char *bufptr = (char *)ftp_data->cmd_buffer;
     ftp_result_t result;
     FRESULT fres;
     ftp_fileinfo_t fno;
 
-    ftp_data.closechild = false;
+    ftp_data->closechild = false;
     // also use the reply buffer to receive new commands
-    if (E_FTP_RESULT_OK == (result = ftp_recv_non_blocking(ftp_data.c_sd, ftp_cmd_buffer, FTP_MAX_PARAM_SIZE + FTP_CMD_SIZE_MAX, &len))) {
+    if (E_FTP_RESULT_OK == (result = ftp_recv_non_blocking(ftp_data->c_sd, ftp_data->cmd_buffer, FTP_MAX_PARAM_SIZE + FTP_CMD_SIZE_MAX, &len))) {
         // bufptr is moved as commands are being popped
         ftp_cmd_index_t cmd = ftp_pop_command(&bufptr);
-        if (!ftp_data.loggin.passvalid && (cmd != E_FTP_CMD_USER && cmd != E_FTP_CMD_PASS && cmd != E_FTP_CMD_QUIT)) {
+        if (!ftp_data->loggin.passvalid && (cmd != E_FTP_CMD_USER && cmd != E_FTP_CMD_PASS && cmd != E_FTP_CMD_QUIT)) {
             ftp_send_reply(332, NULL);
             return;
         }
         switch (cmd) {
         case E_FTP_CMD_FEAT:
-            ftp_send_reply(211, "no-features");
+            ftp_send_reply(211, "-Features:\r\n MDTM\r\n MLST type*;size*;modify*;\r\n SIZE\r\n211 End");
             break;
         case E_FTP_CMD_SYST:
             ftp_send_reply(215, "UNIX Type: L8");
             break;
         case E_FTP_CMD_CDUP:
-            ftp_close_child(ftp_path);
+            ftp_close_child(ftp_data->path);
             ftp_send_reply(250, NULL);
             break;
         case E_FTP_CMD_CWD:
             {
                 fres = FR_NO_PATH;
-                ftp_pop_param (&bufptr, ftp_scratch_buffer, false);
-                ftp_open_child (ftp_path, ftp_scratch_buffer);
-                if ((ftp_path[0] == '/' && ftp_path[1] == '\0') || ((fres = f_opendir_helper (&ftp_data.u.dp, ftp_path)) == FR_OK)) {
+                ftp_pop_param (&bufptr, ftp_data->scratch_buffer, false);
+                ftp_open_child (ftp_data->path, ftp_data->scratch_buffer);
+                if ((ftp_data->path[0] == '/' && ftp_data->path[1] == '\0') || ((fres = f_opendir_helper (&ftp_data->u.dp, ftp_data->path)) == FR_OK)) {
                     if (fres == FR_OK) {
-                        f_closedir_helper(&ftp_data.u.dp);
+                        f_closedir_helper(&ftp_data->u.dp);
                     }
                     ftp_send_reply(250, NULL);
                 } else {
-                    ftp_close_child (ftp_path);
+                    ftp_close_child (ftp_data->path);
                     ftp_send_reply(550, NULL);
                 }
             }
             break;
         case E_FTP_CMD_PWD:
         case E_FTP_CMD_XPWD:
-            ftp_send_reply(257, ftp_path);
+            ftp_send_reply(257, ftp_data->path);
             break;
         case E_FTP_CMD_SIZE:
             {
                 ftp_get_param_and_open_child (&bufptr);
-                if (FR_OK == f_stat_helper (ftp_path, &fno)) {
+                if (FR_OK == f_stat_helper (ftp_data->path, &fno)) {
                     // send the size
-                    if(isLittleFs(ftp_path))
+                    if(isLittleFs(ftp_data->path))
                     {
-                        snprintf((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, "%u", (uint32_t)fno.u.fpinfo_lfs.info.size);
+                        snprintf((char *)ftp_data->dBuffer, ftp_data->dbuffer_size, "%u", (uint32_t)fno.u.fpinfo_lfs.info.size);
                     }
                     else
                     {
-                        snprintf((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, "%u", (uint32_t)fno.u.fpinfo_fat.fsize);
+                        snprintf((char *)ftp_data->dBuffer, ftp_data->dbuffer_size, "%u", (uint32_t)fno.u.fpinfo_fat.fsize);
                     }
 
-                    ftp_send_reply(213, (char *)ftp_data.dBuffer);
+                    ftp_send_reply(213, (char *)ftp_data->dBuffer);
                 } else {
                     ftp_send_reply(550, NULL);
                 }
@@ -1085,24 +1310,24 @@ static void ftp_process_cmd (void) {
             break;
         case E_FTP_CMD_MDTM:
             ftp_get_param_and_open_child (&bufptr);
-            if (FR_OK == f_stat_helper (ftp_path, &fno)) {
+            if (FR_OK == f_stat_helper (ftp_data->path, &fno)) {
                 // send the last modified time
-                if(isLittleFs(ftp_path))
+                if(isLittleFs(ftp_data->path))
                 {
-                    snprintf((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, "%u%02u%02u%02u%02u%02u",
+                    snprintf((char *)ftp_data->dBuffer, ftp_data->dbuffer_size, "%u%02u%02u%02u%02u%02u",
                             1980 + ((fno.u.fpinfo_lfs.timestamp.fdate >> 9) & 0x7f), (fno.u.fpinfo_lfs.timestamp.fdate >> 5) & 0x0f,
                             fno.u.fpinfo_lfs.timestamp.fdate & 0x1f, (fno.u.fpinfo_lfs.timestamp.ftime >> 11) & 0x1f,
                             (fno.u.fpinfo_lfs.timestamp.ftime >> 5) & 0x3f, 2 * (fno.u.fpinfo_lfs.timestamp.ftime & 0x1f));
                 }
                 else
                 {
-                    snprintf((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, "%u%02u%02u%02u%02u%02u",
+                    snprintf((char *)ftp_data->dBuffer, ftp_data->dbuffer_size, "%u%02u%02u%02u%02u%02u",
                                              1980 + ((fno.u.fpinfo_fat.fdate >> 9) & 0x7f), (fno.u.fpinfo_fat.fdate >> 5) & 0x0f,
                                              fno.u.fpinfo_fat.fdate & 0x1f, (fno.u.fpinfo_fat.ftime >> 11) & 0x1f,
                                              (fno.u.fpinfo_fat.ftime >> 5) & 0x3f, 2 * (fno.u.fpinfo_fat.ftime & 0x1f));
                 }
 
-                ftp_send_reply(213, (char *)ftp_data.dBuffer);
+                ftp_send_reply(213, (char *)ftp_data->dBuffer);
             } else {
                 ftp_send_reply(550, NULL);
             }
@@ -1111,18 +1336,18 @@ static void ftp_process_cmd (void) {
             ftp_send_reply(200, NULL);
             break;
         case E_FTP_CMD_USER:
-            ftp_pop_param (&bufptr, ftp_scratch_buffer, true);
-            if (!memcmp(ftp_scratch_buffer, servers_user, MAX(strlen(ftp_scratch_buffer), strlen(servers_user)))) {
-                ftp_data.loggin.uservalid = true && (strlen(servers_user) == strlen(ftp_scratch_buffer));
+            ftp_pop_param (&bufptr, ftp_data->scratch_buffer, true);
+            if (!memcmp(ftp_data->scratch_buffer, servers_user, MAX(strlen(ftp_data->scratch_buffer), strlen(servers_user)))) {
+                ftp_data->loggin.uservalid = true && (strlen(servers_user) == strlen(ftp_data->scratch_buffer));
             }
             ftp_send_reply(331, NULL);
             break;
         case E_FTP_CMD_PASS:
-            ftp_pop_param (&bufptr, ftp_scratch_buffer, true);
-            if (!memcmp(ftp_scratch_buffer, servers_pass, MAX(strlen(ftp_scratch_buffer), strlen(servers_pass))) &&
-                    ftp_data.loggin.uservalid) {
-                ftp_data.loggin.passvalid = true && (strlen(servers_pass) == strlen(ftp_scratch_buffer));
-                if (ftp_data.loggin.passvalid) {
+            ftp_pop_param (&bufptr, ftp_data->scratch_buffer, true);
+            if (!memcmp(ftp_data->scratch_buffer, servers_pass, MAX(strlen(ftp_data->scratch_buffer), strlen(servers_pass))) &&
+                    ftp_data->loggin.uservalid) {
+                ftp_data->loggin.passvalid = true && (strlen(servers_pass) == strlen(ftp_data->scratch_buffer));
+                if (ftp_data->loggin.passvalid) {
                     ftp_send_reply(230, NULL);
                     break;
                 }
@@ -1132,27 +1357,29 @@ static void ftp_process_cmd (void) {
         case E_FTP_CMD_PASV:
             {
                 // some servers (e.g. google chrome) send PASV several times very quickly
-                servers_close_socket(&ftp_data.d_sd);
-                ftp_data.substate = E_FTP_STE_SUB_DISCONNECTED;
+                servers_close_socket(&ftp_data->d_sd);
+                ftp_data->substate = E_FTP_STE_SUB_DISCONNECTED;
                 bool socketcreated = true;
-                if (ftp_data.ld_sd < 0) {
-                    socketcreated = ftp_create_listening_socket(&ftp_data.ld_sd, FTP_PASIVE_DATA_PORT, FTP_DATA_CLIENTS_MAX - 1);
+                if (ftp_data->ld_sd < 0) {
+                    socketcreated = ftp_create_listening_socket(&ftp_data->ld_sd, ftp_data->data_port, FTP_DATA_CLIENTS_MAX - 1);
                 }
                 if (socketcreated) {
-                    uint8_t *pip = (uint8_t *)&ftp_data.ip_addr;
-                    ftp_data.dtimeout = 0;
-                    snprintf((char *)ftp_data.dBuffer, FTP_BUFFER_SIZE, "(%u,%u,%u,%u,%u,%u)",
-                             pip[0], pip[1], pip[2], pip[3], (FTP_PASIVE_DATA_PORT >> 8), (FTP_PASIVE_DATA_PORT & 0xFF));
-                    ftp_data.substate = E_FTP_STE_SUB_LISTEN_FOR_DATA;
-                    ftp_send_reply(227, (char *)ftp_data.dBuffer);
+                    uint8_t *pip = (uint8_t *)&ftp_data->ip_addr;
+                    ftp_data->dtimeout = 0;
+                    snprintf((char *)ftp_data->dBuffer, ftp_data->dbuffer_size, "(%u,%u,%u,%u,%u,%u)",
+                             pip[0], pip[1], pip[2], pip[3], (ftp_data->data_port >> 8), (ftp_data->data_port & 0xFF));
+                    ftp_data->substate = E_FTP_STE_SUB_LISTEN_FOR_DATA;
+                    ftp_send_reply(227, (char *)ftp_data->dBuffer);
                 } else {
                     ftp_send_reply(425, NULL);
                 }
             }
             break;
         case E_FTP_CMD_LIST:
-            if (ftp_open_dir_for_listing(ftp_path) == E_FTP_RESULT_CONTINUE) {
-                ftp_data.state = E_FTP_STE_CONTINUE_LISTING;
+        case E_FTP_CMD_MLSD:
+            ftp_data->mlsd = (cmd == E_FTP_CMD_MLSD);
+            if (ftp_open_dir_for_listing(ftp_data->path) == E_FTP_RESULT_CONTINUE) {
+                ftp_data->state = E_FTP_STE_CONTINUE_LISTING;
                 ftp_send_reply(150, NULL);
             } else {
                 ftp_send_reply(550, NULL);
@@ -1160,34 +1387,34 @@ static void ftp_process_cmd (void) {
             break;
         case E_FTP_CMD_RETR:
             ftp_get_param_and_open_child (&bufptr);
-            if (ftp_open_file (ftp_path, FA_READ)) {
-                ftp_data.state = E_FTP_STE_CONTINUE_FILE_TX;
+            if (ftp_open_file (ftp_data->path, FA_READ)) {
+                ftp_data->state = E_FTP_STE_CONTINUE_FILE_TX;
                 ftp_send_reply(150, NULL);
             } else {
-                ftp_data.state = E_FTP_STE_END_TRANSFER;
+                ftp_data->state = E_FTP_STE_END_TRANSFER;
                 ftp_send_reply(550, NULL);
             }
             break;
         case E_FTP_CMD_STOR:
             ftp_get_param_and_open_child (&bufptr);
             // first check if a software update is being requested
-            if (updater_check_path (ftp_path)) {
+            if (updater_check_path (ftp_data->path)) {
                 if (updater_start()) {
-                    ftp_data.special_file = true;
-                    ftp_data.state = E_FTP_STE_CONTINUE_FILE_RX;
+                    ftp_data->special_file = true;
+                    ftp_data->state = E_FTP_STE_CONTINUE_FILE_RX;
                     ftp_send_reply(150, NULL);
                 } else {
                     // to unlock the updater
                     updater_finish();
-                    ftp_data.state = E_FTP_STE_END_TRANSFER;
+                    ftp_data->state = E_FTP_STE_END_TRANSFER;
                     ftp_send_reply(550, NULL);
                 }
             } else {
-                if (ftp_open_file (ftp_path, FA_WRITE | FA_CREATE_ALWAYS)) {
-                    ftp_data.state = E_FTP_STE_CONTINUE_FILE_RX;
+                if (ftp_open_file (ftp_data->path, FA_WRITE | FA_CREATE_ALWAYS)) {
+                    ftp_data->state = E_FTP_STE_CONTINUE_FILE_RX;
                     ftp_send_reply(150, NULL);
                 } else {
-                    ftp_data.state = E_FTP_STE_END_TRANSFER;
+                    ftp_data->state = E_FTP_STE_END_TRANSFER;
                     ftp_send_reply(550, NULL);
                 }
             }
@@ -1195,7 +1422,7 @@ static void ftp_process_cmd (void) {
         case E_FTP_CMD_DELE:
         case E_FTP_CMD_RMD:
             ftp_get_param_and_open_child (&bufptr);
-            if (FR_OK == f_unlink_helper(ftp_path)) {
+            if (FR_OK == f_unlink_helper(ftp_data->path)) {
                 ftp_send_reply(250, NULL);
             } else {
                 ftp_send_reply(550, NULL);
@@ -1203,7 +1430,7 @@ static void ftp_process_cmd (void) {
             break;
         case E_FTP_CMD_MKD:
             ftp_get_param_and_open_child (&bufptr);
-            if (FR_OK == f_mkdir_helper(ftp_path)) {
+            if (FR_OK == f_mkdir_helper(ftp_data->path)) {
                 ftp_send_reply(250, NULL);
             } else {
                 ftp_send_reply(550, NULL);
@@ -1211,10 +1438,10 @@ static void ftp_process_cmd (void) {
             break;
         case E_FTP_CMD_RNFR:
             ftp_get_param_and_open_child (&bufptr);
-            if (FR_OK == f_stat_helper (ftp_path, &fno)) {
+            if (FR_OK == f_stat_helper (ftp_data->path, &fno)) {
                 ftp_send_reply(350, NULL);
                 // save the current path
-                strcpy ((char *)ftp_data.dBuffer, ftp_path);
+                strcpy ((char *)ftp_data->dBuffer, ftp_data->path);
             } else {
                 ftp_send_reply(550, NULL);
             }
@@ -1222,7 +1449,7 @@ static void ftp_process_cmd (void) {
         case E_FTP_CMD_RNTO:
             ftp_get_param_and_open_child (&bufptr);
             // old path was saved in the data buffer
-            if (FR_OK == (fres = f_rename_helper ((char *)ftp_data.dBuffer, ftp_path))) {
+            if (FR_OK == (fres = f_rename_helper ((char *)ftp_data->dBuffer, ftp_data->path))) {
                 ftp_send_reply(250, NULL);
             } else {
                 ftp_send_reply(550, NULL);
@@ -1240,11 +1467,12 @@ static void ftp_process_cmd (void) {
             break;
         }
 
-        if (ftp_data.closechild) {
-            ftp_return_to_previous_path(ftp_path, ftp_scratch_buffer);
+        if (ftp_data->closechild) {
+            ftp_return_to_previous_path(ftp_data->path, ftp_data->scratch_buffer);
         }
     } else if (result == E_FTP_RESULT_CONTINUE) {
-        if (ftp_data.ctimeout++ > (servers_get_timeout() / FTP_CYCLE_TIME_MS)) {
+        ftp_data->ctimeout += ftp_server.elapsed;
+        if (ftp_data->ctimeout > servers_get_timeout()) {
             ftp_send_reply(221, NULL);
         }
     } else {
@@ -1253,25 +1481,25 @@ static void ftp_process_cmd (void) {
 }
 
 static void ftp_close_files (void) {
-    if (ftp_data.e_open == E_FTP_FILE_OPEN) {
-        f_closefile_helper(&ftp_data.u.fp);
-    } else if (ftp_data.e_open == E_FTP_DIR_OPEN) {
-        f_closedir_helper(&ftp_data.u.dp);
+    if (ftp_data->e_open == E_FTP_FILE_OPEN) {
+        f_closefile_helper(&ftp_data->u.fp);
+    } else if (ftp_data->e_open == E_FTP_DIR_OPEN) {
+        f_closedir_helper(&ftp_data->u.dp);
     }
-    ftp_data.e_open = E_FTP_NOTHING_OPEN;
+    ftp_data->e_open = E_FTP_NOTHING_OPEN;
 }
 
 static void ftp_close_filesystem_on_error (void) {
     ftp_close_files();
-    if (ftp_data.special_file) {
+    if (ftp_data->special_file) {
         updater_finish ();
-        ftp_data.special_file = false;
+        ftp_data->special_file = false;
     }
 }
 
 static void ftp_close_cmd_data (void) {
-    servers_close_socket(&ftp_data.c_sd);
-    servers_close_socket(&ftp_data.d_sd);
+    servers_close_socket(&ftp_data->c_sd);
+    servers_close_socket(&ftp_data->d_sd);
     ftp_close_filesystem_on_error ();
 }
 
@@ -1309,7 +1537,7 @@ static int ftp_print_eplf_item (char *dest, uint32_t destsize, ftp_fileinfo_t *f
     uint day = 1;
     uint64_t fseconds = 0;
 
-    if(isLittleFs(ftp_path))
+    if(isLittleFs(ftp_data->path))
     {
         type = (fno->u.fpinfo_lfs.info.type == LFS_TYPE_DIR) ? "d" : "-";
 
@@ -1388,12 +1616,61 @@ static int ftp_print_eplf_drive (char *dest, uint32_t destsize, const char *name
     return 0;
 }
 
+static int ftp_print_mlsd_item (char *dest, uint32_t destsize, ftp_fileinfo_t *fno) {
+    bool dir;
+    uint32_t size;
+    uint16_t fdate, ftime;
+    const char *name;
+    uint32_t _len;
+
+    if(isLittleFs(ftp_data->path))
+    {
+        dir = (fno->u.fpinfo_lfs.info.type == LFS_TYPE_DIR);
+        size = fno->u.fpinfo_lfs.info.size;
+        fdate = fno->u.fpinfo_lfs.timestamp.fdate;
+        ftime = fno->u.fpinfo_lfs.timestamp.ftime;
+        name = fno->u.fpinfo_lfs.info.name;
+    }
+    else
+    {
+        dir = (fno->u.fpinfo_fat.fattrib & AM_DIR);
+        size = fno->u.fpinfo_fat.fsize;
+        fdate = fno->u.fpinfo_fat.fdate;
+        ftime = fno->u.fpinfo_fat.ftime;
+        name = fno->u.fpinfo_fat.fname;
+    }
+
+    // RFC 3659 facts, so that the clients don't need to SIZE and MDTM every entry
+    if (dir) {
+        _len = snprintf(dest, destsize, "type=dir;modify=%u%02u%02u%02u%02u%02u; %s\r\n",
+                        1980 + ((fdate >> 9) & 0x7f), (fdate >> 5) & 0x0f, fdate & 0x1f,
+                        (ftime >> 11) & 0x1f, (ftime >> 5) & 0x3f, 2 * (ftime & 0x1f), name);
+    } else {
+        _len = snprintf(dest, destsize, "type=file;size=%u;modify=%u%02u%02u%02u%02u%02u; %s\r\n",
+                        size, 1980 + ((fdate >> 9) & 0x7f), (fdate >> 5) & 0x0f, fdate & 0x1f,
+                        (ftime >> 11) & 0x1f, (ftime >> 5) & 0x3f, 2 * (ftime & 0x1f), name);
+    }
+
+    if (_len > 0 && _len < destsize) {
+        return _len;
+    }
+    return 0;
+}
+
+static int ftp_print_mlsd_drive (char *dest, uint32_t destsize, const char *name) {
+    uint32_t _len = snprintf(dest, destsize, "type=dir; %s\r\n", name);
+    if (_len > 0 && _len < destsize) {
+        return _len;
+    }
+    return 0;
+}
+
 static bool ftp_open_file (const char *path, int mode) {
-    FRESULT res = f_open_helper(&ftp_data.u.fp, path, mode);
+    FRESULT res = f_open_helper(&ftp_data->u.fp, path, mode);
     if (res != FR_OK) {
         return false;
     }
-    ftp_data.e_open = E_FTP_FILE_OPEN;
+    ftp_data->e_open = E_FTP_FILE_OPEN;
     return true;
 }
 
@@ -1401,67 +1678,80 @@ static ftp_result_t ftp_read_file (char *filebuf, uint32_t desiredsize, uint32_t
     ftp_result_t result = E_FTP_RESULT_CONTINUE;
 
 
-    FRESULT res = f_read_helper(&ftp_data.u.fp, filebuf, desiredsize, (UINT *)actualsize);
+    FRESULT res = f_read_helper(&ftp_data->u.fp, filebuf, desiredsize, (UINT *)actualsize);
     if (res != FR_OK) {
         ftp_close_files();
         result = E_FTP_RESULT_FAILED;
         *actualsize = 0;
+        ftp_counters.file_errors++;
     } else if (*actualsize < desiredsize) {
         ftp_close_files();
         result = E_FTP_RESULT_OK;
+        ftp_counters.files_sent++;
     }
+    ftp_counters.bytes_sent += *actualsize;
     return result;
 }
 
 static ftp_result_t ftp_write_file (char *filebuf, uint32_t size) {
     ftp_result_t result = E_FTP_RESULT_FAILED;
     uint32_t actualsize;
-    FRESULT res = f_write_helper(&ftp_data.u.fp, filebuf, size, (UINT *)&actualsize);
+    FRESULT res = f_write_helper(&ftp_data->u.fp, filebuf, size, (UINT *)&actualsize);
     if ((actualsize == size) && (FR_OK == res)) {
         result = E_FTP_RESULT_OK;
     } else {
         ftp_close_files();
+        ftp_counters.file_errors++;
     }
+    ftp_counters.bytes_received += actualsize;
     return result;
 }
 
+static void ftp_metrics_collect (uint32_t *values) {
+    values[0] = ftp_counters.sessions;
+    values[1] = ftp_counters.files_sent;
+    values[2] = ftp_counters.files_received;
+    values[3] = ftp_counters.bytes_sent;
+    values[4] = ftp_counters.bytes_received;
+    values[5] = ftp_counters.file_errors;
+}
+
 static ftp_result_t ftp_open_dir_for_listing (const char *path) {
 
     // "hack" to detect the root directory
     if (path[0] == '/' && path[1] == '\0') {
-        ftp_data.listroot = true;
+        ftp_data->listroot = true;
     } else {
         FRESULT res;
-        res = f_opendir_helper(&ftp_data.u.dp, path);                       /* Open the directory */
+        res = f_opendir_helper(&ftp_data->u.dp, path);                       /* Open the directory */
         if (res != FR_OK) {
             return E_FTP_RESULT_FAILED;
         }
-        ftp_data.e_open = E_FTP_DIR_OPEN;
-        ftp_data.listroot = false;
+        ftp_data->e_open = E_FTP_DIR_OPEN;
+        ftp_data->listroot = false;
+        ftp_data->list_pending = false;
     }
     return E_FTP_RESULT_CONTINUE;
 }
 
+static bool ftp_is_dot_entry (const char *name) {
+    return (name[0] == '.' && name[1] == 0) || (name[0] == '.' && name[1] == '.' && name[2] == 0);
+}
+
 static ftp_result_t ftp_list_dir (char *list, uint32_t maxlistsize, uint32_t *listsize) {
     uint next = 0;
     uint32_t _len;
     FRESULT res;
     ftp_result_t result = E_FTP_RESULT_CONTINUE;
-    ftp_fileinfo_t fno;
+    ftp_fileinfo_t *fno = &ftp_data->list_fno;
 
-    // if we are resuming an incomplete list operation, go back to the item we left behind
-    if (!ftp_data.listroot) {
-        for (int i = 0; i < ftp_last_dir_idx; i++) {
-            f_readdir_helper(&ftp_data.u.dp, &fno);
-        }
-    }
-
-    // read until we get all items or there's no more space in the buffer
+    // read until we get all items or there's no more space in the buffer, the directory
+    // stays open in between so every entry is read only once
     while (true) {
-        if (ftp_data.listroot) {
+        if (ftp_data->listroot) {
             // root directory "hack"
             mp_vfs_mount_t *vfs = MP_STATE_VM(vfs_mount_table);
-            int i = ftp_data.volcount;
+            int i = ftp_data->volcount;
             while (vfs != NULL && i != 0) {
                 vfs = vfs->next;
                 i -= 1;
@@ -1469,59 +1759,62 @@ static ftp_result_t ftp_list_dir (char *list, uint32_t maxlistsize, uint32_t *li
             if (vfs == NULL) {
                 if (!next) {
                     // no volume found this time, we are done
-                    ftp_data.volcount = 0;
+                    ftp_data->volcount = 0;
                 }
                 break;
+            }
+            if (ftp_data->mlsd) {
+                _len = ftp_print_mlsd_drive((list + next), (maxlistsize - next), vfs->str + 1);
             } else {
-                next += ftp_print_eplf_drive((list + next), (maxlistsize - next), vfs->str + 1);
+                _len = ftp_print_eplf_drive((list + next), (maxlistsize - next), vfs->str + 1);
             }
-            ftp_data.volcount++;
+            if (!_len) {
+                // no space left, this volume goes into the next buffer
+                break;
+            }
+            next += _len;
+            ftp_data->volcount++;
         } else {
             // a "normal" directory
-            res = f_readdir_helper(&ftp_data.u.dp, &fno);                                                       /* Read a directory item */
-            if(isLittleFs(ftp_path))
-            {
-                if (res != FR_OK || fno.u.fpinfo_lfs.info.name[0] == 0) {
-                    result = E_FTP_RESULT_OK;
-                    break;                                                                                 /* Break on error or end of dp */
-                }
-                if (fno.u.fpinfo_lfs.info.name[0] == '.' && fno.u.fpinfo_lfs.info.name[1] == 0)
+            if (!ftp_data->list_pending) {
+                res = f_readdir_helper(&ftp_data->u.dp, fno);                                           /* Read a directory item */
+                if(isLittleFs(ftp_data->path))
                 {
-                    ftp_last_dir_idx++;
-                    continue;            /* Ignore . entry, but need to count it as LittleFs does not filter it out opposed to FatFs */
+                    if (res != FR_OK || fno->u.fpinfo_lfs.info.name[0] == 0) {
+                        result = E_FTP_RESULT_OK;
+                        break;                                                                          /* Break on error or end of dp */
+                    }
+                    /* LittleFs does not filter out the . and .. entries opposed to FatFs */
+                    if (ftp_is_dot_entry(fno->u.fpinfo_lfs.info.name)) continue;
                 }
-                if (fno.u.fpinfo_lfs.info.name[0] == '.' && fno.u.fpinfo_lfs.info.name[1] == '.' && fno.u.fpinfo_lfs.info.name[2] == 0)
+                else
                 {
-                    ftp_last_dir_idx++;
-                    continue;            /* Ignore .. entry, but need to count it as LittleFs does not filter it out opposed to FatFs */
-                }
-            }
-            else
-            {
-                if (res != FR_OK || fno.u.fpinfo_fat.fname[0] == 0) {
-                    result = E_FTP_RESULT_OK;
-                    break;                                                                                 /* Break on error or end of dp */
+                    if (res != FR_OK || fno->u.fpinfo_fat.fname[0] == 0) {
+                        result = E_FTP_RESULT_OK;
+                        break;                                                                          /* Break on error or end of dp */
+                    }
+                    if (ftp_is_dot_entry(fno->u.fpinfo_fat.fname)) continue;                            /* Ignore . and .. entries */
                 }
-                if (fno.u.fpinfo_fat.fname[0] == '.' && fno.u.fpinfo_fat.fname[1] == 0) continue;                                    /* Ignore . entry */
-                if (fno.u.fpinfo_fat.fname[0] == '.' && fno.u.fpinfo_fat.fname[1] == '.' && fno.u.fpinfo_fat.fname[2] == 0) continue;             /* Ignore .. entry */
             }
 
             // add the entry to the list if space is available
-            _len = ftp_print_eplf_item((list + next), (maxlistsize - next - 1), &fno);
+            if (ftp_data->mlsd) {
+                _len = ftp_print_mlsd_item((list + next), (maxlistsize - next - 1), fno);
+            } else {
+                _len = ftp_print_eplf_item((list + next), (maxlistsize - next - 1), fno);
+            }
             if (!_len) {
-                // close and open again, we will resume in the next iteration
-                ftp_close_files();
-                ftp_open_dir_for_listing(ftp_path);
+                // keep the entry for the next buffer
+                ftp_data->list_pending = true;
                 break;
             }
+            ftp_data->list_pending = false;
             next += _len;
-            ftp_last_dir_idx++;
         }
     }
 
     if (result == E_FTP_RESULT_OK) {
         ftp_close_files();
-        ftp_last_dir_idx = 0;
     }
     *listsize = next;
     return result;
@@ -10,6 +10,8 @@
 #ifndef FTP_H_
 #define FTP_H_
 
+#include "lwip/sockets.h"
+
 extern void stoupper (char *str);
 
 /******************************************************************************
@@ -20,5 +22,6 @@ extern void ftp_run (void);
 extern void ftp_enable (void);
 extern void ftp_disable (void);
 extern void ftp_reset (void);
+extern int32_t ftp_select_fds (fd_set *rfds, fd_set *wfds, uint32_t *timeout_ms);
 
 #endif /* FTP_H_ */
@@ -22,6 +22,14 @@
 #include "esp_log.h"
 #include "rom/crc.h"
 #include "esp32chipinfo.h"
+#include "esp_secure_boot.h"
+#include "esp_heap_caps.h"
+#include "mbedtls/sha256.h"
+#include "uzlib/uzlib.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 
 /******************************************************************************
  DEFINE PRIVATE CONSTANTS
@@ -32,15 +40,104 @@ static const char *TAG = "updater";
 /* if flash is encrypted, it requires the flash_write operation to be done in 16 Bytes chunks */
 #define ENCRYP_FLASH_MIN_CHUNK                            16
 
+/* a 64K block erase is much faster than erasing its 16 sectors one by one */
+#define UPDATER_ERASE_BLOCK_SIZE                          (64 * 1024)
+/* sectors kept erased ahead of the one being filled */
+#define UPDATER_ERASE_AHEAD_SECTORS                       2
+
+#define UPDATER_DIGEST_LEN                                32
+
+/* compressed input kept ahead of the inflater, so that it never runs dry in the middle of a symbol */
+#define UPDATER_INFLATE_IN_SIZE                           2048
+/* enough for the largest dynamic Huffman block header */
+#define UPDATER_INFLATE_MARGIN                            512
+/* a deflate symbol takes at most 48 bits of input and produces at least one byte */
+#define UPDATER_INFLATE_IN_PER_OUT                        6
+#define UPDATER_INFLATE_OUT_SIZE                          512
+
+/* buffers handed over to the writer task, one is filled while the other is programmed */
+#define UPDATER_PIPE_BUFFERS                              2
+#define UPDATER_PIPE_BUF_SIZE                             SPI_FLASH_SEC_SIZE
+#define UPDATER_PIPE_STACK_SIZE                           4096
+#define UPDATER_PIPE_TASK_PRIORITY                        5
+
+/* progress records of a raw download, appended to the otadata sector past the boot info */
+#define UPDATER_PROGRESS_MAGIC                            0x474F5250    // "PROG"
+#define UPDATER_PROGRESS_AREA                             256
+#define UPDATER_PROGRESS_RECORDS                          ((OTAA_DATA_SIZE - UPDATER_PROGRESS_AREA) / sizeof(updater_progress_t))
+/* bytes written between two records, a whole image fits without erasing the sector */
+#define UPDATER_PROGRESS_INTERVAL                         (64 * 1024)
+
+#define UPDATER_DELTA_MAGIC                               "PYD1"
+#define UPDATER_DELTA_HDR_SIZE                            12
+#define UPDATER_DELTA_OP_HDR_MAX                          9
+#define UPDATER_DELTA_ADD_CHUNK                           256
+
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
+typedef enum {
+    E_UPDATER_DIGEST_UNKNOWN = 0,
+    E_UPDATER_DIGEST_VALID,
+    E_UPDATER_DIGEST_INVALID
+} updater_digest_t;
+
+typedef enum {
+    E_UPDATER_DELTA_OP_COPY = 0,    // copy len bytes of the running image from src
+    E_UPDATER_DELTA_OP_INSERT,      // len literal bytes follow
+    E_UPDATER_DELTA_OP_ADD,         // len bytes follow, added to the bytes of the running image at src
+} updater_delta_op_t;
+
+// 32 bytes, friendly to flash encryption
+typedef struct {
+    uint32_t magic;
+    uint32_t start;             // address of the slot being written
+    uint32_t written;           // bytes of the image already in flash, in whole sectors
+    uint32_t crc;               // CRC32 of those bytes
+    uint32_t reserved[3];
+    uint32_t record_crc;
+} updater_progress_t;
+
+typedef struct {
+    TINF_DATA decomp;
+    uint8_t *dict;
+    uint32_t in_len;
+    bool header_done;
+    bool done;
+    uint8_t in[UPDATER_INFLATE_IN_SIZE];
+    uint8_t out[UPDATER_INFLATE_OUT_SIZE];
+} updater_inflate_t;
+
+typedef struct {
+    uint32_t source;            // address of the running image
+    uint32_t source_size;       // bytes of it the patch refers to
+    uint32_t len;               // bytes of the current INSERT/ADD op still to come
+    uint32_t src;               // running image offset of the current op
+    uint8_t hdr[UPDATER_DELTA_HDR_SIZE];
+    uint8_t hdr_len;
+    uint8_t op;
+    bool started;               // patch header checked
+} updater_delta_t;
+
 typedef struct {
     uint32_t size;
     uint32_t offset;
     uint32_t offset_start_upd;
     uint32_t chunk_size;
     uint32_t current_chunk;
+    uint32_t erased;            // end of the flash region already erased
+    uint8_t *sector;            // data waiting to be written as a whole sector
+    mbedtls_sha256_context sha256_context;
+    // the last bytes received, held back from the hash as they might be the appended digest
+    uint8_t tail[UPDATER_DIGEST_LEN];
+    uint8_t tail_len;
+    bool hash_appended;
+    updater_digest_t digest;
+    uint32_t crc;               // CRC32 of the bytes written into flash
+    uint32_t progress_saved;    // bytes written when the last progress record was saved
+    uint8_t format;
+    updater_inflate_t *inflate;
+    updater_delta_t delta;
 } updater_data_t;
 
 /******************************************************************************
@@ -53,6 +150,17 @@ static updater_data_t updater_data = {
     .chunk_size = 0,
     .current_chunk = 0 };
 
+// the writer task behind updater_write_async()
+static struct {
+    TaskHandle_t task;
+    QueueHandle_t full;                         // buffers waiting to be written
+    QueueHandle_t free;                         // buffers the caller can fill
+    uint8_t *data[UPDATER_PIPE_BUFFERS];
+    uint32_t len[UPDATER_PIPE_BUFFERS];
+    int filling;                                // buffer being filled by the caller, -1 if none
+    volatile bool failed;
+} updater_pipe = { .filling = -1 };
+
 //static OsiLockObj_t updater_LockObj;
 static boot_info_t boot_info;
 static uint32_t boot_info_offset;
@@ -62,6 +170,24 @@ static uint32_t boot_info_offset;
  ******************************************************************************/
 static esp_err_t updater_spi_flash_read(size_t src, void *dest, size_t size, bool allow_decrypt);
 static esp_err_t updater_spi_flash_write(size_t dest_addr, void *src, size_t size, bool write_encrypted);
+static bool updater_erase_ahead(uint32_t end);
+static bool updater_flush(void);
+static bool updater_put(const uint8_t *buf, uint32_t len);
+static bool updater_patch(const uint8_t *buf, uint32_t len);
+static bool updater_inflate(const uint8_t *buf, uint32_t len, bool final);
+static bool updater_delta_start(void);
+static bool updater_begin(uint8_t format);
+static bool updater_pipe_init(void);
+static void updater_pipe_release(void);
+static void TASK_Updater(void *pvParameters);
+static uint32_t updater_progress_find(updater_progress_t *last, bool *found);
+static void updater_progress_save(void);
+static void updater_progress_clear(void);
+static bool updater_replay(uint32_t len, uint32_t crc);
+static void updater_hash_start(void);
+static void updater_hash_update(const uint8_t *buf, uint32_t len);
+static void updater_hash_finish(void);
+static void updater_release(void);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
@@ -99,56 +225,150 @@ bool updater_check_path (void *path) {
 }
 
 bool updater_start (void) {
+    return updater_start_format(UPDATER_FORMAT_RAW);
+}
 
-    updater_data.size = (esp32_get_chip_rev() > 0 ? IMG_SIZE_8MB : IMG_SIZE_4MB);
-    // check which one should be the next active image
-    updater_data.offset = updater_ota_next_slot_address();
-
-    ESP_LOGD(TAG, "Updating image at offset = 0x%6X\n", updater_data.offset);
-    updater_data.offset_start_upd = updater_data.offset;
+bool updater_start_format (uint8_t format) {
 
-    // erase the first 2 sectors
-    if (ESP_OK != spi_flash_erase_sector(updater_data.offset / SPI_FLASH_SEC_SIZE)) {
-        ESP_LOGE(TAG, "Erasing first sector failed!\n");
+    if (!updater_begin(format)) {
         return false;
     }
-    if (ESP_OK != spi_flash_erase_sector((updater_data.offset + SPI_FLASH_SEC_SIZE) / SPI_FLASH_SEC_SIZE)) {
-        ESP_LOGE(TAG, "Erasing second sector failed!\n");
+    // a new image, whatever was saved about an interrupted one doesn't apply anymore
+    updater_progress_clear();
+
+    // erase the first sectors
+    if (!updater_erase_ahead(updater_data.offset + (UPDATER_ERASE_AHEAD_SECTORS * SPI_FLASH_SEC_SIZE))) {
+        ESP_LOGE(TAG, "Erasing first sectors failed!\n");
         return false;
     }
+    return true;
+}
 
-    boot_info.size = 0;
-    updater_data.current_chunk = 0;
+bool updater_resume (uint32_t *resume_offset) {
+    updater_progress_t progress;
+    bool found;
+
+    *resume_offset = 0;
+    if (!updater_begin(UPDATER_FORMAT_RAW)) {
+        return false;
+    }
+    updater_progress_find(&progress, &found);
+    if (!found || progress.start != updater_data.offset_start_upd ||
+        progress.written > updater_data.size || !updater_replay(progress.written, progress.crc)) {
+        ESP_LOGI(TAG, "Nothing to resume, starting over\n");
+        mbedtls_sha256_free(&updater_data.sha256_context);
+        updater_hash_start();
+        updater_progress_clear();
+    } else {
+        ESP_LOGI(TAG, "Resuming the image at %d\n", progress.written);
+        updater_data.offset += progress.written;
+        // the sectors past the last saved point may hold anything written before the interruption
+        updater_data.erased = updater_data.offset;
+        updater_data.crc = progress.crc;
+        updater_data.progress_saved = progress.written;
+        boot_info.size = progress.written;
+        *resume_offset = progress.written;
+    }
 
+    if (!updater_erase_ahead(updater_data.offset + (UPDATER_ERASE_AHEAD_SECTORS * SPI_FLASH_SEC_SIZE))) {
+        ESP_LOGE(TAG, "Erasing first sectors failed!\n");
+        return false;
+    }
     return true;
 }
 
 bool updater_write (uint8_t *buf, uint32_t len) {
 
-    // the actual writing into flash, not-encrypted,
-    // because it already came encrypted from OTA server
-    if (ESP_OK != updater_spi_flash_write(updater_data.offset, (void *)buf, len, false)) {
-        ESP_LOGE(TAG, "SPI flash write failed\n");
+    if (!updater_data.sector) {
         return false;
     }
 
-    updater_data.offset += len;
-    updater_data.current_chunk += len;
-    boot_info.size += len;
+    if (updater_data.format & UPDATER_FORMAT_ZLIB) {
+        return updater_inflate(buf, len, false);
+    }
+//    sl_LockObjUnlock (&wlan_LockObj);
+    return updater_patch(buf, len);
+}
 
-    if (updater_data.current_chunk >= SPI_FLASH_SEC_SIZE) {
-        updater_data.current_chunk -= SPI_FLASH_SEC_SIZE;
-        // erase the next sector
-        if (ESP_OK != spi_flash_erase_sector((updater_data.offset + SPI_FLASH_SEC_SIZE) / SPI_FLASH_SEC_SIZE)) {
-            ESP_LOGE(TAG, "Erasing next sector failed!\n");
-            return false;
+bool updater_write_async (uint8_t *buf, uint32_t len) {
+
+    if (!updater_data.sector) {
+        return false;
+    }
+    if (!updater_pipe_init()) {
+        // no memory for the pipeline, write in place
+        return updater_write(buf, len);
+    }
+
+    while (len > 0) {
+        if (updater_pipe.filling < 0) {
+            xQueueReceive(updater_pipe.free, &updater_pipe.filling, portMAX_DELAY);
+            updater_pipe.len[updater_pipe.filling] = 0;
+        }
+        int i = updater_pipe.filling;
+        uint32_t chunk = MIN(len, UPDATER_PIPE_BUF_SIZE - updater_pipe.len[i]);
+        memcpy(&updater_pipe.data[i][updater_pipe.len[i]], buf, chunk);
+        updater_pipe.len[i] += chunk;
+        buf += chunk;
+        len -= chunk;
+        if (updater_pipe.len[i] == UPDATER_PIPE_BUF_SIZE) {
+            xQueueSend(updater_pipe.full, &i, portMAX_DELAY);
+            updater_pipe.filling = -1;
         }
     }
-//    sl_LockObjUnlock (&wlan_LockObj);
-    return true;
+    return !updater_pipe.failed;
+}
+
+bool updater_wait (void) {
+    if (!updater_pipe.task || !updater_pipe.data[0]) {
+        return true;
+    }
+    // hand over what is left and wait until the writer has given every buffer back
+    if (updater_pipe.filling >= 0) {
+        xQueueSend(updater_pipe.full, &updater_pipe.filling, portMAX_DELAY);
+        updater_pipe.filling = -1;
+    }
+    int held[UPDATER_PIPE_BUFFERS];
+    for (int i = 0; i < UPDATER_PIPE_BUFFERS; i++) {
+        xQueueReceive(updater_pipe.free, &held[i], portMAX_DELAY);
+    }
+    for (int i = 0; i < UPDATER_PIPE_BUFFERS; i++) {
+        xQueueSend(updater_pipe.free, &held[i], 0);
+    }
+    bool ok = !updater_pipe.failed;
+    updater_pipe.failed = false;
+    return ok;
 }
 
 bool updater_finish (void) {
+    if (!updater_wait()) {
+        updater_pipe_release();
+        updater_release();
+        // don't boot a partially written image
+        updater_data.offset = 0;
+        return false;
+    }
+    updater_pipe_release();
+    if (updater_data.sector) {
+        bool complete = true;
+        if (updater_data.format & UPDATER_FORMAT_ZLIB) {
+            complete = updater_inflate(NULL, 0, true) && updater_data.inflate->done;
+        }
+        if (updater_data.format & UPDATER_FORMAT_DELTA) {
+            complete = complete && updater_data.delta.started && updater_data.delta.hdr_len == 0 && updater_data.delta.len == 0;
+        }
+        // write the last (partial) sector
+        if (!complete || !updater_flush()) {
+            ESP_LOGE(TAG, "Image incomplete\n");
+            updater_release();
+            // don't boot a partially written image
+            updater_data.offset = 0;
+            return false;
+        }
+        updater_hash_finish();
+        updater_release();
+        updater_progress_clear();
+    }
     if (updater_data.offset > 0) {
         ESP_LOGI(TAG, "Updater finished, boot status: %d\n", boot_info.Status);
 //        sl_LockObjLock (&wlan_LockObj, SL_OS_WAIT_FOREVER);
@@ -181,6 +401,13 @@ bool updater_verify (void) {
     // the last image written stats at updater_data.offset_start_upd and
     // has the lenght boot_info.size
 
+    // the digest has already been checked while the image was being received,
+    // no need to read it back again unless the signature must be verified too
+    if (updater_data.digest == E_UPDATER_DIGEST_VALID && !esp_secure_boot_enabled()) {
+        ESP_LOGI(TAG, "image digest verified during the transfer\n");
+        return true;
+    }
+
     esp_err_t ret;
     esp_image_metadata_t data;
     const esp_partition_pos_t part_pos = {
@@ -284,6 +511,52 @@ int updater_ota_next_slot_address() {
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
 
+static bool updater_begin(uint8_t format)
+{
+    // nothing of a previous update may still be on its way to the flash
+    updater_wait();
+
+    updater_data.size = (esp32_get_chip_rev() > 0 ? IMG_SIZE_8MB : IMG_SIZE_4MB);
+    // check which one should be the next active image
+    updater_data.offset = updater_ota_next_slot_address();
+
+    ESP_LOGD(TAG, "Updating image at offset = 0x%6X\n", updater_data.offset);
+    updater_data.offset_start_upd = updater_data.offset;
+    updater_data.erased = updater_data.offset;
+
+    // the data is written into flash in whole sectors
+    updater_release();
+    updater_data.sector = heap_caps_malloc(SPI_FLASH_SEC_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!updater_data.sector) {
+        ESP_LOGE(TAG, "Can't allocate %d\n", SPI_FLASH_SEC_SIZE);
+        return false;
+    }
+    updater_hash_start();
+    updater_data.format = format;
+
+    if (format & UPDATER_FORMAT_ZLIB) {
+        updater_data.inflate = heap_caps_malloc(sizeof(updater_inflate_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!updater_data.inflate) {
+            ESP_LOGE(TAG, "Can't allocate %d\n", sizeof(updater_inflate_t));
+            updater_release();
+            return false;
+        }
+        memset(updater_data.inflate, 0, sizeof(updater_inflate_t));
+    }
+    if ((format & UPDATER_FORMAT_DELTA) && !updater_delta_start()) {
+        updater_release();
+        return false;
+    }
+
+    boot_info.size = 0;
+    updater_data.current_chunk = 0;
+    updater_data.crc = 0;
+    updater_data.progress_saved = 0;
+
+    return true;
+}
+
+
 static esp_err_t updater_spi_flash_read(size_t src, void *dest, size_t size, bool allow_decrypt)
 {
     if (allow_decrypt && esp_flash_encryption_enabled()) {
@@ -293,6 +566,499 @@ static esp_err_t updater_spi_flash_read(size_t src, void *dest, size_t size, boo
     }
 }
 
+static bool updater_erase_ahead(uint32_t end)
+{
+    uint32_t slot_end = updater_data.offset_start_upd + updater_data.size;
+    end = MIN(end, slot_end);
+    while (updater_data.erased < end) {
+        uint32_t size = SPI_FLASH_SEC_SIZE;
+        if ((updater_data.erased % UPDATER_ERASE_BLOCK_SIZE) == 0 && (updater_data.erased + UPDATER_ERASE_BLOCK_SIZE) <= slot_end) {
+            size = UPDATER_ERASE_BLOCK_SIZE;
+        }
+        if (ESP_OK != spi_flash_erase_range(updater_data.erased, size)) {
+            return false;
+        }
+        updater_data.erased += size;
+    }
+    return true;
+}
+
+static bool updater_flush(void)
+{
+    if (updater_data.current_chunk == 0) {
+        return true;
+    }
+    if (updater_data.offset + updater_data.current_chunk > updater_data.offset_start_upd + updater_data.size) {
+        ESP_LOGE(TAG, "Image too big\n");
+        return false;
+    }
+    if (updater_data.offset == updater_data.offset_start_upd && updater_data.current_chunk >= sizeof(esp_image_header_t)) {
+        const esp_image_header_t *header = (const esp_image_header_t *)updater_data.sector;
+        updater_data.hash_appended = (header->magic == ESP_IMAGE_HEADER_MAGIC) && header->hash_appended;
+    }
+    // the sector being written must have been erased already
+    if (!updater_erase_ahead(updater_data.offset + SPI_FLASH_SEC_SIZE)) {
+        ESP_LOGE(TAG, "Erasing sector failed!\n");
+        return false;
+    }
+    // a raw image is written as it is, because it already came encrypted from OTA server,
+    // a compressed or patched one is assembled here in plain text and encrypted while written
+    bool encrypt = (updater_data.format != UPDATER_FORMAT_RAW);
+    uint32_t len = updater_data.current_chunk;
+    if (encrypt && esp_flash_encryption_enabled()) {
+        uint32_t aligned = (len + 31) & ~31;
+        memset(&updater_data.sector[len], 0xFF, aligned - len);
+        len = aligned;
+    }
+    if (ESP_OK != updater_spi_flash_write(updater_data.offset, (void *)updater_data.sector, len, encrypt)) {
+        ESP_LOGE(TAG, "SPI flash write failed\n");
+        return false;
+    }
+    updater_data.crc = crc32_le(updater_data.crc, updater_data.sector, updater_data.current_chunk);
+    updater_data.offset += updater_data.current_chunk;
+    updater_data.current_chunk = 0;
+    // only a raw download can be continued later, nothing else depends on the data received so far
+    if (updater_data.format == UPDATER_FORMAT_RAW &&
+        (updater_data.offset - updater_data.offset_start_upd) - updater_data.progress_saved >= UPDATER_PROGRESS_INTERVAL) {
+        updater_progress_save();
+    }
+    // keep the next sectors ready for the data still to come
+    if (!updater_erase_ahead(updater_data.offset + (UPDATER_ERASE_AHEAD_SECTORS * SPI_FLASH_SEC_SIZE))) {
+        ESP_LOGE(TAG, "Erasing next sector failed!\n");
+        return false;
+    }
+    return true;
+}
+
+static bool updater_pipe_init(void)
+{
+    if (!updater_pipe.task) {
+        updater_pipe.full = xQueueCreate(UPDATER_PIPE_BUFFERS, sizeof(int));
+        updater_pipe.free = xQueueCreate(UPDATER_PIPE_BUFFERS, sizeof(int));
+        if (!updater_pipe.full || !updater_pipe.free ||
+            pdPASS != xTaskCreatePinnedToCore(TASK_Updater, "Updater", UPDATER_PIPE_STACK_SIZE / sizeof(StackType_t), NULL,
+                                              UPDATER_PIPE_TASK_PRIORITY, &updater_pipe.task, 1)) {
+            ESP_LOGE(TAG, "Can't start the writer task\n");
+            if (updater_pipe.full) {
+                vQueueDelete(updater_pipe.full);
+                updater_pipe.full = NULL;
+            }
+            if (updater_pipe.free) {
+                vQueueDelete(updater_pipe.free);
+                updater_pipe.free = NULL;
+            }
+            updater_pipe.task = NULL;
+            return false;
+        }
+    }
+    // the buffers are only kept while an update is in progress
+    if (!updater_pipe.data[0]) {
+        for (int i = 0; i < UPDATER_PIPE_BUFFERS; i++) {
+            updater_pipe.data[i] = heap_caps_malloc(UPDATER_PIPE_BUF_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            if (!updater_pipe.data[i]) {
+                updater_pipe_release();
+                return false;
+            }
+        }
+        xQueueReset(updater_pipe.free);
+        for (int i = 0; i < UPDATER_PIPE_BUFFERS; i++) {
+            xQueueSend(updater_pipe.free, &i, 0);
+        }
+        updater_pipe.filling = -1;
+        updater_pipe.failed = false;
+    }
+    return true;
+}
+
+// only called once the writer is idle
+static void updater_pipe_release(void)
+{
+    for (int i = 0; i < UPDATER_PIPE_BUFFERS; i++) {
+        free(updater_pipe.data[i]);
+        updater_pipe.data[i] = NULL;
+    }
+}
+
+static void TASK_Updater(void *pvParameters)
+{
+    int i;
+    for (;;) {
+        xQueueReceive(updater_pipe.full, &i, portMAX_DELAY);
+        // once a chunk is lost the image is useless, just give the buffers back until updater_finish()
+        if (!updater_pipe.failed && !updater_write(updater_pipe.data[i], updater_pipe.len[i])) {
+            updater_pipe.failed = true;
+        }
+        xQueueSend(updater_pipe.free, &i, portMAX_DELAY);
+    }
+}
+
+// returns the number of records used, *last is the newest valid one
+static uint32_t updater_progress_find(updater_progress_t *last, bool *found)
+{
+    uint32_t i;
+    *found = false;
+    for (i = 0; i < UPDATER_PROGRESS_RECORDS; i++) {
+        uint32_t addr = boot_info_offset + UPDATER_PROGRESS_AREA + (i * sizeof(updater_progress_t));
+        updater_progress_t record;
+        uint32_t *words = (uint32_t *)&record;
+        // an erased record reads as all ones only without decryption
+        if (ESP_OK != updater_spi_flash_read(addr, &record, sizeof(record), false)) {
+            break;
+        }
+        bool erased = true;
+        for (int w = 0; w < sizeof(record) / sizeof(uint32_t); w++) {
+            erased &= (words[w] == UINT32_MAX);
+        }
+        if (erased) {
+            break;
+        }
+        if (ESP_OK == updater_spi_flash_read(addr, &record, sizeof(record), true) && record.magic == UPDATER_PROGRESS_MAGIC &&
+            record.record_crc == crc32_le(0, (uint8_t *)&record, sizeof(record) - sizeof(record.record_crc))) {
+            *last = record;
+            *found = true;
+        }
+    }
+    return i;
+}
+
+static void updater_progress_save(void)
+{
+    updater_progress_t record;
+    bool found;
+    uint32_t next = updater_progress_find(&record, &found);
+    if (next >= UPDATER_PROGRESS_RECORDS) {
+        return;
+    }
+    memset(&record, 0, sizeof(record));
+    record.magic = UPDATER_PROGRESS_MAGIC;
+    record.start = updater_data.offset_start_upd;
+    record.written = updater_data.offset - updater_data.offset_start_upd;
+    record.crc = updater_data.crc;
+    record.record_crc = crc32_le(0, (uint8_t *)&record, sizeof(record) - sizeof(record.record_crc));
+    if (ESP_OK == updater_spi_flash_write(boot_info_offset + UPDATER_PROGRESS_AREA + (next * sizeof(record)), &record, sizeof(record), true)) {
+        updater_data.progress_saved = record.written;
+    }
+}
+
+// the records only go away with the sector, rewrite the boot info to erase them
+static void updater_progress_clear(void)
+{
+    updater_progress_t record;
+    boot_info_t info;
+    uint32_t info_offset;
+    bool found;
+    if (updater_progress_find(&record, &found) > 0 && updater_read_boot_info(&info, &info_offset)) {
+        updater_write_boot_info(&info, info_offset);
+    }
+}
+
+// feeds the part of the image already in flash through the hash again, checking it against the saved CRC
+static bool updater_replay(uint32_t len, uint32_t crc)
+{
+    uint32_t computed = 0;
+    for (uint32_t done = 0; done < len; ) {
+        uint32_t chunk = MIN(len - done, SPI_FLASH_SEC_SIZE);
+        if (ESP_OK != updater_spi_flash_read(updater_data.offset_start_upd + done, updater_data.sector, chunk, false)) {
+            return false;
+        }
+        if (done == 0 && chunk >= sizeof(esp_image_header_t)) {
+            const esp_image_header_t *header = (const esp_image_header_t *)updater_data.sector;
+            updater_data.hash_appended = (header->magic == ESP_IMAGE_HEADER_MAGIC) && header->hash_appended;
+        }
+        computed = crc32_le(computed, updater_data.sector, chunk);
+        updater_hash_update(updater_data.sector, chunk);
+        done += chunk;
+    }
+    return computed == crc;
+}
+
+// takes the next bytes of the final image
+static bool updater_put(const uint8_t *buf, uint32_t len)
+{
+    updater_hash_update(buf, len);
+    boot_info.size += len;
+
+    while (len > 0) {
+        uint32_t chunk = MIN(len, SPI_FLASH_SEC_SIZE - updater_data.current_chunk);
+        memcpy(&updater_data.sector[updater_data.current_chunk], buf, chunk);
+        updater_data.current_chunk += chunk;
+        buf += chunk;
+        len -= chunk;
+        if (updater_data.current_chunk == SPI_FLASH_SEC_SIZE && !updater_flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool updater_delta_start(void)
+{
+    // the patch is applied against the image running now, found through the flash cache
+    uint32_t running = spi_flash_cache2phys((const void *)updater_delta_start);
+    if (running >= IMG_FACTORY_OFFSET && running < IMG_FACTORY_OFFSET + updater_data.size) {
+        updater_data.delta.source = IMG_FACTORY_OFFSET;
+    } else {
+        updater_data.delta.source = (esp32_get_chip_rev() > 0 ? IMG_UPDATE1_OFFSET_8MB : IMG_UPDATE1_OFFSET_4MB);
+    }
+    if (updater_data.delta.source == updater_data.offset_start_upd) {
+        ESP_LOGE(TAG, "Can't patch the image being replaced\n");
+        return false;
+    }
+    updater_data.delta.source_size = 0;
+    updater_data.delta.len = 0;
+    updater_data.delta.hdr_len = 0;
+    updater_data.delta.started = false;
+    return true;
+}
+
+// the patch must have been made against exactly the image running now
+static bool updater_delta_check_source(void)
+{
+    const uint8_t *hdr = updater_data.delta.hdr;
+    if (memcmp(hdr, UPDATER_DELTA_MAGIC, 4)) {
+        ESP_LOGE(TAG, "Not a delta patch\n");
+        return false;
+    }
+    uint32_t size, crc, computed = 0;
+    memcpy(&size, &hdr[4], sizeof(size));
+    memcpy(&crc, &hdr[8], sizeof(crc));
+    if (size > updater_data.size) {
+        return false;
+    }
+    // nothing has been buffered into the sector yet, use it to read the running image
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t chunk = MIN(size - done, SPI_FLASH_SEC_SIZE);
+        if (ESP_OK != updater_spi_flash_read(updater_data.delta.source + done, updater_data.sector, chunk, true)) {
+            return false;
+        }
+        computed = crc32_le(computed, updater_data.sector, chunk);
+        done += chunk;
+    }
+    if (computed != crc) {
+        ESP_LOGE(TAG, "Delta patch made for another image\n");
+        return false;
+    }
+    updater_data.delta.source_size = size;
+    return true;
+}
+
+static bool updater_delta_copy(uint32_t src, uint32_t len, const uint8_t *add)
+{
+    uint8_t chunk_buf[UPDATER_DELTA_ADD_CHUNK];
+    if (src > updater_data.delta.source_size || len > updater_data.delta.source_size - src) {
+        ESP_LOGE(TAG, "Delta op out of the image\n");
+        return false;
+    }
+    while (len > 0) {
+        uint32_t chunk = MIN(len, sizeof(chunk_buf));
+        if (ESP_OK != updater_spi_flash_read(updater_data.delta.source + src, chunk_buf, chunk, true)) {
+            return false;
+        }
+        if (add) {
+            for (uint32_t i = 0; i < chunk; i++) {
+                chunk_buf[i] += add[i];
+            }
+            add += chunk;
+        }
+        if (!updater_put(chunk_buf, chunk)) {
+            return false;
+        }
+        src += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+// takes the next bytes of the (inflated) input, applying them as patch when needed
+static bool updater_patch(const uint8_t *buf, uint32_t len)
+{
+    updater_delta_t *delta = &updater_data.delta;
+
+    if (!(updater_data.format & UPDATER_FORMAT_DELTA)) {
+        return updater_put(buf, len);
+    }
+
+    while (len > 0) {
+        if (delta->len > 0) {
+            // data of an INSERT or ADD op
+            uint32_t chunk = MIN(len, delta->len);
+            bool ok = (delta->op == E_UPDATER_DELTA_OP_INSERT) ? updater_put(buf, chunk) : updater_delta_copy(delta->src, chunk, buf);
+            if (!ok) {
+                return false;
+            }
+            delta->src += chunk;
+            delta->len -= chunk;
+            buf += chunk;
+            len -= chunk;
+            continue;
+        }
+
+        // collect the patch header, then the header of the next op, its first byte tells how long it is
+        uint32_t need = UPDATER_DELTA_HDR_SIZE;
+        if (delta->started) {
+            need = (delta->hdr_len == 0) ? 1 : ((delta->hdr[0] == E_UPDATER_DELTA_OP_INSERT) ? 5 : UPDATER_DELTA_OP_HDR_MAX);
+        }
+        uint32_t chunk = MIN(len, need - delta->hdr_len);
+        memcpy(&delta->hdr[delta->hdr_len], buf, chunk);
+        delta->hdr_len += chunk;
+        buf += chunk;
+        len -= chunk;
+        if (delta->started && delta->hdr[0] > E_UPDATER_DELTA_OP_ADD) {
+            ESP_LOGE(TAG, "Bad delta op\n");
+            return false;
+        }
+        if (delta->hdr_len < need || need == 1) {
+            continue;
+        }
+        delta->hdr_len = 0;
+
+        if (!delta->started) {
+            if (!updater_delta_check_source()) {
+                return false;
+            }
+            delta->started = true;
+            continue;
+        }
+
+        uint32_t op_len, src = 0;
+        delta->op = delta->hdr[0];
+        memcpy(&op_len, &delta->hdr[1], sizeof(op_len));
+        if (delta->op != E_UPDATER_DELTA_OP_INSERT) {
+            memcpy(&src, &delta->hdr[5], sizeof(src));
+            if (src > delta->source_size || op_len > delta->source_size - src) {
+                ESP_LOGE(TAG, "Delta op out of the image\n");
+                return false;
+            }
+        }
+        if (delta->op == E_UPDATER_DELTA_OP_COPY) {
+            if (!updater_delta_copy(src, op_len, NULL)) {
+                return false;
+            }
+        } else {
+            delta->src = src;
+            delta->len = op_len;
+        }
+    }
+    return true;
+}
+
+// runs the compressed input through uzlib, the decoder can't stop in the middle of a symbol
+// when the input runs out, so it is only stepped while enough input is buffered ahead of it
+static bool updater_inflate(const uint8_t *buf, uint32_t len, bool final)
+{
+    updater_inflate_t *inf = updater_data.inflate;
+    TINF_DATA *d = &inf->decomp;
+
+    do {
+        uint32_t chunk = MIN(len, UPDATER_INFLATE_IN_SIZE - inf->in_len);
+        memcpy(&inf->in[inf->in_len], buf, chunk);
+        inf->in_len += chunk;
+        buf += chunk;
+        len -= chunk;
+        bool last = final && len == 0;
+
+        d->source = inf->in;
+        d->source_limit = &inf->in[inf->in_len];
+        while (!inf->done) {
+            uint32_t avail = d->source_limit - d->source;
+            if (!last && avail < UPDATER_INFLATE_MARGIN) {
+                break;
+            }
+            if (!inf->header_done) {
+                int wbits = uzlib_zlib_parse_header(d);
+                if (wbits < 0) {
+                    ESP_LOGE(TAG, "Bad zlib header\n");
+                    return false;
+                }
+                uint32_t dict_size = 1 << (wbits + 8);
+                uint32_t caps = (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+                inf->dict = heap_caps_malloc(dict_size, caps);
+                if (!inf->dict) {
+                    ESP_LOGE(TAG, "Can't allocate %d\n", dict_size);
+                    return false;
+                }
+                uzlib_uncompress_init(d, inf->dict, dict_size);
+                inf->header_done = true;
+                continue;
+            }
+            uint32_t out_len = UPDATER_INFLATE_OUT_SIZE;
+            if (!last) {
+                out_len = MIN(out_len, (avail - UPDATER_INFLATE_MARGIN) / UPDATER_INFLATE_IN_PER_OUT + 1);
+            }
+            d->dest_start = d->dest = inf->out;
+            d->dest_limit = &inf->out[out_len];
+            int res = uzlib_uncompress_chksum(d);
+            if (res < 0 || d->eof) {
+                ESP_LOGE(TAG, "Inflate failed: %d\n", res);
+                return false;
+            }
+            if (!updater_patch(inf->out, d->dest - inf->out)) {
+                return false;
+            }
+            inf->done = (res == TINF_DONE);
+        }
+        uint32_t consumed = d->source - inf->in;
+        memmove(inf->in, d->source, inf->in_len - consumed);
+        inf->in_len -= consumed;
+    } while (len > 0);
+
+    return true;
+}
+
+static void updater_hash_start(void)
+{
+    mbedtls_sha256_init(&updater_data.sha256_context);
+    mbedtls_sha256_starts_ret(&updater_data.sha256_context, 0);
+    updater_data.tail_len = 0;
+    updater_data.hash_appended = false;
+    updater_data.digest = E_UPDATER_DIGEST_UNKNOWN;
+}
+
+static void updater_hash_update(const uint8_t *buf, uint32_t len)
+{
+    if (len >= UPDATER_DIGEST_LEN) {
+        mbedtls_sha256_update_ret(&updater_data.sha256_context, updater_data.tail, updater_data.tail_len);
+        mbedtls_sha256_update_ret(&updater_data.sha256_context, buf, len - UPDATER_DIGEST_LEN);
+        memcpy(updater_data.tail, buf + len - UPDATER_DIGEST_LEN, UPDATER_DIGEST_LEN);
+        updater_data.tail_len = UPDATER_DIGEST_LEN;
+    } else {
+        uint32_t pending = updater_data.tail_len + len;
+        if (pending > UPDATER_DIGEST_LEN) {
+            uint32_t n = pending - UPDATER_DIGEST_LEN;
+            mbedtls_sha256_update_ret(&updater_data.sha256_context, updater_data.tail, n);
+            memmove(updater_data.tail, updater_data.tail + n, updater_data.tail_len - n);
+            updater_data.tail_len -= n;
+        }
+        memcpy(updater_data.tail + updater_data.tail_len, buf, len);
+        updater_data.tail_len += len;
+    }
+}
+
+static void updater_hash_finish(void)
+{
+    uint8_t digest[UPDATER_DIGEST_LEN];
+    mbedtls_sha256_finish_ret(&updater_data.sha256_context, digest);
+    // an encrypted image can't be checked here, leave it to esp_image_verify()
+    bool plain = (updater_data.format != UPDATER_FORMAT_RAW) || !esp_flash_encryption_enabled();
+    if (updater_data.hash_appended && updater_data.tail_len == UPDATER_DIGEST_LEN && plain) {
+        updater_data.digest = memcmp(digest, updater_data.tail, UPDATER_DIGEST_LEN) ? E_UPDATER_DIGEST_INVALID : E_UPDATER_DIGEST_VALID;
+    }
+}
+
+static void updater_release(void)
+{
+    if (updater_data.sector) {
+        free(updater_data.sector);
+        updater_data.sector = NULL;
+        mbedtls_sha256_free(&updater_data.sha256_context);
+    }
+    if (updater_data.inflate) {
+        free(updater_data.inflate->dict);
+        free(updater_data.inflate);
+        updater_data.inflate = NULL;
+    }
+}
+
 /* @note Both dest_addr and size must be multiples of 16 bytes. For
  * absolute best performance, both dest_addr and size arguments should
  * be multiples of 32 bytes.
@@ -13,6 +13,11 @@
 
 #include "bootloader.h"
 
+/* formats of the data given to updater_write(), they can be combined */
+#define UPDATER_FORMAT_RAW                  (0x00)  // the image as it is written into flash
+#define UPDATER_FORMAT_ZLIB                 (0x01)  // zlib stream, inflated on the fly
+#define UPDATER_FORMAT_DELTA                (0x02)  // patch against the running image, see updater_start_format()
+
 /**
  * @brief  Checks the default path.
  *
@@ -30,6 +35,38 @@ extern bool updater_check_path(void *path);
  */
 extern bool updater_start(void);
 
+/**
+ * @brief  Initialized the OTA update process for an image sent in the given format.
+ *
+ * @note A compressed or patched image is assembled in plain text and encrypted while
+ *        written when Flash Encryption is enabled.
+ *        A delta patch is a header {"PYD1", u32 source size, u32 CRC32 of the source}
+ *        followed by ops, all integers little endian:
+ *          0 COPY   {u32 len, u32 src}          copy len bytes of the running image from src
+ *          1 INSERT {u32 len} + len bytes       insert the bytes
+ *          2 ADD    {u32 len, u32 src} + len bytes  add the bytes to the running image from src
+ *        The patch is refused unless its source matches the running image.
+ *
+ * @param  format   UPDATER_FORMAT_* flags
+ *
+ * @return true if initialization succeeded; false otherwise.
+ */
+extern bool updater_start_format(uint8_t format);
+
+
+/**
+ * @brief  Continues a raw OTA update interrupted before updater_finish().
+ *
+ * @note The written offset and a CRC32 of the data written are saved every 64KB
+ *        in the otadata partition, next to the boot info. The data already in flash is
+ *        checked against them and hashed again, then the update goes on as if it had
+ *        never stopped. When there is nothing to resume a new update is started.
+ *
+ * @param  resume_offset  [out] filled with the offset of the image to continue sending from
+ *
+ * @return true if initialization succeeded; false otherwise.
+ */
+extern bool updater_resume(uint32_t *resume_offset);
 
 /**
  * @brief  OTA Write next chunk to Flash.
@@ -37,6 +74,7 @@ extern bool updater_start(void);
  * @note The OTA process has to be previously initialized with updater_start().
  *        The buf is written as it is (not-encrypted) into Flash.
  *        If Flash Encryption is enabled, the buf must be already encrypted (by the OTA server).
+ *        The data is buffered and written in whole sectors, updater_finish() writes the remainder.
  *
  * @param  buf  buffer with the data-chunk which needs to be written into Flash
  * @param  len  length of the buf data.
@@ -45,6 +83,28 @@ extern bool updater_start(void);
  */
 extern bool updater_write(uint8_t *buf, uint32_t len);
 
+/**
+ * @brief  OTA Write next chunk to Flash, from a separate task.
+ *
+ * @note Same as updater_write(), but the data is copied into a pair of buffers
+ *        that a writer task programs into Flash, so the caller can receive the next
+ *        chunk in the meantime. It only blocks while both buffers are busy.
+ *        updater_finish() waits for everything to be written.
+ *
+ * @param  buf  buffer with the data-chunk which needs to be written into Flash
+ * @param  len  length of the buf data.
+ *
+ * @return false if a previous chunk couldn't be written into Flash.
+ */
+extern bool updater_write_async(uint8_t *buf, uint32_t len);
+
+/**
+ * @brief  Waits until the data given to updater_write_async() has been written into Flash.
+ *
+ * @return false if any of it couldn't be written.
+ */
+extern bool updater_wait(void);
+
 /**
  * @brief  Closing the OTA process. This provokes updating the boot info from the otadata partition.
  *
@@ -56,7 +116,8 @@ extern bool updater_finish(void);
  * @brief  Verifies the newly written OTA image.
  *
  * @note If Secure Boot is enabled the signature is checked.
- *          Anyway the image integrity (SHA256) is checked.
+ *          Anyway the image integrity (SHA256) is checked, using the digest
+ *          computed during the transfer when possible.
  *
  * @return true if boot info was saved successful; false otherwise.
  */
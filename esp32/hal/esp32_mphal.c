@@ -15,6 +15,7 @@
 #include "py/mphal.h"
 #include "py/runtime.h"
 #include "py/objstr.h"
+#include "py/gc.h"
 #include "py/mpstate.h"
 
 #include "esp_heap_caps.h"
@@ -23,6 +24,9 @@
 #include "esp_spi_flash.h"
 #include "nvs_flash.h"
 #include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
 
 #include "machuart.h"
 #include "telnet.h"
@@ -35,6 +39,8 @@
 #include "bootloader.h"
 #include "modwlan.h"
 #include "modbt.h"
+#include "mpsleep.h"
+#include "mpcpufreq.h"
 #include "machtimer.h"
 #include "mpirq.h"
 
@@ -50,6 +56,20 @@ DRAM_ATTR static HAL_tick_user_cb_t HAL_tick_user_cb;
 
 #endif
 
+// stdout is collected here and sent to the UART and telnet in one piece, on a
+// newline, when full, before waiting for input or MP_HAL_STDOUT_FLUSH_MS later
+#define MP_HAL_STDOUT_BUF_SIZE      256
+#define MP_HAL_STDOUT_FLUSH_MS      10
+
+// given by the drivers when one of their streams becomes ready, wakes up uselect
+static SemaphoreHandle_t mp_hal_poll_sem;
+
+static char mp_hal_stdout_buf[MP_HAL_STDOUT_BUF_SIZE];
+static uint32_t mp_hal_stdout_len;
+static SemaphoreHandle_t mp_hal_stdout_mutex;
+static TimerHandle_t mp_hal_stdout_timer;
+
+static void mp_hal_stdout_timer_callback(TimerHandle_t xTimer);
 
 #if defined (LOPY) || defined(LOPY4) || defined(FIPY)
 IRAM_ATTR static void HAL_TimerCallback (void* arg) {
@@ -72,6 +92,9 @@ void HAL_set_tick_cb (void *cb) {
 
 void mp_hal_init(bool soft_reset) {
     if (!soft_reset) {
+        mp_hal_poll_sem = xSemaphoreCreateBinary();
+        mp_hal_stdout_mutex = xSemaphoreCreateMutex();
+        mp_hal_stdout_timer = xTimerCreate("stdout", MP_HAL_STDOUT_FLUSH_MS / portTICK_PERIOD_MS, pdFALSE, 0, mp_hal_stdout_timer_callback);
     #if defined (LOPY) || defined(LOPY4) || defined(FIPY)
         // setup the HAL timer for LoRa
         HAL_tick_user_cb = NULL;
@@ -125,6 +148,8 @@ void mp_hal_delay_us(uint32_t us) {
 }
 
 int mp_hal_stdin_rx_chr(void) {
+    // the prompt and the echo must show up before waiting
+    mp_hal_stdout_flush();
     for ( ; ; ) {
         // read telnet first
         if (telnet_rx_any()) {
@@ -154,17 +179,74 @@ void mp_hal_stdout_tx_str(const char *str) {
     mp_hal_stdout_tx_strn(str, strlen(str));
 }
 
+// called with mp_hal_stdout_mutex taken
+static void mp_hal_stdout_drain(void) {
+    if (mp_hal_stdout_len > 0) {
+        mp_obj_t stream_o = MP_STATE_PORT(mp_os_stream_o);
+        if (stream_o != MP_OBJ_NULL && MP_OBJ_IS_TYPE(stream_o, &mach_uart_type)) {
+            uart_tx_strn(stream_o, mp_hal_stdout_buf, mp_hal_stdout_len);
+        }
+        // and also to telnet
+        telnet_tx_strn(mp_hal_stdout_buf, mp_hal_stdout_len);
+        mp_hal_stdout_len = 0;
+    }
+}
+
+static void mp_hal_stdout_timer_callback(TimerHandle_t xTimer) {
+    xSemaphoreTake(mp_hal_stdout_mutex, portMAX_DELAY);
+    mp_hal_stdout_drain();
+    xSemaphoreGive(mp_hal_stdout_mutex);
+}
+
+void mp_hal_stdout_flush(void) {
+    if (mp_hal_stdout_mutex != NULL) {
+        xSemaphoreTake(mp_hal_stdout_mutex, portMAX_DELAY);
+        mp_hal_stdout_drain();
+        xSemaphoreGive(mp_hal_stdout_mutex);
+    }
+}
+
 void mp_hal_stdout_tx_strn(const char *str, uint32_t len) {
-    if (MP_STATE_PORT(mp_os_stream_o) != MP_OBJ_NULL) {
-        if (MP_OBJ_IS_TYPE(MP_STATE_PORT(mp_os_stream_o), &mach_uart_type)) {
-            uart_tx_strn(MP_STATE_PORT(mp_os_stream_o), str, len);
-        } else {
-            MP_STATE_PORT(mp_os_write)[2] = mp_obj_new_str_of_type(&mp_type_str, (const byte *)str, len);
-            mp_call_method_n_kw(1, 0, MP_STATE_PORT(mp_os_write));
+    mp_obj_t stream_o = MP_STATE_PORT(mp_os_stream_o);
+    if (stream_o != MP_OBJ_NULL && !MP_OBJ_IS_TYPE(stream_o, &mach_uart_type)) {
+        // a Python stream needs the GIL, it can't be written later from the timer
+        MP_STATE_PORT(mp_os_write)[2] = mp_obj_new_str_of_type(&mp_type_str, (const byte *)str, len);
+        mp_call_method_n_kw(1, 0, MP_STATE_PORT(mp_os_write));
+        stream_o = MP_OBJ_NULL;
+    }
+
+    if (mp_hal_stdout_mutex == NULL) {
+        // too early, nothing to buffer with yet
+        if (stream_o != MP_OBJ_NULL) {
+            uart_tx_strn(stream_o, str, len);
         }
+        telnet_tx_strn(str, len);
+        return;
+    }
+
+    xSemaphoreTake(mp_hal_stdout_mutex, portMAX_DELAY);
+    bool was_empty = (mp_hal_stdout_len == 0);
+    bool newline = (memchr(str, '\n', len) != NULL);
+    while (len > 0) {
+        uint32_t n = MIN(len, MP_HAL_STDOUT_BUF_SIZE - mp_hal_stdout_len);
+        memcpy(&mp_hal_stdout_buf[mp_hal_stdout_len], str, n);
+        mp_hal_stdout_len += n;
+        str += n;
+        len -= n;
+        if (mp_hal_stdout_len == MP_HAL_STDOUT_BUF_SIZE) {
+            mp_hal_stdout_drain();
+        }
+    }
+    if (newline) {
+        mp_hal_stdout_drain();
+    }
+    bool pending = (mp_hal_stdout_len > 0);
+    xSemaphoreGive(mp_hal_stdout_mutex);
+
+    // whatever stays in the buffer goes out a bit later
+    if (pending && (was_empty || newline)) {
+        xTimerReset(mp_hal_stdout_timer, 0);
     }
-    // and also to telnet
-    telnet_tx_strn(str, len);
 }
 
 void mp_hal_stdout_tx_strn_cooked(const char *str, uint32_t len) {
@@ -212,10 +294,59 @@ IRAM_ATTR uint64_t mp_hal_ticks_us_non_blocking(void) {
     return esp_timer_get_time();
 }
 
+#if MICROPY_GC_INCREMENTAL
+// spends up to budget_ms of idle time on the sweep left behind by the last collection
+STATIC uint32_t mp_hal_idle_sweep(uint32_t budget_ms) {
+    uint64_t start = mp_hal_ticks_ms_non_blocking();
+    uint32_t used = 0;
+    while (used < budget_ms && gc_sweep_step(MICROPY_GC_SWEEP_STEP_BLOCKS)) {
+        used = mp_hal_ticks_ms_non_blocking() - start;
+    }
+    return used;
+}
+#endif
+
 void mp_hal_delay_ms(uint32_t delay) {
+    #if MICROPY_GC_INCREMENTAL
+    uint32_t used = mp_hal_idle_sweep(delay);
+    delay = (used < delay) ? (delay - used) : 0;
+    #endif
+    // still holding the GIL, no other Python thread can be running meanwhile
+    delay = mpsleep_idle(delay);
+    bool dropped = mpcpufreq_wait_begin(delay);
     MP_THREAD_GIL_EXIT();
     vTaskDelay (delay / portTICK_PERIOD_MS);
     MP_THREAD_GIL_ENTER();
+    mpcpufreq_wait_end(dropped);
+}
+
+// wait until a driver signals that one of its streams is ready, or the delay expires
+void mp_hal_poll_wait(uint32_t delay) {
+    #if MICROPY_GC_INCREMENTAL
+    // a single step, the wait has to notice the events quickly
+    gc_sweep_step(MICROPY_GC_SWEEP_STEP_BLOCKS);
+    #endif
+    bool dropped = mpcpufreq_wait_begin(delay);
+    MP_THREAD_GIL_EXIT();
+    xSemaphoreTake(mp_hal_poll_sem, delay / portTICK_PERIOD_MS);
+    MP_THREAD_GIL_ENTER();
+    mpcpufreq_wait_end(dropped);
+}
+
+// consumes the signal of a driver without waiting, true if there was one
+bool mp_hal_poll_pending(void) {
+    return xSemaphoreTake(mp_hal_poll_sem, 0) == pdTRUE;
+}
+
+IRAM_ATTR void mp_hal_poll_wakeup(void) {
+    if (mp_hal_poll_sem == NULL) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        xSemaphoreGiveFromISR(mp_hal_poll_sem, NULL);
+    } else {
+        xSemaphoreGive(mp_hal_poll_sem);
+    }
 }
 
 void mp_hal_reset_safe_and_boot(bool reset) {
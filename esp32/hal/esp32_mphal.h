@@ -20,12 +20,16 @@ int mp_hal_stdin_rx_chr(void);
 void mp_hal_stdout_tx_str(const char *str);
 void mp_hal_stdout_tx_strn(const char *str, uint32_t len);
 void mp_hal_stdout_tx_strn_cooked(const char *str, uint32_t len);
+void mp_hal_stdout_flush(void);
 uint32_t mp_hal_ticks_s(void);
 uint32_t mp_hal_ticks_ms(void);
 uint32_t mp_hal_ticks_us(void);
 uint64_t mp_hal_ticks_ms_non_blocking(void);
 uint64_t mp_hal_ticks_us_non_blocking(void);
 void mp_hal_delay_ms(uint32_t delay);
+void mp_hal_poll_wait(uint32_t delay);
+void mp_hal_poll_wakeup(void);
+bool mp_hal_poll_pending(void);
 void mp_hal_set_interrupt_char(int c);
 void mp_hal_set_reset_char(int c);
 void mp_hal_reset_safe_and_boot(bool reset);
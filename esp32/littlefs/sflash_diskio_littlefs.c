@@ -1,31 +1,70 @@
+#include <string.h>
+
 #include "ff.h" /* Needed by diskio.h */
 #include "diskio.h"
 #include "sflash_diskio.h"
 #include "sflash_diskio_littlefs.h"
+#include "mpmetrics.h"
 
 //TODO: figure out a proper value here
 #define PYCOM_CONTEXT ((void*)"pycom.io")
 
 
-char prog_buffer[SFLASH_BLOCK_SIZE] = {0};
-char read_buffer[SFLASH_BLOCK_SIZE] = {0};
+char prog_buffer[LITTLEFS_CACHE_SIZE] = {0};
+char read_buffer[LITTLEFS_CACHE_SIZE] = {0};
 // Must be on 64 bit aligned address, create it as array of 64 bit entries to achieve it
 uint64_t lookahead_buffer[SFLASH_BLOCK_COUNT_8MB/(8*8)] = {0};
+// Bumped on every program/erase, invalidates the path lookups cached by the VFS. Starts from 1 so zeroed cache entries are never valid.
+uint32_t littlefs_write_generation = 1;
+// only counted, the snapshots of the metrics registry read them
+static uint32_t littlefs_counters[5];
+
+static const mpmetrics_desc_t littlefs_metrics[] = {
+    { "reads",          E_MPMETRICS_COUNTER },
+    { "read_bytes",     E_MPMETRICS_COUNTER },
+    { "progs",          E_MPMETRICS_COUNTER },
+    { "prog_bytes",     E_MPMETRICS_COUNTER },
+    { "erases",         E_MPMETRICS_COUNTER },
+};
+
+static void littlefs_metrics_collect(uint32_t *values)
+{
+    memcpy(values, littlefs_counters, sizeof(littlefs_counters));
+}
+
+static mpmetrics_source_t littlefs_metrics_source = {
+    .name = "littlefs",
+    .metrics = littlefs_metrics,
+    .n_metrics = MP_ARRAY_SIZE(littlefs_metrics),
+    .collect = littlefs_metrics_collect,
+};
+
+void littlefs_metrics_init(void)
+{
+    mpmetrics_register(&littlefs_metrics_source);
+}
 
 int littlefs_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size)
 {
-    return sflash_disk_read_littlefs(c, buffer, block, size);
+    littlefs_counters[0]++;
+    littlefs_counters[1] += size;
+    return sflash_disk_read_littlefs(c, buffer, block, off, size);
 }
 
 
 int littlefs_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size)
 {
-    return sflash_disk_write_littlefs(c, buffer, block, size);
+    littlefs_write_generation++;
+    littlefs_counters[2]++;
+    littlefs_counters[3] += size;
+    return sflash_disk_write_littlefs(c, buffer, block, off, size);
 }
 
 
 int littlefs_erase(const struct lfs_config *c, lfs_block_t block)
 {
+    littlefs_write_generation++;
+    littlefs_counters[4]++;
     return sflash_disk_erase_littlefs(c, block);
 }
 
@@ -41,16 +80,15 @@ struct lfs_config lfscfg =
     .prog = &littlefs_prog,
     .erase = &littlefs_erase,
     .sync = &littlefs_sync,
-    .read_size = SFLASH_BLOCK_SIZE,
-    .prog_size = SFLASH_BLOCK_SIZE,
+    .read_size = LITTLEFS_READ_SIZE,
+    .prog_size = LITTLEFS_PROG_SIZE,
     .block_size = SFLASH_BLOCK_SIZE,
     .block_count = 0, // To be initialized according to the flash size of the chip
     .block_cycles = 0, // No block-level wear-leveling
-    /* Current implementation of littlefs_read/prog/erase/sync() functions only operates with
-     * full blocks, always the starting address of the block is passed to the driver.
-     * This helps on the Power-loss resilient behavior of LittleFS, with this approach the File System will not be corrupted by corruption of a single file/block
-     * E.g.: it is not possible to only read/write a middle of a block, inline files will not work, set cache_size equal to read/prog size.*/
-    .cache_size = SFLASH_BLOCK_SIZE,
+    /* Reads and programs are done at (block, off) with page granularity, so a metadata commit only programs the pages it appends
+     * and a small read only fetches the pages it needs. Power-loss resilience is unaffected: LittleFS never re-programs a page
+     * without erasing the whole block first. A cache of a full block lets sequential transfers move 4KB per flash access. */
+    .cache_size = LITTLEFS_CACHE_SIZE,
     .lookahead_size = 0, // To be initialized according to the flash size of the chip
     .prog_buffer = prog_buffer,
     .read_buffer = read_buffer,
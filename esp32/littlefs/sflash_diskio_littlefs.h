@@ -4,10 +4,24 @@
 
 #include "lfs.h"
 
+/* Geometry handed over to LittleFS, all of them can be overridden from the board config.
+ * The cache size must be a multiple of the read/prog sizes and must divide SFLASH_BLOCK_SIZE. */
+#ifndef LITTLEFS_READ_SIZE
+#define LITTLEFS_READ_SIZE      (256)   // Minimum read unit, one flash page
+#endif
+#ifndef LITTLEFS_PROG_SIZE
+#define LITTLEFS_PROG_SIZE      (256)   // Minimum program unit, one flash page
+#endif
+#ifndef LITTLEFS_CACHE_SIZE
+#define LITTLEFS_CACHE_SIZE     (SFLASH_BLOCK_SIZE) // Size of the read/prog caches and of every file cache
+#endif
+
 extern int littlefs_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size);
 extern int littlefs_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size);
 extern int littlefs_erase(const struct lfs_config *c, lfs_block_t block);
 extern int littlefs_sync(const struct lfs_config *c);
 extern struct lfs_config lfscfg;
+extern uint32_t littlefs_write_generation;
+extern void littlefs_metrics_init(void);
 
 #endif
@@ -51,44 +51,70 @@ const char* concat_with_cwd(vfs_lfs_struct_t* littlefs, const char* path)
     return (const char*)path_out;
 }
 
-static int is_valid_directory(vfs_lfs_struct_t* littlefs, const char* path)
+// Must be called with the mutex taken, path must be absolute
+static mp_import_stat_t stat_cached(vfs_lfs_struct_t* littlefs, const char* path)
 {
     struct lfs_info fi;
+    mp_import_stat_t result;
+    size_t len = strlen(path);
 
-    int r = lfs_stat(&littlefs->lfs, path, &fi);
+    if(len < LFS_STAT_CACHE_PATH_MAX)
+    {
+        for(int i = 0; i < LFS_STAT_CACHE_ENTRIES; i++)
+        {
+            lfs_stat_cache_entry_t* entry = &littlefs->stat_cache[i];
+            if(entry->generation == littlefs_write_generation && 0 == strcmp(entry->path, path))
+            {
+                return (mp_import_stat_t)entry->result;
+            }
+        }
+    }
 
-    if(LFS_ERR_OK == r)
+    /* check if path exists */
+    if(LFS_ERR_OK == lfs_stat(&littlefs->lfs, path, &fi))
     {
-        if(fi.type == LFS_TYPE_DIR) return true;
-        else return false;
+        result = (fi.type == LFS_TYPE_DIR) ? MP_IMPORT_STAT_DIR : MP_IMPORT_STAT_FILE;
     }
     else
     {
-        return false;
+        result = MP_IMPORT_STAT_NO_EXIST;
+    }
+
+    if(len < LFS_STAT_CACHE_PATH_MAX)
+    {
+        lfs_stat_cache_entry_t* entry = &littlefs->stat_cache[littlefs->stat_cache_next];
+        littlefs->stat_cache_next = (littlefs->stat_cache_next + 1) % LFS_STAT_CACHE_ENTRIES;
+        memcpy(entry->path, path, len + 1);
+        entry->result = result;
+        entry->generation = littlefs_write_generation;
     }
+
+    return result;
+}
+
+static int is_valid_directory(vfs_lfs_struct_t* littlefs, const char* path)
+{
+    return stat_cached(littlefs, path) == MP_IMPORT_STAT_DIR;
 }
 
 static mp_import_stat_t lfs_vfs_import_stat(void *self, const char *path)
 {
-    struct lfs_info lfs_info_stat;
+    mp_import_stat_t result = MP_IMPORT_STAT_NO_EXIST;
     fs_user_mount_t *vfs = (fs_user_mount_t*) self;
     assert(vfs != NULL);
-    /* check if path exists */
-    if((int)LFS_ERR_OK == lfs_stat(&(vfs->fs.littlefs.lfs), path, &lfs_info_stat))
-    {
-        if(lfs_info_stat.type == LFS_TYPE_DIR)
-        {
-            return MP_IMPORT_STAT_DIR;
-        }
-        else
+
+    xSemaphoreTake(vfs->fs.littlefs.mutex, portMAX_DELAY);
+        // import looks up the same handful of non-existent candidates (.mpy, .py, package) over and over
+        const char* abs_path = concat_with_cwd(&vfs->fs.littlefs, path);
+        if(abs_path != NULL)
         {
-            return MP_IMPORT_STAT_FILE;
+            result = stat_cached(&vfs->fs.littlefs, abs_path);
         }
-    }
-    else
-    {
-        return MP_IMPORT_STAT_NO_EXIST;
-    }
+    xSemaphoreGive(vfs->fs.littlefs.mutex);
+
+    m_free((void*)abs_path);
+
+    return result;
 }
 
 static int change_cwd(vfs_lfs_struct_t* littlefs, const char* path_in)
@@ -694,6 +720,24 @@ STATIC mp_obj_t littlefs_vfs_stat(mp_obj_t vfs_in, mp_obj_t path_param) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(littlefs_vfs_stat_obj, littlefs_vfs_stat);
 
+// Must be called with the mutex taken
+// Counting the used blocks traverses the whole file system, only do it again if the flash has been written since
+static lfs_ssize_t blocks_in_use(vfs_lfs_struct_t* littlefs)
+{
+    if(littlefs->blocks_in_use_generation != littlefs_write_generation)
+    {
+        lfs_ssize_t in_use = lfs_fs_size(&littlefs->lfs);
+        if(in_use < 0)
+        {
+            return in_use;
+        }
+        littlefs->blocks_in_use = in_use;
+        littlefs->blocks_in_use_generation = littlefs_write_generation;
+    }
+
+    return littlefs->blocks_in_use;
+}
+
 // Get the status of a VFS.
 STATIC mp_obj_t littlefs_vfs_statvfs(mp_obj_t vfs_in, mp_obj_t path_in) {
 
@@ -705,7 +749,7 @@ STATIC mp_obj_t littlefs_vfs_statvfs(mp_obj_t vfs_in, mp_obj_t path_in) {
     mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(10, NULL));
 
     xSemaphoreTake(self->fs.littlefs.mutex, portMAX_DELAY);
-        lfs_ssize_t in_use = lfs_fs_size(lfs);
+        lfs_ssize_t in_use = blocks_in_use(&self->fs.littlefs);
     xSemaphoreGive(self->fs.littlefs.mutex);
 
     if (in_use < 0) {
@@ -735,7 +779,7 @@ STATIC mp_obj_t littlefs_vfs_getfree(mp_obj_t vfs_in) {
     lfs_t* lfs = &self->fs.littlefs.lfs;
 
     xSemaphoreTake(self->fs.littlefs.mutex, portMAX_DELAY);
-        lfs_ssize_t in_use = lfs_fs_size(lfs);
+        lfs_ssize_t in_use = blocks_in_use(&self->fs.littlefs);
     xSemaphoreGive(self->fs.littlefs.mutex);
 
     if (in_use < 0) {
@@ -7,6 +7,9 @@
 
 #define LFS_ATTRIBUTE_TIMESTAMP     ((uint8_t)1)
 
+#define LFS_STAT_CACHE_ENTRIES      (16)
+#define LFS_STAT_CACHE_PATH_MAX     (48)    // Longer paths are always looked up on the flash
+
 typedef void* SemaphoreHandle_t;
 
 typedef struct pycom_lfs_file_s {
@@ -15,11 +18,23 @@ typedef struct pycom_lfs_file_s {
     bool timestamp_update;  // For requesting timestamp update when closing the file
 } pycom_lfs_file_t;
 
+// Result of a path lookup, valid until anything is programmed or erased on the flash
+typedef struct lfs_stat_cache_entry_s
+{
+    uint32_t generation; // Value of littlefs_write_generation when the entry was filled
+    uint8_t result; // mp_import_stat_t
+    char path[LFS_STAT_CACHE_PATH_MAX];
+}lfs_stat_cache_entry_t;
+
 typedef struct vfs_lfs_struct_s
 {
     lfs_t lfs;
     char* cwd; // Needs to be initialized to point to: "/\0"
     SemaphoreHandle_t mutex; // Needs to be created
+    lfs_stat_cache_entry_t stat_cache[LFS_STAT_CACHE_ENTRIES];
+    uint8_t stat_cache_next; // Entry to be replaced next
+    lfs_ssize_t blocks_in_use; // Result of the last lfs_fs_size()
+    uint32_t blocks_in_use_generation; // Value of littlefs_write_generation when blocks_in_use was counted
 }vfs_lfs_struct_t;
 
 typedef struct lfs_timestamp_attribute_s
@@ -50,7 +65,7 @@ extern lfs_timestamp_attribute_t littlefs_get_timestamp_fp(lfs_file_t* fp);
 
 
 extern const mp_obj_type_t mp_littlefs_vfs_type;
-MP_DECLARE_CONST_FUN_OBJ_3(littlefs_vfs_open_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(littlefs_vfs_open_obj);
 
 
 #endif // MICROPY_INCLUDED_VFS_LITTLEFS_H
@@ -20,6 +20,7 @@ typedef struct _pyb_file_obj_t {
     vfs_lfs_struct_t* littlefs;
     struct lfs_file_config cfg;  // Attributes of the file, e.g.: timestamp
     bool timestamp_update;  // For requesting timestamp update when closing the file
+    bool write_through;  // Opened with buffering=0, every write is synced to the flash
 } pyb_file_obj_t;
 
 STATIC void file_obj_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
@@ -51,6 +52,13 @@ STATIC mp_uint_t file_obj_write(mp_obj_t self_in, const void *buf, mp_uint_t siz
         // Request timestamp update if file has been written successfully
         if(sz_out > 0) {
             self->timestamp_update = true;
+            // Bypass the file cache, the data must be on the flash when write() returns
+            if(self->write_through) {
+                int res = lfs_file_sync(&self->littlefs->lfs, &self->fp);
+                if(res < LFS_ERR_OK) {
+                    sz_out = res;
+                }
+            }
         }
     xSemaphoreGive(self->littlefs->mutex);
 
@@ -120,9 +128,12 @@ STATIC mp_uint_t file_obj_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg,
 
 // Note: encoding is ignored for now; it's also not a valid kwarg for CPython's FileIO,
 // but by adding it here we can use one single mp_arg_t array for open() and FileIO's constructor
+// buffering=0 makes every write go straight to the flash, any other value keeps the file cache
+// of LITTLEFS_CACHE_SIZE bytes (LittleFS sizes all the file caches alike)
 STATIC const mp_arg_t file_open_args[] = {
     { MP_QSTR_file, MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
     { MP_QSTR_mode, MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_QSTR(MP_QSTR_r)} },
+    { MP_QSTR_buffering, MP_ARG_INT, {.u_int = -1} },
     { MP_QSTR_encoding, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
 };
 #define FILE_OPEN_NUM_ARGS MP_ARRAY_SIZE(file_open_args)
@@ -165,6 +176,9 @@ STATIC mp_obj_t file_open(fs_user_mount_t *vfs, const mp_obj_type_t *type, mp_ar
     pyb_file_obj_t *o = m_new_obj_with_finaliser(pyb_file_obj_t);
     o->base.type = type;
     o->timestamp_update = false;
+    o->write_through = (args[2].u_int == 0);
+    // LittleFS allocates the file cache itself
+    o->cfg.buffer = NULL;
 
     xSemaphoreTake(vfs->fs.littlefs.mutex, portMAX_DELAY);
         const char *fname = concat_with_cwd(&vfs->fs.littlefs, mp_obj_str_get_str(args[0].u_obj));
@@ -245,15 +259,15 @@ const mp_obj_type_t mp_type_vfs_lfs_textio = {
 };
 
 // Factory function for I/O stream classes
-STATIC mp_obj_t littlefs_builtin_open_self(mp_obj_t self_in, mp_obj_t path, mp_obj_t mode) {
-    // TODO: analyze buffering args and instantiate appropriate type
-    fs_user_mount_t *self = MP_OBJ_TO_PTR(self_in);
+STATIC mp_obj_t littlefs_builtin_open_self(size_t n_args, const mp_obj_t *args) {
+    fs_user_mount_t *self = MP_OBJ_TO_PTR(args[0]);
     mp_arg_val_t arg_vals[FILE_OPEN_NUM_ARGS];
-    arg_vals[0].u_obj = path;
-    arg_vals[1].u_obj = mode;
-    arg_vals[2].u_obj = mp_const_none;
+    arg_vals[0].u_obj = args[1];
+    arg_vals[1].u_obj = args[2];
+    arg_vals[2].u_int = (n_args > 3) ? mp_obj_get_int(args[3]) : -1;
+    arg_vals[3].u_obj = mp_const_none;
     return file_open(self, &mp_type_vfs_lfs_textio, arg_vals);
 }
-MP_DEFINE_CONST_FUN_OBJ_3(littlefs_vfs_open_obj, littlefs_builtin_open_self);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(littlefs_vfs_open_obj, 3, 4, littlefs_builtin_open_self);
 
 //#endif // MICROPY_VFS && MICROPY_VFS_FAT
@@ -30,8 +30,10 @@ enum {
 
     IEEE802154_BROADCAST = 0xffff,
 
+    IEEE802154_FRAME_TYPE_DATA = 1 << 0,
     IEEE802154_FRAME_TYPE_ACK = 2 << 0,
     IEEE802154_FRAME_TYPE_MACCMD = 3 << 0,
+    IEEE802154_FRAME_TYPE_AGGREGATE = 7 << 0,   // reserved by 802.15.4, marks an aggregated LoRa packet
     IEEE802154_FRAME_TYPE_MASK = 7 << 0,
 
     IEEE802154_SECURITY_ENABLED = 1 << 3,
@@ -66,6 +68,32 @@ enum {
 
 #define POSIX_MAX_SRC_MATCH_ENTRIES OPENTHREAD_CONFIG_MAX_CHILDREN
 
+// aggregated LoRa packet: [FCF = IEEE802154_FRAME_TYPE_AGGREGATE][subtype][count] followed by
+// [len][psdu] for every data frame, or by the DSN of every frame acknowledged by a block ACK
+#define AGGREGATE_HEADER_LENGTH         3
+#define AGGREGATE_SUBTYPE_DATA          0
+#define AGGREGATE_SUBTYPE_BLOCK_ACK     1
+#define AGGREGATE_FRAMES_MAX            8
+#define AGGREGATE_HOLD_MS               10      // time to wait for more frames to the same neighbour
+#define AGGREGATE_ACK_MARGIN_MS         200     // receiver turnaround, on top of the airtimes
+#define AGGREGATE_RETRIES_MAX           3
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    uint8_t frames[LORA_PAYLOAD_SIZE_MAX - AGGREGATE_HEADER_LENGTH];   // [len][psdu] of every frame held
+    uint16_t length;
+    uint8_t dsn[AGGREGATE_FRAMES_MAX];
+    uint8_t count;
+    uint8_t acked;                  // bit mask of the frames acknowledged by the neighbour
+    uint8_t dst[OT_EXT_ADDRESS_SIZE];
+    uint8_t dstLength;
+    uint8_t attempts;
+    bool inFlight;                  // sent, waiting for the block ACK
+    uint32_t deadline;              // end of the hold time, or of the block ACK timeout
+} radioAggregate_t;
+
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
@@ -93,15 +121,32 @@ static bool sSrcMatchEnabled = false;
 
 static int8_t txPower = 14; //dBm
 
+static volatile bool sRxHold = false;
+static bool sAggregationEnabled = false;
+static radioAggregate_t sAggregate;
+static uint8_t sRadioPacket[LORA_PAYLOAD_SIZE_MAX];
+static uint8_t sAggregateMessage[LORA_PAYLOAD_SIZE_MAX];
+static uint8_t sAggregateAckMessage[IEEE802154_ACK_LENGTH + 1];
+static otRadioFrame sAggregateAckFrame;
+
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
 static void radioTransmit(const struct otRadioFrame *pkt);
 static void radioSendMessage(otInstance *aInstance);
 static void radioSendAck(void);
-static void radioProcessFrame(otInstance *aInstance);
+static bool radioProcessFrame(otInstance *aInstance, bool aSendAck);
 void radioReceive(otInstance *aInstance);
 
+static bool radioAggregateCanCarry(const otRadioFrame *aFrame);
+static bool radioAggregateFits(const otRadioFrame *aFrame);
+static void radioAggregateAdd(otInstance *aInstance, otRadioFrame *aFrame);
+static void radioAggregateSend(void);
+static void radioAggregateReset(void);
+static void radioAggregateProcess(void);
+static void radioReceiveAggregate(otInstance *aInstance, const uint8_t *aPacket, uint16_t aLength);
+static void radioReceiveBlockAck(const uint8_t *aPacket, uint16_t aLength);
+
 static bool findShortAddress(uint16_t aShortAddress);
 static bool findExtAddress(const otExtAddress *aExtAddress);
 static inline bool isFrameTypeAck(const uint8_t *frame);
@@ -114,6 +159,7 @@ static inline uint8_t getDsn(const uint8_t *frame);
 static inline otPanId getDstPan(const uint8_t *frame);
 static inline otShortAddress getShortAddress(const uint8_t *frame);
 static inline void getExtAddress(const uint8_t *frame, otExtAddress *address);
+static inline uint8_t getDstAddress(const uint8_t *frame, uint8_t *address);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
@@ -130,6 +176,32 @@ void otPlatRadioInit(void) {
 
     sAckFrame.mLength = 0;
     sAckFrame.mPsdu = sAckMessage;
+
+    sAggregateAckFrame.mLength = 0;
+    sAggregateAckFrame.mPsdu = sAggregateAckMessage;
+    radioAggregateReset();
+}
+
+/**
+ * Enable/Disable the aggregation of the frames sent to the same neighbour into
+ * a single LoRa packet, acknowledged with a block ACK. It must be enabled on
+ * all the nodes of the mesh.
+ *
+ * @param[in]  aEnable  Enable/disable the aggregated frames mode.
+ */
+void otRadioSetAggregation(bool aEnable) {
+    sAggregationEnabled = aEnable;
+    radioAggregateReset();
+}
+
+/**
+ * Hold/Release the reception of frames. While held, the frames stay in the
+ * LoRa RX buffer and aren't acknowledged, so the neighbours retry them later.
+ *
+ * @param[in]  aHold  Hold/release the reception.
+ */
+void otRadioSetRxHold(bool aHold) {
+    sRxHold = aHold;
 }
 
 /**
@@ -751,6 +823,10 @@ void otRadioProcess(otInstance *aInstance) {
 
         radioReceive(aInstance);
 
+        if (sAggregationEnabled) {
+            radioAggregateProcess();
+        }
+
         if (sState == OT_RADIO_STATE_TRANSMIT && !sAckWait) {
             radioSendMessage(aInstance);
         }
@@ -919,9 +995,30 @@ static inline void getExtAddress(const uint8_t *frame, otExtAddress *address) {
     }
 }
 
+// copies the raw destination address, returns its length or 0 if there's none
+static inline uint8_t getDstAddress(const uint8_t *frame, uint8_t *address) {
+    switch (frame[1] & IEEE802154_DST_ADDR_MASK) {
+    case IEEE802154_DST_ADDR_SHORT:
+        memcpy(address, &frame[IEEE802154_DSTADDR_OFFSET], sizeof(otShortAddress));
+        return sizeof(otShortAddress);
+
+    case IEEE802154_DST_ADDR_EXT:
+        memcpy(address, &frame[IEEE802154_DSTADDR_OFFSET], sizeof(otExtAddress));
+        return sizeof(otExtAddress);
+
+    default:
+        return 0;
+    }
+}
+
 void radioReceive(otInstance *aInstance) {
     bool    isAck;
-    ssize_t rval = lora_ot_recv(sReceiveFrame.mPsdu,
+    ssize_t rval;
+
+    if (sRxHold)
+        return;
+
+    rval = lora_ot_recv(sRadioPacket, sizeof(sRadioPacket),
             &(sReceiveFrame.mInfo.mRxInfo.mRssi));
     if (rval <= 0)
         return;
@@ -936,6 +1033,22 @@ void radioReceive(otInstance *aInstance) {
     sReceiveFrame.mIeInfo->mTimestamp = otPlatTimeGet();
 #endif
 
+    if (rval >= AGGREGATE_HEADER_LENGTH && sRadioPacket[0] == IEEE802154_FRAME_TYPE_AGGREGATE) {
+        if (sAggregationEnabled) {
+            if (sRadioPacket[1] == AGGREGATE_SUBTYPE_BLOCK_ACK) {
+                radioReceiveBlockAck(sRadioPacket, rval);
+            } else if (sState == OT_RADIO_STATE_RECEIVE
+                    || sState == OT_RADIO_STATE_TRANSMIT) {
+                radioReceiveAggregate(aInstance, sRadioPacket, rval);
+            }
+        }
+        return;
+    }
+
+    if (rval > OT_RADIO_FRAME_MAX_SIZE)
+        return;
+
+    memcpy(sReceiveFrame.mPsdu, sRadioPacket, rval);
     sReceiveFrame.mLength = rval;
 
     isAck = isFrameTypeAck(sReceiveFrame.mPsdu);
@@ -952,7 +1065,7 @@ void radioReceive(otInstance *aInstance) {
             || sState == OT_RADIO_STATE_TRANSMIT)
             //&& (sReceiveFrame.mChannel == sReceiveMessage.mChannel)
             && (!isAck || sPromiscuous)) {
-        radioProcessFrame(aInstance);
+        radioProcessFrame(aInstance, true);
     }
 
 }
@@ -988,6 +1101,27 @@ void radioSendMessage(otInstance *aInstance) {
 
     //sTransmitMessage.mChannel = sTransmitFrame.mChannel;
 
+    if (sAggregationEnabled) {
+        // the frames wait while an aggregate waits for its block ACK
+        if (sAggregate.inFlight) {
+            return;
+        }
+        if (radioAggregateCanCarry(&sTransmitFrame)) {
+            if (radioAggregateFits(&sTransmitFrame)) {
+                radioAggregateAdd(aInstance, &sTransmitFrame);
+            } else {
+                // the frame goes in the next aggregate
+                radioAggregateSend();
+            }
+            return;
+        }
+        if (sAggregate.count > 0) {
+            // keep the order, send the frames held first
+            radioAggregateSend();
+            return;
+        }
+    }
+
     otPlatRadioTxStarted(aInstance, &sTransmitFrame);
     radioTransmit(&sTransmitFrame);
 
@@ -1033,8 +1167,9 @@ void radioSendAck(void) {
     radioTransmit(&sAckFrame);
 }
 
-void radioProcessFrame(otInstance *aInstance) {
+bool radioProcessFrame(otInstance *aInstance, bool aSendAck) {
     otError error = OT_ERROR_NONE;
+    bool ackRequested = false;
     otPanId dstpan;
     otShortAddress short_address;
     otExtAddress ext_address;
@@ -1073,10 +1208,13 @@ void radioProcessFrame(otInstance *aInstance) {
     //sReceiveFrame.mInfo.mRxInfo.mRssi = -20; // RSSI is already set by lora_ot_rcv function
     sReceiveFrame.mInfo.mRxInfo.mLqi = OT_RADIO_LQI_NONE;
 
-    // generate acknowledgment
+    // generate acknowledgment, the frames of an aggregate get a block ACK instead
     if (isAckRequested(sReceiveFrame.mPsdu)) {
-        otPlatLog(OT_LOG_LEVEL_DEBG, 0, "ACK TX");
-        radioSendAck();
+        ackRequested = true;
+        if (aSendAck) {
+            otPlatLog(OT_LOG_LEVEL_DEBG, 0, "ACK TX");
+            radioSendAck();
+        }
     }
 
     exit:
@@ -1094,4 +1232,157 @@ void radioProcessFrame(otInstance *aInstance) {
                     error == OT_ERROR_NONE ? &sReceiveFrame : NULL, error);
         }
     }
+    return ackRequested;
+}
+
+// unicast data frames requesting an ACK can be aggregated
+static bool radioAggregateCanCarry(const otRadioFrame *aFrame) {
+    uint8_t dst[OT_EXT_ADDRESS_SIZE];
+
+    return (aFrame->mPsdu[0] & IEEE802154_FRAME_TYPE_MASK) == IEEE802154_FRAME_TYPE_DATA
+            && isAckRequested(aFrame->mPsdu)
+            && getDstAddress(aFrame->mPsdu, dst) > 0
+            && AGGREGATE_HEADER_LENGTH + 1 + aFrame->mLength <= LORA_PAYLOAD_SIZE_MAX;
+}
+
+static bool radioAggregateFits(const otRadioFrame *aFrame) {
+    uint8_t dst[OT_EXT_ADDRESS_SIZE];
+    uint8_t dstLength = getDstAddress(aFrame->mPsdu, dst);
+
+    if (sAggregate.count == 0) {
+        return true;
+    }
+    return sAggregate.count < AGGREGATE_FRAMES_MAX
+            && AGGREGATE_HEADER_LENGTH + sAggregate.length + 1 + aFrame->mLength <= LORA_PAYLOAD_SIZE_MAX
+            && dstLength == sAggregate.dstLength
+            && memcmp(dst, sAggregate.dst, dstLength) == 0;
+}
+
+static void radioAggregateAdd(otInstance *aInstance, otRadioFrame *aFrame) {
+    otPlatRadioTxStarted(aInstance, aFrame);
+
+    if (sAggregate.count == 0) {
+        sAggregate.dstLength = getDstAddress(aFrame->mPsdu, sAggregate.dst);
+        sAggregate.deadline = otPlatAlarmMilliGetNow() + AGGREGATE_HOLD_MS;
+    }
+    sAggregate.frames[sAggregate.length++] = aFrame->mLength;
+    memcpy(&sAggregate.frames[sAggregate.length], aFrame->mPsdu, aFrame->mLength);
+    sAggregate.length += aFrame->mLength;
+    sAggregate.dsn[sAggregate.count++] = getDsn(aFrame->mPsdu);
+
+    // the block ACK and the retransmissions are handled here, so complete the
+    // transmission right away for OpenThread to hand over the next frame
+    sAggregateAckFrame.mLength = IEEE802154_ACK_LENGTH;
+    sAggregateAckFrame.mPsdu[0] = IEEE802154_FRAME_TYPE_ACK;
+    sAggregateAckFrame.mPsdu[1] = 0;
+    sAggregateAckFrame.mPsdu[2] = getDsn(aFrame->mPsdu);
+    sAggregateAckFrame.mChannel = aFrame->mChannel;
+
+    otPlatLog(OT_LOG_LEVEL_DEBG, 0, "AGG add %d", sAggregate.count);
+    sState = OT_RADIO_STATE_RECEIVE;
+    otPlatRadioTxDone(aInstance, aFrame, &sAggregateAckFrame, OT_ERROR_NONE);
+}
+
+// sends the frames held which haven't been acknowledged yet
+static void radioAggregateSend(void) {
+    uint16_t length = AGGREGATE_HEADER_LENGTH;
+    uint16_t offset = 0;
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < sAggregate.count; i++) {
+        uint8_t frameLength = sAggregate.frames[offset];
+        if (!(sAggregate.acked & (1 << i))) {
+            memcpy(&sAggregateMessage[length], &sAggregate.frames[offset], 1 + frameLength);
+            length += 1 + frameLength;
+            count++;
+        }
+        offset += 1 + frameLength;
+    }
+    sAggregateMessage[0] = IEEE802154_FRAME_TYPE_AGGREGATE;
+    sAggregateMessage[1] = AGGREGATE_SUBTYPE_DATA;
+    sAggregateMessage[2] = count;
+
+    otPlatLog(OT_LOG_LEVEL_DEBG, 0, "AGG TX %d, l=%d", count, length);
+    lora_ot_send(sAggregateMessage, length);
+
+    sAggregate.inFlight = true;
+    sAggregate.attempts++;
+    sAggregate.deadline = otPlatAlarmMilliGetNow() + lora_ot_airtime(length)
+            + lora_ot_airtime(AGGREGATE_HEADER_LENGTH + count) + AGGREGATE_ACK_MARGIN_MS;
+}
+
+static void radioAggregateReset(void) {
+    sAggregate.length = 0;
+    sAggregate.count = 0;
+    sAggregate.acked = 0;
+    sAggregate.attempts = 0;
+    sAggregate.inFlight = false;
+}
+
+// flushes the frames held once the hold time is over, retransmits on block ACK timeout
+static void radioAggregateProcess(void) {
+    if (sAggregate.count == 0 || (int32_t)(otPlatAlarmMilliGetNow() - sAggregate.deadline) < 0) {
+        return;
+    }
+    if (!sAggregate.inFlight || sAggregate.attempts <= AGGREGATE_RETRIES_MAX) {
+        radioAggregateSend();
+    } else {
+        otPlatLog(OT_LOG_LEVEL_WARN, 0, "AGG lost");
+        radioAggregateReset();
+    }
+}
+
+static void radioReceiveAggregate(otInstance *aInstance, const uint8_t *aPacket, uint16_t aLength) {
+    uint8_t blockAck[AGGREGATE_HEADER_LENGTH + AGGREGATE_FRAMES_MAX];
+    uint16_t offset = AGGREGATE_HEADER_LENGTH;
+    uint8_t acks = 0;
+
+    for (uint8_t i = 0; i < aPacket[2] && offset < aLength; i++) {
+        uint8_t frameLength = aPacket[offset++];
+        if (frameLength < IEEE802154_MIN_LENGTH || frameLength > OT_RADIO_FRAME_MAX_SIZE
+                || offset + frameLength > aLength) {
+            break;
+        }
+        memcpy(sReceiveFrame.mPsdu, &aPacket[offset], frameLength);
+        sReceiveFrame.mLength = frameLength;
+        offset += frameLength;
+
+        uint8_t dsn = getDsn(sReceiveFrame.mPsdu);
+        if (radioProcessFrame(aInstance, false) && acks < AGGREGATE_FRAMES_MAX) {
+            blockAck[AGGREGATE_HEADER_LENGTH + acks++] = dsn;
+        }
+    }
+
+    // a single block ACK for all the frames addressed to us
+    if (acks > 0) {
+        blockAck[0] = IEEE802154_FRAME_TYPE_AGGREGATE;
+        blockAck[1] = AGGREGATE_SUBTYPE_BLOCK_ACK;
+        blockAck[2] = acks;
+        otPlatLog(OT_LOG_LEVEL_DEBG, 0, "AGG ACK TX %d", acks);
+        lora_ot_send(blockAck, AGGREGATE_HEADER_LENGTH + acks);
+    }
+}
+
+static void radioReceiveBlockAck(const uint8_t *aPacket, uint16_t aLength) {
+    if (!sAggregate.inFlight) {
+        return;
+    }
+    for (uint16_t i = AGGREGATE_HEADER_LENGTH; i < aLength && i < AGGREGATE_HEADER_LENGTH + aPacket[2]; i++) {
+        for (uint8_t j = 0; j < sAggregate.count; j++) {
+            if (sAggregate.dsn[j] == aPacket[i]) {
+                sAggregate.acked |= 1 << j;
+            }
+        }
+    }
+    otPlatLog(OT_LOG_LEVEL_DEBG, 0, "AGG ACK RX 0x%x", sAggregate.acked);
+
+    if (sAggregate.acked == (1 << sAggregate.count) - 1) {
+        radioAggregateReset();
+    } else if (sAggregate.attempts <= AGGREGATE_RETRIES_MAX) {
+        // retransmit the frames missed by the neighbour
+        radioAggregateSend();
+    } else {
+        otPlatLog(OT_LOG_LEVEL_WARN, 0, "AGG lost");
+        radioAggregateReset();
+    }
 }
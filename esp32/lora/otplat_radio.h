@@ -55,4 +55,8 @@ void otPlatRadioInit(void);
 
 void otRadioProcess(otInstance *aInstance);
 
+void otRadioSetAggregation(bool aEnable);
+
+void otRadioSetRxHold(bool aHold);
+
 #endif /* LORA_OTPLAT_RADIO_H_ */
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "py/mpconfig.h"
+#include "py/mphal.h"
+#include "radiosched.h"
+
+#if defined(LOPY4)
+#include "sx1276/sx1276.h"
+#endif
+
+/******************************************************************************
+ DECLARE EXTERNAL DATA
+ ******************************************************************************/
+#if defined(FIPY) || defined(LOPY4)
+// shared with the Sigfox library, which takes it on its own
+extern SemaphoreHandle_t xLoRaSigfoxSem;
+#endif
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static portMUX_TYPE radiosched_mux = portMUX_INITIALIZER_UNLOCKED;
+static radiosched_stats_t radiosched_stats[E_RADIOSCHED_NUM_OWNERS];
+static volatile radiosched_owner_t radiosched_current = E_RADIOSCHED_NUM_OWNERS;
+static radiosched_owner_t radiosched_last = E_RADIOSCHED_NUM_OWNERS;
+static volatile uint32_t radiosched_waiting;        // one bit per owner
+static bool radiosched_dirty;                       // a foreign stack has been at the registers
+static uint32_t radiosched_switch_count;
+#if !defined(FIPY) && !defined(LOPY4)
+static bool radiosched_locked;
+#endif
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static bool radiosched_lock(TickType_t ticks) {
+#if defined(FIPY) || defined(LOPY4)
+    return xSemaphoreTake(xLoRaSigfoxSem, ticks) == pdTRUE;
+#else
+    bool locked = false;
+    portENTER_CRITICAL(&radiosched_mux);
+    if (!radiosched_locked) {
+        radiosched_locked = true;
+        locked = true;
+    }
+    portEXIT_CRITICAL(&radiosched_mux);
+    if (!locked && ticks > 0) {
+        vTaskDelay(ticks);
+    }
+    return locked;
+#endif
+}
+
+static void radiosched_unlock(void) {
+#if defined(FIPY) || defined(LOPY4)
+    xSemaphoreGive(xLoRaSigfoxSem);
+#else
+    radiosched_locked = false;
+#endif
+}
+
+static void radiosched_set_waiting(radiosched_owner_t owner, bool waiting) {
+    portENTER_CRITICAL(&radiosched_mux);
+    if (waiting) {
+        radiosched_waiting |= 1 << owner;
+    } else {
+        radiosched_waiting &= ~(1 << owner);
+    }
+    portEXIT_CRITICAL(&radiosched_mux);
+}
+
+// a waiting owner that comes before in the precedence order
+static bool radiosched_outranked(radiosched_owner_t owner) {
+    return (radiosched_waiting & ((1 << owner) - 1)) != 0;
+}
+
+static void radiosched_invalidate(void) {
+#if defined(LOPY4)
+    SX1276ShadowInvalidate();
+#endif
+}
+
+static void radiosched_grant(radiosched_owner_t owner, uint32_t waited_ms) {
+    radiosched_stats_t *stats = &radiosched_stats[owner];
+    radiosched_current = owner;
+    stats->grants++;
+    if (waited_ms > stats->wait_max_ms) {
+        stats->wait_max_ms = waited_ms;
+    }
+    if (owner != radiosched_last) {
+        radiosched_last = owner;
+        radiosched_switch_count++;
+    }
+    if (radiosched_dirty) {
+        // whatever it left behind, the next configuration goes out in full
+        radiosched_dirty = false;
+        radiosched_invalidate();
+    }
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+bool radiosched_take(radiosched_owner_t owner, uint32_t deadline_ms) {
+    uint32_t start = mp_hal_ticks_ms();
+
+    radiosched_set_waiting(owner, true);
+    for ( ; ; ) {
+        if (radiosched_outranked(owner)) {
+            vTaskDelay(RADIOSCHED_SLICE_MS / portTICK_PERIOD_MS);
+        } else if (radiosched_lock(RADIOSCHED_SLICE_MS / portTICK_PERIOD_MS)) {
+            break;
+        }
+        if (radiosched_expired(deadline_ms)) {
+            radiosched_set_waiting(owner, false);
+            radiosched_stats[owner].missed++;
+            return false;
+        }
+    }
+    radiosched_set_waiting(owner, false);
+    radiosched_grant(owner, mp_hal_ticks_ms() - start);
+    return true;
+}
+
+radiosched_result_t radiosched_try(radiosched_owner_t owner, uint32_t deadline_ms) {
+    if (radiosched_expired(deadline_ms)) {
+        radiosched_stats[owner].missed++;
+        return E_RADIOSCHED_MISSED;
+    }
+    if (radiosched_outranked(owner) || !radiosched_lock(0)) {
+        radiosched_stats[owner].busy++;
+        return E_RADIOSCHED_BUSY;
+    }
+    radiosched_grant(owner, 0);
+    return E_RADIOSCHED_GRANTED;
+}
+
+void radiosched_give(radiosched_owner_t owner, uint32_t airtime_ms) {
+    if (owner >= E_RADIOSCHED_NUM_OWNERS || radiosched_current != owner) {
+        return;
+    }
+    radiosched_stats[owner].airtime_ms += airtime_ms;
+    radiosched_current = E_RADIOSCHED_NUM_OWNERS;
+    radiosched_unlock();
+}
+
+void radiosched_foreign(radiosched_owner_t owner, uint32_t airtime_ms) {
+    radiosched_stats_t *stats = &radiosched_stats[owner];
+    stats->grants++;
+    stats->airtime_ms += airtime_ms;
+    if (owner != radiosched_last) {
+        radiosched_last = owner;
+        radiosched_switch_count++;
+    }
+    // it may still be at it after returning (e.g. a downlink window), so once more on the next take
+    radiosched_dirty = true;
+    radiosched_invalidate();
+}
+
+radiosched_owner_t radiosched_holder(void) {
+    return radiosched_current;
+}
+
+bool radiosched_expired(uint32_t deadline_ms) {
+    return deadline_ms != RADIOSCHED_NO_DEADLINE && (int32_t)(mp_hal_ticks_ms() - deadline_ms) >= 0;
+}
+
+void radiosched_get_stats(radiosched_owner_t owner, radiosched_stats_t *stats, bool reset) {
+    if (owner < E_RADIOSCHED_NUM_OWNERS) {
+        *stats = radiosched_stats[owner];
+        if (reset) {
+            memset(&radiosched_stats[owner], 0, sizeof(radiosched_stats_t));
+        }
+    }
+}
+
+uint32_t radiosched_switches(void) {
+    return radiosched_switch_count;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef ESP32_LORA_RADIOSCHED_H_
+#define ESP32_LORA_RADIOSCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define RADIOSCHED_NO_DEADLINE                  (0)
+#define RADIOSCHED_SLICE_MS                     (10)        // granularity of a blocking take
+#define RADIOSCHED_MESH_DEADLINE_MS             (250)       // the mesh retries on its own, a late frame is useless
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// in order of precedence, a waiting owner blocks the ones after it
+typedef enum {
+    E_RADIOSCHED_LORAWAN = 0,
+    E_RADIOSCHED_SIGFOX,
+    E_RADIOSCHED_MESH,
+    E_RADIOSCHED_LORA,                      // raw LoRa and FSK
+    E_RADIOSCHED_NUM_OWNERS
+} radiosched_owner_t;
+
+typedef enum {
+    E_RADIOSCHED_GRANTED = 0,
+    E_RADIOSCHED_BUSY,
+    E_RADIOSCHED_MISSED,
+} radiosched_result_t;
+
+typedef struct {
+    uint32_t            grants;
+    uint32_t            busy;               // try() refused, radio held or a higher owner waiting
+    uint32_t            missed;             // gave up at the deadline
+    uint32_t            airtime_ms;
+    uint32_t            wait_max_ms;
+} radiosched_stats_t;
+
+/******************************************************************************
+ DECLARE PUBLIC FUNCTIONS
+ ******************************************************************************/
+// deadline_ms is on the mp_hal_ticks_ms() clock, false if it passed before the radio was free
+extern bool radiosched_take(radiosched_owner_t owner, uint32_t deadline_ms);
+// never blocks, a frame that gets E_RADIOSCHED_MISSED is to be dropped
+extern radiosched_result_t radiosched_try(radiosched_owner_t owner, uint32_t deadline_ms);
+// a no-op unless owner holds the radio
+extern void radiosched_give(radiosched_owner_t owner, uint32_t airtime_ms);
+// the radio was used by a stack that does its own locking, forget what it was set to
+extern void radiosched_foreign(radiosched_owner_t owner, uint32_t airtime_ms);
+// E_RADIOSCHED_NUM_OWNERS when free
+extern radiosched_owner_t radiosched_holder(void);
+extern bool radiosched_expired(uint32_t deadline_ms);
+extern void radiosched_get_stats(radiosched_owner_t owner, radiosched_stats_t *stats, bool reset);
+extern uint32_t radiosched_switches(void);
+
+#endif /* ESP32_LORA_RADIOSCHED_H_ */
@@ -179,6 +179,60 @@ IRAM_ATTR uint16_t SpiInOut(Spi_t *obj, uint16_t outData) {
     // read data out
     return READ_PERI_REG(SPI_W0_REG(spiNum));
 }
+
+/*!
+ * \brief Sends addr followed by size bytes and receives as many
+ *
+ * The bytes go through all of W0..W15 per transaction, so a full FIFO takes
+ * 5 transactions instead of 256. The chip select stays with the caller.
+ *
+ * \param [IN]  obj     SPI object
+ * \param [IN]  addr    Byte sent first, whatever comes back for it is dropped
+ * \param [IN]  outData Bytes to be sent, zeros when NULL
+ * \param [OUT] inData  Received bytes, discarded when NULL
+ * \param [IN]  size    Number of bytes after addr
+ */
+IRAM_ATTR void SpiInOutBurst(Spi_t *obj, uint8_t addr, const uint8_t *outData, uint8_t *inData, uint16_t size) {
+    uint32_t spiNum = (uint32_t)obj->Spi;
+    uint32_t words[SPI_BURST_MAX_LEN / 4];
+    uint8_t *bytes = (uint8_t *)words;
+    uint32_t head = 1;
+    bytes[0] = addr;
+
+    for (uint32_t pos = 0; head || pos < size; head = 0) {
+        uint32_t chunk = size - pos;
+        if (chunk > SPI_BURST_MAX_LEN - head) {
+            chunk = SPI_BURST_MAX_LEN - head;
+        }
+        uint32_t len = head + chunk;
+        for (uint32_t i = 0; i < chunk; i++) {
+            bytes[head + i] = outData ? outData[pos + i] : 0;
+        }
+
+        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(spiNum), SPI_USR_MOSI_DBITLEN, len * 8 - 1, SPI_USR_MOSI_DBITLEN_S);
+        SET_PERI_REG_BITS(SPI_MISO_DLEN_REG(spiNum), SPI_USR_MISO_DBITLEN, len * 8 - 1, SPI_USR_MISO_DBITLEN_S);
+        // the first byte on the wire is the lowest one of W0
+        for (uint32_t i = 0; i < (len + 3) / 4; i++) {
+            WRITE_PERI_REG(SPI_W0_REG(spiNum) + i * 4, words[i]);
+        }
+        SET_PERI_REG_MASK(SPI_CMD_REG(spiNum), SPI_USR);
+        while (READ_PERI_REG(SPI_CMD_REG(spiNum)) & SPI_USR);
+
+        if (inData) {
+            for (uint32_t i = 0; i < (len + 3) / 4; i++) {
+                words[i] = READ_PERI_REG(SPI_W0_REG(spiNum) + i * 4);
+            }
+            for (uint32_t i = 0; i < chunk; i++) {
+                inData[pos + i] = bytes[head + i];
+            }
+        }
+        pos += chunk;
+    }
+
+    // SpiInOut expects single byte transactions
+    SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(spiNum), SPI_USR_MOSI_DBITLEN, 7, SPI_USR_MOSI_DBITLEN_S);
+    SET_PERI_REG_BITS(SPI_MISO_DLEN_REG(spiNum), SPI_USR_MISO_DBITLEN, 7, SPI_USR_MISO_DBITLEN_S);
+}
 #elif defined(SIPY)
 IRAM_ATTR uint8_t SpiInOut(uint32_t spiNum, uint32_t outData) {
     // set data send buffer length (1 byte)
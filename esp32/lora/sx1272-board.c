@@ -52,7 +52,9 @@ DRAM_ATTR const struct Radio_s Radio =
     SX1272ReadBuffer,
     SX1272SetMaxPayloadLength,
     SX1272SetPublicNetwork,
-    SX1272Reset
+    SX1272Reset,
+    SX1272ArmTx,
+    SX1272FireTx
 };
 
 /*!
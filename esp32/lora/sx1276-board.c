@@ -50,7 +50,10 @@ DRAM_ATTR const struct Radio_s Radio =
     SX1276WriteBuffer,
     SX1276ReadBuffer,
     SX1276SetMaxPayloadLength,
-    SX1276SetPublicNetwork
+    SX1276SetPublicNetwork,
+    NULL,                   // Reset
+    SX1276ArmTx,
+    SX1276FireTx
 };
 
 /*!
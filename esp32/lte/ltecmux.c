@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <string.h>
+
+#include "ltecmux.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define LTECMUX_FCS_INIT                                                (0xFF)
+#define LTECMUX_FCS_GOOD                                                (0xCF)      // remainder over the covered octets plus the FCS
+
+#define LTECMUX_EA                                                      (0x01)
+#define LTECMUX_CR                                                      (0x02)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    E_LTECMUX_RX_HUNT = 0,
+    E_LTECMUX_RX_ADDRESS,
+    E_LTECMUX_RX_CONTROL,
+    E_LTECMUX_RX_LENGTH,
+    E_LTECMUX_RX_LENGTH2,
+    E_LTECMUX_RX_INFO,
+    E_LTECMUX_RX_FCS,
+    E_LTECMUX_RX_CLOSE
+} ltecmux_rx_state_t;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// CRC-8 of TS 27.010 (x^8 + x^2 + x + 1), processed LSB first
+static uint8_t ltecmux_fcs_update (uint8_t fcs, uint8_t octet) {
+    fcs ^= octet;
+    for (int i = 0; i < 8; i++) {
+        fcs = (fcs & 0x01) ? ((fcs >> 1) ^ 0xE0) : (fcs >> 1);
+    }
+    return fcs;
+}
+
+// the information field is only covered in the frames other than UIH
+static bool ltecmux_fcs_covers_info (uint8_t control) {
+    return (control & ~LTECMUX_PF) != LTECMUX_UIH;
+}
+
+static uint8_t ltecmux_rx_after_length (const ltecmux_rx_t *rx) {
+    if (rx->len > rx->n1) {
+        // can't be ours, look for the next frame
+        return E_LTECMUX_RX_HUNT;
+    }
+    return (rx->len > 0) ? E_LTECMUX_RX_INFO : E_LTECMUX_RX_FCS;
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+size_t ltecmux_frame (uint8_t *out, uint8_t dlci, uint8_t control, const uint8_t *info, uint16_t len) {
+    uint8_t fcs = LTECMUX_FCS_INIT;
+    size_t n = 0;
+
+    out[n++] = LTECMUX_FLAG;
+    out[n++] = (dlci << 2) | LTECMUX_CR | LTECMUX_EA;
+    out[n++] = control;
+    if (len > 127) {
+        out[n++] = (len & 0x7F) << 1;
+        out[n++] = len >> 7;
+    } else {
+        out[n++] = (len << 1) | LTECMUX_EA;
+    }
+    for (size_t i = 1; i < n; i++) {
+        fcs = ltecmux_fcs_update(fcs, out[i]);
+    }
+    if (len > 0) {
+        memcpy(&out[n], info, len);
+        if (ltecmux_fcs_covers_info(control)) {
+            for (uint16_t i = 0; i < len; i++) {
+                fcs = ltecmux_fcs_update(fcs, info[i]);
+            }
+        }
+        n += len;
+    }
+    out[n++] = 0xFF - fcs;
+    out[n++] = LTECMUX_FLAG;
+    return n;
+}
+
+void ltecmux_rx_init (ltecmux_rx_t *rx, uint16_t n1) {
+    rx->state = E_LTECMUX_RX_HUNT;
+    rx->n1 = (n1 > LTECMUX_N1_MAX) ? LTECMUX_N1_MAX : n1;
+}
+
+void ltecmux_input (ltecmux_rx_t *rx, const uint8_t *data, size_t len, ltecmux_frame_cb_t cb, void *arg) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t octet = data[i];
+
+        switch (rx->state) {
+        case E_LTECMUX_RX_HUNT:
+            if (octet == LTECMUX_FLAG) {
+                rx->state = E_LTECMUX_RX_ADDRESS;
+            }
+            break;
+        case E_LTECMUX_RX_ADDRESS:
+            // repeated flags between frames
+            if (octet == LTECMUX_FLAG) {
+                break;
+            }
+            if (!(octet & LTECMUX_EA)) {
+                rx->state = E_LTECMUX_RX_HUNT;
+                break;
+            }
+            rx->address = octet;
+            rx->fcs = ltecmux_fcs_update(LTECMUX_FCS_INIT, octet);
+            rx->state = E_LTECMUX_RX_CONTROL;
+            break;
+        case E_LTECMUX_RX_CONTROL:
+            rx->control = octet;
+            rx->fcs = ltecmux_fcs_update(rx->fcs, octet);
+            rx->state = E_LTECMUX_RX_LENGTH;
+            break;
+        case E_LTECMUX_RX_LENGTH:
+            rx->fcs = ltecmux_fcs_update(rx->fcs, octet);
+            rx->len = octet >> 1;
+            rx->pos = 0;
+            if (!(octet & LTECMUX_EA)) {
+                rx->state = E_LTECMUX_RX_LENGTH2;
+            } else {
+                rx->state = ltecmux_rx_after_length(rx);
+            }
+            break;
+        case E_LTECMUX_RX_LENGTH2:
+            rx->fcs = ltecmux_fcs_update(rx->fcs, octet);
+            rx->len |= (uint16_t)octet << 7;
+            rx->state = ltecmux_rx_after_length(rx);
+            break;
+        case E_LTECMUX_RX_INFO:
+            rx->info[rx->pos++] = octet;
+            if (ltecmux_fcs_covers_info(rx->control)) {
+                rx->fcs = ltecmux_fcs_update(rx->fcs, octet);
+            }
+            if (rx->pos == rx->len) {
+                rx->state = E_LTECMUX_RX_FCS;
+            }
+            break;
+        case E_LTECMUX_RX_FCS:
+            rx->fcs = ltecmux_fcs_update(rx->fcs, octet);
+            rx->state = E_LTECMUX_RX_CLOSE;
+            break;
+        case E_LTECMUX_RX_CLOSE:
+            if (octet == LTECMUX_FLAG) {
+                if (rx->fcs == LTECMUX_FCS_GOOD) {
+                    cb(arg, rx->address >> 2, rx->control & ~LTECMUX_PF, rx->info, rx->len);
+                }
+                // the closing flag may open the next frame as well
+                rx->state = E_LTECMUX_RX_ADDRESS;
+            } else {
+                rx->state = E_LTECMUX_RX_HUNT;
+            }
+            break;
+        default:
+            rx->state = E_LTECMUX_RX_HUNT;
+            break;
+        }
+    }
+}
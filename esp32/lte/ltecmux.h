@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef _LTECMUX_H_
+#define _LTECMUX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// 3GPP TS 27.010 basic option frames: F9 | address | control | length | info | FCS | F9
+#define LTECMUX_FLAG                                                    (0xF9)
+#define LTECMUX_N1_DEFAULT                                              (31)        // what the modem uses when AT+CMUX doesn't say
+#define LTECMUX_N1_MAX                                                  (1024)
+#define LTECMUX_OVERHEAD                                                (7)         // both flags, address, control, 2 length octets and FCS
+#define LTECMUX_FRAME_SIZE_MAX                                          (LTECMUX_N1_MAX + LTECMUX_OVERHEAD)
+
+#define LTECMUX_DLCI_CONTROL                                            (0)
+
+// control field, PF is the poll/final bit
+#define LTECMUX_SABM                                                    (0x2F)
+#define LTECMUX_UA                                                      (0x63)
+#define LTECMUX_DM                                                      (0x0F)
+#define LTECMUX_DISC                                                    (0x43)
+#define LTECMUX_UIH                                                     (0xEF)
+#define LTECMUX_UI                                                      (0x03)
+#define LTECMUX_PF                                                      (0x10)
+
+// type octets of the control channel messages, with EA set and C/R clear
+#define LTECMUX_MSG_CR                                                  (0x02)
+#define LTECMUX_MSG_CLD                                                 (0xC1)
+#define LTECMUX_MSG_MSC                                                 (0xE1)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// called with every frame that passed the FCS check, the control field comes without PF
+typedef void (*ltecmux_frame_cb_t) (void *arg, uint8_t dlci, uint8_t control, const uint8_t *info, uint16_t len);
+
+typedef struct {
+    uint8_t     state;
+    uint8_t     address;
+    uint8_t     control;
+    uint8_t     fcs;
+    uint16_t    len;
+    uint16_t    pos;
+    uint16_t    n1;
+    uint8_t     info[LTECMUX_N1_MAX];
+} ltecmux_rx_t;
+
+/******************************************************************************
+ DECLARE PUBLIC FUNCTIONS
+ ******************************************************************************/
+// builds one frame sent as a command by the initiator, returns its length
+extern size_t ltecmux_frame (uint8_t *out, uint8_t dlci, uint8_t control, const uint8_t *info, uint16_t len);
+
+extern void ltecmux_rx_init (ltecmux_rx_t *rx, uint16_t n1);
+
+// feeds the bytes from the UART, anything outside a valid frame is dropped
+extern void ltecmux_input (ltecmux_rx_t *rx, const uint8_t *data, size_t len, ltecmux_frame_cb_t cb, void *arg);
+
+#endif  // _LTECMUX_H_
@@ -7,11 +7,15 @@
  * available at https://www.pycom.io/opensource/licensing
  */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>
 #include "py/mpconfig.h"
 #include "py/obj.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/ringbuf.h"
 #include "esp_system.h"
 #include "esp_log.h"
 
@@ -24,23 +28,38 @@
 
 #include "machpin.h"
 #include "lteppp.h"
+#include "ltecmux.h"
+#include "netfailover.h"
+#include "spscring.h"
 #include "pins.h"
 #include "mpsleep.h"
 #include "esp32_mphal.h"
 #include "lwip/dns.h"
 #include "modlte.h"
+#include "mptaskmon.h"
 
 /******************************************************************************
  DEFINE CONSTANTS
  ******************************************************************************/
 
-#define LTE_TRX_WAIT_MS(len)                                    (((len + 1) * 12 * 1000) / MICROPY_LTE_UART_BAUDRATE)
+#define LTE_TRX_WAIT_MS(len)                                    (((len + 1) * 12 * 1000) / lteppp_baudrate)
 #define LTE_TASK_PERIOD_MS                                      (2)
+#define LTE_HEALTH_DEADLINE_MS                                  (3 * LTE_RX_TIMEOUT_MAX_MS)     // the modem init sends several slow commands
 #define LTE_AT_CMD_TRIALS                                       (5)
+#define LTE_BAUDRATE_SETTLE_MS                                  (20)
+#define LTE_CMUX_DLCI_AT                                        (1)
+#define LTE_CMUX_DLCI_DATA                                      (2)
+#define LTE_CMUX_UA_TIMEOUT_MS                                  (1000)
 
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
+typedef struct {
+    const char              *prefix;
+    lteppp_urc_handler_t    handler;
+    void                    *arg;
+} lteppp_urc_t;
+
 typedef enum
 {
     LTE_PPP_IDLE = 0,
@@ -56,11 +75,11 @@ SemaphoreHandle_t xLTE_modem_Conn_Sem;
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
-static char lteppp_trx_buffer[LTE_UART_BUFFER_SIZE + 1];
+static char lteppp_trx_buffer[sizeof(lte_task_rsp_data_t)];
 #ifdef LTE_DEBUG_BUFF
 static lte_log_t lteppp_log;
 #endif
-static char lteppp_queue_buffer[LTE_UART_BUFFER_SIZE];
+static RingbufHandle_t lteppp_suspend_ring;    // frames held while the modem is out of data mode
 static uart_dev_t* lteppp_uart_reg;
 static QueueHandle_t xCmdQueue;
 static QueueHandle_t xRxQueue;
@@ -71,6 +90,7 @@ static ppp_pcb *lteppp_pcb;         // PPP control block
 struct netif lteppp_netif;          // PPP net interface
 
 static uint32_t lte_ipv4addr;
+static uint32_t lte_up_ticks;       // mp_hal_ticks_ms() when the IP address was assigned
 static uint32_t lte_gw;
 static uint32_t lte_netmask;
 static ip6_addr_t lte_ipv6addr;
@@ -87,6 +107,41 @@ static QueueHandle_t uart0_queue;
 
 static bool lte_uart_break_evt = false;
 
+static bool lteppp_attach_watch = false;    // the LTE task reports when the attachment completes
+static bool lteppp_bg_paused = false;       // the MicroPython thread reads the UART itself
+static lte_link_stats_t lteppp_link_stats = { .rssi = LTE_STATS_UNKNOWN, .rsrp = LTE_STATS_UNKNOWN, .rsrq = LTE_STATS_UNKNOWN };
+
+// first EARFCN of every band the modem can scan, in ascending order
+static const struct {
+    uint32_t    earfcn;
+    uint16_t    band;
+} lteppp_bands[] = {
+    { 0, 1 }, { 600, 2 }, { 1200, 3 }, { 1950, 4 }, { 2400, 5 }, { 3450, 8 }, { 5010, 12 }, { 5180, 13 }, { 5280, 14 },
+    { 5730, 17 }, { 5850, 18 }, { 6000, 19 }, { 6150, 20 }, { 8040, 25 }, { 8690, 26 }, { 9210, 28 }, { 66436, 66 }
+};
+
+static uint32_t lteppp_baudrate = MICROPY_LTE_UART_BAUDRATE;
+
+static lteppp_urc_t lteppp_urcs[LTE_URC_HANDLERS_MAX];
+static char lteppp_at_pending[16];  // name of the command waiting for its response, e.g. "+CEREG"
+
+// 27.010 multiplexer, the AT commands go on one channel while PPP keeps the other
+static bool lteppp_cmux_wanted = false;         // restarted by the LTE task after the modem reset
+static volatile bool lteppp_cmux_on = false;
+static bool lteppp_cmux_data_online = false;    // the data channel is in data mode
+static bool lteppp_cmux_data_cmd = false;       // a command is waiting for its response on the data channel
+static uint8_t lteppp_cmux_ua;                  // channels the modem opened, by DLCI
+static uint16_t lteppp_cmux_n1 = LTECMUX_N1_DEFAULT;
+static ltecmux_rx_t lteppp_cmux_rx;
+static spsc_ring_t lteppp_cmux_at_ring;         // what the modem sent on the AT channel, for the LTE task
+static uint8_t lteppp_cmux_at_storage[LTE_UART_BUFFER_SIZE];
+static uint8_t lteppp_cmux_at_frame[LTE_AT_CMD_SIZE_MAX + LTECMUX_OVERHEAD];    // only used by the LTE task
+static uint8_t lteppp_cmux_ppp_frame[LTECMUX_FRAME_SIZE_MAX];                   // only used by the tcpip thread
+static uint8_t lteppp_cmux_chunk[256];
+
+// rates offered to the modem with AT+IPR, fastest first
+static const uint32_t lteppp_baudrates[] = { 3686400, 1843200, 921600 };
+
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
@@ -97,6 +152,29 @@ static bool lteppp_send_at_cmd(const char *cmd, uint32_t timeout);
 static bool lteppp_check_sim_present(void);
 static void lteppp_status_cb (ppp_pcb *pcb, int err_code, void *ctx);
 static uint32_t lteppp_output_callback(ppp_pcb *pcb, u8_t *data, u32_t len, void *ctx);
+static void lteppp_suspend_ring_flush (bool send);
+static void lteppp_at_set_pending (const char *cmd);
+static bool lteppp_at_is_final (const char *line, size_t len);
+static bool lteppp_at_rsp_complete (const char *buf, size_t len);
+static const lteppp_urc_t *lteppp_urc_find (const char *line, size_t len);
+static void lteppp_urc_call (const lteppp_urc_t *urc, const char *line, size_t len);
+static uint16_t lteppp_at_filter_urcs (char *buf, uint16_t len, uint16_t *offset);
+static void lteppp_at_drain (void);
+static uint32_t lteppp_at_rx_len (void);
+static int lteppp_at_read (uint8_t *buf, uint32_t len, TickType_t wait);
+static void lteppp_at_write (const char *cmd, size_t len, bool data_channel);
+static int lteppp_ppp_write (const uint8_t *data, size_t len);
+static void lteppp_cmux_frame_cb (void *arg, uint8_t dlci, uint8_t control, const uint8_t *info, uint16_t len);
+static void lteppp_cmux_pump (TickType_t wait);
+static bool lteppp_cmux_open (uint8_t dlci);
+static bool lteppp_cmux_start (void);
+static void lteppp_cmux_stop (bool close);
+static bool lteppp_cmux_is_data_cmd (const char *cmd);
+static void lteppp_poll_attach (void);
+static void lteppp_sample_link (void);
+static void lteppp_apply_baudrate (uint32_t baudrate);
+static bool lteppp_sync_baudrate (void);
+static void lteppp_negotiate_baudrate (void);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
@@ -106,7 +184,7 @@ void connect_lte_uart (void) {
 
     // initialize the UART interface
     uart_config_t config;
-    config.baud_rate = MICROPY_LTE_UART_BAUDRATE;
+    config.baud_rate = lteppp_baudrate;
     config.data_bits = UART_DATA_8_BITS;
     config.parity = UART_PARITY_DISABLE;
     config.stop_bits = UART_STOP_BITS_1;
@@ -126,7 +204,7 @@ void connect_lte_uart (void) {
     uart_set_hw_flow_ctrl(LTE_UART_ID, UART_HW_FLOWCTRL_DISABLE, 0);
 
     // install the UART driver
-    uart_driver_install(LTE_UART_ID, LTE_UART_BUFFER_SIZE, LTE_UART_BUFFER_SIZE, 1, &uart0_queue, 0, NULL);
+    uart_driver_install(LTE_UART_ID, LTE_UART_RX_RING_SIZE, LTE_UART_TX_RING_SIZE, 1, &uart0_queue, 0, NULL);
     lteppp_uart_reg = &UART2;
 
     // disable the delay between transfers
@@ -145,7 +223,8 @@ void lteppp_init(void) {
     lteppp_lte_state = E_LTE_INIT;
 
     xCmdQueue = xQueueCreate(LTE_CMD_QUEUE_SIZE_MAX, sizeof(lte_task_cmd_data_t));
-    xRxQueue = xQueueCreate(LTE_RSP_QUEUE_SIZE_MAX, LTE_AT_RSP_SIZE_MAX + 1);
+    xRxQueue = xQueueCreate(LTE_RSP_QUEUE_SIZE_MAX, sizeof(lte_task_rsp_data_t));
+    lteppp_suspend_ring = xRingbufferCreate(LTE_UART_TX_RING_SIZE, RINGBUF_TYPE_BYTEBUF);
 
     xLTESem = xSemaphoreCreateMutex();
     xLTE_modem_Conn_Sem = xSemaphoreCreateMutex();
@@ -209,6 +288,10 @@ void lteppp_set_default_inf(void)
     dns_setserver(1, &(ltepp_dns_info[1]));
 }
 
+struct netif *lteppp_get_netif(void) {
+    return &lteppp_netif;
+}
+
 void lteppp_set_legacy(lte_legacy_t legacy) {
     xSemaphoreTake(xLTESem, portMAX_DELAY);
     lteppp_lte_legacy = legacy;
@@ -216,19 +299,25 @@ void lteppp_set_legacy(lte_legacy_t legacy) {
 }
 
 void lteppp_connect (void) {
-    uart_flush(LTE_UART_ID);
+    if (!lteppp_cmux_on) {
+        uart_flush(LTE_UART_ID);
+    }
     vTaskDelay(25);
     pppapi_set_default(lteppp_pcb);
     ppp_set_usepeerdns(lteppp_pcb, 1);
     pppapi_set_auth(lteppp_pcb, PPPAUTHTYPE_PAP, "", "");
     pppapi_connect(lteppp_pcb, 0);
     lteppp_connstatus = LTE_PPP_IDLE;
+    lteppp_suspend_ring_flush(false);
 }
 
 void lteppp_disconnect(void) {
     pppapi_close(lteppp_pcb, 0);
     vTaskDelay(150);
+    // the ATH that follows takes the data channel back to command mode
+    lteppp_cmux_data_online = false;
     lteppp_connstatus = LTE_PPP_IDLE;
+    lteppp_suspend_ring_flush(false);
 }
 
 void lteppp_send_at_command (lte_task_cmd_data_t *cmd, lte_task_rsp_data_t *rsp) {
@@ -236,10 +325,27 @@ void lteppp_send_at_command (lte_task_cmd_data_t *cmd, lte_task_rsp_data_t *rsp)
     xQueueReceive(xRxQueue, rsp, (TickType_t)portMAX_DELAY);
 }
 
+bool lteppp_register_urc (const char *prefix, lteppp_urc_handler_t handler, void *arg) {
+    for (int i = 0; i < LTE_URC_HANDLERS_MAX; i++) {
+        if (lteppp_urcs[i].prefix == NULL || !strcmp(lteppp_urcs[i].prefix, prefix)) {
+            lteppp_urcs[i].handler = handler;
+            lteppp_urcs[i].arg = arg;
+            lteppp_urcs[i].prefix = prefix;
+            return true;
+        }
+    }
+    return false;
+}
+
 bool lteppp_wait_at_rsp (const char *expected_rsp, uint32_t timeout, bool from_mp, void* data_rem) {
 
     uint32_t rx_len = 0;
     uint32_t timeout_cnt = timeout;
+    uint16_t line_offset = 0;
+    // only used after a restart of the modem, which also ends the multiplexer
+    if (from_mp && lteppp_cmux_on) {
+        lteppp_cmux_stop(false);
+    }
     // wait until characters start arriving
     do {
         // being called from the MicroPython interpreter
@@ -249,7 +355,7 @@ bool lteppp_wait_at_rsp (const char *expected_rsp, uint32_t timeout, bool from_m
         else {
             vTaskDelay(1 / portTICK_RATE_MS);
         }
-        uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
+        rx_len = lteppp_at_rx_len();
         if (timeout_cnt > 0) {
             timeout_cnt--;
         }
@@ -261,12 +367,12 @@ bool lteppp_wait_at_rsp (const char *expected_rsp, uint32_t timeout, bool from_m
     while (rx_len > 0) {
         if (len_count == 0) {
             // try to read up to the size of the buffer minus null terminator (minus 2 because we store the OK status in the last byte)
-            rx_len = uart_read_bytes(LTE_UART_ID, (uint8_t *)lteppp_trx_buffer, LTE_UART_BUFFER_SIZE - 2, LTE_TRX_WAIT_MS(LTE_UART_BUFFER_SIZE) / portTICK_RATE_MS);
+            rx_len = lteppp_at_read((uint8_t *)lteppp_trx_buffer, LTE_UART_BUFFER_SIZE - 2, LTE_TRX_WAIT_MS(LTE_UART_BUFFER_SIZE) / portTICK_RATE_MS);
         }
         else
         {
             // try to read up to the size of the buffer minus null terminator (minus 2 because we store the OK status in the last byte)
-            rx_len = uart_read_bytes(LTE_UART_ID, (uint8_t *)(&(lteppp_trx_buffer[len_count])), LTE_UART_BUFFER_SIZE - len_count - 2, LTE_TRX_WAIT_MS(LTE_UART_BUFFER_SIZE) / portTICK_RATE_MS);
+            rx_len = lteppp_at_read((uint8_t *)(&(lteppp_trx_buffer[len_count])), LTE_UART_BUFFER_SIZE - len_count - 2, LTE_TRX_WAIT_MS(LTE_UART_BUFFER_SIZE) / portTICK_RATE_MS);
         }
         len_count += rx_len;
 
@@ -290,6 +396,8 @@ bool lteppp_wait_at_rsp (const char *expected_rsp, uint32_t timeout, bool from_m
                 lteppp_log.truncated = true;
             }
 #endif
+            // the unsolicited lines go to their handlers, the caller only sees the response
+            len_count = lteppp_at_filter_urcs(lteppp_trx_buffer, len_count, &line_offset);
 
             if (expected_rsp != NULL) {
                 if (strstr(lteppp_trx_buffer, expected_rsp) != NULL) {
@@ -298,7 +406,7 @@ bool lteppp_wait_at_rsp (const char *expected_rsp, uint32_t timeout, bool from_m
                 }
             }
 
-            uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
+            rx_len = lteppp_at_rx_len();
 
             if((len_count + rx_len) >= (LTE_UART_BUFFER_SIZE - 2))
             {
@@ -310,15 +418,14 @@ bool lteppp_wait_at_rsp (const char *expected_rsp, uint32_t timeout, bool from_m
             else if(rx_len == 0)
             {
                 uint8_t timeout_buff = 10;
-                while((!strstr(lteppp_trx_buffer,"\r\nOK\r\n")) && (!strstr(lteppp_trx_buffer,"\r\nERROR\r\n")) && (!strstr(lteppp_trx_buffer,"+SYSSTART")) && (!strstr(lteppp_trx_buffer,"\r\nCONNECT\r\n")) &&
-                        rx_len == 0 && timeout_buff > 0)
+                while(!lteppp_at_rsp_complete(lteppp_trx_buffer, len_count) && rx_len == 0 && timeout_buff > 0)
                 {
 #ifdef LTE_DEBUG_BUFF
                     memcpy(&(lteppp_log.log[lteppp_log.ptr]), "[Waiting]:\n", strlen("[Waiting]:\n"));
                     lteppp_log.ptr += strlen("[Waiting]:\n");
 #endif
 
-                    uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
+                    rx_len = lteppp_at_rx_len();
 
                     if (from_mp) {
                         mp_hal_delay_ms(100);
@@ -369,6 +476,11 @@ void lteppp_deinit (void) {
 
     uart_set_hw_flow_ctrl(LTE_UART_ID, UART_HW_FLOWCTRL_DISABLE, 0);
     uart_set_rts(LTE_UART_ID, false);
+    // the modem would stay in multiplexing mode, deaf to the plain AT commands of the next start
+    lteppp_cmux_wanted = false;
+    if (lteppp_cmux_on) {
+        lteppp_cmux_stop(true);
+    }
     xSemaphoreTake(xLTESem, portMAX_DELAY);
     lteppp_lte_state = E_LTE_INIT;
     lteppp_modem_conn_state = E_LTE_MODEM_DISCONNECTED;
@@ -393,6 +505,56 @@ void lteppp_resume(void)
 {
     lteppp_connstatus = LTE_PPP_RESUMED;
 }
+
+uint32_t lteppp_get_baudrate(void)
+{
+    return lteppp_baudrate;
+}
+
+uint32_t lteppp_get_up_ticks(void)
+{
+    return lte_up_ticks;
+}
+
+void lteppp_set_attach_watch(bool enable)
+{
+    xSemaphoreTake(xLTESem, portMAX_DELAY);
+    lteppp_attach_watch = enable;
+    xSemaphoreGive(xLTESem);
+}
+
+// stops the background commands of the LTE task while the caller waits for the modem directly
+void lteppp_pause_background(bool pause)
+{
+    lteppp_bg_paused = pause;
+    if (pause) {
+        lteppp_set_attach_watch(false);
+    }
+}
+
+void lteppp_get_link_stats(lte_link_stats_t *stats)
+{
+    xSemaphoreTake(xLTESem, portMAX_DELAY);
+    *stats = lteppp_link_stats;
+    xSemaphoreGive(xLTESem);
+}
+
+// returns true only to the first one seeing the attachment, so it's reported once
+bool lteppp_take_attach_watch(void)
+{
+    bool watch;
+    xSemaphoreTake(xLTESem, portMAX_DELAY);
+    watch = lteppp_attach_watch;
+    lteppp_attach_watch = false;
+    xSemaphoreGive(xLTESem);
+    return watch;
+}
+
+// AT commands can go to the modem while PPP is up
+bool lteppp_cmux_active(void)
+{
+    return lteppp_cmux_on;
+}
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
@@ -404,10 +566,13 @@ static void TASK_LTE (void *pvParameters) {
     static uint32_t thread_notification;
 
     connect_lte_uart();
+    mptaskmon_register(E_MPTASKMON_LTE, LTE_HEALTH_DEADLINE_MS);
 
 modem_init:
 
+    mptaskmon_idle(E_MPTASKMON_LTE);
     thread_notification = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    mptaskmon_beat(E_MPTASKMON_LTE);
 
     if (thread_notification)
     {
@@ -418,6 +583,13 @@ modem_init:
         uart_set_rts(LTE_UART_ID, true);
         vTaskDelay(500/portTICK_PERIOD_MS);
         uart_set_hw_flow_ctrl(LTE_UART_ID, UART_HW_FLOWCTRL_CTS_RTS, 64);
+        // the modem keeps a negotiated rate across a reset of the ESP32, and the multiplexer as well
+        if (!lteppp_sync_baudrate()) {
+            // the line terminator gets rid of the frame when it wasn't multiplexing
+            lteppp_cmux_stop(true);
+            uart_write_bytes(LTE_UART_ID, "\r", 1);
+            lteppp_sync_baudrate();
+        }
         // exit PPP session if applicable
         if(lteppp_send_at_cmd("+++", LTE_PPP_BACK_OFF_TIME_MS))
         {
@@ -481,8 +653,12 @@ modem_init:
         at_trials = 0;
         // Disable char echo
         lteppp_send_at_cmd("ATE0", LTE_RX_TIMEOUT_MIN_MS);
-        // disable PSM if enabled by default
-        lteppp_send_at_cmd("AT+CPSMS=0", LTE_RX_TIMEOUT_MIN_MS);
+        // move to the fastest rate both sides support
+        lteppp_negotiate_baudrate();
+        // disable PSM if enabled by default, but keep what was configured before a deep sleep
+        if (mpsleep_get_reset_cause() != MPSLEEP_DEEPSLEEP_RESET) {
+            lteppp_send_at_cmd("AT+CPSMS=0", LTE_RX_TIMEOUT_MIN_MS);
+        }
 
         // at least enable access to the SIM
         lteppp_send_at_cmd("AT+CFUN?", LTE_RX_TIMEOUT_MAX_MS);
@@ -516,6 +692,7 @@ modem_init:
         lte_state_t state;
         for (;;) {
             vTaskDelay(LTE_TASK_PERIOD_MS);
+            mptaskmon_beat(E_MPTASKMON_LTE);
             xSemaphoreTake(xLTESem, portMAX_DELAY);
             if(E_LTE_MODEM_DISCONNECTED == lteppp_modem_conn_state)
             {
@@ -526,13 +703,37 @@ modem_init:
             xSemaphoreGive(xLTESem);
             state = lteppp_get_state();
             if (xQueueReceive(xCmdQueue, lteppp_trx_buffer, 0)) {
-                lteppp_send_at_cmd_exp(lte_task_cmd->data, lte_task_cmd->timeout, NULL, &(lte_task_rsp->data_remaining), lte_task_cmd->dataLen);
+                if (lte_task_cmd->pipeline_len > 0) {
+                    // the buffer is reused for the responses, keep the request aside
+                    const lte_at_pipeline_cmd_t *pipeline = lte_task_cmd->pipeline;
+                    uint8_t pipeline_len = lte_task_cmd->pipeline_len;
+                    uint8_t completed = 0;
+                    // the next command goes out as soon as the previous one is answered
+                    for ( ; completed < pipeline_len; completed++) {
+                        const lte_at_pipeline_cmd_t *step = &pipeline[completed];
+                        if (!lteppp_send_at_cmd_exp(step->cmd, step->timeout, step->expected_rsp, &(lte_task_rsp->data_remaining), strlen(step->cmd))
+                            && step->expected_rsp != NULL) {
+                            break;
+                        }
+                    }
+                    lte_task_rsp->completed = completed;
+                } else {
+                    lteppp_send_at_cmd_exp(lte_task_cmd->data, lte_task_cmd->timeout, NULL, &(lte_task_rsp->data_remaining), lte_task_cmd->dataLen);
+                    lte_task_rsp->completed = 1;
+                }
                 xQueueSend(xRxQueue, (void *)lte_task_rsp, (TickType_t)portMAX_DELAY);
             }
+            else if (lteppp_cmux_wanted && !lteppp_cmux_on && !lteppp_bg_paused && state >= E_LTE_IDLE && state < E_LTE_PPP)
+            {
+                // back after a reset of the modem
+                lteppp_cmux_start();
+            }
             else if(state == E_LTE_PPP && lte_uart_break_evt)
             {
+                // the URCs that raised the break come back with the response
                 lteppp_send_at_cmd("+++", LTE_PPP_BACK_OFF_TIME_MS);
                 lteppp_suspend();
+                lte_uart_break_evt = false;
             }
             else
             {
@@ -541,6 +742,10 @@ modem_init:
                     // check for IP connection
                     if(lteppp_ipv4() > 0)
                     {
+                        if (ltepp_ppp_conn_up == false)
+                        {
+                            modlte_urc_events(LTE_EVENT_CONNECTED);
+                        }
                         ltepp_ppp_conn_up = true;
                     }
                     else
@@ -549,22 +754,54 @@ modem_init:
                         {
                             ltepp_ppp_conn_up = false;
                             lteppp_set_state(E_LTE_ATTACHED);
+                            modlte_urc_events(LTE_EVENT_DISCONNECTED);
                         }
                     }
-                    // wait for characters received
-                    uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
-                    if (rx_len > 0) {
-                        // try to read up to the size of the buffer
-                        rx_len = uart_read_bytes(LTE_UART_ID, (uint8_t *)lteppp_trx_buffer, LTE_UART_BUFFER_SIZE,
-                                                 LTE_TRX_WAIT_MS(LTE_UART_BUFFER_SIZE) / portTICK_RATE_MS);
-                        if (rx_len > 0) {
-                            pppos_input_tcpip(lteppp_pcb, (uint8_t *)lteppp_trx_buffer, rx_len);
+                    if (lteppp_cmux_on) {
+                        // the PPP frames are handed over as they come out of the multiplexer, and
+                        // the AT channel stays free for the URCs and the link samples
+                        lteppp_cmux_pump(0);
+                        if (!lteppp_bg_paused) {
+                            if (!spsc_ring_is_empty(&lteppp_cmux_at_ring)) {
+                                lteppp_at_drain();
+                            }
+                            lteppp_sample_link();
+                        }
+                    } else {
+                        // wait for characters received
+                        uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
+                        // drain the RX ring before sleeping again, at the higher rates one task period
+                        // holds more than a single buffer
+                        while (rx_len > 0) {
+                            // try to read up to the size of the buffer
+                            rx_len = uart_read_bytes(LTE_UART_ID, (uint8_t *)lteppp_trx_buffer, MIN(rx_len, LTE_UART_BUFFER_SIZE),
+                                                     LTE_TRX_WAIT_MS(LTE_UART_BUFFER_SIZE) / portTICK_RATE_MS);
+                            if (rx_len > 0) {
+                                pppos_input_tcpip(lteppp_pcb, (uint8_t *)lteppp_trx_buffer, rx_len);
+                                uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
+                            }
                         }
                     }
                 }
                 else
                 {
                     ltepp_ppp_conn_up = false;
+                    if (lteppp_cmux_on) {
+                        // the URCs don't wait for the next command
+                        lteppp_cmux_pump(0);
+                        if (!lteppp_bg_paused && !spsc_ring_is_empty(&lteppp_cmux_at_ring)) {
+                            lteppp_at_drain();
+                        }
+                    }
+                    if (!lteppp_bg_paused) {
+                        if (state == E_LTE_ATTACHING && lteppp_attach_watch) {
+                            lteppp_poll_attach();
+                        } else if (state == E_LTE_ATTACHED || state == E_LTE_SUSPENDED) {
+                            // without the multiplexer there's no second channel to the modem, in data mode
+                            // the last sample is kept
+                            lteppp_sample_link();
+                        }
+                    }
                 }
             }
         }
@@ -575,32 +812,16 @@ modem_init:
 static void TASK_UART_EVT (void *pvParameters)
 {
     uart_event_t event;
-    uint8_t buff[50] = {0};
     for(;;) {
         //Waiting for UART event.
         if(xQueueReceive(uart0_queue, (void * )&event, (portTickType)portMAX_DELAY)) {
 
+            // the data itself is only read by the LTE task, URCs included
             switch(event.type)
             {
-                case UART_DATA:
-                    if (lte_uart_break_evt) {
-
-                        uint32_t rx_len = uart_read_bytes(LTE_UART_ID, buff, LTE_UART_BUFFER_SIZE,
-                                                                         LTE_TRX_WAIT_MS(LTE_UART_BUFFER_SIZE) / portTICK_RATE_MS);
-
-                        if ((rx_len) && (strstr((const char *)buff, "OK") != NULL))
-                        {
-                            if(strstr((const char *)buff, "+CEREG: 4") != NULL)
-                            {
-                                modlte_urc_events(LTE_EVENT_COVERAGE_LOST);
-                            }
-
-                            lte_uart_break_evt = false;
-                        }
-                    }
-                    break;
                 case UART_BREAK:
-                    if (E_LTE_PPP == lteppp_get_state()) {
+                    // with the multiplexer the URCs have their own channel already
+                    if (E_LTE_PPP == lteppp_get_state() && !lteppp_cmux_on) {
                         lte_uart_break_evt = true;
                     }
                     break;
@@ -615,7 +836,26 @@ static void TASK_UART_EVT (void *pvParameters)
 
 static bool lteppp_send_at_cmd_exp (const char *cmd, uint32_t timeout, const char *expected_rsp, void* data_rem, size_t len) {
 
-    if(strstr(cmd, "Pycom_Dummy") != NULL)
+    if (!strcmp(cmd, "Pycom_CMUX"))
+    {
+        bool started = lteppp_cmux_start();
+        lteppp_cmux_wanted = started;
+        strcpy(lteppp_trx_buffer, started ? LTE_OK_RSP : "ERROR");
+        if (data_rem != NULL) {
+            *((bool *)data_rem) = false;
+        }
+        return started;
+    }
+    else if (lteppp_cmux_on && (!strcmp(cmd, "+++") || (!strcmp(cmd, "ATO") && lteppp_cmux_data_online)))
+    {
+        // the data channel never leaves data mode, only the PPP frames are held meanwhile
+        strcpy(lteppp_trx_buffer, (cmd[0] == '+') ? "\r\nOK\r\n" : "\r\nCONNECT\r\n");
+        if (data_rem != NULL) {
+            *((bool *)data_rem) = false;
+        }
+        return expected_rsp == NULL || strstr(lteppp_trx_buffer, expected_rsp) != NULL;
+    }
+    else if(strstr(cmd, "Pycom_Dummy") != NULL)
     {
 #ifdef LTE_DEBUG_BUFF
         if (lteppp_log.ptr < (LTE_LOG_BUFF_SIZE - strlen("[CMD]: Dummy") + 1))
@@ -636,6 +876,8 @@ static bool lteppp_send_at_cmd_exp (const char *cmd, uint32_t timeout, const cha
     else
     {
         size_t cmd_len = len;
+        bool data_channel = lteppp_cmux_on && lteppp_cmux_is_data_cmd(cmd);
+        bool rsp;
         // char tmp_buf[128];
 #ifdef LTE_DEBUG_BUFF
         if (lteppp_log.ptr < (LTE_LOG_BUFF_SIZE - strlen("[CMD]:") - cmd_len + 1))
@@ -653,18 +895,24 @@ static bool lteppp_send_at_cmd_exp (const char *cmd, uint32_t timeout, const cha
             lteppp_log.truncated = true;
         }
 #endif
-        // flush the rx buffer first
-        uart_flush(LTE_UART_ID);
+        // flush the rx buffer first, keeping the URCs that arrived since the last command
+        lteppp_at_drain();
+        lteppp_at_set_pending(cmd);
         // uart_read_bytes(LTE_UART_ID, (uint8_t *)tmp_buf, sizeof(tmp_buf), 5 / portTICK_RATE_MS);
         // then send the command
-        uart_write_bytes(LTE_UART_ID, cmd, cmd_len);
-        if (strcmp(cmd, "+++")) {
-            uart_write_bytes(LTE_UART_ID, "\r", 1);
-        }
+        lteppp_cmux_data_cmd = data_channel;
+        lteppp_at_write(cmd, cmd_len, data_channel);
         uart_wait_tx_done(LTE_UART_ID, LTE_TRX_WAIT_MS(cmd_len) / portTICK_RATE_MS);
         vTaskDelay(2 / portTICK_RATE_MS);
 
-        return lteppp_wait_at_rsp(expected_rsp, timeout, false, data_rem);
+        rsp = lteppp_wait_at_rsp(expected_rsp, timeout, false, data_rem);
+        if (data_channel) {
+            lteppp_cmux_data_cmd = false;
+            if (strstr(lteppp_trx_buffer, LTE_CONNECT_RSP) != NULL) {
+                lteppp_cmux_data_online = true;
+            }
+        }
+        return rsp;
     }
 }
 
@@ -681,34 +929,495 @@ static bool lteppp_check_sim_present(void) {
     }
 }
 
+static void lteppp_apply_baudrate (uint32_t baudrate) {
+    uart_wait_tx_done(LTE_UART_ID, LTE_TRX_WAIT_MS(LTE_AT_CMD_SIZE_MAX) / portTICK_RATE_MS);
+    uart_set_baudrate(LTE_UART_ID, baudrate);
+    lteppp_baudrate = baudrate;
+    vTaskDelay(LTE_BAUDRATE_SETTLE_MS / portTICK_RATE_MS);
+    uart_flush(LTE_UART_ID);
+}
+
+// finds the rate the modem is currently using, returns false if it doesn't answer at any of them
+static bool lteppp_sync_baudrate (void) {
+    uint32_t current = lteppp_baudrate;
+
+    if (lteppp_send_at_cmd("AT", LTE_RX_TIMEOUT_MIN_MS)) {
+        return true;
+    }
+    for (int i = 0; i < MP_ARRAY_SIZE(lteppp_baudrates); i++) {
+        if (lteppp_baudrates[i] == current || lteppp_baudrates[i] > MICROPY_LTE_UART_BAUDRATE_MAX) {
+            continue;
+        }
+        lteppp_apply_baudrate(lteppp_baudrates[i]);
+        if (lteppp_send_at_cmd("AT", LTE_RX_TIMEOUT_MIN_MS)) {
+            return true;
+        }
+    }
+    // it might be in data mode, let the caller deal with it at the original rate
+    lteppp_apply_baudrate(current);
+    return false;
+}
+
+static void lteppp_negotiate_baudrate (void) {
+    char at_cmd[24];
+    uint32_t current = lteppp_baudrate;
+
+    for (int i = 0; i < MP_ARRAY_SIZE(lteppp_baudrates); i++) {
+        uint32_t baudrate = lteppp_baudrates[i];
+        if (baudrate <= current) {
+            // the list is sorted, nothing faster left to try
+            break;
+        }
+        if (baudrate > MICROPY_LTE_UART_BAUDRATE_MAX) {
+            continue;
+        }
+        sprintf(at_cmd, "AT+IPR=%u", baudrate);
+        // the OK comes back at the old rate, the modem switches right after it
+        if (!lteppp_send_at_cmd(at_cmd, LTE_RX_TIMEOUT_MIN_MS)) {
+            continue;
+        }
+        lteppp_apply_baudrate(baudrate);
+        for (int trials = 0; trials < LTE_AT_CMD_TRIALS; trials++) {
+            if (lteppp_send_at_cmd("AT", LTE_RX_TIMEOUT_MIN_MS)) {
+                return;
+            }
+        }
+        // the link doesn't hold at this rate, find where the modem ended up and go back
+        if (lteppp_sync_baudrate()) {
+            if (lteppp_baudrate != current) {
+                sprintf(at_cmd, "AT+IPR=%u", current);
+                if (lteppp_send_at_cmd(at_cmd, LTE_RX_TIMEOUT_MIN_MS)) {
+                    lteppp_apply_baudrate(current);
+                }
+            }
+        }
+        return;
+    }
+}
+
+static void lteppp_at_set_pending (const char *cmd) {
+    size_t len = 0;
+    // "AT+CEREG?" is answered by "+CEREG: ..." lines
+    if (!strncmp(cmd, "AT", 2)) {
+        cmd += 2;
+        while (cmd[len] != '\0' && cmd[len] != '?' && cmd[len] != '=' && cmd[len] != ';' && cmd[len] != '\r' &&
+               len < sizeof(lteppp_at_pending) - 1) {
+            len++;
+        }
+        memcpy(lteppp_at_pending, cmd, len);
+    }
+    lteppp_at_pending[len] = '\0';
+}
+
+static bool lteppp_at_is_final (const char *line, size_t len) {
+    static const char *finals[] = { "OK", "ERROR", "CONNECT", "NO CARRIER", "+CME ERROR", "+CMS ERROR", "+SYSSTART" };
+    for (int i = 0; i < MP_ARRAY_SIZE(finals); i++) {
+        size_t flen = strlen(finals[i]);
+        if (len >= flen && !strncmp(line, finals[i], flen)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// true once the buffer holds a complete final result line
+static bool lteppp_at_rsp_complete (const char *buf, size_t len) {
+    size_t start = 0;
+    while (start < len) {
+        const char *eol = memchr(&buf[start], '\n', len - start);
+        if (eol == NULL) {
+            break;
+        }
+        size_t end = eol - buf;
+        while (start < end && buf[start] == '\r') {
+            start++;
+        }
+        if (lteppp_at_is_final(&buf[start], end - start)) {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+static const lteppp_urc_t *lteppp_urc_find (const char *line, size_t len) {
+    while (len > 0 && *line == '\r') {
+        line++;
+        len--;
+    }
+    for (int i = 0; i < LTE_URC_HANDLERS_MAX && lteppp_urcs[i].prefix != NULL; i++) {
+        size_t plen = strlen(lteppp_urcs[i].prefix);
+        if (len > plen && !strncmp(line, lteppp_urcs[i].prefix, plen) && line[plen] == ':') {
+            // the same prefix answers a query of that command
+            if (!strcmp(lteppp_at_pending, lteppp_urcs[i].prefix)) {
+                return NULL;
+            }
+            return &lteppp_urcs[i];
+        }
+    }
+    return NULL;
+}
+
+static void lteppp_urc_call (const lteppp_urc_t *urc, const char *line, size_t len) {
+    char urc_line[LTE_AT_LINE_SIZE_MAX + 1];
+    while (len > 0 && (*line == '\r' || *line == '\n')) {
+        line++;
+        len--;
+    }
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == '\n')) {
+        len--;
+    }
+    len = MIN(len, LTE_AT_LINE_SIZE_MAX);
+    memcpy(urc_line, line, len);
+    urc_line[len] = '\0';
+    urc->handler(urc_line, urc->arg);
+}
+
+// takes the complete URC lines out of buf, offset keeps the start of the first line not looked at yet
+static uint16_t lteppp_at_filter_urcs (char *buf, uint16_t len, uint16_t *offset) {
+    uint16_t start = *offset;
+    while (start < len) {
+        char *eol = memchr(&buf[start], '\n', len - start);
+        if (eol == NULL) {
+            break;
+        }
+        uint16_t end = (eol - buf) + 1;
+        const lteppp_urc_t *urc = lteppp_urc_find(&buf[start], end - start);
+        if (urc != NULL) {
+            lteppp_urc_call(urc, &buf[start], end - start);
+            // move the rest of the response down, NULL terminator included
+            memmove(&buf[start], &buf[end], len - end + 1);
+            len -= end - start;
+        } else {
+            start = end;
+        }
+    }
+    *offset = start;
+    return len;
+}
+
+// empties the UART before a new command, the URC lines in there are dispatched and the rest dropped
+static void lteppp_at_drain (void) {
+    static char line[LTE_AT_LINE_SIZE_MAX];
+    static uint16_t line_len = 0;
+    uint8_t chunk[64];
+    int rx_len;
+    // the multiplexer is drained between the commands too, a line can be split across two calls
+    if (!lteppp_cmux_on) {
+        line_len = 0;
+    }
+    // whatever is left over from the previous command is unsolicited by now
+    lteppp_at_pending[0] = '\0';
+    while ((rx_len = lteppp_at_read(chunk, sizeof(chunk), 0)) > 0) {
+        for (int i = 0; i < rx_len; i++) {
+            if (chunk[i] == '\n') {
+                const lteppp_urc_t *urc = lteppp_urc_find(line, line_len);
+                if (urc != NULL) {
+                    lteppp_urc_call(urc, line, line_len);
+                }
+                line_len = 0;
+            } else if (line_len < sizeof(line)) {
+                line[line_len++] = chunk[i];
+            }
+        }
+    }
+}
+
+// bytes waiting for the AT command parser, the UART or the AT channel of the multiplexer
+static uint32_t lteppp_at_rx_len (void) {
+    uint32_t rx_len = 0;
+    if (lteppp_cmux_on) {
+        lteppp_cmux_pump(0);
+        return spsc_ring_count(&lteppp_cmux_at_ring);
+    }
+    uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
+    return rx_len;
+}
+
+static int lteppp_at_read (uint8_t *buf, uint32_t len, TickType_t wait) {
+    uint32_t rx_len;
+    if (!lteppp_cmux_on) {
+        return uart_read_bytes(LTE_UART_ID, buf, len, wait);
+    }
+    lteppp_cmux_pump(0);
+    rx_len = spsc_ring_read(&lteppp_cmux_at_ring, buf, len);
+    if (rx_len == 0 && wait > 0) {
+        lteppp_cmux_pump(wait);
+        rx_len = spsc_ring_read(&lteppp_cmux_at_ring, buf, len);
+    }
+    return rx_len;
+}
+
+// "+++" goes out without the line terminator
+static void lteppp_at_write (const char *cmd, size_t len, bool data_channel) {
+    bool cr = (strcmp(cmd, "+++") != 0);
+    if (lteppp_cmux_on) {
+        char line[LTE_AT_CMD_SIZE_MAX];
+        len = MIN(len, sizeof(line) - 1);
+        memcpy(line, cmd, len);
+        if (cr) {
+            line[len++] = '\r';
+        }
+        size_t frame_len = ltecmux_frame(lteppp_cmux_at_frame, data_channel ? LTE_CMUX_DLCI_DATA : LTE_CMUX_DLCI_AT,
+                                         LTECMUX_UIH, (const uint8_t *)line, len);
+        uart_write_bytes(LTE_UART_ID, (const char *)lteppp_cmux_at_frame, frame_len);
+        return;
+    }
+    uart_write_bytes(LTE_UART_ID, cmd, len);
+    if (cr) {
+        uart_write_bytes(LTE_UART_ID, "\r", 1);
+    }
+}
+
+// called from the tcpip thread, with the multiplexer the data is cut in frames of at most N1 bytes
+static int lteppp_ppp_write (const uint8_t *data, size_t len) {
+    size_t done = 0;
+    if (!lteppp_cmux_on) {
+        return uart_write_bytes(LTE_UART_ID, (const char *)data, len);
+    }
+    while (done < len) {
+        uint16_t n = MIN(len - done, lteppp_cmux_n1);
+        size_t frame_len = ltecmux_frame(lteppp_cmux_ppp_frame, LTE_CMUX_DLCI_DATA, LTECMUX_UIH, &data[done], n);
+        // one write per frame, the driver doesn't interleave it with the AT channel
+        if (uart_write_bytes(LTE_UART_ID, (const char *)lteppp_cmux_ppp_frame, frame_len) < 0) {
+            return -1;
+        }
+        done += n;
+    }
+    return len;
+}
+
+// runs in the LTE task, where the multiplexer is pumped
+static void lteppp_cmux_frame_cb (void *arg, uint8_t dlci, uint8_t control, const uint8_t *info, uint16_t len) {
+    switch (control) {
+    case LTECMUX_UA:
+        if (dlci < 8) {
+            lteppp_cmux_ua |= 1 << dlci;
+        }
+        break;
+    case LTECMUX_DM:
+    case LTECMUX_DISC:
+        if (dlci == LTE_CMUX_DLCI_DATA) {
+            lteppp_cmux_data_online = false;
+        }
+        break;
+    case LTECMUX_UIH:
+    case LTECMUX_UI:
+        if (dlci == LTECMUX_DLCI_CONTROL) {
+            // the modem's commands are acknowledged by sending them back as responses
+            if (len >= 2 && (info[0] & LTECMUX_MSG_CR) && len <= LTE_AT_CMD_SIZE_MAX) {
+                uint8_t rsp[LTE_AT_CMD_SIZE_MAX];
+                memcpy(rsp, info, len);
+                rsp[0] &= ~LTECMUX_MSG_CR;
+                size_t frame_len = ltecmux_frame(lteppp_cmux_at_frame, LTECMUX_DLCI_CONTROL, LTECMUX_UIH, rsp, len);
+                uart_write_bytes(LTE_UART_ID, (const char *)lteppp_cmux_at_frame, frame_len);
+                if (rsp[0] == LTECMUX_MSG_CLD) {
+                    lteppp_cmux_on = false;
+                }
+            }
+        } else if (dlci == LTE_CMUX_DLCI_DATA && lteppp_cmux_data_online && !lteppp_cmux_data_cmd) {
+            pppos_input_tcpip(lteppp_pcb, (uint8_t *)info, len);
+        } else if (dlci == LTE_CMUX_DLCI_AT || dlci == LTE_CMUX_DLCI_DATA) {
+            // dropped if nobody read the channel for a while
+            spsc_ring_write(&lteppp_cmux_at_ring, info, len);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// moves what the UART received through the multiplexer, waits for the first byte if asked to
+static void lteppp_cmux_pump (TickType_t wait) {
+    uint32_t rx_len;
+    int n;
+    while (lteppp_cmux_on) {
+        uart_get_buffered_data_len(LTE_UART_ID, &rx_len);
+        if (rx_len == 0) {
+            if (wait == 0) {
+                break;
+            }
+            n = uart_read_bytes(LTE_UART_ID, lteppp_cmux_chunk, 1, wait);
+            wait = 0;
+        } else {
+            n = uart_read_bytes(LTE_UART_ID, lteppp_cmux_chunk, MIN(rx_len, sizeof(lteppp_cmux_chunk)), 0);
+        }
+        if (n <= 0) {
+            break;
+        }
+        ltecmux_input(&lteppp_cmux_rx, lteppp_cmux_chunk, n, lteppp_cmux_frame_cb, NULL);
+    }
+}
+
+static bool lteppp_cmux_open (uint8_t dlci) {
+    size_t frame_len = ltecmux_frame(lteppp_cmux_at_frame, dlci, LTECMUX_SABM | LTECMUX_PF, NULL, 0);
+    TickType_t start = xTaskGetTickCount();
+
+    uart_write_bytes(LTE_UART_ID, (const char *)lteppp_cmux_at_frame, frame_len);
+    while (!(lteppp_cmux_ua & (1 << dlci))) {
+        if ((xTaskGetTickCount() - start) > (LTE_CMUX_UA_TIMEOUT_MS / portTICK_RATE_MS)) {
+            return false;
+        }
+        lteppp_cmux_pump(LTE_TASK_PERIOD_MS);
+    }
+    return true;
+}
+
+// switches the UART to the multiplexer: the control channel, then one channel for the AT commands
+// and one for PPP. Runs in the LTE task.
+static bool lteppp_cmux_start (void) {
+    char at_cmd[24];
+    uint16_t n1 = LTECMUX_N1_MAX;
+
+    if (lteppp_cmux_on) {
+        return true;
+    }
+    sprintf(at_cmd, "AT+CMUX=0,0,,%u", n1);
+    if (!lteppp_send_at_cmd(at_cmd, LTE_RX_TIMEOUT_MIN_MS)) {
+        // only the basic option with the default frame size
+        n1 = LTECMUX_N1_DEFAULT;
+        if (!lteppp_send_at_cmd("AT+CMUX=0", LTE_RX_TIMEOUT_MIN_MS)) {
+            return false;
+        }
+    }
+    lteppp_cmux_n1 = n1;
+    lteppp_cmux_ua = 0;
+    lteppp_cmux_data_online = false;
+    lteppp_cmux_data_cmd = false;
+    ltecmux_rx_init(&lteppp_cmux_rx, n1);
+    spsc_ring_init(&lteppp_cmux_at_ring, lteppp_cmux_at_storage, sizeof(lteppp_cmux_at_storage), 1);
+    lteppp_cmux_on = true;
+
+    if (!lteppp_cmux_open(LTECMUX_DLCI_CONTROL) || !lteppp_cmux_open(LTE_CMUX_DLCI_AT) || !lteppp_cmux_open(LTE_CMUX_DLCI_DATA)) {
+        lteppp_cmux_stop(true);
+        return false;
+    }
+    return true;
+}
+
+// with close the modem is told to go back to plain AT commands, else it's known to have done so
+static void lteppp_cmux_stop (bool close) {
+    if (close) {
+        static const uint8_t cld[] = { LTECMUX_MSG_CLD | LTECMUX_MSG_CR, 0x01 };
+        uint8_t frame[LTECMUX_OVERHEAD + sizeof(cld)];
+        size_t frame_len = ltecmux_frame(frame, LTECMUX_DLCI_CONTROL, LTECMUX_UIH, cld, sizeof(cld));
+        uart_write_bytes(LTE_UART_ID, (const char *)frame, frame_len);
+        uart_wait_tx_done(LTE_UART_ID, LTE_TRX_WAIT_MS(frame_len) / portTICK_RATE_MS);
+    }
+    lteppp_cmux_on = false;
+    lteppp_cmux_data_online = false;
+    lteppp_cmux_data_cmd = false;
+}
+
+static bool lteppp_cmux_is_data_cmd (const char *cmd) {
+    return !strncmp(cmd, "AT+CGDATA", 9) || !strncmp(cmd, "ATD", 3) || !strcmp(cmd, "ATO");
+}
+
+static void lteppp_poll_attach (void) {
+    static TickType_t last_poll;
+    char *pos;
+
+    if ((xTaskGetTickCount() - last_poll) < (LTE_ATTACH_POLL_MS / portTICK_RATE_MS)) {
+        return;
+    }
+    last_poll = xTaskGetTickCount();
+    // "+CEREG: <n>,<stat>[,...]", registered home or roaming
+    if (lteppp_send_at_cmd("AT+CEREG?", LTE_RX_TIMEOUT_MIN_MS) && (pos = strstr(lteppp_trx_buffer, "+CEREG: ")) &&
+        (pos = strchr(pos, ',')) && (pos[1] == '1' || pos[1] == '5')) {
+        if (lteppp_take_attach_watch()) {
+            lteppp_set_state(E_LTE_ATTACHED);
+            modlte_urc_events(LTE_EVENT_ATTACHED);
+        }
+    }
+}
+
+static void lteppp_sample_link (void) {
+    static TickType_t last_sample;
+    lte_link_stats_t stats = lteppp_link_stats;
+    char *pos;
+
+    if (last_sample != 0 && (xTaskGetTickCount() - last_sample) < (LTE_STATS_PERIOD_MS / portTICK_RATE_MS)) {
+        return;
+    }
+    last_sample = xTaskGetTickCount();
+
+    // "+CSQ: <rssi>,<ber>"
+    if (lteppp_send_at_cmd("AT+CSQ", LTE_RX_TIMEOUT_MIN_MS) && (pos = strstr(lteppp_trx_buffer, "+CSQ: "))) {
+        int rssi = strtol(pos + 6, NULL, 10);
+        stats.rssi = (rssi < 99) ? (-113 + (2 * rssi)) : LTE_STATS_UNKNOWN;
+    }
+    // "+CEREG: 2,<stat>,"<tac>","<ci>",<act>", both in hex
+    if (lteppp_send_at_cmd("AT+CEREG?", LTE_RX_TIMEOUT_MIN_MS) && (pos = strstr(lteppp_trx_buffer, "+CEREG: "))) {
+        if ((pos = strchr(pos, '"')) != NULL) {
+            stats.tac = strtoul(pos + 1, &pos, 16);
+            if ((pos = strchr(pos + 1, '"')) != NULL) {
+                stats.cell_id = strtoul(pos + 1, NULL, 16);
+            }
+        }
+    }
+    // the serving cell comes first: "+SQNMONI: <oper> Cc:.. Nc:.. RSRP:-98.20 CINR:.. RSRQ:-11.00 TAC:.. Id:.. EARFCN:6400 ..."
+    if (lteppp_send_at_cmd("AT+SQNMONI=9", LTE_RX_TIMEOUT_MIN_MS) && (pos = strstr(lteppp_trx_buffer, "+SQNMONI: "))) {
+        char *field;
+        if ((field = strstr(pos, "RSRP:")) != NULL) {
+            stats.rsrp = (int16_t)strtol(field + 5, NULL, 10);
+        }
+        if ((field = strstr(pos, "RSRQ:")) != NULL) {
+            stats.rsrq = (int16_t)strtol(field + 5, NULL, 10);
+        }
+        if ((field = strstr(pos, "EARFCN:")) != NULL) {
+            stats.earfcn = strtoul(field + 7, NULL, 10);
+            stats.band = 0;
+            for (int i = MP_ARRAY_SIZE(lteppp_bands) - 1; i >= 0; i--) {
+                if (stats.earfcn >= lteppp_bands[i].earfcn) {
+                    stats.band = lteppp_bands[i].band;
+                    break;
+                }
+            }
+        }
+    }
+    stats.ticks = mp_hal_ticks_ms();
+
+    xSemaphoreTake(xLTESem, portMAX_DELAY);
+    lteppp_link_stats = stats;
+    xSemaphoreGive(xLTESem);
+}
+
+// hands the frames held while suspended over to the UART, or drops them
+static void lteppp_suspend_ring_flush (bool send) {
+    size_t size;
+    uint8_t *data;
+    while ((data = xRingbufferReceiveUpTo(lteppp_suspend_ring, &size, 0, LTE_UART_TX_RING_SIZE)) != NULL) {
+        if (send) {
+            lteppp_ppp_write(data, size);
+        }
+        vRingbufferReturnItem(lteppp_suspend_ring, data);
+    }
+}
+
 // PPP output callback
 static uint32_t lteppp_output_callback(ppp_pcb *pcb, u8_t *data, u32_t len, void *ctx) {
     LWIP_UNUSED_ARG(ctx);
-    uint32_t tx_bytes;
-    static uint32_t top =0;
+    int tx_bytes;
     if (lteppp_connstatus == LTE_PPP_IDLE || lteppp_connstatus == LTE_PPP_RESUMED) {
-        if(top > 0 && lteppp_connstatus == LTE_PPP_RESUMED)
+        if(lteppp_connstatus == LTE_PPP_RESUMED)
         {
-            uart_write_bytes(LTE_UART_ID, (const char*)lteppp_queue_buffer, top+1);
-            uart_wait_tx_done(LTE_UART_ID, LTE_TRX_WAIT_MS(top+1) / portTICK_RATE_MS);
+            lteppp_suspend_ring_flush(true);
+        }
+        // the frame is copied to the TX ring of the driver and sent by the TX interrupt, the tcpip
+        // thread only waits here when the ring is full
+        tx_bytes = lteppp_ppp_write(data, len);
+        if (tx_bytes < 0) {
+            return 0;
         }
-        top = 0;
-        tx_bytes = uart_write_bytes(LTE_UART_ID, (const char*)data, len);
-        uart_wait_tx_done(LTE_UART_ID, LTE_TRX_WAIT_MS(len) / portTICK_RATE_MS);
     }
     else
     {
-        uint32_t temp = top + len;
-        if(temp > LTE_UART_BUFFER_SIZE)
+        // the frame is kept whole or dropped
+        if (xRingbufferSend(lteppp_suspend_ring, data, len, 0) != pdTRUE)
         {
             return 0;
         }
-        else
-        {
-            memcpy(&(lteppp_queue_buffer[top]), (const char*)data, len);
-            top += len;
-            return len;
-        }
+        tx_bytes = len;
     }
     return tx_bytes;
 }
@@ -727,8 +1436,10 @@ static void lteppp_status_cb (ppp_pcb *pcb, int err_code, void *ctx) {
         lte_ipv4addr = pppif->ip_addr.u_addr.ip4.addr;
         if(lte_ipv4addr > 0)
         {
+            lte_up_ticks = mp_hal_ticks_ms();
             ltepp_dns_info[0] = dns_getserver(0);
             ltepp_dns_info[1] = dns_getserver(1);
+            netfailover_link_event(E_NETFAILOVER_LTE, true);
         }
 //        printf("ipaddr    = %s\n", ipaddr_ntoa(&pppif->ip_addr));
 //        printf("gateway   = %s\n", ipaddr_ntoa(&pppif->gw));
@@ -755,11 +1466,13 @@ static void lteppp_status_cb (ppp_pcb *pcb, int err_code, void *ctx) {
 //        printf("status_cb: User interrupt (disconnected)\n");
         lte_ipv4addr = 0;
         memset(lte_ipv6addr.addr, 0, sizeof(lte_ipv4addr));
+        netfailover_link_event(E_NETFAILOVER_LTE, false);
         break;
     case PPPERR_CONNECT:
 //        printf("status_cb: Connection lost\n");
         lte_ipv4addr = 0;
         memset(lte_ipv6addr.addr, 0, sizeof(lte_ipv4addr));
+        netfailover_link_event(E_NETFAILOVER_LTE, false);
         break;
     case PPPERR_AUTHFAIL:
 //        printf("status_cb: Failed authentication challenge\n");
@@ -769,6 +1482,7 @@ static void lteppp_status_cb (ppp_pcb *pcb, int err_code, void *ctx) {
         break;
     case PPPERR_PEERDEAD:
 //        printf("status_cb: Connection timeout\n");
+        netfailover_link_event(E_NETFAILOVER_LTE, false);
         break;
     case PPPERR_IDLETIMEOUT:
 //        printf("status_cb: Idle Timeout\n");
@@ -783,6 +1497,7 @@ static void lteppp_status_cb (ppp_pcb *pcb, int err_code, void *ctx) {
 //        printf("status_cb: Unknown error code %d\n", err_code);
         lte_ipv4addr = 0;
         memset(lte_ipv6addr.addr, 0, sizeof(lte_ipv4addr));
+        netfailover_link_event(E_NETFAILOVER_LTE, false);
         break;
     }
 }
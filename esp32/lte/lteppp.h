@@ -16,16 +16,27 @@
 #define LTE_UART_ID                                                     (2)
 
 #define LTE_UART_BUFFER_SIZE                                            (2048)
+#define LTE_UART_TX_RING_SIZE                                           (8192)      // PPP frames waiting for the UART TX interrupt
+#define LTE_UART_RX_RING_SIZE                                           (8192)      // PPP input waiting for the LTE task
 #define LTE_CMD_QUEUE_SIZE_MAX                                          (1)
 #define LTE_RSP_QUEUE_SIZE_MAX                                          (1)
 #define LTE_AT_CMD_SIZE_MAX                                             (128)
 #define LTE_AT_RSP_SIZE_MAX                                             (LTE_UART_BUFFER_SIZE)
+#define LTE_AT_LINE_SIZE_MAX                                            (128)
+#define LTE_URC_HANDLERS_MAX                                            (8)
 
 #define LTE_OK_RSP                                                      "OK"
 #define LTE_CONNECT_RSP                                                 "CONNECT"
 #define LTE_RX_TIMEOUT_MAX_MS                                           (9500)
 #define LTE_RX_TIMEOUT_MIN_MS                                           (300)
 #define LTE_PPP_BACK_OFF_TIME_MS                                        (1150)
+#define LTE_ATTACH_POLL_MS                                              (1000)
+#define LTE_STATS_PERIOD_MS                                             (10000)
+#define LTE_STATS_UNKNOWN                                               (-32768)
+
+#ifndef MICROPY_LTE_UART_BAUDRATE_MAX
+#define MICROPY_LTE_UART_BAUDRATE_MAX                                   MICROPY_LTE_UART_BAUDRATE
+#endif
 
 #define LTE_MUTEX_TIMEOUT                                               (5050 / portTICK_RATE_MS)
 #define LTE_TASK_STACK_SIZE                                             (3072)
@@ -69,18 +80,43 @@ typedef struct {
     bool truncated;
 } lte_log_t;
 #endif
+// one step of a command pipeline, the strings must stay valid until the pipeline returns
+typedef struct {
+    const char *cmd;
+    const char *expected_rsp;       // NULL accepts any response
+    uint32_t timeout;
+} lte_at_pipeline_cmd_t;
+
 typedef struct {
     uint32_t timeout;
     char data[LTE_AT_CMD_SIZE_MAX - 4];
     size_t dataLen;
+    const lte_at_pipeline_cmd_t *pipeline;  // when set, data is ignored
+    uint8_t pipeline_len;
 } lte_task_cmd_data_t;
 #pragma pack(1)
 typedef struct {
     char data[LTE_UART_BUFFER_SIZE];
     bool data_remaining;
+    uint8_t completed;              // pipeline steps that got their expected response
 } lte_task_rsp_data_t;
 #pragma pack()
 
+// last sample of the serving cell, LTE_STATS_UNKNOWN (or 0) where the modem didn't report it
+typedef struct {
+    int16_t     rssi;           // dBm
+    int16_t     rsrp;           // dBm
+    int16_t     rsrq;           // dB
+    uint16_t    band;
+    uint16_t    tac;
+    uint32_t    cell_id;
+    uint32_t    earfcn;
+    uint32_t    ticks;          // mp_hal_ticks_ms() when sampled, 0 if never
+} lte_link_stats_t;
+
+// called with a complete unsolicited line, without the line terminator
+typedef void (*lteppp_urc_handler_t) (const char *line, void *arg);
+
 
 /******************************************************************************
  DECLARE PUBLIC DTATA
@@ -114,6 +150,8 @@ extern void lteppp_send_at_command (lte_task_cmd_data_t *cmd, lte_task_rsp_data_
 
 extern bool lteppp_wait_at_rsp (const char *expected_rsp, uint32_t timeout, bool from_mp, void* data_rem);
 
+extern bool lteppp_register_urc (const char *prefix, lteppp_urc_handler_t handler, void *arg);
+
 lte_modem_conn_state_t lteppp_modem_state(void);
 
 extern void connect_lte_uart (void);
@@ -125,6 +163,22 @@ extern void lteppp_suspend(void);
 extern void lteppp_resume(void);
 
 extern void lteppp_set_default_inf(void);
+
+extern struct netif *lteppp_get_netif(void);
+
+extern uint32_t lteppp_get_baudrate(void);
+
+extern uint32_t lteppp_get_up_ticks(void);
+
+extern void lteppp_set_attach_watch(bool enable);
+
+extern bool lteppp_take_attach_watch(void);
+
+extern void lteppp_pause_background(bool pause);
+
+extern void lteppp_get_link_stats(lte_link_stats_t *stats);
+
+extern bool lteppp_cmux_active(void);
 #ifdef LTE_DEBUG_BUFF
 extern char* lteppp_get_log_buff(void);
 #endif
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+#include "tcpip_adapter.h"
+
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/netifapi.h"
+
+#include "py/mpconfig.h"
+#include "py/obj.h"
+#include "modnetwork.h"
+#include "lteppp.h"
+#include "netfailover.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// a query for the NS records of the root zone, the id is filled in per probe
+static const uint8_t netfailover_probe_query[] = {
+    0x00, 0x00,                 // id
+    0x01, 0x00,                 // standard query, recursion desired
+    0x00, 0x01,                 // one question
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00,                       // the root name
+    0x00, 0x02,                 // NS
+    0x00, 0x01,                 // IN
+};
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static netfailover_config_t netfailover_config = {
+    .enabled = false,
+    .priority = { E_NETFAILOVER_WLAN, E_NETFAILOVER_LTE },
+    .fails = NETFAILOVER_PROBE_FAILS_DEF,
+    .period_ms = NETFAILOVER_PROBE_PERIOD_MS_DEF,
+    .probe_port = NETFAILOVER_PROBE_PORT_DEF,
+};
+static netfailover_inf_stats_t netfailover_infs[E_NETFAILOVER_NUM_INFS];
+static volatile netfailover_inf_t netfailover_current = E_NETFAILOVER_NUM_INFS;
+static uint32_t netfailover_switch_count;
+static volatile bool netfailover_eval_pending;
+static TimerHandle_t netfailover_timer;
+
+// only touched from the lwIP thread
+static struct udp_pcb *netfailover_pcb;
+static uint16_t netfailover_seq;
+static uint16_t netfailover_pending[E_NETFAILOVER_NUM_INFS];    // id of the unanswered probe, 0 for none
+static int64_t netfailover_sent_at[E_NETFAILOVER_NUM_INFS];
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+static struct netif *netfailover_get_netif(netfailover_inf_t inf) {
+    struct netif *netif = NULL;
+    if (inf == E_NETFAILOVER_WLAN) {
+        if (tcpip_adapter_get_netif(TCPIP_ADAPTER_IF_STA, (void **)&netif) != ESP_OK) {
+            return NULL;
+        }
+    } else {
+        netif = lteppp_get_netif();
+    }
+    return netif;
+}
+
+// runs in the timer task, the netifapi calls block until the lwIP thread has done them
+static void netfailover_evaluate(void *arg1, uint32_t arg2) {
+    netfailover_eval_pending = false;
+    if (!netfailover_config.enabled) {
+        return;
+    }
+
+    netfailover_inf_t best = E_NETFAILOVER_NUM_INFS;
+    for (int i = 0; i < E_NETFAILOVER_NUM_INFS; i++) {
+        netfailover_inf_t inf = netfailover_config.priority[i];
+        if (netfailover_infs[inf].link_up && netfailover_infs[inf].healthy) {
+            best = inf;
+            break;
+        }
+    }
+    if (best == netfailover_current) {
+        return;
+    }
+    if (best == E_NETFAILOVER_NUM_INFS) {
+        // nothing better to go to, the route stays until one of them comes back
+        netfailover_current = best;
+        return;
+    }
+
+    struct netif *netif = netfailover_get_netif(best);
+    if (netif == NULL) {
+        return;
+    }
+    if (best == E_NETFAILOVER_WLAN) {
+        // brings back the DNS servers of the station
+        mod_network_nic_type_wlan.set_default_inf();
+        netifapi_netif_set_default(netif);
+    } else {
+        lteppp_set_default_inf();
+    }
+    netfailover_current = best;
+    netfailover_switch_count++;
+}
+
+static void netfailover_schedule(void) {
+    if (!netfailover_eval_pending) {
+        netfailover_eval_pending = true;
+        if (xTimerPendFunctionCall(netfailover_evaluate, NULL, 0, 0) != pdPASS) {
+            netfailover_eval_pending = false;
+        }
+    }
+}
+
+static void netfailover_probe_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    if (p->len >= 2) {
+        uint16_t id = (((uint8_t *)p->payload)[0] << 8) | ((uint8_t *)p->payload)[1];
+        for (int inf = 0; inf < E_NETFAILOVER_NUM_INFS; inf++) {
+            if (netfailover_pending[inf] && netfailover_pending[inf] == id) {
+                netfailover_inf_stats_t *stats = &netfailover_infs[inf];
+                netfailover_pending[inf] = 0;
+                stats->answers++;
+                stats->rtt_ms = (esp_timer_get_time() - netfailover_sent_at[inf]) / 1000;
+                stats->missed = 0;
+                if (!stats->healthy) {
+                    stats->healthy = true;
+                    netfailover_schedule();
+                }
+            }
+        }
+    }
+    pbuf_free(p);
+}
+
+// runs in the lwIP thread, one probe per interface, each sent out of its own netif
+static void netfailover_probe_send(void *ctx) {
+    if (netfailover_pcb == NULL) {
+        netfailover_pcb = udp_new();
+        if (netfailover_pcb == NULL) {
+            return;
+        }
+        udp_bind(netfailover_pcb, IP_ADDR_ANY, 0);
+        udp_recv(netfailover_pcb, netfailover_probe_recv, NULL);
+    }
+
+    for (int inf = 0; inf < E_NETFAILOVER_NUM_INFS; inf++) {
+        netfailover_inf_stats_t *stats = &netfailover_infs[inf];
+        if (netfailover_pending[inf]) {
+            // the previous one was never answered
+            netfailover_pending[inf] = 0;
+            if (++stats->missed >= netfailover_config.fails && stats->healthy) {
+                stats->healthy = false;
+                netfailover_schedule();
+            }
+        }
+        struct netif *netif;
+        if (!stats->link_up || (netif = netfailover_get_netif(inf)) == NULL || !netif_is_up(netif)) {
+            continue;
+        }
+
+        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, sizeof(netfailover_probe_query), PBUF_RAM);
+        if (p == NULL) {
+            continue;
+        }
+        if (++netfailover_seq == 0) {
+            netfailover_seq = 1;
+        }
+        memcpy(p->payload, netfailover_probe_query, sizeof(netfailover_probe_query));
+        ((uint8_t *)p->payload)[0] = netfailover_seq >> 8;
+        ((uint8_t *)p->payload)[1] = netfailover_seq;
+        netfailover_sent_at[inf] = esp_timer_get_time();
+        if (udp_sendto_if(netfailover_pcb, p, &netfailover_config.probe_ip, netfailover_config.probe_port, netif) == ERR_OK) {
+            netfailover_pending[inf] = netfailover_seq;
+            stats->probes++;
+        }
+        pbuf_free(p);
+    }
+}
+
+static void netfailover_timer_callback(TimerHandle_t xTimer) {
+    if (netfailover_config.enabled && !ip_addr_isany_val(netfailover_config.probe_ip)) {
+        tcpip_callback(netfailover_probe_send, NULL);
+    }
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void netfailover_link_event(netfailover_inf_t inf, bool up) {
+    if (inf >= E_NETFAILOVER_NUM_INFS) {
+        return;
+    }
+    // recorded even while disabled, so that enabling it starts from the right state
+    netfailover_infs[inf].link_up = up;
+    if (up) {
+        netfailover_infs[inf].healthy = true;
+        netfailover_infs[inf].missed = 0;
+    }
+    if (netfailover_config.enabled) {
+        netfailover_schedule();
+    }
+}
+
+void netfailover_configure(const netfailover_config_t *config) {
+    if (netfailover_timer == NULL) {
+        netfailover_timer = xTimerCreate("NetFailover", config->period_ms / portTICK_PERIOD_MS, pdTRUE, NULL, netfailover_timer_callback);
+    }
+    netfailover_config = *config;
+    xTimerChangePeriod(netfailover_timer, config->period_ms / portTICK_PERIOD_MS, 0);
+    if (config->enabled) {
+        xTimerStart(netfailover_timer, 0);
+        // the route may have been moved by someone else meanwhile
+        netfailover_current = E_NETFAILOVER_NUM_INFS;
+        netfailover_schedule();
+    } else {
+        xTimerStop(netfailover_timer, 0);
+    }
+}
+
+void netfailover_get_config(netfailover_config_t *config) {
+    *config = netfailover_config;
+}
+
+void netfailover_get_stats(netfailover_inf_t inf, netfailover_inf_stats_t *stats) {
+    if (inf < E_NETFAILOVER_NUM_INFS) {
+        *stats = netfailover_infs[inf];
+    }
+}
+
+netfailover_inf_t netfailover_active(void) {
+    return netfailover_current;
+}
+
+uint32_t netfailover_switches(void) {
+    return netfailover_switch_count;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef ESP32_LTE_NETFAILOVER_H_
+#define ESP32_LTE_NETFAILOVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lwip/ip_addr.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define NETFAILOVER_PROBE_PERIOD_MS_DEF         (5000)
+#define NETFAILOVER_PROBE_PERIOD_MS_MIN         (500)
+#define NETFAILOVER_PROBE_FAILS_DEF             (3)
+#define NETFAILOVER_PROBE_PORT_DEF              (53)        // a DNS query, any answer counts
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    E_NETFAILOVER_WLAN = 0,
+    E_NETFAILOVER_LTE,
+    E_NETFAILOVER_NUM_INFS
+} netfailover_inf_t;
+
+typedef struct {
+    bool                link_up;        // as reported by the WLAN and PPP events
+    bool                healthy;        // the probes answered, true until fails in a row are missed
+    uint8_t             missed;         // probes in a row without an answer
+    uint32_t            rtt_ms;         // of the last answered probe
+    uint32_t            probes;
+    uint32_t            answers;
+} netfailover_inf_stats_t;
+
+typedef struct {
+    bool                enabled;
+    uint8_t             priority[E_NETFAILOVER_NUM_INFS];   // the first usable one is the default route
+    uint8_t             fails;
+    uint32_t            period_ms;
+    ip_addr_t           probe_ip;       // IPADDR_ANY disables the probes, only the link state counts
+    uint16_t            probe_port;
+} netfailover_config_t;
+
+/******************************************************************************
+ DECLARE PUBLIC FUNCTIONS
+ ******************************************************************************/
+// may be called from any task, the lwIP thread included
+extern void netfailover_link_event(netfailover_inf_t inf, bool up);
+
+extern void netfailover_configure(const netfailover_config_t *config);
+extern void netfailover_get_config(netfailover_config_t *config);
+extern void netfailover_get_stats(netfailover_inf_t inf, netfailover_inf_stats_t *stats);
+// E_NETFAILOVER_NUM_INFS while none of the interfaces is usable
+extern netfailover_inf_t netfailover_active(void);
+extern uint32_t netfailover_switches(void);
+
+#endif /* ESP32_LTE_NETFAILOVER_H_ */
@@ -51,6 +51,7 @@
 #include "mperror.h"
 #include "machtimer.h"
 #include "esp32chipinfo.h"
+#include "boottime.h"
 
 
 TaskHandle_t mpTaskHandle;
@@ -108,6 +109,8 @@ static StaticTask_t mpTaskTCB;
 *******************************************************************************/
 void app_main(void) {
 
+    boottime_init0();
+
     esp32_init_chip_info();
 
     // remove all the logs from the IDF
@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "py/mpconfig.h"
 #include "py/obj.h"
@@ -29,15 +30,35 @@
 #include "mpexception.h"
 #include "antenna.h"
 #include "modussl.h"
+#include "mptrace.h"
+#include "mpmetrics.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
 
 #include "lwip/sockets.h"
 #include "lwip/dns.h"
 #include "lwip/netdb.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/priv/tcp_priv.h"
 #include "lwipsocket.h"
+#include "extmod/moduselect.h"
 
 
 #define WLAN_MAX_RX_SIZE                    2048
 #define WLAN_MAX_TX_SIZE                    1476
+// a socket with a larger SO_RCVBUF may be drained in bigger reads
+#define LWIPSOCKET_RX_SIZE(s)               MAX(WLAN_MAX_RX_SIZE, (s)->sock_base.rx_size)
+// longest wait on the sockets while other objects are polled too, for the drivers signalling from an ISR
+#define LWIPSOCKET_POLL_SLICE_MS            10
+
+// longer host names are resolved every time
+#define LWIPSOCKET_DNS_NAME_MAX             64
+#define LWIPSOCKET_DNS_CACHE_SIZE_DEFAULT   8
+#define LWIPSOCKET_DNS_TTL_DEFAULT_S        300
+#define LWIPSOCKET_DNS_NEG_TTL_DEFAULT_S    10
 
 #define MAKE_SOCKADDR(addr, ip, port)       struct sockaddr addr; \
                                             addr.sa_family = AF_INET; \
@@ -54,18 +75,295 @@
                                             ip[2] = addr.sa_data[3]; \
                                             ip[3] = addr.sa_data[2];
 
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    char        name[LWIPSOCKET_DNS_NAME_MAX];
+    uint32_t    addr;       // IPv4 address in network order
+    int32_t     error;      // resolver error of a negative entry, 0 otherwise
+    uint32_t    expires;    // ms tick after which the entry must be resolved again
+    uint32_t    used;       // ms tick of the last hit, the oldest one is replaced first
+} lwipsocket_dns_entry_t;
+
+typedef struct {
+    lwipsocket_dns_entry_t  *entries;
+    SemaphoreHandle_t       mutex;
+    uint32_t                size;
+    uint32_t                ttl_ms;
+    uint32_t                neg_ttl_ms;
+    uint32_t                hits;
+    uint32_t                misses;
+} lwipsocket_dns_cache_t;
+
+typedef struct {
+    struct tcpip_api_call_data  call;
+    lwipsocket_net_stats_t      *stats;
+} lwipsocket_pcb_call_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC lwipsocket_dns_cache_t lwipsocket_dns_cache;
+// the lwIP of the IDF is built without LWIP_STATS, what can't be read from its PCB lists is counted here
+STATIC struct {
+    uint32_t    socket_errors;
+    uint32_t    nomem;
+} lwipsocket_counters;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// must be called with the cache mutex taken
+STATIC lwipsocket_dns_entry_t *lwipsocket_dns_find(const char *name, uint32_t now) {
+    for (uint32_t i = 0; i < lwipsocket_dns_cache.size; i++) {
+        lwipsocket_dns_entry_t *e = &lwipsocket_dns_cache.entries[i];
+        if (e->name[0] != '\0' && strcasecmp(e->name, name) == 0) {
+            if ((int32_t)(e->expires - now) > 0) {
+                return e;
+            }
+            // expired, give the slot back
+            e->name[0] = '\0';
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// must be called with the cache mutex taken
+STATIC void lwipsocket_dns_store(const char *name, uint32_t addr, int32_t error, uint32_t now) {
+    uint32_t ttl_ms = (error == 0) ? lwipsocket_dns_cache.ttl_ms : lwipsocket_dns_cache.neg_ttl_ms;
+    if (lwipsocket_dns_cache.size == 0 || ttl_ms == 0) {
+        return;
+    }
+    lwipsocket_dns_entry_t *slot = NULL;
+    for (uint32_t i = 0; i < lwipsocket_dns_cache.size; i++) {
+        lwipsocket_dns_entry_t *e = &lwipsocket_dns_cache.entries[i];
+        if (e->name[0] == '\0' || (int32_t)(e->expires - now) <= 0 || strcasecmp(e->name, name) == 0) {
+            slot = e;
+            break;
+        }
+        if (slot == NULL || (int32_t)(e->used - slot->used) < 0) {
+            slot = e;
+        }
+    }
+    strcpy(slot->name, name);
+    slot->addr = addr;
+    slot->error = error;
+    slot->expires = now + ttl_ms;
+    slot->used = now;
+}
+
+STATIC void lwipsocket_count_error(int error, uint32_t *counter) {
+    if (error == ENOMEM || error == ENOBUFS || error == ENFILE) {
+        (*counter)++;
+    }
+}
+
+// runs in the tcpip thread, the only one allowed to walk the PCB lists
+STATIC err_t lwipsocket_pcb_count(struct tcpip_api_call_data *call) {
+    lwipsocket_net_stats_t *stats = ((lwipsocket_pcb_call_t *)call)->stats;
+    for (struct tcp_pcb *pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+        stats->tcp_active++;
+        stats->tcp_queued += pcb->snd_queuelen;
+        if (pcb->nrtx > 0) {
+            stats->tcp_retransmitting++;
+            stats->tcp_nrtx += pcb->nrtx;
+        }
+    }
+    for (struct tcp_pcb_listen *pcb = tcp_listen_pcbs.listen_pcbs; pcb != NULL; pcb = pcb->next) {
+        stats->tcp_listen++;
+    }
+    for (struct tcp_pcb *pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+        stats->tcp_time_wait++;
+    }
+    for (struct udp_pcb *pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+        stats->udp++;
+    }
+    return ERR_OK;
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void lwipsocket_net_stats(lwipsocket_net_stats_t *stats, bool reset) {
+    memset(stats, 0, sizeof(*stats));
+    lwipsocket_pcb_call_t call = { .stats = stats };
+    tcpip_api_call(lwipsocket_pcb_count, &call.call);
+    stats->socket_errors = lwipsocket_counters.socket_errors;
+    stats->nomem = lwipsocket_counters.nomem;
+    if (reset) {
+        lwipsocket_counters.socket_errors = 0;
+        lwipsocket_counters.nomem = 0;
+    }
+}
+
+STATIC void lwipsocket_metrics_collect(uint32_t *values) {
+    lwipsocket_net_stats_t stats;
+    lwipsocket_net_stats(&stats, false);
+    values[0] = stats.tcp_active;
+    values[1] = stats.tcp_listen;
+    values[2] = stats.tcp_time_wait;
+    values[3] = stats.tcp_retransmitting;
+    values[4] = stats.tcp_queued;
+    values[5] = stats.udp;
+    values[6] = stats.socket_errors;
+    values[7] = stats.nomem;
+    uint32_t entries;
+    lwipsocket_dns_stats(&values[8], &values[9], &entries, false);
+}
+
+STATIC const mpmetrics_desc_t lwipsocket_metrics[] = {
+    { "tcp_active",         E_MPMETRICS_GAUGE },
+    { "tcp_listen",         E_MPMETRICS_GAUGE },
+    { "tcp_time_wait",      E_MPMETRICS_GAUGE },
+    { "tcp_retransmitting", E_MPMETRICS_GAUGE },
+    { "tcp_queued",         E_MPMETRICS_GAUGE },
+    { "udp",                E_MPMETRICS_GAUGE },
+    { "socket_errors",      E_MPMETRICS_COUNTER },
+    { "nomem",              E_MPMETRICS_COUNTER },
+    { "dns_hits",           E_MPMETRICS_COUNTER },
+    { "dns_misses",         E_MPMETRICS_COUNTER },
+};
+STATIC mpmetrics_source_t lwipsocket_metrics_source = {
+    .name = "net",
+    .metrics = lwipsocket_metrics,
+    .n_metrics = MP_ARRAY_SIZE(lwipsocket_metrics),
+    .collect = lwipsocket_metrics_collect,
+};
+
+void lwipsocket_dns_init(void) {
+    lwipsocket_dns_cache.mutex = xSemaphoreCreateMutex();
+    lwipsocket_dns_cache.ttl_ms = LWIPSOCKET_DNS_TTL_DEFAULT_S * 1000;
+    lwipsocket_dns_cache.neg_ttl_ms = LWIPSOCKET_DNS_NEG_TTL_DEFAULT_S * 1000;
+    lwipsocket_dns_config(LWIPSOCKET_DNS_CACHE_SIZE_DEFAULT, lwipsocket_dns_cache.ttl_ms, lwipsocket_dns_cache.neg_ttl_ms);
+}
+
+void lwipsocket_metrics_init(void) {
+    mpmetrics_register(&lwipsocket_metrics_source);
+}
+
+bool lwipsocket_dns_config(uint32_t size, uint32_t ttl_ms, uint32_t neg_ttl_ms) {
+    xSemaphoreTake(lwipsocket_dns_cache.mutex, portMAX_DELAY);
+    bool ok = true;
+    if (size != lwipsocket_dns_cache.size) {
+        lwipsocket_dns_entry_t *entries = NULL;
+        if (size > 0) {
+            entries = heap_caps_malloc(size * sizeof(lwipsocket_dns_entry_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        if (size > 0 && entries == NULL) {
+            // keep the current table
+            ok = false;
+        } else {
+            if (entries) {
+                memset(entries, 0, size * sizeof(lwipsocket_dns_entry_t));
+            }
+            free(lwipsocket_dns_cache.entries);
+            lwipsocket_dns_cache.entries = entries;
+            lwipsocket_dns_cache.size = size;
+        }
+    }
+    lwipsocket_dns_cache.ttl_ms = ttl_ms;
+    lwipsocket_dns_cache.neg_ttl_ms = neg_ttl_ms;
+    xSemaphoreGive(lwipsocket_dns_cache.mutex);
+    return ok;
+}
+
+void lwipsocket_dns_get_config(uint32_t *size, uint32_t *ttl_ms, uint32_t *neg_ttl_ms) {
+    *size = lwipsocket_dns_cache.size;
+    *ttl_ms = lwipsocket_dns_cache.ttl_ms;
+    *neg_ttl_ms = lwipsocket_dns_cache.neg_ttl_ms;
+}
+
+void lwipsocket_dns_flush(void) {
+    xSemaphoreTake(lwipsocket_dns_cache.mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < lwipsocket_dns_cache.size; i++) {
+        lwipsocket_dns_cache.entries[i].name[0] = '\0';
+    }
+    xSemaphoreGive(lwipsocket_dns_cache.mutex);
+}
+
+void lwipsocket_dns_stats(uint32_t *hits, uint32_t *misses, uint32_t *entries, bool reset) {
+    uint32_t now = mp_hal_ticks_ms();
+    xSemaphoreTake(lwipsocket_dns_cache.mutex, portMAX_DELAY);
+    *hits = lwipsocket_dns_cache.hits;
+    *misses = lwipsocket_dns_cache.misses;
+    *entries = 0;
+    for (uint32_t i = 0; i < lwipsocket_dns_cache.size; i++) {
+        lwipsocket_dns_entry_t *e = &lwipsocket_dns_cache.entries[i];
+        if (e->name[0] != '\0' && (int32_t)(e->expires - now) > 0) {
+            (*entries)++;
+        }
+    }
+    if (reset) {
+        lwipsocket_dns_cache.hits = 0;
+        lwipsocket_dns_cache.misses = 0;
+    }
+    xSemaphoreGive(lwipsocket_dns_cache.mutex);
+}
+
+// blocks for the whole DNS query on a miss, so it must be called without the GIL
+// returns 0 or the getaddrinfo() error code
+int lwipsocket_dns_resolve(const char *name, uint32_t *addr) {
+    ip4_addr_t literal;
+    size_t len = strlen(name);
+    bool cacheable = len > 0 && len < LWIPSOCKET_DNS_NAME_MAX && !ip4addr_aton(name, &literal);
+
+    if (cacheable) {
+        uint32_t now = mp_hal_ticks_ms();
+        xSemaphoreTake(lwipsocket_dns_cache.mutex, portMAX_DELAY);
+        lwipsocket_dns_entry_t *e = lwipsocket_dns_find(name, now);
+        int32_t error = 0;
+        if (e) {
+            lwipsocket_dns_cache.hits++;
+            e->used = now;
+            *addr = e->addr;
+            error = e->error;
+        } else {
+            lwipsocket_dns_cache.misses++;
+        }
+        xSemaphoreGive(lwipsocket_dns_cache.mutex);
+        if (e) {
+            return error;
+        }
+    }
+
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo *res = NULL;
+    int32_t error = lwip_getaddrinfo(name, NULL, &hints, &res);
+    if (error == 0 && res == NULL) {
+        error = EAI_FAIL;
+    }
+    uint32_t ip = 0;
+    if (error == 0) {
+        ip = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+        lwip_freeaddrinfo(res);
+    }
+
+    // only an answer is worth remembering, not running out of memory
+    if (cacheable && (error == 0 || error == EAI_FAIL || error == EAI_NONAME)) {
+        xSemaphoreTake(lwipsocket_dns_cache.mutex, portMAX_DELAY);
+        lwipsocket_dns_store(name, ip, error, mp_hal_ticks_ms());
+        xSemaphoreGive(lwipsocket_dns_cache.mutex);
+    }
+    *addr = ip;
+    return error;
+}
+
 //
 ///******************************************************************************/
 //// Micro Python bindings; LWIP socket
 
 int lwipsocket_gethostbyname(const char *name, mp_uint_t len, uint8_t *out_ip, mp_uint_t family) {
     uint32_t ip;
-    struct hostent *h = gethostbyname(name);
-    if (h == NULL) {
+    int error = lwipsocket_dns_resolve(name, &ip);
+    if (error != 0) {
         // CPython: socket.herror
-        return -errno;
+        return -error;
     }
-    ip = *(uint32_t*)*h->h_addr_list;
     out_ip[0] = ip;
     out_ip[1] = ip >> 8;
     out_ip[2] = ip >> 16;
@@ -77,6 +375,7 @@ int lwipsocket_socket_socket(mod_network_socket_obj_t *s, int *_errno) {
     int32_t sd = socket(s->sock_base.u.u_param.domain, s->sock_base.u.u_param.type, s->sock_base.u.u_param.proto);
     if (sd < 0) {
         *_errno = errno;
+        lwipsocket_count_error(*_errno, &lwipsocket_counters.socket_errors);
         return -1;
     }
 
@@ -135,11 +434,14 @@ int lwipsocket_socket_accept(mod_network_socket_obj_t *s, mod_network_socket_obj
     struct sockaddr addr;
     socklen_t addr_len = sizeof(addr);
 
+    MPTRACE(MPTRACE_SOCK_ACCEPT_START, s->sock_base.u.sd, 0);
     sd = lwip_accept_r(s->sock_base.u.sd, &addr, &addr_len);
+    MPTRACE(MPTRACE_SOCK_ACCEPT_END, s->sock_base.u.sd, sd);
     // save the socket descriptor
     s2->sock_base.u.sd = sd;
     if (sd < 0) {
         *_errno = errno;
+        lwipsocket_count_error(*_errno, &lwipsocket_counters.socket_errors);
         return -1;
     }
 
@@ -152,17 +454,21 @@ int lwipsocket_socket_accept(mod_network_socket_obj_t *s, mod_network_socket_obj
 
 int lwipsocket_socket_connect(mod_network_socket_obj_t *s, byte *ip, mp_uint_t port, int *_errno) {
     MAKE_SOCKADDR(addr, ip, port)
+    MPTRACE(MPTRACE_SOCK_CONNECT_START, s->sock_base.u.sd, 0);
     int ret = lwip_connect_r(s->sock_base.u.sd, &addr, sizeof(addr));
+    MPTRACE(MPTRACE_SOCK_CONNECT_END, s->sock_base.u.sd, ret);
 
     if (ret != 0) {
         // printf("Connect returned -0x%x\n", -ret);
         *_errno = errno;
+        lwipsocket_count_error(*_errno, &lwipsocket_counters.nomem);
         return -1;
     }
 
     // printf("Connected.\n");
 
-    if (s->sock_base.is_ssl && (ret == 0)) {
+    // on a non-blocking socket the handshake is left to do_handshake()
+    if (s->sock_base.is_ssl && (ret == 0) && s->sock_base.timeout != 0) {
 
         ret = lwipsocket_socket_setup_ssl(s, _errno);
     }
@@ -174,6 +480,7 @@ int lwipsocket_socket_connect(mod_network_socket_obj_t *s, byte *ip, mp_uint_t p
 int lwipsocket_socket_send(mod_network_socket_obj_t *s, const byte *buf, mp_uint_t len, int *_errno) {
     mp_int_t bytes = 0;
     if (len > 0) {
+        MPTRACE(MPTRACE_SOCK_SEND_START, s->sock_base.u.sd, len);
         if (s->sock_base.is_ssl) {
             mp_obj_ssl_socket_t *ss = (mp_obj_ssl_socket_t *)s;
             while ((bytes = mbedtls_ssl_write(&ss->ssl, (const unsigned char *)buf, len)) <= 0) {
@@ -181,6 +488,7 @@ int lwipsocket_socket_send(mod_network_socket_obj_t *s, const byte *buf, mp_uint
                     // printf("mbedtls_ssl_write returned -0x%x\n", -bytes);
                     break;
                 } else {
+                    MPTRACE(MPTRACE_SOCK_SEND_END, s->sock_base.u.sd, -MP_EAGAIN);
                     *_errno = MP_EAGAIN;
                     return -1;
                 }
@@ -188,9 +496,11 @@ int lwipsocket_socket_send(mod_network_socket_obj_t *s, const byte *buf, mp_uint
         } else {
             bytes = lwip_send_r(s->sock_base.u.sd, (const void *)buf, len, 0);
         }
+        MPTRACE(MPTRACE_SOCK_SEND_END, s->sock_base.u.sd, bytes);
     }
     if (bytes <= 0) {
         *_errno = errno;
+        lwipsocket_count_error(*_errno, &lwipsocket_counters.nomem);
         return -1;
     }
     return bytes;
@@ -201,9 +511,15 @@ int lwipsocket_socket_recv(mod_network_socket_obj_t *s, byte *buf, mp_uint_t len
     if (s->sock_base.is_ssl) {
         mp_obj_ssl_socket_t *ss = (mp_obj_ssl_socket_t *)s;
         do {
+            MPTRACE(MPTRACE_SOCK_RECV_START, s->sock_base.u.sd, len);
             ret = mbedtls_ssl_read(&ss->ssl, (unsigned char *)buf, len);
+            MPTRACE(MPTRACE_SOCK_RECV_END, s->sock_base.u.sd, ret);
             if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE ) {
-                // do nothing
+                // non-blocking return, there's no complete record yet
+                if (s->sock_base.timeout == 0) {
+                    *_errno = MP_EAGAIN;
+                    return -1;
+                }
             } else if (ret == MBEDTLS_ERR_SSL_TIMEOUT) {
                 // printf("SSL timeout recieved\n");
                 // non-blocking return
@@ -237,7 +553,9 @@ int lwipsocket_socket_recv(mod_network_socket_obj_t *s, byte *buf, mp_uint_t len
             return -1;
         }
     } else {
-        ret = lwip_recv_r(s->sock_base.u.sd, buf, MIN(len, WLAN_MAX_RX_SIZE), 0);
+        MPTRACE(MPTRACE_SOCK_RECV_START, s->sock_base.u.sd, len);
+        ret = lwip_recv_r(s->sock_base.u.sd, buf, MIN(len, LWIPSOCKET_RX_SIZE(s)), 0);
+        MPTRACE(MPTRACE_SOCK_RECV_END, s->sock_base.u.sd, ret);
         if (ret < 0) {
             *_errno = errno;
             return -1;
@@ -249,9 +567,12 @@ int lwipsocket_socket_recv(mod_network_socket_obj_t *s, byte *buf, mp_uint_t len
 int lwipsocket_socket_sendto( mod_network_socket_obj_t *s, const byte *buf, mp_uint_t len, byte *ip, mp_uint_t port, int *_errno) {
     if (len > 0) {
         MAKE_SOCKADDR(addr, ip, port)
+        MPTRACE(MPTRACE_SOCK_SEND_START, s->sock_base.u.sd, len);
         int ret = lwip_sendto_r(s->sock_base.u.sd, (byte*)buf, len, 0, (struct sockaddr*)&addr, sizeof(addr));
+        MPTRACE(MPTRACE_SOCK_SEND_END, s->sock_base.u.sd, ret);
         if (ret < 0) {
             *_errno = errno;
+            lwipsocket_count_error(*_errno, &lwipsocket_counters.nomem);
             return -1;
         }
         return ret;
@@ -262,7 +583,9 @@ int lwipsocket_socket_sendto( mod_network_socket_obj_t *s, const byte *buf, mp_u
 int lwipsocket_socket_recvfrom(mod_network_socket_obj_t *s, byte *buf, mp_uint_t len, byte *ip, mp_uint_t *port, int *_errno) {
     struct sockaddr addr;
     socklen_t addr_len = sizeof(addr);
-    mp_int_t ret = lwip_recvfrom_r(s->sock_base.u.sd, buf, MIN(len, WLAN_MAX_RX_SIZE), 0, &addr, &addr_len);
+    MPTRACE(MPTRACE_SOCK_RECV_START, s->sock_base.u.sd, len);
+    mp_int_t ret = lwip_recvfrom_r(s->sock_base.u.sd, buf, MIN(len, LWIPSOCKET_RX_SIZE(s)), 0, &addr, &addr_len);
+    MPTRACE(MPTRACE_SOCK_RECV_END, s->sock_base.u.sd, ret);
     if (ret < 0) {
         *_errno = errno;
         return -1;
@@ -271,15 +594,105 @@ int lwipsocket_socket_recvfrom(mod_network_socket_obj_t *s, byte *buf, mp_uint_t
     return ret;
 }
 
+int lwipsocket_socket_sendmsg(mod_network_socket_obj_t *s, const mp_buffer_info_t *bufs, mp_uint_t n_bufs, byte *ip, mp_uint_t port, int *_errno) {
+    if (s->sock_base.is_ssl) {
+        // mbedtls builds its own records, write the fragments one after the other
+        int total = 0;
+        for (mp_uint_t i = 0; i < n_bufs; i++) {
+            if (bufs[i].len == 0) {
+                continue;
+            }
+            int ret = lwipsocket_socket_send(s, bufs[i].buf, bufs[i].len, _errno);
+            if (ret < 0) {
+                return (total > 0) ? total : -1;
+            }
+            total += ret;
+            if ((mp_uint_t)ret < bufs[i].len) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    struct iovec iov[MOD_USOCKET_SENDMSG_IOV_MAX];
+    for (mp_uint_t i = 0; i < n_bufs; i++) {
+        iov[i].iov_base = bufs[i].buf;
+        iov[i].iov_len = bufs[i].len;
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n_bufs;
+    struct sockaddr addr;
+    if (ip) {
+        MAKE_SOCKADDR(to, ip, port)
+        addr = to;
+        msg.msg_name = &addr;
+        msg.msg_namelen = sizeof(addr);
+    }
+    // lwIP chains the fragments into one segment (TCP) or one datagram (UDP)
+    MPTRACE(MPTRACE_SOCK_SEND_START, s->sock_base.u.sd, n_bufs);
+    int ret = lwip_sendmsg_r(s->sock_base.u.sd, &msg, 0);
+    MPTRACE(MPTRACE_SOCK_SEND_END, s->sock_base.u.sd, ret);
+    if (ret < 0) {
+        *_errno = errno;
+        lwipsocket_count_error(*_errno, &lwipsocket_counters.nomem);
+        return -1;
+    }
+    return ret;
+}
+
 int lwipsocket_socket_setsockopt(mod_network_socket_obj_t *s, mp_uint_t level, mp_uint_t opt, const void *optval, mp_uint_t optlen, int *_errno) {
+    if (level == SOL_SOCKET && opt == SO_SNDBUF) {
+        // lwIP shares one send buffer size (TCP_SND_BUF) between all the sockets, accept the
+        // request like other stacks do when clamping it, getsockopt() reports the real size
+        if (optlen != sizeof(mp_int_t) || *(const mp_int_t *)optval <= 0) {
+            *_errno = MP_EINVAL;
+            return -1;
+        }
+        return 0;
+    }
     int ret = lwip_setsockopt_r(s->sock_base.u.sd, level, opt, optval, optlen);
     if (ret < 0) {
         *_errno = errno;
         return -1;
     }
+    if (level == SOL_SOCKET && opt == SO_RCVBUF && optlen == sizeof(mp_int_t)) {
+        s->sock_base.rx_size = MAX(0, *(const mp_int_t *)optval);
+    }
+    return 0;
+}
+
+int lwipsocket_socket_getsockopt(mod_network_socket_obj_t *s, mp_uint_t level, mp_uint_t opt, mp_int_t *optval, int *_errno) {
+    if (level == SOL_SOCKET && opt == SO_SNDBUF) {
+        *optval = TCP_SND_BUF;
+        return 0;
+    }
+    int val = 0;
+    socklen_t len = sizeof(val);
+    if (lwip_getsockopt_r(s->sock_base.u.sd, level, opt, &val, &len) < 0) {
+        *_errno = errno;
+        return -1;
+    }
+    *optval = val;
     return 0;
 }
 
+/*
+ * the non-blocking bio returns WANT_READ/WANT_WRITE, the blocking one waits with the configured read timeout
+ */
+STATIC int lwipsocket_ssl_set_bio(mp_obj_ssl_socket_t *ss, bool nonblock) {
+    int ret;
+    if (nonblock) {
+        ret = mbedtls_net_set_nonblock(&ss->context_fd);
+        mbedtls_ssl_set_bio(&ss->ssl, &ss->context_fd, mbedtls_net_send, mbedtls_net_recv, NULL);
+    } else {
+        ret = mbedtls_net_set_block(&ss->context_fd);
+        mbedtls_ssl_set_bio(&ss->ssl, &ss->context_fd, mbedtls_net_send, NULL, mbedtls_net_recv_timeout);
+    }
+    return ret;
+}
+
 int lwipsocket_socket_settimeout(mod_network_socket_obj_t *s, mp_int_t timeout_ms, int *_errno) {
     int ret;
 
@@ -287,6 +700,10 @@ int lwipsocket_socket_settimeout(mod_network_socket_obj_t *s, mp_int_t timeout_m
        mp_obj_ssl_socket_t *ss = (mp_obj_ssl_socket_t *)s;
        // mbedtls_net_recv_timeout() API is registered with mbedtls_ssl_set_bio() so setting timeout on receive works
        mbedtls_ssl_conf_read_timeout(&ss->conf, timeout_ms);
+       if ((ret = lwipsocket_ssl_set_bio(ss, timeout_ms == 0)) != 0) {
+           *_errno = ret;
+           return -1;
+       }
     }
     else {
         uint32_t option = lwip_fcntl_r(s->sock_base.u.sd, F_GETFL, 0);
@@ -330,6 +747,13 @@ int lwipsocket_socket_ioctl (mod_network_socket_obj_t *s, mp_uint_t request, mp_
         ret = 0;
         int32_t sd = s->sock_base.u.sd;
 
+        // mbedTLS may hold the rest of a record already read from the socket
+        if (s->sock_base.is_ssl && (flags & MP_STREAM_POLL_RD) &&
+            mbedtls_ssl_get_bytes_avail(&((mp_obj_ssl_socket_t *)s)->ssl) > 0) {
+            ret |= MP_STREAM_POLL_RD;
+            flags &= ~MP_STREAM_POLL_RD;
+        }
+
         // init fds
         fd_set rfds, wfds, xfds;
         FD_ZERO(&rfds);
@@ -376,23 +800,112 @@ int lwipsocket_socket_ioctl (mod_network_socket_obj_t *s, mp_uint_t request, mp_
     return ret;
 }
 
+bool lwipsocket_is_lwip(mod_network_socket_obj_t *s) {
+    return s->sock_base.nic_type != NULL && s->sock_base.nic_type->n_ioctl == lwipsocket_socket_ioctl;
+}
+
+/*
+ * uselect waits for all the lwIP sockets registered with a single select
+ */
+mp_int_t mp_uselect_port_wait(mp_uselect_fd_t *fds, size_t n, mp_uint_t timeout, bool others, int *errcode) {
+    fd_set rfds, wfds, xfds;
+    int32_t maxfd = -1;
+    int32_t nfds;
+
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+    FD_ZERO(&xfds);
+    for (int i = 0; i < n; i++) {
+        if (fds[i].fd < 0) {
+            continue;
+        }
+        if (fds[i].events & MP_STREAM_POLL_RD) {
+            FD_SET(fds[i].fd, &rfds);
+        }
+        if (fds[i].events & MP_STREAM_POLL_WR) {
+            FD_SET(fds[i].fd, &wfds);
+        }
+        if (fds[i].events & (MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP)) {
+            FD_SET(fds[i].fd, &xfds);
+        }
+        maxfd = MAX(maxfd, fds[i].fd);
+    }
+
+    mp_uint_t start_tick = mp_hal_ticks_ms();
+    fd_set r, w, x;
+    MP_THREAD_GIL_EXIT();
+    for (;;) {
+        struct timeval tv;
+        struct timeval *ptv = NULL;
+        mp_uint_t wait = timeout;
+        if (timeout != -1) {
+            mp_uint_t elapsed = mp_hal_ticks_ms() - start_tick;
+            wait = elapsed < timeout ? timeout - elapsed : 0;
+        }
+        if (others && (wait == -1 || wait > LWIPSOCKET_POLL_SLICE_MS)) {
+            wait = LWIPSOCKET_POLL_SLICE_MS;
+        }
+        if (wait != -1) {
+            tv.tv_sec = wait / 1000;
+            tv.tv_usec = (wait % 1000) * 1000;
+            ptv = &tv;
+        }
+
+        r = rfds;
+        w = wfds;
+        x = xfds;
+        nfds = lwip_select(maxfd + 1, &r, &w, &x, ptv);
+        if (nfds != 0 || (timeout != -1 && mp_hal_ticks_ms() - start_tick >= timeout)) {
+            break;
+        }
+        if (others && mp_hal_poll_pending()) {
+            // another object may be ready
+            break;
+        }
+    }
+    MP_THREAD_GIL_ENTER();
+
+    if (nfds < 0) {
+        *errcode = errno;
+        return -1;
+    }
+
+    mp_int_t n_ready = 0;
+    for (int i = 0; nfds > 0 && i < n; i++) {
+        if (fds[i].fd < 0) {
+            continue;
+        }
+        if (FD_ISSET(fds[i].fd, &r)) {
+            fds[i].revents |= MP_STREAM_POLL_RD;
+        }
+        if (FD_ISSET(fds[i].fd, &w)) {
+            fds[i].revents |= MP_STREAM_POLL_WR;
+        }
+        if (FD_ISSET(fds[i].fd, &x)) {
+            fds[i].revents |= MP_STREAM_POLL_HUP;
+        }
+        if (fds[i].revents) {
+            n_ready++;
+        }
+    }
+    return n_ready;
+}
+
 int lwipsocket_socket_setup_ssl(mod_network_socket_obj_t *s, int *_errno)
 {
     int ret;
     uint32_t count = 0;
     mp_obj_ssl_socket_t *ss = (mp_obj_ssl_socket_t *)s;
 
-    if ((ret = mbedtls_net_set_block(&ss->context_fd)) != 0) {
+    if ((ret = lwipsocket_ssl_set_bio(ss, false)) != 0) {
         // printf("failed! net_set_(non)block() returned -0x%x\n", -ret);
         *_errno = ret;
         return -1;
     }
 
-    mbedtls_ssl_set_bio(&ss->ssl, &ss->context_fd, mbedtls_net_send, NULL, mbedtls_net_recv_timeout);
-
     // printf("Performing the SSL/TLS handshake...\n");
 
-    while ((ret = mbedtls_ssl_handshake(&ss->ssl)) != 0)
+    while ((ret = modussl_handshake_step(ss)) != 0)
     {
         if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_TIMEOUT ) || count >= ss->read_timeout)
         {
@@ -415,5 +928,41 @@ int lwipsocket_socket_setup_ssl(mod_network_socket_obj_t *s, int *_errno)
         return -1;
     }
     // printf("Certificate verified.\n");
+    modussl_handshake_done(ss);
+    return 0;
+}
+
+/*
+ * one step of the ssl handshake, it returns instead of waiting for the peer
+ */
+int lwipsocket_socket_handshake(mod_network_socket_obj_t *s, int *_errno)
+{
+    int ret;
+    mp_obj_ssl_socket_t *ss = (mp_obj_ssl_socket_t *)s;
+
+    if ((ret = lwipsocket_ssl_set_bio(ss, true)) != 0) {
+        *_errno = ret;
+        return -1;
+    }
+
+    ret = modussl_handshake_step(ss);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+        return MOD_NETWORK_HANDSHAKE_WANT_READ;
+    } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return MOD_NETWORK_HANDSHAKE_WANT_WRITE;
+    }
+
+    // the handshake is over, go back to the mode set by the socket timeout
+    lwipsocket_ssl_set_bio(ss, s->sock_base.timeout == 0);
+    if (ret != 0) {
+        *_errno = ret;
+        return -1;
+    }
+    if ((ret = mbedtls_ssl_get_verify_result(&ss->ssl)) != 0) {
+        *_errno = ret;
+        return -1;
+    }
+    modussl_handshake_done(ss);
+    s->sock_base.connected = true;
     return 0;
 }
@@ -12,6 +12,34 @@
 
 #include "modnetwork.h"
 
+extern void lwipsocket_dns_init(void);
+
+extern void lwipsocket_metrics_init(void);
+
+extern bool lwipsocket_dns_config(uint32_t size, uint32_t ttl_ms, uint32_t neg_ttl_ms);
+
+extern void lwipsocket_dns_get_config(uint32_t *size, uint32_t *ttl_ms, uint32_t *neg_ttl_ms);
+
+extern void lwipsocket_dns_flush(void);
+
+extern void lwipsocket_dns_stats(uint32_t *hits, uint32_t *misses, uint32_t *entries, bool reset);
+
+typedef struct {
+    uint32_t    tcp_active;
+    uint32_t    tcp_listen;
+    uint32_t    tcp_time_wait;
+    uint32_t    tcp_retransmitting;     // connections with a segment being retransmitted
+    uint32_t    tcp_nrtx;               // retransmissions of those segments so far
+    uint32_t    tcp_queued;             // segments waiting to be sent or acknowledged
+    uint32_t    udp;
+    uint32_t    socket_errors;          // sockets refused for the lack of descriptors or memory
+    uint32_t    nomem;                  // sends and connects refused for the lack of buffers
+} lwipsocket_net_stats_t;
+
+extern void lwipsocket_net_stats(lwipsocket_net_stats_t *stats, bool reset);
+
+extern int lwipsocket_dns_resolve(const char *name, uint32_t *addr);
+
 extern int lwipsocket_gethostbyname(const char *name, mp_uint_t len, uint8_t *out_ip, mp_uint_t family);
 
 extern int lwipsocket_socket_socket(mod_network_socket_obj_t *s, int *_errno);
@@ -34,12 +62,20 @@ extern int lwipsocket_socket_sendto( mod_network_socket_obj_t *s, const byte *bu
 
 extern int lwipsocket_socket_recvfrom(mod_network_socket_obj_t *s, byte *buf, mp_uint_t len, byte *ip, mp_uint_t *port, int *_errno);
 
+extern int lwipsocket_socket_sendmsg(mod_network_socket_obj_t *s, const mp_buffer_info_t *bufs, mp_uint_t n_bufs, byte *ip, mp_uint_t port, int *_errno);
+
 extern int lwipsocket_socket_setsockopt(mod_network_socket_obj_t *s, mp_uint_t level, mp_uint_t opt, const void *optval, mp_uint_t optlen, int *_errno);
 
+extern int lwipsocket_socket_getsockopt(mod_network_socket_obj_t *s, mp_uint_t level, mp_uint_t opt, mp_int_t *optval, int *_errno);
+
 extern int lwipsocket_socket_settimeout(mod_network_socket_obj_t *s, mp_int_t timeout_ms, int *_errno);
 
 extern int lwipsocket_socket_ioctl (mod_network_socket_obj_t *s, mp_uint_t request, mp_uint_t arg, int *_errno);
 
 extern int lwipsocket_socket_setup_ssl(mod_network_socket_obj_t *s, int *_errno);
 
+extern int lwipsocket_socket_handshake(mod_network_socket_obj_t *s, int *_errno);
+
+extern bool lwipsocket_is_lwip(mod_network_socket_obj_t *s);
+
 #endif      // LWIPSOCKET_H_
@@ -13,6 +13,7 @@
 #include "py/mpstate.h"
 #include "py/runtime.h"
 #include "py/mperrno.h"
+#include "py/mpthread.h"
 #include "bufhelper.h"
 
 #include "esp_heap_caps.h"
@@ -23,6 +24,7 @@
 
 #include "esp_types.h"
 #include "esp_attr.h"
+#include "esp_timer.h"
 #include "gpio.h"
 
 #include "machpin.h"
@@ -52,6 +54,15 @@ CAN_device_t CAN_cfg = { .rx_queue = NULL };
 
 #define MACH_CAN_DEF_RX_QUEUE_LEN                   (128)
 
+// recv_into() record: id (4 bytes, little endian), dlc, flags, 2 padding bytes, data (8 bytes)
+#define MACH_CAN_RECORD_SIZE                        (16)
+#define MACH_CAN_RECORD_FLAG_RTR                    (0x01)
+#define MACH_CAN_RECORD_FLAG_EXT                    (0x02)
+
+#define MACH_CAN_STD_ID_MASK                        (0x7FF)
+#define MACH_CAN_EXT_ID_MASK                        (0x1FFFFFFF)
+#define MACH_CAN_TX_TIMEOUT_MS                      (100)       // waiting for room in the TX queue
+
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
@@ -69,6 +80,8 @@ typedef struct {
     uint8_t frame_format;
     uint8_t trigger;
     uint8_t events;
+    bool hw_soft;               // the software filters complete the hardware ones
+    int64_t stats_start;        // start of the bus load window, in us
 } mach_can_obj_t;
 
 /******************************************************************************
@@ -199,10 +212,12 @@ STATIC mp_obj_t mach_can_init_helper(mach_can_obj_t *self, const mp_arg_val_t *a
 
     // start the CAN Module
     CAN_init(mode, frame_format - 1);
+    self->stats_start = esp_timer_get_time();
 
-    // remove the software filters
+    // remove the software filters, CAN_init() has already opened the hardware one
     self->swfilters.num_filters = 0;
     CAN_setup_sw_filters(&self->swfilters);
+    self->hw_soft = false;
 
     // set the af values, so that deassign works later on
     if (self->tx && self->rx) {
@@ -318,7 +333,19 @@ STATIC mp_obj_t mach_can_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
     tx_frame.MsgID = msg_id;
     memcpy(tx_frame.data.u8, bufinfo.buf, bufinfo.len);
 
-    CAN_write_frame(&tx_frame);
+    // wait a bit for the frames with a higher priority to make room in the queue
+    if (!CAN_queue_frame(&tx_frame)) {
+        bool queued = false;
+        MP_THREAD_GIL_EXIT();
+        for (int i = 0; !queued && i < MACH_CAN_TX_TIMEOUT_MS; i++) {
+            vTaskDelay(1 / portTICK_PERIOD_MS);
+            queued = CAN_queue_frame(&tx_frame);
+        }
+        MP_THREAD_GIL_ENTER();
+        if (!queued) {
+            mp_raise_OSError(MP_ENOBUFS);
+        }
+    }
 
     // return the number of bytes sent
     return mp_obj_new_int(bufinfo.len);
@@ -373,6 +400,62 @@ STATIC mp_obj_t mach_can_recv(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_can_recv_obj, 1, mach_can_recv);
 
+/// \method recv_into(buf, *, timeout)
+/// Stores as many received frames as fit in buf, 16 bytes each, and returns how many. Only the
+/// first one is waited for, the timeout has the same meaning as for recv().
+STATIC mp_obj_t mach_can_recv_into(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,          MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_timeout,      MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    uint32_t max_frames = bufinfo.len / MACH_CAN_RECORD_SIZE;
+    uint8_t *record = bufinfo.buf;
+
+    uint64_t timeout = 0;
+    if (args[1].u_obj == mp_const_none) {
+        timeout = portMAX_DELAY;
+    } else if (args[1].u_obj != MP_OBJ_NULL) {
+        timeout = mp_obj_get_float(args[1].u_obj) * 1000;
+        if (timeout > portMAX_DELAY) {
+            timeout = portMAX_DELAY;
+        }
+    }
+
+    uint32_t n_frames = 0;
+    CAN_frame_t rx_frame;
+    MP_THREAD_GIL_EXIT();
+    while (n_frames < max_frames &&
+           xQueueReceive(CAN_cfg.rx_queue, &rx_frame, (n_frames == 0) ? ((uint32_t)timeout * portTICK_PERIOD_MS) : 0) == pdTRUE) {
+        memset(record, 0, MACH_CAN_RECORD_SIZE);
+        record[0] = rx_frame.MsgID & 0xFF;
+        record[1] = (rx_frame.MsgID >> 8) & 0xFF;
+        record[2] = (rx_frame.MsgID >> 16) & 0xFF;
+        record[3] = (rx_frame.MsgID >> 24) & 0xFF;
+        if (rx_frame.FIR.B.RTR == CAN_RTR) {
+            record[5] |= MACH_CAN_RECORD_FLAG_RTR;
+        } else {
+            record[4] = rx_frame.FIR.B.DLC;
+            memcpy(&record[8], rx_frame.data.u8, rx_frame.FIR.B.DLC);
+        }
+        if (rx_frame.FIR.B.FF) {
+            record[5] |= MACH_CAN_RECORD_FLAG_EXT;
+        }
+        record += MACH_CAN_RECORD_SIZE;
+        n_frames++;
+    }
+    MP_THREAD_GIL_ENTER();
+
+    return mp_obj_new_int(n_frames);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_can_recv_into_obj, 1, mach_can_recv_into);
+
 STATIC mp_obj_t mach_can_soft_filter(mp_obj_t self_in, mp_obj_t mode_o, mp_obj_t filters_l) {
     mach_can_obj_t *self = self_in;
 
@@ -409,37 +492,118 @@ STATIC mp_obj_t mach_can_soft_filter(mp_obj_t self_in, mp_obj_t mode_o, mp_obj_t
     }
 
     CAN_setup_sw_filters(&self->swfilters);
+    self->hw_soft = false;
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(mach_can_soft_filter_obj, mach_can_soft_filter);
 
-// STATIC mp_obj_t mach_can_hard_filter(mp_obj_t self_in, mp_obj_t filters_l) {
-//     mach_can_obj_t *self = self_in;
-
-//     mp_obj_t *filters;
-//     mp_uint_t n_filters;
-//     if (filters_l != mp_const_none) {
-//         mp_obj_get_array(filters_l, &n_filters, &filters);
-//         if (n_filters < 1 || n_filters > 2) {
-//             nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "between 1 and 2 hardware filters are possible"));
-//         }
-//         for (int i = 0; i < n_filters; i++) {
-//             mp_obj_t *fromto;
-//             mp_obj_get_array_fixed_n(filters[i], 2, &fromto);
-//             self->hwfilters.codemask[i][0] = mp_obj_get_int_truncated(fromto[0]);
-//             self->hwfilters.codemask[i][1] = mp_obj_get_int_truncated(fromto[1]);
-//         }
-//         self->hwfilters.num_filters = n_filters;
-//     } else {
-//         self->hwfilters.num_filters = 0;
-//     }
-
-//     CAN_setup_hw_filters(&self->hwfilters);
-
-//     return mp_const_none;
-// }
-// STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_can_hard_filter_obj, mach_can_hard_filter);
+// a filter is an id, or an (id, mask) tuple where the mask bits set must match
+STATIC void can_get_filter(mp_obj_t filter_o, uint32_t id_mask, uint32_t *id, uint32_t *care) {
+    if (MP_OBJ_IS_INT(filter_o)) {
+        *id = mp_obj_get_int_truncated(filter_o);
+        *care = id_mask;
+    } else {
+        mp_obj_t *idmask;
+        mp_obj_get_array_fixed_n(filter_o, 2, &idmask);
+        *id = mp_obj_get_int_truncated(idmask[0]);
+        *care = mp_obj_get_int_truncated(idmask[1]) & id_mask;
+    }
+}
+
+// writes the code and mask bytes, slot -1 is the single filter, 0 and 1 the dual ones
+STATIC void can_set_hw_filter(CAN_hw_filters_t *hw, int slot, bool ext, uint32_t id, uint32_t care) {
+    if (slot < 0) {
+        uint32_t code = ext ? (id << 3) : (id << 21);
+        uint32_t mask = ~(ext ? (care << 3) : (care << 21));
+        for (int i = 0; i < 4; i++) {
+            hw->code[i] = code >> (24 - (8 * i));
+            hw->mask[i] = mask >> (24 - (8 * i));
+        }
+    } else {
+        // only ID28..ID13 of an extended frame are seen by a dual filter
+        uint16_t code = ext ? (id >> 13) : (id << 5);
+        uint16_t mask = ~(ext ? (care >> 13) : (care << 5));
+        hw->code[2 * slot] = code >> 8;
+        hw->code[(2 * slot) + 1] = code & 0xFF;
+        hw->mask[2 * slot] = mask >> 8;
+        hw->mask[(2 * slot) + 1] = mask & 0xFF;
+    }
+}
+
+/// \method hard_filter(filters)
+/// Programs the acceptance filter of the controller. One or two filters are exact, except for the
+/// low 13 bits of two extended ids. More filters are merged into one accepting all of them.
+/// When the hardware isn't exact the filters are also set as software ones. Returns True if exact.
+STATIC mp_obj_t mach_can_hard_filter(mp_obj_t self_in, mp_obj_t filters_l) {
+    mach_can_obj_t *self = self_in;
+    bool exact = true;
+
+    memset(&self->hwfilters, 0, sizeof(self->hwfilters));
+    if (filters_l == mp_const_none) {
+        // no acceptance filtering
+        memset(self->hwfilters.mask, 0xFF, sizeof(self->hwfilters.mask));
+    } else {
+        mp_obj_t *filters;
+        mp_uint_t n_filters;
+        mp_obj_get_array(filters_l, &n_filters, &filters);
+        if (n_filters < 1 || n_filters > 32) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "between 1 and 32 hardware filters are possible"));
+        }
+        // standard and extended ids are laid out differently in the filter
+        if (self->frame_format == MACH_CAN_FORMAT_BOTH) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "hardware filters need FORMAT_STD or FORMAT_EXT"));
+        }
+        bool ext = (self->frame_format == MACH_CAN_FORMAT_EXT);
+        uint32_t id_mask = ext ? MACH_CAN_EXT_ID_MASK : MACH_CAN_STD_ID_MASK;
+        uint32_t id, care;
+
+        if (n_filters == 2) {
+            for (int i = 0; i < 2; i++) {
+                can_get_filter(filters[i], id_mask, &id, &care);
+                can_set_hw_filter(&self->hwfilters, i, ext, id, care);
+                if (ext && (care & 0x1FFF)) {
+                    exact = false;
+                }
+            }
+        } else {
+            // keep the bits on which all the filters agree
+            uint32_t ref_id = 0, ref_care = id_mask;
+            for (int i = 0; i < n_filters; i++) {
+                can_get_filter(filters[i], id_mask, &id, &care);
+                if (i == 0) {
+                    ref_id = id;
+                }
+                ref_care &= care & ~(id ^ ref_id);
+            }
+            can_set_hw_filter(&self->hwfilters, -1, ext, ref_id, ref_care);
+            self->hwfilters.single = true;
+            exact = (n_filters == 1);
+        }
+
+        if (!exact) {
+            self->swfilters.mode = CAN_FILTER_MASK;
+            for (int i = 0; i < n_filters; i++) {
+                can_get_filter(filters[i], id_mask, &self->swfilters.fromto[i][0], &self->swfilters.fromto[i][1]);
+            }
+            self->swfilters.num_filters = n_filters;
+            CAN_setup_sw_filters(&self->swfilters);
+            self->hw_soft = true;
+        }
+    }
+
+    // the software filters set by a previous call aren't needed anymore
+    if (exact && self->hw_soft) {
+        self->swfilters.num_filters = 0;
+        CAN_setup_sw_filters(&self->swfilters);
+        self->hw_soft = false;
+    }
+
+    CAN_setup_hw_filters(&self->hwfilters);
+
+    return mp_obj_new_bool(exact);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_can_hard_filter_obj, mach_can_hard_filter);
 
 /// \method callback(trigger, handler, arg)
 STATIC mp_obj_t mach_can_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -483,16 +647,56 @@ STATIC mp_obj_t mach_can_events(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_can_events_obj, mach_can_events);
 
+STATIC mp_obj_t mach_can_stats(mp_obj_t self_in) {
+    mach_can_obj_t *self = self_in;
+    STATIC const qstr can_stats_info_fields[] = {
+        MP_QSTR_rx_frames, MP_QSTR_rx_dropped, MP_QSTR_tx_frames, MP_QSTR_tx_pending,
+        MP_QSTR_errors, MP_QSTR_arb_lost, MP_QSTR_overruns, MP_QSTR_err_passive, MP_QSTR_bus_load
+    };
+
+    if (self->baudrate == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    CAN_stats_t stats;
+    CAN_get_stats(&stats, true);
+
+    // percentage of the bit times used since the last call, a lower bound as stuffing
+    // and the frames dropped by the hardware filter aren't counted
+    int64_t now = esp_timer_get_time();
+    float elapsed = (now - self->stats_start) / 1000000.0f;
+    self->stats_start = now;
+    float load = 0.0f;
+    if (elapsed > 0.0f) {
+        load = MIN(100.0f, (stats.bus_bits * 100.0f) / (elapsed * self->baudrate * 1000.0f));
+    }
+
+    mp_obj_t tuple[9];
+    tuple[0] = mp_obj_new_int_from_uint(stats.rx_frames);
+    tuple[1] = mp_obj_new_int_from_uint(stats.rx_dropped);
+    tuple[2] = mp_obj_new_int_from_uint(stats.tx_frames);
+    tuple[3] = mp_obj_new_int_from_uint(CAN_tx_pending());
+    tuple[4] = mp_obj_new_int_from_uint(stats.errors);
+    tuple[5] = mp_obj_new_int_from_uint(stats.arb_lost);
+    tuple[6] = mp_obj_new_int_from_uint(stats.overruns);
+    tuple[7] = mp_obj_new_int_from_uint(stats.err_passive);
+    tuple[8] = mp_obj_new_float(load);
+    return mp_obj_new_attrtuple(can_stats_info_fields, 9, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_can_stats_obj, mach_can_stats);
+
 STATIC const mp_map_elem_t mach_can_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&mach_can_init_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&mach_can_deinit_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_send),                (mp_obj_t)&mach_can_send_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv),                (mp_obj_t)&mach_can_recv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recv_into),           (mp_obj_t)&mach_can_recv_into_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_soft_filter),         (mp_obj_t)&mach_can_soft_filter_obj },
-    // { MP_OBJ_NEW_QSTR(MP_QSTR_hard_filter),         (mp_obj_t)&mach_can_hard_filter_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_hard_filter),         (mp_obj_t)&mach_can_hard_filter_obj },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_callback),            (mp_obj_t)&mach_can_callback_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_events),              (mp_obj_t)&mach_can_events_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stats),               (mp_obj_t)&mach_can_stats_obj },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_NORMAL),              MP_OBJ_NEW_SMALL_INT(CAN_mode_normal) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_SILENT),              MP_OBJ_NEW_SMALL_INT(CAN_mode_listen_only) },
@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/mpstate.h"
+#include "py/runtime.h"
+#include "py/obj.h"
+
+#include "esp_attr.h"
+#include "driver/pcnt.h"
+#include "soc/pcnt_struct.h"
+
+#include "machpin.h"
+#include "mpexception.h"
+#include "mpirq.h"
+#include "machcounter.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MACH_COUNTER_EDGE_RISING                    (0x01)
+#define MACH_COUNTER_EDGE_FALLING                   (0x02)
+
+#define MACH_COUNTER_EVENT_LIMIT                    (0x01)
+#define MACH_COUNTER_EVENT_THRESHOLD                (0x02)
+#define MACH_COUNTER_EVENT_ZERO                     (0x04)
+
+#define MACH_COUNTER_LIMIT_MAX                      (32767)
+#define MACH_COUNTER_FILTER_MAX                     (1023)      // APB cycles
+#define MACH_COUNTER_APB_MHZ                        (80)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    mp_obj_base_t base;
+    mp_obj_t handler;
+    mp_obj_t handler_arg;
+    volatile int64_t acc;       // counts moved out of the hardware counter at every limit
+    int16_t limit;              // the hardware counter goes back to 0 at +/- limit
+    uint8_t unit;
+    uint8_t trigger;
+    volatile uint8_t events;
+    bool enabled;
+} mach_counter_obj_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC mach_counter_obj_t mach_counter_obj[PCNT_UNIT_MAX];
+STATIC bool mach_counter_isr_installed = false;
+STATIC portMUX_TYPE mach_counter_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mach_counter_callback_handler(void *arg) {
+    mach_counter_obj_t *self = arg;
+    if (self->handler && self->handler != mp_const_none) {
+        mp_call_function_1(self->handler, self->handler_arg);
+    }
+}
+
+STATIC IRAM_ATTR void mach_counter_isr(void *arg) {
+    mach_counter_obj_t *self = arg;
+    uint32_t events = 0;
+
+    portENTER_CRITICAL_ISR(&mach_counter_mux);
+    if (PCNT.status_unit[self->unit].h_lim_lat) {
+        self->acc += self->limit;
+        events |= MACH_COUNTER_EVENT_LIMIT;
+    } else if (PCNT.status_unit[self->unit].l_lim_lat) {
+        self->acc -= self->limit;
+        events |= MACH_COUNTER_EVENT_LIMIT;
+    }
+    if (PCNT.status_unit[self->unit].thres0_lat || PCNT.status_unit[self->unit].thres1_lat) {
+        events |= MACH_COUNTER_EVENT_THRESHOLD;
+    }
+    if (PCNT.status_unit[self->unit].zero_lat) {
+        events |= MACH_COUNTER_EVENT_ZERO;
+    }
+    self->events |= events;
+    portEXIT_CRITICAL_ISR(&mach_counter_mux);
+
+    if (events & self->trigger) {
+        mp_irq_queue_interrupt(mach_counter_callback_handler, (void *)self);
+    }
+}
+
+// the 64 bit count, a limit that the ISR hasn't handled yet is added here
+STATIC int64_t mach_counter_get(mach_counter_obj_t *self) {
+    int16_t raw;
+    int64_t value;
+    uint32_t pending;
+
+    portENTER_CRITICAL(&mach_counter_mux);
+    do {
+        pending = PCNT.int_st.val & BIT(self->unit);
+        pcnt_get_counter_value(self->unit, &raw);
+    } while (pending != (PCNT.int_st.val & BIT(self->unit)));
+    value = self->acc + raw;
+    if (pending) {
+        if (PCNT.status_unit[self->unit].h_lim_lat) {
+            value += self->limit;
+        } else if (PCNT.status_unit[self->unit].l_lim_lat) {
+            value -= self->limit;
+        }
+    }
+    portEXIT_CRITICAL(&mach_counter_mux);
+
+    return value;
+}
+
+STATIC void mach_counter_deinit_helper(mach_counter_obj_t *self) {
+    if (self->enabled) {
+        pcnt_counter_pause(self->unit);
+        pcnt_intr_disable(self->unit);
+        pcnt_isr_handler_remove(self->unit);
+        self->enabled = false;
+    }
+}
+
+/******************************************************************************/
+/* Micro Python bindings : Counter object                                     */
+
+STATIC void mach_counter_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    mach_counter_obj_t *self = self_in;
+    if (self->enabled) {
+        mp_printf(print, "Counter(%u, limit=%d)", self->unit, self->limit);
+    } else {
+        mp_printf(print, "Counter(%u)", self->unit);
+    }
+}
+
+STATIC const mp_arg_t mach_counter_init_args[] = {
+    { MP_QSTR_id,                           MP_ARG_INT,  {.u_int = 0} },
+    { MP_QSTR_pin,                          MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_dir_pin,      MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_edge,         MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACH_COUNTER_EDGE_RISING} },
+    { MP_QSTR_quadrature,   MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_filter_ns,    MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = 0} },
+    { MP_QSTR_limit,        MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACH_COUNTER_LIMIT_MAX} },
+    { MP_QSTR_thresholds,   MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+};
+
+STATIC mp_obj_t mach_counter_init_helper(mach_counter_obj_t *self, const mp_arg_val_t *args) {
+    if (args[1].u_obj == mp_const_none) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "a pin is required"));
+    }
+    int pulse_gpio = pin_find(args[1].u_obj)->pin_number;
+    int ctrl_gpio = PCNT_PIN_NOT_USED;
+    if (args[2].u_obj != mp_const_none) {
+        ctrl_gpio = pin_find(args[2].u_obj)->pin_number;
+    }
+
+    uint32_t edge = args[3].u_int;
+    bool quadrature = args[4].u_bool;
+    if (edge == 0 || edge > (MACH_COUNTER_EDGE_RISING | MACH_COUNTER_EDGE_FALLING) || (quadrature && ctrl_gpio == PCNT_PIN_NOT_USED)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    uint32_t filter = (args[5].u_int * MACH_COUNTER_APB_MHZ) / 1000;
+    if (args[5].u_int < 0 || filter > MACH_COUNTER_FILTER_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "filter_ns must be between 0 and 12787"));
+    }
+
+    mp_int_t limit = args[6].u_int;
+    if (limit < 1 || limit > MACH_COUNTER_LIMIT_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "limit must be between 1 and 32767"));
+    }
+
+    mp_int_t thresholds[2] = { 0, 0 };
+    mp_uint_t n_thresholds = 0;
+    if (args[7].u_obj != mp_const_none) {
+        mp_obj_t *items;
+        mp_obj_get_array(args[7].u_obj, &n_thresholds, &items);
+        if (n_thresholds > 2) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "up to 2 thresholds"));
+        }
+        for (mp_uint_t i = 0; i < n_thresholds; i++) {
+            thresholds[i] = mp_obj_get_int(items[i]);
+            if (thresholds[i] <= -limit || thresholds[i] >= limit) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "thresholds must be within the limits"));
+            }
+        }
+    }
+
+    mach_counter_deinit_helper(self);
+
+    // channel 0 counts the edges of the pin, the direction pin reverses it when low
+    pcnt_config_t config = {
+        .pulse_gpio_num = pulse_gpio,
+        .ctrl_gpio_num = ctrl_gpio,
+        .channel = PCNT_CHANNEL_0,
+        .unit = self->unit,
+        .pos_mode = (edge & MACH_COUNTER_EDGE_RISING) ? PCNT_COUNT_INC : PCNT_COUNT_DIS,
+        .neg_mode = (edge & MACH_COUNTER_EDGE_FALLING) ? PCNT_COUNT_INC : PCNT_COUNT_DIS,
+        .lctrl_mode = (ctrl_gpio == PCNT_PIN_NOT_USED) ? PCNT_MODE_KEEP : PCNT_MODE_REVERSE,
+        .hctrl_mode = PCNT_MODE_KEEP,
+        .counter_h_lim = limit,
+        .counter_l_lim = -limit,
+    };
+    if (quadrature) {
+        // full x4 decoding, every edge of A and B counts:
+        // A is counted with B as direction, B is counted with A as direction
+        config.pos_mode = PCNT_COUNT_INC;
+        config.neg_mode = PCNT_COUNT_DEC;
+        config.lctrl_mode = PCNT_MODE_KEEP;
+        config.hctrl_mode = PCNT_MODE_REVERSE;
+    }
+    if (pcnt_unit_config(&config) != ESP_OK) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    if (quadrature) {
+        config.pulse_gpio_num = ctrl_gpio;
+        config.ctrl_gpio_num = pulse_gpio;
+        config.channel = PCNT_CHANNEL_1;
+        config.lctrl_mode = PCNT_MODE_REVERSE;
+        config.hctrl_mode = PCNT_MODE_KEEP;
+    } else {
+        // make sure that the second channel of the unit doesn't count
+        config.pulse_gpio_num = PCNT_PIN_NOT_USED;
+        config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+        config.channel = PCNT_CHANNEL_1;
+        config.pos_mode = PCNT_COUNT_DIS;
+        config.neg_mode = PCNT_COUNT_DIS;
+    }
+    pcnt_unit_config(&config);
+
+    if (filter > 0) {
+        pcnt_set_filter_value(self->unit, filter);
+        pcnt_filter_enable(self->unit);
+    } else {
+        pcnt_filter_disable(self->unit);
+    }
+
+    // the limits are always enabled, they extend the count to 64 bits
+    pcnt_event_enable(self->unit, PCNT_EVT_H_LIM);
+    pcnt_event_enable(self->unit, PCNT_EVT_L_LIM);
+    pcnt_event_disable(self->unit, PCNT_EVT_ZERO);
+    pcnt_event_disable(self->unit, PCNT_EVT_THRES_0);
+    pcnt_event_disable(self->unit, PCNT_EVT_THRES_1);
+    if (n_thresholds > 0) {
+        pcnt_set_event_value(self->unit, PCNT_EVT_THRES_0, thresholds[0]);
+        pcnt_event_enable(self->unit, PCNT_EVT_THRES_0);
+    }
+    if (n_thresholds > 1) {
+        pcnt_set_event_value(self->unit, PCNT_EVT_THRES_1, thresholds[1]);
+        pcnt_event_enable(self->unit, PCNT_EVT_THRES_1);
+    }
+
+    if (!mach_counter_isr_installed) {
+        if (pcnt_isr_service_install(0) != ESP_OK) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        mach_counter_isr_installed = true;
+    }
+
+    self->limit = limit;
+    self->acc = 0;
+    self->events = 0;
+    pcnt_counter_pause(self->unit);
+    pcnt_counter_clear(self->unit);
+    pcnt_isr_handler_add(self->unit, mach_counter_isr, self);
+    pcnt_intr_enable(self->unit);
+    pcnt_counter_resume(self->unit);
+    self->enabled = true;
+
+    return mp_const_none;
+}
+
+STATIC mp_obj_t mach_counter_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
+    // parse args
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_counter_init_args)];
+    mp_arg_parse_all(n_args, all_args, &kw_args, MP_ARRAY_SIZE(args), mach_counter_init_args, args);
+
+    mp_int_t unit = args[0].u_int;
+    if (unit < 0 || unit >= PCNT_UNIT_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+    }
+
+    mach_counter_obj_t *self = &mach_counter_obj[unit];
+    self->base.type = &mach_counter_type;
+    self->unit = unit;
+
+    // only (re)configure the unit if a pin is given
+    if (args[1].u_obj != mp_const_none) {
+        mach_counter_init_helper(self, args);
+    }
+    return self;
+}
+
+STATIC mp_obj_t mach_counter_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mach_counter_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_counter_init_args)];
+    // the unit can't change
+    args[0].u_int = self->unit;
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(mach_counter_init_args) - 1, mach_counter_init_args + 1, &args[1]);
+    return mach_counter_init_helper(self, args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_counter_init_obj, 1, mach_counter_init);
+
+STATIC mp_obj_t mach_counter_deinit(mp_obj_t self_in) {
+    mach_counter_obj_t *self = self_in;
+    mach_counter_deinit_helper(self);
+    self->trigger = 0;
+    mp_irq_remove(self);
+    INTERRUPT_OBJ_CLEAN(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_counter_deinit_obj, mach_counter_deinit);
+
+/// \method value([value])
+/// Gets the 64 bit count, or sets it.
+STATIC mp_obj_t mach_counter_value(mp_uint_t n_args, const mp_obj_t *args) {
+    mach_counter_obj_t *self = args[0];
+    if (!self->enabled) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    if (n_args == 1) {
+        return mp_obj_new_int_from_ll(mach_counter_get(self));
+    }
+
+    int64_t value = mp_obj_get_int(args[1]);
+    portENTER_CRITICAL(&mach_counter_mux);
+    pcnt_counter_clear(self->unit);
+    self->acc = value;
+    portEXIT_CRITICAL(&mach_counter_mux);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mach_counter_value_obj, 1, 2, mach_counter_value);
+
+STATIC mp_obj_t mach_counter_pause(mp_obj_t self_in) {
+    mach_counter_obj_t *self = self_in;
+    if (self->enabled) {
+        pcnt_counter_pause(self->unit);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_counter_pause_obj, mach_counter_pause);
+
+STATIC mp_obj_t mach_counter_resume(mp_obj_t self_in) {
+    mach_counter_obj_t *self = self_in;
+    if (self->enabled) {
+        pcnt_counter_resume(self->unit);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_counter_resume_obj, mach_counter_resume);
+
+/// \method callback(trigger, handler, arg)
+STATIC mp_obj_t mach_counter_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_trigger,      MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_handler,      MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_arg,          MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    mach_counter_obj_t *self = pos_args[0];
+
+    // enable the callback
+    if (args[0].u_obj != mp_const_none && args[1].u_obj != mp_const_none) {
+        uint32_t trigger = mp_obj_get_int(args[0].u_obj);
+        // the zero event is only enabled when asked for, it fires at every limit too
+        if (self->enabled) {
+            if (trigger & MACH_COUNTER_EVENT_ZERO) {
+                pcnt_event_enable(self->unit, PCNT_EVT_ZERO);
+            } else {
+                pcnt_event_disable(self->unit, PCNT_EVT_ZERO);
+            }
+        }
+        self->handler = args[1].u_obj;
+        mp_irq_add(self, args[1].u_obj);
+        if (args[2].u_obj == mp_const_none) {
+            self->handler_arg = self;
+        } else {
+            self->handler_arg = args[2].u_obj;
+        }
+        self->trigger = trigger;
+    } else {
+        self->trigger = 0;
+        mp_irq_remove(self);
+        INTERRUPT_OBJ_CLEAN(self);
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_counter_callback_obj, 1, mach_counter_callback);
+
+STATIC mp_obj_t mach_counter_events(mp_obj_t self_in) {
+    mach_counter_obj_t *self = self_in;
+
+    portENTER_CRITICAL(&mach_counter_mux);
+    int32_t events = self->events;
+    self->events = 0;
+    portEXIT_CRITICAL(&mach_counter_mux);
+    return mp_obj_new_int(events);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_counter_events_obj, mach_counter_events);
+
+STATIC const mp_map_elem_t mach_counter_locals_dict_table[] = {
+    // instance methods
+    { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&mach_counter_init_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&mach_counter_deinit_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_value),               (mp_obj_t)&mach_counter_value_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pause),               (mp_obj_t)&mach_counter_pause_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_resume),              (mp_obj_t)&mach_counter_resume_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_callback),            (mp_obj_t)&mach_counter_callback_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_events),              (mp_obj_t)&mach_counter_events_obj },
+
+    // class constants
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RISING),              MP_OBJ_NEW_SMALL_INT(MACH_COUNTER_EDGE_RISING) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_FALLING),             MP_OBJ_NEW_SMALL_INT(MACH_COUNTER_EDGE_FALLING) },
+
+    { MP_OBJ_NEW_QSTR(MP_QSTR_LIMIT),               MP_OBJ_NEW_SMALL_INT(MACH_COUNTER_EVENT_LIMIT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_THRESHOLD),           MP_OBJ_NEW_SMALL_INT(MACH_COUNTER_EVENT_THRESHOLD) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ZERO),                MP_OBJ_NEW_SMALL_INT(MACH_COUNTER_EVENT_ZERO) },
+};
+STATIC MP_DEFINE_CONST_DICT(mach_counter_locals_dict, mach_counter_locals_dict_table);
+
+const mp_obj_type_t mach_counter_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Counter,
+    .print = mach_counter_print,
+    .make_new = mach_counter_make_new,
+    .locals_dict = (mp_obj_t)&mach_counter_locals_dict,
+};
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+
+#include "py/runtime.h"
+#include "py/mpthread.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/i2s.h"
+
+#include "machi2s.h"
+#include "machpin.h"
+#include "pybadc.h"
+#include "pybdac.h"
+#include "mpexception.h"
+#include "mpirq.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MACH_I2S_MONO                       (0)
+#define MACH_I2S_STEREO                     (1)
+
+// the ring of DMA buffers is sized from ibuf, in buffers of this many frames
+#define MACH_I2S_DMA_BUF_LEN                (256)
+#define MACH_I2S_DMA_BUF_COUNT_MIN          (2)
+#define MACH_I2S_DMA_BUF_COUNT_MAX          (128)
+#define MACH_I2S_IBUF_DEFAULT               (8192)
+#define MACH_I2S_RATE_MIN                   (8000)
+#define MACH_I2S_RATE_MAX                   (96000)
+#define MACH_I2S_EVENT_QUEUE_LEN            (16)
+#define MACH_I2S_TASK_STACK_SIZE            (2048)
+#define MACH_I2S_TASK_PRIORITY              (6)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    mp_obj_base_t base;
+    mp_obj_t handler;
+    mp_obj_t handler_arg;
+    QueueHandle_t events;       // the DMA events of the driver
+    TaskHandle_t task;
+    uint32_t rate;
+    uint16_t dma_buf_count;
+    i2s_port_t id;
+    uint8_t mode;               // I2S_MODE_RX or I2S_MODE_TX
+    uint8_t bits;
+    uint8_t format;
+    volatile bool irq_pending;
+    bool enabled;
+} mach_i2s_obj_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC mach_i2s_obj_t mach_i2s_obj[I2S_NUM_MAX] = { {.id = I2S_NUM_0}, {.id = I2S_NUM_1} };
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mach_i2s_callback_handler(void *arg) {
+    mach_i2s_obj_t *self = arg;
+    self->irq_pending = false;
+    if (self->handler && self->handler != mp_const_none) {
+        mp_call_function_1(self->handler, self->handler_arg);
+    }
+}
+
+// counts the DMA buffers done and calls back every half of the ring, which is
+// then free to be read or filled while the other half keeps streaming
+STATIC void TASK_I2S (void *pvParameters) {
+    mach_i2s_obj_t *self = pvParameters;
+    uint32_t done = 0;
+    i2s_event_t event;
+
+    for ( ; ; ) {
+        if (!xQueueReceive(self->events, &event, portMAX_DELAY)) {
+            continue;
+        }
+        if (event.type == I2S_EVENT_MAX) {
+            // sent by deinit
+            break;
+        }
+        if (event.type != I2S_EVENT_RX_DONE && event.type != I2S_EVENT_TX_DONE) {
+            continue;
+        }
+        if (++done >= self->dma_buf_count / 2) {
+            done = 0;
+            // a callback still waiting to run already covers this half
+            if (self->handler && !self->irq_pending) {
+                self->irq_pending = true;
+                mp_irq_queue_interrupt_non_ISR(mach_i2s_callback_handler, (void *)self);
+            }
+        }
+    }
+    self->task = NULL;
+    vTaskDelete(NULL);
+}
+
+STATIC void mach_i2s_deinit_helper(mach_i2s_obj_t *self) {
+    if (self->enabled) {
+        if (self->task) {
+            i2s_event_t event = { .type = I2S_EVENT_MAX };
+            xQueueSendToFront(self->events, &event, portMAX_DELAY);
+            MP_THREAD_GIL_EXIT();
+            while (self->task) {
+                vTaskDelay(1);
+            }
+            MP_THREAD_GIL_ENTER();
+        }
+        i2s_driver_uninstall(self->id);
+        self->events = NULL;
+        self->irq_pending = false;
+        self->enabled = false;
+    }
+}
+
+STATIC void mach_i2s_check(mach_i2s_obj_t *self, uint8_t mode) {
+    if (!self->enabled || self->mode != mode) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+}
+
+STATIC TickType_t mach_i2s_ticks(mp_uint_t n_args, const mp_obj_t *args) {
+    if (n_args < 3 || args[2] == mp_const_none) {
+        return portMAX_DELAY;
+    }
+    mp_int_t timeout = mp_obj_get_int(args[2]);
+    return (timeout < 0) ? portMAX_DELAY : (timeout / portTICK_PERIOD_MS);
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+bool mach_i2s_in_use (i2s_port_t id) {
+    return mach_i2s_obj[id].enabled;
+}
+
+void mach_i2s_deinit0 (void) {
+    for (int i = 0; i < I2S_NUM_MAX; i++) {
+        mach_i2s_deinit_helper(&mach_i2s_obj[i]);
+        INTERRUPT_OBJ_CLEAN(&mach_i2s_obj[i]);
+    }
+}
+
+/******************************************************************************/
+/* Micro Python bindings : I2S object                                         */
+
+STATIC void mach_i2s_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    mach_i2s_obj_t *self = self_in;
+    if (self->enabled) {
+        mp_printf(print, "I2S(%u, mode=I2S.%s, rate=%u, bits=%u, format=I2S.%s, ibuf=%u)", self->id,
+                  (self->mode == I2S_MODE_RX) ? "RX" : "TX", self->rate, self->bits,
+                  (self->format == MACH_I2S_STEREO) ? "STEREO" : "MONO",
+                  self->dma_buf_count * MACH_I2S_DMA_BUF_LEN * (self->bits / 8) * (self->format + 1));
+    } else {
+        mp_printf(print, "I2S(%u)", self->id);
+    }
+}
+
+STATIC const mp_arg_t mach_i2s_init_args[] = {
+    { MP_QSTR_id,                           MP_ARG_INT,  {.u_int = 1} },
+    { MP_QSTR_mode,         MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = I2S_MODE_RX} },
+    { MP_QSTR_sck,          MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_ws,           MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_sd,           MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_rate,         MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = 16000} },
+    { MP_QSTR_bits,         MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = 16} },
+    { MP_QSTR_format,       MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACH_I2S_MONO} },
+    { MP_QSTR_ibuf,         MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACH_I2S_IBUF_DEFAULT} },
+};
+
+STATIC mp_obj_t mach_i2s_init_helper(mach_i2s_obj_t *self, const mp_arg_val_t *args) {
+    mp_int_t mode = args[1].u_int;
+    mp_int_t rate = args[5].u_int;
+    mp_int_t bits = args[6].u_int;
+    mp_int_t format = args[7].u_int;
+    if ((mode != I2S_MODE_RX && mode != I2S_MODE_TX) || (bits != 16 && bits != 32) ||
+        (format != MACH_I2S_MONO && format != MACH_I2S_STEREO) || rate < MACH_I2S_RATE_MIN || rate > MACH_I2S_RATE_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    if (args[2].u_obj == mp_const_none || args[3].u_obj == mp_const_none || args[4].u_obj == mp_const_none) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "the sck, ws and sd pins are required"));
+    }
+    i2s_pin_config_t pin_config = {
+        .bck_io_num = pin_find(args[2].u_obj)->pin_number,
+        .ws_io_num = pin_find(args[3].u_obj)->pin_number,
+        .data_out_num = I2S_PIN_NO_CHANGE,
+        .data_in_num = I2S_PIN_NO_CHANGE,
+    };
+    if (mode == I2S_MODE_RX) {
+        pin_config.data_in_num = pin_find(args[4].u_obj)->pin_number;
+    } else {
+        pin_config.data_out_num = pin_find(args[4].u_obj)->pin_number;
+    }
+
+    // I2S0 may be streaming the DAC or the ADC already
+    if (self->id == I2S_NUM_0 && (pyb_dac_wave_in_use() || pyb_adc_stream_in_use())) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+    }
+
+    uint32_t frame_size = (bits / 8) * (format + 1);
+    uint32_t buf_count = args[8].u_int / (MACH_I2S_DMA_BUF_LEN * frame_size);
+    buf_count = MIN(MAX(buf_count, MACH_I2S_DMA_BUF_COUNT_MIN), MACH_I2S_DMA_BUF_COUNT_MAX);
+
+    mach_i2s_deinit_helper(self);
+
+    i2s_config_t i2s_config = {
+        .mode = I2S_MODE_MASTER | mode,
+        .sample_rate = rate,
+        .bits_per_sample = bits,
+        .channel_format = (format == MACH_I2S_STEREO) ? I2S_CHANNEL_FMT_RIGHT_LEFT : I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB,
+        .intr_alloc_flags = 0,
+        .dma_buf_count = buf_count,
+        .dma_buf_len = MACH_I2S_DMA_BUF_LEN,
+        .use_apll = false,
+    };
+    if (ESP_OK != i2s_driver_install(self->id, &i2s_config, MACH_I2S_EVENT_QUEUE_LEN, &self->events)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    if (ESP_OK != i2s_set_pin(self->id, &pin_config)) {
+        i2s_driver_uninstall(self->id);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+
+    self->mode = mode;
+    self->rate = rate;
+    self->bits = bits;
+    self->format = format;
+    self->dma_buf_count = buf_count;
+    self->irq_pending = false;
+    self->enabled = true;
+
+    if (pdPASS != xTaskCreatePinnedToCore(TASK_I2S, "I2S", MACH_I2S_TASK_STACK_SIZE / sizeof(StackType_t),
+                                          self, MACH_I2S_TASK_PRIORITY, &self->task, 1)) {
+        self->task = NULL;
+        mach_i2s_deinit_helper(self);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "cannot start the I2S task"));
+    }
+    return mp_const_none;
+}
+
+STATIC mp_obj_t mach_i2s_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
+    // parse args
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_i2s_init_args)];
+    mp_arg_parse_all(n_args, all_args, &kw_args, MP_ARRAY_SIZE(args), mach_i2s_init_args, args);
+
+    mp_int_t id = args[0].u_int;
+    if (id < 0 || id >= I2S_NUM_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+    }
+    mach_i2s_obj_t *self = &mach_i2s_obj[id];
+    self->base.type = &mach_i2s_type;
+
+    // only (re)configure the peripheral if the pins are given
+    if (args[2].u_obj != mp_const_none) {
+        mach_i2s_init_helper(self, args);
+    }
+    return self;
+}
+
+STATIC mp_obj_t mach_i2s_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mach_i2s_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_i2s_init_args)];
+    // the id can't change
+    args[0].u_int = self->id;
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(mach_i2s_init_args) - 1, mach_i2s_init_args + 1, &args[1]);
+    return mach_i2s_init_helper(self, args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_i2s_init_obj, 1, mach_i2s_init);
+
+STATIC mp_obj_t mach_i2s_deinit(mp_obj_t self_in) {
+    mach_i2s_deinit_helper(self_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_i2s_deinit_obj, mach_i2s_deinit);
+
+/// \method readinto(buf, [timeout_ms])
+/// Copies the received frames out of the DMA ring, returns the number of bytes.
+/// It waits for len(buf) bytes unless a timeout is given, 0 only takes what's there.
+STATIC mp_obj_t mach_i2s_readinto(mp_uint_t n_args, const mp_obj_t *args) {
+    mach_i2s_obj_t *self = args[0];
+    mach_i2s_check(self, I2S_MODE_RX);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    TickType_t ticks = mach_i2s_ticks(n_args, args);
+
+    size_t len = 0;
+    MP_THREAD_GIL_EXIT();
+    i2s_read(self->id, bufinfo.buf, bufinfo.len, &len, ticks);
+    MP_THREAD_GIL_ENTER();
+    return mp_obj_new_int(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mach_i2s_readinto_obj, 2, 3, mach_i2s_readinto);
+
+/// \method write(buf, [timeout_ms])
+/// Copies the frames into the free DMA buffers, returns the number of bytes taken
+STATIC mp_obj_t mach_i2s_write(mp_uint_t n_args, const mp_obj_t *args) {
+    mach_i2s_obj_t *self = args[0];
+    mach_i2s_check(self, I2S_MODE_TX);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    TickType_t ticks = mach_i2s_ticks(n_args, args);
+
+    size_t len = 0;
+    MP_THREAD_GIL_EXIT();
+    i2s_write(self->id, bufinfo.buf, bufinfo.len, &len, ticks);
+    MP_THREAD_GIL_ENTER();
+    return mp_obj_new_int(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mach_i2s_write_obj, 2, 3, mach_i2s_write);
+
+/// \method irq(handler, arg)
+/// The handler is called every time half of the DMA ring has been received or sent
+STATIC mp_obj_t mach_i2s_irq(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_handler,      MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_arg,          MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    mach_i2s_obj_t *self = pos_args[0];
+
+    if (args[0].u_obj != mp_const_none) {
+        mp_irq_add(self, args[0].u_obj);
+        self->handler_arg = (args[1].u_obj == mp_const_none) ? self : args[1].u_obj;
+        self->handler = args[0].u_obj;
+    } else {
+        mp_irq_remove(self);
+        INTERRUPT_OBJ_CLEAN(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_i2s_irq_obj, 1, mach_i2s_irq);
+
+STATIC const mp_map_elem_t mach_i2s_locals_dict_table[] = {
+    // instance methods
+    { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&mach_i2s_init_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&mach_i2s_deinit_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto),            (mp_obj_t)&mach_i2s_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write),               (mp_obj_t)&mach_i2s_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_irq),                 (mp_obj_t)&mach_i2s_irq_obj },
+
+    // class constants
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RX),                  MP_OBJ_NEW_SMALL_INT(I2S_MODE_RX) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TX),                  MP_OBJ_NEW_SMALL_INT(I2S_MODE_TX) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MONO),                MP_OBJ_NEW_SMALL_INT(MACH_I2S_MONO) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_STEREO),              MP_OBJ_NEW_SMALL_INT(MACH_I2S_STEREO) },
+};
+STATIC MP_DEFINE_CONST_DICT(mach_i2s_locals_dict, mach_i2s_locals_dict_table);
+
+const mp_obj_type_t mach_i2s_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_I2S,
+    .print = mach_i2s_print,
+    .make_new = mach_i2s_make_new,
+    .locals_dict = (mp_obj_t)&mach_i2s_locals_dict,
+};
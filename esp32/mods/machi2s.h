@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MACHI2S_H_
+#define MACHI2S_H_
+
+#include "driver/i2s.h"
+
+extern const mp_obj_type_t mach_i2s_type;
+
+// I2S0 also drives DAC.play() and the ADC streaming, only one of them can own it
+extern bool mach_i2s_in_use (i2s_port_t id);
+extern void mach_i2s_deinit0 (void);
+
+#endif /* MACHI2S_H_ */
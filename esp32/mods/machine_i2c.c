@@ -40,6 +40,7 @@
 
 #include "py/mpstate.h"
 #include "py/runtime.h"
+#include "py/mpthread.h"
 #include "bufhelper.h"
 
 #include "esp_heap_caps.h"
@@ -56,6 +57,7 @@
 #include "machpin.h"
 #include "pins.h"
 #include "mpexception.h"
+#include "mpirq.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -63,21 +65,58 @@
 #include "driver/i2c.h"
 #include "driver/gpio.h"
 #include "driver/periph_ctrl.h"
+#include "soc/i2c_struct.h"
+#include "soc/i2c_reg.h"
+
+// register map emulation, everything the ISR touches
+typedef struct {
+    i2c_dev_t *dev;
+    intr_handle_t intr;
+    uint8_t *regs;
+    uint32_t len;
+    uint32_t pointer;       // the register the host reads or writes next
+    uint32_t tx_pointer;    // the next register to go into the TX FIFO
+    uint32_t loaded;        // bytes put in the TX FIFO since it was last reset
+    bool writable;
+    bool first;             // the next byte written by the host selects the register
+    bool written;           // the host wrote registers in this transaction
+    volatile bool irq_pending;
+} machine_i2c_slave_t;
 
 typedef struct _machine_i2c_obj_t {
     mp_obj_base_t base;
+    mp_obj_t handler;
+    mp_obj_t handler_arg;
     uint32_t us_delay;
     uint32_t baudrate;
     pin_obj_t *scl;
     pin_obj_t *sda;
+    machine_i2c_slave_t slave;
     uint8_t bus_id;
+    uint8_t addr;           // own address as a slave, 0 when not one
 } machine_i2c_obj_t;
 
 #define MACHI2C_MASTER                          (0)
+#define MACHI2C_SLAVE                           (1)
+#define MACHI2C_FIFO_LEN                        (32)
+#define MACHI2C_SLAVE_REGS_MAX                  (256)       // 8 bit register addresses
 #define I2C_ACK_CHECK_EN                        (1)
 #define I2C_ACK_VAL                             (0)
 #define I2C_NACK_VAL                            (1)
 
+#define MACHI2C_OP_WRITE                        (0)
+#define MACHI2C_OP_READ                         (1)
+#define MACHI2C_OP_RESTART                      (2)
+
+// one step of I2C.transaction()
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint16_t addr;
+    uint8_t op;
+    bool stop;          // false if the next step follows with a repeated start
+} machine_i2c_op_t;
+
 
 STATIC void mp_hal_i2c_stop(machine_i2c_obj_t *self);
 
@@ -275,6 +314,33 @@ er:
     nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "I2C bus error"));
 }
 
+STATIC void mp_hal_i2c_transaction(machine_i2c_obj_t *self, const machine_i2c_op_t *ops, uint32_t n_ops) {
+    for (uint32_t i = 0; i < n_ops; i++) {
+        const machine_i2c_op_t *op = &ops[i];
+        mp_hal_i2c_start(self);
+        if (!mp_hal_i2c_write_byte(self, (op->addr << 1) | (op->op == MACHI2C_OP_READ))) {
+            goto er;
+        }
+        for (uint32_t j = 0; j < op->len; j++) {
+            if (op->op == MACHI2C_OP_READ) {
+                if (!mp_hal_i2c_read_byte(self, &op->data[j], j == op->len - 1)) {
+                    goto er;
+                }
+            } else if (!mp_hal_i2c_write_byte(self, op->data[j])) {
+                goto er;
+            }
+        }
+        if (op->stop) {
+            mp_hal_i2c_stop(self);
+        }
+    }
+    return;
+
+er:
+    mp_hal_i2c_stop(self);
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "I2C bus error"));
+}
+
 STATIC void mp_hal_i2c_write_mem(machine_i2c_obj_t *self, uint8_t addr, uint16_t memaddr, uint8_t addr_size, const uint8_t *src, size_t len) {
     // start the I2C transaction
     mp_hal_i2c_start(self);
@@ -410,6 +476,43 @@ STATIC void hw_i2c_master_readfrom(machine_i2c_obj_t *i2c_obj, uint16_t slave_ad
     }
 }
 
+STATIC void hw_i2c_master_transaction(machine_i2c_obj_t *i2c_obj, const machine_i2c_op_t *ops, uint32_t n_ops) {
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    uint32_t len = 0;
+
+    for (uint32_t i = 0; i < n_ops; i++) {
+        const machine_i2c_op_t *op = &ops[i];
+        ESP_ERROR_CHECK(i2c_master_start(cmd));
+        if (op->op == MACHI2C_OP_READ) {
+            ESP_ERROR_CHECK(i2c_master_write_byte(cmd, (op->addr << 1) | I2C_MASTER_READ, I2C_ACK_CHECK_EN));
+            if (op->len > 1) {
+                ESP_ERROR_CHECK(i2c_master_read(cmd, op->data, op->len - 1, I2C_ACK_VAL));
+            }
+            ESP_ERROR_CHECK(i2c_master_read_byte(cmd, op->data + op->len - 1, I2C_NACK_VAL));
+        } else {
+            ESP_ERROR_CHECK(i2c_master_write_byte(cmd, (op->addr << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN));
+            if (op->len > 0) {
+                ESP_ERROR_CHECK(i2c_master_write(cmd, op->data, op->len, I2C_ACK_CHECK_EN));
+            }
+        }
+        if (op->stop) {
+            ESP_ERROR_CHECK(i2c_master_stop(cmd));
+        }
+        len += op->len;
+    }
+
+    // the buffers are held by the caller's list, so the bus can run without the GIL
+    MP_THREAD_GIL_EXIT();
+    esp_err_t ret = i2c_master_cmd_begin(i2c_obj->bus_id, cmd, (5000 + (1000 * len)) / portTICK_RATE_MS);
+    MP_THREAD_GIL_ENTER();
+    i2c_cmd_link_delete(cmd);
+
+    if (ret != ESP_OK) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "I2C bus error"));
+    }
+}
+
 STATIC bool hw_i2c_slave_ping (machine_i2c_obj_t *i2c_obj, uint16_t slave_addr) {
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     ESP_ERROR_CHECK(i2c_master_start(cmd));
@@ -421,6 +524,139 @@ STATIC bool hw_i2c_slave_ping (machine_i2c_obj_t *i2c_obj, uint16_t slave_addr)
     return (ret == ESP_OK) ? true : false;
 }
 
+/******************************************************************************
+ SLAVE MODE
+ ******************************************************************************/
+// the TX FIFO always holds the registers from the pointer on, so that a read
+// by the host is answered at bus speed without waiting for any code to run
+STATIC IRAM_ATTR void machine_i2c_slave_fill (machine_i2c_slave_t *slave, uint32_t bus_id) {
+    uint32_t n = MACHI2C_FIFO_LEN - slave->dev->status_reg.tx_fifo_cnt;
+    while (n--) {
+        WRITE_PERI_REG(I2C_DATA_APB_REG(bus_id), slave->regs[slave->tx_pointer]);
+        slave->tx_pointer = (slave->tx_pointer + 1) % slave->len;
+        slave->loaded++;
+    }
+}
+
+STATIC IRAM_ATTR void machine_i2c_slave_load (machine_i2c_slave_t *slave, uint32_t bus_id) {
+    slave->dev->fifo_conf.tx_fifo_rst = 1;
+    slave->dev->fifo_conf.tx_fifo_rst = 0;
+    slave->tx_pointer = slave->pointer;
+    slave->loaded = 0;
+    machine_i2c_slave_fill(slave, bus_id);
+}
+
+STATIC void machine_i2c_slave_callback_handler (void *arg) {
+    machine_i2c_obj_t *self = arg;
+    self->slave.irq_pending = false;
+    if (self->handler && self->handler != mp_const_none) {
+        mp_call_function_1(self->handler, self->handler_arg);
+    }
+}
+
+// the first byte of a write sets the register pointer, the next ones go into the
+// registers from there on, reads take the bytes out of the TX FIFO
+STATIC IRAM_ATTR void machine_i2c_slave_isr (void *arg) {
+    machine_i2c_obj_t *self = arg;
+    machine_i2c_slave_t *slave = &self->slave;
+    i2c_dev_t *dev = slave->dev;
+    uint32_t status = dev->int_status.val;
+    dev->int_clr.val = status;
+
+    if (status & (I2C_RXFIFO_FULL_INT_ST_M | I2C_TRANS_COMPLETE_INT_ST_M)) {
+        for (uint32_t n = dev->status_reg.rx_fifo_cnt; n > 0; n--) {
+            uint8_t data = dev->fifo_data.data;
+            if (slave->first) {
+                slave->first = false;
+                slave->pointer = data % slave->len;
+                machine_i2c_slave_load(slave, self->bus_id);
+            } else {
+                if (slave->writable) {
+                    slave->regs[slave->pointer] = data;
+                    slave->written = true;
+                }
+                slave->pointer = (slave->pointer + 1) % slave->len;
+            }
+        }
+    }
+    if (status & I2C_TXFIFO_EMPTY_INT_ST_M) {
+        machine_i2c_slave_fill(slave, self->bus_id);
+    }
+    if (status & I2C_TRANS_COMPLETE_INT_ST_M) {
+        // stop condition, a read continues after the last byte the host took
+        if (dev->status_reg.slave_rw) {
+            slave->pointer = (slave->pointer + slave->loaded - dev->status_reg.tx_fifo_cnt) % slave->len;
+        }
+        slave->first = true;
+        machine_i2c_slave_load(slave, self->bus_id);
+        if (slave->written && self->handler && !slave->irq_pending) {
+            slave->irq_pending = true;
+            mp_irq_queue_interrupt(machine_i2c_slave_callback_handler, (void *)self);
+        }
+        slave->written = false;
+    }
+}
+
+STATIC void hw_i2c_initialise_slave (machine_i2c_obj_t *i2c_obj) {
+    machine_i2c_slave_t *slave = &i2c_obj->slave;
+    i2c_config_t conf;
+
+    conf.mode = I2C_MODE_SLAVE;
+    conf.sda_io_num = i2c_obj->sda->pin_number;
+    conf.scl_io_num = i2c_obj->scl->pin_number;
+    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.slave.addr_10bit_en = 0;
+    conf.slave.slave_addr = i2c_obj->addr;
+
+    // the ISR below takes the place of the driver's ring buffers
+    periph_module_enable(i2c_obj->bus_id == 0 ? PERIPH_I2C0_MODULE : PERIPH_I2C1_MODULE);
+    i2c_param_config(i2c_obj->bus_id, &conf);
+
+    slave->dev = (i2c_obj->bus_id == 0) ? &I2C0 : &I2C1;
+    slave->dev->int_ena.val = 0;
+    slave->dev->int_clr.val = ~0;
+    // every byte written by the host is seen right away, the first one moves the pointer
+    slave->dev->fifo_conf.rx_fifo_full_thrhd = 1;
+    slave->dev->fifo_conf.tx_fifo_empty_thrhd = MACHI2C_FIFO_LEN / 4;
+    slave->dev->fifo_conf.rx_fifo_rst = 1;
+    slave->dev->fifo_conf.rx_fifo_rst = 0;
+    slave->pointer = 0;
+    slave->first = true;
+    slave->written = false;
+    slave->irq_pending = false;
+    machine_i2c_slave_load(slave, i2c_obj->bus_id);
+
+    if (ESP_OK != i2c_isr_register(i2c_obj->bus_id, machine_i2c_slave_isr, i2c_obj, 0, &slave->intr)) {
+        periph_module_disable(i2c_obj->bus_id == 0 ? PERIPH_I2C0_MODULE : PERIPH_I2C1_MODULE);
+        MP_STATE_PORT(mach_i2c_slave_buf)[i2c_obj->bus_id] = MP_OBJ_NULL;
+        i2c_obj->addr = 0;
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    slave->dev->int_ena.val = I2C_RXFIFO_FULL_INT_ENA_M | I2C_TXFIFO_EMPTY_INT_ENA_M | I2C_TRANS_COMPLETE_INT_ENA_M;
+}
+
+STATIC void hw_i2c_deinit_slave (machine_i2c_obj_t *i2c_obj) {
+    if (i2c_obj->addr) {
+        i2c_obj->slave.dev->int_ena.val = 0;
+        i2c_isr_free(i2c_obj->slave.intr);
+        periph_module_disable(i2c_obj->bus_id == 0 ? PERIPH_I2C0_MODULE : PERIPH_I2C1_MODULE);
+        MP_STATE_PORT(mach_i2c_slave_buf)[i2c_obj->bus_id] = MP_OBJ_NULL;
+        i2c_obj->slave.regs = NULL;
+        i2c_obj->addr = 0;
+    }
+}
+
+// set the af values, so that deassign works later on
+STATIC void i2c_assign_pins_af (machine_i2c_obj_t *self) {
+    if (self->sda && self->scl) {
+        self->sda->af_out = mach_i2c_pin_af[self->bus_id][0];
+        self->sda->af_in = mach_i2c_pin_af[self->bus_id][1];
+        self->scl->af_out = mach_i2c_pin_af[self->bus_id][2];
+        self->scl->af_in = mach_i2c_pin_af[self->bus_id][3];
+    }
+}
+
 STATIC void i2c_deassign_pins_af (machine_i2c_obj_t *self) {
     if (self->sda && self->scl) {
         // we must set the value to 1 so that when Rx pins are deassigned, their are hardwired to 1
@@ -448,14 +684,31 @@ STATIC void machine_i2c_print(const mp_print_t *print, mp_obj_t self_in, mp_prin
     machine_i2c_obj_t *self = self_in;
     if (self->baudrate > 0) {
         mp_printf(print, "I2C(%u, I2C.MASTER, baudrate=%u)", self->bus_id, self->baudrate);
+    } else if (self->addr) {
+        mp_printf(print, "I2C(%u, I2C.SLAVE, addr=0x%02x)", self->bus_id, self->addr);
     } else {
         mp_printf(print, "I2C(%u)", self->bus_id);
     }
 }
 
 STATIC mp_obj_t machine_i2c_init_helper(machine_i2c_obj_t *self, const mp_arg_val_t *args) {
-    // verify that mode is master
-    if (args[0].u_int != MACHI2C_MASTER) {
+    bool slave = args[0].u_int == MACHI2C_SLAVE;
+    mp_buffer_info_t bufinfo;
+    bool writable = false;
+    if (slave) {
+        // the software bus can only be a master
+        if (self->bus_id >= 2 || args[3].u_int < 0x08 || args[3].u_int > 0x77 || args[4].u_obj == mp_const_none) {
+            goto invalid_args;
+        }
+        // a bytearray can be written by the host, bytes can only be read
+        writable = mp_get_buffer(args[4].u_obj, &bufinfo, MP_BUFFER_WRITE);
+        if (!writable) {
+            mp_get_buffer_raise(args[4].u_obj, &bufinfo, MP_BUFFER_READ);
+        }
+        if (bufinfo.len == 0 || bufinfo.len > MACHI2C_SLAVE_REGS_MAX) {
+            goto invalid_args;
+        }
+    } else if (args[0].u_int != MACHI2C_MASTER) {
         goto invalid_args;
     }
 
@@ -463,7 +716,9 @@ STATIC mp_obj_t machine_i2c_init_helper(machine_i2c_obj_t *self, const mp_arg_va
     if (self->bus_id < 2) {
         if (self->baudrate > 0) {
             i2c_driver_delete(self->bus_id);
+            self->baudrate = 0;
         }
+        hw_i2c_deinit_slave(self);
         i2c_deassign_pins_af(self);
     }
 
@@ -481,6 +736,17 @@ STATIC mp_obj_t machine_i2c_init_helper(machine_i2c_obj_t *self, const mp_arg_va
         self->scl = pin_find(pins[1]);
     }
 
+    if (slave) {
+        MP_STATE_PORT(mach_i2c_slave_buf)[self->bus_id] = args[4].u_obj;
+        self->slave.regs = bufinfo.buf;
+        self->slave.len = bufinfo.len;
+        self->slave.writable = writable;
+        self->addr = args[3].u_int;
+        hw_i2c_initialise_slave(self);
+        i2c_assign_pins_af(self);
+        return mp_const_none;
+    }
+
     // get the baudrate
     if (args[1].u_int > 0) {
         self->baudrate = args[1].u_int;
@@ -490,13 +756,7 @@ STATIC mp_obj_t machine_i2c_init_helper(machine_i2c_obj_t *self, const mp_arg_va
 
     if (self->bus_id < 2) {
         hw_i2c_initialise_master(self);
-        // set the af values, so that deassign works later on
-        if (self->sda && self->scl) {
-            self->sda->af_out = mach_i2c_pin_af[self->bus_id][0];
-            self->sda->af_in = mach_i2c_pin_af[self->bus_id][1];
-            self->scl->af_out = mach_i2c_pin_af[self->bus_id][2];
-            self->scl->af_in = mach_i2c_pin_af[self->bus_id][3];
-        }
+        i2c_assign_pins_af(self);
     } else {
         mp_hal_i2c_init(self);
     }
@@ -512,6 +772,8 @@ STATIC const mp_arg_t machine_i2c_init_args[] = {
     { MP_QSTR_mode,                        MP_ARG_INT, {.u_int = MACHI2C_MASTER} },
     { MP_QSTR_baudrate,  MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 100000} },
     { MP_QSTR_pins,      MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_addr,      MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_buf,       MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
 };
 STATIC mp_obj_t machine_i2c_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
     // parse args
@@ -735,6 +997,67 @@ STATIC mp_obj_t machine_i2c_writeto_mem(size_t n_args, const mp_obj_t *pos_args,
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_i2c_writeto_mem_obj, 1, machine_i2c_writeto_mem);
 
+/// \method transaction(ops)
+/// Runs a list of (I2C.WRITE, addr, buf) and (I2C.READ, addr, buf) steps as one bus
+/// transaction. Every step ends with a stop condition unless it is followed by
+/// I2C.RESTART, and READ steps fill their buffer in place.
+STATIC mp_obj_t machine_i2c_transaction(mp_obj_t self_in, mp_obj_t ops_in) {
+    machine_i2c_obj_t *self = self_in;
+
+    mp_uint_t n_items;
+    mp_obj_t *items;
+    mp_obj_get_array(ops_in, &n_items, &items);
+
+    machine_i2c_op_t *ops = m_new(machine_i2c_op_t, n_items);
+    uint32_t n_ops = 0;
+    for (mp_uint_t i = 0; i < n_items; i++) {
+        if (MP_OBJ_IS_SMALL_INT(items[i]) && MP_OBJ_SMALL_INT_VALUE(items[i]) == MACHI2C_OP_RESTART) {
+            if (n_ops > 0) {
+                ops[n_ops - 1].stop = false;
+            }
+            continue;
+        }
+
+        mp_obj_t *step;
+        mp_obj_get_array_fixed_n(items[i], 3, &step);
+        machine_i2c_op_t *op = &ops[n_ops++];
+        op->op = mp_obj_get_int(step[0]);
+        op->addr = mp_obj_get_int(step[1]);
+        op->stop = true;
+
+        mp_buffer_info_t bufinfo;
+        if (op->op == MACHI2C_OP_READ) {
+            mp_get_buffer_raise(step[2], &bufinfo, MP_BUFFER_WRITE);
+            if (bufinfo.len == 0) {
+                goto invalid_args;
+            }
+        } else if (op->op == MACHI2C_OP_WRITE) {
+            mp_get_buffer_raise(step[2], &bufinfo, MP_BUFFER_READ);
+        } else {
+            goto invalid_args;
+        }
+        op->data = bufinfo.buf;
+        op->len = bufinfo.len;
+    }
+
+    if (n_ops > 0) {
+        // never leave the bus held
+        ops[n_ops - 1].stop = true;
+        if (self->bus_id < 2) {
+            hw_i2c_master_transaction(self, ops, n_ops);
+        } else {
+            mp_hal_i2c_transaction(self, ops, n_ops);
+        }
+    }
+    m_del(machine_i2c_op_t, ops, n_items);
+    return mp_const_none;
+
+invalid_args:
+    m_del(machine_i2c_op_t, ops, n_items);
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_i2c_transaction_obj, machine_i2c_transaction);
+
 STATIC mp_obj_t machine_i2c_deinit(mp_obj_t self_in) {
     machine_i2c_obj_t *self = self_in;
 
@@ -746,12 +1069,49 @@ STATIC mp_obj_t machine_i2c_deinit(mp_obj_t self_in) {
         }
         // invalidate the baudrate
         self->baudrate = 0;
+    } else if (self->addr) {
+        hw_i2c_deinit_slave(self);
+        i2c_deassign_pins_af(self);
     }
 
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(machine_i2c_deinit_obj, machine_i2c_deinit);
 
+/// \method irq(handler, arg)
+/// Slave mode, the handler is called after each transaction in which the host wrote registers
+STATIC mp_obj_t machine_i2c_irq(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_handler,      MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_arg,          MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    machine_i2c_obj_t *self = pos_args[0];
+
+    if (args[0].u_obj != mp_const_none) {
+        mp_irq_add(self, args[0].u_obj);
+        self->handler_arg = (args[1].u_obj == mp_const_none) ? self : args[1].u_obj;
+        self->handler = args[0].u_obj;
+    } else {
+        mp_irq_remove(self);
+        INTERRUPT_OBJ_CLEAN(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_i2c_irq_obj, 1, machine_i2c_irq);
+
+void machine_i2c_deinit0 (void) {
+    for (int i = 0; i < 2; i++) {
+        if (mach_i2c_obj[i].addr) {
+            machine_i2c_deinit(&mach_i2c_obj[i]);
+        }
+        INTERRUPT_OBJ_CLEAN(&mach_i2c_obj[i]);
+    }
+}
+
 STATIC const mp_rom_map_elem_t machine_i2c_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init),                (mp_obj_t)&machine_i2c_init_obj },
     { MP_ROM_QSTR(MP_QSTR_deinit),              (mp_obj_t)&machine_i2c_deinit_obj },
@@ -767,7 +1127,17 @@ STATIC const mp_rom_map_elem_t machine_i2c_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_readfrom_mem_into),   (mp_obj_t)&machine_i2c_readfrom_mem_into_obj },
     { MP_ROM_QSTR(MP_QSTR_writeto_mem),         (mp_obj_t)&machine_i2c_writeto_mem_obj },
 
+    // batched operations
+    { MP_ROM_QSTR(MP_QSTR_transaction),         (mp_obj_t)&machine_i2c_transaction_obj },
+
+    // slave mode
+    { MP_ROM_QSTR(MP_QSTR_irq),                 (mp_obj_t)&machine_i2c_irq_obj },
+
     { MP_OBJ_NEW_QSTR(MP_QSTR_MASTER),          MP_OBJ_NEW_SMALL_INT(MACHI2C_MASTER) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SLAVE),           MP_OBJ_NEW_SMALL_INT(MACHI2C_SLAVE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_WRITE),           MP_OBJ_NEW_SMALL_INT(MACHI2C_OP_WRITE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_READ),            MP_OBJ_NEW_SMALL_INT(MACHI2C_OP_READ) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RESTART),         MP_OBJ_NEW_SMALL_INT(MACHI2C_OP_RESTART) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(machine_i2c_locals_dict, machine_i2c_locals_dict_table);
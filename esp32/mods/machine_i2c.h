@@ -42,4 +42,6 @@
 
 extern const mp_obj_type_t machine_i2c_type;
 
+extern void machine_i2c_deinit0 (void);
+
 #endif // __MICROPY_INCLUDED_EXTMOD_MACHINE_I2C_H__
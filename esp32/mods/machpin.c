@@ -45,6 +45,8 @@
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "py/mpstate.h"
+#include "py/mperrno.h"
+#include "py/binary.h"
 
 #include "esp_heap_caps.h"
 #include "sdkconfig.h"
@@ -52,7 +54,9 @@
 #include "esp_spi_flash.h"
 #include "nvs_flash.h"
 #include "esp_intr.h"
+#include "esp_timer.h"
 #include "driver/rtc_io.h"
+#include "rom/ets_sys.h"
 
 #include "gpio.h"
 #include "machpin.h"
@@ -83,10 +87,23 @@ DEFINE CONSTANTS
 #define MACHPIN_SIMPLE_IN_LOW               0x30
 #define MACHPIN_SIMPLE_IN_HIGH              0x38
 #define ETS_GPIO_INUM                       13
+#define MACHPIN_NUM_GPIOS                   40
+#define MACHPIN_EDGE_RING_SIZE_DEFAULT      256         // edges, must be a power of 2
+#define MACHPIN_EDGE_LEVEL                  (1u << 31)
 
 /******************************************************************************
 DEFINE TYPES
 ******************************************************************************/
+// edges captured by the GPIO interrupt, every edge is stored as the time in us
+// (31 bits) with the level after the edge in bit 31
+typedef struct {
+    volatile uint32_t   head;       // free running write index, only moved by the ISR
+    volatile uint32_t   tail;       // free running read index
+    uint32_t            size;
+    uint32_t            dropped;    // edges lost because the ring was full
+    uint32_t            edges[];
+} machpin_edge_ring_t;
+
 //typedef struct {
 //    bool       active;
 //    int8_t     lpds;
@@ -103,6 +120,8 @@ DECLARE PRIVATE DATA
 //                                      {.active = false, .lpds = PYBPIN_WAKES_NOT, .hib = PYBPIN_WAKES_NOT},
 //                                      {.active = false, .lpds = PYBPIN_WAKES_NOT, .hib = PYBPIN_WAKES_NOT},
 //                                      {.active = false, .lpds = PYBPIN_WAKES_NOT, .hib = PYBPIN_WAKES_NOT} } ;
+STATIC machpin_edge_ring_t *machpin_edge_ring[MACHPIN_NUM_GPIOS];
+
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
@@ -319,7 +338,33 @@ STATIC IRAM_ATTR void call_interrupt_handler (pin_obj_t *pin) {
             ((void(*)(void))pin->handler)();
         } else {
             // pass it to the queue
-            mp_irq_queue_interrupt(pin_interrupt_queue_handler, pin);
+            if (pin->hard) {
+                mp_irq_queue_interrupt_hard(pin_interrupt_queue_handler, pin);
+            } else {
+                mp_irq_queue_interrupt_prio(pin_interrupt_queue_handler, pin, MP_IRQ_PRIORITY_LOW);
+            }
+        }
+    }
+}
+
+STATIC IRAM_ATTR void machpin_capture_edge (pin_obj_t *pin, uint32_t time_us) {
+    machpin_edge_ring_t *ring = machpin_edge_ring[pin->pin_number];
+    if (ring) {
+        uint32_t level;
+        if (pin->irq_trigger == GPIO_INTR_POSEDGE) {
+            level = 1;
+        } else if (pin->irq_trigger == GPIO_INTR_NEGEDGE) {
+            level = 0;
+        } else if (pin->pin_number < 32) {
+            level = (READ_PERI_REG(GPIO_IN_REG) >> pin->pin_number) & 1;
+        } else {
+            level = (READ_PERI_REG(GPIO_IN1_REG) >> (pin->pin_number - 32)) & 1;
+        }
+        if (ring->head - ring->tail < ring->size) {
+            ring->edges[ring->head & (ring->size - 1)] = (time_us & ~MACHPIN_EDGE_LEVEL) | (level ? MACHPIN_EDGE_LEVEL : 0);
+            ring->head++;
+        } else {
+            ring->dropped++;
         }
     }
 }
@@ -330,6 +375,8 @@ STATIC IRAM_ATTR void machpin_intr_process (void* arg) {
 
     uint32_t gpio_intr_status = READ_PERI_REG(GPIO_STATUS_REG);
     uint32_t gpio_intr_status_h = READ_PERI_REG(GPIO_STATUS1_REG);
+    // one time stamp for all the edges of this interrupt
+    uint32_t time_us = (uint32_t)esp_timer_get_time();
 
 #ifdef MICROPY_LPWAN_DIO_PIN
     // fast path for the LPWAN DIO interrupt
@@ -350,6 +397,7 @@ STATIC IRAM_ATTR void machpin_intr_process (void* arg) {
     while (gpio_num < 32) {
         if (gpio_intr_status & mask) {
             pin_obj_t *self = (pin_obj_t *)pin_find_pin_by_num(&pin_cpu_pins_locals_dict, gpio_num);
+            machpin_capture_edge(self, time_us);
             call_interrupt_handler(self);
         }
         gpio_num++;
@@ -361,6 +409,7 @@ STATIC IRAM_ATTR void machpin_intr_process (void* arg) {
     while (gpio_num < 40) {
         if (gpio_intr_status_h & mask) {
             pin_obj_t *self = (pin_obj_t *)pin_find_pin_by_num(&pin_cpu_pins_locals_dict, gpio_num);
+            machpin_capture_edge(self, time_us);
             call_interrupt_handler(self);
         }
         gpio_num++;
@@ -615,12 +664,14 @@ STATIC void set_pin_callback_helper(mp_obj_t self_in, mp_obj_t handler, mp_obj_t
     self->handler_arg = handler_arg;
 }
 
-/// \method callback(trigger, handler, arg)
+/// \method callback(trigger, handler, arg, *, hard=False)
+/// A hard handler runs ahead of all the other callbacks but can't allocate memory.
 STATIC mp_obj_t pin_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     STATIC const mp_arg_t allowed_args[] = {
         { MP_QSTR_trigger,      MP_ARG_INT,                  {.u_int = GPIO_INTR_DISABLE} },
         { MP_QSTR_handler,      MP_ARG_OBJ,                  {.u_obj = mp_const_none} },
         { MP_QSTR_arg,          MP_ARG_OBJ,                  {.u_obj = mp_const_none} },
+        { MP_QSTR_hard,         MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
     };
 
     // parse arguments
@@ -633,18 +684,120 @@ STATIC mp_obj_t pin_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     // enable the interrupt just before leaving
     if (args[0].u_int != GPIO_INTR_DISABLE && args[1].u_obj != mp_const_none) {
         set_pin_callback_helper(self, args[1].u_obj, args[2].u_obj);
+        self->hard = args[3].u_bool;
         pin_extint_register(self, args[0].u_int, 0);
         mp_irq_add(self, args[1].u_obj);
         pin_irq_enable(self);
     } else {
         mp_irq_remove(self);
         INTERRUPT_OBJ_CLEAN(self);
+        self->hard = 0;
+        if (machpin_edge_ring[self->pin_number]) {
+            // keep the edge capture going
+            pin_irq_enable(self);
+        }
     }
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pin_callback_obj, 1, pin_callback);
 
+/// \method edge_capture(trigger, *, size=256)
+/// Records the time and level of every edge in a ring read with edges_into().
+/// A trigger of 0 stops the capture. The pin callback uses the same trigger.
+STATIC mp_obj_t pin_edge_capture(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_trigger,      MP_ARG_REQUIRED | MP_ARG_INT, },
+        { MP_QSTR_size,         MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACHPIN_EDGE_RING_SIZE_DEFAULT} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    pin_obj_t *self = pos_args[0];
+
+    uint32_t trigger = args[0].u_int;
+    uint32_t size = args[1].u_int;
+    if (trigger > GPIO_INTR_ANYEDGE || size < 2 || (size & (size - 1))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    pin_irq_disable(self);
+
+    // the ISR doesn't see the old ring anymore once the interrupt is disabled
+    machpin_edge_ring_t *ring = machpin_edge_ring[self->pin_number];
+    machpin_edge_ring[self->pin_number] = NULL;
+    if (ring && (trigger == GPIO_INTR_DISABLE || ring->size != size)) {
+        heap_caps_free(ring);
+        ring = NULL;
+    }
+
+    if (trigger != GPIO_INTR_DISABLE) {
+        if (!ring) {
+            ring = heap_caps_malloc(sizeof(machpin_edge_ring_t) + (size * sizeof(uint32_t)), MALLOC_CAP_INTERNAL);
+            if (!ring) {
+                mp_raise_OSError(MP_ENOMEM);
+            }
+            ring->size = size;
+        }
+        ring->head = 0;
+        ring->tail = 0;
+        ring->dropped = 0;
+        machpin_edge_ring[self->pin_number] = ring;
+        pin_extint_register(self, trigger, 0);
+        pin_irq_enable(self);
+    } else if (self->handler) {
+        // keep the callback going
+        pin_irq_enable(self);
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pin_edge_capture_obj, 1, pin_edge_capture);
+
+/// \method edges_into(buf)
+/// Moves the captured edges into buf as 32 bit words, returns how many.
+STATIC mp_obj_t pin_edges_into(mp_obj_t self_in, mp_obj_t buf_in) {
+    pin_obj_t *self = self_in;
+    machpin_edge_ring_t *ring = machpin_edge_ring[self->pin_number];
+    if (!ring) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint32_t max = bufinfo.len / sizeof(uint32_t);
+    uint32_t *dest = bufinfo.buf;
+
+    uint32_t count = 0;
+    uint32_t tail = ring->tail;
+    uint32_t head = ring->head;
+    while (tail != head && count < max) {
+        dest[count++] = ring->edges[tail & (ring->size - 1)];
+        tail++;
+    }
+    ring->tail = tail;
+
+    return mp_obj_new_int_from_uint(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pin_edges_into_obj, pin_edges_into);
+
+/// \method edges_dropped()
+/// Returns the edges lost because the ring was full since the last call.
+STATIC mp_obj_t pin_edges_dropped(mp_obj_t self_in) {
+    pin_obj_t *self = self_in;
+    machpin_edge_ring_t *ring = machpin_edge_ring[self->pin_number];
+    uint32_t dropped = 0;
+    if (ring) {
+        pin_irq_disable(self);
+        dropped = ring->dropped;
+        ring->dropped = 0;
+        pin_irq_enable(self);
+    }
+    return mp_obj_new_int_from_uint(dropped);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pin_edges_dropped_obj, pin_edges_dropped);
+
 void machpin_register_irq_c_handler(pin_obj_t *self, void *handler) {
     self->handler = handler;
     self->handler_arg = NULL;
@@ -661,6 +814,9 @@ STATIC const mp_map_elem_t pin_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_hold),                    (mp_obj_t)&pin_hold_obj },
 //    { MP_OBJ_NEW_QSTR(MP_QSTR_alt_list),                (mp_obj_t)&pin_alt_list_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_callback),                (mp_obj_t)&pin_callback_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_edge_capture),            (mp_obj_t)&pin_edge_capture_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_edges_into),              (mp_obj_t)&pin_edges_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_edges_dropped),           (mp_obj_t)&pin_edges_dropped_obj },
 
     // class attributes
     { MP_OBJ_NEW_QSTR(MP_QSTR_module),                  (mp_obj_t)&pin_module_pins_obj_type },
@@ -695,6 +851,285 @@ const mp_obj_type_t pin_type = {
     .locals_dict = (mp_obj_t)&pin_locals_dict,
 };
 
+/******************************************************************************/
+// Micro Python bindings; PinGroup
+
+// bit i of a value is pins[i], driven through the W1TS/W1TC registers
+typedef struct {
+    mp_obj_base_t       base;
+    pin_obj_t           *pins[MACHPIN_GROUP_MAX_PINS];
+    uint32_t            mask[2];        // of the whole group, GPIO0-31 and GPIO32-39
+    uint8_t             n_pins;
+    uint8_t             mode;
+    int8_t              shift;          // ascending pins without a gap in one bank, else -1
+    uint8_t             bank;
+} pin_group_obj_t;
+
+STATIC IRAM_ATTR void pin_group_masks (const pin_group_obj_t *self, uint32_t value, uint32_t *set) {
+    if (self->shift >= 0) {
+        set[self->bank] = (value << self->shift) & self->mask[self->bank];
+        set[self->bank ^ 1] = 0;
+    } else {
+        set[0] = set[1] = 0;
+        for (uint32_t i = 0; i < self->n_pins; i++) {
+            if (value & (1 << i)) {
+                uint32_t pin_number = self->pins[i]->pin_number;
+                set[pin_number >> 5] |= 1 << (pin_number & 31);
+            }
+        }
+    }
+}
+
+STATIC IRAM_ATTR void pin_group_write (const pin_group_obj_t *self, uint32_t value, const uint32_t *extra_clr) {
+    uint32_t set[2];
+    pin_group_masks(self, value, set);
+    // the low going pins first, then the high going ones, each bank in a single write
+    if (self->mask[0]) {
+        GPIO_REG_WRITE(GPIO_OUT_W1TC_REG, (self->mask[0] & ~set[0]) | extra_clr[0]);
+        GPIO_REG_WRITE(GPIO_OUT_W1TS_REG, set[0]);
+    }
+    if (self->mask[1]) {
+        GPIO_REG_WRITE(GPIO_OUT1_W1TC_REG, (self->mask[1] & ~set[1]) | extra_clr[1]);
+        GPIO_REG_WRITE(GPIO_OUT1_W1TS_REG, set[1]);
+    }
+}
+
+// so that Pin.value() of a member tells the truth afterwards
+STATIC void pin_group_update_pins (const pin_group_obj_t *self, uint32_t value) {
+    for (uint32_t i = 0; i < self->n_pins; i++) {
+        self->pins[i]->value = (value >> i) & 1;
+    }
+}
+
+STATIC uint32_t pin_group_read (const pin_group_obj_t *self) {
+    uint32_t level[2];
+    if (self->mode == GPIO_MODE_OUTPUT) {
+        // output only pins have the input buffer disabled, read back what is being driven
+        level[0] = GPIO_REG_READ(GPIO_OUT_REG);
+        level[1] = GPIO_REG_READ(GPIO_OUT1_REG);
+    } else {
+        level[0] = GPIO_REG_READ(GPIO_IN_REG);
+        level[1] = GPIO_REG_READ(GPIO_IN1_REG);
+    }
+    if (self->shift >= 0) {
+        return (level[self->bank] & self->mask[self->bank]) >> self->shift;
+    }
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < self->n_pins; i++) {
+        uint32_t pin_number = self->pins[i]->pin_number;
+        value |= ((level[pin_number >> 5] >> (pin_number & 31)) & 1) << i;
+    }
+    return value;
+}
+
+STATIC const mp_arg_t pin_group_init_args[] = {
+    { MP_QSTR_pins,     MP_ARG_REQUIRED |  MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_mode,                        MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_pull,                        MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    { MP_QSTR_value,    MP_ARG_KW_ONLY  |  MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+};
+
+STATIC mp_obj_t pin_group_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    mp_arg_val_t args[MP_ARRAY_SIZE(pin_group_init_args)];
+    mp_arg_parse_all(n_args, all_args, &kw_args, MP_ARRAY_SIZE(args), pin_group_init_args, args);
+
+    mp_uint_t n_pins;
+    mp_obj_t *items;
+    mp_obj_get_array(args[0].u_obj, &n_pins, &items);
+    if (n_pins == 0 || n_pins > MACHPIN_GROUP_MAX_PINS) {
+        goto invalid_args;
+    }
+
+    // output is what a group is for
+    uint mode = GPIO_MODE_OUTPUT;
+    if (args[1].u_obj != MP_OBJ_NULL) {
+        mode = mp_obj_get_int(args[1].u_obj);
+        pin_validate_mode(mode);
+    }
+    uint pull = MACHPIN_PULL_NONE;
+    if (args[2].u_obj != mp_const_none) {
+        pull = mp_obj_get_int(args[2].u_obj);
+        pin_validate_pull(pull);
+    }
+
+    pin_group_obj_t *self = m_new0(pin_group_obj_t, 1);
+    self->base.type = &pin_group_type;
+    self->n_pins = n_pins;
+    self->mode = mode;
+    for (mp_uint_t i = 0; i < n_pins; i++) {
+        pin_obj_t *pin = pin_find(items[i]);
+        uint32_t bit = 1 << (pin->pin_number & 31);
+        if (self->mask[pin->pin_number >> 5] & bit) {
+            // the same pin twice
+            goto invalid_args;
+        }
+        self->mask[pin->pin_number >> 5] |= bit;
+        self->pins[i] = pin;
+    }
+
+    self->bank = self->pins[0]->pin_number >> 5;
+    self->shift = self->pins[0]->pin_number & 31;
+    for (mp_uint_t i = 1; i < n_pins; i++) {
+        if (self->pins[i]->pin_number != self->pins[0]->pin_number + i || (self->pins[i]->pin_number >> 5) != self->bank) {
+            self->shift = -1;
+            break;
+        }
+    }
+
+    int value = -1;
+    if (args[3].u_obj != MP_OBJ_NULL) {
+        value = mp_obj_get_int_truncated(args[3].u_obj);
+    }
+    for (mp_uint_t i = 0; i < n_pins; i++) {
+        pin_config(self->pins[i], -1, -1, mode, pull, (value < 0) ? -1 : ((value >> i) & 1));
+    }
+
+    return (mp_obj_t)self;
+
+invalid_args:
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+}
+
+STATIC mp_obj_t pin_group_value(mp_uint_t n_args, const mp_obj_t *args) {
+    pin_group_obj_t *self = args[0];
+    if (n_args == 1) {
+        return mp_obj_new_int_from_uint(pin_group_read(self));
+    }
+    uint32_t value = mp_obj_get_int_truncated(args[1]);
+    static const uint32_t no_clr[2] = { 0, 0 };
+    pin_group_write(self, value, no_clr);
+    pin_group_update_pins(self, value);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pin_group_value_obj, 1, 2, pin_group_value);
+
+// only the pins whose bit is 1 change, the others keep their level
+STATIC mp_obj_t pin_group_set_clear(mp_obj_t self_in, mp_obj_t bits_in, bool high) {
+    pin_group_obj_t *self = self_in;
+    uint32_t bits = mp_obj_get_int_truncated(bits_in);
+    uint32_t masks[2];
+    pin_group_masks(self, bits, masks);
+    if (high) {
+        GPIO_REG_WRITE(GPIO_OUT_W1TS_REG, masks[0]);
+        GPIO_REG_WRITE(GPIO_OUT1_W1TS_REG, masks[1]);
+    } else {
+        GPIO_REG_WRITE(GPIO_OUT_W1TC_REG, masks[0]);
+        GPIO_REG_WRITE(GPIO_OUT1_W1TC_REG, masks[1]);
+    }
+    for (uint32_t i = 0; i < self->n_pins; i++) {
+        if (bits & (1 << i)) {
+            self->pins[i]->value = high;
+        }
+    }
+    return mp_const_none;
+}
+
+STATIC mp_obj_t pin_group_set(mp_obj_t self_in, mp_obj_t bits_in) {
+    return pin_group_set_clear(self_in, bits_in, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pin_group_set_obj, pin_group_set);
+
+STATIC mp_obj_t pin_group_clear(mp_obj_t self_in, mp_obj_t bits_in) {
+    return pin_group_set_clear(self_in, bits_in, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pin_group_clear_obj, pin_group_clear);
+
+STATIC const mp_arg_t pin_group_write_seq_args[] = {
+    { MP_QSTR_buf,      MP_ARG_REQUIRED |  MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_strobe,   MP_ARG_KW_ONLY  |  MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    { MP_QSTR_delay_us, MP_ARG_KW_ONLY  |  MP_ARG_INT, {.u_int = 0} },
+};
+
+// each item of buf goes on the bus in turn, with strobe (active low, like the WR line of a
+// parallel display) pulled down together with the data and released once it has settled
+STATIC mp_obj_t pin_group_write_seq(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    pin_group_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(pin_group_write_seq_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), pin_group_write_seq_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
+    // only which bits are set matters, so any integer typecode is read as unsigned
+    size_t item_size = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    if (bufinfo.typecode == 'f' || (item_size != 1 && item_size != 2 && item_size != 4)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    size_t n_items = bufinfo.len / item_size;
+    if (n_items == 0) {
+        return mp_const_none;
+    }
+    if (args[2].u_int < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    uint32_t delay_us = args[2].u_int;
+
+    uint32_t strobe[2] = { 0, 0 };
+    volatile uint32_t *strobe_w1ts = NULL;
+    if (args[1].u_obj != mp_const_none) {
+        pin_obj_t *pin = pin_find(args[1].u_obj);
+        if (self->mask[pin->pin_number >> 5] & (1 << (pin->pin_number & 31))) {
+            // it can't be part of the data
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        strobe[pin->pin_number >> 5] = 1 << (pin->pin_number & 31);
+        strobe_w1ts = (volatile uint32_t *)((pin->pin_number < 32) ? GPIO_OUT_W1TS_REG : GPIO_OUT1_W1TS_REG);
+        pin->value = 1;
+    }
+
+    uint32_t value = 0;
+    for (size_t i = 0; i < n_items; i++) {
+        if (item_size == 1) {
+            value = ((const uint8_t *)bufinfo.buf)[i];
+        } else if (item_size == 2) {
+            value = ((const uint16_t *)bufinfo.buf)[i];
+        } else {
+            value = ((const uint32_t *)bufinfo.buf)[i];
+        }
+        pin_group_write(self, value, strobe);
+        if (delay_us) {
+            ets_delay_us(delay_us);
+        }
+        if (strobe_w1ts) {
+            *strobe_w1ts = strobe[0] | strobe[1];
+            if (delay_us) {
+                ets_delay_us(delay_us);
+            }
+        }
+    }
+    pin_group_update_pins(self, value);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pin_group_write_seq_obj, 1, pin_group_write_seq);
+
+STATIC void pin_group_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    pin_group_obj_t *self = self_in;
+    mp_printf(print, "PinGroup([");
+    for (uint32_t i = 0; i < self->n_pins; i++) {
+        mp_printf(print, (i > 0) ? ", '%q'" : "'%q'", self->pins[i]->name);
+    }
+    mp_printf(print, "])");
+}
+
+STATIC const mp_map_elem_t pin_group_locals_dict_table[] = {
+    // instance methods
+    { MP_OBJ_NEW_QSTR(MP_QSTR_value),                   (mp_obj_t)&pin_group_value_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_set),                     (mp_obj_t)&pin_group_set_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_clear),                   (mp_obj_t)&pin_group_clear_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write_seq),               (mp_obj_t)&pin_group_write_seq_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(pin_group_locals_dict, pin_group_locals_dict_table);
+
+const mp_obj_type_t pin_group_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_PinGroup,
+    .print = pin_group_print,
+    .make_new = pin_group_make_new,
+    .locals_dict = (mp_obj_t)&pin_group_locals_dict,
+};
+
 STATIC void pin_named_pins_obj_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     pin_named_pins_obj_t *self = self_in;
     mp_printf(print, "<Pin.%q>", self->name);
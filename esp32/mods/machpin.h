@@ -43,6 +43,8 @@
 #define MACHPIN_PULL_UP                   0x01
 #define MACHPIN_PULL_DOWN                 0x02
 
+#define MACHPIN_GROUP_MAX_PINS            32
+
 enum {
     PIN_TYPE_UART_TXD = 0,
     PIN_TYPE_UART_RXD,
@@ -74,9 +76,11 @@ typedef struct {
     unsigned int        irq_trigger : 3;
     unsigned int        value : 1;
     unsigned int        hold : 1;
+    unsigned int        hard : 1;       // the callback runs in the hard IRQ task
 } pin_obj_t;
 
 extern const mp_obj_type_t pin_type;
+extern const mp_obj_type_t pin_group_type;
 
 typedef struct {
     const char *name;
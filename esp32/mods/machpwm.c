@@ -20,15 +20,34 @@
 #include "py/mphal.h"
 #include "py/gc.h"
 #include "py/stream.h"
+#include "py/mperrno.h"
 #include "mpexception.h"
 #include "machpwm.h"
 #include "ledc.h"
+#include "soc/ledc_struct.h"
 #include "periph_ctrl.h"
 #include "machpin.h"
+#include "mpirq.h"
 
+#include "freertos/FreeRTOS.h"
 
-STATIC mp_obj_t pwm_channel_duty(mp_obj_t self_in, mp_obj_t duty_o) {
-    mach_pwm_channel_obj_t *self = self_in;
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// how often the end of a fade is checked again once its time is over
+#define MACHPWM_FADE_POLL_US                    (1000)
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC bool mach_pwm_fade_installed = false;
+STATIC portMUX_TYPE mach_pwm_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC uint32_t pwm_channel_duty_scaled(mach_pwm_channel_obj_t *self, mp_obj_t duty_o, uint32_t *max_duty) {
     float duty = mp_obj_get_float(duty_o);
     if (duty > 1.0f) {
         duty = 1.0f;
@@ -37,16 +56,49 @@ STATIC mp_obj_t pwm_channel_duty(mp_obj_t self_in, mp_obj_t duty_o) {
     }
 
     uint8_t duty_resolution = ((mach_pwm_timer_obj_t *)MP_STATE_PORT(mach_pwm_timer_obj[self->config.timer_sel]))->config.duty_resolution;
-    uint32_t max_duty = (0x1 << duty_resolution) - 1;
-    uint32_t duty_scaled;
+    *max_duty = (0x1 << duty_resolution) - 1;
     if (duty >= 0.999f) {
-        duty_scaled = max_duty;
-        // need to setup the pin as GPIO and set it high to avoid glitches
-    } else {
-        duty_scaled = (uint32_t) (max_duty * 1.0f * duty);
+        return *max_duty;
+    }
+    return (uint32_t) (*max_duty * 1.0f * duty);
+}
+
+// the driver blocks any duty change until the running fade is over
+STATIC void pwm_channel_check_idle(mach_pwm_channel_obj_t *self) {
+    if (self->fading) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+}
+
+STATIC void pwm_fade_handler(void *arg) {
+    // this function will be called by the interrupt thread
+    mach_pwm_channel_obj_t *self = arg;
+    if (self->fade_handler != mp_const_none) {
+        mp_call_function_1(self->fade_handler, self);
     }
+}
+
+// runs in the esp_timer task when the fade time is over, the hardware may need a few more periods
+STATIC void pwm_fade_timer_cb(void *arg) {
+    mach_pwm_channel_obj_t *self = arg;
+    if (ledc_get_duty(self->config.speed_mode, self->config.channel) != self->fade_target) {
+        esp_timer_start_once(self->fade_timer, MACHPWM_FADE_POLL_US);
+        return;
+    }
+    self->fading = false;
+    if (self->fade_handler != mp_const_none) {
+        mp_irq_queue_interrupt_non_ISR(pwm_fade_handler, self);
+    }
+}
+
+STATIC mp_obj_t pwm_channel_duty(mp_obj_t self_in, mp_obj_t duty_o) {
+    mach_pwm_channel_obj_t *self = self_in;
+    uint32_t max_duty;
+    uint32_t duty_scaled = pwm_channel_duty_scaled(self, duty_o, &max_duty);
 
+    pwm_channel_check_idle(self);
     if (duty_scaled == max_duty) {
+        // need to setup the pin as GPIO and set it high to avoid glitches
         ledc_stop(self->config.speed_mode, self->config.channel, 1);
     } else {
         ledc_set_duty(self->config.speed_mode, self->config.channel, duty_scaled);
@@ -56,6 +108,67 @@ STATIC mp_obj_t pwm_channel_duty(mp_obj_t self_in, mp_obj_t duty_o) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_pwm_channel_duty_obj, pwm_channel_duty);
 
+/// \method fade(duty_cycle, time_ms, *, handler=None)
+/// The LEDC hardware steps the duty cycle to its new value over time_ms, then the
+/// handler is called with the channel. The fade can end sooner when the change is
+/// too small to be stepped that slowly.
+STATIC mp_obj_t pwm_channel_fade(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_duty_cycle,      MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_time_ms,         MP_ARG_REQUIRED | MP_ARG_INT, },
+        { MP_QSTR_handler,         MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    mach_pwm_channel_obj_t *self = pos_args[0];
+
+    uint32_t max_duty;
+    uint32_t target = pwm_channel_duty_scaled(self, args[0].u_obj, &max_duty);
+    mp_int_t time_ms = args[1].u_int;
+    if (time_ms <= 0) {
+        mp_raise_ValueError("time_ms must be positive");
+    }
+    pwm_channel_check_idle(self);
+
+    if (!mach_pwm_fade_installed) {
+        if (ledc_fade_func_install(0) != ESP_OK) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+        mach_pwm_fade_installed = true;
+    }
+    if (self->fade_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = pwm_fade_timer_cb,
+            .arg = self,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "pwm_fade"
+        };
+        if (esp_timer_create(&timer_args, &self->fade_timer) != ESP_OK) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+
+    self->fade_handler = args[2].u_obj;
+    self->fade_target = target;
+    self->fading = true;
+    // nothing to step when already there, the handler still comes after time_ms
+    if (ledc_get_duty(self->config.speed_mode, self->config.channel) != target) {
+        ledc_set_fade_with_time(self->config.speed_mode, self->config.channel, target, time_ms);
+        ledc_fade_start(self->config.speed_mode, self->config.channel, LEDC_FADE_NO_WAIT);
+    }
+    esp_timer_start_once(self->fade_timer, (uint64_t)time_ms * 1000);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_pwm_channel_fade_obj, 3, pwm_channel_fade);
+
+STATIC mp_obj_t pwm_channel_fading(mp_obj_t self_in) {
+    mach_pwm_channel_obj_t *self = self_in;
+    return mp_obj_new_bool(self->fading);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_pwm_channel_fading_obj, pwm_channel_fading);
+
 
 STATIC mp_obj_t mach_pwm_channel_init_helper(mach_pwm_channel_obj_t *self) {
     if (ledc_channel_config(&self->config) != ESP_OK) {
@@ -67,7 +180,9 @@ STATIC mp_obj_t mach_pwm_channel_init_helper(mach_pwm_channel_obj_t *self) {
 
 STATIC const mp_map_elem_t mach_pwm_channel_locals_dict_table[] = {
     // instance methods
-    { MP_OBJ_NEW_QSTR(MP_QSTR_duty_cycle),       (mp_obj_t)&mach_pwm_channel_duty_obj}
+    { MP_OBJ_NEW_QSTR(MP_QSTR_duty_cycle),       (mp_obj_t)&mach_pwm_channel_duty_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fade),             (mp_obj_t)&mach_pwm_channel_fade_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fading),           (mp_obj_t)&mach_pwm_channel_fading_obj},
 };
 STATIC MP_DEFINE_CONST_DICT(mach_pwm_channel_locals_dict, mach_pwm_channel_locals_dict_table);
 
@@ -104,8 +219,11 @@ STATIC mp_obj_t mach_pwm_channel_make_new(mp_uint_t n_args, const mp_obj_t *pos_
     // get the correct pwm timer instance
     if (pwm->mach_pwm_channel_obj_t[pwm_channel_id] == NULL) {
         pwm->mach_pwm_channel_obj_t[pwm_channel_id] = gc_alloc(sizeof(mach_pwm_channel_obj_t), false);
+        memset(pwm->mach_pwm_channel_obj_t[pwm_channel_id], 0, sizeof(mach_pwm_channel_obj_t));
     }
     mach_pwm_channel_obj_t *self = pwm->mach_pwm_channel_obj_t[pwm_channel_id];
+    pwm_channel_check_idle(self);
+    self->fade_handler = mp_const_none;
 
     float duty = 0.5f;
     if (args[2].u_obj != MP_OBJ_NULL) {
@@ -213,16 +331,88 @@ STATIC mp_obj_t mach_pwm_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_pwm_init_obj, 1, mach_pwm_init);
 
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+// the fade timers point to the channels in the heap, which is going away
+void mach_pwm_deinit0(void) {
+    for (int t = 0; t <= LEDC_TIMER_3; t++) {
+        mach_pwm_timer_obj_t *pwm = MP_STATE_PORT(mach_pwm_timer_obj[t]);
+        if (pwm == NULL) {
+            continue;
+        }
+        for (int ch = 0; ch <= LEDC_CHANNEL_7; ch++) {
+            mach_pwm_channel_obj_t *self = pwm->mach_pwm_channel_obj_t[ch];
+            if (self != NULL && self->fade_timer != NULL) {
+                esp_timer_stop(self->fade_timer);
+                esp_timer_delete(self->fade_timer);
+                self->fade_timer = NULL;
+            }
+        }
+        MP_STATE_PORT(mach_pwm_timer_obj[t]) = NULL;
+    }
+}
+
 STATIC mp_obj_t mach_pwm_deinit(mp_obj_t self_in) {
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_pwm_deinit_obj, mach_pwm_deinit);
 
+/// \method duty_cycle(channels, duty_cycles)
+/// Sets the duty cycles of several channels of this timer at once. They share the
+/// period of the timer, so the new values latch at the start of the same period.
+STATIC mp_obj_t mach_pwm_duty_cycle(mp_obj_t self_in, mp_obj_t channels_in, mp_obj_t duties_in) {
+    mach_pwm_timer_obj_t *self = self_in;
+    size_t n_channels, n_duties;
+    mp_obj_t *channels, *duties;
+    mp_obj_get_array(channels_in, &n_channels, &channels);
+    mp_obj_get_array(duties_in, &n_duties, &duties);
+    if (n_channels != n_duties) {
+        mp_raise_ValueError("one duty cycle per channel is needed");
+    }
+
+    // check all of them before touching the hardware
+    for (size_t i = 0; i < n_channels; i++) {
+        mach_pwm_channel_obj_t *channel = channels[i];
+        if (!MP_OBJ_IS_TYPE(channel, &mach_pwm_channel_type) ||
+            self->mach_pwm_channel_obj_t[channel->config.channel] != channel) {
+            mp_raise_ValueError("the channels must belong to this PWM timer");
+        }
+        pwm_channel_check_idle(channel);
+    }
+
+    // the duty registers only take effect when their channel is started
+    uint32_t mask = 0;
+    for (size_t i = 0; i < n_channels; i++) {
+        mach_pwm_channel_obj_t *channel = channels[i];
+        uint32_t max_duty;
+        uint32_t duty_scaled = pwm_channel_duty_scaled(channel, duties[i], &max_duty);
+        if (duty_scaled == max_duty) {
+            // stays high for the whole period, latched like the others instead of stopping the output
+            duty_scaled = max_duty + 1;
+        }
+        ledc_set_duty(self->config.speed_mode, channel->config.channel, duty_scaled);
+        mask |= 1 << channel->config.channel;
+    }
+
+    portENTER_CRITICAL(&mach_pwm_spinlock);
+    for (int ch = 0; ch <= LEDC_CHANNEL_7; ch++) {
+        if (mask & (1 << ch)) {
+            LEDC.channel_group[self->config.speed_mode].channel[ch].conf0.sig_out_en = 1;
+            LEDC.channel_group[self->config.speed_mode].channel[ch].conf1.duty_start = 1;
+        }
+    }
+    portEXIT_CRITICAL(&mach_pwm_spinlock);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mach_pwm_duty_cycle_obj, mach_pwm_duty_cycle);
+
 STATIC const mp_map_elem_t mach_pwm_timer_locals_dict_table[] = {
     // instance methods
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),          (mp_obj_t)&mach_pwm_init_obj },
     // { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),        (mp_obj_t)&mach_pwm_deinit_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_channel),       (mp_obj_t)&mach_pwm_channel_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_duty_cycle),    (mp_obj_t)&mach_pwm_duty_cycle_obj},
 };
 STATIC MP_DEFINE_CONST_DICT(mach_pwm_timer_locals_dict, mach_pwm_timer_locals_dict_table);
 
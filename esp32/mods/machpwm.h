@@ -11,10 +11,15 @@
 #define MACHPWM_H_
 
 #include "ledc.h"
+#include "esp_timer.h"
 
 typedef struct {
     mp_obj_base_t base;
     ledc_channel_config_t config;
+    esp_timer_handle_t fade_timer;      // checks for the end of the hardware fade
+    mp_obj_t fade_handler;
+    uint32_t fade_target;
+    volatile bool fading;
 } mach_pwm_channel_obj_t;
 
 
@@ -28,5 +33,7 @@ typedef struct {
 
 extern const mp_obj_type_t mach_pwm_timer_type;
 
+extern void mach_pwm_deinit0(void);
+
 
 #endif  // MACHPWM_H_
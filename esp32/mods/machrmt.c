@@ -7,6 +7,8 @@
  * available at https://www.pycom.io/opensource/licensing
  */
 
+#include <string.h>
+
 #include "py/mpstate.h"
 #include "py/runtime.h"
 #include "py/obj.h"
@@ -15,6 +17,7 @@
 #include "machpin.h"
 #include "rmt.h"
 #include "machrmt.h"
+#include "modled.h"
 
 /******************************************************************************
  DEFINE CONSTANTS
@@ -25,6 +28,15 @@
 #define RMT_RESOLUTION_1000NS  ((uint8_t)80)   /* Maximum measured pulse-width: ~32.768 ms */
 #define RMT_RESOLUTION_3125NS  ((uint8_t)250)  /* Maximum measured pulse-width: ~102.4  ms */
 
+/* Ringbuffer sizes, in pulses, for the default RX driver and for continuous reception */
+#define RMT_RX_PULSES_DEFAULT  (260)
+#define RMT_RX_PULSES_CONTINUOUS_DEFAULT  (2048)
+
+/* The bus filters the glitches below 0.5 us, counted in APB clock periods */
+#define RMT_BUS_FILTER_TICKS   (40)
+/* One memory block holds 128 pulses which is all the bus can get in one go */
+#define RMT_BUS_RX_PULSES      (128)
+
 /******************************************************************************
  DEFINE PRIVATE TYPES
  ******************************************************************************/
@@ -32,12 +44,29 @@ struct _mach_rmt_obj_t {
     mp_obj_base_t base;
     rmt_config_t config;
     bool is_used;
+    bool rx_running;        /* continuous reception, pulses_get_into() drains without stopping */
+    bool has_carry;
+    uint16_t carry;         /* second pulse of an item that didn't fit in the caller's buffer */
+    bool tx_looping;        /* a sequence is repeated from the channel memory until tx_stop() */
+    uint8_t *pixels;        /* two frames of pixels_len bytes, one is sent while the other is filled */
+    size_t pixels_len;
+    uint8_t pixels_back;    /* frame filled by the next write_pixels() */
+    bool is_bus;            /* taken by the 1-Wire/DHT bus, not available from Python */
 };
 
+/* A pulse sequence converted into RMT items once, replayed by sequence_send() */
+typedef struct {
+    mp_obj_base_t base;
+    mp_uint_t count;
+    rmt_item32_t *items;
+} mach_rmt_seq_obj_t;
+
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
 
+static mach_rmt_bus_t mach_rmt_bus = { .tx = RMT_CHANNEL_MAX, .rx = RMT_CHANNEL_MAX, .gpio = GPIO_NUM_MAX };
+
 static mach_rmt_obj_t mach_rmt_obj[RMT_CHANNEL_MAX] = {
     { .config = {.channel = 0, .mem_block_num = 1, .clk_div = RMT_RESOLUTION_1000NS}, .is_used = true },  /* Channel 0 is used for RGB LED user control */
     { .config = {.channel = 1, .mem_block_num = 1, .clk_div = RMT_RESOLUTION_100NS},  .is_used = true },  /* Channel 1 is used for RGB Led Heartbeat signal */
@@ -50,8 +79,40 @@ static mach_rmt_obj_t mach_rmt_obj[RMT_CHANNEL_MAX] = {
 };
 
 
+/* Ringbuffer space for the given number of pulses, see the note in mach_rmt_init_helper() */
+STATIC size_t mach_rmt_rx_buffer_size(mp_uint_t pulses) {
+    return ((pulses + 1) / 2) * sizeof(rmt_item32_t) + sizeof(size_t) + sizeof(int);
+}
+
+STATIC void mach_rmt_check_tx(mach_rmt_obj_t *self) {
+    if(self->is_used == false){
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is not initialized!"));
+    }
+
+    if(self->config.rmt_mode != RMT_MODE_TX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is configured for RX!"));
+    }
+}
+
+/* Stops a looping sequence, it bypasses the driver so nothing else has to be released */
+STATIC void mach_rmt_tx_end_loop(mach_rmt_obj_t *self) {
+    if(self->tx_looping == true) {
+        rmt_tx_stop(self->config.channel);
+        rmt_set_tx_loop_mode(self->config.channel, false);
+        self->tx_looping = false;
+    }
+}
+
+STATIC void mach_rmt_check_not_bus(mach_rmt_obj_t *self) {
+    if(self->is_bus == true) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is used by the 1-Wire/DHT bus!"));
+    }
+}
+
 STATIC mp_obj_t mach_rmt_init_helper(mach_rmt_obj_t *self, const mp_arg_val_t *args) {
 
+    mach_rmt_check_not_bus(self);
+
     if(args[0].u_obj == mp_const_none) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "GPIO must be defined!"));  
     }
@@ -69,6 +130,9 @@ STATIC mp_obj_t mach_rmt_init_helper(mach_rmt_obj_t *self, const mp_arg_val_t *a
     }
 
     /* After it is checked that the given GPIO is correct uninstall the driver if needed */
+    mach_rmt_tx_end_loop(self);
+    self->rx_running = false;
+    self->has_carry = false;
     if(self->is_used == true) {
         /* Deregister the previously registered GPIO */
         gpio_matrix_out(mach_rmt_obj[self->config.channel].config.gpio_num, SIG_GPIO_OUT_IDX, 0, 0);
@@ -158,7 +222,7 @@ STATIC mp_obj_t mach_rmt_init_helper(mach_rmt_obj_t *self, const mp_arg_val_t *a
          * 128*sizeof(rmt_item32_t) + sizeof(size_t) + sizeof(int) is not enough, it does not allow to receive
          * 128 pulses after each other due to a bug/behavior in Ringbuffer's implementation
          **/
-        retval = rmt_driver_install(self->config.channel, 130*sizeof(rmt_item32_t) + sizeof(size_t) + sizeof(int), 0);
+        retval = rmt_driver_install(self->config.channel, mach_rmt_rx_buffer_size(RMT_RX_PULSES_DEFAULT), 0);
         if(retval != ESP_OK) {
             if(retval == ESP_ERR_NO_MEM) {
                 nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Not enough memory to initialize RMT driver!"));
@@ -200,6 +264,7 @@ STATIC mp_obj_t mach_rmt_make_new(const mp_obj_type_t *type, mp_uint_t n_args, m
     }
     
     self = &(mach_rmt_obj[channel]);
+    mach_rmt_check_not_bus(self);
     self->base.type = &mach_rmt_type;
 
     /* Initialize the driver only if the init parameters are given */
@@ -229,40 +294,57 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_init_obj, 1, mach_rmt_init);
 STATIC mp_obj_t mach_rmt_deinit(mp_obj_t self_in) {
 
     mach_rmt_obj_t *self = self_in;
+    mach_rmt_check_not_bus(self);
 
     if(self->is_used == true){
+        mach_rmt_tx_end_loop(self);
         gpio_matrix_out(mach_rmt_obj[self->config.channel].config.gpio_num, SIG_GPIO_OUT_IDX, 0, 0);
         rmt_driver_uninstall(self->config.channel);
+        MP_STATE_PORT(mach_rmt_tx_buf)[self->config.channel] = MP_OBJ_NULL;
         self->is_used = false;
+        self->rx_running = false;
     }
 
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mach_rmt_deinit_obj, mach_rmt_deinit);
 
-STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-
-    STATIC const mp_arg_t mach_rmt_pulses_send_args[] = {
-        { MP_QSTR_id,                     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_duration,               MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_data,                   MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_start_level,            MP_ARG_OBJ | MP_ARG_KW_ONLY,  {.u_obj = MP_OBJ_NULL} },
-        { MP_QSTR_wait_tx_done,           MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_obj = mp_const_true} }
-    };
-
-    // parse args
-    mp_arg_val_t args[MP_ARRAY_SIZE(mach_rmt_pulses_send_args)];
-    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mach_rmt_pulses_send_args), mach_rmt_pulses_send_args, args);
-
-    mach_rmt_obj_t *self = args[0].u_obj;
-
+STATIC void mach_rmt_check_rx(mach_rmt_obj_t *self) {
     if(self->is_used == false){
         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is not initialized!"));
     }
 
-    if(self->config.rmt_mode != RMT_MODE_TX) {
-        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is configured for RX!"));
+    if(self->config.rmt_mode != RMT_MODE_RX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is configured for TX!"));
     }
+}
+
+/* Packs the halves of the items holding a pulse as (level << 15) | duration, which is the
+ * layout of an rmt_item32_t half. Returns the number of pulses stored, a pulse that doesn't fit is carried over */
+STATIC mp_uint_t mach_rmt_pack(mach_rmt_obj_t *self, const rmt_item32_t *items, mp_uint_t n_items, uint8_t *out, mp_uint_t room) {
+    mp_uint_t stored = 0;
+    for(mp_uint_t i = 0; i < n_items; i++) {
+        uint16_t halves[2] = { items[i].val & 0xFFFF, items[i].val >> 16 };
+        for(int h = 0; h < 2; h++) {
+            /* A zero duration marks the end of the reception */
+            if((halves[h] & 0x7FFF) == 0) {
+                continue;
+            }
+            if(stored < room) {
+                memcpy(&out[stored * sizeof(uint16_t)], &halves[h], sizeof(uint16_t));
+                stored++;
+            }
+            else {
+                self->carry = halves[h];
+                self->has_carry = true;
+            }
+        }
+    }
+    return stored;
+}
+
+/* Converts the "duration", "data" and "start_level" arguments of pulses_send() into RMT items */
+STATIC rmt_item32_t* mach_rmt_items_new(mp_obj_t duration_in, mp_obj_t data_in, mp_obj_t start_level_in, mp_uint_t *count) {
 
     mp_uint_t start_level = 0;
     mp_uint_t data_length = 0;
@@ -271,18 +353,17 @@ STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args,
     mp_int_t duration = 0;
     mp_obj_t* data_ptr = NULL;
     mp_obj_t* duration_ptr = NULL;
-    bool wait_tx_done = args[4].u_bool;
 
     /* Get the "duration" mandatory parameter */
-    if(MP_OBJ_IS_SMALL_INT(args[1].u_obj) == true) {
+    if(MP_OBJ_IS_SMALL_INT(duration_in) == true) {
         /* Duration is given as a single number */
         duration_length = 1;
-        duration = mp_obj_get_int(args[1].u_obj);
+        duration = mp_obj_get_int(duration_in);
     }
     else {
-        if(MP_OBJ_IS_TYPE(args[1].u_obj, &mp_type_tuple) == true) {
+        if(MP_OBJ_IS_TYPE(duration_in, &mp_type_tuple) == true) {
             /* Duration is given as a tuple */
-            mp_obj_tuple_get(args[1].u_obj, &duration_length, &duration_ptr);
+            mp_obj_tuple_get(duration_in, &duration_length, &duration_ptr);
         }
         else
         {
@@ -290,7 +371,7 @@ STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args,
         }
     }
 
-    if(args[2].u_obj == MP_OBJ_NULL)
+    if(data_in == MP_OBJ_NULL)
     {
         /* If duration is not a tuple */
         if(duration_length == 1)
@@ -304,9 +385,9 @@ STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args,
             start_level_needed = true;
         }
     }
-    else if(MP_OBJ_IS_TYPE(args[2].u_obj, &mp_type_tuple) == true) {
+    else if(MP_OBJ_IS_TYPE(data_in, &mp_type_tuple) == true) {
         /* In this case the data parameter is a tuple containing the pulses to be sent out */
-        mp_obj_tuple_get(args[2].u_obj, &data_length, &data_ptr);
+        mp_obj_tuple_get(data_in, &data_length, &data_ptr);
 
         for(mp_uint_t i = 0; i < data_length; i++) {
             if( mp_obj_get_int(data_ptr[i]) > 1){
@@ -314,9 +395,9 @@ STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args,
             }
         }
     }
-    else if(MP_OBJ_IS_INT(args[2].u_obj) == true) {
+    else if(MP_OBJ_IS_INT(data_in) == true) {
         /* In this case the data parameter is interpreted as a number indicating how many pulses will be sent out */
-        data_length = mp_obj_get_int(args[2].u_obj);
+        data_length = mp_obj_get_int(data_in);
         start_level_needed = true;
     }
     else
@@ -332,12 +413,12 @@ STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args,
     if(start_level_needed == true)
     {
         /* Get the start_level as the "data" is not given, or given as a single number indicating the length */
-        if(args[3].u_obj == MP_OBJ_NULL) {
+        if(start_level_in == MP_OBJ_NULL) {
             nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "\"start_level\" parameter must be given!"));
         }
-        else if(MP_OBJ_IS_INT(args[3].u_obj))
+        else if(MP_OBJ_IS_INT(start_level_in))
         {
-            start_level = mp_obj_get_int(args[3].u_obj);
+            start_level = mp_obj_get_int(start_level_in);
             if(start_level > 1) {
                 nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "\"start_level\" can be 0 or 1"));
             }
@@ -392,11 +473,51 @@ STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args,
         }
     }
 
+    *count = items_to_send_count;
+    return items_to_send;
+}
+
+STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    STATIC const mp_arg_t mach_rmt_pulses_send_args[] = {
+        { MP_QSTR_id,                     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_duration,               MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_data,                   MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_start_level,            MP_ARG_OBJ | MP_ARG_KW_ONLY,  {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_wait_tx_done,           MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_obj = mp_const_true} }
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_rmt_pulses_send_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mach_rmt_pulses_send_args), mach_rmt_pulses_send_args, args);
+
+    mach_rmt_obj_t *self = args[0].u_obj;
+
+    if(self->is_used == false){
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is not initialized!"));
+    }
+
+    if(self->config.rmt_mode != RMT_MODE_TX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "RMT channel is configured for RX!"));
+    }
+
+    bool wait_tx_done = args[4].u_bool;
+    mp_uint_t items_to_send_count = 0;
+    rmt_item32_t* items_to_send = mach_rmt_items_new(args[1].u_obj, args[2].u_obj, args[3].u_obj, &items_to_send_count);
+
+    mach_rmt_tx_end_loop(self);
+
     MP_THREAD_GIL_EXIT();
     esp_err_t retval = rmt_write_items(self->config.channel, items_to_send, items_to_send_count, wait_tx_done);
     MP_THREAD_GIL_ENTER();
 
-    m_free(items_to_send);
+    if(wait_tx_done == true) {
+        m_free(items_to_send);
+    }
+    else {
+        /* The driver keeps refilling the channel memory from the items, they must stay alive */
+        MP_STATE_PORT(mach_rmt_tx_buf)[self->config.channel] = (mp_obj_t)items_to_send;
+    }
 
     if (retval != ESP_OK) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Could not send data!"));
@@ -406,6 +527,184 @@ STATIC mp_obj_t mach_rmt_pulses_send(mp_uint_t n_args, const mp_obj_t *pos_args,
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_pulses_send_obj, 1, mach_rmt_pulses_send);
 
+STATIC void mach_rmt_seq_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    mach_rmt_seq_obj_t *self = self_in;
+    mp_printf(print, "RMTSequence(items=%u)", self->count);
+}
+
+STATIC const mp_obj_type_t mach_rmt_seq_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_RMTSequence,
+    .print = mach_rmt_seq_print,
+};
+
+/* Takes the same arguments as pulses_send() and returns them converted, ready to be sent by sequence_send() */
+STATIC mp_obj_t mach_rmt_pulses_compile(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    STATIC const mp_arg_t mach_rmt_pulses_compile_args[] = {
+        { MP_QSTR_id,                     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_duration,               MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_data,                   MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_start_level,            MP_ARG_OBJ | MP_ARG_KW_ONLY,  {.u_obj = MP_OBJ_NULL} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_rmt_pulses_compile_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mach_rmt_pulses_compile_args), mach_rmt_pulses_compile_args, args);
+
+    mach_rmt_seq_obj_t *seq = m_new_obj(mach_rmt_seq_obj_t);
+    seq->base.type = &mach_rmt_seq_type;
+    seq->items = mach_rmt_items_new(args[1].u_obj, args[2].u_obj, args[3].u_obj, &seq->count);
+
+    return seq;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_pulses_compile_obj, 1, mach_rmt_pulses_compile);
+
+/* Sends a compiled sequence "repeat" times, or keeps repeating it from the channel memory with loop=True.
+ * Sequences longer than the channel memory are streamed by the driver from the TX threshold interrupt */
+STATIC mp_obj_t mach_rmt_sequence_send(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    STATIC const mp_arg_t mach_rmt_sequence_send_args[] = {
+        { MP_QSTR_id,                     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_sequence,               MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_repeat,                 MP_ARG_INT | MP_ARG_KW_ONLY,  {.u_int = 1} },
+        { MP_QSTR_loop,                   MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
+        { MP_QSTR_wait_tx_done,           MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = true} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_rmt_sequence_send_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mach_rmt_sequence_send_args), mach_rmt_sequence_send_args, args);
+
+    mach_rmt_obj_t *self = args[0].u_obj;
+    mach_rmt_check_tx(self);
+
+    if(MP_OBJ_IS_TYPE(args[1].u_obj, &mach_rmt_seq_type) == false) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "\"sequence\" must be returned by pulses_compile()!"));
+    }
+    mach_rmt_seq_obj_t *seq = args[1].u_obj;
+    mp_int_t repeat = args[2].u_int;
+    bool wait_tx_done = args[4].u_bool;
+
+    if(repeat < 1) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "\"repeat\" must be at least 1"));
+    }
+
+    mach_rmt_tx_end_loop(self);
+    /* Let a previous transmission finish using its items before they are released */
+    MP_THREAD_GIL_EXIT();
+    rmt_wait_tx_done(self->config.channel, portMAX_DELAY);
+    MP_THREAD_GIL_ENTER();
+    MP_STATE_PORT(mach_rmt_tx_buf)[self->config.channel] = seq;
+
+    esp_err_t retval = ESP_OK;
+    if(args[3].u_bool == true) {
+        /* The hardware restarts from the beginning at the end marker, the whole sequence has to fit in the channel memory */
+        mp_uint_t mem_items = self->config.mem_block_num * RMT_MEM_ITEM_NUM;
+        if(seq->count >= mem_items) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Sequence is too long to be looped on this channel!"));
+        }
+        rmt_item32_t end_marker = { .val = 0 };
+        rmt_tx_stop(self->config.channel);
+        rmt_fill_tx_items(self->config.channel, seq->items, seq->count, 0);
+        rmt_fill_tx_items(self->config.channel, &end_marker, 1, seq->count);
+        rmt_set_tx_loop_mode(self->config.channel, true);
+        retval = rmt_tx_start(self->config.channel, true);
+        self->tx_looping = (retval == ESP_OK);
+    }
+    else {
+        MP_THREAD_GIL_EXIT();
+        for(mp_int_t i = 0; i < repeat && retval == ESP_OK; i++) {
+            /* Only the last repetition may return before it is done */
+            retval = rmt_write_items(self->config.channel, seq->items, seq->count, (i < repeat - 1) || wait_tx_done);
+        }
+        MP_THREAD_GIL_ENTER();
+    }
+
+    if (retval != ESP_OK) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Could not send data!"));
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_sequence_send_obj, 1, mach_rmt_sequence_send);
+
+/* Sends buf, 3 bytes per LED in GRB order, to a WS2812 strip. The bits are encoded while they are sent out so the
+ * length of the strip is not limited by the channel memory. buf is copied, it can be filled with the next frame right away */
+STATIC mp_obj_t mach_rmt_write_pixels(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    STATIC const mp_arg_t mach_rmt_write_pixels_args[] = {
+        { MP_QSTR_id,                     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_buf,                    MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_wait_tx_done,           MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_rmt_write_pixels_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mach_rmt_write_pixels_args), mach_rmt_write_pixels_args, args);
+
+    mach_rmt_obj_t *self = args[0].u_obj;
+    mach_rmt_check_tx(self);
+
+    if(self->config.clk_div != RMT_RESOLUTION_100NS) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "LED strips need a channel with 100ns resolution!"));
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1].u_obj, &bufinfo, MP_BUFFER_READ);
+    if(bufinfo.len == 0) {
+        return mp_const_none;
+    }
+
+    mach_rmt_tx_end_loop(self);
+
+    /* The frames may have been released if something else was sent in between */
+    if(MP_STATE_PORT(mach_rmt_tx_buf)[self->config.channel] != self->pixels || self->pixels_len != bufinfo.len) {
+        MP_THREAD_GIL_EXIT();
+        rmt_wait_tx_done(self->config.channel, portMAX_DELAY);
+        MP_THREAD_GIL_ENTER();
+        self->pixels = m_new(uint8_t, 2 * bufinfo.len);
+        self->pixels_len = bufinfo.len;
+        self->pixels_back = 0;
+        MP_STATE_PORT(mach_rmt_tx_buf)[self->config.channel] = self->pixels;
+    }
+
+    /* The other frame may still be on its way, the driver waits for it before starting this one */
+    uint8_t *frame = &self->pixels[self->pixels_back * self->pixels_len];
+    memcpy(frame, bufinfo.buf, bufinfo.len);
+    self->pixels_back ^= 1;
+
+    bool ok = led_strip_init(self->config.channel);
+    if(ok == true) {
+        MP_THREAD_GIL_EXIT();
+        ok = led_strip_write(self->config.channel, frame, bufinfo.len, args[2].u_bool);
+        MP_THREAD_GIL_ENTER();
+    }
+
+    if (ok == false) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Could not send data!"));
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_write_pixels_obj, 1, mach_rmt_write_pixels);
+
+/* Ends a looping sequence, or waits until the ongoing transmission is done */
+STATIC mp_obj_t mach_rmt_tx_stop(mp_obj_t self_in) {
+
+    mach_rmt_obj_t *self = self_in;
+    mach_rmt_check_tx(self);
+
+    mach_rmt_tx_end_loop(self);
+    MP_THREAD_GIL_EXIT();
+    rmt_wait_tx_done(self->config.channel, portMAX_DELAY);
+    MP_THREAD_GIL_ENTER();
+    MP_STATE_PORT(mach_rmt_tx_buf)[self->config.channel] = MP_OBJ_NULL;
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mach_rmt_tx_stop_obj, mach_rmt_tx_stop);
+
 
 STATIC mp_obj_t mach_rmt_pulses_get(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
 
@@ -512,17 +811,305 @@ STATIC mp_obj_t mach_rmt_pulses_get(mp_uint_t n_args, const mp_obj_t *pos_args,
         }
     }
     rmt_rx_stop(self->config.channel);
+    /* This also ends a continuous reception */
+    self->rx_running = false;
+    self->has_carry = false;
 
     return mp_obj_new_tuple(((mp_obj_list_t*)ret_items)->len, ((mp_obj_list_t*)ret_items)->items);
 
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_pulses_get_obj, 0, mach_rmt_pulses_get);
 
+/* Fills buf with packed pulses, 16 bits each: level in bit 15 and the duration in bits 0-14.
+ * Without a timeout it waits until buf is full, otherwise it returns what arrived within it */
+STATIC mp_obj_t mach_rmt_pulses_get_into(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    STATIC const mp_arg_t mach_rmt_pulses_get_into_args[] = {
+        { MP_QSTR_id,                     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_buf,                    MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_timeout,                MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_OBJ_NULL} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_rmt_pulses_get_into_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mach_rmt_pulses_get_into_args), mach_rmt_pulses_get_into_args, args);
+
+    mach_rmt_obj_t *self = args[0].u_obj;
+    mach_rmt_check_rx(self);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t room = bufinfo.len / sizeof(uint16_t);
+    uint8_t *out = bufinfo.buf;
+
+    TickType_t timeout = portMAX_DELAY;
+    if(args[2].u_obj != MP_OBJ_NULL) {
+        if(MP_OBJ_IS_SMALL_INT(args[2].u_obj) == true) {
+            timeout = mp_obj_get_int(args[2].u_obj);
+        }
+        else
+        {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "If timeout is specified it must be a valid integer number"));
+        }
+    }
+
+    RingbufHandle_t ringbuf = NULL;
+    mp_uint_t stored = 0;
+
+    if(self->has_carry == true && room > 0) {
+        memcpy(out, &self->carry, sizeof(uint16_t));
+        self->has_carry = false;
+        stored++;
+    }
+
+    rmt_get_ringbuf_handle(self->config.channel, &ringbuf);
+    if(self->rx_running == false) {
+        rmt_rx_start(self->config.channel, true);
+    }
+
+    while(stored < room) {
+        size_t received = 0;
+        MP_THREAD_GIL_EXIT();
+        rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(ringbuf, &received, timeout);
+        MP_THREAD_GIL_ENTER();
+        if(items == NULL) {
+            break;
+        }
+        stored += mach_rmt_pack(self, items, received / sizeof(rmt_item32_t), &out[stored * sizeof(uint16_t)], room - stored);
+        vRingbufferReturnItem(ringbuf, (void*)items);
+
+        /* With a timeout only take what is already there after the first block */
+        if(timeout != portMAX_DELAY) {
+            timeout = 0;
+        }
+    }
+
+    if(self->rx_running == false) {
+        rmt_rx_stop(self->config.channel);
+        /* Nothing is carried over between single receptions */
+        self->has_carry = false;
+    }
+
+    return mp_obj_new_int(stored);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_pulses_get_into_obj, 1, mach_rmt_pulses_get_into);
+
+/* Keeps receiving into a ringbuffer of the given number of pulses until rx_stop() */
+STATIC mp_obj_t mach_rmt_rx_start(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    STATIC const mp_arg_t mach_rmt_rx_start_args[] = {
+        { MP_QSTR_id,                     MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_buffer,                 MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = RMT_RX_PULSES_CONTINUOUS_DEFAULT} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(mach_rmt_rx_start_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mach_rmt_rx_start_args), mach_rmt_rx_start_args, args);
+
+    mach_rmt_obj_t *self = args[0].u_obj;
+    mach_rmt_check_rx(self);
+
+    if(args[1].u_int < RMT_RX_PULSES_DEFAULT) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Buffer must hold at least 260 pulses!"));
+    }
+
+    if(self->rx_running == true) {
+        rmt_rx_stop(self->config.channel);
+    }
+    rmt_driver_uninstall(self->config.channel);
+    esp_err_t retval = rmt_driver_install(self->config.channel, mach_rmt_rx_buffer_size(args[1].u_int), 0);
+    if(retval != ESP_OK) {
+        self->is_used = false;
+        self->rx_running = false;
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Not enough memory to initialize RMT driver!"));
+    }
+
+    self->has_carry = false;
+    rmt_rx_start(self->config.channel, true);
+    self->rx_running = true;
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mach_rmt_rx_start_obj, 1, mach_rmt_rx_start);
+
+STATIC mp_obj_t mach_rmt_rx_stop(mp_obj_t self_in) {
+
+    mach_rmt_obj_t *self = self_in;
+    mach_rmt_check_rx(self);
+
+    if(self->rx_running == true) {
+        rmt_rx_stop(self->config.channel);
+        self->rx_running = false;
+        self->has_carry = false;
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mach_rmt_rx_stop_obj, mach_rmt_rx_stop);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+
+/* The highest free channel goes to the bus, the low ones are left for RMT() */
+STATIC rmt_channel_t mach_rmt_bus_claim(gpio_num_t gpio) {
+    for(int i = RMT_CHANNEL_MAX - 1; i >= RMT_CHANNEL_2; i--) {
+        if(mach_rmt_obj[i].is_used == false) {
+            mach_rmt_obj[i].is_used = true;
+            mach_rmt_obj[i].is_bus = true;
+            mach_rmt_obj[i].config.gpio_num = gpio;
+            return i;
+        }
+    }
+    return RMT_CHANNEL_MAX;
+}
+
+STATIC void mach_rmt_bus_release(rmt_channel_t channel) {
+    if(channel < RMT_CHANNEL_MAX) {
+        rmt_driver_uninstall(channel);
+        mach_rmt_obj[channel].is_used = false;
+        mach_rmt_obj[channel].is_bus = false;
+    }
+}
+
+mach_rmt_bus_t *mach_rmt_bus_get(gpio_num_t gpio) {
+    mach_rmt_bus_t *bus = &mach_rmt_bus;
+    if(bus->gpio == gpio) {
+        return bus;
+    }
+
+    for(int i = RMT_CHANNEL_2; i < RMT_CHANNEL_MAX; i++) {
+        if(mach_rmt_obj[i].is_used == true && mach_rmt_obj[i].is_bus == false && mach_rmt_obj[i].config.gpio_num == gpio) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "The given Pin is already used by other RMT channel!"));
+        }
+    }
+
+    /* Moving to another pin, the old one goes back to a normal GPIO */
+    if(bus->gpio != GPIO_NUM_MAX) {
+        gpio_matrix_out(bus->gpio, SIG_GPIO_OUT_IDX, 0, 0);
+    }
+    mach_rmt_bus_release(bus->tx);
+    mach_rmt_bus_release(bus->rx);
+    bus->tx = RMT_CHANNEL_MAX;
+    bus->rx = RMT_CHANNEL_MAX;
+    bus->gpio = GPIO_NUM_MAX;
+
+    rmt_channel_t tx = mach_rmt_bus_claim(gpio);
+    rmt_channel_t rx = mach_rmt_bus_claim(gpio);
+    if(rx == RMT_CHANNEL_MAX) {
+        if(tx != RMT_CHANNEL_MAX) {
+            mach_rmt_obj[tx].is_used = false;
+            mach_rmt_obj[tx].is_bus = false;
+        }
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "No free RMT channels for the bus!"));
+    }
+
+    rmt_config_t config = {
+        .rmt_mode = RMT_MODE_RX,
+        .channel = rx,
+        .gpio_num = gpio,
+        .clk_div = RMT_RESOLUTION_1000NS,
+        .mem_block_num = 1,
+        .rx_config = {
+            .filter_en = true,
+            .filter_ticks_thresh = RMT_BUS_FILTER_TICKS,
+            .idle_threshold = 100,
+        },
+    };
+    esp_err_t retval = rmt_config(&config);
+    if(retval == ESP_OK) {
+        retval = rmt_driver_install(rx, mach_rmt_rx_buffer_size(RMT_BUS_RX_PULSES), 0);
+    }
+    if(retval == ESP_OK) {
+        config = (rmt_config_t) {
+            .rmt_mode = RMT_MODE_TX,
+            .channel = tx,
+            .gpio_num = gpio,
+            .clk_div = RMT_RESOLUTION_1000NS,
+            .mem_block_num = 1,
+            .tx_config = {
+                .idle_level = RMT_IDLE_LEVEL_HIGH,
+                .idle_output_en = true,
+                .carrier_en = false,
+                .carrier_level = RMT_CARRIER_LEVEL_HIGH,
+                .loop_en = false,
+            },
+        };
+        retval = rmt_config(&config);
+    }
+    if(retval == ESP_OK) {
+        retval = rmt_driver_install(tx, 0, 0);
+    }
+    if(retval != ESP_OK) {
+        mach_rmt_bus_release(tx);
+        mach_rmt_bus_release(rx);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Error during RMT driver install"));
+    }
+
+    /* rmt_config() leaves the pin either as an input or as an output, it has to be both and open drain.
+     * Setting the direction routes the output back to the GPIO, so the signals are connected afterwards */
+    gpio_set_direction(gpio, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(gpio, GPIO_PULLUP_ONLY);
+    gpio_matrix_out(gpio, RMT_SIG_OUT0_IDX + tx, 0, 0);
+    gpio_matrix_in(gpio, RMT_SIG_IN0_IDX + rx, 0);
+
+    rmt_get_ringbuf_handle(rx, &bus->ringbuf);
+    bus->tx = tx;
+    bus->rx = rx;
+    bus->gpio = gpio;
+    return bus;
+}
+
+mp_uint_t mach_rmt_bus_transfer(mach_rmt_bus_t *bus, const rmt_item32_t *items, mp_uint_t n_items,
+                                uint16_t *pulses, mp_uint_t max_pulses, uint16_t rx_idle_us) {
+    if(pulses == NULL) {
+        rmt_write_items(bus->tx, items, n_items, true);
+        return 0;
+    }
+
+    /* Drop whatever a previous transfer left behind */
+    size_t size;
+    rmt_item32_t *rx_items;
+    while((rx_items = (rmt_item32_t*)xRingbufferReceive(bus->ringbuf, &size, 0)) != NULL) {
+        vRingbufferReturnItem(bus->ringbuf, (void*)rx_items);
+    }
+
+    rmt_set_rx_idle_thresh(bus->rx, rx_idle_us);
+    rmt_rx_start(bus->rx, true);
+    rmt_write_items(bus->tx, items, n_items, true);
+    /* The reception ends rx_idle_us after the last edge, the same once more is plenty */
+    rx_items = (rmt_item32_t*)xRingbufferReceive(bus->ringbuf, &size, (rx_idle_us / 1000 + 1) * 2 / portTICK_PERIOD_MS + 1);
+    rmt_rx_stop(bus->rx);
+
+    mp_uint_t stored = 0;
+    if(rx_items != NULL) {
+        size /= sizeof(rmt_item32_t);
+        for(mp_uint_t i = 0; i < size; i++) {
+            uint16_t halves[2] = { rx_items[i].val & 0xFFFF, rx_items[i].val >> 16 };
+            for(int h = 0; h < 2; h++) {
+                /* A zero duration marks the end of the reception */
+                if((halves[h] & 0x7FFF) != 0 && stored < max_pulses) {
+                    pulses[stored++] = halves[h];
+                }
+            }
+        }
+        vRingbufferReturnItem(bus->ringbuf, (void*)rx_items);
+    }
+    return stored;
+}
+
 STATIC const mp_map_elem_t mach_rmt_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&mach_rmt_init_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&mach_rmt_deinit_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_pulses_send),         (mp_obj_t)&mach_rmt_pulses_send_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pulses_compile),      (mp_obj_t)&mach_rmt_pulses_compile_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sequence_send),       (mp_obj_t)&mach_rmt_sequence_send_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_tx_stop),             (mp_obj_t)&mach_rmt_tx_stop_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write_pixels),        (mp_obj_t)&mach_rmt_write_pixels_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_pulses_get),          (mp_obj_t)&mach_rmt_pulses_get_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pulses_get_into),     (mp_obj_t)&mach_rmt_pulses_get_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rx_start),            (mp_obj_t)&mach_rmt_rx_start_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rx_stop),             (mp_obj_t)&mach_rmt_rx_stop_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_LOW),                 MP_OBJ_NEW_SMALL_INT(RMT_CARRIER_LEVEL_LOW) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_HIGH),                MP_OBJ_NEW_SMALL_INT(RMT_CARRIER_LEVEL_HIGH) },
 };
@@ -10,7 +10,26 @@
 #ifndef MACHRMT_H_
 #define MACHRMT_H_
 
+#include "rmt.h"
+
+/* A TX and an RX channel at 1 us resolution sharing one open drain pin, for the
+ * protocols where the host and the device take turns on a single wire (1-Wire, DHT).
+ * The TX channel shapes the host's slots, the RX channel times the whole bus. */
+typedef struct {
+    rmt_channel_t tx;
+    rmt_channel_t rx;
+    gpio_num_t gpio;
+    RingbufHandle_t ringbuf;
+} mach_rmt_bus_t;
+
 extern const mp_obj_type_t mach_rmt_type;
 typedef struct _mach_rmt_obj_t mach_rmt_obj_t;
 
+/* The bus on that pin, it takes two free channels the first time and moves when the pin changes */
+extern mach_rmt_bus_t *mach_rmt_bus_get(gpio_num_t gpio);
+/* Sends the items and returns the pulses seen on the wire in the layout of pulses_get_into(),
+ * the reception ends after rx_idle_us without an edge. pulses can be NULL when nothing is read back */
+extern mp_uint_t mach_rmt_bus_transfer(mach_rmt_bus_t *bus, const rmt_item32_t *items, mp_uint_t n_items,
+                                       uint16_t *pulses, mp_uint_t max_pulses, uint16_t rx_idle_us);
+
 #endif  // MACHRMT_H_
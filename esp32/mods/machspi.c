@@ -41,6 +41,7 @@
 
 #include "py/mpstate.h"
 #include "py/runtime.h"
+#include "py/mpthread.h"
 #include "bufhelper.h"
 
 #include "esp_heap_caps.h"
@@ -54,6 +55,13 @@
 #include "esp_intr.h"
 #include "soc/dport_reg.h"
 #include "soc/gpio_sig_map.h"
+#include "soc/spi_reg.h"
+#include "rom/lldesc.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/spi_slave.h"
 
 #include "spi.h"
 #include "machspi.h"
@@ -61,16 +69,71 @@
 #include "mpsleep.h"
 #include "machpin.h"
 #include "pins.h"
+#include "mpirq.h"
+#if MICROPY_PY_FRAMEBUF
+#include "extmod/modframebuf.h"
+#endif
 
 /// \moduleref pyb
 /// \class SPI - a master-driven serial protocol
 
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MACH_SPI_FIRST_BIT_MSB                    0
+
+// transfers from this size on go through DMA instead of the 64 byte register buffer
+#define MACH_SPI_DMA_MIN_LEN                      (64)
+#define MACH_SPI_DMA_DESC_SIZE                    (4092)          // largest word aligned descriptor buffer
+#define MACH_SPI_DMA_DESC_NUM                     (2)
+#define MACH_SPI_DMA_BUF_SIZE                     (MACH_SPI_DMA_DESC_SIZE * MACH_SPI_DMA_DESC_NUM)
+#define MACH_SPI_TASK_STACK_SIZE                  (2048)
+#define MACH_SPI_TASK_PRIORITY                    (5)
+#define MACH_SPI_REG_BUF_SIZE                     (64)            // SPI_W0_REG..SPI_W15_REG
+#define MACH_SPI_CFG_REGS                         (5)
+#define MACH_SPI_SLAVE_NBYTES_MAX                 (MACH_SPI_DMA_BUF_SIZE)
+#define MACH_SPI_SLAVE_TASK_STACK_SIZE            (2048)
+#define MACH_SPI_SLAVE_TASK_PRIORITY              (6)
+#define MACH_SPI_SLAVE_POLL_MS                    (50)          // how soon the task sees a deinit
+
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
+// everything the DMA engine reads or writes, so it must come from DMA capable memory
+typedef struct {
+    lldesc_t            tx_desc[MACH_SPI_DMA_DESC_NUM];
+    lldesc_t            rx_desc[MACH_SPI_DMA_DESC_NUM];
+    uint8_t             tx_buf[MACH_SPI_DMA_BUF_SIZE];
+    uint8_t             rx_buf[MACH_SPI_DMA_BUF_SIZE];
+    // asynchronous transfer, run by the bus task
+    TaskHandle_t        task;
+    const uint8_t       *tx;
+    uint8_t             *rx;
+    uint32_t            len;
+    uint32_t            txchar;
+    volatile bool       busy;
+} mach_spi_dma_t;
+
+// slave mode: both transactions stay queued, so whenever the host selects us
+// the DMA has one ready while the task recycles the other one
+typedef struct {
+    spi_slave_transaction_t trans[2];
+    uint8_t             *tx_next;       // staged by write(), copied into every transaction queued again
+    uint8_t             *rx_last;       // swapped with the receive buffer of each completed transaction
+    uint32_t            len;
+    uint32_t            rx_len;         // bytes clocked in by the host the last time
+    SemaphoreHandle_t   lock;
+    TaskHandle_t        task;
+    volatile bool       stop;
+    volatile bool       irq_pending;
+} mach_spi_slave_t;
+
 typedef struct _mach_spi_obj_t {
     mp_obj_base_t base;
+    mp_obj_t handler;
+    mp_obj_t handler_arg;
     pin_obj_t *pins[3];
+    pin_obj_t *cs;          // slave mode only
     uint baudrate;
     uint config;
     uint spi_num;
@@ -79,12 +142,24 @@ typedef struct _mach_spi_obj_t {
     byte phase;
     byte submode;
     byte wlen;
+    mach_spi_dma_t *dma;    // allocated by the first large transfer
+    mach_spi_slave_t *slave;
+    uint32_t cfg_regs[MACH_SPI_CFG_REGS];
+    uint32_t active_cfg;    // 0 for the bus configuration, else the id of the device last used
 } mach_spi_obj_t;
 
-/******************************************************************************
- DEFINE CONSTANTS
- ******************************************************************************/
-#define MACH_SPI_FIRST_BIT_MSB                    0
+// a peripheral on the bus, with its own speed, mode and chip select
+typedef struct _mach_spi_device_obj_t {
+    mp_obj_base_t base;
+    mach_spi_obj_t *spi;
+    pin_obj_t *cs;
+    uint32_t baudrate;
+    uint32_t id;
+    uint32_t cfg_regs[MACH_SPI_CFG_REGS];
+    byte polarity;
+    byte phase;
+    byte bitorder;
+} mach_spi_device_obj_t;
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
@@ -94,11 +169,17 @@ STATIC const mp_obj_t mach_spi_def_pin[2][3] = { {&PIN_MODULE_P10, &PIN_MODULE_P
                                                  {&PIN_MODULE_P19, &PIN_MODULE_P20, &PIN_MODULE_P21} };
 static const uint32_t mach_spi_pin_af[2][3] = { {HSPICLK_OUT_IDX, HSPID_OUT_IDX, HSPIQ_IN_IDX},
                                                 {VSPICLK_OUT_IDX, VSPID_OUT_IDX, VSPIQ_IN_IDX} };
+static const uint32_t mach_spi_slave_pin_af[2][4] = { {HSPICLK_IN_IDX, HSPID_IN_IDX, HSPIQ_OUT_IDX, HSPICS0_IN_IDX},
+                                                      {VSPICLK_IN_IDX, VSPID_IN_IDX, VSPIQ_OUT_IDX, VSPICS0_IN_IDX} };
 #else
 STATIC mach_spi_obj_t mach_spi_obj[1] = { {.baudrate = 0} };
 STATIC const mp_obj_t mach_spi_def_pin[1][3] = { {&PIN_MODULE_P10, &PIN_MODULE_P11, &PIN_MODULE_P14} };
 static const uint32_t mach_spi_pin_af[1][3] = { {HSPICLK_OUT_IDX, HSPID_OUT_IDX, HSPIQ_IN_IDX} };
+static const uint32_t mach_spi_slave_pin_af[1][4] = { {HSPICLK_IN_IDX, HSPID_IN_IDX, HSPIQ_OUT_IDX, HSPICS0_IN_IDX} };
 #endif
+STATIC uint32_t mach_spi_device_id;
+
+STATIC const mp_obj_type_t mach_spi_device_type;
 
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
@@ -119,6 +200,39 @@ STATIC void machspi_init (const mach_spi_obj_t *self) {
     spi_init(self->spi_num, &spi_attr);
 }
 
+static uint8_t machspi_submode (uint8_t polarity, uint8_t phase) {
+    if (polarity == 0 && phase == 0) {
+        return SpiSubMode_0;
+    } else if (polarity == 0 && phase == 1) {
+        return SpiSubMode_1;
+    } else if (polarity == 1 && phase == 0) {
+        return SpiSubMode_2;
+    }
+    return SpiSubMode_3;
+}
+
+// the registers spi_init() sets up, so that switching between configurations is a few writes
+static void machspi_save_cfg (uint32_t spi_num, uint32_t *regs) {
+    regs[0] = READ_PERI_REG(SPI_CLOCK_REG(spi_num));
+    regs[1] = READ_PERI_REG(SPI_CTRL_REG(spi_num));
+    regs[2] = READ_PERI_REG(SPI_CTRL2_REG(spi_num));
+    regs[3] = READ_PERI_REG(SPI_PIN_REG(spi_num));
+    regs[4] = READ_PERI_REG(SPI_USER_REG(spi_num));
+}
+
+static void machspi_select (mach_spi_obj_t *self, uint32_t id, const uint32_t *regs) {
+    if (self->active_cfg != id) {
+        uint32_t spi_num = self->spi_num;
+        while (READ_PERI_REG(SPI_CMD_REG(spi_num)) & SPI_USR);
+        WRITE_PERI_REG(SPI_CLOCK_REG(spi_num), regs[0]);
+        WRITE_PERI_REG(SPI_CTRL_REG(spi_num), regs[1]);
+        WRITE_PERI_REG(SPI_CTRL2_REG(spi_num), regs[2]);
+        WRITE_PERI_REG(SPI_PIN_REG(spi_num), regs[3]);
+        WRITE_PERI_REG(SPI_USER_REG(spi_num), regs[4]);
+        self->active_cfg = id;
+    }
+}
+
 static int spi_master_send_recv_data(spi_num_e spiNum, spi_data_t* pData) {
     char idx = 0;
     if ((spiNum > SpiNum_Max)
@@ -186,10 +300,158 @@ static int spi_master_send_recv_data(spi_num_e spiNum, spi_data_t* pData) {
     return 0;
 }
 
+static void machspi_dma_link (lldesc_t *desc, uint8_t *buf, uint32_t len) {
+    lldesc_t *last = desc;
+    for ( ; len > 0; desc++) {
+        uint32_t dlen = MIN(len, MACH_SPI_DMA_DESC_SIZE);
+        desc->size = (dlen + 3) & ~3;
+        desc->length = dlen;
+        desc->offset = 0;
+        desc->sosf = 0;
+        desc->eof = 0;
+        desc->owner = 1;
+        desc->buf = buf;
+        desc->qe.stqe_next = desc + 1;
+        last = desc;
+        buf += dlen;
+        len -= dlen;
+    }
+    last->eof = 1;
+    last->qe.stqe_next = NULL;
+}
+
+// sends tx_buf while receiving into rx_buf, len bytes at most MACH_SPI_DMA_BUF_SIZE
+static void machspi_dma_run (mach_spi_obj_t *self, uint32_t len, bool yield) {
+    mach_spi_dma_t *dma = self->dma;
+    uint32_t spi_num = self->spi_num;
+
+    while (READ_PERI_REG(SPI_CMD_REG(spi_num)) & SPI_USR);
+
+    SET_PERI_REG_MASK(SPI_DMA_CONF_REG(spi_num), SPI_OUT_RST | SPI_IN_RST | SPI_AHBM_RST | SPI_AHBM_FIFO_RST);
+    CLEAR_PERI_REG_MASK(SPI_DMA_OUT_LINK_REG(spi_num), SPI_OUTLINK_START);
+    CLEAR_PERI_REG_MASK(SPI_DMA_IN_LINK_REG(spi_num), SPI_INLINK_START);
+    CLEAR_PERI_REG_MASK(SPI_DMA_CONF_REG(spi_num), SPI_OUT_RST | SPI_IN_RST | SPI_AHBM_RST | SPI_AHBM_FIFO_RST);
+    SET_PERI_REG_MASK(SPI_DMA_CONF_REG(spi_num), SPI_OUT_DATA_BURST_EN);
+
+    machspi_dma_link(dma->rx_desc, dma->rx_buf, (len + 3) & ~3);
+    machspi_dma_link(dma->tx_desc, dma->tx_buf, len);
+    SET_PERI_REG_BITS(SPI_DMA_IN_LINK_REG(spi_num), SPI_INLINK_ADDR, (uint32_t)dma->rx_desc, SPI_INLINK_ADDR_S);
+    SET_PERI_REG_MASK(SPI_DMA_IN_LINK_REG(spi_num), SPI_INLINK_START);
+    SET_PERI_REG_BITS(SPI_DMA_OUT_LINK_REG(spi_num), SPI_OUTLINK_ADDR, (uint32_t)dma->tx_desc, SPI_OUTLINK_ADDR_S);
+    SET_PERI_REG_MASK(SPI_DMA_OUT_LINK_REG(spi_num), SPI_OUTLINK_START);
+
+    // plain full duplex data phase, the data comes from DMA and not from W0..W15
+    CLEAR_PERI_REG_MASK(SPI_USER_REG(spi_num), SPI_USR_COMMAND | SPI_USR_ADDR | SPI_USR_DUMMY |
+                                               SPI_USR_MOSI_HIGHPART | SPI_USR_MISO_HIGHPART);
+    SET_PERI_REG_MASK(SPI_USER_REG(spi_num), SPI_USR_MOSI | SPI_USR_MISO);
+    SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(spi_num), SPI_USR_MOSI_DBITLEN, ((len << 3) - 1), SPI_USR_MOSI_DBITLEN_S);
+    SET_PERI_REG_BITS(SPI_MISO_DLEN_REG(spi_num), SPI_USR_MISO_DBITLEN, ((len << 3) - 1), SPI_USR_MISO_DBITLEN_S);
+    SET_PERI_REG_MASK(SPI_CMD_REG(spi_num), SPI_USR);
+
+    if (yield) {
+        // don't spin for transfers that take longer than a couple of ticks
+        uint32_t ms = ((uint64_t)len * 8 * 1000) / self->baudrate;
+        if (ms > 2 * portTICK_PERIOD_MS) {
+            vTaskDelay((ms / portTICK_PERIOD_MS) - 1);
+        }
+    }
+    while (READ_PERI_REG(SPI_CMD_REG(spi_num)) & SPI_USR);
+}
+
+static void machspi_dma_transfer (mach_spi_obj_t *self, const uint8_t *txdata, uint8_t *rxdata, uint32_t len,
+                                  uint32_t txchar, bool yield) {
+    mach_spi_dma_t *dma = self->dma;
+    for (uint32_t offset = 0; offset < len; offset += MACH_SPI_DMA_BUF_SIZE) {
+        uint32_t chunk = MIN(len - offset, MACH_SPI_DMA_BUF_SIZE);
+        if (txdata) {
+            memcpy(dma->tx_buf, &txdata[offset], chunk);
+        } else if (offset == 0) {
+            memset(dma->tx_buf, txchar, chunk);
+        }
+        machspi_dma_run(self, chunk, yield);
+        if (rxdata) {
+            memcpy(&rxdata[offset], dma->rx_buf, chunk);
+        }
+    }
+}
+
+#if MICROPY_PY_FRAMEBUF
+// packs lines that are stride bytes apart back to back into the DMA buffer, so
+// a partial framebuffer update goes out as one stream instead of one per line
+static void machspi_dma_gather (mach_spi_obj_t *self, const uint8_t *src, uint32_t line_len, uint32_t stride,
+                                uint32_t lines) {
+    mach_spi_dma_t *dma = self->dma;
+    uint32_t fill = 0;
+    uint32_t col = 0;
+    while (lines) {
+        uint32_t n = MIN(line_len - col, MACH_SPI_DMA_BUF_SIZE - fill);
+        memcpy(&dma->tx_buf[fill], &src[col], n);
+        fill += n;
+        col += n;
+        if (col == line_len) {
+            col = 0;
+            src += stride;
+            lines--;
+        }
+        if (fill == MACH_SPI_DMA_BUF_SIZE || !lines) {
+            machspi_dma_run(self, fill, false);
+            fill = 0;
+        }
+    }
+}
+#endif
+
+static void TASK_SPI (void *pvParameters) {
+    mach_spi_obj_t *self = pvParameters;
+    mach_spi_dma_t *dma = self->dma;
+    for ( ; ; ) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        machspi_dma_transfer(self, dma->tx, dma->rx, dma->len, dma->txchar, true);
+        dma->busy = false;
+    }
+}
+
+static void machspi_dma_enable (mach_spi_obj_t *self) {
+    DPORT_SET_PERI_REG_MASK(DPORT_PERIP_CLK_EN_REG, DPORT_SPI_DMA_CLK_EN);
+    DPORT_CLEAR_PERI_REG_MASK(DPORT_PERIP_RST_EN_REG, DPORT_SPI_DMA_RST);
+    // DMA channel 1 serves SPI2 and channel 2 SPI3
+    DPORT_SET_PERI_REG_BITS(DPORT_SPI_DMA_CHAN_SEL_REG, 3, self->spi_num - 1, (self->spi_num - 1) * 2);
+}
+
+static bool machspi_dma_init (mach_spi_obj_t *self) {
+    if (!self->dma) {
+        self->dma = heap_caps_malloc(sizeof(mach_spi_dma_t), MALLOC_CAP_DMA);
+        if (!self->dma) {
+            return false;
+        }
+        memset(self->dma, 0, sizeof(mach_spi_dma_t));
+        machspi_dma_enable(self);
+    }
+    return true;
+}
+
+static void machspi_dma_wait (mach_spi_obj_t *self) {
+    if (self->dma) {
+        MP_THREAD_GIL_EXIT();
+        while (self->dma->busy) {
+            vTaskDelay(1);
+        }
+        MP_THREAD_GIL_ENTER();
+        MP_STATE_PORT(mach_spi_async_buf)[self->spi_num - 2] = MP_OBJ_NULL;
+    }
+}
+
 STATIC void pybspi_transfer (mach_spi_obj_t *self, const char *txdata, char *rxdata, uint32_t len, uint32_t *txchar) {
     if (!self->baudrate) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
     }
+    machspi_dma_wait(self);
+    machspi_select(self, 0, self->cfg_regs);
+    // wider words keep the register path, which takes care of their byte order
+    if (len >= MACH_SPI_DMA_MIN_LEN && self->wlen == 1 && machspi_dma_init(self)) {
+        machspi_dma_transfer(self, (const uint8_t *)txdata, (uint8_t *)rxdata, len, txchar ? *txchar : 0x55555555, false);
+        return;
+    }
     // send and receive the data
     for (int i = 0; i < len; i += self->wlen) {
         uint32_t _rxdata = 0;
@@ -214,6 +476,99 @@ STATIC void pybspi_transfer (mach_spi_obj_t *self, const char *txdata, char *rxd
     }
 }
 
+// the buffer object is kept referenced until the transfer is over
+STATIC void pybspi_transfer_async (mach_spi_obj_t *self, mp_obj_t buf, const uint8_t *txdata, uint8_t *rxdata,
+                                   uint32_t len, uint32_t txchar) {
+    if (!self->baudrate) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    if (self->wlen != 1) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "asynchronous transfers need bits=8"));
+    }
+    machspi_dma_wait(self);
+    machspi_select(self, 0, self->cfg_regs);
+    if (!machspi_dma_init(self)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "no DMA capable memory left"));
+    }
+    mach_spi_dma_t *dma = self->dma;
+    if (!dma->task) {
+        if (pdPASS != xTaskCreatePinnedToCore(TASK_SPI, "SPI", MACH_SPI_TASK_STACK_SIZE / sizeof(StackType_t), self,
+                                              MACH_SPI_TASK_PRIORITY, &dma->task, 1)) {
+            dma->task = NULL;
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "cannot start the SPI task"));
+        }
+    }
+    MP_STATE_PORT(mach_spi_async_buf)[self->spi_num - 2] = buf;
+    dma->tx = txdata;
+    dma->rx = rxdata;
+    dma->len = len;
+    dma->txchar = txchar;
+    dma->busy = true;
+    xTaskNotifyGive(dma->task);
+}
+
+// 8 bit words only, moving the whole register buffer per transaction below the DMA threshold
+STATIC void machspi_device_transfer (mach_spi_obj_t *spi, const uint8_t *txdata, uint8_t *rxdata, uint32_t len,
+                                     uint8_t txchar) {
+    if (len >= MACH_SPI_DMA_MIN_LEN && machspi_dma_init(spi)) {
+        machspi_dma_transfer(spi, txdata, rxdata, len, txchar, false);
+        return;
+    }
+    uint32_t words[MACH_SPI_REG_BUF_SIZE / 4];
+    for (uint32_t offset = 0; offset < len; offset += MACH_SPI_REG_BUF_SIZE) {
+        uint32_t chunk = MIN(len - offset, MACH_SPI_REG_BUF_SIZE);
+        if (txdata) {
+            memcpy(words, &txdata[offset], chunk);
+        } else {
+            memset(words, txchar, chunk);
+        }
+        spi_data_t spidata = {.cmd = 0, .cmdLen = 0, .addr = NULL, .addrLen = 0,
+                              .txData = words, .txDataLen = chunk,
+                              .rxData = words, .rxDataLen = chunk};
+        spi_master_send_recv_data(spi->spi_num, &spidata);
+        if (rxdata) {
+            memcpy(&rxdata[offset], words, chunk);
+        }
+    }
+}
+
+// switches the bus over to the device and asserts its chip select
+STATIC void machspi_device_begin (mach_spi_device_obj_t *self) {
+    mach_spi_obj_t *spi = self->spi;
+    if (!spi->baudrate) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    machspi_dma_wait(spi);
+    machspi_select(spi, self->id, self->cfg_regs);
+    self->cs->value = 0;
+    pin_set_value(self->cs);
+}
+
+STATIC void machspi_device_end (mach_spi_device_obj_t *self) {
+    self->cs->value = 1;
+    pin_set_value(self->cs);
+}
+
+// either buffer can be None, not both of them
+STATIC uint32_t machspi_device_run_op (mach_spi_device_obj_t *self, mp_obj_t write, mp_obj_t read) {
+    mp_buffer_info_t bufinfo_write = {.buf = NULL, .len = 0};
+    mp_buffer_info_t bufinfo_read = {.buf = NULL, .len = 0};
+    if (write != mp_const_none) {
+        mp_get_buffer_raise(write, &bufinfo_write, MP_BUFFER_READ);
+    }
+    if (read != mp_const_none) {
+        mp_get_buffer_raise(read, &bufinfo_read, MP_BUFFER_WRITE);
+        if (write != mp_const_none && bufinfo_read.len != bufinfo_write.len) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+    } else if (write == mp_const_none) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    uint32_t len = MAX(bufinfo_write.len, bufinfo_read.len);
+    machspi_device_transfer(self->spi, bufinfo_write.buf, bufinfo_read.buf, len, 0x00);
+    return len;
+}
+
 static void spi_assign_pins_af (mach_spi_obj_t *self, mp_obj_t *pins) {
     uint32_t spi_idx = self->spi_num - 2;
     for (int i = 0; i < 3; i++) {
@@ -235,6 +590,25 @@ static void spi_assign_pins_af (mach_spi_obj_t *self, mp_obj_t *pins) {
     }
 }
 
+// CLK, MOSI and CS come from the host, MISO goes to it
+static void spi_assign_slave_pins_af (mach_spi_obj_t *self, mp_obj_t *pins) {
+    uint32_t spi_idx = self->spi_num - 2;
+    for (int i = 0; i < 4; i++) {
+        pin_obj_t *pin = pin_find(pins[i]);
+        if (i == PIN_TYPE_SPI_MISO) {
+            pin_config(pin, -1, mach_spi_slave_pin_af[spi_idx][i], GPIO_MODE_OUTPUT, MACHPIN_PULL_NONE, 0);
+        } else {
+            pin_config(pin, mach_spi_slave_pin_af[spi_idx][i], -1, GPIO_MODE_INPUT,
+                       (i == 3) ? MACHPIN_PULL_UP : MACHPIN_PULL_NONE, 0);
+        }
+        if (i < 3) {
+            self->pins[i] = pin;
+        } else {
+            self->cs = pin;
+        }
+    }
+}
+
 static void spi_deassign_pins_af (mach_spi_obj_t *self) {
     for (int i = 0; i < 3; i++) {
         if (self->pins[i]) {
@@ -244,6 +618,157 @@ static void spi_deassign_pins_af (mach_spi_obj_t *self) {
             self->pins[i] = MP_OBJ_NULL;
         }
     }
+    if (self->cs) {
+        // deselected
+        self->cs->value = 1;
+        pin_deassign(self->cs);
+        self->cs = MP_OBJ_NULL;
+    }
+}
+
+/******************************************************************************
+ SLAVE MODE
+ ******************************************************************************/
+// the DMA channel and the host of the IDF driver match the numbering of the master code
+static spi_host_device_t machspi_slave_host (const mach_spi_obj_t *self) {
+    return (self->spi_num == SpiNum_SPI2) ? HSPI_HOST : VSPI_HOST;
+}
+
+STATIC void machspi_slave_callback_handler (void *arg) {
+    mach_spi_obj_t *self = arg;
+    self->slave->irq_pending = false;
+    if (self->handler && self->handler != mp_const_none) {
+        mp_call_function_1(self->handler, self->handler_arg);
+    }
+}
+
+static void machspi_slave_queue (mach_spi_obj_t *self, spi_slave_transaction_t *trans) {
+    mach_spi_slave_t *slave = self->slave;
+    xSemaphoreTake(slave->lock, portMAX_DELAY);
+    memcpy((void *)trans->tx_buffer, slave->tx_next, slave->len);
+    xSemaphoreGive(slave->lock);
+    trans->length = slave->len * 8;
+    spi_slave_queue_trans(machspi_slave_host(self), trans, portMAX_DELAY);
+}
+
+static void TASK_SPI_SLAVE (void *pvParameters) {
+    mach_spi_obj_t *self = pvParameters;
+    mach_spi_slave_t *slave = self->slave;
+    spi_slave_transaction_t *trans;
+
+    while (!slave->stop) {
+        if (ESP_OK != spi_slave_get_trans_result(machspi_slave_host(self), &trans, MACH_SPI_SLAVE_POLL_MS / portTICK_PERIOD_MS)) {
+            continue;
+        }
+        // the received data is kept by swapping buffers, not by copying it
+        xSemaphoreTake(slave->lock, portMAX_DELAY);
+        uint8_t *rx = trans->rx_buffer;
+        trans->rx_buffer = slave->rx_last;
+        slave->rx_last = rx;
+        slave->rx_len = MIN(trans->trans_len / 8, slave->len);
+        xSemaphoreGive(slave->lock);
+
+        machspi_slave_queue(self, trans);
+        if (self->handler && !slave->irq_pending) {
+            slave->irq_pending = true;
+            mp_irq_queue_interrupt_non_ISR(machspi_slave_callback_handler, (void *)self);
+        }
+    }
+    slave->task = NULL;
+    vTaskDelete(NULL);
+}
+
+static void machspi_slave_deinit (mach_spi_obj_t *self) {
+    mach_spi_slave_t *slave = self->slave;
+    if (slave) {
+        if (slave->task) {
+            slave->stop = true;
+            MP_THREAD_GIL_EXIT();
+            while (slave->task) {
+                vTaskDelay(1);
+            }
+            MP_THREAD_GIL_ENTER();
+        }
+        spi_slave_free(machspi_slave_host(self));
+        vSemaphoreDelete(slave->lock);
+        heap_caps_free(slave);
+        self->slave = NULL;
+        // releasing its channel may have stopped the DMA clock the master code relies on
+        if (self->dma) {
+            machspi_dma_enable(self);
+        }
+    }
+}
+
+static void machspi_slave_init (mach_spi_obj_t *self, uint32_t nbytes) {
+    // 4 byte words for the DMA, 6 buffers: the 2 transactions, the last received and the staged one
+    uint32_t len = (nbytes + 3) & ~3;
+    mach_spi_slave_t *slave = heap_caps_malloc(sizeof(mach_spi_slave_t) + (6 * len), MALLOC_CAP_DMA);
+    if (!slave) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "no DMA capable memory left"));
+    }
+    memset(slave, 0, sizeof(mach_spi_slave_t) + (6 * len));
+    uint8_t *bufs = (uint8_t *)(slave + 1);
+    for (int i = 0; i < 2; i++) {
+        slave->trans[i].tx_buffer = &bufs[(2 * i) * len];
+        slave->trans[i].rx_buffer = &bufs[(2 * i + 1) * len];
+    }
+    slave->rx_last = &bufs[4 * len];
+    slave->tx_next = &bufs[5 * len];
+    slave->len = len;
+    slave->lock = xSemaphoreCreateMutex();
+
+    // the pins are routed by spi_assign_slave_pins_af()
+    spi_bus_config_t bus_config = {
+        .mosi_io_num = -1,
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = len,
+    };
+    spi_slave_interface_config_t slave_config = {
+        .spics_io_num = -1,
+        .flags = (self->bitorder == SpiBitOrder_LSBFirst) ? (SPI_SLAVE_TXBIT_LSBFIRST | SPI_SLAVE_RXBIT_LSBFIRST) : 0,
+        .queue_size = 2,
+        .mode = (self->polarity << 1) | self->phase,
+    };
+    if (!slave->lock || ESP_OK != spi_slave_initialize(machspi_slave_host(self), &bus_config, &slave_config, self->spi_num - 1)) {
+        if (slave->lock) {
+            vSemaphoreDelete(slave->lock);
+        }
+        heap_caps_free(slave);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    self->slave = slave;
+    machspi_slave_queue(self, &slave->trans[0]);
+    machspi_slave_queue(self, &slave->trans[1]);
+    if (pdPASS != xTaskCreatePinnedToCore(TASK_SPI_SLAVE, "SPIS", MACH_SPI_SLAVE_TASK_STACK_SIZE / sizeof(StackType_t), self,
+                                          MACH_SPI_SLAVE_TASK_PRIORITY, &slave->task, 1)) {
+        slave->task = NULL;
+        machspi_slave_deinit(self);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "cannot start the SPI task"));
+    }
+}
+
+// what the host reads from the next transactions, the rest of them is 0
+static void machspi_slave_write (mach_spi_obj_t *self, const uint8_t *data, uint32_t len) {
+    mach_spi_slave_t *slave = self->slave;
+    len = MIN(len, slave->len);
+    xSemaphoreTake(slave->lock, portMAX_DELAY);
+    memcpy(slave->tx_next, data, len);
+    memset(&slave->tx_next[len], 0, slave->len - len);
+    xSemaphoreGive(slave->lock);
+}
+
+// what the host sent in the last transaction, returns its length
+static uint32_t machspi_slave_readinto (mach_spi_obj_t *self, uint8_t *data, uint32_t len) {
+    mach_spi_slave_t *slave = self->slave;
+    xSemaphoreTake(slave->lock, portMAX_DELAY);
+    len = MIN(len, slave->rx_len);
+    memcpy(data, slave->rx_last, len);
+    xSemaphoreGive(slave->lock);
+    return len;
 }
 
 /******************************************************************************/
@@ -254,14 +779,28 @@ STATIC void pyb_spi_print(const mp_print_t *print, mp_obj_t self_in, mp_print_ki
     if (self->baudrate > 0) {
         mp_printf(print, "SPI(%d, SPI.MASTER, baudrate=%u, bits=%u, polarity=%u, phase=%u, firstbit=SPI.MSB)",
                   self->spi_num - 2, self->baudrate, (self->wlen * 8), self->polarity, self->phase);
+    } else if (self->slave) {
+        mp_printf(print, "SPI(%d, SPI.SLAVE, polarity=%u, phase=%u, nbytes=%u)",
+                  self->spi_num - 2, self->polarity, self->phase, self->slave->len);
     } else {
         mp_print_str(print, "SPI(0)");
     }
 }
 
 STATIC mp_obj_t pyb_spi_init_helper(mach_spi_obj_t *self, const mp_arg_val_t *args) {
-    // verify that the mode is master
-    if (args[0].u_int != SpiMode_Master) {
+    // don't reconfigure the bus under an ongoing transfer
+    machspi_dma_wait(self);
+
+    machspi_slave_deinit(self);
+
+    // a slave moves bytes through DMA only
+    bool slave = args[0].u_int == SpiMode_Slave;
+    if (slave) {
+        if (args[2].u_int != 8 || args[7].u_int <= 0 || args[7].u_int > MACH_SPI_SLAVE_NBYTES_MAX ||
+            args[6].u_obj == MP_OBJ_NULL || args[6].u_obj == mp_const_none) {
+            goto invalid_args;
+        }
+    } else if (args[0].u_int != SpiMode_Master) {
         goto invalid_args;
     }
 
@@ -290,14 +829,17 @@ STATIC mp_obj_t pyb_spi_init_helper(mach_spi_obj_t *self, const mp_arg_val_t *ar
     }
 
     // set the correct submode
-    if (self->polarity == 0 && self->phase == 0) {
-        self->submode = SpiSubMode_0;
-    } else if (self->polarity == 0 && self->phase == 1) {
-        self->submode = SpiSubMode_1;
-    } else if (self->polarity == 1 && self->phase == 0) {
-        self->submode = SpiSubMode_2;
-    } else {
-        self->submode = SpiSubMode_3;
+    self->submode = machspi_submode(self->polarity, self->phase);
+
+    if (slave) {
+        // the clock comes from the host
+        self->baudrate = 0;
+        spi_deassign_pins_af(self);
+        mp_obj_t *pins;
+        mp_obj_get_array_fixed_n(args[6].u_obj, 4, &pins);
+        machspi_slave_init(self, args[7].u_int);
+        spi_assign_slave_pins_af(self, pins);
+        return mp_const_none;
     }
 
     self->baudrate = args[1].u_int;
@@ -321,6 +863,8 @@ STATIC mp_obj_t pyb_spi_init_helper(mach_spi_obj_t *self, const mp_arg_val_t *ar
 
     // init the bus
     machspi_init((const mach_spi_obj_t *)self);
+    machspi_save_cfg(self->spi_num, self->cfg_regs);
+    self->active_cfg = 0;
 
     return mp_const_none;
 
@@ -337,6 +881,7 @@ static const mp_arg_t pyb_spi_init_args[] = {
     { MP_QSTR_phase,        MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 0} },
     { MP_QSTR_firstbit,     MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = SpiBitOrder_MSBFirst} },
     { MP_QSTR_pins,         MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_nbytes,       MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 64} },       // slave mode
 };
 STATIC mp_obj_t pyb_spi_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
     // parse args
@@ -377,14 +922,27 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_spi_init_obj, 1, pyb_spi_init);
 /// Turn off the spi bus.
 STATIC mp_obj_t pyb_spi_deinit(mp_obj_t self_in) {
     mach_spi_obj_t *self = self_in;
+    machspi_dma_wait(self);
     if (self->baudrate > 0) {
         self->baudrate = 0;
         spi_deassign_pins_af(self);
+    } else if (self->slave) {
+        machspi_slave_deinit(self);
+        spi_deassign_pins_af(self);
     }
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_spi_deinit_obj, pyb_spi_deinit);
 
+void mach_spi_deinit0 (void) {
+    for (int i = 0; i < MP_ARRAY_SIZE(mach_spi_obj); i++) {
+        if (mach_spi_obj[i].slave) {
+            pyb_spi_deinit(&mach_spi_obj[i]);
+        }
+        INTERRUPT_OBJ_CLEAN(&mach_spi_obj[i]);
+    }
+}
+
 STATIC mp_obj_t pyb_spi_write (mp_obj_t self_in, mp_obj_t buf) {
     // parse args
     mach_spi_obj_t *self = self_in;
@@ -394,6 +952,12 @@ STATIC mp_obj_t pyb_spi_write (mp_obj_t self_in, mp_obj_t buf) {
     uint8_t data[1];
     pyb_buf_get_for_send(buf, &bufinfo, data);
 
+    if (self->slave) {
+        // staged for the host
+        machspi_slave_write(self, bufinfo.buf, bufinfo.len);
+        return mp_obj_new_int(MIN(bufinfo.len, self->slave->len));
+    }
+
     // just send
     pybspi_transfer(self, (const char *)bufinfo.buf, NULL, bufinfo.len, NULL);
 
@@ -441,6 +1005,11 @@ STATIC mp_obj_t pyb_spi_readinto(mp_uint_t n_args, const mp_obj_t *pos_args, mp_
     vstr_t vstr;
     pyb_buf_get_for_recv(args[0].u_obj, &vstr);
 
+    if (self->slave) {
+        // the last transaction of the host
+        return mp_obj_new_int(machspi_slave_readinto(self, (uint8_t *)vstr.buf, vstr.len));
+    }
+
     // just receive
     uint32_t write = args[1].u_int;
     pybspi_transfer(self, NULL, vstr.buf, vstr.len, &write);
@@ -479,6 +1048,125 @@ STATIC mp_obj_t pyb_spi_write_readinto (mp_obj_t self, mp_obj_t writebuf, mp_obj
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(pyb_spi_write_readinto_obj, pyb_spi_write_readinto);
 
+#if MICROPY_PY_FRAMEBUF
+/// \method write_dirty(fb)
+/// Sends the bytes behind fb.dirty() and clears it, returns the number of bytes written.
+STATIC mp_obj_t pyb_spi_write_dirty (mp_obj_t self_in, mp_obj_t fb) {
+    mach_spi_obj_t *self = self_in;
+    mp_framebuf_region_t region;
+    if (!mp_framebuf_get_dirty(fb, &region)) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    uint32_t len = region.line_len * region.lines;
+    if (region.line_len == region.line_stride) {
+        // full width lines are contiguous already
+        pybspi_transfer(self, (const char *)region.buf, NULL, len, NULL);
+    } else if (self->baudrate && self->wlen == 1 && len >= MACH_SPI_DMA_MIN_LEN && machspi_dma_init(self)) {
+        machspi_dma_wait(self);
+        machspi_select(self, 0, self->cfg_regs);
+        machspi_dma_gather(self, region.buf, region.line_len, region.line_stride, region.lines);
+    } else {
+        for (const uint8_t *line = region.buf; region.lines--; line += region.line_stride) {
+            pybspi_transfer(self, (const char *)line, NULL, region.line_len, NULL);
+        }
+    }
+    mp_framebuf_clear_dirty(fb);
+    return mp_obj_new_int(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_spi_write_dirty_obj, pyb_spi_write_dirty);
+#endif
+
+/// \method write_async(buf)
+/// Starts sending buf through DMA and returns right away, done() tells when it's over.
+STATIC mp_obj_t pyb_spi_write_async (mp_obj_t self_in, mp_obj_t buf) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf, &bufinfo, MP_BUFFER_READ);
+    pybspi_transfer_async(self_in, buf, bufinfo.buf, NULL, bufinfo.len, 0);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(pyb_spi_write_async_obj, pyb_spi_write_async);
+
+/// \method readinto_async(buf, *, write=0x00)
+/// Starts receiving into buf through DMA and returns right away, done() tells when it's over.
+STATIC mp_obj_t pyb_spi_readinto_async(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,       MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_write,     MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 0x00} },
+    };
+
+    // parse args
+    mach_spi_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    pybspi_transfer_async(self, args[0].u_obj, NULL, bufinfo.buf, bufinfo.len, args[1].u_int);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_spi_readinto_async_obj, 1, pyb_spi_readinto_async);
+
+/// \method done()
+/// Returns False while an asynchronous transfer is still running.
+STATIC mp_obj_t pyb_spi_done (mp_obj_t self_in) {
+    mach_spi_obj_t *self = self_in;
+    if (self->dma && self->dma->busy) {
+        return mp_const_false;
+    }
+    MP_STATE_PORT(mach_spi_async_buf)[self->spi_num - 2] = MP_OBJ_NULL;
+    return mp_const_true;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pyb_spi_done_obj, pyb_spi_done);
+
+/// \method device(cs, *, baudrate=1000000, polarity=0, phase=0, firstbit=SPI.MSB)
+/// Returns a peripheral on this bus with its own configuration and chip select pin.
+STATIC mp_obj_t pyb_spi_device(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_cs,           MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_baudrate,     MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 1000000} },    // 1MHz
+        { MP_QSTR_polarity,     MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 0} },
+        { MP_QSTR_phase,        MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 0} },
+        { MP_QSTR_firstbit,     MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = SpiBitOrder_MSBFirst} },
+    };
+
+    // parse args
+    mach_spi_obj_t *spi = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (!spi->baudrate) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    if (args[1].u_int == 0 || args[2].u_int > 1 || args[3].u_int > 1 ||
+        (args[4].u_int != SpiBitOrder_MSBFirst && args[4].u_int != SpiBitOrder_LSBFirst)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    mach_spi_device_obj_t *self = m_new_obj(mach_spi_device_obj_t);
+    self->base.type = &mach_spi_device_type;
+    self->spi = spi;
+    self->cs = pin_find(args[0].u_obj);
+    self->baudrate = args[1].u_int;
+    self->polarity = args[2].u_int;
+    self->phase = args[3].u_int;
+    self->bitorder = args[4].u_int;
+    self->id = ++mach_spi_device_id;
+
+    // the chip select idles high
+    pin_config(self->cs, -1, -1, GPIO_MODE_OUTPUT, MACHPIN_PULL_NONE, 1);
+
+    // let spi_init() work out the register values once and keep them
+    machspi_dma_wait(spi);
+    spi_attr_t spi_attr = {.mode = SpiMode_Master, .subMode = machspi_submode(self->polarity, self->phase),
+                           .speed = 80000000 / self->baudrate, .bitOrder = self->bitorder, .halfMode = SpiWorkMode_Full};
+    spi_init(spi->spi_num, &spi_attr);
+    machspi_save_cfg(spi->spi_num, self->cfg_regs);
+    spi->active_cfg = self->id;
+
+    return self;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pyb_spi_device_obj, 1, pyb_spi_device);
+
 STATIC const mp_map_elem_t pyb_spi_locals_dict_table[] = {
     // instance methods
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&pyb_spi_init_obj },
@@ -487,9 +1175,17 @@ STATIC const mp_map_elem_t pyb_spi_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_read),                (mp_obj_t)&pyb_spi_read_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_readinto),            (mp_obj_t)&pyb_spi_readinto_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_write_readinto),      (mp_obj_t)&pyb_spi_write_readinto_obj },
+#if MICROPY_PY_FRAMEBUF
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write_dirty),         (mp_obj_t)&pyb_spi_write_dirty_obj },
+#endif
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write_async),         (mp_obj_t)&pyb_spi_write_async_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto_async),      (mp_obj_t)&pyb_spi_readinto_async_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_done),                (mp_obj_t)&pyb_spi_done_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_device),              (mp_obj_t)&pyb_spi_device_obj },
 
     // class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_MASTER),              MP_OBJ_NEW_SMALL_INT(SpiMode_Master) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SLAVE),               MP_OBJ_NEW_SMALL_INT(SpiMode_Slave) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_MSB),                 MP_OBJ_NEW_SMALL_INT(SpiBitOrder_MSBFirst) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_LSB),                 MP_OBJ_NEW_SMALL_INT(SpiBitOrder_LSBFirst) },
 };
@@ -503,3 +1199,111 @@ const mp_obj_type_t mach_spi_type = {
     .make_new = pyb_spi_make_new,
     .locals_dict = (mp_obj_t)&pyb_spi_locals_dict,
 };
+
+/******************************************************************************/
+// SPI devices
+
+STATIC void mach_spi_device_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    mach_spi_device_obj_t *self = self_in;
+    mp_printf(print, "SPIDevice(%u, cs=%q, baudrate=%u, polarity=%u, phase=%u)",
+              self->spi->spi_num - 2, self->cs->name, self->baudrate, self->polarity, self->phase);
+}
+
+STATIC mp_obj_t mach_spi_device_write (mp_obj_t self_in, mp_obj_t buf) {
+    mach_spi_device_obj_t *self = self_in;
+    mp_buffer_info_t bufinfo;
+    uint8_t data[1];
+    pyb_buf_get_for_send(buf, &bufinfo, data);
+
+    machspi_device_begin(self);
+    machspi_device_transfer(self->spi, bufinfo.buf, NULL, bufinfo.len, 0x00);
+    machspi_device_end(self);
+    return mp_obj_new_int(bufinfo.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_spi_device_write_obj, mach_spi_device_write);
+
+STATIC mp_obj_t mach_spi_device_readinto(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,       MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_write,     MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 0x00} },
+    };
+
+    // parse args
+    mach_spi_device_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_WRITE);
+
+    machspi_device_begin(self);
+    machspi_device_transfer(self->spi, NULL, bufinfo.buf, bufinfo.len, args[1].u_int);
+    machspi_device_end(self);
+    return mp_obj_new_int(bufinfo.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_spi_device_readinto_obj, 1, mach_spi_device_readinto);
+
+STATIC mp_obj_t mach_spi_device_write_readinto (mp_obj_t self_in, mp_obj_t writebuf, mp_obj_t readbuf) {
+    mach_spi_device_obj_t *self = self_in;
+    nlr_buf_t nlr;
+    uint32_t len = 0;
+
+    machspi_device_begin(self);
+    if (nlr_push(&nlr) == 0) {
+        len = machspi_device_run_op(self, writebuf, readbuf);
+        nlr_pop();
+    } else {
+        machspi_device_end(self);
+        nlr_jump(nlr.ret_val);
+    }
+    machspi_device_end(self);
+    return mp_obj_new_int(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mach_spi_device_write_readinto_obj, mach_spi_device_write_readinto);
+
+/// \method transaction(ops)
+/// Runs a list of operations back to back with the chip select asserted throughout. Every
+/// operation is either a buffer to write, or a (write, read) tuple where write may be None.
+STATIC mp_obj_t mach_spi_device_transaction (mp_obj_t self_in, mp_obj_t ops_in) {
+    mach_spi_device_obj_t *self = self_in;
+    mp_uint_t n_ops;
+    mp_obj_t *ops;
+    mp_obj_get_array(ops_in, &n_ops, &ops);
+    nlr_buf_t nlr;
+
+    machspi_device_begin(self);
+    if (nlr_push(&nlr) == 0) {
+        for (mp_uint_t i = 0; i < n_ops; i++) {
+            if (MP_OBJ_IS_TYPE(ops[i], &mp_type_tuple)) {
+                mp_obj_t *items;
+                mp_obj_get_array_fixed_n(ops[i], 2, &items);
+                machspi_device_run_op(self, items[0], items[1]);
+            } else {
+                machspi_device_run_op(self, ops[i], mp_const_none);
+            }
+        }
+        nlr_pop();
+    } else {
+        machspi_device_end(self);
+        nlr_jump(nlr.ret_val);
+    }
+    machspi_device_end(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_spi_device_transaction_obj, mach_spi_device_transaction);
+
+STATIC const mp_map_elem_t mach_spi_device_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write),               (mp_obj_t)&mach_spi_device_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto),            (mp_obj_t)&mach_spi_device_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write_readinto),      (mp_obj_t)&mach_spi_device_write_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_transaction),         (mp_obj_t)&mach_spi_device_transaction_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mach_spi_device_locals_dict, mach_spi_device_locals_dict_table);
+
+STATIC const mp_obj_type_t mach_spi_device_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_SPIDevice,
+    .print = mach_spi_device_print,
+    .locals_dict = (mp_obj_t)&mach_spi_device_locals_dict,
+};
@@ -39,4 +39,6 @@
 
 extern const mp_obj_type_t mach_spi_type;
 
+extern void mach_spi_deinit0 (void);
+
 #endif  // MACHSPI_H_
@@ -17,6 +17,7 @@
 #include "machtimer.h"
 #include "machtimer_alarm.h"
 #include "machtimer_chrono.h"
+#include "machtimer_capture.h"
 
 static uint64_t us_timer_calibration;
 
@@ -51,7 +52,7 @@ void machtimer_preinit(void) {
 }
 
 void machtimer_init0(void) {
-    mach_timer_alarm_init_heap();
+    mach_timer_alarm_init_heap(MACH_TIMER_ALARMS_MAX);
     timer_enable_intr(TIMER_GROUP_0, TIMER_0);
 }
 
@@ -98,11 +99,21 @@ STATIC IRAM_ATTR mp_obj_t sleep_us(mp_obj_t delay) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(sleep_us_fun_obj, sleep_us);
 STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(sleep_us_obj, &sleep_us_fun_obj);
 
+// count of the main timer, in 1 / CLK_FREQ
+STATIC mp_obj_t ticks(void) {
+    return mp_obj_new_int_from_ull(machtimer_get_timer_counter_value());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ticks_fun_obj, ticks);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(ticks_obj, &ticks_fun_obj);
+
 STATIC const mp_map_elem_t mach_timer_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__),            MP_OBJ_NEW_QSTR(MP_QSTR_timer)},
     { MP_OBJ_NEW_QSTR(MP_QSTR_Alarm),               (mp_obj_t)&mach_timer_alarm_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Chrono),              (mp_obj_t)&mach_timer_chrono_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Capture),             (mp_obj_t)&mach_timer_capture_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sleep_us),            (mp_obj_t)&sleep_us_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ticks),               (mp_obj_t)&ticks_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_CLOCK_FREQ),          MP_OBJ_NEW_SMALL_INT(CLK_FREQ) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mach_timer_globals, mach_timer_globals_table);
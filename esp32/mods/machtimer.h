@@ -12,6 +12,11 @@
 
 #define CLK_FREQ                                    (APB_CLK_FREQ / 2)
 
+// alarms that can be active at the same time
+#ifndef MACH_TIMER_ALARMS_MAX
+#define MACH_TIMER_ALARMS_MAX                       (16)
+#endif
+
 extern const mp_obj_type_t mach_timer_type;
 
 
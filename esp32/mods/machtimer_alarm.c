@@ -16,11 +16,6 @@
 #include "machtimer.h"
 #include "machtimer_alarm.h"
 
-/******************************************************************************
- DEFINE PRIVATE CONSTANTS
- ******************************************************************************/
-#define ALARM_HEAP_MAX_ELEMENTS                     (16U)
-
 /******************************************************************************
  DEFINE PRIVATE TYPES
  ******************************************************************************/
@@ -32,13 +27,26 @@ typedef struct {
     mp_obj_t handler;
     mp_obj_t handler_arg;
     bool periodic;
+    bool hard;
 } mp_obj_alarm_t;
 
 struct {
     uint32_t count;
+    uint32_t capacity;
     mp_obj_alarm_t **data;
 } alarm_heap;
 
+// alarms expired in the ISR and not dispatched yet, all the alarms found expired
+// by one interrupt are run by the same callback of the interrupt task
+struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t size;
+    uint32_t dropped;
+    bool dispatch_pending;
+    mp_obj_alarm_t **data;
+} alarm_fired;
+
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
@@ -54,14 +62,23 @@ void mach_timer_alarm_preinit(void) {
     timer_isr_register(TIMER_GROUP_0, TIMER_0, timer_alarm_isr, NULL, 0, NULL);
 }
 
-void mach_timer_alarm_init_heap(void) {
+void mach_timer_alarm_init_heap(uint32_t capacity) {
     alarm_heap.count = 0;
-    MP_STATE_PORT(mp_alarm_heap) = gc_alloc(ALARM_HEAP_MAX_ELEMENTS * sizeof(mp_obj_alarm_t *), false);
+    alarm_heap.capacity = capacity;
+    // a periodic alarm can be waiting for its dispatch twice
+    alarm_fired.head = 0;
+    alarm_fired.tail = 0;
+    alarm_fired.size = 2 * capacity;
+    alarm_fired.dropped = 0;
+    alarm_fired.dispatch_pending = false;
+    // one block holds both, it's a root pointer so the alarms can't be collected while in use
+    MP_STATE_PORT(mp_alarm_heap) = gc_alloc((alarm_heap.capacity + alarm_fired.size) * sizeof(mp_obj_alarm_t *), false);
     alarm_heap.data = MP_STATE_PORT(mp_alarm_heap);
     if (alarm_heap.data == NULL) {
         mp_printf(&mp_plat_print, "FATAL ERROR: not enough memory for the alarms heap\n");
         for (;;);
     }
+    alarm_fired.data = alarm_heap.data + alarm_heap.capacity;
 }
 
 // Insert a new alarm into the heap
@@ -140,11 +157,19 @@ STATIC IRAM_ATTR void load_next_alarm(void) {
     }
 }
 
-STATIC IRAM_ATTR void set_alarm_when(mp_obj_alarm_t *alarm, uint64_t delta) {
+STATIC IRAM_ATTR uint64_t get_timer_count(void) {
     TIMERG0.hw_timer[0].update = 1;
-    alarm->when = ((uint64_t) TIMERG0.hw_timer[0].cnt_high << 32)
-        | (TIMERG0.hw_timer[0].cnt_low);
-    alarm->when += delta;
+    return ((uint64_t) TIMERG0.hw_timer[0].cnt_high << 32) | (TIMERG0.hw_timer[0].cnt_low);
+}
+
+STATIC IRAM_ATTR void set_alarm_when(mp_obj_alarm_t *alarm, uint64_t delta) {
+    alarm->when = get_timer_count() + delta;
+}
+
+STATIC void alarm_release(void *arg) {
+    mp_obj_alarm_t *alarm = arg;
+    mp_irq_remove(alarm);
+    INTERRUPT_OBJ_CLEAN(alarm);
 }
 
 STATIC void alarm_handler(void *arg) {
@@ -155,29 +180,90 @@ STATIC void alarm_handler(void *arg) {
         mp_call_function_1(alarm->handler, alarm->handler_arg);
     }
     if (!alarm->periodic) {
-        mp_irq_remove(alarm);
-        INTERRUPT_OBJ_CLEAN(alarm);
+        alarm_release(alarm);
+    }
+}
+
+STATIC void alarm_hard_handler(void *arg) {
+    // called by the hard interrupt thread with the heap locked
+    mp_obj_alarm_t *alarm = arg;
+
+    if (alarm->handler && alarm->handler != mp_const_none) {
+        mp_call_function_1(alarm->handler, alarm->handler_arg);
+    }
+    if (!alarm->periodic) {
+        // shrinking the callbacks list may reallocate it
+        mp_irq_queue_interrupt_non_ISR(alarm_release, alarm);
+    }
+}
+
+// runs all the alarms fired since the last dispatch
+STATIC void alarms_dispatch(void *arg) {
+    uint32_t state = MICROPY_BEGIN_ATOMIC_SECTION();
+    alarm_fired.dispatch_pending = false;
+    MICROPY_END_ATOMIC_SECTION(state);
+
+    for (;;) {
+        mp_obj_alarm_t *alarm = NULL;
+        state = MICROPY_BEGIN_ATOMIC_SECTION();
+        if (alarm_fired.tail != alarm_fired.head) {
+            alarm = alarm_fired.data[alarm_fired.tail];
+            alarm_fired.data[alarm_fired.tail] = NULL;
+            alarm_fired.tail = (alarm_fired.tail + 1) % alarm_fired.size;
+        }
+        MICROPY_END_ATOMIC_SECTION(state);
+        if (alarm == NULL) {
+            break;
+        }
+        alarm_handler(alarm);
     }
 }
 
 IRAM_ATTR void timer_alarm_isr(void *arg) {
     TIMERG0.int_clr_timers.t0 = 1; // acknowledge the interrupt
 
+    uint64_t now = get_timer_count();
+    bool fired = false;
+
     // need to check whether all the alarms have been removed from the list
-    // or not since the last time the HW timer was set up
-    if (alarm_heap.count > 0) {
+    // or not since the last time the HW timer was set up, then take all that are due
+    while (alarm_heap.count > 0 && alarm_heap.data[0]->when <= now) {
         mp_obj_alarm_t *alarm = alarm_heap.data[0];
 
         // This will automatically load the next alarm in the queue
         remove_alarm(0);
 
         if (alarm->periodic) {
-            set_alarm_when(alarm, alarm->interval);
+            // scheduled from the previous expiry, so the latency doesn't add up
+            // the periods already missed are skipped
+            uint64_t interval = (alarm->interval > 0) ? alarm->interval : 1;
+            alarm->when += interval;
+            if (alarm->when <= now) {
+                alarm->when += ((now - alarm->when) / interval + 1) * interval;
+            }
             // If this alarm is inserted back to the 0th place, load again
             insert_alarm(alarm);
         }
 
-        mp_irq_queue_interrupt(alarm_handler, alarm);
+        if (alarm->hard) {
+            // straight to the hard task, the others wait for the dispatch
+            mp_irq_queue_interrupt_hard(alarm_hard_handler, alarm);
+            continue;
+        }
+
+        uint32_t next = (alarm_fired.head + 1) % alarm_fired.size;
+        if (next != alarm_fired.tail) {
+            alarm_fired.data[alarm_fired.head] = alarm;
+            alarm_fired.head = next;
+            fired = true;
+        } else {
+            alarm_fired.dropped++;
+        }
+    }
+
+    if (fired && !alarm_fired.dispatch_pending) {
+        alarm_fired.dispatch_pending = true;
+        mp_irq_queue_interrupt_prio(alarms_dispatch, NULL, MP_IRQ_PRIORITY_HIGH);
     }
 }
 
@@ -190,6 +276,7 @@ STATIC mp_obj_t alarm_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_u
         { MP_QSTR_us,           MP_ARG_INT  | MP_ARG_KW_ONLY,    {.u_int = 0} },
         { MP_QSTR_arg,          MP_ARG_OBJ  | MP_ARG_KW_ONLY,    {.u_obj = mp_const_none} },
         { MP_QSTR_periodic,     MP_ARG_BOOL | MP_ARG_KW_ONLY,    {.u_bool = false} },
+        { MP_QSTR_hard,         MP_ARG_BOOL | MP_ARG_KW_ONLY,    {.u_bool = false} },
     };
 
     // parse arguments
@@ -220,6 +307,7 @@ STATIC mp_obj_t alarm_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_u
     self->base.type = type;
     self->interval = clocks;
     self->periodic = args[5].u_bool;
+    self->hard = args[6].u_bool;
 
     self->heap_index = -1;
     alarm_set_callback_helper(self, args[0].u_obj, args[4].u_obj);
@@ -254,7 +342,7 @@ STATIC void alarm_set_callback_helper(mp_obj_t self_in, mp_obj_t handler, mp_obj
         INTERRUPT_OBJ_CLEAN(self);
     }
 
-    if (alarm_heap.count == ALARM_HEAP_MAX_ELEMENTS) {
+    if (alarm_heap.count == alarm_heap.capacity) {
         error = true;
     } else if (self->handler != mp_const_none) {
         mp_irq_add(self, handler);
@@ -265,7 +353,7 @@ STATIC void alarm_set_callback_helper(mp_obj_t self_in, mp_obj_t handler, mp_obj
     MICROPY_END_ATOMIC_SECTION(state);
 
     if (error) {
-        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_MemoryError, "maximum number of %d alarms already reached", ALARM_HEAP_MAX_ELEMENTS));
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_MemoryError, "maximum number of %d alarms already reached", alarm_heap.capacity));
     }
 }
 
@@ -273,12 +361,15 @@ STATIC mp_obj_t alarm_callback(size_t n_args, const mp_obj_t *pos_args, mp_map_t
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_handler,  MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_obj = mp_const_none} },
         { MP_QSTR_arg,      MP_ARG_OBJ | MP_ARG_KW_ONLY,  {.u_obj = mp_const_none} },
+        { MP_QSTR_hard,     MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
     };
 
-    mp_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_obj_alarm_t *self = MP_OBJ_TO_PTR(pos_args[0]);
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
+    self->hard = args[2].u_bool;
+
     alarm_set_callback_helper(self, args[0].u_obj, args[1].u_obj);
 
     return mp_const_none;
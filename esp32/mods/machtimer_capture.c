@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "py/mpconfig.h"
+#include "py/runtime.h"
+#include "py/mperrno.h"
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "driver/mcpwm.h"
+#include "soc/mcpwm_struct.h"
+
+#include "machpin.h"
+#include "mpexception.h"
+#include "machtimer.h"
+#include "machtimer_capture.h"
+
+/******************************************************************************
+ DEFINE PRIVATE CONSTANTS
+ ******************************************************************************/
+#define CAPTURE_CHANNELS                            (3)
+#define CAPTURE_RING_SIZE_DEFAULT                   (64)        // must be a power of 2
+#define CAPTURE_EDGE_RISING                         (0x01)
+#define CAPTURE_EDGE_FALLING                        (0x02)
+#define CAPTURE_INT_BIT(ch)                         (BIT(27) << (ch))
+#define CAPTURE_LEVEL                               (1ULL << 63)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+// the MCPWM capture timer runs from the APB clock, twice the rate of the main timer,
+// it is synced to it so every capture converts to a main timer count
+typedef struct {
+    mp_obj_base_t base;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t size;
+    uint32_t dropped;
+    uint64_t *stamps;       // main timer count, bit 63 is the level after the edge
+    uint8_t channel;
+    bool enabled;
+} mp_obj_capture_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC mp_obj_capture_t capture_obj[CAPTURE_CHANNELS];
+STATIC bool capture_isr_installed = false;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC IRAM_ATTR void capture_isr(void *arg) {
+    uint32_t status = MCPWM0.int_st.val;
+    uint64_t now = machtimer_get_timer_counter_value();
+
+    for (uint32_t ch = 0; ch < CAPTURE_CHANNELS; ch++) {
+        if (!(status & CAPTURE_INT_BIT(ch))) {
+            continue;
+        }
+        mp_obj_capture_t *self = &capture_obj[ch];
+        if (!self->enabled) {
+            continue;
+        }
+        // the capture happened less than one wrap of the 32 bit counter ago
+        uint32_t age = (uint32_t)(now << 1) - MCPWM0.cap_val_ch[ch];
+        uint64_t stamp = now - (age >> 1);
+        // the edge bit is set for a falling edge
+        if (!((MCPWM0.cap_status.val >> ch) & 1)) {
+            stamp |= CAPTURE_LEVEL;
+        }
+        if (self->head - self->tail < self->size) {
+            self->stamps[self->head & (self->size - 1)] = stamp;
+            self->head++;
+        } else {
+            self->dropped++;
+        }
+    }
+    MCPWM0.int_clr.val = status;
+}
+
+STATIC void capture_deinit_helper(mp_obj_capture_t *self) {
+    if (self->enabled) {
+        MCPWM0.int_ena.val &= ~CAPTURE_INT_BIT(self->channel);
+        mcpwm_capture_disable(MCPWM_UNIT_0, MCPWM_SELECT_CAP0 + self->channel);
+        self->enabled = false;
+    }
+    if (self->stamps) {
+        heap_caps_free(self->stamps);
+        self->stamps = NULL;
+    }
+}
+
+/******************************************************************************/
+// Micro Python bindings
+
+/// \classmethod \constructor(channel, pin, *, edge=Capture.RISING, size=64)
+/// Time stamps the edges of the pin in hardware, in counts of the main timer.
+STATIC mp_obj_t capture_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_channel,      MP_ARG_INT  | MP_ARG_REQUIRED,   },
+        { MP_QSTR_pin,          MP_ARG_OBJ  | MP_ARG_REQUIRED,   },
+        { MP_QSTR_edge,         MP_ARG_INT  | MP_ARG_KW_ONLY,    {.u_int = CAPTURE_EDGE_RISING} },
+        { MP_QSTR_size,         MP_ARG_INT  | MP_ARG_KW_ONLY,    {.u_int = CAPTURE_RING_SIZE_DEFAULT} },
+    };
+
+    // parse arguments
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, all_args, &kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    mp_int_t channel = args[0].u_int;
+    if (channel < 0 || channel >= CAPTURE_CHANNELS) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+    }
+    pin_obj_t *pin = pin_find(args[1].u_obj);
+    mp_int_t edge = args[2].u_int;
+    mp_int_t size = args[3].u_int;
+    if (edge < CAPTURE_EDGE_RISING || edge > (CAPTURE_EDGE_RISING | CAPTURE_EDGE_FALLING) || size < 2 || (size & (size - 1))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    mp_obj_capture_t *self = &capture_obj[channel];
+    capture_deinit_helper(self);
+    self->base.type = type;
+    self->channel = channel;
+
+    // the ISR reads the ring, it can't be on the Python heap
+    self->stamps = heap_caps_malloc(size * sizeof(uint64_t), MALLOC_CAP_INTERNAL);
+    if (!self->stamps) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    self->size = size;
+    self->head = 0;
+    self->tail = 0;
+    self->dropped = 0;
+
+    if (!capture_isr_installed) {
+        if (mcpwm_isr_register(MCPWM_UNIT_0, capture_isr, NULL, ESP_INTR_FLAG_IRAM, NULL) != ESP_OK) {
+            capture_deinit_helper(self);
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        capture_isr_installed = true;
+    }
+
+    // route the pin through the GPIO matrix
+    mcpwm_gpio_init(MCPWM_UNIT_0, MCPWM_CAP_0 + channel, pin->pin_number);
+    mcpwm_capture_enable(MCPWM_UNIT_0, MCPWM_SELECT_CAP0 + channel, (edge == CAPTURE_EDGE_FALLING) ? MCPWM_NEG_EDGE : MCPWM_POS_EDGE, 0);
+    // the mode register has one bit for each edge
+    MCPWM0.cap_cfg_ch[channel].mode = ((edge & CAPTURE_EDGE_FALLING) ? 1 : 0) | ((edge & CAPTURE_EDGE_RISING) ? 2 : 0);
+
+    // load twice the main timer count into the capture timer, they share the APB clock
+    uint32_t state = MICROPY_BEGIN_ATOMIC_SECTION();
+    MCPWM0.cap_timer_phase = (uint32_t)(machtimer_get_timer_counter_value() << 1);
+    MCPWM0.cap_timer_cfg.synci_en = 1;
+    MCPWM0.cap_timer_cfg.sync_sw = 1;
+    MICROPY_END_ATOMIC_SECTION(state);
+
+    self->enabled = true;
+    MCPWM0.int_clr.val = CAPTURE_INT_BIT(channel);
+    MCPWM0.int_ena.val |= CAPTURE_INT_BIT(channel);
+    return self;
+}
+
+/// \method read_into(buf)
+/// Moves the time stamps into buf as 64 bit words (bit 63 is the level), returns how many.
+STATIC mp_obj_t capture_read_into(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_capture_t *self = self_in;
+    if (!self->enabled) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint32_t max = bufinfo.len / sizeof(uint64_t);
+    uint64_t *dest = bufinfo.buf;
+
+    uint32_t count = 0;
+    uint32_t tail = self->tail;
+    uint32_t head = self->head;
+    while (tail != head && count < max) {
+        dest[count++] = self->stamps[tail & (self->size - 1)];
+        tail++;
+    }
+    self->tail = tail;
+
+    return mp_obj_new_int_from_uint(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(capture_read_into_obj, capture_read_into);
+
+/// \method dropped()
+/// Returns the edges lost because the ring was full since the last call.
+STATIC mp_obj_t capture_dropped(mp_obj_t self_in) {
+    mp_obj_capture_t *self = self_in;
+    uint32_t state = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t dropped = self->dropped;
+    self->dropped = 0;
+    MICROPY_END_ATOMIC_SECTION(state);
+    return mp_obj_new_int_from_uint(dropped);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(capture_dropped_obj, capture_dropped);
+
+STATIC mp_obj_t capture_deinit(mp_obj_t self_in) {
+    capture_deinit_helper(self_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(capture_deinit_obj, capture_deinit);
+
+STATIC const mp_map_elem_t mach_timer_capture_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__),            MP_OBJ_NEW_QSTR(MP_QSTR_Capture) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read_into),           (mp_obj_t) &capture_read_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dropped),             (mp_obj_t) &capture_dropped_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t) &capture_deinit_obj },
+
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RISING),              MP_OBJ_NEW_SMALL_INT(CAPTURE_EDGE_RISING) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_FALLING),             MP_OBJ_NEW_SMALL_INT(CAPTURE_EDGE_FALLING) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mach_timer_capture_dict, mach_timer_capture_dict_table);
+
+const mp_obj_type_t mach_timer_capture_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Capture,
+    .make_new = capture_make_new,
+    .locals_dict = (mp_obj_t)&mach_timer_capture_dict,
+};
@@ -8,6 +8,7 @@
 #include "py/mpconfig.h"
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/objint.h"
 
 #include "esp_system.h"
 
@@ -19,13 +20,43 @@ typedef struct {
     uint64_t accumulator;
 } mp_obj_chrono_t;
 
+STATIC uint64_t chrono_get_ticks(mp_obj_t ticks) {
+    if (MP_OBJ_IS_SMALL_INT(ticks)) {
+        return MP_OBJ_SMALL_INT_VALUE(ticks);
+    } else if (!MP_OBJ_IS_TYPE(ticks, &mp_type_int)) {
+        mp_raise_TypeError("ticks must be int");
+    }
+    uint64_t value = 0;
+    mp_obj_int_to_bytes_impl(ticks, false, sizeof(value), (byte *)&value);
+    return value;
+}
+
+// Chrono(start, stop) holds the time between two counts of the main timer,
+// like the ones of Timer.ticks() or Timer.Capture
 STATIC mp_obj_t chrono_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 2, false);
+    if (n_args == 1) {
+        mp_raise_TypeError("start and stop are needed");
+    }
+
     mp_obj_chrono_t *self = m_new_obj(mp_obj_chrono_t);
 
     self->base.type = type;
     self->accumulator = 0;
     self->start = 0;
 
+    if (n_args == 2) {
+        uint64_t start = chrono_get_ticks(args[0]);
+        uint64_t stop = chrono_get_ticks(args[1]);
+        // the level bit of the captures isn't part of the time
+        start &= ~(1ULL << 63);
+        stop &= ~(1ULL << 63);
+        if (stop < start) {
+            mp_raise_ValueError("stop is before start");
+        }
+        self->accumulator = stop - start;
+    }
+
     return self;
 }
 
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <timer.h>
+
+#include "py/mpconfig.h"
+#include "py/runtime.h"
+
+#include "esp_attr.h"
+#include "machtimer.h"
+#include "machtimer_compare.h"
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    machtimer_compare_cb_t cb;
+    void *arg;
+    uint64_t when;
+    uint64_t period;
+    bool installed;
+} machtimer_compare_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC machtimer_compare_t machtimer_compare[MACHTIMER_COMPARE_CHANNELS];
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC IRAM_ATTR uint64_t machtimer_compare_now(uint32_t channel) {
+    TIMERG1.hw_timer[channel].update = 1;
+    return ((uint64_t) TIMERG1.hw_timer[channel].cnt_high << 32) | (TIMERG1.hw_timer[channel].cnt_low);
+}
+
+STATIC IRAM_ATTR void machtimer_compare_load(uint32_t channel) {
+    machtimer_compare_t *self = &machtimer_compare[channel];
+    TIMERG1.hw_timer[channel].alarm_high = (uint32_t) (self->when >> 32);
+    TIMERG1.hw_timer[channel].alarm_low = (uint32_t) self->when;
+    TIMERG1.hw_timer[channel].config.alarm_en = 1;
+}
+
+STATIC IRAM_ATTR void machtimer_compare_isr(void *arg) {
+    uint32_t channel = (uint32_t)arg;
+    machtimer_compare_t *self = &machtimer_compare[channel];
+
+    // acknowledge the interrupt
+    if (channel == TIMER_0) {
+        TIMERG1.int_clr_timers.t0 = 1;
+    } else {
+        TIMERG1.int_clr_timers.t1 = 1;
+    }
+
+    if (self->cb == NULL) {
+        return;
+    }
+
+    machtimer_compare_cb_t cb = self->cb;
+    void *cb_arg = self->arg;
+    if (self->period > 0) {
+        // from the previous compare value, so there's no drift, the periods already missed are skipped
+        uint64_t now = machtimer_compare_now(channel);
+        self->when += self->period;
+        if (self->when <= now) {
+            self->when += ((now - self->when) / self->period + 1) * self->period;
+        }
+        machtimer_compare_load(channel);
+    } else {
+        self->cb = NULL;
+    }
+    cb(cb_arg);
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+bool machtimer_compare_start(uint32_t channel, uint64_t when, uint64_t period, machtimer_compare_cb_t cb, void *arg) {
+    if (channel >= MACHTIMER_COMPARE_CHANNELS || cb == NULL) {
+        return false;
+    }
+    machtimer_compare_t *self = &machtimer_compare[channel];
+
+    if (!self->installed) {
+        timer_config_t config = { .alarm_en = false,
+                                  .counter_en = false,
+                                  .counter_dir = TIMER_COUNT_UP,
+                                  .intr_type = TIMER_INTR_LEVEL,
+                                  .auto_reload = false, .divider = 2};
+        if (timer_init(TIMER_GROUP_1, channel, &config) != ESP_OK ||
+            timer_isr_register(TIMER_GROUP_1, channel, machtimer_compare_isr, (void *)channel, ESP_INTR_FLAG_IRAM, NULL) != ESP_OK) {
+            return false;
+        }
+        self->installed = true;
+    }
+
+    timer_disable_intr(TIMER_GROUP_1, channel);
+    timer_pause(TIMER_GROUP_1, channel);
+    self->cb = cb;
+    self->arg = arg;
+    self->when = when;
+    self->period = period;
+
+    // same clock as the main timer, only the count needs to be copied,
+    // the error is the few cycles between the read and the start
+    uint32_t state = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint64_t now = machtimer_get_timer_counter_value();
+    timer_set_counter_value(TIMER_GROUP_1, channel, now);
+    timer_start(TIMER_GROUP_1, channel);
+    MICROPY_END_ATOMIC_SECTION(state);
+
+    // a compare value already passed wouldn't match anymore
+    if (self->when <= now) {
+        self->when = now + (CLK_FREQ / 1000000);
+    }
+
+    machtimer_compare_load(channel);
+    timer_enable_intr(TIMER_GROUP_1, channel);
+    return true;
+}
+
+void machtimer_compare_stop(uint32_t channel) {
+    if (channel < MACHTIMER_COMPARE_CHANNELS && machtimer_compare[channel].installed) {
+        timer_disable_intr(TIMER_GROUP_1, channel);
+        TIMERG1.hw_timer[channel].config.alarm_en = 0;
+        timer_pause(TIMER_GROUP_1, channel);
+        machtimer_compare[channel].cb = NULL;
+    }
+}
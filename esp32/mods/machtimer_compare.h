@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MACHTIMER_COMPARE_H_
+#define MACHTIMER_COMPARE_H_
+
+// the timers of group 1, group 0 is used by the alarms and the HAL
+#define MACHTIMER_COMPARE_CHANNELS                  (2)
+
+// channel 0 fires the scheduled LoRa transmissions (LoRa.send_at)
+#define MACHTIMER_COMPARE_CHANNEL_LORA              (0)
+
+// called from the timer ISR, it must be in IRAM and can't touch the Python heap
+typedef void (*machtimer_compare_cb_t)(void *arg);
+
+// when is given in clocks of the main timer (CLK_FREQ, the Chrono and Alarm time base),
+// a period of 0 makes it one-shot
+extern bool machtimer_compare_start(uint32_t channel, uint64_t when, uint64_t period, machtimer_compare_cb_t cb, void *arg);
+extern void machtimer_compare_stop(uint32_t channel);
+
+#endif  // MACHTIMER_COMPARE_H_
@@ -28,6 +28,7 @@
 #include <stdio.h>
 
 #include "esp_log.h"
+#include "esp_sleep.h"
 
 #include "driver/gpio.h"
 #include "driver/touch_pad.h"
@@ -36,6 +37,7 @@
 #include "py/mphal.h"
 #include "machtouch.h"
 #include "machpin.h"
+#include "mpirq.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -43,12 +45,22 @@
 
 #define TOUCHPAD_FILTER_TOUCH_PERIOD_MS         (10)
 
+#define TOUCHPAD_TRIGGER_PRESS                  (0x01)
+#define TOUCHPAD_TRIGGER_RELEASE                (0x02)
+
 
 typedef struct _mtp_obj_t {
     mp_obj_base_t base;
     gpio_num_t gpio_id;
     touch_pad_t touchpad_id;
     uint16_t init_value;
+    mp_obj_t handler;
+    mp_obj_t handler_arg;
+    uint16_t threshold;         // touched below it, 0 if the pad isn't watched
+    uint16_t release;           // released above it, a bit higher than the threshold
+    uint8_t trigger;
+    volatile uint8_t events;
+    volatile bool touched;
 } mtp_obj_t;
 
 STATIC mtp_obj_t touchpad_obj[] = {
@@ -64,6 +76,39 @@ STATIC mtp_obj_t touchpad_obj[] = {
     {{&machine_touchpad_type}, GPIO_NUM_32, TOUCH_PAD_NUM9},
 };
 
+STATIC void mtp_callback_handler(void *arg) {
+    mtp_obj_t *self = arg;
+    if (self->handler && self->handler != mp_const_none) {
+        mp_call_function_1(self->handler, self->handler_arg);
+    }
+}
+
+// called by the driver at every filter period with the filtered values of all the pads,
+// detects the touches without any polling from Python
+STATIC void mtp_filter_cb(uint16_t *raw_value, uint16_t *filtered_value) {
+    for (int i = 0; i < MP_ARRAY_SIZE(touchpad_obj); i++) {
+        mtp_obj_t *self = &touchpad_obj[i];
+        if (self->threshold == 0) {
+            continue;
+        }
+        uint16_t value = filtered_value[self->touchpad_id];
+        uint8_t event = 0;
+        if (!self->touched && value < self->threshold) {
+            self->touched = true;
+            event = TOUCHPAD_TRIGGER_PRESS;
+        } else if (self->touched && value > self->release) {
+            self->touched = false;
+            event = TOUCHPAD_TRIGGER_RELEASE;
+        }
+        if (event) {
+            self->events |= event;
+            if (event & self->trigger) {
+                mp_irq_queue_interrupt_non_ISR(mtp_callback_handler, self);
+            }
+        }
+    }
+}
+
 STATIC mp_obj_t mtp_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw,
         const mp_obj_t *args) {
 
@@ -86,6 +131,7 @@ STATIC mp_obj_t mtp_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_
         touch_pad_set_voltage(TOUCH_HVOLT_2V7, TOUCH_LVOLT_0V5, TOUCH_HVOLT_ATTEN_1V);
         // initialize and start a software filter to detect slight changes in capacitance
         touch_pad_filter_start(TOUCHPAD_FILTER_TOUCH_PERIOD_MS);
+        touch_pad_set_filter_read_cb(mtp_filter_cb);
         touch_pad_intr_disable();
         touch_pad_clear_status();
         initialized = 1;
@@ -127,11 +173,119 @@ STATIC mp_obj_t mtp_init_value(uint n_args, const mp_obj_t *arg) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mtp_init_value_obj, 1, 2, mtp_init_value);
 
+/// \method callback(trigger, handler=None, arg=None, *, threshold=None, wake=False)
+/// The pad is touched when its filtered value goes below threshold (2/3 of init_value by default).
+/// The threshold is also given to the hardware, with wake=True a touch wakes the board from sleep.
+STATIC mp_obj_t mtp_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_trigger,      MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_handler,      MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_arg,          MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_threshold,    MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_wake,         MP_ARG_KW_ONLY | MP_ARG_BOOL,   {.u_bool = false} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    mtp_obj_t *self = pos_args[0];
+
+    if (args[0].u_obj != mp_const_none && args[1].u_obj != mp_const_none) {
+        mp_int_t threshold = (self->init_value * 2) / 3;
+        if (args[3].u_obj != mp_const_none) {
+            threshold = mp_obj_get_int(args[3].u_obj);
+        }
+        if (threshold <= 0 || threshold >= self->init_value) {
+            mp_raise_ValueError("threshold must be below init_value");
+        }
+        if (touch_pad_set_thresh(self->touchpad_id, threshold) != ESP_OK) {
+            mp_raise_ValueError("Touch pad error");
+        }
+        self->handler = args[1].u_obj;
+        self->handler_arg = (args[2].u_obj == mp_const_none) ? self : args[2].u_obj;
+        mp_irq_add(self, args[1].u_obj);
+        self->touched = false;
+        self->events = 0;
+        self->trigger = mp_obj_get_int(args[0].u_obj);
+        // a quarter of the pressed range as hysteresis
+        self->release = threshold + ((self->init_value - threshold) / 4);
+        self->threshold = threshold;
+        if (args[4].u_bool) {
+            esp_sleep_enable_touchpad_wakeup();
+        }
+    } else {
+        self->threshold = 0;
+        self->trigger = 0;
+        mp_irq_remove(self);
+        INTERRUPT_OBJ_CLEAN(self);
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mtp_callback_obj, 1, mtp_callback);
+
+STATIC mp_obj_t mtp_touched(mp_obj_t self_in) {
+    mtp_obj_t *self = self_in;
+    return mp_obj_new_bool(self->touched);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mtp_touched_obj, mtp_touched);
+
+STATIC mp_obj_t mtp_events(mp_obj_t self_in) {
+    mtp_obj_t *self = self_in;
+    int32_t events = self->events;
+    self->events = 0;
+    return mp_obj_new_int(events);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mtp_events_obj, mtp_events);
+
+/// \method scan(*, sleep_cycles, meas_cycles, filter_ms)
+/// Sets how the touch FSM scans all the pads: sleep_cycles of the 150kHz clock between
+/// measurements, meas_cycles of the 8MHz clock for each measurement.
+STATIC mp_obj_t mtp_scan(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_sleep_cycles, MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_meas_cycles,  MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_filter_ms,    MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    uint16_t sleep_cycles, meas_cycles;
+    touch_pad_get_meas_time(&sleep_cycles, &meas_cycles);
+    if (args[0].u_obj != mp_const_none) {
+        sleep_cycles = mp_obj_get_int(args[0].u_obj);
+    }
+    if (args[1].u_obj != mp_const_none) {
+        meas_cycles = mp_obj_get_int(args[1].u_obj);
+    }
+    if (touch_pad_set_meas_time(sleep_cycles, meas_cycles) != ESP_OK) {
+        mp_raise_ValueError("Touch pad error");
+    }
+    if (args[2].u_obj != mp_const_none) {
+        if (touch_pad_set_filter_period(mp_obj_get_int(args[2].u_obj)) != ESP_OK) {
+            mp_raise_ValueError("Touch pad error");
+        }
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mtp_scan_obj, 1, mtp_scan);
+
 STATIC const mp_rom_map_elem_t mtp_locals_dict_table[] = {
     // instance methods
     { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&mtp_config_obj) },
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mtp_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_init_value), MP_ROM_PTR(&mtp_init_value_obj) },
+    { MP_ROM_QSTR(MP_QSTR_callback), MP_ROM_PTR(&mtp_callback_obj) },
+    { MP_ROM_QSTR(MP_QSTR_touched), MP_ROM_PTR(&mtp_touched_obj) },
+    { MP_ROM_QSTR(MP_QSTR_events), MP_ROM_PTR(&mtp_events_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scan), MP_ROM_PTR(&mtp_scan_obj) },
+
+    // class constants
+    { MP_ROM_QSTR(MP_QSTR_PRESS), MP_ROM_INT(TOUCHPAD_TRIGGER_PRESS) },
+    { MP_ROM_QSTR(MP_QSTR_RELEASE), MP_ROM_INT(TOUCHPAD_TRIGGER_RELEASE) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mtp_locals_dict, mtp_locals_dict_table);
@@ -8,6 +8,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "py/mpconfig.h"
 #include "py/obj.h"
@@ -17,6 +18,7 @@
 #include "py/mphal.h"
 #include "py/stream.h"
 #include "py/mperrno.h"
+#include "py/mpthread.h"
 #include "readline.h"
 #include "serverstask.h"
 
@@ -40,6 +42,7 @@
 #include "mpexception.h"
 #include "utils/interrupt_char.h"
 #include "moduos.h"
+#include "mpirq.h"
 #include "machpin.h"
 #include "pins.h"
 #include "periph_ctrl.h"
@@ -47,6 +50,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/ringbuf.h"
 #include "freertos/xtensa_api.h"
 
 /// \moduleref machine
@@ -62,6 +66,22 @@
 #define MACHUART_TX_MAX_TIMEOUT_MS              (5)
 
 #define MACHUART_RX_BUFFER_LEN                  (512)
+#define MACHUART_TX_BUFFER_LEN                  (512)
+#define MACHUART_RX_THRESHOLD_DEFAULT           (120)       // same as the IDF driver
+#define MACHUART_EVENT_QUEUE_LEN                (16)
+
+// frame mode
+#define MACHUART_FRAME_SIZE_DEFAULT             (256)
+#define MACHUART_FRAME_BUFFER_DEFAULT           (2048)
+#define MACHUART_FRAME_END_MAX                  (4)
+#define MACHUART_FRAME_TASK_STACK_SIZE          (2048)
+#define MACHUART_FRAME_TASK_PRIORITY            (6)
+#define MACHUART_FRAME_EVENT_WAIT_MS            (50)
+
+// TX done notifications
+#define MACHUART_TX_TASK_STACK_SIZE             (2048)
+#define MACHUART_TX_TASK_PRIORITY               (6)
+#define MACHUART_TX_WAIT_MS                     (50)
 #define MACHUART_TX_FIFO_LEN                    (UART_FIFO_LEN)
 
 // interrupt triggers
@@ -69,6 +89,7 @@
 #define UART_TRIGGER_RX_HALF                    (0x02)
 #define UART_TRIGGER_RX_FULL                    (0x04)
 #define UART_TRIGGER_TX_DONE                    (0x08)
+#define UART_TRIGGER_RX_FRAME                   (0x10)
 
 #define MACH_UART_CHECK_INIT(self)                    \
     if(!(self->init)) {nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_OSError, "UART not Initialized!"));}
@@ -84,6 +105,8 @@ STATIC mp_obj_t mach_uart_deinit(mp_obj_t self_in);
  ******************************************************************************/
 struct _mach_uart_obj_t {
     mp_obj_base_t base;
+    mp_obj_t handler;
+    mp_obj_t handler_arg;
     uart_dev_t* uart_reg;
     pin_obj_t *pins[4];
     uart_config_t config;
@@ -92,6 +115,26 @@ struct _mach_uart_obj_t {
     uint8_t rx_timeout;
     uint8_t n_pins;
     bool init;
+    bool tx_buffered;               // writes are queued in the driver's TX ring buffer
+    QueueHandle_t events;           // driver events, only used to count the overflows
+    uint32_t rx_overflows;
+    uint8_t rx_threshold;
+    uint8_t trigger;
+    bool hard;                      // the callback runs in the hard IRQ task
+    // frame mode, the frame task owns the driver events and the RX ring while it runs
+    TaskHandle_t frame_task;
+    RingbufHandle_t frames;         // complete frames waiting for read_frame()
+    uint8_t *frame_buf;             // frame being received
+    uint32_t frame_len;
+    uint32_t frame_max;
+    uint32_t frames_dropped;
+    uint8_t frame_idle;             // idle line, in character times, closing a frame, 0 if not used
+    uint8_t frame_end[MACHUART_FRAME_END_MAX];
+    uint8_t frame_end_len;
+    volatile bool frame_stop;
+    TaskHandle_t tx_task;           // queues the TX_DONE callback once a write has left the FIFO
+    volatile bool tx_stop;
+    bool rs485;                     // RTS drives the transceiver's DE pin
 };
 
 /******************************************************************************
@@ -123,8 +166,21 @@ void uart_deinit_all (void) {
     }
 }
 
+// drains the driver events, data lost because the RX FIFO overflowed is counted
+static void uart_rx_check_events (mach_uart_obj_t *self) {
+    uart_event_t event;
+    if (self->events && !self->frame_task) {
+        while (xQueueReceive(self->events, &event, 0) == pdTRUE) {
+            if (event.type == UART_FIFO_OVF) {
+                self->rx_overflows++;
+            }
+        }
+    }
+}
+
 uint32_t uart_rx_any(mach_uart_obj_t *self) {
     size_t len = 0;
+    uart_rx_check_events(self);
     uart_get_buffered_data_len(self->uart_id, &len);
     return len;
 }
@@ -168,6 +224,9 @@ bool uart_tx_strn(mach_uart_obj_t *self, const char *str, uint len) {
         self->uart_reg->int_clr.tx_done = 1;
 
         isrmask = MICROPY_BEGIN_ATOMIC_SECTION();
+    } else if (self->tx_buffered) {
+        // the driver feeds the FIFO from its interrupt
+        return uart_write_bytes(self->uart_id, str, len) == len;
     }
 
     for (const char *top = str + len; str < top; str++) {
@@ -205,6 +264,14 @@ static bool uart_tx_fifo_space (mach_uart_obj_t *self) {
     return false;
 }
 
+// with a TX ring it is writable once the previous writes have been sent, a write never blocks then
+static bool uart_tx_space (mach_uart_obj_t *self) {
+    if (self->tx_buffered && self->n_pins != 1) {
+        return uart_wait_tx_done(self->uart_id, 0) == ESP_OK;
+    }
+    return uart_tx_fifo_space(self);
+}
+
 static void uart_deassign_pins_af (mach_uart_obj_t *self) {
     for (int i = 0; i < self->n_pins; i++) {
         if (self->pins[i]) {
@@ -248,6 +315,138 @@ static void uart_assign_pins_af (mach_uart_obj_t *self, mp_obj_t *pins, uint32_t
     self->n_pins = n_pins;
 }
 
+STATIC void uart_callback_handler(void *arg) {
+    mach_uart_obj_t *self = arg;
+    if (self->handler && self->handler != mp_const_none) {
+        mp_call_function_1(self->handler, self->handler_arg);
+    }
+}
+
+static void uart_callback_queue (mach_uart_obj_t *self) {
+    if (self->hard) {
+        mp_irq_queue_interrupt_hard_non_ISR(uart_callback_handler, self);
+    } else {
+        mp_irq_queue_interrupt_non_ISR(uart_callback_handler, self);
+    }
+}
+
+static void uart_frame_close (mach_uart_obj_t *self, uint32_t len) {
+    if (len > 0) {
+        if (xRingbufferSend(self->frames, self->frame_buf, len, 0) != pdTRUE) {
+            self->frames_dropped++;
+        } else if (self->trigger & UART_TRIGGER_RX_FRAME) {
+            uart_callback_queue(self);
+        }
+        // keep what was received after the terminator
+        self->frame_len -= len;
+        memmove(self->frame_buf, &self->frame_buf[len], self->frame_len);
+    }
+}
+
+// the terminator can straddle two reads, so the search starts a few bytes back
+static void uart_frame_collect (mach_uart_obj_t *self, bool idle) {
+    size_t avail = 0;
+    uart_get_buffered_data_len(self->uart_id, &avail);
+    while (avail > 0) {
+        uint32_t start = self->frame_len;
+        int32_t len = uart_read_bytes(self->uart_id, &self->frame_buf[start], MIN(avail, self->frame_max - start), 0);
+        if (len <= 0) {
+            break;
+        }
+        avail -= len;
+        self->frame_len += len;
+
+        if (self->frame_end_len > 0) {
+            uint32_t i = (start >= self->frame_end_len) ? (start - self->frame_end_len + 1) : 0;
+            for ( ; i + self->frame_end_len <= self->frame_len; i++) {
+                if (!memcmp(&self->frame_buf[i], self->frame_end, self->frame_end_len)) {
+                    uart_frame_close(self, i + self->frame_end_len);
+                    i = (uint32_t)-1;   // start over on what is left
+                }
+            }
+        }
+        if (self->frame_len == self->frame_max) {
+            // too long, delivered as it is
+            uart_frame_close(self, self->frame_len);
+        }
+    }
+    if (idle && self->frame_idle > 0) {
+        uart_frame_close(self, self->frame_len);
+    }
+}
+
+STATIC void TASK_UART_FRAMES (void *pvParameters) {
+    mach_uart_obj_t *self = pvParameters;
+    uart_event_t event;
+    while (!self->frame_stop) {
+        if (xQueueReceive(self->events, &event, MACHUART_FRAME_EVENT_WAIT_MS / portTICK_PERIOD_MS) == pdTRUE) {
+            if (event.type == UART_FIFO_OVF) {
+                self->rx_overflows++;
+            } else if (event.type == UART_DATA) {
+                // the RX timeout (idle line) interrupt leaves less than the FIFO threshold behind
+                uart_frame_collect(self, event.size < self->rx_threshold);
+            }
+        } else if (self->frame_len > 0 && self->frame_idle > 0) {
+            // idle for a whole wait, it only happens if the frame ended exactly at the FIFO threshold
+            uart_frame_close(self, self->frame_len);
+        }
+    }
+    self->frame_task = NULL;
+    vTaskDelete(NULL);
+}
+
+// woken up by every write, the wait is bounded so that the task can be stopped
+STATIC void TASK_UART_TX (void *pvParameters) {
+    mach_uart_obj_t *self = pvParameters;
+    while (!self->tx_stop) {
+        if (ulTaskNotifyTake(pdTRUE, MACHUART_TX_WAIT_MS / portTICK_PERIOD_MS)) {
+            while (!self->tx_stop && uart_wait_tx_done(self->uart_id, MACHUART_TX_WAIT_MS / portTICK_PERIOD_MS) != ESP_OK);
+            if (!self->tx_stop && (self->trigger & UART_TRIGGER_TX_DONE)) {
+                uart_callback_queue(self);
+            }
+        }
+    }
+    self->tx_task = NULL;
+    vTaskDelete(NULL);
+}
+
+static void uart_tx_done_stop (mach_uart_obj_t *self) {
+    if (self->tx_task) {
+        self->tx_stop = true;
+        MP_THREAD_GIL_EXIT();
+        while (self->tx_task) {
+            vTaskDelay(1);
+        }
+        MP_THREAD_GIL_ENTER();
+    }
+}
+
+static void uart_frame_mode_stop (mach_uart_obj_t *self) {
+    if (self->frame_task) {
+        self->frame_stop = true;
+        MP_THREAD_GIL_EXIT();
+        while (self->frame_task) {
+            vTaskDelay(1);
+        }
+        MP_THREAD_GIL_ENTER();
+    }
+    if (self->frames) {
+        vRingbufferDelete(self->frames);
+        self->frames = NULL;
+    }
+    if (self->frame_buf) {
+        heap_caps_free(self->frame_buf);
+        self->frame_buf = NULL;
+    }
+    self->frame_idle = 0;
+    self->frame_end_len = 0;
+    self->frame_len = 0;
+    // back to the read() timeout
+    if (self->init) {
+        self->uart_reg->conf1.rx_tout_thrhd = self->rx_timeout & UART_RX_TOUT_THRHD_V;
+    }
+}
+
 // waits at most timeout microseconds for at least 1 char to become ready for
 // reading (from buf or for direct reading).
 // returns true if something available, false if not.
@@ -381,7 +580,24 @@ STATIC mp_obj_t mach_uart_init_helper(mach_uart_obj_t *self, const mp_arg_val_t
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "invalid RX buffer size, should be > 128 bytes"));
     }
 
+    // a TX buffer is optional, without it the FIFO is filled by the caller
+    int tx_buffer_size = args[7].u_int;
+    if (tx_buffer_size != 0 && !(tx_buffer_size > UART_FIFO_LEN)) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "invalid TX buffer size, should be 0 or > 128 bytes"));
+    }
+
+    // number of bytes in the RX FIFO that wakes up the driver, lower it for high baudrates
+    uint32_t rx_threshold = args[8].u_int;
+    if (rx_threshold < 1 || rx_threshold >= UART_FIFO_LEN) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "invalid RX threshold, should be 1 to 127 bytes"));
+    }
+
     if (self->config.baud_rate > 0) {
+        // frame mode and the TX done task use the driver, they must be stopped before
+        uart_frame_mode_stop(self);
+        uart_tx_done_stop(self);
+        // let the TX ring drain, what is left is lost
+        uart_wait_tx_done(self->uart_id, MACHUART_TX_WAIT_MS / portTICK_PERIOD_MS);
         // uninstall the driver
         uart_driver_delete(self->uart_id);
     }
@@ -421,6 +637,15 @@ STATIC mp_obj_t mach_uart_init_helper(mach_uart_obj_t *self, const mp_arg_val_t
         uart_assign_pins_af (self, pins, n_pins);
     }
 
+    // in RS485 mode the RTS pin is driven by the driver, only while transmitting
+    self->rs485 = args[9].u_bool;
+    if (self->rs485) {
+        if (!self->pins[PIN_TYPE_UART_RTS] || (flowcontrol & UART_HW_FLOWCTRL_CTS)) {
+            goto error;
+        }
+        flowcontrol = UART_HW_FLOWCTRL_DISABLE;
+    }
+
     self->rx_timeout = args[5].u_int;
 
     self->base.type = &mach_uart_type;
@@ -433,7 +658,18 @@ STATIC mp_obj_t mach_uart_init_helper(mach_uart_obj_t *self, const mp_arg_val_t
     uart_param_config(self->uart_id, &self->config);
 
     // install the UART driver
-    uart_driver_install(self->uart_id, rx_buffer_size, 0, 0, NULL, 0, UARTRxCallback);
+    // the events are only read to count the RX overflows, a full queue loses events but never data
+    self->events = NULL;
+    self->rx_overflows = 0;
+    uart_driver_install(self->uart_id, rx_buffer_size, tx_buffer_size, MACHUART_EVENT_QUEUE_LEN, &self->events, 0, UARTRxCallback);
+    self->tx_buffered = (tx_buffer_size > 0);
+    if (self->rs485) {
+        uart_set_mode(self->uart_id, UART_MODE_RS485_HALF_DUPLEX);
+    }
+
+    // configure the rx FIFO threshold
+    self->rx_threshold = rx_threshold;
+    self->uart_reg->conf1.rxfifo_full_thrhd = rx_threshold & UART_RXFIFO_FULL_THRHD_V;
 
     // disable the delay between transfers
     self->uart_reg->idle_conf.tx_idle_num = 0;
@@ -458,7 +694,10 @@ STATIC const mp_arg_t mach_uart_init_args[] = {
     { MP_QSTR_stop,                            MP_ARG_OBJ,  {.u_obj = mp_const_none} },
     { MP_QSTR_pins,           MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = MP_OBJ_NULL} },
     { MP_QSTR_timeout_chars,  MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = 2} },
-    { MP_QSTR_rx_buffer_size, MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACHUART_RX_BUFFER_LEN} }
+    { MP_QSTR_rx_buffer_size, MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACHUART_RX_BUFFER_LEN} },
+    { MP_QSTR_tx_buffer_size, MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACHUART_TX_BUFFER_LEN} },
+    { MP_QSTR_rx_threshold,   MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACHUART_RX_THRESHOLD_DEFAULT} },
+    { MP_QSTR_rs485,          MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} }
 };
 STATIC mp_obj_t mach_uart_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
     // parse args
@@ -501,12 +740,18 @@ STATIC mp_obj_t mach_uart_deinit(mp_obj_t self_in) {
     mach_uart_obj_t *self = self_in;
 
     if (self->config.baud_rate > 0) {
+        uart_frame_mode_stop(self);
+        uart_tx_done_stop(self);
+        // let the TX ring drain, what is left is lost
+        uart_wait_tx_done(self->uart_id, MACHUART_TX_WAIT_MS / portTICK_PERIOD_MS);
         // invalidate the baudrate
         self->config.baud_rate = 0;
         // detach the pins
         uart_deassign_pins_af(self);
-        // uninstall the driver
+        // uninstall the driver, it also deletes the event queue
         uart_driver_delete(self->uart_id);
+        self->events = NULL;
+        self->tx_buffered = false;
     }
 
     self->init = false;
@@ -522,6 +767,174 @@ STATIC mp_obj_t mach_uart_any(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_uart_any_obj, mach_uart_any);
 
+STATIC mp_obj_t mach_uart_rx_overflows(mp_obj_t self_in) {
+    mach_uart_obj_t *self = self_in;
+    MACH_UART_CHECK_INIT(self)
+    uart_rx_check_events(self);
+    return mp_obj_new_int_from_uint(self->rx_overflows);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_uart_rx_overflows_obj, mach_uart_rx_overflows);
+
+/// \method frame_mode(*, idle, end, max_size, buffer)
+/// Received bytes are grouped in frames, closed after idle character times without data
+/// and/or after the end bytes. Without idle nor end the frame mode is stopped.
+STATIC mp_obj_t mach_uart_frame_mode(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_idle,           MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_end,            MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_max_size,       MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACHUART_FRAME_SIZE_DEFAULT} },
+        { MP_QSTR_buffer,         MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = MACHUART_FRAME_BUFFER_DEFAULT} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    mach_uart_obj_t *self = pos_args[0];
+    MACH_UART_CHECK_INIT(self)
+
+    uart_frame_mode_stop(self);
+    if (args[0].u_obj == mp_const_none && args[1].u_obj == mp_const_none) {
+        return mp_const_none;
+    }
+
+    mp_int_t idle = 0;
+    if (args[0].u_obj != mp_const_none) {
+        idle = mp_obj_get_int(args[0].u_obj);
+        if (idle < 1 || idle > UART_RX_TOUT_THRHD_V) {
+            goto error;
+        }
+    }
+    mp_buffer_info_t end = { .len = 0 };
+    if (args[1].u_obj != mp_const_none) {
+        mp_get_buffer_raise(args[1].u_obj, &end, MP_BUFFER_READ);
+        if (end.len < 1 || end.len > MACHUART_FRAME_END_MAX) {
+            goto error;
+        }
+    }
+    // a frame must hold at least the terminator, a frame and its ring header must fit in the buffer
+    if (args[2].u_int < MACHUART_FRAME_END_MAX || args[3].u_int < args[2].u_int + 16) {
+        goto error;
+    }
+
+    self->frame_max = args[2].u_int;
+    self->frame_buf = heap_caps_malloc(self->frame_max, MALLOC_CAP_8BIT);
+    self->frames = xRingbufferCreate(args[3].u_int, RINGBUF_TYPE_NOSPLIT);
+    if (!self->frame_buf || !self->frames) {
+        uart_frame_mode_stop(self);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "cannot allocate the frame buffers"));
+    }
+    self->frame_idle = idle;
+    memcpy(self->frame_end, end.buf, end.len);
+    self->frame_end_len = end.len;
+    self->frames_dropped = 0;
+    if (idle > 0) {
+        self->uart_reg->conf1.rx_tout_thrhd = idle;
+    }
+
+    // the bytes received before belong to no frame
+    uart_flush_input(self->uart_id);
+    xQueueReset(self->events);
+    self->frame_stop = false;
+    if (pdPASS != xTaskCreatePinnedToCore(TASK_UART_FRAMES, "UARTFrames", MACHUART_FRAME_TASK_STACK_SIZE / sizeof(StackType_t),
+                                          self, MACHUART_FRAME_TASK_PRIORITY, &self->frame_task, 1)) {
+        self->frame_task = NULL;
+        uart_frame_mode_stop(self);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "cannot start the frame task"));
+    }
+
+    return mp_const_none;
+
+error:
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_uart_frame_mode_obj, 1, mach_uart_frame_mode);
+
+/// \method read_frame([timeout_ms])
+/// Returns the oldest complete frame, or None if none arrives within timeout_ms.
+STATIC mp_obj_t mach_uart_read_frame(mp_uint_t n_args, const mp_obj_t *args) {
+    mach_uart_obj_t *self = args[0];
+    MACH_UART_CHECK_INIT(self)
+    if (!self->frame_task) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    TickType_t timeout_ticks = 0;
+    if (n_args > 1) {
+        timeout_ticks = mp_obj_get_int(args[1]) / portTICK_PERIOD_MS;
+    }
+
+    size_t len = 0;
+    MP_THREAD_GIL_EXIT();
+    uint8_t *frame = xRingbufferReceive(self->frames, &len, timeout_ticks);
+    MP_THREAD_GIL_ENTER();
+    if (!frame) {
+        return mp_const_none;
+    }
+    mp_obj_t frame_o = mp_obj_new_bytes(frame, len);
+    vRingbufferReturnItem(self->frames, frame);
+    return frame_o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mach_uart_read_frame_obj, 1, 2, mach_uart_read_frame);
+
+/// \method frames_dropped()
+/// Frames lost because the frame buffer was full.
+STATIC mp_obj_t mach_uart_frames_dropped(mp_obj_t self_in) {
+    mach_uart_obj_t *self = self_in;
+    MACH_UART_CHECK_INIT(self)
+    return mp_obj_new_int_from_uint(self->frames_dropped);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_uart_frames_dropped_obj, mach_uart_frames_dropped);
+
+/// \method callback(trigger, handler, arg, *, hard=False)
+STATIC mp_obj_t mach_uart_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_trigger,      MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_handler,      MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_arg,          MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_hard,         MP_ARG_KW_ONLY | MP_ARG_BOOL,   {.u_bool = false} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    mach_uart_obj_t *self = pos_args[0];
+
+    MACH_UART_CHECK_INIT(self)
+
+    // enable the callback
+    if (args[0].u_obj != mp_const_none && args[1].u_obj != mp_const_none) {
+        self->trigger = mp_obj_get_int(args[0].u_obj);
+        self->hard = args[3].u_bool;
+        self->handler = args[1].u_obj;
+        mp_irq_add(self, args[1].u_obj);
+        if (args[2].u_obj == mp_const_none) {
+            self->handler_arg = self;
+        } else {
+            self->handler_arg = args[2].u_obj;
+        }
+    } else {
+        self->trigger = 0;
+        self->hard = false;
+        mp_irq_remove(self);
+        INTERRUPT_OBJ_CLEAN(self);
+    }
+
+    if (self->trigger & UART_TRIGGER_TX_DONE) {
+        if (!self->tx_task) {
+            self->tx_stop = false;
+            if (pdPASS != xTaskCreatePinnedToCore(TASK_UART_TX, "UARTTx", MACHUART_TX_TASK_STACK_SIZE / sizeof(StackType_t),
+                                                  self, MACHUART_TX_TASK_PRIORITY, &self->tx_task, 1)) {
+                self->tx_task = NULL;
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "cannot start the TX task"));
+            }
+        }
+    } else {
+        uart_tx_done_stop(self);
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_uart_callback_obj, 1, mach_uart_callback);
+
 STATIC mp_obj_t mach_uart_wait_tx_done(mp_obj_t self_in, mp_obj_t timeout_ms) {
     mach_uart_obj_t *self = self_in;
     MACH_UART_CHECK_INIT(self)
@@ -585,6 +998,11 @@ STATIC const mp_map_elem_t mach_uart_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_any),             (mp_obj_t)&mach_uart_any_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_wait_tx_done),    (mp_obj_t)&mach_uart_wait_tx_done_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sendbreak),       (mp_obj_t)&mach_uart_sendbreak_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rx_overflows),    (mp_obj_t)&mach_uart_rx_overflows_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_frame_mode),      (mp_obj_t)&mach_uart_frame_mode_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read_frame),      (mp_obj_t)&mach_uart_read_frame_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_frames_dropped),  (mp_obj_t)&mach_uart_frames_dropped_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_callback),        (mp_obj_t)&mach_uart_callback_obj },
 //    { MP_OBJ_NEW_QSTR(MP_QSTR_irq),         (mp_obj_t)&pyb_uart_irq_obj },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_read),            (mp_obj_t)&mp_stream_read_obj },
@@ -595,6 +1013,8 @@ STATIC const mp_map_elem_t mach_uart_locals_dict_table[] = {
     // class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_EVEN),            MP_OBJ_NEW_SMALL_INT(UART_PARITY_EVEN) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ODD),             MP_OBJ_NEW_SMALL_INT(UART_PARITY_ODD) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RX_FRAME),        MP_OBJ_NEW_SMALL_INT(UART_TRIGGER_RX_FRAME) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TX_DONE),         MP_OBJ_NEW_SMALL_INT(UART_TRIGGER_TX_DONE) },
     // { MP_OBJ_NEW_QSTR(MP_QSTR_RX_ANY),      MP_OBJ_NEW_SMALL_INT(2) },
 };
 STATIC MP_DEFINE_CONST_DICT(mach_uart_locals_dict, mach_uart_locals_dict_table);
@@ -609,6 +1029,12 @@ STATIC mp_uint_t mach_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t size,
         return 0;
     }
 
+    // the bytes belong to the frame task
+    if (self->frame_task) {
+        *errcode = MP_EPERM;
+        return MP_STREAM_ERROR;
+    }
+
     // wait for first char to become available
     if (!uart_rx_wait(self)) {
         // return EAGAIN error to indicate non-blocking (then read() method returns None)
@@ -616,11 +1042,16 @@ STATIC mp_uint_t mach_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t size,
         return MP_STREAM_ERROR;
     }
 
-    // read the data
+    // copy whatever the driver's ring buffer holds straight into the caller's buffer
     byte *orig_buf = buf;
     for ( ; ; ) {
-        *buf++ = uart_rx_char(self);
-        if (--size == 0 || !uart_rx_wait(self)) {
+        size_t avail = MIN(uart_rx_any(self), size);
+        int32_t len = uart_read_bytes(self->uart_id, buf, avail, 0);
+        if (len > 0) {
+            buf += len;
+            size -= len;
+        }
+        if (size == 0 || !uart_rx_wait(self)) {
             // return number of bytes read
             return buf - orig_buf;
         }
@@ -633,9 +1064,21 @@ STATIC mp_uint_t mach_uart_write(mp_obj_t self_in, const void *buf_in, mp_uint_t
     const char *buf = buf_in;
 
     // write the data
-    if (!uart_tx_strn(self, buf, size)) {
+    bool ok;
+    if (self->tx_buffered && self->n_pins != 1) {
+        // returns as soon as the data is in the TX ring, only waits if it is full
+        MP_THREAD_GIL_EXIT();
+        ok = uart_write_bytes(self->uart_id, buf, size) == size;
+        MP_THREAD_GIL_ENTER();
+    } else {
+        ok = uart_tx_strn(self, buf, size);
+    }
+    if (!ok) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
+    if (self->tx_task) {
+        xTaskNotifyGive(self->tx_task);
+    }
     return size;
 }
 
@@ -650,7 +1093,7 @@ STATIC mp_uint_t mach_uart_ioctl(mp_obj_t self_in, mp_uint_t request, mp_uint_t
         if ((flags & MP_STREAM_POLL_RD) && uart_rx_any(self)) {
             ret |= MP_STREAM_POLL_RD;
         }
-        if ((flags & MP_STREAM_POLL_WR) && uart_tx_fifo_space(self)) {
+        if ((flags & MP_STREAM_POLL_WR) && uart_tx_space(self)) {
             ret |= MP_STREAM_POLL_WR;
         }
     } else {
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/mpstate.h"
+#include "py/runtime.h"
+#include "py/obj.h"
+
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_clk.h"
+#include "rom/ets_sys.h"
+#include "soc/soc.h"
+#include "soc/rtc.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/sens_reg.h"
+
+#include "mpexception.h"
+#include "machulp.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// the start of the RTC slow memory, kept out of the linker's hands by CONFIG_ULP_COPROC_RESERVE_MEM
+#define MACH_ULP_MEM                                ((volatile uint32_t *)SOC_RTC_DATA_LOW)
+#define MACH_ULP_MEM_WORDS                          (CONFIG_ULP_COPROC_RESERVE_MEM / sizeof(uint32_t))
+
+#define MACH_ULP_BINARY_MAGIC                       (0x00706c75)    // "ulp\0"
+#define MACH_ULP_PERIODS                            (5)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// header of the binaries made by the esp32ulp toolchain
+typedef struct {
+    uint32_t magic;
+    uint16_t text_offset;
+    uint16_t text_size;
+    uint16_t data_size;
+    uint16_t bss_size;
+} mach_ulp_header_t;
+
+typedef struct {
+    mp_obj_base_t base;
+} mach_ulp_obj_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC const mach_ulp_obj_t mach_ulp_obj = {{&mach_ulp_type}};
+// read by the sleep entry, it must not live in flash
+STATIC DRAM_ATTR bool mach_ulp_wake = false;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC uint32_t mach_ulp_addr (mp_obj_t addr_in);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+bool machulp_is_running (void) {
+    return GET_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_ULP_CP_SLP_TIMER_EN) != 0;
+}
+
+uint32_t __real_rtc_sleep_start (uint32_t wakeup_opt, uint32_t reject_opt);
+
+// libesp32 is built without the ULP and esp_sleep_enable_ulp_wakeup() is a no-op there, so the
+// link wraps rtc_sleep_start() to add the ULP trigger to the wake-up sources esp_sleep_start() sets
+IRAM_ATTR uint32_t __wrap_rtc_sleep_start (uint32_t wakeup_opt, uint32_t reject_opt) {
+    if (mach_ulp_wake) {
+        wakeup_opt |= RTC_ULP_TRIG_EN;
+    }
+    return __real_rtc_sleep_start(wakeup_opt, reject_opt);
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC uint32_t mach_ulp_addr (mp_obj_t addr_in) {
+    mp_int_t addr = mp_obj_get_int(addr_in);
+    if (addr < 0 || addr >= MACH_ULP_MEM_WORDS) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "address outside of the ULP memory"));
+    }
+    return addr;
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC mp_obj_t mach_ulp_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    return (mp_obj_t)&mach_ulp_obj;
+}
+
+/// \method set_wakeup_period(period_index, period_us)
+/// Sets one of the 5 periods the ULP timer can start the program with, the `sleep`
+/// instruction of the program picks which one.
+STATIC mp_obj_t mach_ulp_set_wakeup_period(mp_obj_t self_in, mp_obj_t index_in, mp_obj_t period_in) {
+    mp_int_t index = mp_obj_get_int(index_in);
+    mp_int_t period_us = mp_obj_get_int(period_in);
+    if (index < 0 || index >= MACH_ULP_PERIODS || period_us < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    // the calibration is the length of a slow clock cycle in us, Q13.19
+    uint64_t cycles = ((uint64_t)period_us << RTC_CLK_CAL_FRACT) / esp_clk_slowclk_cal_get();
+    if (cycles > SENS_SLEEP_CYCLES_S0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "period too long"));
+    }
+    REG_SET_FIELD(SENS_ULP_CP_SLEEP_CYC0_REG + index * sizeof(uint32_t), SENS_SLEEP_CYCLES_S0, (uint32_t)cycles);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mach_ulp_set_wakeup_period_obj, mach_ulp_set_wakeup_period);
+
+/// \method load_binary(load_addr, program)
+/// Copies a program made by the esp32ulp toolchain to the word address load_addr of the
+/// ULP memory and clears its bss.
+STATIC mp_obj_t mach_ulp_load_binary(mp_obj_t self_in, mp_obj_t addr_in, mp_obj_t program_in) {
+    uint32_t addr = mach_ulp_addr(addr_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(program_in, &bufinfo, MP_BUFFER_READ);
+
+    mach_ulp_header_t header;
+    if (bufinfo.len < sizeof(header)) {
+        goto invalid;
+    }
+    memcpy(&header, bufinfo.buf, sizeof(header));
+    uint32_t size = header.text_size + header.data_size;
+    if (header.magic != MACH_ULP_BINARY_MAGIC || header.text_offset < sizeof(header) ||
+        header.text_offset + size > bufinfo.len || (size % sizeof(uint32_t)) != 0) {
+        goto invalid;
+    }
+    uint32_t words = (size + header.bss_size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    if (addr + words > MACH_ULP_MEM_WORDS) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "program too big for the ULP memory"));
+    }
+
+    // the RTC slow memory only takes 32 bit writes
+    const byte *src = (const byte *)bufinfo.buf + header.text_offset;
+    uint32_t i = 0;
+    for (; i < size / sizeof(uint32_t); i++) {
+        uint32_t word;
+        memcpy(&word, src + i * sizeof(uint32_t), sizeof(word));
+        MACH_ULP_MEM[addr + i] = word;
+    }
+    for (; i < words; i++) {
+        MACH_ULP_MEM[addr + i] = 0;
+    }
+    return mp_const_none;
+
+invalid:
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid ULP binary"));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mach_ulp_load_binary_obj, mach_ulp_load_binary);
+
+/// \method run(entry_point)
+/// Starts the ULP timer, which runs the program from the word address entry_point every
+/// time the period chosen by the program elapses. It keeps running in deep sleep.
+STATIC mp_obj_t mach_ulp_run(mp_obj_t self_in, mp_obj_t entry_in) {
+    uint32_t entry = mach_ulp_addr(entry_in);
+
+    CLEAR_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_ULP_CP_SLP_TIMER_EN);
+    // at least one slow clock cycle
+    ets_delay_us(10);
+    REG_SET_FIELD(SENS_SAR_START_FORCE_REG, SENS_PC_INIT, entry);
+    CLEAR_PERI_REG_MASK(SENS_SAR_START_FORCE_REG, SENS_ULP_CP_FORCE_START_TOP_M);
+    // raise the voltage while the 8MHz clock the ULP runs from is enabled
+    SET_PERI_REG_MASK(RTC_CNTL_OPTIONS0_REG, RTC_CNTL_BIAS_I2C_FOLW_8M);
+    SET_PERI_REG_MASK(RTC_CNTL_OPTIONS0_REG, RTC_CNTL_BIAS_CORE_FOLW_8M);
+    SET_PERI_REG_MASK(RTC_CNTL_OPTIONS0_REG, RTC_CNTL_BIAS_SLEEP_FOLW_8M);
+    SET_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_ULP_CP_SLP_TIMER_EN);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_ulp_run_obj, mach_ulp_run);
+
+/// \method stop()
+/// Stops the ULP timer, the program isn't started again.
+STATIC mp_obj_t mach_ulp_stop(mp_obj_t self_in) {
+    CLEAR_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_ULP_CP_SLP_TIMER_EN);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mach_ulp_stop_obj, mach_ulp_stop);
+
+/// \method read(addr)
+/// Reads the variable at the word address addr, the ULP only stores the lower 16 bits.
+STATIC mp_obj_t mach_ulp_read(mp_obj_t self_in, mp_obj_t addr_in) {
+    return mp_obj_new_int(MACH_ULP_MEM[mach_ulp_addr(addr_in)] & 0xFFFF);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_ulp_read_obj, mach_ulp_read);
+
+/// \method write(addr, value)
+/// Writes a variable for the program to read, e.g. a threshold.
+STATIC mp_obj_t mach_ulp_write(mp_obj_t self_in, mp_obj_t addr_in, mp_obj_t value_in) {
+    MACH_ULP_MEM[mach_ulp_addr(addr_in)] = mp_obj_get_int_truncated(value_in) & 0xFFFF;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mach_ulp_write_obj, mach_ulp_write);
+
+/// \method wake_on(enable)
+/// Lets the `wake` instruction of the program wake the main CPU from light and deep sleep.
+STATIC mp_obj_t mach_ulp_wake_on(mp_obj_t self_in, mp_obj_t enable_in) {
+    mach_ulp_wake = mp_obj_is_true(enable_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mach_ulp_wake_on_obj, mach_ulp_wake_on);
+
+STATIC const mp_map_elem_t mach_ulp_locals_dict_table[] = {
+    // instance methods
+    { MP_OBJ_NEW_QSTR(MP_QSTR_set_wakeup_period),   (mp_obj_t)&mach_ulp_set_wakeup_period_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_load_binary),         (mp_obj_t)&mach_ulp_load_binary_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_run),                 (mp_obj_t)&mach_ulp_run_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stop),                (mp_obj_t)&mach_ulp_stop_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read),                (mp_obj_t)&mach_ulp_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write),               (mp_obj_t)&mach_ulp_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_wake_on),             (mp_obj_t)&mach_ulp_wake_on_obj },
+
+    // class constants
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MEM_WORDS),           MP_OBJ_NEW_SMALL_INT(MACH_ULP_MEM_WORDS) },
+};
+STATIC MP_DEFINE_CONST_DICT(mach_ulp_locals_dict, mach_ulp_locals_dict_table);
+
+const mp_obj_type_t mach_ulp_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_ULP,
+    .make_new = mach_ulp_make_new,
+    .locals_dict = (mp_obj_t)&mach_ulp_locals_dict,
+};
@@ -30,6 +30,7 @@
 #include "driver/timer.h"
 
 #include "machwdt.h"
+#include "mptaskmon.h"
 
 
 /******************************************************************************
@@ -127,6 +128,10 @@ STATIC mp_obj_t mach_wdt_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mach_wdt_init_obj, 1, mach_wdt_init);
 
 STATIC mp_obj_t mach_wdt_feed (mp_obj_t self_in) {
+    // with the guard on, a stuck internal task lets the watchdog reset the device
+    if (mptaskmon_get_guard() && !mptaskmon_healthy()) {
+        return mp_const_none;
+    }
     TIMERG0.wdt_wprotect = TIMG_WDT_WKEY_VALUE;
     TIMERG0.wdt_feed = 1;
     TIMERG0.wdt_wprotect = 0;
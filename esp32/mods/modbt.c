@@ -33,6 +33,7 @@
 #include "antenna.h"
 
 #include "esp_bt.h"
+#include "esp_coexist.h"
 #include "common/bt_trace.h"
 #include "stack/bt_types.h"
 #include "stack/btm_api.h"
@@ -49,6 +50,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 
 #include "lwip/opt.h"
 #include "lwip/def.h"
@@ -60,9 +62,37 @@
  DEFINE PRIVATE CONSTANTS
  ******************************************************************************/
 #define BT_SCAN_QUEUE_SIZE_MAX                              (16)
+// advertisements kept by the scan ring, the larger default is used when PSRAM is available
+#define BT_SCAN_RING_SIZE_DEFAULT                           (16)
+#define BT_SCAN_RING_SIZE_PSRAM                             (512)
+#define BT_SCAN_RING_SIZE_MAX                               (4096)
+#define BT_SCAN_ADV_DATA_LEN_MAX                            (ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX)
+// devices remembered for the duplicate suppression
+#define BT_SCAN_DEDUP_SIZE                                  (64)
+#define BT_SCAN_MAC_PREFIX_LEN_MAX                          (6)
+#define BT_SCAN_RSSI_NONE                                   (-128)
+// mac, addr_type, rssi and data_len in front of the data of every packed advertisement
+#define BT_SCAN_PACKED_HEADER_LEN                           (ESP_BD_ADDR_LEN + 3)
 #define BT_GATTS_QUEUE_SIZE_MAX                             (2)
-#define BT_MTU_SIZE_MAX                                     (200)
-#define BT_CHAR_VALUE_SIZE_MAX                              (BT_MTU_SIZE_MAX - 3)
+// scan interval and window limits, in units of 0.625 ms
+#define BT_SCAN_INTERVAL_MIN                                (0x0004)
+#define BT_SCAN_INTERVAL_MAX                                (0x4000)
+#define BT_SCAN_TIME_UNIT_US                                (625)
+#define BT_GATTS_TIMEOUT_MS                                 (2500)
+// characteristic events waiting to be delivered to the Python callbacks
+#define BT_GATTS_EVENT_QUEUE_SIZE_DEFAULT                   (16)
+#define BT_GATTS_EVENT_QUEUE_SIZE_MAX                       (256)
+#define BT_MTU_SIZE_DEFAULT                                 (200)
+#define BT_MTU_SIZE_MAX                                     (ESP_GATT_MAX_MTU_SIZE)
+// characteristic values are sized per characteristic, up to the ATT limit
+#define BT_CHAR_VALUE_SIZE_DEFAULT                          (BT_MTU_SIZE_DEFAULT - 3)
+#define BT_CHAR_VALUE_SIZE_MAX                              (512)
+// LE data length extension (BLE 4.2), payload octets of a link layer packet
+#define BT_DATA_LENGTH_MIN                                  (27)
+#define BT_DATA_LENGTH_MAX                                  (251)
+// notification stream: bytes buffered in C and notifications in flight at once
+#define BT_STREAM_RING_SIZE                                 (4096)
+#define BT_STREAM_CREDITS_MAX                               (8)
 
 #define MOD_BT_CLIENT_APP_ID                                (0)
 #define MOD_BT_SERVER_APP_ID                                (1)
@@ -78,6 +108,14 @@
 #define MOD_BT_GATTC_MTU_EVT                                (0x0100)
 #define MOD_BT_GATTS_MTU_EVT                                (0x0200)
 #define MOD_BT_GATTS_CLOSE_EVT                              (0x0400)
+#define MOD_BT_GATTS_STREAM_EVT                             (0x0800)
+// completion of the asynchronous GATTC operations, same values as CHAR_READ_EVENT / CHAR_WRITE_EVENT
+#define MOD_BT_GATTC_READ_EVT                               (MOD_BT_GATTS_READ_EVT)
+#define MOD_BT_GATTC_WRITE_EVT                              (MOD_BT_GATTS_WRITE_EVT)
+// a GATTC characteristic index starts with this many slots and doubles when half full
+#define MOD_BT_CHAR_INDEX_SIZE_MIN                          (16)
+// same for the index of the GATTS attributes (characteristics and descriptors)
+#define MOD_BT_ATTR_INDEX_SIZE_MIN                          (32)
 #define MOD_BT_NVS_NAMESPACE                                "BT_NVS"
 #define MOD_BT_HASH_SIZE                                    (20)
 #define MOD_BT_PIN_LENGTH                                   (6)
@@ -88,7 +126,10 @@
 typedef struct {
     mp_obj_base_t         base;
     int32_t               scan_duration;
-    uint8_t               gatts_mtu;
+    uint16_t              gatts_mtu;
+    uint16_t              data_length;      // requested on every new connection
+    uint16_t              data_length_tx;   // last negotiated values
+    uint16_t              data_length_rx;
     mp_obj_t              handler;
     mp_obj_t              handler_arg;
     esp_bd_addr_t         client_bda;
@@ -112,6 +153,9 @@ typedef struct {
     int32_t               conn_id;
     uint16_t              mtu;
     esp_gatt_if_t         gatt_if;
+    struct _bt_char_obj_t **char_index;     // characteristics hashed by handle, open addressing
+    uint16_t              char_index_size;  // power of 2
+    uint16_t              char_index_count;
 } bt_connection_obj_t;
 
 typedef struct {
@@ -134,7 +178,7 @@ typedef struct {
     esp_gatt_char_prop_t    char_prop;
 } bt_char_t;
 
-typedef struct {
+typedef struct _bt_char_obj_t {
     mp_obj_base_t           base;
     bt_srv_obj_t            *service;
     esp_gattc_char_elem_t   characteristic;
@@ -143,7 +187,10 @@ typedef struct {
     uint32_t                trigger;
     uint32_t                events;
     uint16_t                value_len;
-    uint8_t                 value[BT_CHAR_VALUE_SIZE_MAX];
+    uint16_t                value_size;
+    uint8_t                 *value;
+    uint32_t                pending;    // asynchronous operation in flight
+    esp_gatt_status_t       status;     // of the last asynchronous operation
     // mp_obj_list_t         desc_list;
 } bt_char_obj_t;
 
@@ -172,7 +219,6 @@ typedef struct {
 } bt_register_for_notify_event_t;
 
 typedef union {
-    esp_ble_gap_cb_param_t          scan;
     bt_srv_t                        service;
     bt_read_value_t                 read;
     bt_write_value_t                write;
@@ -200,7 +246,8 @@ typedef struct {
     uint32_t              properties;
     uint16_t              handle;
     uint16_t              value_len;
-    uint8_t               value[BT_CHAR_VALUE_SIZE_MAX];
+    uint16_t              value_size;
+    uint8_t               *value;
     bool                  is_char;
 } bt_gatts_attr_obj_t;
 
@@ -227,6 +274,67 @@ typedef struct {
     uint8_t* data;
 } char_cbk_arg_t;
 
+// radio time used by the scans, split between BT and WiFi from the scan duty cycle
+typedef struct {
+    esp_coex_prefer_t   prefer;
+    uint32_t            scan_start;     // tick count when the current scan started, 0 if idle
+    uint16_t            scan_interval;  // parameters of the current scan
+    uint16_t            scan_window;
+    uint64_t            scan_ms;
+    uint64_t            bt_ms;
+} bt_coex_t;
+
+typedef struct {
+    esp_bd_addr_t   bda;
+    uint8_t         addr_type;
+    uint8_t         adv_type;
+    int8_t          rssi;
+    uint8_t         data_len;       // advertisement + scan response length
+    uint8_t         data[BT_SCAN_ADV_DATA_LEN_MAX];
+} bt_scan_adv_t;
+
+typedef struct {
+    esp_bd_addr_t   bda;
+    uint8_t         adv_type;
+    TickType_t      last_seen;
+    bool            used;
+} bt_scan_dedup_t;
+
+// filters applied by the GAP handler before storing an advertisement
+typedef struct {
+    uint8_t         mac_prefix[BT_SCAN_MAC_PREFIX_LEN_MAX];
+    uint8_t         mac_prefix_len;
+    esp_bt_uuid_t   service_uuid;   // len 0: no service filter
+    int32_t         manufacturer;   // -1: no manufacturer filter
+    int8_t          rssi;           // weakest rssi accepted
+    uint32_t        dedup_window;   // ms, 0: report every advertisement
+} bt_scan_filter_t;
+
+typedef struct {
+    bt_scan_adv_t       *advs;
+    SemaphoreHandle_t   mutex;
+    uint32_t            size;
+    uint32_t            head;       // free running write index
+    uint32_t            tail;       // free running read index
+    uint32_t            received;
+    uint32_t            filtered;
+    uint32_t            duplicates;
+    uint32_t            dropped;    // advertisements lost because the ring was full
+    bt_scan_filter_t    filter;
+    bt_scan_dedup_t     dedup[BT_SCAN_DEDUP_SIZE];
+} bt_scan_ring_t;
+
+// data streamed as notifications of a characteristic, sent from the BT task
+typedef struct {
+    uint8_t                 *buf;
+    SemaphoreHandle_t       mutex;
+    bt_gatts_char_obj_t     *chr;
+    uint32_t                head;       // free running write index
+    uint32_t                tail;       // free running read index
+    uint8_t                 credits;    // notifications the controller can still take
+    bool                    congested;
+} bt_stream_t;
+
 
 /******************************************************************************
  DECLARE PRIVATE DATA
@@ -234,6 +342,16 @@ typedef struct {
 static volatile bt_obj_t bt_obj;
 static QueueHandle_t xScanQueue;
 static QueueHandle_t xGattsQueue;
+static QueueHandle_t xGattsEventQueue;
+static uint32_t bt_gatts_event_queue_size;
+static volatile uint32_t bt_gatts_event_overflow;
+static bt_scan_ring_t bt_scan_ring;
+static bt_stream_t bt_stream;
+static bt_coex_t bt_coex = {.prefer = ESP_COEX_PREFER_BALANCE};
+static SemaphoreHandle_t bt_char_index_mutex;
+static bt_gatts_attr_obj_t **bt_attr_index;
+static uint16_t bt_attr_index_size;
+static uint16_t bt_attr_index_count;
 
 static esp_ble_adv_data_t adv_data;
 static esp_ble_adv_data_t scan_rsp_data;
@@ -272,6 +390,7 @@ static bool mod_bt_is_conn_restore_available;
 static nvs_handle modbt_nvs_handle;
 static uint8_t tx_pwr_level_to_dbm[] = {-12, -9, -6, -3, 0, 3, 6, 9};
 static EventGroupHandle_t bt_event_group;
+static bool bt_resources_init;
 static uint16_t bt_conn_mtu = 0;
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
@@ -288,31 +407,54 @@ STATIC void gatts_char_callback_handler(void *arg);
 static mp_obj_t modbt_start_scan(mp_obj_t timeout);
 static mp_obj_t modbt_conn_disconnect(mp_obj_t self_in);
 static mp_obj_t modbt_connect(mp_obj_t addr);
+static bool bt_scan_ring_alloc(uint32_t size);
+static void bt_scan_ring_flush(void);
+static void bt_scan_ring_put(struct ble_scan_result_evt_param *scan_rst);
+static bool bt_scan_ring_get(bt_scan_adv_t *adv);
+static uint32_t bt_scan_ring_get_packed(uint8_t *buf, uint32_t len);
+static void gatts_attr_index_free(void);
+static void gatts_char_event_flush(void);
+static void bt_coex_scan_stop(void);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
+static void modbt_reset_resources(void) {
+    bt_gatts_event_overflow = 0;
+    memset(&bt_scan_ring.filter, 0, sizeof(bt_scan_ring.filter));
+    bt_scan_ring.filter.manufacturer = -1;
+    bt_scan_ring.filter.rssi = BT_SCAN_RSSI_NONE;
+}
+
+// queues and buffers are only created once Bluetooth is used (or on boot, see mptask.c)
+void modbt_init_resources(void) {
+    if (bt_resources_init) {
+        return;
+    }
+    xScanQueue = xQueueCreate(BT_SCAN_QUEUE_SIZE_MAX, sizeof(bt_event_result_t));
+    xGattsQueue = xQueueCreate(BT_GATTS_QUEUE_SIZE_MAX, sizeof(bt_gatts_event_result_t));
+    bt_gatts_event_queue_size = BT_GATTS_EVENT_QUEUE_SIZE_DEFAULT;
+    xGattsEventQueue = xQueueCreate(bt_gatts_event_queue_size, sizeof(char_cbk_arg_t *));
+    bt_char_index_mutex = xSemaphoreCreateMutex();
+    bt_scan_ring.mutex = xSemaphoreCreateMutex();
+    if (!bt_scan_ring_alloc((heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) ? BT_SCAN_RING_SIZE_PSRAM : BT_SCAN_RING_SIZE_DEFAULT)) {
+        bt_scan_ring_alloc(BT_SCAN_RING_SIZE_DEFAULT);
+    }
+    bt_event_group = xEventGroupCreate();
+    bt_resources_init = true;
+    modbt_reset_resources();
+}
+
 void modbt_init0(void) {
-    if (!xScanQueue) {
-        xScanQueue = xQueueCreate(BT_SCAN_QUEUE_SIZE_MAX, sizeof(bt_event_result_t));
-    } else {
+    if (bt_resources_init) {
         xQueueReset(xScanQueue);
-    }
-    if (!xGattsQueue) {
-        xGattsQueue = xQueueCreate(BT_GATTS_QUEUE_SIZE_MAX, sizeof(bt_gatts_event_result_t));
-    } else {
         xQueueReset(xGattsQueue);
-    }
-    if(!bt_event_group)
-    {
-        bt_event_group = xEventGroupCreate();
-    }
-    else
-    {
+        gatts_char_event_flush();
+        bt_scan_ring_flush();
         //Using only specific events in group for now
         xEventGroupClearBits(bt_event_group, MOD_BT_GATTC_MTU_EVT | MOD_BT_GATTS_MTU_EVT | MOD_BT_GATTS_DISCONN_EVT | MOD_BT_GATTS_CLOSE_EVT);
+        modbt_reset_resources();
     }
-    bt_event_group = xEventGroupCreate();
 
     if (bt_obj.init) {
         esp_ble_gattc_app_unregister(MOD_BT_CLIENT_APP_ID);
@@ -322,6 +464,7 @@ void modbt_init0(void) {
     mp_obj_list_init((mp_obj_t)&MP_STATE_PORT(btc_conn_list), 0);
     mp_obj_list_init((mp_obj_t)&MP_STATE_PORT(bts_srv_list), 0);
     mp_obj_list_init((mp_obj_t)&MP_STATE_PORT(bts_attr_list), 0);
+    gatts_attr_index_free();
 
     esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
 
@@ -329,6 +472,10 @@ void modbt_init0(void) {
     mod_bt_is_conn_restore_available = false;
 }
 
+bool modbt_is_enabled(void) {
+    return bt_obj.init;
+}
+
 void modbt_deinit(bool allow_reconnect)
 {
     uint16_t timeout = 0;
@@ -338,6 +485,8 @@ void modbt_deinit(bool allow_reconnect)
             esp_ble_gap_stop_scanning();
             bt_obj.scanning = false;
         }
+        // the stop event may never come once the stack is disabled below
+        bt_coex_scan_stop();
         /* Allow reconnection flag */
         mod_bt_allow_resume_deinit = allow_reconnect;
 
@@ -566,6 +715,50 @@ static void set_secure_parameters(uint32_t passKey){
     esp_ble_gap_set_security_param(ESP_BLE_SM_SET_RSP_KEY, &rsp_key, sizeof(uint8_t));
 }
 
+/*
+ * adds (or replaces) a characteristic in the handle index of its connection
+ */
+static bool char_index_add (bt_connection_obj_t *conn, bt_char_obj_t *chr) {
+    bool ret = true;
+
+    xSemaphoreTake(bt_char_index_mutex, portMAX_DELAY);
+    if ((conn->char_index_count + 1) * 2 > conn->char_index_size) {
+        // grow the table, rehashing the current entries
+        uint16_t size = conn->char_index_size ? conn->char_index_size * 2 : MOD_BT_CHAR_INDEX_SIZE_MIN;
+        bt_char_obj_t **index = heap_caps_calloc(size, sizeof(bt_char_obj_t *), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (index == NULL) {
+            ret = false;
+            goto exit;
+        }
+        for (uint16_t i = 0; i < conn->char_index_size; i++) {
+            bt_char_obj_t *c = conn->char_index[i];
+            if (c) {
+                uint16_t j = c->characteristic.char_handle & (size - 1);
+                while (index[j]) {
+                    j = (j + 1) & (size - 1);
+                }
+                index[j] = c;
+            }
+        }
+        heap_caps_free(conn->char_index);
+        conn->char_index = index;
+        conn->char_index_size = size;
+    }
+
+    uint16_t i = chr->characteristic.char_handle & (conn->char_index_size - 1);
+    while (conn->char_index[i] && conn->char_index[i]->characteristic.char_handle != chr->characteristic.char_handle) {
+        i = (i + 1) & (conn->char_index_size - 1);
+    }
+    if (conn->char_index[i] == NULL) {
+        conn->char_index_count++;
+    }
+    conn->char_index[i] = chr;
+
+exit:
+    xSemaphoreGive(bt_char_index_mutex);
+    return ret;
+}
+
 static void close_connection (int32_t conn_id) {
     for (mp_uint_t i = 0; i < MP_STATE_PORT(btc_conn_list).len; i++) {
         bt_connection_obj_t *connection_obj = ((bt_connection_obj_t *)(MP_STATE_PORT(btc_conn_list).items[i]));
@@ -573,6 +766,21 @@ static void close_connection (int32_t conn_id) {
         if (connection_obj->conn_id == conn_id && (!mod_bt_allow_resume_deinit)) {
             connection_obj->conn_id = -1;
             mp_obj_list_remove((void *)&MP_STATE_PORT(btc_conn_list), connection_obj);
+
+            // the asynchronous operations in flight will never complete
+            xSemaphoreTake(bt_char_index_mutex, portMAX_DELAY);
+            for (uint16_t j = 0; j < connection_obj->char_index_size; j++) {
+                bt_char_obj_t *chr = connection_obj->char_index[j];
+                if (chr && chr->pending) {
+                    chr->pending = 0;
+                    chr->status = ESP_GATT_ERROR;
+                }
+            }
+            heap_caps_free(connection_obj->char_index);
+            connection_obj->char_index = NULL;
+            connection_obj->char_index_size = 0;
+            connection_obj->char_index_count = 0;
+            xSemaphoreGive(bt_char_index_mutex);
         }
     }
 }
@@ -601,34 +809,424 @@ static esp_err_t modem_sleep(bool enable)
 }
 
 static bt_char_obj_t *find_gattc_char (int32_t conn_id, uint16_t char_handle) {
+    bt_char_obj_t *char_obj = NULL;
+
     for (mp_uint_t i = 0; i < MP_STATE_PORT(btc_conn_list).len; i++) {
         // search through the connections
         bt_connection_obj_t *connection_obj = ((bt_connection_obj_t *)(MP_STATE_PORT(btc_conn_list).items[i]));
         if (connection_obj->conn_id == conn_id) {
-            // search through the services
-            for (mp_uint_t j = 0; j < connection_obj->srv_list.len; j++) {
-                // search through the characteristics
-                bt_srv_obj_t *srv_obj = ((bt_srv_obj_t *)(connection_obj->srv_list.items[j]));
-                for (mp_uint_t j = 0; j < srv_obj->char_list.len; j++) {
-                    bt_char_obj_t *char_obj = ((bt_char_obj_t *)(srv_obj->char_list.items[j]));
-                    if (char_obj->characteristic.char_handle == char_handle) {
-                        return char_obj;
+            // then through the handle index of the connection
+            xSemaphoreTake(bt_char_index_mutex, portMAX_DELAY);
+            if (connection_obj->char_index_size > 0) {
+                uint16_t mask = connection_obj->char_index_size - 1;
+                for (uint16_t j = char_handle & mask; connection_obj->char_index[j]; j = (j + 1) & mask) {
+                    if (connection_obj->char_index[j]->characteristic.char_handle == char_handle) {
+                        char_obj = connection_obj->char_index[j];
+                        break;
                     }
                 }
             }
+            xSemaphoreGive(bt_char_index_mutex);
+            break;
         }
     }
-    return NULL;
+    return char_obj;
 }
 
-static bt_gatts_attr_obj_t *find_gatts_attr_by_handle (uint16_t handle) {
+/*
+ * completes an asynchronous read or write, returns false if none was pending on the characteristic
+ */
+static bool gattc_char_async_done (int32_t conn_id, uint16_t char_handle, uint32_t event, esp_gatt_status_t status,
+                                   const uint8_t *value, uint16_t value_len) {
+    bt_char_obj_t *char_obj = find_gattc_char(conn_id, char_handle);
+
+    if (char_obj == NULL || char_obj->pending != event) {
+        return false;
+    }
+    if (status == ESP_GATT_OK && value) {
+        char_obj->value_len = MIN(value_len, char_obj->value_size);
+        memcpy(char_obj->value, value, char_obj->value_len);
+    }
+    char_obj->status = status;
+    char_obj->pending = 0;
+    char_obj->events |= event;
+    if (char_obj->trigger & event) {
+        mp_irq_queue_interrupt_non_ISR(gattc_char_callback_handler, char_obj);
+    }
+    return true;
+}
+
+/*
+ * adds (or replaces) an attribute of a started service in the GATTS handle index
+ */
+static bool gatts_attr_index_add (bt_gatts_attr_obj_t *attr) {
+    bool ret = true;
+
+    xSemaphoreTake(bt_char_index_mutex, portMAX_DELAY);
+    if ((bt_attr_index_count + 1) * 2 > bt_attr_index_size) {
+        // grow the table, rehashing the current entries
+        uint16_t size = bt_attr_index_size ? bt_attr_index_size * 2 : MOD_BT_ATTR_INDEX_SIZE_MIN;
+        bt_gatts_attr_obj_t **index = heap_caps_calloc(size, sizeof(bt_gatts_attr_obj_t *), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (index == NULL) {
+            ret = false;
+            goto exit;
+        }
+        for (uint16_t i = 0; i < bt_attr_index_size; i++) {
+            bt_gatts_attr_obj_t *a = bt_attr_index[i];
+            if (a) {
+                uint16_t j = a->handle & (size - 1);
+                while (index[j]) {
+                    j = (j + 1) & (size - 1);
+                }
+                index[j] = a;
+            }
+        }
+        heap_caps_free(bt_attr_index);
+        bt_attr_index = index;
+        bt_attr_index_size = size;
+    }
+
+    uint16_t i = attr->handle & (bt_attr_index_size - 1);
+    while (bt_attr_index[i] && bt_attr_index[i]->handle != attr->handle) {
+        i = (i + 1) & (bt_attr_index_size - 1);
+    }
+    if (bt_attr_index[i] == NULL) {
+        bt_attr_index_count++;
+    }
+    bt_attr_index[i] = attr;
+
+exit:
+    xSemaphoreGive(bt_char_index_mutex);
+    return ret;
+}
+
+static void gatts_attr_index_free (void) {
+    xSemaphoreTake(bt_char_index_mutex, portMAX_DELAY);
+    heap_caps_free(bt_attr_index);
+    bt_attr_index = NULL;
+    bt_attr_index_size = 0;
+    bt_attr_index_count = 0;
+    xSemaphoreGive(bt_char_index_mutex);
+}
+
+/*
+ * indexes all the attributes of a service, called when the service is started
+ */
+static bool gatts_attr_index_add_service (bt_gatts_srv_obj_t *srv) {
     for (mp_uint_t i = 0; i < MP_STATE_PORT(bts_attr_list).len; i++) {
-        bt_gatts_attr_obj_t *char_obj = ((bt_gatts_attr_obj_t *)(MP_STATE_PORT(bts_attr_list).items[i]));
-        if (char_obj->handle == handle) {
-            return char_obj;
+        bt_gatts_attr_obj_t *attr = ((bt_gatts_attr_obj_t *)(MP_STATE_PORT(bts_attr_list).items[i]));
+        // descriptors belong to a characteristic, which belongs to the service
+        bt_gatts_attr_obj_t *chr = attr->is_char ? attr : (bt_gatts_attr_obj_t *)attr->parent;
+        if (chr->parent == srv && !gatts_attr_index_add(attr)) {
+            return false;
         }
     }
-    return NULL;
+    return true;
+}
+
+static bt_gatts_attr_obj_t *find_gatts_attr_by_handle (uint16_t handle) {
+    bt_gatts_attr_obj_t *attr_obj = NULL;
+
+    xSemaphoreTake(bt_char_index_mutex, portMAX_DELAY);
+    if (bt_attr_index_size > 0) {
+        uint16_t mask = bt_attr_index_size - 1;
+        for (uint16_t i = handle & mask; bt_attr_index[i]; i = (i + 1) & mask) {
+            if (bt_attr_index[i]->handle == handle) {
+                attr_obj = bt_attr_index[i];
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(bt_char_index_mutex);
+    return attr_obj;
+}
+
+/*
+ * delivers the queued characteristic events, runs in the interrupt task
+ */
+STATIC void gatts_char_event_drain(void *arg) {
+    char_cbk_arg_t *cbk_arg;
+
+    // if a handler raises, the remaining events are picked up by the next drain
+    while (xQueueReceive(xGattsEventQueue, &cbk_arg, 0) == pdTRUE) {
+        gatts_char_callback_handler(cbk_arg);
+    }
+}
+
+/*
+ * queues a characteristic event for the Python callback, returns false (and counts it) if it was lost
+ */
+static bool gatts_char_event_post (bt_gatts_char_obj_t *chr, uint32_t event, const uint8_t *data, uint16_t data_length) {
+    char_cbk_arg_t *cbk_arg = heap_caps_malloc(sizeof(char_cbk_arg_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (cbk_arg == NULL) {
+        goto error;
+    }
+    cbk_arg->chr = chr;
+    cbk_arg->event = event;
+    cbk_arg->data_length = data_length;
+    cbk_arg->data = NULL;
+    if (data_length > 0) {
+        cbk_arg->data = heap_caps_malloc(data_length, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (cbk_arg->data == NULL) {
+            heap_caps_free(cbk_arg);
+            goto error;
+        }
+        memcpy(cbk_arg->data, data, data_length);
+    }
+    if (xQueueSend(xGattsEventQueue, &cbk_arg, 0) != pdTRUE) {
+        heap_caps_free(cbk_arg->data);
+        heap_caps_free(cbk_arg);
+        goto error;
+    }
+    // every event schedules a drain, so a drain lost in the interrupt queue only delays the delivery
+    mp_irq_queue_interrupt_non_ISR(gatts_char_event_drain, NULL);
+    return true;
+
+error:
+    bt_gatts_event_overflow++;
+    return false;
+}
+
+static void gatts_char_event_flush (void) {
+    char_cbk_arg_t *cbk_arg;
+
+    while (xQueueReceive(xGattsEventQueue, &cbk_arg, 0) == pdTRUE) {
+        heap_caps_free(cbk_arg->data);
+        heap_caps_free(cbk_arg);
+    }
+}
+
+/*
+ * waits for the completion of a GATTS setup request
+ */
+static void gatts_wait_event (bt_gatts_event_result_t *gatts_event) {
+    if (xQueueReceive(xGattsQueue, gatts_event, (TickType_t)(BT_GATTS_TIMEOUT_MS / portTICK_RATE_MS)) != pdTRUE) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+}
+
+/*
+ * (re)allocates the scan ring, in PSRAM when the device has it
+ */
+static bool bt_scan_ring_alloc(uint32_t size) {
+    bt_scan_adv_t *advs = heap_caps_malloc(size * sizeof(bt_scan_adv_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+
+    if (advs == NULL) {
+        advs = heap_caps_malloc(size * sizeof(bt_scan_adv_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (advs == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(bt_scan_ring.mutex, portMAX_DELAY);
+    if (bt_scan_ring.advs) {
+        heap_caps_free(bt_scan_ring.advs);
+    }
+    bt_scan_ring.advs = advs;
+    bt_scan_ring.size = size;
+    bt_scan_ring.head = bt_scan_ring.tail = 0;
+    xSemaphoreGive(bt_scan_ring.mutex);
+    return true;
+}
+
+static void bt_scan_ring_flush(void) {
+    xSemaphoreTake(bt_scan_ring.mutex, portMAX_DELAY);
+    bt_scan_ring.head = bt_scan_ring.tail = 0;
+    bt_scan_ring.received = bt_scan_ring.filtered = bt_scan_ring.duplicates = bt_scan_ring.dropped = 0;
+    memset(bt_scan_ring.dedup, 0, sizeof(bt_scan_ring.dedup));
+    xSemaphoreGive(bt_scan_ring.mutex);
+}
+
+/*
+ * true if the advertisement data contains the service uuid, in a uuid list or a service data field
+ */
+static bool bt_scan_match_service(const uint8_t *data, uint8_t len, const esp_bt_uuid_t *uuid) {
+    for (uint16_t i = 0; i + 1 < len && data[i] > 0; i += data[i] + 1) {
+        uint8_t field_len = MIN(data[i] - 1, len - i - 2);
+        uint8_t type = data[i + 1];
+        const uint8_t *field = &data[i + 2];
+        uint8_t size = 0;
+
+        switch (type) {
+        case ESP_BLE_AD_TYPE_16SRV_PART:
+        case ESP_BLE_AD_TYPE_16SRV_CMPL:
+            size = ESP_UUID_LEN_16;
+            break;
+        case ESP_BLE_AD_TYPE_32SRV_PART:
+        case ESP_BLE_AD_TYPE_32SRV_CMPL:
+            size = ESP_UUID_LEN_32;
+            break;
+        case ESP_BLE_AD_TYPE_128SRV_PART:
+        case ESP_BLE_AD_TYPE_128SRV_CMPL:
+            size = ESP_UUID_LEN_128;
+            break;
+        case ESP_BLE_AD_TYPE_SERVICE_DATA:
+            // starts with the 16 bit uuid of the service
+            if (uuid->len == ESP_UUID_LEN_16 && field_len >= ESP_UUID_LEN_16
+                    && memcmp(field, &uuid->uuid.uuid16, ESP_UUID_LEN_16) == 0) {
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (size == uuid->len) {
+            for (uint8_t j = 0; j + size <= field_len; j += size) {
+                if (memcmp(&field[j], &uuid->uuid, size) == 0) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * true if the advertisement data carries manufacturer specific data of the company id
+ */
+static bool bt_scan_match_manufacturer(const uint8_t *data, uint8_t len, uint16_t company) {
+    for (uint16_t i = 0; i + 1 < len && data[i] > 0; i += data[i] + 1) {
+        if (data[i + 1] == ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE && data[i] >= 3 && i + 3 < len
+                && (data[i + 2] | (data[i + 3] << 8)) == company) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * true if the same device sent the same kind of advertisement within the dedup window
+ */
+static bool bt_scan_is_duplicate(const struct ble_scan_result_evt_param *scan_rst, TickType_t now) {
+    bt_scan_dedup_t *slot = NULL;
+    TickType_t window = bt_scan_ring.filter.dedup_window / portTICK_PERIOD_MS;
+
+    for (int i = 0; i < BT_SCAN_DEDUP_SIZE; i++) {
+        bt_scan_dedup_t *d = &bt_scan_ring.dedup[i];
+        if (d->used && d->adv_type == scan_rst->ble_evt_type && memcmp(d->bda, scan_rst->bda, ESP_BD_ADDR_LEN) == 0) {
+            if ((now - d->last_seen) < window) {
+                return true;
+            }
+            d->last_seen = now;
+            return false;
+        }
+        // otherwise take a free slot, or the device not heard the longest time
+        if (!d->used) {
+            if (slot == NULL || slot->used) {
+                slot = d;
+            }
+        } else if (slot == NULL || (slot->used && (now - d->last_seen) > (now - slot->last_seen))) {
+            slot = d;
+        }
+    }
+
+    memcpy(slot->bda, scan_rst->bda, ESP_BD_ADDR_LEN);
+    slot->adv_type = scan_rst->ble_evt_type;
+    slot->last_seen = now;
+    slot->used = true;
+    return false;
+}
+
+/*
+ * called by the GAP handler with each advertisement received
+ */
+static void bt_scan_ring_put(struct ble_scan_result_evt_param *scan_rst) {
+    bt_scan_filter_t *filter = &bt_scan_ring.filter;
+    uint8_t data_len = MIN(scan_rst->adv_data_len + scan_rst->scan_rsp_len, BT_SCAN_ADV_DATA_LEN_MAX);
+
+    xSemaphoreTake(bt_scan_ring.mutex, portMAX_DELAY);
+    bt_scan_ring.received++;
+
+    if (scan_rst->rssi < filter->rssi
+            || memcmp(scan_rst->bda, filter->mac_prefix, filter->mac_prefix_len) != 0
+            || (filter->manufacturer >= 0 && !bt_scan_match_manufacturer(scan_rst->ble_adv, data_len, filter->manufacturer))
+            || (filter->service_uuid.len > 0 && !bt_scan_match_service(scan_rst->ble_adv, data_len, &filter->service_uuid))) {
+        bt_scan_ring.filtered++;
+    } else if (filter->dedup_window > 0 && bt_scan_is_duplicate(scan_rst, xTaskGetTickCount())) {
+        bt_scan_ring.duplicates++;
+    } else if (bt_scan_ring.head - bt_scan_ring.tail >= bt_scan_ring.size) {
+        bt_scan_ring.dropped++;
+    } else {
+        bt_scan_adv_t *adv = &bt_scan_ring.advs[bt_scan_ring.head % bt_scan_ring.size];
+        memcpy(adv->bda, scan_rst->bda, ESP_BD_ADDR_LEN);
+        adv->addr_type = scan_rst->ble_addr_type;
+        adv->adv_type = scan_rst->ble_evt_type;
+        adv->rssi = scan_rst->rssi;
+        adv->data_len = data_len;
+        memcpy(adv->data, scan_rst->ble_adv, BT_SCAN_ADV_DATA_LEN_MAX);
+        bt_scan_ring.head++;
+    }
+    xSemaphoreGive(bt_scan_ring.mutex);
+}
+
+static bool bt_scan_ring_get(bt_scan_adv_t *adv) {
+    bool ret = false;
+
+    xSemaphoreTake(bt_scan_ring.mutex, portMAX_DELAY);
+    if (bt_scan_ring.head != bt_scan_ring.tail) {
+        memcpy(adv, &bt_scan_ring.advs[bt_scan_ring.tail % bt_scan_ring.size], sizeof(bt_scan_adv_t));
+        bt_scan_ring.tail++;
+        ret = true;
+    }
+    xSemaphoreGive(bt_scan_ring.mutex);
+    return ret;
+}
+
+/*
+ * packs as many advertisements as fit in buf, returns how many were packed
+ */
+static uint32_t bt_scan_ring_get_packed(uint8_t *buf, uint32_t len) {
+    uint32_t count = 0;
+    uint32_t offset = 0;
+
+    xSemaphoreTake(bt_scan_ring.mutex, portMAX_DELAY);
+    while (bt_scan_ring.head != bt_scan_ring.tail) {
+        bt_scan_adv_t *adv = &bt_scan_ring.advs[bt_scan_ring.tail % bt_scan_ring.size];
+        if (offset + BT_SCAN_PACKED_HEADER_LEN + adv->data_len > len) {
+            break;
+        }
+        memcpy(&buf[offset], adv->bda, ESP_BD_ADDR_LEN);
+        offset += ESP_BD_ADDR_LEN;
+        buf[offset++] = adv->addr_type;
+        buf[offset++] = (uint8_t)adv->rssi;
+        buf[offset++] = adv->data_len;
+        memcpy(&buf[offset], adv->data, adv->data_len);
+        offset += adv->data_len;
+        bt_scan_ring.tail++;
+        count++;
+    }
+    xSemaphoreGive(bt_scan_ring.mutex);
+    return count;
+}
+
+static void bt_coex_scan_start (void) {
+    bt_coex.scan_interval = ble_scan_params.scan_interval;
+    bt_coex.scan_window = ble_scan_params.scan_window;
+    // zero means idle
+    bt_coex.scan_start = xTaskGetTickCount() | 1;
+}
+
+/*
+ * scan time so far, and the part of it the scanner kept the radio for itself
+ */
+static void bt_coex_scan_time (uint64_t *scan_ms, uint64_t *bt_ms) {
+    uint32_t start = bt_coex.scan_start;
+
+    *scan_ms = bt_coex.scan_ms;
+    *bt_ms = bt_coex.bt_ms;
+    if (start) {
+        uint32_t elapsed = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+        *scan_ms += elapsed;
+        *bt_ms += (uint64_t)elapsed * bt_coex.scan_window / bt_coex.scan_interval;
+    }
+}
+
+static void bt_coex_scan_stop (void) {
+    if (bt_coex.scan_start) {
+        bt_coex_scan_time(&bt_coex.scan_ms, &bt_coex.bt_ms);
+        bt_coex.scan_start = 0;
+    }
 }
 
 static void gap_events_handler (esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
@@ -642,12 +1240,27 @@ static void gap_events_handler (esp_gap_ble_cb_event_t event, esp_ble_gap_cb_par
         esp_ble_gap_start_scanning(duration);
         break;
     }
-    case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT: {
+    case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+        if (param->scan_start_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+            bt_coex_scan_start();
+        }
+        break;
+    case ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT:
+        bt_coex_scan_stop();
+        break;
+    case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+    case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT: {
         bt_gatts_event_result_t gatts_event;
         gatts_event.adv_set = true;
         xQueueSend(xGattsQueue, (void *)&gatts_event, (TickType_t)0);
         break;
     }
+    case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+        if (param->pkt_data_lenth_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+            bt_obj.data_length_tx = param->pkt_data_lenth_cmpl.params.tx_len;
+            bt_obj.data_length_rx = param->pkt_data_lenth_cmpl.params.rx_len;
+        }
+        break;
     case ESP_GAP_BLE_NC_REQ_EVT:
     case ESP_GAP_BLE_PASSKEY_NOTIF_EVT: {
          printf("BLE paring passkey : %d\n", param->ble_security.key_notif.passkey);
@@ -659,12 +1272,10 @@ static void gap_events_handler (esp_gap_ble_cb_event_t event, esp_ble_gap_cb_par
         }
     }
     case ESP_GAP_BLE_SCAN_RESULT_EVT: {
-        bt_event_result_t bt_event_result;
         esp_ble_gap_cb_param_t *scan_result = (esp_ble_gap_cb_param_t *)param;
-        memcpy(&bt_event_result.scan, scan_result, sizeof(esp_ble_gap_cb_param_t));
         switch (scan_result->scan_rst.search_evt) {
         case ESP_GAP_SEARCH_INQ_RES_EVT:
-            xQueueSend(xScanQueue, (void *)&bt_event_result, (TickType_t)0);
+            bt_scan_ring_put(&scan_result->scan_rst);
             bt_obj.events |= MOD_BT_GATTC_ADV_EVT;
             if (bt_obj.trigger & MOD_BT_GATTC_ADV_EVT) {
                 mp_irq_queue_interrupt_non_ISR(bluetooth_callback_handler, (void *)&bt_obj);
@@ -673,6 +1284,7 @@ static void gap_events_handler (esp_gap_ble_cb_event_t event, esp_ble_gap_cb_par
         case ESP_GAP_SEARCH_DISC_RES_EVT:
             break;
         case ESP_GAP_SEARCH_INQ_CMPL_EVT:
+            bt_coex_scan_stop();
             if (bt_obj.scan_duration < 0) {
                 esp_ble_gap_set_scan_params(&ble_scan_params);
             } else {
@@ -715,6 +1327,9 @@ static void gattc_events_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc
         bt_event_result.connection.gatt_if = gattc_if;
         memcpy(bt_event_result.connection.srv_bda, p_data->connect.remote_bda, ESP_BD_ADDR_LEN);
         esp_ble_gattc_send_mtu_req (gattc_if, p_data->connect.conn_id);
+        if (bt_obj.data_length > BT_DATA_LENGTH_MIN) {
+            esp_ble_gap_set_pkt_data_len(p_data->connect.remote_bda, bt_obj.data_length);
+        }
         xQueueSend(xScanQueue, (void *)&bt_event_result, (TickType_t)0);
         break;
     case ESP_GATTC_CFG_MTU_EVT:
@@ -724,6 +1339,10 @@ static void gattc_events_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc
         xEventGroupSetBits(bt_event_group, MOD_BT_GATTC_MTU_EVT);
         break;
     case ESP_GATTC_READ_CHAR_EVT:
+        if (gattc_char_async_done(p_data->read.conn_id, p_data->read.handle, MOD_BT_GATTC_READ_EVT,
+                                  p_data->read.status, p_data->read.value, p_data->read.value_len)) {
+            break;
+        }
         if (p_data->read.status == ESP_GATT_OK) {
             uint16_t read_len = p_data->read.value_len > BT_CHAR_VALUE_SIZE_MAX ? BT_CHAR_VALUE_SIZE_MAX : p_data->read.value_len;
             memcpy(&bt_event_result.read.value, p_data->read.value, read_len);
@@ -733,6 +1352,10 @@ static void gattc_events_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc
         bt_obj.busy = false;
         break;
     case ESP_GATTC_WRITE_CHAR_EVT:
+        if (gattc_char_async_done(p_data->write.conn_id, p_data->write.handle, MOD_BT_GATTC_WRITE_EVT,
+                                  p_data->write.status, NULL, 0)) {
+            break;
+        }
         bt_event_result.write.status = p_data->write.status;
         xQueueSend(xScanQueue, (void *)&bt_event_result, (TickType_t)0);
         bt_obj.busy = false;
@@ -763,8 +1386,9 @@ static void gattc_events_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc
         char_obj = find_gattc_char (p_data->notify.conn_id, p_data->notify.handle);
         if (char_obj != NULL) {
             // copy the new value into the characteristic
-            memcpy(&char_obj->value, p_data->notify.value, p_data->notify.value_len);
-            char_obj->value_len = p_data->notify.value_len;
+            uint16_t notify_len = MIN(p_data->notify.value_len, char_obj->value_size);
+            memcpy(char_obj->value, p_data->notify.value, notify_len);
+            char_obj->value_len = notify_len;
 
             // register the event
             if (p_data->notify.is_notify) {
@@ -815,17 +1439,17 @@ STATIC void gattc_char_callback_handler(void *arg) {
 STATIC void gatts_char_callback_handler(void *arg) {
 
     bt_gatts_char_obj_t *chr = ((char_cbk_arg_t*)arg)->chr;
+    mp_obj_t tuple[2];
 
-    if (chr->handler && chr->handler != mp_const_none) {
+    tuple[0] = mp_obj_new_int(((char_cbk_arg_t*)arg)->event);
+    tuple[1] = mp_const_none;
+    if(((char_cbk_arg_t*)arg)->data_length > 0) {
+        tuple[1] = mp_obj_new_bytes(((char_cbk_arg_t*)arg)->data, ((char_cbk_arg_t*)arg)->data_length);
+        heap_caps_free(((char_cbk_arg_t*)arg)->data);
+    }
+    heap_caps_free((char_cbk_arg_t*)arg);
 
-        mp_obj_t tuple[2];
-        tuple[0] = mp_obj_new_int(((char_cbk_arg_t*)arg)->event);
-        tuple[1] = mp_const_none;
-        if(((char_cbk_arg_t*)arg)->data_length > 0) {
-            tuple[1] = mp_obj_new_bytes(((char_cbk_arg_t*)arg)->data, ((char_cbk_arg_t*)arg)->data_length);
-            heap_caps_free(((char_cbk_arg_t*)arg)->data);
-            heap_caps_free((char_cbk_arg_t*)arg);
-        }
+    if (chr->handler && chr->handler != mp_const_none) {
 
         mp_obj_t r_value = mp_call_function_2(chr->handler, chr->handler_arg, mp_obj_new_tuple(2, tuple));
 
@@ -867,6 +1491,50 @@ STATIC void gatts_char_callback_handler(void *arg) {
     }
 }
 
+/*
+ * sends the streamed data as notifications while there are credits left
+ */
+static void bt_stream_pump(void) {
+    uint8_t chunk[BT_MTU_SIZE_MAX - 3];
+    bool sent = false;
+
+    xSemaphoreTake(bt_stream.mutex, portMAX_DELAY);
+    while (bt_stream.chr && bt_stream.head != bt_stream.tail && bt_stream.credits > 0 && !bt_stream.congested
+            && bt_obj.gatts_conn_id >= 0) {
+        uint16_t mtu = (bt_obj.gatts_mtu > 0) ? bt_obj.gatts_mtu : ESP_GATT_DEF_BLE_MTU_SIZE;
+        uint16_t len = MIN(MIN(bt_stream.head - bt_stream.tail, mtu - 3), sizeof(chunk));
+
+        for (uint16_t i = 0; i < len; i++) {
+            chunk[i] = bt_stream.buf[(bt_stream.tail + i) % BT_STREAM_RING_SIZE];
+        }
+        if (ESP_OK != esp_ble_gatts_send_indicate(bt_obj.gatts_if, bt_obj.gatts_conn_id, bt_stream.chr->attr_obj.handle,
+                                                  len, chunk, false)) {
+            break;
+        }
+        bt_stream.tail += len;
+        bt_stream.credits--;
+        sent = true;
+    }
+    xSemaphoreGive(bt_stream.mutex);
+
+    if (sent) {
+        // there's room for more data
+        xEventGroupSetBits(bt_event_group, MOD_BT_GATTS_STREAM_EVT);
+    }
+}
+
+static void bt_stream_flush(void) {
+    if (bt_stream.mutex) {
+        xSemaphoreTake(bt_stream.mutex, portMAX_DELAY);
+        bt_stream.head = bt_stream.tail = 0;
+        bt_stream.credits = BT_STREAM_CREDITS_MAX;
+        bt_stream.congested = false;
+        bt_stream.chr = NULL;
+        xSemaphoreGive(bt_stream.mutex);
+        xEventGroupSetBits(bt_event_group, MOD_BT_GATTS_STREAM_EVT);
+    }
+}
+
 static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param) {
     esp_ble_gatts_cb_param_t *p = (esp_ble_gatts_cb_param_t *)param;
 
@@ -886,16 +1554,11 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                 if (char_obj->trigger & MOD_BT_GATTS_READ_EVT) {
                     char_obj->read_request = true;
                     char_obj->trans_id = p->read.trans_id;
-
-                    char_cbk_arg_t *cbk_arg = heap_caps_malloc(sizeof(char_cbk_arg_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-
-                    cbk_arg->chr = char_obj;
-                    cbk_arg->event = MOD_BT_GATTS_READ_EVT;
-                    cbk_arg->data_length = 0;
-                    cbk_arg->data = NULL;
-
-                    mp_irq_queue_interrupt_non_ISR(gatts_char_callback_handler, cbk_arg);
-                    break;
+                    if (gatts_char_event_post(char_obj, MOD_BT_GATTS_READ_EVT, NULL, 0)) {
+                        break;
+                    }
+                    // couldn't be queued, answer with the current value instead
+                    char_obj->read_request = false;
                 }
             }
             // send the response immediately if it's not a characteristic or if there's no callback registered
@@ -913,7 +1576,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
             bt_gatts_attr_obj_t *attr_obj = find_gatts_attr_by_handle (p->write.handle);
             if (attr_obj) {
                 // only write up to the maximum allowed size
-                uint16_t write_len = p->write.len > BT_CHAR_VALUE_SIZE_MAX ? BT_CHAR_VALUE_SIZE_MAX : p->write.len;
+                uint16_t write_len = p->write.len > attr_obj->value_size ? attr_obj->value_size : p->write.len;
                 memcpy(attr_obj->value, p->write.value, write_len);
                 attr_obj->value_len = write_len;
 
@@ -921,16 +1584,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                     bt_gatts_char_obj_t *char_obj = (bt_gatts_char_obj_t *)attr_obj;
                     char_obj->events |= MOD_BT_GATTS_WRITE_EVT;
                     if (char_obj->trigger & MOD_BT_GATTS_WRITE_EVT) {
-
-                        char_cbk_arg_t *cbk_arg = heap_caps_malloc(sizeof(char_cbk_arg_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-
-                        cbk_arg->chr = char_obj;
-                        cbk_arg->event = MOD_BT_GATTS_WRITE_EVT;
-                        cbk_arg->data_length = write_len;
-                        cbk_arg->data = heap_caps_malloc(cbk_arg->data_length, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-                        memcpy(cbk_arg->data, p->write.value, cbk_arg->data_length);
-
-                        mp_irq_queue_interrupt_non_ISR(gatts_char_callback_handler, cbk_arg);
+                        gatts_char_event_post(char_obj, MOD_BT_GATTS_WRITE_EVT, p->write.value, write_len);
                     }
                 } else {    // descriptor
                     if (attr_obj->uuid.len == ESP_UUID_LEN_16 && attr_obj->uuid.uuid.uuid16 == GATT_UUID_CHAR_CLIENT_CONFIG) {
@@ -939,15 +1593,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                         char_obj->config = value;
                         char_obj->events |= MOD_BT_GATTS_SUBSCRIBE_EVT;
                         if (char_obj->trigger & MOD_BT_GATTS_SUBSCRIBE_EVT) {
-
-                            char_cbk_arg_t *cbk_arg = heap_caps_malloc(sizeof(char_cbk_arg_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-
-                            cbk_arg->chr = char_obj;
-                            cbk_arg->event = MOD_BT_GATTS_SUBSCRIBE_EVT;
-                            cbk_arg->data_length = 0;
-                            cbk_arg->data = NULL;
-
-                            mp_irq_queue_interrupt_non_ISR(gatts_char_callback_handler, cbk_arg);
+                            gatts_char_event_post(char_obj, MOD_BT_GATTS_SUBSCRIBE_EVT, NULL, 0);
                         }
 
                         if (value == 0x0001) {  // notifications enabled
@@ -966,8 +1612,24 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         bt_obj.gatts_mtu = p->mtu.mtu;
         xEventGroupSetBits(bt_event_group, MOD_BT_GATTS_MTU_EVT);
         break;
-    case ESP_GATTS_EXEC_WRITE_EVT:
     case ESP_GATTS_CONF_EVT:
+        // a notification (or indication) has been sent, give its credit back
+        if (bt_stream.mutex) {
+            xSemaphoreTake(bt_stream.mutex, portMAX_DELAY);
+            if (bt_stream.credits < BT_STREAM_CREDITS_MAX) {
+                bt_stream.credits++;
+            }
+            xSemaphoreGive(bt_stream.mutex);
+            bt_stream_pump();
+        }
+        break;
+    case ESP_GATTS_CONGEST_EVT:
+        if (bt_stream.mutex) {
+            bt_stream.congested = p->congest.congested;
+            bt_stream_pump();
+        }
+        break;
+    case ESP_GATTS_EXEC_WRITE_EVT:
     case ESP_GATTS_UNREG_EVT:
         break;
     case ESP_GATTS_CREATE_EVT: {
@@ -1003,6 +1665,9 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         } else {
             memcpy((void *)bt_obj.client_bda, p->connect.remote_bda, ESP_BD_ADDR_LEN);
             bt_obj.gatts_conn_id = p->connect.conn_id;
+            if (bt_obj.data_length > BT_DATA_LENGTH_MIN) {
+                esp_ble_gap_set_pkt_data_len(p->connect.remote_bda, bt_obj.data_length);
+            }
             bt_obj.events |= MOD_BT_GATTS_CONN_EVT;
             if (bt_obj.trigger & MOD_BT_GATTS_CONN_EVT) {
                 mp_irq_queue_interrupt_non_ISR(bluetooth_callback_handler, (void *)&bt_obj);
@@ -1015,6 +1680,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
     case ESP_GATTS_DISCONNECT_EVT:
         bt_obj.gatts_conn_id = -1;
         xEventGroupClearBits(bt_event_group, MOD_BT_GATTS_MTU_EVT);
+        bt_stream_flush();
         if (bt_obj.advertising) {
             if (!bt_obj.secure){
                 esp_ble_gap_start_advertising(&bt_adv_params);
@@ -1034,7 +1700,6 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
     case ESP_GATTS_OPEN_EVT:
     case ESP_GATTS_CANCEL_OPEN_EVT:
     case ESP_GATTS_LISTEN_EVT:
-    case ESP_GATTS_CONGEST_EVT:
     default:
         break;
     }
@@ -1045,7 +1710,24 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
 
 /// \class Bluetooth
 static mp_obj_t bt_init_helper(bt_obj_t *self, const mp_arg_val_t *args) {
+    if (args[7].u_int < 1 || args[7].u_int > BT_GATTS_EVENT_QUEUE_SIZE_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid event queue size"));
+    }
+
     if (!self->init) {
+        // the GATTS callbacks are not registered yet, nothing can be posting events
+        if (args[7].u_int != bt_gatts_event_queue_size) {
+            QueueHandle_t queue = xQueueCreate(args[7].u_int, sizeof(char_cbk_arg_t *));
+            if (queue == NULL) {
+                mp_raise_OSError(MP_ENOMEM);
+            }
+            gatts_char_event_flush();
+            vQueueDelete(xGattsEventQueue);
+            xGattsEventQueue = queue;
+            bt_gatts_event_queue_size = args[7].u_int;
+        }
+        bt_gatts_event_overflow = 0;
+
         if (!self->controller_active) {
             esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
             esp_bt_controller_init(&bt_cfg);
@@ -1068,10 +1750,11 @@ static mp_obj_t bt_init_helper(bt_obj_t *self, const mp_arg_val_t *args) {
         mp_obj_list_init((mp_obj_t)&MP_STATE_PORT(btc_conn_list), 0);
         mp_obj_list_init((mp_obj_t)&MP_STATE_PORT(bts_srv_list), 0);
         mp_obj_list_init((mp_obj_t)&MP_STATE_PORT(bts_attr_list), 0);
+        gatts_attr_index_free();
         esp_ble_gattc_app_register(MOD_BT_CLIENT_APP_ID);
         esp_ble_gatts_app_register(MOD_BT_SERVER_APP_ID);
 
-        //set MTU
+        //set MTU, negotiated with every peer up to this value
         uint16_t mtu = args[5].u_int;
         if(mtu > BT_MTU_SIZE_MAX)
         {
@@ -1087,6 +1770,9 @@ static mp_obj_t bt_init_helper(bt_obj_t *self, const mp_arg_val_t *args) {
         self->init = true;
     }
 
+    // LE data length extension, requested on every new connection
+    bt_obj.data_length = MIN(MAX(args[6].u_int, BT_DATA_LENGTH_MIN), BT_DATA_LENGTH_MAX);
+
     // get the antenna type
     uint8_t antenna;
     if (args[1].u_obj == MP_OBJ_NULL) {
@@ -1136,7 +1822,9 @@ STATIC const mp_arg_t bt_init_args[] = {
     { MP_QSTR_modem_sleep,  MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj  = MP_OBJ_NULL} },
     { MP_QSTR_secure,       MP_ARG_KW_ONLY  | MP_ARG_BOOL,  {.u_bool = false} },
     { MP_QSTR_pin,          MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int  = 123456} },
-    { MP_QSTR_mtu,          MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int  = BT_MTU_SIZE_MAX} },
+    { MP_QSTR_mtu,          MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int  = BT_MTU_SIZE_DEFAULT} },
+    { MP_QSTR_data_length,  MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int  = BT_DATA_LENGTH_MAX} },
+    { MP_QSTR_event_queue,  MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int  = BT_GATTS_EVENT_QUEUE_SIZE_DEFAULT} },
 
 };
 STATIC mp_obj_t bt_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
@@ -1156,6 +1844,8 @@ STATIC mp_obj_t bt_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
     }
 
+    modbt_init_resources();
+
     if (args[4].u_bool) {
        if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) == 0) {
           nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError,"Secure BLE not available for 512K RAM devices"));
@@ -1200,7 +1890,7 @@ STATIC mp_obj_t bt_start_scan(mp_obj_t self_in, mp_obj_t timeout) {
 
     bt_obj.scan_duration = duration;
     bt_obj.scanning = true;
-    xQueueReset(xScanQueue);
+    bt_scan_ring_flush();
     if (ESP_OK != esp_ble_gap_set_scan_params(&ble_scan_params)) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
@@ -1250,6 +1940,78 @@ STATIC mp_obj_t bt_modem_sleep(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bt_modem_sleep_obj, 1, 2, bt_modem_sleep);
 
+STATIC mp_obj_t bt_coexistence(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_prefer,           MP_ARG_OBJ,                     {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_scan_interval,    MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_scan_window,      MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = MP_OBJ_NULL} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (n_args == 1 && kw_args->used == 0) {
+        STATIC const qstr bt_coexistence_fields[] = {
+            MP_QSTR_prefer, MP_QSTR_scan_interval, MP_QSTR_scan_window,
+        };
+        mp_obj_t tuple[3];
+
+        tuple[0] = mp_obj_new_int(bt_coex.prefer);
+        tuple[1] = mp_obj_new_int(ble_scan_params.scan_interval * BT_SCAN_TIME_UNIT_US / 1000);
+        tuple[2] = mp_obj_new_int(ble_scan_params.scan_window * BT_SCAN_TIME_UNIT_US / 1000);
+        return mp_obj_new_attrtuple(bt_coexistence_fields, 3, tuple);
+    }
+
+    // the intervals are given in milliseconds
+    uint32_t interval = ble_scan_params.scan_interval;
+    uint32_t window = ble_scan_params.scan_window;
+    if (args[1].u_obj != MP_OBJ_NULL) {
+        interval = mp_obj_get_int(args[1].u_obj) * 1000 / BT_SCAN_TIME_UNIT_US;
+    }
+    if (args[2].u_obj != MP_OBJ_NULL) {
+        window = mp_obj_get_int(args[2].u_obj) * 1000 / BT_SCAN_TIME_UNIT_US;
+    }
+    if (interval < BT_SCAN_INTERVAL_MIN || interval > BT_SCAN_INTERVAL_MAX ||
+        window < BT_SCAN_INTERVAL_MIN || window > interval) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid scan interval or window"));
+    }
+    if ((interval != ble_scan_params.scan_interval || window != ble_scan_params.scan_window) && bt_obj.scanning) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+    }
+
+    if (args[0].u_obj != MP_OBJ_NULL) {
+        mp_int_t prefer = mp_obj_get_int(args[0].u_obj);
+        if (prefer < ESP_COEX_PREFER_WIFI || prefer >= ESP_COEX_PREFER_NUM) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid coexistence preference"));
+        }
+        if (ESP_OK != esp_coex_preference_set(prefer)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        bt_coex.prefer = prefer;
+    }
+    ble_scan_params.scan_interval = interval;
+    ble_scan_params.scan_window = window;
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(bt_coexistence_obj, 1, bt_coexistence);
+
+STATIC mp_obj_t bt_coexistence_stats(mp_obj_t self_in) {
+    STATIC const qstr bt_coexistence_stats_fields[] = {
+        MP_QSTR_scan_ms, MP_QSTR_bt_ms, MP_QSTR_wifi_ms,
+    };
+    mp_obj_t tuple[3];
+    uint64_t scan_ms, bt_ms;
+
+    bt_coex_scan_time(&scan_ms, &bt_ms);
+    tuple[0] = mp_obj_new_int_from_ull(scan_ms);
+    tuple[1] = mp_obj_new_int_from_ull(bt_ms);
+    tuple[2] = mp_obj_new_int_from_ull(scan_ms - bt_ms);
+
+    return mp_obj_new_attrtuple(bt_coexistence_stats_fields, 3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_coexistence_stats_obj, bt_coexistence_stats);
+
 STATIC mp_obj_t bt_stop_scan(mp_obj_t self_in) {
     if (bt_obj.scanning) {
         esp_ble_gap_stop_scanning();
@@ -1260,19 +2022,19 @@ STATIC mp_obj_t bt_stop_scan(mp_obj_t self_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_stop_scan_obj, bt_stop_scan);
 
 STATIC mp_obj_t bt_read_scan(mp_obj_t self_in) {
-    bt_event_result_t bt_event;
+    bt_scan_adv_t adv;
 
     STATIC const qstr bt_scan_info_fields[] = {
         MP_QSTR_mac, MP_QSTR_addr_type, MP_QSTR_adv_type, MP_QSTR_rssi, MP_QSTR_data,
     };
 
-    if (xQueueReceive(xScanQueue, &bt_event, (TickType_t)0)) {
+    if (bt_scan_ring_get(&adv)) {
         mp_obj_t tuple[5];
-        tuple[0] = mp_obj_new_bytes((const byte *)bt_event.scan.scan_rst.bda, 6);
-        tuple[1] = mp_obj_new_int(bt_event.scan.scan_rst.ble_addr_type);
-        tuple[2] = mp_obj_new_int(bt_event.scan.scan_rst.ble_evt_type & 0x03);    // FIXME
-        tuple[3] = mp_obj_new_int(bt_event.scan.scan_rst.rssi);
-        tuple[4] = mp_obj_new_bytes((const byte *)bt_event.scan.scan_rst.ble_adv, sizeof(bt_event.scan.scan_rst.ble_adv));
+        tuple[0] = mp_obj_new_bytes((const byte *)adv.bda, 6);
+        tuple[1] = mp_obj_new_int(adv.addr_type);
+        tuple[2] = mp_obj_new_int(adv.adv_type & 0x03);    // FIXME
+        tuple[3] = mp_obj_new_int(adv.rssi);
+        tuple[4] = mp_obj_new_bytes((const byte *)adv.data, sizeof(adv.data));
 
         return mp_obj_new_attrtuple(bt_scan_info_fields, 5, tuple);
     }
@@ -1281,20 +2043,20 @@ STATIC mp_obj_t bt_read_scan(mp_obj_t self_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_read_scan_obj, bt_read_scan);
 
 STATIC mp_obj_t bt_get_advertisements(mp_obj_t self_in) {
-    bt_event_result_t bt_event;
+    bt_scan_adv_t adv;
 
     STATIC const qstr bt_scan_info_fields[] = {
         MP_QSTR_mac, MP_QSTR_addr_type, MP_QSTR_adv_type, MP_QSTR_rssi, MP_QSTR_data,
     };
 
     mp_obj_t advs = mp_obj_new_list(0, NULL);
-    while (xQueueReceive(xScanQueue, &bt_event, (TickType_t)0)) {
+    while (bt_scan_ring_get(&adv)) {
         mp_obj_t tuple[5];
-        tuple[0] = mp_obj_new_bytes((const byte *)bt_event.scan.scan_rst.bda, 6);
-        tuple[1] = mp_obj_new_int(bt_event.scan.scan_rst.ble_addr_type);
-        tuple[2] = mp_obj_new_int(bt_event.scan.scan_rst.ble_evt_type & 0x03);    // FIXME
-        tuple[3] = mp_obj_new_int(bt_event.scan.scan_rst.rssi);
-        tuple[4] = mp_obj_new_bytes((const byte *)bt_event.scan.scan_rst.ble_adv, sizeof(bt_event.scan.scan_rst.ble_adv));
+        tuple[0] = mp_obj_new_bytes((const byte *)adv.bda, 6);
+        tuple[1] = mp_obj_new_int(adv.addr_type);
+        tuple[2] = mp_obj_new_int(adv.adv_type & 0x03);    // FIXME
+        tuple[3] = mp_obj_new_int(adv.rssi);
+        tuple[4] = mp_obj_new_bytes((const byte *)adv.data, sizeof(adv.data));
 
         mp_obj_list_append(advs, mp_obj_new_attrtuple(bt_scan_info_fields, 5, tuple));
     }
@@ -1302,6 +2064,134 @@ STATIC mp_obj_t bt_get_advertisements(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_get_advertisements_obj, bt_get_advertisements);
 
+STATIC mp_obj_t bt_get_advs_into(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+
+    // no allocation at all, the buffer is filled with [mac][addr_type][rssi][data_len][data] records
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    return mp_obj_new_int_from_uint(bt_scan_ring_get_packed(bufinfo.buf, bufinfo.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(bt_get_advs_into_obj, bt_get_advs_into);
+
+/// \method scan_filter(*, mac_prefix, service_uuid, manufacturer, rssi, dedup_window, ring_size)
+STATIC mp_obj_t bt_scan_filter(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_mac_prefix,       MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_service_uuid,     MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_manufacturer,     MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_rssi,             MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_dedup_window,     MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 0} },
+        { MP_QSTR_ring_size,        MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    bt_scan_filter_t filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.manufacturer = -1;
+    filter.rssi = BT_SCAN_RSSI_NONE;
+
+    if (args[0].u_obj != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len > BT_SCAN_MAC_PREFIX_LEN_MAX) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid MAC prefix"));
+        }
+        memcpy(filter.mac_prefix, bufinfo.buf, bufinfo.len);
+        filter.mac_prefix_len = bufinfo.len;
+    }
+
+    if (args[1].u_obj != mp_const_none) {
+        if (MP_OBJ_IS_SMALL_INT(args[1].u_obj) == true) {
+            uint32_t srv_uuid = mp_obj_get_int_truncated(args[1].u_obj);
+            if (srv_uuid > UINT16_MAX) {
+                filter.service_uuid.len = ESP_UUID_LEN_32;
+                filter.service_uuid.uuid.uuid32 = srv_uuid;
+            } else {
+                filter.service_uuid.len = ESP_UUID_LEN_16;
+                filter.service_uuid.uuid.uuid16 = srv_uuid;
+            }
+        } else {
+            mp_buffer_info_t uuid_bufinfo;
+            mp_get_buffer_raise(args[1].u_obj, &uuid_bufinfo, MP_BUFFER_READ);
+            if (uuid_bufinfo.len != ESP_UUID_LEN_128) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid UUID"));
+            }
+            filter.service_uuid.len = ESP_UUID_LEN_128;
+            memcpy(filter.service_uuid.uuid.uuid128, uuid_bufinfo.buf, ESP_UUID_LEN_128);
+        }
+    }
+
+    if (args[2].u_obj != mp_const_none) {
+        filter.manufacturer = mp_obj_get_int(args[2].u_obj) & 0xFFFF;
+    }
+
+    if (args[3].u_obj != mp_const_none) {
+        filter.rssi = mp_obj_get_int(args[3].u_obj);
+    }
+
+    if (args[4].u_int < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid dedup window"));
+    }
+    filter.dedup_window = args[4].u_int;
+
+    if (args[5].u_obj != mp_const_none) {
+        int32_t size = mp_obj_get_int(args[5].u_obj);
+        if (size <= 0 || size > BT_SCAN_RING_SIZE_MAX) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid ring size"));
+        }
+        if (bt_obj.scanning) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+        }
+        if (!bt_scan_ring_alloc(size)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, mpexception_os_resource_not_avaliable));
+        }
+    }
+
+    xSemaphoreTake(bt_scan_ring.mutex, portMAX_DELAY);
+    bt_scan_ring.filter = filter;
+    memset(bt_scan_ring.dedup, 0, sizeof(bt_scan_ring.dedup));
+    xSemaphoreGive(bt_scan_ring.mutex);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(bt_scan_filter_obj, 1, bt_scan_filter);
+
+STATIC mp_obj_t bt_scan_stats(mp_obj_t self_in) {
+    STATIC const qstr bt_scan_stats_fields[] = {
+        MP_QSTR_received, MP_QSTR_filtered, MP_QSTR_duplicates, MP_QSTR_dropped, MP_QSTR_pending, MP_QSTR_ring_size,
+    };
+    mp_obj_t tuple[6];
+
+    xSemaphoreTake(bt_scan_ring.mutex, portMAX_DELAY);
+    tuple[0] = mp_obj_new_int_from_uint(bt_scan_ring.received);
+    tuple[1] = mp_obj_new_int_from_uint(bt_scan_ring.filtered);
+    tuple[2] = mp_obj_new_int_from_uint(bt_scan_ring.duplicates);
+    tuple[3] = mp_obj_new_int_from_uint(bt_scan_ring.dropped);
+    tuple[4] = mp_obj_new_int_from_uint(bt_scan_ring.head - bt_scan_ring.tail);
+    tuple[5] = mp_obj_new_int_from_uint(bt_scan_ring.size);
+    xSemaphoreGive(bt_scan_ring.mutex);
+
+    return mp_obj_new_attrtuple(bt_scan_stats_fields, 6, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_scan_stats_obj, bt_scan_stats);
+
+STATIC mp_obj_t bt_event_stats(mp_obj_t self_in) {
+    STATIC const qstr bt_event_stats_fields[] = {
+        MP_QSTR_queue_size, MP_QSTR_pending, MP_QSTR_overflow,
+    };
+    mp_obj_t tuple[3];
+
+    tuple[0] = mp_obj_new_int_from_uint(bt_gatts_event_queue_size);
+    tuple[1] = mp_obj_new_int_from_uint(uxQueueMessagesWaiting(xGattsEventQueue));
+    tuple[2] = mp_obj_new_int_from_uint(bt_gatts_event_overflow);
+
+    return mp_obj_new_attrtuple(bt_event_stats_fields, 3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_event_stats_obj, bt_event_stats);
+
 STATIC mp_obj_t bt_resolve_adv_data(mp_obj_t self_in, mp_obj_t adv_data, mp_obj_t data_type) {
     mp_buffer_info_t bufinfo;
     uint8_t data_len;
@@ -1618,12 +2508,13 @@ STATIC mp_obj_t bt_set_advertisement (mp_uint_t n_args, const mp_obj_t *pos_args
     adv_data.p_service_data = NULL;
     adv_data.service_uuid_len = 0;
     adv_data.p_service_uuid = NULL;
+    xQueueReset(xGattsQueue);
     esp_ble_gap_config_adv_data(&adv_data);
     esp_ble_gap_config_adv_data(&scan_rsp_data);
 
     // wait for the advertisement data to be configured
     bt_gatts_event_result_t gatts_event;
-    xQueueReceive(xGattsQueue, &gatts_event, portMAX_DELAY);
+    gatts_wait_event(&gatts_event);
 
     return mp_const_none;
 }
@@ -1645,11 +2536,12 @@ STATIC mp_obj_t bt_set_advertisement_raw(mp_obj_t self_in, mp_obj_t raw_data) {
             data_len = sizeof(data);
         }
  
+        xQueueReset(xGattsQueue);
         esp_ble_gap_config_adv_data_raw(data, data_len);
      
         // wait for the advertisement data to be configured
         bt_gatts_event_result_t gatts_event;
-        xQueueReceive(xGattsQueue, &gatts_event, portMAX_DELAY);
+        gatts_wait_event(&gatts_event);
     }
  
     return mp_const_none;
@@ -1712,10 +2604,11 @@ STATIC mp_obj_t bt_service (mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
     service_id.is_primary = args[1].u_bool;
     service_id.id.inst_id = 0x00;
 
+    xQueueReset(xGattsQueue);
     esp_ble_gatts_create_service(bt_obj.gatts_if, &service_id, (args[2].u_int * 3) + 1);
 
     bt_gatts_event_result_t gatts_event;
-    xQueueReceive(xGattsQueue, &gatts_event, portMAX_DELAY);
+    gatts_wait_event(&gatts_event);
 
     bt_gatts_srv_obj_t *srv = m_new_obj(bt_gatts_srv_obj_t);
     srv->base.type = (mp_obj_t)&mod_bt_gatts_service_type;
@@ -1738,6 +2631,9 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(bt_service_obj, 1, bt_service);
 STATIC mp_obj_t bt_service_start(mp_obj_t self_in) {
     bt_gatts_srv_obj_t *self = self_in;
     if (!self->started) {
+        if (!gatts_attr_index_add_service(self)) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
         if (ESP_OK != esp_ble_gatts_start_service(self->handle)) {
             nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
         }
@@ -1765,6 +2661,7 @@ STATIC mp_obj_t bt_characteristic (mp_uint_t n_args, const mp_obj_t *pos_args, m
         { MP_QSTR_permissions,              MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_properties,               MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_value,                    MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_max_len,                  MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
     };
 
     bt_gatts_srv_obj_t *self = pos_args[0];
@@ -1811,11 +2708,25 @@ STATIC mp_obj_t bt_characteristic (mp_uint_t n_args, const mp_obj_t *pos_args, m
         properties = mp_obj_get_int(args[2].u_obj);
     }
 
+    // storage of the value, large enough for the initial value by default
+    mp_int_t max_len = BT_CHAR_VALUE_SIZE_DEFAULT;
+    if (args[4].u_obj != mp_const_none) {
+        max_len = mp_obj_get_int(args[4].u_obj);
+        if (max_len <= 0 || max_len > BT_CHAR_VALUE_SIZE_MAX) {
+            goto error;
+        }
+    } else if (args[3].u_obj != mp_const_none && !mp_obj_is_integer(args[3].u_obj)) {
+        max_len = MIN(MAX(max_len, mp_obj_get_int(mp_obj_len(args[3].u_obj))), BT_CHAR_VALUE_SIZE_MAX);
+    }
+    max_len = MAX(max_len, sizeof(uint32_t));
+
     bt_gatts_char_obj_t *characteristic = m_new_obj(bt_gatts_char_obj_t);
     characteristic->attr_obj.base.type = (mp_obj_t)&mod_bt_gatts_char_type;
     characteristic->attr_obj.parent = self;
     characteristic->attr_obj.is_char = true;
     characteristic->attr_obj.properties = properties;
+    characteristic->attr_obj.value_size = max_len;
+    characteristic->attr_obj.value = m_new(uint8_t, max_len);
     characteristic->trigger = 0;
     characteristic->events = 0;
 
@@ -1836,7 +2747,7 @@ STATIC mp_obj_t bt_characteristic (mp_uint_t n_args, const mp_obj_t *pos_args, m
         } else {
             mp_buffer_info_t value_bufinfo;
             mp_get_buffer_raise(args[3].u_obj, &value_bufinfo, MP_BUFFER_READ);
-            uint16_t write_len = value_bufinfo.len > BT_CHAR_VALUE_SIZE_MAX ? BT_CHAR_VALUE_SIZE_MAX : value_bufinfo.len;
+            uint16_t write_len = value_bufinfo.len > characteristic->attr_obj.value_size ? characteristic->attr_obj.value_size : value_bufinfo.len;
             memcpy(characteristic->attr_obj.value, value_bufinfo.buf, write_len);
             characteristic->attr_obj.value_len = write_len;
         }
@@ -1845,10 +2756,11 @@ STATIC mp_obj_t bt_characteristic (mp_uint_t n_args, const mp_obj_t *pos_args, m
         characteristic->attr_obj.value_len = 1;
     }
 
+    xQueueReset(xGattsQueue);
     esp_ble_gatts_add_char(self->handle, &char_uuid, permissions, properties, NULL, NULL);
 
     bt_gatts_event_result_t gatts_event;
-    xQueueReceive(xGattsQueue, &gatts_event, portMAX_DELAY);
+    gatts_wait_event(&gatts_event);
 
     characteristic->attr_obj.handle = gatts_event.char_handle;
     memcpy(&characteristic->attr_obj.uuid, &char_uuid, sizeof(char_uuid));
@@ -1859,20 +2771,28 @@ STATIC mp_obj_t bt_characteristic (mp_uint_t n_args, const mp_obj_t *pos_args, m
     descriptor->uuid.len = ESP_UUID_LEN_16;
     descriptor->uuid.uuid.uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
 
+    xQueueReset(xGattsQueue);
     esp_ble_gatts_add_char_descr(self->handle, &descriptor->uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, NULL, NULL);
 
-    xQueueReceive(xGattsQueue, &gatts_event, portMAX_DELAY);
+    gatts_wait_event(&gatts_event);
 
     descriptor->base.type = (mp_obj_t)&mod_bt_gatts_char_type;
     descriptor->handle = gatts_event.char_descr_handle;
     descriptor->parent = characteristic;
     descriptor->is_char = false;
+    descriptor->value_size = 2;
+    descriptor->value = m_new(uint8_t, descriptor->value_size);
     descriptor->value_len = 2;
     descriptor->value[0] = 0;
     descriptor->value[1] = 0;
 
     mp_obj_list_append((mp_obj_t)&MP_STATE_PORT(bts_attr_list), descriptor);
 
+    // the service is already running, index the new attributes right away
+    if (self->started && (!gatts_attr_index_add(&characteristic->attr_obj) || !gatts_attr_index_add(descriptor))) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+
     return characteristic;
 
 error:
@@ -1915,7 +2835,7 @@ STATIC mp_obj_t bt_characteristic_value (mp_uint_t n_args, const mp_obj_t *args)
         } else {
             mp_buffer_info_t value_bufinfo;
             mp_get_buffer_raise(args[1], &value_bufinfo, MP_BUFFER_READ);
-            uint8_t value_len = value_bufinfo.len > BT_CHAR_VALUE_SIZE_MAX ? BT_CHAR_VALUE_SIZE_MAX : value_bufinfo.len;
+            uint16_t value_len = value_bufinfo.len > self->attr_obj.value_size ? self->attr_obj.value_size : value_bufinfo.len;
             memcpy(self->attr_obj.value, value_bufinfo.buf, value_len);
             self->attr_obj.value_len = value_len;
         }
@@ -1979,12 +2899,93 @@ STATIC mp_obj_t bt_characteristic_config(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_characteristic_config_obj, bt_characteristic_config);
 
+/*
+ * copies a buffer in the stream ring, waiting for room as the notifications are sent
+ */
+static bool bt_stream_write(bt_gatts_char_obj_t *self, const uint8_t *data, uint32_t len) {
+    uint32_t offset = 0;
+
+    while (offset < len) {
+        uint32_t room;
+
+        if (bt_obj.gatts_conn_id < 0) {
+            return false;
+        }
+        xEventGroupClearBits(bt_event_group, MOD_BT_GATTS_STREAM_EVT);
+        xSemaphoreTake(bt_stream.mutex, portMAX_DELAY);
+        bt_stream.chr = self;
+        room = MIN(BT_STREAM_RING_SIZE - (bt_stream.head - bt_stream.tail), len - offset);
+        for (uint32_t i = 0; i < room; i++) {
+            bt_stream.buf[(bt_stream.head + i) % BT_STREAM_RING_SIZE] = data[offset + i];
+        }
+        bt_stream.head += room;
+        xSemaphoreGive(bt_stream.mutex);
+        offset += room;
+
+        bt_stream_pump();
+        if (offset < len) {
+            MP_THREAD_GIL_EXIT();
+            xEventGroupWaitBits(bt_event_group, MOD_BT_GATTS_STREAM_EVT, true, false, 100 / portTICK_PERIOD_MS);
+            MP_THREAD_GIL_ENTER();
+        }
+    }
+    return true;
+}
+
+/// \method stream([data])
+STATIC mp_obj_t bt_characteristic_stream(mp_uint_t n_args, const mp_obj_t *args) {
+    bt_gatts_char_obj_t *self = args[0];
+
+    if (bt_stream.mutex == NULL) {
+        bt_stream.buf = heap_caps_malloc(BT_STREAM_RING_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (bt_stream.buf == NULL) {
+            bt_stream.buf = heap_caps_malloc(BT_STREAM_RING_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        if (bt_stream.buf == NULL) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, mpexception_os_resource_not_avaliable));
+        }
+        bt_stream.credits = BT_STREAM_CREDITS_MAX;
+        bt_stream.mutex = xSemaphoreCreateMutex();
+    }
+
+    if (n_args == 1) {
+        // bytes still waiting to be notified
+        return mp_obj_new_int_from_uint(bt_stream.head - bt_stream.tail);
+    }
+
+    if (bt_obj.gatts_conn_id < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "no client connected"));
+    } else if (bt_stream.chr != NULL && bt_stream.chr != self && bt_stream.head != bt_stream.tail) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+    }
+
+    mp_buffer_info_t bufinfo;
+    bool ok = true;
+    if (mp_get_buffer(args[1], &bufinfo, MP_BUFFER_READ)) {
+        ok = bt_stream_write(self, bufinfo.buf, bufinfo.len);
+    } else {
+        // an iterable of buffers
+        mp_obj_t iterable = mp_getiter(args[1], NULL);
+        mp_obj_t item;
+        while (ok && (item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+            mp_get_buffer_raise(item, &bufinfo, MP_BUFFER_READ);
+            ok = bt_stream_write(self, bufinfo.buf, bufinfo.len);
+        }
+    }
+    if (!ok) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "connection already closed"));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bt_characteristic_stream_obj, 1, 2, bt_characteristic_stream);
+
 STATIC const mp_map_elem_t bt_gatts_char_locals_dict_table[] = {
     // instance methods
     { MP_OBJ_NEW_QSTR(MP_QSTR_value),          (mp_obj_t)&bt_characteristic_value_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_callback),       (mp_obj_t)&bt_characteristic_callback_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_events),         (mp_obj_t)&bt_characteristic_events_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_config),         (mp_obj_t)&bt_characteristic_config_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stream),         (mp_obj_t)&bt_characteristic_stream_obj },
 };
 STATIC MP_DEFINE_CONST_DICT(bt_gatts_char_locals_dict, bt_gatts_char_locals_dict_table);
 
@@ -2093,6 +3094,24 @@ STATIC mp_obj_t bt_gatts_get_mtu(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_gatts_get_mtu_obj, bt_gatts_get_mtu);
 
+STATIC mp_obj_t bt_data_length(mp_obj_t self_in) {
+    STATIC const qstr bt_data_length_fields[] = {
+        MP_QSTR_tx_len, MP_QSTR_rx_len,
+    };
+    bt_obj_t * self =  (bt_obj_t *)self_in;
+
+    // nothing negotiated yet
+    if (self->data_length_tx == 0) {
+        return mp_const_none;
+    }
+
+    mp_obj_t tuple[2];
+    tuple[0] = mp_obj_new_int(self->data_length_tx);
+    tuple[1] = mp_obj_new_int(self->data_length_rx);
+    return mp_obj_new_attrtuple(bt_data_length_fields, 2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_data_length_obj, bt_data_length);
+
 STATIC const mp_map_elem_t bt_locals_dict_table[] = {
     // instance methods
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                    (mp_obj_t)&bt_init_obj },
@@ -2102,6 +3121,10 @@ STATIC const mp_map_elem_t bt_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_stop_scan),               (mp_obj_t)&bt_stop_scan_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_get_adv),                 (mp_obj_t)&bt_read_scan_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_get_advertisements),      (mp_obj_t)&bt_get_advertisements_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_get_advs_into),           (mp_obj_t)&bt_get_advs_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_scan_filter),             (mp_obj_t)&bt_scan_filter_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_event_stats),             (mp_obj_t)&bt_event_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_scan_stats),              (mp_obj_t)&bt_scan_stats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_resolve_adv_data),        (mp_obj_t)&bt_resolve_adv_data_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_connect),                 (mp_obj_t)&bt_connect_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_set_advertisement_params),(mp_obj_t)&bt_set_advertisement_params_obj },
@@ -2113,8 +3136,11 @@ STATIC const mp_map_elem_t bt_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_events),                  (mp_obj_t)&bt_events_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_disconnect_client),       (mp_obj_t)&bt_gatts_disconnect_client_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_modem_sleep),             (mp_obj_t)&bt_modem_sleep_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_coexistence),             (mp_obj_t)&bt_coexistence_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_coexistence_stats),       (mp_obj_t)&bt_coexistence_stats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_tx_power),                (mp_obj_t)&bt_tx_power_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_gatts_mtu),               (mp_obj_t)&bt_gatts_get_mtu_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_data_length),             (mp_obj_t)&bt_data_length_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_nvram_erase),             (mp_obj_t)&bt_nvram_erase_obj },
 
 
@@ -2167,6 +3193,9 @@ STATIC const mp_map_elem_t bt_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_NEW_ADV_EVENT),           MP_OBJ_NEW_SMALL_INT(MOD_BT_GATTC_ADV_EVT) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_CLIENT_CONNECTED),        MP_OBJ_NEW_SMALL_INT(MOD_BT_GATTS_CONN_EVT) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_CLIENT_DISCONNECTED),     MP_OBJ_NEW_SMALL_INT(MOD_BT_GATTS_DISCONN_EVT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_COEX_PREFER_WIFI),        MP_OBJ_NEW_SMALL_INT(ESP_COEX_PREFER_WIFI) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_COEX_PREFER_BT),          MP_OBJ_NEW_SMALL_INT(ESP_COEX_PREFER_BT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_COEX_BALANCE),            MP_OBJ_NEW_SMALL_INT(ESP_COEX_PREFER_BALANCE) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_CHAR_READ_EVENT),         MP_OBJ_NEW_SMALL_INT(MOD_BT_GATTS_READ_EVT) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_CHAR_WRITE_EVENT),        MP_OBJ_NEW_SMALL_INT(MOD_BT_GATTS_WRITE_EVT) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_CHAR_NOTIFY_EVENT),       MP_OBJ_NEW_SMALL_INT(MOD_BT_GATTC_NOTIFY_EVT) },
@@ -2357,9 +3386,16 @@ STATIC mp_obj_t bt_srv_characteristics(mp_obj_t self_in) {
                         chr->base.type = (mp_obj_t)&mod_bt_characteristic_type;
                         chr->service = self;
                         memcpy(&chr->characteristic, &char_elems[i], sizeof(esp_gattc_char_elem_t));
+                        // notifications carry up to the negotiated MTU - 3 bytes
+                        chr->value_size = MIN(MAX(self->connection->mtu, BT_MTU_SIZE_DEFAULT) - 3, BT_CHAR_VALUE_SIZE_MAX);
+                        chr->value = m_new(uint8_t, chr->value_size);
                         chr->value[0] = 0;
                         chr->value_len = 1;
                         mp_obj_list_append(&self->char_list, chr);
+                        if (!char_index_add(self->connection, chr)) {
+                            free(char_elems);
+                            mp_raise_OSError(MP_ENOMEM);
+                        }
                     }
                 }
                 free(char_elems);
@@ -2415,6 +3451,9 @@ STATIC mp_obj_t bt_char_read(mp_obj_t self_in) {
     bt_char_obj_t *self = self_in;
     bt_event_result_t bt_event;
 
+    if (self->pending) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+    }
     if (self->service->connection->conn_id >= 0) {
         xQueueReset(xScanQueue);
         bt_obj.busy = true;
@@ -2428,8 +3467,8 @@ STATIC mp_obj_t bt_char_read(mp_obj_t self_in) {
             mp_hal_delay_ms(5);
         }
         if (xQueueReceive(xScanQueue, &bt_event, (TickType_t)5)) {
-            memcpy(self->value, bt_event.read.value, bt_event.read.value_len);
-            self->value_len = bt_event.read.value_len;
+            self->value_len = MIN(bt_event.read.value_len, self->value_size);
+            memcpy(self->value, bt_event.read.value, self->value_len);
             return mp_obj_new_bytes(bt_event.read.value, bt_event.read.value_len);
         } else {
             nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
@@ -2495,6 +3534,9 @@ STATIC mp_obj_t bt_char_write(mp_obj_t self_in, mp_obj_t value) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(value, &bufinfo, MP_BUFFER_READ);
 
+    if (self->pending) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+    }
     if (self->service->connection->conn_id >= 0) {
         xQueueReset(xScanQueue);
         bt_obj.busy = true;
@@ -2528,6 +3570,88 @@ error:
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(bt_char_write_obj, bt_char_write);
 
+/*
+ * starts an asynchronous read, completed with CHAR_READ_EVENT and the new value()
+ */
+STATIC mp_obj_t bt_char_read_async(mp_obj_t self_in) {
+    bt_char_obj_t *self = self_in;
+
+    if (self->service->connection->conn_id < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "connection already closed"));
+    }
+    if (self->pending) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+    }
+
+    self->events &= ~MOD_BT_GATTC_READ_EVT;
+    self->pending = MOD_BT_GATTC_READ_EVT;
+    if (ESP_OK != esp_ble_gattc_read_char (bt_obj.gattc_if, self->service->connection->conn_id,
+                                           self->characteristic.char_handle,
+                                           ESP_GATT_AUTH_REQ_NONE)) {
+        self->pending = 0;
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_char_read_async_obj, bt_char_read_async);
+
+/*
+ * starts an asynchronous write with response, completed with CHAR_WRITE_EVENT
+ */
+STATIC mp_obj_t bt_char_write_async(mp_obj_t self_in, mp_obj_t value) {
+    bt_char_obj_t *self = self_in;
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(value, &bufinfo, MP_BUFFER_READ);
+
+    if (self->service->connection->conn_id < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "connection already closed"));
+    }
+    if (self->pending) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+    }
+
+    self->events &= ~MOD_BT_GATTC_WRITE_EVT;
+    self->pending = MOD_BT_GATTC_WRITE_EVT;
+    // the stack copies the value, the buffer can be reused immediately
+    if (ESP_OK != esp_ble_gattc_write_char (bt_obj.gattc_if, self->service->connection->conn_id,
+                                            self->characteristic.char_handle,
+                                            bufinfo.len,
+                                            bufinfo.buf,
+                                            ESP_GATT_WRITE_TYPE_RSP,
+                                            ESP_GATT_AUTH_REQ_NONE)) {
+        self->pending = 0;
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(bt_char_write_async_obj, bt_char_write_async);
+
+/*
+ * returns the events since the last call, CHAR_READ_EVENT | CHAR_WRITE_EVENT | CHAR_NOTIFY_EVENT
+ */
+STATIC mp_obj_t bt_char_events(mp_obj_t self_in) {
+    bt_char_obj_t *self = self_in;
+
+    int32_t events = self->events;
+    self->events = 0;
+    return mp_obj_new_int(events);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_char_events_obj, bt_char_events);
+
+/*
+ * returns None while an asynchronous operation is in flight, else the GATT status of the last one
+ */
+STATIC mp_obj_t bt_char_status(mp_obj_t self_in) {
+    bt_char_obj_t *self = self_in;
+
+    if (self->pending) {
+        return mp_const_none;
+    }
+    return mp_obj_new_int(self->status);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(bt_char_status_obj, bt_char_status);
+
 /// \method callback(trigger, handler, arg)
 STATIC mp_obj_t bt_char_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     STATIC const mp_arg_t allowed_args[] = {
@@ -2545,7 +3669,7 @@ STATIC mp_obj_t bt_char_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_
     // enable the callback
     if (args[0].u_obj != mp_const_none && args[1].u_obj != mp_const_none) {
         uint32_t trigger = mp_obj_get_int(args[0].u_obj);
-        if (trigger != MOD_BT_GATTC_NOTIFY_EVT) {
+        if (trigger == 0 || (trigger & ~(MOD_BT_GATTC_NOTIFY_EVT | MOD_BT_GATTC_READ_EVT | MOD_BT_GATTC_WRITE_EVT))) {
             nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid trigger"));
         }
         self->trigger = trigger;
@@ -2556,7 +3680,9 @@ STATIC mp_obj_t bt_char_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_
             self->handler_arg = args[2].u_obj;
         }
 
-        if (self->service->connection->conn_id >= 0) {
+        if (!(trigger & MOD_BT_GATTC_NOTIFY_EVT)) {
+            // only the asynchronous operations, nothing to subscribe to
+        } else if (self->service->connection->conn_id >= 0) {
             if (ESP_OK != esp_ble_gattc_register_for_notify (self->service->connection->gatt_if,
                                                              self->service->connection->srv_bda,
                                                              self->characteristic.char_handle)) {
@@ -2639,7 +3765,11 @@ STATIC const mp_map_elem_t bt_characteristic_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_read),                    (mp_obj_t)&bt_char_read_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_read_descriptor),         (mp_obj_t)&bt_char_read_descriptor_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_write),                   (mp_obj_t)&bt_char_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read_async),              (mp_obj_t)&bt_char_read_async_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write_async),             (mp_obj_t)&bt_char_write_async_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_callback),                (mp_obj_t)&bt_char_callback_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_events),                  (mp_obj_t)&bt_char_events_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_status),                  (mp_obj_t)&bt_char_status_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_value),                   (mp_obj_t)&bt_char_value_obj },
     // { MP_OBJ_NEW_QSTR(MP_QSTR_descriptors),             (mp_obj_t)&bt_char_descriptors_obj },
 };
@@ -26,7 +26,9 @@
  DECLARE FUNCTIONS
  ******************************************************************************/
 extern void modbt_init0(void);
+extern void modbt_init_resources(void);
 extern mp_obj_t bt_deinit(mp_obj_t self_in);
 extern void bt_resume(bool reconnect);
 void modbt_deinit(bool allow_reconnect);
+bool modbt_is_enabled(void);
 #endif  // MODBT_H_
@@ -12,6 +12,7 @@
 #include "py/obj.h"
 #include "py/runtime.h"
 #include "py/gc.h"
+#include "py/stream.h"
 
 #include "coap.h"
 #include "coap_list.h"
@@ -21,7 +22,12 @@
 #include "modusocket.h"
 #include "lwipsocket.h"
 #include "netutils.h"
+#include "mpirq.h"
 
+#include "lwip/sockets.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/semphr.h"
 
 
@@ -35,6 +41,18 @@
 #define MODCOAP_REQUEST_PUT     (0x02)
 #define MODCOAP_REQUEST_POST    (0x04)
 #define MODCOAP_REQUEST_DELETE  (0x08)
+#define MODCOAP_RESOURCE_BUCKETS    (64)   // must be a power of 2
+#define MODCOAP_BLOCK_SIZE_DEFAULT  (1024)
+#define MODCOAP_BLOCK_SIZE_MIN      (16)
+#define MODCOAP_BLOCK_SIZE_MAX      (1024)
+#define MODCOAP_BLOCK1_PAYLOAD_MAX  (64 * 1024)   // biggest payload a resource accepts in Block1 blocks
+#define MODCOAP_TOKEN_LENGTH_MAX    (8)
+#define MODCOAP_TASK_STACK_SIZE     (4096)
+#define MODCOAP_TASK_PRIORITY       (5)
+#define MODCOAP_TASK_WAIT_MS        (1000)  // longest wait for a message if nothing is to be retransmitted
+#define MODCOAP_MP_READ_WAIT_MS     (1000)  // wait for the interpreter to read a message before asking it again
+
+#define MODCOAP_BLOCK_SIZE(szx)     (1 << ((szx) + 4))
 
 /******************************************************************************
  DEFINE PRIVATE TYPES
@@ -45,21 +63,48 @@ typedef struct mod_coap_resource_obj_s {
     struct mod_coap_resource_obj_s* next;
     uint8_t* value;
     unsigned char* uri;
+    uint8_t* block1_value;      // payload of a PUT/POST collected from Block1 blocks so far
+    uint32_t block1_len;
     uint32_t max_age;
+    uint32_t value_len;
     uint16_t etag_value;
-    uint16_t value_len;
     uint8_t mediatype;
     bool etag;
 }mod_coap_resource_obj_t;
 
+// State of the block-wise transfer of the last request sent out
+typedef struct mod_coap_block_xfer_s {
+    coap_address_t dst_address;
+    coap_list_t* options;       // options of the request, repeated in every follow-up request
+    mp_obj_t payload;           // str/bytes or a stream the request payload is read from, MP_OBJ_NULL once it is sent
+    mp_obj_t response_stream;   // stream the response payload is written to, MP_OBJ_NULL to collect it in response
+    vstr_t response;
+    uint8_t* block;             // one block plus one byte read ahead from the payload stream
+    uint32_t block_len;
+    uint32_t offset;            // payload bytes sent out so far
+    uint32_t received;          // response bytes received so far
+    uint32_t block2_num;        // next Block2 block to be requested
+    unsigned int method;
+    uint16_t message_id;        // ID of the last request sent out
+    uint8_t token[MODCOAP_TOKEN_LENGTH_MAX];
+    uint8_t token_length;
+    uint8_t szx;
+    bool block1;                // the payload is sent in Block1 blocks
+    bool block2;                // Block2 option is put into the request
+    bool active;
+}mod_coap_block_xfer_t;
+
 typedef struct mod_coap_obj_s {
     mp_obj_base_t base;
     coap_context_t* context;
     mod_network_socket_obj_t* socket;
-    mod_coap_resource_obj_t* resources;
+    mod_coap_resource_obj_t* resources[MODCOAP_RESOURCE_BUCKETS];
     SemaphoreHandle_t semphr;
     mp_obj_t callback;
     coap_list_t *optlist;
+    mod_coap_block_xfer_t xfer;
+    TaskHandle_t task;          // serves the socket if a dedicated task is used, NULL otherwise
+    uint8_t block_szx;          // the biggest block size used as a server and by default as a client
 }mod_coap_obj_t;
 
 
@@ -67,12 +112,15 @@ typedef struct mod_coap_obj_s {
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
+STATIC mod_coap_resource_obj_t** resource_bucket(const coap_key_t key);
 STATIC mod_coap_resource_obj_t* find_resource(coap_resource_t* resource);
 STATIC mod_coap_resource_obj_t* find_resource_by_key(coap_key_t key);
-STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint8_t max_age, mp_obj_t value, bool etag);
+STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint8_t max_age, mp_obj_t value, bool etag, bool observable, bool notify_con);
 STATIC void remove_resource_by_key(coap_key_t key);
 STATIC void remove_resource(const char* uri);
 STATIC void resource_update_value(mod_coap_resource_obj_t* resource, mp_obj_t new_value);
+STATIC int resource_collect_block1(mod_coap_resource_obj_t* resource_obj, coap_pdu_t* request, coap_pdu_t* response, coap_block_t* block, size_t* size, unsigned char** data);
+STATIC void resource_release_block1(mod_coap_resource_obj_t* resource_obj);
 
 STATIC void coap_resource_callback_get(coap_context_t * context,
                                        struct coap_resource_t * resource,
@@ -129,6 +177,13 @@ STATIC coap_pdu_t * modcoap_new_request(coap_context_t *ctx,
                                         const char *data,
                                         size_t length);
 STATIC coap_list_t * modcoap_new_option_node(unsigned short key, unsigned int length, unsigned char *data);
+STATIC void modcoap_add_block_option(coap_pdu_t* pdu, unsigned short type, const coap_block_t* block);
+STATIC uint8_t modcoap_block_szx(mp_int_t block_size);
+STATIC void modcoap_xfer_release(mod_coap_block_xfer_t* xfer);
+STATIC coap_tid_t modcoap_xfer_send(mod_coap_block_xfer_t* xfer);
+STATIC int modcoap_peek_code(void);
+STATIC void modcoap_read_in_mp(void* arg);
+STATIC void TASK_CoAP(void *pvParameters);
 /******************************************************************************
  DEFINE PRIVATE VARIABLES
  ******************************************************************************/
@@ -140,16 +195,21 @@ STATIC bool initialized = false;
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
+// Get the bucket of the resource index the key belongs to
+STATIC mod_coap_resource_obj_t** resource_bucket(const coap_key_t key) {
+    // The key is already a hash of the Uri, its bytes are spread well enough to be used directly
+    uint32_t hash = ((uint32_t)key[0] << 24) | ((uint32_t)key[1] << 16) | ((uint32_t)key[2] << 8) | key[3];
+    return &coap_obj_ptr->resources[hash & (MODCOAP_RESOURCE_BUCKETS - 1)];
+}
+
 // Get the resource if exists
 STATIC mod_coap_resource_obj_t* find_resource(coap_resource_t* resource) {
 
-    if(coap_obj_ptr->resources != NULL) {
-        mod_coap_resource_obj_t* current = coap_obj_ptr->resources;
-        for(; current != NULL; current = current->next) {
-            // The hash key is generated from Uri
-            if(memcmp(current->coap_resource->key, resource->key, sizeof(current->coap_resource->key)) == 0) {
-                return current;
-            }
+    mod_coap_resource_obj_t* current = *resource_bucket(resource->key);
+    for(; current != NULL; current = current->next) {
+        // The hash key is generated from Uri
+        if(memcmp(current->coap_resource->key, resource->key, sizeof(coap_key_t)) == 0) {
+            return current;
         }
     }
     return NULL;
@@ -158,13 +218,11 @@ STATIC mod_coap_resource_obj_t* find_resource(coap_resource_t* resource) {
 // Get the resource if exists by its key
 STATIC mod_coap_resource_obj_t* find_resource_by_key(coap_key_t key) {
 
-    if(coap_obj_ptr->resources != NULL) {
-        mod_coap_resource_obj_t* current = coap_obj_ptr->resources;
-        for(; current != NULL; current = current->next) {
-            // The hash key is generated from Uri
-            if(memcmp(current->coap_resource->key, key, sizeof(current->coap_resource->key)) == 0) {
-                return current;
-            }
+    mod_coap_resource_obj_t* current = *resource_bucket(key);
+    for(; current != NULL; current = current->next) {
+        // The hash key is generated from Uri
+        if(memcmp(current->coap_resource->key, key, sizeof(coap_key_t)) == 0) {
+            return current;
         }
     }
     return mp_const_none;
@@ -172,7 +230,7 @@ STATIC mod_coap_resource_obj_t* find_resource_by_key(coap_key_t key) {
 
 
 // Create a new resource in the scope of the only context
-STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint8_t max_age, mp_obj_t value, bool etag) {
+STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype, uint8_t max_age, mp_obj_t value, bool etag, bool observable, bool notify_con) {
 
     // Currently only 1 context is supported
     mod_coap_obj_t* context = coap_obj_ptr;
@@ -180,16 +238,13 @@ STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype,
     coap_key_t key;
     (void)coap_hash_path((const unsigned char*)uri, strlen(uri), key);
 
-    // Check if there is at least 1 resource
-    if(context->resources != NULL) {
-        mod_coap_resource_obj_t* current = context->resources;
-        // Iterate through the resources and check whether the new one exists
-        for(; current != NULL; current = current->next) {
-            // The hash key is generated from Uri
-            if(memcmp(key, current->coap_resource->key, sizeof(key)) == 0) {
-                // Resource already exists
-                return NULL;
-            }
+    // Only the resources sharing the bucket can have the same key
+    mod_coap_resource_obj_t** bucket = resource_bucket(key);
+    for(mod_coap_resource_obj_t* current = *bucket; current != NULL; current = current->next) {
+        // The hash key is generated from Uri
+        if(memcmp(key, current->coap_resource->key, sizeof(key)) == 0) {
+            // Resource already exists
+            return NULL;
         }
     }
 
@@ -207,12 +262,19 @@ STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype,
 
     // No next elem
     resource->next = NULL;
+    resource->value = NULL;
+    resource->block1_value = NULL;
+    resource->block1_len = 0;
 
     // uri parameter pointer will be destroyed, pass a pointer to a permanent location
-    resource->uri = m_malloc(strlen(uri));
-    memcpy(resource->uri, uri, strlen(uri));
-    resource->coap_resource = coap_resource_init((const unsigned char* )resource->uri, strlen(uri), 0);
+    size_t uri_len = strlen(uri);
+    resource->uri = m_malloc(uri_len + 1);
+    memcpy(resource->uri, uri, uri_len + 1);
+    // Notifications are sent as non-confirmable messages unless asked otherwise, libcoap still confirms every few of them
+    resource->coap_resource = coap_resource_init((const unsigned char* )resource->uri, uri_len, notify_con ? COAP_RESOURCE_FLAGS_NOTIFY_CON : COAP_RESOURCE_FLAGS_NOTIFY_NON);
     if(resource->coap_resource != NULL) {
+        resource->coap_resource->observable = observable ? 1 : 0;
+
         // Add the resource to the Coap context
         coap_add_resource(context->context, resource->coap_resource);
 
@@ -223,18 +285,9 @@ STATIC mod_coap_resource_obj_t* add_resource(const char* uri, uint8_t mediatype,
         // Initialize default value
         resource_update_value(resource, value);
 
-        // Add the resource to our context
-        if(context->resources == NULL) {
-            // No resource exists, add as first element
-            context->resources = resource;
-        }
-        else {
-            mod_coap_resource_obj_t* current = context->resources;
-            // Find the last resource
-            for(; current->next != NULL; current = current->next) {}
-            // Append the new resource to the end of the list
-            current->next = resource;
-        }
+        // Add the resource to our context, in front of its bucket
+        resource->next = *bucket;
+        *bucket = resource;
 
         return resource;
     }
@@ -255,44 +308,27 @@ STATIC void remove_resource_by_key(coap_key_t key) {
     // Currently only 1 context is supported
     mod_coap_obj_t* context = coap_obj_ptr;
 
-    if(context->resources != NULL) {
-        mod_coap_resource_obj_t* current = context->resources;
-        mod_coap_resource_obj_t* previous = context->resources;
-        for(; current != NULL; current = current->next) {
-
-            // The hash key is generated from Uri
-            if(memcmp(current->coap_resource->key, key, sizeof(coap_key_t)) == 0) {
-                // Resource found, remove from the list
-                // Check if it is the first element in the list
-                if(context->resources == current) {
-                    // If no more element in the list then invalidate the list
-                    if(current->next == NULL) {
-                        context->resources = NULL;
-                    }
-                    // Other elements are in the list
-                    else {
-                        context->resources = current->next;
-                    }
-                }
-                else {
-                    // It is not the first element
-                    previous->next = current->next;
-                }
-
-                // Free the URI
-                m_free(current->uri);
-                // Free the resource in coap's scope
-                coap_delete_resource(context->context, key);
-                // Free the element in MP scope
-                m_free(current->value);
-                // Free the resource itself
-                m_free(current);
-
-                return;
-            }
-
-            // Mark the current element as previous, needed when removing the actual current element from the list
-            previous = current;
+    // Walk the links of the bucket so the element can be unlinked wherever it is in the chain
+    for(mod_coap_resource_obj_t** link = resource_bucket(key); *link != NULL; link = &(*link)->next) {
+        mod_coap_resource_obj_t* current = *link;
+
+        // The hash key is generated from Uri
+        if(memcmp(current->coap_resource->key, key, sizeof(coap_key_t)) == 0) {
+            // Resource found, remove from the bucket
+            *link = current->next;
+
+            // Free the URI
+            m_free(current->uri);
+            // Free the resource in coap's scope
+            coap_delete_resource(context->context, key);
+            // Free the element in MP scope
+            m_free(current->value);
+            // Free the payload of an unfinished Block1 transfer
+            m_free(current->block1_value);
+            // Free the resource itself
+            m_free(current);
+
+            return;
         }
     }
 }
@@ -348,6 +384,73 @@ STATIC void resource_update_value(mod_coap_resource_obj_t* resource, mp_obj_t ne
         resource->value = m_malloc(resource->value_len);
         memcpy(resource->value, value_bufinfo.buf, resource->value_len);
     }
+
+    // The observers are notified by the next coap_check_notify()
+    if(resource->coap_resource->observable == 1) {
+        resource->coap_resource->dirty = 1;
+    }
+}
+
+// Collect the payload of a PUT/POST request sent in Block1 blocks
+// Returns 0 if the request is not block-wise, 1 if the whole payload is collected and -1 if the response is already composed
+STATIC int resource_collect_block1(mod_coap_resource_obj_t* resource_obj, coap_pdu_t* request, coap_pdu_t* response, coap_block_t* block, size_t* size, unsigned char** data) {
+
+    if(coap_get_block(request, COAP_OPTION_BLOCK1, block) == 0) {
+        return 0;
+    }
+
+    size_t len = 0;
+    unsigned char* buf = NULL;
+    (void)coap_get_data(request, &len, &buf);
+
+    // The blocks must arrive in order, the first one (re)starts the transfer
+    uint32_t offset = block->num << (block->szx + 4);
+    if(block->num == 0) {
+        resource_obj->block1_len = 0;
+    }
+
+    if(offset != resource_obj->block1_len) {
+        // 4.08 Request Entity Incomplete: a block is missing
+        response->hdr->code = COAP_RESPONSE_CODE(408);
+    }
+    else if((offset + len) > MODCOAP_BLOCK1_PAYLOAD_MAX) {
+        // 4.13 Request Entity Too Large
+        response->hdr->code = COAP_RESPONSE_CODE(413);
+    }
+    else {
+        resource_obj->block1_value = m_renew(uint8_t, resource_obj->block1_value, resource_obj->block1_len, offset + len);
+        memcpy(&resource_obj->block1_value[offset], buf, len);
+        resource_obj->block1_len = offset + len;
+
+        // A smaller size in the response makes the client continue with smaller blocks
+        if(block->szx > coap_obj_ptr->block_szx) {
+            block->szx = coap_obj_ptr->block_szx;
+        }
+
+        if(block->m == 1) {
+            // 2.31 Continue: the block is stored, waiting for the next one
+            response->hdr->code = COAP_RESPONSE_CODE(231);
+            modcoap_add_block_option(response, COAP_OPTION_BLOCK1, block);
+            return -1;
+        }
+
+        *data = resource_obj->block1_value;
+        *size = resource_obj->block1_len;
+        return 1;
+    }
+
+    // The transfer cannot be finished, drop what has been collected
+    resource_release_block1(resource_obj);
+    const char* error_message = coap_response_phrase(response->hdr->code);
+    coap_add_data(response, strlen(error_message), (unsigned char *)error_message);
+    return -1;
+}
+
+// Free the payload collected from Block1 blocks
+STATIC void resource_release_block1(mod_coap_resource_obj_t* resource_obj) {
+    m_free(resource_obj->block1_value);
+    resource_obj->block1_value = NULL;
+    resource_obj->block1_len = 0;
 }
 
 
@@ -366,8 +469,10 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
     // Check if the resource exists. (e.g.: has not been removed in the background before we got the semaphore in mod_coap_read())
     if(resource_obj != NULL) {
 
+        // No request is given when the GET handler composes a notification for an observer
+
         // Check if media type of the resource is given
-        if(resource_obj->mediatype != -1) {
+        if((request != NULL) && (resource_obj->mediatype != -1)) {
             coap_opt_iterator_t opt_it;
             // Need to check if ACCEPT option is specified and we can serve it
             coap_opt_t *opt = coap_check_option(request, COAP_OPTION_ACCEPT, &opt_it);
@@ -395,7 +500,7 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
         response->hdr->code = COAP_RESPONSE_CODE(205);
 
         // Check if ETAG value is maintained for the resource
-        if(resource_obj->etag == true) {
+        if((request != NULL) && (resource_obj->etag == true)) {
 
             coap_opt_iterator_t opt_it;
             // Need to check if E-TAG option is specified and we can serve it
@@ -418,6 +523,47 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
             }
         }
 
+        // Serve the value in Block2 blocks if the client asked for a block or the value does not fit into one
+        coap_block_t block;
+        bool blockwise = (request != NULL) && (coap_get_block(request, COAP_OPTION_BLOCK2, &block) == 1);
+        if(blockwise == false) {
+            block.szx = coap_obj_ptr->block_szx;
+            blockwise = (resource_obj->value_len > MODCOAP_BLOCK_SIZE(block.szx));
+        }
+
+        if(blockwise == true) {
+            // Never send bigger blocks than configured, the client continues with the size of the response
+            if(block.szx > coap_obj_ptr->block_szx) {
+                block.num <<= (block.szx - coap_obj_ptr->block_szx);
+                block.szx = coap_obj_ptr->block_szx;
+            }
+
+            uint32_t offset = block.num << (block.szx + 4);
+            if((offset > 0) && (offset >= resource_obj->value_len)) {
+                // 4.02 Bad Option: the requested block is beyond the end of the value
+                response->hdr->code = COAP_RESPONSE_CODE(402);
+                const char* error_message = coap_response_phrase(response->hdr->code);
+                coap_add_data(response, strlen(error_message), (unsigned char *)error_message);
+                return;
+            }
+            block.m = ((offset + MODCOAP_BLOCK_SIZE(block.szx)) < resource_obj->value_len) ? 1 : 0;
+        }
+
+        // Register or deregister the observer if the client asked for it
+        if((request != NULL) && (resource->observable == 1)) {
+            coap_opt_iterator_t opt_it;
+            coap_opt_t *opt = coap_check_option(request, COAP_OPTION_OBSERVE, &opt_it);
+            if(opt != NULL) {
+                unsigned int observe = coap_decode_var_bytes(coap_opt_value(opt), coap_opt_length(opt));
+                if(observe == 0) {
+                    (void)coap_add_observer(resource, endpoint, address, token);
+                }
+                else if(observe == 1) {
+                    (void)coap_delete_observer(resource, address, token);
+                }
+            }
+        }
+
         // Add the options if configured
         unsigned char buf[3];
 
@@ -425,6 +571,11 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
             coap_add_option(response, COAP_OPTION_ETAG, coap_encode_var_bytes(buf, resource_obj->etag_value), buf);
         }
 
+        // Responses and notifications to observers carry the sequence number of the notification, it is 24 bits long
+        if(coap_find_observer(resource, address, token) != NULL) {
+            coap_add_option(response, COAP_OPTION_OBSERVE, coap_encode_var_bytes(buf, context->observe & 0xFFFFFF), buf);
+        }
+
         if(resource_obj->mediatype != -1) {
             coap_add_option(response, COAP_OPTION_CONTENT_TYPE, coap_encode_var_bytes(buf, resource_obj->mediatype), buf);
         }
@@ -433,9 +584,18 @@ STATIC void coap_resource_callback_get(coap_context_t * context,
             coap_add_option(response, COAP_OPTION_MAXAGE, coap_encode_var_bytes(buf, resource_obj->max_age), buf);
         }
 
+        if(blockwise == true) {
+            modcoap_add_block_option(response, COAP_OPTION_BLOCK2, &block);
+        }
+
         // Add the data itself if updated
         if(response->hdr->code == COAP_RESPONSE_CODE(205)) {
-            coap_add_data(response, resource_obj->value_len, (unsigned char *)resource_obj->value);
+            if(blockwise == true) {
+                coap_add_block(response, resource_obj->value_len, (unsigned char *)resource_obj->value, block.num, block.szx);
+            }
+            else {
+                coap_add_data(response, resource_obj->value_len, (unsigned char *)resource_obj->value);
+            }
         }
     }
     else {
@@ -524,10 +684,20 @@ STATIC void coap_resource_callback_put(coap_context_t * context,
             // Update the data and set response code and add E-Tag option if needed
             size_t size;
             unsigned char *data;
-            int ret = coap_get_data(request, &size, &data);
+            coap_block_t block;
+            int ret = resource_collect_block1(resource_obj, request, response, &block, &size, &data);
+            if(ret < 0) {
+                // More blocks are expected or the transfer failed, the response is already composed
+                return;
+            }
+            bool blockwise = (ret == 1);
+            if(blockwise == false) {
+                ret = coap_get_data(request, &size, &data);
+            }
             if(ret == 1) {
                 mp_obj_t new_value = mp_obj_new_str((const char*)data, size);
                 resource_update_value(resource_obj, new_value);
+                resource_release_block1(resource_obj);
 
                 // Value is updated
                 response->hdr->code = COAP_RESPONSE_CODE(204);
@@ -537,6 +707,11 @@ STATIC void coap_resource_callback_put(coap_context_t * context,
                 if(resource_obj->etag == true) {
                     coap_add_option(response, COAP_OPTION_ETAG, coap_encode_var_bytes(buf, resource_obj->etag_value), buf);
                 }
+
+                // Acknowledge the last block
+                if(blockwise == true) {
+                    modcoap_add_block_option(response, COAP_OPTION_BLOCK1, &block);
+                }
             }
             else {
                 // 5.00 Internal Server error occurred
@@ -606,10 +781,20 @@ STATIC void coap_resource_callback_post(coap_context_t * context,
         // Update the data and set response code and add E-Tag option if needed
         size_t size;
         unsigned char *data;
-        int ret = coap_get_data(request, &size, &data);
+        coap_block_t block;
+        int ret = resource_collect_block1(resource_obj, request, response, &block, &size, &data);
+        if(ret < 0) {
+            // More blocks are expected or the transfer failed, the response is already composed
+            return;
+        }
+        bool blockwise = (ret == 1);
+        if(blockwise == false) {
+            ret = coap_get_data(request, &size, &data);
+        }
         if(ret == 1) {
             mp_obj_t new_value = mp_obj_new_str((const char*)data, size);
             resource_update_value(resource_obj, new_value);
+            resource_release_block1(resource_obj);
 
             // Value is updated
             response->hdr->code = COAP_RESPONSE_CODE(204);
@@ -619,6 +804,11 @@ STATIC void coap_resource_callback_post(coap_context_t * context,
             if(resource_obj->etag == true) {
                 coap_add_option(response, COAP_OPTION_ETAG, coap_encode_var_bytes(buf, resource_obj->etag_value), buf);
             }
+
+            // Acknowledge the last block
+            if(blockwise == true) {
+                modcoap_add_block_option(response, COAP_OPTION_BLOCK1, &block);
+            }
         }
         else {
             // 5.00 Internal Server error occurred
@@ -669,15 +859,89 @@ STATIC void coap_response_handler(struct coap_context_t * context,
     size_t len;
     unsigned char *databuf;
     int ret = coap_get_data(received, &len, &databuf);
+    if(ret == 0) {
+        len = 0;
+    }
+    mp_obj_t payload = (ret == 1) ? mp_obj_new_bytes(databuf, len) : MP_OBJ_NULL;
+
+    mod_coap_block_xfer_t* xfer = &coap_obj_ptr->xfer;
+
+    // Continue the block-wise transfer if the response belongs to its request
+    if((xfer->active == true) &&
+       (received->hdr->token_length == xfer->token_length) &&
+       (memcmp(received->hdr->token, xfer->token, xfer->token_length) == 0)) {
+
+        coap_block_t block;
+
+        if((xfer->payload != MP_OBJ_NULL) && (coap_get_block(received, COAP_OPTION_BLOCK1, &block) == 1)) {
+            // 2.31 Continue: the server stored the block, send the next one
+            if(received->hdr->code == COAP_RESPONSE_CODE(231)) {
+                // Continue with smaller blocks if the server asked for it
+                if(block.szx < xfer->szx) {
+                    xfer->szx = block.szx;
+                }
+                if(modcoap_xfer_send(xfer) != COAP_INVALID_TID) {
+                    return;
+                }
+            }
+        }
+        // The final response of a block-wise upload is reported even without payload
+        if((xfer->block1 == true) && (payload == MP_OBJ_NULL)) {
+            payload = mp_const_empty_bytes;
+        }
+        // The payload has been sent out, the follow-up requests of the response do not repeat it
+        xfer->payload = MP_OBJ_NULL;
+
+        if((COAP_RESPONSE_CLASS(received->hdr->code) == 2) && (coap_get_block(received, COAP_OPTION_BLOCK2, &block) == 1)) {
+            // Store the block only once even if the server sent it again
+            uint32_t offset = block.num << (block.szx + 4);
+            if(offset == xfer->received) {
+                if(xfer->response_stream != MP_OBJ_NULL) {
+                    int errcode;
+                    mp_stream_rw(xfer->response_stream, databuf, len, &errcode, MP_STREAM_RW_WRITE);
+                    if(errcode != 0) {
+                        // The payload cannot be stored, the rest of the blocks are not requested
+                        block.m = 0;
+                    }
+                }
+                else {
+                    vstr_add_strn(&xfer->response, (const char*)databuf, len);
+                }
+                xfer->received += len;
+            }
+
+            if(block.m == 1) {
+                // Request the next block with the size the server uses
+                xfer->szx = block.szx;
+                xfer->block2 = true;
+                xfer->block2_num = xfer->received >> (block.szx + 4);
+                if(modcoap_xfer_send(xfer) != COAP_INVALID_TID) {
+                    return;
+                }
+            }
+
+            // The whole payload is received, None is given if it has been written to the stream
+            if(xfer->response_stream != MP_OBJ_NULL) {
+                payload = mp_const_none;
+            }
+            else {
+                payload = mp_obj_new_str_from_vstr(&mp_type_bytes, &xfer->response);
+                xfer->response.buf = NULL;
+            }
+        }
 
-    if(ret == 1){
+        // The transfer is finished
+        modcoap_xfer_release(xfer);
+    }
+
+    if((payload != MP_OBJ_NULL) && (coap_obj_ptr->callback != MP_OBJ_NULL)) {
 
         mp_obj_t args[5];
         args[0] = mp_obj_new_int(received->hdr->code);
         args[1] = mp_obj_new_int(received->hdr->id);
         args[2] = mp_obj_new_int(received->hdr->type);
         args[3] = mp_obj_new_bytes(received->hdr->token, received->hdr->token_length);
-        args[4] = mp_obj_new_bytes(databuf, len);
+        args[4] = payload;
 
         // Call the registered function, it must have 5 parameters:
         mp_call_function_n_kw(coap_obj_ptr->callback, 5, 0, args);
@@ -764,6 +1028,202 @@ STATIC coap_list_t * modcoap_new_option_node(unsigned short key, unsigned int le
     return node;
 }
 
+// Helper function to add a Block1 or Block2 option, libcoap composes only Block2 options on its own
+STATIC void modcoap_add_block_option(coap_pdu_t* pdu, unsigned short type, const coap_block_t* block) {
+
+    unsigned char buf[3];
+    coap_add_option(pdu, type, coap_encode_var_bytes(buf, (block->num << 4) | (block->m << 3) | block->szx), buf);
+}
+
+// Helper function to get the SZX exponent of a block size
+STATIC uint8_t modcoap_block_szx(mp_int_t block_size) {
+
+    uint8_t szx = 0;
+    for(mp_int_t size = MODCOAP_BLOCK_SIZE_MIN; size <= MODCOAP_BLOCK_SIZE_MAX; size <<= 1, szx++) {
+        if(size == block_size) {
+            return szx;
+        }
+    }
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Invalid \"block_size\" parameter value!"));
+
+    // Just for the compiler
+    return 0;
+}
+
+// Helper function to release everything held by the block-wise transfer
+STATIC void modcoap_xfer_release(mod_coap_block_xfer_t* xfer) {
+
+    struct coap_list_t *next;
+    while(xfer->options != NULL) {
+        next = xfer->options->next;
+        xfer->options->next = NULL;
+        m_free(xfer->options);
+        xfer->options = next;
+    }
+
+    if(xfer->response.buf != NULL) {
+        vstr_clear(&xfer->response);
+    }
+
+    m_free(xfer->block);
+    xfer->block = NULL;
+    xfer->payload = MP_OBJ_NULL;
+    xfer->response_stream = MP_OBJ_NULL;
+    xfer->active = false;
+}
+
+// Helper function to send the next request of the block-wise transfer
+STATIC coap_tid_t modcoap_xfer_send(mod_coap_block_xfer_t* xfer) {
+
+    coap_pdu_t *pdu = modcoap_new_request(coap_obj_ptr->context, xfer->method, &xfer->options, (const char*)xfer->token, xfer->token_length, NULL, 0);
+    if(pdu == NULL) {
+        return COAP_INVALID_TID;
+    }
+
+    if(xfer->block2 == true) {
+        coap_block_t block2 = { .num = xfer->block2_num, .m = 0, .szx = xfer->szx };
+        modcoap_add_block_option(pdu, COAP_OPTION_BLOCK2, &block2);
+    }
+
+    if(xfer->payload != MP_OBJ_NULL) {
+        uint32_t block_size = MODCOAP_BLOCK_SIZE(xfer->szx);
+        const uint8_t* data;
+        uint32_t len;
+        bool more;
+
+        if(xfer->block != NULL) {
+            // Read one byte more than a block from the stream to know whether this is the last block
+            if(xfer->block_len <= block_size) {
+                int errcode;
+                xfer->block_len += mp_stream_rw(xfer->payload, &xfer->block[xfer->block_len], block_size + 1 - xfer->block_len, &errcode, MP_STREAM_RW_READ);
+                if(errcode != 0) {
+                    coap_delete_pdu(pdu);
+                    return COAP_INVALID_TID;
+                }
+            }
+            data = xfer->block;
+            more = (xfer->block_len > block_size);
+            len = more ? block_size : xfer->block_len;
+        }
+        else {
+            size_t payload_len;
+            data = (const uint8_t*)mp_obj_str_get_data(xfer->payload, &payload_len) + xfer->offset;
+            more = ((payload_len - xfer->offset) > block_size);
+            len = more ? block_size : (payload_len - xfer->offset);
+        }
+
+        if(xfer->block1 == true) {
+            coap_block_t block1 = { .num = xfer->offset >> (xfer->szx + 4), .m = more, .szx = xfer->szx };
+            modcoap_add_block_option(pdu, COAP_OPTION_BLOCK1, &block1);
+        }
+
+        if(len > 0) {
+            coap_add_data(pdu, len, data);
+        }
+
+        // The block is part of the PDU now, retransmissions are done by libcoap
+        xfer->offset += len;
+        if(xfer->block != NULL) {
+            xfer->block_len -= len;
+            memmove(xfer->block, &xfer->block[len], xfer->block_len);
+        }
+    }
+
+    xfer->message_id = pdu->hdr->id;
+    return coap_send_confirmed(coap_obj_ptr->context, coap_obj_ptr->context->endpoint, &xfer->dst_address, pdu);
+}
+
+// Get the code of the next message waiting on the socket without removing or waiting for it, -1 if there is none
+STATIC int modcoap_peek_code(void) {
+
+    uint8_t hdr[2];
+    int n = lwip_recvfrom_r(coap_obj_ptr->context->sockfd, hdr, sizeof(hdr), MSG_PEEK | MSG_DONTWAIT, NULL, NULL);
+    if(n < 0) {
+        return -1;
+    }
+    // A message too short to have a code is read as an empty one, libcoap drops it
+    return (n == sizeof(hdr)) ? hdr[1] : 0;
+}
+
+// Read the next message in the context of the interpreter, queued by the CoAP task
+STATIC void modcoap_read_in_mp(void* arg) {
+
+    xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
+
+    nlr_buf_t nlr;
+    if(nlr_push(&nlr) == 0) {
+        // The message may have been read already if the task asked more than once
+        if(modcoap_peek_code() >= 0) {
+            coap_read(coap_obj_ptr->context);
+            coap_check_notify(coap_obj_ptr->context);
+        }
+        nlr_pop();
+    }
+    else {
+        // An exception of the response callback must not leave the context locked
+        mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+    }
+
+    xSemaphoreGive(coap_obj_ptr->semphr);
+    xTaskNotifyGive(coap_obj_ptr->task);
+}
+
+// Serve the socket without waiting for coap.read(), GET requests and empty messages are handled without the interpreter
+STATIC void TASK_CoAP(void *pvParameters) {
+
+    coap_context_t* ctx = coap_obj_ptr->context;
+
+    for (;;) {
+        uint32_t wait_ms = MODCOAP_TASK_WAIT_MS;
+
+        xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
+
+        // Retransmit the confirmable messages not acknowledged in time
+        coap_tick_t now;
+        coap_ticks(&now);
+        coap_queue_t* next = coap_peek_next(ctx);
+        while((next != NULL) && (next->t <= (now - ctx->sendqueue_basetime))) {
+            coap_retransmit(ctx, coap_pop_next(ctx));
+            next = coap_peek_next(ctx);
+        }
+        if(next != NULL) {
+            // The time of the head of the queue is relative to the base time
+            wait_ms = MIN(wait_ms, (((ctx->sendqueue_basetime + next->t - now) * 1000) / COAP_TICKS_PER_SECOND) + 1);
+        }
+
+        // Retry the notifications which could not be sent out
+        coap_check_notify(ctx);
+
+        xSemaphoreGive(coap_obj_ptr->semphr);
+
+        // Block on the socket until a message arrives or the next retransmission is due
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(ctx->sockfd, &rfds);
+        struct timeval tv = { .tv_sec = wait_ms / 1000, .tv_usec = (wait_ms % 1000) * 1000 };
+        if(lwip_select(ctx->sockfd + 1, &rfds, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+
+        xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
+        // Python could have read the message in the meantime
+        int code = modcoap_peek_code();
+        bool native = (code == 0) || (code == COAP_REQUEST_GET);
+        if(native == true) {
+            // The GET handler only copies the stored value into the response, ACKs and RSTs are handled by libcoap
+            coap_read(ctx);
+        }
+        xSemaphoreGive(coap_obj_ptr->semphr);
+
+        if((code >= 0) && (native == false)) {
+            // Updates of the values and the responses to our requests need the heap of the interpreter or call into Python
+            mp_irq_queue_interrupt_non_ISR(modcoap_read_in_mp, NULL);
+            // The message stays on the socket until the interpreter reads it
+            (void)ulTaskNotifyTake(pdTRUE, MODCOAP_MP_READ_WAIT_MS / portTICK_PERIOD_MS);
+        }
+    }
+}
+
 /******************************************************************************
  DEFINE COAP RESOURCE CLASS FUNCTIONS
  ******************************************************************************/
@@ -807,6 +1267,7 @@ STATIC mp_obj_t mod_coap_resource_value(mp_uint_t n_args, const mp_obj_t *args)
         } else {
             // set
             resource_update_value(self, (mp_obj_t)args[1]);
+            coap_check_notify(coap_obj_ptr->context);
         }
     }
     xSemaphoreGive(coap_obj_ptr->semphr);
@@ -929,6 +1390,8 @@ STATIC const mp_arg_t mod_coap_init_args[] = {
         { MP_QSTR_address,                  MP_ARG_OBJ  | MP_ARG_REQUIRED, },
         { MP_QSTR_port,                     MP_ARG_OBJ  | MP_ARG_KW_ONLY, {.u_int = MODCOAP_DEFAULT_PORT}},
         { MP_QSTR_service_discovery,        MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false}},
+        { MP_QSTR_block_size,               MP_ARG_INT  | MP_ARG_KW_ONLY, {.u_int = MODCOAP_BLOCK_SIZE_DEFAULT}},
+        { MP_QSTR_dedicated_task,           MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false}},
 };
 
 // Initialize the module
@@ -941,13 +1404,20 @@ STATIC mp_obj_t mod_coap_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
         MP_STATE_PORT(coap_ptr) = m_malloc(sizeof(mod_coap_obj_t));
         coap_obj_ptr = MP_STATE_PORT(coap_ptr);
         coap_obj_ptr->context = NULL;
-        coap_obj_ptr->resources = NULL;
+        memset(coap_obj_ptr->resources, 0, sizeof(coap_obj_ptr->resources));
         coap_obj_ptr->socket = NULL;
         coap_obj_ptr->semphr = NULL;
+        coap_obj_ptr->callback = MP_OBJ_NULL;
+        coap_obj_ptr->optlist = NULL;
+        coap_obj_ptr->task = NULL;
+        memset(&coap_obj_ptr->xfer, 0, sizeof(coap_obj_ptr->xfer));
 
         mp_arg_val_t args[MP_ARRAY_SIZE(mod_coap_init_args)];
         mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), mod_coap_init_args, args);
 
+        // Get the biggest block size of block-wise transfers
+        coap_obj_ptr->block_szx = modcoap_block_szx(args[3].u_int);
+
         mp_obj_t list = mp_obj_new_list(0, NULL);
         // Get the address as a string
         mp_obj_list_append(list, args[0].u_obj);
@@ -958,9 +1428,17 @@ STATIC mp_obj_t mod_coap_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
 
         mod_coap_init_helper(list, service_discovery);
 
+        // Responses are always handled to be able to continue block-wise transfers
+        coap_register_response_handler(coap_obj_ptr->context, coap_response_handler);
+
         coap_obj_ptr->semphr = xSemaphoreCreateBinary();
         xSemaphoreGive(coap_obj_ptr->semphr);
 
+        // Serve the requests from a dedicated task instead of coap.read() if asked for
+        if(args[4].u_bool == true) {
+            xTaskCreatePinnedToCore(TASK_CoAP, "CoAP", MODCOAP_TASK_STACK_SIZE / sizeof(StackType_t), NULL, MODCOAP_TASK_PRIORITY, &coap_obj_ptr->task, 1);
+        }
+
         initialized = true;
     }
     else {
@@ -994,6 +1472,8 @@ STATIC const mp_arg_t mod_coap_add_resource_args[] = {
         { MP_QSTR_max_age,                  MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = -1}},
         { MP_QSTR_value,                    MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL}},
         { MP_QSTR_etag,                     MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = false}},
+        { MP_QSTR_observable,               MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = false}},
+        { MP_QSTR_notify_con,               MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = false}},
 };
 
 // Add a new resource to the context if not exists
@@ -1007,7 +1487,7 @@ STATIC mp_obj_t mod_coap_add_resource(mp_uint_t n_args, const mp_obj_t *pos_args
         mp_arg_val_t args[MP_ARRAY_SIZE(mod_coap_add_resource_args)];
         mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), mod_coap_add_resource_args, args);
 
-        mod_coap_resource_obj_t* res = add_resource(mp_obj_str_get_str(args[0].u_obj), args[1].u_int, args[2].u_int, args[3].u_obj, args[4].u_bool);
+        mod_coap_resource_obj_t* res = add_resource(mp_obj_str_get_str(args[0].u_obj), args[1].u_int, args[2].u_int, args[3].u_obj, args[4].u_bool, args[5].u_bool, args[6].u_bool);
 
         xSemaphoreGive(coap_obj_ptr->semphr);
 
@@ -1074,7 +1554,12 @@ STATIC mp_obj_t mod_coap_read(void) {
     if(initialized == true) {
         // Take the context's semaphore to avoid concurrent access, this will guard the handler functions too
         xSemaphoreTake(coap_obj_ptr->semphr, portMAX_DELAY);
-        coap_read(coap_obj_ptr->context);
+        // The dedicated task may have read the message already, do not block on the empty socket then
+        if((coap_obj_ptr->task == NULL) || (modcoap_peek_code() >= 0)) {
+            coap_read(coap_obj_ptr->context);
+            // Notify the observers of the resources updated by the requests
+            coap_check_notify(coap_obj_ptr->context);
+        }
         xSemaphoreGive(coap_obj_ptr->semphr);
     }
     else {
@@ -1113,7 +1598,10 @@ STATIC const mp_arg_t mod_coap_send_request_args[] = {
         { MP_QSTR_content_format,           MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = -1}},
         { MP_QSTR_payload,                  MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL}},
         { MP_QSTR_token,                    MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL}},
-        { MP_QSTR_include_options,          MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = true}}
+        { MP_QSTR_include_options,          MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = true}},
+        { MP_QSTR_block_size,               MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 0}},
+        { MP_QSTR_response_stream,          MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL}},
+        { MP_QSTR_observe,                  MP_ARG_KW_ONLY  | MP_ARG_BOOL,{.u_bool = false}},
 };
 
 
@@ -1179,11 +1667,18 @@ STATIC mp_obj_t mod_coap_send_request(mp_uint_t n_args, const mp_obj_t *pos_args
                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Invalid \"content_format\" parameter value!"));
        }
 
-        // Get the payload
-        const char* payload = NULL;
+        // Get the payload, it is either a str/bytes object or a stream it is read from
+        mp_obj_t payload = args[5].u_obj;
+        bool payload_stream = false;
         size_t payload_length = 0;
-        if(args[5].u_obj != MP_OBJ_NULL) {
-            payload = mp_obj_str_get_data(args[5].u_obj, &payload_length);
+        if(payload != MP_OBJ_NULL) {
+            if(mp_obj_get_type(payload)->protocol != NULL) {
+                (void)mp_get_stream_raise(payload, MP_STREAM_OP_READ);
+                payload_stream = true;
+            }
+            else {
+                (void)mp_obj_str_get_data(payload, &payload_length);
+            }
         }
 
         // Get the token
@@ -1191,11 +1686,24 @@ STATIC mp_obj_t mod_coap_send_request(mp_uint_t n_args, const mp_obj_t *pos_args
         size_t token_length = 0;
         if(args[6].u_obj != MP_OBJ_NULL) {
             token = mp_obj_str_get_data(args[6].u_obj, &token_length);
+            if(token_length > MODCOAP_TOKEN_LENGTH_MAX) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Invalid \"token\" parameter value!"));
+            }
         }
 
         // Get the include_options parameter
         bool include_options = args[7].u_bool;
 
+        // Get the block size, an explicitly given one is negotiated with the server for the response too
+        bool block2 = (args[8].u_int != 0);
+        uint8_t szx = block2 ? modcoap_block_szx(args[8].u_int) : coap_obj_ptr->block_szx;
+
+        // Get the stream the response payload is written to
+        mp_obj_t response_stream = args[9].u_obj;
+        if(response_stream != MP_OBJ_NULL) {
+            (void)mp_get_stream_raise(response_stream, MP_STREAM_OP_WRITE);
+        }
+
         mp_obj_t address = mp_obj_new_list(0, NULL);
         // Get the address as a string
         mp_obj_list_append(address, mp_obj_new_str((const char*)coap_uri.host.s, coap_uri.host.length));
@@ -1264,46 +1772,56 @@ STATIC mp_obj_t mod_coap_send_request(mp_uint_t n_args, const mp_obj_t *pos_args
             }
         }
 
-        // Create new request
-        coap_pdu_t *pdu = modcoap_new_request(coap_obj_ptr->context, method, &coap_obj_ptr->optlist, token, token_length, payload, payload_length);
-
-        // Clean up optlist, they are already part of the PDU if it has been created
-        struct coap_list_t *next;
-        while(coap_obj_ptr->optlist != NULL) {
-            next = coap_obj_ptr->optlist->next;
-            coap_obj_ptr->optlist->next = NULL;
-            m_free(coap_obj_ptr->optlist);
-            coap_obj_ptr->optlist = next;
+        // Put the Observe option to register as an observer, 0 is encoded as an empty value
+        if(args[10].u_bool == true) {
+            coap_list_t * node = modcoap_new_option_node(COAP_OPTION_OBSERVE, 0, NULL);
+            if(node != NULL) {
+                LL_APPEND(coap_obj_ptr->optlist, node);
+            }
         }
 
-        if (pdu == NULL) {
-            xSemaphoreGive(coap_obj_ptr->semphr);
-            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Cannot create request"));
+        // A new request ends the block-wise transfer of the previous one
+        mod_coap_block_xfer_t* xfer = &coap_obj_ptr->xfer;
+        modcoap_xfer_release(xfer);
+
+        // The options are kept to be repeated in the follow-up requests of a block-wise transfer
+        xfer->options = coap_obj_ptr->optlist;
+        coap_obj_ptr->optlist = NULL;
+        xfer->dst_address = dst_address;
+        xfer->method = method;
+        if(token != NULL) {
+            memcpy(xfer->token, token, token_length);
+        }
+        xfer->token_length = token_length;
+        xfer->szx = szx;
+        xfer->block2 = block2;
+        xfer->block2_num = 0;
+        xfer->offset = 0;
+        xfer->received = 0;
+        xfer->payload = ((payload_stream == true) || (payload_length > 0)) ? payload : MP_OBJ_NULL;
+        // Payloads not fitting into one block and streams of unknown length are sent in Block1 blocks
+        xfer->block1 = (payload_stream == true) || (payload_length > MODCOAP_BLOCK_SIZE(szx));
+        if(payload_stream == true) {
+            xfer->block = m_new(uint8_t, MODCOAP_BLOCK_SIZE_MAX + 1);
+            xfer->block_len = 0;
         }
+        xfer->response_stream = response_stream;
+        vstr_init(&xfer->response, 0);
+        xfer->active = true;
 
-        // Send out the request
+        // Create and send out the request, followed by the rest of the blocks from the response handler
         // TODO: currently always confirmed message is sent out
-        coap_tid_t ret;
-        if (pdu->hdr->type == COAP_MESSAGE_CON) {
-            ret = coap_send_confirmed(coap_obj_ptr->context, coap_obj_ptr->context->endpoint, &dst_address, pdu);
-        }
-        else {
-            ret = coap_send(coap_obj_ptr->context, coap_obj_ptr->context->endpoint, &dst_address, pdu);
-        }
+        coap_tid_t ret = modcoap_xfer_send(xfer);
 
         // Sending the packet failed
         if(ret == COAP_INVALID_TID) {
+            modcoap_xfer_release(xfer);
             xSemaphoreGive(coap_obj_ptr->semphr);
             nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Sending message failed!"));
         }
 
         // Fetch the message ID to be used from MicroPython to match the request with response
-        mp_obj_t id = mp_obj_new_int(pdu->hdr->id);
-
-        //TODO: check if this is needed once not-confirmed message support is added
-//        if (pdu->hdr->type != COAP_MESSAGE_CON) {
-//          coap_delete_pdu(pdu);
-//        }
+        mp_obj_t id = mp_obj_new_int(xfer->message_id);
 
         xSemaphoreGive(coap_obj_ptr->semphr);
 
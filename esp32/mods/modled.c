@@ -8,6 +8,7 @@
  */
 
 #include <stdbool.h>
+#include "esp_attr.h"
 #include "modled.h"
 
 /******************************************************************************
@@ -23,6 +24,7 @@
 #define LED_BIT_1_LOW_PERIOD  (3) // 300ns
 #define LED_BIT_0_HIGH_PERIOD (3) // 300ns
 #define LED_BIT_0_LOW_PERIOD  (9) // 900ns
+#define LED_RESET_PERIOD      (250) // 2 x 25us low, the strip latches the colors after 50us
 
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
@@ -32,6 +34,8 @@ static bool led_init_rmt(led_info_t *led_info);
 static void led_encode_color(led_info_t *led_info);
 static void set_high_bit(rmt_item32_t *item);
 static void set_low_bit(rmt_item32_t *item);
+static void led_strip_translate(const void *src, rmt_item32_t *dest, size_t src_size,
+                                size_t wanted_num, size_t *translated_size, size_t *item_num);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
@@ -75,24 +79,80 @@ bool led_set_color(led_info_t *led_info, bool synchronize, bool wait_tx)
     return true;
 }
 
+bool led_strip_init(rmt_channel_t channel)
+{
+    // the channel must be in TX mode with the driver installed and LED_RMT_CLK_DIV as divider
+    return rmt_translator_init(channel, led_strip_translate) == ESP_OK;
+}
+
+bool led_strip_write(rmt_channel_t channel, const uint8_t *grb, size_t len, bool wait_tx)
+{
+    // the pixels are encoded by led_strip_translate() from the TX threshold interrupt,
+    // grb must stay untouched until the transmission is done
+    if ((grb == NULL) || (len == 0)) {
+        return false;
+    }
+
+    return rmt_write_sample(channel, grb, len, wait_tx) == ESP_OK;
+}
+
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
 
-static void set_high_bit(rmt_item32_t *item){
+static void IRAM_ATTR set_high_bit(rmt_item32_t *item){
     item->duration0 = LED_BIT_1_HIGH_PERIOD;
     item->level0    = 1;
     item->duration1 = LED_BIT_1_LOW_PERIOD;
     item->level1    = 0;
 }
 
-static void set_low_bit(rmt_item32_t *item){
+static void IRAM_ATTR set_low_bit(rmt_item32_t *item){
     item->duration0 = LED_BIT_0_HIGH_PERIOD;
     item->level0    = 1;
     item->duration1 = LED_BIT_0_LOW_PERIOD;
     item->level1    = 0;
 }
 
+// called by the RMT driver, also from its interrupt, to refill the channel memory from the pixel bytes
+static void IRAM_ATTR led_strip_translate(const void *src, rmt_item32_t *dest, size_t src_size,
+                                          size_t wanted_num, size_t *translated_size, size_t *item_num)
+{
+    const uint8_t *psrc = src;
+    size_t size = 0;
+    size_t num = 0;
+
+    if ((src == NULL) || (dest == NULL)) {
+        *translated_size = 0;
+        *item_num = 0;
+        return;
+    }
+
+    // a byte is only encoded if its 8 bits fit, together with the reset after the last byte
+    while ((size < src_size) && ((num + 8 + ((size == src_size - 1) ? 1 : 0)) <= wanted_num)) {
+        for (uint8_t bit_mask = 0x80; bit_mask != 0; bit_mask >>= 1) {
+            if (psrc[size] & bit_mask) {
+                set_high_bit(&dest[num]);
+            } else {
+                set_low_bit(&dest[num]);
+            }
+            num++;
+        }
+        size++;
+    }
+
+    if (size == src_size) {
+        dest[num].duration0 = LED_RESET_PERIOD;
+        dest[num].level0    = 0;
+        dest[num].duration1 = LED_RESET_PERIOD;
+        dest[num].level1    = 0;
+        num++;
+    }
+
+    *translated_size = size;
+    *item_num = num;
+}
+
 static void led_encode_color(led_info_t *led_info)
 {
     uint32_t rmt_idx = 0;
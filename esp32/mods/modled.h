@@ -46,6 +46,8 @@ typedef struct {
 bool led_set_color(led_info_t *led_info, bool synchronize, bool wait_tx);
 bool led_init(led_info_t *led_info);
 void rmt_deinit_rgb (void);
+bool led_strip_init(rmt_channel_t channel);
+bool led_strip_write(rmt_channel_t channel, const uint8_t *grb, size_t len, bool wait_tx);
 
 #endif    /* MODLED_H */
 
@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "py/mpconfig.h"
@@ -29,11 +30,21 @@
 #include "pycom_config.h"
 #include "mpirq.h"
 #include "modlora.h"
+#include "mpsleep.h"
+#include "mptrace.h"
+#include "machtimer.h"
+#include "machtimer_compare.h"
+#include "lora/radiosched.h"
+#if defined(LOPY4)
+#include "sx1276/sx1276.h"
+#endif
 
 #include "esp_heap_caps.h"
 #include "sdkconfig.h"
 #include "esp_system.h"
 #include "esp_spi_flash.h"
+#include "esp_attr.h"
+#include "rom/crc.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 
@@ -42,6 +53,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/event_groups.h"
 
 #include "lora/mac/LoRaMacTest.h"
@@ -61,6 +73,8 @@
 #endif  // #ifdef LORA_OPENTHREAD_ENABLED
 
 #include "random.h"
+#include "mptaskmon.h"
+#include "mpmetrics.h"
 /******************************************************************************
  DEFINE PRIVATE CONSTANTS
  ******************************************************************************/
@@ -71,11 +85,21 @@
 #define LORA_FIX_LENGTH_PAYLOAD_OFF                 (false)
 #define LORA_TX_TIMEOUT_MAX                         (9000)      // 9 seconds
 #define LORA_RX_TIMEOUT                             (0)         // No timeout
+#define LORA_SCAN_CAD_GUARD                         (100)       // TASK_LoRa iterations to wait for CAD done
 
 // [SF6..SF12]
 #define LORA_SPREADING_FACTOR_MIN                   (6)
 #define LORA_SPREADING_FACTOR_MAX                   (12)
 
+// FSK bit rate [1.2..300 kbps], the deviation plus half the bit rate must fit in the widest filter
+#define LORA_FSK_BITRATE_MIN                        (1200)
+#define LORA_FSK_BITRATE_MAX                        (300000)
+#define LORA_FSK_FDEV_MIN                           (600)
+#define LORA_FSK_RX_BW_MAX                          (250000)
+
+// the raw modes drive either modem of the radio directly
+#define LORA_RAW_MODEM()                            ((lora_obj.stack_mode == E_LORA_STACK_MODE_FSK) ? MODEM_FSK : MODEM_LORA)
+
 #define LORA_CHECK_SOCKET(s)                        if (s->sock_base.u.sd < 0) {  \
                                                         *_errno = MP_EBADF;     \
                                                         return -1;              \
@@ -87,6 +111,7 @@
 #define DEF_LORAWAN_APP_PORT                        2
 
 #define LORA_JOIN_WAIT_MS                           (50)
+#define LORA_HEALTH_DEADLINE_MS                     (5000)      // a Sigfox frame can hold the radio for seconds
 
 #define LORAWAN_SOCKET_GET_FD(sd)                   (sd & 0xFF)
 
@@ -111,16 +136,37 @@
 #define MODLORA_TX_EVENT                            (0x02)
 #define MODLORA_TX_FAILED_EVENT                     (0x04)
 
+// LoRa.send_at accepts timestamps from this far ahead (the task must arm the radio first)...
+#define LORA_TX_AT_GUARD_US                         (2000)
+// ...up to this far ahead, well inside the 32-bit wrap of the timestamps
+#define LORA_TX_AT_MAX_US                           (60000000)
+
+#define LORA_RX_RING_MASK                           (LORA_RX_RING_SIZE - 1)
+
 #define MODLORA_NVS_NAMESPACE                       "LORA_NVM"
 
+#define LORA_NVS_JOURNAL_MAGIC                      (0x4C4A524E)    // "LJRN"
+#define LORA_NVS_JOURNAL_SIZE                       (16)        // entries between two compactions
+#define LORA_NVS_JOURNAL_MAX_DELTA                  (64)        // uplinks between two compactions
+#define LORA_NVS_JOURNAL_MARGIN                     (64)        // uplinks assumed sent without a save
+
+#define LORA_RTC_SNAPSHOT_MAGIC                     (0x4C534E50)    // "LSNP"
+
 #define MESH_CLI_OUTPUT_SIZE                            (1024)
 
+#define LORA_ADR_DR_NUM                             (16)
+#define LORA_ADR_STEP_MARGIN_Q                      (10)        // 2.5 dB, one spreading factor, in quarter dB
+#define LORA_ADR_FAST_MARGIN_DEF                    (10)        // dB left after the step, as network servers use
+#define LORA_ADR_FAST_FRAMES_DEF                    (4)
+#define LORA_ADR_FAST_DR_MAX_DEF                    (5)
+
 /******************************************************************************
  DEFINE PRIVATE TYPES
  ******************************************************************************/
 typedef enum {
     E_LORA_STACK_MODE_LORA = 0,
-    E_LORA_STACK_MODE_LORAWAN
+    E_LORA_STACK_MODE_LORAWAN,
+    E_LORA_STACK_MODE_FSK
 } lora_stack_mode_t;
 
 typedef enum {
@@ -136,7 +182,10 @@ typedef enum {
     E_LORA_STATE_TX_DONE,
     E_LORA_STATE_TX_TIMEOUT,
     E_LORA_STATE_SLEEP,
-    E_LORA_STATE_RESET
+    E_LORA_STATE_RESET,
+    E_LORA_STATE_CAD,
+    E_LORA_STATE_CAD_DONE,
+    E_LORA_STATE_CAD_DETECTED
 } lora_state_t;
 
 typedef enum {
@@ -187,6 +236,12 @@ typedef struct {
     uint8_t           sf;
     int8_t            tx_power;
     uint8_t           pwr_mode;
+    uint32_t          bitrate;
+    uint32_t          fdev;
+    uint8_t           sync_word[LORA_FSK_SYNC_WORD_MAX];
+    uint8_t           sync_word_len;
+    bool              crc;
+    bool              whitening;
 
     struct {
         bool Enabled;
@@ -231,17 +286,71 @@ typedef struct {
 } lora_obj_t;
 
 typedef struct {
-    uint32_t    index;
-    uint32_t    size;
-    uint8_t     data[LORA_PAYLOAD_SIZE_MAX];
-    uint8_t     port;
-} lora_partial_rx_packet_t;
+    uint32_t    frequency[LORA_SCAN_CHANNELS_MAX];
+    uint8_t     sf[LORA_SCAN_CHANNELS_MAX];
+    uint8_t     count;      // 0 when scanning is disabled
+    uint8_t     index;      // channel currently tuned
+    uint8_t     guard;
+} lora_scan_t;
+
+// frame counters saved since the last full NVS write, relative to the NVS base
+typedef struct {
+    uint16_t    uplinks;
+    uint16_t    downlinks;
+    uint32_t    adr_acks;
+} lora_nvs_journal_entry_t;
+
+typedef struct {
+    uint32_t                    magic;
+    uint32_t                    generation;     // matches E_LORA_NVS_ELE_JOURNAL_GEN of the NVS base
+    uint32_t                    state_crc;      // LoRaMacNvsStateCrc() of the NVS base
+    uint32_t                    uplinks;        // counters stored in the NVS base
+    uint32_t                    downlinks;
+    uint32_t                    skipped;        // uplinks to skip because of restores without a save
+    uint32_t                    count;
+    uint8_t                     region;
+    bool                        joined;
+    bool                        pending;        // restored, but not saved since
+    lora_nvs_journal_entry_t    entries[LORA_NVS_JOURNAL_SIZE];
+    uint32_t                    crc;
+} lora_nvs_journal_t;
+
+// data rate statistics and the client side fast ADR
+typedef struct {
+    uint32_t    sent[LORA_ADR_DR_NUM];
+    uint32_t    ok[LORA_ADR_DR_NUM];        // the confirmed ones only when acked
+    uint32_t    link_checks;
+    uint32_t    link_check_fails;
+    uint8_t     margin;                     // dB, from the last LinkCheckAns
+    uint8_t     gateways;
+    int16_t     last_margin_q;              // the latest of LinkCheckAns and downlink SNR, quarter dB
+    bool        measured;                   // last_margin_q is valid
+    bool        fresh;                      // measured since the last step
+    bool        fast;                       // only while the network ADR is off
+    uint8_t     fast_margin;
+    uint8_t     fast_frames;
+    uint8_t     fast_dr_max;
+    int8_t      fast_dr;                    // -1 until the first frame
+    uint8_t     fast_floor;                 // the data rate asked for by the socket
+    uint8_t     fast_run;                   // successful frames in a row at fast_dr
+    uint32_t    steps_up;
+    uint32_t    steps_down;
+} lora_adr_t;
+
+// LoRaWAN session kept in RTC memory while in deep sleep
+typedef struct {
+    uint32_t                    magic;
+    uint8_t                     region;
+    LoRaMacSessionContext_t     session;
+    uint32_t                    crc;
+} lora_rtc_snapshot_t;
 
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
 static QueueHandle_t xCmdQueue;
-static QueueHandle_t xRxQueue;
+static SemaphoreHandle_t xRxSem;
+static SemaphoreHandle_t xTxBatchSem;
 static QueueHandle_t xCbQueue;
 static EventGroupHandle_t LoRaEvents;
 
@@ -250,18 +359,48 @@ static lora_cmd_data_t task_cmd_data;
 static LoRaMacPrimitives_t LoRaMacPrimitives;
 static LoRaMacCallback_t LoRaMacCallbacks;
 
+// the SX127x reset value, so FSK nodes talk to each other out of the box
+static const uint8_t lora_fsk_def_sync_word[] = { 0xC1, 0x94, 0xC1 };
+
 static lora_obj_t lora_obj;
-static lora_partial_rx_packet_t lora_partial_rx_packet;
-static lora_rx_data_t rx_data_isr;
+static DRAM_ATTR lora_rx_ring_t lora_rx_ring;
+static lora_tx_batch_t lora_tx_batch;
+static DRAM_ATTR lora_scan_t lora_scan;
+static RTC_DATA_ATTR lora_nvs_journal_t lora_nvs_journal;
+static RTC_DATA_ATTR lora_rtc_snapshot_t lora_rtc_snapshot;
+static bool lora_rtc_warm;
+static DRAM_ATTR TimerTime_t lora_raw_time_on_air;
+static radiosched_owner_t lora_raw_tx_owner = E_RADIOSCHED_LORA;
+static lora_adr_t lora_adr = {
+    .fast_margin = LORA_ADR_FAST_MARGIN_DEF,
+    .fast_frames = LORA_ADR_FAST_FRAMES_DEF,
+    .fast_dr_max = LORA_ADR_FAST_DR_MAX_DEF,
+    .fast_dr = -1,
+};
+static lora_downlink_c_handler_t lora_downlink_c_handler;
 
 static TimerEvent_t TxNextActReqTimer;
 
+// highest data rate accepted from the user, indexed by region
+static const uint32_t lora_region_max_data_rate[LORAMAC_REGION_MAX] = {
+    [LORAMAC_REGION_AS923]          = DR_6,
+    [LORAMAC_REGION_AU915]          = DR_6,
+    [LORAMAC_REGION_CN470]          = DR_6,
+    [LORAMAC_REGION_CN779]          = UINT32_MAX,
+    [LORAMAC_REGION_EU433]          = UINT32_MAX,
+    [LORAMAC_REGION_EU868]          = DR_6,
+    [LORAMAC_REGION_KR920]          = UINT32_MAX,
+    [LORAMAC_REGION_IN865]          = DR_6,
+    [LORAMAC_REGION_US915]          = DR_4,
+    [LORAMAC_REGION_US915_HYBRID]   = DR_4,
+};
+
 static nvs_handle modlora_nvs_handle;
 static const char *modlora_nvs_data_key[E_LORA_NVS_NUM_KEYS] = { "JOINED", "UPLNK", "DWLNK", "DEVADDR",
                                                                  "NWSKEY", "APPSKEY", "NETID", "ADRACK",
                                                                  "MACPARAMS", "CHANNELS", "SRVACK", "MACNXTTX",
                                                                  "MACBUFIDX", "MACRPTIDX", "MACBUF", "MACRPTBUF",
-                                                                 "REGION", "CHANMASK", "CHANMASKREM" };
+                                                                 "REGION", "CHANMASK", "CHANMASKREM", "JRNLGEN" };
 /******************************************************************************
  DECLARE PUBLIC DATA
  ******************************************************************************/
@@ -277,22 +416,41 @@ static void OnRxDone (uint8_t *payload, uint32_t timestamp, uint16_t size, int16
 static void OnTxTimeout (void);
 static void OnRxTimeout (void);
 static void OnRxError (void);
+static void OnCadDone (bool channelActivityDetected);
 static void lora_radio_setup (lora_init_cmd_data_t *init_data);
+static void lora_start_rx (void);
+static void lora_scan_cad (void);
 static void lora_validate_mode (uint32_t mode);
 static void lora_validate_frequency (uint32_t frequency);
 static void lora_validate_power (uint8_t tx_power);
 static void lora_validate_bandwidth (uint8_t bandwidth);
 static void lora_validate_sf (uint8_t sf);
 static void lora_validate_coding_rate (uint8_t coding_rate);
+static void lora_validate_fsk (uint32_t bitrate, uint32_t fdev);
+static void lora_fsk_setup (lora_init_cmd_data_t *init_data);
 static void lora_set_config (lora_cmd_data_t *cmd_data);
 static void lora_get_config (lora_cmd_data_t *cmd_data);
 static void lora_send_cmd (lora_cmd_data_t *cmd_data);
-static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms);
+static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms, radiosched_owner_t owner);
 static int32_t lora_recv (byte *buf, uint32_t len, int32_t timeout_ms, uint32_t *port);
+static IRAM_ATTR bool lora_rx_ring_put (const uint8_t *payload, uint8_t len, uint8_t port);
+static void lora_rx_ring_flush (void);
+static void lora_adr_measured (int16_t margin_q);
+static void lora_adr_record (uint8_t dr, bool success);
+static uint8_t lora_adr_fast_dr (uint8_t floor);
+static void lora_metrics_collect (uint32_t *values);
 static bool lora_rx_any (void);
 static bool lora_tx_space (void);
+static bool lora_tx_batch_next (lora_cmd_data_t *cmd_data);
+static uint32_t lora_tx_batch_fill (lora_tx_cmd_data_t *tx, uint8_t max_len);
 static void lora_callback_handler (void *arg);
 static bool lorawan_nvs_open (void);
+static bool lora_nvs_journal_append (void);
+static void lora_nvs_journal_compact (uint32_t generation);
+static bool lora_nvs_journal_restore (uint32_t *uplinks, uint32_t *downlinks);
+static void lora_nvs_journal_invalidate (void);
+static void lora_nvs_journal_set_pending (void);
+static bool lora_rtc_snapshot_valid (void);
 
 static int lora_socket_socket (mod_network_socket_obj_t *s, int *_errno);
 static void lora_socket_close (mod_network_socket_obj_t *s);
@@ -306,6 +464,7 @@ static int lora_socket_ioctl (mod_network_socket_obj_t *s, mp_uint_t request, mp
 static int lora_socket_sendto (struct _mod_network_socket_obj_t *s, const byte *buf, mp_uint_t len, byte *ip, mp_uint_t port, int *_errno);
 
 static bool lora_lbt_is_free(void);
+static bool lora_tx_at_start (uint32_t at_us);
 STATIC mp_obj_t lora_nvram_erase (mp_obj_t self_in);
 
 /******************************************************************************
@@ -318,9 +477,48 @@ SemaphoreHandle_t xLoRaSigfoxSem;
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
+// only once, either on boot or when the LoRa class is first used
+#define LORA_METRICS(owner) \
+    { owner "_grants",      E_MPMETRICS_COUNTER }, \
+    { owner "_missed",      E_MPMETRICS_COUNTER }, \
+    { owner "_airtime",     E_MPMETRICS_COUNTER }
+
+// in the order of radiosched_owner_t
+static const mpmetrics_desc_t lora_metrics[] = {
+    LORA_METRICS("lorawan"),
+    LORA_METRICS("sigfox"),
+    LORA_METRICS("mesh"),
+    LORA_METRICS("lora"),
+    { "switches",           E_MPMETRICS_COUNTER },
+};
+static mpmetrics_source_t lora_metrics_source = {
+    .name = "lora",
+    .metrics = lora_metrics,
+    .n_metrics = MP_ARRAY_SIZE(lora_metrics),
+    .collect = lora_metrics_collect,
+};
+
+static void lora_metrics_collect (uint32_t *values) {
+    for (int owner = 0; owner < E_RADIOSCHED_NUM_OWNERS; owner++) {
+        radiosched_stats_t stats;
+        radiosched_get_stats(owner, &stats, false);
+        *values++ = stats.grants;
+        *values++ = stats.missed;
+        *values++ = stats.airtime_ms;
+    }
+    *values = radiosched_switches();
+}
+
 void modlora_init0(void) {
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
     xCmdQueue = xQueueCreate(LORA_CMD_QUEUE_SIZE_MAX, sizeof(lora_cmd_data_t));
-    xRxQueue = xQueueCreate(LORA_DATA_QUEUE_SIZE_MAX, sizeof(lora_rx_data_t));
+    xRxSem = xSemaphoreCreateBinary();
+    xTxBatchSem = xSemaphoreCreateBinary();
+    xSemaphoreGive(xTxBatchSem);
     xCbQueue = xQueueCreate(LORA_CB_QUEUE_SIZE_MAX, sizeof(modlora_timerCallback));
     LoRaEvents = xEventGroupCreate();
 #if defined(FIPY) || defined(LOPY4)
@@ -331,14 +529,31 @@ void modlora_init0(void) {
         mp_printf(&mp_plat_print, "Error opening LoRa NVS namespace!\n");
     }
 
+    // the session snapshot can only be trusted right after the deep sleep it was taken for
+    lora_rtc_warm = mpsleep_get_reset_cause() == MPSLEEP_DEEPSLEEP_RESET && lora_rtc_snapshot_valid();
+    if (!lora_rtc_warm) {
+        lora_rtc_snapshot.magic = 0;
+    }
+
     // target board initialisation
     BoardInitMcu();
     BoardInitPeriph();
 
+    mpmetrics_register(&lora_metrics_source);
     xTaskCreatePinnedToCore(TASK_LoRa, "LoRa", LORA_STACK_SIZE / sizeof(StackType_t), NULL, LORA_TASK_PRIORITY, &xLoRaTaskHndl, 1);
     xTaskCreatePinnedToCore(TASK_LoRa_Timer, "LoRa_Timer_callback", LORA_TIMER_STACK_SIZE / sizeof(StackType_t), NULL, LORA_TIMER_TASK_PRIORITY, &xLoRaTimerTaskHndl, 1);
 }
 
+void modlora_deepsleep_save(void) {
+    lora_rtc_snapshot.magic = 0;
+    if (lora_obj.stack_mode == E_LORA_STACK_MODE_LORAWAN && lora_obj.joined &&
+        LoRaMacSessionSave(&lora_rtc_snapshot.session)) {
+        lora_rtc_snapshot.region = lora_obj.region;
+        lora_rtc_snapshot.magic = LORA_RTC_SNAPSHOT_MAGIC;
+        lora_rtc_snapshot.crc = crc32_le(0, (uint8_t *)&lora_rtc_snapshot, offsetof(lora_rtc_snapshot_t, crc));
+    }
+}
+
 bool modlora_nvs_set_uint(uint32_t key_idx, uint32_t value) {
     if (ESP_OK == nvs_set_u32(modlora_nvs_handle, modlora_nvs_data_key[key_idx], value)) {
         return true;
@@ -391,6 +606,20 @@ bool modlora_is_module_sleep(void)
     }
 }
 
+// neither initialised nor waiting for a radio event
+bool modlora_is_radio_off(void) {
+    return lora_obj.state == E_LORA_STATE_NOINIT || lora_obj.state == E_LORA_STATE_SLEEP;
+}
+
+// register a C function that gets every LoRaWAN downlink straight from the MAC
+// callback, skipping the RX ring and the IRQ queue. Pass NULL to unregister it
+void modlora_register_downlink_c_handler(modlora_downlink_handler_t handler, void *arg) {
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    lora_downlink_c_handler.handler = handler;
+    lora_downlink_c_handler.arg = arg;
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
+
 IRAM_ATTR void modlora_set_timer_callback(modlora_timerCallback cb)
 {
     if(cb != NULL)
@@ -407,12 +636,12 @@ IRAM_ATTR void modlora_set_timer_callback(modlora_timerCallback cb)
 }
 
 #ifdef LORA_OPENTHREAD_ENABLED
-int lora_ot_recv(uint8_t *buf, int8_t *rssi) {
+int lora_ot_recv(uint8_t *buf, uint16_t len, int8_t *rssi) {
 
     // put Lora into RX mode
-    int len = lora_recv (buf, OT_RADIO_FRAME_MAX_SIZE, 0, NULL);
+    int ret = lora_recv (buf, len, 0, NULL);
 
-    if (len > 0) {
+    if (ret > 0) {
 
         // put rssi on signed 8bit, saturate at -128dB
         if (lora_obj.rssi < INT8_MIN)
@@ -420,9 +649,9 @@ int lora_ot_recv(uint8_t *buf, int8_t *rssi) {
         else
             *rssi = lora_obj.rssi;
 
-        otPlatLog(OT_LOG_LEVEL_INFO, 0, "radio rcv: %d, %d", len, *rssi);
+        otPlatLog(OT_LOG_LEVEL_INFO, 0, "radio rcv: %d, %d", ret, *rssi);
     }
-    return len;
+    return ret;
 }
 
 void lora_ot_send(const uint8_t *buf, uint16_t len) {
@@ -430,10 +659,15 @@ void lora_ot_send(const uint8_t *buf, uint16_t len) {
     // send max 255 bytes
     len = LORA_PAYLOAD_SIZE_MAX < len ? LORA_PAYLOAD_SIZE_MAX : len;
 
-    lora_send(buf, len, 0);
+    lora_send(buf, len, 0, E_RADIOSCHED_MESH);
 
     //otPlatLog(OT_LOG_LEVEL_INFO, 0, "radio TX: %d", len);
 }
+
+// time-on-air (milisec) of a packet with the current LoRa settings
+uint32_t lora_ot_airtime(uint16_t len) {
+    return Radio.TimeOnAir(MODEM_LORA, len);
+}
 #endif  // #ifdef LORA_OPENTHREAD_ENABLED
 
 /******************************************************************************
@@ -456,6 +690,117 @@ static bool lorawan_nvs_open (void) {
     return true;
 }
 
+static uint32_t lora_nvs_journal_crc (void) {
+    return crc32_le(0, (uint8_t *)&lora_nvs_journal, offsetof(lora_nvs_journal_t, crc));
+}
+
+static bool lora_nvs_journal_valid (void) {
+    return lora_nvs_journal.magic == LORA_NVS_JOURNAL_MAGIC && lora_nvs_journal.crc == lora_nvs_journal_crc();
+}
+
+static void lora_nvs_journal_invalidate (void) {
+    lora_nvs_journal.magic = 0;
+}
+
+static void lora_nvs_journal_set_pending (void) {
+    if (lora_nvs_journal_valid()) {
+        lora_nvs_journal.pending = true;
+        lora_nvs_journal.crc = lora_nvs_journal_crc();
+    }
+}
+
+static bool lora_rtc_snapshot_valid (void) {
+    return lora_rtc_snapshot.magic == LORA_RTC_SNAPSHOT_MAGIC &&
+           lora_rtc_snapshot.crc == crc32_le(0, (uint8_t *)&lora_rtc_snapshot, offsetof(lora_rtc_snapshot_t, crc));
+}
+
+// records the frame counters in RTC memory only, as long as nothing else changed since the last full save
+static bool lora_nvs_journal_append (void) {
+    MibRequestConfirm_t mibReq;
+    uint32_t uplinks, downlinks;
+
+    if (!lora_nvs_journal_valid() || lora_nvs_journal.count >= LORA_NVS_JOURNAL_SIZE ||
+        lora_nvs_journal.region != lora_obj.region || lora_nvs_journal.joined != lora_obj.joined) {
+        return false;
+    }
+
+    mibReq.Type = MIB_UPLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mibReq);
+    uplinks = mibReq.Param.UpLinkCounter - lora_nvs_journal.uplinks;
+    mibReq.Type = MIB_DOWNLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mibReq);
+    downlinks = mibReq.Param.DownLinkCounter - lora_nvs_journal.downlinks;
+    if (uplinks > LORA_NVS_JOURNAL_MAX_DELTA || downlinks > UINT16_MAX) {
+        return false;
+    }
+    if (LoRaMacNvsStateCrc() != lora_nvs_journal.state_crc) {
+        return false;
+    }
+
+    lora_nvs_journal_entry_t *entry = &lora_nvs_journal.entries[lora_nvs_journal.count++];
+    entry->uplinks = uplinks;
+    entry->downlinks = downlinks;
+    entry->adr_acks = *LoRaMacGetAdrAckCounter();
+    lora_nvs_journal.skipped = 0;
+    lora_nvs_journal.pending = false;
+    lora_nvs_journal.crc = lora_nvs_journal_crc();
+    return true;
+}
+
+// starts a new journal on top of the session that has just been written to NVS
+static void lora_nvs_journal_compact (uint32_t generation) {
+    MibRequestConfirm_t mibReq;
+
+    lora_nvs_journal.magic = LORA_NVS_JOURNAL_MAGIC;
+    lora_nvs_journal.generation = generation;
+    lora_nvs_journal.state_crc = LoRaMacNvsStateCrc();
+    mibReq.Type = MIB_UPLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mibReq);
+    lora_nvs_journal.uplinks = mibReq.Param.UpLinkCounter;
+    mibReq.Type = MIB_DOWNLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mibReq);
+    lora_nvs_journal.downlinks = mibReq.Param.DownLinkCounter;
+    lora_nvs_journal.skipped = 0;
+    lora_nvs_journal.count = 0;
+    lora_nvs_journal.region = lora_obj.region;
+    lora_nvs_journal.joined = lora_obj.joined;
+    lora_nvs_journal.pending = false;
+    lora_nvs_journal.crc = lora_nvs_journal_crc();
+}
+
+// applies the journal on top of the counters read from NVS, returns false if the NVS base has no journal
+static bool lora_nvs_journal_restore (uint32_t *uplinks, uint32_t *downlinks) {
+    uint32_t generation;
+
+    if (!modlora_nvs_get_uint(E_LORA_NVS_ELE_JOURNAL_GEN, &generation)) {
+        return false;
+    }
+
+    if (lora_nvs_journal_valid() && lora_nvs_journal.generation == generation) {
+        if (lora_nvs_journal.count > 0) {
+            lora_nvs_journal_entry_t *entry = &lora_nvs_journal.entries[lora_nvs_journal.count - 1];
+            *uplinks += entry->uplinks;
+            *downlinks += entry->downlinks;
+            *LoRaMacGetAdrAckCounter() = entry->adr_acks;
+        }
+        if (lora_nvs_journal.pending) {
+            // restored before without saving afterwards, frames may have been sent meanwhile
+            lora_nvs_journal.skipped += LORA_NVS_JOURNAL_MARGIN;
+        }
+        *uplinks += lora_nvs_journal.skipped;
+        lora_nvs_journal.pending = true;
+        lora_nvs_journal.crc = lora_nvs_journal_crc();
+    } else {
+        // the RTC memory was lost (power cycle), skip every counter that might have been journaled
+        // and move the NVS base forward so that a second restore doesn't hand out the same ones
+        *uplinks += LORA_NVS_JOURNAL_MAX_DELTA + LORA_NVS_JOURNAL_MARGIN;
+        modlora_nvs_set_uint(E_LORA_NVS_ELE_UPLINK, *uplinks);
+        nvs_commit(modlora_nvs_handle);
+        lora_nvs_journal_invalidate();
+    }
+    return true;
+}
+
 static int32_t lorawan_send (const byte *buf, uint32_t len, uint32_t timeout_ms, bool confirmed, uint32_t dr, uint32_t port) {
     lora_cmd_data_t cmd_data;
 
@@ -483,6 +828,7 @@ static int32_t lorawan_send (const byte *buf, uint32_t len, uint32_t timeout_ms,
     xEventGroupClearBits(LoRaEvents, LORA_STATUS_COMPLETED | LORA_STATUS_ERROR | LORA_STATUS_MSG_SIZE);
 
     // just pass to the LoRa queue
+    MPTRACE(MPTRACE_LORA_SEND, len, cmd_data.info.tx.port);
     if (!xQueueSend(xCmdQueue, (void *)&cmd_data, (TickType_t)(timeout_ms / portTICK_PERIOD_MS))) {
         return 0;
     }
@@ -512,6 +858,12 @@ static int32_t lorawan_send (const byte *buf, uint32_t len, uint32_t timeout_ms,
 
 static void McpsConfirm (McpsConfirm_t *McpsConfirm) {
     uint32_t status = LORA_STATUS_COMPLETED;
+    MPTRACE(MPTRACE_LORA_TX_CONFIRM, McpsConfirm->Status, McpsConfirm->NbRetries);
+    if (McpsConfirm->McpsRequest != MCPS_CONFIRMED || McpsConfirm->Status != LORAMAC_EVENT_INFO_STATUS_OK ||
+        McpsConfirm->AckReceived) {
+        // a confirmed frame still waiting for its ack is retransmitted, it counts once it's over
+        lora_adr_record(McpsConfirm->Datarate, McpsConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK);
+    }
     if (McpsConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK) {
         // save the values before calling the event handler
         lora_obj.sftx = McpsConfirm->Datarate;
@@ -525,7 +877,7 @@ static void McpsConfirm (McpsConfirm_t *McpsConfirm) {
             case MCPS_UNCONFIRMED: {
                 lora_obj.events |= MODLORA_TX_EVENT;
                 if (lora_obj.trigger & MODLORA_TX_EVENT) {
-                    mp_irq_queue_interrupt(lora_callback_handler, (void *)&lora_obj);
+                    mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
                 }
                 lora_obj.state = E_LORA_STATE_IDLE;
                 xEventGroupSetBits(LoRaEvents, status);
@@ -536,7 +888,7 @@ static void McpsConfirm (McpsConfirm_t *McpsConfirm) {
                 if (McpsConfirm->AckReceived) {
                     lora_obj.events |= MODLORA_TX_EVENT;
                     if (lora_obj.trigger & MODLORA_TX_EVENT) {
-                        mp_irq_queue_interrupt(lora_callback_handler, (void *)&lora_obj);
+                        mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
                     }
                     lora_obj.state = E_LORA_STATE_IDLE;
                     xEventGroupSetBits(LoRaEvents, status);
@@ -552,15 +904,15 @@ static void McpsConfirm (McpsConfirm_t *McpsConfirm) {
     } else {
         lora_obj.events |= MODLORA_TX_FAILED_EVENT;
         if (lora_obj.trigger & MODLORA_TX_FAILED_EVENT) {
-            mp_irq_queue_interrupt(lora_callback_handler, (void *)&lora_obj);
+            mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
         }
         lora_obj.state = E_LORA_STATE_IDLE;
         status |= LORA_STATUS_ERROR;
         xEventGroupSetBits(LoRaEvents, status);
     }
-#if defined(FIPY) || defined(LOPY4)
-    xSemaphoreGive(xLoRaSigfoxSem);
-#endif
+    // a select/poll waiting for the socket to become writable can go on
+    mp_hal_poll_wakeup();
+    radiosched_give(E_RADIOSCHED_LORAWAN, McpsConfirm->TxTimeOnAir);
 }
 
 static void McpsIndication (McpsIndication_t *mcpsIndication) {
@@ -597,6 +949,10 @@ static void McpsIndication (McpsIndication_t *mcpsIndication) {
     lora_obj.rssi = mcpsIndication->Rssi;
     lora_obj.snr = mcpsIndication->Snr;
     lora_obj.sfrx = mcpsIndication->RxDatarate;
+    if (mcpsIndication->RxSf >= 6 && mcpsIndication->RxSf <= 12) {
+        // the demodulation floor is -7.5 dB at SF7 and 2.5 dB lower for each step up
+        lora_adr_measured((int8_t)mcpsIndication->Snr + 30 + 10 * (mcpsIndication->RxSf - 7));
+    }
 
     if ((mcpsIndication->Port == 224) && (lora_obj.ComplianceTest.Enabled == true)
         && (lora_obj.ComplianceTest.Running == true)) {
@@ -620,14 +976,20 @@ static void McpsIndication (McpsIndication_t *mcpsIndication) {
 
     if (mcpsIndication->RxData && mcpsIndication->BufferSize > 0) {
         if (mcpsIndication->Port > 0 && mcpsIndication->Port < 224) {
-            if (mcpsIndication->BufferSize <= LORA_PAYLOAD_SIZE_MAX) {
-                memcpy((void *)rx_data_isr.data, mcpsIndication->Buffer, mcpsIndication->BufferSize);
-                rx_data_isr.len = mcpsIndication->BufferSize;
-                rx_data_isr.port = mcpsIndication->Port;
-                xQueueSend(xRxQueue, (void *)&rx_data_isr, 0);
+            uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+            lora_downlink_c_handler_t c_handler = lora_downlink_c_handler;
+            MICROPY_END_ATOMIC_SECTION(ilevel);
+            if (c_handler.handler != NULL && c_handler.handler(mcpsIndication->Buffer, mcpsIndication->BufferSize,
+                                                               mcpsIndication->Port, c_handler.arg)) {
+                // consumed by the C handler
+            } else if (mcpsIndication->BufferSize <= LORA_PAYLOAD_SIZE_MAX) {
+                if (lora_rx_ring_put(mcpsIndication->Buffer, mcpsIndication->BufferSize, mcpsIndication->Port)) {
+                    xSemaphoreGive(xRxSem);
+                    mp_hal_poll_wakeup();
+                }
                 lora_obj.events |= MODLORA_RX_EVENT;
                 if (lora_obj.trigger & MODLORA_RX_EVENT) {
-                    mp_irq_queue_interrupt(lora_callback_handler, (void *)&lora_obj);
+                    mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
                 }
             }
             // printf("Data on port 1 or 2 received\n");
@@ -650,8 +1012,8 @@ static void McpsIndication (McpsIndication_t *mcpsIndication) {
                         lora_obj.ComplianceTest.Running = true;
                         lora_obj.ComplianceTest.State = 1;
 
-                        // flush the rx queue
-                        xQueueReset(xRxQueue);
+                        // flush the rx ring
+                        lora_rx_ring_flush();
 
                         // enable ADR during test mode
                         MibRequestConfirm_t mibReq;
@@ -698,9 +1060,10 @@ static void McpsIndication (McpsIndication_t *mcpsIndication) {
                         // return the payload
                         if (bDoEcho) {
                             if (mcpsIndication->BufferSize <= LORA_PAYLOAD_SIZE_MAX) {
-                                memcpy((void *)rx_data_isr.data, mcpsIndication->Buffer, mcpsIndication->BufferSize);
-                                rx_data_isr.len = mcpsIndication->BufferSize;
-                                xQueueSend(xRxQueue, (void *)&rx_data_isr, 0);
+                                if (lora_rx_ring_put(mcpsIndication->Buffer, mcpsIndication->BufferSize, mcpsIndication->Port)) {
+                                    xSemaphoreGive(xRxSem);
+                                    mp_hal_poll_wakeup();
+                                }
                             }
                         } else {
                             // set the state back to 1
@@ -739,8 +1102,10 @@ static void MlmeConfirm (MlmeConfirm_t *MlmeConfirm) {
                 lora_obj.ComplianceTest.DownLinkCounter = 0;
                 break;
             case MLME_LINK_CHECK:
-                // Check DemodMargin
-                // Check NbGateways
+                lora_adr.link_checks++;
+                lora_adr.margin = MlmeConfirm->DemodMargin;
+                lora_adr.gateways = MlmeConfirm->NbGateways;
+                lora_adr_measured(MlmeConfirm->DemodMargin * 4);
                 if (lora_obj.ComplianceTest.Running == true) {
                     lora_obj.ComplianceTest.LinkCheck = true;
                     lora_obj.ComplianceTest.DemodMargin = MlmeConfirm->DemodMargin;
@@ -751,10 +1116,11 @@ static void MlmeConfirm (MlmeConfirm_t *MlmeConfirm) {
             default:
                 break;
         }
+    } else if (MlmeConfirm->MlmeRequest == MLME_LINK_CHECK) {
+        lora_adr.link_check_fails++;
+        lora_adr.gateways = 0;
     }
-#if defined(FIPY) || defined(LOPY4)
-    xSemaphoreGive(xLoRaSigfoxSem);
-#endif
+    radiosched_give(E_RADIOSCHED_LORAWAN, MlmeConfirm->TxTimeOnAir);
 }
 
 static void OnTxNextActReqTimerEvent(void) {
@@ -800,8 +1166,10 @@ static void TASK_LoRa (void *pvParameters) {
     lora_obj.state = E_LORA_STATE_NOINIT;
     lora_obj.pwr_mode = E_LORA_MODE_ALWAYS_ON;
 
+    mptaskmon_register(E_MPTASKMON_LORA, LORA_HEALTH_DEADLINE_MS);
     for ( ; ; ) {
         vTaskDelay (2 / portTICK_PERIOD_MS);
+        mptaskmon_beat(E_MPTASKMON_LORA);
 
         if(lora_obj.reset)
         {
@@ -815,14 +1183,18 @@ static void TASK_LoRa (void *pvParameters) {
         case E_LORA_STATE_RX:
         case E_LORA_STATE_SLEEP:
         case E_LORA_STATE_RESET:
-            // receive from the command queue and act accordingly
-            if (xQueueReceive(xCmdQueue, &task_cmd_data, 0)) {
+            // receive from the command queue (or continue with a pending batch) and act accordingly
+            if (xQueueReceive(xCmdQueue, &task_cmd_data, 0) || lora_tx_batch_next(&task_cmd_data)) {
                 switch (task_cmd_data.cmd) {
                 case E_LORA_CMD_INIT:
                     isReset = lora_obj.state == E_LORA_STATE_RESET? true:false;
+                    // an exchange cut short by the re-init would never hand the radio back
+                    radiosched_give(radiosched_holder(), 0);
                     // save the new configuration first
                     lora_set_config(&task_cmd_data);
                     if (task_cmd_data.info.init.stack_mode == E_LORA_STACK_MODE_LORAWAN) {
+                        // channel scanning is only supported in raw LoRa mode
+                        lora_scan.count = 0;
                         LoRaMacPrimitives.MacMcpsConfirm = McpsConfirm;
                         LoRaMacPrimitives.MacMcpsIndication = McpsIndication;
                         LoRaMacPrimitives.MacMlmeConfirm = MlmeConfirm;
@@ -865,6 +1237,8 @@ static void TASK_LoRa (void *pvParameters) {
                             result &= modlora_nvs_get_uint(E_LORA_NVS_ELE_ADR_ACKS, LoRaMacGetAdrAckCounter());
 
                             if (result) {
+                                bool journaled = lora_nvs_journal_restore(&uplinks, &downlinks);
+
                                 mibReq.Type = MIB_UPLINK_COUNTER;
                                 mibReq.Param.UpLinkCounter = uplinks;
                                 LoRaMacMibSetRequestConfirm( &mibReq );
@@ -930,8 +1304,10 @@ static void TASK_LoRa (void *pvParameters) {
 
                                 lora_obj.activation = E_LORA_ACTIVATION_ABP;
                                 lora_obj.state = E_LORA_STATE_JOIN;
-                                // clear the joined flag until the nvram_save method is called again
-                                modlora_nvs_set_uint(E_LORA_NVS_ELE_JOINED, (uint32_t)false);
+                                if (!journaled) {
+                                    // clear the joined flag until the nvram_save method is called again
+                                    modlora_nvs_set_uint(E_LORA_NVS_ELE_JOINED, (uint32_t)false);
+                                }
                             } else {
                                 lora_obj.state = E_LORA_STATE_IDLE;
                             }
@@ -945,6 +1321,7 @@ static void TASK_LoRa (void *pvParameters) {
                         RadioEvents.TxTimeout = OnTxTimeout;
                         RadioEvents.RxTimeout = OnRxTimeout;
                         RadioEvents.RxError = OnRxError;
+                        RadioEvents.CadDone = OnCadDone;
                         Radio.Init(&RadioEvents);
 
                         // radio configuration
@@ -975,24 +1352,62 @@ static void TASK_LoRa (void *pvParameters) {
                     }
                     lora_obj.state = E_LORA_STATE_JOIN;
                     break;
-                case E_LORA_CMD_TX:
+                case E_LORA_CMD_TX: {
+                    // never wait for the radio here, the task would stop serving everything else
+                    radiosched_owner_t owner = task_cmd_data.info.tx.owner;
+                    radiosched_result_t grant = radiosched_try(owner, task_cmd_data.info.tx.deadline_ms);
                     // implement Listen-before-Talk LBT, only for LoRa RAW (not LoRaWAN)
-                    if (lora_lbt_is_free()) {
+                    if (grant == E_RADIOSCHED_GRANTED && lora_lbt_is_free()) {
                         // no activity detected on Lora, so send the pack now
-
-                        // taking sigfox semaphore blocks ?!?!?
-                        // maybe, in the end of TX sempahore has to be released sooner
-//                        #if defined(FIPY) || defined(LOPY4)
-//                            xSemaphoreTake(xLoRaSigfoxSem, portMAX_DELAY);
-//                        #endif
+                        // raw LoRa transmissions are all accounted to band 0
+                        lora_raw_time_on_air = Radio.TimeOnAir(LORA_RAW_MODEM(), task_cmd_data.info.tx.len);
+                        lora_raw_tx_owner = owner;
+                        MPTRACE(MPTRACE_LORA_TX_START, task_cmd_data.info.tx.len, 0);
                         Radio.Send(task_cmd_data.info.tx.data, task_cmd_data.info.tx.len);
                         lora_obj.state = E_LORA_STATE_TX;
+                    } else if (grant == E_RADIOSCHED_MISSED) {
+                        // the channel or the radio stayed busy past the deadline, drop the frame
+                        lora_obj.events |= MODLORA_TX_FAILED_EVENT;
+                        if (lora_obj.trigger & MODLORA_TX_FAILED_EVENT) {
+                            mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
+                        }
+                        xEventGroupSetBits(LoRaEvents, LORA_STATUS_ERROR);
                     } else {
-                        // activity detected on Lora, so put the TX command back on queue on Front
+                        radiosched_give(owner, 0);
+                        // activity detected on Lora or the radio is in use, so put the TX command back on queue on Front
                         // to be executed on next Lora task
                         xQueueSendToFront(xCmdQueue, (void *)&task_cmd_data, (TickType_t)portMAX_DELAY);
                     }
                     break;
+                }
+                case E_LORA_CMD_TX_AT: {
+                    // no LBT here, the slot is given by the gateway schedule
+                    lora_raw_time_on_air = Radio.TimeOnAir(LORA_RAW_MODEM(), task_cmd_data.info.tx.len);
+                    lora_raw_tx_owner = E_RADIOSCHED_LORA;
+                    // the slot does not wait, if the radio is in use the frame is lost like a late one
+                    bool granted = radiosched_try(E_RADIOSCHED_LORA, RADIOSCHED_NO_DEADLINE) == E_RADIOSCHED_GRANTED;
+                    if (granted) {
+                        Radio.Standby();
+                        Radio.ArmTx(task_cmd_data.info.tx.data, task_cmd_data.info.tx.len);
+                    }
+                    if (granted && lora_tx_at_start(task_cmd_data.info.tx.at_us)) {
+                        MPTRACE(MPTRACE_LORA_TX_START, task_cmd_data.info.tx.len, 0);
+                        lora_obj.state = E_LORA_STATE_TX;
+                    } else {
+                        // too late to make the slot, drop the frame and go back to listening
+                        if (granted) {
+                            radiosched_give(E_RADIOSCHED_LORA, 0);
+                        }
+                        Radio.Sleep();
+                        lora_obj.events |= MODLORA_TX_FAILED_EVENT;
+                        if (lora_obj.trigger & MODLORA_TX_FAILED_EVENT) {
+                            mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
+                        }
+                        xEventGroupSetBits(LoRaEvents, LORA_STATUS_ERROR);
+                        lora_start_rx();
+                    }
+                    break;
+                }
                 case E_LORA_CMD_CONFIG_CHANNEL:
                     if (task_cmd_data.info.channel.add) {
                         ChannelParams_t channel =
@@ -1005,21 +1420,47 @@ static void TASK_LoRa (void *pvParameters) {
                     }
                     xEventGroupSetBits(LoRaEvents, LORA_STATUS_COMPLETED);
                     break;
+                case E_LORA_CMD_LORAWAN_TX_BATCH:
                 case E_LORA_CMD_LORAWAN_TX: {
                         LoRaMacTxInfo_t txInfo;
                         EventBits_t status = 0;
                         bool empty_frame = false;
+                        bool batch = (task_cmd_data.cmd == E_LORA_CMD_LORAWAN_TX_BATCH);
+                        uint32_t batch_len = 0;
                         int8_t mac_datarate = 0;
 
+                        if (batch) {
+                            task_cmd_data.info.tx.dr = lora_tx_batch.dr;
+                        }
+
                         // set the new data rate before checking if Tx is possible, but store the current one
                         if (!lora_obj.adr) {
                             mibReq.Type = MIB_CHANNELS_DATARATE;
                             LoRaMacMibGetRequestConfirm( &mibReq );
                             mac_datarate = mibReq.Param.ChannelsDatarate;
+                            if (lora_adr.fast) {
+                                task_cmd_data.info.tx.dr = lora_adr_fast_dr(task_cmd_data.info.tx.dr);
+                            }
                             mibReq.Param.ChannelsDatarate = task_cmd_data.info.tx.dr;
                             LoRaMacMibSetRequestConfirm( &mibReq );
                         }
 
+                        if (batch) {
+                            // pack as many of the queued payloads as the data rate allows into a single frame
+                            LoRaMacQueryTxPossible (0, &txInfo);
+                            batch_len = lora_tx_batch_fill(&task_cmd_data.info.tx, txInfo.MaxPossiblePayload);
+                            if (task_cmd_data.info.tx.len == 0) {
+                                // the next payload can't fit in a frame at this data rate, skip it
+                                lora_tx_batch.offset += batch_len;
+                                lora_tx_batch.errors++;
+                                if (!lora_obj.adr) {
+                                    mibReq.Param.ChannelsDatarate = mac_datarate;
+                                    LoRaMacMibSetRequestConfirm( &mibReq );
+                                }
+                                break;
+                            }
+                        }
+
                         if (LoRaMacQueryTxPossible (task_cmd_data.info.tx.len, &txInfo) != LORAMAC_STATUS_OK) {
                             // send an empty frame in order to flush MAC commands
                             mcpsReq.Type = MCPS_UNCONFIRMED;
@@ -1044,9 +1485,7 @@ static void TASK_LoRa (void *pvParameters) {
                                 mcpsReq.Req.Unconfirmed.Datarate = task_cmd_data.info.tx.dr;
                             }
                         }
-                    #if defined(FIPY) || defined(LOPY4)
-                        xSemaphoreTake(xLoRaSigfoxSem, portMAX_DELAY);
-                    #endif
+                        radiosched_take(E_RADIOSCHED_LORAWAN, RADIOSCHED_NO_DEADLINE);
 
                         // set back the original datarate
                         if (!lora_obj.adr) {
@@ -1054,15 +1493,24 @@ static void TASK_LoRa (void *pvParameters) {
                             LoRaMacMibSetRequestConfirm( &mibReq );
                         }
 
+                        MPTRACE(MPTRACE_LORA_TX_START, mcpsReq.Req.Unconfirmed.fBufferSize, 0);
                         if (LoRaMacMcpsRequest(&mcpsReq) != LORAMAC_STATUS_OK || empty_frame) {
                             // the command has failed, send the response now
                             lora_obj.state = E_LORA_STATE_IDLE;
-                            status |= LORA_STATUS_ERROR;
-                            xEventGroupSetBits(LoRaEvents, status);
-                        #if defined(FIPY) || defined(LOPY4)
-                            xSemaphoreGive(xLoRaSigfoxSem);
-                        #endif
+                            if (batch) {
+                                // the remaining frames would fail in the same way, drop them
+                                lora_tx_batch.offset = lora_tx_batch.len;
+                                lora_tx_batch.errors++;
+                            } else {
+                                status |= LORA_STATUS_ERROR;
+                                xEventGroupSetBits(LoRaEvents, status);
+                            }
+                            radiosched_give(E_RADIOSCHED_LORAWAN, 0);
                         } else {
+                            if (batch) {
+                                lora_tx_batch.offset += batch_len;
+                                lora_tx_batch.sent++;
+                            }
                             lora_obj.state = E_LORA_STATE_TX;
                         }
                     }
@@ -1071,22 +1519,51 @@ static void TASK_LoRa (void *pvParameters) {
                     Radio.Sleep();
                     lora_obj.state = E_LORA_STATE_SLEEP;
                     xEventGroupSetBits(LoRaEvents, LORA_STATUS_COMPLETED);
-                #if defined(FIPY) || defined(LOPY4)
-                    xSemaphoreGive(xLoRaSigfoxSem);
-                #endif
+                    radiosched_give(radiosched_holder(), 0);
                     break;
                 case E_LORA_CMD_WAKE_UP:
                     // just enable the receiver again
-                    Radio.Rx(LORA_RX_TIMEOUT);
-                    lora_obj.state = E_LORA_STATE_RX;
+                    lora_start_rx();
+                    xEventGroupSetBits(LoRaEvents, LORA_STATUS_COMPLETED);
+                    radiosched_give(radiosched_holder(), 0);
+                    break;
+                case E_LORA_CMD_WARM_RESTORE:
+                    // the MAC and the region have already been initialized by lora.init()
+                    LoRaMacSessionRestore(&lora_rtc_snapshot.session);
+                    lora_obj.net_id = lora_rtc_snapshot.session.NetID;
+                    lora_obj.u.abp.DevAddr = lora_rtc_snapshot.session.DevAddr;
+                    memcpy((void *)lora_obj.u.abp.NwkSKey, lora_rtc_snapshot.session.NwkSKey, sizeof(lora_obj.u.abp.NwkSKey));
+                    memcpy((void *)lora_obj.u.abp.AppSKey, lora_rtc_snapshot.session.AppSKey, sizeof(lora_obj.u.abp.AppSKey));
+                    // use it only once
+                    lora_rtc_snapshot.magic = 0;
+                    lora_obj.activation = E_LORA_ACTIVATION_ABP;
+                    lora_obj.joined = false;
+                    lora_obj.state = E_LORA_STATE_JOIN;
+                    break;
+                case E_LORA_CMD_SCAN:
+                    memcpy(lora_scan.frequency, task_cmd_data.info.scan.frequency, sizeof(lora_scan.frequency));
+                    memcpy(lora_scan.sf, task_cmd_data.info.scan.sf, sizeof(lora_scan.sf));
+                    // the first hop goes to channel 0
+                    lora_scan.index = task_cmd_data.info.scan.count - 1;
+                    lora_scan.count = task_cmd_data.info.scan.count;
+                    if (lora_obj.state != E_LORA_STATE_SLEEP) {
+                        Radio.Standby();
+                        if (lora_scan.count > 0) {
+                            lora_scan_cad();
+                        } else {
+                            // back to the configured channel
+                            lora_get_config(&task_cmd_data);
+                            lora_radio_setup(&task_cmd_data.info.init);
+                        }
+                    }
                     xEventGroupSetBits(LoRaEvents, LORA_STATUS_COMPLETED);
-                #if defined(FIPY) || defined(LOPY4)
-                    xSemaphoreGive(xLoRaSigfoxSem);
-                #endif
                     break;
                 default:
                     break;
                 }
+            } else if (lora_scan.count > 0 && lora_obj.state == E_LORA_STATE_RX && Radio.GetStatus() != RF_RX_RUNNING) {
+                // a command interrupted the scan, resume it
+                lora_scan_cad();
 //            } else if (lora_obj.state == E_LORA_STATE_IDLE && lora_obj.stack_mode == E_LORA_STACK_MODE_LORA) {
 //                Radio.Rx(LORA_RX_TIMEOUT);
 //                lora_obj.state = E_LORA_STATE_RX;
@@ -1096,9 +1573,7 @@ static void TASK_LoRa (void *pvParameters) {
             TimerStop( &TxNextActReqTimer );
             if (!lora_obj.joined) {
                 if (lora_obj.activation == E_LORA_ACTIVATION_OTAA) {
-                #if defined(FIPY) || defined(LOPY4)
-                    xSemaphoreTake(xLoRaSigfoxSem, portMAX_DELAY);
-                #endif
+                    radiosched_take(E_RADIOSCHED_LORAWAN, RADIOSCHED_NO_DEADLINE);
                     mibReq.Type = MIB_NETWORK_ACTIVATION;
                     mibReq.Param.NetworkActivation = ACTIVATION_TYPE_OTAA;
                     LoRaMacMibSetRequestConfirm( &mibReq );
@@ -1153,6 +1628,25 @@ static void TASK_LoRa (void *pvParameters) {
             // we need to perform a mode transition in order to clear the TxRx FIFO
             Radio.Sleep();
             //lora_obj.state = E_LORA_STATE_IDLE;
+            lora_start_rx();
+            break;
+        case E_LORA_STATE_CAD:
+            // recover if the CAD done interrupt got lost
+            if (--lora_scan.guard == 0) {
+                lora_scan_cad();
+            }
+            break;
+        case E_LORA_STATE_CAD_DONE:
+            if (uxQueueMessagesWaiting(xCmdQueue) > 0) {
+                // nothing on this channel, let the pending commands run first
+                Radio.Standby();
+                lora_obj.state = E_LORA_STATE_RX;
+            } else {
+                lora_scan_cad();
+            }
+            break;
+        case E_LORA_STATE_CAD_DETECTED:
+            // activity on this channel, stay on it and receive a single frame
             lora_obj.state = E_LORA_STATE_RX;
             Radio.Rx(LORA_RX_TIMEOUT);
             break;
@@ -1162,23 +1656,18 @@ static void TASK_LoRa (void *pvParameters) {
             // we need to perform a mode transition in order to clear the TxRx FIFO
             Radio.Sleep();
             xEventGroupSetBits(LoRaEvents, LORA_STATUS_COMPLETED);
+            mp_hal_poll_wakeup();
             //lora_obj.state = E_LORA_STATE_IDLE;
-            lora_obj.state = E_LORA_STATE_RX;
-            Radio.Rx(LORA_RX_TIMEOUT);
-        #if defined(FIPY) || defined(LOPY4)
-            xSemaphoreGive(xLoRaSigfoxSem);
-        #endif
+            lora_start_rx();
+            radiosched_give(lora_raw_tx_owner, lora_raw_time_on_air);
             break;
         case E_LORA_STATE_TX_TIMEOUT:
             // we need to perform a mode transition in order to clear the TxRx FIFO
             Radio.Sleep();
             xEventGroupSetBits(LoRaEvents, LORA_STATUS_ERROR);
             //lora_obj.state = E_LORA_STATE_IDLE;
-            lora_obj.state = E_LORA_STATE_RX;
-            Radio.Rx(LORA_RX_TIMEOUT);
-        #if defined(FIPY) || defined(LOPY4)
-            xSemaphoreGive(xLoRaSigfoxSem);
-        #endif
+            lora_start_rx();
+            radiosched_give(lora_raw_tx_owner, 0);
             break;
         default:
             break;
@@ -1223,7 +1712,7 @@ static bool lora_lbt_is_free(void)
 
     do {
         if (RF_RX_RUNNING == Radio.GetStatus()) {
-            rssi = Radio.Rssi(MODEM_LORA);
+            rssi = Radio.Rssi(LORA_RAW_MODEM());
         }
         rssi_max = (rssi > rssi_max) ? rssi : rssi_max;
 
@@ -1245,86 +1734,199 @@ static void lora_callback_handler(void *arg) {
     }
 }
 
+static IRAM_ATTR void lora_tx_at_fire (void *arg) {
+    (void)arg;
+    Radio.FireTx();
+}
+
+/*! lora_tx_at_start schedules the armed frame on the main timer
+ * at_us is on the esp_timer clock of the RX timestamps, both clocks are sampled
+ * together so the compare value is exact to a clock tick plus the ISR latency
+ * returns false if the time left is below the guard (the slot can't be made)
+ */
+static bool lora_tx_at_start (uint32_t at_us) {
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t now_us = (uint32_t)mp_hal_ticks_us_non_blocking();
+    uint64_t now_clk = machtimer_get_timer_counter_value();
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+
+    int32_t delta_us = (int32_t)(at_us - now_us);
+    if (delta_us < LORA_TX_AT_GUARD_US) {
+        return false;
+    }
+    return machtimer_compare_start(MACHTIMER_COMPARE_CHANNEL_LORA, now_clk + (uint64_t)delta_us * (CLK_FREQ / 1000000),
+                                   0, lora_tx_at_fire, NULL);
+}
+
 static IRAM_ATTR void OnTxDone (void) {
+    MPTRACE(MPTRACE_LORA_TX_DONE, 0, 0);
+    LoRaMacAirtimeRecord(0, lora_raw_time_on_air, TimerGetCurrentTime());
     lora_obj.events |= MODLORA_TX_EVENT;
     if (lora_obj.trigger & MODLORA_TX_EVENT) {
-        mp_irq_queue_interrupt(lora_callback_handler, (void *)&lora_obj);
+        mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
     }
     lora_obj.state = E_LORA_STATE_TX_DONE;
 }
 
+static IRAM_ATTR void OnCadDone (bool channelActivityDetected) {
+    lora_obj.state = channelActivityDetected ? E_LORA_STATE_CAD_DETECTED : E_LORA_STATE_CAD_DONE;
+}
+
 static IRAM_ATTR void OnRxDone (uint8_t *payload, uint32_t timestamp, uint16_t size, int16_t rssi, int8_t snr, uint8_t sf) {
+    MPTRACE(MPTRACE_LORA_RX_DONE, size, rssi);
     lora_obj.rx_timestamp = timestamp;
     lora_obj.rssi = rssi;
     lora_obj.snr = snr;
     lora_obj.sfrx = sf;
     if (size <= LORA_PAYLOAD_SIZE_MAX) {
-        memcpy((void *)rx_data_isr.data, payload, size);
-        rx_data_isr.len = size;
-        xQueueSendFromISR(xRxQueue, (void *)&rx_data_isr, NULL);
+        // the payload goes straight into the ring, no intermediate frame buffer
+        // while scanning, the port tells on which of the scan channels the frame was received
+        if (lora_rx_ring_put(payload, size, (lora_scan.count > 0) ? lora_scan.index : 0)) {
+            xSemaphoreGiveFromISR(xRxSem, NULL);
+            mp_hal_poll_wakeup();
+        }
     }
 
     lora_obj.events |= MODLORA_RX_EVENT;
     if (lora_obj.trigger & MODLORA_RX_EVENT) {
-        mp_irq_queue_interrupt(lora_callback_handler, (void *)&lora_obj);
+        mp_irq_queue_interrupt_prio(lora_callback_handler, (void *)&lora_obj, MP_IRQ_PRIORITY_HIGH);
     }
 
     lora_obj.state = E_LORA_STATE_RX_DONE;
 }
 
 static IRAM_ATTR void OnTxTimeout (void) {
+    MPTRACE(MPTRACE_LORA_TX_TIMEOUT, 1, 0);
     lora_obj.state = E_LORA_STATE_TX_TIMEOUT;
 }
 
 static IRAM_ATTR void OnRxTimeout (void) {
+    MPTRACE(MPTRACE_LORA_RX_TIMEOUT, 0, 0);
     lora_obj.state = E_LORA_STATE_RX_TIMEOUT;
 }
 
 static IRAM_ATTR void OnRxError (void) {
+    MPTRACE(MPTRACE_LORA_RX_ERROR, 0, 0);
     lora_obj.state = E_LORA_STATE_RX_ERROR;
 }
 
 static void lora_radio_setup (lora_init_cmd_data_t *init_data) {
     uint16_t symbol_to = 8;
 
-    Radio.SetModem(MODEM_LORA);
-
-    if (init_data->public) {
-        Radio.Write(REG_LR_SYNCWORD, LORA_MAC_PUBLIC_SYNCWORD);
+    if (init_data->stack_mode == E_LORA_STACK_MODE_FSK) {
+        lora_fsk_setup(init_data);
     } else {
-        Radio.Write(REG_LR_SYNCWORD, LORA_MAC_PRIVATE_SYNCWORD);
-    }
+        Radio.SetModem(MODEM_LORA);
 
-    Radio.SetChannel(init_data->frequency);
+        if (init_data->public) {
+            Radio.Write(REG_LR_SYNCWORD, LORA_MAC_PUBLIC_SYNCWORD);
+        } else {
+            Radio.Write(REG_LR_SYNCWORD, LORA_MAC_PRIVATE_SYNCWORD);
+        }
+
+        Radio.SetChannel(init_data->frequency);
 
-    Radio.SetTxConfig(MODEM_LORA, init_data->tx_power, 0, init_data->bandwidth,
-                                  init_data->sf, init_data->coding_rate,
-                                  init_data->preamble, LORA_FIX_LENGTH_PAYLOAD_OFF,
-                                  true, 0, 0, init_data->txiq, LORA_TX_TIMEOUT_MAX);
+        Radio.SetTxConfig(MODEM_LORA, init_data->tx_power, 0, init_data->bandwidth,
+                                      init_data->sf, init_data->coding_rate,
+                                      init_data->preamble, LORA_FIX_LENGTH_PAYLOAD_OFF,
+                                      true, 0, 0, init_data->txiq, LORA_TX_TIMEOUT_MAX);
 
-    Radio.SetRxConfig(MODEM_LORA, init_data->bandwidth, init_data->sf,
-                                  init_data->coding_rate, 0, init_data->preamble,
-                                  symbol_to, LORA_FIX_LENGTH_PAYLOAD_OFF,
-                                  0, true, 0, 0, init_data->rxiq, true);
+        Radio.SetRxConfig(MODEM_LORA, init_data->bandwidth, init_data->sf,
+                                      init_data->coding_rate, 0, init_data->preamble,
+                                      symbol_to, LORA_FIX_LENGTH_PAYLOAD_OFF,
+                                      0, true, 0, 0, init_data->rxiq, true);
 
-    Radio.SetMaxPayloadLength(MODEM_LORA, LORA_PAYLOAD_SIZE_MAX);
+        Radio.SetMaxPayloadLength(MODEM_LORA, LORA_PAYLOAD_SIZE_MAX);
+    }
 
     if (init_data->power_mode == E_LORA_MODE_ALWAYS_ON) {
         // start listening
-        Radio.Rx(LORA_RX_TIMEOUT);
-        lora_obj.state = E_LORA_STATE_RX;
+        lora_start_rx();
     } else {
         Radio.Sleep();
         lora_obj.state = E_LORA_STATE_SLEEP;
     }
 }
 
+/*! lora_fsk_setup configures the FSK modem and its packet engine (preamble, sync word, CRC
+ * and whitening), frames are variable length and limited to what fits in the FIFO
+ */
+static void lora_fsk_setup (lora_init_cmd_data_t *init_data) {
+    // Carson's rule, single side: the channel filter passes the deviation plus half the bit rate
+    uint32_t rx_bw = init_data->fdev + init_data->bitrate / 2;
+
+    // channel scanning is only supported in raw LoRa mode
+    lora_scan.count = 0;
+
+    Radio.SetModem(MODEM_FSK);
+    Radio.SetChannel(init_data->frequency);
+
+    Radio.SetTxConfig(MODEM_FSK, init_data->tx_power, init_data->fdev, 0,
+                                 init_data->bitrate, 0, init_data->preamble, false,
+                                 init_data->crc, 0, 0, false, LORA_TX_TIMEOUT_MAX);
+
+    // the AFC needs room for the crystal offsets on both sides
+    Radio.SetRxConfig(MODEM_FSK, rx_bw, init_data->bitrate, 0, MIN(rx_bw * 2, LORA_FSK_RX_BW_MAX),
+                                 init_data->preamble, 0, false, 0, init_data->crc, 0, 0, false, true);
+
+    // the receiver restarts on its own once a frame has been read out of the FIFO
+    Radio.Write(REG_SYNCCONFIG, (Radio.Read(REG_SYNCCONFIG) & RF_SYNCCONFIG_AUTORESTARTRXMODE_MASK &
+                                 RF_SYNCCONFIG_SYNC_MASK & RF_SYNCCONFIG_SYNCSIZE_MASK) |
+                                 RF_SYNCCONFIG_AUTORESTARTRXMODE_WAITPLL_ON | RF_SYNCCONFIG_SYNC_ON |
+                                 (init_data->sync_word_len - 1));
+    for (uint32_t i = 0; i < init_data->sync_word_len; i++) {
+        Radio.Write(REG_SYNCVALUE1 + i, init_data->sync_word[i]);
+    }
+    Radio.Write(REG_PACKETCONFIG1, (Radio.Read(REG_PACKETCONFIG1) & RF_PACKETCONFIG1_DCFREE_MASK) |
+                                   (init_data->whitening ? RF_PACKETCONFIG1_DCFREE_WHITENING : RF_PACKETCONFIG1_DCFREE_OFF));
+
+    Radio.SetMaxPayloadLength(MODEM_FSK, RADIO_FSK_PAYLOAD_MAX);
+}
+
+/*! lora_start_rx puts the radio back in receive mode, or continues scanning if enabled
+ */
+static void lora_start_rx (void) {
+    if (lora_scan.count > 0) {
+        lora_scan_cad();
+    } else {
+        Radio.Rx(LORA_RX_TIMEOUT);
+        lora_obj.state = E_LORA_STATE_RX;
+    }
+}
+
+/*! lora_scan_cad tunes the radio to the next scan channel and starts a channel activity detection
+ */
+static void lora_scan_cad (void) {
+    lora_scan.index = (lora_scan.index + 1) % lora_scan.count;
+
+    Radio.Standby();
+    Radio.SetChannel(lora_scan.frequency[lora_scan.index]);
+    Radio.SetRxConfig(MODEM_LORA, lora_obj.bandwidth, lora_scan.sf[lora_scan.index],
+                                  lora_obj.coding_rate, 0, lora_obj.preamble,
+                                  8, LORA_FIX_LENGTH_PAYLOAD_OFF,
+                                  0, true, 0, 0, lora_obj.rxiq, false);
+
+    lora_scan.guard = LORA_SCAN_CAD_GUARD;
+    lora_obj.state = E_LORA_STATE_CAD;
+    Radio.StartCad();
+}
+
 static void lora_validate_mode (uint32_t mode) {
-    if (mode > E_LORA_STACK_MODE_LORAWAN) {
+    if (mode > E_LORA_STACK_MODE_FSK) {
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "invalid mode %d", mode));
     }
 }
 
+static void lora_validate_fsk (uint32_t bitrate, uint32_t fdev) {
+    if (bitrate < LORA_FSK_BITRATE_MIN || bitrate > LORA_FSK_BITRATE_MAX) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "bitrate %d out of range", bitrate));
+    }
+    // the signal has to fit in the widest channel filter
+    if (fdev < LORA_FSK_FDEV_MIN || fdev + bitrate / 2 > LORA_FSK_RX_BW_MAX) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "frequency deviation %d out of range", fdev));
+    }
+}
+
 static void lora_validate_frequency (uint32_t frequency) {
     switch (lora_obj.region) {
         case LORAMAC_REGION_AS923:
@@ -1432,27 +2034,10 @@ static void lora_validate_power (uint8_t tx_power) {
 }
 
 static bool lora_validate_data_rate (uint32_t data_rate) {
-
-    switch (lora_obj.region) {
-    case LORAMAC_REGION_AS923:
-    case LORAMAC_REGION_EU868:
-    case LORAMAC_REGION_AU915:
-    case LORAMAC_REGION_CN470:
-    case LORAMAC_REGION_IN865:
-        if (data_rate > DR_6) {
-            return false;
-        }
-        break;
-    case LORAMAC_REGION_US915:
-    case LORAMAC_REGION_US915_HYBRID:
-        if (data_rate > DR_4) {
-            return false;
-        }
-        break;
-    default:
-        break;
+    if (lora_obj.region >= LORAMAC_REGION_MAX) {
+        return true;
     }
-    return true;
+    return data_rate <= lora_region_max_data_rate[lora_obj.region];
 }
 
 static void lora_validate_bandwidth (uint8_t bandwidth) {
@@ -1510,6 +2095,12 @@ static void lora_set_config (lora_cmd_data_t *cmd_data) {
     lora_obj.tx_retries = cmd_data->info.init.tx_retries;
     lora_obj.device_class = cmd_data->info.init.device_class;
     lora_obj.region = cmd_data->info.init.region;
+    lora_obj.bitrate = cmd_data->info.init.bitrate;
+    lora_obj.fdev = cmd_data->info.init.fdev;
+    memcpy(lora_obj.sync_word, cmd_data->info.init.sync_word, sizeof(lora_obj.sync_word));
+    lora_obj.sync_word_len = cmd_data->info.init.sync_word_len;
+    lora_obj.crc = cmd_data->info.init.crc;
+    lora_obj.whitening = cmd_data->info.init.whitening;
 }
 
 static void lora_get_config (lora_cmd_data_t *cmd_data) {
@@ -1528,6 +2119,12 @@ static void lora_get_config (lora_cmd_data_t *cmd_data) {
     cmd_data->info.init.tx_retries = lora_obj.tx_retries;
     cmd_data->info.init.device_class = lora_obj.device_class;
     cmd_data->info.init.region = lora_obj.region;
+    cmd_data->info.init.bitrate = lora_obj.bitrate;
+    cmd_data->info.init.fdev = lora_obj.fdev;
+    memcpy(cmd_data->info.init.sync_word, lora_obj.sync_word, sizeof(cmd_data->info.init.sync_word));
+    cmd_data->info.init.sync_word_len = lora_obj.sync_word_len;
+    cmd_data->info.init.crc = lora_obj.crc;
+    cmd_data->info.init.whitening = lora_obj.whitening;
 }
 
 static void lora_send_cmd (lora_cmd_data_t *cmd_data) {
@@ -1546,7 +2143,7 @@ static void lora_send_cmd (lora_cmd_data_t *cmd_data) {
     }
 }
 
-static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms) {
+static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms, radiosched_owner_t owner) {
     lora_cmd_data_t cmd_data;
 
 /*
@@ -1561,6 +2158,14 @@ static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms) {
     cmd_data.cmd = E_LORA_CMD_TX;
     memcpy (cmd_data.info.tx.data, buf, len);
     cmd_data.info.tx.len = len;
+    cmd_data.info.tx.owner = owner;
+    cmd_data.info.tx.deadline_ms = RADIOSCHED_NO_DEADLINE;
+    if (owner == E_RADIOSCHED_MESH) {
+        cmd_data.info.tx.deadline_ms = mp_hal_ticks_ms() + RADIOSCHED_MESH_DEADLINE_MS;
+    } else if ((int32_t)timeout_ms > 0) {
+        // a socket timeout also bounds how long the frame may wait for the radio
+        cmd_data.info.tx.deadline_ms = mp_hal_ticks_ms() + timeout_ms;
+    }
 
     if (timeout_ms < 0) {
         // blocking mode
@@ -1570,6 +2175,7 @@ static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms) {
     xEventGroupClearBits(LoRaEvents, LORA_STATUS_COMPLETED | LORA_STATUS_ERROR | LORA_STATUS_MSG_SIZE);
 
     // just pass to the LoRa queue
+    MPTRACE(MPTRACE_LORA_SEND, len, 0);
     if (!xQueueSend(xCmdQueue, (void *)&cmd_data, (TickType_t)(timeout_ms / portTICK_PERIOD_MS))) {
         //printf("Q full\n");
         return 0;
@@ -1588,7 +2194,7 @@ static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms) {
     }
 
     // calculate the time on air
-    lora_obj.tx_time_on_air = Radio.TimeOnAir(MODEM_LORA, len);
+    lora_obj.tx_time_on_air = Radio.TimeOnAir(LORA_RAW_MODEM(), len);
     lora_obj.tx_counter += 1;
     lora_obj.tx_frequency = lora_obj.frequency;
 
@@ -1596,58 +2202,150 @@ static int32_t lora_send (const byte *buf, uint32_t len, uint32_t timeout_ms) {
     return len;
 }
 
-static int32_t lora_recv (byte *buf, uint32_t len, int32_t timeout_ms, uint32_t *port) {
-    lora_rx_data_t rx_data;
+static void lora_adr_measured (int16_t margin_q) {
+    lora_adr.last_margin_q = margin_q;
+    lora_adr.measured = true;
+    lora_adr.fresh = true;
+}
 
-    if (timeout_ms < 0) {
-        // blocking mode
-        timeout_ms = portMAX_DELAY;
+static void lora_adr_record (uint8_t dr, bool success) {
+    if (dr < LORA_ADR_DR_NUM) {
+        lora_adr.sent[dr]++;
+        if (success) {
+            lora_adr.ok[dr]++;
+        }
     }
-
-    // if there's a partial packet pending
-    if (lora_partial_rx_packet.size > 0) {
-        // adjust the len
-        uint32_t available_len = lora_partial_rx_packet.size - lora_partial_rx_packet.index;
-        if (available_len < len) {
-            len = available_len;
+    if (!lora_adr.fast || dr != lora_adr.fast_dr) {
+        // sent at some other rate, it says nothing about this one
+        return;
+    }
+    if (!success) {
+        lora_adr.fast_run = 0;
+        lora_adr.fresh = false;
+        if (lora_adr.fast_dr > lora_adr.fast_floor) {
+            lora_adr.fast_dr--;
+            lora_adr.steps_down++;
         }
+    } else if (++lora_adr.fast_run >= lora_adr.fast_frames && lora_adr.fresh &&
+               lora_adr.fast_dr < lora_adr.fast_dr_max &&
+               lora_adr.last_margin_q - LORA_ADR_STEP_MARGIN_Q >= lora_adr.fast_margin * 4) {
+        // there is room for one more step, and only one at a time
+        lora_adr.fast_dr++;
+        lora_adr.fast_run = 0;
+        lora_adr.fresh = false;
+        lora_adr.steps_up++;
+    }
+}
 
-        // get the available data
-        memcpy(buf, (void *)&lora_partial_rx_packet.data[lora_partial_rx_packet.index], len);
-        if (port != NULL) {
-            *port = rx_data.port;
-        }
+// never under what the socket asked for
+static uint8_t lora_adr_fast_dr (uint8_t floor) {
+    if (lora_adr.fast_dr < floor) {
+        lora_adr.fast_dr = floor;
+        lora_adr.fast_run = 0;
+    } else if (lora_adr.fast_dr > MAX(floor, lora_adr.fast_dr_max)) {
+        lora_adr.fast_dr = MAX(floor, lora_adr.fast_dr_max);
+    }
+    lora_adr.fast_floor = floor;
+    return lora_adr.fast_dr;
+}
 
-        // update the index and size values
-        lora_partial_rx_packet.index += len;
-        if (lora_partial_rx_packet.index == lora_partial_rx_packet.size) {
-            // there's no more data left
-            lora_partial_rx_packet.size = 0;
-        }
-        // return the number of bytes received
-        return len;
-    } else if (xQueueReceive(xRxQueue, &rx_data, (TickType_t)(timeout_ms / portTICK_PERIOD_MS))) {
-        // adjust the len
-        if (rx_data.len < len) {
-            len = rx_data.len;
-        }
+static IRAM_ATTR void lora_rx_ring_write (uint32_t index, const void *src, uint32_t len) {
+    uint32_t start = index & LORA_RX_RING_MASK;
+    uint32_t chunk = MIN(len, LORA_RX_RING_SIZE - start);
+    memcpy(&lora_rx_ring.data[start], src, chunk);
+    memcpy(lora_rx_ring.data, (const uint8_t *)src + chunk, len - chunk);
+}
 
-        // get the available data
-        memcpy(buf, rx_data.data, len);
-        if (port != NULL) {
-            *port = rx_data.port;
-        }
+static void lora_rx_ring_read (uint32_t index, void *dst, uint32_t len) {
+    uint32_t start = index & LORA_RX_RING_MASK;
+    uint32_t chunk = MIN(len, LORA_RX_RING_SIZE - start);
+    memcpy(dst, &lora_rx_ring.data[start], chunk);
+    memcpy((uint8_t *)dst + chunk, lora_rx_ring.data, len - chunk);
+}
+
+/*! lora_rx_ring_put stores a frame (header + payload) in the RX ring
+ * frames only take the space they need, so bursts of short frames fit without loss
+ * returns false (and counts the frame as dropped) if there's not enough space left
+ */
+static IRAM_ATTR bool lora_rx_ring_put (const uint8_t *payload, uint8_t len, uint8_t port) {
+    lora_rx_frame_hdr_t hdr = { .len = len, .port = port };
+    bool stored = false;
+
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    if (LORA_RX_RING_SIZE - (lora_rx_ring.head - lora_rx_ring.tail) >= sizeof(hdr) + len) {
+        lora_rx_ring_write(lora_rx_ring.head, &hdr, sizeof(hdr));
+        lora_rx_ring_write(lora_rx_ring.head + sizeof(hdr), payload, len);
+        lora_rx_ring.head += sizeof(hdr) + len;
+        stored = true;
+    } else {
+        lora_rx_ring.dropped++;
+    }
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+    return stored;
+}
+
+/*! lora_rx_ring_get copies up to len bytes of the oldest frame directly into buf
+ * the frame is released once all of its payload has been read
+ * returns the number of bytes copied or -1 if the ring is empty
+ */
+static int32_t lora_rx_ring_get (byte *buf, uint32_t len, uint32_t *port) {
+    lora_rx_frame_hdr_t hdr;
+
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    if (lora_rx_ring.head == lora_rx_ring.tail) {
+        MICROPY_END_ATOMIC_SECTION(ilevel);
+        return -1;
+    }
+    lora_rx_ring_read(lora_rx_ring.tail, &hdr, sizeof(hdr));
+    uint32_t available_len = hdr.len - lora_rx_ring.offset;
+    if (available_len < len) {
+        len = available_len;
+    }
+    lora_rx_ring_read(lora_rx_ring.tail + sizeof(hdr) + lora_rx_ring.offset, buf, len);
+    lora_rx_ring.offset += len;
+    if (lora_rx_ring.offset == hdr.len) {
+        // there's no more data left, free the slot
+        lora_rx_ring.tail += sizeof(hdr) + hdr.len;
+        lora_rx_ring.offset = 0;
+    }
+    MICROPY_END_ATOMIC_SECTION(ilevel);
 
-        // copy the remainder to the partial data buffer
-        int32_t r_len = rx_data.len - len;
-        if (r_len > 0) {
-            memcpy((void *)lora_partial_rx_packet.data, &rx_data.data[len], r_len);
-            lora_partial_rx_packet.size = r_len;
-            lora_partial_rx_packet.index = 0;
-            lora_partial_rx_packet.port = rx_data.port;
+    if (port != NULL) {
+        *port = hdr.port;
+    }
+    return len;
+}
+
+static void lora_rx_ring_flush (void) {
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    lora_rx_ring.tail = lora_rx_ring.head;
+    lora_rx_ring.offset = 0;
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
+
+static int32_t lora_recv (byte *buf, uint32_t len, int32_t timeout_ms, uint32_t *port) {
+    TickType_t timeout_ticks;
+
+    if (timeout_ms < 0) {
+        // blocking mode
+        timeout_ticks = portMAX_DELAY;
+    } else {
+        timeout_ticks = (TickType_t)(timeout_ms / portTICK_PERIOD_MS);
+    }
+
+    int32_t ret = lora_rx_ring_get(buf, len, port);
+    if (ret < 0 && timeout_ms != 0) {
+        // discard a notification left behind by a frame that has already been read
+        xSemaphoreTake(xRxSem, 0);
+        if (!lora_rx_any()) {
+            xSemaphoreTake(xRxSem, timeout_ticks);
         }
+        ret = lora_rx_ring_get(buf, len, port);
+    }
+
+    if (ret >= 0) {
         // return the number of bytes received
-        return len;
+        return ret;
     }
     // non-blocking sockects do not thrown timeout errors
     if (timeout_ms == 0) {
@@ -1658,22 +2356,63 @@ static int32_t lora_recv (byte *buf, uint32_t len, int32_t timeout_ms, uint32_t
 }
 
 static bool lora_rx_any (void) {
-    lora_rx_data_t rx_data;
-    if (lora_partial_rx_packet.size > 0) {
-        return true;
-    } else if (xQueuePeek(xRxQueue, &rx_data, (TickType_t)0)) {
+    return lora_rx_ring.head != lora_rx_ring.tail;
+}
+
+static bool lora_tx_space (void) {
+    if (uxQueueSpacesAvailable(xCmdQueue) > 0) {
         return true;
     }
     return false;
 }
 
-static bool lora_tx_space (void) {
-    if (uxQueueSpacesAvailable(xCmdQueue) > 0) {
+/*! lora_tx_batch_next is called by the LoRa task when the command queue is empty
+ * as soon as the previous frame has been confirmed the next frame of the batch is scheduled,
+ * the MAC delays it further if the duty cycle requires so
+ * returns true if cmd_data holds a batch TX command to execute
+ */
+static bool lora_tx_batch_next (lora_cmd_data_t *cmd_data) {
+    if (lora_tx_batch.len == 0 || lora_obj.state != E_LORA_STATE_IDLE) {
+        return false;
+    }
+    if (lora_tx_batch.offset < lora_tx_batch.len) {
+        cmd_data->cmd = E_LORA_CMD_LORAWAN_TX_BATCH;
         return true;
     }
+    // all frames of the batch are done, release the batch buffer
+    lora_tx_batch.len = 0;
+    lora_tx_batch.offset = 0;
+    xSemaphoreGive(xTxBatchSem);
     return false;
 }
 
+/*! lora_tx_batch_fill copies whole records from the batch buffer into tx, up to max_len bytes
+ * returns the number of batch bytes consumed. If the first record is already larger than max_len
+ * tx->len is set to 0 and the size of that record is returned so that it can be skipped
+ */
+static uint32_t lora_tx_batch_fill (lora_tx_cmd_data_t *tx, uint8_t max_len) {
+    uint32_t offset = lora_tx_batch.offset;
+
+    tx->len = 0;
+    tx->port = lora_tx_batch.port;
+    tx->dr = lora_tx_batch.dr;
+    tx->confirmed = lora_tx_batch.confirmed;
+
+    while (offset < lora_tx_batch.len) {
+        uint32_t rec_len = lora_tx_batch.data[offset] + 1;
+        if (tx->len + rec_len > max_len) {
+            if (tx->len == 0) {
+                offset += rec_len;
+            }
+            break;
+        }
+        memcpy(&tx->data[tx->len], &lora_tx_batch.data[offset], rec_len);
+        tx->len += rec_len;
+        offset += rec_len;
+    }
+    return offset - lora_tx_batch.offset;
+}
+
 /******************************************************************************/
 // Micro Python bindings; LoRa class
 
@@ -1767,6 +2506,25 @@ static mp_obj_t lora_init_helper(lora_obj_t *self, const mp_arg_val_t *args) {
     cmd_data.info.init.device_class = args[13].u_int;
     lora_validate_device_class(cmd_data.info.init.device_class);
 
+    // the FSK modem and packet engine settings
+    cmd_data.info.init.bitrate = args[15].u_int;
+    cmd_data.info.init.fdev = args[16].u_int;
+    lora_validate_fsk(cmd_data.info.init.bitrate, cmd_data.info.init.fdev);
+    if (args[17].u_obj == mp_const_none) {
+        memcpy(cmd_data.info.init.sync_word, lora_fsk_def_sync_word, sizeof(lora_fsk_def_sync_word));
+        cmd_data.info.init.sync_word_len = sizeof(lora_fsk_def_sync_word);
+    } else {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[17].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len == 0 || bufinfo.len > LORA_FSK_SYNC_WORD_MAX) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "sync word must be 1 to 8 bytes long"));
+        }
+        memcpy(cmd_data.info.init.sync_word, bufinfo.buf, bufinfo.len);
+        cmd_data.info.init.sync_word_len = bufinfo.len;
+    }
+    cmd_data.info.init.crc = args[18].u_bool;
+    cmd_data.info.init.whitening = args[19].u_bool;
+
     // send message to the lora task
     cmd_data.cmd = E_LORA_CMD_INIT;
     lora_send_cmd(&cmd_data);
@@ -1791,6 +2549,11 @@ STATIC const mp_arg_t lora_init_args[] = {
     { MP_QSTR_tx_retries,   MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int = 2} },
     { MP_QSTR_device_class, MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int = CLASS_A} },
     { MP_QSTR_region,       MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_bitrate,      MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int = 50000} },
+    { MP_QSTR_fdev,         MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int = 25000} },
+    { MP_QSTR_sync_word,    MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = mp_const_none} },
+    { MP_QSTR_crc,          MP_ARG_KW_ONLY  | MP_ARG_BOOL,  {.u_bool = true} },
+    { MP_QSTR_whitening,    MP_ARG_KW_ONLY  | MP_ARG_BOOL,  {.u_bool = true} },
 };
 STATIC mp_obj_t lora_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
     // parse args
@@ -1809,6 +2572,8 @@ STATIC mp_obj_t lora_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_ui
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
     }
 
+    modlora_init0();
+
     // run the constructor if the peripehral is not initialized or extra parameters are given
     if (n_kw > 0 || self->state == E_LORA_STATE_NOINIT) {
         // start the peripheral
@@ -2161,6 +2926,96 @@ STATIC mp_obj_t lora_sf (mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lora_sf_obj, 1, 2, lora_sf);
 
+/// \method send_at(buf, t_us)
+/// Queues a LoRa RAW frame that goes out when the RX timestamp clock reaches t_us.
+/// The radio is armed ahead and the transmission is fired from a timer ISR,
+/// completion is reported with the TX_PACKET_EVENT / TX_FAILED_EVENT events.
+STATIC mp_obj_t lora_send_at (mp_obj_t self_in, mp_obj_t buf_in, mp_obj_t t_us_in) {
+    lora_obj_t *self = self_in;
+
+    // check for the correct lora radio mode
+    if (self->stack_mode != E_LORA_STACK_MODE_LORA) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len == 0 || bufinfo.len > LORA_PAYLOAD_SIZE_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    uint32_t at_us = mp_obj_get_int_truncated(t_us_in);
+    int32_t delta_us = (int32_t)(at_us - (uint32_t)mp_hal_ticks_us_non_blocking());
+    if (delta_us < LORA_TX_AT_GUARD_US || delta_us > LORA_TX_AT_MAX_US) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "timestamp out of range"));
+    }
+
+    lora_cmd_data_t cmd_data;
+    cmd_data.cmd = E_LORA_CMD_TX_AT;
+    memcpy (cmd_data.info.tx.data, bufinfo.buf, bufinfo.len);
+    cmd_data.info.tx.len = bufinfo.len;
+    cmd_data.info.tx.at_us = at_us;
+
+    xEventGroupClearBits(LoRaEvents, LORA_STATUS_COMPLETED | LORA_STATUS_ERROR | LORA_STATUS_MSG_SIZE);
+    MPTRACE(MPTRACE_LORA_SEND, bufinfo.len, 0);
+    if (!xQueueSend(xCmdQueue, (void *)&cmd_data, 0)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+    }
+
+    self->sftx = self->sf;
+    self->tx_time_on_air = Radio.TimeOnAir(LORA_RAW_MODEM(), bufinfo.len);
+    self->tx_counter += 1;
+    self->tx_frequency = self->frequency;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(lora_send_at_obj, lora_send_at);
+
+STATIC mp_obj_t lora_scan_channels (mp_uint_t n_args, const mp_obj_t *args) {
+    lora_obj_t *self = args[0];
+
+    // check for the correct lora radio mode
+    if (self->stack_mode != E_LORA_STACK_MODE_LORA) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    if (n_args == 1) {
+        mp_obj_t channels = mp_obj_new_list(0, NULL);
+        for (uint32_t i = 0; i < lora_scan.count; i++) {
+            mp_obj_t tuple[2];
+            tuple[0] = mp_obj_new_int_from_uint(lora_scan.frequency[i]);
+            tuple[1] = mp_obj_new_int(lora_scan.sf[i]);
+            mp_obj_list_append(channels, mp_obj_new_tuple(2, tuple));
+        }
+        return channels;
+    } else {
+        lora_cmd_data_t cmd_data;
+        memset(&cmd_data.info.scan, 0, sizeof(cmd_data.info.scan));
+        if (args[1] != mp_const_none) {
+            mp_obj_t *items;
+            mp_uint_t n_items;
+            mp_obj_get_array(args[1], &n_items, &items);
+            if (n_items > LORA_SCAN_CHANNELS_MAX) {
+                nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "up to %d channels can be scanned", LORA_SCAN_CHANNELS_MAX));
+            }
+            for (mp_uint_t i = 0; i < n_items; i++) {
+                mp_obj_t *channel;
+                mp_obj_get_array_fixed_n(items[i], 2, &channel);
+                uint32_t frequency = mp_obj_get_int(channel[0]);
+                uint8_t sf = mp_obj_get_int(channel[1]);
+                lora_validate_frequency(frequency);
+                lora_validate_sf(sf);
+                cmd_data.info.scan.frequency[i] = frequency;
+                cmd_data.info.scan.sf[i] = sf;
+            }
+            cmd_data.info.scan.count = n_items;
+        }
+        cmd_data.cmd = E_LORA_CMD_SCAN;
+        lora_send_cmd (&cmd_data);
+        return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lora_scan_channels_obj, 1, 2, lora_scan_channels);
+
 STATIC mp_obj_t lora_power_mode(mp_uint_t n_args, const mp_obj_t *args) {
     lora_obj_t *self = args[0];
     lora_cmd_data_t cmd_data;
@@ -2189,7 +3044,7 @@ STATIC mp_obj_t lora_stats(mp_obj_t self_in) {
     static const qstr lora_stats_info_fields[] = {
         MP_QSTR_rx_timestamp, MP_QSTR_rssi, MP_QSTR_snr, MP_QSTR_sfrx, MP_QSTR_sftx,
         MP_QSTR_tx_trials, MP_QSTR_tx_power, MP_QSTR_tx_time_on_air, MP_QSTR_tx_counter,
-        MP_QSTR_tx_frequency
+        MP_QSTR_tx_frequency, MP_QSTR_rx_dropped
     };
 
     if (self->snr & 0x80)  { // the SNR sign bit is 1
@@ -2201,7 +3056,7 @@ STATIC mp_obj_t lora_stats(mp_obj_t self_in) {
         snr = (self->snr & 0xFF) / 4;
     }
 
-    mp_obj_t stats_tuple[10];
+    mp_obj_t stats_tuple[11];
     stats_tuple[0] = mp_obj_new_int_from_uint(self->rx_timestamp);
     stats_tuple[1] = mp_obj_new_int(self->rssi);
     stats_tuple[2] = mp_obj_new_float(snr);
@@ -2212,17 +3067,310 @@ STATIC mp_obj_t lora_stats(mp_obj_t self_in) {
     stats_tuple[7] = mp_obj_new_int(self->tx_time_on_air);
     stats_tuple[8] = mp_obj_new_int(self->tx_counter);
     stats_tuple[9] = mp_obj_new_int(self->tx_frequency);
+    stats_tuple[10] = mp_obj_new_int_from_uint(lora_rx_ring.dropped);
 
     return mp_obj_new_attrtuple(lora_stats_info_fields, sizeof(stats_tuple) / sizeof(stats_tuple[0]), stats_tuple);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_stats_obj, lora_stats);
 
+STATIC mp_obj_t lora_timer_stats(mp_uint_t n_args, const mp_obj_t *args) {
+    TimerStats_t stats;
+    bool reset = (n_args > 1) ? mp_obj_is_true(args[1]) : false;
+
+    static const qstr lora_timer_stats_fields[] = {
+        MP_QSTR_scheduler, MP_QSTR_operations, MP_QSTR_avg_cycles, MP_QSTR_max_cycles, MP_QSTR_max_lateness
+    };
+
+    TimerGetStats(&stats, reset);
+
+    mp_obj_t stats_tuple[5];
+#if LORA_TIMER_USE_HEAP
+    stats_tuple[0] = MP_OBJ_NEW_QSTR(MP_QSTR_heap);
+#else
+    stats_tuple[0] = MP_OBJ_NEW_QSTR(MP_QSTR_list);
+#endif
+    stats_tuple[1] = mp_obj_new_int_from_uint(stats.Operations);
+    stats_tuple[2] = mp_obj_new_int_from_uint(stats.Operations ? (uint32_t)(stats.TotalCycles / stats.Operations) : 0);
+    stats_tuple[3] = mp_obj_new_int_from_uint(stats.MaxCycles);
+    stats_tuple[4] = mp_obj_new_int_from_uint(stats.MaxLateness);
+
+    return mp_obj_new_attrtuple(lora_timer_stats_fields, sizeof(stats_tuple) / sizeof(stats_tuple[0]), stats_tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lora_timer_stats_obj, 1, 2, lora_timer_stats);
+
+STATIC mp_obj_t lora_radio_stats(mp_uint_t n_args, const mp_obj_t *args) {
+    bool reset = (n_args > 1) ? mp_obj_is_true(args[1]) : false;
+
+    static const qstr lora_radio_stats_fields[] = {
+        MP_QSTR_lorawan, MP_QSTR_sigfox, MP_QSTR_mesh, MP_QSTR_lora, MP_QSTR_switches, MP_QSTR_reg_writes, MP_QSTR_reg_skipped
+    };
+    static const qstr lora_radio_owner_fields[] = {
+        MP_QSTR_grants, MP_QSTR_busy, MP_QSTR_missed, MP_QSTR_airtime, MP_QSTR_wait_max
+    };
+
+    mp_obj_t stats_tuple[7];
+    for (int i = 0; i < E_RADIOSCHED_NUM_OWNERS; i++) {
+        radiosched_stats_t stats;
+        radiosched_get_stats(i, &stats, reset);
+        mp_obj_t owner_tuple[5];
+        owner_tuple[0] = mp_obj_new_int_from_uint(stats.grants);
+        owner_tuple[1] = mp_obj_new_int_from_uint(stats.busy);
+        owner_tuple[2] = mp_obj_new_int_from_uint(stats.missed);
+        owner_tuple[3] = mp_obj_new_int_from_uint(stats.airtime_ms);
+        owner_tuple[4] = mp_obj_new_int_from_uint(stats.wait_max_ms);
+        stats_tuple[i] = mp_obj_new_attrtuple(lora_radio_owner_fields, 5, owner_tuple);
+    }
+    stats_tuple[4] = mp_obj_new_int_from_uint(radiosched_switches());
+    uint32_t writes = 0, skipped = 0;
+#if defined(LOPY4)
+    SX1276ShadowGetStats(&writes, &skipped);
+#endif
+    stats_tuple[5] = mp_obj_new_int_from_uint(writes);
+    stats_tuple[6] = mp_obj_new_int_from_uint(skipped);
+
+    return mp_obj_new_attrtuple(lora_radio_stats_fields, sizeof(stats_tuple) / sizeof(stats_tuple[0]), stats_tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lora_radio_stats_obj, 1, 2, lora_radio_stats);
+
+STATIC mp_obj_t lora_adr_stats(mp_uint_t n_args, const mp_obj_t *args) {
+    lora_obj_t *self = args[0];
+    MibRequestConfirm_t mibReq;
+    bool reset = (n_args > 1) ? mp_obj_is_true(args[1]) : false;
+
+    static const qstr lora_adr_stats_fields[] = {
+        MP_QSTR_dr, MP_QSTR_adr, MP_QSTR_adr_ack_cnt, MP_QSTR_margin, MP_QSTR_gateways, MP_QSTR_link_checks,
+        MP_QSTR_link_check_fails, MP_QSTR_last_margin, MP_QSTR_per_dr, MP_QSTR_fast_dr, MP_QSTR_steps_up, MP_QSTR_steps_down
+    };
+
+    // check for the correct lora radio mode
+    if (self->stack_mode != E_LORA_STACK_MODE_LORAWAN) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm(&mibReq);
+
+    // (dr, sent, ok) of each data rate used so far
+    mp_obj_t per_dr[LORA_ADR_DR_NUM];
+    uint32_t n_dr = 0;
+    for (int dr = 0; dr < LORA_ADR_DR_NUM; dr++) {
+        if (lora_adr.sent[dr] > 0) {
+            mp_obj_t item[3] = {
+                mp_obj_new_int(dr), mp_obj_new_int_from_uint(lora_adr.sent[dr]), mp_obj_new_int_from_uint(lora_adr.ok[dr])
+            };
+            per_dr[n_dr++] = mp_obj_new_tuple(3, item);
+        }
+    }
+
+    mp_obj_t stats_tuple[12];
+    stats_tuple[0] = mp_obj_new_int(mibReq.Param.ChannelsDatarate);
+    stats_tuple[1] = mp_obj_new_bool(self->adr);
+    stats_tuple[2] = mp_obj_new_int_from_uint(*LoRaMacGetAdrAckCounter());
+    stats_tuple[3] = mp_obj_new_int(lora_adr.margin);
+    stats_tuple[4] = mp_obj_new_int(lora_adr.gateways);
+    stats_tuple[5] = mp_obj_new_int_from_uint(lora_adr.link_checks);
+    stats_tuple[6] = mp_obj_new_int_from_uint(lora_adr.link_check_fails);
+    stats_tuple[7] = lora_adr.measured ? mp_obj_new_float(lora_adr.last_margin_q / 4.0f) : mp_const_none;
+    stats_tuple[8] = mp_obj_new_tuple(n_dr, per_dr);
+    stats_tuple[9] = (lora_adr.fast && lora_adr.fast_dr >= 0) ? mp_obj_new_int(lora_adr.fast_dr) : mp_const_none;
+    stats_tuple[10] = mp_obj_new_int_from_uint(lora_adr.steps_up);
+    stats_tuple[11] = mp_obj_new_int_from_uint(lora_adr.steps_down);
+
+    if (reset) {
+        memset(lora_adr.sent, 0, sizeof(lora_adr.sent));
+        memset(lora_adr.ok, 0, sizeof(lora_adr.ok));
+        lora_adr.link_checks = 0;
+        lora_adr.link_check_fails = 0;
+        lora_adr.steps_up = 0;
+        lora_adr.steps_down = 0;
+    }
+
+    return mp_obj_new_attrtuple(lora_adr_stats_fields, sizeof(stats_tuple) / sizeof(stats_tuple[0]), stats_tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lora_adr_stats_obj, 1, 2, lora_adr_stats);
+
+STATIC const mp_arg_t lora_adr_policy_args[] = {
+    { MP_QSTR_fast,                            MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_margin,                          MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_frames,                          MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_dr_max,                          MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = MP_OBJ_NULL} },
+};
+
+// the fast policy only chooses the data rate while the network ADR is off
+STATIC mp_obj_t lora_adr_policy(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(lora_adr_policy_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), lora_adr_policy_args, args);
+
+    if (kw_args->used == 0) {
+        static const qstr lora_adr_policy_fields[] = {
+            MP_QSTR_fast, MP_QSTR_margin, MP_QSTR_frames, MP_QSTR_dr_max
+        };
+        mp_obj_t policy[4];
+        policy[0] = mp_obj_new_bool(lora_adr.fast);
+        policy[1] = mp_obj_new_int(lora_adr.fast_margin);
+        policy[2] = mp_obj_new_int(lora_adr.fast_frames);
+        policy[3] = mp_obj_new_int(lora_adr.fast_dr_max);
+        return mp_obj_new_attrtuple(lora_adr_policy_fields, 4, policy);
+    }
+
+    // validate everything before changing anything
+    mp_int_t margin = (args[1].u_obj != MP_OBJ_NULL) ? mp_obj_get_int(args[1].u_obj) : lora_adr.fast_margin;
+    mp_int_t frames = (args[2].u_obj != MP_OBJ_NULL) ? mp_obj_get_int(args[2].u_obj) : lora_adr.fast_frames;
+    mp_int_t dr_max = (args[3].u_obj != MP_OBJ_NULL) ? mp_obj_get_int(args[3].u_obj) : lora_adr.fast_dr_max;
+    if (margin < 0 || margin > 30 || frames < 1 || frames > 255 || dr_max < 0 || dr_max >= LORA_ADR_DR_NUM) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    lora_adr.fast_margin = margin;
+    lora_adr.fast_frames = frames;
+    lora_adr.fast_dr_max = dr_max;
+    if (args[0].u_obj != MP_OBJ_NULL) {
+        lora_adr.fast = mp_obj_is_true(args[0].u_obj);
+        // start again from what the socket asks for
+        lora_adr.fast_dr = -1;
+        lora_adr.fast_run = 0;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(lora_adr_policy_obj, 1, lora_adr_policy);
+
+STATIC mp_obj_t lora_timing_trace(mp_uint_t n_args, const mp_obj_t *args) {
+    static const qstr lora_trace_events[] = {
+        MP_QSTR_tx_done, MP_QSTR_rx1_open, MP_QSTR_rx2_open, MP_QSTR_rx_done
+    };
+    static const qstr lora_trace_fields[] = {
+        MP_QSTR_event, MP_QSTR_scheduled, MP_QSTR_actual, MP_QSTR_delta
+    };
+
+    // check for the correct lora radio mode
+    if (lora_obj.stack_mode != E_LORA_STACK_MODE_LORAWAN) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+
+    LoRaMacTraceSample_t *samples = m_new(LoRaMacTraceSample_t, LORAMAC_TRACE_SIZE);
+    uint32_t count = LoRaMacTraceRead(samples, LORAMAC_TRACE_SIZE);
+    if (n_args > 1 && mp_obj_is_true(args[1])) {
+        LoRaMacTraceClear();
+    }
+
+    mp_obj_t trace = mp_obj_new_list(0, NULL);
+    for (uint32_t i = 0; i < count; i++) {
+        mp_obj_t sample[4];
+        sample[0] = MP_OBJ_NEW_QSTR(lora_trace_events[samples[i].Event]);
+        sample[1] = mp_obj_new_int_from_uint(samples[i].Scheduled);
+        sample[2] = mp_obj_new_int_from_uint(samples[i].Actual);
+        sample[3] = mp_obj_new_int((int32_t)(samples[i].Actual - samples[i].Scheduled));
+        mp_obj_list_append(trace, mp_obj_new_attrtuple(lora_trace_fields, MP_ARRAY_SIZE(sample), sample));
+    }
+    m_del(LoRaMacTraceSample_t, samples, LORAMAC_TRACE_SIZE);
+    return trace;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lora_timing_trace_obj, 1, 2, lora_timing_trace);
+
 STATIC mp_obj_t lora_has_joined(mp_obj_t self_in) {
     lora_obj_t *self = self_in;
     return self->joined ? mp_const_true : mp_const_false;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_has_joined_obj, lora_has_joined);
 
+STATIC mp_obj_t lora_send_batch(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_payloads,       MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_port,           MP_ARG_KW_ONLY  | MP_ARG_INT,                         {.u_int = DEF_LORAWAN_APP_PORT} },
+        { MP_QSTR_confirmed,      MP_ARG_KW_ONLY  | MP_ARG_BOOL,                        {.u_bool = false} },
+        { MP_QSTR_dr,             MP_ARG_KW_ONLY  | MP_ARG_OBJ,                         {.u_obj = mp_const_none} },
+        { MP_QSTR_wait,           MP_ARG_KW_ONLY  | MP_ARG_BOOL,                        {.u_bool = false} },
+    };
+
+    // check for the correct lora radio mode
+    if (lora_obj.stack_mode != E_LORA_STACK_MODE_LORAWAN) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    if (!lora_obj.joined) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(MP_ENETDOWN)));
+    }
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    uint32_t port = args[1].u_int;
+    if (port == 0 || port >= 224) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "invalid port %d", port));
+    }
+
+    uint32_t dr;
+    if (args[3].u_obj == mp_const_none) {
+        MibRequestConfirm_t mibReq;
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        LoRaMacMibGetRequestConfirm(&mibReq);
+        dr = mibReq.Param.ChannelsDatarate;
+    } else {
+        dr = mp_obj_get_int(args[3].u_obj);
+        if (!lora_validate_data_rate(dr)) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "invalid data rate %d", dr));
+        }
+    }
+
+    // validate all payloads first, so that nothing can raise while the batch buffer is owned
+    mp_obj_t *payloads;
+    mp_uint_t n_payloads;
+    mp_obj_get_array(args[0].u_obj, &n_payloads, &payloads);
+    uint32_t total_len = 0;
+    for (mp_uint_t i = 0; i < n_payloads; i++) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(payloads[i], &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len >= LORA_PAYLOAD_SIZE_MAX) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(MP_EMSGSIZE)));
+        }
+        total_len += bufinfo.len + 1;
+    }
+    if (total_len > LORA_TX_BATCH_SIZE_MAX) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(MP_EMSGSIZE)));
+    }
+    if (n_payloads == 0) {
+        return mp_obj_new_int(0);
+    }
+
+    // wait until the previous batch has been sent
+    MP_THREAD_GIL_EXIT();
+    xSemaphoreTake(xTxBatchSem, portMAX_DELAY);
+    MP_THREAD_GIL_ENTER();
+
+    uint32_t len = 0;
+    for (mp_uint_t i = 0; i < n_payloads; i++) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer(payloads[i], &bufinfo, MP_BUFFER_READ);
+        lora_tx_batch.data[len++] = bufinfo.len;
+        memcpy(&lora_tx_batch.data[len], bufinfo.buf, bufinfo.len);
+        len += bufinfo.len;
+    }
+    lora_tx_batch.port = port;
+    lora_tx_batch.dr = dr;
+    lora_tx_batch.confirmed = args[2].u_bool;
+    lora_tx_batch.offset = 0;
+    lora_tx_batch.sent = 0;
+    lora_tx_batch.errors = 0;
+    // setting the length hands the batch over to the LoRa task
+    lora_tx_batch.len = len;
+
+    if (args[4].u_bool) {
+        MP_THREAD_GIL_EXIT();
+        xSemaphoreTake(xTxBatchSem, portMAX_DELAY);
+        uint32_t errors = lora_tx_batch.errors;
+        uint32_t sent = lora_tx_batch.sent;
+        xSemaphoreGive(xTxBatchSem);
+        MP_THREAD_GIL_ENTER();
+        if (errors > 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        // return the number of frames used
+        return mp_obj_new_int_from_uint(sent);
+    }
+    // return the number of payloads queued
+    return mp_obj_new_int_from_uint(n_payloads);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(lora_send_batch_obj, 2, lora_send_batch);
+
 STATIC mp_obj_t lora_add_channel (mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_index,        MP_ARG_REQUIRED | MP_ARG_INT },
@@ -2330,7 +3478,7 @@ STATIC mp_obj_t lora_ischannel_free(mp_obj_t self_in, mp_obj_t rssi, mp_obj_t ti
     lora_obj_t *self = self_in;
 
     // probably we could listen for 2 symbols (bits) for the current Lora settings (freq, bw, sf)
-    if (Radio.IsChannelFree(MODEM_LORA, self->frequency, mp_obj_get_int(rssi), mp_obj_get_int(time_ms))) {
+    if (Radio.IsChannelFree(LORA_RAW_MODEM(), self->frequency, mp_obj_get_int(rssi), mp_obj_get_int(time_ms))) {
         return mp_const_true;
     }
     return mp_const_false;
@@ -2345,17 +3493,29 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(lora_set_battery_level_obj, lora_set_battery_le
 
 STATIC mp_obj_t lora_nvram_save (mp_obj_t self_in) {
     LoRaMacRegion_t region = 0xFF;
+    uint32_t generation = 0;
+
+    // only the frame counters changed, keep them in RTC memory
+    if (lora_nvs_journal_append()) {
+        return mp_const_none;
+    }
+
     modlora_nvs_get_uint(E_LORA_NVS_ELE_REGION, &region);
     // if the region doesn't match, erase the previous stored data
     if (region != lora_obj.region) {
         lora_nvram_erase(NULL);
     }
+    modlora_nvs_get_uint(E_LORA_NVS_ELE_JOURNAL_GEN, &generation);
+    generation++;
     LoRaMacNvsSave();
     modlora_nvs_set_uint(E_LORA_NVS_ELE_REGION, (uint32_t)lora_obj.region);
     modlora_nvs_set_uint(E_LORA_NVS_ELE_JOINED, (uint32_t)lora_obj.joined);
+    modlora_nvs_set_uint(E_LORA_NVS_ELE_JOURNAL_GEN, generation);
     if (ESP_OK != nvs_commit(modlora_nvs_handle)) {
+        lora_nvs_journal_invalidate();
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
+    lora_nvs_journal_compact(generation);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_nvram_save_obj, lora_nvram_save);
@@ -2365,6 +3525,19 @@ STATIC mp_obj_t lora_nvram_restore (mp_obj_t self_in) {
     LoRaMacRegion_t region;
     lora_cmd_data_t cmd_data;
 
+    // right after a deep sleep wake-up the session can be taken from RTC memory
+    if (lora_rtc_warm) {
+        lora_rtc_warm = false;
+        if (lora_obj.stack_mode == E_LORA_STACK_MODE_LORAWAN && lora_rtc_snapshot.region == lora_obj.region &&
+            lora_rtc_snapshot_valid()) {
+            // counters used from now on are only known to the journal after the next save
+            lora_nvs_journal_set_pending();
+            cmd_data.cmd = E_LORA_CMD_WARM_RESTORE;
+            lora_send_cmd (&cmd_data);
+            return mp_const_none;
+        }
+    }
+
     if (modlora_nvs_get_uint(E_LORA_NVS_ELE_JOINED, &joined)) {
         lora_obj.joined = joined;
         if (joined) {
@@ -2390,6 +3563,9 @@ STATIC mp_obj_t lora_nvram_restore (mp_obj_t self_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_nvram_restore_obj, lora_nvram_restore);
 
 STATIC mp_obj_t lora_nvram_erase (mp_obj_t self_in) {
+    lora_nvs_journal_invalidate();
+    lora_rtc_snapshot.magic = 0;
+    lora_rtc_warm = false;
     if (ESP_OK != nvs_erase_all(modlora_nvs_handle)) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
@@ -2399,11 +3575,33 @@ STATIC mp_obj_t lora_nvram_erase (mp_obj_t self_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_nvram_erase_obj, lora_nvram_erase);
 
 // return time-on-air (milisec) for the current Lora settings, specifying pack_len
-STATIC mp_obj_t lora_airtime (mp_obj_t self_in, mp_obj_t pack_len_obj) {
-    int len = mp_obj_get_int(pack_len_obj);
-    return mp_obj_new_int(Radio.TimeOnAir(MODEM_LORA, len));
+// without pack_len, return the time-on-air used per band during the last hour
+STATIC mp_obj_t lora_airtime (mp_uint_t n_args, const mp_obj_t *args) {
+    if (n_args > 1) {
+        int len = mp_obj_get_int(args[1]);
+        return mp_obj_new_int(Radio.TimeOnAir(LORA_RAW_MODEM(), len));
+    }
+
+    TimerTime_t airtime[LORAMAC_AIRTIME_BANDS_MAX];
+    mp_obj_t bands[LORAMAC_AIRTIME_BANDS_MAX];
+    // in raw LoRa mode everything is accounted to a single band
+    uint8_t max = (lora_obj.stack_mode == E_LORA_STACK_MODE_LORAWAN) ? LORAMAC_AIRTIME_BANDS_MAX : 1;
+    uint8_t count = LoRaMacGetAirtime(airtime, max);
+    for (uint8_t i = 0; i < count; i++) {
+        bands[i] = mp_obj_new_int_from_uint(airtime[i]);
+    }
+    return mp_obj_new_list(count, bands);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(lora_airtime_obj, 1, 2, lora_airtime);
+
+// return the time (milisec) until the duty-cycle rules of the region allow the next uplink
+STATIC mp_obj_t lora_next_tx_allowed (mp_obj_t self_in) {
+    if (lora_obj.stack_mode != E_LORA_STACK_MODE_LORAWAN) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    return mp_obj_new_int_from_uint(LoRaMacGetNextTxDelay());
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(lora_airtime_obj, lora_airtime);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(lora_next_tx_allowed_obj, lora_next_tx_allowed);
 
 STATIC mp_obj_t lora_reset (mp_obj_t self_in) {
 
@@ -2449,9 +3647,17 @@ STATIC const mp_map_elem_t lora_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_coding_rate),           (mp_obj_t)&lora_coding_rate_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_preamble),              (mp_obj_t)&lora_preamble_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sf),                    (mp_obj_t)&lora_sf_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_scan),                  (mp_obj_t)&lora_scan_channels_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_power_mode),            (mp_obj_t)&lora_power_mode_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_stats),                 (mp_obj_t)&lora_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_timer_stats),           (mp_obj_t)&lora_timer_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_radio_stats),           (mp_obj_t)&lora_radio_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_adr_stats),             (mp_obj_t)&lora_adr_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_adr_policy),            (mp_obj_t)&lora_adr_policy_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_timing_trace),          (mp_obj_t)&lora_timing_trace_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_has_joined),            (mp_obj_t)&lora_has_joined_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_send_batch),            (mp_obj_t)&lora_send_batch_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_send_at),               (mp_obj_t)&lora_send_at_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_add_channel),           (mp_obj_t)&lora_add_channel_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_remove_channel),        (mp_obj_t)&lora_remove_channel_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_mac),                   (mp_obj_t)&lora_mac_obj },
@@ -2464,6 +3670,7 @@ STATIC const mp_map_elem_t lora_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_nvram_restore),         (mp_obj_t)&lora_nvram_restore_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_nvram_erase),           (mp_obj_t)&lora_nvram_erase_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_airtime),               (mp_obj_t)&lora_airtime_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_next_tx_allowed),       (mp_obj_t)&lora_next_tx_allowed_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_reset),                 (mp_obj_t)&lora_reset_obj },
 
 #ifdef LORA_OPENTHREAD_ENABLED
@@ -2476,6 +3683,7 @@ STATIC const mp_map_elem_t lora_locals_dict_table[] = {
     // class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_LORA),                MP_OBJ_NEW_SMALL_INT(E_LORA_STACK_MODE_LORA) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_LORAWAN),             MP_OBJ_NEW_SMALL_INT(E_LORA_STACK_MODE_LORAWAN) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_FSK),                 MP_OBJ_NEW_SMALL_INT(E_LORA_STACK_MODE_FSK) },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_OTAA),                MP_OBJ_NEW_SMALL_INT(E_LORA_ACTIVATION_OTAA) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ABP),                 MP_OBJ_NEW_SMALL_INT(E_LORA_ACTIVATION_ABP) },
@@ -2591,11 +3799,11 @@ static int lora_socket_send (mod_network_socket_obj_t *s, const byte *buf, mp_ui
     // is the radio able to transmit
     if (lora_obj.pwr_mode == E_LORA_MODE_SLEEP) {
         *_errno = MP_ENETDOWN;
-    } else if (len > LORA_PAYLOAD_SIZE_MAX) {
+    } else if (len > LORA_PAYLOAD_SIZE_MAX || (lora_obj.stack_mode == E_LORA_STACK_MODE_FSK && len > RADIO_FSK_PAYLOAD_MAX)) {
         *_errno = MP_EMSGSIZE;
     } else if (len > 0) {
-        if (lora_obj.stack_mode == E_LORA_STACK_MODE_LORA) {
-            n_bytes = lora_send (buf, len, s->sock_base.timeout);
+        if (lora_obj.stack_mode != E_LORA_STACK_MODE_LORAWAN) {
+            n_bytes = lora_send (buf, len, s->sock_base.timeout, E_RADIOSCHED_LORA);
         } else {
             if (lora_obj.joined) {
                 n_bytes = lorawan_send (buf, len, s->sock_base.timeout,
@@ -17,8 +17,11 @@
  DEFINE CONSTANTS
  ******************************************************************************/
 #define LORA_PAYLOAD_SIZE_MAX                                   (255)
+#define LORA_FSK_SYNC_WORD_MAX                                  (8)
 #define LORA_CMD_QUEUE_SIZE_MAX                                 (7)
-#define LORA_DATA_QUEUE_SIZE_MAX                                (7)
+#define LORA_TX_BATCH_SIZE_MAX                                  (1024)
+#define LORA_SCAN_CHANNELS_MAX                                  (8)
+#define LORA_RX_RING_SIZE                                       (2048)     // must be a power of 2
 #define LORA_CB_QUEUE_SIZE_MAX                                  (7)
 #define LORA_STACK_SIZE                                         (4096)
 #define LORA_TIMER_STACK_SIZE                                   (3072)
@@ -41,6 +44,10 @@ typedef enum {
     E_LORA_CMD_LORAWAN_TX,
     E_LORA_CMD_SLEEP,
     E_LORA_CMD_WAKE_UP,
+    E_LORA_CMD_LORAWAN_TX_BATCH,
+    E_LORA_CMD_SCAN,
+    E_LORA_CMD_WARM_RESTORE,
+    E_LORA_CMD_TX_AT,
 } lora_cmd_t;
 
 typedef enum {
@@ -63,6 +70,7 @@ typedef enum {
     E_LORA_NVS_ELE_REGION,
     E_LORA_NVS_ELE_CHANNELMASK,
     E_LORA_NVS_ELE_CHANNELMASK_REMAINING,
+    E_LORA_NVS_ELE_JOURNAL_GEN,
     E_LORA_NVS_NUM_KEYS
 } e_lora_nvs_key_t;
 
@@ -82,6 +90,12 @@ typedef struct {
     bool            rxiq;
     bool            adr;
     bool            public;
+    uint32_t        bitrate;
+    uint32_t        fdev;
+    uint8_t         sync_word[LORA_FSK_SYNC_WORD_MAX];
+    uint8_t         sync_word_len;
+    bool            crc;
+    bool            whitening;
 } lora_init_cmd_data_t;
 
 typedef struct {
@@ -110,6 +124,9 @@ typedef struct {
     uint8_t     port;
     uint8_t     dr;
     bool        confirmed;
+    uint32_t    at_us;      // E_LORA_CMD_TX_AT only, on the rx_timestamp clock
+    uint8_t     owner;      // E_LORA_CMD_TX only, a radiosched_owner_t
+    uint32_t    deadline_ms;
 } lora_tx_cmd_data_t;
 
 typedef struct {
@@ -120,11 +137,18 @@ typedef struct {
     bool        add;
 } lora_config_channel_cmd_data_t;
 
+typedef struct {
+    uint32_t    frequency[LORA_SCAN_CHANNELS_MAX];
+    uint8_t     sf[LORA_SCAN_CHANNELS_MAX];
+    uint8_t     count;
+} lora_scan_cmd_data_t;
+
 typedef union {
     lora_init_cmd_data_t                init;
     lora_join_cmd_data_t                join;
     lora_tx_cmd_data_t                  tx;
     lora_config_channel_cmd_data_t      channel;
+    lora_scan_cmd_data_t                scan;
 } lora_cmd_info_u_t;
 
 typedef struct {
@@ -132,15 +156,45 @@ typedef struct {
     lora_cmd_info_u_t           info;
 } lora_cmd_data_t;
 
+// application payloads waiting to be packed into LoRaWAN frames by the LoRa task
+// every record is stored as [len][payload]
+typedef struct {
+    uint8_t     data[LORA_TX_BATCH_SIZE_MAX];
+    uint32_t    len;        // bytes stored
+    uint32_t    offset;     // bytes already handed over to the MAC
+    uint32_t    sent;       // frames transmitted for this batch
+    uint32_t    errors;     // frames (or records) that couldn't be transmitted
+    uint8_t     port;
+    uint8_t     dr;
+    bool        confirmed;
+} lora_tx_batch_t;
+
 ///////////////////////////////////////////
 
+// header stored in front of every frame in the RX ring buffer
 typedef struct {
-    uint8_t data[LORA_PAYLOAD_SIZE_MAX + 1];
     uint8_t len;
     uint8_t port;
-} lora_rx_data_t;
+} lora_rx_frame_hdr_t;
+
+typedef struct {
+    uint8_t             data[LORA_RX_RING_SIZE];
+    volatile uint32_t   head;       // free running write index, only moved by the producer
+    volatile uint32_t   tail;       // free running index of the oldest frame header
+    uint32_t            offset;     // payload bytes of the oldest frame already consumed
+    uint32_t            dropped;    // frames discarded because the ring was full
+} lora_rx_ring_t;
 
 typedef void ( *modlora_timerCallback )( void );
+
+// C level downlink handler, returns true if the frame has been consumed and
+// must not be delivered to the LoRa socket nor to the Python callback
+typedef bool ( *modlora_downlink_handler_t )( const uint8_t *payload, uint8_t len, uint8_t port, void *arg );
+
+typedef struct {
+    modlora_downlink_handler_t  handler;
+    void                        *arg;
+} lora_downlink_c_handler_t;
 /******************************************************************************
  EXPORTED DATA
  ******************************************************************************/
@@ -153,11 +207,15 @@ extern bool modlora_nvs_set_uint(uint32_t key_idx, uint32_t value);
 extern bool modlora_nvs_set_blob(uint32_t key_idx, const void *value, uint32_t length);
 extern bool modlora_nvs_get_uint(uint32_t key_idx, uint32_t *value);
 extern bool modlora_nvs_get_blob(uint32_t key_idx, void *value, uint32_t *length);
+extern void modlora_deepsleep_save(void);
 extern void modlora_sleep_module(void);
 extern bool modlora_is_module_sleep(void);
+extern bool modlora_is_radio_off(void);
 IRAM_ATTR extern void modlora_set_timer_callback(modlora_timerCallback cb);
+extern void modlora_register_downlink_c_handler(modlora_downlink_handler_t handler, void *arg);
 
-extern int lora_ot_recv(uint8_t *buf, int8_t *rssi);
+extern int lora_ot_recv(uint8_t *buf, uint16_t len, int8_t *rssi);
 extern void lora_ot_send(const uint8_t *buf, uint16_t len);
+extern uint32_t lora_ot_airtime(uint16_t len);
 
 #endif  // MODLORA_H_
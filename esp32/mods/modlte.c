@@ -71,6 +71,23 @@
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
+// unit of a 3GPP GPRS timer encoded in the upper 3 bits
+typedef struct {
+    uint8_t     unit;
+    uint32_t    seconds;
+} lte_timer_unit_t;
+
+// duration of the last run of every phase in ms, -1 if not measured yet
+typedef struct {
+    uint32_t    attach_start;
+    uint32_t    connect_start;
+    int32_t     attach;
+    int32_t     connect;
+    int32_t     suspend;
+    int32_t     resume;
+    bool        attaching;
+    bool        connecting;
+} lte_timings_t;
 
 /******************************************************************************
  DEFINE CONSTANTS
@@ -83,6 +100,9 @@
 
 #define SQNS_SW_FULL_BAND_SUPPORT   41000
 #define SQNS_SW_5_8_BAND_SUPPORT    39000
+
+#define LTE_EDRX_ACT_LTE_M          4
+#define LTE_EDRX_ACT_NB_IOT         5
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
@@ -98,6 +118,16 @@ static bool lte_legacyattach_flag = true;
 
 static bool lte_ue_is_out_of_coverage = false;
 
+static lte_timings_t lte_timings = {.attach = -1, .connect = -1, .suspend = -1, .resume = -1};
+
+// T3412 extended (GPRS Timer 3) and T3324 (GPRS Timer 2), finest unit first
+static const lte_timer_unit_t lte_t3412_units[] = { {3, 2}, {4, 30}, {5, 60}, {0, 600}, {1, 3600}, {2, 36000}, {6, 1152000} };
+static const lte_timer_unit_t lte_t3324_units[] = { {0, 2}, {1, 60}, {2, 360} };
+
+// eDRX cycle lengths in units of 10 ms, indexed by their 4 bit value
+static const uint32_t lte_edrx_cycles[] = { 512, 1024, 2048, 4096, 6144, 8192, 10240, 12288, 14336, 16384,
+                                           32768, 65536, 131072, 262144, 524288, 1048576 };
+
 extern TaskHandle_t xLTEUpgradeTaskHndl;
 extern TaskHandle_t mpTaskHandle;
 extern TaskHandle_t svTaskHandle;
@@ -118,6 +148,8 @@ extern TaskHandle_t xLTETaskHndl;
  ******************************************************************************/
 static bool lte_push_at_command_ext (char *cmd_str, uint32_t timeout, const char *expected_rsp, size_t len);
 static bool lte_push_at_command (char *cmd_str, uint32_t timeout);
+static bool lte_push_at_pipeline (const lte_at_pipeline_cmd_t *pipeline, size_t len);
+static void lte_cereg_urc_handler (const char *line, void *arg);
 static void lte_pause_ppp(void);
 static bool lte_check_attached(bool legacy);
 static void lte_check_init(void);
@@ -134,8 +166,15 @@ static void lte_callback_handler(void* arg);
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
 
+// only once, either on boot or when the LTE class is first used
 void modlte_init0(void) {
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
     lteppp_init();
+    lteppp_register_urc("+CEREG", lte_cereg_urc_handler, NULL);
 }
 void modlte_start_modem(void)
 {
@@ -144,18 +183,16 @@ void modlte_start_modem(void)
     portYIELD();
 }
 
+// called from the LTE task, the UART event task and the tcpip thread
 void modlte_urc_events(lte_events_t events)
 {
-    switch(events)
-    {
-    case LTE_EVENT_COVERAGE_LOST:
-        if ((lte_obj.trigger & LTE_TRIGGER_SIG_LOST)) {
-            lte_obj.events |= (uint32_t)LTE_TRIGGER_SIG_LOST;
-        }
-        mp_irq_queue_interrupt(lte_callback_handler, &lte_obj);
-        break;
-    default:
-        break;
+    static const uint32_t triggers[LTE_EVENT_MAX] = {
+        LTE_TRIGGER_SIG_LOST, LTE_TRIGGER_ATTACHED, LTE_TRIGGER_CONNECTED, LTE_TRIGGER_DISCONNECTED
+    };
+
+    if (events < LTE_EVENT_MAX && (lte_obj.trigger & triggers[events])) {
+        lte_obj.events |= triggers[events];
+        mp_irq_queue_interrupt_non_ISR(lte_callback_handler, &lte_obj);
     }
 }
 //*****************************************************************************
@@ -189,7 +226,33 @@ static bool lte_push_at_command (char *cmd_str, uint32_t timeout) {
     return lte_push_at_command_ext(cmd_str, timeout, LTE_OK_RSP, strlen(cmd_str));
 }
 
+// sends the commands back to back from the LTE task, stops at the first one that fails
+// the response of the last command sent is left in modlte_rsp
+static bool lte_push_at_pipeline (const lte_at_pipeline_cmd_t *pipeline, size_t len) {
+    lte_task_cmd_data_t cmd = { .pipeline = pipeline, .pipeline_len = len };
+    lteppp_send_at_command(&cmd, &modlte_rsp);
+    return modlte_rsp.completed == len;
+}
+
+// unsolicited "+CEREG: <stat>[,...]" lines, stat 4 means no coverage
+static void lte_cereg_urc_handler (const char *line, void *arg) {
+    const char *pos = line + strlen("+CEREG:");
+    while (*pos == ' ') {
+        pos++;
+    }
+    if (*pos == '4') {
+        lte_ue_is_out_of_coverage = true;
+        modlte_urc_events(LTE_EVENT_COVERAGE_LOST);
+    } else if (*pos == '1' || *pos == '5') {
+        lte_ue_is_out_of_coverage = false;
+    }
+}
+
 static void lte_pause_ppp(void) {
+    // the multiplexer keeps a channel for the commands next to the PPP one, nothing to pause
+    if (lteppp_cmux_active()) {
+        return;
+    }
     mp_hal_delay_ms(LTE_PPP_BACK_OFF_TIME_MS);
     if (!lte_push_at_command("+++", LTE_PPP_BACK_OFF_TIME_MS)) {
         mp_hal_delay_ms(LTE_PPP_BACK_OFF_TIME_MS);
@@ -227,8 +290,11 @@ static bool lte_check_attached(bool legacy) {
                 }
             }
         }
-        lte_push_at_command("AT", LTE_RX_TIMEOUT_MIN_MS);
-        lte_push_at_command("AT+CGATT?", LTE_RX_TIMEOUT_MIN_MS);
+        static const lte_at_pipeline_cmd_t cgatt_query[] = {
+            { .cmd = "AT", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+            { .cmd = "AT+CGATT?", .expected_rsp = LTE_OK_RSP, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+        };
+        lte_push_at_pipeline(cgatt_query, MP_ARRAY_SIZE(cgatt_query));
         if (((pos = strstr(modlte_rsp.data, "+CGATT")) && (strlen(pos) >= 7) && (pos[7] == '1' || pos[8] == '1'))) {
             cgatt = true;
         }
@@ -277,6 +343,14 @@ static bool lte_check_attached(bool legacy) {
             }
         }
     }
+    if (attached && lteppp_take_attach_watch()) {
+        // the LTE task hasn't seen it yet
+        modlte_urc_events(LTE_EVENT_ATTACHED);
+    }
+    if (attached && lte_timings.attaching) {
+        lte_timings.attach = mp_hal_ticks_ms() - lte_timings.attach_start;
+        lte_timings.attaching = false;
+    }
     if (attached && lteppp_get_state() < E_LTE_PPP) {
         lteppp_set_state(E_LTE_ATTACHED);
     }
@@ -334,7 +408,7 @@ static void lte_set_default_inf(void)
 }
 
 static void lte_check_inppp(void) {
-    if (lteppp_get_state() == E_LTE_PPP) {
+    if (lteppp_get_state() == E_LTE_PPP && !lteppp_cmux_active()) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "LTE modem is in data state, cannot send AT commands"));
     }
 }
@@ -483,9 +557,16 @@ static mp_obj_t lte_init_helper(lte_obj_t *self, const mp_arg_val_t *args) {
         lte_push_at_command("AT", LTE_RX_TIMEOUT_MAX_MS);
     }
 
+    // AT commands and PPP on separate channels, lost when the modem resets and restored by the LTE task
+    if (args[3].u_bool && !lte_push_at_command("Pycom_CMUX", LTE_RX_TIMEOUT_MAX_MS)) {
+        xSemaphoreGive(xLTE_modem_Conn_Sem);
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "the modem doesn't support multiplexing"));
+    }
+
     lteppp_set_state(E_LTE_IDLE);
     mod_network_register_nic(&lte_obj);
     lte_obj.init = true;
+    lteppp_pause_background(false);
     xSemaphoreGive(xLTE_modem_Conn_Sem);
     return mp_const_none;
 }
@@ -494,7 +575,8 @@ static const mp_arg_t lte_init_args[] = {
     { MP_QSTR_id,                                   MP_ARG_INT, {.u_int = 0} },
     { MP_QSTR_carrier,                              MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
     { MP_QSTR_cid,                                  MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 1} },
-    { MP_QSTR_legacyattach,                         MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} }
+    { MP_QSTR_legacyattach,                         MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} },
+    { MP_QSTR_cmux,                                 MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false} }
 };
 
 static mp_obj_t lte_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
@@ -509,6 +591,8 @@ static mp_obj_t lte_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uin
     lte_obj_t *self = &lte_obj;
     self->base.type = (mp_obj_t)&mod_network_nic_type_lte;
 
+    modlte_init0();
+
     if (n_kw > 0) {
         // check the peripheral id
         if (args[0].u_int != 0) {
@@ -542,6 +626,7 @@ STATIC mp_obj_t lte_deinit(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
 
     if (lte_obj.init) {
         lte_obj_t *self = (lte_obj_t*)pos_args[0];
+        lteppp_pause_background(true);
         if (lteppp_get_state() == E_LTE_PPP && (lteppp_get_legacy() == E_LTE_LEGACY || args[0].u_bool)) {
             lte_disconnect(self);
         } else {
@@ -755,16 +840,22 @@ STATIC mp_obj_t lte_attach(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
 
             if (args[0].u_obj == mp_const_none  && args[6].u_obj == mp_const_none) {
                 // neither the argument 'band', nor 'bands' was supplied
-                lte_push_at_command("AT!=\"RRC::addScanBand band=3\"", LTE_RX_TIMEOUT_MIN_MS);
-                lte_push_at_command("AT!=\"RRC::addScanBand band=4\"", LTE_RX_TIMEOUT_MIN_MS);
-                if (is_hw_new_band_support && version > SQNS_SW_5_8_BAND_SUPPORT) {
-                    lte_push_at_command("AT!=\"RRC::addScanBand band=5\"", LTE_RX_TIMEOUT_MIN_MS);
-                    lte_push_at_command("AT!=\"RRC::addScanBand band=8\"", LTE_RX_TIMEOUT_MIN_MS);
+                // bands 5 and 8 go last so older firmware can skip them
+                static const lte_at_pipeline_cmd_t default_bands[] = {
+                    { .cmd = "AT!=\"RRC::addScanBand band=3\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                    { .cmd = "AT!=\"RRC::addScanBand band=4\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                    { .cmd = "AT!=\"RRC::addScanBand band=12\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                    { .cmd = "AT!=\"RRC::addScanBand band=13\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                    { .cmd = "AT!=\"RRC::addScanBand band=20\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                    { .cmd = "AT!=\"RRC::addScanBand band=28\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                    { .cmd = "AT!=\"RRC::addScanBand band=5\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                    { .cmd = "AT!=\"RRC::addScanBand band=8\"", .expected_rsp = NULL, .timeout = LTE_RX_TIMEOUT_MIN_MS },
+                };
+                size_t n_bands = MP_ARRAY_SIZE(default_bands);
+                if (!is_hw_new_band_support || version <= SQNS_SW_5_8_BAND_SUPPORT) {
+                    n_bands -= 2;
                 }
-                lte_push_at_command("AT!=\"RRC::addScanBand band=12\"", LTE_RX_TIMEOUT_MIN_MS);
-                lte_push_at_command("AT!=\"RRC::addScanBand band=13\"", LTE_RX_TIMEOUT_MIN_MS);
-                lte_push_at_command("AT!=\"RRC::addScanBand band=20\"", LTE_RX_TIMEOUT_MIN_MS);
-                lte_push_at_command("AT!=\"RRC::addScanBand band=28\"", LTE_RX_TIMEOUT_MIN_MS);
+                lte_push_at_pipeline(default_bands, n_bands);
             }
             else
             {
@@ -825,6 +916,11 @@ STATIC mp_obj_t lte_attach(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
             lte_push_at_command("AT!=\"disablelog 0\"", LTE_RX_TIMEOUT_MAX_MS);
         }
         lteppp_set_state(E_LTE_ATTACHING);
+        lte_timings.attach_start = mp_hal_ticks_ms();
+        lte_timings.attaching = true;
+        // the LTE task reports the attachment through the callback, no need to poll isattached()
+        lteppp_pause_background(false);
+        lteppp_set_attach_watch(true);
         if (!lte_push_at_command("AT+CFUN=1", LTE_RX_TIMEOUT_MAX_MS)) {
             nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
         }
@@ -839,6 +935,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(lte_attach_obj, 1, lte_attach);
 
 mp_obj_t lte_detach(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     lte_check_init();
+    lteppp_pause_background(true);
 
     STATIC const mp_arg_t allowed_args[] = {
         { MP_QSTR_reset,              MP_ARG_KW_ONLY  | MP_ARG_BOOL,  {.u_bool = false}},
@@ -908,6 +1005,7 @@ STATIC mp_obj_t lte_suspend(mp_obj_t self_in) {
     }
     lte_check_init();
     if (lteppp_get_state() == E_LTE_PPP) {
+        uint32_t start = mp_hal_ticks_ms();
         lteppp_suspend();
         //printf("Pausing ppp...\n");
         lte_pause_ppp();
@@ -922,6 +1020,7 @@ STATIC mp_obj_t lte_suspend(mp_obj_t self_in) {
             }
         }
         lte_check_attached(lte_legacyattach_flag);
+        lte_timings.suspend = mp_hal_ticks_ms() - start;
     }
     return mp_const_none;
 }
@@ -983,6 +1082,8 @@ STATIC mp_obj_t lte_connect(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
             }
         }
         mod_network_register_nic(&lte_obj);
+        lte_timings.connect_start = mp_hal_ticks_ms();
+        lte_timings.connecting = true;
         lteppp_connect();
         lteppp_set_state(E_LTE_PPP);
         vTaskDelay(1000);
@@ -1010,6 +1111,18 @@ STATIC mp_obj_t lte_resume(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
     if (lteppp_get_state() == E_LTE_PPP) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
     }
+    uint32_t start = mp_hal_ticks_ms();
+
+    // the PPP session is still up on both sides, go back to data mode without checking
+    // the attachment or renegotiating PPP
+    if (lteppp_get_state() == E_LTE_SUSPENDED && lteppp_ipv4() > 0 && args[0].u_obj == mp_const_none) {
+        if (lte_push_at_command_ext("ATO", LTE_RX_TIMEOUT_MAX_MS, LTE_CONNECT_RSP, strlen("ATO"))) {
+            lteppp_resume();
+            lteppp_set_state(E_LTE_PPP);
+            lte_timings.resume = mp_hal_ticks_ms() - start;
+            return mp_const_none;
+        }
+    }
     lte_check_attached(lte_legacyattach_flag);
 
     if (lteppp_get_state() == E_LTE_SUSPENDED || lteppp_get_state() == E_LTE_ATTACHED) {
@@ -1026,6 +1139,7 @@ STATIC mp_obj_t lte_resume(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
             lteppp_resume();
             lteppp_set_state(E_LTE_PPP);
             vTaskDelay(1500);
+            lte_timings.resume = mp_hal_ticks_ms() - start;
         } else {
             lteppp_disconnect();
             lteppp_set_state(E_LTE_ATTACHED);
@@ -1208,8 +1322,205 @@ STATIC mp_obj_t lte_ue_coverage(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(lte_ue_coverage_obj, lte_ue_coverage);
 
+// picks the finest unit that can hold the duration, the timer is rounded up
+static void lte_encode_timer (char *bits, const lte_timer_unit_t *units, size_t n_units, mp_int_t seconds) {
+    if (seconds >= 0) {
+        for (size_t i = 0; i < n_units; i++) {
+            uint32_t value = (seconds + units[i].seconds - 1) / units[i].seconds;
+            if (value <= 31) {
+                uint8_t timer = (units[i].unit << 5) | value;
+                for (int b = 0; b < 8; b++) {
+                    bits[b] = (timer & (0x80 >> b)) ? '1' : '0';
+                }
+                bits[8] = '\0';
+                return;
+            }
+        }
+    }
+    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "timer value %d out of range", seconds));
+}
+
+static mp_obj_t lte_decode_timer (const char *bits, const lte_timer_unit_t *units, size_t n_units) {
+    uint8_t timer = 0;
+    for (int b = 0; b < 8; b++) {
+        if (bits[b] != '0' && bits[b] != '1') {
+            return mp_const_none;
+        }
+        timer = (timer << 1) | (bits[b] - '0');
+    }
+    for (size_t i = 0; i < n_units; i++) {
+        if (units[i].unit == (timer >> 5)) {
+            return mp_obj_new_int_from_uint(units[i].seconds * (timer & 0x1F));
+        }
+    }
+    // deactivated
+    return mp_const_none;
+}
+
+STATIC mp_obj_t lte_psm(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_enable,           MP_ARG_OBJ,                     {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_periodic,         MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = mp_const_none} },
+        { MP_QSTR_active,           MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = mp_const_none} },
+    };
+    lte_check_init();
+    lte_check_inppp();
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[0].u_obj == MP_OBJ_NULL) {
+        static const qstr lte_psm_fields[] = { MP_QSTR_enabled, MP_QSTR_periodic, MP_QSTR_active };
+        mp_obj_t tuple[3] = { mp_const_false, mp_const_none, mp_const_none };
+        char *pos;
+
+        if (!lte_push_at_command("AT+CPSMS?", LTE_RX_TIMEOUT_MIN_MS) || !(pos = strstr(modlte_rsp.data, "+CPSMS: "))) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        tuple[0] = mp_obj_new_bool(pos[8] == '1');
+        // the requested T3412 and T3324 are the last two quoted values
+        const char *timers[4];
+        int n_timers = 0;
+        while (n_timers < 4 && (pos = strchr(pos, '"')) != NULL) {
+            timers[n_timers++] = ++pos;
+            if ((pos = strchr(pos, '"')) == NULL) {
+                break;
+            }
+            pos++;
+        }
+        if (n_timers >= 2) {
+            tuple[1] = lte_decode_timer(timers[n_timers - 2], lte_t3412_units, MP_ARRAY_SIZE(lte_t3412_units));
+            tuple[2] = lte_decode_timer(timers[n_timers - 1], lte_t3324_units, MP_ARRAY_SIZE(lte_t3324_units));
+        }
+        return mp_obj_new_attrtuple(lte_psm_fields, MP_ARRAY_SIZE(tuple), tuple);
+    }
+
+    char at_cmd[LTE_AT_CMD_SIZE_MAX - 4];
+    if (!mp_obj_is_true(args[0].u_obj)) {
+        strcpy(at_cmd, "AT+CPSMS=0");
+    } else if (args[1].u_obj == mp_const_none && args[2].u_obj == mp_const_none) {
+        // let the network pick the timers
+        strcpy(at_cmd, "AT+CPSMS=1");
+    } else {
+        if (args[1].u_obj == mp_const_none || args[2].u_obj == mp_const_none) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "both periodic and active are needed"));
+        }
+        char t3412[9], t3324[9];
+        lte_encode_timer(t3412, lte_t3412_units, MP_ARRAY_SIZE(lte_t3412_units), mp_obj_get_int(args[1].u_obj));
+        lte_encode_timer(t3324, lte_t3324_units, MP_ARRAY_SIZE(lte_t3324_units), mp_obj_get_int(args[2].u_obj));
+        sprintf(at_cmd, "AT+CPSMS=1,,,\"%s\",\"%s\"", t3412, t3324);
+    }
+    if (!lte_push_at_command(at_cmd, LTE_RX_TIMEOUT_MAX_MS)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(lte_psm_obj, 1, lte_psm);
+
+STATIC mp_obj_t lte_edrx(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_enable,           MP_ARG_OBJ,                     {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_cycle,            MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = mp_const_none} },
+        { MP_QSTR_nbiot,            MP_ARG_KW_ONLY  | MP_ARG_BOOL,  {.u_bool = false} },
+    };
+    lte_check_init();
+    lte_check_inppp();
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    uint8_t act = args[2].u_bool ? LTE_EDRX_ACT_NB_IOT : LTE_EDRX_ACT_LTE_M;
+    char at_cmd[LTE_AT_CMD_SIZE_MAX - 4];
+
+    if (args[0].u_obj == MP_OBJ_NULL) {
+        // one "+CEDRXS: <act>,"<cycle>"" line for every access technology with eDRX enabled
+        char prefix[16];
+        char *pos;
+        sprintf(prefix, "+CEDRXS: %u,\"", act);
+        if (!lte_push_at_command("AT+CEDRXS?", LTE_RX_TIMEOUT_MIN_MS)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        if ((pos = strstr(modlte_rsp.data, prefix)) == NULL) {
+            return mp_const_none;
+        }
+        pos += strlen(prefix);
+        uint8_t value = 0;
+        for (int b = 0; b < 4; b++) {
+            value = (value << 1) | (pos[b] == '1');
+        }
+        return mp_obj_new_float(lte_edrx_cycles[value] / 100.0);
+    }
+
+    if (!mp_obj_is_true(args[0].u_obj)) {
+        sprintf(at_cmd, "AT+CEDRXS=0,%u", act);
+    } else {
+        if (args[1].u_obj == mp_const_none) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "cycle is needed"));
+        }
+        // the shortest cycle that is at least as long as the one requested
+        uint32_t cycle = (uint32_t)(mp_obj_get_float(args[1].u_obj) * 100);
+        uint8_t value = 0;
+        while (value < MP_ARRAY_SIZE(lte_edrx_cycles) - 1 && lte_edrx_cycles[value] < cycle) {
+            value++;
+        }
+        sprintf(at_cmd, "AT+CEDRXS=1,%u,\"%c%c%c%c\"", act, (value & 8) ? '1' : '0', (value & 4) ? '1' : '0',
+                (value & 2) ? '1' : '0', (value & 1) ? '1' : '0');
+    }
+    if (!lte_push_at_command(at_cmd, LTE_RX_TIMEOUT_MAX_MS)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(lte_edrx_obj, 1, lte_edrx);
+
+STATIC mp_obj_t lte_stats(mp_obj_t self_in) {
+    static const qstr lte_stats_fields[] = {
+        MP_QSTR_rssi, MP_QSTR_rsrp, MP_QSTR_rsrq, MP_QSTR_cell_id, MP_QSTR_tac, MP_QSTR_band, MP_QSTR_earfcn, MP_QSTR_age
+    };
+    lte_link_stats_t stats;
+    mp_obj_t tuple[8];
+
+    lte_check_init();
+    // sampled by the LTE task, reading them doesn't interrupt the PPP session
+    lteppp_get_link_stats(&stats);
+    if (stats.ticks == 0) {
+        return mp_const_none;
+    }
+    tuple[0] = (stats.rssi != LTE_STATS_UNKNOWN) ? mp_obj_new_int(stats.rssi) : mp_const_none;
+    tuple[1] = (stats.rsrp != LTE_STATS_UNKNOWN) ? mp_obj_new_int(stats.rsrp) : mp_const_none;
+    tuple[2] = (stats.rsrq != LTE_STATS_UNKNOWN) ? mp_obj_new_int(stats.rsrq) : mp_const_none;
+    tuple[3] = stats.cell_id ? mp_obj_new_int_from_uint(stats.cell_id) : mp_const_none;
+    tuple[4] = stats.tac ? mp_obj_new_int(stats.tac) : mp_const_none;
+    tuple[5] = stats.band ? mp_obj_new_int(stats.band) : mp_const_none;
+    tuple[6] = stats.earfcn ? mp_obj_new_int_from_uint(stats.earfcn) : mp_const_none;
+    tuple[7] = mp_obj_new_int_from_uint(mp_hal_ticks_ms() - stats.ticks);
+    return mp_obj_new_attrtuple(lte_stats_fields, MP_ARRAY_SIZE(tuple), tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(lte_stats_obj, lte_stats);
+
+STATIC mp_obj_t lte_timings_info(mp_obj_t self_in) {
+    static const qstr lte_timings_fields[] = { MP_QSTR_attach, MP_QSTR_connect, MP_QSTR_suspend, MP_QSTR_resume };
+    mp_obj_t tuple[4];
+
+    // the IP address comes from the tcpip thread, the connection is timed up to it
+    if (lte_timings.connecting && lteppp_ipv4() > 0 &&
+        (int32_t)(lteppp_get_up_ticks() - lte_timings.connect_start) >= 0) {
+        lte_timings.connect = lteppp_get_up_ticks() - lte_timings.connect_start;
+        lte_timings.connecting = false;
+    }
+    tuple[0] = (lte_timings.attach >= 0) ? mp_obj_new_int(lte_timings.attach) : mp_const_none;
+    tuple[1] = (lte_timings.connect >= 0) ? mp_obj_new_int(lte_timings.connect) : mp_const_none;
+    tuple[2] = (lte_timings.suspend >= 0) ? mp_obj_new_int(lte_timings.suspend) : mp_const_none;
+    tuple[3] = (lte_timings.resume >= 0) ? mp_obj_new_int(lte_timings.resume) : mp_const_none;
+    return mp_obj_new_attrtuple(lte_timings_fields, MP_ARRAY_SIZE(tuple), tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(lte_timings_obj, lte_timings_info);
+
 STATIC mp_obj_t lte_reset(mp_obj_t self_in) {
     lte_check_init();
+    lteppp_pause_background(true);
     lte_disconnect(self_in);
     lte_push_at_command("AT^RESET", LTE_RX_TIMEOUT_MAX_MS);
     lteppp_set_state(E_LTE_IDLE);
@@ -1266,7 +1577,8 @@ STATIC mp_obj_t lte_upgrade_mode(void) {
     uart_driver_delete(2);
 
     // initialize the UART interface
-    lte_uart_config1.baud_rate = MICROPY_LTE_UART_BAUDRATE;
+    // the modem side runs at the rate negotiated by the LTE task
+    lte_uart_config1.baud_rate = lteppp_get_baudrate();
     lte_uart_config1.data_bits = UART_DATA_8_BITS;
     lte_uart_config1.parity = UART_PARITY_DISABLE;
     lte_uart_config1.stop_bits = UART_STOP_BITS_1;
@@ -1416,6 +1728,10 @@ STATIC const mp_map_elem_t lte_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_modem_upgrade_mode),  (mp_obj_t)&lte_upgrade_mode_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_reconnect_uart),      (mp_obj_t)&lte_reconnect_uart_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ue_coverage),         (mp_obj_t)&lte_ue_coverage_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_psm),                 (mp_obj_t)&lte_psm_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_edrx),                (mp_obj_t)&lte_edrx_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_timings),             (mp_obj_t)&lte_timings_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stats),               (mp_obj_t)&lte_stats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_lte_callback),         (mp_obj_t)&lte_callback_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_events),              (mp_obj_t)&lte_events_obj },
 #ifdef LTE_DEBUG_BUFF
@@ -1426,6 +1742,9 @@ STATIC const mp_map_elem_t lte_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_IP),                   MP_OBJ_NEW_QSTR(MP_QSTR_IP) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_IPV4V6),               MP_OBJ_NEW_QSTR(MP_QSTR_IPV4V6) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_EVENT_COVERAGE_LOSS),  MP_OBJ_NEW_SMALL_INT(LTE_TRIGGER_SIG_LOST) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_EVENT_ATTACHED),       MP_OBJ_NEW_SMALL_INT(LTE_TRIGGER_ATTACHED) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_EVENT_CONNECTED),      MP_OBJ_NEW_SMALL_INT(LTE_TRIGGER_CONNECTED) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_EVENT_DISCONNECTED),   MP_OBJ_NEW_SMALL_INT(LTE_TRIGGER_DISCONNECTED) },
 };
 STATIC MP_DEFINE_CONST_DICT(lte_locals_dict, lte_locals_dict_table);
 
@@ -1447,11 +1766,14 @@ const mod_network_nic_type_t mod_network_nic_type_lte = {
     .n_send = lwipsocket_socket_send,
     .n_recv = lwipsocket_socket_recv,
     .n_recvfrom = lwipsocket_socket_recvfrom,
+    .n_sendmsg = lwipsocket_socket_sendmsg,
     .n_settimeout = lwipsocket_socket_settimeout,
     .n_setsockopt = lwipsocket_socket_setsockopt,
+    .n_getsockopt = lwipsocket_socket_getsockopt,
     .n_bind = lwipsocket_socket_bind,
     .n_ioctl = lwipsocket_socket_ioctl,
     .n_setupssl = lwipsocket_socket_setup_ssl,
+    .n_handshake = lwipsocket_socket_handshake,
     .inf_up = ltepp_is_ppp_conn_up,
     .set_default_inf = lte_set_default_inf
 };
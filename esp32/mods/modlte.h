@@ -18,6 +18,9 @@
 
 #define LTE_TRIGGER_NONE                0x00000000
 #define LTE_TRIGGER_SIG_LOST            0x00000001
+#define LTE_TRIGGER_ATTACHED            0x00000002
+#define LTE_TRIGGER_CONNECTED           0x00000004
+#define LTE_TRIGGER_DISCONNECTED        0x00000008
 
 typedef struct _lte_obj_t {
     mp_obj_base_t           base;
@@ -35,6 +38,9 @@ typedef struct _lte_obj_t {
 typedef enum
 {
     LTE_EVENT_COVERAGE_LOST = 0,
+    LTE_EVENT_ATTACHED,
+    LTE_EVENT_CONNECTED,
+    LTE_EVENT_DISCONNECTED,
     LTE_EVENT_MAX
 }lte_events_t;
 
@@ -37,6 +37,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "py/mpconfig.h"
 #include "py/obj.h"
@@ -44,6 +45,7 @@
 #include "py/objlist.h"
 #include "py/stream.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
 
 #include "esp_heap_caps.h"
 #include "sdkconfig.h"
@@ -66,6 +68,10 @@
 #include "machrtc.h"
 #include "mperror.h"
 #include "mpsleep.h"
+#include "mpwakestub.h"
+#include "mpcpufreq.h"
+#include "mpexception.h"
+#include "sflash_diskio.h"
 #include "pybadc.h"
 #include "pybdac.h"
 #include "pybsd.h"
@@ -75,7 +81,15 @@
 #include "machwdt.h"
 #include "machcan.h"
 #include "machrmt.h"
+#include "machi2s.h"
+#include "machcounter.h"
 #include "machtouch.h"
+#include "machulp.h"
+#include "mpirq.h"
+#include "mptaskstats.h"
+#include "mptaskmon.h"
+#include "mpmetrics.h"
+#include "mptrace.h"
 #include "pycom_config.h"
 #if defined (GPY) || defined (FIPY)
 #include "lteppp.h"
@@ -123,6 +137,7 @@ extern TaskHandle_t mpTaskHandle;
 extern TaskHandle_t svTaskHandle;
 extern TaskHandle_t xLoRaTaskHndl;
 extern TaskHandle_t xSigfoxTaskHndl;
+extern void modpycom_nvs_commit_all(void);
 
 STATIC mp_obj_t machine_info(void) {
     // FreeRTOS info
@@ -147,16 +162,61 @@ STATIC mp_obj_t machine_info(void) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_info_obj, machine_info);
 
 mp_obj_t NORETURN machine_reset(void) {
+    sflash_disk_flush();
+    modpycom_nvs_commit_all();
     machtimer_deinit();
     machine_wdt_start(1);
     for ( ; ; );
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_reset_obj, machine_reset);
 
-STATIC mp_obj_t machine_freq(void) {
-    return mp_obj_new_int(ets_get_cpu_frequency() * 1000000);
+STATIC uint32_t machine_freq_mhz(mp_obj_t hz) {
+    uint32_t mhz = mp_obj_get_int(hz) / 1000000;
+    if (!mpcpufreq_is_valid(mhz)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "frequency must be 80, 160 or 240MHz"));
+    }
+    return mhz;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_freq_obj, machine_freq);
+
+// freq([hz], *, auto): auto=(min_hz, max_hz) runs the TLS handshakes at max_hz and the
+// waits at min_hz, hz is used for the rest, auto=True is the same as (80MHz, 240MHz)
+STATIC mp_obj_t machine_freq(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_hz, ARG_auto };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_hz,               MP_ARG_OBJ,                   {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_auto,             MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = MP_OBJ_NULL} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (args[ARG_hz].u_obj == MP_OBJ_NULL && args[ARG_auto].u_obj == MP_OBJ_NULL) {
+        return mp_obj_new_int(mpcpufreq_get() * 1000000);
+    }
+
+    if (args[ARG_hz].u_obj != MP_OBJ_NULL) {
+        mpcpufreq_set(machine_freq_mhz(args[ARG_hz].u_obj));
+    }
+
+    mp_obj_t auto_obj = args[ARG_auto].u_obj;
+    if (auto_obj == mp_const_true) {
+        mpcpufreq_auto(true, MPCPUFREQ_MIN_MHZ, MPCPUFREQ_MAX_MHZ);
+    } else if (auto_obj == mp_const_false || auto_obj == mp_const_none) {
+        mpcpufreq_auto(false, MPCPUFREQ_MIN_MHZ, MPCPUFREQ_MAX_MHZ);
+    } else if (auto_obj != MP_OBJ_NULL) {
+        mp_obj_t *range;
+        mp_obj_get_array_fixed_n(auto_obj, 2, &range);
+        uint32_t min_mhz = machine_freq_mhz(range[0]);
+        uint32_t max_mhz = machine_freq_mhz(range[1]);
+        if (min_mhz > max_mhz) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        mpcpufreq_auto(true, min_mhz, max_mhz);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_freq_obj, 0, machine_freq);
 
 STATIC mp_obj_t machine_unique_id(void) {
     uint8_t id[6];
@@ -224,6 +284,8 @@ STATIC mp_obj_t machine_sleep (uint n_args, const mp_obj_t *arg) {
 
     modbt_deinit(reconnect);
     wlan_deinit(NULL);
+    // the board may lose power while sleeping, write back the FatFS blocks still cached
+    sflash_disk_flush();
 
     if(ESP_OK != esp_light_sleep_start())
     {
@@ -250,6 +312,8 @@ STATIC mp_obj_t machine_deepsleep (uint n_args, const mp_obj_t *arg) {
         lteppp_deinit();
     }
 #endif
+    modpycom_nvs_commit_all();
+    mpsleep_enter_deepsleep();
     if (n_args == 0) {
         mach_expected_wakeup_time = 0;
         esp_deep_sleep_start();
@@ -258,6 +322,8 @@ STATIC mp_obj_t machine_deepsleep (uint n_args, const mp_obj_t *arg) {
         struct timeval tv;
         gettimeofday(&tv, NULL);
         mach_expected_wakeup_time = (int64_t)((tv.tv_sec * 1000000ull) + tv.tv_usec) + sleep_time;
+        // the wake stub sleeps again for the same time when there's nothing worth booting for
+        mpwakestub_arm(sleep_time);
         esp_deep_sleep(sleep_time);
     }
 }
@@ -304,6 +370,95 @@ STATIC mp_obj_t machine_pin_sleep_wakeup (mp_uint_t n_args, const mp_obj_t *pos_
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_pin_sleep_wakeup_obj, 0, machine_pin_sleep_wakeup);
 
+STATIC mp_obj_t machine_wake_stub (mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_enable, ARG_adc, ARG_low, ARG_high, ARG_pins, ARG_level, ARG_max_skips };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_enable,           MP_ARG_REQUIRED | MP_ARG_BOOL, },
+        { MP_QSTR_adc,              MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_low,              MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 0} },
+        { MP_QSTR_high,             MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = MPWAKESTUB_ADC_MAX} },
+        { MP_QSTR_pins,             MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_level,            MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 1} },
+        { MP_QSTR_max_skips,        MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 0} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (!args[ARG_enable].u_bool) {
+        mpwakestub_disable();
+        return mp_const_none;
+    }
+
+    int8_t adc_gpio = -1;
+    if (args[ARG_adc].u_obj != mp_const_none) {
+        adc_gpio = pin_find(args[ARG_adc].u_obj)->pin_number;
+    }
+    if (args[ARG_low].u_int < 0 || args[ARG_high].u_int > MPWAKESTUB_ADC_MAX || args[ARG_low].u_int > args[ARG_high].u_int ||
+        args[ARG_max_skips].u_int < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    uint32_t len = 0;
+    mp_obj_t *pins = NULL;
+    if (args[ARG_pins].u_obj != mp_const_none) {
+        mp_obj_get_array(args[ARG_pins].u_obj, &len, &pins);
+    }
+    uint8_t gpios[len];
+    for (int i = 0; i < len; i++) {
+        gpios[i] = pin_find(pins[i])->pin_number;
+    }
+
+    if (!mpwakestub_config(adc_gpio, args[ARG_low].u_int, args[ARG_high].u_int, gpios, len,
+                           args[ARG_level].u_int ? UINT32_MAX : 0, args[ARG_max_skips].u_int)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "the wake stub can't sample the selected pin(s)"));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_wake_stub_obj, 1, machine_wake_stub);
+
+STATIC mp_obj_t machine_wake_stub_stats (void) {
+    uint32_t skips;
+    uint16_t adc_value;
+    mpwakestub_get_stats(&skips, &adc_value);
+
+    mp_obj_t tuple[2];
+    tuple[0] = mp_obj_new_int_from_uint(skips);
+    tuple[1] = mp_obj_new_int(adc_value);
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_wake_stub_stats_obj, machine_wake_stub_stats);
+
+// idle_sleep([enable], *, min_ms): light sleep through the time.sleep() waits
+STATIC mp_obj_t machine_idle_sleep (mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_enable, ARG_min_ms };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_enable,           MP_ARG_OBJ,                   {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_min_ms,           MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = -1} },
+    };
+
+    // parse args
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (args[ARG_enable].u_obj == MP_OBJ_NULL && args[ARG_min_ms].u_int < 0) {
+        return mp_obj_new_bool(mpsleep_idle_enabled());
+    }
+
+    bool enable = mpsleep_idle_enabled();
+    if (args[ARG_enable].u_obj != MP_OBJ_NULL) {
+        enable = mp_obj_is_true(args[ARG_enable].u_obj);
+    }
+    uint32_t min_ms = mpsleep_idle_min_ms();
+    if (args[ARG_min_ms].u_int >= 0) {
+        min_ms = args[ARG_min_ms].u_int;
+    }
+    mpsleep_idle_configure(enable, min_ms);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_idle_sleep_obj, 0, machine_idle_sleep);
+
 STATIC mp_obj_t machine_reset_cause (void) {
     return mp_obj_new_int(mpsleep_get_reset_cause());
 }
@@ -347,6 +502,236 @@ STATIC mp_obj_t machine_enable_irq (uint n_args, const mp_obj_t *arg) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_enable_irq_obj, 0, 1, machine_enable_irq);
 
+// (dispatched, dropped) callbacks of the high, normal and low priority levels
+STATIC mp_obj_t machine_irq_stats (void) {
+    mp_obj_t levels[MP_IRQ_PRIORITY_LEVELS];
+    for (int prio = MP_IRQ_PRIORITY_HIGH; prio < MP_IRQ_PRIORITY_LEVELS; prio++) {
+        mp_irq_stats_t stats;
+        mp_irq_get_stats(prio, &stats);
+        mp_obj_t tuple[2];
+        tuple[0] = mp_obj_new_int_from_uint(stats.dispatched);
+        tuple[1] = mp_obj_new_int_from_uint(stats.dropped);
+        levels[prio] = mp_obj_new_tuple(2, tuple);
+    }
+    return mp_obj_new_tuple(MP_IRQ_PRIORITY_LEVELS, levels);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_irq_stats_obj, machine_irq_stats);
+
+// one entry per task alive, cpu is the percentage of a core used since the previous call
+STATIC mp_obj_t machine_tasks (void) {
+    STATIC const qstr machine_tasks_fields[] = {
+        MP_QSTR_name, MP_QSTR_core, MP_QSTR_priority, MP_QSTR_state, MP_QSTR_cpu, MP_QSTR_stack_size, MP_QSTR_stack_free
+    };
+    STATIC const qstr machine_tasks_states[] = {
+        MP_QSTR_running, MP_QSTR_ready, MP_QSTR_blocked, MP_QSTR_suspended, MP_QSTR_deleted
+    };
+
+    mptaskstats_task_t *tasks = m_new(mptaskstats_task_t, MPTASKSTATS_TASKS_MAX);
+    uint32_t window;
+    uint32_t count = mptaskstats_read(tasks, MPTASKSTATS_TASKS_MAX, &window);
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (uint32_t i = 0; i < count; i++) {
+        mptaskstats_task_t *task = &tasks[i];
+        mp_obj_t tuple[7];
+        tuple[0] = mp_obj_new_str(task->name, strlen(task->name));
+        tuple[1] = (task->core < 0) ? mp_const_none : mp_obj_new_int(task->core);
+        tuple[2] = mp_obj_new_int(task->priority);
+        tuple[3] = (task->state <= eDeleted) ? MP_OBJ_NEW_QSTR(machine_tasks_states[task->state]) : mp_const_none;
+        tuple[4] = mp_obj_new_float(window ? (task->ticks * 100.0f) / window : 0.0f);
+        tuple[5] = mp_obj_new_int_from_uint(task->stack_size);
+        tuple[6] = mp_obj_new_int_from_uint(task->stack_free);
+        mp_obj_list_append(list, mp_obj_new_attrtuple(machine_tasks_fields, 7, tuple));
+    }
+    m_del(mptaskstats_task_t, tasks, MPTASKSTATS_TASKS_MAX);
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_tasks_obj, machine_tasks);
+
+// one entry per internal task with a heartbeat, guard makes WDT.feed() a no-op while one is overdue
+STATIC mp_obj_t machine_task_health (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset,    MP_ARG_BOOL,                  {.u_bool = false} },
+        { MP_QSTR_guard,    MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    STATIC const qstr machine_task_health_fields[] = {
+        MP_QSTR_name, MP_QSTR_deadline, MP_QSTR_beats, MP_QSTR_overruns, MP_QSTR_max, MP_QSTR_last_seen,
+        MP_QSTR_idle, MP_QSTR_overdue, MP_QSTR_hist
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[1].u_obj != mp_const_none) {
+        mptaskmon_set_guard(mp_obj_is_true(args[1].u_obj));
+    }
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (int i = 0; i < E_MPTASKMON_NUM_TASKS; i++) {
+        mptaskmon_stats_t stats;
+        mptaskmon_get_stats(i, &stats, args[0].u_bool);
+        if (!stats.registered) {
+            continue;
+        }
+        mp_obj_t hist[MPTASKMON_HIST_BUCKETS];
+        for (int b = 0; b < MPTASKMON_HIST_BUCKETS; b++) {
+            hist[b] = mp_obj_new_int_from_uint(stats.hist[b]);
+        }
+        mp_obj_t tuple[9];
+        const char *name = mptaskmon_name(i);
+        tuple[0] = mp_obj_new_str(name, strlen(name));
+        tuple[1] = mp_obj_new_int_from_uint(stats.deadline_ms);
+        tuple[2] = mp_obj_new_int_from_uint(stats.beats);
+        tuple[3] = mp_obj_new_int_from_uint(stats.overruns);
+        tuple[4] = mp_obj_new_int_from_uint(stats.max_ms);
+        tuple[5] = mp_obj_new_int_from_uint(stats.since_ms);
+        tuple[6] = mp_obj_new_bool(stats.idle);
+        tuple[7] = mp_obj_new_bool(stats.overdue);
+        tuple[8] = mp_obj_new_tuple(MPTASKMON_HIST_BUCKETS, hist);
+        mp_obj_list_append(list, mp_obj_new_attrtuple(machine_task_health_fields, 9, tuple));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_task_health_obj, 0, machine_task_health);
+
+// name is source.metric, the value of a histogram is a tuple of its buckets
+STATIC mp_obj_t machine_metrics (size_t n_args, const mp_obj_t *args) {
+    STATIC const qstr machine_metrics_fields[] = {
+        MP_QSTR_name, MP_QSTR_kind, MP_QSTR_value
+    };
+    STATIC const qstr machine_metrics_kinds[] = {
+        MP_QSTR_counter, MP_QSTR_gauge, MP_QSTR_histogram
+    };
+
+    if (n_args > 0 && mp_obj_is_true(args[0])) {
+        // what the exporter sends, with absolute values
+        byte *buf = m_new(byte, MPMETRICS_SNAPSHOT_MAX);
+        size_t len = mpmetrics_snapshot(buf, false);
+        mp_obj_t snapshot = mp_obj_new_bytes(buf, len);
+        m_del(byte, buf, MPMETRICS_SNAPSHOT_MAX);
+        return snapshot;
+    }
+
+    uint32_t *values = m_new(uint32_t, MPMETRICS_VALUES_MAX);
+    uint32_t count = mpmetrics_collect(values, MPMETRICS_VALUES_MAX);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    uint32_t idx = 0;
+    for (mpmetrics_source_t *source = mpmetrics_first(); source != NULL && idx < count; source = source->next) {
+        for (uint32_t i = 0; i < source->n_metrics && idx < count; i++) {
+            const mpmetrics_desc_t *desc = &source->metrics[i];
+            vstr_t vstr;
+            vstr_init(&vstr, 32);
+            vstr_printf(&vstr, "%s.%s", source->name, desc->name);
+            mp_obj_t tuple[3];
+            tuple[0] = mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+            tuple[1] = MP_OBJ_NEW_QSTR(machine_metrics_kinds[desc->kind]);
+            if (desc->kind == E_MPMETRICS_HISTOGRAM) {
+                mp_obj_t buckets = mp_obj_new_tuple(desc->buckets, NULL);
+                for (uint32_t b = 0; b < desc->buckets; b++) {
+                    ((mp_obj_tuple_t *)MP_OBJ_TO_PTR(buckets))->items[b] = mp_obj_new_int_from_uint(values[idx++]);
+                }
+                tuple[2] = buckets;
+            } else if (desc->kind == E_MPMETRICS_GAUGE) {
+                tuple[2] = mp_obj_new_int((int32_t)values[idx++]);
+            } else {
+                tuple[2] = mp_obj_new_int_from_uint(values[idx++]);
+            }
+            mp_obj_list_append(list, mp_obj_new_attrtuple(machine_metrics_fields, 3, tuple));
+        }
+    }
+    m_del(uint32_t, values, MPMETRICS_VALUES_MAX);
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_metrics_obj, 0, 1, machine_metrics);
+
+// target None stops it, without arguments it returns the state
+STATIC mp_obj_t machine_metrics_export (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_target,   MP_ARG_OBJ,                   {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_period,   MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = MPMETRICS_PERIOD_MS_DEF} },
+        { MP_QSTR_topic,    MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_delta,    MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    STATIC const qstr machine_metrics_export_fields[] = {
+        MP_QSTR_running, MP_QSTR_exports, MP_QSTR_failures, MP_QSTR_bytes, MP_QSTR_schema
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[0].u_obj == MP_OBJ_NULL) {
+        mpmetrics_export_stats_t stats;
+        mpmetrics_export_get_stats(&stats);
+        mp_obj_t tuple[5];
+        tuple[0] = mp_obj_new_bool(MP_STATE_PORT(mpmetrics_export)[0] != MP_OBJ_NULL);
+        tuple[1] = mp_obj_new_int_from_uint(stats.exports);
+        tuple[2] = mp_obj_new_int_from_uint(stats.failures);
+        tuple[3] = mp_obj_new_int_from_uint(stats.bytes);
+        tuple[4] = mp_obj_new_int_from_uint(mpmetrics_schema());
+        return mp_obj_new_attrtuple(machine_metrics_export_fields, 5, tuple);
+    }
+    if (args[0].u_obj == mp_const_none) {
+        mpmetrics_export_stop();
+        return mp_const_none;
+    }
+
+    mp_obj_t topic = args[2].u_obj;
+    if (topic == MP_OBJ_NULL) {
+        topic = MP_OBJ_NEW_QSTR(MP_QSTR_metrics);
+    } else if (!MP_OBJ_IS_STR_OR_BYTES(topic)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, mpexception_value_invalid_arguments));
+    }
+    mp_obj_t dest[2];
+    mp_load_method_maybe(args[0].u_obj, MP_QSTR_publish, dest);
+    if (args[1].u_int < MPMETRICS_PERIOD_MS_MIN || (dest[0] == MP_OBJ_NULL && !mp_obj_is_callable(args[0].u_obj))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    mpmetrics_export_start(args[0].u_obj, topic, args[1].u_int, args[3].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_metrics_export_obj, 0, machine_metrics_export);
+
+// a mask of 0 stops the recording and keeps what was recorded
+STATIC mp_obj_t machine_trace (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_mask,     MP_ARG_REQUIRED | MP_ARG_INT, },
+        { MP_QSTR_size,     MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = MPTRACE_SIZE_DEFAULT} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[0].u_int == 0) {
+        mptrace_stop();
+    } else {
+        if (args[1].u_int <= 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        if (!mptrace_start(args[0].u_int, args[1].u_int)) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_trace_obj, 1, machine_trace);
+
+// writes the trace as Chrome Trace Event JSON to the REPL, or to a stream such as a file or a UART
+STATIC mp_obj_t machine_trace_dump (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_stream,   MP_ARG_OBJ,                   {.u_obj = mp_const_none} },
+        { MP_QSTR_clear,    MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[0].u_obj == mp_const_none) {
+        mptrace_dump(&mp_plat_print, args[1].u_bool);
+    } else {
+        mp_get_stream_raise(args[0].u_obj, MP_STREAM_OP_WRITE);
+        mp_print_t print = {MP_OBJ_TO_PTR(args[0].u_obj), mp_stream_write_adaptor};
+        mptrace_dump(&print, args[1].u_bool);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_trace_dump_obj, 0, machine_trace_dump);
+
 
 /*
  Implement ESP32 core temperature read
@@ -379,6 +764,42 @@ STATIC mp_obj_t secure_boot (void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_secure_boot_obj, secure_boot);
 
+// DHT11/DHT22 timings in us, the start pulse is long enough for both
+#define MACHINE_DHT_START_LOW               (18000)
+#define MACHINE_DHT_IDLE                    (MACHINE_DHT_START_LOW + 2000)
+#define MACHINE_DHT_BIT_HIGH                (48)        // a 0 is high for 26 us, a 1 for 70 us
+#define MACHINE_DHT_PULSES                  (4 + 2 * 40)
+
+// drivers/dht: the start pulse and the answer of the sensor go through the RMT bus,
+// so the 40 bits are timed in hardware with the interrupts left on
+STATIC mp_obj_t machine_dht_readinto (mp_obj_t pin_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < 5) {
+        mp_raise_ValueError("buffer too small");
+    }
+
+    mach_rmt_bus_t *bus = mach_rmt_bus_get(pin_find(pin_in)->pin_number);
+    rmt_item32_t item;
+    item.level0 = 0;
+    item.duration0 = MACHINE_DHT_START_LOW;
+    item.level1 = 1;
+    item.duration1 = 10;
+    uint16_t pulses[MACHINE_DHT_PULSES + 1];
+    mp_uint_t n = mach_rmt_bus_transfer(bus, &item, 1, pulses, MP_ARRAY_SIZE(pulses), MACHINE_DHT_IDLE);
+
+    // the start pulse, the line released, the 80 us low and high of the answer, then low and high for each bit
+    if (n < MACHINE_DHT_PULSES || (pulses[0] & 0x8000) || (pulses[2] & 0x8000)) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    uint8_t *buf = bufinfo.buf;
+    for (int i = 0; i < 40; i++) {
+        buf[i / 8] = (buf[i / 8] << 1) | ((pulses[5 + 2 * i] & 0x7FFF) > MACHINE_DHT_BIT_HIGH);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_dht_readinto_obj, machine_dht_readinto);
+
 STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__),                MP_OBJ_NEW_QSTR(MP_QSTR_umachine) },
 
@@ -391,22 +812,35 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_unique_id),               (mp_obj_t)(&machine_unique_id_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_main),                    (mp_obj_t)(&machine_main_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_rng),                     (mp_obj_t)(&machine_rng_get_obj) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rng_into),                (mp_obj_t)(&machine_rng_into_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_idle),                    (mp_obj_t)(&machine_idle_obj) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_idle_sleep),              (mp_obj_t)(&machine_idle_sleep_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sleep),                   (mp_obj_t)(&machine_sleep_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deepsleep),               (mp_obj_t)(&machine_deepsleep_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_remaining_sleep_time),    (mp_obj_t)(&machine_remaining_sleep_time_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_pin_sleep_wakeup),    (mp_obj_t)(&machine_pin_sleep_wakeup_obj) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_wake_stub),               (mp_obj_t)(&machine_wake_stub_obj) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_wake_stub_stats),         (mp_obj_t)(&machine_wake_stub_stats_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_reset_cause),             (mp_obj_t)(&machine_reset_cause_obj) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_wake_reason),             (mp_obj_t)(&machine_wake_reason_obj) },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_disable_irq),             (mp_obj_t)&machine_disable_irq_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_enable_irq),              (mp_obj_t)&machine_enable_irq_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_irq_stats),               (mp_obj_t)&machine_irq_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_tasks),                   (mp_obj_t)&machine_tasks_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_task_health),             (mp_obj_t)&machine_task_health_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_metrics),                 (mp_obj_t)&machine_metrics_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_metrics_export),          (mp_obj_t)&machine_metrics_export_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_trace),                   (mp_obj_t)&machine_trace_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_trace_dump),              (mp_obj_t)&machine_trace_dump_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_info),                    (mp_obj_t)&machine_info_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_temperature),             (mp_obj_t)&machine_temperature_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_flash_encrypt),           (mp_obj_t)&machine_flash_encrypt_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_secure_boot),               (mp_obj_t)&machine_secure_boot_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dht_readinto),            (mp_obj_t)&machine_dht_readinto_obj },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_Pin),                     (mp_obj_t)&pin_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_PinGroup),                (mp_obj_t)&pin_group_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_UART),                    (mp_obj_t)&mach_uart_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_SPI),                     (mp_obj_t)&mach_spi_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_I2C),                     (mp_obj_t)&machine_i2c_type },
@@ -419,7 +853,10 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_WDT),                     (mp_obj_t)&mach_wdt_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_CAN),                     (mp_obj_t)&mach_can_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_RMT),                     (mp_obj_t)&mach_rmt_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_I2S),                     (mp_obj_t)&mach_i2s_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Counter),                 (mp_obj_t)&mach_counter_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Touch),                   (mp_obj_t)&machine_touchpad_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ULP),                     (mp_obj_t)&mach_ulp_type },
 
 
     // constants
@@ -437,6 +874,13 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_WAKEUP_ALL_LOW),      MP_OBJ_NEW_SMALL_INT(ESP_EXT1_WAKEUP_ALL_LOW) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_WAKEUP_ANY_HIGH),     MP_OBJ_NEW_SMALL_INT(ESP_EXT1_WAKEUP_ANY_HIGH) },
+
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TRACE_LORA),          MP_OBJ_NEW_SMALL_INT(MPTRACE_CAT_LORA) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TRACE_WLAN),          MP_OBJ_NEW_SMALL_INT(MPTRACE_CAT_WLAN) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TRACE_GC),            MP_OBJ_NEW_SMALL_INT(MPTRACE_CAT_GC) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TRACE_IRQ),           MP_OBJ_NEW_SMALL_INT(MPTRACE_CAT_IRQ) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TRACE_SOCKET),        MP_OBJ_NEW_SMALL_INT(MPTRACE_CAT_SOCKET) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TRACE_ALL),           MP_OBJ_NEW_SMALL_INT(MPTRACE_CAT_ALL) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(machine_module_globals, machine_module_globals_table);
@@ -19,6 +19,11 @@
 
 #include "modmdns.h"
 #include "modnetwork.h"
+#include "mpirq.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 
 /******************************************************************************
@@ -27,6 +32,18 @@
 #define MOD_MDNS_PROTO_TCP      (0)
 #define MOD_MDNS_PROTO_UDP      (1)
 
+#define MOD_MDNS_BROWSE_MAX                 (3)
+#define MOD_MDNS_CACHE_SIZE                 (8)         // services cached per browse
+#define MOD_MDNS_NAME_LEN_MAX               (64)
+#define MOD_MDNS_HOSTNAME_LEN_MAX           (32)
+#define MOD_MDNS_TXT_LEN_MAX                (64)        // key and value strings of the txt record, each NULL terminated
+#define MOD_MDNS_BROWSE_INTERVAL_DEFAULT    (30)        // seconds
+#define MOD_MDNS_BROWSE_TTL_DEFAULT         (120)       // seconds, the TTL of the SRV and A records (RFC 6762)
+#define MOD_MDNS_BROWSE_QUERY_MS            (3000)
+#define MOD_MDNS_TASK_STACK_SIZE            (3072)
+#define MOD_MDNS_TASK_PRIORITY              (5)
+#define MOD_MDNS_TASK_IDLE_MS               (1000)
+
 /******************************************************************************
  DEFINE PRIVATE TYPES
  ******************************************************************************/
@@ -38,9 +55,38 @@ typedef struct mod_mdns_query_obj_s {
     mp_obj_t txt;                 /* txt record */
     mp_obj_t addr;                /* linked list of IP addresses found */
 }mod_mdns_query_obj_t;
+
+// A service found by a browse, kept until its TTL expires
+typedef struct mod_mdns_cache_entry_s {
+    char instance_name[MOD_MDNS_NAME_LEN_MAX];
+    char hostname[MOD_MDNS_HOSTNAME_LEN_MAX];
+    char txt[MOD_MDNS_TXT_LEN_MAX];
+    TickType_t expires;
+    uint32_t addr;                /* IPv4 address in network byte order */
+    uint16_t port;
+    uint8_t txt_count;
+    bool used;
+}mod_mdns_cache_entry_t;
+
+typedef struct mod_mdns_browse_s {
+    mod_mdns_cache_entry_t cache[MOD_MDNS_CACHE_SIZE];
+    char service_type[MOD_MDNS_NAME_LEN_MAX];
+    mp_obj_t handler;
+    TickType_t next_query;
+    uint32_t interval_ms;
+    uint32_t ttl_ms;
+    uint8_t proto;
+    bool active;
+}mod_mdns_browse_t;
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
+STATIC mp_obj_t mod_mdns_new_query(const char* instance_name, const char* hostname, uint16_t port, mp_obj_t txt, uint32_t addr);
+STATIC mod_mdns_browse_t* mod_mdns_find_browse(const char* service_type, uint8_t proto);
+STATIC mp_obj_t mod_mdns_browse_results(mod_mdns_browse_t* browse);
+STATIC bool mod_mdns_browse_merge(mod_mdns_browse_t* browse, mdns_result_t* results);
+STATIC void mod_mdns_browse_callback_handler(void *arg);
+STATIC void TASK_MDNS_Browse(void *pvParameters);
 
 /******************************************************************************
  DEFINE PRIVATE VARIABLES
@@ -48,9 +94,198 @@ typedef struct mod_mdns_query_obj_s {
 STATIC bool initialized = false;
 STATIC const mp_obj_type_t mod_mdns_query_type;
 
+STATIC mod_mdns_browse_t mod_mdns_browses[MOD_MDNS_BROWSE_MAX];
+STATIC SemaphoreHandle_t mod_mdns_cache_mutex = NULL;   // guards the caches, never held during a query
+STATIC SemaphoreHandle_t mod_mdns_query_mutex = NULL;   // held by the browse task while it queries
+STATIC TaskHandle_t xMDNSBrowseTaskHndl = NULL;
+
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
+// Create a new query result object
+STATIC mp_obj_t mod_mdns_new_query(const char* instance_name, const char* hostname, uint16_t port, mp_obj_t txt, uint32_t addr) {
+
+    mod_mdns_query_obj_t *query_obj = m_new(mod_mdns_query_obj_t, 1);
+    query_obj->base.type = (mp_obj_t)&mod_mdns_query_type;
+    query_obj->instance_name = mp_obj_new_str(instance_name, strlen(instance_name));
+    query_obj->hostname = mp_obj_new_str(hostname, strlen(hostname));
+    query_obj->port = mp_obj_new_int(port);
+    query_obj->txt = txt;
+    query_obj->addr = netutils_format_ipv4_addr((uint8_t *)&addr, NETUTILS_BIG);
+
+    return query_obj;
+}
+
+// Get the active browse of a service
+STATIC mod_mdns_browse_t* mod_mdns_find_browse(const char* service_type, uint8_t proto) {
+
+    for(int i = 0; i < MOD_MDNS_BROWSE_MAX; i++) {
+        mod_mdns_browse_t* browse = &mod_mdns_browses[i];
+        if((browse->active == true) && (browse->proto == proto) && (strcmp(browse->service_type, service_type) == 0)) {
+            return browse;
+        }
+    }
+    return NULL;
+}
+
+// Create the list of query result objects from the cache of a browse
+STATIC mp_obj_t mod_mdns_browse_results(mod_mdns_browse_t* browse) {
+
+    mp_obj_t queries_list = mp_obj_new_list(0, NULL);
+
+    xSemaphoreTake(mod_mdns_cache_mutex, portMAX_DELAY);
+    for(int i = 0; i < MOD_MDNS_CACHE_SIZE; i++) {
+        mod_mdns_cache_entry_t* entry = &browse->cache[i];
+        if(entry->used == true) {
+            mp_obj_t txt = mp_obj_new_list(0, NULL);
+            const char* item = entry->txt;
+            for(int j = 0; j < entry->txt_count; j++) {
+                mp_obj_t tuple[2];
+                tuple[0] = mp_obj_new_str(item, strlen(item));
+                item += strlen(item) + 1;
+                tuple[1] = mp_obj_new_str(item, strlen(item));
+                item += strlen(item) + 1;
+                mp_obj_list_append(txt, mp_obj_new_tuple(2, tuple));
+            }
+            mp_obj_list_append(queries_list, mod_mdns_new_query(entry->instance_name, entry->hostname, entry->port, txt, entry->addr));
+        }
+    }
+    xSemaphoreGive(mod_mdns_cache_mutex);
+
+    return queries_list;
+}
+
+// Refresh the cache of a browse with the results of a query and drop the expired services, returns true if the cache changed
+STATIC bool mod_mdns_browse_merge(mod_mdns_browse_t* browse, mdns_result_t* results) {
+
+    bool changed = false;
+    TickType_t now = xTaskGetTickCount();
+
+    for(mdns_result_t* result = results; result != NULL; result = result->next) {
+        if(result->instance_name == NULL) {
+            continue;
+        }
+
+        // Compose the entry as it should be stored
+        mod_mdns_cache_entry_t found;
+        memset(&found, 0, sizeof(found));
+        strlcpy(found.instance_name, result->instance_name, sizeof(found.instance_name));
+        if(result->hostname != NULL) {
+            strlcpy(found.hostname, result->hostname, sizeof(found.hostname));
+        }
+        found.port = result->port;
+        if(result->addr != NULL) {
+            found.addr = result->addr->addr.u_addr.ip4.addr;
+        }
+        // Keep as many txt items as fit
+        size_t txt_len = 0;
+        for(int i = 0; i < result->txt_count; i++) {
+            const char* key = result->txt[i].key;
+            const char* value = (result->txt[i].value != NULL) ? result->txt[i].value : "";
+            size_t len = strlen(key) + strlen(value) + 2;
+            if((txt_len + len) > sizeof(found.txt)) {
+                break;
+            }
+            strcpy(&found.txt[txt_len], key);
+            strcpy(&found.txt[txt_len + strlen(key) + 1], value);
+            txt_len += len;
+            found.txt_count++;
+        }
+        found.expires = now + pdMS_TO_TICKS(browse->ttl_ms);
+        found.used = true;
+
+        // Look for the service in the cache, or for a free slot
+        mod_mdns_cache_entry_t* entry = NULL;
+        mod_mdns_cache_entry_t* free_entry = NULL;
+        for(int i = 0; i < MOD_MDNS_CACHE_SIZE; i++) {
+            if(browse->cache[i].used == false) {
+                if(free_entry == NULL) {
+                    free_entry = &browse->cache[i];
+                }
+            }
+            else if(strcmp(browse->cache[i].instance_name, found.instance_name) == 0) {
+                entry = &browse->cache[i];
+                break;
+            }
+        }
+
+        if(entry != NULL) {
+            // Only the expiry changes if the service is the same as before
+            if((strcmp(entry->hostname, found.hostname) != 0) || (entry->port != found.port) || (entry->addr != found.addr) ||
+               (entry->txt_count != found.txt_count) || (memcmp(entry->txt, found.txt, sizeof(found.txt)) != 0)) {
+                changed = true;
+            }
+            *entry = found;
+        }
+        else if(free_entry != NULL) {
+            *free_entry = found;
+            changed = true;
+        }
+    }
+
+    // The services not seen again within their TTL are gone
+    for(int i = 0; i < MOD_MDNS_CACHE_SIZE; i++) {
+        mod_mdns_cache_entry_t* entry = &browse->cache[i];
+        if((entry->used == true) && ((int32_t)(now - entry->expires) >= 0)) {
+            entry->used = false;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+// Called in the context of the interpreter when the cache of a browse changed
+STATIC void mod_mdns_browse_callback_handler(void *arg) {
+
+    mod_mdns_browse_t* browse = (mod_mdns_browse_t*)arg;
+
+    if((browse->active == true) && (browse->handler != mp_const_none)) {
+        mp_call_function_1(browse->handler, mod_mdns_browse_results(browse));
+    }
+}
+
+// Query the browsed services periodically, the results are merged into the caches
+STATIC void TASK_MDNS_Browse(void *pvParameters) {
+
+    for (;;) {
+        TickType_t now = xTaskGetTickCount();
+
+        for(int i = 0; i < MOD_MDNS_BROWSE_MAX; i++) {
+            mod_mdns_browse_t* browse = &mod_mdns_browses[i];
+
+            if((browse->active == false) || ((int32_t)(now - browse->next_query) < 0)) {
+                continue;
+            }
+
+            // The module cannot be deinitialized while the query is running
+            mdns_result_t *results = NULL;
+            esp_err_t ret = ESP_FAIL;
+            xSemaphoreTake(mod_mdns_query_mutex, portMAX_DELAY);
+            if((initialized == true) && (browse->active == true)) {
+                ret = mdns_query_ptr(browse->service_type, (browse->proto == MOD_MDNS_PROTO_TCP) ? "_tcp" : "_udp",
+                                     MOD_MDNS_BROWSE_QUERY_MS, MOD_MDNS_CACHE_SIZE, &results);
+            }
+            xSemaphoreGive(mod_mdns_query_mutex);
+
+            xSemaphoreTake(mod_mdns_cache_mutex, portMAX_DELAY);
+            // A failed query still lets the services expire
+            bool changed = mod_mdns_browse_merge(browse, (ret == ESP_OK) ? results : NULL);
+            browse->next_query = xTaskGetTickCount() + pdMS_TO_TICKS(browse->interval_ms);
+            xSemaphoreGive(mod_mdns_cache_mutex);
+
+            if(results != NULL) {
+                mdns_query_results_free(results);
+            }
+
+            if((changed == true) && (browse->active == true)) {
+                mp_irq_queue_interrupt_non_ISR(mod_mdns_browse_callback_handler, browse);
+            }
+        }
+
+        vTaskDelay(MOD_MDNS_TASK_IDLE_MS / portTICK_PERIOD_MS);
+    }
+}
 
 /******************************************************************************
  DEFINE MDNS CLASS FUNCTIONS
@@ -86,9 +321,24 @@ STATIC mp_obj_t mod_mdns_deinit() {
 
     if(initialized == true) {
 
+        // Stop the browses, the caches are dropped
+        for(int i = 0; i < MOD_MDNS_BROWSE_MAX; i++) {
+            if(mod_mdns_browses[i].active == true) {
+                mod_mdns_browses[i].active = false;
+                mp_irq_remove(&mod_mdns_browses[i]);
+            }
+        }
+
+        // Wait for the query of the browse task to finish
+        if(mod_mdns_query_mutex != NULL) {
+            xSemaphoreTake(mod_mdns_query_mutex, portMAX_DELAY);
+        }
         mdns_service_remove_all();
         mdns_free();
         initialized = false;
+        if(mod_mdns_query_mutex != NULL) {
+            xSemaphoreGive(mod_mdns_query_mutex);
+        }
     }
 
     return mp_const_none;
@@ -264,6 +514,14 @@ STATIC mp_obj_t mod_mdns_query(mp_uint_t n_args, const mp_obj_t *pos_args, mp_ma
         }
 
 
+        // The services of a browsed type are returned from the cache without a query
+        if(instance_name == NULL) {
+            mod_mdns_browse_t* browse = mod_mdns_find_browse(service_type, proto_num);
+            if(browse != NULL) {
+                return mod_mdns_browse_results(browse);
+            }
+        }
+
         mdns_result_t *results;
         esp_err_t ret;
 
@@ -282,20 +540,14 @@ STATIC mp_obj_t mod_mdns_query(mp_uint_t n_args, const mp_obj_t *pos_args, mp_ma
             mdns_result_t *result = results;
             mp_obj_t queries_list = mp_obj_new_list(0, NULL);
             while(result != NULL) {
-                mod_mdns_query_obj_t *query_obj = m_new(mod_mdns_query_obj_t, 1);
-                query_obj->base.type = (mp_obj_t)&mod_mdns_query_type;
-                query_obj->instance_name = mp_obj_new_str(result->instance_name, strlen(result->instance_name));
-                query_obj->hostname = mp_obj_new_str(result->hostname, strlen(result->hostname));
-                query_obj->port = mp_obj_new_int(result->port);
-
-                query_obj->txt = mp_obj_new_list(0, NULL);
+                mp_obj_t txt = mp_obj_new_list(0, NULL);
                 for(int i = 0; i < result->txt_count; i++) {
                     mp_obj_t tuple[2];
                     tuple[0] = mp_obj_new_str(result->txt[i].key, strlen(result->txt[i].key));
                     tuple[1] = mp_obj_new_str(result->txt[i].value, strlen(result->txt[i].value));
-                    mp_obj_list_append(query_obj->txt, mp_obj_new_tuple(2, tuple));
+                    mp_obj_list_append(txt, mp_obj_new_tuple(2, tuple));
                 }
-                query_obj->addr = netutils_format_ipv4_addr((uint8_t *)&result->addr->addr.u_addr.ip4.addr, NETUTILS_BIG);
+                mp_obj_t query_obj = mod_mdns_new_query(result->instance_name, result->hostname, result->port, txt, result->addr->addr.u_addr.ip4.addr);
 
                 mp_obj_list_append(queries_list, query_obj);
 
@@ -316,6 +568,111 @@ STATIC mp_obj_t mod_mdns_query(mp_uint_t n_args, const mp_obj_t *pos_args, mp_ma
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_mdns_query_obj, 3, mod_mdns_query);
 
+// Start browsing for a service continuously, the services found are cached
+STATIC mp_obj_t mod_mdns_browse(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    STATIC const mp_arg_t mod_mdns_browse_args[] = {
+            { MP_QSTR_service_type,             MP_ARG_OBJ  | MP_ARG_REQUIRED, },
+            { MP_QSTR_proto,                    MP_ARG_INT  | MP_ARG_REQUIRED, },
+            { MP_QSTR_handler,                  MP_ARG_OBJ  | MP_ARG_KW_ONLY,  {.u_obj = mp_const_none}},
+            { MP_QSTR_interval,                 MP_ARG_INT  | MP_ARG_KW_ONLY,  {.u_int = MOD_MDNS_BROWSE_INTERVAL_DEFAULT}},
+            { MP_QSTR_ttl,                      MP_ARG_INT  | MP_ARG_KW_ONLY,  {.u_int = MOD_MDNS_BROWSE_TTL_DEFAULT}},
+    };
+
+    if(initialized == true) {
+
+        mp_arg_val_t args[MP_ARRAY_SIZE(mod_mdns_browse_args)];
+        mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), mod_mdns_browse_args, args);
+
+        // Get service type
+        size_t service_type_len;
+        const char * service_type = mp_obj_str_get_data(args[0].u_obj, &service_type_len);
+        if(service_type_len >= MOD_MDNS_NAME_LEN_MAX) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "service_type is too long"));
+        }
+
+        // Get proto
+        mp_int_t proto_num = args[1].u_int;
+        if(proto_num != MOD_MDNS_PROTO_TCP && proto_num != MOD_MDNS_PROTO_UDP) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "proto must be 0 (TCP) or 1 (UDP)"));
+        }
+
+        // Get the handler
+        mp_obj_t handler = args[2].u_obj;
+        if((handler != mp_const_none) && !mp_obj_is_callable(handler)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "handler must be callable"));
+        }
+
+        // Get the query interval and how long the services are kept without being seen again
+        if((args[3].u_int <= 0) || (args[4].u_int < args[3].u_int)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "interval must be positive and not longer than ttl"));
+        }
+
+        if(mod_mdns_cache_mutex == NULL) {
+            mod_mdns_cache_mutex = xSemaphoreCreateMutex();
+            mod_mdns_query_mutex = xSemaphoreCreateMutex();
+        }
+
+        // A browse of the same service is restarted with the new parameters, its cache is kept
+        mod_mdns_browse_t* browse = mod_mdns_find_browse(service_type, proto_num);
+        if(browse == NULL) {
+            for(int i = 0; i < MOD_MDNS_BROWSE_MAX; i++) {
+                if(mod_mdns_browses[i].active == false) {
+                    browse = &mod_mdns_browses[i];
+                    xSemaphoreTake(mod_mdns_cache_mutex, portMAX_DELAY);
+                    memset(browse, 0, sizeof(mod_mdns_browse_t));
+                    memcpy(browse->service_type, service_type, service_type_len);
+                    browse->proto = proto_num;
+                    xSemaphoreGive(mod_mdns_cache_mutex);
+                    break;
+                }
+            }
+            if(browse == NULL) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "Too many services are browsed"));
+            }
+        }
+
+        browse->handler = handler;
+        mp_irq_add(browse, handler);
+        browse->interval_ms = args[3].u_int * 1000;
+        browse->ttl_ms = args[4].u_int * 1000;
+        // Query right away
+        browse->next_query = xTaskGetTickCount();
+        browse->active = true;
+
+        if(xMDNSBrowseTaskHndl == NULL) {
+            xTaskCreatePinnedToCore(TASK_MDNS_Browse, "MDNS_Browse", MOD_MDNS_TASK_STACK_SIZE / sizeof(StackType_t), NULL, MOD_MDNS_TASK_PRIORITY, &xMDNSBrowseTaskHndl, 1);
+        }
+
+        // Return what is already known
+        return mod_mdns_browse_results(browse);
+    }
+    else {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "MDNS module is not initialized!"));
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_mdns_browse_obj, 2, mod_mdns_browse);
+
+// Stop browsing for a service, its cache is dropped
+STATIC mp_obj_t mod_mdns_browse_stop(mp_obj_t service_type_in, mp_obj_t proto_in) {
+
+    if(initialized == true) {
+        mod_mdns_browse_t* browse = mod_mdns_find_browse(mp_obj_str_get_str(service_type_in), mp_obj_get_int(proto_in));
+        if(browse != NULL) {
+            browse->active = false;
+            mp_irq_remove(browse);
+        }
+    }
+    else {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "MDNS module is not initialized!"));
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_mdns_browse_stop_obj, mod_mdns_browse_stop);
+
 STATIC mp_obj_t mod_mdns_query_instance_name(mp_obj_t self) {
 
     return ((mod_mdns_query_obj_t *)self)->instance_name;
@@ -373,6 +730,8 @@ STATIC const mp_map_elem_t mod_mdns_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_add_service),                     (mp_obj_t)&mod_mdns_add_service_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_remove_service),                  (mp_obj_t)&mod_mdns_remove_service_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_query),                           (mp_obj_t)&mod_mdns_query_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_browse),                          (mp_obj_t)&mod_mdns_browse_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_browse_stop),                     (mp_obj_t)&mod_mdns_browse_stop_obj },
 
     // class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_PROTO_TCP),                     MP_OBJ_NEW_SMALL_INT(MOD_MDNS_PROTO_TCP) },
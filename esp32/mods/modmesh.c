@@ -11,9 +11,11 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 
@@ -32,6 +34,8 @@
 #include "py/stream.h"
 #include "modusocket.h"
 #include "pycom_config.h"
+#include "netutils.h"
+#include "lwip/sockets.h"
 
 #include "util/mpirq.h"
 
@@ -49,6 +53,7 @@
 #include <openthread/platform/uart.h>
 #include <openthread/border_router.h>
 #include <openthread/link.h>
+#include <openthread/instance.h>
 
 #include "lora/otplat_alarm.h"
 #include "lora/otplat_radio.h"
@@ -60,8 +65,12 @@
  ******************************************************************************/
 #define MESH_STACK_SIZE                                             (8192)
 #define MESH_TASK_PRIORITY                                          (6)
-#define OT_DATA_QUEUE_SIZE_MAX                                      (5)
 #define OT_RX_PACK_SIZE_MAX                                         (512)
+// RX pool shared by all the sockets, split in blocks chained per packet
+#define OT_RX_POOL_BLOCK_SIZE                                       (64)
+#define OT_RX_POOL_BUDGET_DEFAULT                                   (4096)
+#define OT_RX_POOL_BUDGET_MIN                                       (1024)
+#define OT_RX_POOL_BLOCK_NONE                                       (0xFFFF)
 #define IPV6_HEADER_UDP_PROTOCOL_CODE                               (17)
 #define MESH_CLI_OUTPUT_SIZE                                        (1024)
 #define MESH_NEIGBORS_MAX                                           (16)
@@ -77,12 +86,27 @@
 // number of Mesh.leader() micropy command fields
 #define MESH_LEADER_FIELDS_NUM                                      (3)
 
+// number of Mesh.topology() micropy command fields
+#define MESH_TOPOLOGY_FIELDS_NUM                                    (6)
+
+// period of the link quality refresh of the topology cache, in ms
+#define MESH_TOPOLOGY_REFRESH_MS                                    (2000)
+
+// RSSI change (dB) of a neighbor considered a topology change
+#define MESH_TOPOLOGY_RSSI_DELTA                                    (3)
+
 // number of Mesh.border_router() micropy command fields
 #define MESH_BR_FIELDS_NUM                                          (2)
 
 // max number of Border Routers prefix entries for a single node
 #define MESH_BR_MAX                                                 (2)
 
+// max number of native forwarding routes of the Border Router
+#define MESH_BR_ROUTES_MAX                                          (4)
+
+// number of Mesh.border_router_forward() micropy command fields
+#define MESH_BR_ROUTE_FIELDS_NUM                                    (4)
+
 // max number of UDP sockets
 #define UDP_SOCKETS_MAX                                             (3)
 
@@ -129,6 +153,29 @@ typedef struct {
     uint16_t dest_port;
 } ot_rx_data_t;
 
+// stored in front of every packet in the RX pool
+typedef struct {
+    uint16_t len;
+    uint16_t src_port;
+    uint16_t dest_port;
+    otIp6Address src_ip;
+    otIp6Address dest_ip;
+} ot_rx_info_t;
+
+typedef struct {
+    uint16_t next;
+    uint8_t data[OT_RX_POOL_BLOCK_SIZE - sizeof(uint16_t)];
+} ot_rx_block_t;
+
+typedef struct {
+    ot_rx_block_t *blocks;
+    SemaphoreHandle_t mutex;
+    uint16_t count;                         // blocks in the pool
+    uint16_t free;                          // head of the free blocks list
+    uint16_t free_count;
+    uint32_t dropped;                       // packets that didn't fit in the pool
+} ot_rx_pool_t;
+
 typedef struct {
     uint8_t preamble[6];
     uint8_t payload_type;
@@ -146,6 +193,41 @@ typedef struct {
     int8_t preference;
 }border_router_info_t;
 
+// neighbor or router of the topology cache
+typedef struct {
+    otExtAddress ext;
+    uint16_t rloc16;
+    uint8_t info;                           // role of a neighbor, id of a router
+    int16_t link;                           // rssi of a neighbor, path cost of a router
+    uint32_t age;
+    uint32_t version;                       // topology version of the last change
+    bool used;                              // false: removed at version or never used
+}mesh_topo_entry_t;
+
+// topology snapshot kept by the Mesh task, versioned for the incremental reads
+typedef struct {
+    SemaphoreHandle_t mutex;
+    uint32_t version;
+    uint32_t full_since;                    // removals up to this version were forgotten
+    uint32_t refresh_time;                  // ms of the last refresh
+    volatile bool dirty;                    // set by the OpenThread state callback
+    mesh_topo_entry_t neighbors[MESH_NEIGBORS_MAX];
+    mesh_topo_entry_t routers[MESH_ROUTERS_MAX];
+    otExtAddress leader_ext;
+    uint32_t leader_part_id;
+    uint16_t leader_rloc16;
+    bool leader_valid;
+}mesh_topo_t;
+
+// UDP datagrams for a destination prefix forwarded by the Border Router to an upstream host
+typedef struct {
+    otIp6Prefix prefix;
+    struct sockaddr_in upstream;            // port 0 keeps the destination port of the datagram
+    uint32_t forwarded;
+    uint32_t errors;
+    bool used;
+}br_route_t;
+
 
 typedef struct {
     mod_network_socket_obj_t *s;            // pointer to the NIC socket
@@ -153,7 +235,8 @@ typedef struct {
     uint16_t port;                          // UDP port
     otIp6Address ip;                        // ipv6
     //char ip_str[MOD_USOCKET_IPV6_CHARS_MAX];// IPv6 in string
-    QueueHandle_t rx_queue;                 // queue for RX packages
+    uint16_t rx_head;                       // first block of the oldest packet received
+    uint16_t rx_tail;                       // last block of the newest packet received
 }pymesh_socket_t;
 
 /******************************************************************************
@@ -164,6 +247,12 @@ static otInstance *ot = NULL;
 static otIp6Prefix border_router_prefix;
 static mesh_obj_t mesh_obj;
 static pymesh_socket_t sockets[UDP_SOCKETS_MAX];
+static ot_rx_pool_t rx_pool;
+static br_route_t br_routes[MESH_BR_ROUTES_MAX];
+static SemaphoreHandle_t br_routes_mutex;
+static int br_fwd_socket = -1;
+static uint8_t br_fwd_buf[OT_RX_PACK_SIZE_MAX];
+static mesh_topo_t topo;
 
 /******************************************************************************
  DECLARE PUBLIC DATA
@@ -211,6 +300,28 @@ static int mesh_del_border_router(const char* ipv6_net_str);
 
 static pymesh_socket_t *find_socket(mod_network_socket_obj_t *nic_sock);
 
+static bool rx_pool_init(uint32_t budget);
+
+static void rx_pool_deinit(void);
+
+static bool rx_pool_put(pymesh_socket_t *sock, const ot_rx_data_t *rx_data);
+
+static int rx_pool_get(pymesh_socket_t *sock, ot_rx_info_t *info, uint8_t *buf, uint16_t len);
+
+static void rx_pool_flush(pymesh_socket_t *sock);
+
+static bool rx_pool_low(void);
+
+static bool br_forward(const ipv6_and_udp_header_t *header, otMessage *aMessage, uint16_t messageLength);
+
+static void br_forward_deinit(void);
+
+static void mesh_state_changed_cb(uint32_t aFlags, void *aContext);
+
+static void mesh_topo_reset(void);
+
+static void mesh_topo_update(void);
+
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
@@ -232,8 +343,9 @@ int mesh_socket_open(mod_network_socket_obj_t *s, int *_errno) {
 
     memset(&sock->udp_sock, 0, sizeof(otUdpSocket));
 
-    otEXPECT_ACTION(NULL != (sock->rx_queue = xQueueCreate(OT_DATA_QUEUE_SIZE_MAX, sizeof(ot_rx_data_t))),
-            *_errno = MP_ENOBUFS);
+    otEXPECT_ACTION(NULL != rx_pool.blocks, *_errno = MP_ENOBUFS);
+    sock->rx_head = OT_RX_POOL_BLOCK_NONE;
+    sock->rx_tail = OT_RX_POOL_BLOCK_NONE;
 
     // open socket
     otEXPECT_ACTION(
@@ -245,7 +357,6 @@ int mesh_socket_open(mod_network_socket_obj_t *s, int *_errno) {
 
     exit: if (*_errno != 0) {
         printf("err: %d", *_errno);
-        vQueueDelete(sock->rx_queue);
         sock->s = NULL;
         return -1;
     }
@@ -260,14 +371,14 @@ void mesh_socket_close(mod_network_socket_obj_t *s) {
         // destroy a specific socket
         pymesh_socket_t *sock = find_socket(s);
         otUdpClose(&sock->udp_sock);
-        vQueueDelete(sock->rx_queue);
+        rx_pool_flush(sock);
         memset(sock, 0, sizeof(pymesh_socket_t));
     } else {
         // destroy all sockets
         for (int i = 0 ; i < UDP_SOCKETS_MAX; i++) {
             if (sockets[i].s) {
                 otUdpClose(&sockets[i].udp_sock);
-                vQueueDelete(sockets[i].rx_queue);
+                rx_pool_flush(&sockets[i]);
                 memset(&sockets[i], 0, sizeof(pymesh_socket_t));
             }
         }
@@ -354,7 +465,8 @@ int mesh_socket_sendto(mod_network_socket_obj_t *s, const byte *buf, mp_uint_t l
 int mesh_socket_recvfrom(mod_network_socket_obj_t *s, byte *buf, mp_uint_t len, byte *ip, mp_uint_t *port,
         int *_errno) {
 
-    ot_rx_data_t rx_data;
+    ot_rx_info_t rx_info;
+    int ret;
 
     *_errno = 0;
 
@@ -362,17 +474,11 @@ int mesh_socket_recvfrom(mod_network_socket_obj_t *s, byte *buf, mp_uint_t len,
 
     otEXPECT_ACTION(NULL != (sock = find_socket(s)), *_errno = MP_ENOENT);
 
-    if (xQueueReceive(sock->rx_queue, &rx_data, 0)) {
-        // adjust the len
-        if (rx_data.len < len) {
-            len = rx_data.len;
-        }
-
-        memcpy(buf, rx_data.data, len);
-        otIp6ToString(rx_data.src_ip, (char*)ip, MOD_USOCKET_IPV6_CHARS_MAX);
-        *port = rx_data.src_port;
+    if ((ret = rx_pool_get(sock, &rx_info, buf, len)) >= 0) {
+        otIp6ToString(rx_info.src_ip, (char*)ip, MOD_USOCKET_IPV6_CHARS_MAX);
+        *port = rx_info.src_port;
 
-        return len;
+        return ret;
     }
     exit: if (*_errno != 0) {
         printf("err: %d", *_errno);
@@ -397,12 +503,19 @@ static void TASK_Mesh(void *pvParameters) {
         // CLI
         if (mesh_obj.ot_ready) {
 
+            // stop receiving frames while the RX pool can't take a full packet, the
+            // neighbours keep retrying them instead of us dropping the packets
+            otRadioSetRxHold(rx_pool_low());
+
             // Radio 802.15.4 TX/RX state-machine
             otRadioProcess(ot);
 
             // openThread Process
             otTaskletsProcess(ot);
 
+            // keep the topology cache in sync with the OpenThread tables
+            mesh_topo_update();
+
             if (mesh_obj.otCliBufferLen > 0) {
                 otCliConsoleInputLine(mesh_obj.otCliBuffer, mesh_obj.otCliBufferLen);
                 mesh_obj.otCliBufferLen = 0;
@@ -420,8 +533,6 @@ static void TASK_Mesh(void *pvParameters) {
  */
 static void modmesh_init(void) {
 
-    //xRxQueue = xQueueCreate(OT_DATA_QUEUE_SIZE_MAX, sizeof(ot_rx_data_t));
-
     ot_obj.handler = mp_const_none;
     ot_obj.handler_arg = mp_const_none;
     
@@ -466,6 +577,454 @@ STATIC void rx_interrupt_queue_handler(void *arg) {
         }
 }
 
+/*
+ * allocates the RX pool shared by all the sockets, budget is in bytes
+ */
+static bool rx_pool_init(uint32_t budget) {
+    if (rx_pool.mutex == NULL) {
+        rx_pool.mutex = xSemaphoreCreateMutex();
+    }
+    if (budget < OT_RX_POOL_BUDGET_MIN) {
+        budget = OT_RX_POOL_BUDGET_MIN;
+    }
+    rx_pool.count = MIN(budget / OT_RX_POOL_BLOCK_SIZE, OT_RX_POOL_BLOCK_NONE);
+    if (NULL == (rx_pool.blocks = malloc(rx_pool.count * sizeof(ot_rx_block_t)))) {
+        rx_pool.count = 0;
+        return false;
+    }
+    for (uint16_t i = 0; i < rx_pool.count; i++) {
+        rx_pool.blocks[i].next = (i + 1 < rx_pool.count) ? i + 1 : OT_RX_POOL_BLOCK_NONE;
+    }
+    rx_pool.free = 0;
+    rx_pool.free_count = rx_pool.count;
+    rx_pool.dropped = 0;
+    return true;
+}
+
+static void rx_pool_deinit(void) {
+    free(rx_pool.blocks);
+    rx_pool.blocks = NULL;
+    rx_pool.count = 0;
+    rx_pool.free = OT_RX_POOL_BLOCK_NONE;
+    rx_pool.free_count = 0;
+}
+
+static uint16_t rx_pool_blocks_needed(uint16_t len) {
+    uint32_t size = sizeof(ot_rx_info_t) + len;
+    return (size + sizeof(((ot_rx_block_t *)0)->data) - 1) / sizeof(((ot_rx_block_t *)0)->data);
+}
+
+// copies len bytes from/to the chain of blocks starting at *block, starting at *offset
+static void rx_pool_copy(uint16_t *block, uint16_t *offset, uint8_t *data, uint16_t len, bool write) {
+    while (len > 0) {
+        ot_rx_block_t *b = &rx_pool.blocks[*block];
+        if (*offset == sizeof(b->data)) {
+            // continue on the next block of the chain
+            *block = b->next;
+            *offset = 0;
+            continue;
+        }
+        uint16_t chunk = MIN(len, sizeof(b->data) - *offset);
+        if (write) {
+            memcpy(&b->data[*offset], data, chunk);
+        } else if (data) {
+            memcpy(data, &b->data[*offset], chunk);
+        }
+        if (data) {
+            data += chunk;
+        }
+        len -= chunk;
+        *offset += chunk;
+    }
+}
+
+/*
+ * appends a packet to the socket, the packet is dropped (and counted) if the pool is full
+ */
+static bool rx_pool_put(pymesh_socket_t *sock, const ot_rx_data_t *rx_data) {
+    ot_rx_info_t info;
+    uint16_t needed = rx_pool_blocks_needed(rx_data->len);
+
+    info.len = rx_data->len;
+    info.src_port = rx_data->src_port;
+    info.dest_port = rx_data->dest_port;
+    info.src_ip = rx_data->src_ip;
+    info.dest_ip = rx_data->dest_ip;
+
+    xSemaphoreTake(rx_pool.mutex, portMAX_DELAY);
+    if (rx_pool.blocks == NULL || rx_pool.free_count < needed) {
+        rx_pool.dropped++;
+        xSemaphoreGive(rx_pool.mutex);
+        return false;
+    }
+
+    // take the blocks from the free list
+    uint16_t first = rx_pool.free;
+    uint16_t last = first;
+    for (uint16_t i = 1; i < needed; i++) {
+        last = rx_pool.blocks[last].next;
+    }
+    rx_pool.free = rx_pool.blocks[last].next;
+    rx_pool.free_count -= needed;
+    rx_pool.blocks[last].next = OT_RX_POOL_BLOCK_NONE;
+
+    uint16_t block = first;
+    uint16_t offset = 0;
+    rx_pool_copy(&block, &offset, (uint8_t *)&info, sizeof(info), true);
+    rx_pool_copy(&block, &offset, (uint8_t *)rx_data->data, rx_data->len, true);
+
+    // link the packet to the end of the socket queue
+    if (sock->rx_tail != OT_RX_POOL_BLOCK_NONE) {
+        rx_pool.blocks[sock->rx_tail].next = first;
+    } else {
+        sock->rx_head = first;
+    }
+    sock->rx_tail = last;
+    xSemaphoreGive(rx_pool.mutex);
+    return true;
+}
+
+/*
+ * removes the oldest packet of the socket, copying up to len bytes of it to buf
+ * returns the number of bytes copied or -1 if there are no packets
+ */
+static int rx_pool_get(pymesh_socket_t *sock, ot_rx_info_t *info, uint8_t *buf, uint16_t len) {
+    xSemaphoreTake(rx_pool.mutex, portMAX_DELAY);
+    if (sock->rx_head == OT_RX_POOL_BLOCK_NONE) {
+        xSemaphoreGive(rx_pool.mutex);
+        return -1;
+    }
+
+    uint16_t first = sock->rx_head;
+    uint16_t block = first;
+    uint16_t offset = 0;
+    rx_pool_copy(&block, &offset, (uint8_t *)info, sizeof(*info), false);
+    len = MIN(len, info->len);
+    rx_pool_copy(&block, &offset, buf, len, false);
+    // skip the bytes that don't fit in the caller's buffer
+    rx_pool_copy(&block, &offset, NULL, info->len - len, false);
+
+    // block is now the last one of the packet, give the chain back to the free list
+    uint16_t needed = rx_pool_blocks_needed(info->len);
+    if (block == sock->rx_tail) {
+        sock->rx_head = OT_RX_POOL_BLOCK_NONE;
+        sock->rx_tail = OT_RX_POOL_BLOCK_NONE;
+    } else {
+        sock->rx_head = rx_pool.blocks[block].next;
+    }
+    rx_pool.blocks[block].next = rx_pool.free;
+    rx_pool.free = first;
+    rx_pool.free_count += needed;
+    xSemaphoreGive(rx_pool.mutex);
+    return len;
+}
+
+/*
+ * discards all the packets of the socket
+ */
+static void rx_pool_flush(pymesh_socket_t *sock) {
+    ot_rx_info_t info;
+    while (rx_pool_get(sock, &info, NULL, 0) >= 0);
+}
+
+/*
+ * sends the UDP payload to the upstream host of the longest route matching the destination
+ * returns false if no route matches
+ */
+static bool br_forward(const ipv6_and_udp_header_t *header, otMessage *aMessage, uint16_t messageLength) {
+    br_route_t *route = NULL;
+
+    if (br_fwd_socket < 0) {
+        return false;
+    }
+
+    xSemaphoreTake(br_routes_mutex, portMAX_DELAY);
+    for (int i = 0; i < MESH_BR_ROUTES_MAX; i++) {
+        if (br_routes[i].used
+                && otIp6PrefixMatch(&header->dest_ip6, &br_routes[i].prefix.mPrefix) >= br_routes[i].prefix.mLength
+                && (route == NULL || br_routes[i].prefix.mLength > route->prefix.mLength)) {
+            route = &br_routes[i];
+        }
+    }
+
+    if (route) {
+        struct sockaddr_in upstream = route->upstream;
+        uint16_t len = MIN(messageLength - sizeof(ipv6_and_udp_header_t), sizeof(br_fwd_buf));
+
+        if (upstream.sin_port == 0) {
+            upstream.sin_port = lwip_htons(header->dst_port);
+        }
+        otMessageRead(aMessage, sizeof(ipv6_and_udp_header_t), br_fwd_buf, len);
+        if (lwip_sendto_r(br_fwd_socket, br_fwd_buf, len, MSG_DONTWAIT, (struct sockaddr *)&upstream, sizeof(upstream)) == len) {
+            route->forwarded++;
+        } else {
+            route->errors++;
+        }
+    }
+    xSemaphoreGive(br_routes_mutex);
+
+    return route != NULL;
+}
+
+static void br_forward_deinit(void) {
+    if (br_routes_mutex) {
+        xSemaphoreTake(br_routes_mutex, portMAX_DELAY);
+    }
+    memset(br_routes, 0, sizeof(br_routes));
+    if (br_fwd_socket >= 0) {
+        lwip_close_r(br_fwd_socket);
+        br_fwd_socket = -1;
+    }
+    if (br_routes_mutex) {
+        xSemaphoreGive(br_routes_mutex);
+    }
+}
+
+/*
+ * adds (or replaces) a forwarding route, upstream_port 0 keeps the destination port
+ */
+static int mesh_add_br_route(const char* ipv6_net_str, const uint8_t *upstream_ip, uint16_t upstream_port) {
+    int error = 0;
+    otIp6Prefix prefix;
+    char net[MOD_USOCKET_IPV6_CHARS_MAX];
+    char *prefixLengthStr;
+    br_route_t *route = NULL;
+
+    memset(&prefix, 0, sizeof(prefix));
+    snprintf(net, sizeof(net), "%s", ipv6_net_str);
+
+    // ipv6 prefix example: "2001:dead:beef:cafe::/64"
+    otEXPECT_ACTION((prefixLengthStr = strchr(net, '/')) != NULL, error = MP_ENXIO);
+    *prefixLengthStr++ = '\0';
+    otEXPECT_ACTION(otIp6AddressFromString(net, &prefix.mPrefix) == OT_ERROR_NONE, error = MP_ENXIO);
+    prefix.mLength = (uint8_t)(strtol(prefixLengthStr, NULL, 0));
+
+    if (br_routes_mutex == NULL) {
+        br_routes_mutex = xSemaphoreCreateMutex();
+    }
+    if (br_fwd_socket < 0) {
+        otEXPECT_ACTION((br_fwd_socket = lwip_socket_r(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) >= 0, error = MP_ENOMEM);
+    }
+
+    xSemaphoreTake(br_routes_mutex, portMAX_DELAY);
+    for (int i = 0; i < MESH_BR_ROUTES_MAX; i++) {
+        if (br_routes[i].used && br_routes[i].prefix.mLength == prefix.mLength
+                && otIp6PrefixMatch(&br_routes[i].prefix.mPrefix, &prefix.mPrefix) >= prefix.mLength) {
+            // same prefix, replace its upstream
+            route = &br_routes[i];
+            break;
+        } else if (!br_routes[i].used && route == NULL) {
+            route = &br_routes[i];
+        }
+    }
+    if (route) {
+        memset(route, 0, sizeof(br_route_t));
+        route->prefix = prefix;
+        route->upstream.sin_family = AF_INET;
+        route->upstream.sin_port = lwip_htons(upstream_port);
+        memcpy(&route->upstream.sin_addr.s_addr, upstream_ip, sizeof(route->upstream.sin_addr.s_addr));
+        route->used = true;
+    } else {
+        error = MP_ENOMEM;
+    }
+    xSemaphoreGive(br_routes_mutex);
+
+exit:
+    return error;
+}
+
+/*
+ * removes the forwarding route of a prefix
+ */
+static int mesh_del_br_route(const char* ipv6_net_str) {
+    int error = MP_ENOENT;
+    otIp6Prefix prefix;
+    char net[MOD_USOCKET_IPV6_CHARS_MAX];
+    char *prefixLengthStr;
+
+    memset(&prefix, 0, sizeof(prefix));
+    snprintf(net, sizeof(net), "%s", ipv6_net_str);
+
+    otEXPECT_ACTION((prefixLengthStr = strchr(net, '/')) != NULL, error = MP_ENXIO);
+    *prefixLengthStr++ = '\0';
+    otEXPECT_ACTION(otIp6AddressFromString(net, &prefix.mPrefix) == OT_ERROR_NONE, error = MP_ENXIO);
+    prefix.mLength = (uint8_t)(strtol(prefixLengthStr, NULL, 0));
+    otEXPECT(br_routes_mutex != NULL);
+
+    xSemaphoreTake(br_routes_mutex, portMAX_DELAY);
+    for (int i = 0; i < MESH_BR_ROUTES_MAX; i++) {
+        if (br_routes[i].used && br_routes[i].prefix.mLength == prefix.mLength
+                && otIp6PrefixMatch(&br_routes[i].prefix.mPrefix, &prefix.mPrefix) >= prefix.mLength) {
+            br_routes[i].used = false;
+            error = 0;
+        }
+    }
+    xSemaphoreGive(br_routes_mutex);
+
+exit:
+    return error;
+}
+
+/*
+ * called by OpenThread (in the Mesh task) when its state has changed
+ */
+static void mesh_state_changed_cb(uint32_t aFlags, void *aContext) {
+    topo.dirty = true;
+}
+
+static void mesh_topo_reset(void) {
+    if (topo.mutex == NULL) {
+        topo.mutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(topo.mutex, portMAX_DELAY);
+    memset(topo.neighbors, 0, sizeof(topo.neighbors));
+    memset(topo.routers, 0, sizeof(topo.routers));
+    // keep counting, so a version read before a restart is never seen as up to date
+    topo.full_since = ++topo.version;
+    topo.leader_valid = false;
+    topo.dirty = true;
+    xSemaphoreGive(topo.mutex);
+}
+
+/*
+ * merges the fresh entries in the cache, link changes smaller than link_delta are ignored
+ * returns true if the cache has changed
+ */
+static bool mesh_topo_merge(mesh_topo_entry_t *cache, uint8_t cache_num,
+        const mesh_topo_entry_t *fresh, uint8_t fresh_num, int16_t link_delta, uint32_t version) {
+    bool seen[cache_num];
+    bool changed = false;
+
+    memset(seen, 0, sizeof(seen));
+    for (uint8_t i = 0; i < fresh_num; i++) {
+        mesh_topo_entry_t *entry = NULL;
+
+        for (uint8_t j = 0; j < cache_num; j++) {
+            if (cache[j].used && memcmp(&cache[j].ext, &fresh[i].ext, sizeof(otExtAddress)) == 0) {
+                entry = &cache[j];
+                break;
+            }
+        }
+
+        if (entry) {
+            if (entry->rloc16 != fresh[i].rloc16 || entry->info != fresh[i].info
+                    || abs(entry->link - fresh[i].link) >= link_delta) {
+                entry->rloc16 = fresh[i].rloc16;
+                entry->info = fresh[i].info;
+                entry->link = fresh[i].link;
+                entry->version = version;
+                changed = true;
+            }
+            // the age alone isn't a change of the topology
+            entry->age = fresh[i].age;
+        } else {
+            // back in the table, or take the slot removed the longest time ago
+            for (uint8_t j = 0; j < cache_num; j++) {
+                if (!cache[j].used && !seen[j]) {
+                    if (memcmp(&cache[j].ext, &fresh[i].ext, sizeof(otExtAddress)) == 0) {
+                        entry = &cache[j];
+                        break;
+                    } else if (entry == NULL || cache[j].version < entry->version) {
+                        entry = &cache[j];
+                    }
+                }
+            }
+            if (entry == NULL) {
+                continue;
+            }
+            if (memcmp(&entry->ext, &fresh[i].ext, sizeof(otExtAddress)) != 0 && entry->version > topo.full_since) {
+                // the removal of the previous entry can't be reported anymore
+                topo.full_since = entry->version;
+            }
+            *entry = fresh[i];
+            entry->version = version;
+            entry->used = true;
+            changed = true;
+        }
+        seen[entry - cache] = true;
+    }
+
+    for (uint8_t j = 0; j < cache_num; j++) {
+        if (cache[j].used && !seen[j]) {
+            cache[j].used = false;
+            cache[j].version = version;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/*
+ * refreshes the topology cache, after a state change or periodically for the link quality
+ */
+static void mesh_topo_update(void) {
+    otNeighborInfo neighbors[MESH_NEIGBORS_MAX];
+    otRouterInfo routers[MESH_ROUTERS_MAX];
+    mesh_topo_entry_t fresh[MAX(MESH_NEIGBORS_MAX, MESH_ROUTERS_MAX)];
+    otRouterInfo leaderRouterData;
+    otLeaderData leaderData;
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    bool changed;
+    bool leader_valid;
+    int num;
+
+    if (!topo.dirty && (now - topo.refresh_time) < MESH_TOPOLOGY_REFRESH_MS) {
+        return;
+    }
+    topo.dirty = false;
+    topo.refresh_time = now;
+
+    leader_valid = (mesh_leader_data(&leaderRouterData, &leaderData) > 0);
+
+    xSemaphoreTake(topo.mutex, portMAX_DELAY);
+
+    num = mesh_neighbors(MESH_NEIGBORS_MAX, neighbors);
+    memset(fresh, 0, sizeof(fresh));
+    for (int i = 0; i < num; i++) {
+        fresh[i].ext = neighbors[i].mExtAddress;
+        fresh[i].rloc16 = neighbors[i].mRloc16;
+        fresh[i].info = neighbors[i].mIsChild ? OT_DEVICE_ROLE_CHILD : OT_DEVICE_ROLE_ROUTER;
+        fresh[i].link = neighbors[i].mAverageRssi;
+        fresh[i].age = neighbors[i].mAge;
+    }
+    changed = mesh_topo_merge(topo.neighbors, MESH_NEIGBORS_MAX, fresh, num,
+            MESH_TOPOLOGY_RSSI_DELTA, topo.version + 1);
+
+    num = mesh_routers(MESH_ROUTERS_MAX, routers);
+    memset(fresh, 0, sizeof(fresh));
+    for (int i = 0; i < num; i++) {
+        fresh[i].ext = routers[i].mExtAddress;
+        fresh[i].rloc16 = routers[i].mRloc16;
+        fresh[i].info = routers[i].mRouterId;
+        fresh[i].link = routers[i].mPathCost;
+        fresh[i].age = routers[i].mAge;
+    }
+    changed |= mesh_topo_merge(topo.routers, MESH_ROUTERS_MAX, fresh, num, 1, topo.version + 1);
+
+    if (leader_valid != topo.leader_valid
+            || (leader_valid && (leaderData.mPartitionId != topo.leader_part_id
+                    || leaderRouterData.mRloc16 != topo.leader_rloc16
+                    || memcmp(&leaderRouterData.mExtAddress, &topo.leader_ext, sizeof(otExtAddress)) != 0))) {
+        topo.leader_valid = leader_valid;
+        topo.leader_part_id = leaderData.mPartitionId;
+        topo.leader_rloc16 = leaderRouterData.mRloc16;
+        topo.leader_ext = leaderRouterData.mExtAddress;
+        changed = true;
+    }
+
+    if (changed) {
+        topo.version++;
+    }
+    xSemaphoreGive(topo.mutex);
+}
+
+/*
+ * true when the RX pool can't take a packet of the maximum size anymore
+ */
+static bool rx_pool_low(void) {
+    return rx_pool.blocks != NULL && rx_pool.free_count < rx_pool_blocks_needed(OT_RX_PACK_SIZE_MAX);
+}
+
 // initialize Thread interface
 static otInstance* openthread_init(uint8_t key[]) {
     otError err;
@@ -478,6 +1037,10 @@ static otInstance* openthread_init(uint8_t key[]) {
     }
     otPlatAlarmInit(ot);
 
+    // refresh the topology cache on every role, child or partition change
+    mesh_topo_reset();
+    otSetStateChangedCallback(ot, mesh_state_changed_cb, NULL);
+
     // set master key
     otMasterKey masterkey;
     memcpy(masterkey.m8, key, OT_MASTER_KEY_SIZE);
@@ -518,6 +1081,8 @@ static void openthread_deinit(void) {
 
     mesh_obj.ot_ready = false;
     mesh_socket_close(NULL);
+    rx_pool_deinit();
+    br_forward_deinit();
 
     otInstanceFactoryReset(ot);
     otInstanceFinalize(ot);
@@ -817,15 +1382,8 @@ static void socket_udp_cb(void *aContext, otMessage *aMessage,
 //    otPlatLog(0, 0,"socket_udp_cb %dB p=%d %s", rx_data.len, rx_data.src_port, ip_str);
 //    otPlatLog(0, 0,"reg in queue, call handler");
 
-    // store packet received in queue, to be consumed by socket.recvfrom()
-    if (!xQueueSend(sock->rx_queue, (void *) &rx_data, 0)) {
-        // queue is full, so we should drop the oldest item, to add the new one
-        ot_rx_data_t rx_data_drop;
-        xQueueReceive(sock->rx_queue, &rx_data_drop, 0);
-
-        // try to store it again
-        xQueueSend(sock->rx_queue, (void *) &rx_data, 0);
-    }
+    // store packet received in the RX pool, to be consumed by socket.recvfrom()
+    rx_pool_put(sock, &rx_data);
 
 
     // callback to mpy if registered
@@ -930,6 +1488,12 @@ void br_ip6_rcv_cb(otMessage *aMessage, void *aContext){
     if (matching_bits < border_router_prefix.mLength)
         return;
 
+    // datagrams matching a forwarding route go straight to the upstream network
+    if (br_forward(&header, aMessage, messageLength)) {
+        otMessageFree(aMessage);
+        return;
+    }
+
     // the source IPv6 matches the BR prefix, so we should add data payload into the RX_queue
 
     // first, let's find the socket
@@ -965,16 +1529,8 @@ void br_ip6_rcv_cb(otMessage *aMessage, void *aContext){
 
     //otPlatLog(0, 0,"reg in queue, call handler %d", rx_data.src_port);
 
-    // store packet received in queue, to be consumed by socket.recvfrom()
-
-    if (!xQueueSend(sock->rx_queue, (void *) &rx_data, 0)) {
-        // queue is full, so we should drop the oldest item, to add the new one
-        ot_rx_data_t rx_data_drop;
-        xQueueReceive(sock->rx_queue, &rx_data_drop, 0);
-
-        // try to store it again
-        xQueueSend(sock->rx_queue, (void *) &rx_data, 0);
-    }
+    // store packet received in the RX pool, to be consumed by socket.recvfrom()
+    rx_pool_put(sock, &rx_data);
 
     // free message
     otMessageFree(aMessage);
@@ -1027,6 +1583,8 @@ void otConsoleCb(const char *aBuf, uint16_t aBufLength, void *aContext){
 STATIC const mp_arg_t mesh_init_args[] = {
     { MP_QSTR_id,                             MP_ARG_INT,   {.u_int  = 0} },
     { MP_QSTR_key,         MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj  = MP_OBJ_NULL} },
+    { MP_QSTR_aggregation, MP_ARG_KW_ONLY  | MP_ARG_BOOL,  {.u_bool = false} },
+    { MP_QSTR_rx_budget,   MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int  = OT_RX_POOL_BUDGET_DEFAULT} },
 };
 /*
  * start Lora Mesh openthread
@@ -1053,6 +1611,14 @@ STATIC mp_obj_t mesh_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_ui
             memcpy(master_key, bufinfo.buf, sizeof(master_key));
         }
 
+        // pack the frames to the same neighbour in a single LoRa packet
+        otRadioSetAggregation(args[2].u_bool);
+
+        // RX pool shared by all the Pymesh sockets
+        if (!rx_pool_init(args[3].u_int)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+        }
+
         modmesh_init();
         //printf("mesh task started\n");
         
@@ -1087,6 +1653,25 @@ STATIC mp_obj_t mesh_deinit_cmd (mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mesh_deinit_obj, mesh_deinit_cmd);
 
+/*
+ * returns the usage of the RX pool shared by the Pymesh sockets
+ */
+STATIC mp_obj_t mesh_rx_stats_cmd (mp_obj_t self_in) {
+    static const qstr rx_stats_fields[] = {
+        MP_QSTR_budget, MP_QSTR_free, MP_QSTR_dropped
+    };
+    mp_obj_t tuple[3];
+
+    xSemaphoreTake(rx_pool.mutex, portMAX_DELAY);
+    tuple[0] = mp_obj_new_int(rx_pool.count * OT_RX_POOL_BLOCK_SIZE);
+    tuple[1] = mp_obj_new_int(rx_pool.free_count * OT_RX_POOL_BLOCK_SIZE);
+    tuple[2] = mp_obj_new_int_from_uint(rx_pool.dropped);
+    xSemaphoreGive(rx_pool.mutex);
+
+    return mp_obj_new_attrtuple(rx_stats_fields, 3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mesh_rx_stats_obj, mesh_rx_stats_cmd);
+
 /*
  * returns state of Mesh mode (either disabled, detached, Child, Router, Leader)
  */
@@ -1305,6 +1890,108 @@ STATIC mp_obj_t mesh_leader (mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mesh_leader_obj, mesh_leader);
 
+static long long mesh_ext_to_mac(const otExtAddress *ext) {
+    long long mac = 0;
+
+    for (size_t j = 0; j < OT_EXT_ADDRESS_SIZE; j++)
+        mac = (mac << 8) + ext->m8[j];
+    return mac;
+}
+
+/*
+ * returns the topology cache changes since a version, or None if nothing has changed
+ */
+STATIC mp_obj_t mesh_topology (mp_uint_t n_args, const mp_obj_t *args) {
+    // Ex: (version=12, full=False, neighbors=[...], routers=[...], removed=[72623859790382856], leader=(...))
+    static const qstr mesh_topology_fields[MESH_TOPOLOGY_FIELDS_NUM] = {
+            MP_QSTR_version, MP_QSTR_full, MP_QSTR_neighbors, MP_QSTR_routers, MP_QSTR_removed, MP_QSTR_leader
+    };
+    static const qstr mesh_neighbors_fields[MESH_NEIGHBOR_FIELDS_NUM] = {
+            MP_QSTR_mac, MP_QSTR_role, MP_QSTR_rloc16, MP_QSTR_rssi, MP_QSTR_age
+    };
+    static const qstr mesh_routers_fields[MESH_ROUTERS_FIELDS_NUM] = {
+            MP_QSTR_mac, MP_QSTR_rloc16, MP_QSTR_id, MP_QSTR_path_cost, MP_QSTR_age
+    };
+    static const qstr mesh_leader_fields[MESH_LEADER_FIELDS_NUM] = {
+            MP_QSTR_part_id, MP_QSTR_mac, MP_QSTR_rloc16
+    };
+    static mesh_topo_t snapshot;
+    uint32_t since = 0;
+    mp_obj_t tuple[MESH_TOPOLOGY_FIELDS_NUM];
+    mp_obj_t entry_tuple[MAX(MESH_NEIGHBOR_FIELDS_NUM, MESH_ROUTERS_FIELDS_NUM)];
+    bool full;
+
+    if (n_args > 1) {
+        since = mp_obj_get_int_truncated(args[1]);
+    }
+
+    if (!mesh_obj.ot_ready || topo.mutex == NULL) {
+        return mp_const_none;
+    }
+
+    xSemaphoreTake(topo.mutex, portMAX_DELAY);
+    if (since == topo.version) {
+        // stable mesh, nothing to allocate
+        xSemaphoreGive(topo.mutex);
+        return mp_const_none;
+    }
+    memcpy(&snapshot, &topo, sizeof(snapshot));
+    xSemaphoreGive(topo.mutex);
+
+    full = (since < snapshot.full_since || since > snapshot.version);
+
+    mp_obj_t neighbors = mp_obj_new_list(0, NULL);
+    mp_obj_t routers = mp_obj_new_list(0, NULL);
+    mp_obj_t removed = mp_obj_new_list(0, NULL);
+
+    for (int i = 0; i < MESH_NEIGBORS_MAX; i++) {
+        mesh_topo_entry_t *e = &snapshot.neighbors[i];
+        if (e->used && (full || e->version > since)) {
+            entry_tuple[0] = mp_obj_new_int_from_ll(mesh_ext_to_mac(&e->ext));
+            entry_tuple[1] = mp_obj_new_int(e->info);
+            entry_tuple[2] = mp_obj_new_int_from_uint(e->rloc16);
+            entry_tuple[3] = mp_obj_new_int(e->link);
+            entry_tuple[4] = mp_obj_new_int_from_uint(e->age);
+            mp_obj_list_append(neighbors, mp_obj_new_attrtuple(mesh_neighbors_fields,
+                    MESH_NEIGHBOR_FIELDS_NUM, entry_tuple));
+        } else if (!e->used && !full && e->version > since) {
+            mp_obj_list_append(removed, mp_obj_new_int_from_ll(mesh_ext_to_mac(&e->ext)));
+        }
+    }
+
+    for (int i = 0; i < MESH_ROUTERS_MAX; i++) {
+        mesh_topo_entry_t *e = &snapshot.routers[i];
+        if (e->used && (full || e->version > since)) {
+            entry_tuple[0] = mp_obj_new_int_from_ll(mesh_ext_to_mac(&e->ext));
+            entry_tuple[1] = mp_obj_new_int_from_uint(e->rloc16);
+            entry_tuple[2] = mp_obj_new_int_from_uint(e->info);
+            entry_tuple[3] = mp_obj_new_int_from_uint(e->link);
+            entry_tuple[4] = mp_obj_new_int_from_uint(e->age);
+            mp_obj_list_append(routers, mp_obj_new_attrtuple(mesh_routers_fields,
+                    MESH_ROUTERS_FIELDS_NUM, entry_tuple));
+        } else if (!e->used && !full && e->version > since) {
+            mp_obj_list_append(removed, mp_obj_new_int_from_ll(mesh_ext_to_mac(&e->ext)));
+        }
+    }
+
+    tuple[0] = mp_obj_new_int_from_uint(snapshot.version);
+    tuple[1] = mp_obj_new_bool(full);
+    tuple[2] = neighbors;
+    tuple[3] = routers;
+    tuple[4] = removed;
+    tuple[5] = mp_const_none;
+    if (snapshot.leader_valid) {
+        mp_obj_t leader_tuple[MESH_LEADER_FIELDS_NUM];
+        leader_tuple[0] = mp_obj_new_int_from_uint(snapshot.leader_part_id);
+        leader_tuple[1] = mp_obj_new_int_from_ll(mesh_ext_to_mac(&snapshot.leader_ext));
+        leader_tuple[2] = mp_obj_new_int_from_uint(snapshot.leader_rloc16);
+        tuple[5] = mp_obj_new_attrtuple(mesh_leader_fields, MESH_LEADER_FIELDS_NUM, leader_tuple);
+    }
+
+    return mp_obj_new_attrtuple(mesh_topology_fields, MESH_TOPOLOGY_FIELDS_NUM, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mesh_topology_obj, 1, 2, mesh_topology);
+
 /*
  * register a callback(with argument) to be triggered when mesh interface receives data
  */
@@ -1375,6 +2062,68 @@ STATIC mp_obj_t mesh_border_router_del (mp_obj_t self_in, mp_obj_t br_prefixj) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mesh_border_router_del_obj, mesh_border_router_del);
 
+/*
+ * list, add or delete the native forwarding routes of the Border Router
+ */
+STATIC mp_obj_t mesh_border_router_forward (mp_uint_t n_args, const mp_obj_t *args) {
+
+    if (n_args == 1) {
+        // list the forwarding routes
+        static const qstr mesh_br_route_fields[MESH_BR_ROUTE_FIELDS_NUM] = {
+                MP_QSTR_net, MP_QSTR_upstream, MP_QSTR_forwarded, MP_QSTR_errors};
+
+        mp_obj_t route_list[MESH_BR_ROUTES_MAX];
+        mp_obj_t route_tuple[MESH_BR_ROUTE_FIELDS_NUM];
+        br_route_t routes[MESH_BR_ROUTES_MAX];
+        int route_num = 0;
+
+        if (br_routes_mutex) {
+            xSemaphoreTake(br_routes_mutex, portMAX_DELAY);
+            memcpy(routes, br_routes, sizeof(routes));
+            xSemaphoreGive(br_routes_mutex);
+        } else {
+            memset(routes, 0, sizeof(routes));
+        }
+
+        for (int i = 0; i < MESH_BR_ROUTES_MAX; i++) {
+            if (!routes[i].used) {
+                continue;
+            }
+            char net[MOD_USOCKET_IPV6_CHARS_MAX + 4];
+            otIp6ToString(routes[i].prefix.mPrefix, net, MOD_USOCKET_IPV6_CHARS_MAX);
+            snprintf(net + strlen(net), sizeof(net) - strlen(net), "/%d", routes[i].prefix.mLength);
+
+            route_tuple[0] = mp_obj_new_str(net, strlen(net));
+            route_tuple[1] = netutils_format_inet_addr((uint8_t *)&routes[i].upstream.sin_addr.s_addr,
+                    lwip_ntohs(routes[i].upstream.sin_port), NETUTILS_BIG);
+            route_tuple[2] = mp_obj_new_int_from_uint(routes[i].forwarded);
+            route_tuple[3] = mp_obj_new_int_from_uint(routes[i].errors);
+
+            route_list[route_num++] = mp_obj_new_attrtuple(mesh_br_route_fields,
+                    MESH_BR_ROUTE_FIELDS_NUM, route_tuple);
+        }
+        return mp_obj_new_list(route_num, route_list);
+    }
+
+    const char *ipv6_net_str = mp_obj_str_get_str(args[1]);
+    int error;
+
+    if (n_args == 2 || args[2] == mp_const_none) {
+        // delete the route
+        error = mesh_del_br_route(ipv6_net_str);
+    } else {
+        // add a route, by net address and upstream (ip, port) address
+        uint8_t ip[4];
+        mp_uint_t port = netutils_parse_inet_addr(args[2], ip, NETUTILS_BIG);
+        error = mesh_add_br_route(ipv6_net_str, ip, port);
+    }
+    if (error != 0) {
+        mp_raise_OSError(error);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mesh_border_router_forward_obj, 1, 3, mesh_border_router_forward);
+
 STATIC const mp_map_elem_t mesh_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_state),                   (mp_obj_t)&mesh_state_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_cli),                     (mp_obj_t)&mesh_cli_obj },
@@ -1384,9 +2133,12 @@ STATIC const mp_map_elem_t mesh_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_neighbors),               (mp_obj_t)&mesh_neighbors_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_routers),                 (mp_obj_t)&mesh_routers_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_leader),                  (mp_obj_t)&mesh_leader_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_topology),                (mp_obj_t)&mesh_topology_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_rx_cb),                   (mp_obj_t)&mesh_rx_cb_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rx_stats),                (mp_obj_t)&mesh_rx_stats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_border_router),           (mp_obj_t)&mesh_border_router_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_border_router_del),       (mp_obj_t)&mesh_border_router_del_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_border_router_forward),   (mp_obj_t)&mesh_border_router_forward_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),                  (mp_obj_t)&mesh_deinit_obj },
 };
 
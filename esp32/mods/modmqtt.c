@@ -0,0 +1,1035 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/obj.h"
+#include "py/objlist.h"
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "py/mpthread.h"
+
+#include "modmqtt.h"
+#include "modnetwork.h"
+#include "modusocket.h"
+#include "modussl.h"
+#include "lwipsocket.h"
+#include "mpexception.h"
+#include "mpirq.h"
+
+#include "lwip/sockets.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MODMQTT_MSG_CONNECT             (0x10)
+#define MODMQTT_MSG_CONNACK             (0x20)
+#define MODMQTT_MSG_PUBLISH             (0x30)
+#define MODMQTT_MSG_PUBACK              (0x40)
+#define MODMQTT_MSG_PUBREC              (0x50)
+#define MODMQTT_MSG_PUBREL              (0x60)
+#define MODMQTT_MSG_PUBCOMP             (0x70)
+#define MODMQTT_MSG_SUBSCRIBE           (0x80)
+#define MODMQTT_MSG_SUBACK              (0x90)
+#define MODMQTT_MSG_UNSUBSCRIBE         (0xA0)
+#define MODMQTT_MSG_UNSUBACK            (0xB0)
+#define MODMQTT_MSG_PINGREQ             (0xC0)
+#define MODMQTT_MSG_PINGRESP            (0xD0)
+#define MODMQTT_MSG_DISCONNECT          (0xE0)
+
+#define MODMQTT_FLAG_DUP                (0x08)
+#define MODMQTT_FLAG_RETAIN             (0x01)
+#define MODMQTT_FLAG_QOS1               (0x02)  // also required on SUBSCRIBE, UNSUBSCRIBE and PUBREL
+
+#define MODMQTT_STATE_DISCONNECTED      (0)
+#define MODMQTT_STATE_CONNECTING        (1)
+#define MODMQTT_STATE_CONNECTED         (2)
+
+#define MODMQTT_WINDOW_MAX              (16)
+#define MODMQTT_WINDOW_DEFAULT          (4)
+#define MODMQTT_KEEPALIVE_DEFAULT       (60)        // seconds
+#define MODMQTT_TIMEOUT_DEFAULT         (10)        // seconds, for the operations waiting for the broker
+#define MODMQTT_PING_TIMEOUT_MS         (10000)     // the connection is lost if the PINGRESP takes longer
+#define MODMQTT_IO_TIMEOUT_MS           (30000)     // longest wait for the socket to take or give more bytes
+#define MODMQTT_RX_MAX                  (8 * 1024)  // bigger packets are read but dropped
+#define MODMQTT_RX_QUEUE_LEN            (8)         // messages waiting for the callback
+#define MODMQTT_REMAINING_LEN_MAX       (268435455)
+#define MODMQTT_HEADER_LEN_MAX          (5 + 2)     // fixed header plus the 16 bit length of a topic
+#define MODMQTT_WAIT_SLICE_MS           (20)
+#define MODMQTT_TASK_STACK_SIZE         (6 * 1024)
+#define MODMQTT_TASK_PRIORITY           (6)
+#define MODMQTT_TASK_POLL_MS            (250)       // longest wait on the socket before checking the keepalive and a stop request
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+// a QoS 1 message waiting for its PUBACK, it's sent again with the DUP flag after a reconnection
+typedef struct {
+    mp_obj_t topic;
+    mp_obj_t payload;
+    uint16_t pid;                   // 0 if the slot is free
+    uint8_t flags;
+} modmqtt_inflight_t;
+
+// a PUBLISH read by the task, the packet body follows the header
+typedef struct {
+    uint16_t topic_len;
+    uint8_t qos;
+    bool retain;
+    uint32_t payload_offset;
+    uint32_t payload_len;
+    uint8_t data[];
+} modmqtt_rx_msg_t;
+
+typedef struct {
+    mp_obj_base_t base;
+    mp_obj_t client_id;
+    mp_obj_t user;
+    mp_obj_t password;
+    mp_obj_t sock;                  // MP_OBJ_NULL while disconnected
+    mp_obj_t msg_handler;
+    mp_obj_t lost_handler;
+    SemaphoreHandle_t io_mutex;     // one packet at a time on the socket, in both directions
+    SemaphoreHandle_t ack_sem;      // given by the task whenever the broker acknowledges something
+    QueueHandle_t rx_queue;
+    TaskHandle_t task;
+    uint64_t last_tx_ms;
+    uint64_t ping_ms;
+    volatile uint8_t state;
+    volatile bool stop;
+    volatile bool ping_pending;
+    volatile int16_t op_result;     // SUBACK return code or 0 for the UNSUBACK, -1 while waiting
+    volatile uint8_t connack;
+    uint16_t op_pid;                // packet id of the SUBSCRIBE or UNSUBSCRIBE being acknowledged
+    uint16_t next_pid;
+    uint16_t keepalive;
+    uint8_t window;
+    bool clean_session;
+    modmqtt_inflight_t inflight[MODMQTT_WINDOW_MAX];
+} modmqtt_obj_t;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC size_t modmqtt_encode_len(uint8_t *buf, uint32_t len);
+STATIC int modmqtt_send(modmqtt_obj_t *self, mp_buffer_info_t *bufs, size_t n_bufs);
+STATIC int modmqtt_send_locked(modmqtt_obj_t *self, mp_buffer_info_t *bufs, size_t n_bufs);
+STATIC int modmqtt_send_ack(modmqtt_obj_t *self, uint8_t type, uint16_t pid);
+STATIC int modmqtt_recv(modmqtt_obj_t *self, uint8_t *buf, size_t len);
+STATIC bool modmqtt_readable(modmqtt_obj_t *self, uint32_t wait_ms);
+STATIC int modmqtt_read_packet(modmqtt_obj_t *self, uint8_t *type, uint8_t **body, uint32_t *len);
+STATIC void modmqtt_handle_packet(modmqtt_obj_t *self, uint8_t type, uint8_t *body, uint32_t len);
+STATIC void modmqtt_handle_publish(modmqtt_obj_t *self, uint8_t type, uint8_t *body, uint32_t len);
+STATIC void modmqtt_deliver(void *arg);
+STATIC void modmqtt_lost(void *arg);
+STATIC void modmqtt_drop_rx(modmqtt_obj_t *self);
+STATIC void modmqtt_stop_task(modmqtt_obj_t *self);
+STATIC bool modmqtt_is_active(modmqtt_obj_t *self);
+STATIC void modmqtt_release(modmqtt_obj_t *self);
+STATIC uint16_t modmqtt_new_pid(modmqtt_obj_t *self);
+STATIC uint32_t modmqtt_timeout_ms(mp_obj_t timeout);
+STATIC bool modmqtt_wait_ack(uint32_t *remaining_ms, modmqtt_obj_t *self);
+STATIC int modmqtt_publish_slot(modmqtt_obj_t *self, modmqtt_inflight_t *slot, mp_obj_t topic, mp_obj_t payload, uint8_t flags, uint16_t pid);
+STATIC void TASK_MQTT(void *pvParameters);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void modmqtt_init0(void) {
+    mp_obj_list_init(&MP_STATE_PORT(mqtt_client_list), 0);
+}
+
+void modmqtt_deinit0(void) {
+    // the clients live in the heap which is about to go away, their tasks must be gone before
+    for (mp_uint_t i = 0; i < MP_STATE_PORT(mqtt_client_list).len; i++) {
+        modmqtt_obj_t *self = (modmqtt_obj_t *)MP_STATE_PORT(mqtt_client_list).items[i];
+        modmqtt_stop_task(self);
+        modmqtt_drop_rx(self);
+    }
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC size_t modmqtt_encode_len(uint8_t *buf, uint32_t len) {
+    size_t n = 0;
+    do {
+        buf[n] = len & 0x7F;
+        len >>= 7;
+        if (len > 0) {
+            buf[n] |= 0x80;
+        }
+        n++;
+    } while (len > 0);
+    return n;
+}
+
+// write the fragments as one packet, the caller holds io_mutex
+STATIC int modmqtt_send_locked(modmqtt_obj_t *self, mp_buffer_info_t *bufs, size_t n_bufs) {
+    mod_network_socket_obj_t *s = (mod_network_socket_obj_t *)self->sock;
+    uint64_t start = mp_hal_ticks_ms_non_blocking();
+    size_t first = 0;
+
+    while (first < n_bufs) {
+        int _errno = 0;
+        // lwIP chains the fragments into the same segment, the payload isn't copied
+        int ret = lwipsocket_socket_sendmsg(s, &bufs[first], n_bufs - first, NULL, 0, &_errno);
+        if (ret < 0) {
+            if (_errno != MP_EAGAIN) {
+                return _errno;
+            }
+            ret = 0;
+        }
+        // skip what went out, the last fragment may have been sent only in part
+        while ((first < n_bufs) && ((size_t)ret >= bufs[first].len)) {
+            ret -= bufs[first].len;
+            first++;
+        }
+        if (first < n_bufs) {
+            bufs[first].buf = (uint8_t *)bufs[first].buf + ret;
+            bufs[first].len -= ret;
+            if ((mp_hal_ticks_ms_non_blocking() - start) > MODMQTT_IO_TIMEOUT_MS) {
+                return MP_ETIMEDOUT;
+            }
+            vTaskDelay(1);
+        }
+    }
+    self->last_tx_ms = mp_hal_ticks_ms_non_blocking();
+    return 0;
+}
+
+STATIC int modmqtt_send(modmqtt_obj_t *self, mp_buffer_info_t *bufs, size_t n_bufs) {
+    xSemaphoreTake(self->io_mutex, portMAX_DELAY);
+    int ret = modmqtt_send_locked(self, bufs, n_bufs);
+    xSemaphoreGive(self->io_mutex);
+    return ret;
+}
+
+STATIC int modmqtt_send_ack(modmqtt_obj_t *self, uint8_t type, uint16_t pid) {
+    uint8_t pkt[4] = { type, 2, pid >> 8, pid & 0xFF };
+    mp_buffer_info_t buf = { .buf = pkt, .len = sizeof(pkt) };
+    return modmqtt_send(self, &buf, 1);
+}
+
+// read exactly len bytes, the caller holds io_mutex
+STATIC int modmqtt_recv(modmqtt_obj_t *self, uint8_t *buf, size_t len) {
+    mod_network_socket_obj_t *s = (mod_network_socket_obj_t *)self->sock;
+    uint64_t start = mp_hal_ticks_ms_non_blocking();
+
+    while (len > 0) {
+        int _errno = 0;
+        int ret = lwipsocket_socket_recv(s, buf, len, &_errno);
+        if (ret == 0) {
+            // closed by the broker
+            return MP_ECONNRESET;
+        } else if (ret < 0) {
+            if ((_errno != MP_EAGAIN) && (_errno != MBEDTLS_ERR_SSL_TIMEOUT)) {
+                return _errno;
+            }
+            if ((mp_hal_ticks_ms_non_blocking() - start) > MODMQTT_IO_TIMEOUT_MS) {
+                return MP_ETIMEDOUT;
+            }
+            modmqtt_readable(self, MODMQTT_WAIT_SLICE_MS);
+        } else {
+            buf += ret;
+            len -= ret;
+        }
+    }
+    return 0;
+}
+
+STATIC bool modmqtt_readable(modmqtt_obj_t *self, uint32_t wait_ms) {
+    mod_network_socket_obj_t *s = (mod_network_socket_obj_t *)self->sock;
+
+    // mbedtls may hold the rest of a record already read from the socket
+    if (s->sock_base.is_ssl && (mbedtls_ssl_get_bytes_avail(&((mp_obj_ssl_socket_t *)s)->ssl) > 0)) {
+        return true;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(s->sock_base.u.sd, &rfds);
+    struct timeval tv = { .tv_sec = wait_ms / 1000, .tv_usec = (wait_ms % 1000) * 1000 };
+    return lwip_select(s->sock_base.u.sd + 1, &rfds, NULL, NULL, &tv) > 0;
+}
+
+// the body is malloc'ed with room for a modmqtt_rx_msg_t in front, NULL if it was too big to be kept
+STATIC int modmqtt_read_packet(modmqtt_obj_t *self, uint8_t *type, uint8_t **body, uint32_t *len) {
+    uint8_t b;
+    int ret;
+
+    *body = NULL;
+    if ((ret = modmqtt_recv(self, type, 1)) != 0) {
+        return ret;
+    }
+
+    *len = 0;
+    for (uint32_t shift = 0; ; shift += 7) {
+        if (shift > 21) {
+            return MP_EIO;
+        }
+        if ((ret = modmqtt_recv(self, &b, 1)) != 0) {
+            return ret;
+        }
+        *len |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+
+    if (*len <= MODMQTT_RX_MAX) {
+        uint8_t *msg = malloc(sizeof(modmqtt_rx_msg_t) + *len);
+        if (msg != NULL) {
+            if ((ret = modmqtt_recv(self, msg + sizeof(modmqtt_rx_msg_t), *len)) != 0) {
+                free(msg);
+                return ret;
+            }
+            *body = msg;
+            return 0;
+        }
+    }
+
+    // no room for it, drain it from the socket
+    uint8_t chunk[64];
+    for (uint32_t left = *len; left > 0; ) {
+        uint32_t n = MIN(left, sizeof(chunk));
+        if ((ret = modmqtt_recv(self, chunk, n)) != 0) {
+            return ret;
+        }
+        left -= n;
+    }
+    return 0;
+}
+
+STATIC void modmqtt_handle_packet(modmqtt_obj_t *self, uint8_t type, uint8_t *body, uint32_t len) {
+    uint8_t *p = (body != NULL) ? body + sizeof(modmqtt_rx_msg_t) : NULL;
+    uint16_t pid = ((p != NULL) && (len >= 2)) ? ((p[0] << 8) | p[1]) : 0;
+
+    switch (type & 0xF0) {
+    case MODMQTT_MSG_CONNACK:
+        if ((p != NULL) && (len == 2) && (self->state == MODMQTT_STATE_CONNECTING)) {
+            self->connack = p[1];
+            if (p[1] == 0) {
+                self->state = MODMQTT_STATE_CONNECTED;
+            } else {
+                // refused, connect() reports it
+                self->stop = true;
+            }
+            xSemaphoreGive(self->ack_sem);
+        }
+        break;
+    case MODMQTT_MSG_PUBACK:
+        for (int i = 0; i < MODMQTT_WINDOW_MAX; i++) {
+            if ((pid != 0) && (self->inflight[i].pid == pid)) {
+                self->inflight[i].topic = MP_OBJ_NULL;
+                self->inflight[i].payload = MP_OBJ_NULL;
+                self->inflight[i].pid = 0;
+                xSemaphoreGive(self->ack_sem);
+                break;
+            }
+        }
+        break;
+    case MODMQTT_MSG_PUBREL:
+        // only sent by a broker delivering at QoS 2, which we never ask for
+        modmqtt_send_ack(self, MODMQTT_MSG_PUBCOMP, pid);
+        break;
+    case MODMQTT_MSG_SUBACK:
+        if ((pid != 0) && (pid == self->op_pid) && (len >= 3)) {
+            self->op_result = p[2];
+            xSemaphoreGive(self->ack_sem);
+        }
+        break;
+    case MODMQTT_MSG_UNSUBACK:
+        if ((pid != 0) && (pid == self->op_pid)) {
+            self->op_result = 0;
+            xSemaphoreGive(self->ack_sem);
+        }
+        break;
+    case MODMQTT_MSG_PINGRESP:
+        self->ping_pending = false;
+        break;
+    case MODMQTT_MSG_PUBLISH:
+        modmqtt_handle_publish(self, type, body, len);
+        // the message owns the body now
+        return;
+    default:
+        break;
+    }
+    free(body);
+}
+
+STATIC void modmqtt_handle_publish(modmqtt_obj_t *self, uint8_t type, uint8_t *body, uint32_t len) {
+    uint8_t qos = (type >> 1) & 0x03;
+    uint32_t header_len = 2 + ((qos > 0) ? 2 : 0);
+
+    if (body == NULL) {
+        // too big to be kept, it's still acknowledged not to be sent again
+        return;
+    }
+
+    modmqtt_rx_msg_t *msg = (modmqtt_rx_msg_t *)body;
+    if (len < header_len) {
+        free(body);
+        return;
+    }
+    msg->topic_len = (msg->data[0] << 8) | msg->data[1];
+    if ((uint32_t)msg->topic_len + header_len > len) {
+        free(body);
+        return;
+    }
+    msg->qos = qos;
+    msg->retain = type & MODMQTT_FLAG_RETAIN;
+    msg->payload_offset = msg->topic_len + header_len;
+    msg->payload_len = len - msg->payload_offset;
+
+    if (qos > 0) {
+        uint16_t pid = (msg->data[msg->topic_len + 2] << 8) | msg->data[msg->topic_len + 3];
+        // a QoS 2 message is taken as an "at least once" one, the PUBREL is answered when it comes
+        modmqtt_send_ack(self, (qos == 1) ? MODMQTT_MSG_PUBACK : MODMQTT_MSG_PUBREC, pid);
+    }
+
+    // wait for the callback to make room, the broker is held back by TCP meanwhile
+    while (xQueueSend(self->rx_queue, &msg, MODMQTT_TASK_POLL_MS / portTICK_PERIOD_MS) != pdTRUE) {
+        if (self->stop) {
+            free(body);
+            return;
+        }
+    }
+    mp_irq_queue_interrupt_non_ISR(modmqtt_deliver, self);
+}
+
+// called in the context of the interpreter, any of the calls may find the queue empty already
+STATIC void modmqtt_deliver(void *arg) {
+    modmqtt_obj_t *self = arg;
+    modmqtt_rx_msg_t *msg;
+
+    if (!modmqtt_is_active(self)) {
+        return;
+    }
+
+    while (xQueueReceive(self->rx_queue, &msg, 0) == pdTRUE) {
+        if (self->msg_handler != mp_const_none) {
+            nlr_buf_t nlr;
+            if (nlr_push(&nlr) == 0) {
+                mp_obj_t topic = mp_obj_new_bytes(&msg->data[2], msg->topic_len);
+                mp_obj_t payload = mp_obj_new_bytes(&msg->data[msg->payload_offset], msg->payload_len);
+                mp_call_function_2(self->msg_handler, topic, payload);
+                nlr_pop();
+            } else {
+                // keep going with the next messages, they own malloc'ed memory
+                mp_printf(&mp_plat_print, "Unhandled exception in MQTT callback\n");
+                mp_obj_print_exception(&mp_plat_print, (mp_obj_t)nlr.ret_val);
+            }
+        }
+        free(msg);
+    }
+}
+
+// called in the context of the interpreter once the task of a client that lost its connection is gone
+STATIC void modmqtt_lost(void *arg) {
+    modmqtt_obj_t *self = arg;
+
+    if (!modmqtt_is_active(self) || (self->task != NULL) || (self->state != MODMQTT_STATE_DISCONNECTED)) {
+        // connect() or disconnect() were called meanwhile
+        return;
+    }
+    modmqtt_deliver(self);
+    mp_obj_t handler = self->lost_handler;
+    modmqtt_release(self);
+    if (handler != mp_const_none) {
+        mp_call_function_1(handler, self);
+    }
+}
+
+STATIC void modmqtt_drop_rx(modmqtt_obj_t *self) {
+    modmqtt_rx_msg_t *msg;
+    while (xQueueReceive(self->rx_queue, &msg, 0) == pdTRUE) {
+        free(msg);
+    }
+}
+
+STATIC void modmqtt_stop_task(modmqtt_obj_t *self) {
+    self->stop = true;
+    while (self->task != NULL) {
+        vTaskDelay(MODMQTT_WAIT_SLICE_MS / portTICK_PERIOD_MS);
+    }
+}
+
+STATIC bool modmqtt_is_active(modmqtt_obj_t *self) {
+    mp_obj_list_t *list = &MP_STATE_PORT(mqtt_client_list);
+    for (mp_uint_t i = 0; i < list->len; i++) {
+        if (list->items[i] == self) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the task must be gone already
+STATIC void modmqtt_release(modmqtt_obj_t *self) {
+    self->state = MODMQTT_STATE_DISCONNECTED;
+    self->sock = MP_OBJ_NULL;
+    modmqtt_drop_rx(self);
+    mp_obj_list_remove(&MP_STATE_PORT(mqtt_client_list), self);
+}
+
+STATIC uint16_t modmqtt_new_pid(modmqtt_obj_t *self) {
+    for (;;) {
+        uint16_t pid = ++self->next_pid;
+        if (pid == 0) {
+            continue;
+        }
+        bool used = (pid == self->op_pid);
+        for (int i = 0; (i < MODMQTT_WINDOW_MAX) && !used; i++) {
+            used = (self->inflight[i].pid == pid);
+        }
+        if (!used) {
+            return pid;
+        }
+    }
+}
+
+STATIC uint32_t modmqtt_timeout_ms(mp_obj_t timeout) {
+    if (timeout == mp_const_none) {
+        return portMAX_DELAY;
+    }
+    mp_float_t t = mp_obj_get_float(timeout);
+    if (t < 0) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
+    }
+    return (uint32_t)(t * 1000);
+}
+
+// wait for the task to get an acknowledgement without the GIL, false once the time is up
+STATIC bool modmqtt_wait_ack(uint32_t *remaining_ms, modmqtt_obj_t *self) {
+    if (*remaining_ms == 0) {
+        return false;
+    }
+    uint32_t slice = MIN(*remaining_ms, MODMQTT_WAIT_SLICE_MS);
+    MP_THREAD_GIL_EXIT();
+    // other threads waiting may take the semaphore first, everybody checks again after a slice
+    xSemaphoreTake(self->ack_sem, slice / portTICK_PERIOD_MS);
+    MP_THREAD_GIL_ENTER();
+    if (*remaining_ms != portMAX_DELAY) {
+        *remaining_ms -= slice;
+    }
+    return true;
+}
+
+STATIC int modmqtt_publish_slot(modmqtt_obj_t *self, modmqtt_inflight_t *slot, mp_obj_t topic, mp_obj_t payload, uint8_t flags, uint16_t pid) {
+    mp_buffer_info_t topic_buf, payload_buf;
+    uint8_t hdr[MODMQTT_HEADER_LEN_MAX];
+    uint8_t pid_buf[2] = { pid >> 8, pid & 0xFF };
+    bool qos = (flags & MODMQTT_FLAG_QOS1) != 0;
+
+    mp_get_buffer_raise(topic, &topic_buf, MP_BUFFER_READ);
+    mp_get_buffer_raise(payload, &payload_buf, MP_BUFFER_READ);
+    if ((topic_buf.len == 0) || (topic_buf.len > UINT16_MAX) ||
+        ((2 + topic_buf.len + (qos ? 2 : 0) + payload_buf.len) > MODMQTT_REMAINING_LEN_MAX)) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
+    }
+
+    size_t n = 0;
+    hdr[n++] = MODMQTT_MSG_PUBLISH | flags;
+    n += modmqtt_encode_len(&hdr[n], 2 + topic_buf.len + (qos ? 2 : 0) + payload_buf.len);
+    hdr[n++] = topic_buf.len >> 8;
+    hdr[n++] = topic_buf.len & 0xFF;
+
+    // the payload goes to the stack straight from the caller's buffer
+    mp_buffer_info_t bufs[4] = {
+        { .buf = hdr, .len = n },
+        { .buf = topic_buf.buf, .len = topic_buf.len },
+        { .buf = pid_buf, .len = qos ? sizeof(pid_buf) : 0 },
+        { .buf = payload_buf.buf, .len = payload_buf.len },
+    };
+
+    if (slot != NULL) {
+        slot->topic = topic;
+        slot->payload = payload;
+        slot->flags = flags & ~MODMQTT_FLAG_DUP;
+        slot->pid = pid;
+    }
+
+    MP_THREAD_GIL_EXIT();
+    int ret = modmqtt_send(self, bufs, MP_ARRAY_SIZE(bufs));
+    MP_THREAD_GIL_ENTER();
+    return ret;
+}
+
+STATIC void TASK_MQTT(void *pvParameters) {
+    modmqtt_obj_t *self = pvParameters;
+    bool lost = false;
+
+    while (!self->stop) {
+        uint32_t wait_ms = MODMQTT_TASK_POLL_MS;
+        uint64_t now = mp_hal_ticks_ms_non_blocking();
+
+        if ((self->state == MODMQTT_STATE_CONNECTED) && (self->keepalive > 0)) {
+            if (self->ping_pending) {
+                if ((now - self->ping_ms) > MIN(MODMQTT_PING_TIMEOUT_MS, self->keepalive * 1000)) {
+                    lost = true;
+                    break;
+                }
+            } else if ((now - self->last_tx_ms) >= (self->keepalive * 1000)) {
+                uint8_t pkt[2] = { MODMQTT_MSG_PINGREQ, 0 };
+                mp_buffer_info_t buf = { .buf = pkt, .len = sizeof(pkt) };
+                self->ping_pending = true;
+                self->ping_ms = now;
+                if (modmqtt_send(self, &buf, 1) != 0) {
+                    lost = true;
+                    break;
+                }
+            } else {
+                wait_ms = MIN(wait_ms, (uint32_t)((self->keepalive * 1000) - (now - self->last_tx_ms)));
+            }
+        }
+
+        if (!modmqtt_readable(self, wait_ms)) {
+            continue;
+        }
+
+        uint8_t type;
+        uint8_t *body;
+        uint32_t len;
+        xSemaphoreTake(self->io_mutex, portMAX_DELAY);
+        int ret = modmqtt_read_packet(self, &type, &body, &len);
+        xSemaphoreGive(self->io_mutex);
+        if (ret != 0) {
+            lost = true;
+            break;
+        }
+        modmqtt_handle_packet(self, type, body, len);
+    }
+
+    bool was_connected = (self->state == MODMQTT_STATE_CONNECTED);
+    self->state = MODMQTT_STATE_DISCONNECTED;
+    // wake up whoever waits for an acknowledgement
+    xSemaphoreGive(self->ack_sem);
+    self->task = NULL;
+    if (lost && was_connected) {
+        mp_irq_queue_interrupt_non_ISR(modmqtt_lost, self);
+    }
+    vTaskDelete(NULL);
+}
+
+/******************************************************************************/
+// Micro Python bindings; MQTT class
+
+STATIC const mp_arg_t modmqtt_make_new_args[] = {
+    { MP_QSTR_client_id,        MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_keepalive,        MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = MODMQTT_KEEPALIVE_DEFAULT} },
+    { MP_QSTR_clean_session,    MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} },
+    { MP_QSTR_user,             MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_password,         MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_window,           MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = MODMQTT_WINDOW_DEFAULT} },
+};
+STATIC mp_obj_t modmqtt_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    mp_arg_val_t args[MP_ARRAY_SIZE(modmqtt_make_new_args)];
+    mp_arg_parse_all(n_args, all_args, &kw_args, MP_ARRAY_SIZE(args), modmqtt_make_new_args, args);
+
+    if ((args[1].u_int < 0) || (args[1].u_int > UINT16_MAX) ||
+        (args[5].u_int < 1) || (args[5].u_int > MODMQTT_WINDOW_MAX)) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
+    }
+
+    modmqtt_obj_t *self = m_new_obj_with_finaliser(modmqtt_obj_t);
+    memset(self, 0, sizeof(*self));
+    self->base.type = type;
+    self->client_id = args[0].u_obj;
+    self->keepalive = args[1].u_int;
+    self->clean_session = args[2].u_bool;
+    self->user = args[3].u_obj;
+    self->password = args[4].u_obj;
+    self->window = args[5].u_int;
+    self->sock = MP_OBJ_NULL;
+    self->msg_handler = mp_const_none;
+    self->lost_handler = mp_const_none;
+    self->state = MODMQTT_STATE_DISCONNECTED;
+    self->io_mutex = xSemaphoreCreateMutex();
+    self->ack_sem = xSemaphoreCreateBinary();
+    self->rx_queue = xQueueCreate(MODMQTT_RX_QUEUE_LEN, sizeof(modmqtt_rx_msg_t *));
+    if ((self->io_mutex == NULL) || (self->ack_sem == NULL) || (self->rx_queue == NULL)) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    // check the strings now rather than in connect()
+    mp_obj_str_get_str(self->client_id);
+    if (self->user != mp_const_none) {
+        mp_obj_str_get_str(self->user);
+    }
+    if (self->password != mp_const_none) {
+        mp_obj_str_get_str(self->password);
+    }
+    return self;
+}
+
+STATIC const mp_arg_t modmqtt_connect_args[] = {
+    { MP_QSTR_self,     MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_sock,     MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_timeout,  MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_SMALL_INT(MODMQTT_TIMEOUT_DEFAULT)} },
+};
+STATIC mp_obj_t modmqtt_connect(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(modmqtt_connect_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), modmqtt_connect_args, args);
+    modmqtt_obj_t *self = args[0].u_obj;
+    uint32_t timeout_ms = modmqtt_timeout_ms(args[2].u_obj);
+
+    if (self->task != NULL) {
+        mp_raise_OSError(MP_EISCONN);
+    }
+    // the socket must be a connected TCP one, optionally wrapped by ussl
+    mp_obj_type_t *sock_type = mp_obj_get_type(args[1].u_obj);
+    if ((sock_type != &socket_type) && (sock_type != &ssl_socket_type)) {
+        mp_raise_TypeError(mpexception_value_invalid_arguments);
+    }
+
+    mp_buffer_info_t id, user = { .len = 0 }, password = { .len = 0 };
+    mp_get_buffer_raise(self->client_id, &id, MP_BUFFER_READ);
+    if (self->user != mp_const_none) {
+        mp_get_buffer_raise(self->user, &user, MP_BUFFER_READ);
+    }
+    if (self->password != mp_const_none) {
+        mp_get_buffer_raise(self->password, &password, MP_BUFFER_READ);
+    }
+
+    // variable header: protocol name, level 4 (3.1.1), flags and keepalive
+    uint8_t hdr[5 + 10];
+    uint8_t flags = (self->clean_session ? 0x02 : 0) |
+                    ((self->user != mp_const_none) ? 0x80 : 0) |
+                    ((self->password != mp_const_none) ? 0x40 : 0);
+    uint32_t rem = 10 + 2 + id.len +
+                   ((self->user != mp_const_none) ? (2 + user.len) : 0) +
+                   ((self->password != mp_const_none) ? (2 + password.len) : 0);
+    size_t n = 0;
+    hdr[n++] = MODMQTT_MSG_CONNECT;
+    n += modmqtt_encode_len(&hdr[n], rem);
+    memcpy(&hdr[n], "\x00\x04MQTT\x04", 7);
+    n += 7;
+    hdr[n++] = flags;
+    hdr[n++] = self->keepalive >> 8;
+    hdr[n++] = self->keepalive & 0xFF;
+    uint8_t id_len[2] = { id.len >> 8, id.len & 0xFF };
+    uint8_t user_len[2] = { user.len >> 8, user.len & 0xFF };
+    uint8_t password_len[2] = { password.len >> 8, password.len & 0xFF };
+    mp_buffer_info_t bufs[7] = {
+        { .buf = hdr, .len = n },
+        { .buf = id_len, .len = 2 },
+        { .buf = id.buf, .len = id.len },
+        { .buf = user_len, .len = (self->user != mp_const_none) ? 2 : 0 },
+        { .buf = user.buf, .len = user.len },
+        { .buf = password_len, .len = (self->password != mp_const_none) ? 2 : 0 },
+        { .buf = password.buf, .len = password.len },
+    };
+
+    // the task and the callbacks use the client until disconnect(), keep it out of the GC's reach
+    if (!modmqtt_is_active(self)) {
+        mp_obj_list_append(&MP_STATE_PORT(mqtt_client_list), self);
+    }
+    self->sock = args[1].u_obj;
+    self->stop = false;
+    self->ping_pending = false;
+    self->connack = 0;
+    self->op_pid = 0;
+    self->state = MODMQTT_STATE_CONNECTING;
+    modmqtt_drop_rx(self);
+    xSemaphoreTake(self->ack_sem, 0);
+    if (self->clean_session) {
+        memset(self->inflight, 0, sizeof(self->inflight));
+    }
+
+    MP_THREAD_GIL_EXIT();
+    int ret = modmqtt_send(self, bufs, MP_ARRAY_SIZE(bufs));
+    MP_THREAD_GIL_ENTER();
+    if (ret != 0) {
+        modmqtt_release(self);
+        mp_raise_OSError(ret);
+    }
+
+    if (xTaskCreatePinnedToCore(TASK_MQTT, "MQTT", MODMQTT_TASK_STACK_SIZE / sizeof(StackType_t), self,
+                                MODMQTT_TASK_PRIORITY, &self->task, 1) != pdPASS) {
+        self->task = NULL;
+        modmqtt_release(self);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+
+    while ((self->state == MODMQTT_STATE_CONNECTING) && !self->stop) {
+        if (!modmqtt_wait_ack(&timeout_ms, self)) {
+            break;
+        }
+    }
+
+    if (self->state != MODMQTT_STATE_CONNECTED) {
+        uint8_t connack = self->connack;
+        bool timed_out = (self->state == MODMQTT_STATE_CONNECTING) && !self->stop;
+        MP_THREAD_GIL_EXIT();
+        modmqtt_stop_task(self);
+        MP_THREAD_GIL_ENTER();
+        modmqtt_release(self);
+        mp_raise_OSError((connack != 0) ? MP_ECONNREFUSED : (timed_out ? MP_ETIMEDOUT : MP_ECONNABORTED));
+    }
+
+    // the session was kept by the broker, what wasn't acknowledged goes again
+    for (int i = 0; i < MODMQTT_WINDOW_MAX; i++) {
+        modmqtt_inflight_t *slot = &self->inflight[i];
+        if (slot->pid != 0) {
+            modmqtt_publish_slot(self, slot, slot->topic, slot->payload, slot->flags | MODMQTT_FLAG_DUP, slot->pid);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(modmqtt_connect_obj, 2, modmqtt_connect);
+
+STATIC mp_obj_t modmqtt_disconnect(mp_obj_t self_in) {
+    modmqtt_obj_t *self = self_in;
+
+    if (self->task != NULL) {
+        uint8_t pkt[2] = { MODMQTT_MSG_DISCONNECT, 0 };
+        mp_buffer_info_t buf = { .buf = pkt, .len = sizeof(pkt) };
+        MP_THREAD_GIL_EXIT();
+        if (self->state == MODMQTT_STATE_CONNECTED) {
+            modmqtt_send(self, &buf, 1);
+        }
+        modmqtt_stop_task(self);
+        MP_THREAD_GIL_ENTER();
+    }
+    // closing the socket is left to its owner
+    if (modmqtt_is_active(self)) {
+        modmqtt_release(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(modmqtt_disconnect_obj, modmqtt_disconnect);
+
+STATIC mp_obj_t modmqtt_isconnected(mp_obj_t self_in) {
+    modmqtt_obj_t *self = self_in;
+    return mp_obj_new_bool(self->state == MODMQTT_STATE_CONNECTED);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(modmqtt_isconnected_obj, modmqtt_isconnected);
+
+STATIC const mp_arg_t modmqtt_publish_args[] = {
+    { MP_QSTR_self,     MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_topic,    MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_msg,      MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_qos,      MP_ARG_INT,                   {.u_int = 0} },
+    { MP_QSTR_retain,   MP_ARG_BOOL,                  {.u_bool = false} },
+    { MP_QSTR_timeout,  MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = MP_OBJ_NEW_SMALL_INT(MODMQTT_TIMEOUT_DEFAULT)} },
+};
+STATIC mp_obj_t modmqtt_publish(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(modmqtt_publish_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), modmqtt_publish_args, args);
+    modmqtt_obj_t *self = args[0].u_obj;
+    uint32_t timeout_ms = modmqtt_timeout_ms(args[5].u_obj);
+    modmqtt_inflight_t *slot = NULL;
+    uint16_t pid = 0;
+
+    if ((args[3].u_int != 0) && (args[3].u_int != 1)) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
+    }
+    if (self->state != MODMQTT_STATE_CONNECTED) {
+        mp_raise_OSError(MP_ENOTCONN);
+    }
+
+    if (args[3].u_int == 1) {
+        // wait for a place in the window
+        for (;;) {
+            for (int i = 0; (i < MODMQTT_WINDOW_MAX) && (slot == NULL); i++) {
+                if (self->inflight[i].pid == 0) {
+                    slot = &self->inflight[i];
+                }
+            }
+            uint32_t used = 0;
+            for (int i = 0; i < MODMQTT_WINDOW_MAX; i++) {
+                used += (self->inflight[i].pid != 0) ? 1 : 0;
+            }
+            if (used < self->window) {
+                break;
+            }
+            slot = NULL;
+            if (self->state != MODMQTT_STATE_CONNECTED) {
+                mp_raise_OSError(MP_ENOTCONN);
+            }
+            if (!modmqtt_wait_ack(&timeout_ms, self)) {
+                mp_raise_OSError(MP_ETIMEDOUT);
+            }
+        }
+        pid = modmqtt_new_pid(self);
+    }
+
+    uint8_t flags = (args[3].u_int ? MODMQTT_FLAG_QOS1 : 0) | (args[4].u_bool ? MODMQTT_FLAG_RETAIN : 0);
+    int ret = modmqtt_publish_slot(self, slot, args[1].u_obj, args[2].u_obj, flags, pid);
+    if (ret != 0) {
+        // a QoS 1 message stays in the window, it's sent again after connect()
+        mp_raise_OSError(ret);
+    }
+    return (pid != 0) ? MP_OBJ_NEW_SMALL_INT(pid) : mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(modmqtt_publish_obj, 3, modmqtt_publish);
+
+// send a SUBSCRIBE or an UNSUBSCRIBE and wait for its acknowledgement
+STATIC mp_int_t modmqtt_subscription(modmqtt_obj_t *self, uint8_t type, mp_obj_t topic, int qos, mp_obj_t timeout) {
+    uint32_t timeout_ms = modmqtt_timeout_ms(timeout);
+    mp_buffer_info_t topic_buf;
+
+    mp_get_buffer_raise(topic, &topic_buf, MP_BUFFER_READ);
+    if ((topic_buf.len == 0) || (topic_buf.len > UINT16_MAX)) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
+    }
+    if (self->state != MODMQTT_STATE_CONNECTED) {
+        mp_raise_OSError(MP_ENOTCONN);
+    }
+    if (self->op_pid != 0) {
+        mp_raise_OSError(MP_EALREADY);
+    }
+
+    uint8_t hdr[MODMQTT_HEADER_LEN_MAX + 2];
+    uint8_t qos_buf = qos;
+    size_t n = 0;
+    self->op_pid = modmqtt_new_pid(self);
+    self->op_result = -1;
+    hdr[n++] = type | MODMQTT_FLAG_QOS1;
+    n += modmqtt_encode_len(&hdr[n], 2 + 2 + topic_buf.len + ((type == MODMQTT_MSG_SUBSCRIBE) ? 1 : 0));
+    hdr[n++] = self->op_pid >> 8;
+    hdr[n++] = self->op_pid & 0xFF;
+    hdr[n++] = topic_buf.len >> 8;
+    hdr[n++] = topic_buf.len & 0xFF;
+    mp_buffer_info_t bufs[3] = {
+        { .buf = hdr, .len = n },
+        { .buf = topic_buf.buf, .len = topic_buf.len },
+        { .buf = &qos_buf, .len = (type == MODMQTT_MSG_SUBSCRIBE) ? 1 : 0 },
+    };
+
+    MP_THREAD_GIL_EXIT();
+    int ret = modmqtt_send(self, bufs, MP_ARRAY_SIZE(bufs));
+    MP_THREAD_GIL_ENTER();
+    if (ret != 0) {
+        self->op_pid = 0;
+        mp_raise_OSError(ret);
+    }
+
+    while ((self->op_result < 0) && (self->state == MODMQTT_STATE_CONNECTED)) {
+        if (!modmqtt_wait_ack(&timeout_ms, self)) {
+            break;
+        }
+    }
+    mp_int_t result = self->op_result;
+    self->op_pid = 0;
+
+    if (result < 0) {
+        mp_raise_OSError((self->state == MODMQTT_STATE_CONNECTED) ? MP_ETIMEDOUT : MP_ENOTCONN);
+    } else if (result == 0x80) {
+        // the broker refused the subscription
+        mp_raise_OSError(MP_EACCES);
+    }
+    return result;
+}
+
+STATIC const mp_arg_t modmqtt_subscribe_args[] = {
+    { MP_QSTR_self,     MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_topic,    MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_qos,      MP_ARG_INT,                   {.u_int = 0} },
+    { MP_QSTR_timeout,  MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = MP_OBJ_NEW_SMALL_INT(MODMQTT_TIMEOUT_DEFAULT)} },
+};
+STATIC mp_obj_t modmqtt_subscribe(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(modmqtt_subscribe_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), modmqtt_subscribe_args, args);
+
+    if ((args[2].u_int != 0) && (args[2].u_int != 1)) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
+    }
+    // the granted QoS
+    return MP_OBJ_NEW_SMALL_INT(modmqtt_subscription(args[0].u_obj, MODMQTT_MSG_SUBSCRIBE, args[1].u_obj, args[2].u_int, args[3].u_obj));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(modmqtt_subscribe_obj, 2, modmqtt_subscribe);
+
+STATIC const mp_arg_t modmqtt_unsubscribe_args[] = {
+    { MP_QSTR_self,     MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_topic,    MP_ARG_REQUIRED | MP_ARG_OBJ, },
+    { MP_QSTR_timeout,  MP_ARG_KW_ONLY | MP_ARG_OBJ,  {.u_obj = MP_OBJ_NEW_SMALL_INT(MODMQTT_TIMEOUT_DEFAULT)} },
+};
+STATIC mp_obj_t modmqtt_unsubscribe(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(modmqtt_unsubscribe_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), modmqtt_unsubscribe_args, args);
+
+    modmqtt_subscription(args[0].u_obj, MODMQTT_MSG_UNSUBSCRIBE, args[1].u_obj, 0, args[2].u_obj);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(modmqtt_unsubscribe_obj, 2, modmqtt_unsubscribe);
+
+STATIC mp_obj_t modmqtt_pending(mp_obj_t self_in) {
+    modmqtt_obj_t *self = self_in;
+    mp_int_t count = 0;
+    for (int i = 0; i < MODMQTT_WINDOW_MAX; i++) {
+        count += (self->inflight[i].pid != 0) ? 1 : 0;
+    }
+    return MP_OBJ_NEW_SMALL_INT(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(modmqtt_pending_obj, modmqtt_pending);
+
+STATIC mp_obj_t modmqtt_set_callback(mp_obj_t self_in, mp_obj_t handler) {
+    modmqtt_obj_t *self = self_in;
+    if ((handler != mp_const_none) && !mp_obj_is_callable(handler)) {
+        mp_raise_TypeError(mpexception_value_invalid_arguments);
+    }
+    self->msg_handler = handler;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(modmqtt_set_callback_obj, modmqtt_set_callback);
+
+STATIC mp_obj_t modmqtt_set_lost_callback(mp_obj_t self_in, mp_obj_t handler) {
+    modmqtt_obj_t *self = self_in;
+    if ((handler != mp_const_none) && !mp_obj_is_callable(handler)) {
+        mp_raise_TypeError(mpexception_value_invalid_arguments);
+    }
+    self->lost_handler = handler;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(modmqtt_set_lost_callback_obj, modmqtt_set_lost_callback);
+
+STATIC mp_obj_t modmqtt_del(mp_obj_t self_in) {
+    modmqtt_obj_t *self = self_in;
+    // a connected client is referenced by the list, it can't be collected
+    modmqtt_drop_rx(self);
+    vQueueDelete(self->rx_queue);
+    vSemaphoreDelete(self->ack_sem);
+    vSemaphoreDelete(self->io_mutex);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(modmqtt_del_obj, modmqtt_del);
+
+STATIC const mp_map_elem_t modmqtt_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___del__),             (mp_obj_t)&modmqtt_del_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_connect),             (mp_obj_t)&modmqtt_connect_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_disconnect),          (mp_obj_t)&modmqtt_disconnect_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_isconnected),         (mp_obj_t)&modmqtt_isconnected_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_publish),             (mp_obj_t)&modmqtt_publish_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_subscribe),           (mp_obj_t)&modmqtt_subscribe_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_unsubscribe),         (mp_obj_t)&modmqtt_unsubscribe_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pending),             (mp_obj_t)&modmqtt_pending_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_set_callback),        (mp_obj_t)&modmqtt_set_callback_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_set_lost_callback),   (mp_obj_t)&modmqtt_set_lost_callback_obj },
+};
+STATIC MP_DEFINE_CONST_DICT(modmqtt_locals_dict, modmqtt_locals_dict_table);
+
+const mp_obj_type_t mod_network_mqtt_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_MQTT,
+    .make_new = modmqtt_make_new,
+    .locals_dict = (mp_obj_t)&modmqtt_locals_dict,
+};
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MODMQTT_H_
+#define MODMQTT_H_
+
+/******************************************************************************
+ EXPORTED DATA
+ ******************************************************************************/
+extern const mp_obj_type_t mod_network_mqtt_type;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+extern void modmqtt_init0(void);
+extern void modmqtt_deinit0(void);
+
+#endif  // MODMQTT_H_
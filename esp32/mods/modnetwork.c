@@ -48,7 +48,12 @@
 #include "serverstask.h"
 #include "modusocket.h"
 #include "modcoap.h"
+#include "modmqtt.h"
 #include "modmdns.h"
+#include "netutils.h"
+#if defined(FIPY) || defined(GPY)
+#include "netfailover.h"
+#endif
 
 #include "lwip/sockets.h"
 
@@ -227,6 +232,119 @@ STATIC mp_obj_t network_server_deinit(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(network_server_deinit_obj, network_server_deinit);
 
+#if defined(FIPY) || defined(GPY)
+STATIC const mod_network_nic_type_t *network_failover_nics[E_NETFAILOVER_NUM_INFS] = {
+    &mod_network_nic_type_wlan,
+    &mod_network_nic_type_lte,
+};
+
+STATIC mp_obj_t network_failover_inf_stats(netfailover_inf_t inf) {
+    STATIC const qstr network_failover_inf_fields[] = {
+        MP_QSTR_link, MP_QSTR_healthy, MP_QSTR_rtt, MP_QSTR_probes, MP_QSTR_answers
+    };
+    netfailover_inf_stats_t stats;
+    netfailover_get_stats(inf, &stats);
+    mp_obj_t tuple[5];
+    tuple[0] = mp_obj_new_bool(stats.link_up);
+    tuple[1] = mp_obj_new_bool(stats.healthy);
+    tuple[2] = mp_obj_new_int_from_uint(stats.rtt_ms);
+    tuple[3] = mp_obj_new_int_from_uint(stats.probes);
+    tuple[4] = mp_obj_new_int_from_uint(stats.answers);
+    return mp_obj_new_attrtuple(network_failover_inf_fields, 5, tuple);
+}
+
+/// \function failover(*, enable, priority, probe, period, fails)
+/// Moves the default route to the first interface of priority that is up and answers
+/// the probes, without any involvement of the application. Returns the state when
+/// called without arguments.
+STATIC mp_obj_t network_failover(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const qstr network_failover_fields[] = {
+        MP_QSTR_enabled, MP_QSTR_active, MP_QSTR_priority, MP_QSTR_probe, MP_QSTR_period,
+        MP_QSTR_fails, MP_QSTR_switches, MP_QSTR_wlan, MP_QSTR_lte
+    };
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_enable,       MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_priority,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_probe,        MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_period,       MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_fails,        MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    netfailover_config_t config;
+    netfailover_get_config(&config);
+
+    if (kw_args->used == 0) {
+        mp_obj_t priority[E_NETFAILOVER_NUM_INFS];
+        for (int i = 0; i < E_NETFAILOVER_NUM_INFS; i++) {
+            priority[i] = (mp_obj_t)network_failover_nics[config.priority[i]];
+        }
+        netfailover_inf_t active = netfailover_active();
+        uint32_t probe_ip = ip4_addr_get_u32(ip_2_ip4(&config.probe_ip));
+
+        mp_obj_t tuple[9];
+        tuple[0] = mp_obj_new_bool(config.enabled);
+        tuple[1] = (active < E_NETFAILOVER_NUM_INFS) ? (mp_obj_t)network_failover_nics[active] : mp_const_none;
+        tuple[2] = mp_obj_new_tuple(E_NETFAILOVER_NUM_INFS, priority);
+        tuple[3] = probe_ip ? netutils_format_inet_addr((uint8_t *)&probe_ip, config.probe_port, NETUTILS_BIG) : mp_const_none;
+        tuple[4] = mp_obj_new_int_from_uint(config.period_ms);
+        tuple[5] = MP_OBJ_NEW_SMALL_INT(config.fails);
+        tuple[6] = mp_obj_new_int_from_uint(netfailover_switches());
+        tuple[7] = network_failover_inf_stats(E_NETFAILOVER_WLAN);
+        tuple[8] = network_failover_inf_stats(E_NETFAILOVER_LTE);
+        return mp_obj_new_attrtuple(network_failover_fields, 9, tuple);
+    }
+
+    if (args[0].u_obj != MP_OBJ_NULL) {
+        config.enabled = mp_obj_is_true(args[0].u_obj);
+    }
+    if (args[1].u_obj != MP_OBJ_NULL) {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(args[1].u_obj, E_NETFAILOVER_NUM_INFS, &items);
+        uint32_t seen = 0;
+        for (int i = 0; i < E_NETFAILOVER_NUM_INFS; i++) {
+            int inf = 0;
+            while (inf < E_NETFAILOVER_NUM_INFS && items[i] != (mp_obj_t)network_failover_nics[inf]) {
+                inf++;
+            }
+            if (inf == E_NETFAILOVER_NUM_INFS || (seen & (1 << inf))) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "priority must list WLAN and LTE once"));
+            }
+            seen |= 1 << inf;
+            config.priority[i] = inf;
+        }
+    }
+    if (args[2].u_obj != MP_OBJ_NULL) {
+        uint32_t probe_ip = 0;
+        config.probe_port = NETFAILOVER_PROBE_PORT_DEF;
+        if (args[2].u_obj != mp_const_none) {
+            config.probe_port = netutils_parse_inet_addr(args[2].u_obj, (uint8_t *)&probe_ip, NETUTILS_BIG);
+        }
+        ip_addr_set_ip4_u32(&config.probe_ip, probe_ip);
+    }
+    if (args[3].u_obj != MP_OBJ_NULL) {
+        mp_int_t period = mp_obj_get_int(args[3].u_obj);
+        if (period < NETFAILOVER_PROBE_PERIOD_MS_MIN) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        config.period_ms = period;
+    }
+    if (args[4].u_obj != MP_OBJ_NULL) {
+        mp_int_t fails = mp_obj_get_int(args[4].u_obj);
+        if (fails < 1 || fails > 255) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        config.fails = fails;
+    }
+
+    netfailover_configure(&config);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(network_failover_obj, 0, network_failover);
+#endif
+
 STATIC const mp_map_elem_t mp_module_network_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__),            MP_OBJ_NEW_QSTR(MP_QSTR_network) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_WLAN),                (mp_obj_t)&mod_network_nic_type_wlan },
@@ -238,11 +356,13 @@ STATIC const mp_map_elem_t mp_module_network_globals_table[] = {
 #endif
 #if defined(FIPY) || defined(GPY)
     { MP_OBJ_NEW_QSTR(MP_QSTR_LTE),                 (mp_obj_t)&mod_network_nic_type_lte },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_failover),            (mp_obj_t)&network_failover_obj },
 #endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_Bluetooth),           (mp_obj_t)&mod_network_nic_type_bt },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Server),              (mp_obj_t)&network_server_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Coap),                (mp_obj_t)&mod_coap },
     { MP_OBJ_NEW_QSTR(MP_QSTR_MDNS),                (mp_obj_t)&mod_mdns },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MQTT),                (mp_obj_t)&mod_network_mqtt_type },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_network_globals, mp_module_network_globals_table);
@@ -44,6 +44,10 @@
  ******************************************************************************/
 #define MOD_NETWORK_IPV4ADDR_BUF_SIZE             (4)
 
+// returned by n_handshake while the handshake is still in progress
+#define MOD_NETWORK_HANDSHAKE_WANT_READ           (1)
+#define MOD_NETWORK_HANDSHAKE_WANT_WRITE          (2)
+
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
@@ -56,7 +60,8 @@ typedef enum {
     SOCKET_NOT_CONNECTED,
     SOCKET_CONN_PENDING,
     SOCKET_CONN_ERROR,
-    SOCKET_CONN_TIMEDOUT
+    SOCKET_CONN_TIMEDOUT,
+    SOCKET_CONN_HANDSHAKE
 }mod_network_sock_conn_status_t;
 
 typedef struct _mod_network_nic_type_t {
@@ -76,10 +81,17 @@ typedef struct _mod_network_nic_type_t {
     int (*n_recv)(struct _mod_network_socket_obj_t *socket, byte *buf, mp_uint_t len, int *_errno);
     int (*n_sendto)(struct _mod_network_socket_obj_t *socket, const byte *buf, mp_uint_t len, byte *ip, mp_uint_t port, int *_errno);
     int (*n_recvfrom)(struct _mod_network_socket_obj_t *socket, byte *buf, mp_uint_t len, byte *ip, mp_uint_t *port, int *_errno);
+    // optional gather send, ip is NULL on a connected socket
+    int (*n_sendmsg)(struct _mod_network_socket_obj_t *socket, const mp_buffer_info_t *bufs, mp_uint_t n_bufs, byte *ip, mp_uint_t port, int *_errno);
     int (*n_setsockopt)(struct _mod_network_socket_obj_t *socket, mp_uint_t level, mp_uint_t opt, const void *optval, mp_uint_t optlen, int *_errno);
+    // optional, only integer options are read back
+    int (*n_getsockopt)(struct _mod_network_socket_obj_t *socket, mp_uint_t level, mp_uint_t opt, mp_int_t *optval, int *_errno);
     int (*n_settimeout)(struct _mod_network_socket_obj_t *socket, mp_int_t timeout_ms, int *_errno);
     int (*n_ioctl)(struct _mod_network_socket_obj_t *socket, mp_uint_t request, mp_uint_t arg, int *_errno);
     int (*n_setupssl)(struct _mod_network_socket_obj_t *socket, int *_errno);
+    // optional, runs the ssl handshake as far as it can go without blocking
+    // returns 0 once it's over, MOD_NETWORK_HANDSHAKE_WANT_* while in progress and -1 on error
+    int (*n_handshake)(struct _mod_network_socket_obj_t *socket, int *_errno);
 
     // Interface status
     bool (*inf_up)(void);
@@ -107,6 +119,7 @@ typedef struct _mod_network_socket_base_t {
     mod_network_sock_conn_status_t conn_status;
     int err;
     uint8_t domain;
+    uint32_t rx_size;       // largest read handed to the stack at once, 0 for the default
 } mod_network_socket_base_t;
 
 typedef struct _mod_network_socket_obj_t {
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "machpin.h"
+#include "machrmt.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// standard speed timings in us, the RMT clocks them so no interrupt can stretch a slot
+#define ONEWIRE_RESET_LOW                       (480)
+#define ONEWIRE_RESET_HIGH                      (480)
+#define ONEWIRE_RESET_IDLE                      (ONEWIRE_RESET_LOW + 60)    // the presence pulse comes within 60 us
+#define ONEWIRE_SLOT                            (70)
+#define ONEWIRE_WRITE_1_LOW                     (6)
+#define ONEWIRE_WRITE_0_LOW                     (60)
+#define ONEWIRE_READ_LOW                        (3)
+#define ONEWIRE_READ_SAMPLE                     (15)        // a device sending a 0 holds the line low past it
+#define ONEWIRE_SLOT_IDLE                       (100)       // longer than the high part of any slot
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC mach_rmt_bus_t *onewire_bus(mp_obj_t pin_in) {
+    return mach_rmt_bus_get(pin_find(pin_in)->pin_number);
+}
+
+STATIC void onewire_slot(rmt_item32_t *item, uint16_t low) {
+    item->level0 = 0;
+    item->duration0 = low;
+    item->level1 = 1;
+    item->duration1 = ONEWIRE_SLOT - low;
+}
+
+STATIC void onewire_write(mach_rmt_bus_t *bus, uint32_t value, int bits) {
+    rmt_item32_t items[8];
+    for (int i = 0; i < bits; i++) {
+        onewire_slot(&items[i], ((value >> i) & 1) ? ONEWIRE_WRITE_1_LOW : ONEWIRE_WRITE_0_LOW);
+    }
+    mach_rmt_bus_transfer(bus, items, bits, NULL, 0, ONEWIRE_SLOT_IDLE);
+}
+
+// the bits of the devices are the lengths of the low pulses seen in the read slots
+STATIC uint32_t onewire_read(mach_rmt_bus_t *bus, int bits) {
+    rmt_item32_t items[8];
+    uint16_t pulses[16];
+    for (int i = 0; i < bits; i++) {
+        onewire_slot(&items[i], ONEWIRE_READ_LOW);
+    }
+    mp_uint_t n = mach_rmt_bus_transfer(bus, items, bits, pulses, MP_ARRAY_SIZE(pulses), ONEWIRE_SLOT_IDLE);
+
+    uint32_t value = 0;
+    int bit = 0;
+    for (mp_uint_t i = 0; i < n && bit < bits; i++) {
+        if ((pulses[i] & 0x8000) == 0) {
+            value |= (uint32_t)((pulses[i] & 0x7FFF) < ONEWIRE_READ_SAMPLE) << bit;
+            bit++;
+        }
+    }
+    if (bit < bits) {
+        // the line never came back up, shorted or without a pull-up
+        mp_raise_OSError(MP_EIO);
+    }
+    return value;
+}
+
+/******************************************************************************
+ DEFINE MODULE FUNCTIONS
+ ******************************************************************************/
+STATIC mp_obj_t onewire_reset(mp_obj_t pin_in) {
+    mach_rmt_bus_t *bus = onewire_bus(pin_in);
+    rmt_item32_t item;
+    item.level0 = 0;
+    item.duration0 = ONEWIRE_RESET_LOW;
+    item.level1 = 1;
+    item.duration1 = ONEWIRE_RESET_HIGH;
+    uint16_t pulses[4];
+    mp_uint_t n = mach_rmt_bus_transfer(bus, &item, 1, pulses, MP_ARRAY_SIZE(pulses), ONEWIRE_RESET_IDLE);
+
+    // our own reset pulse, the line released and then pulled low again by the devices
+    bool presence = n >= 3 && (pulses[0] & 0x8000) == 0 && (pulses[2] & 0x8000) == 0;
+    return mp_obj_new_bool(presence);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_reset_obj, onewire_reset);
+
+STATIC mp_obj_t onewire_readbit(mp_obj_t pin_in) {
+    return MP_OBJ_NEW_SMALL_INT(onewire_read(onewire_bus(pin_in), 1));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_readbit_obj, onewire_readbit);
+
+STATIC mp_obj_t onewire_readbyte(mp_obj_t pin_in) {
+    return MP_OBJ_NEW_SMALL_INT(onewire_read(onewire_bus(pin_in), 8));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_readbyte_obj, onewire_readbyte);
+
+STATIC mp_obj_t onewire_writebit(mp_obj_t pin_in, mp_obj_t value_in) {
+    onewire_write(onewire_bus(pin_in), mp_obj_is_true(value_in), 1);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_writebit_obj, onewire_writebit);
+
+STATIC mp_obj_t onewire_writebyte(mp_obj_t pin_in, mp_obj_t value_in) {
+    onewire_write(onewire_bus(pin_in), mp_obj_get_int(value_in), 8);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_writebyte_obj, onewire_writebyte);
+
+/// \function readinto(pin, buf)
+/// Reads len(buf) bytes, one RMT transfer per byte
+STATIC mp_obj_t onewire_readinto(mp_obj_t pin_in, mp_obj_t buf_in) {
+    mach_rmt_bus_t *bus = onewire_bus(pin_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    for (size_t i = 0; i < bufinfo.len; i++) {
+        ((uint8_t *)bufinfo.buf)[i] = onewire_read(bus, 8);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_readinto_obj, onewire_readinto);
+
+/// \function write(pin, buf)
+STATIC mp_obj_t onewire_write_buf(mp_obj_t pin_in, mp_obj_t buf_in) {
+    mach_rmt_bus_t *bus = onewire_bus(pin_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    for (size_t i = 0; i < bufinfo.len; i++) {
+        onewire_write(bus, ((const uint8_t *)bufinfo.buf)[i], 8);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_write_buf_obj, onewire_write_buf);
+
+STATIC mp_obj_t onewire_crc8(mp_obj_t data) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    uint8_t crc = 0;
+    for (size_t i = 0; i < bufinfo.len; ++i) {
+        uint8_t byte = ((uint8_t *)bufinfo.buf)[i];
+        for (int b = 0; b < 8; ++b) {
+            uint8_t fb_bit = (crc ^ byte) & 0x01;
+            if (fb_bit == 0x01) {
+                crc = crc ^ 0x18;
+            }
+            crc = (crc >> 1) & 0x7f;
+            if (fb_bit == 0x01) {
+                crc = crc | 0x80;
+            }
+            byte = byte >> 1;
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(crc);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_crc8_obj, onewire_crc8);
+
+// the functions of extmod/modonewire.c, drivers/onewire runs on top of them unchanged
+STATIC const mp_map_elem_t onewire_module_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__),            MP_OBJ_NEW_QSTR(MP_QSTR__onewire) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_reset),               (mp_obj_t)&onewire_reset_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readbit),             (mp_obj_t)&onewire_readbit_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readbyte),            (mp_obj_t)&onewire_readbyte_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_writebit),            (mp_obj_t)&onewire_writebit_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_writebyte),           (mp_obj_t)&onewire_writebyte_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto),            (mp_obj_t)&onewire_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write),               (mp_obj_t)&onewire_write_buf_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_crc8),                (mp_obj_t)&onewire_crc8_obj },
+};
+STATIC MP_DEFINE_CONST_DICT(onewire_module_globals, onewire_module_globals_table);
+
+const mp_obj_module_t mp_module_onewire = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&onewire_module_globals,
+};
@@ -10,12 +10,16 @@
 #include "py/mpconfig.h"
 #include "py/obj.h"
 #include "py/objstr.h"
+#include "py/objtuple.h"
 #include "py/runtime.h"
+#include "py/mperrno.h"
 #include "mperror.h"
 #include "updater.h"
 #include "modled.h"
 
 #include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 
@@ -38,15 +42,18 @@
 
 #include "modmachine.h"
 #include "esp32chipinfo.h"
+#include "boottime.h"
 #include "modwlan.h"
 
 
 #include <string.h>
 
-extern led_info_t led_info;
 
 
 #define NVS_NAMESPACE                           "PY_NVM"
+#ifndef NVS_KEY_NAME_MAX_SIZE
+#define NVS_KEY_NAME_MAX_SIZE                   (16)        // including the null character
+#endif
 
 #define WDT_ON_BOOT_MIN_TIMEOUT_MS              (5000)
 
@@ -60,6 +67,8 @@ void modpycom_init0(void) {
     if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &pycom_nvs_handle) != ESP_OK) {
         mp_printf(&mp_plat_print, "Error while opening Pycom NVS name space\n");
     }
+    MP_STATE_PORT(pycom_nvs_cache) = mp_obj_new_dict(0);
+    MP_STATE_PORT(pycom_nvs_dirty) = mp_obj_new_dict(0);
     rmt_driver_install(RMT_CHANNEL_0, 1000, 0);
     if (updater_read_boot_info (&boot_info, &boot_info_offset) == false) {
         mp_printf(&mp_plat_print, "Error reading bootloader information!\n");
@@ -141,11 +150,6 @@ STATIC mp_obj_t mod_pycom_heartbeat (mp_uint_t n_args, const mp_obj_t *args) {
 #ifndef RGB_LED_DISABLE
     if (n_args) {
         mperror_enable_heartbeat (mp_obj_is_true(args[0]));
-        if (!mp_obj_is_true(args[0])) {
-            do {
-                mp_hal_delay_ms(2);
-            } while (!mperror_heartbeat_disable_done());
-        }
     } else {
         return mp_obj_new_bool(mperror_is_heartbeat_enabled());
     }
@@ -162,9 +166,12 @@ STATIC mp_obj_t mod_pycom_rgb_led (mp_obj_t o_color) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
     }
 
-    uint32_t color = mp_obj_get_int(o_color);
-    led_info.color.value = color;
-    led_set_color(&led_info, true, false);
+    if (o_color == mp_const_none) {
+        // switch the led off and give its RMT channel back until the next call
+        mperror_led_release();
+    } else if (!mperror_led_set_color(mp_obj_get_int(o_color))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
 #else
     nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "RGB Led Interface Disabled"));
 #endif
@@ -173,19 +180,43 @@ STATIC mp_obj_t mod_pycom_rgb_led (mp_obj_t o_color) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_pycom_rgb_led_obj, mod_pycom_rgb_led);
 
-STATIC mp_obj_t mod_pycom_ota_start (void) {
-    if (!updater_start()) {
+STATIC mp_obj_t mod_pycom_ota_start (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_format,       MP_ARG_INT, {.u_int = UPDATER_FORMAT_RAW} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[0].u_int & ~(UPDATER_FORMAT_ZLIB | UPDATER_FORMAT_DELTA)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    if (!updater_start_format(args[0].u_int)) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_ota_start_obj, mod_pycom_ota_start);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_pycom_ota_start_obj, 0, mod_pycom_ota_start);
+
+// returns the offset of the image from which ota_write() has to continue
+STATIC mp_obj_t mod_pycom_ota_resume (void) {
+    uint32_t offset;
+    if (!updater_resume(&offset)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    return mp_obj_new_int_from_uint(offset);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_ota_resume_obj, mod_pycom_ota_resume);
 
 STATIC mp_obj_t mod_pycom_ota_write (mp_obj_t data) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
 
-    if (!updater_write(bufinfo.buf, bufinfo.len)) {
+    // the data is programmed by the updater task, this only waits when both of its buffers are busy
+    MP_THREAD_GIL_EXIT();
+    bool ok = updater_write_async(bufinfo.buf, bufinfo.len);
+    MP_THREAD_GIL_ENTER();
+    if (!ok) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
     return mp_const_none;
@@ -193,7 +224,10 @@ STATIC mp_obj_t mod_pycom_ota_write (mp_obj_t data) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_pycom_ota_write_obj, mod_pycom_ota_write);
 
 STATIC mp_obj_t mod_pycom_ota_finish (void) {
-    if (!updater_finish()) {
+    MP_THREAD_GIL_EXIT();
+    bool ok = updater_finish();
+    MP_THREAD_GIL_ENTER();
+    if (!ok) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
     return mp_const_none;
@@ -256,69 +290,110 @@ STATIC mp_obj_t mod_pycom_pulses_get (mp_obj_t gpio, mp_obj_t timeout) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_pycom_pulses_get_obj, mod_pycom_pulses_get);
 
 
-STATIC mp_obj_t mod_pycom_nvs_set (mp_obj_t _key, mp_obj_t _value) {
+// the values read or written since the soft reset are kept in pycom_nvs_cache, the keys
+// of the ones which still have to be written to flash in pycom_nvs_dirty
+STATIC void mod_pycom_nvs_raise (esp_err_t esp_err) {
+    if (ESP_ERR_NVS_NOT_ENOUGH_SPACE == esp_err || ESP_ERR_NVS_PAGE_FULL == esp_err || ESP_ERR_NVS_NO_FREE_PAGES == esp_err) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "No free space available"));
+    } else if (ESP_ERR_NVS_INVALID_NAME == esp_err || ESP_ERR_NVS_KEY_TOO_LONG == esp_err) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Key is invalid"));
+    } else {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_Exception, "Error occurred while storing value, code: %d", esp_err));
+    }
+}
 
-    const char *key = mp_obj_str_get_str(_key);
-    esp_err_t esp_err = ESP_OK;
+STATIC esp_err_t mod_pycom_nvs_write (mp_obj_t key, mp_obj_t value) {
+    if (MP_OBJ_IS_STR(value)) {
+        return nvs_set_str(pycom_nvs_handle, mp_obj_str_get_str(key), mp_obj_str_get_str(value));
+    }
+    return nvs_set_u32(pycom_nvs_handle, mp_obj_str_get_str(key), mp_obj_get_int_truncated(value));
+}
 
-    if (MP_OBJ_IS_STR_OR_BYTES(_value)) {
-        const char *value = mp_obj_str_get_str(_value);
-        if (strlen(value) >= 1984) {
+// writes the pending values and commits them
+STATIC esp_err_t mod_pycom_nvs_flush (void) {
+    mp_map_t *cache = mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_cache));
+    mp_map_t *dirty = mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_dirty));
+    if (dirty->used == 0) {
+        return ESP_OK;
+    }
+    for (size_t i = 0; i < dirty->alloc; i++) {
+        if (mp_map_slot_is_filled(dirty, i)) {
+            mp_obj_t key = dirty->table[i].key;
+            esp_err_t esp_err = mod_pycom_nvs_write(key, mp_map_lookup(cache, key, MP_MAP_LOOKUP)->value);
+            if (ESP_OK != esp_err) {
+                // the ones already written are written again by the next commit, no harm done
+                return esp_err;
+            }
+        }
+    }
+    mp_map_clear(dirty);
+    return nvs_commit(pycom_nvs_handle);
+}
+
+// the value as nvs_get() would read it back from flash
+STATIC mp_obj_t mod_pycom_nvs_value (mp_obj_t value) {
+    if (MP_OBJ_IS_STR_OR_BYTES(value)) {
+        size_t len;
+        const char *str = mp_obj_str_get_data(value, &len);
+        if (strlen(str) >= 1984) {
             // Maximum length (including null character) can be 1984 bytes
             nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "value too long (max: 1984)"));
         }
-        esp_err = nvs_set_str(pycom_nvs_handle, key, value);
-    } else if(MP_OBJ_IS_INT(_value)) {
-        uint32_t value = mp_obj_get_int_truncated(_value);
-        esp_err = nvs_set_u32(pycom_nvs_handle, key, value);
-    } else {
-        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Value must be string, bytes or integer"));
+        return MP_OBJ_IS_STR(value) ? value : mp_obj_new_str(str, strlen(str));
+    } else if(MP_OBJ_IS_INT(value)) {
+        return mp_obj_new_int((int32_t)mp_obj_get_int_truncated(value));
     }
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Value must be string, bytes or integer"));
+}
 
-    if (ESP_OK == esp_err) {
-        nvs_commit(pycom_nvs_handle);
-    } else if (ESP_ERR_NVS_NOT_ENOUGH_SPACE == esp_err || ESP_ERR_NVS_PAGE_FULL == esp_err || ESP_ERR_NVS_NO_FREE_PAGES == esp_err) {
-        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "No free space available"));
-    } else if (ESP_ERR_NVS_INVALID_NAME == esp_err || ESP_ERR_NVS_KEY_TOO_LONG == esp_err) {
+STATIC void mod_pycom_nvs_store (mp_obj_t key, mp_obj_t value) {
+    if (strlen(mp_obj_str_get_str(key)) >= NVS_KEY_NAME_MAX_SIZE) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Key is invalid"));
-    } else {
-        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_Exception, "Error occurred while storing value, code: %d", esp_err));
     }
-    return mp_const_none;
+    value = mod_pycom_nvs_value(value);
+    mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_cache)), key, MP_MAP_LOOKUP);
+    if (elem != NULL && mp_obj_equal(elem->value, value)) {
+        // unchanged, no need to wear the flash
+        return;
+    }
+    mp_obj_dict_store(MP_STATE_PORT(pycom_nvs_cache), key, value);
+    mp_obj_dict_store(MP_STATE_PORT(pycom_nvs_dirty), key, mp_const_true);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_pycom_nvs_set_obj, mod_pycom_nvs_set);
 
-STATIC mp_obj_t mod_pycom_nvs_get (mp_uint_t n_args, const mp_obj_t *args) {
+STATIC mp_obj_t mod_pycom_nvs_lookup (mp_obj_t key, mp_obj_t def) {
+    mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_cache)), key, MP_MAP_LOOKUP);
+    if (elem != NULL) {
+        return elem->value;
+    }
 
-    const char *key = mp_obj_str_get_str(args[0]);
+    const char *key_str = mp_obj_str_get_str(key);
     esp_err_t esp_err = ESP_OK;
     mp_obj_t ret = mp_const_none;
     uint32_t value;
 
-    esp_err = nvs_get_u32(pycom_nvs_handle, key, &value);
+    esp_err = nvs_get_u32(pycom_nvs_handle, key_str, &value);
     if (esp_err == ESP_OK) {
         ret = mp_obj_new_int(value);
     }
     else {
-        esp_err = nvs_get_str(pycom_nvs_handle, key, NULL, &value);
+        esp_err = nvs_get_str(pycom_nvs_handle, key_str, NULL, &value);
         if(esp_err == ESP_OK) {
             char* value_string = (char*)m_malloc(value);
 
-            esp_err = nvs_get_str(pycom_nvs_handle, key, value_string, &value);
+            esp_err = nvs_get_str(pycom_nvs_handle, key_str, value_string, &value);
 
             if(esp_err == ESP_OK) {
                 //do not count the terminating \0
                 ret = mp_obj_new_str(value_string, value-1);
-                m_free(value_string);
             }
             m_free(value_string);
         }
     }
 
     if(esp_err == ESP_ERR_NVS_NOT_FOUND) {
-        if (n_args > 1) {
+        if (def != MP_OBJ_NULL) {
             // return user defined NoExistValue
-            return args[1];
+            return def;
         }
         else
         {
@@ -328,14 +403,84 @@ STATIC mp_obj_t mod_pycom_nvs_get (mp_uint_t n_args, const mp_obj_t *args) {
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_Exception, "Error occurred while fetching value, code: %d", esp_err));
     }
 
+    mp_obj_dict_store(MP_STATE_PORT(pycom_nvs_cache), key, ret);
     return ret;
 }
+
+void modpycom_nvs_commit_all (void) {
+    mod_pycom_nvs_flush();
+}
+
+// nvs_set(key, value, *, commit=True) or nvs_set({key: value, ...}, *, commit=True), with
+// commit=False the values stay in RAM until nvs_commit()
+STATIC mp_obj_t mod_pycom_nvs_set (mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_key, ARG_value, ARG_commit };
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_key,                 MP_ARG_REQUIRED | MP_ARG_OBJ,  },
+        { MP_QSTR_value,                                 MP_ARG_OBJ,  {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_commit,              MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (MP_OBJ_IS_TYPE(args[ARG_key].u_obj, &mp_type_dict)) {
+        mp_map_t *map = mp_obj_dict_get_map(args[ARG_key].u_obj);
+        for (size_t i = 0; i < map->alloc; i++) {
+            if (mp_map_slot_is_filled(map, i)) {
+                mod_pycom_nvs_store(map->table[i].key, map->table[i].value);
+            }
+        }
+    } else if (args[ARG_value].u_obj != MP_OBJ_NULL) {
+        mod_pycom_nvs_store(args[ARG_key].u_obj, args[ARG_value].u_obj);
+    } else {
+        mp_raise_TypeError("value missing");
+    }
+
+    if (args[ARG_commit].u_bool) {
+        esp_err_t esp_err = mod_pycom_nvs_flush();
+        if (ESP_OK != esp_err) {
+            mod_pycom_nvs_raise(esp_err);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_pycom_nvs_set_obj, 1, mod_pycom_nvs_set);
+
+// nvs_get(key[, default]) or nvs_get([key, ...][, default]), the latter returns a tuple
+STATIC mp_obj_t mod_pycom_nvs_get (mp_uint_t n_args, const mp_obj_t *args) {
+    mp_obj_t def = (n_args > 1) ? args[1] : MP_OBJ_NULL;
+
+    if (MP_OBJ_IS_TYPE(args[0], &mp_type_list) || MP_OBJ_IS_TYPE(args[0], &mp_type_tuple)) {
+        size_t len;
+        mp_obj_t *keys;
+        mp_obj_get_array(args[0], &len, &keys);
+        mp_obj_tuple_t *values = MP_OBJ_TO_PTR(mp_obj_new_tuple(len, NULL));
+        for (size_t i = 0; i < len; i++) {
+            values->items[i] = mod_pycom_nvs_lookup(keys[i], def);
+        }
+        return MP_OBJ_FROM_PTR(values);
+    }
+    return mod_pycom_nvs_lookup(args[0], def);
+}
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_pycom_nvs_get_obj, 1, 2, mod_pycom_nvs_get);
 
+STATIC mp_obj_t mod_pycom_nvs_commit (void) {
+    esp_err_t esp_err = mod_pycom_nvs_flush();
+    if (ESP_OK != esp_err) {
+        mod_pycom_nvs_raise(esp_err);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_nvs_commit_obj, mod_pycom_nvs_commit);
+
 STATIC mp_obj_t mod_pycom_nvs_erase (mp_obj_t _key) {
     const char *key = mp_obj_str_get_str(_key);
 
-    if (ESP_ERR_NVS_NOT_FOUND == nvs_erase_key(pycom_nvs_handle, key)) {
+    mp_map_lookup(mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_cache)), _key, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    // a value never committed only has to be forgotten
+    bool pending = mp_map_lookup(mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_dirty)), _key, MP_MAP_LOOKUP_REMOVE_IF_FOUND) != NULL;
+    if (ESP_ERR_NVS_NOT_FOUND == nvs_erase_key(pycom_nvs_handle, key) && !pending) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_KeyError, "key not found"));
     }
     return mp_const_none;
@@ -343,6 +488,8 @@ STATIC mp_obj_t mod_pycom_nvs_erase (mp_obj_t _key) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_pycom_nvs_erase_obj, mod_pycom_nvs_erase);
 
 STATIC mp_obj_t mod_pycom_nvs_erase_all (void) {
+    mp_map_clear(mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_cache)));
+    mp_map_clear(mp_obj_dict_get_map(MP_STATE_PORT(pycom_nvs_dirty)));
     if (ESP_OK != nvs_erase_all(pycom_nvs_handle)) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
     }
@@ -351,6 +498,28 @@ STATIC mp_obj_t mod_pycom_nvs_erase_all (void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_nvs_erase_all_obj, mod_pycom_nvs_erase_all);
 
+// config_begin() makes the config setters that follow write the flash only once, at
+// config_commit(), config_abort() drops their changes
+STATIC mp_obj_t mod_pycom_config_begin (void) {
+    config_begin();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_config_begin_obj, mod_pycom_config_begin);
+
+STATIC mp_obj_t mod_pycom_config_commit (void) {
+    if (!config_commit()) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_config_commit_obj, mod_pycom_config_commit);
+
+STATIC mp_obj_t mod_pycom_config_abort (void) {
+    config_abort();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_config_abort_obj, mod_pycom_config_abort);
+
 STATIC mp_obj_t mod_pycom_wifi_on_boot (mp_uint_t n_args, const mp_obj_t *args) {
     if (n_args == 0) {
         return mp_obj_new_bool(config_get_wifi_on_boot());
@@ -571,6 +740,21 @@ STATIC mp_obj_t mod_pycom_lte_modem_on_boot (mp_uint_t n_args, const mp_obj_t *a
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_pycom_lte_modem_on_boot_obj, 0, 1, mod_pycom_lte_modem_on_boot);
 
+// subsystems started during boot, the others wait for their class to be used
+STATIC mp_obj_t mod_pycom_init_on_boot (mp_uint_t n_args, const mp_obj_t *args) {
+    if (n_args) {
+        mp_int_t init_on_boot = mp_obj_get_int(args[0]);
+        if (init_on_boot & ~PYCOM_INIT_ON_BOOT_ALL) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        config_set_init_on_boot(init_on_boot);
+    } else {
+        return mp_obj_new_int(config_get_init_on_boot());
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_pycom_init_on_boot_obj, 0, 1, mod_pycom_init_on_boot);
+
 STATIC mp_obj_t mod_pycom_pybytes_on_boot (mp_uint_t n_args, const mp_obj_t *args) {
     if (n_args) {
         config_set_pybytes_autostart (mp_obj_is_true(args[0]));
@@ -745,6 +929,126 @@ STATIC mp_obj_t mod_pycom_get_free_heap (void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_get_free_heap_obj, mod_pycom_get_free_heap);
 
+// same layout as get_free_heap(), a fragmented heap can have plenty free and no room for a buffer
+STATIC mp_obj_t mod_pycom_get_largest_free_block (void) {
+    size_t heap_psram_largest = 0;
+    mp_obj_t items[2];
+
+    if (esp32_get_chip_rev() > 0) {
+        heap_psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    items[0] = mp_obj_new_int(heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (heap_psram_largest) {
+        items[1] = mp_obj_new_int(heap_psram_largest);
+    } else {
+        items[1] = mp_obj_new_str("NO_EXT_RAM", strlen("NO_EXT_RAM"));
+    }
+    return mp_obj_new_tuple(2, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_get_largest_free_block_obj, mod_pycom_get_largest_free_block);
+
+// partitions owned by the firmware, flash_write() must never touch them
+STATIC const char *const flash_reserved_partitions[] = { "nvs", "otadata", "fs", "config" };
+
+STATIC const esp_partition_t *pycom_find_partition (mp_obj_t label_in) {
+    const char *label = mp_obj_str_get_str(label_in);
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL) {
+        part = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, label);
+    }
+    if (part == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "partition not found"));
+    }
+    return part;
+}
+
+STATIC void pycom_check_partition_range (const esp_partition_t *part, mp_int_t offset, mp_int_t *size) {
+    if (*size < 0) {
+        *size = (offset >= 0) ? (mp_int_t)part->size - offset : 0;
+    }
+    if (offset < 0 || *size <= 0 || offset + *size > part->size) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+}
+
+// maps a range of a flash partition through the flash cache and returns it as a read-only
+// memoryview, the data is read in place (and decrypted if needed) without using the heap
+STATIC mp_obj_t mod_pycom_flash_mmap (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_partition,    MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_offset,       MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_size,         MP_ARG_INT, {.u_int = -1} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    const esp_partition_t *part = pycom_find_partition(args[0].u_obj);
+    mp_int_t offset = args[1].u_int;
+    mp_int_t size = args[2].u_int;
+    pycom_check_partition_range(part, offset, &size);
+
+    // the mapping is never released: the memoryview can't tell when it is freed and mapping the
+    // same pages again only takes a reference on them, so the address space used stays bounded
+    const void *ptr;
+    spi_flash_mmap_handle_t handle;
+    esp_err_t err = esp_partition_mmap(part, offset, size, SPI_FLASH_MMAP_DATA, &ptr, &handle);
+    if (err == ESP_ERR_NO_MEM) {
+        mp_raise_OSError(MP_ENOMEM);
+    } else if (err != ESP_OK) {
+        mp_raise_OSError(MP_EIO);
+    }
+    return mp_obj_new_memoryview('B', size, (void *)ptr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_pycom_flash_mmap_obj, 1, mod_pycom_flash_mmap);
+
+// erases the sectors covering [offset, offset + len(data)) of a user data partition and writes data there
+STATIC mp_obj_t mod_pycom_flash_write (mp_obj_t partition, mp_obj_t offset_in, mp_obj_t data) {
+    const esp_partition_t *part = pycom_find_partition(partition);
+    if (part->type != ESP_PARTITION_TYPE_DATA) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "not a data partition"));
+    }
+    for (int i = 0; i < MP_ARRAY_SIZE(flash_reserved_partitions); i++) {
+        if (strcmp(part->label, flash_reserved_partitions[i]) == 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "partition in use by the firmware"));
+        }
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    mp_int_t offset = mp_obj_get_int(offset_in);
+    mp_int_t size = bufinfo.len;
+    pycom_check_partition_range(part, offset, &size);
+    if (offset % SPI_FLASH_SEC_SIZE) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "offset must be sector aligned"));
+    }
+
+    uint32_t erase_size = (size + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+    if (offset + erase_size > part->size ||
+        esp_partition_erase_range(part, offset, erase_size) != ESP_OK ||
+        esp_partition_write(part, offset, bufinfo.buf, size) != ESP_OK) {
+        mp_raise_OSError(MP_EIO);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mod_pycom_flash_write_obj, mod_pycom_flash_write);
+
+// returns the (phase, microseconds since reset) tuples of the phases reached so far during boot
+STATIC mp_obj_t mod_pycom_boot_times (void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (boottime_phase_t phase = 0; phase < E_BOOTTIME_NUM_PHASES; phase++) {
+        uint32_t us = boottime_get(phase);
+        if (us > 0) {
+            mp_obj_t tuple[2];
+            tuple[0] = mp_obj_new_str(boottime_phase_name(phase), strlen(boottime_phase_name(phase)));
+            tuple[1] = mp_obj_new_int_from_uint(us);
+            mp_obj_list_append(list, mp_obj_new_tuple(2, tuple));
+        }
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_pycom_boot_times_obj, mod_pycom_boot_times);
+
 #if (VARIANT == PYBYTES)
 
 STATIC mp_obj_t mod_pycom_pybytes_device_token (void) {
@@ -826,7 +1130,7 @@ STATIC uint8_t hex_from_char(const char c) {
 }
 
 
-STATIC mp_obj_t mod_pycom_sigfox_info (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+STATIC mp_obj_t mod_pycom_sigfox_info_helper (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     enum { ARG_id, ARG_pac, ARG_public_key, ARG_private_key, ARG_force };
     STATIC const mp_arg_t allowed_args[] = {
             { MP_QSTR_id,           MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
@@ -996,6 +1300,24 @@ STATIC mp_obj_t mod_pycom_sigfox_info (size_t n_args, const mp_obj_t *pos_args,
     }
     return mp_const_none;
 }
+
+// the values are written to flash together, or not at all if one of them is invalid
+STATIC mp_obj_t mod_pycom_sigfox_info (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_obj_t ret;
+    nlr_buf_t nlr;
+    config_begin();
+    if (nlr_push(&nlr) == 0) {
+        ret = mod_pycom_sigfox_info_helper(n_args, pos_args, kw_args);
+        nlr_pop();
+    } else {
+        config_abort();
+        nlr_jump(nlr.ret_val);
+    }
+    if (!config_commit()) {
+        return mp_const_false;
+    }
+    return ret;
+}
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_pycom_sigfox_info_obj, 0, mod_pycom_sigfox_info);
 
 STATIC const mp_map_elem_t pycom_module_globals_table[] = {
@@ -1003,6 +1325,7 @@ STATIC const mp_map_elem_t pycom_module_globals_table[] = {
         { MP_OBJ_NEW_QSTR(MP_QSTR_heartbeat),                       (mp_obj_t)&mod_pycom_heartbeat_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_rgbled),                          (mp_obj_t)&mod_pycom_rgb_led_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_start),                       (mp_obj_t)&mod_pycom_ota_start_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_ota_resume),                      (mp_obj_t)&mod_pycom_ota_resume_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_write),                       (mp_obj_t)&mod_pycom_ota_write_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_finish),                      (mp_obj_t)&mod_pycom_ota_finish_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_ota_verify),                      (mp_obj_t)&mod_pycom_ota_verify_obj },
@@ -1010,14 +1333,23 @@ STATIC const mp_map_elem_t pycom_module_globals_table[] = {
         { MP_OBJ_NEW_QSTR(MP_QSTR_pulses_get),                      (mp_obj_t)&mod_pycom_pulses_get_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_nvs_set),                         (mp_obj_t)&mod_pycom_nvs_set_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_nvs_get),                         (mp_obj_t)&mod_pycom_nvs_get_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_nvs_commit),                      (mp_obj_t)&mod_pycom_nvs_commit_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_nvs_erase),                       (mp_obj_t)&mod_pycom_nvs_erase_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_nvs_erase_all),                   (mp_obj_t)&mod_pycom_nvs_erase_all_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_config_begin),                    (mp_obj_t)&mod_pycom_config_begin_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_config_commit),                   (mp_obj_t)&mod_pycom_config_commit_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_config_abort),                    (mp_obj_t)&mod_pycom_config_abort_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_wifi_on_boot),                    (mp_obj_t)&mod_pycom_wifi_on_boot_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_wdt_on_boot),                     (mp_obj_t)&mod_pycom_wdt_on_boot_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_wdt_on_boot_timeout),             (mp_obj_t)&mod_pycom_wdt_on_boot_timeout_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_heartbeat_on_boot),               (mp_obj_t)&mod_pycom_heartbeat_on_boot_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_lte_modem_en_on_boot),            (mp_obj_t)&mod_pycom_lte_modem_on_boot_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_init_on_boot),                    (mp_obj_t)&mod_pycom_init_on_boot_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_get_free_heap),                   (mp_obj_t)&mod_pycom_get_free_heap_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_get_largest_free_block),          (mp_obj_t)&mod_pycom_get_largest_free_block_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_flash_mmap),                      (mp_obj_t)&mod_pycom_flash_mmap_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_flash_write),                     (mp_obj_t)&mod_pycom_flash_write_obj },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_boot_times),                      (mp_obj_t)&mod_pycom_boot_times_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_wifi_ssid_sta),                   (mp_obj_t)&mod_pycom_wifi_ssid_sta_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_wifi_ssid_ap),                    (mp_obj_t)&mod_pycom_wifi_ssid_ap_obj },
         { MP_OBJ_NEW_QSTR(MP_QSTR_wifi_pwd_sta),                    (mp_obj_t)&mod_pycom_wifi_pwd_sta_obj },
@@ -1045,6 +1377,12 @@ STATIC const mp_map_elem_t pycom_module_globals_table[] = {
         // class constants
         { MP_OBJ_NEW_QSTR(MP_QSTR_FACTORY),                         MP_OBJ_NEW_SMALL_INT(0) },
         { MP_OBJ_NEW_QSTR(MP_QSTR_OTA_0),                           MP_OBJ_NEW_SMALL_INT(1) },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_OTA_RAW),                         MP_OBJ_NEW_SMALL_INT(UPDATER_FORMAT_RAW) },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_OTA_ZLIB),                        MP_OBJ_NEW_SMALL_INT(UPDATER_FORMAT_ZLIB) },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_OTA_DELTA),                       MP_OBJ_NEW_SMALL_INT(UPDATER_FORMAT_DELTA) },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_INIT_BT),                         MP_OBJ_NEW_SMALL_INT(PYCOM_INIT_ON_BOOT_BT) },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_INIT_LORA),                       MP_OBJ_NEW_SMALL_INT(PYCOM_INIT_ON_BOOT_LORA) },
+        { MP_OBJ_NEW_QSTR(MP_QSTR_INIT_LTE),                        MP_OBJ_NEW_SMALL_INT(PYCOM_INIT_ON_BOOT_LTE) },
         { MP_OBJ_NEW_QSTR(MP_QSTR_FAT),                           MP_OBJ_NEW_SMALL_INT(0) },
         { MP_OBJ_NEW_QSTR(MP_QSTR_LittleFS),                        MP_OBJ_NEW_SMALL_INT(1) },
 
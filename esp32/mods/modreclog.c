@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+/*
+ * Append-only record log kept in a directory of fixed size segment files
+ * named "%08x.seg" after their sequence number. Every record is stored as a
+ * reclog_record_hdr_t followed by the payload. When a segment is full the next
+ * one is started and the oldest segment is removed once more than `segments`
+ * exist. Records are batched in RAM and written with one write and one sync
+ * per batch, the segment file is kept open so no open/close (and no timestamp
+ * update) happens per record. A torn record at the end of a segment (power
+ * loss during a write) ends that segment, appending resumes in a new one.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/obj.h"
+#include "py/objstr.h"
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "extmod/vfs.h"
+#include "rom/crc.h"
+#include "mpexception.h"
+#include "modreclog.h"
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC const mp_obj_type_t reclog_type;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC mp_obj_t reclog_segment_path (reclog_obj_t *self, uint32_t seq) {
+    size_t len;
+    const char *dir = mp_obj_str_get_data(self->dir, &len);
+    vstr_t vstr;
+    vstr_init(&vstr, len + 1 + RECLOG_SEGMENT_NAME_LEN + 1);
+    vstr_printf(&vstr, "%s/%08x.seg", dir, seq);
+    return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+}
+
+STATIC bool reclog_parse_segment_name (const char *name, uint32_t *seq) {
+    if (strlen(name) != RECLOG_SEGMENT_NAME_LEN || strcmp(&name[8], ".seg") != 0) {
+        return false;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        char c = name[i];
+        if (c >= '0' && c <= '9') {
+            value = (value << 4) | (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            value = (value << 4) | (c - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+    *seq = value;
+    return true;
+}
+
+STATIC mp_obj_t reclog_open_file (mp_obj_t path, qstr mode) {
+    mp_obj_t args[2] = { path, MP_OBJ_NEW_QSTR(mode) };
+    return mp_vfs_open(2, args, (mp_map_t *)&mp_const_empty_map);
+}
+
+STATIC void reclog_write (mp_obj_t file, const void *buf, size_t len) {
+    int errcode;
+    mp_uint_t n = mp_stream_rw(file, (void *)buf, len, &errcode, MP_STREAM_RW_WRITE);
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    if (n != len) {
+        mp_raise_OSError(MP_ENOSPC);
+    }
+}
+
+STATIC void reclog_sync (mp_obj_t file) {
+    int errcode;
+    if (mp_get_stream(file)->ioctl(file, MP_STREAM_FLUSH, 0, &errcode) == MP_STREAM_ERROR) {
+        mp_raise_OSError(errcode);
+    }
+}
+
+// writes the buffered records to the segment and syncs it
+STATIC void reclog_flush_buffer (reclog_obj_t *self) {
+    if (self->buffer_len > 0) {
+        // drop the batch even if the write fails, otherwise every later append would fail again with it
+        uint32_t len = self->buffer_len;
+        self->buffer_len = 0;
+        reclog_write(self->file, self->buffer, len);
+    }
+    reclog_sync(self->file);
+    self->unsynced = 0;
+}
+
+// walks the records of an open segment, appending the payloads of the ones past `skip`
+// to `out` (if given) until `max` are collected, returns the offset after the last valid record
+STATIC uint32_t reclog_scan_segment (mp_obj_t file, mp_obj_t out, uint32_t *skip, uint32_t *max, bool *torn) {
+    uint32_t offset = 0;
+    int errcode;
+
+    *torn = false;
+    while (out == MP_OBJ_NULL || *max > 0) {
+        reclog_record_hdr_t hdr;
+        mp_uint_t n = mp_stream_rw(file, &hdr, sizeof(hdr), &errcode, MP_STREAM_RW_READ);
+        if (errcode != 0) {
+            mp_raise_OSError(errcode);
+        }
+        if (n == 0) {
+            break;
+        }
+        if (n != sizeof(hdr) || hdr.magic != RECLOG_RECORD_MAGIC) {
+            *torn = true;
+            break;
+        }
+
+        vstr_t vstr;
+        vstr_init_len(&vstr, hdr.len);
+        n = mp_stream_rw(file, vstr.buf, hdr.len, &errcode, MP_STREAM_RW_READ);
+        if (errcode != 0) {
+            vstr_clear(&vstr);
+            mp_raise_OSError(errcode);
+        }
+        if (n != hdr.len || hdr.crc != crc32_le(0, (uint8_t *)vstr.buf, hdr.len)) {
+            vstr_clear(&vstr);
+            *torn = true;
+            break;
+        }
+        offset += sizeof(hdr) + hdr.len;
+
+        if (out != MP_OBJ_NULL && *skip == 0) {
+            mp_obj_list_append(out, mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr));
+            (*max)--;
+        } else {
+            if (out != MP_OBJ_NULL) {
+                (*skip)--;
+            }
+            vstr_clear(&vstr);
+        }
+    }
+    return offset;
+}
+
+STATIC void reclog_start_segment (reclog_obj_t *self, uint32_t seq) {
+    self->file = reclog_open_file(reclog_segment_path(self, seq), MP_QSTR_wb);
+    self->last_seq = seq;
+    self->segment_len = 0;
+
+    // drop the oldest segments
+    while (self->last_seq - self->first_seq + 1 > self->segments) {
+        mp_vfs_remove(reclog_segment_path(self, self->first_seq));
+        self->first_seq++;
+    }
+}
+
+STATIC void reclog_rotate (reclog_obj_t *self) {
+    reclog_flush_buffer(self);
+    mp_stream_close(self->file);
+    self->file = MP_OBJ_NULL;
+    reclog_start_segment(self, self->last_seq + 1);
+}
+
+// finds the existing segments and resumes appending to the newest one
+STATIC void reclog_recover (reclog_obj_t *self) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_vfs_mkdir(self->dir);
+        nlr_pop();
+    }
+
+    bool found = false;
+    mp_obj_t iter = mp_getiter(mp_vfs_ilistdir(1, &self->dir), NULL);
+    mp_obj_t next;
+    while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        size_t n_items;
+        mp_obj_t *items;
+        mp_obj_get_array(next, &n_items, &items);
+        uint32_t seq;
+        if (reclog_parse_segment_name(mp_obj_str_get_str(items[0]), &seq)) {
+            if (!found || seq < self->first_seq) {
+                self->first_seq = seq;
+            }
+            if (!found || seq > self->last_seq) {
+                self->last_seq = seq;
+            }
+            found = true;
+        }
+    }
+
+    if (!found) {
+        self->first_seq = 0;
+        reclog_start_segment(self, 0);
+        return;
+    }
+
+    mp_obj_t path = reclog_segment_path(self, self->last_seq);
+    mp_obj_t file = reclog_open_file(path, MP_QSTR_rb);
+    bool torn;
+    uint32_t end = reclog_scan_segment(file, MP_OBJ_NULL, NULL, NULL, &torn);
+    mp_stream_close(file);
+
+    if (torn) {
+        // never append behind a damaged record, it would hide everything after it
+        reclog_start_segment(self, self->last_seq + 1);
+    } else {
+        self->file = reclog_open_file(path, MP_QSTR_ab);
+        self->segment_len = end;
+        // keep the configured number of segments if it shrunk since the last run
+        while (self->last_seq - self->first_seq + 1 > self->segments) {
+            mp_vfs_remove(reclog_segment_path(self, self->first_seq));
+            self->first_seq++;
+        }
+    }
+}
+
+STATIC reclog_obj_t *reclog_get_open (mp_obj_t self_in) {
+    reclog_obj_t *self = self_in;
+    if (self->file == MP_OBJ_NULL) {
+        mp_raise_msg(&mp_type_OSError, mpexception_os_request_not_possible);
+    }
+    return self;
+}
+
+/******************************************************************************/
+// Micro Python bindings; Log class
+
+STATIC mp_obj_t reclog_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_path,                         MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_segment_size,                 MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = RECLOG_SEGMENT_SIZE_DEFAULT} },
+        { MP_QSTR_segments,                     MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = RECLOG_SEGMENTS_DEFAULT} },
+        { MP_QSTR_buffer_size,                  MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = RECLOG_BUFFER_SIZE_DEFAULT} },
+        { MP_QSTR_sync,                         MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 0} },
+    };
+
+    // parse arguments
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, all_args, &kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    const char *path = mp_obj_str_get_str(args[0].u_obj);
+    size_t path_len = strlen(path);
+    while (path_len > 1 && path[path_len - 1] == '/') {
+        path_len--;
+    }
+    if (args[1].u_int < (sizeof(reclog_record_hdr_t) + 1) || args[2].u_int < 1 || args[2].u_int > UINT16_MAX ||
+        args[3].u_int < sizeof(reclog_record_hdr_t) || args[4].u_int < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    reclog_obj_t *self = m_new_obj(reclog_obj_t);
+    self->base.type = &reclog_type;
+    self->dir = mp_obj_new_str(path, path_len);
+    self->file = MP_OBJ_NULL;
+    self->segment_size = args[1].u_int;
+    self->segments = args[2].u_int;
+    self->buffer_size = args[3].u_int;
+    self->buffer_len = 0;
+    self->buffer = m_new(uint8_t, self->buffer_size);
+    self->sync = args[4].u_int;
+    self->unsynced = 0;
+    self->first_seq = 0;
+    self->last_seq = 0;
+    self->segment_len = 0;
+
+    reclog_recover(self);
+
+    return self;
+}
+
+STATIC mp_obj_t reclog_append(mp_obj_t self_in, mp_obj_t data) {
+    reclog_obj_t *self = reclog_get_open(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+
+    uint32_t rec_size = sizeof(reclog_record_hdr_t) + bufinfo.len;
+    if (bufinfo.len > UINT16_MAX || rec_size > self->segment_size) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "record too long"));
+    }
+
+    if (self->segment_len + rec_size > self->segment_size) {
+        reclog_rotate(self);
+    }
+
+    reclog_record_hdr_t hdr = {
+        .magic = RECLOG_RECORD_MAGIC,
+        .len = bufinfo.len,
+        .crc = crc32_le(0, bufinfo.buf, bufinfo.len),
+    };
+
+    if (self->buffer_len + rec_size > self->buffer_size) {
+        reclog_flush_buffer(self);
+    }
+    if (rec_size > self->buffer_size) {
+        // doesn't fit in the batch, write it on its own
+        reclog_write(self->file, &hdr, sizeof(hdr));
+        reclog_write(self->file, bufinfo.buf, bufinfo.len);
+        self->segment_len += rec_size;
+        reclog_sync(self->file);
+        self->unsynced = 0;
+    } else {
+        memcpy(&self->buffer[self->buffer_len], &hdr, sizeof(hdr));
+        memcpy(&self->buffer[self->buffer_len + sizeof(hdr)], bufinfo.buf, bufinfo.len);
+        self->buffer_len += rec_size;
+        self->segment_len += rec_size;
+        if (self->sync > 0 && ++self->unsynced >= self->sync) {
+            reclog_flush_buffer(self);
+        }
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(reclog_append_obj, reclog_append);
+
+STATIC mp_obj_t reclog_flush(mp_obj_t self_in) {
+    reclog_obj_t *self = reclog_get_open(self_in);
+    reclog_flush_buffer(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(reclog_flush_obj, reclog_flush);
+
+// returns a list with up to n records, oldest first, after skipping the first `start` ones
+STATIC mp_obj_t reclog_read(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_start,                        MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_n,                            MP_ARG_INT, {.u_int = -1} },
+    };
+
+    reclog_obj_t *self = reclog_get_open(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    uint32_t skip = (args[0].u_int > 0) ? args[0].u_int : 0;
+    uint32_t max = (args[1].u_int >= 0) ? args[1].u_int : UINT32_MAX;
+
+    // whatever is still batched has to be visible
+    reclog_flush_buffer(self);
+
+    mp_obj_t out = mp_obj_new_list(0, NULL);
+    for (uint32_t seq = self->first_seq; seq <= self->last_seq && max > 0; seq++) {
+        mp_obj_t file = reclog_open_file(reclog_segment_path(self, seq), MP_QSTR_rb);
+        bool torn;
+        reclog_scan_segment(file, out, &skip, &max, &torn);
+        mp_stream_close(file);
+    }
+    return out;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(reclog_read_obj, 1, reclog_read);
+
+STATIC mp_obj_t reclog_clear(mp_obj_t self_in) {
+    reclog_obj_t *self = reclog_get_open(self_in);
+    self->buffer_len = 0;
+    mp_stream_close(self->file);
+    self->file = MP_OBJ_NULL;
+    for (uint32_t seq = self->first_seq; seq <= self->last_seq; seq++) {
+        mp_vfs_remove(reclog_segment_path(self, seq));
+    }
+    self->first_seq = self->last_seq + 1;
+    reclog_start_segment(self, self->first_seq);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(reclog_clear_obj, reclog_clear);
+
+STATIC mp_obj_t reclog_close(mp_obj_t self_in) {
+    reclog_obj_t *self = self_in;
+    if (self->file != MP_OBJ_NULL) {
+        mp_obj_t file = self->file;
+        self->file = MP_OBJ_NULL;
+        if (self->buffer_len > 0) {
+            uint32_t len = self->buffer_len;
+            self->buffer_len = 0;
+            reclog_write(file, self->buffer, len);
+        }
+        mp_stream_close(file);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(reclog_close_obj, reclog_close);
+
+STATIC mp_obj_t reclog___exit__(size_t n_args, const mp_obj_t *args) {
+    return reclog_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(reclog___exit___obj, 4, 4, reclog___exit__);
+
+STATIC const mp_map_elem_t reclog_locals_dict_table[] = {
+    // instance methods
+    { MP_OBJ_NEW_QSTR(MP_QSTR_append),                  (mp_obj_t)&reclog_append_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_flush),                   (mp_obj_t)&reclog_flush_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read),                    (mp_obj_t)&reclog_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_clear),                   (mp_obj_t)&reclog_clear_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_close),                   (mp_obj_t)&reclog_close_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___enter__),               (mp_obj_t)&mp_identity_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___exit__),                (mp_obj_t)&reclog___exit___obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(reclog_locals_dict, reclog_locals_dict_table);
+
+STATIC const mp_obj_type_t reclog_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Log,
+    .make_new = reclog_make_new,
+    .locals_dict = (mp_obj_t)&reclog_locals_dict,
+};
+
+STATIC const mp_map_elem_t mp_module_reclog_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__),            MP_OBJ_NEW_QSTR(MP_QSTR_reclog) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Log),                 (mp_obj_t)&reclog_type },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_reclog_globals, mp_module_reclog_globals_table);
+
+const mp_obj_module_t mp_module_ureclog = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_reclog_globals,
+};
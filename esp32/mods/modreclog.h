@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MODRECLOG_H_
+#define MODRECLOG_H_
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define RECLOG_RECORD_MAGIC                         (0x5AA5)
+#define RECLOG_SEGMENT_SIZE_DEFAULT                 (16 * 1024)
+#define RECLOG_SEGMENTS_DEFAULT                     (4)
+#define RECLOG_BUFFER_SIZE_DEFAULT                  (4096)      // one flash block
+#define RECLOG_SEGMENT_NAME_LEN                     (12)        // "%08x.seg"
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// stored in front of every record, the CRC covers the payload
+typedef struct {
+    uint16_t magic;
+    uint16_t len;
+    uint32_t crc;
+} reclog_record_hdr_t;
+
+typedef struct _reclog_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t    dir;            // directory holding the segment files
+    mp_obj_t    file;           // segment being appended to, MP_OBJ_NULL once closed
+    uint8_t     *buffer;        // records not written to the segment yet
+    uint32_t    buffer_size;
+    uint32_t    buffer_len;
+    uint32_t    segment_size;
+    uint32_t    segment_len;    // bytes in the current segment, buffered ones included
+    uint32_t    first_seq;      // oldest segment kept
+    uint32_t    last_seq;       // segment being appended to
+    uint32_t    sync;           // records between forced flushes, 0 if only when the buffer is full
+    uint32_t    unsynced;       // records appended since the last flush
+    uint16_t    segments;       // segments kept before the oldest one is dropped
+} reclog_obj_t;
+
+#endif /* MODRECLOG_H_ */
@@ -21,11 +21,205 @@
 #include "mpexception.h"
 #include "py/stream.h"
 #include "esp32_mphal.h"
+#include "mpirq.h"
 
 #include "modnetwork.h"
 #include "modusocket.h"
 
 #include "sigfox/modsigfox.h"
+#if defined(FIPY) || defined(LOPY4)
+#include "lora/radiosched.h"
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MODSIGFOX_ASYNC_QUEUE_SIZE                  (4)
+#define MODSIGFOX_ASYNC_STACK_SIZE                  (2048)
+#define MODSIGFOX_ASYNC_TASK_PRIORITY               (5)
+#define MODSIGFOX_ASYNC_IDLE_POLL_MS                (10)
+
+// callback events
+#define MODSIGFOX_RX_EVENT                          (0x01)
+#define MODSIGFOX_TX_EVENT                          (0x02)
+#define MODSIGFOX_TX_FAILED_EVENT                   (0x04)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    mod_network_socket_obj_t sock;      // a copy, the frame goes out with the options it was sent with
+    uint8_t len;
+    uint8_t data[FSK_TX_PAYLOAD_SIZE_MAX];
+} modsigfox_async_frame_t;
+
+typedef struct {
+    QueueHandle_t queue;                // the frame on the air stays at the head until it's done
+    TaskHandle_t task;
+    mp_obj_t handler;
+    mp_obj_t handler_arg;
+    volatile uint8_t events;
+    uint8_t trigger;
+} modsigfox_async_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC modsigfox_async_t sigfox_async;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC bool modsigfox_async_init0 (void);
+STATIC void modsigfox_async_wait_idle (void);
+STATIC void modsigfox_async_callback_handler (void *arg);
+STATIC void TASK_SigfoxAsync (void *pvParameters);
+STATIC void modsigfox_radio_used (void);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void modsigfox_async_deinit0 (void) {
+    // the frames already accepted still go out, they don't reference the heap
+    sigfox_async.trigger = 0;
+    sigfox_async.events = 0;
+    INTERRUPT_OBJ_CLEAN(&sigfox_async);
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC bool modsigfox_async_init0 (void) {
+    if (sigfox_async.queue) {
+        return true;
+    }
+    sigfox_async.queue = xQueueCreate(MODSIGFOX_ASYNC_QUEUE_SIZE, sizeof(modsigfox_async_frame_t));
+    if (!sigfox_async.queue) {
+        return false;
+    }
+    if (pdPASS != xTaskCreatePinnedToCore(TASK_SigfoxAsync, "SigfoxAsync", MODSIGFOX_ASYNC_STACK_SIZE / sizeof(StackType_t),
+                                          NULL, MODSIGFOX_ASYNC_TASK_PRIORITY, &sigfox_async.task, 1)) {
+        vQueueDelete(sigfox_async.queue);
+        sigfox_async.queue = NULL;
+        return false;
+    }
+    return true;
+}
+
+// the library runs a single command at a time, anything that talks to its task waits for the queue to drain
+STATIC void modsigfox_async_wait_idle (void) {
+    while (sigfox_async.queue && uxQueueMessagesWaiting(sigfox_async.queue) > 0) {
+        // releases the GIL meanwhile
+        mp_hal_delay_ms(MODSIGFOX_ASYNC_IDLE_POLL_MS);
+    }
+}
+
+// the library shares the radio with LoRa but drives it on its own
+STATIC void modsigfox_radio_used (void) {
+#if defined(FIPY) || defined(LOPY4)
+    radiosched_foreign(E_RADIOSCHED_SIGFOX, 0);
+#endif
+}
+
+STATIC void modsigfox_async_callback_handler (void *arg) {
+    modsigfox_async_t *self = arg;
+
+    if (self->handler && self->handler != mp_const_none) {
+        mp_call_function_1(self->handler, self->handler_arg);
+    }
+}
+
+// sigfox_socket_send() only queues the command to the library task and waits for its completion bits,
+// it doesn't touch the heap nor raise, so it can block here instead of in the interpreter
+STATIC void TASK_SigfoxAsync (void *pvParameters) {
+    static modsigfox_async_frame_t frame;
+
+    for (;;) {
+        xQueuePeek(sigfox_async.queue, &frame, portMAX_DELAY);
+
+        int _errno = 0;
+        uint8_t events;
+        int ret = sigfox_socket_send(&frame.sock, frame.data, frame.len, &_errno);
+        modsigfox_radio_used();
+        if (ret < 0) {
+            events = MODSIGFOX_TX_FAILED_EVENT;
+        } else {
+            events = MODSIGFOX_TX_EVENT;
+            // with SO_RX set the library has waited for the downlink window as well
+            if (sigfox_socket_ioctl(&frame.sock, MP_STREAM_POLL, MP_STREAM_POLL_RD, &_errno) & MP_STREAM_POLL_RD) {
+                events |= MODSIGFOX_RX_EVENT;
+            }
+        }
+        // done, the next frame or a blocking call can talk to the library now
+        xQueueReceive(sigfox_async.queue, &frame, 0);
+
+        sigfox_async.events |= events;
+        if (sigfox_async.trigger & events) {
+            mp_irq_queue_interrupt_non_ISR(modsigfox_async_callback_handler, (void *)&sigfox_async);
+        }
+    }
+}
+
+/******************************************************************************/
+// Micro Python bindings; Sigfox socket
+
+// a non-blocking socket queues the frame and returns, the completion is reported through events()
+STATIC int modsigfox_socket_send (mod_network_socket_obj_t *s, const byte *buf, mp_uint_t len, int *_errno) {
+    if (s->sock_base.timeout != 0) {
+        // it must not overtake the frames queued before
+        modsigfox_async_wait_idle();
+        int ret = sigfox_socket_send(s, buf, len, _errno);
+        modsigfox_radio_used();
+        return ret;
+    }
+
+    mp_uint_t max_len = (sigfox_obj.mode == E_SIGFOX_MODE_SIGFOX) ? SIGFOX_TX_PAYLOAD_SIZE_MAX : FSK_TX_PAYLOAD_SIZE_MAX;
+    if (len > max_len) {
+        *_errno = MP_EMSGSIZE;
+        return -1;
+    }
+
+    if (!modsigfox_async_init0()) {
+        *_errno = MP_ENOMEM;
+        return -1;
+    }
+
+    modsigfox_async_frame_t frame;
+    memcpy(&frame.sock, s, sizeof(frame.sock));
+    frame.sock.sock_base.timeout = -1;
+    frame.len = len;
+    memcpy(frame.data, buf, len);
+    if (xQueueSend(sigfox_async.queue, &frame, 0) != pdTRUE) {
+        *_errno = MP_EAGAIN;
+        return -1;
+    }
+    return len;
+}
+
+STATIC int modsigfox_socket_settimeout (mod_network_socket_obj_t *s, mp_int_t timeout_ms, int *_errno) {
+    if (sigfox_socket_settimeout(s, timeout_ms, _errno) != 0) {
+        return -1;
+    }
+    // the send path above decides on it
+    s->sock_base.timeout = timeout_ms;
+    return 0;
+}
+
+STATIC int modsigfox_socket_ioctl (mod_network_socket_obj_t *s, mp_uint_t request, mp_uint_t arg, int *_errno) {
+    int ret = sigfox_socket_ioctl(s, request, arg, _errno);
+    if (request == MP_STREAM_POLL && ret != MP_STREAM_ERROR && sigfox_async.queue &&
+        uxQueueSpacesAvailable(sigfox_async.queue) == 0) {
+        ret &= ~MP_STREAM_POLL_WR;
+    }
+    return ret;
+}
+
+/******************************************************************************/
+// Micro Python bindings; Sigfox class
 
 
 STATIC const mp_arg_t sigfox_init_args[] = {
@@ -56,8 +250,10 @@ STATIC mp_obj_t sigfox_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_
 
     // run the constructor if the peripehral is not initialized or extra parameters are given
     if (n_kw > 0 || self->state == E_SIGFOX_STATE_NOINIT) {
+        modsigfox_async_wait_idle();
         // start the peripheral
         sigfox_init_helper(self, &args[1]);
+        modsigfox_radio_used();
         // register it as a network card
         mod_network_register_nic(self);
     }
@@ -69,15 +265,28 @@ STATIC mp_obj_t sigfox_init(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
     // parse args
     mp_arg_val_t args[MP_ARRAY_SIZE(sigfox_init_args) - 1];
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), &sigfox_init_args[1], args);
-    return sigfox_init_helper(pos_args[0], args);
+    modsigfox_async_wait_idle();
+    mp_obj_t ret = sigfox_init_helper(pos_args[0], args);
+    modsigfox_radio_used();
+    return ret;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sigfox_init_obj, 1, sigfox_init);
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_mac_obj, sigfox_mac);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_id_obj, sigfox_id);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_pac_obj, sigfox_pac);
-STATIC MP_DEFINE_CONST_FUN_OBJ_3(sigfox_test_mode_obj, sigfox_test_mode);
-STATIC MP_DEFINE_CONST_FUN_OBJ_3(sigfox_cw_obj, sigfox_cw);
+
+STATIC mp_obj_t modsigfox_test_mode(mp_obj_t self_in, mp_obj_t mode, mp_obj_t config) {
+    modsigfox_async_wait_idle();
+    return sigfox_test_mode(self_in, mode, config);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(sigfox_test_mode_obj, modsigfox_test_mode);
+
+STATIC mp_obj_t modsigfox_cw(mp_obj_t self_in, mp_obj_t frequency, mp_obj_t start) {
+    modsigfox_async_wait_idle();
+    return sigfox_cw(self_in, frequency, start);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(sigfox_cw_obj, modsigfox_cw);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_frequencies_obj, sigfox_frequencies);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sigfox_config_obj, 1, 2, sigfox_config);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sigfox_public_key_obj, 1, 2, sigfox_public_key);
@@ -88,6 +297,53 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_version_obj, sigfox_version);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_info_obj, sigfox_info);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_reset_obj, sigfox_reset);
 
+/// \method callback(trigger, handler, arg)
+STATIC mp_obj_t sigfox_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_trigger,      MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_handler,      MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+        { MP_QSTR_arg,          MP_ARG_OBJ,                     {.u_obj = mp_const_none} },
+    };
+
+    // parse arguments
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    // enable the callback
+    if (args[0].u_obj != mp_const_none && args[1].u_obj != mp_const_none) {
+        sigfox_async.handler = args[1].u_obj;
+        if (args[2].u_obj == mp_const_none) {
+            sigfox_async.handler_arg = pos_args[0];
+        } else {
+            sigfox_async.handler_arg = args[2].u_obj;
+        }
+        // keeps both reachable for the GC, the object above is static
+        mp_obj_t refs[2] = { sigfox_async.handler, sigfox_async.handler_arg };
+        mp_irq_add(pos_args[0], mp_obj_new_tuple(2, refs));
+        sigfox_async.trigger = mp_obj_get_int(args[0].u_obj);
+    } else {
+        sigfox_async.trigger = 0;
+        mp_irq_remove(pos_args[0]);
+        INTERRUPT_OBJ_CLEAN(&sigfox_async);
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sigfox_callback_obj, 1, sigfox_callback);
+
+STATIC mp_obj_t sigfox_events(mp_obj_t self_in) {
+    uint8_t events = sigfox_async.events;
+    // the task may be setting new ones meanwhile
+    sigfox_async.events &= ~events;
+    return mp_obj_new_int(events);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_events_obj, sigfox_events);
+
+STATIC mp_obj_t sigfox_pending(mp_obj_t self_in) {
+    return mp_obj_new_int(sigfox_async.queue ? uxQueueMessagesWaiting(sigfox_async.queue) : 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sigfox_pending_obj, sigfox_pending);
+
 
 STATIC const mp_map_elem_t sigfox_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&sigfox_init_obj },
@@ -105,6 +361,9 @@ STATIC const mp_map_elem_t sigfox_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_freq_offset),         (mp_obj_t)&sigfox_freq_offset_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_info),                (mp_obj_t)&sigfox_info_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_reset),               (mp_obj_t)&sigfox_reset_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_callback),            (mp_obj_t)&sigfox_callback_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_events),              (mp_obj_t)&sigfox_events_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pending),             (mp_obj_t)&sigfox_pending_obj },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_SIGFOX),              MP_OBJ_NEW_SMALL_INT(E_SIGFOX_MODE_SIGFOX) },
 #if !defined(FIPY) && !defined(LOPY4)
@@ -115,6 +374,10 @@ STATIC const mp_map_elem_t sigfox_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_RCZ2),                MP_OBJ_NEW_SMALL_INT(E_SIGFOX_RCZ2) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_RCZ3),                MP_OBJ_NEW_SMALL_INT(E_SIGFOX_RCZ3) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_RCZ4),                MP_OBJ_NEW_SMALL_INT(E_SIGFOX_RCZ4) },
+
+    { MP_OBJ_NEW_QSTR(MP_QSTR_RX_PACKET_EVENT),     MP_OBJ_NEW_SMALL_INT(MODSIGFOX_RX_EVENT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TX_PACKET_EVENT),     MP_OBJ_NEW_SMALL_INT(MODSIGFOX_TX_EVENT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TX_FAILED_EVENT),     MP_OBJ_NEW_SMALL_INT(MODSIGFOX_TX_FAILED_EVENT) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(sigfox_locals_dict, sigfox_locals_dict_table);
@@ -129,9 +392,9 @@ const mod_network_nic_type_t mod_network_nic_type_sigfox = {
 
     .n_socket = sigfox_socket_socket,
     .n_close = sigfox_socket_close,
-    .n_send = sigfox_socket_send,
+    .n_send = modsigfox_socket_send,
     .n_recv = sigfox_socket_recv,
-    .n_settimeout = sigfox_socket_settimeout,
+    .n_settimeout = modsigfox_socket_settimeout,
     .n_setsockopt = sigfox_socket_setsockopt,
-    .n_ioctl = sigfox_socket_ioctl,
+    .n_ioctl = modsigfox_socket_ioctl,
 };
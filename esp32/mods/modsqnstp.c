@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+/*
+ * Native side of the Sequans STP transfer done by the frozen sqnstp.py. The
+ * Python code opens the session, push() then sends the whole image: it reads
+ * the blob in large chunks and runs the TRANSFER_BLOCK_CMD / TRANSFER_BLOCK
+ * exchange for every block without going back to Python, with the same retries
+ * as Master.send_data(). Each request goes to the UART with one write, the
+ * responses are read with a deadline instead of polling every 2 ms.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/obj.h"
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mphal.h"
+#include "py/mperrno.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define SQNSTP_MREQ_SIGNATURE                       (0x66617374)
+#define SQNSTP_SRSP_SIGNATURE                       (0x74736166)
+#define SQNSTP_HEADER_SIZE                          (16)
+#define SQNSTP_TRANSFER_BLOCK_CMD                   (2)
+#define SQNSTP_TRANSFER_BLOCK                       (3)
+#define SQNSTP_ACK                                  (0x80)
+#define SQNSTP_BLOCK_SIZE_MAX                       (2048 - 32)     // limitation of the 31x0 MII
+#define SQNSTP_CHUNK_SIZE                           (16 * 1024)     // read from the blob at once
+#define SQNSTP_TRIALS                               (4)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    E_SQNSTP_OK = 0,
+    E_SQNSTP_HEADER,            // no valid response header, the request is sent again
+    E_SQNSTP_SESSION,           // valid header of another request
+} sqnstp_status_t;
+
+typedef struct {
+    mp_obj_t                uart;
+    const mp_stream_p_t     *stream;
+    uint8_t                 sid;
+    uint32_t                tid;
+    uint32_t                timeout_ms;
+    uint8_t                 *tx;        // header and payload of one request
+} sqnstp_session_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+// CRC-16/CCITT, polynomial 0x1021 and initial value 0
+STATIC const uint16_t sqnstp_crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC uint16_t sqnstp_crc16 (uint16_t crc, const uint8_t *data, size_t len) {
+    while (len--) {
+        crc = (crc << 8) ^ sqnstp_crc16_table[((crc >> 8) ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+STATIC void sqnstp_put_u16 (uint8_t *p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+STATIC void sqnstp_put_u32 (uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+STATIC uint16_t sqnstp_get_u16 (const uint8_t *p) {
+    return (p[0] << 8) | p[1];
+}
+
+STATIC uint32_t sqnstp_get_u32 (const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// ">IBBHIHH": signature, op, sid, payload length, tid, header CRC, payload CRC
+STATIC void sqnstp_pack_header (uint8_t *h, uint32_t signature, uint8_t op, uint8_t sid, uint16_t plen,
+                                uint32_t tid, uint16_t hcrc, uint16_t pcrc) {
+    sqnstp_put_u32(&h[0], signature);
+    h[4] = op;
+    h[5] = sid;
+    sqnstp_put_u16(&h[6], plen);
+    sqnstp_put_u32(&h[8], tid);
+    sqnstp_put_u16(&h[12], hcrc);
+    sqnstp_put_u16(&h[14], pcrc);
+}
+
+STATIC void sqnstp_write (sqnstp_session_t *s, const uint8_t *buf, size_t len) {
+    int errcode;
+    while (len > 0) {
+        mp_uint_t n = s->stream->write(s->uart, buf, len, &errcode);
+        if (n == MP_STREAM_ERROR) {
+            if (errcode == MP_EAGAIN) {
+                continue;
+            }
+            mp_raise_OSError(errcode);
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+// false if the bytes didn't all arrive before the deadline
+STATIC bool sqnstp_read (sqnstp_session_t *s, uint8_t *buf, size_t len) {
+    uint32_t start = mp_hal_ticks_ms();
+    int errcode;
+    while (len > 0) {
+        mp_uint_t n = s->stream->read(s->uart, buf, len, &errcode);
+        if (n == MP_STREAM_ERROR) {
+            if (errcode != MP_EAGAIN) {
+                mp_raise_OSError(errcode);
+            }
+            n = 0;
+        }
+        buf += n;
+        len -= n;
+        if (len > 0 && (mp_hal_ticks_ms() - start) >= s->timeout_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
+STATIC void sqnstp_send_mreq (sqnstp_session_t *s, uint8_t op, const uint8_t *pld, uint16_t len) {
+    uint16_t pcrc = (len > 0) ? sqnstp_crc16(0, pld, len) : 0;
+    sqnstp_pack_header(s->tx, SQNSTP_MREQ_SIGNATURE, op, s->sid, len, s->tid, 0, pcrc);
+    sqnstp_put_u16(&s->tx[12], sqnstp_crc16(0, s->tx, SQNSTP_HEADER_SIZE));
+    memcpy(&s->tx[SQNSTP_HEADER_SIZE], pld, len);
+    sqnstp_write(s, s->tx, SQNSTP_HEADER_SIZE + len);
+}
+
+STATIC sqnstp_status_t sqnstp_recv_srsp (sqnstp_session_t *s, uint8_t op, uint16_t *plen, uint16_t *pcrc) {
+    uint8_t h[SQNSTP_HEADER_SIZE];
+
+    if (!sqnstp_read(s, h, sizeof(h)) || sqnstp_get_u32(&h[0]) != SQNSTP_SRSP_SIGNATURE) {
+        return E_SQNSTP_HEADER;
+    }
+    uint16_t hcrc = sqnstp_get_u16(&h[12]);
+    if (hcrc != 0) {
+        sqnstp_put_u16(&h[12], 0);
+        if (sqnstp_crc16(0, h, sizeof(h)) != hcrc) {
+            return E_SQNSTP_HEADER;
+        }
+    }
+    if (h[4] != (op | SQNSTP_ACK) || h[5] != s->sid || sqnstp_get_u32(&h[8]) != s->tid) {
+        return E_SQNSTP_SESSION;
+    }
+    *plen = sqnstp_get_u16(&h[6]);
+    *pcrc = sqnstp_get_u16(&h[14]);
+    return E_SQNSTP_OK;
+}
+
+// sends the request until a valid response header comes back
+STATIC sqnstp_status_t sqnstp_request (sqnstp_session_t *s, uint8_t op, const uint8_t *pld, uint16_t len,
+                                       uint16_t *plen, uint16_t *pcrc) {
+    for (int trials = SQNSTP_TRIALS; ; ) {
+        sqnstp_send_mreq(s, op, pld, len);
+        sqnstp_status_t status = sqnstp_recv_srsp(s, op, plen, pcrc);
+        if (status != E_SQNSTP_HEADER) {
+            return status;
+        }
+        if (--trials == 0) {
+            mp_raise_OSError(MP_ETIMEDOUT);
+        }
+    }
+}
+
+// returns the bytes the modem took, one TRANSFER_BLOCK_CMD and TRANSFER_BLOCK exchange per try
+STATIC uint16_t sqnstp_send_block (sqnstp_session_t *s, const uint8_t *data, uint16_t len, int *trials) {
+    uint16_t plen, pcrc;
+    uint8_t cmd[2];
+    uint8_t rsp[2];
+
+    for ( ; ; ) {
+        sqnstp_put_u16(cmd, len);
+        if (sqnstp_request(s, SQNSTP_TRANSFER_BLOCK_CMD, cmd, sizeof(cmd), &plen, &pcrc) != E_SQNSTP_OK) {
+            goto retry;
+        }
+        s->tid++;
+
+        while (sqnstp_request(s, SQNSTP_TRANSFER_BLOCK, data, len, &plen, &pcrc) != E_SQNSTP_OK) {
+            if (--(*trials) <= 0) {
+                mp_raise_OSError(MP_EIO);
+            }
+        }
+        if (!sqnstp_read(s, rsp, sizeof(rsp)) || plen != sizeof(rsp) || (pcrc != 0 && pcrc != sqnstp_crc16(0, rsp, sizeof(rsp)))) {
+            goto retry;
+        }
+        s->tid++;
+
+        // the residue is what the modem didn't consume
+        uint16_t residue = sqnstp_get_u16(rsp);
+        return (residue < len) ? (len - residue) : 0;
+
+retry:
+        if (--(*trials) <= 0) {
+            mp_raise_OSError(MP_EIO);
+        }
+    }
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+STATIC mp_obj_t sqnstp_crc16_fun (size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    uint16_t crc = (n_args > 1) ? mp_obj_get_int(args[1]) : 0;
+    return MP_OBJ_NEW_SMALL_INT(sqnstp_crc16(crc, bufinfo.buf, bufinfo.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sqnstp_crc16_obj, 1, 2, sqnstp_crc16_fun);
+
+// the sums of sqnscrc.fletcher32(), over big endian 16-bit words
+STATIC mp_obj_t sqnstp_fletcher32 (mp_obj_t data_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data_in, &bufinfo, MP_BUFFER_READ);
+    const uint8_t *data = bufinfo.buf;
+    size_t len = bufinfo.len;
+    uint32_t s1 = 0xFFFF, s2 = 0xFFFF;
+
+    while (len > 1) {
+        // 360 words at most before the sums are folded, they can't overflow
+        size_t words = MIN(len / 2, 360);
+        len -= words * 2;
+        while (words--) {
+            s1 += (data[0] << 8) | data[1];
+            s2 += s1;
+            data += 2;
+        }
+        s1 = (s1 & 0xFFFF) + (s1 >> 16);
+        s2 = (s2 & 0xFFFF) + (s2 >> 16);
+    }
+    if (len & 1) {
+        s1 += *data << 8;
+        s2 += s1;
+        s1 = (s1 & 0xFFFF) + (s1 >> 16);
+        s2 = (s2 & 0xFFFF) + (s2 >> 16);
+    }
+    s1 = (s1 & 0xFFFF) + (s1 >> 16);
+    s2 = (s2 & 0xFFFF) + (s2 >> 16);
+    return mp_obj_new_int_from_uint((s2 << 16) | s1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sqnstp_fletcher32_obj, sqnstp_fletcher32);
+
+// push(uart, blob, *, sid, tid, max_transfer, timeout=90000, progress=None), returns the next tid
+STATIC mp_obj_t sqnstp_push (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_uart,             MP_ARG_REQUIRED | MP_ARG_OBJ,   {.u_obj = mp_const_none} },
+        { MP_QSTR_blob,             MP_ARG_REQUIRED | MP_ARG_OBJ,   {.u_obj = mp_const_none} },
+        { MP_QSTR_sid,              MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_tid,              MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_max_transfer,     MP_ARG_KW_ONLY | MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_timeout,          MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 90000} },
+        { MP_QSTR_progress,         MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (args[4].u_int <= SQNSTP_HEADER_SIZE) {
+        mp_raise_ValueError("max_transfer too small");
+    }
+    uint16_t block_max = MIN(args[4].u_int - SQNSTP_HEADER_SIZE, SQNSTP_BLOCK_SIZE_MAX);
+    sqnstp_session_t s = {
+        .uart = args[0].u_obj,
+        .stream = mp_get_stream_raise(args[0].u_obj, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE),
+        .sid = args[2].u_int,
+        .tid = args[3].u_int,
+        .timeout_ms = args[5].u_int,
+        .tx = m_new(uint8_t, SQNSTP_HEADER_SIZE + block_max),
+    };
+    mp_obj_t read_method[3];
+    mp_load_method(args[1].u_obj, MP_QSTR_read, read_method);
+    read_method[2] = MP_OBJ_NEW_SMALL_INT(SQNSTP_CHUNK_SIZE);
+    int trials = SQNSTP_TRIALS;
+    mp_uint_t downloaded = 0;
+
+    for ( ; ; ) {
+        mp_buffer_info_t chunk;
+        mp_obj_t data = mp_call_method_n_kw(1, 0, read_method);
+        mp_get_buffer_raise(data, &chunk, MP_BUFFER_READ);
+        if (chunk.len == 0) {
+            break;
+        }
+        const uint8_t *pos = chunk.buf;
+        size_t left = chunk.len;
+        while (left > 0) {
+            uint16_t taken = sqnstp_send_block(&s, pos, MIN(left, block_max), &trials);
+            pos += taken;
+            left -= taken;
+            downloaded += taken;
+        }
+        if (args[6].u_obj != mp_const_none) {
+            mp_call_function_1(args[6].u_obj, mp_obj_new_int_from_uint(downloaded));
+        }
+    }
+    m_del(uint8_t, s.tx, SQNSTP_HEADER_SIZE + block_max);
+    return mp_obj_new_int_from_uint(s.tid);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sqnstp_push_obj, 2, sqnstp_push);
+
+STATIC const mp_map_elem_t mp_module_sqnstp_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__),            MP_OBJ_NEW_QSTR(MP_QSTR_usqnstp) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_crc16),               (mp_obj_t)&sqnstp_crc16_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fletcher32),          (mp_obj_t)&sqnstp_fletcher32_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_push),                (mp_obj_t)&sqnstp_push_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_sqnstp_globals, mp_module_sqnstp_globals_table);
+
+const mp_obj_module_t mp_module_usqnstp = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_sqnstp_globals,
+};
@@ -20,10 +20,12 @@
 #include "mbedtls/entropy.h"
 #include "mbedtls/pk.h"
 #include "mbedtls/ctr_drbg.h"
+#include "mbedtls/ecdsa.h"
 
 /******************************************************************************
  DEFINE CONSTANTS
  ******************************************************************************/
+#define CRYPT_AES_CHUNK_SIZE                (4096)      // bytes handed to the AES module in one go
 
 /******************************************************************************
  DEFINE PRIVATE TYPES
@@ -42,7 +44,7 @@ typedef enum {
 
 typedef struct _mp_obj_AES_t mp_obj_AES_t;
 
-typedef mp_obj_t(*crypt_func_t)(mp_obj_AES_t *, uint32_t, const unsigned char *, uint32_t);
+typedef int(*crypt_func_t)(mp_obj_AES_t *, uint32_t, const unsigned char *, unsigned char *, uint32_t);
 
 typedef struct _mp_obj_AES_t {
     mp_obj_base_t base;
@@ -55,97 +57,130 @@ typedef struct _mp_obj_AES_t {
     uint8_t stream[16]; // used only in CTR
     uint32_t offset;
     crypt_func_t crypt_func;
+    bool block_only;    // ECB and CBC only take whole blocks
 } mp_obj_AES_t;
 
+// a parsed RSA or EC key, with its own random generator
+typedef struct _mp_obj_key_t {
+    mp_obj_base_t base;
+    mbedtls_pk_context pk;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    bool is_private;
+} mp_obj_key_t;
+
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
-STATIC mp_obj_t aes_do_ecb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len);
-STATIC mp_obj_t aes_do_cbc(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len);
-STATIC mp_obj_t aes_do_cfb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len);
-STATIC mp_obj_t aes_do_ctr(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len);
+STATIC int aes_do_ecb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len);
+STATIC int aes_do_cbc(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len);
+STATIC int aes_do_cfb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len);
+STATIC int aes_do_ctr(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len);
 
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
 
-STATIC mp_obj_t aes_do_ecb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len) {
+STATIC int aes_do_ecb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len) {
     int i;
-    uint8_t *output = m_new(uint8_t, len);
-    uint8_t *tmp = output;
-
-    if ((len % 16) != 0) {
-        mp_raise_ValueError("Input strings must be a multiple of 16 in length");
-    }
 
     for (i = len / 16; i > 0; i--) {
-        esp_aes_crypt_ecb(&self->ctx, operation, input, tmp);
+        esp_aes_crypt_ecb(&self->ctx, operation, input, output);
         input += 16;
-        tmp += 16;
+        output += 16;
     }
-
-    return mp_obj_new_bytes(output, len);
+    return 0;
 }
 
-STATIC mp_obj_t aes_do_cbc(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len) {
-    int result;
-    uint8_t *output = m_new(uint8_t, len);
-
-    result = esp_aes_crypt_cbc(&self->ctx, operation, len, self->u.IV, input, output);
+STATIC int aes_do_cbc(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len) {
+    return esp_aes_crypt_cbc(&self->ctx, operation, len, self->u.IV, input, output);
+}
 
-    if (result == ERR_ESP_AES_INVALID_INPUT_LENGTH) {
-        mp_raise_ValueError("Input strings must be a multiple of 16 in length");
+STATIC int aes_do_cfb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len) {
+    if (self->segment_size == CRYPT_SEGMENT_128) {
+        return esp_aes_crypt_cfb128(&self->ctx, operation, len, &self->offset, self->u.IV, input, output);
     }
+    return esp_aes_crypt_cfb8(&self->ctx, operation, len, self->u.IV, input, output);
+}
 
-    return mp_obj_new_bytes(output, len);
+STATIC int aes_do_ctr(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len) {
+    return esp_aes_crypt_ctr(&self->ctx, len, &self->offset, self->u.counter, self->stream, input, output);
 }
 
-STATIC mp_obj_t aes_do_cfb(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len) {
-    int result;
-    uint8_t *output = m_new(uint8_t, len);
+/*
+ * runs the cipher in chunks, the IV, the counter and the offsets carry the state over to the next chunk and to the next call
+ * output can be the same buffer as input
+ */
+STATIC void aes_crypt(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, unsigned char *output, uint32_t len) {
+    int result = 0;
 
-    if (self->segment_size == CRYPT_SEGMENT_128) {
-        result = esp_aes_crypt_cfb128(&self->ctx, operation, len, &self->offset, self->u.IV, input, output);
-    } else {
-        result = esp_aes_crypt_cfb8(&self->ctx, operation, len, self->u.IV, input, output);
+    if (self->block_only && (len % 16) != 0) {
+        mp_raise_ValueError("Input strings must be a multiple of 16 in length");
+    }
+
+    MP_THREAD_GIL_EXIT();
+    while (len > 0 && result == 0) {
+        uint32_t chunk = MIN(len, CRYPT_AES_CHUNK_SIZE);
+        result = self->crypt_func(self, operation, input, output, chunk);
+        input += chunk;
+        output += chunk;
+        len -= chunk;
     }
+    MP_THREAD_GIL_ENTER();
 
     if (result == ERR_ESP_AES_INVALID_INPUT_LENGTH) {
         mp_raise_ValueError("Input strings must be a multiple of 16 in length");
     }
-
-    return mp_obj_new_bytes(output, len);
 }
 
-STATIC mp_obj_t aes_do_ctr(mp_obj_AES_t *self, uint32_t operation, const unsigned char *input, uint32_t len) {
-    uint8_t *output = m_new(uint8_t, len);
+STATIC mp_obj_t aes_crypt_new(mp_obj_AES_t *self, uint32_t operation, mp_obj_t data) {
+    mp_buffer_info_t bufinfo;
+    vstr_t vstr;
+
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    vstr_init_len(&vstr, bufinfo.len);
+    aes_crypt(self, operation, bufinfo.buf, (unsigned char *)vstr.buf, bufinfo.len);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
 
-    esp_aes_crypt_ctr(&self->ctx, len, &self->offset, self->u.counter, self->stream, input, output);
+STATIC mp_obj_t aes_crypt_into(mp_obj_AES_t *self, uint32_t operation, mp_obj_t src, mp_obj_t dst) {
+    mp_buffer_info_t srcinfo;
+    mp_buffer_info_t dstinfo;
 
-    return mp_obj_new_bytes(output, len);
+    mp_get_buffer_raise(src, &srcinfo, MP_BUFFER_READ);
+    mp_get_buffer_raise(dst, &dstinfo, MP_BUFFER_WRITE);
+    if (dstinfo.len < srcinfo.len) {
+        mp_raise_ValueError("Output buffer too small");
+    }
+    aes_crypt(self, operation, srcinfo.buf, dstinfo.buf, srcinfo.len);
+    return mp_obj_new_int(srcinfo.len);
 }
 
 STATIC mp_obj_t AES_decrypt(mp_obj_t self_in, mp_obj_t ciphertext) {
-    mp_obj_AES_t *self = self_in;
-    mp_buffer_info_t bufinfo;
-
-    mp_get_buffer_raise(ciphertext, &bufinfo, MP_BUFFER_READ);
-    return self->crypt_func(self, ESP_AES_DECRYPT, bufinfo.buf, bufinfo.len);
+    return aes_crypt_new(self_in, ESP_AES_DECRYPT, ciphertext);
 }
 MP_DEFINE_CONST_FUN_OBJ_2(AES_decrypt_obj, AES_decrypt);
 
 STATIC mp_obj_t AES_encrypt(mp_obj_t self_in, mp_obj_t plaintext) {
-    mp_obj_AES_t *self = self_in;
-    mp_buffer_info_t bufinfo;
-
-    mp_get_buffer_raise(plaintext, &bufinfo, MP_BUFFER_READ);
-    return self->crypt_func(self, ESP_AES_ENCRYPT, bufinfo.buf, bufinfo.len);
+    return aes_crypt_new(self_in, ESP_AES_ENCRYPT, plaintext);
 }
 MP_DEFINE_CONST_FUN_OBJ_2(AES_encrypt_obj, AES_encrypt);
 
+STATIC mp_obj_t AES_decrypt_into(mp_obj_t self_in, mp_obj_t ciphertext, mp_obj_t plaintext) {
+    return aes_crypt_into(self_in, ESP_AES_DECRYPT, ciphertext, plaintext);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(AES_decrypt_into_obj, AES_decrypt_into);
+
+STATIC mp_obj_t AES_encrypt_into(mp_obj_t self_in, mp_obj_t plaintext, mp_obj_t ciphertext) {
+    return aes_crypt_into(self_in, ESP_AES_ENCRYPT, plaintext, ciphertext);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(AES_encrypt_into_obj, AES_encrypt_into);
+
 STATIC const mp_map_elem_t AES_locals_dict_table[] = {
-    { MP_OBJ_NEW_QSTR(MP_QSTR_decrypt),    (mp_obj_t) &AES_decrypt_obj },
-    { MP_OBJ_NEW_QSTR(MP_QSTR_encrypt),    (mp_obj_t) &AES_encrypt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_decrypt),         (mp_obj_t) &AES_decrypt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_encrypt),         (mp_obj_t) &AES_encrypt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_decrypt_into),    (mp_obj_t) &AES_decrypt_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_encrypt_into),    (mp_obj_t) &AES_encrypt_into_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(AES_locals_dict, AES_locals_dict_table);
@@ -185,6 +220,7 @@ STATIC mp_obj_t AES_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uin
 
     self->base.type = &AESCipher_type;
     self->offset = 0;
+    self->block_only = false;
 
     // store the key
     mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
@@ -202,10 +238,12 @@ STATIC mp_obj_t AES_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uin
     switch (mode) {
     case CRYPT_MODE_ECB:
         self->crypt_func = &aes_do_ecb;
+        self->block_only = true;
         break;
 
     case CRYPT_MODE_CBC:
         self->crypt_func = &aes_do_cbc;
+        self->block_only = true;
         break;
 
     case CRYPT_MODE_CFB:
@@ -261,6 +299,268 @@ STATIC mp_obj_t AES_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uin
     return self;
 }
 
+/******************************************************************************/
+// Key objects, the key is parsed once and then used for any number of operations
+
+STATIC const mp_obj_type_t key_type;
+
+STATIC mp_obj_t key_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
+
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_key,          MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_pers,         MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = MP_OBJ_NULL} },
+    };
+
+    // parse arguments
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, all_args, &kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    const char* pers = "esp32-tls";
+    if (args[1].u_obj != MP_OBJ_NULL) {
+        pers = mp_obj_str_get_str(args[1].u_obj);
+    }
+
+    // PEM keys are parsed including their null terminator
+    mp_buffer_info_t bufinfo;
+    vstr_t vstr;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
+    vstr_init(&vstr, bufinfo.len + 1);
+    vstr_add_strn(&vstr, bufinfo.buf, bufinfo.len);
+    const unsigned char *key = (const unsigned char *)vstr_null_terminated_str(&vstr);
+    size_t key_len = bufinfo.len;
+    if (key_len >= 5 && memcmp(key, "-----", 5) == 0) {
+        key_len++;
+    }
+
+    mp_obj_key_t *self = m_new_obj_with_finaliser(mp_obj_key_t);
+    self->base.type = &key_type;
+    mbedtls_pk_init(&self->pk);
+    mbedtls_ctr_drbg_init(&self->ctr_drbg);
+    mbedtls_entropy_init(&self->entropy);
+
+    self->is_private = true;
+    int rc = mbedtls_pk_parse_key(&self->pk, key, key_len, NULL, 0);
+    if (rc != 0) {
+        mbedtls_pk_free(&self->pk);
+        mbedtls_pk_init(&self->pk);
+        self->is_private = false;
+        rc = mbedtls_pk_parse_public_key(&self->pk, key, key_len);
+    }
+    vstr_clear(&vstr);
+    if (rc != 0) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Invalid key, mbedtls error code: 0x%X", -rc));
+    }
+
+    rc = mbedtls_ctr_drbg_seed(&self->ctr_drbg, mbedtls_entropy_func, &self->entropy, (const unsigned char*)pers, strlen(pers));
+    if (rc != 0) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_RuntimeError, "Random generator setup failed, mbedtls error code: 0x%X", -rc));
+    }
+
+    return self;
+}
+
+STATIC mp_obj_t key_del(mp_obj_t self_in) {
+    mp_obj_key_t *self = self_in;
+    mbedtls_pk_free(&self->pk);
+    mbedtls_ctr_drbg_free(&self->ctr_drbg);
+    mbedtls_entropy_free(&self->entropy);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(key_del_obj, key_del);
+
+STATIC void key_digest(const byte *message, size_t len, uint8_t *digest) {
+    int rc = mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), message, len, digest);
+    if (rc != 0) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_RuntimeError, "Message Digest operation failed, error code: %d", rc));
+    }
+}
+
+/*
+ * SHA-256 then PKCS#1 v1.5 or ECDSA, raw ECDSA signatures are r || s as used by JWT (ES256)
+ */
+STATIC mp_obj_t key_sign_internal(mp_obj_key_t *self, const byte *message, size_t len, bool raw) {
+    uint8_t digest[32];
+    int rc;
+    vstr_t vstr;
+
+    if (!self->is_private) {
+        mp_raise_ValueError("A private key is required");
+    }
+    key_digest(message, len, digest);
+
+    if (raw) {
+        if (!mbedtls_pk_can_do(&self->pk, MBEDTLS_PK_ECKEY)) {
+            mp_raise_ValueError("raw signatures are only for EC keys");
+        }
+        mbedtls_ecp_keypair *ec = mbedtls_pk_ec(self->pk);
+        size_t n_len = mbedtls_mpi_size(&ec->grp.N);
+        mbedtls_mpi r, s;
+        mbedtls_mpi_init(&r);
+        mbedtls_mpi_init(&s);
+        vstr_init_len(&vstr, 2 * n_len);
+        MP_THREAD_GIL_EXIT();
+        rc = mbedtls_ecdsa_sign(&ec->grp, &r, &s, &ec->d, digest, sizeof(digest), mbedtls_ctr_drbg_random, &self->ctr_drbg);
+        if (rc == 0) {
+            rc = mbedtls_mpi_write_binary(&r, (unsigned char *)vstr.buf, n_len);
+        }
+        if (rc == 0) {
+            rc = mbedtls_mpi_write_binary(&s, (unsigned char *)vstr.buf + n_len, n_len);
+        }
+        MP_THREAD_GIL_ENTER();
+        mbedtls_mpi_free(&r);
+        mbedtls_mpi_free(&s);
+    } else {
+        size_t sig_len = 0;
+        vstr_init_len(&vstr, MAX(mbedtls_pk_get_len(&self->pk), MBEDTLS_ECDSA_MAX_LEN));
+        MP_THREAD_GIL_EXIT();
+        rc = mbedtls_pk_sign(&self->pk, MBEDTLS_MD_SHA256, digest, sizeof(digest), (unsigned char *)vstr.buf, &sig_len,
+                             mbedtls_ctr_drbg_random, &self->ctr_drbg);
+        MP_THREAD_GIL_ENTER();
+        vstr.len = sig_len;
+    }
+
+    if (rc != 0) {
+        vstr_clear(&vstr);
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_RuntimeError, "Signing failed, error code: %d!", rc));
+    }
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+STATIC mp_obj_t key_crypt_internal(mp_obj_key_t *self, const byte *message, size_t len, bool encrypt) {
+    int rc;
+    vstr_t vstr;
+    size_t output_len = 0;
+
+    if (!encrypt && !self->is_private) {
+        mp_raise_ValueError("A private key is required");
+    }
+    vstr_init_len(&vstr, mbedtls_pk_get_len(&self->pk));
+    MP_THREAD_GIL_EXIT();
+    if (encrypt) {
+        rc = mbedtls_pk_encrypt(&self->pk, message, len, (unsigned char *)vstr.buf, &output_len, vstr.len,
+                                mbedtls_ctr_drbg_random, &self->ctr_drbg);
+    } else {
+        rc = mbedtls_pk_decrypt(&self->pk, message, len, (unsigned char *)vstr.buf, &output_len, vstr.len,
+                                mbedtls_ctr_drbg_random, &self->ctr_drbg);
+    }
+    MP_THREAD_GIL_ENTER();
+
+    if (rc != 0) {
+        vstr_clear(&vstr);
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_RuntimeError, "%s failed, mbedtls error code: 0x%X!",
+                                                encrypt ? "Encrypt" : "Decrypt", -rc));
+    }
+    vstr.len = output_len;
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+STATIC mp_obj_t key_sign(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_message,      MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_raw,          MP_ARG_KW_ONLY | MP_ARG_BOOL,   {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    mp_buffer_info_t message;
+    mp_get_buffer_raise(args[0].u_obj, &message, MP_BUFFER_READ);
+    return key_sign_internal(pos_args[0], message.buf, message.len, args[1].u_bool);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(key_sign_obj, 2, key_sign);
+
+STATIC mp_obj_t key_verify(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_message,      MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_signature,    MP_ARG_REQUIRED | MP_ARG_OBJ,   },
+        { MP_QSTR_raw,          MP_ARG_KW_ONLY | MP_ARG_BOOL,   {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    mp_obj_key_t *self = pos_args[0];
+    mp_buffer_info_t message;
+    mp_buffer_info_t signature;
+    mp_get_buffer_raise(args[0].u_obj, &message, MP_BUFFER_READ);
+    mp_get_buffer_raise(args[1].u_obj, &signature, MP_BUFFER_READ);
+
+    uint8_t digest[32];
+    int rc;
+    key_digest(message.buf, message.len, digest);
+
+    if (args[2].u_bool) {
+        if (!mbedtls_pk_can_do(&self->pk, MBEDTLS_PK_ECKEY)) {
+            mp_raise_ValueError("raw signatures are only for EC keys");
+        }
+        mbedtls_ecp_keypair *ec = mbedtls_pk_ec(self->pk);
+        size_t n_len = mbedtls_mpi_size(&ec->grp.N);
+        if (signature.len != 2 * n_len) {
+            return mp_const_false;
+        }
+        mbedtls_mpi r, s;
+        mbedtls_mpi_init(&r);
+        mbedtls_mpi_init(&s);
+        MP_THREAD_GIL_EXIT();
+        rc = mbedtls_mpi_read_binary(&r, signature.buf, n_len);
+        if (rc == 0) {
+            rc = mbedtls_mpi_read_binary(&s, (const unsigned char *)signature.buf + n_len, n_len);
+        }
+        if (rc == 0) {
+            rc = mbedtls_ecdsa_verify(&ec->grp, digest, sizeof(digest), &ec->Q, &r, &s);
+        }
+        MP_THREAD_GIL_ENTER();
+        mbedtls_mpi_free(&r);
+        mbedtls_mpi_free(&s);
+    } else {
+        MP_THREAD_GIL_EXIT();
+        rc = mbedtls_pk_verify(&self->pk, MBEDTLS_MD_SHA256, digest, sizeof(digest), signature.buf, signature.len);
+        MP_THREAD_GIL_ENTER();
+    }
+    return mp_obj_new_bool(rc == 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(key_verify_obj, 3, key_verify);
+
+STATIC mp_obj_t key_encrypt(mp_obj_t self_in, mp_obj_t message_in) {
+    mp_buffer_info_t message;
+    mp_get_buffer_raise(message_in, &message, MP_BUFFER_READ);
+    return key_crypt_internal(self_in, message.buf, message.len, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(key_encrypt_obj, key_encrypt);
+
+STATIC mp_obj_t key_decrypt(mp_obj_t self_in, mp_obj_t message_in) {
+    mp_buffer_info_t message;
+    mp_get_buffer_raise(message_in, &message, MP_BUFFER_READ);
+    return key_crypt_internal(self_in, message.buf, message.len, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(key_decrypt_obj, key_decrypt);
+
+STATIC mp_obj_t key_is_private(mp_obj_t self_in) {
+    mp_obj_key_t *self = self_in;
+    return mp_obj_new_bool(self->is_private);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(key_is_private_obj, key_is_private);
+
+STATIC const mp_map_elem_t key_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___del__),         (mp_obj_t) &key_del_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sign),            (mp_obj_t) &key_sign_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_verify),          (mp_obj_t) &key_verify_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_encrypt),         (mp_obj_t) &key_encrypt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_decrypt),         (mp_obj_t) &key_decrypt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_is_private),      (mp_obj_t) &key_is_private_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(key_locals_dict, key_locals_dict_table);
+
+STATIC const mp_obj_type_t key_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Key,
+    .make_new = key_make_new,
+    .locals_dict = (mp_obj_t)&key_locals_dict,
+};
+
 STATIC mp_obj_t getrandbits(mp_obj_t bits) {
     uint32_t num_cycles, i;
     vstr_t vstr;
@@ -291,6 +591,9 @@ STATIC mp_obj_t mod_crypt_generate_rsa_signature(mp_uint_t n_args, const mp_obj_
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mod_pycom_generate_rsa_signature_args), mod_pycom_generate_rsa_signature_args, args);
 
     const char* message = mp_obj_str_get_str(args[0].u_obj);
+    if (MP_OBJ_IS_TYPE(args[1].u_obj, &key_type)) {
+        return key_sign_internal(args[1].u_obj, (const byte *)message, strlen(message), false);
+    }
     const char* private_key = mp_obj_str_get_str(args[1].u_obj);
 
     char* pers="esp32-tls";
@@ -352,11 +655,14 @@ STATIC mp_obj_t mod_crypt_rsa_encrypt(mp_uint_t n_args, const mp_obj_t *pos_args
     mp_arg_val_t args[MP_ARRAY_SIZE(mod_pycom_generate_rsa_signature_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mod_pycom_generate_rsa_signature_args), mod_pycom_generate_rsa_signature_args, args);
 
-    const char* public_key = mp_obj_str_get_str(args[1].u_obj);
-
     mp_buffer_info_t message;
     mp_get_buffer_raise(args[0].u_obj, &message, MP_BUFFER_READ);
 
+    if (MP_OBJ_IS_TYPE(args[1].u_obj, &key_type)) {
+        return key_crypt_internal(args[1].u_obj, message.buf, message.len, true);
+    }
+    const char* public_key = mp_obj_str_get_str(args[1].u_obj);
+
     char* pers="esp32-tls";
 
     mbedtls_pk_context pk_context;
@@ -418,11 +724,14 @@ STATIC mp_obj_t mod_crypt_rsa_decrypt(mp_uint_t n_args, const mp_obj_t *pos_args
     mp_arg_val_t args[MP_ARRAY_SIZE(mod_pycom_generate_rsa_signature_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(mod_pycom_generate_rsa_signature_args), mod_pycom_generate_rsa_signature_args, args);
 
-    const char* private_key = mp_obj_str_get_str(args[1].u_obj);
-
     mp_buffer_info_t message;
     mp_get_buffer_raise(args[0].u_obj, &message, MP_BUFFER_READ);
 
+    if (MP_OBJ_IS_TYPE(args[1].u_obj, &key_type)) {
+        return key_crypt_internal(args[1].u_obj, message.buf, message.len, false);
+    }
+    const char* private_key = mp_obj_str_get_str(args[1].u_obj);
+
     char* pers="esp32-tls";
 
     mbedtls_pk_context pk_context;
@@ -496,6 +805,7 @@ STATIC const mp_obj_type_t mod_crypt_aes = {
 STATIC const mp_map_elem_t module_ucrypto_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__),                        MP_OBJ_NEW_QSTR(MP_QSTR_ucrypto) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_AES),                             (mp_obj_t)&mod_crypt_aes },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Key),                             (mp_obj_t)&key_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_getrandbits),                     (mp_obj_t)&getrandbits_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_generate_rsa_signature),          (mp_obj_t)&mod_crypt_generate_rsa_signature_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_rsa_encrypt),                     (mp_obj_t)&mod_crypt_rsa_encrypt_obj },
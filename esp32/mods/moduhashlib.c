@@ -17,6 +17,8 @@
 #include "py/mpconfig.h"
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/stream.h"
+#include "extmod/vfs.h"
 #include "sha1_alt.h"
 #include "sha256_alt.h"
 #include "sha512_alt.h"
@@ -27,7 +29,12 @@
 #include "mbedtls/sha256.h"
 #include "mbedtls/sha512.h"
 
-STATIC bool hash_busy = false;
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define HASH_FILE_CHUNK_SIZE                (4096)      // a flash sector
+#define HASH_HMAC_IPAD                      (0x36)
+#define HASH_HMAC_OPAD                      (0x5C)
 
 /******************************************************************************
  DEFINE PRIVATE TYPES
@@ -47,6 +54,11 @@ typedef struct _mp_obj_hash_t {
     }u;
 } mp_obj_hash_t;
 
+typedef struct _mp_obj_hmac_t {
+    mp_obj_hash_t hash;     // the inner sha256
+    uint8_t okey[64];       // key ^ opad, for the outer sha256
+} mp_obj_hmac_t;
+
 
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
@@ -54,6 +66,13 @@ typedef struct _mp_obj_hash_t {
 STATIC void hash_update_internal(mp_obj_t self_in, mp_obj_t data, bool digest);
 STATIC mp_obj_t hash_read (mp_obj_t self_in);
 
+STATIC const mp_obj_type_t md5_type;
+STATIC const mp_obj_type_t sha1_type;
+STATIC const mp_obj_type_t sha224_type;
+STATIC const mp_obj_type_t sha256_type;
+STATIC const mp_obj_type_t sha384_type;
+STATIC const mp_obj_type_t sha512_type;
+
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
@@ -67,6 +86,7 @@ STATIC void generic_hash_update(mp_obj_hash_t *self, void *data, uint32_t len) {
 
     case MP_QSTR_sha224:
     case MP_QSTR_sha256:
+    case MP_QSTR_hmac_sha256:
         mbedtls_sha256_update_ret(&self->u.sha256_context, data, len);
         break;
 
@@ -81,6 +101,80 @@ STATIC void generic_hash_update(mp_obj_hash_t *self, void *data, uint32_t len) {
     }
 }
 
+/*
+ * the SHA contexts take the hardware unit on their first update if it's free, or run in software
+ * otherwise, and they hold it until they're freed
+ */
+STATIC void generic_hash_free(mp_obj_hash_t *self) {
+    switch (self->base.type->name) {
+    case MP_QSTR_sha1:
+        mbedtls_sha1_free(&self->u.sha1_context);
+        break;
+
+    case MP_QSTR_sha224:
+    case MP_QSTR_sha256:
+    case MP_QSTR_hmac_sha256:
+        mbedtls_sha256_free(&self->u.sha256_context);
+        break;
+
+    case MP_QSTR_sha384:
+    case MP_QSTR_sha512:
+        mbedtls_sha512_free(&self->u.sha512_context);
+        break;
+    }
+}
+
+STATIC void hash_init(mp_obj_hash_t *self, const mp_obj_type_t *type) {
+    memset(self, 0, sizeof(mp_obj_hash_t));
+
+    self->digested = false;
+    self->base.type = type;
+
+    switch (self->base.type->name) {
+    case MP_QSTR_sha1:
+        self->h_size = 20;
+        self->b_size = 64;
+        mbedtls_sha1_init(&self->u.sha1_context);
+        mbedtls_sha1_starts_ret(&self->u.sha1_context);
+        break;
+
+    case MP_QSTR_sha224:
+        self->h_size = 28;
+        self->b_size = 64;
+        mbedtls_sha256_init(&self->u.sha256_context);
+        mbedtls_sha256_starts_ret(&self->u.sha256_context, 1);
+        break;
+
+    case MP_QSTR_sha256:
+    case MP_QSTR_hmac_sha256:
+        self->h_size = 32;
+        self->b_size = 64;
+        mbedtls_sha256_init(&self->u.sha256_context);
+        mbedtls_sha256_starts_ret(&self->u.sha256_context, 0);
+        break;
+
+    case MP_QSTR_sha384:
+        self->h_size = 48;
+        self->b_size = 128;
+        mbedtls_sha512_init(&self->u.sha512_context);
+        mbedtls_sha512_starts_ret(&self->u.sha512_context, 1);
+        break;
+
+    case MP_QSTR_sha512:
+        self->h_size = 64;
+        self->b_size = 128;
+        mbedtls_sha512_init(&self->u.sha512_context);
+        mbedtls_sha512_starts_ret(&self->u.sha512_context, 0);
+        break;
+
+    case MP_QSTR_md5:
+        self->h_size = 16;
+        self->b_size = 64;
+        MD5Init(&self->u.md5_context);
+        break;
+    }
+}
+
 STATIC void hash_update_internal(mp_obj_t self_in, mp_obj_t data, bool digest) {
     mp_obj_hash_t *self = self_in;
     mp_buffer_info_t bufinfo;
@@ -123,7 +217,9 @@ STATIC void hash_update_internal(mp_obj_t self_in, mp_obj_t data, bool digest) {
     if (len != 0) {
         // process it (them)
         len *= self->b_size;
+        bool released = mp_thread_gil_release_begin(len);
         generic_hash_update(self, bufinfo.buf, len);
+        mp_thread_gil_release_end(released);
 
         // update the input string information
         bufinfo.buf = ((uint8_t *) bufinfo.buf) + len;
@@ -154,6 +250,21 @@ STATIC mp_obj_t hash_read(mp_obj_t self_in) {
             mbedtls_sha256_free(&self->u.sha256_context);
             break;
 
+        case MP_QSTR_hmac_sha256: {
+            mp_obj_hmac_t *hmac = self_in;
+            mbedtls_sha256_finish_ret(&self->u.sha256_context, (uint8_t *)self->buffer);
+            mbedtls_sha256_free(&self->u.sha256_context);
+            // the outer hash reuses the context
+            mbedtls_sha256_init(&self->u.sha256_context);
+            mbedtls_sha256_starts_ret(&self->u.sha256_context, 0);
+            mbedtls_sha256_update_ret(&self->u.sha256_context, hmac->okey, sizeof(hmac->okey));
+            mbedtls_sha256_update_ret(&self->u.sha256_context, self->buffer, self->h_size);
+            mbedtls_sha256_finish_ret(&self->u.sha256_context, (uint8_t *)self->buffer);
+            mbedtls_sha256_free(&self->u.sha256_context);
+            memset(hmac->okey, 0, sizeof(hmac->okey));
+            break;
+        }
+
         case MP_QSTR_sha384:
         case MP_QSTR_sha512:
             mbedtls_sha512_finish_ret(&self->u.sha512_context, (uint8_t *)self->buffer);
@@ -166,7 +277,6 @@ STATIC mp_obj_t hash_read(mp_obj_t self_in) {
         }
 
         self->digested = true;
-        hash_busy = false;
     }
 
     return mp_obj_new_bytes(self->buffer, self->h_size);
@@ -180,65 +290,41 @@ STATIC mp_obj_t hash_read(mp_obj_t self_in) {
 STATIC mp_obj_t hash_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 0, 1, false);
 
+    mp_obj_hash_t *self = m_new_obj_with_finaliser(mp_obj_hash_t);
+    hash_init(self, type);
 
-    if (hash_busy == true) {
-        mp_raise_msg(&mp_type_OSError, "only one active hash operation is permitted at a time");
+    if (n_args) {
+        hash_update_internal(self, args[0], false);
     }
 
-    hash_busy = true;
-
-    mp_obj_hash_t *self = m_new_obj(mp_obj_hash_t);
-
-    memset(self, 0, sizeof(mp_obj_hash_t));
-
-    self->digested = false;
-    self->base.type = type;
-
-    switch (self->base.type->name) {
-    case MP_QSTR_sha1:
-        self->h_size = 20;
-        self->b_size = 64;
-        mbedtls_sha1_init(&self->u.sha1_context);
-        mbedtls_sha1_starts_ret(&self->u.sha1_context);
-        break;
-
-    case MP_QSTR_sha224:
-        self->h_size = 28;
-        self->b_size = 64;
-        mbedtls_sha256_init(&self->u.sha256_context);
-        mbedtls_sha256_starts_ret(&self->u.sha256_context, 1);
-        break;
-
-    case MP_QSTR_sha256:
-        self->h_size = 32;
-        self->b_size = 64;
-        mbedtls_sha256_init(&self->u.sha256_context);
-        mbedtls_sha256_starts_ret(&self->u.sha256_context, 0);
-        break;
+    return self;
+}
 
-    case MP_QSTR_sha384:
-        self->h_size = 48;
-        self->b_size = 128;
-        mbedtls_sha512_init(&self->u.sha512_context);
-        mbedtls_sha512_starts_ret(&self->u.sha512_context, 1);
-        break;
+/// \classmethod \constructor(key[, data])
+STATIC mp_obj_t hmac_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
 
-    case MP_QSTR_sha512:
-        self->h_size = 64;
-        self->b_size = 128;
-        mbedtls_sha512_init(&self->u.sha512_context);
-        mbedtls_sha512_starts_ret(&self->u.sha512_context, 0);
-        break;
+    mp_buffer_info_t bufinfo;
+    uint8_t key[64] = {0};
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len > sizeof(key)) {
+        // longer keys are hashed first
+        mbedtls_sha256_ret(bufinfo.buf, bufinfo.len, key, 0);
+    } else {
+        memcpy(key, bufinfo.buf, bufinfo.len);
+    }
 
-    case MP_QSTR_md5:
-        self->h_size = 16;
-        self->b_size = 64;
-        MD5Init(&self->u.md5_context);
-        break;
+    mp_obj_hmac_t *self = m_new_obj_with_finaliser(mp_obj_hmac_t);
+    hash_init(&self->hash, type);
+    for (size_t i = 0; i < sizeof(key); i++) {
+        self->okey[i] = key[i] ^ HASH_HMAC_OPAD;
+        key[i] ^= HASH_HMAC_IPAD;
     }
+    generic_hash_update(&self->hash, key, sizeof(key));
+    memset(key, 0, sizeof(key));
 
-    if (n_args) {
-        hash_update_internal(self, args[0], false);
+    if (n_args > 1) {
+        hash_update_internal(self, args[1], false);
     }
 
     return self;
@@ -258,7 +344,19 @@ STATIC mp_obj_t hash_digest(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(hash_digest_obj, hash_digest);
 
+// releases the hardware unit held by a hash that was never digested
+STATIC mp_obj_t hash_del(mp_obj_t self_in) {
+    mp_obj_hash_t *self = self_in;
+    if (!self->digested) {
+        generic_hash_free(self);
+        self->digested = true;
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(hash_del_obj, hash_del);
+
 STATIC const mp_map_elem_t hash_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___del__),   (mp_obj_t) &hash_del_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_update),    (mp_obj_t) &hash_update_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_digest),    (mp_obj_t) &hash_digest_obj },
 };
@@ -307,6 +405,68 @@ STATIC const mp_obj_type_t sha512_type = {
    .locals_dict = (mp_obj_t)&hash_locals_dict,
 };
 
+STATIC const mp_obj_type_t hmac_sha256_type = {
+   { &mp_type_type },
+   .name = MP_QSTR_hmac_sha256,
+   .make_new = hmac_make_new,
+   .locals_dict = (mp_obj_t)&hash_locals_dict,
+};
+
+/// \function file_digest(path[, digest])
+/// hashes a file in flash sector sized chunks, without going through Python for every chunk
+STATIC mp_obj_t hash_file_digest(size_t n_args, const mp_obj_t *args) {
+    const mp_obj_type_t *hash_types[] = { &md5_type, &sha1_type, &sha224_type, &sha256_type, &sha384_type, &sha512_type };
+    const mp_obj_type_t *type = NULL;
+
+    if (n_args < 2) {
+        type = &sha256_type;
+    } else {
+        qstr name = MP_QSTR_NULL;
+        if (MP_OBJ_IS_STR(args[1])) {
+            size_t len;
+            const char *str = mp_obj_str_get_data(args[1], &len);
+            name = qstr_find_strn(str, len);
+        }
+        for (size_t i = 0; i < MP_ARRAY_SIZE(hash_types); i++) {
+            if (args[1] == (mp_obj_t)hash_types[i] || name == hash_types[i]->name) {
+                type = hash_types[i];
+                break;
+            }
+        }
+        if (type == NULL) {
+            mp_raise_ValueError(mpexception_value_invalid_arguments);
+        }
+    }
+
+    mp_obj_t open_args[2] = { args[0], MP_OBJ_NEW_QSTR(MP_QSTR_rb) };
+    mp_obj_t file = mp_vfs_open(MP_ARRAY_SIZE(open_args), open_args, (mp_map_t *)&mp_const_empty_map);
+
+    mp_obj_hash_t *self = m_new_obj_with_finaliser(mp_obj_hash_t);
+    hash_init(self, type);
+
+    uint8_t *chunk = m_new(uint8_t, HASH_FILE_CHUNK_SIZE);
+    int errcode = 0;
+    mp_uint_t len;
+    do {
+        len = mp_stream_rw(file, chunk, HASH_FILE_CHUNK_SIZE, &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+        if (errcode != 0) {
+            break;
+        }
+        MP_THREAD_GIL_EXIT();
+        generic_hash_update(self, chunk, len);
+        MP_THREAD_GIL_ENTER();
+    } while (len > 0);
+
+    m_del(uint8_t, chunk, HASH_FILE_CHUNK_SIZE);
+    mp_stream_close(file);
+    if (errcode != 0) {
+        hash_del(self);
+        mp_raise_OSError(errcode);
+    }
+    return hash_read(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(hash_file_digest_obj, 1, 2, hash_file_digest);
+
 STATIC const mp_map_elem_t mp_module_hashlib_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__),    MP_OBJ_NEW_QSTR(MP_QSTR_uhashlib) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_md5),         (mp_obj_t)&md5_type },
@@ -315,6 +475,8 @@ STATIC const mp_map_elem_t mp_module_hashlib_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_sha256),      (mp_obj_t)&sha256_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sha384),      (mp_obj_t)&sha384_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sha512),      (mp_obj_t)&sha512_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_hmac_sha256), (mp_obj_t)&hmac_sha256_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_file_digest), (mp_obj_t)&hash_file_digest_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_hashlib_globals, mp_module_hashlib_globals_table);
@@ -44,6 +44,7 @@
 #include "py/objtuple.h"
 #include "py/objstr.h"
 #include "py/runtime.h"
+#include "py/mphal.h"
 #include "timeutils.h"
 #include "lib/oofatfs/ff.h"
 #include "lib/oofatfs/diskio.h"
@@ -159,10 +160,11 @@ MP_DEFINE_CONST_FUN_OBJ_0(mod_os_sync_obj, os_sync);
 STATIC mp_obj_t os_urandom(mp_obj_t num) {
     mp_int_t n = mp_obj_get_int(num);
     vstr_t vstr;
-    vstr_init_len(&vstr, n);
-    for (int i = 0; i < n; i++) {
-        vstr.buf[i] = rng_get();
+    if (n < 0) {
+        mp_raise_ValueError(mpexception_value_invalid_arguments);
     }
+    vstr_init_len(&vstr, n);
+    rng_fill((uint8_t *)vstr.buf, n);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(os_urandom_obj, os_urandom);
@@ -176,6 +178,8 @@ STATIC mp_obj_t os_dupterm(uint n_args, const mp_obj_t *args) {
         }
     } else {
         mp_obj_t stream_o = args[0];
+        // what is buffered belongs to the current terminal
+        mp_hal_stdout_flush();
         if (stream_o == mp_const_none) {
             MP_STATE_PORT(mp_os_stream_o) = MP_OBJ_NULL;
         } else {
@@ -10,6 +10,7 @@
 #include "py/mpconfig.h"
 #include "py/obj.h"
 #include "py/objstr.h"
+#include "py/objlist.h"
 #include "py/runtime.h"
 #include "mpexception.h"
 #include "moduqueue.h"
@@ -23,6 +24,55 @@
  ******************************************************************************/
 STATIC const mp_obj_type_t mp_queue_type;
 
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC TickType_t queue_timeout_ticks (bool block, mp_obj_t timeout) {
+    if (!block) {
+        return 0;
+    }
+    if (timeout == mp_const_none) {
+        return portMAX_DELAY;
+    }
+    return (TickType_t)(mp_obj_get_int_truncated(timeout) / portTICK_PERIOD_MS);
+}
+
+// ticks left of a timeout started at the tick count given
+STATIC TickType_t queue_ticks_left (TickType_t ticks, TickType_t start) {
+    if (ticks == portMAX_DELAY) {
+        return ticks;
+    }
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    return (elapsed < ticks) ? ticks - elapsed : 0;
+}
+
+// the GIL is only released when the task really has to wait for the queue
+STATIC bool queue_send (mp_obj_queue_t *self, mp_obj_t item, TickType_t ticks) {
+    if (xQueueSend(self->handle, (void *)&item, 0)) {
+        return true;
+    }
+    if (ticks == 0) {
+        return false;
+    }
+    MP_THREAD_GIL_EXIT();
+    BaseType_t sent = xQueueSend(self->handle, (void *)&item, ticks);
+    MP_THREAD_GIL_ENTER();
+    return sent;
+}
+
+STATIC bool queue_receive (mp_obj_queue_t *self, mp_obj_t *item, TickType_t ticks) {
+    if (xQueueReceive(self->handle, (void *)item, 0)) {
+        return true;
+    }
+    if (ticks == 0) {
+        return false;
+    }
+    MP_THREAD_GIL_EXIT();
+    BaseType_t received = xQueueReceive(self->handle, (void *)item, ticks);
+    MP_THREAD_GIL_ENTER();
+    return received;
+}
+
 /******************************************************************************/
 // Micro Python bindings; Queue class
 
@@ -91,22 +141,48 @@ STATIC mp_obj_t mp_queue_put(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
 
-    uint32_t timeout_ms = (args[2].u_obj == mp_const_none) ? portMAX_DELAY : mp_obj_get_int_truncated(args[2].u_obj);
-    MP_THREAD_GIL_EXIT();
-    if (!xQueueSend(self->handle, (void *)&args[0].u_obj, args[1].u_bool ? (TickType_t)(timeout_ms / portTICK_PERIOD_MS) : 0)) {
-        MP_THREAD_GIL_ENTER();
+    if (!queue_send(self, args[0].u_obj, queue_timeout_ticks(args[1].u_bool, args[2].u_obj))) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Full"));
     }
-    MP_THREAD_GIL_ENTER();
-
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mp_queue_put_obj, 1, mp_queue_put);
 
+// put_many(items, block=True, timeout=None): queues the items in order and returns how many
+// of them were queued, fewer than given only if the queue stayed full until the timeout
+STATIC mp_obj_t mp_queue_put_many(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_items,      MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_block,                        MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_timeout,                      MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    };
+
+    // parse args
+    mp_obj_queue_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(args[0].u_obj, &len, &items);
+
+    TickType_t ticks = queue_timeout_ticks(args[1].u_bool, args[2].u_obj);
+    TickType_t start = xTaskGetTickCount();
+    size_t n = 0;
+    while (n < len && queue_send(self, items[n], queue_ticks_left(ticks, start))) {
+        n++;
+    }
+    return mp_obj_new_int(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mp_queue_put_many_obj, 1, mp_queue_put_many);
+
+// get(block=True, timeout=None, *, default): returns default instead of raising Empty
+// when given, a timed out get doesn't allocate then
 STATIC mp_obj_t mp_queue_get(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_block,                        MP_ARG_BOOL, {.u_bool = true} },
         { MP_QSTR_timeout,                      MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_default,                      MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
     };
 
     // parse args
@@ -114,19 +190,52 @@ STATIC mp_obj_t mp_queue_get(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
 
-    uint32_t timeout_ms = (args[1].u_obj == mp_const_none) ? portMAX_DELAY : mp_obj_get_int_truncated(args[1].u_obj);
     mp_obj_t item;
-    MP_THREAD_GIL_EXIT();
-    if (!xQueueReceive(self->handle, (void *)&item, args[0].u_bool ? (TickType_t)(timeout_ms / portTICK_PERIOD_MS) : 0)) {
-        MP_THREAD_GIL_ENTER();
+    if (!queue_receive(self, &item, queue_timeout_ticks(args[0].u_bool, args[1].u_obj))) {
+        if (args[2].u_obj != MP_OBJ_NULL) {
+            return args[2].u_obj;
+        }
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Empty"));
     }
-    MP_THREAD_GIL_ENTER();
-
     return item;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mp_queue_get_obj, 1, mp_queue_get);
 
+// get_many(n, block=True, timeout=None): waits for an item like get() and returns a list
+// of it and of the ones queued behind it, up to n, the list is empty after a timeout
+STATIC mp_obj_t mp_queue_get_many(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_n,          MP_ARG_REQUIRED | MP_ARG_INT, },
+        { MP_QSTR_block,                        MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_timeout,                      MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    };
+
+    // parse args
+    mp_obj_queue_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (args[0].u_int <= 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    mp_obj_t first;
+    if (!queue_receive(self, &first, queue_timeout_ticks(args[1].u_bool, args[2].u_obj))) {
+        return mp_obj_new_list(0, NULL);
+    }
+    size_t n = MIN((size_t)args[0].u_int, uxQueueMessagesWaiting(self->handle) + 1);
+    mp_obj_list_t *list = MP_OBJ_TO_PTR(mp_obj_new_list(n, NULL));
+    list->items[0] = first;
+    size_t got = 1;
+    while (got < n && xQueueReceive(self->handle, (void *)&list->items[got], 0)) {
+        got++;
+    }
+    // another consumer may have taken some meanwhile
+    list->len = got;
+    return MP_OBJ_FROM_PTR(list);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mp_queue_get_many_obj, 1, mp_queue_get_many);
+
 STATIC mp_obj_t mp_queue_empty(mp_obj_t self_in) {
     mp_obj_queue_t *self = self_in;
     mp_obj_t buffer;
@@ -150,7 +259,9 @@ STATIC const mp_map_elem_t queue_locals_dict_table[] = {
     // instance methods
     { MP_OBJ_NEW_QSTR(MP_QSTR___del__),                 (mp_obj_t)&mp_queue_delete_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_put),                     (mp_obj_t)&mp_queue_put_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_put_many),                (mp_obj_t)&mp_queue_put_many_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_get),                     (mp_obj_t)&mp_queue_get_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_get_many),                (mp_obj_t)&mp_queue_get_many_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_empty),                   (mp_obj_t)&mp_queue_empty_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_full),                    (mp_obj_t)&mp_queue_full_obj },
 
@@ -61,6 +61,7 @@
 #include "lwip/dns.h"
 #include "lwip/netdb.h"
 #include "lwipsocket.h"
+#include "extmod/moduselect.h"
 
 #include "mbedtls/ssl.h"
 
@@ -74,6 +75,10 @@
 #define MODUSOCKET_MAX_SOCKETS                      15
 #define MODUSOCKET_CONN_TIMEOUT                     -2
 #define MODUSOCKET_MAX_DNS_SERV                      2
+#define MODUSOCKET_CONN_MAX                         MODUSOCKET_MAX_SOCKETS
+#define MODUSOCKET_WHEEL_SLOTS                      64          // must be a power of 2
+#define MODUSOCKET_WHEEL_TICK_MS                    10
+#define MODUSOCKET_OPS_STACK_SIZE                   8192        // the ssl handshakes of the timed connects run here
 /******************************************************************************
  DEFINE PRIVATE TYPES
  ******************************************************************************/
@@ -82,6 +87,18 @@ typedef struct {
     bool    user;
 } modusocket_sock_t;
 
+// connect in progress, handled by TASK_SOCK_OPS
+typedef struct {
+    mod_network_socket_obj_t    *sock;          // NULL when the entry is free
+    SemaphoreHandle_t           done;           // given once conn_status is final
+    uint32_t                    rounds;         // wheel revolutions left before the time out
+    uint32_t                    timeout_ms;     // kept here, the socket runs in non-blocking mode meanwhile
+    int8_t                      next;           // next entry in the same wheel slot, -1 for none
+    uint8_t                     slot;
+    uint8_t                     want;           // MOD_NETWORK_HANDSHAKE_WANT_* while the ssl handshake is in progress
+    bool                        in_wheel;
+} modusocket_conn_t;
+
 /******************************************************************************
  DEFINE PRIVATE DATA
  ******************************************************************************/
@@ -91,13 +108,15 @@ STATIC const mp_obj_type_t raw_socket_type;
 STATIC modusocket_sock_t modusocket_sockets[MODUSOCKET_MAX_SOCKETS] = {{.sd = -1}, {.sd = -1}, {.sd = -1}, {.sd = -1}, {.sd = -1},
                                                                        {.sd = -1}, {.sd = -1}, {.sd = -1}, {.sd = -1}, {.sd = -1},
                                                                        {.sd = -1}, {.sd = -1}, {.sd = -1}, {.sd = -1}, {.sd = -1}};
+STATIC uint32_t modusocket_sockets_peak;
 
-STATIC mod_network_socket_obj_t* modsocket_sock;
-STATIC TimerHandle_t modsocket_conn_timeout_timer;
-STATIC bool modsocket_istimeout = false;
+// all the accesses are protected by xSocketOpsSem
+STATIC modusocket_conn_t modusocket_conns[MODUSOCKET_CONN_MAX];
+STATIC int8_t modusocket_wheel[MODUSOCKET_WHEEL_SLOTS];
+STATIC uint32_t modusocket_wheel_cursor;
+STATIC TickType_t modusocket_wheel_tick;
 
 STATIC void TASK_SOCK_OPS (void *pvParameters) ;
-STATIC void modsocket_timer_callback( TimerHandle_t xTimer );
 /******************************************************************************
  DEFINE PUBLIC DATA
  ******************************************************************************/
@@ -108,10 +127,16 @@ SemaphoreHandle_t xSocketOpsSem;
  ******************************************************************************/
 void modusocket_pre_init (void) {
 
-	// Create a Task to handle Socket Async ops
-	xTaskCreatePinnedToCore(TASK_SOCK_OPS, "Socket Operations", 4096 / sizeof(StackType_t), NULL, 5, &xSocketOpsTaskHndl, 1);
 	// Create semaphore
 	xSocketOpsSem = xSemaphoreCreateMutex();
+	for (int i = 0; i < MODUSOCKET_CONN_MAX; i++) {
+	    modusocket_conns[i].done = xSemaphoreCreateBinary();
+	}
+	memset(modusocket_wheel, -1, sizeof(modusocket_wheel));
+	lwipsocket_dns_init();
+	lwipsocket_metrics_init();
+	// Create a Task to handle Socket Async ops
+	xTaskCreatePinnedToCore(TASK_SOCK_OPS, "Socket Operations", MODUSOCKET_OPS_STACK_SIZE / sizeof(StackType_t), NULL, 5, &xSocketOpsTaskHndl, 1);
 }
 
 void modusocket_socket_add (int32_t sd, bool user) {
@@ -123,6 +148,10 @@ void modusocket_socket_add (int32_t sd, bool user) {
             break;
         }
     }
+    uint32_t used = modusocket_socket_count();
+    if (used > modusocket_sockets_peak) {
+        modusocket_sockets_peak = used;
+    }
 //    sl_LockObjUnlock (&modusocket_LockObj);
 }
 
@@ -138,6 +167,16 @@ void modusocket_check_numdns (mp_obj_t numdns) {
 }
 
 
+uint32_t modusocket_socket_count (void) {
+    uint32_t used = 0;
+    for (int i = 0; i < MODUSOCKET_MAX_SOCKETS; i++) {
+        if (modusocket_sockets[i].sd >= 0) {
+            used++;
+        }
+    }
+    return used;
+}
+
 void modusocket_socket_delete (int32_t sd) {
 //    sl_LockObjLock (&modusocket_LockObj, SL_OS_WAIT_FOREVER);
     for (int i = 0; i < MODUSOCKET_MAX_SOCKETS; i++) {
@@ -214,6 +253,7 @@ STATIC mp_obj_t socket_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_
     s->sock_base.timeout = -1;      // sockets are blocking by default
     s->sock_base.is_ssl = false;
     s->sock_base.connected = false;
+    s->sock_base.rx_size = 0;
 
     if (n_args > 0) {
         s->sock_base.u.u_param.domain = mp_obj_get_int(args[0]);
@@ -364,84 +404,84 @@ STATIC mp_obj_t socket_connect(mp_obj_t self_in, mp_obj_t addr_in) {
 
     if (self->sock_base.timeout > 0 && self->sock_base.domain == AF_INET) {
 
-        modsocket_sock = self_in;
-        int timeout_temp = modsocket_sock->sock_base.timeout;
+        int timeout_temp = self->sock_base.timeout;
+        modusocket_conn_t *conn = NULL;
 
         // get address
         self->sock_base.port = netutils_parse_inet_addr(addr_in, self->sock_base.ip_addr, NETUTILS_LITTLE);
 
         // Set socket to Non-Blocking
-        if(modsocket_sock->sock_base.nic_type->n_settimeout(modsocket_sock, 0, &(self->sock_base.err)) != 0)
+        if(self->sock_base.nic_type->n_settimeout(self, 0, &(self->sock_base.err)) != 0)
         {
             nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(self->sock_base.err)));
         }
 
-        /* Start socket operation handling task */
-        self->sock_base.conn_status = SOCKET_CONN_START;
-        /*create Timer */
-        modsocket_conn_timeout_timer = xTimerCreate("Socket_conn_Timer", timeout_temp / portTICK_PERIOD_MS, 0, 0, modsocket_timer_callback);
+        xSemaphoreTake(xSocketOpsSem, portMAX_DELAY);
+        for (int i = 0; i < MODUSOCKET_CONN_MAX; i++) {
+            if (modusocket_conns[i].sock == NULL) {
+                conn = &modusocket_conns[i];
+                xSemaphoreTake(conn->done, 0);
+                self->sock_base.conn_status = SOCKET_CONN_START;
+                conn->timeout_ms = timeout_temp;
+                conn->sock = self;
+                break;
+            }
+        }
+        xSemaphoreGive(xSocketOpsSem);
+        if (conn == NULL) {
+            self->sock_base.nic_type->n_settimeout(self, timeout_temp, &(self->sock_base.err));
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+        }
 
+        /* Start socket operation handling task */
         MP_THREAD_GIL_EXIT();
         xTaskNotifyGive(xSocketOpsTaskHndl);
-        portYIELD();
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        xSemaphoreTake(conn->done, portMAX_DELAY);
+        MP_THREAD_GIL_ENTER();
 
+        // the entry can be reused from now on
         xSemaphoreTake(xSocketOpsSem, portMAX_DELAY);
+        conn->sock = NULL;
+        xSemaphoreGive(xSocketOpsSem);
+
+        // Set socket back to Blocking
+        self->sock_base.nic_type->n_settimeout(self, timeout_temp, &(self->sock_base.err));
 
         switch(self->sock_base.conn_status)
         {
         case SOCKET_CONN_TIMEDOUT:
-            // Set socket back to Blocking
-            modsocket_sock->sock_base.nic_type->n_settimeout(modsocket_sock, timeout_temp, &(self->sock_base.err));
             //Close socket
-            socket_close(modsocket_sock);
-            /* Release Sem */
-            xSemaphoreGive(xSocketOpsSem);
+            socket_close(self);
             nlr_raise(mp_obj_new_exception_msg(&mp_type_TimeoutError, "timed out"));
             break;
         case SOCKET_CONN_ERROR:
-            // Set socket back to Blocking
-            modsocket_sock->sock_base.nic_type->n_settimeout(modsocket_sock, timeout_temp, &(self->sock_base.err));
             //Close socket
-            socket_close(modsocket_sock);
-            /* Release Sem */
-            xSemaphoreGive(xSocketOpsSem);
+            socket_close(self);
             nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, mp_obj_new_int(self->sock_base.err)));
             break;
-        case SOCKET_CONN_PENDING:
-        case SOCKET_NOT_CONNECTED:
-        case SOCKET_CONN_START:
-            // Do Nothing
-            break;
         case SOCKET_CONNECTED:
-            /* Release Sem */
-            xSemaphoreGive(xSocketOpsSem);
-            // Set socket back to Blocking
-            modsocket_sock->sock_base.nic_type->n_settimeout(modsocket_sock, timeout_temp, &(self->sock_base.err));
-            // setup ssl if applicable
-            if(modsocket_sock->sock_base.is_ssl)
+            // setup ssl if applicable and not already done by the engine
+            if(self->sock_base.is_ssl && self->sock_base.nic_type->n_handshake == NULL)
             {
-                if(modsocket_sock->sock_base.nic_type->n_setupssl(modsocket_sock, &(self->sock_base.err)) != 0)
+                MP_THREAD_GIL_EXIT();
+                int ret = self->sock_base.nic_type->n_setupssl(self, &(self->sock_base.err));
+                MP_THREAD_GIL_ENTER();
+                if(ret != 0)
                 {
                     //Close socket
-                    socket_close(modsocket_sock);
+                    socket_close(self);
                     nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(self->sock_base.err)));
                 }
             }
             // mark socket as connected to allow ssl handshake if applicable
-            modsocket_sock->sock_base.connected = true;
+            self->sock_base.connected = true;
             break;
         default:
-            // Set socket back to Blocking
-            modsocket_sock->sock_base.nic_type->n_settimeout(modsocket_sock, timeout_temp, &(self->sock_base.err));
             //Close socket
-            socket_close(modsocket_sock);
-            /* Release Sem */
-            xSemaphoreGive(xSocketOpsSem);
+            socket_close(self);
             nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Connection failed"));
             break;
         }
-        MP_THREAD_GIL_ENTER();
     }
     else
     {
@@ -509,6 +549,41 @@ STATIC mp_obj_t socket_recv(mp_obj_t self_in, mp_obj_t len_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_recv_obj, socket_recv);
 
+// method socket.recv_into(buffer[, nbytes])
+STATIC mp_obj_t socket_recv_into(mp_uint_t n_args, const mp_obj_t *args) {
+    mod_network_socket_obj_t *self = args[0];
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t len = bufinfo.len;
+    if (n_args > 2) {
+        mp_int_t nbytes = mp_obj_get_int(args[2]);
+        if (nbytes < 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        if ((mp_uint_t)nbytes < len) {
+            len = nbytes;
+        }
+    }
+    int _errno;
+    // the NIC writes straight into the caller's buffer, no intermediate object is allocated
+    MP_THREAD_GIL_EXIT();
+    mp_int_t ret = self->sock_base.nic_type->n_recv(self, bufinfo.buf, len, &_errno);
+    MP_THREAD_GIL_ENTER();
+    if (ret < 0) {
+        if (_errno == MP_EAGAIN || _errno == MBEDTLS_ERR_SSL_TIMEOUT ) {
+            if (self->sock_base.timeout > 0) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_TimeoutError, "timed out"));
+            } else {
+                ret = 0;        // non-blocking socket
+            }
+        } else {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
+        }
+    }
+    return mp_obj_new_int_from_uint(ret);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_into_obj, 2, 3, socket_recv_into);
+
 // method socket.sendto(bytes, address)
 STATIC mp_obj_t socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_in) {
     mod_network_socket_obj_t *self = self_in;
@@ -552,6 +627,25 @@ STATIC mp_obj_t socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(socket_sendto_obj, socket_sendto);
 
+// builds the address tuple returned by recvfrom and recvfrom_into
+STATIC mp_obj_t socket_format_addr(mod_network_socket_obj_t *self, byte *ip, mp_uint_t port) {
+#if defined (LOPY) || defined(LOPY4) || defined(FIPY)
+    // check if lora NIC and IP is not set (so Lora Raw or LoraWAN, but no Lora Mesh)
+    if (self->sock_base.nic_type == &mod_network_nic_type_lora) {
+        if (ip[0] == 0) {
+            return mp_obj_new_int(port);
+        }
+        // Lora Mesh
+        mp_obj_t addr[2] = {
+            mp_obj_new_str((char*)ip, strlen((char*)ip)),
+            mp_obj_new_int(port),
+        };
+        return mp_obj_new_tuple(2, addr);
+    }
+#endif
+    return netutils_format_inet_addr(ip, port, NETUTILS_LITTLE);
+}
+
 // method socket.recvfrom(bufsize)
 STATIC mp_obj_t socket_recvfrom(mp_obj_t self_in, mp_obj_t len_in) {
     mod_network_socket_obj_t *self = self_in;
@@ -579,29 +673,103 @@ STATIC mp_obj_t socket_recvfrom(mp_obj_t self_in, mp_obj_t len_in) {
         vstr.buf[vstr.len] = '\0';
         tuple[0] = mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
     }
-#if defined (LOPY) || defined(LOPY4) || defined(FIPY)
-    // check if lora NIC and IP is not set (so Lora Raw or LoraWAN, but no Lora Mesh)
-    if (self->sock_base.nic_type == &mod_network_nic_type_lora) {
-            if (ip[0] == 0) {
-            tuple[1] = mp_obj_new_int(port);
-            } else {
-                // Lora Mesh
-                mp_obj_t addr[2] = {
-                addr[0] = mp_obj_new_str((char*)ip, strlen((char*)ip)),
-                addr[1] = mp_obj_new_int(port),
-                };
-                tuple[1] = mp_obj_new_tuple(2, addr);
-            }
-    } else {
-        tuple[1] = netutils_format_inet_addr(ip, port, NETUTILS_LITTLE);
-    }
-#else
-    tuple[1] = netutils_format_inet_addr(ip, port, NETUTILS_LITTLE);
-#endif
+    tuple[1] = socket_format_addr(self, ip, port);
     return mp_obj_new_tuple(2, tuple);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_recvfrom_obj, socket_recvfrom);
 
+// method socket.recvfrom_into(buffer[, nbytes])
+STATIC mp_obj_t socket_recvfrom_into(mp_uint_t n_args, const mp_obj_t *args) {
+    mod_network_socket_obj_t *self = args[0];
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t len = bufinfo.len;
+    if (n_args > 2) {
+        mp_int_t nbytes = mp_obj_get_int(args[2]);
+        if (nbytes < 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        if ((mp_uint_t)nbytes < len) {
+            len = nbytes;
+        }
+    }
+    byte ip[MOD_USOCKET_IPV6_CHARS_MAX];
+    mp_uint_t port = 0;
+    int _errno;
+
+    ip[0] = 0;// init IP with null
+    MP_THREAD_GIL_EXIT();
+    mp_int_t ret = self->sock_base.nic_type->n_recvfrom(self, bufinfo.buf, len, ip, &port, &_errno);
+    MP_THREAD_GIL_ENTER();
+    if (ret < 0) {
+        if ((_errno == MP_EAGAIN || _errno == MBEDTLS_ERR_SSL_TIMEOUT ) && self->sock_base.timeout > 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TimeoutError, "timed out"));
+        }
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
+    }
+    mp_obj_t tuple[2] = {
+        mp_obj_new_int_from_uint(ret),
+        socket_format_addr(self, ip, port),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recvfrom_into_obj, 2, 3, socket_recvfrom_into);
+
+// method socket.sendmsg(buffers[, address])
+STATIC mp_obj_t socket_sendmsg(mp_uint_t n_args, const mp_obj_t *args) {
+    mod_network_socket_obj_t *self = args[0];
+
+    // collect the fragments, they are handed over to the NIC as they are
+    mp_buffer_info_t bufs[MOD_USOCKET_SENDMSG_IOV_MAX];
+    mp_obj_t *items;
+    size_t n_bufs;
+    mp_obj_get_array(args[1], &n_bufs, &items);
+    if (n_bufs > MOD_USOCKET_SENDMSG_IOV_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    mp_uint_t total = 0;
+    for (size_t i = 0; i < n_bufs; i++) {
+        mp_get_buffer_raise(items[i], &bufs[i], MP_BUFFER_READ);
+        total += bufs[i].len;
+    }
+
+    uint8_t ip[MOD_USOCKET_IPV6_CHARS_MAX];
+    mp_uint_t port = 0;
+    bool has_addr = n_args > 2 && args[2] != mp_const_none;
+    if (has_addr) {
+        port = netutils_parse_inet_addr(args[2], ip, NETUTILS_LITTLE);
+    }
+
+    int _errno;
+    mp_int_t ret;
+    if (self->sock_base.nic_type->n_sendmsg) {
+        MP_THREAD_GIL_EXIT();
+        ret = self->sock_base.nic_type->n_sendmsg(self, bufs, n_bufs, has_addr ? ip : NULL, port, &_errno);
+        MP_THREAD_GIL_ENTER();
+    } else if (n_bufs <= 1) {
+        // no gather support in the NIC, a single fragment is a plain send
+        const byte *buf = n_bufs ? bufs[0].buf : NULL;
+        MP_THREAD_GIL_EXIT();
+        if (has_addr) {
+            ret = self->sock_base.nic_type->n_sendto(self, buf, total, ip, port, &_errno);
+        } else {
+            ret = self->sock_base.nic_type->n_send(self, buf, total, &_errno);
+        }
+        MP_THREAD_GIL_ENTER();
+    } else {
+        // the fragments of a datagram can't be split over several sends
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(MP_EOPNOTSUPP)));
+    }
+    if (ret < 0 && total > 0) {
+        if (_errno == MP_EAGAIN && self->sock_base.timeout > 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TimeoutError, "timed out"));
+        }
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
+    }
+    return mp_obj_new_int(ret < 0 ? 0 : ret);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_sendmsg_obj, 2, 3, socket_sendmsg);
+
 // method socket.setsockopt(level, optname, value)
 STATIC mp_obj_t socket_setsockopt(mp_uint_t n_args, const mp_obj_t *args) {
     mod_network_socket_obj_t *self = args[0];
@@ -635,6 +803,21 @@ STATIC mp_obj_t socket_setsockopt(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_setsockopt_obj, 4, 4, socket_setsockopt);
 
+// method socket.getsockopt(level, optname)
+STATIC mp_obj_t socket_getsockopt(mp_obj_t self_in, mp_obj_t level_in, mp_obj_t opt_in) {
+    mod_network_socket_obj_t *self = self_in;
+    if (self->sock_base.nic_type->n_getsockopt == NULL) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(MP_EOPNOTSUPP)));
+    }
+    mp_int_t val;
+    int _errno;
+    if (self->sock_base.nic_type->n_getsockopt(self, mp_obj_get_int(level_in), mp_obj_get_int(opt_in), &val, &_errno) != 0) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
+    }
+    return mp_obj_new_int(val);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(socket_getsockopt_obj, socket_getsockopt);
+
 // method socket.settimeout(value)
 // timeout=0 means non-blocking
 // timeout=None means blocking
@@ -684,8 +867,19 @@ STATIC mp_obj_t socket_do_handshake(mp_obj_t self_in) {
     mod_network_socket_obj_t *self = self_in;
 
     int _errno;
+    if (self->sock_base.timeout == 0 && self->sock_base.nic_type->n_handshake) {
+        // non-blocking, tell the caller what to wait for before calling again
+        MP_THREAD_GIL_EXIT();
+        int ret = self->sock_base.nic_type->n_handshake(self, &_errno);
+        MP_THREAD_GIL_ENTER();
+        if (ret < 0) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
+        }
+        return ret == 0 ? mp_const_none : MP_OBJ_NEW_SMALL_INT(ret);
+    }
     MP_THREAD_GIL_EXIT();
     if (self->sock_base.nic_type->n_setupssl(self, &_errno) != 0) {
+        MP_THREAD_GIL_ENTER();
         nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(_errno)));
     }
     MP_THREAD_GIL_ENTER();
@@ -693,95 +887,209 @@ STATIC mp_obj_t socket_do_handshake(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(socket_do_handshake_obj, socket_do_handshake);
 
-static void TASK_SOCK_OPS (void *pvParameters) {
+STATIC void modusocket_wheel_add (int8_t idx, uint32_t ticks) {
+    modusocket_conn_t *conn = &modusocket_conns[idx];
 
-    mp_uint_t flag = MP_STREAM_POLL_WR;
-    int ret;
-    static uint32_t thread_notification;
+    ticks = MAX(1, ticks);
+    conn->slot = (modusocket_wheel_cursor + ticks) & (MODUSOCKET_WHEEL_SLOTS - 1);
+    conn->rounds = (ticks - 1) / MODUSOCKET_WHEEL_SLOTS;
+    conn->next = modusocket_wheel[conn->slot];
+    conn->in_wheel = true;
+    modusocket_wheel[conn->slot] = idx;
+}
 
-Conn_start:
+STATIC void modusocket_wheel_remove (int8_t idx) {
+    modusocket_conn_t *conn = &modusocket_conns[idx];
+    int8_t *link = &modusocket_wheel[conn->slot];
 
-    thread_notification = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (!conn->in_wheel) {
+        return;
+    }
+    while (*link >= 0) {
+        if (*link == idx) {
+            *link = conn->next;
+            break;
+        }
+        link = &modusocket_conns[*link].next;
+    }
+    conn->in_wheel = false;
+}
 
-    if (thread_notification) {
-        for (;;)
-        {
-            if(modsocket_sock->sock_base.conn_status == SOCKET_CONN_START)
-            {
-                xSemaphoreTake(xSocketOpsSem, portMAX_DELAY);
+STATIC void modusocket_conn_done (int8_t idx, mod_network_sock_conn_status_t status) {
+    modusocket_conn_t *conn = &modusocket_conns[idx];
+
+    modusocket_wheel_remove(idx);
+    conn->sock->sock_base.conn_status = status;
+    xSemaphoreGive(conn->done);
+}
+
+/*
+ * moves the handshake of an ssl socket forward, the time out is armed again once the tcp connection is up
+ */
+STATIC void modusocket_conn_handshake (int8_t idx) {
+    mod_network_socket_obj_t *sock = modusocket_conns[idx].sock;
 
+    if (sock->sock_base.conn_status != SOCKET_CONN_HANDSHAKE) {
+        if (!sock->sock_base.is_ssl || sock->sock_base.nic_type->n_handshake == NULL) {
+            modusocket_conn_done(idx, SOCKET_CONNECTED);
+            return;
+        }
+        sock->sock_base.conn_status = SOCKET_CONN_HANDSHAKE;
+        modusocket_wheel_remove(idx);
+        modusocket_wheel_add(idx, (modusocket_conns[idx].timeout_ms + MODUSOCKET_WHEEL_TICK_MS - 1) / MODUSOCKET_WHEEL_TICK_MS);
+    }
+    int ret = sock->sock_base.nic_type->n_handshake(sock, &(sock->sock_base.err));
+    if (ret == 0) {
+        modusocket_conn_done(idx, SOCKET_CONNECTED);
+    } else if (ret < 0) {
+        modusocket_conn_done(idx, SOCKET_CONN_ERROR);
+    } else {
+        modusocket_conns[idx].want = ret;
+    }
+}
+
+/*
+ * moves the wheel forward by the ticks elapsed, timing out the connects that expire
+ */
+STATIC void modusocket_wheel_advance (void) {
+    TickType_t now = xTaskGetTickCount();
+    uint32_t ticks = (now - modusocket_wheel_tick) * portTICK_PERIOD_MS / MODUSOCKET_WHEEL_TICK_MS;
+
+    modusocket_wheel_tick += ticks * MODUSOCKET_WHEEL_TICK_MS / portTICK_PERIOD_MS;
+    if (ticks >= MODUSOCKET_WHEEL_SLOTS) {
+        // late by a full revolution, schedule every connect again from the ticks it has left
+        uint32_t remaining[MODUSOCKET_CONN_MAX];
+        for (int8_t i = 0; i < MODUSOCKET_CONN_MAX; i++) {
+            modusocket_conn_t *conn = &modusocket_conns[i];
+            remaining[i] = 0;
+            if (conn->in_wheel) {
+                remaining[i] = ((conn->slot - modusocket_wheel_cursor - 1) & (MODUSOCKET_WHEEL_SLOTS - 1)) + 1 +
+                               conn->rounds * MODUSOCKET_WHEEL_SLOTS;
+                modusocket_wheel_remove(i);
+            }
+        }
+        modusocket_wheel_cursor += ticks;
+        for (int8_t i = 0; i < MODUSOCKET_CONN_MAX; i++) {
+            if (remaining[i] == 0) {
+                continue;
+            }
+            if (remaining[i] <= ticks) {
+                modusocket_conn_done(i, SOCKET_CONN_TIMEDOUT);
+            } else {
+                modusocket_wheel_add(i, remaining[i] - ticks);
+            }
+        }
+        return;
+    }
+    while (ticks--) {
+        modusocket_wheel_cursor++;
+        int8_t idx = modusocket_wheel[modusocket_wheel_cursor & (MODUSOCKET_WHEEL_SLOTS - 1)];
+        while (idx >= 0) {
+            int8_t next = modusocket_conns[idx].next;
+            if (modusocket_conns[idx].rounds == 0) {
+                modusocket_conn_done(idx, SOCKET_CONN_TIMEDOUT);
+            } else {
+                modusocket_conns[idx].rounds--;
+            }
+            idx = next;
+        }
+    }
+}
+
+static void TASK_SOCK_OPS (void *pvParameters) {
+
+    bool pending = false;
+
+    for (;;)
+    {
+        // sleep until a connect is requested, or until the next tick while some are in progress
+        ulTaskNotifyTake(pdTRUE, pending ? 0 : portMAX_DELAY);
+
+        fd_set rfds, wfds, xfds;
+        int32_t maxfd = -1;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        FD_ZERO(&xfds);
+
+        xSemaphoreTake(xSocketOpsSem, portMAX_DELAY);
+        if (!pending) {
+            modusocket_wheel_tick = xTaskGetTickCount();
+        }
+        for (int8_t i = 0; i < MODUSOCKET_CONN_MAX; i++) {
+            mod_network_socket_obj_t *sock = modusocket_conns[i].sock;
+            if (sock == NULL) {
+                continue;
+            }
+            if (sock->sock_base.conn_status == SOCKET_CONN_START) {
                 //connect socket
-                if (modsocket_sock->sock_base.nic_type->n_connect(modsocket_sock, modsocket_sock->sock_base.ip_addr, modsocket_sock->sock_base.port, &(modsocket_sock->sock_base.err)) != 0) {
-
-                    if(modsocket_sock->sock_base.err == EINPROGRESS)
-                    {
-                        /*start Timer */
-                        xTimerStart(modsocket_conn_timeout_timer, 0);
-                        /* Pending */
-                        modsocket_sock->sock_base.conn_status = SOCKET_CONN_PENDING;
-                    }
-                    else
-                    {
-                        modsocket_sock->sock_base.conn_status = SOCKET_CONN_ERROR;
-                        xSemaphoreGive(xSocketOpsSem);
-                        goto Conn_start;
+                if (sock->sock_base.nic_type->n_connect(sock, sock->sock_base.ip_addr, sock->sock_base.port, &(sock->sock_base.err)) != 0) {
+                    if (sock->sock_base.err == EINPROGRESS) {
+                        sock->sock_base.conn_status = SOCKET_CONN_PENDING;
+                        modusocket_wheel_add(i, (modusocket_conns[i].timeout_ms + MODUSOCKET_WHEEL_TICK_MS - 1) / MODUSOCKET_WHEEL_TICK_MS);
+                    } else {
+                        modusocket_conn_done(i, SOCKET_CONN_ERROR);
                     }
-                }
-                else
-                {
+                } else {
                     // socket already connected
-                    modsocket_sock->sock_base.conn_status = SOCKET_CONNECTED;
-                    xSemaphoreGive(xSocketOpsSem);
-                    goto Conn_start;
+                    modusocket_conn_handshake(i);
                 }
             }
-            else if (modsocket_sock->sock_base.conn_status == SOCKET_CONN_PENDING)
-            {
-                //start polling
-                ret = lwipsocket_socket_ioctl(modsocket_sock, MP_STREAM_POLL, flag, &(modsocket_sock->sock_base.err));
-                if((ret & MP_STREAM_POLL_WR) == MP_STREAM_POLL_WR)
-                {
-                    // socket connected
-                    modsocket_sock->sock_base.conn_status = SOCKET_CONNECTED;
-                    /* Stop Timer*/
-                    xTimerStop(modsocket_conn_timeout_timer, 0);
-                    xTimerDelete(modsocket_conn_timeout_timer, 0);
-                    xSemaphoreGive(xSocketOpsSem);
-                    goto Conn_start;
-                }
-                else if(ret < 0)
-                {
-                    modsocket_sock->sock_base.conn_status = SOCKET_CONN_ERROR;
-                    xSemaphoreGive(xSocketOpsSem);
-                    goto Conn_start;
-                }
+            if (sock->sock_base.conn_status == SOCKET_CONN_PENDING) {
+                FD_SET(sock->sock_base.u.sd, &wfds);
+                FD_SET(sock->sock_base.u.sd, &xfds);
+                maxfd = MAX(maxfd, sock->sock_base.u.sd);
+            } else if (sock->sock_base.conn_status == SOCKET_CONN_HANDSHAKE) {
+                FD_SET(sock->sock_base.u.sd, modusocket_conns[i].want == MOD_NETWORK_HANDSHAKE_WANT_READ ? &rfds : &wfds);
+                FD_SET(sock->sock_base.u.sd, &xfds);
+                maxfd = MAX(maxfd, sock->sock_base.u.sd);
+            }
+        }
+        xSemaphoreGive(xSocketOpsSem);
 
-                if(modsocket_istimeout)
-                {
-                    modsocket_sock->sock_base.conn_status = SOCKET_CONN_TIMEDOUT;
-                    modsocket_istimeout = false;
-                    xSemaphoreGive(xSocketOpsSem);
-                    goto Conn_start;
+        pending = maxfd >= 0;
+        if (!pending) {
+            continue;
+        }
+
+        // one wait for all the connects in progress
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = MODUSOCKET_WHEEL_TICK_MS * 1000;
+        int32_t nfds = lwip_select(maxfd + 1, &rfds, &wfds, &xfds, &tv);
+
+        xSemaphoreTake(xSocketOpsSem, portMAX_DELAY);
+        for (int8_t i = 0; nfds > 0 && i < MODUSOCKET_CONN_MAX; i++) {
+            mod_network_socket_obj_t *sock = modusocket_conns[i].sock;
+            if (sock == NULL) {
+                continue;
+            }
+            int32_t sd = sock->sock_base.u.sd;
+            if (sock->sock_base.conn_status == SOCKET_CONN_HANDSHAKE) {
+                if (FD_ISSET(sd, &rfds) || FD_ISSET(sd, &wfds) || FD_ISSET(sd, &xfds)) {
+                    modusocket_conn_handshake(i);
                 }
+                continue;
             }
-            else
-            {
-                // Nothing
+            if (sock->sock_base.conn_status != SOCKET_CONN_PENDING) {
+                continue;
+            }
+            if (FD_ISSET(sd, &wfds) || FD_ISSET(sd, &xfds)) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (lwip_getsockopt_r(sd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) {
+                    err = errno;
+                }
+                if (err == 0) {
+                    modusocket_conn_handshake(i);
+                } else {
+                    sock->sock_base.err = err;
+                    modusocket_conn_done(i, SOCKET_CONN_ERROR);
+                }
             }
-
-            vTaskDelay(5/portTICK_PERIOD_MS);
         }
+        modusocket_wheel_advance();
+        xSemaphoreGive(xSocketOpsSem);
     }
-
-    goto Conn_start;
-}
-
-STATIC void modsocket_timer_callback( TimerHandle_t xTimer )
-{
-    modsocket_istimeout = true;
-    /* Stop Timer*/
-    xTimerStop(modsocket_conn_timeout_timer, 0);
-    xTimerDelete(modsocket_conn_timeout_timer, 0);
 }
 
 STATIC const mp_map_elem_t socket_locals_dict_table[] = {
@@ -794,9 +1102,13 @@ STATIC const mp_map_elem_t socket_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_send),            (mp_obj_t)&socket_send_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sendall),         (mp_obj_t)&socket_send_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv),            (mp_obj_t)&socket_recv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recv_into),       (mp_obj_t)&socket_recv_into_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sendto),          (mp_obj_t)&socket_sendto_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recvfrom),        (mp_obj_t)&socket_recvfrom_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recvfrom_into),   (mp_obj_t)&socket_recvfrom_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sendmsg),         (mp_obj_t)&socket_sendmsg_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setsockopt),      (mp_obj_t)&socket_setsockopt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_getsockopt),      (mp_obj_t)&socket_getsockopt_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_settimeout),      (mp_obj_t)&socket_settimeout_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setblocking),     (mp_obj_t)&socket_setblocking_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_makefile),        (mp_obj_t)&socket_makefile_obj },
@@ -819,7 +1131,10 @@ STATIC const mp_map_elem_t raw_socket_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_send),            (mp_obj_t)&socket_send_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_sendto),          (mp_obj_t)&socket_sendto_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recv),            (mp_obj_t)&socket_recv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recv_into),       (mp_obj_t)&socket_recv_into_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_recvfrom),        (mp_obj_t)&socket_recvfrom_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_recvfrom_into),   (mp_obj_t)&socket_recvfrom_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sendmsg),         (mp_obj_t)&socket_sendmsg_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_settimeout),      (mp_obj_t)&socket_settimeout_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_bind),            (mp_obj_t)&socket_bind_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_setblocking),     (mp_obj_t)&socket_setblocking_obj },
@@ -884,6 +1199,21 @@ const mp_stream_p_t raw_socket_stream_p = {
     .is_text = false,
 };
 
+// the lwIP sockets are waited for by uselect with a single select
+int mp_uselect_port_fd(mp_obj_t obj) {
+    const mp_obj_type_t *type = mp_obj_get_type(obj);
+
+    if (type->protocol != &socket_stream_p && type->protocol != &raw_socket_stream_p) {
+        return -1;
+    }
+    mod_network_socket_obj_t *s = obj;
+    // the ssl sockets are polled through their ioctl, which knows about the records already decrypted
+    if (!lwipsocket_is_lwip(s) || s->sock_base.u.sd < 0 || s->sock_base.is_ssl) {
+        return -1;
+    }
+    return s->sock_base.u.sd;
+}
+
 const mp_obj_type_t socket_type = {
     { &mp_type_type },
     .name = MP_QSTR_socket,
@@ -913,29 +1243,20 @@ STATIC mp_obj_t mod_usocket_getaddrinfo(size_t n_args, const mp_obj_t *args) {
     const char *host = mp_obj_str_get_data(args[0], &hlen);
     mp_int_t port = mp_obj_get_int(args[1]);
 
-    const struct addrinfo hints = {
-        .ai_family = AF_INET,
-        .ai_socktype = SOCK_STREAM,
-    };
-    struct addrinfo *res;
-    struct in_addr *addr;
-
-    char port_s[6];
-    sprintf(port_s, "%d", port);
-    int32_t result = getaddrinfo(host, port_s, &hints, &res);
-    if(result != 0 || res == NULL) {
+    // the DNS query can take seconds on a cellular link, let the other threads run meanwhile
+    uint32_t addr;
+    MP_THREAD_GIL_EXIT();
+    int32_t result = lwipsocket_dns_resolve(host, &addr);
+    MP_THREAD_GIL_ENTER();
+    if (result != 0) {
         nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(result)));
     }
-    addr = &((struct sockaddr_in *)res->ai_addr)->sin_addr;
     mp_obj_tuple_t *tuple = mp_obj_new_tuple(5, NULL);
-    tuple->items[0] = MP_OBJ_NEW_SMALL_INT(res->ai_family);
-    tuple->items[1] = MP_OBJ_NEW_SMALL_INT(res->ai_socktype);
+    tuple->items[0] = MP_OBJ_NEW_SMALL_INT(AF_INET);
+    tuple->items[1] = MP_OBJ_NEW_SMALL_INT(SOCK_STREAM);
     tuple->items[2] = MP_OBJ_NEW_SMALL_INT(0);
     tuple->items[3] = MP_OBJ_NEW_QSTR(MP_QSTR_);
-    tuple->items[4] = netutils_format_inet_addr((uint8_t *) &addr->s_addr, port, NETUTILS_BIG);
-
-    //getaddrinfo() allocates memory, needs to be freed
-    freeaddrinfo(res);
+    tuple->items[4] = netutils_format_inet_addr((uint8_t *)&addr, port, NETUTILS_BIG);
 
     return mp_obj_new_list(1, (mp_obj_t*) &tuple);
 }
@@ -991,12 +1312,160 @@ STATIC mp_obj_t mod_usocket_dnsserver(size_t n_args, const mp_obj_t *args)
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_usocket_dnsserver_obj, 0, 2, mod_usocket_dnsserver);
 
+// function usocket.dnscache(*, size, ttl, negative_ttl)
+STATIC mp_obj_t mod_usocket_dnscache(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_size,                 MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_ttl,                  MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_negative_ttl,         MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    uint32_t size, ttl_ms, neg_ttl_ms;
+    lwipsocket_dns_get_config(&size, &ttl_ms, &neg_ttl_ms);
+    if (args[0].u_obj == MP_OBJ_NULL && args[1].u_obj == MP_OBJ_NULL && args[2].u_obj == MP_OBJ_NULL) {
+        mp_obj_t tuple[3];
+        tuple[0] = mp_obj_new_int_from_uint(size);
+        tuple[1] = mp_obj_new_int_from_uint(ttl_ms / 1000);
+        tuple[2] = mp_obj_new_int_from_uint(neg_ttl_ms / 1000);
+        return mp_obj_new_tuple(3, tuple);
+    }
+
+    mp_int_t values[3] = { size, ttl_ms / 1000, neg_ttl_ms / 1000 };
+    for (int i = 0; i < 3; i++) {
+        if (args[i].u_obj != MP_OBJ_NULL) {
+            values[i] = mp_obj_get_int(args[i].u_obj);
+            if (values[i] < 0 || (i == 0 && values[i] > MODUSOCKET_DNS_CACHE_SIZE_MAX)) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+            }
+        }
+    }
+    if (!lwipsocket_dns_config(values[0], values[1] * 1000, values[2] * 1000)) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_usocket_dnscache_obj, 0, mod_usocket_dnscache);
+
+// function usocket.dnsflush()
+STATIC mp_obj_t mod_usocket_dnsflush(void) {
+    lwipsocket_dns_flush();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_usocket_dnsflush_obj, mod_usocket_dnsflush);
+
+// function usocket.dnsstats(*, reset=False)
+STATIC mp_obj_t mod_usocket_dnsstats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const qstr dns_stats_fields[] = {
+        MP_QSTR_hits, MP_QSTR_misses, MP_QSTR_entries
+    };
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset,                MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    uint32_t hits, misses, entries;
+    lwipsocket_dns_stats(&hits, &misses, &entries, args[0].u_bool);
+    mp_obj_t tuple[3];
+    tuple[0] = mp_obj_new_int_from_uint(hits);
+    tuple[1] = mp_obj_new_int_from_uint(misses);
+    tuple[2] = mp_obj_new_int_from_uint(entries);
+    return mp_obj_new_attrtuple(dns_stats_fields, 3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_usocket_dnsstats_obj, 0, mod_usocket_dnsstats);
+
+// function usocket.netstats(*, reset=False)
+STATIC mp_obj_t mod_usocket_netstats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const qstr net_stats_fields[] = {
+        MP_QSTR_tcp, MP_QSTR_udp, MP_QSTR_sockets, MP_QSTR_memory
+    };
+    STATIC const qstr tcp_stats_fields[] = {
+        MP_QSTR_active, MP_QSTR_listen, MP_QSTR_time_wait, MP_QSTR_limit, MP_QSTR_retransmitting, MP_QSTR_nrtx, MP_QSTR_queued
+    };
+    STATIC const qstr udp_stats_fields[] = {
+        MP_QSTR_used, MP_QSTR_limit
+    };
+    STATIC const qstr sock_stats_fields[] = {
+        MP_QSTR_used, MP_QSTR_peak, MP_QSTR_limit, MP_QSTR_errors
+    };
+    STATIC const qstr mem_stats_fields[] = {
+        MP_QSTR_free, MP_QSTR_min_free, MP_QSTR_nomem
+    };
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset,                MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    lwipsocket_net_stats_t stats;
+    lwipsocket_net_stats(&stats, args[0].u_bool);
+    uint32_t used = modusocket_socket_count();
+
+    mp_obj_t tcp[7];
+    tcp[0] = mp_obj_new_int_from_uint(stats.tcp_active);
+    tcp[1] = mp_obj_new_int_from_uint(stats.tcp_listen);
+    tcp[2] = mp_obj_new_int_from_uint(stats.tcp_time_wait);
+    tcp[3] = mp_obj_new_int_from_uint(CONFIG_LWIP_MAX_ACTIVE_TCP);
+    tcp[4] = mp_obj_new_int_from_uint(stats.tcp_retransmitting);
+    tcp[5] = mp_obj_new_int_from_uint(stats.tcp_nrtx);
+    tcp[6] = mp_obj_new_int_from_uint(stats.tcp_queued);
+    mp_obj_t udp[2];
+    udp[0] = mp_obj_new_int_from_uint(stats.udp);
+    udp[1] = mp_obj_new_int_from_uint(CONFIG_LWIP_MAX_UDP_PCBS);
+    mp_obj_t sock[4];
+    sock[0] = mp_obj_new_int_from_uint(used);
+    sock[1] = mp_obj_new_int_from_uint(modusocket_sockets_peak);
+    sock[2] = mp_obj_new_int_from_uint(CONFIG_LWIP_MAX_SOCKETS);
+    sock[3] = mp_obj_new_int_from_uint(stats.socket_errors);
+    mp_obj_t mem[3];
+    mem[0] = mp_obj_new_int_from_uint(heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    mem[1] = mp_obj_new_int_from_uint(heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    mem[2] = mp_obj_new_int_from_uint(stats.nomem);
+    if (args[0].u_bool) {
+        modusocket_sockets_peak = used;
+    }
+
+    mp_obj_t tuple[4];
+    tuple[0] = mp_obj_new_attrtuple(tcp_stats_fields, 7, tcp);
+    tuple[1] = mp_obj_new_attrtuple(udp_stats_fields, 2, udp);
+    tuple[2] = mp_obj_new_attrtuple(sock_stats_fields, 4, sock);
+    tuple[3] = mp_obj_new_attrtuple(mem_stats_fields, 3, mem);
+    return mp_obj_new_attrtuple(net_stats_fields, 4, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_usocket_netstats_obj, 0, mod_usocket_netstats);
+
+// function usocket.dnsprefetch(hosts)
+STATIC mp_obj_t mod_usocket_dnsprefetch(mp_obj_t hosts_in) {
+    mp_obj_t iter = mp_getiter(hosts_in, NULL);
+    mp_obj_t item;
+    mp_uint_t resolved = 0;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        const char *host = mp_obj_str_get_str(item);
+        uint32_t addr;
+        MP_THREAD_GIL_EXIT();
+        int32_t result = lwipsocket_dns_resolve(host, &addr);
+        MP_THREAD_GIL_ENTER();
+        if (result == 0) {
+            resolved++;
+        }
+    }
+    return mp_obj_new_int_from_uint(resolved);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_usocket_dnsprefetch_obj, mod_usocket_dnsprefetch);
+
 STATIC const mp_map_elem_t mp_module_usocket_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__),        MP_OBJ_NEW_QSTR(MP_QSTR_usocket) },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_socket),          (mp_obj_t)&socket_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_getaddrinfo),     (mp_obj_t)&mod_usocket_getaddrinfo_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_dnsserver),       (mp_obj_t)&mod_usocket_dnsserver_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dnscache),        (mp_obj_t)&mod_usocket_dnscache_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dnsflush),        (mp_obj_t)&mod_usocket_dnsflush_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dnsstats),        (mp_obj_t)&mod_usocket_dnsstats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dnsprefetch),     (mp_obj_t)&mod_usocket_dnsprefetch_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_netstats),        (mp_obj_t)&mod_usocket_netstats_obj },
 
     // class exceptions
     { MP_OBJ_NEW_QSTR(MP_QSTR_error),           (mp_obj_t)&mp_type_OSError },
@@ -1037,6 +1506,10 @@ STATIC const mp_map_elem_t mp_module_usocket_globals_table[] = {
 #endif
     { MP_OBJ_NEW_QSTR(MP_QSTR_SOL_SOCKET),      MP_OBJ_NEW_SMALL_INT(SOL_SOCKET) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_SO_REUSEADDR),    MP_OBJ_NEW_SMALL_INT(SO_REUSEADDR) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SO_KEEPALIVE),    MP_OBJ_NEW_SMALL_INT(SO_KEEPALIVE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SO_SNDBUF),       MP_OBJ_NEW_SMALL_INT(SO_SNDBUF) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SO_RCVBUF),       MP_OBJ_NEW_SMALL_INT(SO_RCVBUF) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_TCP_NODELAY),     MP_OBJ_NEW_SMALL_INT(TCP_NODELAY) },
 
 #if defined(LOPY) || defined (LOPY4) || defined(FIPY)
     { MP_OBJ_NEW_QSTR(MP_QSTR_SO_CONFIRMED),    MP_OBJ_NEW_SMALL_INT(SO_LORAWAN_CONFIRMED) },
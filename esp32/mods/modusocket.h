@@ -58,6 +58,12 @@
 * ex: ABCD:ABCD:ABCD:ABCD:ABCD:ABCD:ABCD:ABCD 4*8+7=39 chars */
 #define MOD_USOCKET_IPV6_CHARS_MAX                    40
 
+// largest resolver cache accepted by usocket.dnscache()
+#define MODUSOCKET_DNS_CACHE_SIZE_MAX                 64
+
+// most fragments accepted by socket.sendmsg()
+#define MOD_USOCKET_SENDMSG_IOV_MAX                   16
+
 extern const mp_obj_dict_t socket_locals_dict;
 extern const mp_stream_p_t socket_stream_p;
 
@@ -66,6 +72,7 @@ extern const mp_obj_type_t socket_type;
 extern void modusocket_pre_init (void);
 extern void modusocket_socket_add (int32_t sd, bool user);
 extern void modusocket_socket_delete (int32_t sd);
+extern uint32_t modusocket_socket_count (void);
 extern void modusocket_enter_sleep (void);
 extern void modusocket_close_all_user_sockets (void);
 
@@ -8,6 +8,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -28,11 +29,28 @@
 #include "modussl.h"
 #include "mptask.h"
 #include "pycom_general_util.h"
+#include "esp32chipinfo.h"
+#include "mpcpufreq.h"
+#include "esp_heap_caps.h"
+
+#include "mbedtls/platform.h"
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+#include "mbedtls/ssl_cache.h"
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+#include "mbedtls/ssl_ticket.h"
+#endif
 
 /******************************************************************************
  DEFINE CONSTANTS
  ******************************************************************************/
 #define DEFAULT_SSL_READ_TIMEOUT                    10 //sec
+// sessions remembered by the server side sockets
+#define MODUSSL_SERVER_CACHE_ENTRIES                4
+#define MODUSSL_SERVER_SESSION_LIFETIME             (24 * 3600) //sec
+// mbedTLS allocations from this size on (the record buffers and the certificates) go to the PSRAM
+#define MODUSSL_PSRAM_ALLOC_MIN                     (4096)
 
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
@@ -41,20 +59,131 @@
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
-// ssl sockets inherit from normal socket, so we take its
-// locals and stream methods
-STATIC const mp_obj_type_t ssl_socket_type = {
-    { &mp_type_type },
-    .name = MP_QSTR_ussl,
-    .getiter = NULL,
-    .iternext = NULL,
-    .protocol = &socket_stream_p,
-    .locals_dict = (mp_obj_t)&socket_locals_dict,
-};
+#if defined(MBEDTLS_SSL_CACHE_C)
+STATIC mbedtls_ssl_cache_context modussl_server_cache;
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+STATIC mbedtls_ssl_ticket_context modussl_server_ticket;
+STATIC mbedtls_entropy_context modussl_ticket_entropy;
+STATIC mbedtls_ctr_drbg_context modussl_ticket_drbg;
+#endif
+STATIC bool modussl_server_cache_ready;
+
+
+#if defined(MBEDTLS_PLATFORM_MEMORY) && !defined(MBEDTLS_PLATFORM_CALLOC_MACRO)
+// the small and short lived allocations (bignums, cipher contexts) stay in the faster
+// internal RAM, the per socket record buffers (2 x 16 KB) don't need to
+STATIC void *mod_ssl_calloc (size_t n, size_t size) {
+    void *p = NULL;
+    if (n * size >= MODUSSL_PSRAM_ALLOC_MIN && esp32_get_chip_rev() > 0) {
+        p = heap_caps_calloc(n, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (p == NULL) {
+        p = heap_caps_calloc(n, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return p;
+}
+#endif
+
+void modussl_pre_init (void) {
+#if defined(MBEDTLS_PLATFORM_MEMORY) && !defined(MBEDTLS_PLATFORM_CALLOC_MACRO)
+    // heap_caps_free() (behind free()) returns the memory to whichever heap it came from
+    mbedtls_platform_set_calloc_free(mod_ssl_calloc, free);
+#endif
+}
+
+// the session ID cache and the ticket keys are shared by all the server side sockets
+static int32_t mod_ssl_server_cache_init (void) {
+    if (modussl_server_cache_ready) {
+        return 0;
+    }
+#if defined(MBEDTLS_SSL_CACHE_C)
+    mbedtls_ssl_cache_init(&modussl_server_cache);
+    mbedtls_ssl_cache_set_max_entries(&modussl_server_cache, MODUSSL_SERVER_CACHE_ENTRIES);
+    mbedtls_ssl_cache_set_timeout(&modussl_server_cache, MODUSSL_SERVER_SESSION_LIFETIME);
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+    int32_t ret;
+    mbedtls_ssl_ticket_init(&modussl_server_ticket);
+    mbedtls_entropy_init(&modussl_ticket_entropy);
+    mbedtls_ctr_drbg_init(&modussl_ticket_drbg);
+    if ((ret = mbedtls_ctr_drbg_seed(&modussl_ticket_drbg, mbedtls_entropy_func, &modussl_ticket_entropy, (const unsigned char *)"Pycom ticket", strlen("Pycom ticket"))) != 0 ||
+        (ret = mbedtls_ssl_ticket_setup(&modussl_server_ticket, mbedtls_ctr_drbg_random, &modussl_ticket_drbg,
+                                        MBEDTLS_CIPHER_AES_128_GCM, MODUSSL_SERVER_SESSION_LIFETIME)) != 0) {
+        mbedtls_ssl_ticket_free(&modussl_server_ticket);
+        mbedtls_ctr_drbg_free(&modussl_ticket_drbg);
+        mbedtls_entropy_free(&modussl_ticket_entropy);
+        return ret;
+    }
+#endif
+    modussl_server_cache_ready = true;
+    return 0;
+}
+
+// turns the blob of ssl_socket.session() back into a session, the ticket stays in the blob
+STATIC void mod_ssl_session_from_blob (const byte *blob, size_t len, mbedtls_ssl_session *session) {
+    modussl_session_blob_t hdr;
+    if (len < sizeof(hdr)) {
+        goto arg_error;
+    }
+    memcpy(&hdr, blob, sizeof(hdr));
+    if (hdr.magic != MODUSSL_SESSION_MAGIC || hdr.version != MODUSSL_SESSION_VERSION ||
+        hdr.id_len > sizeof(hdr.id) || len != sizeof(hdr) + hdr.ticket_len) {
+        goto arg_error;
+    }
+
+    mbedtls_ssl_session_init(session);
+#if defined(MBEDTLS_HAVE_TIME)
+    session->start = mbedtls_time(NULL);
+#endif
+    session->ciphersuite = hdr.ciphersuite;
+    session->compression = hdr.compression;
+    session->id_len = hdr.id_len;
+    memcpy(session->id, hdr.id, sizeof(session->id));
+    memcpy(session->master, hdr.master, sizeof(session->master));
+    session->verify_result = hdr.verify_result;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    session->ticket = hdr.ticket_len ? (unsigned char *)blob + sizeof(hdr) : NULL;
+    session->ticket_len = hdr.ticket_len;
+    session->ticket_lifetime = hdr.ticket_lifetime;
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    session->mfl_code = hdr.mfl_code;
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    session->trunc_hmac = hdr.trunc_hmac;
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    session->encrypt_then_mac = hdr.encrypt_then_mac;
+#endif
+    return;
+
+arg_error:
+    mp_raise_ValueError("invalid session");
+}
+
+// the public key operations of a handshake run at the boost frequency of machine.freq(auto=...)
+int modussl_handshake_step (mp_obj_ssl_socket_t *ssl_sock) {
+    mpcpufreq_boost_begin();
+    int ret = mbedtls_ssl_handshake(&ssl_sock->ssl);
+    mpcpufreq_boost_end();
+    return ret;
+}
+
+void modussl_handshake_done (mp_obj_ssl_socket_t *ssl_sock) {
+    if (ssl_sock->resume_offered) {
+        // a resumed session keeps its master secret, a full handshake derives a new one
+        ssl_sock->resumed = ssl_sock->ssl.session != NULL &&
+                            memcmp(ssl_sock->ssl.session->master, ssl_sock->resume_master, sizeof(ssl_sock->resume_master)) == 0;
+        memset(ssl_sock->resume_master, 0, sizeof(ssl_sock->resume_master));
+        ssl_sock->resume_offered = false;
+    }
+}
 
 static int32_t mod_ssl_setup_socket (mp_obj_ssl_socket_t *ssl_sock, const char *host_name,
                                      const char *ca_cert, const char *client_cert, const char *client_key,
-                                     uint32_t ssl_verify, uint32_t client_or_server) {
+                                     uint32_t ssl_verify, uint32_t client_or_server, const mbedtls_ssl_session *session,
+                                     uint8_t mfl_code, bool do_handshake) {
 
     int32_t ret;
     mbedtls_ssl_init(&ssl_sock->ssl);
@@ -116,6 +245,22 @@ static int32_t mod_ssl_setup_socket (mp_obj_ssl_socket_t *ssl_sock, const char *
         }
     }
 
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    // asks the server for shorter records (RFC 6066)
+    if ((ret = mbedtls_ssl_conf_max_frag_len(&ssl_sock->conf, mfl_code)) != 0) {
+        return ret;
+    }
+#endif
+
+    if (client_or_server == MBEDTLS_SSL_IS_SERVER && modussl_server_cache_ready) {
+#if defined(MBEDTLS_SSL_CACHE_C)
+        mbedtls_ssl_conf_session_cache(&ssl_sock->conf, &modussl_server_cache, mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+        mbedtls_ssl_conf_session_tickets_cb(&ssl_sock->conf, mbedtls_ssl_ticket_write, mbedtls_ssl_ticket_parse, &modussl_server_ticket);
+#endif
+    }
+
     if ((ret = mbedtls_ssl_setup(&ssl_sock->ssl, &ssl_sock->conf)) != 0) {
         // printf("mbedtls_ssl_setup returned -0x%x\n\n", -ret);
         return ret;
@@ -130,11 +275,20 @@ static int32_t mod_ssl_setup_socket (mp_obj_ssl_socket_t *ssl_sock, const char *
         }
     }
 
+    if (session) {
+        // offer the previous session (its ID or its ticket) for an abbreviated handshake
+        if ((ret = mbedtls_ssl_set_session(&ssl_sock->ssl, session)) != 0) {
+            return ret;
+        }
+        memcpy(ssl_sock->resume_master, session->master, sizeof(ssl_sock->resume_master));
+        ssl_sock->resume_offered = true;
+    }
+
     ssl_sock->context_fd.fd = ssl_sock->sock_base.u.sd;
     ssl_sock->sock_base.is_ssl = true;
 
-    // perform the handshake if already connected
-    if (ssl_sock->sock_base.connected) {
+    // perform the handshake if already connected, unless it's left to do_handshake()
+    if (do_handshake && ssl_sock->sock_base.connected) {
 
         if ((ret = mbedtls_net_set_block(&ssl_sock->context_fd)) != 0) {
             // printf("failed! net_set_(non)block() returned -0x%x\n", -ret);
@@ -145,7 +299,7 @@ static int32_t mod_ssl_setup_socket (mp_obj_ssl_socket_t *ssl_sock, const char *
 
         // printf("Performing the SSL/TLS handshake...\n");
         int count = 0;
-        while ((ret = mbedtls_ssl_handshake(&ssl_sock->ssl)) != 0)
+        while ((ret = modussl_handshake_step(ssl_sock)) != 0)
         {
             if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_TIMEOUT) || count >= ssl_sock->read_timeout) {
                  //printf("mbedtls_ssl_handshake returned -0x%x\n", -ret);
@@ -165,12 +319,96 @@ static int32_t mod_ssl_setup_socket (mp_obj_ssl_socket_t *ssl_sock, const char *
         } else {
             // printf("Certificate verified.\n");
         }
+        modussl_handshake_done(ssl_sock);
     }
 
     return 0;
 }
 
 
+/******************************************************************************/
+// Micro Python bindings; SSL socket
+
+// attribute ssl_socket.session
+STATIC mp_obj_t ssl_socket_session(mp_obj_ssl_socket_t *self) {
+    const mbedtls_ssl_session *session = self->ssl.session;
+    if (session == NULL || self->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        return mp_const_none;
+    }
+
+    modussl_session_blob_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = MODUSSL_SESSION_MAGIC;
+    hdr.version = MODUSSL_SESSION_VERSION;
+    hdr.id_len = session->id_len;
+    hdr.compression = session->compression;
+    hdr.ciphersuite = session->ciphersuite;
+    hdr.verify_result = session->verify_result;
+    memcpy(hdr.id, session->id, sizeof(hdr.id));
+    memcpy(hdr.master, session->master, sizeof(hdr.master));
+    const unsigned char *ticket = NULL;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    if (session->ticket_len <= MODUSSL_SESSION_TICKET_MAX) {
+        ticket = session->ticket;
+        hdr.ticket_len = session->ticket_len;
+        hdr.ticket_lifetime = session->ticket_lifetime;
+    }
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    hdr.mfl_code = session->mfl_code;
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    hdr.trunc_hmac = session->trunc_hmac;
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    hdr.encrypt_then_mac = session->encrypt_then_mac;
+#endif
+    if (hdr.id_len == 0 && hdr.ticket_len == 0) {
+        // the server offered nothing to resume
+        return mp_const_none;
+    }
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, sizeof(hdr) + hdr.ticket_len);
+    memcpy(vstr.buf, &hdr, sizeof(hdr));
+    if (hdr.ticket_len) {
+        memcpy(vstr.buf + sizeof(hdr), ticket, hdr.ticket_len);
+    }
+    memset(hdr.master, 0, sizeof(hdr.master));
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+STATIC void ssl_socket_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    mp_obj_ssl_socket_t *self = self_in;
+    if (dest[0] != MP_OBJ_NULL) {
+        // the attributes are read only
+        return;
+    }
+    if (attr == MP_QSTR_session) {
+        dest[0] = ssl_socket_session(self);
+    } else if (attr == MP_QSTR_session_reused) {
+        dest[0] = mp_obj_new_bool(self->resumed);
+    } else {
+        // the rest are the methods of the normal socket
+        mp_map_elem_t *elem = mp_map_lookup((mp_map_t *)&socket_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            mp_convert_member_lookup(self_in, self->base.type, elem->value, dest);
+        }
+    }
+}
+
+// ssl sockets inherit from normal socket, so we take its
+// locals and stream methods
+const mp_obj_type_t ssl_socket_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_ussl,
+    .getiter = NULL,
+    .iternext = NULL,
+    .attr = ssl_socket_attr,
+    .protocol = &socket_stream_p,
+    .locals_dict = (mp_obj_t)&socket_locals_dict,
+};
+
 /******************************************************************************/
 // Micro Python bindings; SSL class
 
@@ -185,6 +423,9 @@ STATIC mp_obj_t mod_ssl_wrap_socket(mp_uint_t n_args, const mp_obj_t *pos_args,
         { MP_QSTR_ca_certs,                     MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
         { MP_QSTR_server_hostname,              MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
         { MP_QSTR_timeout,                      MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_session,                      MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_max_fragment_length,          MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+        { MP_QSTR_do_handshake,                 MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} },
     };
 
     int32_t _error;
@@ -212,12 +453,51 @@ STATIC mp_obj_t mod_ssl_wrap_socket(mp_uint_t n_args, const mp_obj_t *pos_args,
         goto arg_error;
     }
 
+    uint8_t mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+    if (args[10].u_obj != mp_const_none) {
+        switch (mp_obj_get_int(args[10].u_obj)) {
+        case 512:
+            mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_512;
+            break;
+        case 1024:
+            mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+            break;
+        case 2048:
+            mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+            break;
+        case 4096:
+            mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+            break;
+        default:
+            goto arg_error;
+        }
+    }
+
     // create the ssl socket
     mp_obj_ssl_socket_t *ssl_sock = m_new_obj_with_finaliser(mp_obj_ssl_socket_t);
     // ssl sockets inherit all properties from the original socket
     memcpy (&ssl_sock->sock_base, &((mod_network_socket_obj_t *)args[0].u_obj)->sock_base, sizeof(mod_network_socket_base_t));
     ssl_sock->base.type = &ssl_socket_type;
     ssl_sock->o_sock = args[0].u_obj;       // this is needed so that the GC doesnt collect the socket
+    ssl_sock->resume_offered = false;
+    ssl_sock->resumed = false;
+
+    // a session exported from a previous connection to the same server
+    mbedtls_ssl_session session;
+    bool has_session = false;
+    if (args[9].u_obj != mp_const_none) {
+        if (server_side) {
+            goto arg_error;
+        }
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[9].u_obj, &bufinfo, MP_BUFFER_READ);
+        mod_ssl_session_from_blob(bufinfo.buf, bufinfo.len, &session);
+        has_session = true;
+    }
+
+    if (server_side && (_error = mod_ssl_server_cache_init()) != 0) {
+        mp_raise_OSError(_error);
+    }
 
     //Read timeout
     if(args[8].u_obj == mp_const_none)
@@ -254,7 +534,12 @@ STATIC mp_obj_t mod_ssl_wrap_socket(mp_uint_t n_args, const mp_obj_t *pos_args,
     MP_THREAD_GIL_EXIT();
 
     _error = mod_ssl_setup_socket(ssl_sock, host_name, ca_cert, client_cert, client_key,
-                                  verify_type, server_side ? MBEDTLS_SSL_IS_SERVER : MBEDTLS_SSL_IS_CLIENT);
+                                  verify_type, server_side ? MBEDTLS_SSL_IS_SERVER : MBEDTLS_SSL_IS_CLIENT,
+                                  has_session ? &session : NULL, mfl_code, args[11].u_bool);
+
+    if (has_session) {
+        memset(session.master, 0, sizeof(session.master));
+    }
 
     MP_THREAD_GIL_ENTER();
 
@@ -282,6 +567,8 @@ STATIC const mp_map_elem_t mp_module_ussl_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_CERT_REQUIRED),       MP_OBJ_NEW_SMALL_INT(MBEDTLS_SSL_VERIFY_REQUIRED) },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_SSL_TIMEOUT),         MP_OBJ_NEW_SMALL_INT(MBEDTLS_ERR_SSL_TIMEOUT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SSL_WANT_READ),       MP_OBJ_NEW_SMALL_INT(MOD_NETWORK_HANDSHAKE_WANT_READ) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SSL_WANT_WRITE),      MP_OBJ_NEW_SMALL_INT(MOD_NETWORK_HANDSHAKE_WANT_WRITE) },
 
     // { MP_OBJ_NEW_QSTR(MP_QSTR_PROTOCOL_SSLv3),      MP_OBJ_NEW_SMALL_INT(SL_SO_SEC_METHOD_SSLV3) },
     // { MP_OBJ_NEW_QSTR(MP_QSTR_PROTOCOL_TLSv1),      MP_OBJ_NEW_SMALL_INT(SL_SO_SEC_METHOD_TLSV1) },
@@ -24,9 +24,33 @@
 #include "mbedtls/error.h"
 #include "mbedtls/certs.h"
 
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MODUSSL_SESSION_MAGIC               (0x5E)
+#define MODUSSL_SESSION_VERSION             (1)
+#define MODUSSL_SESSION_TICKET_MAX          (1024)
+
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
+// header of the blob returned by ssl_socket.session(), an eventual ticket follows it
+typedef struct {
+    uint8_t     magic;
+    uint8_t     version;
+    uint8_t     id_len;
+    uint8_t     compression;
+    int32_t     ciphersuite;
+    uint32_t    verify_result;
+    uint32_t    ticket_lifetime;
+    uint16_t    ticket_len;
+    uint8_t     mfl_code;
+    uint8_t     trunc_hmac;
+    uint8_t     encrypt_then_mac;
+    uint8_t     id[32];
+    uint8_t     master[48];
+} modussl_session_blob_t;
+
 typedef struct _mp_obj_ssl_socket_t {
     mp_obj_base_t base;
     mod_network_socket_base_t sock_base;
@@ -43,6 +67,21 @@ typedef struct _mp_obj_ssl_socket_t {
     mbedtls_x509_crt own_cert;
     mbedtls_pk_context pk_key;
     uint8_t read_timeout;
+    bool resume_offered;
+    bool resumed;               // the server accepted the offered session, the handshake was an abbreviated one
+    uint8_t resume_master[48];  // master secret of the offered session, kept until the handshake is over
 } mp_obj_ssl_socket_t;
 
+/******************************************************************************
+ EXPORTED DATA
+ ******************************************************************************/
+extern const mp_obj_type_t ssl_socket_type;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+extern void modussl_pre_init(void);
+extern void modussl_handshake_done(mp_obj_ssl_socket_t *ssl_sock);
+extern int modussl_handshake_step(mp_obj_ssl_socket_t *ssl_sock);
+
 #endif /* MODUSSL_H_ */
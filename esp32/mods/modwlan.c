@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "py/mpconfig.h"
 #include "py/obj.h"
@@ -31,6 +32,11 @@
 #include "esp_event_loop.h"
 #include "esp_wpa2.h"
 #include "esp_smartconfig.h"
+#include "esp_now.h"
+#include "esp_timer.h"
+#include "rom/crc.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pkcs5.h"
 
 //#include "timeutils.h"
 #include "netutils.h"
@@ -56,10 +62,36 @@
 #include "mptask.h"
 #include "pycom_config.h"
 #include "pycom_general_util.h"
+#include "mptrace.h"
+#include "mpmetrics.h"
+#if defined(FIPY) || defined(GPY)
+#include "netfailover.h"
+#endif
 
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
+// last AP joined, kept in RTC memory to skip the scan and the PMK derivation after a deep sleep
+typedef struct {
+    uint32_t    magic;
+    uint8_t     ssid[(MODWLAN_SSID_LEN_MAX + 1)];
+    uint8_t     bssid[6];
+    uint8_t     channel;
+    bool        pmk_set;
+    uint32_t    key_crc;    // of the passphrase the PMK was derived from
+    uint8_t     pmk[32];
+    uint32_t    crc;
+} wlan_fast_conn_t;
+
+// phases of the last connection, in microseconds since it started
+typedef struct {
+    int64_t     start;
+    uint32_t    pmk_us;
+    uint32_t    assoc_us;   // up to SYSTEM_EVENT_STA_CONNECTED, scan and 4-way handshake included
+    uint32_t    ip_us;
+    bool        fast;       // the cached BSSID and channel were used
+    bool        fallback;   // the fast attempt failed and a full scan was done
+} wlan_conn_timing_t;
 
 /******************************************************************************
  DEFINE CONSTANTS
@@ -74,8 +106,25 @@
 
 #define MAX_WIFI_PKT_PARAMS                    18
 
+#define WLAN_CAPTURE_RING_SIZE_DEFAULT          (16 * 1024)
+#define WLAN_CAPTURE_RING_SIZE_PSRAM            (256 * 1024)
+#define WLAN_CAPTURE_RING_SIZE_MAX              (2 * 1024 * 1024)
+#define WLAN_CAPTURE_SNAPLEN_DEFAULT            (256)
+#define WLAN_CAPTURE_RSSI_NONE                  (-128)
+#define WLAN_CAPTURE_TYPES_ALL                  (MOD_WLAN_TRIGGER_PKT_MGMT | MOD_WLAN_TRIGGER_PKT_CTRL | MOD_WLAN_TRIGGER_PKT_DATA)
+#define WLAN_PCAP_MAGIC                         (0xA1B2C3D4)
+#define WLAN_PCAP_LINKTYPE_RADIOTAP             (127)
+#define WLAN_PCAP_GLOBAL_HDR_LEN                (24)
+#define WLAN_PCAP_REC_HDR_LEN                   (16)
+// flags (FCS included), channel and antenna signal
+#define WLAN_RADIOTAP_HDR_LEN                   (15)
+#define WLAN_CAPTURE_REC_LEN_MAX                (WLAN_PCAP_REC_HDR_LEN + WLAN_RADIOTAP_HDR_LEN + MAX_WIFI_PROM_PKT_SIZE)
+
 #define SMART_CONF_TASK_STACK_SIZE              4096
 
+#define WLAN_FAST_CONN_MAGIC                    (0x57464331)
+#define WLAN_PMK_ITERATIONS                     (4096)
+
 #define SMART_CONF_TASK_PRIORITY                5
 
 #define CHECK_ESP_ERR( x, gotofun ) if(ESP_OK != x) { goto gotofun; }
@@ -114,6 +163,16 @@ static TimerHandle_t wlan_conn_timeout_timer = NULL;
 static TimerHandle_t wlan_smartConfig_timeout = NULL;
 static uint8_t wlan_prom_data_buff[2][MAX_WIFI_PROM_PKT_SIZE] = {0};
 static wlan_internal_prom_t wlan_prom_packet[2];
+static wlan_capture_t wlan_capture;
+static wlan_scan_t wlan_scan_async;
+static wlan_espnow_t wlan_espnow;
+static wlan_stats_t wlan_stats;
+static wlan_ap_config_t wlan_ap_config;
+static wlan_ap_clients_t wlan_ap;
+static RTC_DATA_ATTR wlan_fast_conn_t wlan_fast_conn;
+static wlan_fast_conn_t wlan_fast_conn_pending;
+static wlan_conn_timing_t wlan_conn_timing;
+static bool wlan_fast_conn_trying = false;
 
 static uint8_t token = 0;
 
@@ -132,6 +191,7 @@ SemaphoreHandle_t smartConfigTimeout_mutex;
 
 static const int ESPTOUCH_DONE_BIT = BIT1;
 static const int ESPTOUCH_STOP_BIT = BIT2;
+static const int SCAN_DONE_BIT = BIT3;
 static bool wlan_smart_config_enabled = false;
 
 /******************************************************************************
@@ -170,6 +230,20 @@ STATIC void wlan_stop_smartConfig_timer();
 static void smart_config_callback(smartconfig_status_t status, void *pdata);
 static void TASK_SMART_CONFIG (void *pvParameters);
 STATIC void wlan_callback_handler(void* arg);
+static void wlan_capture_put(const wifi_promiscuous_pkt_t *pkt, wifi_promiscuous_pkt_type_t type);
+static bool wlan_fast_conn_valid(void);
+static void wlan_fast_conn_save(const uint8_t *bssid, uint8_t channel);
+static esp_err_t wlan_scan_next(void);
+static void wlan_scan_collect(void);
+static void wlan_stats_hook_netif(void);
+static void wlan_stats_timer_callback(TimerHandle_t xTimer);
+static void wlan_metrics_collect(uint32_t *values);
+static void wlan_ap_hook_netif(void);
+static void wlan_ap_client_add(const uint8_t *mac, uint8_t aid);
+static void wlan_ap_client_remove(uint8_t aid);
+static void wlan_ap_clients_sample(void);
+STATIC void wlan_validate_ap_config(const wlan_ap_config_t *config);
+static void wlan_espnow_stop(void);
 //*****************************************************************************
 //
 //! \brief The Function Handles WLAN Events
@@ -199,8 +273,19 @@ void wlan_pre_init (void) {
     (wlan_prom_packet[0].data) = (uint8_t*) (&(wlan_prom_data_buff[0][0]));
     (wlan_prom_packet[1].data) = (uint8_t*) (&(wlan_prom_data_buff[1][0]));
     wlan_obj.mutex = xSemaphoreCreateMutex();
+    wlan_capture.mutex = xSemaphoreCreateMutex();
+    wlan_scan_async.mutex = xSemaphoreCreateMutex();
+    wlan_espnow.mutex = xSemaphoreCreateMutex();
+    wlan_capture.types = WLAN_CAPTURE_TYPES_ALL;
+    wlan_capture.subtypes = 0xFFFF;
+    wlan_capture.snaplen = WLAN_CAPTURE_SNAPLEN_DEFAULT;
+    wlan_capture.rssi = WLAN_CAPTURE_RSSI_NONE;
     timeout_mutex = xSemaphoreCreateMutex();
     smartConfigTimeout_mutex = xSemaphoreCreateMutex();
+    wlan_ap_config.max_clients = MAX_AP_CONNECTED_STA;
+    wlan_ap_config.beacon_interval = MODWLAN_AP_BEACON_MIN;
+    wlan_stats.timer = xTimerCreate("Wlan_Stats", MODWLAN_STATS_PERIOD_MS / portTICK_PERIOD_MS, pdTRUE, 0, wlan_stats_timer_callback);
+    mpmetrics_register(&wlan_metrics_source);
     memcpy(wlan_obj.country.cc, (const char*)"NA", sizeof(wlan_obj.country.cc));
     // create Smart Config Task
     xTaskCreatePinnedToCore(TASK_SMART_CONFIG, "SmartConfig", SMART_CONF_TASK_STACK_SIZE / sizeof(StackType_t), NULL, SMART_CONF_TASK_PRIORITY, &SmartConfTaskHandle, 1);
@@ -245,7 +330,21 @@ void wlan_resume (bool reconnect)
 
 void wlan_setup (wlan_internal_setup_t *config) {
 
+    if (config->ap_config != NULL) {
+        wlan_ap_config = *(config->ap_config);
+    }
+
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    // the driver only allocates its TX buffers here, so their split can't change after
+    if (wlan_ap_config.tx_buf_static) {
+        cfg.tx_buf_type = 0;
+        cfg.static_tx_buf_num = wlan_ap_config.tx_buf_static;
+    } else if (wlan_ap_config.tx_buf_dynamic) {
+        cfg.tx_buf_type = 1;
+    }
+    if (wlan_ap_config.tx_buf_dynamic) {
+        cfg.dynamic_tx_buf_num = wlan_ap_config.tx_buf_dynamic;
+    }
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
@@ -352,6 +451,8 @@ STATIC bool wlan_is_inf_up(void)
 }
 
 STATIC esp_err_t wlan_event_handler(void *ctx, system_event_t *event) {
+    MPTRACE(MPTRACE_WLAN_EVENT, event->event_id,
+            (event->event_id == SYSTEM_EVENT_STA_DISCONNECTED) ? event->event_info.disconnected.reason : 0);
     switch(event->event_id) {
         case SYSTEM_EVENT_STA_START: /**< ESP32 station start */
             wlan_obj.sta_stopped = false;
@@ -367,16 +468,29 @@ STATIC esp_err_t wlan_event_handler(void *ctx, system_event_t *event) {
             wlan_obj.channel = _event->channel;
             wlan_obj.auth = _event->authmode;
             wlan_obj.disconnected = false;
+            wlan_stats.connects++;
+            wlan_stats.connected_at = esp_timer_get_time();
+            if (wlan_conn_timing.start && !wlan_conn_timing.assoc_us) {
+                wlan_conn_timing.assoc_us = esp_timer_get_time() - wlan_conn_timing.start;
+            }
+            wlan_fast_conn_trying = false;
+            wlan_fast_conn_save(_event->bssid, _event->channel);
             /* Stop Conn timeout counter*/
             wlan_stop_sta_conn_timer();
         }
             break;
         case SYSTEM_EVENT_STA_GOT_IP: /**< ESP32 station got IP from connected AP */
+            if (wlan_conn_timing.start && !wlan_conn_timing.ip_us) {
+                wlan_conn_timing.ip_us = esp_timer_get_time() - wlan_conn_timing.start;
+            }
             xEventGroupSetBits(wifi_event_group, CONNECTED_BIT);
             mod_network_register_nic(&wlan_obj);
+            wlan_stats_hook_netif();
+            xTimerStart(wlan_stats.timer, 0);
 #if defined(FIPY) || defined(GPY)
             // Save DNS info for restoring if wifi inf is usable again after LTE disconnect
             tcpip_adapter_get_dns_info(TCPIP_ADAPTER_IF_STA, TCPIP_ADAPTER_DNS_MAIN, &wlan_sta_inf_dns_info);
+            netfailover_link_event(E_NETFAILOVER_WLAN, true);
 #endif
             is_inf_up = true;
             break;
@@ -384,6 +498,32 @@ STATIC esp_err_t wlan_event_handler(void *ctx, system_event_t *event) {
             xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
             system_event_sta_disconnected_t *disconn = &event->event_info.disconnected;
         	is_inf_up = false;
+#if defined(FIPY) || defined(GPY)
+            netfailover_link_event(E_NETFAILOVER_WLAN, false);
+#endif
+            if (wlan_stats.connected_at) {
+                wlan_stats.disconnects++;
+                wlan_stats.connected_at = 0;
+            }
+            wlan_stats.last_reason = disconn->reason;
+            if (disconn->reason == WIFI_REASON_BEACON_TIMEOUT) {
+                wlan_stats.beacon_loss++;
+            }
+            if (wlan_fast_conn_trying) {
+                // the cached AP didn't work, forget it and fall back to a full scan
+                wifi_config_t wifi_config;
+                wlan_fast_conn_trying = false;
+                wlan_fast_conn.magic = 0;
+                wlan_conn_timing.fallback = true;
+                if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK) {
+                    wifi_config.sta.bssid_set = false;
+                    wifi_config.sta.channel = 0;
+                    wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+                    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+                }
+                esp_wifi_connect();
+                break;
+            }
             switch (disconn->reason) {
                 case WIFI_REASON_AUTH_FAIL:
                 case WIFI_REASON_ASSOC_LEAVE:
@@ -407,23 +547,42 @@ STATIC esp_err_t wlan_event_handler(void *ctx, system_event_t *event) {
         case SYSTEM_EVENT_AP_START:                 /**< ESP32 soft-AP start */
             mod_wlan_ap_number_of_connections = 0;
             wlan_obj.soft_ap_stopped = false;
+            memset(wlan_ap.clients, 0, sizeof(wlan_ap.clients));
+            wlan_ap_hook_netif();
+            xTimerStart(wlan_stats.timer, 0);
             break;
         case SYSTEM_EVENT_AP_STOP:                  /**< ESP32 soft-AP stop */
             xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
             wlan_obj.soft_ap_stopped = true;
             break;
         case SYSTEM_EVENT_AP_STACONNECTED:          /**< a station connected to ESP32 soft-AP */
+            wlan_ap_client_add(event->event_info.sta_connected.mac, event->event_info.sta_connected.aid);
             mod_wlan_ap_number_of_connections++;
             xEventGroupSetBits(wifi_event_group, CONNECTED_BIT);
             break;
         case SYSTEM_EVENT_AP_STADISCONNECTED:       /**< a station disconnected from ESP32 soft-AP */
+            wlan_ap_client_remove(event->event_info.sta_disconnected.aid);
             mod_wlan_ap_number_of_connections--;
             if(mod_wlan_ap_number_of_connections == 0) {
                 xEventGroupClearBits(wifi_event_group, CONNECTED_BIT);
             }
             break;
-        case SYSTEM_EVENT_WIFI_READY:                /**< ESP32 WiFi ready */
         case SYSTEM_EVENT_SCAN_DONE:                /**< ESP32 finish scanning AP */
+            if (wlan_scan_async.running) {
+                wlan_scan_collect();
+                if (wlan_scan_async.pending && wlan_scan_next() == ESP_OK) {
+                    break;
+                }
+                wlan_scan_async.pending = 0;
+                wlan_scan_async.running = false;
+                xEventGroupSetBits(wifi_event_group, SCAN_DONE_BIT);
+                wlan_obj.events |= MOD_WLAN_SCAN_DONE;
+                if (wlan_obj.trigger & MOD_WLAN_SCAN_DONE) {
+                    mp_irq_queue_interrupt_non_ISR(wlan_callback_handler, &wlan_obj);
+                }
+            }
+            break;
+        case SYSTEM_EVENT_WIFI_READY:                /**< ESP32 WiFi ready */
         case SYSTEM_EVENT_STA_AUTHMODE_CHANGE:      /**< the auth mode of AP connected by ESP32 station changed */
         case SYSTEM_EVENT_STA_LOST_IP:              /**< ESP32 station lost IP and the IP is reset to 0 */
         case SYSTEM_EVENT_STA_WPS_ER_SUCCESS:       /**< ESP32 station wps succeeds in enrollee mode */
@@ -533,7 +692,8 @@ STATIC void wlan_setup_ap (const char *ssid, uint32_t auth, const char *key, uin
     strcpy((char *)config.ap.password, (char *)wlan_obj.key);
     config.ap.channel = channel;
     wlan_obj.channel = channel;
-    config.ap.max_connection = MAX_AP_CONNECTED_STA;
+    config.ap.max_connection = wlan_ap_config.max_clients;
+    config.ap.beacon_interval = wlan_ap_config.beacon_interval;
     config.ap.ssid_hidden = (uint8_t)hidden;
     esp_wifi_set_config(WIFI_IF_AP, &config);
     //get mac of AP
@@ -545,6 +705,17 @@ STATIC void wlan_setup_ap (const char *ssid, uint32_t auth, const char *key, uin
     MP_THREAD_GIL_EXIT();
 }
 
+STATIC void wlan_validate_ap_config (const wlan_ap_config_t *config) {
+    if (config->max_clients < 1 || config->max_clients > ESP_WIFI_MAX_CONN_NUM ||
+        config->beacon_interval < MODWLAN_AP_BEACON_MIN || config->beacon_interval > MODWLAN_AP_BEACON_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    if ((config->tx_buf_static && (config->tx_buf_static < MODWLAN_TX_BUF_STATIC_MIN || config->tx_buf_static > MODWLAN_TX_BUF_STATIC_MAX)) ||
+        (config->tx_buf_dynamic && (config->tx_buf_dynamic < MODWLAN_TX_BUF_DYNAMIC_MIN || config->tx_buf_dynamic > MODWLAN_TX_BUF_DYNAMIC_MAX))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid TX buffer count"));
+    }
+}
+
 STATIC void wlan_validate_mode (uint mode) {
     if (mode < WIFI_MODE_STA || mode > WIFI_MODE_APSTA) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
@@ -727,6 +898,311 @@ static void wlan_validate_country_policy(uint8_t policy)
     }
 }
 
+/*
+ * starts the scan of the next channel of the subset, or of all the channels at once
+ */
+static esp_err_t wlan_scan_next (void) {
+    uint8_t channel = 0;
+
+    if (wlan_scan_async.pending) {
+        channel = __builtin_ctz(wlan_scan_async.pending);
+        wlan_scan_async.pending &= ~(1 << channel);
+    }
+    wlan_scan_async.config.channel = channel;
+    return esp_wifi_scan_start(&wlan_scan_async.config, false);
+}
+
+/*
+ * appends the APs found by the last scan, runs in the event task
+ */
+static void wlan_scan_collect (void) {
+    uint16_t ap_num = 0;
+
+    esp_wifi_scan_get_ap_num(&ap_num);
+    if (ap_num == 0) {
+        return;
+    }
+
+    wifi_ap_record_t *ap_record_buffer = pvPortMalloc(ap_num * sizeof(wifi_ap_record_t));
+    if (ap_record_buffer == NULL) {
+        wlan_scan_async.dropped += ap_num;
+        return;
+    }
+    if (ESP_OK == esp_wifi_scan_get_ap_records(&ap_num, ap_record_buffer)) {
+        xSemaphoreTake(wlan_scan_async.mutex, portMAX_DELAY);
+        for (int i = 0; i < ap_num; i++) {
+            int j;
+            // an AP can be heard from the adjacent channels too
+            for (j = 0; j < wlan_scan_async.count; j++) {
+                if (!memcmp(wlan_scan_async.records[j].bssid, ap_record_buffer[i].bssid, 6)) {
+                    break;
+                }
+            }
+            if (j < wlan_scan_async.count) {
+                continue;
+            }
+            if (wlan_scan_async.count < MODWLAN_SCAN_RESULTS_MAX) {
+                memcpy(&wlan_scan_async.records[wlan_scan_async.count++], &ap_record_buffer[i], sizeof(wifi_ap_record_t));
+            } else {
+                wlan_scan_async.dropped++;
+            }
+        }
+        xSemaphoreGive(wlan_scan_async.mutex);
+    }
+    vPortFree(ap_record_buffer);
+}
+
+STATIC mp_obj_t wlan_scan_new_results (void) {
+    STATIC const qstr wlan_scan_info_fields[] = {
+        MP_QSTR_ssid, MP_QSTR_bssid, MP_QSTR_sec, MP_QSTR_channel, MP_QSTR_rssi
+    };
+    mp_obj_t nets = mp_obj_new_list(0, NULL);
+
+    xSemaphoreTake(wlan_scan_async.mutex, portMAX_DELAY);
+    for (; wlan_scan_async.read < wlan_scan_async.count; wlan_scan_async.read++) {
+        wifi_ap_record_t *ap_record = &wlan_scan_async.records[wlan_scan_async.read];
+        mp_obj_t tuple[5];
+        tuple[0] = mp_obj_new_str((const char *)ap_record->ssid, strlen((char *)ap_record->ssid));
+        tuple[1] = mp_obj_new_bytes((const byte *)ap_record->bssid, sizeof(ap_record->bssid));
+        tuple[2] = mp_obj_new_int(ap_record->authmode);
+        tuple[3] = mp_obj_new_int(ap_record->primary);
+        tuple[4] = mp_obj_new_int(ap_record->rssi);
+        mp_obj_list_append(nets, mp_obj_new_attrtuple(wlan_scan_info_fields, 5, tuple));
+    }
+    xSemaphoreGive(wlan_scan_async.mutex);
+
+    return nets;
+}
+
+/*
+ * the lwIP statistics are disabled, the station netif is wrapped to count its traffic
+ */
+static err_t wlan_stats_input (struct pbuf *p, struct netif *inp) {
+    wlan_stats.rx_packets++;
+    wlan_stats.rx_bytes += p->tot_len;
+    return wlan_stats.input(p, inp);
+}
+
+static err_t wlan_stats_linkoutput (struct netif *netif, struct pbuf *p) {
+    err_t err = wlan_stats.linkoutput(netif, p);
+    if (err == ERR_OK) {
+        wlan_stats.tx_packets++;
+        wlan_stats.tx_bytes += p->tot_len;
+    } else {
+        wlan_stats.tx_errors++;
+    }
+    return err;
+}
+
+static void wlan_stats_hook_netif (void) {
+    struct netif *netif = NULL;
+
+    if (tcpip_adapter_get_netif(TCPIP_ADAPTER_IF_STA, (void **)&netif) != ESP_OK || netif == NULL) {
+        return;
+    }
+    // the netif is created again every time the station is started
+    if (netif->input != wlan_stats_input) {
+        wlan_stats.input = netif->input;
+        netif->input = wlan_stats_input;
+    }
+    if (netif->linkoutput != wlan_stats_linkoutput) {
+        wlan_stats.linkoutput = netif->linkoutput;
+        netif->linkoutput = wlan_stats_linkoutput;
+    }
+}
+
+static void wlan_stats_timer_callback (TimerHandle_t xTimer) {
+    wifi_ap_record_t ap_info;
+    uint32_t rx_packets = wlan_stats.rx_packets;
+    uint32_t tx_packets = wlan_stats.tx_packets;
+    uint32_t rx_bytes = wlan_stats.rx_bytes;
+    uint32_t tx_bytes = wlan_stats.tx_bytes;
+
+    wlan_stats.rx_pps = (rx_packets - wlan_stats.last_rx_packets) * 1000 / MODWLAN_STATS_PERIOD_MS;
+    wlan_stats.tx_pps = (tx_packets - wlan_stats.last_tx_packets) * 1000 / MODWLAN_STATS_PERIOD_MS;
+    wlan_stats.rx_bps = (rx_bytes - wlan_stats.last_rx_bytes) * 1000 / MODWLAN_STATS_PERIOD_MS;
+    wlan_stats.tx_bps = (tx_bytes - wlan_stats.last_tx_bytes) * 1000 / MODWLAN_STATS_PERIOD_MS;
+    wlan_stats.last_rx_packets = rx_packets;
+    wlan_stats.last_tx_packets = tx_packets;
+    wlan_stats.last_rx_bytes = rx_bytes;
+    wlan_stats.last_tx_bytes = tx_bytes;
+
+    if (wlan_stats.connected_at && esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+        wlan_stats.rssi[wlan_stats.rssi_count % MODWLAN_RSSI_HISTORY_LEN] = ap_info.rssi;
+        wlan_stats.rssi_count++;
+    }
+    if (!wlan_obj.soft_ap_stopped) {
+        wlan_ap_clients_sample();
+    }
+}
+
+static const mpmetrics_desc_t wlan_metrics[] = {
+    { "rx_packets",     E_MPMETRICS_COUNTER },
+    { "tx_packets",     E_MPMETRICS_COUNTER },
+    { "rx_bytes",       E_MPMETRICS_COUNTER },
+    { "tx_bytes",       E_MPMETRICS_COUNTER },
+    { "tx_errors",      E_MPMETRICS_COUNTER },
+    { "connects",       E_MPMETRICS_COUNTER },
+    { "disconnects",    E_MPMETRICS_COUNTER },
+    { "beacon_loss",    E_MPMETRICS_COUNTER },
+    { "rx_bps",         E_MPMETRICS_GAUGE },
+    { "tx_bps",         E_MPMETRICS_GAUGE },
+    { "rssi",           E_MPMETRICS_GAUGE },        // the last sample, 0 while not connected
+};
+static mpmetrics_source_t wlan_metrics_source = {
+    .name = "wlan",
+    .metrics = wlan_metrics,
+    .n_metrics = MP_ARRAY_SIZE(wlan_metrics),
+    .collect = wlan_metrics_collect,
+};
+
+static void wlan_metrics_collect (uint32_t *values) {
+    values[0] = wlan_stats.rx_packets;
+    values[1] = wlan_stats.tx_packets;
+    values[2] = wlan_stats.rx_bytes;
+    values[3] = wlan_stats.tx_bytes;
+    values[4] = wlan_stats.tx_errors;
+    values[5] = wlan_stats.connects;
+    values[6] = wlan_stats.disconnects;
+    values[7] = wlan_stats.beacon_loss;
+    values[8] = wlan_stats.rx_bps;
+    values[9] = wlan_stats.tx_bps;
+    uint32_t rssi_count = wlan_stats.rssi_count;
+    values[10] = (wlan_stats.connected_at && rssi_count) ? (int32_t)wlan_stats.rssi[(rssi_count - 1) % MODWLAN_RSSI_HISTORY_LEN] : 0;
+}
+
+/*
+ * the soft-AP netif is wrapped as well, the frames are put on the account of
+ * the client by their source or destination MAC
+ */
+static wlan_ap_client_t *wlan_ap_client_find(const uint8_t *mac) {
+    for (int i = 0; i < ESP_WIFI_MAX_CONN_NUM; i++) {
+        wlan_ap_client_t *client = &wlan_ap.clients[i];
+        if (client->aid && !memcmp(client->mac, mac, 6)) {
+            return client;
+        }
+    }
+    return NULL;
+}
+
+static err_t wlan_ap_input (struct pbuf *p, struct netif *inp) {
+    if (p->len >= 12) {
+        wlan_ap_client_t *client = wlan_ap_client_find((uint8_t *)p->payload + 6);
+        if (client) {
+            client->rx_bytes += p->tot_len;
+            client->last_seen = esp_timer_get_time();
+        }
+    }
+    return wlan_ap.input(p, inp);
+}
+
+static err_t wlan_ap_linkoutput (struct netif *netif, struct pbuf *p) {
+    err_t err = wlan_ap.linkoutput(netif, p);
+    if (err == ERR_OK && p->len >= 6) {
+        wlan_ap_client_t *client = wlan_ap_client_find((uint8_t *)p->payload);
+        if (client) {
+            client->tx_bytes += p->tot_len;
+        }
+    }
+    return err;
+}
+
+static void wlan_ap_hook_netif (void) {
+    struct netif *netif = NULL;
+
+    if (tcpip_adapter_get_netif(TCPIP_ADAPTER_IF_AP, (void **)&netif) != ESP_OK || netif == NULL) {
+        return;
+    }
+    if (netif->input != wlan_ap_input) {
+        wlan_ap.input = netif->input;
+        netif->input = wlan_ap_input;
+    }
+    if (netif->linkoutput != wlan_ap_linkoutput) {
+        wlan_ap.linkoutput = netif->linkoutput;
+        netif->linkoutput = wlan_ap_linkoutput;
+    }
+}
+
+static void wlan_ap_client_add (const uint8_t *mac, uint8_t aid) {
+    wlan_ap_client_remove(aid);
+    for (int i = 0; i < ESP_WIFI_MAX_CONN_NUM; i++) {
+        wlan_ap_client_t *client = &wlan_ap.clients[i];
+        if (!client->aid) {
+            memset(client, 0, sizeof(*client));
+            memcpy(client->mac, mac, 6);
+            client->last_seen = esp_timer_get_time();
+            client->aid = aid;
+            return;
+        }
+    }
+}
+
+static void wlan_ap_client_remove (uint8_t aid) {
+    for (int i = 0; i < ESP_WIFI_MAX_CONN_NUM; i++) {
+        if (wlan_ap.clients[i].aid == aid) {
+            wlan_ap.clients[i].aid = 0;
+        }
+    }
+}
+
+// runs with the station counters, drops the clients silent for longer than inactive_time
+static void wlan_ap_clients_sample (void) {
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < ESP_WIFI_MAX_CONN_NUM; i++) {
+        wlan_ap_client_t *client = &wlan_ap.clients[i];
+        if (!client->aid) {
+            continue;
+        }
+        uint32_t rx_bytes = client->rx_bytes;
+        uint32_t tx_bytes = client->tx_bytes;
+        client->rx_bps = (rx_bytes - client->last_rx_bytes) * 1000 / MODWLAN_STATS_PERIOD_MS;
+        client->tx_bps = (tx_bytes - client->last_tx_bytes) * 1000 / MODWLAN_STATS_PERIOD_MS;
+        client->last_rx_bytes = rx_bytes;
+        client->last_tx_bytes = tx_bytes;
+        if (wlan_ap_config.inactive_time && now - client->last_seen > (int64_t)wlan_ap_config.inactive_time * 1000000) {
+            // the slot is freed by SYSTEM_EVENT_AP_STADISCONNECTED
+            esp_wifi_deauth_sta(client->aid);
+            client->last_seen = now;
+        }
+    }
+}
+
+static bool wlan_fast_conn_valid (void) {
+    return wlan_fast_conn.magic == WLAN_FAST_CONN_MAGIC &&
+           wlan_fast_conn.crc == crc32_le(0, (uint8_t *)&wlan_fast_conn, offsetof(wlan_fast_conn_t, crc));
+}
+
+/*
+ * stores the AP just joined, together with the PMK derived for this connection
+ */
+static void wlan_fast_conn_save (const uint8_t *bssid, uint8_t channel) {
+    if (wlan_fast_conn_pending.magic != WLAN_FAST_CONN_MAGIC) {
+        // not a connection started by wlan_do_connect
+        return;
+    }
+    memcpy(&wlan_fast_conn, &wlan_fast_conn_pending, sizeof(wlan_fast_conn));
+    memcpy(wlan_fast_conn.bssid, bssid, sizeof(wlan_fast_conn.bssid));
+    wlan_fast_conn.channel = channel;
+    wlan_fast_conn.crc = crc32_le(0, (uint8_t *)&wlan_fast_conn, offsetof(wlan_fast_conn_t, crc));
+}
+
+/*
+ * WPA2 PSK = PBKDF2-HMAC-SHA1(passphrase, ssid, 4096, 32)
+ */
+static bool wlan_derive_pmk (const char *ssid, const char *key, uint8_t *pmk) {
+    mbedtls_md_context_t ctx;
+    bool ret = false;
+
+    mbedtls_md_init(&ctx);
+    if (mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1) == 0 &&
+        mbedtls_pkcs5_pbkdf2_hmac(&ctx, (const unsigned char *)key, strlen(key), (const unsigned char *)ssid, strlen(ssid),
+                                  WLAN_PMK_ITERATIONS, 32, pmk) == 0) {
+        ret = true;
+    }
+    mbedtls_md_free(&ctx);
+    return ret;
+}
+
 STATIC void wlan_do_connect (const char* ssid, const char* bssid, const wifi_auth_mode_t auth, const char* key,
                              int32_t timeout, const wlan_wpa2_ent_obj_t * const wpa2_ent, const char* hostname, uint8_t channel) {
 
@@ -735,8 +1211,12 @@ STATIC void wlan_do_connect (const char* ssid, const char* bssid, const wifi_aut
     memset(&wifi_config, 0, sizeof(wifi_config));
 
     // first close any active connections
+    wlan_fast_conn_trying = false;
     esp_wifi_disconnect();
 
+    memset(&wlan_conn_timing, 0, sizeof(wlan_conn_timing));
+    wlan_conn_timing.start = esp_timer_get_time();
+
     strcpy((char *)wifi_config.sta.ssid, ssid);
 
     if (key) {
@@ -748,6 +1228,43 @@ STATIC void wlan_do_connect (const char* ssid, const char* bssid, const wifi_aut
         wifi_config.sta.bssid_set = true;
     }
 
+    // what will be cached once connected
+    memset(&wlan_fast_conn_pending, 0, sizeof(wlan_fast_conn_pending));
+    wlan_fast_conn_pending.magic = WLAN_FAST_CONN_MAGIC;
+    strlcpy((char *)wlan_fast_conn_pending.ssid, ssid, sizeof(wlan_fast_conn_pending.ssid));
+    bool cached = wlan_fast_conn_valid() && !strcmp((const char *)wlan_fast_conn.ssid, ssid);
+
+    if ((auth == WIFI_AUTH_WPA_PSK || auth == WIFI_AUTH_WPA2_PSK || auth == WIFI_AUTH_WPA_WPA2_PSK) &&
+        key && strlen(key) >= 8 && strlen(key) < 64) {
+        // hand the PMK to the supplicant as a hex PSK, so that it doesn't run PBKDF2 itself
+        uint32_t key_crc = crc32_le(0, (const uint8_t *)key, strlen(key));
+        if (cached && wlan_fast_conn.pmk_set && wlan_fast_conn.key_crc == key_crc) {
+            memcpy(wlan_fast_conn_pending.pmk, wlan_fast_conn.pmk, sizeof(wlan_fast_conn_pending.pmk));
+            wlan_fast_conn_pending.pmk_set = true;
+        } else {
+            wlan_fast_conn_pending.pmk_set = wlan_derive_pmk(ssid, key, wlan_fast_conn_pending.pmk);
+        }
+        if (wlan_fast_conn_pending.pmk_set) {
+            wlan_fast_conn_pending.key_crc = key_crc;
+            for (int i = 0; i < sizeof(wlan_fast_conn_pending.pmk); i++) {
+                snprintf((char *)&wifi_config.sta.password[i * 2], 3, "%02x", wlan_fast_conn_pending.pmk[i]);
+            }
+        }
+        wlan_conn_timing.pmk_us = esp_timer_get_time() - wlan_conn_timing.start;
+    } else if (cached && key && strlen(key) == 64) {
+        // already a PSK, only the AP can be reused
+        wlan_fast_conn_pending.key_crc = crc32_le(0, (const uint8_t *)key, strlen(key));
+    }
+
+    // go straight to the last AP joined, unless the caller chose one
+    if (cached && !bssid && channel == 0 && (wlan_fast_conn_pending.pmk_set || key == NULL ||
+        wlan_fast_conn_pending.key_crc == wlan_fast_conn.key_crc)) {
+        memcpy(wifi_config.sta.bssid, wlan_fast_conn.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.bssid_set = true;
+        channel = wlan_fast_conn.channel;
+        wlan_conn_timing.fast = true;
+    }
+
     wifi_config.sta.channel = channel;
     if(channel > 0)
     {
@@ -815,7 +1332,9 @@ STATIC void wlan_do_connect (const char* ssid, const char* bssid, const wifi_aut
         wlan_update_hostname();
     }
 
+    wlan_fast_conn_trying = wlan_conn_timing.fast;
     if (ESP_OK != esp_wifi_connect()) {
+        wlan_fast_conn_trying = false;
         goto os_error;
     }
 
@@ -869,6 +1388,10 @@ STATIC void promiscuous_callback(void *buf, wifi_promiscuous_pkt_type_t type)
     bool trigger = false;
     static uint8_t old_token = 0xFF;
 
+    if (wlan_capture.enabled) {
+        wlan_capture_put((wifi_promiscuous_pkt_t *)buf, type);
+    }
+
     switch (type)
     {
     case WIFI_PKT_MGMT:
@@ -946,6 +1469,259 @@ STATIC void promiscuous_callback(void *buf, wifi_promiscuous_pkt_type_t type)
     }
 }
 
+/*
+ * stores a received ESP-NOW message in the ring, runs in the WiFi task
+ */
+static void wlan_espnow_recv_cb (const uint8_t *mac, const uint8_t *data, int len) {
+    bool stored = false;
+
+    if (len <= 0 || len > MODWLAN_ESPNOW_DATA_LEN_MAX) {
+        return;
+    }
+    xSemaphoreTake(wlan_espnow.mutex, portMAX_DELAY);
+    wlan_espnow.received++;
+    if (wlan_espnow.head - wlan_espnow.tail < MODWLAN_ESPNOW_RX_SLOTS) {
+        wlan_espnow_rec_t *rec = &wlan_espnow.recs[wlan_espnow.head & (MODWLAN_ESPNOW_RX_SLOTS - 1)];
+        memcpy(rec->mac, mac, sizeof(rec->mac));
+        memcpy(rec->data, data, len);
+        rec->len = len;
+        wlan_espnow.head++;
+        stored = true;
+    } else {
+        wlan_espnow.dropped++;
+    }
+    xSemaphoreGive(wlan_espnow.mutex);
+
+    if (stored) {
+        wlan_obj.events |= MOD_WLAN_ESPNOW_RX;
+        if (wlan_obj.trigger & MOD_WLAN_ESPNOW_RX) {
+            mp_irq_queue_interrupt(wlan_callback_handler, &wlan_obj);
+        }
+    }
+}
+
+/*
+ * the outcome of the last espnow_send(), runs in the WiFi task
+ */
+static void wlan_espnow_send_cb (const uint8_t *mac, esp_now_send_status_t status) {
+    uint32_t event;
+
+    if (status == ESP_NOW_SEND_SUCCESS) {
+        wlan_espnow.tx_ok++;
+        event = MOD_WLAN_ESPNOW_TX;
+    } else {
+        wlan_espnow.tx_failed++;
+        event = MOD_WLAN_ESPNOW_TX_FAILED;
+    }
+    wlan_obj.events |= event;
+    if (wlan_obj.trigger & event) {
+        mp_irq_queue_interrupt(wlan_callback_handler, &wlan_obj);
+    }
+}
+
+static void wlan_espnow_stop (void) {
+    esp_now_unregister_recv_cb();
+    esp_now_unregister_send_cb();
+    esp_now_deinit();
+    wlan_espnow.enabled = false;
+    xSemaphoreTake(wlan_espnow.mutex, portMAX_DELAY);
+    heap_caps_free(wlan_espnow.recs);
+    wlan_espnow.recs = NULL;
+    xSemaphoreGive(wlan_espnow.mutex);
+}
+
+static void wlan_espnow_get_mac (mp_obj_t mac_o, uint8_t *mac) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(mac_o, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len != ESP_NOW_ETH_ALEN) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid MAC address"));
+    }
+    memcpy(mac, bufinfo.buf, ESP_NOW_ETH_ALEN);
+}
+
+static void wlan_espnow_get_key (mp_obj_t key_o, uint8_t *key) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(key_o, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len != ESP_NOW_KEY_LEN) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "the key must be 16 bytes long"));
+    }
+    memcpy(key, bufinfo.buf, ESP_NOW_KEY_LEN);
+}
+
+static void wlan_espnow_check (esp_err_t err) {
+    switch (err) {
+    case ESP_OK:
+        return;
+    case ESP_ERR_ESPNOW_NOT_INIT:
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "ESP-NOW not initialized"));
+    case ESP_ERR_ESPNOW_FULL:
+    case ESP_ERR_ESPNOW_NO_MEM:
+        mp_raise_OSError(MP_ENOMEM);
+    case ESP_ERR_ESPNOW_NOT_FOUND:
+        mp_raise_OSError(MP_ENOENT);
+    case ESP_ERR_ESPNOW_ARG:
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    default:
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+}
+
+/*
+ * (re)allocates the capture ring, in PSRAM when the device has it
+ */
+static bool wlan_capture_alloc (uint32_t size) {
+    uint8_t *data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+
+    if (data == NULL) {
+        data = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (data == NULL) {
+        return false;
+    }
+    xSemaphoreTake(wlan_capture.mutex, portMAX_DELAY);
+    heap_caps_free(wlan_capture.data);
+    wlan_capture.data = data;
+    wlan_capture.size = size;
+    wlan_capture.head = 0;
+    wlan_capture.tail = 0;
+    xSemaphoreGive(wlan_capture.mutex);
+    return true;
+}
+
+static void wlan_capture_write (const void *src, uint32_t len) {
+    uint32_t offset = wlan_capture.head & (wlan_capture.size - 1);
+    uint32_t first = MIN(len, wlan_capture.size - offset);
+
+    memcpy(&wlan_capture.data[offset], src, first);
+    memcpy(wlan_capture.data, (const uint8_t *)src + first, len - first);
+    wlan_capture.head += len;
+}
+
+static void wlan_capture_read (void *dst, uint32_t index, uint32_t len) {
+    uint32_t offset = index & (wlan_capture.size - 1);
+    uint32_t first = MIN(len, wlan_capture.size - offset);
+
+    memcpy(dst, &wlan_capture.data[offset], first);
+    memcpy((uint8_t *)dst + first, wlan_capture.data, len - first);
+}
+
+static bool wlan_capture_mac_match (const uint8_t *frame, uint16_t len) {
+    // addr1, addr2 and addr3, as far as the frame has them
+    for (uint16_t offset = 4; offset + 6 <= len && offset <= 16; offset += 6) {
+        if (!memcmp(&frame[offset], wlan_capture.mac, sizeof(wlan_capture.mac))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * filters a promiscuous frame and stores it in the capture ring, runs in the WiFi task
+ */
+static void wlan_capture_put (const wifi_promiscuous_pkt_t *pkt, wifi_promiscuous_pkt_type_t type) {
+    uint32_t type_bit;
+    switch (type) {
+    case WIFI_PKT_MGMT:
+        type_bit = MOD_WLAN_TRIGGER_PKT_MGMT;
+        break;
+    case WIFI_PKT_CTRL:
+        type_bit = MOD_WLAN_TRIGGER_PKT_CTRL;
+        break;
+    case WIFI_PKT_DATA:
+        type_bit = MOD_WLAN_TRIGGER_PKT_DATA;
+        break;
+    default:
+        // no 802.11 frame to capture
+        return;
+    }
+
+    const uint8_t *frame = pkt->payload;
+    uint16_t len = pkt->rx_ctrl.sig_len;
+
+    xSemaphoreTake(wlan_capture.mutex, portMAX_DELAY);
+    wlan_capture.received++;
+    if (!(wlan_capture.types & type_bit) || pkt->rx_ctrl.rssi < wlan_capture.rssi ||
+        (len > 0 && !(wlan_capture.subtypes & (1 << (frame[0] >> 4)))) ||
+        (wlan_capture.mac_set && !wlan_capture_mac_match(frame, len))) {
+        wlan_capture.filtered++;
+        goto exit;
+    }
+
+    uint32_t caplen = MIN(len, wlan_capture.snaplen);
+    if (wlan_capture.size - (wlan_capture.head - wlan_capture.tail) < WLAN_PCAP_REC_HDR_LEN + WLAN_RADIOTAP_HDR_LEN + caplen) {
+        wlan_capture.dropped++;
+        goto exit;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint32_t rec_hdr[4] = {now.tv_sec, now.tv_usec, WLAN_RADIOTAP_HDR_LEN + caplen, WLAN_RADIOTAP_HDR_LEN + len};
+    uint16_t freq = (pkt->rx_ctrl.channel == 14) ? 2484 : 2407 + 5 * pkt->rx_ctrl.channel;
+    uint8_t radiotap[WLAN_RADIOTAP_HDR_LEN] = {
+        0, 0, WLAN_RADIOTAP_HDR_LEN, 0,     // version, pad, length
+        0x2A, 0, 0, 0,                      // present: flags, channel, antenna signal
+        0x10, 0,                            // the FCS is included, pad
+        freq & 0xFF, freq >> 8, 0x80, 0,    // frequency, 2 GHz channel
+        (uint8_t)pkt->rx_ctrl.rssi
+    };
+    wlan_capture_write(rec_hdr, sizeof(rec_hdr));
+    wlan_capture_write(radiotap, sizeof(radiotap));
+    wlan_capture_write(frame, caplen);
+
+exit:
+    xSemaphoreGive(wlan_capture.mutex);
+}
+
+/*
+ * copies the oldest record into buf, returns its length or 0 if there are none (or it doesn't fit)
+ */
+static uint32_t wlan_capture_get (uint8_t *buf, uint32_t len) {
+    uint32_t rec_len = 0;
+
+    xSemaphoreTake(wlan_capture.mutex, portMAX_DELAY);
+    if (wlan_capture.head != wlan_capture.tail) {
+        uint32_t rec_hdr[4];
+        wlan_capture_read(rec_hdr, wlan_capture.tail, sizeof(rec_hdr));
+        if (WLAN_PCAP_REC_HDR_LEN + rec_hdr[2] <= len) {
+            rec_len = WLAN_PCAP_REC_HDR_LEN + rec_hdr[2];
+            wlan_capture_read(buf, wlan_capture.tail, rec_len);
+            wlan_capture.tail += rec_len;
+        }
+    }
+    xSemaphoreGive(wlan_capture.mutex);
+    return rec_len;
+}
+
+/*
+ * the hardware filter lets through what the callback and the capture need
+ */
+static void wlan_prom_filter_apply (void) {
+    wifi_promiscuous_filter_t filter = {
+        .filter_mask = 0
+    };
+    uint32_t trigger = wlan_obj.trigger | (wlan_capture.enabled ? wlan_capture.types : 0);
+
+    if (trigger & MOD_WLAN_TRIGGER_PKT_MGMT) {
+        filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MGMT;
+    }
+    if (trigger & MOD_WLAN_TRIGGER_PKT_CTRL) {
+        filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_CTRL;
+    }
+    if (trigger & MOD_WLAN_TRIGGER_PKT_DATA) {
+        filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA;
+    }
+    if (trigger & MOD_WLAN_TRIGGER_PKT_DATA_MPDU) {
+        filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA_MPDU;
+    }
+    if (trigger & MOD_WLAN_TRIGGER_PKT_DATA_AMPDU) {
+        filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA_AMPDU;
+    }
+    if (trigger & MOD_WLAN_TRIGGER_PKT_MISC) {
+        filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MISC;
+    }
+    esp_wifi_set_promiscuous_filter(&filter);
+}
+
 STATIC void wlan_set_default_inf(void)
 {
 #if defined(FIPY) || defined(GPY)
@@ -1187,6 +1963,22 @@ STATIC mp_obj_t wlan_init_helper(wlan_obj_t *self, const mp_arg_val_t *args) {
         ptrcountry_info = &country_info;
     }
 
+    if (args[12].u_int < 0 || args[12].u_int > 0xFFFF) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    wlan_ap_config_t ap_config = {
+        .max_clients = args[10].u_int,
+        .beacon_interval = args[11].u_int,
+        .inactive_time = args[12].u_int,
+    };
+    if (args[13].u_obj != mp_const_none) {
+        mp_obj_t *tx_buffers;
+        mp_obj_get_array_fixed_n(args[13].u_obj, 2, &tx_buffers);
+        ap_config.tx_buf_static = mp_obj_get_int(tx_buffers[0]);
+        ap_config.tx_buf_dynamic = mp_obj_get_int(tx_buffers[1]);
+    }
+    wlan_validate_ap_config(&ap_config);
+
     wlan_conn_recover_hidden = hidden;
 
     wlan_internal_setup_t setup = {
@@ -1202,7 +1994,8 @@ STATIC mp_obj_t wlan_init_helper(wlan_obj_t *self, const mp_arg_val_t *args) {
             hidden,
             bandwidth,
             ptrcountry_info,
-            &max_tx_pwr
+            &max_tx_pwr,
+            &ap_config
     };
 
     // initialize the wlan subsystem
@@ -1223,6 +2016,10 @@ STATIC const mp_arg_t wlan_init_args[] = {
     { MP_QSTR_bandwidth,    MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = WIFI_BW_HT40} },
     { MP_QSTR_max_tx_pwr,   MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 0} },
     { MP_QSTR_country,        MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+    { MP_QSTR_max_clients,  MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = MAX_AP_CONNECTED_STA} },
+    { MP_QSTR_beacon_interval, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = MODWLAN_AP_BEACON_MIN} },
+    { MP_QSTR_inactive_time, MP_ARG_KW_ONLY | MP_ARG_INT,  {.u_int = 0} },
+    { MP_QSTR_tx_buffers,   MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
 };
 STATIC mp_obj_t wlan_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
     // parse args
@@ -1271,6 +2068,16 @@ mp_obj_t wlan_deinit(mp_obj_t self_in) {
             vTaskDelay(100/portTICK_PERIOD_MS);
         }
 
+        xTimerStop(wlan_stats.timer, 0);
+        if (wlan_scan_async.running) {
+            esp_wifi_scan_stop();
+            wlan_scan_async.pending = 0;
+            wlan_scan_async.running = false;
+        }
+        if (wlan_espnow.enabled) {
+            wlan_espnow_stop();
+        }
+
         esp_wifi_stop();
 
         /* wait for sta and Soft-AP to stop */
@@ -1301,6 +2108,9 @@ STATIC mp_obj_t wlan_scan(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *
         { MP_QSTR_show_hidden,          MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_type,                 MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_scantime,             MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_channels,             MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_dwell,                MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_blocking,             MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = true} },
     };
 
     // parse args
@@ -1412,6 +2222,37 @@ STATIC mp_obj_t wlan_scan(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *
         }
     }
 
+    // time spent on each channel
+    if (args[7].u_obj != mp_const_none) {
+        if (args[5].u_obj != mp_const_none) {
+            goto scan_time_err;
+        }
+        uint32_t dwell = mp_obj_get_int(args[7].u_obj);
+        if (scan_config.scan_type == WIFI_SCAN_TYPE_PASSIVE) {
+            scan_config.scan_time.passive = dwell;
+        } else {
+            scan_config.scan_time.active.min = dwell;
+            scan_config.scan_time.active.max = dwell;
+        }
+    }
+
+    uint16_t channels = 0;
+    if (args[6].u_obj != mp_const_none) {
+        mp_obj_t *items;
+        size_t len;
+        mp_obj_get_array(args[6].u_obj, &len, &items);
+        for (int i = 0; i < len; i++) {
+            mp_int_t channel = mp_obj_get_int(items[i]);
+            if (channel < 1 || channel > MODWLAN_SCAN_CHANNEL_MAX) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid channel"));
+            }
+            channels |= 1 << channel;
+        }
+        if (channels == 0 || scan_config.channel != 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+    }
+
     ptr_config = &scan_config;
 
     // check for the correct wlan mode
@@ -1419,6 +2260,55 @@ STATIC mp_obj_t wlan_scan(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
     }
 
+    if (channels || !args[8].u_bool) {
+        if (wlan_scan_async.running) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+        }
+        if (wlan_scan_async.records == NULL) {
+            wlan_scan_async.records = heap_caps_malloc(MODWLAN_SCAN_RESULTS_MAX * sizeof(wifi_ap_record_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (wlan_scan_async.records == NULL) {
+                wlan_scan_async.records = heap_caps_malloc(MODWLAN_SCAN_RESULTS_MAX * sizeof(wifi_ap_record_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            }
+            if (wlan_scan_async.records == NULL) {
+                mp_raise_OSError(MP_ENOMEM);
+            }
+        }
+
+        // the strings given might be collected before the last channel is scanned
+        memcpy(&wlan_scan_async.config, &scan_config, sizeof(scan_config));
+        if (scan_config.ssid) {
+            strlcpy((char *)wlan_scan_async.ssid, (const char *)scan_config.ssid, sizeof(wlan_scan_async.ssid));
+            wlan_scan_async.config.ssid = wlan_scan_async.ssid;
+        }
+        if (scan_config.bssid) {
+            memcpy(wlan_scan_async.bssid, scan_config.bssid, sizeof(wlan_scan_async.bssid));
+            wlan_scan_async.config.bssid = wlan_scan_async.bssid;
+        }
+
+        xSemaphoreTake(wlan_scan_async.mutex, portMAX_DELAY);
+        wlan_scan_async.count = 0;
+        wlan_scan_async.read = 0;
+        wlan_scan_async.dropped = 0;
+        xSemaphoreGive(wlan_scan_async.mutex);
+        wlan_scan_async.pending = channels;
+        xEventGroupClearBits(wifi_event_group, SCAN_DONE_BIT);
+
+        wlan_scan_async.running = true;
+        if (wlan_scan_next() != ESP_OK) {
+            wlan_scan_async.pending = 0;
+            wlan_scan_async.running = false;
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Scan operation Failed!"));
+        }
+        if (!args[8].u_bool) {
+            return mp_const_none;
+        }
+
+        MP_THREAD_GIL_EXIT();
+        xEventGroupWaitBits(wifi_event_group, SCAN_DONE_BIT, true, false, portMAX_DELAY);
+        MP_THREAD_GIL_ENTER();
+        return wlan_scan_new_results();
+    }
+
     MP_THREAD_GIL_EXIT();
     esp_err_t err = esp_wifi_scan_start(ptr_config, true);
     MP_THREAD_GIL_ENTER();
@@ -1475,6 +2365,17 @@ scan_time_err:
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(wlan_scan_obj, 1, wlan_scan);
 
+STATIC mp_obj_t wlan_scan_results(mp_obj_t self_in) {
+    // read the flag first, all the results are stored by the time it's cleared
+    bool running = wlan_scan_async.running;
+
+    if (!running && wlan_scan_async.read == wlan_scan_async.count) {
+        return mp_const_none;
+    }
+    return wlan_scan_new_results();
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_scan_results_obj, wlan_scan_results);
+
 STATIC mp_obj_t wlan_connect(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     STATIC const mp_arg_t allowed_args[] = {
         { MP_QSTR_ssid,                 MP_ARG_REQUIRED | MP_ARG_OBJ, },
@@ -1920,7 +2821,8 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(wlan_wifi_protocol_obj, 1, 2, wlan_wi
 
 STATIC mp_obj_t wlan_ap_sta_list (mp_obj_t self_in) {
     STATIC const qstr wlan_sta_ifo_fields[] = {
-        MP_QSTR_mac, MP_QSTR_rssi, MP_QSTR_wlan_protocol
+        MP_QSTR_mac, MP_QSTR_rssi, MP_QSTR_wlan_protocol, MP_QSTR_rx_bytes, MP_QSTR_tx_bytes,
+        MP_QSTR_rx_rate, MP_QSTR_tx_rate, MP_QSTR_idle
     };
     uint8_t index;
     wifi_sta_list_t sta_list;
@@ -1932,8 +2834,9 @@ STATIC mp_obj_t wlan_ap_sta_list (mp_obj_t self_in) {
         /* Get STAs connected to AP*/
         esp_wifi_ap_get_sta_list(&sta_list);
 
-        mp_obj_t tuple[3];
-        for(index = 0; index < MAX_AP_CONNECTED_STA && index < sta_list.num; index++)
+        int64_t now = esp_timer_get_time();
+        mp_obj_t tuple[8];
+        for(index = 0; index < sta_list.num; index++)
         {
             tuple[0] = mp_obj_new_bytes((const byte *)sta_list.sta[index].mac, 6);
             tuple[1] = MP_OBJ_NEW_SMALL_INT(sta_list.sta[index].rssi);
@@ -1958,8 +2861,20 @@ STATIC mp_obj_t wlan_ap_sta_list (mp_obj_t self_in) {
                 tuple[2] = mp_const_none;
             }
 
+            // the traffic seen on the AP netif, None before the client sent anything up the stack
+            wlan_ap_client_t *client = wlan_ap_client_find(sta_list.sta[index].mac);
+            if (client) {
+                tuple[3] = mp_obj_new_int_from_uint(client->rx_bytes);
+                tuple[4] = mp_obj_new_int_from_uint(client->tx_bytes);
+                tuple[5] = mp_obj_new_int_from_uint(client->rx_bps);
+                tuple[6] = mp_obj_new_int_from_uint(client->tx_bps);
+                tuple[7] = mp_obj_new_int_from_uint((now - client->last_seen) / 1000);
+            } else {
+                tuple[3] = tuple[4] = tuple[5] = tuple[6] = tuple[7] = mp_const_none;
+            }
+
             /*insert tuple */
-            mp_obj_list_append(sta_out_list, mp_obj_new_attrtuple(wlan_sta_ifo_fields, 3, tuple));
+            mp_obj_list_append(sta_out_list, mp_obj_new_attrtuple(wlan_sta_ifo_fields, 8, tuple));
         }
     }
     else
@@ -1971,6 +2886,64 @@ STATIC mp_obj_t wlan_ap_sta_list (mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_ap_sta_list_obj, wlan_ap_sta_list);
 
+/// \method ap_config([max_clients, beacon_interval, inactive_time])
+/// Changes the soft-AP settings on the fly, the TX buffers can only be set by init()
+STATIC mp_obj_t wlan_ap_config_get_set (mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const qstr wlan_ap_config_fields[] = {
+        MP_QSTR_max_clients, MP_QSTR_beacon_interval, MP_QSTR_inactive_time, MP_QSTR_tx_buffers
+    };
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_max_clients,          MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_beacon_interval,      MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_inactive_time,        MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (kw_args->used == 0) {
+        mp_obj_t tx_buffers[2] = {
+            MP_OBJ_NEW_SMALL_INT(wlan_ap_config.tx_buf_static),
+            MP_OBJ_NEW_SMALL_INT(wlan_ap_config.tx_buf_dynamic)
+        };
+        mp_obj_t tuple[4];
+        tuple[0] = MP_OBJ_NEW_SMALL_INT(wlan_ap_config.max_clients);
+        tuple[1] = MP_OBJ_NEW_SMALL_INT(wlan_ap_config.beacon_interval);
+        tuple[2] = MP_OBJ_NEW_SMALL_INT(wlan_ap_config.inactive_time);
+        tuple[3] = mp_obj_new_tuple(2, tx_buffers);
+        return mp_obj_new_attrtuple(wlan_ap_config_fields, 4, tuple);
+    }
+
+    wlan_ap_config_t ap_config = wlan_ap_config;
+    if (args[0].u_obj != mp_const_none) {
+        ap_config.max_clients = mp_obj_get_int(args[0].u_obj);
+    }
+    if (args[1].u_obj != mp_const_none) {
+        ap_config.beacon_interval = mp_obj_get_int(args[1].u_obj);
+    }
+    if (args[2].u_obj != mp_const_none) {
+        mp_int_t inactive_time = mp_obj_get_int(args[2].u_obj);
+        if (inactive_time < 0 || inactive_time > 0xFFFF) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        ap_config.inactive_time = inactive_time;
+    }
+    wlan_validate_ap_config(&ap_config);
+    wlan_ap_config = ap_config;
+
+    if (wlan_obj.started && (wlan_obj.mode == WIFI_MODE_AP || wlan_obj.mode == WIFI_MODE_APSTA)) {
+        wifi_config_t config;
+        esp_wifi_get_config(WIFI_IF_AP, &config);
+        config.ap.max_connection = wlan_ap_config.max_clients;
+        config.ap.beacon_interval = wlan_ap_config.beacon_interval;
+        if (ESP_OK != esp_wifi_set_config(WIFI_IF_AP, &config)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(wlan_ap_config_obj, 1, wlan_ap_config_get_set);
+
 STATIC mp_obj_t wlan_joined_ap_info (mp_obj_t self_in)
 {
     STATIC const qstr wlan_sta_ifo_fields[] = {
@@ -2493,41 +3466,12 @@ STATIC mp_obj_t wlan_callback(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
     wlan_obj_t *self = pos_args[0];
 
-    wifi_promiscuous_filter_t filter =
-    {
-            .filter_mask = 0
-    };
-
     // enable the callback
     if (args[0].u_obj != mp_const_none && args[1].u_obj != mp_const_none) {
         self->trigger = mp_obj_get_int(args[0].u_obj);
         if (self->trigger <= MOD_WLAN_TRIGGER_PKT_ANY)
         {
-            if(self->trigger & MOD_WLAN_TRIGGER_PKT_MGMT)
-            {
-                filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MGMT;
-            }
-            if(self->trigger & MOD_WLAN_TRIGGER_PKT_CTRL)
-            {
-                filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_CTRL;
-            }
-            if(self->trigger & MOD_WLAN_TRIGGER_PKT_DATA)
-            {
-                filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA;
-            }
-            if(self->trigger & MOD_WLAN_TRIGGER_PKT_DATA_MPDU)
-            {
-                filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA_MPDU;
-            }
-            if(self->trigger & MOD_WLAN_TRIGGER_PKT_DATA_AMPDU)
-            {
-                filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA_AMPDU;
-            }
-            if(self->trigger & MOD_WLAN_TRIGGER_PKT_MISC)
-            {
-                filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MISC;
-            }
-            esp_wifi_set_promiscuous_filter(&filter);
+            wlan_prom_filter_apply();
         }
         self->handler = args[1].u_obj;
         if (args[2].u_obj == mp_const_none) {
@@ -2635,11 +3579,445 @@ STATIC mp_obj_t wlan_ctrl_pkt_filter(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(wlan_ctrl_pkt_filter_obj, 1, 2, wlan_ctrl_pkt_filter);
 
+STATIC mp_obj_t wlan_capture_filter(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_types,        MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = WLAN_CAPTURE_TYPES_ALL} },
+        { MP_QSTR_subtypes,     MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = 0xFFFF} },
+        { MP_QSTR_mac,          MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+        { MP_QSTR_rssi,         MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = WLAN_CAPTURE_RSSI_NONE} },
+        { MP_QSTR_snaplen,      MP_ARG_KW_ONLY | MP_ARG_INT,    {.u_int = WLAN_CAPTURE_SNAPLEN_DEFAULT} },
+        { MP_QSTR_ring_size,    MP_ARG_KW_ONLY | MP_ARG_OBJ,    {.u_obj = mp_const_none} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    if (args[0].u_int == 0 || (args[0].u_int & ~WLAN_CAPTURE_TYPES_ALL) || args[1].u_int > 0xFFFF) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid frame types"));
+    }
+    if (args[3].u_int < WLAN_CAPTURE_RSSI_NONE || args[3].u_int > 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid rssi"));
+    }
+    if (args[4].u_int <= 0 || args[4].u_int > MAX_WIFI_PROM_PKT_SIZE) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid snaplen"));
+    }
+    mp_buffer_info_t mac_info = {.len = 0};
+    if (args[2].u_obj != mp_const_none) {
+        mp_get_buffer_raise(args[2].u_obj, &mac_info, MP_BUFFER_READ);
+        if (mac_info.len != sizeof(wlan_capture.mac)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid MAC address"));
+        }
+    }
+
+    if (args[5].u_obj != mp_const_none) {
+        mp_int_t size = mp_obj_get_int(args[5].u_obj);
+        if (size < WLAN_CAPTURE_REC_LEN_MAX || size > WLAN_CAPTURE_RING_SIZE_MAX) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid ring size"));
+        }
+        if (wlan_capture.enabled) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "operation already in progress"));
+        }
+        // the ring indexes need a power of 2
+        uint32_t ring_size = 1;
+        while (ring_size < size) {
+            ring_size <<= 1;
+        }
+        if (!wlan_capture_alloc(ring_size)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, mpexception_os_resource_not_avaliable));
+        }
+    }
+
+    xSemaphoreTake(wlan_capture.mutex, portMAX_DELAY);
+    wlan_capture.types = args[0].u_int;
+    wlan_capture.subtypes = args[1].u_int;
+    wlan_capture.rssi = args[3].u_int;
+    wlan_capture.snaplen = args[4].u_int;
+    wlan_capture.mac_set = (mac_info.len > 0);
+    if (wlan_capture.mac_set) {
+        memcpy(wlan_capture.mac, mac_info.buf, sizeof(wlan_capture.mac));
+    }
+    xSemaphoreGive(wlan_capture.mutex);
+
+    if (wlan_capture.enabled) {
+        wlan_prom_filter_apply();
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(wlan_capture_filter_obj, 1, wlan_capture_filter);
+
+STATIC mp_obj_t wlan_capture(mp_uint_t n_args, const mp_obj_t *args) {
+    wlan_obj_t* self = (wlan_obj_t*)args[0];
+
+    if (n_args == 1) {
+        return mp_obj_new_bool(wlan_capture.enabled);
+    }
+
+    if (mp_obj_is_true(args[1])) {
+        if (wlan_capture.data == NULL &&
+            !wlan_capture_alloc((heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) ? WLAN_CAPTURE_RING_SIZE_PSRAM : WLAN_CAPTURE_RING_SIZE_DEFAULT)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, mpexception_os_resource_not_avaliable));
+        }
+        xSemaphoreTake(wlan_capture.mutex, portMAX_DELAY);
+        wlan_capture.head = 0;
+        wlan_capture.tail = 0;
+        wlan_capture.received = 0;
+        wlan_capture.filtered = 0;
+        wlan_capture.dropped = 0;
+        xSemaphoreGive(wlan_capture.mutex);
+        wlan_capture.enabled = true;
+        wlan_prom_filter_apply();
+        // the capture needs the promiscuous mode
+        if (!self->is_promiscuous) {
+            if (ESP_OK != esp_wifi_set_promiscuous(true)) {
+                wlan_capture.enabled = false;
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+            }
+            self->is_promiscuous = true;
+            esp_wifi_set_promiscuous_rx_cb(promiscuous_callback);
+        }
+    } else {
+        // the frames already captured can still be drained
+        wlan_capture.enabled = false;
+        wlan_prom_filter_apply();
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(wlan_capture_obj, 1, 2, wlan_capture);
+
+STATIC mp_obj_t wlan_capture_stats(mp_obj_t self_in) {
+    STATIC const qstr wlan_capture_stats_fields[] = {
+        MP_QSTR_received, MP_QSTR_filtered, MP_QSTR_dropped, MP_QSTR_pending, MP_QSTR_ring_size,
+    };
+    mp_obj_t tuple[5];
+
+    xSemaphoreTake(wlan_capture.mutex, portMAX_DELAY);
+    tuple[0] = mp_obj_new_int_from_uint(wlan_capture.received);
+    tuple[1] = mp_obj_new_int_from_uint(wlan_capture.filtered);
+    tuple[2] = mp_obj_new_int_from_uint(wlan_capture.dropped);
+    tuple[3] = mp_obj_new_int_from_uint(wlan_capture.head - wlan_capture.tail);
+    tuple[4] = mp_obj_new_int_from_uint(wlan_capture.size);
+    xSemaphoreGive(wlan_capture.mutex);
+
+    return mp_obj_new_attrtuple(wlan_capture_stats_fields, 5, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_capture_stats_obj, wlan_capture_stats);
+
+STATIC mp_obj_t wlan_connect_timing(mp_obj_t self_in) {
+    STATIC const qstr wlan_connect_timing_fields[] = {
+        MP_QSTR_fast, MP_QSTR_fallback, MP_QSTR_pmk_ms, MP_QSTR_assoc_ms, MP_QSTR_dhcp_ms, MP_QSTR_total_ms,
+    };
+    mp_obj_t tuple[6];
+    uint32_t assoc_us = wlan_conn_timing.assoc_us;
+    uint32_t ip_us = wlan_conn_timing.ip_us;
+
+    tuple[0] = mp_obj_new_bool(wlan_conn_timing.fast);
+    tuple[1] = mp_obj_new_bool(wlan_conn_timing.fallback);
+    tuple[2] = mp_obj_new_int_from_uint(wlan_conn_timing.pmk_us / 1000);
+    // the phases not reached yet are reported as None
+    tuple[3] = assoc_us ? mp_obj_new_int_from_uint((assoc_us - wlan_conn_timing.pmk_us) / 1000) : mp_const_none;
+    tuple[4] = (assoc_us && ip_us) ? mp_obj_new_int_from_uint((ip_us - assoc_us) / 1000) : mp_const_none;
+    tuple[5] = ip_us ? mp_obj_new_int_from_uint(ip_us / 1000) : mp_const_none;
+
+    return mp_obj_new_attrtuple(wlan_connect_timing_fields, 6, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_connect_timing_obj, wlan_connect_timing);
+
+STATIC mp_obj_t wlan_stats_get(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const qstr wlan_stats_fields[] = {
+        MP_QSTR_connects, MP_QSTR_disconnects, MP_QSTR_last_reason, MP_QSTR_beacon_loss, MP_QSTR_uptime,
+        MP_QSTR_rx_packets, MP_QSTR_tx_packets, MP_QSTR_rx_bytes, MP_QSTR_tx_bytes, MP_QSTR_tx_errors,
+        MP_QSTR_rx_pps, MP_QSTR_tx_pps, MP_QSTR_rx_bps, MP_QSTR_tx_bps, MP_QSTR_rssi,
+    };
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset,                MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t tuple[15];
+    mp_obj_t rssi[MODWLAN_RSSI_HISTORY_LEN];
+    int64_t connected_at = wlan_stats.connected_at;
+    uint32_t rssi_count = wlan_stats.rssi_count;
+    uint32_t n_rssi = MIN(rssi_count, MODWLAN_RSSI_HISTORY_LEN);
+
+    tuple[0] = mp_obj_new_int_from_uint(wlan_stats.connects);
+    tuple[1] = mp_obj_new_int_from_uint(wlan_stats.disconnects);
+    tuple[2] = mp_obj_new_int_from_uint(wlan_stats.last_reason);
+    tuple[3] = mp_obj_new_int_from_uint(wlan_stats.beacon_loss);
+    tuple[4] = connected_at ? mp_obj_new_int_from_uint((esp_timer_get_time() - connected_at) / 1000000) : mp_const_none;
+    tuple[5] = mp_obj_new_int_from_uint(wlan_stats.rx_packets);
+    tuple[6] = mp_obj_new_int_from_uint(wlan_stats.tx_packets);
+    tuple[7] = mp_obj_new_int_from_uint(wlan_stats.rx_bytes);
+    tuple[8] = mp_obj_new_int_from_uint(wlan_stats.tx_bytes);
+    tuple[9] = mp_obj_new_int_from_uint(wlan_stats.tx_errors);
+    tuple[10] = mp_obj_new_int_from_uint(wlan_stats.rx_pps);
+    tuple[11] = mp_obj_new_int_from_uint(wlan_stats.tx_pps);
+    tuple[12] = mp_obj_new_int_from_uint(wlan_stats.rx_bps);
+    tuple[13] = mp_obj_new_int_from_uint(wlan_stats.tx_bps);
+    // oldest sample first
+    for (int i = 0; i < n_rssi; i++) {
+        rssi[i] = MP_OBJ_NEW_SMALL_INT(wlan_stats.rssi[(rssi_count - n_rssi + i) % MODWLAN_RSSI_HISTORY_LEN]);
+    }
+    tuple[14] = mp_obj_new_tuple(n_rssi, rssi);
+
+    if (args[0].u_bool) {
+        wlan_stats.connects = 0;
+        wlan_stats.disconnects = 0;
+        wlan_stats.beacon_loss = 0;
+        wlan_stats.tx_errors = 0;
+        wlan_stats.rssi_count = 0;
+    }
+
+    return mp_obj_new_attrtuple(wlan_stats_fields, 15, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(wlan_stats_obj, 1, wlan_stats_get);
+
+/*
+ * drains the capture ring as pcap records into a buffer, or into a stream (file, socket)
+ */
+STATIC mp_obj_t wlan_capture_drain(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_dest,         MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_header,       MP_ARG_KW_ONLY  | MP_ARG_BOOL,  {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    const uint32_t global_hdr[6] = {WLAN_PCAP_MAGIC, 0x00040002, 0, 0, MAX_WIFI_PROM_PKT_SIZE + WLAN_RADIOTAP_HDR_LEN, WLAN_PCAP_LINKTYPE_RADIOTAP};
+    uint32_t written = 0;
+    mp_buffer_info_t bufinfo;
+
+    if (mp_get_buffer(args[0].u_obj, &bufinfo, MP_BUFFER_WRITE)) {
+        uint8_t *buf = bufinfo.buf;
+        if (args[1].u_bool) {
+            if (bufinfo.len < WLAN_PCAP_GLOBAL_HDR_LEN) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+            }
+            memcpy(buf, global_hdr, WLAN_PCAP_GLOBAL_HDR_LEN);
+            written = WLAN_PCAP_GLOBAL_HDR_LEN;
+        }
+        uint32_t rec_len;
+        while ((rec_len = wlan_capture_get(&buf[written], bufinfo.len - written)) > 0) {
+            written += rec_len;
+        }
+    } else {
+        mp_get_stream_raise(args[0].u_obj, MP_STREAM_OP_WRITE);
+        int errcode;
+        if (args[1].u_bool) {
+            mp_stream_write_exactly(args[0].u_obj, global_hdr, WLAN_PCAP_GLOBAL_HDR_LEN, &errcode);
+            if (errcode != 0) {
+                mp_raise_OSError(errcode);
+            }
+            written = WLAN_PCAP_GLOBAL_HDR_LEN;
+        }
+        // one record at a time, the ring is not locked while writing
+        uint8_t *rec = m_new(uint8_t, WLAN_CAPTURE_REC_LEN_MAX);
+        uint32_t rec_len;
+        while ((rec_len = wlan_capture_get(rec, WLAN_CAPTURE_REC_LEN_MAX)) > 0) {
+            mp_stream_write_exactly(args[0].u_obj, rec, rec_len, &errcode);
+            if (errcode != 0) {
+                m_del(uint8_t, rec, WLAN_CAPTURE_REC_LEN_MAX);
+                mp_raise_OSError(errcode);
+            }
+            written += rec_len;
+        }
+        m_del(uint8_t, rec, WLAN_CAPTURE_REC_LEN_MAX);
+    }
+    return mp_obj_new_int_from_uint(written);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(wlan_capture_drain_obj, 1, wlan_capture_drain);
+
+STATIC mp_obj_t wlan_espnow_init(mp_uint_t n_args, const mp_obj_t *args) {
+    wlan_obj_t* self = (wlan_obj_t*)args[0];
+
+    if (!self->started) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    if (!wlan_espnow.enabled) {
+        wlan_espnow_rec_t *recs = heap_caps_malloc(MODWLAN_ESPNOW_RX_SLOTS * sizeof(wlan_espnow_rec_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (recs == NULL) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, mpexception_os_resource_not_avaliable));
+        }
+        xSemaphoreTake(wlan_espnow.mutex, portMAX_DELAY);
+        wlan_espnow.recs = recs;
+        wlan_espnow.head = 0;
+        wlan_espnow.tail = 0;
+        wlan_espnow.received = 0;
+        wlan_espnow.dropped = 0;
+        wlan_espnow.tx_ok = 0;
+        wlan_espnow.tx_failed = 0;
+        xSemaphoreGive(wlan_espnow.mutex);
+        if (ESP_OK != esp_now_init()) {
+            heap_caps_free(recs);
+            wlan_espnow.recs = NULL;
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        esp_now_register_recv_cb(wlan_espnow_recv_cb);
+        esp_now_register_send_cb(wlan_espnow_send_cb);
+        wlan_espnow.enabled = true;
+    }
+    if (n_args > 1 && args[1] != mp_const_none) {
+        uint8_t pmk[ESP_NOW_KEY_LEN];
+        wlan_espnow_get_key(args[1], pmk);
+        wlan_espnow_check(esp_now_set_pmk(pmk));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(wlan_espnow_init_obj, 1, 2, wlan_espnow_init);
+
+STATIC mp_obj_t wlan_espnow_deinit(mp_obj_t self_in) {
+    if (wlan_espnow.enabled) {
+        wlan_espnow_stop();
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_espnow_deinit_obj, wlan_espnow_deinit);
+
+STATIC mp_obj_t wlan_espnow_add_peer(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_mac,          MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_lmk,          MP_ARG_KW_ONLY  | MP_ARG_OBJ,   {.u_obj = mp_const_none} },
+        { MP_QSTR_channel,      MP_ARG_KW_ONLY  | MP_ARG_INT,   {.u_int = 0} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+    wlan_obj_t* self = pos_args[0];
+
+    esp_now_peer_info_t peer = {0};
+    wlan_espnow_get_mac(args[0].u_obj, peer.peer_addr);
+    if (args[1].u_obj != mp_const_none) {
+        wlan_espnow_get_key(args[1].u_obj, peer.lmk);
+        peer.encrypt = true;
+    }
+    // 0 follows the channel the interface is on
+    if (args[2].u_int != 0) {
+        wlan_validate_channel(args[2].u_int);
+    }
+    peer.channel = args[2].u_int;
+    peer.ifidx = (self->mode == WIFI_MODE_AP) ? ESP_IF_WIFI_AP : ESP_IF_WIFI_STA;
+
+    if (esp_now_is_peer_exist(peer.peer_addr)) {
+        wlan_espnow_check(esp_now_mod_peer(&peer));
+    } else {
+        wlan_espnow_check(esp_now_add_peer(&peer));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(wlan_espnow_add_peer_obj, 1, wlan_espnow_add_peer);
+
+STATIC mp_obj_t wlan_espnow_del_peer(mp_obj_t self_in, mp_obj_t mac_o) {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+
+    wlan_espnow_get_mac(mac_o, mac);
+    wlan_espnow_check(esp_now_del_peer(mac));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(wlan_espnow_del_peer_obj, wlan_espnow_del_peer);
+
+STATIC mp_obj_t wlan_espnow_peers(mp_obj_t self_in) {
+    STATIC const qstr wlan_espnow_peer_fields[] = {
+        MP_QSTR_mac, MP_QSTR_channel, MP_QSTR_encrypt,
+    };
+
+    if (!wlan_espnow.enabled) {
+        wlan_espnow_check(ESP_ERR_ESPNOW_NOT_INIT);
+    }
+    mp_obj_t peers = mp_obj_new_list(0, NULL);
+    esp_now_peer_info_t peer;
+    bool from_head = true;
+    while (ESP_OK == esp_now_fetch_peer(from_head, &peer)) {
+        mp_obj_t tuple[3];
+        tuple[0] = mp_obj_new_bytes(peer.peer_addr, ESP_NOW_ETH_ALEN);
+        tuple[1] = mp_obj_new_int(peer.channel);
+        tuple[2] = mp_obj_new_bool(peer.encrypt);
+        mp_obj_list_append(peers, mp_obj_new_attrtuple(wlan_espnow_peer_fields, 3, tuple));
+        from_head = false;
+    }
+    return peers;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_espnow_peers_obj, wlan_espnow_peers);
+
+STATIC mp_obj_t wlan_espnow_send(mp_obj_t self_in, mp_obj_t mac_o, mp_obj_t buf_o) {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    mp_buffer_info_t bufinfo;
+
+    // None sends to all the peers
+    if (mac_o != mp_const_none) {
+        wlan_espnow_get_mac(mac_o, mac);
+    }
+    mp_get_buffer_raise(buf_o, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len == 0 || bufinfo.len > MODWLAN_ESPNOW_DATA_LEN_MAX) {
+        mp_raise_OSError(MP_EMSGSIZE);
+    }
+    // the outcome is reported later with the ESPNOW_TX and ESPNOW_TX_FAILED events
+    wlan_espnow_check(esp_now_send((mac_o != mp_const_none) ? mac : NULL, bufinfo.buf, bufinfo.len));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(wlan_espnow_send_obj, wlan_espnow_send);
+
+STATIC mp_obj_t wlan_espnow_recv_into(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_buffer_info_t macinfo = {.len = 0};
+
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    if (n_args > 2 && args[2] != mp_const_none) {
+        mp_get_buffer_raise(args[2], &macinfo, MP_BUFFER_WRITE);
+        if (macinfo.len < ESP_NOW_ETH_ALEN) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid MAC address"));
+        }
+    }
+
+    int32_t len = -1;
+    xSemaphoreTake(wlan_espnow.mutex, portMAX_DELAY);
+    if (wlan_espnow.recs != NULL && wlan_espnow.head != wlan_espnow.tail) {
+        wlan_espnow_rec_t *rec = &wlan_espnow.recs[wlan_espnow.tail & (MODWLAN_ESPNOW_RX_SLOTS - 1)];
+        // a message that doesn't fit stays in the ring
+        if (rec->len <= bufinfo.len) {
+            len = rec->len;
+            memcpy(bufinfo.buf, rec->data, len);
+            if (macinfo.len > 0) {
+                memcpy(macinfo.buf, rec->mac, ESP_NOW_ETH_ALEN);
+            }
+            wlan_espnow.tail++;
+        } else {
+            len = -2;
+        }
+    }
+    xSemaphoreGive(wlan_espnow.mutex);
+
+    if (len == -2) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer too small"));
+    }
+    return (len < 0) ? mp_const_none : mp_obj_new_int(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(wlan_espnow_recv_into_obj, 2, 3, wlan_espnow_recv_into);
+
+STATIC mp_obj_t wlan_espnow_stats(mp_obj_t self_in) {
+    STATIC const qstr wlan_espnow_stats_fields[] = {
+        MP_QSTR_received, MP_QSTR_dropped, MP_QSTR_pending, MP_QSTR_tx_ok, MP_QSTR_tx_failed,
+    };
+    mp_obj_t tuple[5];
+
+    xSemaphoreTake(wlan_espnow.mutex, portMAX_DELAY);
+    tuple[0] = mp_obj_new_int_from_uint(wlan_espnow.received);
+    tuple[1] = mp_obj_new_int_from_uint(wlan_espnow.dropped);
+    tuple[2] = mp_obj_new_int_from_uint(wlan_espnow.head - wlan_espnow.tail);
+    tuple[3] = mp_obj_new_int_from_uint(wlan_espnow.tx_ok);
+    tuple[4] = mp_obj_new_int_from_uint(wlan_espnow.tx_failed);
+    xSemaphoreGive(wlan_espnow.mutex);
+
+    return mp_obj_new_attrtuple(wlan_espnow_stats_fields, 5, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_espnow_stats_obj, wlan_espnow_stats);
+
 
 STATIC const mp_map_elem_t wlan_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&wlan_init_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&wlan_deinit_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_scan),                (mp_obj_t)&wlan_scan_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_scan_results),        (mp_obj_t)&wlan_scan_results_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_connect),             (mp_obj_t)&wlan_connect_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_disconnect),          (mp_obj_t)&wlan_disconnect_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_isconnected),         (mp_obj_t)&wlan_isconnected_obj },
@@ -2654,6 +4032,7 @@ STATIC const mp_map_elem_t wlan_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_antenna),             (mp_obj_t)&wlan_antenna_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_mac),                 (mp_obj_t)&wlan_mac_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ap_sta_list),         (mp_obj_t)&wlan_ap_sta_list_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ap_config),           (mp_obj_t)&wlan_ap_config_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_max_tx_power),        (mp_obj_t)&wlan_max_tx_power_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_country),             (mp_obj_t)&wlan_country_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_joined_ap_info),      (mp_obj_t)&wlan_joined_ap_info_obj },
@@ -2664,6 +4043,20 @@ STATIC const mp_map_elem_t wlan_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_events),              (mp_obj_t)&wlan_events_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_wifi_packet),         (mp_obj_t)&wlan_packet_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ctrl_pkt_filter),     (mp_obj_t)&wlan_ctrl_pkt_filter_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture),             (mp_obj_t)&wlan_capture_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_filter),      (mp_obj_t)&wlan_capture_filter_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_stats),       (mp_obj_t)&wlan_capture_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_connect_timing),      (mp_obj_t)&wlan_connect_timing_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stats),               (mp_obj_t)&wlan_stats_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_capture_drain),       (mp_obj_t)&wlan_capture_drain_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_init),         (mp_obj_t)&wlan_espnow_init_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_deinit),       (mp_obj_t)&wlan_espnow_deinit_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_add_peer),     (mp_obj_t)&wlan_espnow_add_peer_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_del_peer),     (mp_obj_t)&wlan_espnow_del_peer_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_peers),        (mp_obj_t)&wlan_espnow_peers_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_send),         (mp_obj_t)&wlan_espnow_send_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_recv_into),    (mp_obj_t)&wlan_espnow_recv_into_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_espnow_stats),        (mp_obj_t)&wlan_espnow_stats_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_smartConfig),         (mp_obj_t)&wlan_smartConfig_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Connected_ap_pwd),    (mp_obj_t)&wlan_smartConfkey_obj },
 
@@ -2708,6 +4101,10 @@ STATIC const mp_map_elem_t wlan_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_FILTER_CTRL_PKT_CFENDACK),     MP_OBJ_NEW_SMALL_INT(WIFI_PROMIS_CTRL_FILTER_MASK_CFENDACK) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_SMART_CONF_DONE),             MP_OBJ_NEW_SMALL_INT(MOD_WLAN_SMART_CONFIG_DONE) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_SMART_CONF_TIMEOUT),             MP_OBJ_NEW_SMALL_INT(MOD_WLAN_SMART_CONFIG_TIMEOUT) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_SCAN_DONE),                   MP_OBJ_NEW_SMALL_INT(MOD_WLAN_SCAN_DONE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ESPNOW_RX),                   MP_OBJ_NEW_SMALL_INT(MOD_WLAN_ESPNOW_RX) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ESPNOW_TX),                   MP_OBJ_NEW_SMALL_INT(MOD_WLAN_ESPNOW_TX) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ESPNOW_TX_FAILED),            MP_OBJ_NEW_SMALL_INT(MOD_WLAN_ESPNOW_TX_FAILED) },
 };
 STATIC MP_DEFINE_CONST_DICT(wlan_locals_dict, wlan_locals_dict_table);
 
@@ -2730,10 +4127,13 @@ const mod_network_nic_type_t mod_network_nic_type_wlan = {
     .n_recv = lwipsocket_socket_recv,
     .n_sendto = lwipsocket_socket_sendto,
     .n_recvfrom = lwipsocket_socket_recvfrom,
+    .n_sendmsg = lwipsocket_socket_sendmsg,
     .n_setsockopt = lwipsocket_socket_setsockopt,
+    .n_getsockopt = lwipsocket_socket_getsockopt,
     .n_settimeout = lwipsocket_socket_settimeout,
     .n_ioctl = lwipsocket_socket_ioctl,
     .n_setupssl = lwipsocket_socket_setup_ssl,
+    .n_handshake = lwipsocket_socket_handshake,
 	.inf_up = wlan_is_inf_up,
 	.set_default_inf = wlan_set_default_inf
 };
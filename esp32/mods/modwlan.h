@@ -11,6 +11,7 @@
 #define MODWLAN_H_
 
 #include <tcpip_adapter.h>
+#include "lwip/netif.h"
 
 /******************************************************************************
  DEFINE CONSTANTS
@@ -36,6 +37,26 @@
 
 #define MOD_WLAN_SMART_CONFIG_DONE                   0x00000040    // 64
 #define MOD_WLAN_SMART_CONFIG_TIMEOUT                0x00000080    // 128
+#define MOD_WLAN_SCAN_DONE                           0x00000100    // 256
+#define MOD_WLAN_ESPNOW_RX                           0x00000200    // 512
+#define MOD_WLAN_ESPNOW_TX                           0x00000400    // 1024
+#define MOD_WLAN_ESPNOW_TX_FAILED                    0x00000800    // 2048
+
+#define MODWLAN_SCAN_RESULTS_MAX                     64
+#define MODWLAN_SCAN_CHANNEL_MAX                     14
+
+#define MODWLAN_STATS_PERIOD_MS                      1000
+#define MODWLAN_RSSI_HISTORY_LEN                     16
+
+#define MODWLAN_AP_BEACON_MIN                        100           // ms
+#define MODWLAN_AP_BEACON_MAX                        60000
+#define MODWLAN_TX_BUF_STATIC_MIN                    6
+#define MODWLAN_TX_BUF_STATIC_MAX                    64
+#define MODWLAN_TX_BUF_DYNAMIC_MIN                   16
+#define MODWLAN_TX_BUF_DYNAMIC_MAX                   128
+
+#define MODWLAN_ESPNOW_DATA_LEN_MAX                  250
+#define MODWLAN_ESPNOW_RX_SLOTS                      16            // power of 2
 
 /******************************************************************************
  DEFINE TYPES
@@ -110,6 +131,113 @@ typedef struct wlan_internal_prom_t
     wifi_promiscuous_pkt_type_t        pkt_type;
 }wlan_internal_prom_t;
 
+// promiscuous frames stored as ready to use pcap records (record header, radiotap header, frame)
+typedef struct {
+    uint8_t             *data;
+    uint32_t            size;       // power of 2
+    volatile uint32_t   head;       // free running write index, only moved by the WiFi task
+    volatile uint32_t   tail;       // free running index of the oldest record
+    uint32_t            received;
+    uint32_t            filtered;   // frames rejected by the filters
+    uint32_t            dropped;    // frames discarded because the ring was full
+    uint32_t            types;      // MOD_WLAN_TRIGGER_PKT_MGMT | _CTRL | _DATA
+    uint16_t            subtypes;   // bit n set accepts the frames of subtype n
+    uint16_t            snaplen;
+    int8_t              rssi;
+    uint8_t             mac[6];
+    bool                mac_set;
+    bool                enabled;
+    SemaphoreHandle_t   mutex;
+} wlan_capture_t;
+
+// ESP-NOW messages waiting to be read, one fixed size slot each
+typedef struct {
+    uint8_t             mac[6];
+    uint8_t             len;
+    uint8_t             data[MODWLAN_ESPNOW_DATA_LEN_MAX];
+} wlan_espnow_rec_t;
+
+typedef struct {
+    wlan_espnow_rec_t   *recs;      // MODWLAN_ESPNOW_RX_SLOTS of them
+    volatile uint32_t   head;       // free running write index, only moved by the WiFi task
+    volatile uint32_t   tail;       // free running index of the oldest message
+    uint32_t            received;
+    uint32_t            dropped;    // messages discarded because the ring was full
+    uint32_t            tx_ok;
+    uint32_t            tx_failed;
+    bool                enabled;
+    SemaphoreHandle_t   mutex;
+} wlan_espnow_t;
+
+// non blocking scan, one channel after the other from SYSTEM_EVENT_SCAN_DONE
+typedef struct {
+    wifi_ap_record_t    *records;
+    uint16_t            count;      // records collected so far
+    uint16_t            read;       // records already returned to Python
+    uint16_t            pending;    // bit n set: channel n still to be scanned
+    uint16_t            dropped;    // APs not stored because the results were full
+    wifi_scan_config_t  config;
+    uint8_t             ssid[(MODWLAN_SSID_LEN_MAX + 1)];
+    uint8_t             bssid[6];
+    volatile bool       running;
+    SemaphoreHandle_t   mutex;
+} wlan_scan_t;
+
+// station counters, the rates and the RSSI are sampled by a timer every MODWLAN_STATS_PERIOD_MS
+typedef struct {
+    volatile uint32_t   rx_packets;
+    volatile uint32_t   tx_packets;
+    volatile uint32_t   rx_bytes;
+    volatile uint32_t   tx_bytes;
+    volatile uint32_t   tx_errors;
+    uint32_t            last_rx_packets;
+    uint32_t            last_tx_packets;
+    uint32_t            last_rx_bytes;
+    uint32_t            last_tx_bytes;
+    uint32_t            rx_pps;
+    uint32_t            tx_pps;
+    uint32_t            rx_bps;
+    uint32_t            tx_bps;
+    uint32_t            connects;
+    uint32_t            disconnects;
+    uint32_t            beacon_loss;
+    uint32_t            last_reason;
+    int64_t             connected_at;
+    int8_t              rssi[MODWLAN_RSSI_HISTORY_LEN];
+    uint32_t            rssi_count;     // free running, the newest sample is at (rssi_count - 1) % MODWLAN_RSSI_HISTORY_LEN
+    netif_input_fn      input;
+    netif_linkoutput_fn linkoutput;
+    TimerHandle_t       timer;
+} wlan_stats_t;
+
+// soft-AP settings, a 0 TX buffer count keeps the one of the sdkconfig
+typedef struct {
+    uint8_t             max_clients;
+    uint16_t            beacon_interval;    // ms
+    uint16_t            inactive_time;      // s, 0 never drops an idle client
+    uint8_t             tx_buf_static;      // when set the driver uses static TX buffers
+    uint8_t             tx_buf_dynamic;
+} wlan_ap_config_t;
+
+// a station joined to the soft-AP, its traffic is counted on the AP netif
+typedef struct {
+    uint8_t             mac[6];
+    uint8_t             aid;                // 0 when the slot is free
+    volatile uint32_t   rx_bytes;
+    volatile uint32_t   tx_bytes;
+    uint32_t            last_rx_bytes;
+    uint32_t            last_tx_bytes;
+    uint32_t            rx_bps;
+    uint32_t            tx_bps;
+    volatile int64_t    last_seen;          // us, the last frame received from it
+} wlan_ap_client_t;
+
+typedef struct {
+    wlan_ap_client_t    clients[ESP_WIFI_MAX_CONN_NUM];
+    netif_input_fn      input;
+    netif_linkoutput_fn linkoutput;
+} wlan_ap_clients_t;
+
 #pragma pack(1)
 typedef struct wlan_internal_setup_t
 {
@@ -126,6 +254,7 @@ typedef struct wlan_internal_setup_t
     wifi_bandwidth_t     bandwidth;
     wifi_country_t*        country;
     int8_t*                max_tx_pr;
+    const wlan_ap_config_t* ap_config;      // NULL keeps the current soft-AP settings
 }wlan_internal_setup_t;
 #pragma pack()
 
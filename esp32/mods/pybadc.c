@@ -12,6 +12,7 @@
 
 #include "py/mpstate.h"
 #include "py/runtime.h"
+#include "py/mpthread.h"
 #include "bufhelper.h"
 
 #include "esp_heap_caps.h"
@@ -25,10 +26,14 @@
 #include "esp_intr.h"
 #include "soc/dport_reg.h"
 #include "soc/gpio_sig_map.h"
+#include "soc/syscon_reg.h"
+#include "driver/i2s.h"
 
 #include "adc.h"
 #include "esp_adc_cal.h"
 #include "pybadc.h"
+#include "pybdac.h"
+#include "machi2s.h"
 #include "mpexception.h"
 #include "mpsleep.h"
 #include "machpin.h"
@@ -41,6 +46,19 @@
 #define PYB_ADC_NUM_CHANNELS                (ADC1_CHANNEL_MAX)
 #define V_REF_NOM                           1100
 
+// continuous sampling runs the ADC from I2S0 and its DMA
+#define PYB_ADC_I2S_NUM                     (I2S_NUM_0)
+#define PYB_ADC_DMA_BUF_LEN                 (1024)      // samples, the most the I2S driver takes per buffer
+#define PYB_ADC_DMA_BUF_COUNT_MIN           (2)
+#define PYB_ADC_STREAM_BUFFER_DEFAULT       (8192)      // bytes
+#define PYB_ADC_SCAN_CHANNELS_MAX           (16)        // entries of the SAR1 pattern table
+#define PYB_ADC_RATE_MIN                    (1000)
+#define PYB_ADC_RATE_MAX                    (2000000)
+#define PYB_ADC_OVERSAMPLE_MAX              (64)
+
+#define PYB_ADC_FILTER_AVERAGE              (0)
+#define PYB_ADC_FILTER_MEDIAN               (1)
+
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
@@ -49,6 +67,8 @@ typedef struct {
     uint16_t vref;
     uint8_t width;
     bool enabled;
+    bool streaming;         // I2S owns the ADC, single conversions aren't possible
+    uint32_t rate;
 } pyb_adc_obj_t;
 
 typedef struct {
@@ -89,6 +109,16 @@ STATIC void pyb_adc_init (pyb_adc_obj_t *self) {
     self->enabled = true;
 }
 
+// the ADC block is configured, streaming or not
+bool pyb_adc_in_use (void) {
+    return pyb_adc_obj.enabled;
+}
+
+// I2S0 is streaming the samples
+bool pyb_adc_stream_in_use (void) {
+    return pyb_adc_obj.streaming;
+}
+
 STATIC void pyb_adc_check_init(void) {
     // not initialized
     if (!pyb_adc_obj.enabled) {
@@ -104,6 +134,152 @@ STATIC void pyb_adc_channel_init (pyb_adc_channel_obj_t *self) {
     self->enabled = true;
 }
 
+// the channels to scan, all the enabled ones unless a list of them is given
+STATIC uint32_t pyb_adc_get_scan (mp_obj_t channels_in, pyb_adc_channel_obj_t **scan) {
+    uint32_t n_scan = 0;
+    if (channels_in == mp_const_none) {
+        for (int i = 0; i < PYB_ADC_NUM_CHANNELS; i++) {
+            if (pyb_adc_channel_obj[i].enabled) {
+                scan[n_scan++] = &pyb_adc_channel_obj[i];
+            }
+        }
+    } else {
+        mp_uint_t n_items;
+        mp_obj_t *items;
+        mp_obj_get_array(channels_in, &n_items, &items);
+        if (n_items > PYB_ADC_SCAN_CHANNELS_MAX) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+        }
+        for (mp_uint_t i = 0; i < n_items; i++) {
+            if (!MP_OBJ_IS_TYPE(items[i], &pyb_adc_channel_type) || !((pyb_adc_channel_obj_t *)items[i])->enabled) {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+            }
+            scan[n_scan++] = items[i];
+        }
+    }
+    if (n_scan == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    return n_scan;
+}
+
+STATIC void pyb_adc_stream_start (pyb_adc_obj_t *self, uint32_t rate, pyb_adc_channel_obj_t **scan, uint32_t n_scan,
+                                   uint32_t buffer_size) {
+    pyb_adc_check_init();
+    if (self->streaming) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    // or I2S0 taken by machine.I2S
+    if (mach_i2s_in_use(PYB_ADC_I2S_NUM) || pyb_dac_wave_in_use()) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+    }
+    if (rate < PYB_ADC_RATE_MIN || rate > PYB_ADC_RATE_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+
+    // the DMA buffers are the ring the samples are read from
+    uint32_t buf_count = buffer_size / (PYB_ADC_DMA_BUF_LEN * sizeof(uint16_t));
+    i2s_config_t i2s_config = {
+        .mode = I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN,
+        .sample_rate = rate,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+        .intr_alloc_flags = 0,
+        .dma_buf_count = MAX(buf_count, PYB_ADC_DMA_BUF_COUNT_MIN),
+        .dma_buf_len = PYB_ADC_DMA_BUF_LEN,
+        .use_apll = false,
+    };
+    if (ESP_OK != i2s_driver_install(PYB_ADC_I2S_NUM, &i2s_config, 0, NULL)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+    }
+    i2s_set_adc_mode(ADC_UNIT_1, scan[0]->channel);
+    i2s_adc_enable(PYB_ADC_I2S_NUM);
+
+    // i2s_adc_enable() sets up a single channel at 11dB, replace it with the scan pattern,
+    // every entry being channel[7:4], bit width[3:2] and attenuation[1:0]
+    uint32_t tab[PYB_ADC_SCAN_CHANNELS_MAX / 4] = {0};
+    for (uint32_t i = 0; i < n_scan; i++) {
+        uint32_t entry = (scan[i]->channel << 4) | ((self->width - 9) << 2) | scan[i]->attn;
+        tab[i / 4] |= entry << (24 - ((i % 4) * 8));
+    }
+    SET_PERI_REG_BITS(SYSCON_SARADC_CTRL_REG, SYSCON_SARADC_SAR1_PATT_LEN, n_scan - 1, SYSCON_SARADC_SAR1_PATT_LEN_S);
+    WRITE_PERI_REG(SYSCON_SARADC_SAR1_PATT_TAB1_REG, tab[0]);
+    WRITE_PERI_REG(SYSCON_SARADC_SAR1_PATT_TAB2_REG, tab[1]);
+    WRITE_PERI_REG(SYSCON_SARADC_SAR1_PATT_TAB3_REG, tab[2]);
+    WRITE_PERI_REG(SYSCON_SARADC_SAR1_PATT_TAB4_REG, tab[3]);
+
+    self->rate = rate;
+    self->streaming = true;
+}
+
+STATIC void pyb_adc_stream_stop (pyb_adc_obj_t *self) {
+    if (self->streaming) {
+        i2s_adc_disable(PYB_ADC_I2S_NUM);
+        i2s_driver_uninstall(PYB_ADC_I2S_NUM);
+        // the single conversions need the ADC set back up
+        self->streaming = false;
+        pyb_adc_init(self);
+        for (int i = 0; i < PYB_ADC_NUM_CHANNELS; i++) {
+            if (pyb_adc_channel_obj[i].enabled) {
+                adc1_config_channel_atten(pyb_adc_channel_obj[i].channel, pyb_adc_channel_obj[i].attn);
+            }
+        }
+    }
+}
+
+// fills samples in scan order, blocking until there are size bytes of them
+STATIC void pyb_adc_stream_read_raw (uint8_t *samples, size_t size) {
+    size_t len = 0;
+    MP_THREAD_GIL_EXIT();
+    i2s_read(PYB_ADC_I2S_NUM, samples, size, &len, portMAX_DELAY);
+    MP_THREAD_GIL_ENTER();
+
+    // the two samples of every 32 bit word arrive swapped, and tagged with their channel in [15:12]
+    for (size_t i = 0; i < len; i += 2 * sizeof(uint16_t)) {
+        uint16_t pair[2];
+        memcpy(pair, &samples[i], sizeof(pair));
+        uint16_t first = pair[1] & 0x0FFF;
+        pair[1] = pair[0] & 0x0FFF;
+        pair[0] = first;
+        memcpy(&samples[i], pair, sizeof(pair));
+    }
+}
+
+// one output value out of n raw samples
+STATIC uint32_t pyb_adc_reduce (const uint16_t *raw, uint32_t n, uint8_t filter) {
+    if (filter == PYB_ADC_FILTER_MEDIAN) {
+        uint16_t sorted[PYB_ADC_OVERSAMPLE_MAX];
+        // insertion sort, n is small
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t j = i;
+            for ( ; j > 0 && sorted[j - 1] > raw[i]; j--) {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = raw[i];
+        }
+        if (n & 1) {
+            return sorted[n / 2];
+        }
+        return (sorted[(n / 2) - 1] + sorted[n / 2] + 1) / 2;
+    }
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += raw[i];
+    }
+    return (sum + (n / 2)) / n;
+}
+
+STATIC void pyb_adc_stream_read (mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    // the DMA moves samples in pairs
+    if (bufinfo.len % (2 * sizeof(uint16_t))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    pyb_adc_stream_read_raw(bufinfo.buf, bufinfo.len);
+}
+
 /******************************************************************************/
 /* Micro Python bindings : adc object                                         */
 
@@ -191,6 +367,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(adc_vref_obj, 1, 2, adc_vref);
 
 STATIC mp_obj_t adc_deinit(mp_obj_t self_in) {
     pyb_adc_obj_t *self = self_in;
+    pyb_adc_stream_stop(self);
     self->enabled = false;
     return mp_const_none;
 }
@@ -246,17 +423,97 @@ STATIC mp_obj_t adc_channel(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(adc_channel_obj, 1, adc_channel);
 
+/// \method read_timed(buf, rate, *, channels=None)
+/// Fills buf with 16 bit samples taken at rate Hz, interleaved in the order of channels.
+STATIC mp_obj_t adc_read_timed(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,        MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_rate,       MP_ARG_REQUIRED | MP_ARG_INT, },
+        { MP_QSTR_channels,   MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+
+    // parse args
+    pyb_adc_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    pyb_adc_channel_obj_t *scan[PYB_ADC_SCAN_CHANNELS_MAX];
+    uint32_t n_scan = pyb_adc_get_scan(args[2].u_obj, scan);
+    pyb_adc_stream_start(self, args[1].u_int, scan, n_scan, MIN(bufinfo.len, PYB_ADC_STREAM_BUFFER_DEFAULT));
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        pyb_adc_stream_read(args[0].u_obj);
+        nlr_pop();
+    } else {
+        pyb_adc_stream_stop(self);
+        nlr_jump(nlr.ret_val);
+    }
+    pyb_adc_stream_stop(self);
+    return mp_obj_new_int(bufinfo.len / sizeof(uint16_t));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(adc_read_timed_obj, 1, adc_read_timed);
+
+/// \method start(rate, *, channels=None, buffer=8192)
+/// Starts sampling into a ring of buffer bytes, to be drained with readinto().
+STATIC mp_obj_t adc_start(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_rate,       MP_ARG_REQUIRED | MP_ARG_INT, },
+        { MP_QSTR_channels,   MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_buffer,     MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = PYB_ADC_STREAM_BUFFER_DEFAULT} },
+    };
+
+    // parse args
+    pyb_adc_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    pyb_adc_channel_obj_t *scan[PYB_ADC_SCAN_CHANNELS_MAX];
+    uint32_t n_scan = pyb_adc_get_scan(args[1].u_obj, scan);
+    pyb_adc_stream_start(self, args[0].u_int, scan, n_scan, args[2].u_int);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(adc_start_obj, 1, adc_start);
+
+/// \method readinto(buf)
+/// Takes the next samples of the stream started with start(), waiting until buf is full.
+STATIC mp_obj_t adc_readinto(mp_obj_t self_in, mp_obj_t buf_in) {
+    pyb_adc_obj_t *self = self_in;
+    if (!self->streaming) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    pyb_adc_stream_read(buf_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    return mp_obj_new_int(bufinfo.len / sizeof(uint16_t));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(adc_readinto_obj, adc_readinto);
+
+STATIC mp_obj_t adc_stop(mp_obj_t self_in) {
+    pyb_adc_stream_stop(self_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_stop_obj, adc_stop);
+
 STATIC const mp_map_elem_t adc_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&adc_init_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&adc_deinit_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_channel),             (mp_obj_t)&adc_channel_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_vref),                (mp_obj_t)&adc_vref_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_vref_to_pin),         (mp_obj_t)&adc_vref_to_pin_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read_timed),          (mp_obj_t)&adc_read_timed_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_start),               (mp_obj_t)&adc_start_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto),            (mp_obj_t)&adc_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stop),                (mp_obj_t)&adc_stop_obj },
 
     { MP_OBJ_NEW_QSTR(MP_QSTR_ATTN_0DB),            MP_OBJ_NEW_SMALL_INT(ADC_ATTEN_0db) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ATTN_2_5DB),          MP_OBJ_NEW_SMALL_INT(ADC_ATTEN_2_5db) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ATTN_6DB),            MP_OBJ_NEW_SMALL_INT(ADC_ATTEN_6db) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ATTN_11DB),           MP_OBJ_NEW_SMALL_INT(ADC_ATTEN_11db) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_AVERAGE),             MP_OBJ_NEW_SMALL_INT(PYB_ADC_FILTER_AVERAGE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_MEDIAN),              MP_OBJ_NEW_SMALL_INT(PYB_ADC_FILTER_MEDIAN) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(adc_locals_dict, adc_locals_dict_table);
@@ -296,7 +553,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_channel_deinit_obj, adc_channel_deinit);
 STATIC mp_obj_t adc_channel_value(mp_obj_t self_in) {
     pyb_adc_channel_obj_t *self = self_in;
     // the channel must be enabled
-    if (!self->enabled) {
+    if (!self->enabled || self->adc->streaming) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
     }
     return MP_OBJ_NEW_SMALL_INT(adc1_get_raw(self->channel));
@@ -307,7 +564,7 @@ STATIC mp_obj_t adc_channel_voltage(mp_obj_t self_in) {
     pyb_adc_channel_obj_t *self = self_in;
     uint32_t voltage;
     // the channel must be enabled
-    if (!self->enabled) {
+    if (!self->enabled || self->adc->streaming) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
     }
     if (self->calibrate) {
@@ -334,12 +591,77 @@ STATIC mp_obj_t adc_channel_call(mp_obj_t self_in, mp_uint_t n_args, mp_uint_t n
     return adc_channel_value (self_in);
 }
 
+/// \method voltages(buf, *, rate=100000, oversample=16, filter=ADC.AVERAGE)
+/// Fills the array('H') buf with calibrated millivolts, each one reduced from oversample
+/// consecutive samples taken at rate Hz, and returns how many of them were stored.
+STATIC mp_obj_t adc_channel_voltages(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    STATIC const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,        MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_rate,       MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 100000} },
+        { MP_QSTR_oversample, MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 16} },
+        { MP_QSTR_filter,     MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = PYB_ADC_FILTER_AVERAGE} },
+    };
+
+    // parse args
+    pyb_adc_channel_obj_t *self = pos_args[0];
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(args), allowed_args, args);
+
+    uint32_t oversample = args[2].u_int;
+    uint8_t filter = args[3].u_int;
+    if (!self->enabled) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_request_not_possible));
+    }
+    if (oversample < 1 || oversample > PYB_ADC_OVERSAMPLE_MAX ||
+        (filter != PYB_ADC_FILTER_AVERAGE && filter != PYB_ADC_FILTER_MEDIAN)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    uint32_t n_out = bufinfo.len / sizeof(uint16_t);
+    uint16_t *out = bufinfo.buf;
+
+    if (self->calibrate) {
+        self->calibrate = false;
+        esp_adc_cal_characterize(ADC_UNIT_1, self->attn, self->adc->width - 9,self->adc->vref, &self->characteristics);
+    }
+
+    // as many whole groups as fit in a DMA buffer, keeping the sample pairs together
+    uint32_t groups = PYB_ADC_DMA_BUF_LEN / oversample;
+    if ((groups * oversample) & 1) {
+        groups--;
+    }
+    uint16_t *raw = m_new(uint16_t, groups * oversample);
+
+    pyb_adc_stream_start(self->adc, args[1].u_int, &self, 1, PYB_ADC_STREAM_BUFFER_DEFAULT);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        for (uint32_t i = 0; i < n_out; ) {
+            pyb_adc_stream_read_raw((uint8_t *)raw, groups * oversample * sizeof(uint16_t));
+            for (uint32_t g = 0; g < groups && i < n_out; g++, i++) {
+                uint32_t value = pyb_adc_reduce(&raw[g * oversample], oversample, filter);
+                out[i] = esp_adc_cal_raw_to_voltage(value, &self->characteristics);
+            }
+        }
+        nlr_pop();
+    } else {
+        pyb_adc_stream_stop(self->adc);
+        nlr_jump(nlr.ret_val);
+    }
+    pyb_adc_stream_stop(self->adc);
+    m_del(uint16_t, raw, groups * oversample);
+
+    return mp_obj_new_int(n_out);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(adc_channel_voltages_obj, 1, adc_channel_voltages);
+
 STATIC const mp_map_elem_t adc_channel_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&adc_channel_init_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&adc_channel_deinit_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_value),               (mp_obj_t)&adc_channel_value_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_voltage),             (mp_obj_t)&adc_channel_voltage_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_value_to_voltage),    (mp_obj_t)&adc_channel_value_to_voltage_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_voltages),            (mp_obj_t)&adc_channel_voltages_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(adc_channel_locals_dict, adc_channel_locals_dict_table);
@@ -12,4 +12,7 @@
 
 extern const mp_obj_type_t pyb_adc_type;
 
+extern bool pyb_adc_in_use (void);
+extern bool pyb_adc_stream_in_use (void);
+
 #endif /* PYBADC_H_ */
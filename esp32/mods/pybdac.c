@@ -8,10 +8,21 @@
  */
 
 
+#include <string.h>
+
+#include "py/mpstate.h"
 #include "py/runtime.h"
+#include "py/mpthread.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/i2s.h"
 
 #include "analog.h"
 #include "pybdac.h"
+#include "pybadc.h"
+#include "machi2s.h"
 #include "mpexception.h"
 #include "machpin.h"
 
@@ -20,6 +31,15 @@
  DECLARE CONSTANTS
  ******************************************************************************/
 #define PYB_DAC_NUM                         2
+
+// waveforms are played by I2S0 through its DMA
+#define PYB_DAC_I2S_NUM                     (I2S_NUM_0)
+#define PYB_DAC_DMA_BUF_COUNT               (4)
+#define PYB_DAC_DMA_BUF_LEN                 (256)       // frames
+#define PYB_DAC_RATE_MIN                    (1000)
+#define PYB_DAC_RATE_MAX                    (1000000)
+#define PYB_DAC_TASK_STACK_SIZE             (3072)
+#define PYB_DAC_TASK_PRIORITY               (5)
 /******************************************************************************
  DEFINE TYPES
  ******************************************************************************/
@@ -35,12 +55,30 @@ typedef struct {
     uint8_t tone_scale;
 } pyb_dac_obj_t;
 
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;
+    uint32_t slot;          // root pointer keeping the buffer object alive
+    bool loop;
+} pyb_dac_wave_buf_t;
+
+typedef struct {
+    TaskHandle_t task;
+    QueueHandle_t queue;    // the buffer to play next, hence double buffering
+    pyb_dac_obj_t *owner;   // DAC the I2S output is routed to, NULL if stopped
+    uint32_t rate;
+    uint32_t seq;           // buffers queued so far, selects their root pointer slot
+    volatile bool stop;
+    volatile bool busy;
+} pyb_dac_wave_t;
+
 
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
 STATIC pyb_dac_obj_t pyb_dac_obj[PYB_DAC_NUM] = { {.id = 0, .enabled = false, .tone = false},
                                                   {.id = 1, .enabled = false, .tone = false} };
+STATIC pyb_dac_wave_t pyb_dac_wave;
 
 
 /******************************************************************************
@@ -59,9 +97,107 @@ esp_err_t set_dac(void){
     return analog_dac_out(dac_enable, dac_tone_enable, dc_value, tone_scale, tone_step);
 }
 
+// every 8 bit sample is sent as the high byte of both 16 bit channels of a frame
+STATIC void TASK_DAC (void *pvParameters) {
+    uint16_t frames[PYB_DAC_DMA_BUF_LEN * 2];
+    pyb_dac_wave_buf_t wave;
+    for ( ; ; ) {
+        if (!xQueueReceive(pyb_dac_wave.queue, &wave, 0)) {
+            // don't let the DMA repeat its last buffer while there's nothing to play
+            pyb_dac_wave.busy = false;
+            if (pyb_dac_wave.owner) {
+                i2s_zero_dma_buffer(PYB_DAC_I2S_NUM);
+            }
+            xQueueReceive(pyb_dac_wave.queue, &wave, portMAX_DELAY);
+        }
+        pyb_dac_wave.busy = true;
+        do {
+            for (uint32_t i = 0; i < wave.len && !pyb_dac_wave.stop; ) {
+                uint32_t n = MIN(wave.len - i, PYB_DAC_DMA_BUF_LEN);
+                for (uint32_t j = 0; j < n; j++) {
+                    frames[2 * j] = frames[(2 * j) + 1] = wave.data[i + j] << 8;
+                }
+                size_t written;
+                i2s_write(PYB_DAC_I2S_NUM, frames, n * 2 * sizeof(uint16_t), &written, portMAX_DELAY);
+                i += n;
+            }
+            // a looping buffer plays until another one is queued
+        } while (wave.loop && !pyb_dac_wave.stop && !uxQueueMessagesWaiting(pyb_dac_wave.queue));
+        MP_STATE_PORT(dac_wave_buf)[wave.slot] = MP_OBJ_NULL;
+    }
+}
+
+STATIC void pyb_dac_wave_stop (void) {
+    if (pyb_dac_wave.owner) {
+        // stays set until the next start, a buffer the task has just picked up gets skipped too
+        pyb_dac_wave.stop = true;
+        xQueueReset(pyb_dac_wave.queue);
+        MP_THREAD_GIL_EXIT();
+        while (pyb_dac_wave.busy) {
+            vTaskDelay(1);
+        }
+        MP_THREAD_GIL_ENTER();
+        MP_STATE_PORT(dac_wave_buf)[0] = MP_OBJ_NULL;
+        MP_STATE_PORT(dac_wave_buf)[1] = MP_OBJ_NULL;
+
+        i2s_set_dac_mode(I2S_DAC_CHANNEL_DISABLE);
+        i2s_driver_uninstall(PYB_DAC_I2S_NUM);
+        pyb_dac_wave.owner = NULL;
+        // back to the static levels
+        set_dac();
+    }
+}
+
+STATIC void pyb_dac_wave_start (pyb_dac_obj_t *self, uint32_t rate) {
+    if (!pyb_dac_wave.task) {
+        pyb_dac_wave.queue = xQueueCreate(1, sizeof(pyb_dac_wave_buf_t));
+        if (!pyb_dac_wave.queue || pdPASS != xTaskCreatePinnedToCore(TASK_DAC, "DAC", PYB_DAC_TASK_STACK_SIZE / sizeof(StackType_t),
+                                                                     NULL, PYB_DAC_TASK_PRIORITY, &pyb_dac_wave.task, 1)) {
+            pyb_dac_wave.task = NULL;
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_MemoryError, "cannot start the DAC task"));
+        }
+    }
+
+    if (pyb_dac_wave.owner != self) {
+        // I2S0 can be taken by machine.I2S or by the ADC streaming
+        if (mach_i2s_in_use(PYB_DAC_I2S_NUM) || pyb_adc_stream_in_use()) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_resource_not_avaliable));
+        }
+        // only one DAC can be driven by I2S at a time
+        pyb_dac_wave_stop();
+        i2s_config_t i2s_config = {
+            .mode = I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN,
+            .sample_rate = rate,
+            .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+            .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+            .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+            .intr_alloc_flags = 0,
+            .dma_buf_count = PYB_DAC_DMA_BUF_COUNT,
+            .dma_buf_len = PYB_DAC_DMA_BUF_LEN,
+            .use_apll = false,
+        };
+        if (ESP_OK != i2s_driver_install(PYB_DAC_I2S_NUM, &i2s_config, 0, NULL)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, mpexception_os_operation_failed));
+        }
+        // DAC1 is on GPIO25 and is the right channel
+        i2s_set_dac_mode(self->id == 0 ? I2S_DAC_CHANNEL_RIGHT_EN : I2S_DAC_CHANNEL_LEFT_EN);
+        pyb_dac_wave.owner = self;
+        pyb_dac_wave.rate = rate;
+        pyb_dac_wave.stop = false;
+    } else if (pyb_dac_wave.rate != rate) {
+        i2s_set_sample_rates(PYB_DAC_I2S_NUM, rate);
+        pyb_dac_wave.rate = rate;
+    }
+}
+
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
+// the I2S output is routed to one of the DACs
+bool pyb_dac_wave_in_use (void) {
+    return pyb_dac_wave.owner != NULL;
+}
+
 STATIC void pyb_dac_init (pyb_dac_obj_t *self) {
     self->enabled = true;
 }
@@ -124,6 +260,9 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(dac_init_obj, 1, dac_init);
 STATIC mp_obj_t dac_deinit(mp_obj_t self_in) {
     pyb_dac_obj_t *self = self_in;
 
+    if (pyb_dac_wave.owner == self) {
+        pyb_dac_wave_stop();
+    }
     self->enabled = false;
     self->dc_value = 0;
     set_dac();
@@ -191,11 +330,67 @@ STATIC mp_obj_t dac_tone(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_a
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(dac_tone_obj, 1, dac_tone);
 
 
+/// \method play(buf, rate, *, loop=False)
+/// Queues the 8 bit samples of buf to be output at rate Hz, waiting only while another
+/// buffer is already queued. A looping buffer repeats until the next one is queued.
+STATIC mp_obj_t dac_play(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf,     MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_rate,    MP_ARG_REQUIRED | MP_ARG_INT, },
+        { MP_QSTR_loop,    MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false} },
+    };
+
+    pyb_dac_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[1].u_int < PYB_DAC_RATE_MIN || args[1].u_int > PYB_DAC_RATE_MAX) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, mpexception_value_invalid_arguments));
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0].u_obj, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len == 0) {
+        return mp_const_none;
+    }
+
+    pyb_dac_wave_start(self, args[1].u_int);
+
+    pyb_dac_wave_buf_t wave = {.data = bufinfo.buf, .len = bufinfo.len, .slot = pyb_dac_wave.seq++ & 1, .loop = args[2].u_bool};
+    MP_THREAD_GIL_EXIT();
+    // the slot frees up once the buffer queued two calls ago is done
+    while (MP_STATE_PORT(dac_wave_buf)[wave.slot] != MP_OBJ_NULL) {
+        vTaskDelay(1);
+    }
+    MP_THREAD_GIL_ENTER();
+    MP_STATE_PORT(dac_wave_buf)[wave.slot] = args[0].u_obj;
+    MP_THREAD_GIL_EXIT();
+    xQueueSend(pyb_dac_wave.queue, &wave, portMAX_DELAY);
+    MP_THREAD_GIL_ENTER();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(dac_play_obj, 1, dac_play);
+
+STATIC mp_obj_t dac_playing(mp_obj_t self_in) {
+    return mp_obj_new_bool(pyb_dac_wave.owner == self_in && (pyb_dac_wave.busy || uxQueueMessagesWaiting(pyb_dac_wave.queue)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(dac_playing_obj, dac_playing);
+
+STATIC mp_obj_t dac_stop(mp_obj_t self_in) {
+    if (pyb_dac_wave.owner == self_in) {
+        pyb_dac_wave_stop();
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(dac_stop_obj, dac_stop);
+
 STATIC const mp_map_elem_t dac_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_init),                (mp_obj_t)&dac_init_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_deinit),              (mp_obj_t)&dac_deinit_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_write),               (mp_obj_t)&dac_write_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_tone),                (mp_obj_t)&dac_tone_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_play),                (mp_obj_t)&dac_play_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_playing),             (mp_obj_t)&dac_playing_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_stop),                (mp_obj_t)&dac_stop_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(dac_locals_dict, dac_locals_dict_table);
@@ -12,4 +12,6 @@
 
 extern const mp_obj_type_t pyb_dac_type;
 
+extern bool pyb_dac_wave_in_use (void);
+
 #endif /* PYBDAC_H_ */
@@ -37,6 +37,7 @@
 /******************************************************************************
  DEFINE PRIVATE CONSTANTS
  ******************************************************************************/
+#define PYBSD_FREQUENCY_MAX_HZ                  (SDMMC_FREQ_HIGHSPEED * 1000)
 
 /******************************************************************************
  DECLARE PUBLIC DATA
@@ -50,7 +51,7 @@ pybsd_obj_t pybsd_obj = {.enabled = false};
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
-STATIC void pyb_sd_hw_init (pybsd_obj_t *self);
+STATIC void pyb_sd_hw_init (pybsd_obj_t *self, uint8_t width);
 STATIC mp_obj_t pyb_sd_make_new (const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args);
 STATIC mp_obj_t pyb_sd_deinit (mp_obj_t self_in);
 
@@ -58,24 +59,44 @@ STATIC mp_obj_t pyb_sd_deinit (mp_obj_t self_in);
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
 /// initalizes the sd card hardware driver
-STATIC void pyb_sd_hw_init (pybsd_obj_t *self) {
+STATIC void pyb_sd_hw_init (pybsd_obj_t *self, uint8_t width) {
+    if (self->enabled && self->width != width) {
+        // the slot has to be set up again for the new bus width
+        sdmmc_host_deinit();
+        self->enabled = false;
+    }
     if (!self->enabled) {
         sdmmc_slot_config_t slot_config =
         {
             .gpio_cd = SDMMC_SLOT_NO_CD,
             .gpio_wp = SDMMC_SLOT_NO_WP,
-            .width   = 1,  // single bit bus
+            .width   = width,
         };
 
         sdmmc_host_init();
         sdmmc_host_init_slot(SDMMC_HOST_SLOT_1, &slot_config);
+        self->width = width;
         self->enabled = true;
     }
 }
 
 STATIC mp_obj_t pyb_sd_init_helper (pybsd_obj_t *self, const mp_arg_val_t *args) {
-    pyb_sd_hw_init (self);
-    if (sd_disk_init() != 0) {
+    uint32_t freq_khz = SDMMC_FREQ_DEFAULT;
+    if (args[0].u_obj != MP_OBJ_NULL && args[0].u_obj != mp_const_none) {
+        mp_int_t freq = mp_obj_get_int(args[0].u_obj);
+        if (freq < SDMMC_FREQ_PROBING * 1000 || freq > PYBSD_FREQUENCY_MAX_HZ) {
+            mp_raise_ValueError("invalid frequency");
+        }
+        freq_khz = freq / 1000;
+    }
+    // the 4-bit bus also needs D1-D3 on GPIO4, GPIO12 and GPIO13 wired to the card
+    uint8_t width = args[1].u_int;
+    if (width != 1 && width != 4) {
+        mp_raise_ValueError("invalid bus width");
+    }
+
+    pyb_sd_hw_init (self, width);
+    if (sd_disk_init(freq_khz, width) != 0) {
         mp_raise_msg(&mp_type_OSError, mpexception_os_operation_failed);
     }
 
@@ -89,6 +110,7 @@ STATIC mp_obj_t pyb_sd_init_helper (pybsd_obj_t *self, const mp_arg_val_t *args)
 STATIC const mp_arg_t pyb_sd_init_args[] = {
     { MP_QSTR_id,                          MP_ARG_INT, {.u_int = 0} },
     { MP_QSTR_freq,                        MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_width,                       MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
 };
 STATIC mp_obj_t pyb_sd_make_new (const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *all_args) {
     // parse args
@@ -40,7 +40,9 @@
 #define __INCLUDED_MPCONFIGPORT_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "mp_pycom_err.h"
+#include "nativecode.h"
 
 // options to control how Micro Python is built
 #define MICROPY_OBJ_REPR                            (MICROPY_OBJ_REPR_A)
@@ -48,9 +50,17 @@
 #define MICROPY_EMIT_X64                            (0)
 #define MICROPY_EMIT_THUMB                          (0)
 #define MICROPY_EMIT_INLINE_THUMB                   (0)
+#define MICROPY_EMIT_XTENSAWIN                      (1)
+#define MICROPY_EMIT_INLINE_XTENSA                  (1)
+// native code is generated in the GC heap then copied to IRAM, the only executable RAM
+#define MP_PLAT_COMMIT_EXEC(buf, len)               nativecode_commit(buf, len)
 #define MICROPY_MEM_STATS                           (0)
 #define MICROPY_DEBUG_PRINTERS                      (1)
 #define MICROPY_ENABLE_GC                           (1)
+#define MICROPY_GC_INCREMENTAL                      (1)
+#define MICROPY_GC_SPLIT_HEAP                       (1)
+#define MICROPY_GC_SPLIT_HEAP_LARGE_BYTES           (256)
+#define MICROPY_GC_ALLOC_PROFILE                    (1)
 #define MICROPY_STACK_CHECK                         (1)
 #define MICROPY_HELPER_REPL                         (1)
 #define MICROPY_PY_BUILTINS_HELP                    (1)
@@ -81,30 +91,56 @@
 #define MICROPY_PY_IO                               (1)
 #define MICROPY_PY_IO_FILEIO                        (1)
 #define MICROPY_PY_STRUCT                           (1)
+#define MICROPY_PY_STRUCT_STRUCT                    (1)
 #define MICROPY_PY_SYS                              (1)
 #define MICROPY_PY_THREAD                           (1)
 #define MICROPY_PY_THREAD_GIL                       (1)
-#define MICROPY_PY_THREAD_GIL_VM_DIVISOR            (8)
+#define MICROPY_PY_THREAD_GIL_ADAPTIVE              (1)
+#define MICROPY_PY_THREAD_GIL_SLICE_US              (1000)
+#define MICROPY_PY_THREAD_CORE_AFFINITY             (1)
 #define MICROPY_PY_SYS_MAXSIZE                      (1)
 #define MICROPY_PY_SYS_EXIT                         (1)
 #define MICROPY_PY_SYS_STDFILES                     (1)
 #define MICROPY_PY_UBINASCII                        (1)
+#define MICROPY_PY_UBINASCII_CRC32                  (1)
+#define MICROPY_PY_UBINASCII_CRC                    (1)
 #define MICROPY_PY_UERRNO                           (1)
 #define MICROPY_PY_UCTYPES                          (1)
+#define MICROPY_PY_UCTYPES_LAYOUT_CACHE             (4)
 #define MICROPY_PY_UHASHLIB                         (0)
 #define MICROPY_PY_UHASHLIB_SHA1                    (0)
 #define MICROPY_PY_UJSON                            (1)
+#define MICROPY_STREAMS_POSIX_API                   (MICROPY_PY_BTREE)
+// a page is written to the file system as a whole, the cache holds the pages modified until flush()
+#define MICROPY_PY_BTREE_PAGESIZE                   (1024)
+#define MICROPY_PY_BTREE_CACHESIZE                  (8 * 1024)
 #define MICROPY_PY_URE                              (1)
+#define MICROPY_PY_URE_CACHE                        (8)
+#define MICROPY_PY_URE_MATCH_INTO                   (1)
 #define MICROPY_PY_USELECT                          (1)
+#define MICROPY_PY_USELECT_PORT_FDS                 (1)
 #define MICROPY_PY_MACHINE                          (1)
 #define MICROPY_PY_MICROPYTHON_MEM_INFO             (1)
+#define MICROPY_PY_MICROPYTHON_PROFILE              (1)
 #define MICROPY_PY_UTIMEQ                           (1)
 #define MICROPY_CPYTHON_COMPAT                      (1)
 #define MICROPY_LONGINT_IMPL                        (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_FLOAT_IMPL                          (MICROPY_FLOAT_IMPL_FLOAT)
 #define MICROPY_ERROR_REPORTING                     (MICROPY_ERROR_REPORTING_NORMAL)
 #define MICROPY_OPT_COMPUTED_GOTO                   (1)
+// the cache in the bytecode would need the frozen code in RAM, the one in the VM doesn't
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE    (0)
+#define MICROPY_OPT_MAP_LOOKUP_CACHE                (1)
+
+// VM_IRAM=on places the hottest interpreter paths in IRAM (the .iram1 sections
+// of esp32.project.ld), saving the flash cache misses on them, roughly 10 KB of IRAM
+#ifdef MICROPY_VM_IN_IRAM
+#include "esp_attr.h"
+#define MICROPY_WRAP_MP_EXECUTE_BYTECODE(f)         IRAM_ATTR f
+#define MICROPY_WRAP_MP_MAP_LOOKUP(f)               IRAM_ATTR f
+#define MICROPY_WRAP_GC_ALLOC(f)                    IRAM_ATTR f
+#define MICROPY_WRAP_MP_OBJ_GET_TYPE(f)             IRAM_ATTR f
+#endif
 #define MICROPY_REPL_AUTO_INDENT                    (1)
 #define MICROPY_COMP_MODULE_CONST                   (1)
 #define MICROPY_ENABLE_FINALISER                    (1)
@@ -114,9 +150,14 @@
 #define MICROPY_MODULE_FROZEN_STR                   (0)
 #define MICROPY_MODULE_FROZEN_MPY                   (1)
 #define MICROPY_PERSISTENT_CODE_LOAD                (1)
+#define MICROPY_PERSISTENT_CODE_SAVE                (1)
+// boot.py, main.py and the modules imported from /flash are compiled once
+#define MICROPY_PERSISTENT_CODE_CACHE               (1)
 #define MICROPY_QSTR_EXTRA_POOL                     mp_qstr_frozen_const_pool
+#define MICROPY_QSTR_INDEX                          (1)
 #define MICROPY_PY_FRAMEBUF                         (1)
 #define MICROPY_PY_UZLIB                            (1)
+#define MICROPY_PY_UZLIB_COMPRESS                   (1)
 
 #define MICROPY_STREAMS_NON_BLOCK                   (1)
 #define MICROPY_PY_BUILTINS_TIMEOUTERROR            (1)
@@ -191,6 +232,17 @@ extern const struct _mp_obj_module_t mp_module_uhashlib;
 extern const struct _mp_obj_module_t module_ucrypto;
 extern const struct _mp_obj_module_t mp_module_ussl;
 extern const struct _mp_obj_module_t mp_module_uqueue;
+extern const struct _mp_obj_module_t mp_module_ureclog;
+extern const struct _mp_obj_module_t mp_module_onewire;
+extern const struct _mp_obj_module_t mp_module_udsp;
+#if defined(FIPY) || defined(GPY)
+extern const struct _mp_obj_module_t mp_module_usqnstp;
+#define MICROPY_PORT_LTE_BUILTIN_MODULES \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_usqnstp),         (mp_obj_t)&mp_module_usqnstp },   \
+
+#else
+#define MICROPY_PORT_LTE_BUILTIN_MODULES
+#endif
 
 #define MICROPY_PORT_BUILTIN_MODULES \
     { MP_OBJ_NEW_QSTR(MP_QSTR_umachine),        (mp_obj_t)&machine_module },      \
@@ -206,6 +258,10 @@ extern const struct _mp_obj_module_t mp_module_uqueue;
     { MP_OBJ_NEW_QSTR(MP_QSTR_ussl),            (mp_obj_t)&mp_module_ussl },      \
     { MP_OBJ_NEW_QSTR(MP_QSTR_uerrno),          (mp_obj_t)&mp_module_uerrno },    \
     { MP_OBJ_NEW_QSTR(MP_QSTR_uqueue),          (mp_obj_t)&mp_module_uqueue },    \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ureclog),         (mp_obj_t)&mp_module_ureclog },   \
+    { MP_OBJ_NEW_QSTR(MP_QSTR__onewire),        (mp_obj_t)&mp_module_onewire },   \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_udsp),            (mp_obj_t)&mp_module_udsp },      \
+    MICROPY_PORT_LTE_BUILTIN_MODULES \
 
 #define MICROPY_PORT_BUILTIN_MODULE_WEAK_LINKS \
     { MP_OBJ_NEW_QSTR(MP_QSTR_machine),         (mp_obj_t)&machine_module },      \
@@ -222,6 +278,8 @@ extern const struct _mp_obj_module_t mp_module_uqueue;
     { MP_OBJ_NEW_QSTR(MP_QSTR_ssl),             (mp_obj_t)&mp_module_ussl },      \
     { MP_OBJ_NEW_QSTR(MP_QSTR_errno),           (mp_obj_t)&mp_module_uerrno },    \
     { MP_OBJ_NEW_QSTR(MP_QSTR_queue),           (mp_obj_t)&mp_module_uqueue },    \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_reclog),          (mp_obj_t)&mp_module_ureclog },   \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dsp),             (mp_obj_t)&mp_module_udsp },      \
 
 // extra constants
 #define MICROPY_PORT_CONSTANTS \
@@ -234,7 +292,18 @@ extern const struct _mp_obj_module_t mp_module_uqueue;
 #define MICROPY_BEGIN_ATOMIC_SECTION()              portENTER_CRITICAL_NESTED()
 #define MICROPY_END_ATOMIC_SECTION(state)           portEXIT_CRITICAL_NESTED(state)
 
-#define MICROPY_EVENT_POLL_HOOK                     mp_hal_delay_ms(1);
+#define MICROPY_EVENT_POLL_HOOK                     mp_hal_poll_wait(1);
+
+// the collections show in the trace of machine.trace()
+void mptrace_gc_collect (bool start);
+#define MICROPY_GC_HOOK_COLLECT_START               mptrace_gc_collect(true);
+#define MICROPY_GC_HOOK_COLLECT_END                 mptrace_gc_collect(false);
+
+// the CRCs of the ROM (rom/crc.h), for ubinascii.crc32() and ubinascii.CRC
+uint32_t crc32_le (uint32_t crc, uint8_t const *buf, uint32_t len);
+uint16_t crc16_le (uint16_t crc, uint8_t const *buf, uint32_t len);
+#define MICROPY_PY_UBINASCII_CRC32_LE(crc, buf, len)    crc32_le((crc), (buf), (len))
+#define MICROPY_PY_UBINASCII_CRC16_LE(crc, buf, len)    crc16_le((crc), (buf), (len))
 
 #define MICROPY_PORT_ROOT_POINTERS \
     const char *readline_hist[8];                               \
@@ -252,6 +321,15 @@ extern const struct _mp_obj_module_t mp_module_uqueue;
     mp_obj_list_t bts_attr_list;                                \
     char* lfs_cwd;                                              \
     mp_obj_t coap_ptr;                                          \
+    mp_obj_t mach_spi_async_buf[2];                             \
+    mp_obj_t mach_i2c_slave_buf[2];                             \
+    mp_obj_t dac_wave_buf[2];                                   \
+    mp_obj_t mach_rmt_tx_buf[8];                                \
+    mp_obj_t pycom_nvs_cache;                                   \
+    mp_obj_t pycom_nvs_dirty;                                   \
+    mp_obj_list_t mqtt_client_list;                             \
+    mp_obj_t mpmetrics_export[2];                               \
+    const byte *prof_sites[MICROPY_PY_MICROPYTHON_PROFILE_SITES]; \
 
 // we need to provide a declaration/definition of alloca()
 #include <alloca.h>
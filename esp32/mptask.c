@@ -44,6 +44,7 @@
 #include "modnetwork.h"
 #include "modwlan.h"
 #include "modusocket.h"
+#include "modmqtt.h"
 #include "antenna.h"
 #include "modled.h"
 #include "esp_log.h"
@@ -64,11 +65,22 @@
 #include "updater.h"
 #include "pycom_config.h"
 #include "mpsleep.h"
+#include "mpwakestub.h"
+#include "mpcpufreq.h"
+#include "mptaskstats.h"
+#include "mptaskmon.h"
+#include "mpmetrics.h"
+#include "mpprofile.h"
 #include "machrtc.h"
 #include "modbt.h"
 #include "machtimer.h"
 #include "machtimer_alarm.h"
+#include "machpwm.h"
+#include "machi2s.h"
+#include "machine_i2c.h"
+#include "machspi.h"
 #include "mptask.h"
+#include "boottime.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -91,6 +103,8 @@
  DECLARE EXTERNAL FUNCTIONS
  ******************************************************************************/
 extern void modpycom_init0(void);
+extern void modpycom_nvs_commit_all(void);
+extern void modussl_pre_init(void);
 
 /******************************************************************************
  DECLARE EXTERNAL DATA
@@ -103,6 +117,8 @@ extern TaskHandle_t svTaskHandle;
  ******************************************************************************/
 #define GC_POOL_SIZE_BYTES                                          (67 * 1024)
 #define GC_POOL_SIZE_BYTES_PSRAM                                    ((2048 + 512) * 1024)
+// internal RAM area holding the small objects on PSRAM boards, the large ones go to the PSRAM pool
+#define GC_POOL_SIZE_BYTES_PSRAM_INTERNAL                           (48 * 1024)
 
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
@@ -126,6 +142,7 @@ fs_user_mount_t sflash_vfs_flash;
  DECLARE PRIVATE DATA
  ******************************************************************************/
 static uint8_t *gc_pool_upy;
+static uint8_t *gc_pool_upy_psram;
 
 static char fresh_main_py[] = "# main.py -- put your code here!\r\n";
 static char fresh_boot_py[] = "# boot.py -- run on boot-up\r\n";
@@ -140,6 +157,8 @@ void TASK_Micropython (void *pvParameters) {
     bool soft_reset = false;
     uint32_t stack_len;
 
+    boottime_mark(E_BOOTTIME_MP_TASK);
+
     uint8_t chip_rev = esp32_get_chip_rev();
 
     if (chip_rev > 0) {
@@ -152,6 +171,7 @@ void TASK_Micropython (void *pvParameters) {
     antenna_init0();
     config_init0();
     mpsleep_init0();
+    mpwakestub_init0();
     if (mpsleep_get_reset_cause() != MPSLEEP_DEEPSLEEP_RESET) {
         rtc_init0();
     }
@@ -164,6 +184,7 @@ void TASK_Micropython (void *pvParameters) {
 #endif
     /* Creat Socket Operation task */
     modusocket_pre_init();
+    modussl_pre_init();
 
     // initialise the stack pointer for the main thread (must be done after mp_thread_preinit)
     mp_stack_set_top((void *)sp);
@@ -175,6 +196,17 @@ void TASK_Micropython (void *pvParameters) {
     if (esp32_get_chip_rev() > 0) {
         gc_pool_size = GC_POOL_SIZE_BYTES_PSRAM;
         gc_pool_upy = heap_caps_malloc(GC_POOL_SIZE_BYTES_PSRAM, MALLOC_CAP_SPIRAM);
+#if MICROPY_GC_SPLIT_HEAP
+        // the objects used the most stay out of the slower external RAM
+        gc_pool_upy_psram = gc_pool_upy;
+        gc_pool_upy = heap_caps_malloc(GC_POOL_SIZE_BYTES_PSRAM_INTERNAL, MALLOC_CAP_INTERNAL);
+        if (NULL == gc_pool_upy) {
+            gc_pool_upy = gc_pool_upy_psram;
+            gc_pool_upy_psram = NULL;
+        } else {
+            gc_pool_size = GC_POOL_SIZE_BYTES_PSRAM_INTERNAL;
+        }
+#endif
     } else {
         gc_pool_size = GC_POOL_SIZE_BYTES;
         gc_pool_upy = heap_caps_malloc(GC_POOL_SIZE_BYTES, MALLOC_CAP_INTERNAL);
@@ -197,9 +229,16 @@ soft_reset:
 
     // GC init
     gc_init((void *)gc_pool_upy, (void *)(gc_pool_upy + gc_pool_size));
+#if MICROPY_GC_SPLIT_HEAP
+    if (gc_pool_upy_psram != NULL) {
+        gc_add((void *)gc_pool_upy_psram, (void *)(gc_pool_upy_psram + GC_POOL_SIZE_BYTES_PSRAM));
+    }
+#endif
+    boottime_mark(E_BOOTTIME_GC_INIT);
 
     // MicroPython init
     mp_init();
+    boottime_mark(E_BOOTTIME_MP_INIT);
     mp_obj_list_init(mp_sys_path, 0);
     mp_obj_list_init(mp_sys_argv, 0);
     mp_obj_list_append(mp_sys_path, MP_OBJ_NEW_QSTR(MP_QSTR_)); // current dir (or base dir of the script)
@@ -217,8 +256,16 @@ soft_reset:
     mp_hal_init(soft_reset);
     readline_init0();
     mod_network_init0();
+    modmqtt_init0();
     modbt_init0();
+    if (config_get_init_on_boot() & PYCOM_INIT_ON_BOOT_BT) {
+        modbt_init_resources();
+    }
     machtimer_init0();
+    mpcpufreq_init0();
+    mptaskstats_init0();
+    mptaskmon_init0();
+    mpmetrics_init0();
     modpycom_init0();
     bool safeboot = false;
     boot_info_t boot_info;
@@ -239,16 +286,24 @@ soft_reset:
         // Config Wifi as per Pycom config
         mptask_config_wifi(false);
         // these ones are special because they need uPy running and they launch tasks
-#if defined(LOPY) || defined (LOPY4) || defined (FIPY)
+#if defined(LOPY4) || defined (FIPY)
+        // the Sigfox library shares the radio and its lock with LoRa, it can't wait
         modlora_init0();
+#elif defined(LOPY)
+        // otherwise started by the first LoRa() call
+        if (config_get_init_on_boot() & PYCOM_INIT_ON_BOOT_LORA) {
+            modlora_init0();
+        }
 #endif
 #if defined(SIPY) || defined(LOPY4) || defined (FIPY)
         modsigfox_init0();
 #endif
     }
+    boottime_mark(E_BOOTTIME_MODULES_INIT);
 
     // initialize the serial flash file system
     mptask_init_sflash_filesystem();
+    boottime_mark(E_BOOTTIME_FS_MOUNT);
 
 #if defined(LOPY) || defined(SIPY) || defined (LOPY4) || defined(FIPY)
     // must be done after initializing the file system
@@ -270,14 +325,17 @@ soft_reset:
     MP_STATE_PORT(machine_config_main) = MP_OBJ_NULL;
 
     pyexec_frozen_module("_boot.py");
+    boottime_mark(E_BOOTTIME_FROZEN_BOOT_PY);
 
     if (!soft_reset) {
     #if defined(GPY) || defined (FIPY)
-        modlte_init0();
-        if(config_get_lte_modem_enable_on_boot())
-        {
+        // otherwise started by the first LTE() call
+        if (config_get_lte_modem_enable_on_boot()) {
+            modlte_init0();
             // Notify the LTE thread to start
             modlte_start_modem();
+        } else if (config_get_init_on_boot() & PYCOM_INIT_ON_BOOT_LTE) {
+            modlte_init0();
         }
     #endif
     }
@@ -285,6 +343,7 @@ soft_reset:
     if (!safeboot) {
         // run boot.py
         int ret = pyexec_file("boot.py");
+        boottime_mark(E_BOOTTIME_BOOT_PY);
         if (ret & PYEXEC_FORCED_EXIT) {
             goto soft_reset_exit;
         }
@@ -308,6 +367,7 @@ soft_reset:
 #else
         pyexec_frozen_module("_main.py");
 #endif
+        boottime_mark(E_BOOTTIME_FROZEN_MAIN_PY);
 
         // run the main script from the current directory.
         if (pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
@@ -317,6 +377,7 @@ soft_reset:
             } else {
                 main_py = mp_obj_str_get_str(MP_STATE_PORT(machine_config_main));
             }
+            boottime_mark(E_BOOTTIME_MAIN_PY);
             int ret = pyexec_file(main_py);
             if (ret & PYEXEC_FORCED_EXIT) {
                 goto soft_reset_exit;
@@ -346,11 +407,27 @@ soft_reset:
 
 soft_reset_exit:
 
+    mpprofile_deinit0();
+    // the MQTT tasks use the heap
+    modmqtt_deinit0();
+#if defined(SIPY) || defined(LOPY4) || defined (FIPY)
+    modsigfox_async_deinit0();
+#endif
     machtimer_deinit();
+    mach_pwm_deinit0();
+    mach_i2s_deinit0();
+    machine_i2c_deinit0();
+    mach_spi_deinit0();
 #if MICROPY_PY_THREAD
     mp_irq_kill();
     mp_thread_deinit();
 #endif
+    // nothing can run native code anymore
+    nativecode_free_all();
+    // the NVS values set with commit=False live in the heap
+    modpycom_nvs_commit_all();
+    // a transaction left open by the script
+    config_abort();
     mpsleep_signal_soft_reset();
     mp_printf(&mp_plat_print, "PYB: soft reboot\n");
     // it needs to be this one in order to not mess with the GIL
@@ -488,6 +565,7 @@ STATIC void mptask_init_sflash_filesystem_littlefs(void) {
     sflash_disk_init();
     //Initialize the VFS object with the block device's functions
     pyb_flash_init_vfs_littlefs(vfs_littlefs);
+    littlefs_metrics_init();
 
     if(spi_flash_get_chip_size() > (4* 1024 * 1024))
     {
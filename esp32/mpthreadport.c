@@ -44,6 +44,7 @@
 
 #include "sdkconfig.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -58,6 +59,7 @@
 
 #define MP_THREAD_MIN_STACK_SIZE                        (5 * 1024)
 #define MP_THREAD_DEFAULT_STACK_SIZE                    (MP_THREAD_MIN_STACK_SIZE)
+#define MP_THREAD_GIL_HANDOVER_US                       (200)
 
 // this structure forms a linked list, one node per active thread
 typedef struct _thread_t {
@@ -78,6 +80,19 @@ STATIC thread_t *thread; // root pointer, handled by mp_thread_gc_others
 STATIC bool during_soft_reset = false;
 STATIC uint8_t mp_chip_revision;
 
+// core new Python threads are pinned to when none is given, MP_THREAD_CORE_ANY lets the scheduler pick
+STATIC int thread_default_core = MP_THREAD_CORE_DEFAULT;
+// buffers of at least this many bytes are processed by the native builtins with the GIL
+// released, 0 keeps it held all the time
+size_t mp_thread_gil_release_min = 0;
+
+// threads blocked on the GIL, the VM keeps it as long as nobody is waiting
+volatile uint32_t mp_thread_gil_waiters = 0;
+STATIC portMUX_TYPE gil_waiters_mux = portMUX_INITIALIZER_UNLOCKED;
+// only written by the GIL holder
+STATIC volatile uint32_t gil_handovers;
+STATIC uint64_t gil_slice_start;
+
 void mp_thread_preinit(void *stack, uint32_t stack_len, uint8_t chip_revision) {
     mp_thread_set_state(&mp_state_ctx.thread);
     // create first entry in linked list of all threads
@@ -96,6 +111,8 @@ void mp_thread_init(void) {
     {
         mp_thread_mutex_init(&thread_mutex);
     }
+    thread_default_core = MP_THREAD_CORE_DEFAULT;
+    mp_thread_gil_release_min = 0;
 }
 
 void mp_thread_gc_others(void) {
@@ -118,6 +135,14 @@ mp_state_thread_t *mp_thread_get_state(void) {
     return pvTaskGetThreadLocalStoragePointer(NULL, 1);
 }
 
+// true when the calling thread is the only Python thread alive
+bool mp_thread_is_alone(void) {
+    mp_thread_mutex_lock(&thread_mutex, 1);
+    bool alone = (thread == NULL || thread->next == NULL);
+    mp_thread_mutex_unlock(&thread_mutex);
+    return alone;
+}
+
 void mp_thread_set_state(void *state) {
     vTaskSetThreadLocalStoragePointer(NULL, 1, state);
 }
@@ -154,7 +179,7 @@ STATIC void freertos_entry(void *arg) {
     for (;;);
 }
 
-void mp_thread_create_ex(void *(*entry)(void*), void *arg, size_t *stack_size, int priority, char *name) {
+void mp_thread_create_ex(void *(*entry)(void*), void *arg, size_t *stack_size, int priority, char *name, int core) {
     // store thread entry function into a global variable so we can access it
     ext_thread_entry = entry;
 
@@ -193,7 +218,8 @@ void mp_thread_create_ex(void *(*entry)(void*), void *arg, size_t *stack_size, i
     mp_thread_mutex_lock(&thread_mutex, 1);
 
     // create thread
-    TaskHandle_t id = xTaskCreateStaticPinnedToCore(freertos_entry, name, *stack_size / sizeof(StackType_t), arg, priority, stack, tcb, 1);
+    TaskHandle_t id = xTaskCreateStaticPinnedToCore(freertos_entry, name, *stack_size / sizeof(StackType_t), arg, priority, stack, tcb,
+                                                     (core == MP_THREAD_CORE_ANY) ? tskNO_AFFINITY : core);
     if (id == NULL) {
         mp_thread_mutex_unlock(&thread_mutex);
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "can't create thread"));
@@ -221,7 +247,37 @@ memory_error:
 }
 
 void mp_thread_create(void *(*entry)(void*), void *arg, size_t *stack_size) {
-    mp_thread_create_ex(entry, arg, stack_size, MP_THREAD_PRIORITY, "MPThread");
+    mp_thread_create_ex(entry, arg, stack_size, MP_THREAD_PRIORITY, "MPThread", thread_default_core);
+}
+
+void mp_thread_create_on_core(void *(*entry)(void*), void *arg, size_t *stack_size, int core) {
+    mp_thread_create_ex(entry, arg, stack_size, MP_THREAD_PRIORITY, "MPThread", core);
+}
+
+int mp_thread_get_default_core(void) {
+    return thread_default_core;
+}
+
+void mp_thread_set_default_core(int core) {
+    thread_default_core = core;
+}
+
+int mp_thread_get_core(void) {
+    return xPortGetCoreID();
+}
+
+bool mp_thread_gil_release_begin(size_t len) {
+    if (mp_thread_gil_release_min == 0 || len < mp_thread_gil_release_min) {
+        return false;
+    }
+    MP_THREAD_GIL_EXIT();
+    return true;
+}
+
+void mp_thread_gil_release_end(bool released) {
+    if (released) {
+        MP_THREAD_GIL_ENTER();
+    }
 }
 
 void mp_thread_finish(void) {
@@ -293,6 +349,48 @@ void mp_thread_mutex_init(mp_thread_mutex_t *mutex) {
     mutex->handle = xSemaphoreCreateMutexStatic(&mutex->buffer);
 }
 
+void mp_thread_gil_enter(void) {
+    mp_thread_mutex_t *gil = &MP_STATE_VM(gil_mutex);
+    if (!mp_thread_mutex_lock(gil, 0)) {
+        portENTER_CRITICAL(&gil_waiters_mux);
+        mp_thread_gil_waiters++;
+        portEXIT_CRITICAL(&gil_waiters_mux);
+        mp_thread_mutex_lock(gil, 1);
+        portENTER_CRITICAL(&gil_waiters_mux);
+        mp_thread_gil_waiters--;
+        portEXIT_CRITICAL(&gil_waiters_mux);
+    }
+    gil_handovers++;
+    // the slice starts when the first waiter is noticed, nobody has to read the time otherwise
+    gil_slice_start = 0;
+}
+
+bool mp_thread_gil_slice_expired(void) {
+    if (mp_irq_hard_is_waiting()) {
+        // a hard callback doesn't wait for the slice to end
+        return true;
+    }
+    uint64_t now = esp_timer_get_time();
+    if (gil_slice_start == 0) {
+        gil_slice_start = now;
+        return false;
+    }
+    return (now - gil_slice_start) >= MICROPY_PY_THREAD_GIL_SLICE_US;
+}
+
+void mp_thread_gil_yield(void) {
+    uint32_t handovers = gil_handovers;
+    MP_THREAD_GIL_EXIT();
+    // a woken up waiter still has to take the mutex, give it the time to do so (and let it
+    // run if it shares our core) instead of taking the GIL straight back
+    uint64_t start = esp_timer_get_time();
+    while (gil_handovers == handovers && mp_thread_gil_waiters != 0 &&
+           (esp_timer_get_time() - start) < MP_THREAD_GIL_HANDOVER_US) {
+        taskYIELD();
+    }
+    MP_THREAD_GIL_ENTER();
+}
+
 int mp_thread_mutex_lock(mp_thread_mutex_t *mutex, int wait) {
     return (pdTRUE == xSemaphoreTake(mutex->handle, wait ? portMAX_DELAY : 0));
 }
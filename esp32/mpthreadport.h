@@ -44,6 +44,8 @@
 #include "freertos/FreeRTOS.h"
 
 #define MP_THREAD_PRIORITY                  5
+#define MP_THREAD_CORE_ANY                  (-1)
+#define MP_THREAD_CORE_DEFAULT              (1)
 
 typedef struct _mp_thread_mutex_t {
     SemaphoreHandle_t handle;
@@ -61,6 +63,17 @@ void mp_thread_init(void);
 void mp_thread_gc_others(void);
 void mp_thread_deinit(void);
 mp_obj_thread_lock_t *mp_thread_new_thread_lock(void);
-void mp_thread_create_ex(void *(*entry)(void*), void *arg, size_t *stack_size, int priority, char *name);
+void mp_thread_create_ex(void *(*entry)(void*), void *arg, size_t *stack_size, int priority, char *name, int core);
+void mp_thread_create_on_core(void *(*entry)(void*), void *arg, size_t *stack_size, int core);
+int mp_thread_get_default_core(void);
+void mp_thread_set_default_core(int core);
+int mp_thread_get_core(void);
+bool mp_thread_is_alone(void);
+
+// CPU heavy builtins bracket work on a buffer of len bytes with these, so that other
+// threads can run on the other core meanwhile; no Python object may be touched in between
+extern size_t mp_thread_gil_release_min;
+bool mp_thread_gil_release_begin(size_t len);
+void mp_thread_gil_release_end(bool released);
 
 #endif // __MICROPY_INCLUDED_ESP32_MPTHREADPORT_H__
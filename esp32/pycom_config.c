@@ -14,18 +14,66 @@
 #include "ff.h"
 #include "diskio.h"
 #include "sflash_diskio.h"
+#include "nvs.h"
 #include "pycom_config.h"
 
 #define CONFIG_DATA_FLASH_BLOCK         (SFLASH_START_BLOCK_4MB + SFLASH_BLOCK_COUNT_4MB)
 #define CONFIG_DATA_FLASH_ADDR          (SFLASH_START_ADDR_4MB + (SFLASH_BLOCK_COUNT_4MB * SFLASH_BLOCK_SIZE))
 
+// a copy of the block is kept in NVS while the sector is erased and written again, an update
+// interrupted by a reset is finished on the next boot
+#define CONFIG_JOURNAL_NAMESPACE        "PY_CFG"
+#define CONFIG_JOURNAL_KEY              "journal"
+#define CONFIG_COMPARE_CHUNK            (64)
+
 static bool config_write (void);
+static bool config_flush (void);
+static bool config_flash_matches (void);
+static bool config_write_sector (void);
 
 static pycom_config_block_t pycom_config_block;
+// the setters only update the RAM mirror while a transaction is open
+static uint32_t config_transaction_depth = 0;
+static bool config_dirty = false;
 
 void config_init0 (void) {
     // read the config struct from flash
     spi_flash_read(CONFIG_DATA_FLASH_ADDR, (void *)&pycom_config_block, sizeof(pycom_config_block));
+
+    nvs_handle handle;
+    if (nvs_open(CONFIG_JOURNAL_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        size_t length = sizeof(pycom_config_block);
+        if (nvs_get_blob(handle, CONFIG_JOURNAL_KEY, (void *)&pycom_config_block, &length) == ESP_OK) {
+            if (length != sizeof(pycom_config_block) || !config_write_sector()) {
+                // not a block of this firmware, or the flash can't take it, keep what's there
+                spi_flash_read(CONFIG_DATA_FLASH_ADDR, (void *)&pycom_config_block, sizeof(pycom_config_block));
+            }
+            nvs_erase_key(handle, CONFIG_JOURNAL_KEY);
+            nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+}
+
+void config_begin (void) {
+    config_transaction_depth++;
+}
+
+// writes the block once for all the setters called since the outermost config_begin()
+bool config_commit (void) {
+    if (config_transaction_depth == 0 || --config_transaction_depth > 0) {
+        return true;
+    }
+    return config_flush();
+}
+
+// drops the changes of the open transactions
+void config_abort (void) {
+    if (config_transaction_depth > 0) {
+        config_transaction_depth = 0;
+        config_dirty = false;
+        spi_flash_read(CONFIG_DATA_FLASH_ADDR, (void *)&pycom_config_block, sizeof(pycom_config_block));
+    }
 }
 
 bool config_set_lpwan_mac (const uint8_t *mac) {
@@ -243,6 +291,23 @@ bool config_get_lte_modem_enable_on_boot (void) {
     return (bool)pycom_config_block.lte_config.lte_modem_en_on_boot;
 }
 
+bool config_set_init_on_boot (uint8_t init_on_boot) {
+    init_on_boot &= PYCOM_INIT_ON_BOOT_ALL;
+    if (pycom_config_block.init_config.init_on_boot != init_on_boot) {
+        pycom_config_block.init_config.init_on_boot = init_on_boot;
+        return config_write();
+    }
+    return true;
+}
+
+uint8_t config_get_init_on_boot (void) {
+    // the reserved space is erased on devices configured by older firmware, nothing is eager then
+    if (pycom_config_block.init_config.init_on_boot == 0xFF) {
+        return 0;
+    }
+    return pycom_config_block.init_config.init_on_boot & PYCOM_INIT_ON_BOOT_ALL;
+}
+
 #if (VARIANT == PYBYTES)
 bool config_set_pybytes_force_update (uint8_t force_update) {
     if (pycom_config_block.pybytes_config.force_update != force_update) {
@@ -406,10 +471,60 @@ bool config_get_pybytes_autostart (void) {
 }
 
 static bool config_write (void) {
+    config_dirty = true;
+    if (config_transaction_depth > 0) {
+        return true;
+    }
+    return config_flush();
+}
+
+static bool config_flush (void) {
+    if (!config_dirty) {
+        return true;
+    }
+    config_dirty = false;
+    // many setters store the value they already have, don't wear the sector for nothing
+    if (config_flash_matches()) {
+        return true;
+    }
+
+    nvs_handle handle;
+    if (nvs_open(CONFIG_JOURNAL_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        // no journal, the update isn't protected against a reset but it's still done
+        return config_write_sector();
+    }
+    bool journal = nvs_set_blob(handle, CONFIG_JOURNAL_KEY, (void *)&pycom_config_block, sizeof(pycom_config_block)) == ESP_OK &&
+                   nvs_commit(handle) == ESP_OK;
+    bool ret = config_write_sector();
+    if (journal) {
+        nvs_erase_key(handle, CONFIG_JOURNAL_KEY);
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+static bool config_flash_matches (void) {
+    uint8_t chunk[CONFIG_COMPARE_CHUNK];
+    for (uint32_t offset = 0; offset < sizeof(pycom_config_block); offset += sizeof(chunk)) {
+        uint32_t len = sizeof(pycom_config_block) - offset;
+        if (len > sizeof(chunk)) {
+            len = sizeof(chunk);
+        }
+        if (spi_flash_read(CONFIG_DATA_FLASH_ADDR + offset, chunk, len) != ESP_OK ||
+            memcmp(chunk, (uint8_t *)&pycom_config_block + offset, len) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool config_write_sector (void) {
     // erase the block first
     if (ESP_OK == spi_flash_erase_sector(CONFIG_DATA_FLASH_BLOCK)) {
-        // then write it
-        return (spi_flash_write(CONFIG_DATA_FLASH_ADDR, (void *)&pycom_config_block, sizeof(pycom_config_block)) == ESP_OK);
+        // then write it, and read it back
+        return (spi_flash_write(CONFIG_DATA_FLASH_ADDR, (void *)&pycom_config_block, sizeof(pycom_config_block)) == ESP_OK) &&
+               config_flash_matches();
     }
     return false;
 }
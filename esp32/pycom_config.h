@@ -16,6 +16,11 @@
 /******************************************************************************
  DEFINE CONSTANTS
  ******************************************************************************/
+// subsystems initialized during boot instead of when first used
+#define PYCOM_INIT_ON_BOOT_BT                   (0x01)
+#define PYCOM_INIT_ON_BOOT_LORA                 (0x02)
+#define PYCOM_INIT_ON_BOOT_LTE                  (0x04)
+#define PYCOM_INIT_ON_BOOT_ALL                  (0x07)
 
 /******************************************************************************
  DEFINE TYPES
@@ -82,6 +87,10 @@ typedef struct {
     uint8_t lte_modem_en_on_boot;
 } pycom_lte_config_t;
 
+typedef struct {
+    uint8_t init_on_boot;       // PYCOM_INIT_ON_BOOT_* flags, 0xFF if never set
+} pycom_init_config_t;
+
 typedef struct {
     uint8_t carrier[129];
     uint8_t apn[129];
@@ -102,7 +111,8 @@ typedef struct {
     pycom_config_t pycom_config;
     pycom_wifi_ap_config_t wifi_ap_config;
     pycom_pybytes_lte_config_t pycom_pybytes_lte_config;
-    uint8_t pycom_reserved[112];
+    pycom_init_config_t init_config;
+    uint8_t pycom_reserved[111];
 } pycom_config_block_t;
 
 typedef enum
@@ -118,6 +128,12 @@ typedef enum
  ******************************************************************************/
 void config_init0(void);
 
+void config_begin(void);
+
+bool config_commit(void);
+
+void config_abort(void);
+
 bool config_set_lpwan_mac(const uint8_t *mac);
 
 void config_get_lpwan_mac(uint8_t *mac);
@@ -220,6 +236,10 @@ bool config_set_lte_modem_enable_on_boot (bool lte_modem_en_on_boot);
 
 bool config_get_lte_modem_enable_on_boot (void);
 
+bool config_set_init_on_boot (uint8_t init_on_boot);
+
+uint8_t config_get_init_on_boot (void);
+
 bool config_set_pybytes_autostart (bool pybytes_autostart);
 
 bool config_get_pybytes_autostart (void);
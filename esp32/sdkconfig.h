@@ -86,7 +86,7 @@
 #define CONFIG_TCPIP_TASK_AFFINITY_CPU0 1
 #define CONFIG_FATFS_CODEPAGE 437
 #define CONFIG_ESP32_DEFAULT_CPU_FREQ_160 1
-#define CONFIG_ULP_COPROC_RESERVE_MEM 0
+#define CONFIG_ULP_COPROC_RESERVE_MEM 512
 #define CONFIG_SECURE_SIGNED_APPS 1
 #define CONFIG_LWIP_MAX_UDP_PCBS 16
 #define CONFIG_ESPTOOLPY_BAUD 921600
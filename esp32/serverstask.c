@@ -23,6 +23,7 @@
 #include "modusocket.h"
 #include "mpexception.h"
 #include "modnetwork.h"
+#include "mptaskmon.h"
 
 #include "lwip/sockets.h"
 #include "lwip/dns.h"
@@ -46,10 +47,16 @@ typedef struct {
  ******************************************************************************/
 static volatile servers_data_t servers_data = {.timeout = SERVERS_DEF_TIMEOUT_MS};
 static volatile bool sleep_sockets = false;
+// loopback datagram socket used by the other tasks to interrupt the servers select()
+static int32_t servers_wakeup_sd = -1;
+static struct sockaddr_in servers_wakeup_addr;
+static volatile bool servers_wakeup_pending = false;
 
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
+static void servers_create_wakeup_socket (void);
+static void servers_wait_for_events (void);
 
 /******************************************************************************
  DECLARE PUBLIC DATA
@@ -61,15 +68,16 @@ extern TaskHandle_t svTaskHandle;
  DECLARE PUBLIC FUNCTIONS
  ******************************************************************************/
 void TASK_Servers (void *pvParameters) {
-    bool cycle = false;
-
     strcpy (servers_user, SERVERS_DEF_USER);
     strcpy (servers_pass, SERVERS_DEF_PASS);
 
     telnet_init();
     ftp_init();
+    servers_create_wakeup_socket();
+    mptaskmon_register(E_MPTASKMON_SERVERS, SERVERS_HEALTH_DEADLINE_MS);
 
     for ( ; ; ) {
+        mptaskmon_beat(E_MPTASKMON_SERVERS);
 
         if (servers_data.do_enable) {
             // enable network services
@@ -99,11 +107,8 @@ void TASK_Servers (void *pvParameters) {
             modusocket_close_all_user_sockets();
         }
 
-        if (cycle) {
-            telnet_run();
-        } else {
-            ftp_run();
-        }
+        telnet_run();
+        ftp_run();
 
         if (sleep_sockets) {
 //            pybwdt_srv_sleeping(true);  //  FIXME
@@ -124,14 +129,15 @@ void TASK_Servers (void *pvParameters) {
             mp_hal_reset_safe_and_boot(true);
         }
 
-        // move to the next cycle
-        cycle = cycle ? false : true;
-        vTaskDelay (SERVERS_CYCLE_TIME_MS / portTICK_PERIOD_MS);
+        // sleep until one of the server sockets needs attention
+        mptaskmon_idle(E_MPTASKMON_SERVERS);
+        servers_wait_for_events();
     }
 }
 
 void servers_start (void) {
     servers_data.do_enable = true;
+    servers_wakeup();
     mp_hal_delay_ms(SERVERS_CYCLE_TIME_MS * 3);
 }
 
@@ -149,6 +155,7 @@ void servers_stop (void) {
     else
     {
         servers_data.do_disable = true;
+        servers_wakeup();
         do {
             mp_hal_delay_ms(SERVERS_CYCLE_TIME_MS);
         } while (servers_are_enabled());
@@ -158,14 +165,17 @@ void servers_stop (void) {
 
 void servers_reset (void) {
     servers_data.do_reset = true;
+    servers_wakeup();
 }
 
 void servers_wlan_cycle_power (void) {
     servers_data.do_wlan_cycle_power = true;
+    servers_wakeup();
 }
 
 void servers_reset_and_safe_boot (void) {
     servers_data.reset_and_safe_boot = true;
+    servers_wakeup();
 }
 
 bool servers_are_enabled (void) {
@@ -174,6 +184,7 @@ bool servers_are_enabled (void) {
 
 void server_sleep_sockets (void) {
     sleep_sockets = true;
+    servers_wakeup();
     mp_hal_delay_ms(SERVERS_CYCLE_TIME_MS + 1);
 }
 
@@ -205,6 +216,81 @@ uint32_t servers_get_timeout (void) {
     return servers_data.timeout;
 }
 
+void servers_wakeup (void) {
+    // one datagram is enough until the servers task has seen it
+    if (servers_wakeup_sd > 0 && !servers_wakeup_pending) {
+        servers_wakeup_pending = true;
+        uint8_t dummy = 0;
+        if (sendto(servers_wakeup_sd, &dummy, sizeof(dummy), 0, (struct sockaddr *)&servers_wakeup_addr, sizeof(servers_wakeup_addr)) <= 0) {
+            servers_wakeup_pending = false;
+        }
+    }
+}
+
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
+static void servers_create_wakeup_socket (void) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    int32_t sd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sd > 0) {
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_len = sizeof(addr);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        // bind to any free port and read back which one it is
+        if (!bind(sd, (const struct sockaddr *)&addr, sizeof(addr)) &&
+            !getsockname(sd, (struct sockaddr *)&servers_wakeup_addr, &addr_len)) {
+            uint32_t option = fcntl(sd, F_GETFL, 0);
+            option |= O_NONBLOCK;
+            fcntl(sd, F_SETFL, option);
+            servers_wakeup_sd = sd;
+            return;
+        }
+        closesocket(sd);
+    }
+}
+
+static void servers_wait_for_events (void) {
+    fd_set rfds;
+    fd_set wfds;
+    uint32_t timeout_ms = SERVERS_WAIT_FOREVER;
+    int32_t maxfd = -1;
+
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+
+    if (servers_data.do_enable || servers_data.do_disable || servers_data.do_reset || sleep_sockets || servers_data.reset_and_safe_boot) {
+        // there's a request pending already
+        return;
+    }
+
+    maxfd = MAX(maxfd, telnet_select_fds(&rfds, &wfds, &timeout_ms));
+    maxfd = MAX(maxfd, ftp_select_fds(&rfds, &wfds, &timeout_ms));
+
+    if (servers_wakeup_sd > 0) {
+        FD_SET(servers_wakeup_sd, &rfds);
+        maxfd = MAX(maxfd, servers_wakeup_sd);
+    } else {
+        // nobody can wake us up, fall back to polling
+        timeout_ms = MIN(timeout_ms, SERVERS_CYCLE_TIME_MS);
+    }
+
+    if (maxfd < 0) {
+        vTaskDelay (MAX(1, MIN(timeout_ms, SERVERS_IDLE_CHECK_MS) / portTICK_PERIOD_MS));
+        return;
+    }
+
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    select(maxfd + 1, &rfds, &wfds, NULL, (timeout_ms == SERVERS_WAIT_FOREVER) ? NULL : &tv);
+
+    if (servers_wakeup_sd > 0 && FD_ISSET(servers_wakeup_sd, &rfds)) {
+        // clear the flag before draining, so that a request made from now on sends a new datagram
+        servers_wakeup_pending = false;
+        uint8_t dummy[8];
+        while (recv(servers_wakeup_sd, dummy, sizeof(dummy), 0) > 0);
+    }
+}
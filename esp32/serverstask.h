@@ -23,6 +23,9 @@
 #define SERVERS_USER_PASS_LEN_MAX                   32
 
 #define SERVERS_CYCLE_TIME_MS                       2
+#define SERVERS_HEALTH_DEADLINE_MS                  (2000)      // from waking up to waiting again
+#define SERVERS_IDLE_CHECK_MS                       1000          // wake up period while clients are connected
+#define SERVERS_WAIT_FOREVER                        UINT32_MAX
 
 #define SERVERS_DEF_USER                            "micro"
 #define SERVERS_DEF_PASS                            "python"
@@ -54,5 +57,6 @@ extern void servers_set_login (char *user, char *pass);
 extern void server_sleep_sockets (void);
 extern void servers_set_timeout (uint32_t timeout);
 extern uint32_t servers_get_timeout (void);
+extern void servers_wakeup (void);
 
 #endif /* SERVERSTASK_H_ */
@@ -157,6 +157,7 @@ extern sigfox_obj_t sigfox_obj;
  DECLARE FUNCTIONS
  ******************************************************************************/
 extern void modsigfox_init0 (void);
+extern void modsigfox_async_deinit0 (void);
 extern void sigfox_update_id (void);
 extern void sigfox_update_pac (void);
 extern void sigfox_update_private_key (void);
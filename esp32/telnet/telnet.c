@@ -36,18 +36,18 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/ringbuf.h"
 
 /******************************************************************************
  DEFINE PRIVATE CONSTANTS
  ******************************************************************************/
 #define TELNET_PORT                         23
-// rxRindex and rxWindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256
-#define TELNET_RX_BUFFER_SIZE               256
+#define TELNET_RX_BUFFER_SIZE               1024        // must be a power of 2
+#define TELNET_TX_RING_SIZE                 4096        // output queued by the interpreter
+#define TELNET_TX_CHUNK_SIZE                512         // taken from the ring on every send
 #define TELNET_MAX_CLIENTS                  1
 #define TELNET_TX_RETRIES_MAX               50
-#define TELNET_WAIT_TIME_MS                 2
 #define TELNET_LOGIN_RETRIES_MAX            3
-#define TELNET_CYCLE_TIME_MS                (SERVERS_CYCLE_TIME_MS * 2)
 
 #define SE 240
 #define AYT 246
@@ -100,15 +100,22 @@ typedef union {
 
 typedef struct {
     uint8_t             *rxBuffer;
-    uint32_t            timeout;
+    uint8_t             *txBuffer;
+    RingbufHandle_t     txRing;
+    uint32_t            txLen;
+    uint32_t            txOffset;
+    uint32_t            txDropped;
+    volatile bool       txQueued;   // set by the producers, cleared before draining the ring
+    uint32_t            timeout;    // ms without any input from the client
+    uint32_t            lastRun;
     telnet_state_t      state;
     telnet_substate_t   substate;
     int32_t             sd;
     int32_t             n_sd;
 
-    // rxRindex and rxWindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256
-    uint8_t             rxWindex;
-    uint8_t             rxRindex;
+    // always kept within [0, TELNET_RX_BUFFER_SIZE)
+    uint16_t            rxWindex;
+    uint16_t            rxRindex;
 
     // used to store incoming chars in cases the reception needs to be
     // completed later
@@ -143,10 +150,12 @@ static void telnet_wait_for_connection (void);
 static void telnet_send_and_proceed (void *data, int32_t Len, telnet_connected_substate_t next_state);
 static telnet_result_t telnet_send_non_blocking (void *data, int32_t Len);
 static telnet_result_t telnet_recv_text_non_blocking (void *buff, int32_t Maxlen, int32_t *rxLen);
+static int32_t telnet_rx_space (void);
 static void telnet_process (void);
 static int telnet_process_credential (char *credential, int32_t rxLen);
 static void telnet_parse_input (uint8_t *str, int32_t *len);
-static bool telnet_send_with_retries (int32_t sd, const void *pBuf, int32_t len);
+static void telnet_send_from_ring (void);
+static void telnet_flush_ring (void);
 static void telnet_reset_buffer (void);
 
 /******************************************************************************
@@ -155,11 +164,22 @@ static void telnet_reset_buffer (void);
 void telnet_init (void) {
     // allocate memory for the receive buffer (from the RTOS heap)
     telnet_data.rxBuffer = heap_caps_malloc(TELNET_RX_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    telnet_data.txBuffer = heap_caps_malloc(TELNET_TX_CHUNK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    // the interpreter only queues its output, the servers task sends it
+    telnet_data.txRing = xRingbufferCreate(TELNET_TX_RING_SIZE, RINGBUF_TYPE_BYTEBUF);
+    telnet_data.txLen = 0;
+    telnet_data.txOffset = 0;
+    telnet_data.txDropped = 0;
     telnet_data.state = E_TELNET_STE_DISABLED;
 }
 
 void telnet_run (void) {
     int32_t rxLen;
+    // the servers task sleeps until something happens, so count real time
+    uint32_t now = mp_hal_ticks_ms();
+    uint32_t elapsed = (telnet_data.state >= E_TELNET_STE_CONNECTED) ? (now - telnet_data.lastRun) : 0;
+    telnet_data.lastRun = now;
+
     switch (telnet_data.state) {
         case E_TELNET_STE_DISABLED:
             telnet_wait_for_enabled();
@@ -245,24 +265,87 @@ void telnet_run (void) {
             break;
         case E_TELNET_STE_LOGGED_IN:
             telnet_process();
+            if (telnet_data.state == E_TELNET_STE_LOGGED_IN) {
+                telnet_send_from_ring();
+            }
             break;
         default:
             break;
     }
 
     if (telnet_data.state >= E_TELNET_STE_CONNECTED) {
-        if (telnet_data.timeout++ > (servers_get_timeout() / TELNET_CYCLE_TIME_MS)) {
+        telnet_data.timeout += elapsed;
+        if (telnet_data.timeout > servers_get_timeout()) {
             telnet_reset();
         }
     }
 }
 
 void telnet_tx_strn (const char *str, int len) {
-    if (telnet_data.n_sd > 0 && telnet_data.state == E_TELNET_STE_LOGGED_IN && len > 0) {
-        telnet_send_with_retries(telnet_data.n_sd, str, len);
+    if (telnet_data.n_sd > 0 && telnet_data.state == E_TELNET_STE_LOGGED_IN && len > 0 && telnet_data.txRing) {
+        // never wait for the client, what doesn't fit in the ring is dropped
+        size_t free = xRingbufferGetCurFreeSize(telnet_data.txRing);
+        if (len > free) {
+            telnet_data.txDropped += len - free;
+            len = free;
+        }
+        if (len > 0) {
+            if (xRingbufferSend(telnet_data.txRing, str, len, 0) == pdTRUE) {
+                telnet_data.txQueued = true;
+                servers_wakeup();
+            } else {
+                telnet_data.txDropped += len;
+            }
+        }
     }
 }
 
+int32_t telnet_select_fds (fd_set *rfds, fd_set *wfds, uint32_t *timeout_ms) {
+    int32_t sd = -1;
+    switch (telnet_data.state) {
+        case E_TELNET_STE_DISABLED:
+            if (telnet_data.enabled) {
+                *timeout_ms = MIN(*timeout_ms, SERVERS_CYCLE_TIME_MS);
+            }
+            return -1;
+        case E_TELNET_STE_START:
+            // retry creating the socket
+            *timeout_ms = MIN(*timeout_ms, SERVERS_CYCLE_TIME_MS);
+            return -1;
+        case E_TELNET_STE_LISTEN:
+            if (telnet_data.sd > 0) {
+                FD_SET(telnet_data.sd, rfds);
+            }
+            return telnet_data.sd;
+        case E_TELNET_STE_CONNECTED:
+            sd = telnet_data.n_sd;
+            if (telnet_data.substate.connected == E_TELNET_STE_SUB_GET_USER ||
+                telnet_data.substate.connected == E_TELNET_STE_SUB_GET_PASSWORD) {
+                FD_SET(sd, rfds);
+            } else {
+                FD_SET(sd, wfds);
+            }
+            break;
+        case E_TELNET_STE_LOGGED_IN:
+            sd = telnet_data.n_sd;
+            if (telnet_rx_space() <= 0) {
+                // the buffer is full, check again once the interpreter has read from it
+                *timeout_ms = MIN(*timeout_ms, SERVERS_CYCLE_TIME_MS);
+            } else {
+                FD_SET(sd, rfds);
+            }
+            if (telnet_data.txOffset < telnet_data.txLen || telnet_data.txQueued) {
+                FD_SET(sd, wfds);
+            }
+            break;
+        default:
+            return -1;
+    }
+    // the idle timeout must still be checked
+    *timeout_ms = MIN(*timeout_ms, SERVERS_IDLE_CHECK_MS);
+    return sd;
+}
+
 bool telnet_rx_any (void) {
     return (telnet_data.n_sd > 0) ? (telnet_data.rxRindex != telnet_data.rxWindex &&
             telnet_data.state == E_TELNET_STE_LOGGED_IN) : false;
@@ -271,8 +354,8 @@ bool telnet_rx_any (void) {
 int telnet_rx_char (void) {
     int rx_char = -1;
     if (telnet_data.rxRindex != telnet_data.rxWindex) {
-        // rxRindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256 so that it wraps around automatically
-        rx_char = (int)telnet_data.rxBuffer[telnet_data.rxRindex++];
+        rx_char = (int)telnet_data.rxBuffer[telnet_data.rxRindex];
+        telnet_data.rxRindex = (telnet_data.rxRindex + 1) & (TELNET_RX_BUFFER_SIZE - 1);
     }
     return rx_char;
 }
@@ -291,6 +374,7 @@ void telnet_reset (void) {
     // close the connection and start all over again
     servers_close_socket(&telnet_data.n_sd);
     servers_close_socket(&telnet_data.sd);
+    telnet_flush_ring();
     telnet_data.state = E_TELNET_STE_START;
 }
 
@@ -424,17 +508,21 @@ static telnet_result_t telnet_recv_text_non_blocking (void *buff, int32_t Maxlen
     return E_TELNET_RESULT_AGAIN;
 }
 
-static void telnet_process (void) {
-    int32_t rxLen;
+static int32_t telnet_rx_space (void) {
+    // contiguous space available at rxWindex
     int32_t maxLen = (telnet_data.rxWindex >= telnet_data.rxRindex) ? (TELNET_RX_BUFFER_SIZE - telnet_data.rxWindex) :
                                                                    ((telnet_data.rxRindex - telnet_data.rxWindex) - 1);
     // to avoid an overrrun
-    maxLen = (telnet_data.rxRindex == 0) ? (maxLen - 1) : maxLen;
+    return (telnet_data.rxRindex == 0) ? (maxLen - 1) : maxLen;
+}
+
+static void telnet_process (void) {
+    int32_t rxLen;
+    int32_t maxLen = telnet_rx_space();
 
     if (maxLen > 0) {
         if (E_TELNET_RESULT_OK == telnet_recv_text_non_blocking(&telnet_data.rxBuffer[telnet_data.rxWindex], maxLen, &rxLen)) {
-            // rxWindex must be uint8_t and TELNET_RX_BUFFER_SIZE == 256 so that it wraps around automatically
-            telnet_data.rxWindex = telnet_data.rxWindex + rxLen;
+            telnet_data.rxWindex = (telnet_data.rxWindex + rxLen) & (TELNET_RX_BUFFER_SIZE - 1);
         }
     }
 }
@@ -551,31 +639,45 @@ static void telnet_parse_input (uint8_t *str, int32_t *len) {
     }
 }
 
-static bool telnet_send_with_retries (int32_t sd, const void *pBuf, int32_t len) {
-    int32_t retries = 0;
-    uint32_t delay = TELNET_WAIT_TIME_MS;
-
-    do {
-        // make it blocking
-        uint32_t option = fcntl(sd, F_GETFL, 0);
-        option &= ~O_NONBLOCK;
-        fcntl(sd, F_SETFL, option);
-        if (send(sd, pBuf, len, 0) > 0) {
-            // make it non-blocking again
-            option |= O_NONBLOCK;
-            fcntl(sd, F_SETFL, option);
-            return true;
-        } else if (EAGAIN != errno) {
-            // make it non-blocking again
-            option |= O_NONBLOCK;
-            fcntl(sd, F_SETFL, option);
-            return false;
+static void telnet_send_from_ring (void) {
+    // send as much as the socket takes without blocking, the rest goes in the next cycle
+    while (true) {
+        if (telnet_data.txOffset == telnet_data.txLen) {
+            size_t size;
+            telnet_data.txQueued = false;
+            uint8_t *data = xRingbufferReceiveUpTo(telnet_data.txRing, &size, 0, TELNET_TX_CHUNK_SIZE);
+            if (data == NULL) {
+                return;
+            }
+            telnet_data.txQueued = true;
+            memcpy(telnet_data.txBuffer, data, size);
+            vRingbufferReturnItem(telnet_data.txRing, data);
+            telnet_data.txLen = size;
+            telnet_data.txOffset = 0;
+        }
+        int32_t sent = send(telnet_data.n_sd, telnet_data.txBuffer + telnet_data.txOffset, telnet_data.txLen - telnet_data.txOffset, 0);
+        if (sent > 0) {
+            telnet_data.txOffset += sent;
+        } else if (errno == EAGAIN) {
+            return;
+        } else {
+            // error
+            telnet_reset();
+            return;
         }
-        // start with the default delay and increment it on each retry
-        mp_hal_delay_ms(delay++);
-    } while (++retries <= TELNET_TX_RETRIES_MAX);
+    }
+}
 
-    return false;
+static void telnet_flush_ring (void) {
+    size_t size;
+    uint8_t *data;
+    if (telnet_data.txRing) {
+        while ((data = xRingbufferReceiveUpTo(telnet_data.txRing, &size, 0, TELNET_TX_RING_SIZE)) != NULL) {
+            vRingbufferReturnItem(telnet_data.txRing, data);
+        }
+    }
+    telnet_data.txLen = 0;
+    telnet_data.txOffset = 0;
 }
 
 static void telnet_reset_buffer (void) {
@@ -10,6 +10,8 @@
 #ifndef TELNET_H_
 #define TELNET_H_
 
+#include "lwip/sockets.h"
+
 /******************************************************************************
  DECLARE EXPORTED FUNCTIONS
  ******************************************************************************/
@@ -21,5 +23,6 @@ extern int  telnet_rx_char (void);
 extern void telnet_enable (void);
 extern void telnet_disable (void);
 extern void telnet_reset (void);
+extern int32_t telnet_select_fds (fd_set *rfds, fd_set *wfds, uint32_t *timeout_ms);
 
 #endif /* TELNET_H_ */
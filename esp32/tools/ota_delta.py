@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2020, Pycom Limited.
+#
+# This software is licensed under the GNU GPL version 3 or any
+# later version, with permitted additional terms. For more information
+# see the Pycom Licence v1.0 document supplied with this file, or
+# available at https://www.pycom.io/opensource/licensing
+#
+
+"""
+Builds the OTA payloads accepted by pycom.ota_start(format=...):
+
+  ota_delta.py --zlib new.bin out.bin                 compressed image   (pycom.OTA_ZLIB)
+  ota_delta.py --old old.bin new.bin out.bin          delta patch        (pycom.OTA_DELTA)
+  ota_delta.py --zlib --old old.bin new.bin out.bin   compressed patch   (pycom.OTA_ZLIB | pycom.OTA_DELTA)
+
+old.bin must be the exact image running on the device. The zlib window is kept
+small (--wbits) as the device has to hold it in RAM while inflating.
+"""
+
+import argparse
+import struct
+import zlib
+
+MAGIC = b'PYD1'
+OP_COPY = 0
+OP_INSERT = 1
+OP_ADD = 2
+BLOCK = 32
+# shorter matches cost more as an op than what they save
+MIN_MATCH = 64
+
+
+def diff(old, new):
+    index = {}
+    for i in range(0, len(old) - BLOCK + 1, BLOCK):
+        index.setdefault(old[i:i + BLOCK], i)
+
+    out = [MAGIC + struct.pack('<II', len(old), zlib.crc32(old) & 0xffffffff)]
+    shift = 0      # new offset - old offset of the last match
+    pos = 0
+    lit = 0
+
+    def flush_literal(end):
+        if end == lit:
+            return
+        data = new[lit:end]
+        src = lit - shift
+        if 0 <= src and src + len(data) <= len(old):
+            # moved code mostly differs in a few address bytes, the differences compress well
+            add = bytes((d - old[src + i]) & 0xff for i, d in enumerate(data))
+            out.append(struct.pack('<BII', OP_ADD, len(data), src) + add)
+        else:
+            out.append(struct.pack('<BI', OP_INSERT, len(data)) + data)
+
+    while pos + BLOCK <= len(new):
+        src = index.get(new[pos:pos + BLOCK])
+        if src is None:
+            pos += 1
+            continue
+        # extend the match both ways
+        start, sstart = pos, src
+        while start > lit and sstart > 0 and new[start - 1] == old[sstart - 1]:
+            start -= 1
+            sstart -= 1
+        end, send = pos + BLOCK, src + BLOCK
+        while end < len(new) and send < len(old) and new[end] == old[send]:
+            end += 1
+            send += 1
+        if end - start < MIN_MATCH:
+            pos += 1
+            continue
+        flush_literal(start)
+        out.append(struct.pack('<BII', OP_COPY, end - start, sstart))
+        shift = start - sstart
+        pos = lit = end
+    flush_literal(len(new))
+    return b''.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build compressed and/or delta OTA payloads')
+    parser.add_argument('--old', help='image running on the device, builds a delta patch against it')
+    parser.add_argument('--zlib', action='store_true', help='compress the payload')
+    parser.add_argument('--wbits', type=int, default=12, help='zlib window bits (9..15)')
+    parser.add_argument('new', help='new application image')
+    parser.add_argument('out', help='payload to send to pycom.ota_write()')
+    args = parser.parse_args()
+
+    with open(args.new, 'rb') as f:
+        payload = f.read()
+    size = len(payload)
+    if args.old:
+        with open(args.old, 'rb') as f:
+            payload = diff(f.read(), payload)
+    if args.zlib:
+        comp = zlib.compressobj(9, zlib.DEFLATED, args.wbits)
+        payload = comp.compress(payload) + comp.flush()
+
+    with open(args.out, 'wb') as f:
+        f.write(payload)
+    print('%d bytes -> %d bytes (%.1f%%)' % (size, len(payload), 100.0 * len(payload) / size))
+
+
+if __name__ == '__main__':
+    main()
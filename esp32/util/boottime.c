@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_timer.h"
+#include "soc/rtc_cntl_reg.h"
+
+#include "boottime.h"
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static uint32_t boottime_bootloader_us;
+// only the first hard reset run is recorded, a soft reset keeps the values
+static uint32_t boottime_phases[E_BOOTTIME_NUM_PHASES];
+
+static const char *boottime_phase_names[E_BOOTTIME_NUM_PHASES] = {
+    "bootloader",
+    "app_main",
+    "mp_task",
+    "gc_init",
+    "mp_init",
+    "modules_init",
+    "fs_mount",
+    "_boot.py",
+    "boot.py",
+    "_main.py",
+    "main.py",
+};
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void boottime_init0(void) {
+    uint32_t reg = REG_READ(BOOTTIME_BOOTLOADER_REG);
+    if ((reg & BOOTTIME_BOOTLOADER_TAG_MASK) == BOOTTIME_BOOTLOADER_TAG) {
+        boottime_bootloader_us = reg & BOOTTIME_BOOTLOADER_US_MASK;
+        boottime_phases[E_BOOTTIME_BOOTLOADER] = boottime_bootloader_us;
+    }
+    // consumed, the next reset must not report it again if the bootloader doesn't write it
+    REG_WRITE(BOOTTIME_BOOTLOADER_REG, 0);
+    boottime_mark(E_BOOTTIME_APP_MAIN);
+}
+
+void boottime_mark(boottime_phase_t phase) {
+    if (phase < E_BOOTTIME_NUM_PHASES && boottime_phases[phase] == 0) {
+        // the esp_timer starts counting while the application starts, after the bootloader is done
+        boottime_phases[phase] = boottime_bootloader_us + (uint32_t)esp_timer_get_time();
+    }
+}
+
+uint32_t boottime_get(boottime_phase_t phase) {
+    if (phase < E_BOOTTIME_NUM_PHASES) {
+        return boottime_phases[phase];
+    }
+    return 0;
+}
+
+const char *boottime_phase_name(boottime_phase_t phase) {
+    if (phase < E_BOOTTIME_NUM_PHASES) {
+        return boottime_phase_names[phase];
+    }
+    return "";
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef ESP32_UTIL_BOOTTIME_H_
+#define ESP32_UTIL_BOOTTIME_H_
+
+#include <stdint.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// the bootloader leaves the time it took (ROM included) here, tagged so that a value
+// from an older bootloader is not mistaken for it
+#define BOOTTIME_BOOTLOADER_REG                 RTC_CNTL_STORE0_REG
+#define BOOTTIME_BOOTLOADER_TAG                 (0xB7000000)
+#define BOOTTIME_BOOTLOADER_TAG_MASK            (0xFF000000)
+#define BOOTTIME_BOOTLOADER_US_MASK             (0x00FFFFFF)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// in the order they are reached during a hard reset
+typedef enum {
+    E_BOOTTIME_BOOTLOADER = 0,      // bootloader jumps to the application
+    E_BOOTTIME_APP_MAIN,            // app_main() entered
+    E_BOOTTIME_MP_TASK,             // TASK_Micropython() entered
+    E_BOOTTIME_GC_INIT,             // GC pool allocated and initialized
+    E_BOOTTIME_MP_INIT,             // mp_init() done
+    E_BOOTTIME_MODULES_INIT,        // peripherals and radios initialized
+    E_BOOTTIME_FS_MOUNT,            // /flash mounted
+    E_BOOTTIME_FROZEN_BOOT_PY,      // _boot.py finished
+    E_BOOTTIME_BOOT_PY,             // boot.py finished
+    E_BOOTTIME_FROZEN_MAIN_PY,      // _main.py finished
+    E_BOOTTIME_MAIN_PY,             // main.py started
+    E_BOOTTIME_NUM_PHASES
+} boottime_phase_t;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+extern void boottime_init0(void);
+extern void boottime_mark(boottime_phase_t phase);
+// microseconds since reset, 0 if the phase wasn't reached (yet)
+extern uint32_t boottime_get(boottime_phase_t phase);
+extern const char *boottime_phase_name(boottime_phase_t phase);
+
+#endif /* ESP32_UTIL_BOOTTIME_H_ */
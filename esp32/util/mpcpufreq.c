@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "py/mpconfig.h"
+#include "py/mpstate.h"
+
+#include "sdkconfig.h"
+#include "rom/ets_sys.h"
+#include "soc/rtc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/xtensa_timer.h"
+#include "xtensa/core-macros.h"
+
+#include "mpcpufreq.h"
+#include "mpthreadport.h"
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+// frequency set with machine.freq(), kept across soft resets
+STATIC uint32_t mpcpufreq_base_mhz = 0;
+STATIC uint32_t mpcpufreq_cur_mhz = 0;
+STATIC bool mpcpufreq_auto_enable = false;
+STATIC uint32_t mpcpufreq_auto_min_mhz = MPCPUFREQ_MIN_MHZ;
+STATIC uint32_t mpcpufreq_auto_max_mhz = MPCPUFREQ_MAX_MHZ;
+// CPU heavy sections running (TLS handshakes), and waits at the low frequency
+STATIC uint32_t mpcpufreq_boosts = 0;
+STATIC uint32_t mpcpufreq_waits = 0;
+STATIC portMUX_TYPE mpcpufreq_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mpcpufreq_apply (void);
+STATIC void mpcpufreq_switch (uint32_t mhz);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void mpcpufreq_init0 (void) {
+    if (mpcpufreq_base_mhz == 0) {
+        mpcpufreq_base_mhz = mpcpufreq_cur_mhz = ets_get_cpu_frequency();
+    }
+    // the automatic mode doesn't survive a soft reset
+    portENTER_CRITICAL(&mpcpufreq_mux);
+    mpcpufreq_auto_enable = false;
+    mpcpufreq_boosts = 0;
+    mpcpufreq_waits = 0;
+    mpcpufreq_apply();
+    portEXIT_CRITICAL(&mpcpufreq_mux);
+}
+
+// only the PLL frequencies keep the APB clock at 80MHz, so UART baud rates, SPI
+// clocks, RMT dividers and the timers driving LoRa don't need to be retimed
+bool mpcpufreq_is_valid (uint32_t mhz) {
+    return mhz == 80 || mhz == 160 || mhz == 240;
+}
+
+void mpcpufreq_set (uint32_t mhz) {
+    portENTER_CRITICAL(&mpcpufreq_mux);
+    mpcpufreq_base_mhz = mhz;
+    mpcpufreq_apply();
+    portEXIT_CRITICAL(&mpcpufreq_mux);
+}
+
+uint32_t mpcpufreq_get (void) {
+    return mpcpufreq_cur_mhz;
+}
+
+void mpcpufreq_auto (bool enable, uint32_t min_mhz, uint32_t max_mhz) {
+    portENTER_CRITICAL(&mpcpufreq_mux);
+    mpcpufreq_auto_enable = enable;
+    mpcpufreq_auto_min_mhz = min_mhz;
+    mpcpufreq_auto_max_mhz = max_mhz;
+    mpcpufreq_apply();
+    portEXIT_CRITICAL(&mpcpufreq_mux);
+}
+
+bool mpcpufreq_auto_enabled (void) {
+    return mpcpufreq_auto_enable;
+}
+
+void mpcpufreq_boost_begin (void) {
+    portENTER_CRITICAL(&mpcpufreq_mux);
+    if (mpcpufreq_boosts++ == 0) {
+        mpcpufreq_apply();
+    }
+    portEXIT_CRITICAL(&mpcpufreq_mux);
+}
+
+void mpcpufreq_boost_end (void) {
+    portENTER_CRITICAL(&mpcpufreq_mux);
+    if (mpcpufreq_boosts > 0 && --mpcpufreq_boosts == 0) {
+        mpcpufreq_apply();
+    }
+    portEXIT_CRITICAL(&mpcpufreq_mux);
+}
+
+// drops to the low frequency for a wait of ms milliseconds, called with the GIL held so
+// that no other Python thread gets slowed down, true if mpcpufreq_wait_end() must follow
+bool mpcpufreq_wait_begin (uint32_t ms) {
+    if (!mpcpufreq_auto_enable || ms < MPCPUFREQ_WAIT_MIN_MS || !mp_thread_is_alone()) {
+        return false;
+    }
+    portENTER_CRITICAL(&mpcpufreq_mux);
+    mpcpufreq_waits++;
+    mpcpufreq_apply();
+    portEXIT_CRITICAL(&mpcpufreq_mux);
+    return true;
+}
+
+void mpcpufreq_wait_end (bool dropped) {
+    if (!dropped) {
+        return;
+    }
+    portENTER_CRITICAL(&mpcpufreq_mux);
+    if (mpcpufreq_waits > 0) {
+        mpcpufreq_waits--;
+    }
+    mpcpufreq_apply();
+    portEXIT_CRITICAL(&mpcpufreq_mux);
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// called inside mpcpufreq_mux
+STATIC void mpcpufreq_apply (void) {
+    uint32_t mhz = mpcpufreq_base_mhz;
+    if (mpcpufreq_auto_enable) {
+        if (mpcpufreq_boosts > 0) {
+            mhz = mpcpufreq_auto_max_mhz;
+        } else if (mpcpufreq_waits > 0) {
+            mhz = mpcpufreq_auto_min_mhz;
+        }
+    }
+    if (mhz != mpcpufreq_cur_mhz) {
+        mpcpufreq_switch(mhz);
+    }
+}
+
+STATIC void mpcpufreq_switch (uint32_t mhz) {
+    rtc_cpu_freq_config_t config;
+    if (!rtc_clk_cpu_freq_mhz_to_config(mhz, &config)) {
+        return;
+    }
+    // 240MHz comes from a different PLL frequency than 80 and 160MHz, the switch between
+    // them goes through the crystal for the few microseconds the PLL takes to relock
+    rtc_clk_cpu_freq_set_config(&config);
+    // ets_delay_us() of both cores
+    ets_update_cpu_frequency(mhz);
+    // the FreeRTOS tick counts CPU cycles, the other core picks the new divisor up
+    // at its next tick
+    _xt_tick_divisor = (mhz * 1000000) / XT_TICK_PER_SEC;
+    XTHAL_SET_CCOMPARE(XT_TIMER_INDEX, XTHAL_GET_CCOUNT() + _xt_tick_divisor);
+    mpcpufreq_cur_mhz = mhz;
+}
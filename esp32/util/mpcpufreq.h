@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MPCPUFREQ_H_
+#define MPCPUFREQ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MPCPUFREQ_MIN_MHZ                           (80)
+#define MPCPUFREQ_MAX_MHZ                           (240)
+// shorter waits are not worth the time spent relocking the PLL
+#define MPCPUFREQ_WAIT_MIN_MS                       (5)
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+void mpcpufreq_init0 (void);
+bool mpcpufreq_is_valid (uint32_t mhz);
+void mpcpufreq_set (uint32_t mhz);
+uint32_t mpcpufreq_get (void);
+void mpcpufreq_auto (bool enable, uint32_t min_mhz, uint32_t max_mhz);
+bool mpcpufreq_auto_enabled (void);
+void mpcpufreq_boost_begin (void);
+void mpcpufreq_boost_end (void);
+bool mpcpufreq_wait_begin (uint32_t ms);
+void mpcpufreq_wait_end (bool dropped);
+
+#endif /* MPCPUFREQ_H_ */
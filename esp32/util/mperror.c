@@ -34,7 +34,7 @@
 #include "freertos/semphr.h"
 #include "freertos/queue.h"
 
-#include "esp_freertos_hooks.h"
+#include "esp_timer.h"
 
 
 /******************************************************************************
@@ -45,8 +45,6 @@
 #define MPERROR_HEARTBEAT_ON_MS                     (80)
 #define MPERROR_HEARTBEAT_OFF_MS                    (3920)
 
-#define MPERROR_HEARTBEAT_PRIORITY                  (5)
-
 #define MPERROR_HEARTBEAT_LED_GPIO                  (0)
 /******************************************************************************
  DECLARE PRIVATE DATA
@@ -68,39 +66,51 @@ led_info_t led_info = {
 #endif
 
 struct mperror_heart_beat {
-    uint64_t off_time;
-    uint64_t on_time;
+    esp_timer_handle_t timer;
+    SemaphoreHandle_t mutex;
     bool beating;
     bool enabled;
-    bool do_disable;
+    bool led_ready;
 } mperror_heart_beat;
 
-static void disable_and_wait (void);
+static void mperror_heartbeat_start (void);
+static void mperror_heartbeat_stop (void);
+static void mperror_heartbeat_timer_cb (void *arg);
+static bool mperror_led_acquire (bool reconfigure);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
 void mperror_pre_init(void) {
+    const esp_timer_create_args_t timer_args = {
+        .callback = mperror_heartbeat_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "heartbeat"
+    };
     mperror_heart_beat.enabled = false;
-    esp_register_freertos_idle_hook(mperror_heartbeat_signal);
+    mperror_heart_beat.led_ready = false;
+    mperror_heart_beat.mutex = xSemaphoreCreateMutex();
+    esp_timer_create(&timer_args, &mperror_heart_beat.timer);
 }
 
 void mperror_init0 (void) {
+    mperror_heartbeat_stop();
     // configure the heartbeat led pin
     pin_config(&pin_GPIO0, -1, -1, GPIO_MODE_OUTPUT, MACHPIN_PULL_NONE, 0);
-    led_init(&led_info);
+    mperror_led_acquire(true);
     led_info.color.value = 0;
     led_set_color(&led_info, false, false);
-    mperror_heart_beat.on_time = 0;
-    mperror_heart_beat.off_time = 0;
-    mperror_heart_beat.beating = false;
-    mperror_heart_beat.enabled = (config_get_heartbeat_on_boot()) ? true : false;
-    mperror_heart_beat.do_disable = (config_get_heartbeat_on_boot()) ? false : true;
+    if (config_get_heartbeat_on_boot()) {
+        mperror_heartbeat_start();
+    }
 }
 
 void mperror_signal_error (void) {
     uint32_t count = 0;
     bool toggle = true;
+    mperror_heartbeat_stop();
+    mperror_led_acquire(false);
     while ((MPERROR_TOOGLE_MS * count++) < MPERROR_SIGNAL_ERROR_MS) {
         // toogle the led
         if (!toggle) {
@@ -108,7 +118,6 @@ void mperror_signal_error (void) {
         } else {
             led_info.color.value = 0;
         }
-        disable_and_wait();
         led_set_color(&led_info, false, false);
         toggle = ~toggle;
         mp_hal_delay_ms(MPERROR_TOOGLE_MS);
@@ -117,35 +126,9 @@ void mperror_signal_error (void) {
 
 void mperror_heartbeat_switch_off (void) {
     if (mperror_heart_beat.enabled) {
-        led_info.color.value = 0;
-        disable_and_wait();
-        led_set_color(&led_info, false, false);
-    }
-    mperror_heart_beat.on_time = 0;
-    mperror_heart_beat.off_time = 0;
-    mperror_heart_beat.beating = false;
-}
-
-bool mperror_heartbeat_signal (void) {
-    if (mperror_heart_beat.do_disable) {
-        mperror_heart_beat.do_disable = false;
-    } else if (mperror_heart_beat.enabled) {
-        if (!mperror_heart_beat.beating) {
-            if ((mperror_heart_beat.on_time = mp_hal_ticks_ms_non_blocking()) - mperror_heart_beat.off_time > MPERROR_HEARTBEAT_OFF_MS) {
-                led_info.color.value = MPERROR_HEARTBEAT_COLOR;
-                led_set_color(&led_info, false, false);
-                mperror_heart_beat.beating = true;
-            }
-        } else {
-            if ((mperror_heart_beat.off_time = mp_hal_ticks_ms_non_blocking()) - mperror_heart_beat.on_time > MPERROR_HEARTBEAT_ON_MS) {
-                led_info.color.value = 0;
-                led_set_color(&led_info, false, false);
-                mperror_heart_beat.beating = false;
-            }
-        }
+        mperror_heartbeat_stop();
+        mperror_heartbeat_start();
     }
-    // let the CPU save some power
-    return true;
 }
 
 #ifndef BOOTLOADER_BUILD
@@ -160,6 +143,9 @@ void NORETURN __fatal_error(const char *msg) {
     }
 #endif
     // signal the crash with the system led
+    esp_timer_stop(mperror_heart_beat.timer);
+    mperror_heart_beat.enabled = false;
+    mperror_led_acquire(false);
     led_info.color.value = MPERROR_FATAL_COLOR;
     led_set_color(&led_info, false, false);
     for ( ;; ); //{__WFI();}
@@ -184,19 +170,12 @@ void nlr_jump_fail(void *val) {
 
 void mperror_enable_heartbeat (bool enable) {
     if (enable && !mperror_heart_beat.enabled) {
-        mperror_heart_beat.enabled = true;
-        mperror_heart_beat.do_disable = false;
-        mperror_heart_beat.on_time = 0;
-        mperror_heart_beat.off_time = 0;
-        mperror_heart_beat.beating = false;
-        led_info.color.value = MPERROR_HEARTBEAT_COLOR;
+        mperror_heartbeat_stop();
         pin_config(&pin_GPIO0, -1, -1, GPIO_MODE_OUTPUT, MACHPIN_PULL_NONE, 0);
-        led_init(&led_info);
-        led_set_color(&led_info, false, false);
+        mperror_led_acquire(true);
+        mperror_heartbeat_start();
     } else if (!enable) {
-        led_info.color.value = 0;
-        disable_and_wait();
-        led_set_color(&led_info, false, false);
+        mperror_heartbeat_stop();
     }
 }
 
@@ -204,20 +183,83 @@ bool mperror_is_heartbeat_enabled (void) {
     return mperror_heart_beat.enabled;
 }
 
-bool mperror_heartbeat_disable_done (void) {
-    return mperror_heart_beat.do_disable == false;
+bool mperror_led_set_color (uint32_t color) {
+    if (!mperror_led_acquire(false)) {
+        return false;
+    }
+    led_info.color.value = color;
+    return led_set_color(&led_info, true, false);
+}
+
+void mperror_led_release (void) {
+    mperror_heartbeat_stop();
+    if (mperror_heart_beat.led_ready) {
+        led_info.color.value = 0;
+        led_set_color(&led_info, true, true);
+        rmt_deinit_rgb();
+        mperror_heart_beat.led_ready = false;
+    }
 }
 
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
 
-static void disable_and_wait (void) {
-    mperror_heart_beat.enabled = false;
-    mperror_heart_beat.do_disable = true;
-    while (!mperror_heartbeat_disable_done()) {
-        mp_hal_delay_ms(2);
+static void mperror_heartbeat_start (void) {
+    xSemaphoreTake(mperror_heart_beat.mutex, portMAX_DELAY);
+    if (!mperror_heart_beat.enabled && mperror_led_acquire(false)) {
+        mperror_heart_beat.enabled = true;
+        mperror_heart_beat.beating = false;
+        led_info.color.value = 0;
+        led_set_color(&led_info, false, false);
+        // the first beat comes right away, then the timer only fires on the led edges
+        esp_timer_start_once(mperror_heart_beat.timer, MPERROR_TOOGLE_MS * 1000);
+    }
+    xSemaphoreGive(mperror_heart_beat.mutex);
+}
+
+static void mperror_heartbeat_stop (void) {
+    // once the mutex is held the callback is either done or will see enabled == false
+    xSemaphoreTake(mperror_heart_beat.mutex, portMAX_DELAY);
+    esp_timer_stop(mperror_heart_beat.timer);
+    if (mperror_heart_beat.enabled) {
+        mperror_heart_beat.enabled = false;
+        mperror_heart_beat.beating = false;
+        led_info.color.value = 0;
+        led_set_color(&led_info, true, false);
+    }
+    xSemaphoreGive(mperror_heart_beat.mutex);
+}
+
+static void mperror_heartbeat_timer_cb (void *arg) {
+    xSemaphoreTake(mperror_heart_beat.mutex, portMAX_DELAY);
+    if (mperror_heart_beat.enabled) {
+        uint32_t next_ms;
+        if (!mperror_heart_beat.beating) {
+            led_info.color.value = MPERROR_HEARTBEAT_COLOR;
+            next_ms = MPERROR_HEARTBEAT_ON_MS;
+        } else {
+            led_info.color.value = 0;
+            next_ms = MPERROR_HEARTBEAT_OFF_MS;
+        }
+        // the RMT shifts the 24 bits out on its own, the CPU is only needed on the edges
+        led_set_color(&led_info, false, false);
+        mperror_heart_beat.beating = !mperror_heart_beat.beating;
+        esp_timer_start_once(mperror_heart_beat.timer, next_ms * 1000);
+    }
+    xSemaphoreGive(mperror_heart_beat.mutex);
+}
+
+static bool mperror_led_acquire (bool reconfigure) {
+    // pin_config() takes the pin away from the RMT, the channel must be set up again after it
+    if (reconfigure && mperror_heart_beat.led_ready) {
+        rmt_deinit_rgb();
+        mperror_heart_beat.led_ready = false;
+    }
+    if (!mperror_heart_beat.led_ready) {
+        mperror_heart_beat.led_ready = led_init(&led_info);
     }
+    return mperror_heart_beat.led_ready;
 }
 
 #else
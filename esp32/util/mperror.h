@@ -24,10 +24,10 @@ void mperror_bootloader_check_reset_cause (void);
 void mperror_deinit_sfe_pin (void);
 void mperror_signal_error (void);
 void mperror_heartbeat_switch_off (void);
-bool mperror_heartbeat_signal (void);
 void mperror_enable_heartbeat (bool enable);
 bool mperror_is_heartbeat_enabled (void);
-bool mperror_heartbeat_disable_done (void);
+bool mperror_led_set_color (uint32_t color);
+void mperror_led_release (void);
 void mperror_set_rgb_color(uint32_t rgbcolor);
 
 #endif // MPERROR_H_
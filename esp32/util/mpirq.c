@@ -7,18 +7,24 @@
  * available at https://www.pycom.io/opensource/licensing
  */
 
+#include <string.h>
+
 #include "py/mpconfig.h"
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #include "mpexception.h"
 #include "mperror.h"
 #include "mpirq.h"
 #include "mpthreadport.h"
+#include "mptrace.h"
+#include "mpmetrics.h"
 #include "py/stackctrl.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_attr.h"
 
 #if MICROPY_PY_THREAD
@@ -31,14 +37,105 @@ typedef struct {
 /******************************************************************************
  DECLARE PRIVATE DATA
  ******************************************************************************/
-STATIC QueueHandle_t InterruptsQueue;
+STATIC QueueHandle_t InterruptsQueue[MP_IRQ_PRIORITY_LEVELS];
+// counts the callbacks waiting in all the queues
+STATIC SemaphoreHandle_t InterruptsPending;
+STATIC mp_irq_stats_t mp_irq_stats[MP_IRQ_PRIORITY_LEVELS];
 STATIC bool mp_irq_is_alive;
 
+// the hard callbacks don't share the queues and the task of the others
+STATIC QueueHandle_t InterruptsHardQueue;
+STATIC bool mp_irq_hard_is_alive;
+// set while the hard task waits for the GIL, the holder then hands it over at its next check
+STATIC volatile bool mp_irq_hard_waiting;
+
+STATIC const uint32_t mp_irq_queue_len[MP_IRQ_PRIORITY_LEVELS] = {
+    INTERRUPTS_HIGH_QUEUE_LEN, INTERRUPTS_QUEUE_LEN, INTERRUPTS_LOW_QUEUE_LEN
+};
+
 STATIC mpirq_args_t mpirq_args;
 
+STATIC void mp_irq_metrics_collect (uint32_t *values);
+STATIC const mpmetrics_desc_t mp_irq_metrics[] = {
+    { "high_dispatched",    E_MPMETRICS_COUNTER },
+    { "high_dropped",       E_MPMETRICS_COUNTER },
+    { "normal_dispatched",  E_MPMETRICS_COUNTER },
+    { "normal_dropped",     E_MPMETRICS_COUNTER },
+    { "low_dispatched",     E_MPMETRICS_COUNTER },
+    { "low_dropped",        E_MPMETRICS_COUNTER },
+};
+STATIC mpmetrics_source_t mp_irq_metrics_source = {
+    .name = "irq",
+    .metrics = mp_irq_metrics,
+    .n_metrics = MP_ARRAY_SIZE(mp_irq_metrics),
+    .collect = mp_irq_metrics_collect,
+};
+
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
+// takes the next callback, highest level first, the pending count must have been taken
+STATIC void mp_irq_next(mp_callback_obj_t *cb) {
+    for (int prio = MP_IRQ_PRIORITY_HIGH; prio < MP_IRQ_PRIORITY_LEVELS; prio++) {
+        if (xQueueReceive(InterruptsQueue[prio], cb, 0) == pdTRUE) {
+            mp_irq_stats[prio].dispatched++;
+            return;
+        }
+    }
+    // can't happen, but makes the task exit instead of calling garbage
+    cb->handler = NULL;
+}
+
+STATIC IRAM_ATTR bool mp_irq_send(mp_callback_obj_t *cb, mp_irq_priority_t prio, bool from_isr) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    bool sent;
+
+    if (from_isr) {
+        sent = (xQueueSendFromISR(InterruptsQueue[prio], cb, &xHigherPriorityTaskWoken) == pdTRUE);
+        if (sent) {
+            xSemaphoreGiveFromISR(InterruptsPending, &xHigherPriorityTaskWoken);
+        }
+    } else {
+        sent = (xQueueSend(InterruptsQueue[prio], cb, 0) == pdTRUE);
+        if (sent) {
+            xSemaphoreGive(InterruptsPending);
+        }
+    }
+    if (!sent) {
+        mp_irq_stats[prio].dropped++;
+    }
+    MPTRACE(sent ? MPTRACE_IRQ_QUEUE : MPTRACE_IRQ_DROP, cb->handler, prio);
+
+    if (xHigherPriorityTaskWoken) {
+        portYIELD_FROM_ISR();
+    }
+    return sent;
+}
+
+STATIC IRAM_ATTR void mp_irq_send_hard(mp_callback_obj_t *cb, bool from_isr) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    bool sent;
+
+    if (from_isr) {
+        sent = (xQueueSendFromISR(InterruptsHardQueue, cb, &xHigherPriorityTaskWoken) == pdTRUE);
+    } else {
+        sent = (xQueueSend(InterruptsHardQueue, cb, 0) == pdTRUE);
+    }
+    MPTRACE(sent ? MPTRACE_IRQ_QUEUE : MPTRACE_IRQ_DROP, cb->handler, MP_IRQ_PRIORITY_HIGH);
+
+    if (xHigherPriorityTaskWoken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+STATIC void mp_irq_reset_queues(void) {
+    for (int prio = MP_IRQ_PRIORITY_HIGH; prio < MP_IRQ_PRIORITY_LEVELS; prio++) {
+        xQueueReset(InterruptsQueue[prio]);
+    }
+    while (xSemaphoreTake(InterruptsPending, 0) == pdTRUE);
+    xQueueReset(InterruptsHardQueue);
+}
+
 static void *TASK_Interrupts(void *pvParameters) {
     mpirq_args_t *args = (mpirq_args_t *)pvParameters;
 
@@ -49,6 +146,10 @@ static void *TASK_Interrupts(void *pvParameters) {
     mp_stack_set_top(&ts + 1); // need to include ts in root-pointer scan
     mp_stack_set_limit(INTERRUPTS_TASK_STACK_SIZE - 1024);
 
+    #if MICROPY_PROF_CODE
+    ts.prof_code = NULL;
+    #endif
+
     mp_locals_set(args->dict_locals);
     mp_globals_set(args->dict_globals);
 
@@ -58,7 +159,8 @@ static void *TASK_Interrupts(void *pvParameters) {
     MP_THREAD_GIL_EXIT();
 
     for (;;) {
-        xQueueReceive(InterruptsQueue, &cb, portMAX_DELAY);
+        xSemaphoreTake(InterruptsPending, portMAX_DELAY);
+        mp_irq_next(&cb);
 
         // a NULL handler means that we need to exit the loop
         if (NULL == cb.handler) {
@@ -69,9 +171,25 @@ static void *TASK_Interrupts(void *pvParameters) {
 
         nlr_buf_t nlr;
         if (nlr_push(&nlr) == 0) {
+            MPTRACE(MPTRACE_IRQ_DISPATCH_START, cb.handler, 0);
             cb.handler(cb.arg);
+            MPTRACE(MPTRACE_IRQ_DISPATCH_END, 0, 0);
+            // run what else is pending while holding the GIL
+            for (int i = 1; i < INTERRUPTS_BATCH_LEN && xSemaphoreTake(InterruptsPending, 0) == pdTRUE; i++) {
+                mp_irq_next(&cb);
+                if (NULL == cb.handler) {
+                    // put the exit request back
+                    xSemaphoreGive(InterruptsPending);
+                    xQueueSendToFront(InterruptsQueue[MP_IRQ_PRIORITY_HIGH], &cb, 0);
+                    break;
+                }
+                MPTRACE(MPTRACE_IRQ_DISPATCH_START, cb.handler, 0);
+                cb.handler(cb.arg);
+                MPTRACE(MPTRACE_IRQ_DISPATCH_END, 0, 0);
+            }
             nlr_pop();
         } else {
+            MPTRACE(MPTRACE_IRQ_DISPATCH_END, 0, 0);
             // uncaught exception, check for SystemExit
             mp_obj_base_t *exc = (mp_obj_base_t*)nlr.ret_val;
             if (mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(exc->type), MP_OBJ_FROM_PTR(&mp_type_SystemExit))) {
@@ -98,11 +216,82 @@ static void *TASK_Interrupts(void *pvParameters) {
     return NULL;
 }
 
+// one callback per GIL acquisition, run with the heap locked so that it can't allocate
+// nor start a collection, a MemoryError is raised instead
+static void *TASK_HardInterrupts(void *pvParameters) {
+    mpirq_args_t *args = (mpirq_args_t *)pvParameters;
+
+    mp_callback_obj_t cb;
+    mp_state_thread_t ts;
+    mp_thread_set_state(&ts);
+
+    mp_stack_set_top(&ts + 1); // need to include ts in root-pointer scan
+    mp_stack_set_limit(INTERRUPTS_HARD_TASK_STACK_SIZE - 1024);
+
+    #if MICROPY_PROF_CODE
+    ts.prof_code = NULL;
+    #endif
+
+    mp_locals_set(args->dict_locals);
+    mp_globals_set(args->dict_globals);
+
+    MP_THREAD_GIL_ENTER();
+    mp_thread_start();
+    MP_THREAD_GIL_EXIT();
+
+    for (;;) {
+        xQueueReceive(InterruptsHardQueue, &cb, portMAX_DELAY);
+
+        // a NULL handler means that we need to exit the loop
+        if (NULL == cb.handler) {
+            break;
+        }
+
+        mp_irq_hard_waiting = true;
+        MP_THREAD_GIL_ENTER();
+        mp_irq_hard_waiting = false;
+        gc_lock();
+
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            MPTRACE(MPTRACE_IRQ_DISPATCH_START, cb.handler, 0);
+            cb.handler(cb.arg);
+            MPTRACE(MPTRACE_IRQ_DISPATCH_END, 0, 0);
+            nlr_pop();
+        } else {
+            MPTRACE(MPTRACE_IRQ_DISPATCH_END, 0, 0);
+            // the exception lives in the emergency buffer, printing it doesn't allocate either
+            mp_obj_base_t *exc = (mp_obj_base_t*)nlr.ret_val;
+            if (!mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(exc->type), MP_OBJ_FROM_PTR(&mp_type_SystemExit))) {
+                mp_printf(&mp_plat_print, "Unhandled exception in hard callback handler\n");
+                mp_obj_print_exception(&mp_plat_print, MP_OBJ_FROM_PTR(exc));
+            }
+        }
+
+        gc_unlock();
+        MP_THREAD_GIL_EXIT();
+    }
+
+    MP_THREAD_GIL_ENTER();
+    mp_thread_finish();
+    MP_THREAD_GIL_EXIT();
+
+    mp_irq_hard_is_alive = false;
+
+    return NULL;
+}
+
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
  ******************************************************************************/
 void mp_irq_preinit(void) {
-    InterruptsQueue = xQueueCreate(INTERRUPTS_QUEUE_LEN, sizeof(mp_callback_obj_t));
+    uint32_t total = 0;
+    for (int prio = MP_IRQ_PRIORITY_HIGH; prio < MP_IRQ_PRIORITY_LEVELS; prio++) {
+        InterruptsQueue[prio] = xQueueCreate(mp_irq_queue_len[prio], sizeof(mp_callback_obj_t));
+        total += mp_irq_queue_len[prio];
+    }
+    InterruptsPending = xSemaphoreCreateCounting(total, 0);
+    InterruptsHardQueue = xQueueCreate(INTERRUPTS_HARD_QUEUE_LEN, sizeof(mp_callback_obj_t));
 }
 
 void mp_irq_init0(void) {
@@ -112,12 +301,22 @@ void mp_irq_init0(void) {
     mp_obj_list_init(&MP_STATE_PORT(mp_irq_obj_list), 0);
 
     mp_irq_is_alive = true;
-    xQueueReset(InterruptsQueue);
+    mp_irq_reset_queues();
+    memset(mp_irq_stats, 0, sizeof(mp_irq_stats));
+    mpmetrics_register(&mp_irq_metrics_source);
 
     mpirq_args.dict_locals = mp_locals_get();
     mpirq_args.dict_globals = mp_globals_get();
 
-    mp_thread_create_ex(TASK_Interrupts, &mpirq_args, &stack_size, INTERRUPTS_TASK_PRIORITY, "IRQs");
+    mp_thread_create_ex(TASK_Interrupts, &mpirq_args, &stack_size, INTERRUPTS_TASK_PRIORITY, "IRQs", 1);
+
+    // mp_init() has dropped the previous one, the hard callbacks can't raise without it
+    mp_alloc_emergency_exception_buf(MP_OBJ_NEW_SMALL_INT(INTERRUPTS_EMERGENCY_BUF_SIZE));
+
+    stack_size = INTERRUPTS_HARD_TASK_STACK_SIZE;
+    mp_irq_hard_is_alive = true;
+    mp_irq_hard_waiting = false;
+    mp_thread_create_ex(TASK_HardInterrupts, &mpirq_args, &stack_size, INTERRUPTS_HARD_TASK_PRIORITY, "HardIRQs", 1);
 }
 
 void mp_irq_add (mp_obj_t parent, mp_obj_t handler) {
@@ -148,20 +347,31 @@ mp_obj_tuple_t *mp_irq_find (mp_obj_t parent) {
 
 void IRAM_ATTR mp_irq_queue_interrupt(void (* handler)(void *), void *arg) {
     mp_callback_obj_t cb = {.handler = handler, .arg = arg};
+    mp_irq_send(&cb, MP_IRQ_PRIORITY_NORMAL, true);
+}
 
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+void IRAM_ATTR mp_irq_queue_interrupt_prio(void (* handler)(void *), void *arg, mp_irq_priority_t prio) {
+    mp_callback_obj_t cb = {.handler = handler, .arg = arg};
+    mp_irq_send(&cb, prio, true);
+}
 
-    xQueueSendFromISR(InterruptsQueue, &cb, &xHigherPriorityTaskWoken);
+void mp_irq_queue_interrupt_non_ISR(void (* handler)(void *), void *arg) {
+    mp_callback_obj_t cb = {.handler = handler, .arg = arg};
+    mp_irq_send(&cb, MP_IRQ_PRIORITY_NORMAL, false);
+}
 
-    if( xHigherPriorityTaskWoken)
-    {
-        portYIELD_FROM_ISR();
-    }
+void IRAM_ATTR mp_irq_queue_interrupt_hard(void (* handler)(void *), void *arg) {
+    mp_callback_obj_t cb = {.handler = handler, .arg = arg};
+    mp_irq_send_hard(&cb, true);
 }
 
-void mp_irq_queue_interrupt_non_ISR(void (* handler)(void *), void *arg) {
+void mp_irq_queue_interrupt_hard_non_ISR(void (* handler)(void *), void *arg) {
     mp_callback_obj_t cb = {.handler = handler, .arg = arg};
-    (void)xQueueSend(InterruptsQueue, &cb, 0);
+    mp_irq_send_hard(&cb, false);
+}
+
+bool mp_irq_hard_is_waiting(void) {
+    return mp_irq_hard_waiting;
 }
 
 void IRAM_ATTR mp_irq_queue_interrupt_immediate_thread_delete(TaskHandle_t id) {
@@ -169,20 +379,39 @@ void IRAM_ATTR mp_irq_queue_interrupt_immediate_thread_delete(TaskHandle_t id) {
     // Check if IRQ task is not being shutdown
     if(mp_irq_is_alive == true){
         mp_callback_obj_t cb = {.handler = vTaskDelete, .arg = id};
-        (void)xQueueSend(InterruptsQueue, &cb, 0);
+        mp_irq_send(&cb, MP_IRQ_PRIORITY_HIGH, false);
+    }
+}
+
+void mp_irq_get_stats(mp_irq_priority_t prio, mp_irq_stats_t *stats) {
+    *stats = mp_irq_stats[prio];
+}
+
+STATIC void mp_irq_metrics_collect (uint32_t *values) {
+    for (int prio = MP_IRQ_PRIORITY_HIGH; prio < MP_IRQ_PRIORITY_LEVELS; prio++) {
+        *values++ = mp_irq_stats[prio].dispatched;
+        *values++ = mp_irq_stats[prio].dropped;
     }
 }
 
 void mp_irq_kill(void) {
     // sending a NULL handler will kill the interrupt task
-    mp_irq_queue_interrupt(NULL, NULL);
+    mp_callback_obj_t cb = {.handler = NULL, .arg = NULL};
+    bool sent = mp_irq_send(&cb, MP_IRQ_PRIORITY_HIGH, false);
     // release the GIL if we have it
     MP_THREAD_GIL_EXIT();
+    while (!sent) {
+        // the queue is full, let the task make room
+        vTaskDelay(3 / portTICK_PERIOD_MS);
+        sent = mp_irq_send(&cb, MP_IRQ_PRIORITY_HIGH, false);
+    }
+    // the hard task runs one callback at a time, the request goes ahead of the pending ones
+    xQueueSendToFront(InterruptsHardQueue, &cb, portMAX_DELAY);
     do {
         // it needs to be this one in order to not mess with the GIL
         vTaskDelay(3 / portTICK_PERIOD_MS);
-    } while (mp_irq_is_alive);
-    xQueueReset(InterruptsQueue);
+    } while (mp_irq_is_alive || mp_irq_hard_is_alive);
+    mp_irq_reset_queues();
     // TODO disable all interrupts here at hardware level
 }
 
@@ -192,4 +421,12 @@ void IRAM_ATTR mp_irq_queue_interrupt(void (* handler)(void *), void *arg) {
 
 }
 
+void IRAM_ATTR mp_irq_queue_interrupt_prio(void (* handler)(void *), void *arg, mp_irq_priority_t prio) {
+
+}
+
+void IRAM_ATTR mp_irq_queue_interrupt_hard(void (* handler)(void *), void *arg) {
+
+}
+
 #endif  // MICROPY_PY_THREAD
@@ -20,6 +20,17 @@
 #define INTERRUPTS_TASK_STACK_LEN                  (INTERRUPTS_TASK_STACK_SIZE / sizeof(StackType_t))
 
 #define INTERRUPTS_QUEUE_LEN                       (32)
+#define INTERRUPTS_HIGH_QUEUE_LEN                  (16)
+#define INTERRUPTS_LOW_QUEUE_LEN                   (32)
+// callbacks run for every GIL acquisition, 1 takes the GIL for each callback
+#define INTERRUPTS_BATCH_LEN                       (4)
+
+// hard callbacks have their own task, above everything that runs Python code
+#define INTERRUPTS_HARD_TASK_PRIORITY              20
+#define INTERRUPTS_HARD_TASK_STACK_SIZE            (4 * 1024)
+#define INTERRUPTS_HARD_QUEUE_LEN                  (8)
+// allocated at start-up, holds the exceptions raised while the heap is locked
+#define INTERRUPTS_EMERGENCY_BUF_SIZE              (256)
 
 #define INTERRUPT_OBJ_CLEAN(obj)                   {\
                                                        (obj)->handler = NULL; \
@@ -34,6 +45,19 @@ typedef struct {
     void *arg;
 } mp_callback_obj_t;
 
+// the interrupt task always runs the pending callbacks of the highest level first
+typedef enum {
+    MP_IRQ_PRIORITY_HIGH = 0,       // LoRa, timer alarms
+    MP_IRQ_PRIORITY_NORMAL,
+    MP_IRQ_PRIORITY_LOW,            // pins, they can come in bursts
+    MP_IRQ_PRIORITY_LEVELS
+} mp_irq_priority_t;
+
+typedef struct {
+    uint32_t dispatched;
+    uint32_t dropped;               // the queue of the level was full
+} mp_irq_stats_t;
+
 /******************************************************************************
  DECLARE EXPORTED DATA
  ******************************************************************************/
@@ -49,7 +73,12 @@ void mp_irq_add (mp_obj_t parent, mp_obj_t handler);
 void mp_irq_remove (mp_obj_t parent);
 mp_obj_tuple_t *mp_irq_find (mp_obj_t parent);
 void mp_irq_queue_interrupt(void (* handler)(void *), void *arg);
+void mp_irq_queue_interrupt_prio(void (* handler)(void *), void *arg, mp_irq_priority_t prio);
 void mp_irq_queue_interrupt_non_ISR(void (* handler)(void *), void *arg);
+void mp_irq_queue_interrupt_hard(void (* handler)(void *), void *arg);
+void mp_irq_queue_interrupt_hard_non_ISR(void (* handler)(void *), void *arg);
+bool mp_irq_hard_is_waiting(void);
+void mp_irq_get_stats(mp_irq_priority_t prio, mp_irq_stats_t *stats);
 void mp_irq_queue_interrupt_immediate_thread_delete(TaskHandle_t id);
 void mp_irq_kill(void);
 #endif /* MPIRQ_H_ */
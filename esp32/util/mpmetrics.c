@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/mpstate.h"
+#include "py/obj.h"
+#include "py/nlr.h"
+#include "py/runtime.h"
+#include "py/gc.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+
+#include "mpirq.h"
+#include "mpmetrics.h"
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC mpmetrics_source_t *mpmetrics_sources;
+STATIC portMUX_TYPE mpmetrics_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// these are only touched with the GIL held
+STATIC uint32_t mpmetrics_values[MPMETRICS_VALUES_MAX];
+STATIC uint32_t mpmetrics_prev[MPMETRICS_VALUES_MAX];
+STATIC uint32_t mpmetrics_prev_schema;
+STATIC uint16_t mpmetrics_seq;
+
+STATIC TimerHandle_t mpmetrics_timer;
+STATIC volatile bool mpmetrics_export_pending;
+STATIC bool mpmetrics_export_delta;
+STATIC mpmetrics_export_stats_t mpmetrics_export_stats;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mpmetrics_gc_collect (uint32_t *values);
+STATIC void mpmetrics_self_collect (uint32_t *values);
+
+STATIC const mpmetrics_desc_t mpmetrics_gc_metrics[] = {
+    { "total",          E_MPMETRICS_GAUGE },
+    { "used",           E_MPMETRICS_GAUGE },
+    { "free",           E_MPMETRICS_GAUGE },
+    { "max_free",       E_MPMETRICS_GAUGE },        // bytes of the largest free block
+};
+STATIC mpmetrics_source_t mpmetrics_gc_source = {
+    .name = "gc",
+    .metrics = mpmetrics_gc_metrics,
+    .n_metrics = MP_ARRAY_SIZE(mpmetrics_gc_metrics),
+    .collect = mpmetrics_gc_collect,
+};
+
+STATIC const mpmetrics_desc_t mpmetrics_self_metrics[] = {
+    { "exports",        E_MPMETRICS_COUNTER },
+    { "failures",       E_MPMETRICS_COUNTER },
+    { "bytes",          E_MPMETRICS_COUNTER },
+};
+STATIC mpmetrics_source_t mpmetrics_self_source = {
+    .name = "metrics",
+    .metrics = mpmetrics_self_metrics,
+    .n_metrics = MP_ARRAY_SIZE(mpmetrics_self_metrics),
+    .collect = mpmetrics_self_collect,
+};
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mpmetrics_gc_collect (uint32_t *values) {
+    gc_info_t info;
+    gc_info(&info);
+    values[0] = info.total;
+    values[1] = info.used;
+    values[2] = info.free;
+    values[3] = info.max_free * MICROPY_BYTES_PER_GC_BLOCK;
+}
+
+STATIC void mpmetrics_self_collect (uint32_t *values) {
+    values[0] = mpmetrics_export_stats.exports;
+    values[1] = mpmetrics_export_stats.failures;
+    values[2] = mpmetrics_export_stats.bytes;
+}
+
+STATIC uint32_t mpmetrics_fnv1a (uint32_t hash, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len--) {
+        hash = (hash ^ *p++) * 16777619;
+    }
+    return hash;
+}
+
+STATIC uint8_t *mpmetrics_put_varint (uint8_t *p, uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *p++ = value;
+    return p;
+}
+
+// runs in the interrupt task, with the GIL
+STATIC void mpmetrics_export_handler (void *arg) {
+    mpmetrics_export_pending = false;
+    mp_obj_t target = MP_STATE_PORT(mpmetrics_export)[0];
+    if (target == MP_OBJ_NULL) {
+        return;
+    }
+
+    byte *buf = m_new(byte, MPMETRICS_SNAPSHOT_MAX);
+    size_t len = mpmetrics_snapshot(buf, mpmetrics_export_delta);
+    mp_obj_t msg = mp_obj_new_bytes(buf, len);
+    m_del(byte, buf, MPMETRICS_SNAPSHOT_MAX);
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t dest[4];
+        mp_load_method_maybe(target, MP_QSTR_publish, dest);
+        if (dest[0] != MP_OBJ_NULL) {
+            dest[2] = MP_STATE_PORT(mpmetrics_export)[1];
+            dest[3] = msg;
+            mp_call_method_n_kw(2, 0, dest);
+        } else {
+            mp_call_function_1(target, msg);
+        }
+        nlr_pop();
+        mpmetrics_export_stats.exports++;
+        mpmetrics_export_stats.bytes += len;
+    } else {
+        // offline most likely, no point in filling the console with it every period
+        mpmetrics_export_stats.failures++;
+    }
+}
+
+STATIC void mpmetrics_timer_callback (TimerHandle_t xTimer) {
+    // a slow target doesn't pile up exports
+    if (!mpmetrics_export_pending) {
+        mpmetrics_export_pending = true;
+        mp_irq_queue_interrupt_non_ISR(mpmetrics_export_handler, NULL);
+    }
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void mpmetrics_init0 (void) {
+    if (mpmetrics_timer == NULL) {
+        mpmetrics_timer = xTimerCreate("Metrics", MPMETRICS_PERIOD_MS_DEF / portTICK_PERIOD_MS, pdTRUE, NULL, mpmetrics_timer_callback);
+    }
+    // the target was on the heap of the previous run
+    mpmetrics_export_stop();
+    mpmetrics_register(&mpmetrics_gc_source);
+    mpmetrics_register(&mpmetrics_self_source);
+}
+
+void mpmetrics_register (mpmetrics_source_t *source) {
+    portENTER_CRITICAL(&mpmetrics_mux);
+    mpmetrics_source_t **last = &mpmetrics_sources;
+    while (*last != NULL && *last != source) {
+        last = &(*last)->next;
+    }
+    if (*last == NULL) {
+        // appended, so that the order of the values only depends on the order of the registrations
+        source->next = NULL;
+        *last = source;
+    }
+    portEXIT_CRITICAL(&mpmetrics_mux);
+}
+
+mpmetrics_source_t *mpmetrics_first (void) {
+    return mpmetrics_sources;
+}
+
+uint32_t mpmetrics_source_values (const mpmetrics_source_t *source) {
+    uint32_t n_values = 0;
+    for (uint32_t i = 0; i < source->n_metrics; i++) {
+        n_values += (source->metrics[i].kind == E_MPMETRICS_HISTOGRAM) ? source->metrics[i].buckets : 1;
+    }
+    return n_values;
+}
+
+uint32_t mpmetrics_schema (void) {
+    uint32_t hash = 2166136261;
+    for (mpmetrics_source_t *source = mpmetrics_sources; source != NULL; source = source->next) {
+        hash = mpmetrics_fnv1a(hash, source->name, strlen(source->name) + 1);
+        for (uint32_t i = 0; i < source->n_metrics; i++) {
+            const mpmetrics_desc_t *desc = &source->metrics[i];
+            hash = mpmetrics_fnv1a(hash, desc->name, strlen(desc->name) + 1);
+            hash = mpmetrics_fnv1a(hash, &desc->kind, 1);
+            hash = mpmetrics_fnv1a(hash, &desc->buckets, 1);
+        }
+    }
+    return hash;
+}
+
+uint32_t mpmetrics_collect (uint32_t *values, uint32_t max) {
+    uint32_t count = 0;
+    for (mpmetrics_source_t *source = mpmetrics_sources; source != NULL; source = source->next) {
+        uint32_t n_values = mpmetrics_source_values(source);
+        if (count + n_values > max) {
+            // the schema still tells where it ended
+            break;
+        }
+        source->collect(&values[count]);
+        count += n_values;
+    }
+    return count;
+}
+
+// version, flags, sequence (16 bits), schema, uptime in seconds, all little endian, then
+// one varint per value, the gauges zigzag encoded
+size_t mpmetrics_snapshot (uint8_t *buf, bool delta) {
+    uint32_t schema = mpmetrics_schema();
+    uint32_t uptime = esp_timer_get_time() / 1000000;
+    uint32_t count = mpmetrics_collect(mpmetrics_values, MPMETRICS_VALUES_MAX);
+
+    if (delta && schema != mpmetrics_prev_schema) {
+        // a source registered since the last one, start over from absolute values
+        memset(mpmetrics_prev, 0, sizeof(mpmetrics_prev));
+        mpmetrics_prev_schema = schema;
+    }
+    uint16_t seq = delta ? mpmetrics_seq++ : 0;
+
+    uint8_t *p = buf;
+    *p++ = MPMETRICS_FORMAT_VERSION;
+    *p++ = delta ? MPMETRICS_FLAG_DELTA : 0;
+    *p++ = seq;
+    *p++ = seq >> 8;
+    for (int i = 0; i < 4; i++) {
+        *p++ = schema >> (8 * i);
+    }
+    for (int i = 0; i < 4; i++) {
+        *p++ = uptime >> (8 * i);
+    }
+
+    uint32_t idx = 0;
+    for (mpmetrics_source_t *source = mpmetrics_sources; source != NULL && idx < count; source = source->next) {
+        for (uint32_t i = 0; i < source->n_metrics && idx < count; i++) {
+            const mpmetrics_desc_t *desc = &source->metrics[i];
+            uint32_t n_values = (desc->kind == E_MPMETRICS_HISTOGRAM) ? desc->buckets : 1;
+            for (uint32_t n = 0; n < n_values; n++, idx++) {
+                uint32_t value = mpmetrics_values[idx];
+                if (desc->kind == E_MPMETRICS_GAUGE) {
+                    int32_t level = value;
+                    p = mpmetrics_put_varint(p, (level << 1) ^ (level >> 31));
+                } else if (delta) {
+                    // one that went down was reset meanwhile (a soft reset, a stats call with reset=True)
+                    p = mpmetrics_put_varint(p, (value >= mpmetrics_prev[idx]) ? value - mpmetrics_prev[idx] : value);
+                    mpmetrics_prev[idx] = value;
+                } else {
+                    p = mpmetrics_put_varint(p, value);
+                }
+            }
+        }
+    }
+    return p - buf;
+}
+
+void mpmetrics_export_start (mp_obj_t target, mp_obj_t topic, uint32_t period_ms, bool delta) {
+    MP_STATE_PORT(mpmetrics_export)[0] = target;
+    MP_STATE_PORT(mpmetrics_export)[1] = topic;
+    mpmetrics_export_delta = delta;
+    xTimerChangePeriod(mpmetrics_timer, period_ms / portTICK_PERIOD_MS, 0);
+    xTimerStart(mpmetrics_timer, 0);
+}
+
+void mpmetrics_export_stop (void) {
+    xTimerStop(mpmetrics_timer, 0);
+    MP_STATE_PORT(mpmetrics_export)[0] = MP_OBJ_NULL;
+    MP_STATE_PORT(mpmetrics_export)[1] = MP_OBJ_NULL;
+}
+
+void mpmetrics_export_get_stats (mpmetrics_export_stats_t *stats) {
+    *stats = mpmetrics_export_stats;
+}
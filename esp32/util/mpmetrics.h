@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MPMETRICS_H_
+#define MPMETRICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "py/obj.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MPMETRICS_VALUES_MAX                        (192)       // of all the sources together, a histogram takes one per bucket
+#define MPMETRICS_FORMAT_VERSION                    (1)
+#define MPMETRICS_HEADER_SIZE                       (12)
+// a varint of a uint32_t takes 5 bytes at most
+#define MPMETRICS_SNAPSHOT_MAX                      (MPMETRICS_HEADER_SIZE + (5 * MPMETRICS_VALUES_MAX))
+#define MPMETRICS_FLAG_DELTA                        (0x01)      // counters and buckets since the previous export
+
+#define MPMETRICS_PERIOD_MS_DEF                     (60000)
+#define MPMETRICS_PERIOD_MS_MIN                     (1000)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    E_MPMETRICS_COUNTER = 0,                // only goes up, wraps at 32 bits
+    E_MPMETRICS_GAUGE,                      // signed, a level at the time of the snapshot
+    E_MPMETRICS_HISTOGRAM,                  // a counter per bucket
+} mpmetrics_kind_t;
+
+typedef struct {
+    const char          *name;
+    uint8_t             kind;
+    uint8_t             buckets;            // histograms only
+} mpmetrics_desc_t;
+
+// the values are read from the module's own statistics when a snapshot is taken, the
+// hot paths don't pay for anything they didn't count already
+typedef struct _mpmetrics_source_t {
+    const char          *name;
+    const mpmetrics_desc_t *metrics;
+    uint8_t             n_metrics;
+    // one value per counter and gauge and one per bucket of a histogram, in the order of metrics
+    void                (*collect)(uint32_t *values);
+    struct _mpmetrics_source_t *next;
+} mpmetrics_source_t;
+
+typedef struct {
+    uint32_t            exports;
+    uint32_t            failures;           // the target raised
+    uint32_t            bytes;
+} mpmetrics_export_stats_t;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+void mpmetrics_init0 (void);
+// from any task, more than once is fine
+void mpmetrics_register (mpmetrics_source_t *source);
+mpmetrics_source_t *mpmetrics_first (void);
+uint32_t mpmetrics_source_values (const mpmetrics_source_t *source);
+// FNV-1a of the names, kinds and buckets, it changes with the layout of a snapshot
+uint32_t mpmetrics_schema (void);
+// all the values in registry order, all the functions below need the GIL
+uint32_t mpmetrics_collect (uint32_t *values, uint32_t max);
+size_t mpmetrics_snapshot (uint8_t *buf, bool delta);
+
+// the target is one with a publish(topic, msg) method, like network.MQTT, or any callable
+void mpmetrics_export_start (mp_obj_t target, mp_obj_t topic, uint32_t period_ms, bool delta);
+void mpmetrics_export_stop (void);
+void mpmetrics_export_get_stats (mpmetrics_export_stats_t *stats);
+
+#endif /* MPMETRICS_H_ */
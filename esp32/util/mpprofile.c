@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/mpstate.h"
+#include "py/mphal.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_freertos_hooks.h"
+
+#include "mpprofile.h"
+
+#if MICROPY_PY_MICROPYTHON_PROFILE
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    bool enabled;
+    uint32_t divider;
+    uint32_t countdown[portNUM_PROCESSORS];
+    uint32_t total;
+    uint32_t in_python;
+    // site i is the bytecode in MP_STATE_PORT(prof_sites)[i]
+    uint32_t samples[MICROPY_PY_MICROPYTHON_PROFILE_SITES];
+} mpprofile_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+// the tick interrupt of each core samples the task it interrupted, when it's a
+// MicroPython thread the sample goes to the bytecode function it's running
+STATIC mpprofile_t mpprofile;
+STATIC portMUX_TYPE mpprofile_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mpprofile_clear (void);
+STATIC void mpprofile_sample (uint32_t core);
+STATIC void mpprofile_tick_core0 (void);
+#if portNUM_PROCESSORS > 1
+STATIC void mpprofile_tick_core1 (void);
+#endif
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+// the rate is a divider of the tick rate
+bool mp_hal_prof_start (mp_uint_t hz) {
+    static bool hooked = false;
+    if (hz == 0 || hz > CONFIG_FREERTOS_HZ) {
+        return false;
+    }
+    if (!hooked) {
+        hooked = true;
+        esp_register_freertos_tick_hook_for_cpu(mpprofile_tick_core0, 0);
+    #if portNUM_PROCESSORS > 1
+        esp_register_freertos_tick_hook_for_cpu(mpprofile_tick_core1, 1);
+    #endif
+    }
+
+    portENTER_CRITICAL(&mpprofile_mux);
+    mpprofile_clear();
+    mpprofile.divider = CONFIG_FREERTOS_HZ / hz;
+    for (uint32_t core = 0; core < portNUM_PROCESSORS; core++) {
+        mpprofile.countdown[core] = mpprofile.divider;
+    }
+    mpprofile.enabled = true;
+    portEXIT_CRITICAL(&mpprofile_mux);
+    return true;
+}
+
+// keeps the profile, so that it can still be read
+void mp_hal_prof_stop (void) {
+    mpprofile.enabled = false;
+}
+
+size_t mp_hal_prof_read (const uint8_t **sites, size_t *samples, size_t max, size_t *in_python, size_t *total) {
+    size_t n = 0;
+    portENTER_CRITICAL(&mpprofile_mux);
+    for (uint32_t i = 0; i < MICROPY_PY_MICROPYTHON_PROFILE_SITES && n < max; i++) {
+        if (mpprofile.samples[i] != 0) {
+            sites[n] = MP_STATE_PORT(prof_sites)[i];
+            samples[n] = mpprofile.samples[i];
+            n++;
+        }
+    }
+    *in_python = mpprofile.in_python;
+    *total = mpprofile.total;
+    portEXIT_CRITICAL(&mpprofile_mux);
+    return n;
+}
+
+// the bytecode of the sites is gone after a soft reset
+void mpprofile_deinit0 (void) {
+    portENTER_CRITICAL(&mpprofile_mux);
+    mpprofile.enabled = false;
+    mpprofile_clear();
+    portEXIT_CRITICAL(&mpprofile_mux);
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mpprofile_clear (void) {
+    mpprofile.total = 0;
+    mpprofile.in_python = 0;
+    memset(mpprofile.samples, 0, sizeof(mpprofile.samples));
+    memset(MP_STATE_PORT(prof_sites), 0, sizeof(MP_STATE_PORT(prof_sites)));
+}
+
+STATIC IRAM_ATTR void mpprofile_sample (uint32_t core) {
+    if (!mpprofile.enabled || --mpprofile.countdown[core] > 0) {
+        return;
+    }
+    mpprofile.countdown[core] = mpprofile.divider;
+
+    // the same slot as mp_thread_get_state(), NULL for the tasks that aren't MicroPython threads
+    TaskHandle_t task = xTaskGetCurrentTaskHandleForCPU(core);
+    mp_state_thread_t *ts = pvTaskGetThreadLocalStoragePointer(task, 1);
+
+    portENTER_CRITICAL_ISR(&mpprofile_mux);
+    mpprofile.total++;
+    if (ts != NULL) {
+        mpprofile.in_python++;
+        const byte *code = ts->prof_code;
+        if (code != NULL) {
+            // once the table is full, the samples of new functions only count as in Python
+            for (uint32_t i = 0; i < MICROPY_PY_MICROPYTHON_PROFILE_SITES; i++) {
+                if (mpprofile.samples[i] == 0) {
+                    MP_STATE_PORT(prof_sites)[i] = code;
+                } else if (MP_STATE_PORT(prof_sites)[i] != code) {
+                    continue;
+                }
+                mpprofile.samples[i]++;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL_ISR(&mpprofile_mux);
+}
+
+STATIC IRAM_ATTR void mpprofile_tick_core0 (void) {
+    mpprofile_sample(0);
+}
+
+#if portNUM_PROCESSORS > 1
+STATIC IRAM_ATTR void mpprofile_tick_core1 (void) {
+    mpprofile_sample(1);
+}
+#endif
+
+#else
+
+void mpprofile_deinit0 (void) {
+}
+
+#endif // MICROPY_PY_MICROPYTHON_PROFILE
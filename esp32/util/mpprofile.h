@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MPPROFILE_H_
+#define MPPROFILE_H_
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+void mpprofile_deinit0 (void);
+
+#endif /* MPPROFILE_H_ */
@@ -18,11 +18,27 @@
 #include "rom/rtc.h"
 #include "esp_system.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
 #include "mpsleep.h"
+#include "mpthreadport.h"
+#include "modwlan.h"
+#include "modbt.h"
+#include "machulp.h"
+#if defined(LOPY) || defined (LOPY4) || defined (FIPY)
+#include "modlora.h"
+#include "sflash_diskio.h"
+#endif
+#if defined(GPY) || defined (FIPY)
+#include "lteppp.h"
+#endif
 
 /******************************************************************************
  DECLARE PRIVATE CONSTANTS
  ******************************************************************************/
+// UART0 (the REPL) wakes the chip up after this many edges, the first character is lost
+#define MPSLEEP_IDLE_UART_WAKE_EDGES                (3)
 
 /******************************************************************************
  DEFINE PRIVATE TYPES
@@ -33,10 +49,16 @@
  ******************************************************************************/
 STATIC mpsleep_reset_cause_t mpsleep_reset_cause = MPSLEEP_PWRON_RESET;
 STATIC mpsleep_wake_reason_t mpsleep_wake_reason = MPSLEEP_PWRON_WAKE;
+STATIC bool mpsleep_idle_enable = false;
+STATIC uint32_t mpsleep_idle_min = MPSLEEP_IDLE_MIN_MS_DEFAULT;
+// drivers which need the clocks running, the idle sleep is skipped while it's not zero
+STATIC volatile uint32_t mpsleep_idle_locks = 0;
+STATIC portMUX_TYPE mpsleep_idle_mux = portMUX_INITIALIZER_UNLOCKED;
 
 /******************************************************************************
  DECLARE PRIVATE FUNCTIONS
  ******************************************************************************/
+STATIC bool mpsleep_idle_allowed (void);
 
 /******************************************************************************
  DEFINE PUBLIC FUNCTIONS
@@ -72,6 +94,9 @@ void mpsleep_init0 (void) {
         case ESP_SLEEP_WAKEUP_TIMER:
             mpsleep_wake_reason = MPSLEEP_RTC_WAKE;
             break;
+        case ESP_SLEEP_WAKEUP_ULP:
+            mpsleep_wake_reason = MPSLEEP_ULP_WAKE;
+            break;
         case ESP_SLEEP_WAKEUP_UNDEFINED:
         default:
             mpsleep_wake_reason = MPSLEEP_PWRON_WAKE;
@@ -83,6 +108,19 @@ void mpsleep_signal_soft_reset (void) {
     mpsleep_reset_cause = MPSLEEP_SOFT_RESET;
 }
 
+void mpsleep_enter_deepsleep (void) {
+    // RAM is lost on deepsleep, write back the FatFS blocks still cached
+    sflash_disk_flush();
+#if defined(LOPY) || defined (LOPY4) || defined (FIPY)
+    // keep the LoRaWAN session in RTC memory for a warm restore on wake-up
+    modlora_deepsleep_save();
+#endif
+    // the ULP program reads the pads and the ADC through the RTC peripherals
+    if (machulp_is_running()) {
+        esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    }
+}
+
 mpsleep_reset_cause_t mpsleep_get_reset_cause (void) {
     return mpsleep_reset_cause;
 }
@@ -91,6 +129,82 @@ mpsleep_wake_reason_t mpsleep_get_wake_reason (void) {
     return mpsleep_wake_reason;
 }
 
+void mpsleep_idle_configure (bool enable, uint32_t min_ms) {
+    mpsleep_idle_enable = enable;
+    mpsleep_idle_min = min_ms;
+}
+
+bool mpsleep_idle_enabled (void) {
+    return mpsleep_idle_enable;
+}
+
+uint32_t mpsleep_idle_min_ms (void) {
+    return mpsleep_idle_min;
+}
+
+void mpsleep_idle_lock (void) {
+    portENTER_CRITICAL(&mpsleep_idle_mux);
+    mpsleep_idle_locks++;
+    portEXIT_CRITICAL(&mpsleep_idle_mux);
+}
+
+void mpsleep_idle_unlock (void) {
+    portENTER_CRITICAL(&mpsleep_idle_mux);
+    if (mpsleep_idle_locks > 0) {
+        mpsleep_idle_locks--;
+    }
+    portEXIT_CRITICAL(&mpsleep_idle_mux);
+}
+
+// spends an idle wait of the interpreter in light sleep when nothing else needs
+// the CPU, returns how many milliseconds of the wait are still left
+uint32_t mpsleep_idle (uint32_t ms) {
+    if (!mpsleep_idle_allowed() || ms < mpsleep_idle_min) {
+        return ms;
+    }
+
+    // the REPL output still in the FIFO would be garbled by the stopped clocks
+    uart_wait_tx_done(0, ms / portTICK_PERIOD_MS);
+
+    esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+    uart_set_wakeup_threshold(0, MPSLEEP_IDLE_UART_WAKE_EDGES);
+    esp_sleep_enable_uart_wakeup(0);
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = esp_light_sleep_start();
+    uint32_t slept = (esp_timer_get_time() - start) / 1000;
+
+    // machine.sleep() and machine.deepsleep() pick their own wake-up sources
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_UART);
+
+    if (err != ESP_OK) {
+        return ms;
+    }
+    return (slept < ms) ? (ms - slept) : 0;
+}
+
 /******************************************************************************
  DEFINE PRIVATE FUNCTIONS
  ******************************************************************************/
+// the FreeRTOS tick doesn't advance during the light sleep and all the tasks are
+// stopped, so it's only entered when the radios are off and no other Python thread runs
+STATIC bool mpsleep_idle_allowed (void) {
+    if (!mpsleep_idle_enable || mpsleep_idle_locks > 0) {
+        return false;
+    }
+    if (wlan_obj.started || modbt_is_enabled()) {
+        return false;
+    }
+#if defined(LOPY) || defined (LOPY4) || defined (FIPY)
+    if (!modlora_is_radio_off()) {
+        return false;
+    }
+#endif
+#if defined(GPY) || defined (FIPY)
+    if (lteppp_get_state() != E_LTE_INIT) {
+        return false;
+    }
+#endif
+    return mp_thread_is_alone();
+}
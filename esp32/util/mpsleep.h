@@ -13,6 +13,8 @@
 /******************************************************************************
  DEFINE CONSTANTS
  ******************************************************************************/
+// shorter waits are not worth the time spent entering and leaving the light sleep
+#define MPSLEEP_IDLE_MIN_MS_DEFAULT                 (20)
 
 /******************************************************************************
  DEFINE TYPES
@@ -39,7 +41,14 @@ typedef enum {
  ******************************************************************************/
 void mpsleep_init0 (void);
 void mpsleep_signal_soft_reset (void);
+void mpsleep_enter_deepsleep (void);
 mpsleep_reset_cause_t mpsleep_get_reset_cause (void);
 mpsleep_wake_reason_t mpsleep_get_wake_reason (void);
+void mpsleep_idle_configure (bool enable, uint32_t min_ms);
+bool mpsleep_idle_enabled (void);
+uint32_t mpsleep_idle_min_ms (void);
+void mpsleep_idle_lock (void);
+void mpsleep_idle_unlock (void);
+uint32_t mpsleep_idle (uint32_t ms);
 
 #endif /* MPSLEEP_H_ */
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/misc.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "mptaskmon.h"
+#include "mpmetrics.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MPTASKMON_STACK_SIZE                        (2048)
+#define MPTASKMON_PRIORITY                          (1)         // just above idle, a busy system starves it first
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    mptaskmon_stats_t stats;
+    int64_t last_us;
+} mptaskmon_entry_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC const char *TAG = "TaskMon";
+STATIC const char *mptaskmon_names[E_MPTASKMON_NUM_TASKS] = { "LoRa", "LTE", "Servers" };
+STATIC mptaskmon_entry_t mptaskmon_entries[E_MPTASKMON_NUM_TASKS];
+STATIC portMUX_TYPE mptaskmon_mux = portMUX_INITIALIZER_UNLOCKED;
+STATIC bool mptaskmon_guard;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void TASK_TaskMon (void *pvParameters);
+STATIC uint32_t mptaskmon_check (mptaskmon_entry_t *entry, int64_t now);
+STATIC void mptaskmon_metrics_collect (uint32_t *values);
+
+#define MPTASKMON_METRICS(task) \
+    { task "_beats",        E_MPMETRICS_COUNTER }, \
+    { task "_overruns",     E_MPMETRICS_COUNTER }, \
+    { task "_gaps",         E_MPMETRICS_HISTOGRAM, MPTASKMON_HIST_BUCKETS }
+
+// in the order of mptaskmon_task_t
+STATIC const mpmetrics_desc_t mptaskmon_metrics[] = {
+    MPTASKMON_METRICS("lora"),
+    MPTASKMON_METRICS("lte"),
+    MPTASKMON_METRICS("servers"),
+};
+STATIC mpmetrics_source_t mptaskmon_metrics_source = {
+    .name = "tasks",
+    .metrics = mptaskmon_metrics,
+    .n_metrics = MP_ARRAY_SIZE(mptaskmon_metrics),
+    .collect = mptaskmon_metrics_collect,
+};
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void mptaskmon_init0 (void) {
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+    mpmetrics_register(&mptaskmon_metrics_source);
+    xTaskCreatePinnedToCore(TASK_TaskMon, "TaskMon", MPTASKMON_STACK_SIZE / sizeof(StackType_t), NULL, MPTASKMON_PRIORITY, NULL, 1);
+}
+
+void mptaskmon_register (mptaskmon_task_t task, uint32_t deadline_ms) {
+    mptaskmon_entry_t *entry = &mptaskmon_entries[task];
+    portENTER_CRITICAL(&mptaskmon_mux);
+    entry->stats.registered = true;
+    entry->stats.idle = false;
+    entry->stats.overdue = false;
+    entry->stats.deadline_ms = deadline_ms;
+    entry->last_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&mptaskmon_mux);
+}
+
+void mptaskmon_beat (mptaskmon_task_t task) {
+    mptaskmon_entry_t *entry = &mptaskmon_entries[task];
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&mptaskmon_mux);
+    mptaskmon_stats_t *stats = &entry->stats;
+    if (!stats->idle) {
+        uint32_t gap_ms = (now - entry->last_us) / 1000;
+        uint32_t bucket = 0;
+        while (bucket < MPTASKMON_HIST_BUCKETS - 1 && gap_ms >= (1 << (2 * bucket))) {
+            bucket++;
+        }
+        stats->hist[bucket]++;
+        stats->max_ms = MAX(stats->max_ms, gap_ms);
+        // the checker may not have had the chance to see it
+        if (gap_ms > stats->deadline_ms && !stats->overdue) {
+            stats->overruns++;
+        }
+    }
+    stats->beats++;
+    stats->idle = false;
+    stats->overdue = false;
+    entry->last_us = now;
+    portEXIT_CRITICAL(&mptaskmon_mux);
+}
+
+void mptaskmon_idle (mptaskmon_task_t task) {
+    portENTER_CRITICAL(&mptaskmon_mux);
+    mptaskmon_entries[task].stats.idle = true;
+    mptaskmon_entries[task].stats.overdue = false;
+    portEXIT_CRITICAL(&mptaskmon_mux);
+}
+
+void mptaskmon_get_stats (mptaskmon_task_t task, mptaskmon_stats_t *stats, bool reset) {
+    mptaskmon_entry_t *entry = &mptaskmon_entries[task];
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&mptaskmon_mux);
+    mptaskmon_check(entry, now);
+    *stats = entry->stats;
+    if (reset) {
+        entry->stats.beats = 0;
+        entry->stats.overruns = 0;
+        entry->stats.max_ms = 0;
+        memset(entry->stats.hist, 0, sizeof(entry->stats.hist));
+    }
+    portEXIT_CRITICAL(&mptaskmon_mux);
+}
+
+const char *mptaskmon_name (mptaskmon_task_t task) {
+    return mptaskmon_names[task];
+}
+
+bool mptaskmon_healthy (void) {
+    bool healthy = true;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&mptaskmon_mux);
+    for (int i = 0; i < E_MPTASKMON_NUM_TASKS; i++) {
+        mptaskmon_check(&mptaskmon_entries[i], now);
+        healthy &= !mptaskmon_entries[i].stats.overdue;
+    }
+    portEXIT_CRITICAL(&mptaskmon_mux);
+    return healthy;
+}
+
+void mptaskmon_set_guard (bool guard) {
+    mptaskmon_guard = guard;
+}
+
+bool mptaskmon_get_guard (void) {
+    return mptaskmon_guard;
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+// with the mux held, returns the time since the last beat
+STATIC uint32_t mptaskmon_check (mptaskmon_entry_t *entry, int64_t now) {
+    mptaskmon_stats_t *stats = &entry->stats;
+    uint32_t since_ms = (now - entry->last_us) / 1000;
+    stats->since_ms = since_ms;
+    if (stats->registered && !stats->idle && !stats->overdue && since_ms > stats->deadline_ms) {
+        // counted once per gap, the beat that ends it doesn't count it again
+        stats->overdue = true;
+        stats->overruns++;
+    }
+    return since_ms;
+}
+
+STATIC void mptaskmon_metrics_collect (uint32_t *values) {
+    portENTER_CRITICAL(&mptaskmon_mux);
+    for (int i = 0; i < E_MPTASKMON_NUM_TASKS; i++) {
+        mptaskmon_stats_t *stats = &mptaskmon_entries[i].stats;
+        *values++ = stats->beats;
+        *values++ = stats->overruns;
+        memcpy(values, stats->hist, sizeof(stats->hist));
+        values += MPTASKMON_HIST_BUCKETS;
+    }
+    portEXIT_CRITICAL(&mptaskmon_mux);
+}
+
+STATIC void TASK_TaskMon (void *pvParameters) {
+    for ( ; ; ) {
+        vTaskDelay(MPTASKMON_CHECK_PERIOD_MS / portTICK_PERIOD_MS);
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < E_MPTASKMON_NUM_TASKS; i++) {
+            portENTER_CRITICAL(&mptaskmon_mux);
+            bool was_overdue = mptaskmon_entries[i].stats.overdue;
+            uint32_t since_ms = mptaskmon_check(&mptaskmon_entries[i], now);
+            bool overdue = mptaskmon_entries[i].stats.overdue;
+            portEXIT_CRITICAL(&mptaskmon_mux);
+            if (overdue && !was_overdue) {
+                // out on the console before the watchdog, if any, resets the device
+                ESP_LOGW(TAG, "%s has not been seen for %u ms", mptaskmon_names[i], since_ms);
+            }
+        }
+    }
+}
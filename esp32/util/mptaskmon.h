@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MPTASKMON_H_
+#define MPTASKMON_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MPTASKMON_CHECK_PERIOD_MS                   (250)
+#define MPTASKMON_HIST_BUCKETS                      (8)         // < 1, 4, 16 ... 4096 ms, the last one open ended
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    E_MPTASKMON_LORA = 0,
+    E_MPTASKMON_LTE,
+    E_MPTASKMON_SERVERS,
+    E_MPTASKMON_NUM_TASKS
+} mptaskmon_task_t;
+
+typedef struct {
+    bool                registered;
+    bool                idle;               // blocked on purpose, the deadline doesn't run
+    bool                overdue;            // the gap so far is longer than the deadline
+    uint32_t            deadline_ms;
+    uint32_t            beats;
+    uint32_t            overruns;           // gaps that went past the deadline
+    uint32_t            max_ms;             // longest gap between two beats
+    uint32_t            since_ms;           // since the last beat
+    uint32_t            hist[MPTASKMON_HIST_BUCKETS];
+} mptaskmon_stats_t;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+void mptaskmon_init0 (void);
+// called by the task itself, before its main loop
+void mptaskmon_register (mptaskmon_task_t task, uint32_t deadline_ms);
+// once per iteration of the main loop
+void mptaskmon_beat (mptaskmon_task_t task);
+// before blocking without a timeout, the next beat starts a new gap
+void mptaskmon_idle (mptaskmon_task_t task);
+void mptaskmon_get_stats (mptaskmon_task_t task, mptaskmon_stats_t *stats, bool reset);
+// false while a registered task is past its deadline
+const char *mptaskmon_name (mptaskmon_task_t task);
+bool mptaskmon_healthy (void);
+void mptaskmon_set_guard (bool guard);
+bool mptaskmon_get_guard (void);
+
+#endif /* MPTASKMON_H_ */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/misc.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_freertos_hooks.h"
+
+#include "mptaskstats.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// per core, a power of 2
+#define MPTASKSTATS_SLOTS                           (64)
+#define MPTASKSTATS_SLOTS_MASK                      (MPTASKSTATS_SLOTS - 1)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    TaskHandle_t task;
+    uint32_t ticks;
+} mptaskstats_slot_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+// the libfreertos.a of the IDF is built without the run time counters, so the tick
+// interrupt of each core samples the task it interrupted instead, that's one table
+// lookup per millisecond and core
+STATIC mptaskstats_slot_t mptaskstats_slots[portNUM_PROCESSORS][MPTASKSTATS_SLOTS];
+STATIC uint32_t mptaskstats_ticks[portNUM_PROCESSORS];
+STATIC portMUX_TYPE mptaskstats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void mptaskstats_sample (uint32_t core);
+STATIC void mptaskstats_tick_core0 (void);
+#if portNUM_PROCESSORS > 1
+STATIC void mptaskstats_tick_core1 (void);
+#endif
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void mptaskstats_init0 (void) {
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+    esp_register_freertos_tick_hook_for_cpu(mptaskstats_tick_core0, 0);
+#if portNUM_PROCESSORS > 1
+    esp_register_freertos_tick_hook_for_cpu(mptaskstats_tick_core1, 1);
+#endif
+}
+
+// fills the tasks alive now with what they did since the previous call
+uint32_t mptaskstats_read (mptaskstats_task_t *tasks, uint32_t max, uint32_t *window_ticks) {
+    static mptaskstats_slot_t slots[portNUM_PROCESSORS][MPTASKSTATS_SLOTS];
+    TaskSnapshot_t snapshot[MPTASKSTATS_TASKS_MAX];
+    UBaseType_t tcb_size;
+
+    portENTER_CRITICAL(&mptaskstats_mux);
+    memcpy(slots, mptaskstats_slots, sizeof(slots));
+    memset(mptaskstats_slots, 0, sizeof(mptaskstats_slots));
+    *window_ticks = mptaskstats_ticks[0];
+    memset(mptaskstats_ticks, 0, sizeof(mptaskstats_ticks));
+    portEXIT_CRITICAL(&mptaskstats_mux);
+
+    // the idle task of this core frees the deleted tasks, it can't run meanwhile
+    vTaskSuspendAll();
+    uint32_t count = uxTaskGetSnapshotAll(snapshot, MIN(max, MPTASKSTATS_TASKS_MAX), &tcb_size);
+    for (uint32_t i = 0; i < count; i++) {
+        TaskHandle_t handle = (TaskHandle_t)snapshot[i].pxTCB;
+        mptaskstats_task_t *task = &tasks[i];
+        task->handle = handle;
+        strlcpy(task->name, pcTaskGetTaskName(handle), sizeof(task->name));
+        BaseType_t affinity = xTaskGetAffinity(handle);
+        task->core = (affinity == tskNO_AFFINITY) ? -1 : affinity;
+        task->priority = uxTaskPriorityGet(handle);
+        task->state = eTaskGetState(handle);
+        task->stack_size = (uint8_t *)snapshot[i].pxEndOfStack - (uint8_t *)pxTaskGetStackStart(handle);
+        // StackType_t is a byte on this port
+        task->stack_free = uxTaskGetStackHighWaterMark(handle);
+        task->ticks = 0;
+        for (uint32_t core = 0; core < portNUM_PROCESSORS; core++) {
+            uint32_t idx = ((uint32_t)handle >> 2) & MPTASKSTATS_SLOTS_MASK;
+            for (uint32_t n = 0; n < MPTASKSTATS_SLOTS && slots[core][idx].task; n++) {
+                if (slots[core][idx].task == handle) {
+                    task->ticks += slots[core][idx].ticks;
+                    break;
+                }
+                idx = (idx + 1) & MPTASKSTATS_SLOTS_MASK;
+            }
+        }
+    }
+    xTaskResumeAll();
+
+    return count;
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC IRAM_ATTR void mptaskstats_sample (uint32_t core) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandleForCPU(core);
+    uint32_t idx = ((uint32_t)task >> 2) & MPTASKSTATS_SLOTS_MASK;
+
+    portENTER_CRITICAL_ISR(&mptaskstats_mux);
+    mptaskstats_ticks[core]++;
+    // open addressing, a full table (more tasks alive than slots) just misses the sample
+    for (uint32_t n = 0; n < MPTASKSTATS_SLOTS; n++) {
+        mptaskstats_slot_t *slot = &mptaskstats_slots[core][idx];
+        if (slot->task == task) {
+            slot->ticks++;
+            break;
+        } else if (slot->task == NULL) {
+            slot->task = task;
+            slot->ticks = 1;
+            break;
+        }
+        idx = (idx + 1) & MPTASKSTATS_SLOTS_MASK;
+    }
+    portEXIT_CRITICAL_ISR(&mptaskstats_mux);
+}
+
+STATIC IRAM_ATTR void mptaskstats_tick_core0 (void) {
+    mptaskstats_sample(0);
+}
+
+#if portNUM_PROCESSORS > 1
+STATIC IRAM_ATTR void mptaskstats_tick_core1 (void) {
+    mptaskstats_sample(1);
+}
+#endif
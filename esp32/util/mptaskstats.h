@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MPTASKSTATS_H_
+#define MPTASKSTATS_H_
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MPTASKSTATS_TASKS_MAX                       (40)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+    int8_t core;                    // -1 if the task can run on both
+    uint8_t priority;
+    eTaskState state;
+    uint32_t ticks;                 // ticks spent running during the window, both cores together
+    uint32_t stack_size;            // bytes
+    uint32_t stack_free;            // the lowest it's been since the task started, bytes
+} mptaskstats_task_t;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+void mptaskstats_init0 (void);
+uint32_t mptaskstats_read (mptaskstats_task_t *tasks, uint32_t max, uint32_t *window_ticks);
+
+#endif /* MPTASKSTATS_H_ */
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "py/mpconfig.h"
+#include "py/misc.h"
+#include "py/mpprint.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include "mptrace.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MPTRACE_SIZE_MAX                            (8192)
+#define MPTRACE_TASKS_MAX                           (40)
+// ISRs have no task, they are shown as one thread per core
+#define MPTRACE_TID_ISR                             (1000)
+
+/******************************************************************************
+ DEFINE PRIVATE TYPES
+ ******************************************************************************/
+typedef struct {
+    uint32_t time_us;
+    TaskHandle_t task;
+    uint32_t arg0;
+    uint32_t arg1;
+    uint8_t event;
+    uint8_t core;
+} mptrace_entry_t;
+
+typedef struct {
+    uint8_t event;
+    char phase;
+    const char *name;
+    const char *arg0;
+    const char *arg1;
+} mptrace_event_info_t;
+
+typedef struct {
+    TaskHandle_t task;
+    char name[configMAX_TASK_NAME_LEN];
+} mptrace_thread_t;
+
+/******************************************************************************
+ DECLARE EXPORTED DATA
+ ******************************************************************************/
+volatile uint32_t mptrace_mask = 0;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+STATIC mptrace_entry_t *mptrace_ring = NULL;
+STATIC uint32_t mptrace_size = 0;
+STATIC uint32_t mptrace_head = 0;
+STATIC portMUX_TYPE mptrace_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// 'B' and 'E' pairs share the name, everything else is an instant event
+STATIC const mptrace_event_info_t mptrace_events[] = {
+    { MPTRACE_LORA_SEND,            'i', "lora_send",       "len",      "port" },
+    { MPTRACE_LORA_TX_START,        'B', "lora_tx",         "len",      NULL },
+    { MPTRACE_LORA_TX_DONE,         'E', "lora_tx",         NULL,       NULL },
+    { MPTRACE_LORA_TX_TIMEOUT,      'E', "lora_tx",         "timeout",  NULL },
+    { MPTRACE_LORA_TX_CONFIRM,      'i', "lora_tx_confirm", "status",   "retries" },
+    { MPTRACE_LORA_RX_DONE,         'i', "lora_rx",         "len",      "rssi" },
+    { MPTRACE_LORA_RX_TIMEOUT,      'i', "lora_rx_timeout", NULL,       NULL },
+    { MPTRACE_LORA_RX_ERROR,        'i', "lora_rx_error",   NULL,       NULL },
+    { MPTRACE_WLAN_EVENT,           'i', "wlan_event",      "id",       "reason" },
+    { MPTRACE_GC_COLLECT_START,     'B', "gc_collect",      NULL,       NULL },
+    { MPTRACE_GC_COLLECT_END,       'E', "gc_collect",      NULL,       NULL },
+    { MPTRACE_IRQ_QUEUE,            'i', "irq_queue",       "handler",  "priority" },
+    { MPTRACE_IRQ_DROP,             'i', "irq_drop",        "handler",  "priority" },
+    { MPTRACE_IRQ_DISPATCH_START,   'B', "irq_dispatch",    "handler",  NULL },
+    { MPTRACE_IRQ_DISPATCH_END,     'E', "irq_dispatch",    NULL,       NULL },
+    { MPTRACE_SOCK_CONNECT_START,   'B', "sock_connect",    "sd",       NULL },
+    { MPTRACE_SOCK_CONNECT_END,     'E', "sock_connect",    "sd",       "ret" },
+    { MPTRACE_SOCK_ACCEPT_START,    'B', "sock_accept",     "sd",       NULL },
+    { MPTRACE_SOCK_ACCEPT_END,      'E', "sock_accept",     "sd",       "ret" },
+    { MPTRACE_SOCK_SEND_START,      'B', "sock_send",       "sd",       "len" },
+    { MPTRACE_SOCK_SEND_END,        'E', "sock_send",       "sd",       "ret" },
+    { MPTRACE_SOCK_RECV_START,      'B', "sock_recv",       "sd",       "len" },
+    { MPTRACE_SOCK_RECV_END,        'E', "sock_recv",       "sd",       "ret" },
+};
+
+/******************************************************************************
+ DECLARE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC const mptrace_event_info_t *mptrace_event_info (uint8_t event);
+STATIC void mptrace_print_arg (const mp_print_t *print, const char *name, uint32_t value, bool *first);
+STATIC uint32_t mptrace_get_threads (mptrace_thread_t *threads, uint32_t max);
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+// runs from any task or ISR, also while the flash cache is disabled
+IRAM_ATTR void mptrace_record (uint8_t event, uint32_t arg0, uint32_t arg1) {
+    TaskHandle_t task = xPortInIsrContext() ? NULL : xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL_ISR(&mptrace_mux);
+    if (mptrace_ring != NULL) {
+        // taken inside the lock, so the ring is in time order across both cores
+        mptrace_entry_t *entry = &mptrace_ring[mptrace_head & (mptrace_size - 1)];
+        entry->time_us = (uint32_t)esp_timer_get_time();
+        entry->task = task;
+        entry->arg0 = arg0;
+        entry->arg1 = arg1;
+        entry->event = event;
+        entry->core = xPortGetCoreID();
+        mptrace_head++;
+    }
+    portEXIT_CRITICAL_ISR(&mptrace_mux);
+}
+
+// the ring is outside of the MicroPython heap, so it survives a soft reset
+bool mptrace_start (uint32_t mask, uint32_t size) {
+    uint32_t rounded = 16;
+    while (rounded < size && rounded < MPTRACE_SIZE_MAX) {
+        rounded <<= 1;
+    }
+
+    if (mptrace_ring == NULL || rounded != mptrace_size) {
+        mptrace_entry_t *ring = heap_caps_malloc(rounded * sizeof(mptrace_entry_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (ring == NULL) {
+            return false;
+        }
+        mptrace_mask = 0;
+        portENTER_CRITICAL(&mptrace_mux);
+        mptrace_entry_t *old = mptrace_ring;
+        mptrace_ring = ring;
+        mptrace_size = rounded;
+        mptrace_head = 0;
+        portEXIT_CRITICAL(&mptrace_mux);
+        free(old);
+    }
+    mptrace_mask = mask & MPTRACE_CAT_ALL;
+    return true;
+}
+
+// keeps the ring, so that it can still be dumped
+void mptrace_stop (void) {
+    mptrace_mask = 0;
+}
+
+void mptrace_gc_collect (bool start) {
+    MPTRACE(start ? MPTRACE_GC_COLLECT_START : MPTRACE_GC_COLLECT_END, 0, 0);
+}
+
+// writes the ring as Chrome Trace Event JSON, which chrome://tracing and Perfetto open as is
+void mptrace_dump (const mp_print_t *print, bool clear) {
+    static mptrace_thread_t threads[MPTRACE_TASKS_MAX];
+    uint32_t mask = mptrace_mask;
+
+    // recording stops while the ring is read, the lock waits for any writer still in flight
+    mptrace_mask = 0;
+    portENTER_CRITICAL(&mptrace_mux);
+    uint32_t head = mptrace_head;
+    portEXIT_CRITICAL(&mptrace_mux);
+
+    uint32_t count = MIN(head, mptrace_size);
+    uint32_t lost = head - count;
+    uint32_t nthreads = mptrace_get_threads(threads, MPTRACE_TASKS_MAX);
+
+    mp_printf(print, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (uint32_t i = 0; i < nthreads; i++) {
+        mp_printf(print, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                  first ? "" : ",\n", (uint32_t)threads[i].task, threads[i].name);
+        first = false;
+    }
+    for (uint32_t core = 0; core < portNUM_PROCESSORS; core++) {
+        mp_printf(print, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"ISR core %u\"}}",
+                  first ? "" : ",\n", MPTRACE_TID_ISR + core, core);
+        first = false;
+    }
+
+    // the timestamps are relative to the oldest entry, the 32 bit deltas unwrap the microsecond counter
+    uint32_t ts = 0;
+    uint32_t prev = 0;
+    for (uint32_t i = head - count; i != head; i++) {
+        const mptrace_entry_t *entry = &mptrace_ring[i & (mptrace_size - 1)];
+        const mptrace_event_info_t *info = mptrace_event_info(entry->event);
+        if (info == NULL) {
+            continue;
+        }
+        if (i != head - count) {
+            ts += entry->time_us - prev;
+        }
+        prev = entry->time_us;
+        uint32_t tid = entry->task ? (uint32_t)entry->task : MPTRACE_TID_ISR + entry->core;
+
+        mp_printf(print, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%u,\"pid\":1,\"tid\":%u",
+                  info->name, info->phase, ts, tid);
+        if (info->phase == 'i') {
+            mp_printf(print, ",\"s\":\"t\"");
+        }
+        bool first_arg = true;
+        mptrace_print_arg(print, info->arg0, entry->arg0, &first_arg);
+        mptrace_print_arg(print, info->arg1, entry->arg1, &first_arg);
+        mp_printf(print, "%s}", first_arg ? "" : "}");
+    }
+    mp_printf(print, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"lost\":%u}}\n", lost);
+
+    if (clear) {
+        portENTER_CRITICAL(&mptrace_mux);
+        mptrace_head = 0;
+        portEXIT_CRITICAL(&mptrace_mux);
+    }
+    mptrace_mask = mask;
+}
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC const mptrace_event_info_t *mptrace_event_info (uint8_t event) {
+    for (uint32_t i = 0; i < MP_ARRAY_SIZE(mptrace_events); i++) {
+        if (mptrace_events[i].event == event) {
+            return &mptrace_events[i];
+        }
+    }
+    return NULL;
+}
+
+STATIC void mptrace_print_arg (const mp_print_t *print, const char *name, uint32_t value, bool *first) {
+    if (name != NULL) {
+        mp_printf(print, "%s\"%s\":%d", *first ? ",\"args\":{" : ",", name, (int32_t)value);
+        *first = false;
+    }
+}
+
+// the names of the tasks alive now, the entries of deleted tasks still show with their handle
+STATIC uint32_t mptrace_get_threads (mptrace_thread_t *threads, uint32_t max) {
+    TaskSnapshot_t snapshot[MPTRACE_TASKS_MAX];
+    UBaseType_t tcb_size;
+
+    vTaskSuspendAll();
+    uint32_t count = uxTaskGetSnapshotAll(snapshot, MIN(max, MPTRACE_TASKS_MAX), &tcb_size);
+    for (uint32_t i = 0; i < count; i++) {
+        threads[i].task = (TaskHandle_t)snapshot[i].pxTCB;
+        strlcpy(threads[i].name, pcTaskGetTaskName(threads[i].task), sizeof(threads[i].name));
+    }
+    xTaskResumeAll();
+    return count;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MPTRACE_H_
+#define MPTRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "py/mpprint.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// the category of an event is in its upper nibble
+#define MPTRACE_CAT_LORA                            (1 << 0)
+#define MPTRACE_CAT_WLAN                            (1 << 1)
+#define MPTRACE_CAT_GC                              (1 << 2)
+#define MPTRACE_CAT_IRQ                             (1 << 3)
+#define MPTRACE_CAT_SOCKET                          (1 << 4)
+#define MPTRACE_CAT_ALL                             (0x1F)
+
+#define MPTRACE_SIZE_DEFAULT                        (512)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef enum {
+    MPTRACE_LORA_SEND = 0x00,
+    MPTRACE_LORA_TX_START,
+    MPTRACE_LORA_TX_DONE,
+    MPTRACE_LORA_TX_TIMEOUT,
+    MPTRACE_LORA_TX_CONFIRM,
+    MPTRACE_LORA_RX_DONE,
+    MPTRACE_LORA_RX_TIMEOUT,
+    MPTRACE_LORA_RX_ERROR,
+
+    MPTRACE_WLAN_EVENT = 0x10,
+
+    MPTRACE_GC_COLLECT_START = 0x20,
+    MPTRACE_GC_COLLECT_END,
+
+    MPTRACE_IRQ_QUEUE = 0x30,
+    MPTRACE_IRQ_DROP,
+    MPTRACE_IRQ_DISPATCH_START,
+    MPTRACE_IRQ_DISPATCH_END,
+
+    MPTRACE_SOCK_CONNECT_START = 0x40,
+    MPTRACE_SOCK_CONNECT_END,
+    MPTRACE_SOCK_ACCEPT_START,
+    MPTRACE_SOCK_ACCEPT_END,
+    MPTRACE_SOCK_SEND_START,
+    MPTRACE_SOCK_SEND_END,
+    MPTRACE_SOCK_RECV_START,
+    MPTRACE_SOCK_RECV_END,
+} mptrace_event_t;
+
+/******************************************************************************
+ DECLARE EXPORTED DATA
+ ******************************************************************************/
+extern volatile uint32_t mptrace_mask;
+
+/******************************************************************************
+ DEFINE MACROS
+ ******************************************************************************/
+// costs a load and a branch while the category is off, safe in an ISR and with the cache disabled
+#define MPTRACE(event, arg0, arg1)                  do { \
+                                                        if (mptrace_mask & (1 << ((event) >> 4))) { \
+                                                            mptrace_record((event), (uint32_t)(arg0), (uint32_t)(arg1)); \
+                                                        } \
+                                                    } while (0)
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+void mptrace_record (uint8_t event, uint32_t arg0, uint32_t arg1);
+bool mptrace_start (uint32_t mask, uint32_t size);
+void mptrace_stop (void);
+void mptrace_gc_collect (bool start);
+void mptrace_dump (const mp_print_t *print, bool clear);
+
+#endif /* MPTRACE_H_ */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_clk.h"
+#include "driver/adc.h"
+#include "driver/rtc_io.h"
+#include "soc/soc.h"
+#include "soc/rtc.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/rtc_io_reg.h"
+#include "soc/sens_reg.h"
+#include "soc/uart_reg.h"
+
+#include "mpwakestub.h"
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// SENS_FORCE_XPD_SAR values, the ADC is powered only while sampling
+#define MPWAKESTUB_XPD_SAR_FSM                  (0)
+#define MPWAKESTUB_XPD_SAR_PU                   (3)
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+static RTC_DATA_ATTR mpwakestub_config_t mpwakestub;
+
+// stub results of the deep sleep cycles that led to this boot
+static uint32_t mpwakestub_skips;
+static uint16_t mpwakestub_adc_value;
+
+// ADC1 channel of each GPIO, -1 if not an ADC1 pad
+static const int8_t mpwakestub_adc1_channels[40] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  4,  5,  6,  7,  0,  1,  2,  3,
+};
+
+/******************************************************************************
+ DEFINE WAKE STUB FUNCTIONS (RTC fast memory, nothing in flash can be used)
+ ******************************************************************************/
+static uint16_t RTC_IRAM_ATTR mpwakestub_adc_read (uint8_t channel) {
+    // mpwakestub_arm() left the ADC in RTC mode with the channel configured
+    REG_SET_FIELD(SENS_SAR_MEAS_WAIT2_REG, SENS_FORCE_XPD_SAR, MPWAKESTUB_XPD_SAR_PU);
+    REG_SET_FIELD(SENS_SAR_MEAS_START1_REG, SENS_SAR1_EN_PAD, (1 << channel));
+    REG_CLR_BIT(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_START_SAR);
+    REG_SET_BIT(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_START_SAR);
+    while (!REG_GET_BIT(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_DONE_SAR));
+    uint16_t value = REG_GET_FIELD(SENS_SAR_MEAS_START1_REG, SENS_MEAS1_DATA_SAR);
+    REG_SET_FIELD(SENS_SAR_MEAS_WAIT2_REG, SENS_FORCE_XPD_SAR, MPWAKESTUB_XPD_SAR_FSM);
+    return value;
+}
+
+static void RTC_IRAM_ATTR mpwakestub_sleep (void) {
+    // let the ROM finish printing the reset reason
+    while (REG_GET_FIELD(UART_STATUS_REG(0), UART_ST_UTX_OUT));
+
+    // the wake up timer counts from now on
+    SET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_UPDATE);
+    while (!GET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_VALID));
+    uint64_t now = READ_PERI_REG(RTC_CNTL_TIME0_REG) | ((uint64_t)READ_PERI_REG(RTC_CNTL_TIME1_REG) << 32);
+    uint64_t wakeup = now + (mpwakestub.period_lo | ((uint64_t)mpwakestub.period_hi << 32));
+    WRITE_PERI_REG(RTC_CNTL_SLP_TIMER0_REG, wakeup & UINT32_MAX);
+    WRITE_PERI_REG(RTC_CNTL_SLP_TIMER1_REG, wakeup >> 32);
+
+    // come back here and sleep
+    REG_WRITE(RTC_ENTRY_ADDR_REG, (uint32_t)&esp_wake_deep_sleep);
+    CLEAR_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_SLEEP_EN);
+    SET_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_SLEEP_EN);
+    for ( ; ; );
+}
+
+// overrides the IDF one, runs on every deep sleep wake up before the bootloader
+void RTC_IRAM_ATTR esp_wake_deep_sleep (void) {
+    esp_default_wake_deep_sleep();
+
+    // only the timer wakes are filtered, pin wake ups always boot
+    if (mpwakestub.magic != MPWAKESTUB_MAGIC ||
+        !(REG_GET_FIELD(RTC_CNTL_WAKEUP_STATE_REG, RTC_CNTL_WAKEUP_CAUSE) & RTC_TIMER_TRIG_EN)) {
+        return;
+    }
+    if (mpwakestub.max_skips > 0 && mpwakestub.skips >= mpwakestub.max_skips) {
+        return;
+    }
+    if (mpwakestub.rtc_pins) {
+        uint32_t in = REG_GET_FIELD(RTC_GPIO_IN_REG, RTC_GPIO_IN_NEXT);
+        if (~(in ^ mpwakestub.rtc_levels) & mpwakestub.rtc_pins) {
+            return;
+        }
+    }
+    if (mpwakestub.adc_channel != MPWAKESTUB_ADC_NONE) {
+        mpwakestub.adc_value = mpwakestub_adc_read(mpwakestub.adc_channel);
+        if (mpwakestub.adc_value < mpwakestub.adc_low || mpwakestub.adc_value > mpwakestub.adc_high) {
+            return;
+        }
+    }
+    // nothing interesting, back to sleep without booting
+    mpwakestub.skips++;
+    mpwakestub_sleep();
+}
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void mpwakestub_init0 (void) {
+    if (mpwakestub.magic == MPWAKESTUB_MAGIC) {
+        mpwakestub_skips = mpwakestub.skips;
+        mpwakestub_adc_value = mpwakestub.adc_value;
+        mpwakestub.skips = 0;
+    }
+}
+
+bool mpwakestub_config (int8_t adc_gpio, uint16_t adc_low, uint16_t adc_high, const uint8_t *gpios,
+                        uint32_t n_gpios, uint32_t levels, uint32_t max_skips) {
+    mpwakestub_config_t config;
+    memset(&config, 0, sizeof(config));
+
+    config.adc_channel = MPWAKESTUB_ADC_NONE;
+    if (adc_gpio >= 0) {
+        if (adc_gpio >= sizeof(mpwakestub_adc1_channels) || mpwakestub_adc1_channels[adc_gpio] < 0) {
+            return false;
+        }
+        config.adc_channel = mpwakestub_adc1_channels[adc_gpio];
+    }
+    for (int i = 0; i < n_gpios; i++) {
+        if (!rtc_gpio_is_valid_gpio(gpios[i])) {
+            return false;
+        }
+        uint32_t rtc_pin = 1 << rtc_gpio_desc[gpios[i]].rtc_num;
+        config.rtc_pins |= rtc_pin;
+        if (levels & (1 << i)) {
+            config.rtc_levels |= rtc_pin;
+        }
+    }
+    config.adc_low = adc_low;
+    config.adc_high = adc_high;
+    config.max_skips = max_skips;
+    config.magic = MPWAKESTUB_MAGIC;
+    mpwakestub = config;
+    return true;
+}
+
+void mpwakestub_disable (void) {
+    mpwakestub.magic = 0;
+}
+
+void mpwakestub_arm (uint64_t sleep_us) {
+    if (mpwakestub.magic != MPWAKESTUB_MAGIC) {
+        return;
+    }
+    uint64_t period = rtc_time_us_to_slowclk(sleep_us, esp_clk_slowclk_cal_get());
+    mpwakestub.period_lo = period & UINT32_MAX;
+    mpwakestub.period_hi = period >> 32;
+    mpwakestub.skips = 0;
+
+    // the stub reads the pads through the RTC peripherals, keep them configured while sleeping
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    for (int gpio = 0; gpio < GPIO_PIN_COUNT; gpio++) {
+        if (rtc_gpio_is_valid_gpio(gpio) && (mpwakestub.rtc_pins & (1 << rtc_gpio_desc[gpio].rtc_num))) {
+            rtc_gpio_init(gpio);
+            rtc_gpio_set_direction(gpio, RTC_GPIO_MODE_INPUT_ONLY);
+        }
+    }
+    if (mpwakestub.adc_channel != MPWAKESTUB_ADC_NONE) {
+        adc1_config_width(ADC_WIDTH_BIT_12);
+        adc1_config_channel_atten(mpwakestub.adc_channel, ADC_ATTEN_DB_11);
+        // a first conversion switches the ADC to RTC control
+        mpwakestub.adc_value = adc1_get_raw(mpwakestub.adc_channel);
+        adc_power_off();
+    }
+}
+
+void mpwakestub_get_stats (uint32_t *skips, uint16_t *adc_value) {
+    *skips = mpwakestub_skips;
+    *adc_value = mpwakestub_adc_value;
+}
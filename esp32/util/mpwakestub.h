@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef MPWAKESTUB_H_
+#define MPWAKESTUB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+#define MPWAKESTUB_MAGIC                        (0x5354554B)    // "KUTS"
+#define MPWAKESTUB_ADC_NONE                     (0xFF)
+#define MPWAKESTUB_ADC_MAX                      (4095)          // 12 bit samples
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// kept in RTC slow memory, read by the wake stub before the bootloader runs
+typedef struct {
+    uint32_t    magic;          // MPWAKESTUB_MAGIC while the stub is enabled
+    uint32_t    period_lo;      // deep sleep period in RTC slow clock ticks
+    uint32_t    period_hi;
+    uint32_t    rtc_pins;       // RTC GPIO numbers checked on wake up
+    uint32_t    rtc_levels;     // level that makes a pin worth booting for
+    uint32_t    max_skips;      // boot anyway after that many skipped wakes, 0 for never
+    uint32_t    skips;          // wakes handled by the stub since the last boot
+    uint16_t    adc_low;        // booting if the sample is outside [adc_low, adc_high]
+    uint16_t    adc_high;
+    uint16_t    adc_value;      // last sample taken
+    uint8_t     adc_channel;    // ADC1 channel, MPWAKESTUB_ADC_NONE if not sampled
+} mpwakestub_config_t;
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+extern void mpwakestub_init0 (void);
+extern bool mpwakestub_config (int8_t adc_gpio, uint16_t adc_low, uint16_t adc_high, const uint8_t *gpios,
+                               uint32_t n_gpios, uint32_t levels, uint32_t max_skips);
+extern void mpwakestub_disable (void);
+extern void mpwakestub_arm (uint64_t sleep_us);
+extern void mpwakestub_get_stats (uint32_t *skips, uint16_t *adc_value);
+
+#endif /* MPWAKESTUB_H_ */
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+
+#include "py/mpconfig.h"
+#include "py/misc.h"
+
+#include "nativecode.h"
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+// IRAM can only be accessed 32 bits at a time, the header is made of words too
+typedef struct _nativecode_block_t {
+    struct _nativecode_block_t *next;
+    uint32_t size;
+    uint32_t code[];
+} nativecode_block_t;
+
+/******************************************************************************
+ DECLARE PRIVATE DATA
+ ******************************************************************************/
+// the blocks are out of reach of the GC, a function object dropped by the
+// program can't release its code so everything goes at soft reset
+static nativecode_block_t *nativecode_blocks;
+
+/******************************************************************************
+ DEFINE PUBLIC FUNCTIONS
+ ******************************************************************************/
+void *nativecode_commit(void *buf, size_t len) {
+    size_t words = (len + 3) / 4;
+    size_t size = sizeof(nativecode_block_t) + words * 4;
+    nativecode_block_t *block = heap_caps_malloc(size, MALLOC_CAP_EXEC | MALLOC_CAP_32BIT);
+    if (block == NULL) {
+        m_malloc_fail(size);
+    }
+
+    // copy word by word, the last one padded with zeros
+    const uint8_t *src = buf;
+    for (size_t i = 0; i < words; i++, src += 4, len -= 4) {
+        uint32_t w = 0;
+        memcpy(&w, src, len < 4 ? len : 4);
+        block->code[i] = w;
+    }
+
+    block->size = size;
+    block->next = nativecode_blocks;
+    nativecode_blocks = block;
+    return block->code;
+}
+
+void nativecode_free_all(void) {
+    while (nativecode_blocks != NULL) {
+        nativecode_block_t *next = nativecode_blocks->next;
+        heap_caps_free(nativecode_blocks);
+        nativecode_blocks = next;
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef ESP32_UTIL_NATIVECODE_H_
+#define ESP32_UTIL_NATIVECODE_H_
+
+#include <stddef.h>
+
+/******************************************************************************
+ DECLARE FUNCTIONS
+ ******************************************************************************/
+// copies the code generated in the GC heap to IRAM, returns where it can run from
+extern void *nativecode_commit(void *buf, size_t len);
+// frees all the committed code, only when nothing can run it anymore (soft reset)
+extern void nativecode_free_all(void);
+
+#endif /* ESP32_UTIL_NATIVECODE_H_ */
@@ -8,11 +8,18 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "py/obj.h"
+#include "py/runtime.h"
 #include "random.h"
 #include "esp_system.h"
+#include "bootloader_random.h"
 #include "machrtc.h"
+#include "modwlan.h"
+#include "modbt.h"
+#include "pybadc.h"
+#include "pybdac.h"
 
 /******************************************************************************
 * LOCAL TYPES
@@ -48,6 +55,13 @@ STATIC mp_obj_t machine_rng_get(void) {
 }
 MP_DEFINE_CONST_FUN_OBJ_0(machine_rng_get_obj, machine_rng_get);
 
+STATIC mp_obj_t machine_rng_into(mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    return mp_obj_new_bool(rng_fill(bufinfo.buf, bufinfo.len));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(machine_rng_into_obj, machine_rng_into);
+
 /******************************************************************************
 * PUBLIC FUNCTIONS
 ******************************************************************************/
@@ -76,3 +90,34 @@ uint32_t rng_get (void) {
     s_seed = lfsr(s_seed);
     return s_seed;
 }
+
+/*
+ * fills buf from the hardware RNG. Its output is only truly random while the RF
+ * subsystem runs, or while the SAR ADC feeds it noise as the bootloader does.
+ * The later is set up here for the duration of the call, unless the ADC or the
+ * I2S peripheral it borrows are in use. Returns false when neither source was
+ * available and the bytes are only pseudo random.
+ */
+bool rng_fill (uint8_t *buf, size_t len) {
+    bool rf_on = wlan_obj.started || modbt_is_enabled();
+    bool adc_noise = !rf_on && !pyb_adc_in_use() && !pyb_dac_wave_in_use();
+
+    if (adc_noise) {
+        bootloader_random_enable();
+    }
+    // esp_random() spaces the reads of the RNG register by itself
+    while (len >= sizeof(uint32_t)) {
+        uint32_t word = esp_random();
+        memcpy(buf, &word, sizeof(word));
+        buf += sizeof(word);
+        len -= sizeof(word);
+    }
+    if (len > 0) {
+        uint32_t word = esp_random();
+        memcpy(buf, &word, len);
+    }
+    if (adc_noise) {
+        bootloader_random_disable();
+    }
+    return rf_on || adc_noise;
+}
@@ -10,9 +10,15 @@
 #ifndef __RANDOM_H
 #define __RANDOM_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 void rng_init0 (void);
 uint32_t rng_get (void);
+bool rng_fill (uint8_t *buf, size_t len);
 
 MP_DECLARE_CONST_FUN_OBJ_0(machine_rng_get_obj);
+MP_DECLARE_CONST_FUN_OBJ_1(machine_rng_into_obj);
 
 #endif // __RANDOM_H
@@ -11,80 +11,47 @@
 #include <stdbool.h>
 #include <string.h>
 
-#include "fifo.h"
 #include "socketfifo.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-/*----------------------------------------------------------------------------
- ** Declare private functions
- */
-static void socketfifo_Push (void * const pvFifo, const void * const pvElement);
-static void socketfifo_Pop (void * const pvFifo, void * const pvElement);
-
-/*----------------------------------------------------------------------------
- ** Declare private data
- */
-static FIFO_t *socketfifo;
-
 /*----------------------------------------------------------------------------
  ** Define public functions
  */
-void SOCKETFIFO_Init (FIFO_t *fifo, void *elements, uint32_t maxcount) {
-    // Initialize global data
-    socketfifo = fifo;
-    socketfifo->pvElements = elements;
-    FIFO_Init (socketfifo, maxcount, socketfifo_Push, socketfifo_Pop);
+void SOCKETFIFO_Init (spsc_ring_t *fifo, void *elements, uint32_t maxcount) {
+    spsc_ring_init (fifo, elements, maxcount, sizeof(SocketFifoElement_t));
 }
 
-bool SOCKETFIFO_Push (const void * const element) {
-    return FIFO_bPushElement (socketfifo, element);
+bool SOCKETFIFO_Push (spsc_ring_t *fifo, const void * const element) {
+    return spsc_ring_push (fifo, element);
 }
 
-bool SOCKETFIFO_Pop (void * const element) {
-    return FIFO_bPopElement (socketfifo, element);
+bool SOCKETFIFO_Pop (spsc_ring_t *fifo, void * const element) {
+    return spsc_ring_pop (fifo, element);
 }
 
-bool SOCKETFIFO_Peek (void * const element) {
-    return FIFO_bPeekElement (socketfifo, element);
+bool SOCKETFIFO_Peek (spsc_ring_t *fifo, void * const element) {
+    return spsc_ring_front (fifo, element);
 }
 
-bool SOCKETFIFO_IsEmpty (void) {
-    return FIFO_IsEmpty (socketfifo);
+bool SOCKETFIFO_IsEmpty (spsc_ring_t *fifo) {
+    return spsc_ring_is_empty (fifo);
 }
 
-bool SOCKETFIFO_IsFull (void) {
-    return FIFO_IsFull (socketfifo);
+bool SOCKETFIFO_IsFull (spsc_ring_t *fifo) {
+    return spsc_ring_is_full (fifo);
 }
 
-void SOCKETFIFO_Flush (void) {
+void SOCKETFIFO_Flush (spsc_ring_t *fifo) {
     SocketFifoElement_t element;
-    while (SOCKETFIFO_Pop(&element)) {
+    while (SOCKETFIFO_Pop(fifo, &element)) {
         if (element.freedata) {
             vPortFree(element.data);
         }
     }
 }
 
-unsigned int SOCKETFIFO_Count (void) {
-    return socketfifo->uiElementCount;
+unsigned int SOCKETFIFO_Count (spsc_ring_t *fifo) {
+    return spsc_ring_count (fifo);
 }
-
-/*----------------------------------------------------------------------------
- ** Define private functions
- */
-static void socketfifo_Push (void * const pvFifo, const void * const pvElement) {
-    if ((pvFifo != NULL) && (NULL != pvElement)) {
-        unsigned int uiLast = ((FIFO_t *)pvFifo)->uiLast;
-        memcpy (&((SocketFifoElement_t *)((FIFO_t *)pvFifo)->pvElements)[uiLast], pvElement, sizeof(SocketFifoElement_t));
-    }
-}
-
-static void socketfifo_Pop (void * const pvFifo, void * const pvElement) {
-    if ((pvFifo != NULL) && (NULL != pvElement)) {
-        unsigned int uiFirst = ((FIFO_t *)pvFifo)->uiFirst;
-        memcpy (pvElement, &((SocketFifoElement_t *)((FIFO_t *)pvFifo)->pvElements)[uiFirst], sizeof(SocketFifoElement_t));
-    }
-}
-
@@ -13,6 +13,7 @@
 /*----------------------------------------------------------------------------
  ** Imports
  */
+#include "spscring.h"
 
 /*----------------------------------------------------------------------------
  ** Define constants
@@ -34,13 +35,14 @@ typedef struct {
 /*----------------------------------------------------------------------------
  ** Declare public functions
  */
-extern void SOCKETFIFO_Init (FIFO_t *fifo, void *elements, uint32_t maxcount);
-extern bool SOCKETFIFO_Push (const void * const element);
-extern bool SOCKETFIFO_Pop (void * const element);
-extern bool SOCKETFIFO_Peek (void * const element);
-extern bool SOCKETFIFO_IsEmpty (void);
-extern bool SOCKETFIFO_IsFull (void);
-extern void SOCKETFIFO_Flush (void);
-extern unsigned int SOCKETFIFO_Count (void);
+// maxcount must be a power of 2
+extern void SOCKETFIFO_Init (spsc_ring_t *fifo, void *elements, uint32_t maxcount);
+extern bool SOCKETFIFO_Push (spsc_ring_t *fifo, const void * const element);
+extern bool SOCKETFIFO_Pop (spsc_ring_t *fifo, void * const element);
+extern bool SOCKETFIFO_Peek (spsc_ring_t *fifo, void * const element);
+extern bool SOCKETFIFO_IsEmpty (spsc_ring_t *fifo);
+extern bool SOCKETFIFO_IsFull (spsc_ring_t *fifo);
+extern void SOCKETFIFO_Flush (spsc_ring_t *fifo);
+extern unsigned int SOCKETFIFO_Count (spsc_ring_t *fifo);
 
 #endif /* SOCKETFIFO_H_ */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ ** Single producer, single consumer ring of fixed size elements (bytes when
+ ** elem_size is 1). It takes no lock: head is only written by the producer and
+ ** tail only by the consumer, each one publishing its index with release
+ ** semantics after touching the storage. One side can run in an ISR or on the
+ ** other core. Both indexes are free running, so the capacity must be a power
+ ** of 2 and all of it is usable.
+ **
+ ** The reserve/commit and peek/release pairs hand out the contiguous part of
+ ** the free or filled space, to fill or drain the ring in place without a copy.
+ */
+
+/*----------------------------------------------------------------------------
+ ** Define types
+ */
+typedef struct {
+    uint8_t             *storage;
+    uint32_t            capacity;   // in elements, power of 2
+    uint32_t            elem_size;  // in bytes
+    volatile uint32_t   head;       // free running write index, only moved by the producer
+    volatile uint32_t   tail;       // free running read index, only moved by the consumer
+} spsc_ring_t;
+
+/*----------------------------------------------------------------------------
+ ** Define public functions
+ */
+static inline void spsc_ring_init (spsc_ring_t *ring, void *storage, uint32_t capacity, uint32_t elem_size) {
+    ring->storage = storage;
+    ring->capacity = capacity;
+    ring->elem_size = elem_size;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+static inline uint32_t spsc_ring_count (const spsc_ring_t *ring) {
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t spsc_ring_space (const spsc_ring_t *ring) {
+    return ring->capacity - spsc_ring_count(ring);
+}
+
+static inline bool spsc_ring_is_empty (const spsc_ring_t *ring) {
+    return spsc_ring_count(ring) == 0;
+}
+
+static inline bool spsc_ring_is_full (const spsc_ring_t *ring) {
+    return spsc_ring_count(ring) == ring->capacity;
+}
+
+static inline uint8_t *spsc_ring_slot (const spsc_ring_t *ring, uint32_t index) {
+    return &ring->storage[(index & (ring->capacity - 1)) * ring->elem_size];
+}
+
+/*
+ * producer side: up to *count free elements in one piece, *count is updated
+ * with what is available. Nothing is visible to the consumer before commit.
+ */
+static inline void *spsc_ring_reserve (spsc_ring_t *ring, uint32_t *count) {
+    uint32_t head = ring->head;
+    uint32_t space = ring->capacity - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+    uint32_t contiguous = ring->capacity - (head & (ring->capacity - 1));
+
+    if (*count > space) {
+        *count = space;
+    }
+    if (*count > contiguous) {
+        *count = contiguous;
+    }
+    return (*count > 0) ? spsc_ring_slot(ring, head) : NULL;
+}
+
+static inline void spsc_ring_commit (spsc_ring_t *ring, uint32_t count) {
+    __atomic_store_n(&ring->head, ring->head + count, __ATOMIC_RELEASE);
+}
+
+/*
+ * consumer side: up to *count filled elements in one piece, they stay in the
+ * ring until released
+ */
+static inline void *spsc_ring_peek (spsc_ring_t *ring, uint32_t *count) {
+    uint32_t tail = ring->tail;
+    uint32_t filled = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+    uint32_t contiguous = ring->capacity - (tail & (ring->capacity - 1));
+
+    if (*count > filled) {
+        *count = filled;
+    }
+    if (*count > contiguous) {
+        *count = contiguous;
+    }
+    return (*count > 0) ? spsc_ring_slot(ring, tail) : NULL;
+}
+
+static inline void spsc_ring_release (spsc_ring_t *ring, uint32_t count) {
+    __atomic_store_n(&ring->tail, ring->tail + count, __ATOMIC_RELEASE);
+}
+
+/*
+ * copies up to count elements in, wrapping around, returns how many went in
+ */
+static inline uint32_t spsc_ring_write (spsc_ring_t *ring, const void *src, uint32_t count) {
+    uint32_t done = 0;
+
+    while (done < count) {
+        uint32_t n = count - done;
+        void *dst = spsc_ring_reserve(ring, &n);
+        if (dst == NULL) {
+            break;
+        }
+        memcpy(dst, (const uint8_t *)src + done * ring->elem_size, n * ring->elem_size);
+        spsc_ring_commit(ring, n);
+        done += n;
+    }
+    return done;
+}
+
+/*
+ * copies up to count elements out, wrapping around, returns how many came out
+ */
+static inline uint32_t spsc_ring_read (spsc_ring_t *ring, void *dst, uint32_t count) {
+    uint32_t done = 0;
+
+    while (done < count) {
+        uint32_t n = count - done;
+        const void *src = spsc_ring_peek(ring, &n);
+        if (src == NULL) {
+            break;
+        }
+        memcpy((uint8_t *)dst + done * ring->elem_size, src, n * ring->elem_size);
+        spsc_ring_release(ring, n);
+        done += n;
+    }
+    return done;
+}
+
+static inline bool spsc_ring_push (spsc_ring_t *ring, const void *elem) {
+    return spsc_ring_write(ring, elem, 1) == 1;
+}
+
+static inline bool spsc_ring_pop (spsc_ring_t *ring, void *elem) {
+    return spsc_ring_read(ring, elem, 1) == 1;
+}
+
+// the oldest element stays in the ring
+static inline bool spsc_ring_front (spsc_ring_t *ring, void *elem) {
+    uint32_t n = 1;
+    const void *src = spsc_ring_peek(ring, &n);
+
+    if (src == NULL) {
+        return false;
+    }
+    memcpy(elem, src, ring->elem_size);
+    return true;
+}
+
+// consumer side, drops everything queued so far
+static inline void spsc_ring_flush (spsc_ring_t *ring) {
+    __atomic_store_n(&ring->tail, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+#endif /* SPSCRING_H_ */
@@ -348,8 +348,8 @@ STATIC mp_obj_t mod_btree_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t
         MP_ARRAY_SIZE(allowed_args), allowed_args, (mp_arg_val_t*)&args);
     BTREEINFO openinfo = {0};
     openinfo.flags = args.flags.u_int;
-    openinfo.cachesize = args.cachesize.u_int;
-    openinfo.psize = args.pagesize.u_int;
+    openinfo.cachesize = args.cachesize.u_int ? args.cachesize.u_int : MICROPY_PY_BTREE_CACHESIZE;
+    openinfo.psize = args.pagesize.u_int ? args.pagesize.u_int : MICROPY_PY_BTREE_PAGESIZE;
     openinfo.minkeypage = args.minkeypage.u_int;
 
     DB *db = __bt_open(MP_OBJ_TO_PTR(pos_args[0]), &btree_stream_fvtable, &openinfo, /*dflags*/0);
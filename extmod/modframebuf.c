@@ -31,6 +31,8 @@
 
 #if MICROPY_PY_FRAMEBUF
 
+#include "extmod/modframebuf.h"
+
 #include "ports/stm32/font_petme128_8x8.h"
 
 typedef struct _mp_obj_framebuf_t {
@@ -39,6 +41,9 @@ typedef struct _mp_obj_framebuf_t {
     void *buf;
     uint16_t width, height, stride;
     uint8_t format;
+    // bounding box of everything drawn since the dirty state was last cleared,
+    // empty while dirty_x1 <= dirty_x0
+    uint16_t dirty_x0, dirty_y0, dirty_x1, dirty_y1;
 } mp_obj_framebuf_t;
 
 typedef void (*setpixel_t)(const mp_obj_framebuf_t*, int, int, uint32_t);
@@ -124,11 +129,23 @@ STATIC uint32_t rgb565_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
 
 STATIC void rgb565_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
     uint16_t *b = &((uint16_t*)fb->buf)[x + y * fb->stride];
+    // store two pixels per 32 bit word once the line is word aligned
+    uint32_t col2 = (col & 0xffff) | (col << 16);
     while (h--) {
-        for (int ww = w; ww; --ww) {
-            *b++ = col;
+        uint16_t *p = b;
+        int ww = w;
+        if ((uintptr_t)p & 2) {
+            *p++ = col;
+            --ww;
+        }
+        for (uint32_t *p2 = (uint32_t*)p; ww >= 2; ww -= 2) {
+            *p2++ = col2;
+            p = (uint16_t*)p2;
         }
-        b += fb->stride - w;
+        if (ww) {
+            *p = col;
+        }
+        b += fb->stride;
     }
 }
 
@@ -244,7 +261,29 @@ static inline uint32_t getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
     return formats[fb->format].getpixel(fb, x, y);
 }
 
-STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+// adds the rectangle, clipped to the framebuffer, to the dirty region
+STATIC void mark_dirty(mp_obj_framebuf_t *fb, int x, int y, int w, int h) {
+    if (h < 1 || w < 1 || x + w <= 0 || y + h <= 0 || y >= fb->height || x >= fb->width) {
+        return;
+    }
+    int xend = MIN(fb->width, x + w);
+    int yend = MIN(fb->height, y + h);
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+    if (fb->dirty_x1 <= fb->dirty_x0) {
+        fb->dirty_x0 = x;
+        fb->dirty_y0 = y;
+        fb->dirty_x1 = xend;
+        fb->dirty_y1 = yend;
+    } else {
+        fb->dirty_x0 = MIN(fb->dirty_x0, x);
+        fb->dirty_y0 = MIN(fb->dirty_y0, y);
+        fb->dirty_x1 = MAX(fb->dirty_x1, xend);
+        fb->dirty_y1 = MAX(fb->dirty_y1, yend);
+    }
+}
+
+STATIC void fill_rect(mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
     if (h < 1 || w < 1 || x + w <= 0 || y + h <= 0 || y >= fb->height || x >= fb->width) {
         // No operation needed.
         return;
@@ -257,6 +296,58 @@ STATIC void fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, u
     y = MAX(y, 0);
 
     formats[fb->format].fill_rect(fb, x, y, xend - x, yend - y, col);
+    mark_dirty(fb, x, y, xend - x, yend - y);
+}
+
+// Widens the dirty rectangle to whole bytes of the buffer and describes the
+// memory behind it, returns false when nothing was drawn. For MONO_VLSB a line
+// is a page of 8 rows, for the horizontal formats x is rounded out to a byte.
+STATIC bool framebuf_dirty_region(const mp_obj_framebuf_t *fb, int *rect, mp_framebuf_region_t *region) {
+    if (fb->dirty_x1 <= fb->dirty_x0) {
+        return false;
+    }
+    int x = fb->dirty_x0, y = fb->dirty_y0, xend = fb->dirty_x1, yend = fb->dirty_y1;
+    const uint8_t *buf = fb->buf;
+    switch (fb->format) {
+        case FRAMEBUF_MVLSB:
+            y &= ~7;
+            yend = (yend + 7) & ~7;
+            region->buf = &buf[(y >> 3) * fb->stride + x];
+            region->line_len = xend - x;
+            region->line_stride = fb->stride;
+            region->lines = (yend - y) >> 3;
+            yend = MIN(yend, fb->height);
+            break;
+        case FRAMEBUF_RGB565:
+            region->buf = &buf[(x + y * fb->stride) * 2];
+            region->line_len = (xend - x) * 2;
+            region->line_stride = fb->stride * 2;
+            region->lines = yend - y;
+            break;
+        case FRAMEBUF_GS8:
+            region->buf = &buf[x + y * fb->stride];
+            region->line_len = xend - x;
+            region->line_stride = fb->stride;
+            region->lines = yend - y;
+            break;
+        default: {
+            // pixels per byte, the stride is already a multiple of it
+            int ppb = (fb->format == FRAMEBUF_GS4_HMSB) ? 2 : (fb->format == FRAMEBUF_GS2_HMSB) ? 4 : 8;
+            x &= ~(ppb - 1);
+            xend = (xend + ppb - 1) & ~(ppb - 1);
+            region->buf = &buf[(x + y * fb->stride) / ppb];
+            region->line_len = (xend - x) / ppb;
+            region->line_stride = fb->stride / ppb;
+            region->lines = yend - y;
+            xend = MIN(xend, fb->width);
+            break;
+        }
+    }
+    rect[0] = x;
+    rect[1] = y;
+    rect[2] = xend - x;
+    rect[3] = yend - y;
+    return true;
 }
 
 STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
@@ -299,6 +390,11 @@ STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size
             mp_raise_ValueError("invalid format");
     }
 
+    // the first transfer has to send everything
+    o->dirty_x0 = o->dirty_y0 = 0;
+    o->dirty_x1 = o->width;
+    o->dirty_y1 = o->height;
+
     return MP_OBJ_FROM_PTR(o);
 }
 
@@ -315,6 +411,7 @@ STATIC mp_obj_t framebuf_fill(mp_obj_t self_in, mp_obj_t col_in) {
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t col = mp_obj_get_int(col_in);
     formats[self->format].fill_rect(self, 0, 0, self->width, self->height, col);
+    mark_dirty(self, 0, 0, self->width, self->height);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(framebuf_fill_obj, framebuf_fill);
@@ -346,6 +443,7 @@ STATIC mp_obj_t framebuf_pixel(size_t n_args, const mp_obj_t *args) {
         } else {
             // set
             setpixel(self, x, y, mp_obj_get_int(args[3]));
+            mark_dirty(self, x, y, 1, 1);
         }
     }
     return mp_const_none;
@@ -411,6 +509,8 @@ STATIC mp_obj_t framebuf_line(size_t n_args, const mp_obj_t *args) {
     mp_int_t y2 = mp_obj_get_int(args[4]);
     mp_int_t col = mp_obj_get_int(args[5]);
 
+    mark_dirty(self, MIN(x1, x2), MIN(y1, y2), MAX(x1, x2) - MIN(x1, x2) + 1, MAX(y1, y2) - MIN(y1, y2) + 1);
+
     mp_int_t dx = x2 - x1;
     mp_int_t sx;
     if (dx > 0) {
@@ -495,6 +595,48 @@ STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     int x0end = MIN(self->width, x + source->width);
     int y0end = MIN(self->height, y + source->height);
 
+    mark_dirty(self, x0, y0, x0end - x0, y0end - y0);
+
+    if (self->format == source->format && (self->format == FRAMEBUF_RGB565 || self->format == FRAMEBUF_GS8)) {
+        // whole bytes per pixel, so lines can be moved without going through getpixel/setpixel
+        int bpp = self->format == FRAMEBUF_RGB565 ? 2 : 1;
+        uint8_t *dest = (uint8_t*)self->buf + (x0 + y0 * self->stride) * bpp;
+        const uint8_t *src = (const uint8_t*)source->buf + (x1 + y1 * source->stride) * bpp;
+        int w = x0end - x0;
+        int h = y0end - y0;
+        int dest_stride = self->stride * bpp;
+        int src_stride = source->stride * bpp;
+        if (self->buf == source->buf && dest > src) {
+            // blitting onto an overlapping part of itself, go bottom up
+            dest += (h - 1) * dest_stride;
+            src += (h - 1) * src_stride;
+            dest_stride = -dest_stride;
+            src_stride = -src_stride;
+        }
+        for (; h; --h) {
+            if (key == -1) {
+                memmove(dest, src, w * bpp);
+            } else if (self->format == FRAMEBUF_RGB565) {
+                const uint16_t *s = (const uint16_t*)src;
+                uint16_t *d = (uint16_t*)dest;
+                for (int ww = w; ww; --ww, ++s, ++d) {
+                    if (*s != (uint32_t)key) {
+                        *d = *s;
+                    }
+                }
+            } else {
+                for (int ww = 0; ww < w; ++ww) {
+                    if (src[ww] != (uint32_t)key) {
+                        dest[ww] = src[ww];
+                    }
+                }
+            }
+            dest += dest_stride;
+            src += src_stride;
+        }
+        return mp_const_none;
+    }
+
     for (; y0 < y0end; ++y0) {
         int cx1 = x1;
         for (int cx0 = x0; cx0 < x0end; ++cx0) {
@@ -538,6 +680,7 @@ STATIC mp_obj_t framebuf_scroll(mp_obj_t self_in, mp_obj_t xstep_in, mp_obj_t ys
             setpixel(self, x, y, getpixel(self, x - xstep, y - ystep));
         }
     }
+    mark_dirty(self, 0, 0, self->width, self->height);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(framebuf_scroll_obj, framebuf_scroll);
@@ -553,6 +696,9 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
         col = mp_obj_get_int(args[4]);
     }
 
+    mark_dirty(self, x0, y0, strlen(str) * 8, 8);
+    setpixel_t text_setpixel = formats[self->format].setpixel;
+
     // loop over chars
     for (; *str; ++str) {
         // get char and make sure its in range of font
@@ -569,7 +715,7 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
                 for (int y = y0; vline_data; vline_data >>= 1, y++) { // scan over vertical column
                     if (vline_data & 1) { // only draw if pixel set
                         if (0 <= y && y < self->height) { // clip y
-                            setpixel(self, x0, y, col);
+                            text_setpixel(self, x0, y, col);
                         }
                     }
                 }
@@ -580,6 +726,27 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_text_obj, 4, 5, framebuf_text);
 
+// returns the part changed since the last clear as (x, y, w, h), widened to
+// whole bytes of the buffer, or None; writing the buffer directly isn't tracked
+STATIC mp_obj_t framebuf_dirty(size_t n_args, const mp_obj_t *args) {
+    mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(args[0]);
+    int rect[4];
+    mp_framebuf_region_t region;
+    mp_obj_t ret = mp_const_none;
+    if (framebuf_dirty_region(self, rect, &region)) {
+        mp_obj_t tuple[4];
+        for (int i = 0; i < 4; i++) {
+            tuple[i] = MP_OBJ_NEW_SMALL_INT(rect[i]);
+        }
+        ret = mp_obj_new_tuple(4, tuple);
+    }
+    if (n_args > 1 && mp_obj_is_true(args[1])) {
+        self->dirty_x0 = self->dirty_x1 = 0;
+    }
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(framebuf_dirty_obj, 1, 2, framebuf_dirty);
+
 STATIC const mp_rom_map_elem_t framebuf_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&framebuf_fill_obj) },
     { MP_ROM_QSTR(MP_QSTR_fill_rect), MP_ROM_PTR(&framebuf_fill_rect_obj) },
@@ -591,6 +758,7 @@ STATIC const mp_rom_map_elem_t framebuf_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_blit), MP_ROM_PTR(&framebuf_blit_obj) },
     { MP_ROM_QSTR(MP_QSTR_scroll), MP_ROM_PTR(&framebuf_scroll_obj) },
     { MP_ROM_QSTR(MP_QSTR_text), MP_ROM_PTR(&framebuf_text_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dirty), MP_ROM_PTR(&framebuf_dirty_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(framebuf_locals_dict, framebuf_locals_dict_table);
 
@@ -602,6 +770,28 @@ STATIC const mp_obj_type_t mp_type_framebuf = {
     .locals_dict = (mp_obj_dict_t*)&framebuf_locals_dict,
 };
 
+// C API for drivers that stream a FrameBuffer or an instance of a subclass
+
+STATIC mp_obj_framebuf_t *framebuf_native(mp_obj_t fb_in) {
+    if (!MP_OBJ_IS_TYPE(fb_in, &mp_type_framebuf)) {
+        fb_in = mp_instance_cast_to_native_base(fb_in, MP_OBJ_FROM_PTR(&mp_type_framebuf));
+        if (fb_in == MP_OBJ_NULL) {
+            mp_raise_TypeError("FrameBuffer required");
+        }
+    }
+    return MP_OBJ_TO_PTR(fb_in);
+}
+
+bool mp_framebuf_get_dirty(mp_obj_t fb_in, mp_framebuf_region_t *region) {
+    int rect[4];
+    return framebuf_dirty_region(framebuf_native(fb_in), rect, region);
+}
+
+void mp_framebuf_clear_dirty(mp_obj_t fb_in) {
+    mp_obj_framebuf_t *fb = framebuf_native(fb_in);
+    fb->dirty_x0 = fb->dirty_x1 = 0;
+}
+
 // this factory function is provided for backwards compatibility with old FrameBuffer1 class
 STATIC mp_obj_t legacy_framebuffer1(size_t n_args, const mp_obj_t *args) {
     mp_obj_framebuf_t *o = m_new_obj(mp_obj_framebuf_t);
@@ -619,6 +809,9 @@ STATIC mp_obj_t legacy_framebuffer1(size_t n_args, const mp_obj_t *args) {
     } else {
         o->stride = o->width;
     }
+    o->dirty_x0 = o->dirty_y0 = 0;
+    o->dirty_x1 = o->width;
+    o->dirty_y1 = o->height;
 
     return MP_OBJ_FROM_PTR(o);
 }
@@ -0,0 +1,44 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_MODFRAMEBUF_H
+#define MICROPY_INCLUDED_EXTMOD_MODFRAMEBUF_H
+
+#include "py/obj.h"
+
+// the bytes behind the dirty rectangle of a FrameBuffer, as lines of line_len
+// bytes that start line_stride bytes apart
+typedef struct _mp_framebuf_region_t {
+    const uint8_t *buf;
+    size_t line_len;
+    size_t line_stride;
+    size_t lines;
+} mp_framebuf_region_t;
+
+// both raise TypeError unless fb_in is a FrameBuffer
+bool mp_framebuf_get_dirty(mp_obj_t fb_in, mp_framebuf_region_t *region);
+void mp_framebuf_clear_dirty(mp_obj_t fb_in);
+
+#endif // MICROPY_INCLUDED_EXTMOD_MODFRAMEBUF_H
@@ -32,108 +32,92 @@
 #include "py/binary.h"
 #include "extmod/modubinascii.h"
 
-mp_obj_t mod_binascii_hexlify(size_t n_args, const mp_obj_t *args) {
-    // Second argument is for an extension to allow a separator to be used
-    // between values.
-    const char *sep = NULL;
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
-
-    // Code below assumes non-zero buffer length when computing size with
-    // separator, so handle the zero-length case here.
-    if (bufinfo.len == 0) {
-        return mp_const_empty_bytes;
-    }
+STATIC const char binascii_hex_digits[16] = "0123456789abcdef";
 
-    vstr_t vstr;
-    size_t out_len = bufinfo.len * 2;
-    if (n_args > 1) {
-        // 1-char separator between hex numbers
-        out_len += bufinfo.len - 1;
-        sep = mp_obj_str_get_str(args[1]);
-    }
-    vstr_init_len(&vstr, out_len);
-    byte *in = bufinfo.buf, *out = (byte*)vstr.buf;
-    for (mp_uint_t i = bufinfo.len; i--;) {
-        byte d = (*in >> 4);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
+// sep < 0 for no separator, out must have room for 2 or 3 bytes per input byte
+STATIC size_t binascii_hexlify_into(const byte *in, size_t len, byte *out, int sep) {
+    byte *start = out;
+    if (sep < 0) {
+        // no separator to check for, four bytes per iteration
+        for (; len >= 4; len -= 4, in += 4, out += 8) {
+            out[0] = binascii_hex_digits[in[0] >> 4];
+            out[1] = binascii_hex_digits[in[0] & 0xf];
+            out[2] = binascii_hex_digits[in[1] >> 4];
+            out[3] = binascii_hex_digits[in[1] & 0xf];
+            out[4] = binascii_hex_digits[in[2] >> 4];
+            out[5] = binascii_hex_digits[in[2] & 0xf];
+            out[6] = binascii_hex_digits[in[3] >> 4];
+            out[7] = binascii_hex_digits[in[3] & 0xf];
         }
-        *out++ = d + '0';
-        d = (*in++ & 0xf);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
-        }
-        *out++ = d + '0';
-        if (sep != NULL && i != 0) {
-            *out++ = *sep;
+    }
+    for (mp_uint_t i = len; i--;) {
+        *out++ = binascii_hex_digits[*in >> 4];
+        *out++ = binascii_hex_digits[*in++ & 0xf];
+        if (sep >= 0 && i != 0) {
+            *out++ = sep;
         }
     }
-    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    return out - start;
 }
-MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_hexlify_obj, 1, 2, mod_binascii_hexlify);
-
-mp_obj_t mod_binascii_unhexlify(mp_obj_t data) {
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
 
-    if ((bufinfo.len & 1) != 0) {
+STATIC size_t binascii_unhexlify_into(const byte *in, size_t len, byte *out) {
+    if ((len & 1) != 0) {
         mp_raise_ValueError("odd-length string");
     }
-    vstr_t vstr;
-    vstr_init_len(&vstr, bufinfo.len / 2);
-    byte *in = bufinfo.buf, *out = (byte*)vstr.buf;
-    byte hex_byte = 0;
-    for (mp_uint_t i = bufinfo.len; i--;) {
-        byte hex_ch = *in++;
-        if (unichar_isxdigit(hex_ch)) {
-            hex_byte += unichar_xdigit_value(hex_ch);
-        } else {
+    for (size_t i = 0; i < len; i += 2) {
+        byte hi = in[i], lo = in[i + 1];
+        if (!unichar_isxdigit(hi) || !unichar_isxdigit(lo)) {
             mp_raise_ValueError("non-hex digit found");
         }
-        if (i & 1) {
-            hex_byte <<= 4;
-        } else {
-            *out++ = hex_byte;
-            hex_byte = 0;
-        }
-    }
-    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
-}
-MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_unhexlify_obj, mod_binascii_unhexlify);
-
-// If ch is a character in the base64 alphabet, and is not a pad character, then
-// the corresponding integer between 0 and 63, inclusively, is returned.
-// Otherwise, -1 is returned.
-static int mod_binascii_sextet(byte ch) {
-    if (ch >= 'A' && ch <= 'Z') {
-        return ch - 'A';
-    } else if (ch >= 'a' && ch <= 'z') {
-        return ch - 'a' + 26;
-    } else if (ch >= '0' && ch <= '9') {
-        return ch - '0' + 52;
-    } else if (ch == '+') {
-        return 62;
-    } else if (ch == '/') {
-        return 63;
-    } else {
-        return -1;
+        *out++ = unichar_xdigit_value(hi) << 4 | unichar_xdigit_value(lo);
     }
+    return len / 2;
 }
 
-mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
-    byte *in = bufinfo.buf;
+STATIC const char binascii_base64_digits[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-    vstr_t vstr;
-    vstr_init(&vstr, (bufinfo.len / 4) * 3 + 1); // Potentially over-allocate
-    byte *out = (byte *)vstr.buf;
+// the value of each character in the base64 alphabet, 0xff for the others
+STATIC const byte binascii_base64_values[256] = {
+    #define X (0xff)
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, 62, X, X, X, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, X, X, X, X, X, X,
+    X, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, X, X, X, X, X,
+    X, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    #undef X
+};
 
+// returns the number of bytes decoded, out_size is checked as it goes
+STATIC size_t binascii_a2b_base64_into(const byte *in, size_t len, byte *out, size_t out_size) {
+    size_t out_len = 0;
     uint shift = 0;
     int nbits = 0; // Number of meaningful bits in shift
     bool hadpad = false; // Had a pad character since last valid character
-    for (size_t i = 0; i < bufinfo.len; i++) {
+    for (size_t i = 0; i < len; i++) {
+        if (nbits == 0 && len - i >= 4) {
+            // four valid characters in a row make three bytes, the common case
+            byte a = binascii_base64_values[in[i]], b = binascii_base64_values[in[i + 1]];
+            byte c = binascii_base64_values[in[i + 2]], d = binascii_base64_values[in[i + 3]];
+            if ((a | b | c | d) < 64) {
+                if (out_len + 3 > out_size) {
+                    goto too_small;
+                }
+                out[out_len++] = a << 2 | b >> 4;
+                out[out_len++] = b << 4 | c >> 2;
+                out[out_len++] = c << 6 | d;
+                hadpad = false;
+                i += 3;
+                continue;
+            }
+        }
+
         if (in[i] == '=') {
             if ((nbits == 2) || ((nbits == 4) && hadpad)) {
                 nbits = 0;
@@ -142,8 +126,8 @@ mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
             hadpad = true;
         }
 
-        int sextet = mod_binascii_sextet(in[i]);
-        if (sextet == -1) {
+        byte sextet = binascii_base64_values[in[i]];
+        if (sextet == 0xff) {
             continue;
         }
         hadpad = false;
@@ -152,71 +136,149 @@ mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
 
         if (nbits >= 8) {
             nbits -= 8;
-            out[vstr.len++] = (shift >> nbits) & 0xFF;
+            if (out_len == out_size) {
+                goto too_small;
+            }
+            out[out_len++] = (shift >> nbits) & 0xFF;
         }
     }
 
     if (nbits) {
         mp_raise_ValueError("incorrect padding");
     }
+    return out_len;
+
+too_small:
+    mp_raise_ValueError("buffer too small");
+}
+
+#define BINASCII_B2A_BASE64_LEN(len) ((((len) + 2) / 3) * 4 + 1)
+
+STATIC size_t binascii_b2a_base64_into(const byte *in, size_t len, byte *out) {
+    byte *start = out;
+    for (; len >= 3; len -= 3, in += 3) {
+        uint32_t v = in[0] << 16 | in[1] << 8 | in[2];
+        *out++ = binascii_base64_digits[v >> 18];
+        *out++ = binascii_base64_digits[(v >> 12) & 0x3f];
+        *out++ = binascii_base64_digits[(v >> 6) & 0x3f];
+        *out++ = binascii_base64_digits[v & 0x3f];
+    }
+    if (len != 0) {
+        uint32_t v = in[0] << 16 | (len == 2 ? in[1] << 8 : 0);
+        *out++ = binascii_base64_digits[v >> 18];
+        *out++ = binascii_base64_digits[(v >> 12) & 0x3f];
+        *out++ = len == 2 ? binascii_base64_digits[(v >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+    *out++ = '\n';
+    return out - start;
+}
+
+STATIC byte *binascii_get_out_buf(mp_obj_t buf_in, size_t needed) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < needed) {
+        mp_raise_ValueError("buffer too small");
+    }
+    return bufinfo.buf;
+}
+
+mp_obj_t mod_binascii_hexlify(size_t n_args, const mp_obj_t *args) {
+    // Second argument is for an extension to allow a separator to be used
+    // between values.
+    int sep = -1;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+
+    // Code below assumes non-zero buffer length when computing size with
+    // separator, so handle the zero-length case here.
+    if (bufinfo.len == 0) {
+        return mp_const_empty_bytes;
+    }
 
+    vstr_t vstr;
+    size_t out_len = bufinfo.len * 2;
+    if (n_args > 1) {
+        // 1-char separator between hex numbers
+        out_len += bufinfo.len - 1;
+        sep = (byte)*mp_obj_str_get_str(args[1]);
+    }
+    vstr_init_len(&vstr, out_len);
+    binascii_hexlify_into(bufinfo.buf, bufinfo.len, (byte*)vstr.buf, sep);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_hexlify_obj, 1, 2, mod_binascii_hexlify);
+
+// function ubinascii.hexlify_into(data, buf)
+STATIC mp_obj_t mod_binascii_hexlify_into(mp_obj_t data, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    byte *out = binascii_get_out_buf(buf_in, bufinfo.len * 2);
+    return MP_OBJ_NEW_SMALL_INT(binascii_hexlify_into(bufinfo.buf, bufinfo.len, out, -1));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_hexlify_into_obj, mod_binascii_hexlify_into);
+
+mp_obj_t mod_binascii_unhexlify(mp_obj_t data) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, bufinfo.len / 2);
+    binascii_unhexlify_into(bufinfo.buf, bufinfo.len, (byte*)vstr.buf);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_unhexlify_obj, mod_binascii_unhexlify);
+
+// function ubinascii.unhexlify_into(data, buf)
+STATIC mp_obj_t mod_binascii_unhexlify_into(mp_obj_t data, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    byte *out = binascii_get_out_buf(buf_in, bufinfo.len / 2);
+    return MP_OBJ_NEW_SMALL_INT(binascii_unhexlify_into(bufinfo.buf, bufinfo.len, out));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_unhexlify_into_obj, mod_binascii_unhexlify_into);
+
+mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+
+    vstr_t vstr;
+    size_t out_size = (bufinfo.len / 4) * 3 + 1; // Potentially over-allocate
+    vstr_init(&vstr, out_size);
+    vstr.len = binascii_a2b_base64_into(bufinfo.buf, bufinfo.len, (byte*)vstr.buf, out_size);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_a2b_base64_obj, mod_binascii_a2b_base64);
 
+// function ubinascii.a2b_base64_into(data, buf)
+STATIC mp_obj_t mod_binascii_a2b_base64_into(mp_obj_t data, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo, outinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    mp_get_buffer_raise(buf_in, &outinfo, MP_BUFFER_WRITE);
+    return MP_OBJ_NEW_SMALL_INT(binascii_a2b_base64_into(bufinfo.buf, bufinfo.len, outinfo.buf, outinfo.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_a2b_base64_into_obj, mod_binascii_a2b_base64_into);
+
 mp_obj_t mod_binascii_b2a_base64(mp_obj_t data) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
 
     vstr_t vstr;
-    vstr_init_len(&vstr, ((bufinfo.len != 0) ? (((bufinfo.len - 1) / 3) + 1) * 4 : 0) + 1);
-
-    // First pass, we convert input buffer to numeric base 64 values
-    byte *in = bufinfo.buf, *out = (byte*)vstr.buf;
-    mp_uint_t i;
-    for (i = bufinfo.len; i >= 3; i -= 3) {
-        *out++ = (in[0] & 0xFC) >> 2;
-        *out++ = (in[0] & 0x03) << 4 | (in[1] & 0xF0) >> 4;
-        *out++ = (in[1] & 0x0F) << 2 | (in[2] & 0xC0) >> 6;
-        *out++ = in[2] & 0x3F;
-        in += 3;
-    }
-    if (i != 0) {
-        *out++ = (in[0] & 0xFC) >> 2;
-        if (i == 2) {
-            *out++ = (in[0] & 0x03) << 4 | (in[1] & 0xF0) >> 4;
-            *out++ = (in[1] & 0x0F) << 2;
-        }
-        else {
-            *out++ = (in[0] & 0x03) << 4;
-            *out++ = 64;
-        }
-        *out = 64;
-    }
-
-    // Second pass, we convert number base 64 values to actual base64 ascii encoding
-    out = (byte*)vstr.buf;
-    for (mp_uint_t j = vstr.len - 1; j--;) {
-        if (*out < 26) {
-            *out += 'A';
-        } else if (*out < 52) {
-            *out += 'a' - 26;
-        } else if (*out < 62) {
-            *out += '0' - 52;
-        } else if (*out == 62) {
-            *out ='+';
-        } else if (*out == 63) {
-            *out = '/';
-        } else {
-            *out = '=';
-        }
-        out++;
-    }
-    *out = '\n';
+    vstr_init_len(&vstr, BINASCII_B2A_BASE64_LEN(bufinfo.len));
+    binascii_b2a_base64_into(bufinfo.buf, bufinfo.len, (byte*)vstr.buf);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_b2a_base64_obj, mod_binascii_b2a_base64);
 
+// function ubinascii.b2a_base64_into(data, buf)
+STATIC mp_obj_t mod_binascii_b2a_base64_into(mp_obj_t data, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    byte *out = binascii_get_out_buf(buf_in, BINASCII_B2A_BASE64_LEN(bufinfo.len));
+    return MP_OBJ_NEW_SMALL_INT(binascii_b2a_base64_into(bufinfo.buf, bufinfo.len, out));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_b2a_base64_into_obj, mod_binascii_b2a_base64_into);
+
 #if MICROPY_PY_UBINASCII_CRC32
 #include "uzlib/tinf.h"
 
@@ -224,12 +286,179 @@ mp_obj_t mod_binascii_crc32(size_t n_args, const mp_obj_t *args) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
     uint32_t crc = (n_args > 1) ? mp_obj_get_int_truncated(args[1]) : 0;
+    #ifdef MICROPY_PY_UBINASCII_CRC32_LE
+    crc = MICROPY_PY_UBINASCII_CRC32_LE(crc, bufinfo.buf, bufinfo.len);
+    return mp_obj_new_int_from_uint(crc);
+    #else
     crc = uzlib_crc32(bufinfo.buf, bufinfo.len, crc ^ 0xffffffff);
     return mp_obj_new_int_from_uint(crc ^ 0xffffffff);
+    #endif
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_crc32_obj, 1, 2, mod_binascii_crc32);
 #endif
 
+#if MICROPY_PY_UBINASCII_CRC
+
+// A CRC of 8 to 32 bits described by the usual parameters (width, poly, init, refin, refout,
+// xorout), computed a byte at a time from a table made when the object is created.  The
+// CRC-32 of zlib and the CRC-16 of X.25 are handed to the port when it provides them.
+
+enum {
+    BINASCII_CRC_SW = 0,
+    BINASCII_CRC_HW32,
+    BINASCII_CRC_HW16,
+};
+
+typedef struct _mp_obj_crc_t {
+    mp_obj_base_t base;
+    uint32_t poly;
+    uint32_t init;
+    uint32_t xorout;
+    uint32_t mask;
+    uint8_t width;
+    uint8_t hw;
+    bool refin;
+    bool refout;
+    uint32_t table[256];
+} mp_obj_crc_t;
+
+STATIC const mp_obj_type_t binascii_crc_type;
+
+STATIC uint32_t binascii_crc_reflect(uint32_t v, uint width) {
+    uint32_t r = 0;
+    for (uint i = 0; i < width; i++, v >>= 1) {
+        r = (r << 1) | (v & 1);
+    }
+    return r;
+}
+
+STATIC mp_obj_t binascii_crc_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_width, ARG_poly, ARG_init, ARG_refin, ARG_refout, ARG_xorout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_width,    MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_poly,     MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_init,     MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_SMALL_INT(0)} },
+        { MP_QSTR_refin,    MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_refout,   MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_xorout,   MP_ARG_KW_ONLY  | MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_SMALL_INT(0)} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t width = args[ARG_width].u_int;
+    if (width < 8 || width > 32) {
+        mp_raise_ValueError("width must be 8 to 32 bits");
+    }
+    mp_obj_crc_t *self = m_new_obj(mp_obj_crc_t);
+    self->base.type = &binascii_crc_type;
+    self->width = width;
+    self->mask = width == 32 ? 0xffffffff : (1u << width) - 1;
+    self->poly = mp_obj_get_int_truncated(args[ARG_poly].u_obj) & self->mask;
+    self->init = mp_obj_get_int_truncated(args[ARG_init].u_obj) & self->mask;
+    self->xorout = mp_obj_get_int_truncated(args[ARG_xorout].u_obj) & self->mask;
+    self->refin = args[ARG_refin].u_bool;
+    self->refout = args[ARG_refout].u_bool;
+
+    self->hw = BINASCII_CRC_SW;
+    if (self->refin && self->refout && self->xorout == self->mask) {
+        #ifdef MICROPY_PY_UBINASCII_CRC32_LE
+        if (width == 32 && self->poly == 0x04c11db7) {
+            self->hw = BINASCII_CRC_HW32;
+        }
+        #endif
+        #ifdef MICROPY_PY_UBINASCII_CRC16_LE
+        if (width == 16 && self->poly == 0x1021) {
+            self->hw = BINASCII_CRC_HW16;
+        }
+        #endif
+    }
+
+    if (self->refin) {
+        uint32_t rpoly = binascii_crc_reflect(self->poly, width);
+        for (uint i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (c >> 1) ^ rpoly : c >> 1;
+            }
+            self->table[i] = c;
+        }
+    } else {
+        uint32_t top = 1u << (width - 1);
+        for (uint i = 0; i < 256; i++) {
+            uint32_t c = (uint32_t)i << (width - 8);
+            for (int k = 0; k < 8; k++) {
+                c = (c & top) ? (c << 1) ^ self->poly : c << 1;
+            }
+            self->table[i] = c & self->mask;
+        }
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// method CRC.calc(data, value=None), value is a previous result to carry on from
+STATIC mp_obj_t binascii_crc_calc(size_t n_args, const mp_obj_t *args) {
+    mp_obj_crc_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+
+    // the register holds the CRC the way it's computed: reflected when refin is set
+    uint32_t reg;
+    if (n_args > 2 && args[2] != mp_const_none) {
+        reg = (mp_obj_get_int_truncated(args[2]) & self->mask) ^ self->xorout;
+        if (self->refin != self->refout) {
+            reg = binascii_crc_reflect(reg, self->width);
+        }
+    } else {
+        reg = self->refin ? binascii_crc_reflect(self->init, self->width) : self->init;
+    }
+
+    const byte *p = bufinfo.buf;
+    size_t len = bufinfo.len;
+    switch (self->hw) {
+        #ifdef MICROPY_PY_UBINASCII_CRC32_LE
+        case BINASCII_CRC_HW32:
+            return mp_obj_new_int_from_uint(MICROPY_PY_UBINASCII_CRC32_LE(reg ^ self->xorout, p, len));
+        #endif
+        #ifdef MICROPY_PY_UBINASCII_CRC16_LE
+        case BINASCII_CRC_HW16:
+            return MP_OBJ_NEW_SMALL_INT(MICROPY_PY_UBINASCII_CRC16_LE(reg ^ self->xorout, p, len));
+        #endif
+        default:
+            break;
+    }
+
+    if (self->refin) {
+        while (len--) {
+            reg = self->table[(reg ^ *p++) & 0xff] ^ (reg >> 8);
+        }
+    } else {
+        uint shift = self->width - 8;
+        while (len--) {
+            reg = (self->table[((reg >> shift) ^ *p++) & 0xff] ^ (reg << 8)) & self->mask;
+        }
+    }
+    if (self->refin != self->refout) {
+        reg = binascii_crc_reflect(reg, self->width);
+    }
+    return mp_obj_new_int_from_uint(reg ^ self->xorout);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(binascii_crc_calc_obj, 2, 3, binascii_crc_calc);
+
+STATIC const mp_rom_map_elem_t binascii_crc_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_calc), MP_ROM_PTR(&binascii_crc_calc_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(binascii_crc_locals_dict, binascii_crc_locals_dict_table);
+
+STATIC const mp_obj_type_t binascii_crc_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_CRC,
+    .make_new = binascii_crc_make_new,
+    .locals_dict = (void*)&binascii_crc_locals_dict,
+};
+
+#endif // MICROPY_PY_UBINASCII_CRC
+
 #if MICROPY_PY_UBINASCII
 
 STATIC const mp_rom_map_elem_t mp_module_binascii_globals_table[] = {
@@ -238,9 +467,16 @@ STATIC const mp_rom_map_elem_t mp_module_binascii_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_unhexlify), MP_ROM_PTR(&mod_binascii_unhexlify_obj) },
     { MP_ROM_QSTR(MP_QSTR_a2b_base64), MP_ROM_PTR(&mod_binascii_a2b_base64_obj) },
     { MP_ROM_QSTR(MP_QSTR_b2a_base64), MP_ROM_PTR(&mod_binascii_b2a_base64_obj) },
+    { MP_ROM_QSTR(MP_QSTR_hexlify_into), MP_ROM_PTR(&mod_binascii_hexlify_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unhexlify_into), MP_ROM_PTR(&mod_binascii_unhexlify_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_a2b_base64_into), MP_ROM_PTR(&mod_binascii_a2b_base64_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_b2a_base64_into), MP_ROM_PTR(&mod_binascii_b2a_base64_into_obj) },
     #if MICROPY_PY_UBINASCII_CRC32
     { MP_ROM_QSTR(MP_QSTR_crc32), MP_ROM_PTR(&mod_binascii_crc32_obj) },
     #endif
+    #if MICROPY_PY_UBINASCII_CRC
+    { MP_ROM_QSTR(MP_QSTR_CRC), MP_ROM_PTR(&binascii_crc_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_binascii_globals, mp_module_binascii_globals_table);
@@ -403,9 +403,109 @@ STATIC void set_aligned(uint val_type, void *p, mp_int_t index, mp_obj_t val) {
     }
 }
 
-STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
-    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+#if MICROPY_PY_UCTYPES_LAYOUT_CACHE
+
+// A structure descriptor compiled into a table of its fields sorted by offset.
+// Each slot remembers the field last found for the names hashing to it, so a
+// repeated access takes one compare. The layout is compiled again when the
+// number of fields of the descriptor changes, other edits of a descriptor
+// already in use are not picked up.
+
+#define UCTYPES_LAYOUT_SLOTS (16)
+
+typedef struct _uctypes_field_t {
+    qstr name;
+    mp_uint_t order;        // byte offset, times 32 plus the bit offset for bitfields
+    mp_obj_t desc;          // value of the field in the descriptor
+} uctypes_field_t;
+
+typedef struct _uctypes_layout_t {
+    mp_obj_t desc;
+    size_t used;
+    size_t n_fields;
+    uint16_t slots[UCTYPES_LAYOUT_SLOTS]; // field index plus 1, 0 if none
+    uctypes_field_t fields[];
+} uctypes_layout_t;
+
+STATIC mp_uint_t uctypes_field_order(mp_obj_t v) {
+    if (mp_obj_is_small_int(v)) {
+        mp_uint_t offset = MP_OBJ_SMALL_INT_VALUE(v);
+        mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
+        offset &= VALUE_MASK(VAL_TYPE_BITS);
+        if (val_type >= BFUINT8 && val_type <= BFINT32) {
+            return (offset & ((1 << OFFSET_BITS) - 1)) * 32 + ((offset >> OFFSET_BITS) & 31);
+        }
+        return offset * 32;
+    } else if (mp_obj_is_type(v, &mp_type_tuple)) {
+        mp_obj_tuple_t *t = MP_OBJ_TO_PTR(v);
+        if (t->len > 0 && mp_obj_is_small_int(t->items[0])) {
+            return (MP_OBJ_SMALL_INT_VALUE(t->items[0]) & VALUE_MASK(AGG_TYPE_BITS)) * 32;
+        }
+    }
+    // a malformed field raises when accessed, as without the layout
+    return 0;
+}
+
+STATIC uctypes_layout_t *uctypes_layout_compile(mp_obj_t desc_in) {
+    mp_map_t *map = &((mp_obj_dict_t*)MP_OBJ_TO_PTR(desc_in))->map;
+    uctypes_layout_t *l = m_new_obj_var(uctypes_layout_t, uctypes_field_t, map->used);
+    l->desc = desc_in;
+    l->used = map->used;
+    l->n_fields = 0;
+    memset(l->slots, 0, sizeof(l->slots));
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (!mp_map_slot_is_filled(map, i)) {
+            continue;
+        }
+        uctypes_field_t field;
+        field.name = mp_obj_str_get_qstr(map->table[i].key);
+        field.order = uctypes_field_order(map->table[i].value);
+        field.desc = map->table[i].value;
+        // insertion sort, fields at the same offset keep their order
+        size_t j = l->n_fields++;
+        for (; j > 0 && l->fields[j - 1].order > field.order; j--) {
+            l->fields[j] = l->fields[j - 1];
+        }
+        l->fields[j] = field;
+    }
+    return l;
+}
+
+STATIC uctypes_layout_t *uctypes_layout_get(mp_obj_t desc_in) {
+    uctypes_layout_t **cache = MP_STATE_VM(uctypes_layouts);
+    size_t i;
+    for (i = 0; i < MICROPY_PY_UCTYPES_LAYOUT_CACHE - 1; i++) {
+        if (cache[i] == NULL || cache[i]->desc == desc_in) {
+            break;
+        }
+    }
+    // not found, the least recently used one makes room
+    uctypes_layout_t *l = cache[i];
+    if (l == NULL || l->desc != desc_in || l->used != ((mp_obj_dict_t*)MP_OBJ_TO_PTR(desc_in))->map.used) {
+        l = uctypes_layout_compile(desc_in);
+    }
+    memmove(&cache[1], &cache[0], i * sizeof(*cache));
+    cache[0] = l;
+    return l;
+}
+
+STATIC mp_obj_t uctypes_layout_field(uctypes_layout_t *l, qstr attr) {
+    uint16_t *slot = &l->slots[attr % UCTYPES_LAYOUT_SLOTS];
+    if (*slot != 0 && l->fields[*slot - 1].name == attr) {
+        return l->fields[*slot - 1].desc;
+    }
+    for (size_t i = 0; i < l->n_fields; i++) {
+        if (l->fields[i].name == attr) {
+            *slot = i + 1;
+            return l->fields[i].desc;
+        }
+    }
+    nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, MP_OBJ_NEW_QSTR(attr)));
+}
 
+#endif
+
+STATIC void uctypes_struct_check_fields(mp_obj_uctypes_struct_t *self) {
     if (!mp_obj_is_type(self->desc, &mp_type_dict)
       #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
         && !mp_obj_is_type(self->desc, &mp_type_ordereddict)
@@ -413,8 +513,9 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
       ) {
             mp_raise_TypeError("struct: no fields");
     }
+}
 
-    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
+STATIC mp_obj_t uctypes_struct_field_op(mp_obj_uctypes_struct_t *self, mp_obj_t deref, mp_obj_t set_val) {
     if (mp_obj_is_small_int(deref)) {
         mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(deref);
         mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
@@ -522,6 +623,17 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
     return MP_OBJ_NULL;
 }
 
+STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
+    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    uctypes_struct_check_fields(self);
+    #if MICROPY_PY_UCTYPES_LAYOUT_CACHE
+    mp_obj_t deref = uctypes_layout_field(uctypes_layout_get(self->desc), attr);
+    #else
+    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
+    #endif
+    return uctypes_struct_field_op(self, deref, set_val);
+}
+
 STATIC void uctypes_struct_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] == MP_OBJ_NULL) {
         // load attribute
@@ -673,6 +785,45 @@ STATIC mp_obj_t uctypes_struct_bytes_at(mp_obj_t ptr, mp_obj_t size) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(uctypes_struct_bytes_at_obj, uctypes_struct_bytes_at);
 
+#if MICROPY_PY_UCTYPES_LAYOUT_CACHE
+
+STATIC uctypes_layout_t *uctypes_struct_layout(mp_obj_t self_in) {
+    if (!mp_obj_is_type(self_in, &uctypes_struct_type)) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    uctypes_struct_check_fields(self);
+    return uctypes_layout_get(self->desc);
+}
+
+/// \function to_tuple()
+/// Return the values of all the fields of a structure, in the order of their
+/// offsets. Aggregate fields give the same objects as attribute access.
+STATIC mp_obj_t uctypes_struct_to_tuple(mp_obj_t self_in) {
+    uctypes_layout_t *l = uctypes_struct_layout(self_in);
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(l->n_fields, NULL));
+    for (size_t i = 0; i < l->n_fields; i++) {
+        t->items[i] = uctypes_struct_field_op(MP_OBJ_TO_PTR(self_in), l->fields[i].desc, MP_OBJ_NULL);
+    }
+    return MP_OBJ_FROM_PTR(t);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(uctypes_struct_to_tuple_obj, uctypes_struct_to_tuple);
+
+/// \function to_dict()
+/// Return a dict of the names and values of all the fields of a structure.
+STATIC mp_obj_t uctypes_struct_to_dict(mp_obj_t self_in) {
+    uctypes_layout_t *l = uctypes_struct_layout(self_in);
+    mp_obj_t d = mp_obj_new_dict(l->n_fields);
+    for (size_t i = 0; i < l->n_fields; i++) {
+        mp_obj_dict_store(d, MP_OBJ_NEW_QSTR(l->fields[i].name),
+            uctypes_struct_field_op(MP_OBJ_TO_PTR(self_in), l->fields[i].desc, MP_OBJ_NULL));
+    }
+    return d;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(uctypes_struct_to_dict_obj, uctypes_struct_to_dict);
+
+#endif
+
 
 STATIC const mp_obj_type_t uctypes_struct_type = {
     { &mp_type_type },
@@ -692,6 +843,10 @@ STATIC const mp_rom_map_elem_t mp_module_uctypes_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_addressof), MP_ROM_PTR(&uctypes_struct_addressof_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytes_at), MP_ROM_PTR(&uctypes_struct_bytes_at_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytearray_at), MP_ROM_PTR(&uctypes_struct_bytearray_at_obj) },
+    #if MICROPY_PY_UCTYPES_LAYOUT_CACHE
+    { MP_ROM_QSTR(MP_QSTR_to_tuple), MP_ROM_PTR(&uctypes_struct_to_tuple_obj) },
+    { MP_ROM_QSTR(MP_QSTR_to_dict), MP_ROM_PTR(&uctypes_struct_to_dict_obj) },
+    #endif
 
     /// \moduleref uctypes
 
@@ -25,9 +25,10 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/objlist.h"
-#include "py/objstringio.h"
+#include "py/objstr.h"
 #include "py/parsenum.h"
 #include "py/runtime.h"
 #include "py/stream.h"
@@ -51,6 +52,34 @@ STATIC mp_obj_t mod_ujson_dumps(mp_obj_t obj) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 
+typedef struct _ujson_buf_t {
+    byte *buf;
+    size_t size;
+    size_t len;
+} ujson_buf_t;
+
+STATIC void ujson_buf_strn(void *env, const char *str, size_t len) {
+    ujson_buf_t *b = env;
+    if (b->len < b->size) {
+        memcpy(b->buf + b->len, str, MIN(len, b->size - b->len));
+    }
+    // keep counting past the end, to tell how big the buffer needs to be
+    b->len += len;
+}
+
+STATIC mp_obj_t mod_ujson_dump_into(mp_obj_t obj, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    ujson_buf_t b = {bufinfo.buf, bufinfo.len, 0};
+    mp_print_t print = {&b, ujson_buf_strn};
+    mp_obj_print_helper(&print, obj, PRINT_JSON);
+    if (b.len > b.size) {
+        mp_raise_ValueError("buffer too small");
+    }
+    return MP_OBJ_NEW_SMALL_INT(b.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ujson_dump_into_obj, mod_ujson_dump_into);
+
 // The function below implements a simple non-recursive JSON parser.
 //
 // The JSON specification is at http://www.ietf.org/rfc/rfc4627.txt
@@ -69,6 +98,10 @@ typedef struct _ujson_stream_t {
     mp_uint_t (*read)(mp_obj_t obj, void *buf, mp_uint_t size, int *errcode);
     int errcode;
     byte cur;
+    // input not consumed yet, refilled from buf through read (NULL when parsing a string in place)
+    const byte *ptr;
+    const byte *end;
+    byte *buf;
 } ujson_stream_t;
 
 #define S_EOF (0) // null is not allowed in json stream so is ok as EOF marker
@@ -76,20 +109,56 @@ typedef struct _ujson_stream_t {
 #define S_CUR(s) ((s).cur)
 #define S_NEXT(s) (ujson_stream_next(&(s)))
 
+// dict keys recently made by the parser, so that the same key in many objects is allocated once
+#define UJSON_KEY_CACHE_SIZE (8)
+
+typedef struct _ujson_key_cache_t {
+    mp_obj_t keys[UJSON_KEY_CACHE_SIZE];
+    size_t next;
+} ujson_key_cache_t;
+
 STATIC byte ujson_stream_next(ujson_stream_t *s) {
-    mp_uint_t ret = s->read(s->stream_obj, &s->cur, 1, &s->errcode);
-    if (s->errcode != 0) {
-        mp_raise_OSError(s->errcode);
-    }
-    if (ret == 0) {
-        s->cur = S_EOF;
+    if (s->ptr == s->end) {
+        if (s->read == NULL) {
+            s->cur = S_EOF;
+            return s->cur;
+        }
+        mp_uint_t ret = s->read(s->stream_obj, s->buf, MICROPY_PY_UJSON_STREAM_BUF_SIZE, &s->errcode);
+        if (s->errcode != 0) {
+            mp_raise_OSError(s->errcode);
+        }
+        if (ret == 0) {
+            s->cur = S_EOF;
+            return s->cur;
+        }
+        s->ptr = s->buf;
+        s->end = s->buf + ret;
     }
+    s->cur = *s->ptr++;
     return s->cur;
 }
 
-STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
-    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
-    ujson_stream_t s = {stream_obj, stream_p->read, 0, 0};
+STATIC mp_obj_t ujson_new_key(ujson_key_cache_t *cache, const vstr_t *vstr) {
+    // keys that are already qstrs cost nothing, the others are shared from the cache
+    qstr q = qstr_find_strn(vstr->buf, vstr->len);
+    if (q != MP_QSTR_NULL) {
+        return MP_OBJ_NEW_QSTR(q);
+    }
+    for (size_t i = 0; i < UJSON_KEY_CACHE_SIZE && cache->keys[i] != MP_OBJ_NULL; i++) {
+        size_t len;
+        const char *data = mp_obj_str_get_data(cache->keys[i], &len);
+        if (len == vstr->len && memcmp(data, vstr->buf, len) == 0) {
+            return cache->keys[i];
+        }
+    }
+    mp_obj_t key = mp_obj_new_str_copy(&mp_type_str, (const byte*)vstr->buf, vstr->len);
+    cache->keys[cache->next] = key;
+    cache->next = (cache->next + 1) % UJSON_KEY_CACHE_SIZE;
+    return key;
+}
+
+STATIC mp_obj_t ujson_parse(ujson_stream_t s) {
+    ujson_key_cache_t keys = {{MP_OBJ_NULL}, 0};
     vstr_t vstr;
     vstr_init(&vstr, 8);
     mp_obj_list_t stack; // we use a list as a simple stack for nested JSON
@@ -174,7 +243,11 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
                     goto fail;
                 }
                 S_NEXT(s);
-                next = mp_obj_new_str(vstr.buf, vstr.len);
+                if (stack_top_type == &mp_type_dict && stack_key == MP_OBJ_NULL) {
+                    next = ujson_new_key(&keys, &vstr);
+                } else {
+                    next = mp_obj_new_str(vstr.buf, vstr.len);
+                }
                 break;
             case '-':
             case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': {
@@ -278,14 +351,22 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
     fail:
     mp_raise_ValueError("syntax error in JSON");
 }
+
+STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
+    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
+    // the stream is read in chunks, JSON input must run to its end anyway
+    byte buf[MICROPY_PY_UJSON_STREAM_BUF_SIZE];
+    ujson_stream_t s = {stream_obj, stream_p->read, 0, 0, buf, buf, buf};
+    return ujson_parse(s);
+}
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_load_obj, mod_ujson_load);
 
 STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
-    size_t len;
-    const char *buf = mp_obj_str_get_data(obj, &len);
-    vstr_t vstr = {len, len, (char*)buf, true};
-    mp_obj_stringio_t sio = {{&mp_type_stringio}, &vstr, 0, MP_OBJ_NULL};
-    return mod_ujson_load(MP_OBJ_FROM_PTR(&sio));
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, MP_BUFFER_READ);
+    // parse the string in place, without going through a stream
+    ujson_stream_t s = {MP_OBJ_NULL, NULL, 0, 0, bufinfo.buf, (const byte*)bufinfo.buf + bufinfo.len, NULL};
+    return ujson_parse(s);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_loads_obj, mod_ujson_loads);
 
@@ -293,6 +374,7 @@ STATIC const mp_rom_map_elem_t mp_module_ujson_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ujson) },
     { MP_ROM_QSTR(MP_QSTR_dump), MP_ROM_PTR(&mod_ujson_dump_obj) },
     { MP_ROM_QSTR(MP_QSTR_dumps), MP_ROM_PTR(&mod_ujson_dumps_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dump_into), MP_ROM_PTR(&mod_ujson_dump_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&mod_ujson_load_obj) },
     { MP_ROM_QSTR(MP_QSTR_loads), MP_ROM_PTR(&mod_ujson_loads_obj) },
 };
@@ -204,6 +204,49 @@ STATIC mp_obj_t re_search(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_search_obj, 2, 4, re_search);
 
+#if MICROPY_PY_URE_MATCH_INTO
+
+// Stores the start and end offsets of the match in spans[0:2] and those of
+// each group after them (-1 for a group not taking part), any pairs the
+// buffer can't hold are dropped. Returns the number of groups plus one on a
+// match, 0 otherwise. Neither the match nor the substrings get allocated.
+STATIC mp_obj_t ure_exec_into(bool is_anchored, mp_obj_t self_in, mp_obj_t str_in, mp_obj_t spans_in) {
+    mp_obj_re_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(spans_in, &bufinfo, MP_BUFFER_WRITE);
+    size_t spans_len = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL);
+    Subject subj;
+    size_t len;
+    subj.begin = mp_obj_str_get_data(str_in, &len);
+    subj.end = subj.begin + len;
+    int caps_num = (self->re.sub + 1) * 2;
+    const char **caps = mp_local_alloc(caps_num * sizeof(char*));
+    // cast is a workaround for a bug in msvc (see above)
+    memset((char**)caps, 0, caps_num * sizeof(char*));
+    int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, is_anchored);
+    if (res != 0) {
+        for (int i = 0; i < caps_num && (size_t)i < spans_len; ++i) {
+            mp_int_t offset = (caps[i] == NULL) ? -1 : caps[i] - subj.begin;
+            mp_binary_set_val_array_from_int(bufinfo.typecode, bufinfo.buf, i, offset);
+        }
+        res = caps_num / 2;
+    }
+    mp_local_free((char**)caps);
+    return MP_OBJ_NEW_SMALL_INT(res);
+}
+
+STATIC mp_obj_t re_match_into(mp_obj_t self_in, mp_obj_t str_in, mp_obj_t spans_in) {
+    return ure_exec_into(true, self_in, str_in, spans_in);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(re_match_into_obj, re_match_into);
+
+STATIC mp_obj_t re_search_into(mp_obj_t self_in, mp_obj_t str_in, mp_obj_t spans_in) {
+    return ure_exec_into(false, self_in, str_in, spans_in);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(re_search_into_obj, re_search_into);
+
+#endif
+
 STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
     mp_obj_re_t *self = MP_OBJ_TO_PTR(args[0]);
     Subject subj;
@@ -370,6 +413,10 @@ STATIC const mp_rom_map_elem_t re_locals_dict_table[] = {
     #if MICROPY_PY_URE_SUB
     { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&re_sub_obj) },
     #endif
+    #if MICROPY_PY_URE_MATCH_INTO
+    { MP_ROM_QSTR(MP_QSTR_match_into), MP_ROM_PTR(&re_match_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_search_into), MP_ROM_PTR(&re_search_into_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(re_locals_dict, re_locals_dict_table);
@@ -381,18 +428,54 @@ STATIC const mp_obj_type_t re_type = {
     .locals_dict = (void*)&re_locals_dict,
 };
 
+#if MICROPY_PY_URE_CACHE
+
+// The compiled regexes are never modified, the same one can be handed out for
+// every use of a pattern. On a hit the entry moves to the front, on a miss the
+// new one goes there and the least recently used one is dropped.
+STATIC mp_obj_t re_cache_lookup(mp_obj_t pattern) {
+    mp_obj_t *cache = MP_STATE_VM(ure_cache);
+    for (size_t i = 0; i < MICROPY_PY_URE_CACHE * 2 && cache[i] != MP_OBJ_NULL; i += 2) {
+        if (cache[i] == pattern || mp_obj_equal(cache[i], pattern)) {
+            mp_obj_t re = cache[i + 1];
+            memmove(&cache[2], &cache[0], i * sizeof(mp_obj_t));
+            cache[0] = pattern;
+            cache[1] = re;
+            return re;
+        }
+    }
+    return MP_OBJ_NULL;
+}
+
+STATIC void re_cache_store(mp_obj_t pattern, mp_obj_t re) {
+    mp_obj_t *cache = MP_STATE_VM(ure_cache);
+    memmove(&cache[2], &cache[0], (MICROPY_PY_URE_CACHE - 1) * 2 * sizeof(mp_obj_t));
+    cache[0] = pattern;
+    cache[1] = re;
+}
+
+#endif
+
 STATIC mp_obj_t mod_re_compile(size_t n_args, const mp_obj_t *args) {
     const char *re_str = mp_obj_str_get_str(args[0]);
+    int flags = 0;
+    if (n_args > 1) {
+        flags = mp_obj_get_int(args[1]);
+    }
+    #if MICROPY_PY_URE_CACHE
+    if (!(flags & FLAG_DEBUG)) {
+        mp_obj_t re = re_cache_lookup(args[0]);
+        if (re != MP_OBJ_NULL) {
+            return re;
+        }
+    }
+    #endif
     int size = re1_5_sizecode(re_str);
     if (size == -1) {
         goto error;
     }
     mp_obj_re_t *o = m_new_obj_var(mp_obj_re_t, char, size);
     o->base.type = &re_type;
-    int flags = 0;
-    if (n_args > 1) {
-        flags = mp_obj_get_int(args[1]);
-    }
     int error = re1_5_compilecode(&o->re, re_str);
     if (error != 0) {
 error:
@@ -401,6 +484,11 @@ error:
     if (flags & FLAG_DEBUG) {
         re1_5_dumpcode(&o->re);
     }
+    #if MICROPY_PY_URE_CACHE
+    else {
+        re_cache_store(args[0], MP_OBJ_FROM_PTR(o));
+    }
+    #endif
     return MP_OBJ_FROM_PTR(o);
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_compile_obj, 1, 2, mod_re_compile);
@@ -424,6 +512,18 @@ STATIC mp_obj_t mod_re_search(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_search_obj, 2, 4, mod_re_search);
 
+#if MICROPY_PY_URE_MATCH_INTO
+STATIC mp_obj_t mod_re_match_into(mp_obj_t pattern_in, mp_obj_t str_in, mp_obj_t spans_in) {
+    return ure_exec_into(true, mod_re_compile(1, &pattern_in), str_in, spans_in);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(mod_re_match_into_obj, mod_re_match_into);
+
+STATIC mp_obj_t mod_re_search_into(mp_obj_t pattern_in, mp_obj_t str_in, mp_obj_t spans_in) {
+    return ure_exec_into(false, mod_re_compile(1, &pattern_in), str_in, spans_in);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(mod_re_search_into_obj, mod_re_search_into);
+#endif
+
 #if MICROPY_PY_URE_SUB
 STATIC mp_obj_t mod_re_sub(size_t n_args, const mp_obj_t *args) {
     mp_obj_t self = mod_re_compile(1, args);
@@ -440,6 +540,10 @@ STATIC const mp_rom_map_elem_t mp_module_re_globals_table[] = {
     #if MICROPY_PY_URE_SUB
     { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&mod_re_sub_obj) },
     #endif
+    #if MICROPY_PY_URE_MATCH_INTO
+    { MP_ROM_QSTR(MP_QSTR_match_into), MP_ROM_PTR(&mod_re_match_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_search_into), MP_ROM_PTR(&mod_re_search_into_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_DEBUG), MP_ROM_INT(FLAG_DEBUG) },
 };
 
@@ -36,6 +36,7 @@
 #include "py/stream.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
+#include "extmod/moduselect.h"
 
 // Flags for poll()
 #define FLAG_ONESHOT (1)
@@ -49,6 +50,9 @@ typedef struct _poll_obj_t {
     mp_uint_t (*ioctl)(mp_obj_t obj, mp_uint_t request, uintptr_t arg, int *errcode);
     mp_uint_t flags;
     mp_uint_t flags_ret;
+    #if MICROPY_PY_USELECT_PORT_FDS
+    int fd;
+    #endif
 } poll_obj_t;
 
 STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_len, mp_uint_t flags, bool or_flags) {
@@ -62,6 +66,9 @@ STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_
             poll_obj->ioctl = stream_p->ioctl;
             poll_obj->flags = flags;
             poll_obj->flags_ret = 0;
+            #if MICROPY_PY_USELECT_PORT_FDS
+            poll_obj->fd = mp_uselect_port_fd(obj[i]);
+            #endif
             elem->value = MP_OBJ_FROM_PTR(poll_obj);
         } else {
             // object exists; update its flags
@@ -74,6 +81,20 @@ STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_
     }
 }
 
+STATIC void poll_count_ready(mp_uint_t ret, size_t *rwx_num) {
+    if (rwx_num != NULL) {
+        if (ret & MP_STREAM_POLL_RD) {
+            rwx_num[0] += 1;
+        }
+        if (ret & MP_STREAM_POLL_WR) {
+            rwx_num[1] += 1;
+        }
+        if ((ret & ~(MP_STREAM_POLL_RD | MP_STREAM_POLL_WR)) != 0) {
+            rwx_num[2] += 1;
+        }
+    }
+}
+
 // poll each object in the map
 STATIC mp_uint_t poll_map_poll(mp_map_t *poll_map, size_t *rwx_num) {
     mp_uint_t n_ready = 0;
@@ -83,6 +104,13 @@ STATIC mp_uint_t poll_map_poll(mp_map_t *poll_map, size_t *rwx_num) {
         }
 
         poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map->table[i].value);
+        #if MICROPY_PY_USELECT_PORT_FDS
+        if (poll_obj->fd >= 0) {
+            // waited for with the other descriptors
+            poll_obj->flags_ret = 0;
+            continue;
+        }
+        #endif
         int errcode;
         mp_int_t ret = poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL, poll_obj->flags, &errcode);
         poll_obj->flags_ret = ret;
@@ -95,18 +123,99 @@ STATIC mp_uint_t poll_map_poll(mp_map_t *poll_map, size_t *rwx_num) {
         if (ret != 0) {
             // object is ready
             n_ready += 1;
-            if (rwx_num != NULL) {
-                if (ret & MP_STREAM_POLL_RD) {
-                    rwx_num[0] += 1;
+            poll_count_ready(ret, rwx_num);
+        }
+    }
+    return n_ready;
+}
+
+// poll the objects until one is ready or the timeout expires
+STATIC mp_uint_t poll_map_wait(mp_map_t *poll_map, size_t *rwx_num, mp_uint_t timeout) {
+    mp_uint_t start_tick = mp_hal_ticks_ms();
+    mp_uint_t n_ready;
+
+    #if MICROPY_PY_USELECT_PORT_FDS
+    size_t n_fds = 0;
+    for (mp_uint_t i = 0; i < poll_map->alloc; ++i) {
+        if (mp_map_slot_is_filled(poll_map, i) && ((poll_obj_t*)MP_OBJ_TO_PTR(poll_map->table[i].value))->fd >= 0) {
+            n_fds++;
+        }
+    }
+    if (n_fds > 0) {
+        bool others = n_fds < poll_map->used;
+        mp_uselect_fd_t *fds = m_new(mp_uselect_fd_t, n_fds);
+        for (;;) {
+            size_t n = 0;
+            bool closed = false;
+            for (mp_uint_t i = 0; i < poll_map->alloc; ++i) {
+                if (!mp_map_slot_is_filled(poll_map, i)) {
+                    continue;
                 }
-                if (ret & MP_STREAM_POLL_WR) {
-                    rwx_num[1] += 1;
+                poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map->table[i].value);
+                if (poll_obj->fd >= 0) {
+                    // the object may have been closed since it was registered
+                    fds[n].fd = mp_uselect_port_fd(poll_obj->obj);
+                    fds[n].events = poll_obj->flags;
+                    fds[n].revents = 0;
+                    if (fds[n].fd < 0) {
+                        fds[n].revents = MP_STREAM_POLL_HUP;
+                        closed = true;
+                    }
+                    n++;
                 }
-                if ((ret & ~(MP_STREAM_POLL_RD | MP_STREAM_POLL_WR)) != 0) {
-                    rwx_num[2] += 1;
+            }
+
+            n_ready = others ? poll_map_poll(poll_map, rwx_num) : 0;
+
+            // a single wait for all the descriptors, which doesn't block if another object is ready
+            mp_uint_t wait = 0;
+            if (n_ready == 0 && !closed) {
+                mp_uint_t elapsed = mp_hal_ticks_ms() - start_tick;
+                if (timeout == -1) {
+                    wait = -1;
+                } else if (elapsed < timeout) {
+                    wait = timeout - elapsed;
                 }
             }
+            int errcode;
+            mp_int_t ret = mp_uselect_port_wait(fds, n_fds, wait, others, &errcode);
+            if (ret == -1) {
+                m_del(mp_uselect_fd_t, fds, n_fds);
+                mp_raise_OSError(errcode);
+            }
+
+            n = 0;
+            for (mp_uint_t i = 0; i < poll_map->alloc; ++i) {
+                if (!mp_map_slot_is_filled(poll_map, i)) {
+                    continue;
+                }
+                poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map->table[i].value);
+                if (poll_obj->fd >= 0) {
+                    poll_obj->flags_ret = fds[n++].revents;
+                    if (poll_obj->flags_ret != 0) {
+                        n_ready += 1;
+                        poll_count_ready(poll_obj->flags_ret, rwx_num);
+                    }
+                }
+            }
+
+            if (n_ready > 0 || (timeout != -1 && mp_hal_ticks_ms() - start_tick >= timeout)) {
+                break;
+            }
+            // woken up by a driver, poll its objects again
         }
+        m_del(mp_uselect_fd_t, fds, n_fds);
+        return n_ready;
+    }
+    #endif
+
+    for (;;) {
+        // poll the objects
+        n_ready = poll_map_poll(poll_map, rwx_num);
+        if (n_ready > 0 || (timeout != -1 && mp_hal_ticks_ms() - start_tick >= timeout)) {
+            break;
+        }
+        MICROPY_EVENT_POLL_HOOK
     }
     return n_ready;
 }
@@ -142,39 +251,32 @@ STATIC mp_obj_t select_select(size_t n_args, const mp_obj_t *args) {
     poll_map_add(&poll_map, w_array, rwx_len[1], MP_STREAM_POLL_WR, true);
     poll_map_add(&poll_map, x_array, rwx_len[2], MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP, true);
 
-    mp_uint_t start_tick = mp_hal_ticks_ms();
     rwx_len[0] = rwx_len[1] = rwx_len[2] = 0;
-    for (;;) {
-        // poll the objects
-        mp_uint_t n_ready = poll_map_poll(&poll_map, rwx_len);
+    poll_map_wait(&poll_map, rwx_len, timeout);
 
-        if (n_ready > 0 || (timeout != -1 && mp_hal_ticks_ms() - start_tick >= timeout)) {
-            // one or more objects are ready, or we had a timeout
-            mp_obj_t list_array[3];
-            list_array[0] = mp_obj_new_list(rwx_len[0], NULL);
-            list_array[1] = mp_obj_new_list(rwx_len[1], NULL);
-            list_array[2] = mp_obj_new_list(rwx_len[2], NULL);
-            rwx_len[0] = rwx_len[1] = rwx_len[2] = 0;
-            for (mp_uint_t i = 0; i < poll_map.alloc; ++i) {
-                if (!mp_map_slot_is_filled(&poll_map, i)) {
-                    continue;
-                }
-                poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map.table[i].value);
-                if (poll_obj->flags_ret & MP_STREAM_POLL_RD) {
-                    ((mp_obj_list_t*)MP_OBJ_TO_PTR(list_array[0]))->items[rwx_len[0]++] = poll_obj->obj;
-                }
-                if (poll_obj->flags_ret & MP_STREAM_POLL_WR) {
-                    ((mp_obj_list_t*)MP_OBJ_TO_PTR(list_array[1]))->items[rwx_len[1]++] = poll_obj->obj;
-                }
-                if ((poll_obj->flags_ret & ~(MP_STREAM_POLL_RD | MP_STREAM_POLL_WR)) != 0) {
-                    ((mp_obj_list_t*)MP_OBJ_TO_PTR(list_array[2]))->items[rwx_len[2]++] = poll_obj->obj;
-                }
-            }
-            mp_map_deinit(&poll_map);
-            return mp_obj_new_tuple(3, list_array);
+    // one or more objects are ready, or we had a timeout
+    mp_obj_t list_array[3];
+    list_array[0] = mp_obj_new_list(rwx_len[0], NULL);
+    list_array[1] = mp_obj_new_list(rwx_len[1], NULL);
+    list_array[2] = mp_obj_new_list(rwx_len[2], NULL);
+    rwx_len[0] = rwx_len[1] = rwx_len[2] = 0;
+    for (mp_uint_t i = 0; i < poll_map.alloc; ++i) {
+        if (!mp_map_slot_is_filled(&poll_map, i)) {
+            continue;
+        }
+        poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map.table[i].value);
+        if (poll_obj->flags_ret & MP_STREAM_POLL_RD) {
+            ((mp_obj_list_t*)MP_OBJ_TO_PTR(list_array[0]))->items[rwx_len[0]++] = poll_obj->obj;
+        }
+        if (poll_obj->flags_ret & MP_STREAM_POLL_WR) {
+            ((mp_obj_list_t*)MP_OBJ_TO_PTR(list_array[1]))->items[rwx_len[1]++] = poll_obj->obj;
+        }
+        if ((poll_obj->flags_ret & ~(MP_STREAM_POLL_RD | MP_STREAM_POLL_WR)) != 0) {
+            ((mp_obj_list_t*)MP_OBJ_TO_PTR(list_array[2]))->items[rwx_len[2]++] = poll_obj->obj;
         }
-        MICROPY_EVENT_POLL_HOOK
     }
+    mp_map_deinit(&poll_map);
+    return mp_obj_new_tuple(3, list_array);
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_select_select_obj, 3, 4, select_select);
 
@@ -245,18 +347,7 @@ STATIC mp_uint_t poll_poll_internal(uint n_args, const mp_obj_t *args) {
 
     self->flags = flags;
 
-    mp_uint_t start_tick = mp_hal_ticks_ms();
-    mp_uint_t n_ready;
-    for (;;) {
-        // poll the objects
-        n_ready = poll_map_poll(&self->poll_map, NULL);
-        if (n_ready > 0 || (timeout != -1 && mp_hal_ticks_ms() - start_tick >= timeout)) {
-            break;
-        }
-        MICROPY_EVENT_POLL_HOOK
-    }
-
-    return n_ready;
+    return poll_map_wait(&self->poll_map, NULL, timeout);
 }
 
 STATIC mp_obj_t poll_poll(size_t n_args, const mp_obj_t *args) {
@@ -0,0 +1,25 @@
+#ifndef MICROPY_INCLUDED_EXTMOD_MODUSELECT_H
+#define MICROPY_INCLUDED_EXTMOD_MODUSELECT_H
+
+#include "py/obj.h"
+
+#if MICROPY_PY_USELECT_PORT_FDS
+
+// an object backed by a descriptor that the port can wait for together with the others
+typedef struct _mp_uselect_fd_t {
+    int fd;
+    mp_uint_t events;
+    mp_uint_t revents;
+} mp_uselect_fd_t;
+
+// returns the descriptor backing obj, or -1 if it must be polled with its ioctl
+int mp_uselect_port_fd(mp_obj_t obj);
+
+// waits up to timeout ms (-1 forever) for one of the descriptors to be ready and fills their
+// revents; with others set it also returns as soon as a driver signals one of its streams
+// returns the number of descriptors ready, or -1 with errcode set
+mp_int_t mp_uselect_port_wait(mp_uselect_fd_t *fds, size_t n, mp_uint_t timeout, bool others, int *errcode);
+
+#endif
+
+#endif // MICROPY_INCLUDED_EXTMOD_MODUSELECT_H
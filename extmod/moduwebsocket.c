@@ -57,6 +57,37 @@ typedef struct _mp_obj_websocket_t {
 
 STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode);
 
+// XOR the payload with the mask a word at a time, bytewise only up to the
+// first aligned address and for the tail
+STATIC void websocket_unmask(mp_obj_websocket_t *self, byte *p, size_t sz) {
+    uint32_t mask;
+    memcpy(&mask, self->mask, 4);
+    if (mask == 0) {
+        // Unmasked frame, nothing to do
+        return;
+    }
+    while (sz != 0 && ((uintptr_t)p & 3) != 0) {
+        *p++ ^= self->mask[self->mask_pos++ & 3];
+        sz--;
+    }
+    if (sz >= 4) {
+        byte rot[4];
+        for (int i = 0; i < 4; i++) {
+            rot[i] = self->mask[(self->mask_pos + i) & 3];
+        }
+        memcpy(&mask, rot, 4);
+        uint32_t *w = (uint32_t*)p;
+        for (size_t n = sz >> 2; n--;) {
+            *w++ ^= mask;
+        }
+        p = (byte*)w;
+        sz &= 3;
+    }
+    while (sz--) {
+        *p++ ^= self->mask[self->mask_pos++ & 3];
+    }
+}
+
 STATIC mp_obj_t websocket_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, 2, false);
     mp_get_stream_raise(args[0], MP_STREAM_OP_READ | MP_STREAM_OP_WRITE | MP_STREAM_OP_IOCTL);
@@ -175,10 +206,7 @@ STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
                     return out_sz;
                 }
 
-                sz = out_sz;
-                for (byte *p = buf; sz--; p++) {
-                    *p ^= self->mask[self->mask_pos++ & 3];
-                }
+                websocket_unmask(self, buf, out_sz);
 
                 self->msg_sz -= out_sz;
                 if (self->msg_sz == 0) {
@@ -175,7 +175,17 @@ STATIC mp_obj_t mod_uzlib_decompress(size_t n_args, const mp_obj_t *args) {
     }
 
     while (1) {
+        #if MICROPY_PY_THREAD_CORE_AFFINITY
+        // decomp and dest_buf are only referenced from here, keep them in memory where the
+        // collector of another thread finds them while the GIL is released
+        void *volatile gc_roots[2] = { decomp, dest_buf };
+        bool released = mp_thread_gil_release_begin(decomp->source_limit - decomp->source);
         st = uzlib_uncompress_chksum(decomp);
+        mp_thread_gil_release_end(released);
+        (void)gc_roots;
+        #else
+        st = uzlib_uncompress_chksum(decomp);
+        #endif
         if (st < 0) {
             goto error;
         }
@@ -201,10 +211,291 @@ error:
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_decompress_obj, 1, 3, mod_uzlib_decompress);
 
+#if MICROPY_PY_UZLIB_COMPRESS
+
+// The compressor finds repeats in a window of the last 2^wbits bytes, through a hash table of
+// 2^(wbits - 1) positions, and sends them with the fixed Huffman codes.  Its memory is therefore
+// 2 * 2^wbits bytes besides the object itself, and whoever decompresses the output needs a
+// dictionary of only 2^wbits bytes.
+
+#define COMP_WBITS_MIN          (8)
+#define COMP_WBITS_MAX          (15)
+#define COMP_WBITS_DEFAULT      (10)
+#define COMP_MATCH_MIN          (3)
+#define COMP_MATCH_MAX          (258)
+#define COMP_OUTBUF_SIZE        (64)
+// room a literal, a match or a sync flush needs in outbuf
+#define COMP_OUTBUF_SLACK       (8)
+
+typedef enum {
+    COMP_FORMAT_ZLIB = 0,
+    COMP_FORMAT_GZIP,
+    COMP_FORMAT_RAW,
+} comp_format_t;
+
+typedef struct _uzlib_comp_t {
+    struct Outbuf out;
+    mp_print_t dest;
+    byte *window;
+    uint16_t *hash;
+    uint32_t pos;
+    uint32_t checksum;
+    uint32_t wmask;
+    uint8_t wbits;
+    uint8_t format;
+    byte outbuf[COMP_OUTBUF_SIZE];
+} uzlib_comp_t;
+
+STATIC void comp_drain(uzlib_comp_t *c) {
+    if (c->out.outlen > 0) {
+        c->dest.print_strn(c->dest.data, (const char*)c->outbuf, c->out.outlen);
+        c->out.outlen = 0;
+    }
+}
+
+STATIC void comp_init(uzlib_comp_t *c, mp_int_t wbits, const mp_print_t *dest) {
+    comp_format_t format = COMP_FORMAT_ZLIB;
+    if (wbits < 0) {
+        format = COMP_FORMAT_RAW;
+        wbits = -wbits;
+    } else if (wbits >= 16) {
+        format = COMP_FORMAT_GZIP;
+        wbits -= 16;
+    }
+    if (wbits < COMP_WBITS_MIN || wbits > COMP_WBITS_MAX) {
+        mp_raise_ValueError("invalid wbits");
+    }
+    memset(c, 0, sizeof(*c));
+    c->out.outbuf = c->outbuf;
+    c->out.outsize = COMP_OUTBUF_SIZE;
+    c->dest = *dest;
+    c->window = m_new(byte, 1 << wbits);
+    c->hash = m_new0(uint16_t, 1 << (wbits - 1));
+    c->wmask = (1 << wbits) - 1;
+    c->wbits = wbits;
+    c->format = format;
+
+    if (format == COMP_FORMAT_ZLIB) {
+        // CINFO tells the window size, FLEVEL 0 the fastest method
+        byte cmf = ((wbits - 8) << 4) | 8;
+        byte flg = 31 - ((cmf << 8) % 31);
+        c->outbuf[c->out.outlen++] = cmf;
+        c->outbuf[c->out.outlen++] = flg == 31 ? 0 : flg;
+        c->checksum = 1;
+    } else if (format == COMP_FORMAT_GZIP) {
+        static const byte gzip_header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 4, 0xff};
+        memcpy(c->outbuf, gzip_header, sizeof(gzip_header));
+        c->out.outlen = sizeof(gzip_header);
+        c->checksum = ~0;
+    }
+    zlib_start_block(&c->out);
+}
+
+STATIC inline byte comp_byte(uzlib_comp_t *c, const byte *data, uint32_t base, uint32_t p) {
+    // bytes before the current data are taken from the window
+    return p >= base ? data[p - base] : c->window[p & c->wmask];
+}
+
+STATIC inline uint32_t comp_hash(uzlib_comp_t *c, const byte *d) {
+    return ((d[0] << 16 | d[1] << 8 | d[2]) * 2654435761u) >> (32 - (c->wbits - 1));
+}
+
+STATIC void comp_data(uzlib_comp_t *c, const byte *data, size_t len) {
+    if (c->format == COMP_FORMAT_ZLIB) {
+        c->checksum = uzlib_adler32(data, len, c->checksum);
+    } else if (c->format == COMP_FORMAT_GZIP) {
+        c->checksum = uzlib_crc32(data, len, c->checksum);
+    }
+    uint32_t base = c->pos;
+    uint32_t end = base + len;
+    while (c->pos < end) {
+        uint32_t p = c->pos;
+        uint32_t avail = end - p;
+        uint32_t match = 0;
+        uint32_t dist = 0;
+        if (avail >= COMP_MATCH_MIN) {
+            uint32_t h = comp_hash(c, data + p - base);
+            // positions are kept modulo 2^16, a stale one is caught by comparing the data
+            dist = (uint16_t)((uint16_t)p - c->hash[h]);
+            c->hash[h] = p;
+            if (dist > 0 && dist <= c->wmask + 1 && dist <= p) {
+                uint32_t max = MIN(avail, COMP_MATCH_MAX);
+                while (match < max && comp_byte(c, data, base, p - dist + match) == data[p - base + match]) {
+                    match++;
+                }
+            }
+        }
+        if (match >= COMP_MATCH_MIN) {
+            zlib_match(&c->out, dist, match);
+            for (uint32_t q = p; q < p + match; q++) {
+                if (q > p && end - q >= COMP_MATCH_MIN) {
+                    c->hash[comp_hash(c, data + q - base)] = q;
+                }
+                c->window[q & c->wmask] = data[q - base];
+            }
+            c->pos += match;
+        } else {
+            zlib_literal(&c->out, data[p - base]);
+            c->window[p & c->wmask] = data[p - base];
+            c->pos++;
+        }
+        if (c->out.outlen >= COMP_OUTBUF_SIZE - COMP_OUTBUF_SLACK) {
+            comp_drain(c);
+        }
+    }
+}
+
+STATIC void comp_align(uzlib_comp_t *c) {
+    if (c->out.noutbits > 0) {
+        outbits(&c->out, 0, 8 - c->out.noutbits);
+    }
+}
+
+// ends the block and sends everything so far, like Z_SYNC_FLUSH
+STATIC void comp_flush(uzlib_comp_t *c) {
+    zlib_finish_block(&c->out);
+    // an empty stored block brings the output to a byte boundary
+    outbits(&c->out, 0, 3);
+    comp_align(c);
+    outbits(&c->out, 0, 16);
+    outbits(&c->out, 0xffff, 16);
+    zlib_start_block(&c->out);
+    comp_drain(c);
+}
+
+STATIC void comp_finish(uzlib_comp_t *c) {
+    zlib_finish_block(&c->out);
+    // an empty final block
+    outbits(&c->out, 3, 3);
+    zlib_finish_block(&c->out);
+    comp_align(c);
+    comp_drain(c);
+
+    byte trailer[8];
+    if (c->format == COMP_FORMAT_ZLIB) {
+        for (int i = 0; i < 4; i++) {
+            trailer[i] = c->checksum >> (24 - 8 * i);
+        }
+        c->dest.print_strn(c->dest.data, (const char*)trailer, 4);
+    } else if (c->format == COMP_FORMAT_GZIP) {
+        uint32_t crc = ~c->checksum;
+        for (int i = 0; i < 4; i++) {
+            trailer[i] = crc >> (8 * i);
+            trailer[4 + i] = c->pos >> (8 * i);
+        }
+        c->dest.print_strn(c->dest.data, (const char*)trailer, 8);
+    }
+    m_del(byte, c->window, c->wmask + 1);
+    m_del(uint16_t, c->hash, 1 << (c->wbits - 1));
+    c->window = NULL;
+    c->hash = NULL;
+}
+
+typedef struct _mp_obj_compio_t {
+    mp_obj_base_t base;
+    mp_obj_t dest_stream;
+    uzlib_comp_t comp;
+    bool closed;
+} mp_obj_compio_t;
+
+STATIC mp_obj_t compio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->base.type = type;
+    o->dest_stream = args[0];
+    o->closed = false;
+    mp_print_t dest = {MP_OBJ_TO_PTR(args[0]), mp_stream_write_adaptor};
+    comp_init(&o->comp, n_args > 1 ? mp_obj_get_int(args[1]) : COMP_WBITS_DEFAULT, &dest);
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_uint_t compio_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (o->closed) {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    comp_data(&o->comp, buf, size);
+    return size;
+}
+
+STATIC mp_uint_t compio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (request == MP_STREAM_FLUSH) {
+        if (!o->closed) {
+            comp_flush(&o->comp);
+        }
+        return 0;
+    } else if (request == MP_STREAM_CLOSE) {
+        // the destination stream is left open
+        if (!o->closed) {
+            o->closed = true;
+            comp_finish(&o->comp);
+        }
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC mp_obj_t compio___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    int errcode;
+    compio_ioctl(args[0], MP_STREAM_CLOSE, 0, &errcode);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compio___exit___obj, 4, 4, compio___exit__);
+
+STATIC const mp_rom_map_elem_t compio_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&compio___exit___obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(compio_locals_dict, compio_locals_dict_table);
+
+STATIC const mp_stream_p_t compio_stream_p = {
+    .write = compio_write,
+    .ioctl = compio_ioctl,
+};
+
+STATIC const mp_obj_type_t compio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_CompIO,
+    .make_new = compio_make_new,
+    .protocol = &compio_stream_p,
+    .locals_dict = (void*)&compio_locals_dict,
+};
+
+STATIC mp_obj_t mod_uzlib_compress(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+
+    vstr_t vstr;
+    mp_print_t dest;
+    vstr_init_print(&vstr, bufinfo.len / 2 + 16, &dest);
+    uzlib_comp_t *comp = m_new_obj(uzlib_comp_t);
+    comp_init(comp, n_args > 1 ? mp_obj_get_int(args[1]) : COMP_WBITS_DEFAULT, &dest);
+    comp_data(comp, bufinfo.buf, bufinfo.len);
+    comp_finish(comp);
+    m_del_obj(uzlib_comp_t, comp);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_compress_obj, 1, 2, mod_uzlib_compress);
+
+#endif // MICROPY_PY_UZLIB_COMPRESS
+
 STATIC const mp_rom_map_elem_t mp_module_uzlib_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uzlib) },
     { MP_ROM_QSTR(MP_QSTR_decompress), MP_ROM_PTR(&mod_uzlib_decompress_obj) },
     { MP_ROM_QSTR(MP_QSTR_DecompIO), MP_ROM_PTR(&decompio_type) },
+    #if MICROPY_PY_UZLIB_COMPRESS
+    { MP_ROM_QSTR(MP_QSTR_compress), MP_ROM_PTR(&mod_uzlib_compress_obj) },
+    { MP_ROM_QSTR(MP_QSTR_CompIO), MP_ROM_PTR(&compio_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uzlib_globals, mp_module_uzlib_globals_table);
@@ -222,5 +513,8 @@ const mp_obj_module_t mp_module_uzlib = {
 #include "uzlib/tinfgzip.c"
 #include "uzlib/adler32.c"
 #include "uzlib/crc32.c"
+#if MICROPY_PY_UZLIB_COMPRESS
+#include "uzlib/defl_static.c"
+#endif
 
 #endif // MICROPY_PY_UZLIB
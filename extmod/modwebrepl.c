@@ -74,6 +74,9 @@ STATIC char denied_prompt[] = "\r\nAccess denied\r\n";
 
 STATIC char webrepl_passwd[10];
 
+// Shared by both directions of a file transfer, only one runs at a time
+STATIC byte filebuf[MICROPY_PY_WEBREPL_FILE_BUF];
+
 STATIC void write_webrepl(mp_obj_t websock, const void *buf, size_t len) {
     const mp_stream_p_t *sock_stream = mp_get_stream(websock);
     int err;
@@ -119,19 +122,53 @@ STATIC void check_file_op_finished(mp_obj_webrepl_t *self) {
 
 STATIC int write_file_chunk(mp_obj_webrepl_t *self) {
     const mp_stream_p_t *file_stream = mp_get_stream(self->cur_file);
-    byte readbuf[2 + 256];
     int err;
-    mp_uint_t out_sz = file_stream->read(self->cur_file, readbuf + 2, sizeof(readbuf) - 2, &err);
+    mp_uint_t out_sz = file_stream->read(self->cur_file, filebuf + 2, sizeof(filebuf) - 2, &err);
     if (out_sz == MP_STREAM_ERROR) {
         return out_sz;
     }
-    readbuf[0] = out_sz;
-    readbuf[1] = out_sz >> 8;
+    filebuf[0] = out_sz;
+    filebuf[1] = out_sz >> 8;
     DEBUG_printf("webrepl: Sending %d bytes of file\n", out_sz);
-    write_webrepl(self->sock, readbuf, 2 + out_sz);
+    write_webrepl(self->sock, filebuf, 2 + out_sz);
     return out_sz;
 }
 
+// Fill filebuf from the websocket for as long as it has data and write each
+// full buffer straight to the file, so a put costs one file write per buffer
+// rather than a trip through dupterm per websocket read
+STATIC mp_uint_t put_file_chunks(mp_obj_webrepl_t *self, mp_uint_t buf_sz, int *errcode) {
+    const mp_stream_p_t *sock_stream = mp_get_stream(self->sock);
+    for (;;) {
+        bool drained = false;
+        while (self->data_to_recv != 0 && buf_sz < sizeof(filebuf)) {
+            size_t to_read = MIN(sizeof(filebuf) - buf_sz, self->data_to_recv);
+            mp_uint_t sz = sock_stream->read(self->sock, filebuf + buf_sz, to_read, errcode);
+            if (sz == MP_STREAM_ERROR && *errcode != MP_EAGAIN) {
+                return sz;
+            }
+            if (sz == 0 || sz == MP_STREAM_ERROR) {
+                drained = true;
+                break;
+            }
+            self->data_to_recv -= sz;
+            buf_sz += sz;
+        }
+
+        DEBUG_printf("webrepl: Writing %lu bytes to file\n", buf_sz);
+        int err;
+        mp_uint_t res = mp_stream_write_exactly(self->cur_file, filebuf, buf_sz, &err);
+        if (err != 0 || res != buf_sz) {
+            assert(0);
+        }
+
+        if (drained || self->data_to_recv == 0) {
+            return 0;
+        }
+        buf_sz = 0;
+    }
+}
+
 STATIC void handle_op(mp_obj_webrepl_t *self) {
 
     // Handle operations not requiring opened file
@@ -246,28 +283,14 @@ STATIC mp_uint_t _webrepl_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
     }
 
     if (self->data_to_recv != 0) {
-        static byte filebuf[512];
         filebuf[0] = *(byte*)buf;
-        mp_uint_t buf_sz = 1;
-        if (--self->data_to_recv != 0) {
-            size_t to_read = MIN(sizeof(filebuf) - 1, self->data_to_recv);
-            mp_uint_t sz = sock_stream->read(self->sock, filebuf + 1, to_read, errcode);
-            if (sz == MP_STREAM_ERROR) {
-                return sz;
-            }
-            self->data_to_recv -= sz;
-            buf_sz += sz;
-        }
+        self->data_to_recv--;
 
         if (self->hdr.type == PUT_FILE) {
-            DEBUG_printf("webrepl: Writing %lu bytes to file\n", buf_sz);
-            int err;
-            mp_uint_t res = mp_stream_write_exactly(self->cur_file, filebuf, buf_sz, &err);
-            if (err != 0 || res != buf_sz) {
-                assert(0);
+            if (put_file_chunks(self, 1, errcode) == MP_STREAM_ERROR) {
+                return MP_STREAM_ERROR;
             }
         } else if (self->hdr.type == GET_FILE) {
-            assert(buf_sz == 1);
             assert(self->data_to_recv == 0);
             assert(filebuf[0] == 0);
             mp_uint_t out_sz = write_file_chunk(self);
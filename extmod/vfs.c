@@ -276,7 +276,7 @@ MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_umount_obj, mp_vfs_umount);
 
 // Note: buffering and encoding args are currently ignored
 mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_file, ARG_mode, ARG_encoding };
+    enum { ARG_file, ARG_mode, ARG_buffering, ARG_encoding };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_file, MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
         { MP_QSTR_mode, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_QSTR(MP_QSTR_r)} },
@@ -296,7 +296,13 @@ mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
     #endif
 
     mp_vfs_mount_t *vfs = lookup_path(args[ARG_file].u_obj, &args[ARG_file].u_obj);
-    return mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t*)&args);
+    // only pass buffering on when it was given, so that VFS objects with an open(path, mode) method keep working
+    size_t n_open_args = 2;
+    if (args[ARG_buffering].u_int != -1) {
+        args[ARG_buffering].u_obj = MP_OBJ_NEW_SMALL_INT(args[ARG_buffering].u_int);
+        n_open_args = 3;
+    }
+    return mp_vfs_proxy_call(vfs, MP_QSTR_open, n_open_args, (mp_obj_t*)&args);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_open_obj, 0, mp_vfs_open);
 
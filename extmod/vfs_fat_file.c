@@ -274,15 +274,15 @@ const mp_obj_type_t mp_type_vfs_fat_textio = {
 };
 
 // Factory function for I/O stream classes
-STATIC mp_obj_t fatfs_builtin_open_self(mp_obj_t self_in, mp_obj_t path, mp_obj_t mode) {
+STATIC mp_obj_t fatfs_builtin_open_self(size_t n_args, const mp_obj_t *args) {
     // TODO: analyze buffering args and instantiate appropriate type
-    fs_user_mount_t *self = MP_OBJ_TO_PTR(self_in);
+    fs_user_mount_t *self = MP_OBJ_TO_PTR(args[0]);
     mp_arg_val_t arg_vals[FILE_OPEN_NUM_ARGS];
-    arg_vals[0].u_obj = path;
-    arg_vals[1].u_obj = mode;
+    arg_vals[0].u_obj = args[1];
+    arg_vals[1].u_obj = args[2];
     arg_vals[2].u_obj = mp_const_none;
     return file_open(self, &mp_type_vfs_fat_textio, arg_vals);
 }
-MP_DEFINE_CONST_FUN_OBJ_3(fat_vfs_open_obj, fatfs_builtin_open_self);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(fat_vfs_open_obj, 3, 4, fatfs_builtin_open_self);
 
 #endif // MICROPY_VFS && MICROPY_VFS_FAT
@@ -25,6 +25,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #include "LoRaMacTest.h"
 
 #include "modlora.h"
+#include "rom/crc.h"
 
 /*!
  * Maximum PHY layer payload size
@@ -46,6 +47,11 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
  */
 static LoRaMacRegion_t LoRaMacRegion;
 
+/*!
+ * Constant PHY tables of the region, NULL if it only supports the generic dispatch
+ */
+static const RegionPhyTable_t* LoRaMacPhyTable;
+
 /*!
  * LoRaMac duty cycle for the back-off procedure during the first hour.
  */
@@ -381,6 +387,39 @@ TimerTime_t TxTimeOnAir = 0;
  */
 static uint8_t JoinRequestTrials;
 
+/*!
+ * Time at which the last transmission was started
+ */
+static TimerTime_t TxStartTime = 0;
+
+/*!
+ * Time at which the last RX window was opened
+ */
+static TimerTime_t RxWindowOpenTime = 0;
+
+/*!
+ * Ring of the most recent RX window timing samples
+ */
+static LoRaMacTraceSample_t TraceRing[LORAMAC_TRACE_SIZE];
+static uint32_t TraceHead = 0;
+
+/*!
+ * Time on air per band, accumulated in one minute slots over the last hour
+ */
+static uint32_t AirtimeSlots[LORAMAC_AIRTIME_SLOTS][LORAMAC_AIRTIME_BANDS_MAX];
+static uint32_t AirtimeSlotNumber[LORAMAC_AIRTIME_SLOTS];
+
+/*!
+ * Time on air and end time of the last transmission per band
+ */
+static TimerTime_t AirtimeLastTimeOnAir[LORAMAC_AIRTIME_BANDS_MAX];
+static TimerTime_t AirtimeLastTxDoneTime[LORAMAC_AIRTIME_BANDS_MAX];
+
+/*!
+ * Band of the channel used by the ongoing transmission
+ */
+static uint8_t TxBand = 0;
+
 /*!
  * Maximum number of trials for the Join Request
  */
@@ -421,6 +460,11 @@ LoRaMacFlags_t LoRaMacFlags;
  */
 static void OnRadioTxDone( void );
 
+/*!
+ * \brief Records a timing trace sample
+ */
+static void TraceRecord( LoRaMacTraceEvent_t event, TimerTime_t scheduled, TimerTime_t actual );
+
 /*!
  * \brief This function prepares the MAC to abort the execution of function
  *        OnRadioRxDone in case of a reception error.
@@ -642,6 +686,9 @@ static IRAM_ATTR void OnRadioTxDone( void )
     SetBandTxDoneParams_t txDone;
     TimerTime_t curTime = TimerGetCurrentTime( );
 
+    TraceRecord( LORAMAC_TRACE_TX_DONE, TxStartTime + TxTimeOnAir, curTime );
+    LoRaMacAirtimeRecord( TxBand, TxTimeOnAir, curTime );
+
     if( LoRaMacDeviceClass != CLASS_C )
     {
         Radio.Sleep( );
@@ -754,10 +801,13 @@ static void OnRadioRxDone( uint8_t *payload, uint32_t timestamp, uint16_t size,
 
     bool isMicOk = false;
 
+    TraceRecord( LORAMAC_TRACE_RX_DONE, RxWindowOpenTime, TimerGetCurrentTime( ) );
+
     McpsConfirm.AckReceived = false;
     McpsIndication.TimeStamp = timestamp;
     McpsIndication.Rssi = rssi;
     McpsIndication.Snr = snr;
+    McpsIndication.RxSf = sf;
     McpsIndication.RxSlot = RxSlot;
     McpsIndication.Port = 0;
     McpsIndication.Multicast = 0;
@@ -1492,6 +1542,9 @@ static void OnTxDelayedTimerEvent( void )
 
 static void OnRxWindow1TimerEvent( void )
 {
+    RxWindowOpenTime = TimerGetCurrentTime( );
+    TraceRecord( LORAMAC_TRACE_RX1_OPEN, AggregatedLastTxDoneTime + RxWindow1Delay, RxWindowOpenTime );
+
     TimerStop( &RxWindowTimer1 );
     RxSlot = 0;
 
@@ -1513,6 +1566,9 @@ static void OnRxWindow1TimerEvent( void )
 
 static void OnRxWindow2TimerEvent( void )
 {
+    RxWindowOpenTime = TimerGetCurrentTime( );
+    TraceRecord( LORAMAC_TRACE_RX2_OPEN, AggregatedLastTxDoneTime + RxWindow2Delay, RxWindowOpenTime );
+
     TimerStop( &RxWindowTimer2 );
 
     RxWindow2Config.Channel = Channel;
@@ -1602,12 +1658,22 @@ static void RxWindowSetup( bool rxContinuous, uint32_t maxRxWindow )
     }
 }
 
-bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
+static uint8_t GetMaxPayload( int8_t datarate )
 {
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
-    uint16_t maxN = 0;
-    uint16_t payloadSize = 0;
+
+    // Direct lookup in the tables of the region
+    if( ( LoRaMacPhyTable != NULL ) && ( datarate >= 0 ) && ( datarate < LoRaMacPhyTable->NbDatarates ) )
+    {
+        uint8_t dwell = ( LoRaMacParams.UplinkDwellTime == 0 ) ? 0 : 1;
+
+        if( RepeaterSupport == true )
+        {
+            return LoRaMacPhyTable->MaxPayloadRepeater[dwell][datarate];
+        }
+        return LoRaMacPhyTable->MaxPayload[dwell][datarate];
+    }
 
     // Setup PHY request
     getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
@@ -1620,7 +1686,32 @@ bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
         getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
     }
     phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    maxN = phyParam.Value;
+    return phyParam.Value;
+}
+
+static int8_t GetMinTxDatarate( void )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    if( LoRaMacPhyTable != NULL )
+    {
+        return LoRaMacPhyTable->TxMinDatarate[( LoRaMacParams.UplinkDwellTime == 0 ) ? 0 : 1];
+    }
+
+    getPhy.Attribute = PHY_MIN_TX_DR;
+    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
+    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
+    return phyParam.Value;
+}
+
+bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
+{
+    uint16_t maxN = 0;
+    uint16_t payloadSize = 0;
+
+    // Get the maximum payload length
+    maxN = GetMaxPayload( datarate );
 
     // Calculate the resulting payload size
     payloadSize = ( lenN + fOptsLen );
@@ -2346,8 +2437,17 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl
 LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
 {
     TxConfigParams_t txConfig;
+    ChannelParams_t* channels;
+    uint32_t size;
     int8_t txPower = 0;
 
+    // Remember the band for the airtime accounting at TX done
+    TxBand = 0;
+    if( RegionGetChannels( LoRaMacRegion, &channels, &size ) == true )
+    {
+        TxBand = channels[channel].Band;
+    }
+
     txConfig.Channel = channel;
     txConfig.Datarate = LoRaMacParams.ChannelsDatarate;
     txConfig.TxPower = LoRaMacParams.ChannelsTxPower;
@@ -2377,6 +2477,7 @@ LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
     }
 
     // Send now
+    TxStartTime = TimerGetCurrentTime( );
     Radio.Send( LoRaMacBuffer, LoRaMacBufferPktLen );
 
     LoRaMacState |= LORAMAC_TX_RUNNING;
@@ -2445,6 +2546,7 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacC
     LoRaMacPrimitives = primitives;
     LoRaMacCallbacks = callbacks;
     LoRaMacRegion = region;
+    LoRaMacPhyTable = RegionGetPhyTable( region );
 
     LoRaMacFlags.Value = 0;
 
@@ -2574,8 +2676,6 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t *primitives, LoRaMacC
 LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
 {
     AdrNextParams_t adrNext;
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     int8_t datarate = LoRaMacParamsDefaults.ChannelsDatarate;
     int8_t txPower = LoRaMacParamsDefaults.ChannelsTxPower;
     uint8_t fOptLen = MacCommandsBufferIndex + MacCommandsBufferToRepeatIndex;
@@ -2597,18 +2697,7 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
     // apply the datarate, the tx power and the ADR ack counter.
     RegionAdrNext( LoRaMacRegion, &adrNext, &datarate, &txPower, &AdrAckCounter );
 
-    // Setup PHY request
-    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
-    getPhy.Datarate = datarate;
-    getPhy.Attribute = PHY_MAX_PAYLOAD;
-
-    // Change request in case repeater is supported
-    if( RepeaterSupport == true )
-    {
-        getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
-    }
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
-    txInfo->CurrentPayloadSize = phyParam.Value;
+    txInfo->CurrentPayloadSize = GetMaxPayload( datarate );
 
     // Verify if the fOpts fit into the maximum payload
     if( txInfo->CurrentPayloadSize >= fOptLen )
@@ -3419,8 +3508,6 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t *mlmeRequest )
 
 LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t *mcpsRequest )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     LoRaMacStatus_t status = LORAMAC_STATUS_SERVICE_UNKNOWN;
     LoRaMacHeader_t macHdr;
     VerifyParams_t verify;
@@ -3494,13 +3581,9 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t *mcpsRequest )
         return LORAMAC_STATUS_PARAMETER_INVALID;
     }
 
-    // Get the minimum possible datarate
-    getPhy.Attribute = PHY_MIN_TX_DR;
-    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
-    phyParam = RegionGetPhyParam( LoRaMacRegion, &getPhy );
     // Apply the minimum possible datarate.
     // Some regions have limitations for the minimum datarate.
-    datarate = MAX( datarate, phyParam.Value );
+    datarate = MAX( datarate, GetMinTxDatarate( ) );
 
     if( readyToSend == true )
     {
@@ -3601,6 +3684,109 @@ void LoRaMacNvsSave( void )
     modlora_nvs_set_uint(E_LORA_NVS_ELE_ADR_ACKS, AdrAckCounter);
 }
 
+uint32_t LoRaMacNvsStateCrc( void )
+{
+    ChannelParams_t *channels;
+    uint16_t *channelmask;
+    uint32_t size;
+    uint32_t crc;
+
+    // everything LoRaMacNvsSave writes except the frame counters, the ADR ACK counter and
+    // the remaining channel mask, which change on (almost) every uplink
+    crc = crc32_le(0, (uint8_t *)&LoRaMacParams, sizeof(LoRaMacParams));
+    if (RegionGetChannels(LoRaMacRegion, &channels, &size)) {
+        crc = crc32_le(crc, (uint8_t *)channels, size);
+    }
+    if (RegionGetChannelMask(LoRaMacRegion, &channelmask, &size)) {
+        crc = crc32_le(crc, (uint8_t *)channelmask, size);
+    }
+    crc = crc32_le(crc, (uint8_t *)&SrvAckRequested, sizeof(SrvAckRequested));
+    crc = crc32_le(crc, (uint8_t *)&MacCommandsInNextTx, sizeof(MacCommandsInNextTx));
+    crc = crc32_le(crc, &MacCommandsBufferIndex, sizeof(MacCommandsBufferIndex));
+    crc = crc32_le(crc, &MacCommandsBufferToRepeatIndex, sizeof(MacCommandsBufferToRepeatIndex));
+    crc = crc32_le(crc, MacCommandsBuffer, sizeof(MacCommandsBuffer));
+    crc = crc32_le(crc, MacCommandsBufferToRepeat, sizeof(MacCommandsBufferToRepeat));
+    crc = crc32_le(crc, LoRaMacNwkSKey, sizeof(LoRaMacNwkSKey));
+    crc = crc32_le(crc, LoRaMacAppSKey, sizeof(LoRaMacAppSKey));
+    crc = crc32_le(crc, (uint8_t *)&LoRaMacNetID, sizeof(LoRaMacNetID));
+    crc = crc32_le(crc, (uint8_t *)&LoRaMacDevAddr, sizeof(LoRaMacDevAddr));
+    return crc;
+}
+
+bool LoRaMacSessionSave( LoRaMacSessionContext_t *ctx )
+{
+    ChannelParams_t *channels;
+    uint16_t *channelmask;
+    uint32_t size;
+
+    memset(ctx, 0, sizeof(LoRaMacSessionContext_t));
+    if (!RegionGetChannels(LoRaMacRegion, &channels, &size) || size > sizeof(ctx->Channels)) {
+        return false;
+    }
+    memcpy(ctx->Channels, channels, size);
+    ctx->ChannelsSize = size;
+
+    if (RegionGetChannelMask(LoRaMacRegion, &channelmask, &size)) {
+        if (size > sizeof(ctx->ChannelsMask)) {
+            return false;
+        }
+        memcpy(ctx->ChannelsMask, channelmask, size);
+        ctx->ChannelsMaskSize = size;
+    }
+
+    if (RegionGetChannelMaskRemaining(LoRaMacRegion, &channelmask, &size)) {
+        if (size > sizeof(ctx->ChannelsMaskRemaining)) {
+            return false;
+        }
+        memcpy(ctx->ChannelsMaskRemaining, channelmask, size);
+        ctx->ChannelsMaskRemainingSize = size;
+    }
+
+    ctx->MacParams = LoRaMacParams;
+    ctx->UpLinkCounter = UpLinkCounter;
+    ctx->DownLinkCounter = DownLinkCounter;
+    ctx->AdrAckCounter = AdrAckCounter;
+    ctx->NetID = LoRaMacNetID;
+    ctx->DevAddr = LoRaMacDevAddr;
+    memcpy(ctx->NwkSKey, LoRaMacNwkSKey, sizeof(ctx->NwkSKey));
+    memcpy(ctx->AppSKey, LoRaMacAppSKey, sizeof(ctx->AppSKey));
+    memcpy(ctx->MacCommandsBuffer, MacCommandsBuffer, sizeof(ctx->MacCommandsBuffer));
+    memcpy(ctx->MacCommandsBufferToRepeat, MacCommandsBufferToRepeat, sizeof(ctx->MacCommandsBufferToRepeat));
+    ctx->MacCommandsBufferIndex = MacCommandsBufferIndex;
+    ctx->MacCommandsBufferToRepeatIndex = MacCommandsBufferToRepeatIndex;
+    ctx->SrvAckRequested = SrvAckRequested;
+    ctx->MacCommandsInNextTx = MacCommandsInNextTx;
+    return true;
+}
+
+void LoRaMacSessionRestore( const LoRaMacSessionContext_t *ctx )
+{
+    ChannelParams_t *channels;
+    uint16_t *channelmask;
+    uint32_t size;
+
+    if (RegionGetChannels(LoRaMacRegion, &channels, &size) && size == ctx->ChannelsSize) {
+        memcpy(channels, ctx->Channels, size);
+    }
+    if (RegionGetChannelMask(LoRaMacRegion, &channelmask, &size) && size == ctx->ChannelsMaskSize) {
+        memcpy(channelmask, ctx->ChannelsMask, size);
+    }
+    if (RegionGetChannelMaskRemaining(LoRaMacRegion, &channelmask, &size) && size == ctx->ChannelsMaskRemainingSize) {
+        memcpy(channelmask, ctx->ChannelsMaskRemaining, size);
+    }
+
+    LoRaMacParams = ctx->MacParams;
+    UpLinkCounter = ctx->UpLinkCounter;
+    DownLinkCounter = ctx->DownLinkCounter;
+    AdrAckCounter = ctx->AdrAckCounter;
+    memcpy(MacCommandsBuffer, ctx->MacCommandsBuffer, sizeof(MacCommandsBuffer));
+    memcpy(MacCommandsBufferToRepeat, ctx->MacCommandsBufferToRepeat, sizeof(MacCommandsBufferToRepeat));
+    MacCommandsBufferIndex = ctx->MacCommandsBufferIndex;
+    MacCommandsBufferToRepeatIndex = ctx->MacCommandsBufferToRepeatIndex;
+    SrvAckRequested = ctx->SrvAckRequested;
+    MacCommandsInNextTx = ctx->MacCommandsInNextTx;
+}
+
 void LoRaMacGetChannelList(ChannelParams_t **channels, uint32_t *size) {
     RegionGetChannels(LoRaMacRegion, channels, size);
 }
@@ -3644,3 +3830,132 @@ uint8_t * LoRaMacGetMacCmdBufferRepeat(void) {
 uint32_t * LoRaMacGetAdrAckCounter(void) {
     return &AdrAckCounter;
 }
+
+static IRAM_ATTR void TraceRecord( LoRaMacTraceEvent_t event, TimerTime_t scheduled, TimerTime_t actual ) {
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    LoRaMacTraceSample_t *sample = &TraceRing[TraceHead % LORAMAC_TRACE_SIZE];
+    sample->Scheduled = scheduled;
+    sample->Actual = actual;
+    sample->Event = event;
+    TraceHead++;
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
+
+uint32_t LoRaMacTraceRead( LoRaMacTraceSample_t *samples, uint32_t max ) {
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t count = ( TraceHead < LORAMAC_TRACE_SIZE ) ? TraceHead : LORAMAC_TRACE_SIZE;
+    if( count > max ) {
+        count = max;
+    }
+    for( uint32_t i = 0; i < count; i++ ) {
+        samples[i] = TraceRing[( TraceHead - count + i ) % LORAMAC_TRACE_SIZE];
+    }
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+    return count;
+}
+
+void LoRaMacTraceClear( void ) {
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    TraceHead = 0;
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
+
+IRAM_ATTR void LoRaMacAirtimeRecord( uint8_t band, TimerTime_t timeOnAir, TimerTime_t txDoneTime ) {
+    uint32_t slotNumber = txDoneTime / LORAMAC_AIRTIME_SLOT_TIME;
+    uint32_t slot = slotNumber % LORAMAC_AIRTIME_SLOTS;
+
+    if( band >= LORAMAC_AIRTIME_BANDS_MAX ) {
+        return;
+    }
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    if( AirtimeSlotNumber[slot] != slotNumber ) {
+        // the slot belongs to a previous hour, start it over
+        for( uint8_t i = 0; i < LORAMAC_AIRTIME_BANDS_MAX; i++ ) {
+            AirtimeSlots[slot][i] = 0;
+        }
+        AirtimeSlotNumber[slot] = slotNumber;
+    }
+    AirtimeSlots[slot][band] += timeOnAir;
+    AirtimeLastTimeOnAir[band] = timeOnAir;
+    AirtimeLastTxDoneTime[band] = txDoneTime;
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
+
+uint8_t LoRaMacGetAirtime( TimerTime_t *airtime, uint8_t max ) {
+    Band_t* bands;
+    uint8_t nbBands;
+    uint32_t slotNumber = TimerGetCurrentTime( ) / LORAMAC_AIRTIME_SLOT_TIME;
+
+    if( RegionGetBands( LoRaMacRegion, &bands, &nbBands ) == false ) {
+        nbBands = 1;
+    }
+    if( nbBands > LORAMAC_AIRTIME_BANDS_MAX ) {
+        nbBands = LORAMAC_AIRTIME_BANDS_MAX;
+    }
+    if( nbBands > max ) {
+        nbBands = max;
+    }
+    for( uint8_t i = 0; i < nbBands; i++ ) {
+        airtime[i] = 0;
+    }
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    for( uint32_t s = 0; s < LORAMAC_AIRTIME_SLOTS; s++ ) {
+        if( ( slotNumber - AirtimeSlotNumber[s] ) < LORAMAC_AIRTIME_SLOTS ) {
+            for( uint8_t i = 0; i < nbBands; i++ ) {
+                airtime[i] += AirtimeSlots[s][i];
+            }
+        }
+    }
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+    return nbBands;
+}
+
+static TimerTime_t GetRemainingTimeOff( TimerTime_t timeOnAir, uint16_t dCycle, TimerTime_t txDoneTime ) {
+    TimerTime_t timeOff = ( dCycle > 0 ) ? ( timeOnAir * dCycle ) - timeOnAir : 0;
+    TimerTime_t elapsed = TimerGetElapsedTime( txDoneTime );
+
+    return ( timeOff > elapsed ) ? timeOff - elapsed : 0;
+}
+
+TimerTime_t LoRaMacGetNextTxDelay( void ) {
+    ChannelParams_t* channels;
+    uint16_t* channelmask = NULL;
+    Band_t* bands;
+    uint32_t size;
+    uint32_t maskSize = 0;
+    uint8_t nbBands;
+    TimerTime_t delay = UINT32_MAX;
+    TimerTime_t aggregatedDelay;
+
+    if( RegionGetBands( LoRaMacRegion, &bands, &nbBands ) == false ||
+        RegionGetChannels( LoRaMacRegion, &channels, &size ) == false ) {
+        return 0;
+    }
+    RegionGetChannelMask( LoRaMacRegion, &channelmask, &maskSize );
+
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    for( uint32_t i = 0; i < size / sizeof( ChannelParams_t ); i++ ) {
+        uint8_t band = channels[i].Band;
+
+        if( channels[i].Frequency == 0 || band >= nbBands || band >= LORAMAC_AIRTIME_BANDS_MAX ) {
+            continue;
+        }
+        if( channelmask != NULL && ( i / 16 ) < ( maskSize / sizeof( uint16_t ) ) &&
+            ( channelmask[i / 16] & ( 1 << ( i % 16 ) ) ) == 0 ) {
+            continue;
+        }
+        TimerTime_t bandDelay = GetRemainingTimeOff( AirtimeLastTimeOnAir[band], bands[band].DCycle,
+                                                     AirtimeLastTxDoneTime[band] );
+        if( bandDelay < delay ) {
+            delay = bandDelay;
+        }
+    }
+    aggregatedDelay = GetRemainingTimeOff( TxTimeOnAir, AggregatedDCycle, AggregatedLastTxDoneTime );
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+
+    if( delay == UINT32_MAX ) {
+        // no enabled channel
+        delay = 0;
+    }
+    return ( aggregatedDelay > delay ) ? aggregatedDelay : delay;
+}
@@ -952,6 +952,10 @@ typedef struct sMcpsIndication
      * Snr of the received packet
      */
     uint8_t Snr;
+    /*!
+     * Spreading factor of the received packet
+     */
+    uint8_t RxSf;
     /*!
      * Receive window
      *
@@ -2059,6 +2063,14 @@ bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen );
 
 void LoRaMacNvsSave( void );
 
+/*!
+ * \brief   CRC32 of the session state saved by LoRaMacNvsSave, excluding the
+ *          frame counters, the ADR ACK counter and the remaining channel mask
+ *
+ * \retval  CRC of the session state
+ */
+uint32_t LoRaMacNvsStateCrc( void );
+
 void LoRaMacGetChannelList(ChannelParams_t **channels, uint32_t *size);
 
 bool LoRaMacGetChannelsMask(uint16_t **channelmask, uint32_t *size);
@@ -2083,6 +2095,161 @@ uint8_t * LoRaMacGetMacCmdBufferRepeat(void);
 
 uint32_t * LoRaMacGetAdrAckCounter(void);
 
+/*!
+ * Number of RX window timing samples kept by the MAC
+ */
+#define LORAMAC_TRACE_SIZE                          32
+
+/*!
+ * MAC events recorded in the timing trace
+ */
+typedef enum eLoRaMacTraceEvent
+{
+    /*!
+     * Radio TX done, scheduled at TX start + time on air
+     */
+    LORAMAC_TRACE_TX_DONE,
+    /*!
+     * RX1 window opened, scheduled at TX done + RX1 delay
+     */
+    LORAMAC_TRACE_RX1_OPEN,
+    /*!
+     * RX2 window opened, scheduled at TX done + RX2 delay
+     */
+    LORAMAC_TRACE_RX2_OPEN,
+    /*!
+     * Radio RX done, "scheduled" is the time at which the RX window was opened
+     */
+    LORAMAC_TRACE_RX_DONE,
+}LoRaMacTraceEvent_t;
+
+/*!
+ * Timing trace sample, times are in ms from TimerGetCurrentTime
+ */
+typedef struct sLoRaMacTraceSample
+{
+    TimerTime_t Scheduled;
+    TimerTime_t Actual;
+    LoRaMacTraceEvent_t Event;
+}LoRaMacTraceSample_t;
+
+/*!
+ * \brief   Copies the most recent timing trace samples, oldest first
+ *
+ * \param   [OUT] samples Destination array
+ * \param   [IN] max Size of the destination array
+ *
+ * \retval  Number of samples copied
+ */
+uint32_t LoRaMacTraceRead( LoRaMacTraceSample_t *samples, uint32_t max );
+
+/*!
+ * \brief   Discards all timing trace samples
+ */
+void LoRaMacTraceClear( void );
+
+/*!
+ * Largest number of duty-cycle bands of the supported regions (EU868)
+ */
+#define LORAMAC_AIRTIME_BANDS_MAX                   5
+
+/*!
+ * Airtime accounting window, in slots of LORAMAC_AIRTIME_SLOT_TIME ms (1 hour)
+ */
+#define LORAMAC_AIRTIME_SLOTS                       60
+#define LORAMAC_AIRTIME_SLOT_TIME                   60000
+
+/*!
+ * \brief   Accounts a completed transmission to a band. Can be called from
+ *          the radio ISR
+ *
+ * \param   [IN] band Band of the channel used for the transmission
+ * \param   [IN] timeOnAir Time on air of the transmission [ms]
+ * \param   [IN] txDoneTime Time at which the transmission ended
+ */
+void LoRaMacAirtimeRecord( uint8_t band, TimerTime_t timeOnAir, TimerTime_t txDoneTime );
+
+/*!
+ * \brief   Returns the time on air used by every band during the last hour
+ *
+ * \param   [OUT] airtime Time on air per band [ms]
+ * \param   [IN] max Size of the destination array
+ *
+ * \retval  Number of bands copied
+ */
+uint8_t LoRaMacGetAirtime( TimerTime_t *airtime, uint8_t max );
+
+/*!
+ * \brief   Computes the time left until the duty-cycle rules of the region
+ *          allow the next transmission on at least one enabled channel. The
+ *          band time-off is computed even when the MAC duty-cycle enforcement
+ *          is disabled
+ *
+ * \retval  Time to wait [ms], 0 when a transmission is allowed right away
+ */
+TimerTime_t LoRaMacGetNextTxDelay( void );
+
+/*!
+ * Largest channel plan that fits in a session context (US915, AU915)
+ */
+#define LORAMAC_SESSION_CHANNELS_MAX                72
+
+/*!
+ * Largest channel mask that fits in a session context
+ */
+#define LORAMAC_SESSION_CHANNELS_MASK_SIZE          6
+
+/*!
+ * Size of the MAC command buffers in a session context
+ */
+#define LORAMAC_SESSION_MAC_CMD_SIZE                128
+
+/*!
+ * Snapshot of an activated LoRaWAN session, the same state LoRaMacNvsSave
+ * writes to NVS plus the frame counters
+ */
+typedef struct sLoRaMacSessionContext
+{
+    LoRaMacParams_t MacParams;
+    ChannelParams_t Channels[LORAMAC_SESSION_CHANNELS_MAX];
+    uint16_t ChannelsMask[LORAMAC_SESSION_CHANNELS_MASK_SIZE];
+    uint16_t ChannelsMaskRemaining[LORAMAC_SESSION_CHANNELS_MASK_SIZE];
+    uint32_t ChannelsSize;
+    uint32_t ChannelsMaskSize;
+    uint32_t ChannelsMaskRemainingSize;
+    uint32_t UpLinkCounter;
+    uint32_t DownLinkCounter;
+    uint32_t AdrAckCounter;
+    uint32_t NetID;
+    uint32_t DevAddr;
+    uint8_t NwkSKey[16];
+    uint8_t AppSKey[16];
+    uint8_t MacCommandsBuffer[LORAMAC_SESSION_MAC_CMD_SIZE];
+    uint8_t MacCommandsBufferToRepeat[LORAMAC_SESSION_MAC_CMD_SIZE];
+    uint8_t MacCommandsBufferIndex;
+    uint8_t MacCommandsBufferToRepeatIndex;
+    bool SrvAckRequested;
+    bool MacCommandsInNextTx;
+}LoRaMacSessionContext_t;
+
+/*!
+ * \brief   Copies the current session into a context
+ *
+ * \param   [OUT] ctx Session context
+ *
+ * \retval  [true: the session fits in the context, false: it doesn't]
+ */
+bool LoRaMacSessionSave( LoRaMacSessionContext_t *ctx );
+
+/*!
+ * \brief   Restores a session saved with LoRaMacSessionSave, on top of a MAC
+ *          initialized for the same region. The keys, DevAddr and NetID are
+ *          still applied through the MIB by the caller.
+ *
+ * \param   [IN] ctx Session context
+ */
+void LoRaMacSessionRestore( const LoRaMacSessionContext_t *ctx );
+
 /*! \} defgroup LORAMAC */
 
 #endif // __LORAMAC_H__
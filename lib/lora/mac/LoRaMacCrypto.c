@@ -19,6 +19,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 */
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "utilities.h"
 
 #include "lora/system/crypto/aes.h"
@@ -26,6 +27,38 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 
 #include "LoRaMacCrypto.h"
 
+/*!
+ * Route AES through the ESP32 hardware engine instead of the software implementation
+ */
+#ifndef LORAMAC_CRYPTO_HW_AES
+#define LORAMAC_CRYPTO_HW_AES                       1
+#endif
+
+#if LORAMAC_CRYPTO_HW_AES
+#include "hwcrypto/aes.h"
+
+/*!
+ * Number of keys kept loaded (NwkSKey, AppSKey and AppKey)
+ */
+#define LORAMAC_CRYPTO_KEY_CACHE_SIZE               3
+
+/*!
+ * Hardware AES context and CMAC subkeys of a key
+ */
+typedef struct sCryptoKey
+{
+    uint8_t Key[16];
+    uint8_t K1[16];
+    uint8_t K2[16];
+    esp_aes_context Ctx;
+    bool Valid;
+}CryptoKey_t;
+
+static CryptoKey_t CryptoKeyCache[LORAMAC_CRYPTO_KEY_CACHE_SIZE];
+static uint8_t CryptoKeyCacheNext = 0;
+static CryptoKey_t *CryptoCurrentKey = NULL;
+#endif
+
 /*!
  * CMAC/AES Message Integrity Code (MIC) Block B0 size
  */
@@ -55,6 +88,7 @@ static uint8_t sBlock[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                             0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
                           };
 
+#if !LORAMAC_CRYPTO_HW_AES
 /*!
  * AES computation context variable
  */
@@ -64,6 +98,149 @@ static aes_context AesContext;
  * CMAC computation context variable
  */
 static AES_CMAC_CTX AesCmacCtx[1];
+#endif
+
+#if LORAMAC_CRYPTO_HW_AES
+
+static void CryptoEncryptBlock( const uint8_t *in, uint8_t *out )
+{
+    esp_aes_crypt_ecb( &CryptoCurrentKey->Ctx, ESP_AES_ENCRYPT, in, out );
+}
+
+/*!
+ * Derives the CMAC subkey "out" from "in" (RFC 4493, section 2.3)
+ */
+static void CryptoCmacSubkey( const uint8_t *in, uint8_t *out )
+{
+    uint8_t msb = in[0] & 0x80;
+
+    for( uint8_t i = 0; i < 15; i++ )
+    {
+        out[i] = ( in[i] << 1 ) | ( in[i + 1] >> 7 );
+    }
+    out[15] = in[15] << 1;
+    if( msb != 0 )
+    {
+        out[15] ^= 0x87;
+    }
+}
+
+/*!
+ * Selects the key used by the next operations. Keys are cached together with
+ * their CMAC subkeys, so a session key is only set up once and not per frame
+ */
+static void CryptoSetKey( const uint8_t *key )
+{
+    uint8_t zero[16] = { 0 };
+    uint8_t l[16];
+
+    if( ( CryptoCurrentKey != NULL ) && ( memcmp( CryptoCurrentKey->Key, key, 16 ) == 0 ) )
+    {
+        return;
+    }
+    for( uint8_t i = 0; i < LORAMAC_CRYPTO_KEY_CACHE_SIZE; i++ )
+    {
+        if( CryptoKeyCache[i].Valid && ( memcmp( CryptoKeyCache[i].Key, key, 16 ) == 0 ) )
+        {
+            CryptoCurrentKey = &CryptoKeyCache[i];
+            return;
+        }
+    }
+
+    // replace the oldest entry
+    CryptoCurrentKey = &CryptoKeyCache[CryptoKeyCacheNext];
+    CryptoKeyCacheNext = ( CryptoKeyCacheNext + 1 ) % LORAMAC_CRYPTO_KEY_CACHE_SIZE;
+
+    memcpy1( CryptoCurrentKey->Key, key, 16 );
+    esp_aes_init( &CryptoCurrentKey->Ctx );
+    esp_aes_setkey( &CryptoCurrentKey->Ctx, key, 128 );
+    CryptoEncryptBlock( zero, l );
+    CryptoCmacSubkey( l, CryptoCurrentKey->K1 );
+    CryptoCmacSubkey( CryptoCurrentKey->K1, CryptoCurrentKey->K2 );
+    CryptoCurrentKey->Valid = true;
+}
+
+/*!
+ * Computes the AES-CMAC of the optional 16 bytes block "b0" followed by "buffer"
+ */
+static void CryptoCmac( const uint8_t *key, const uint8_t *b0, const uint8_t *buffer, uint16_t size, uint8_t *mac )
+{
+    uint8_t block[16];
+    uint16_t prefixSize = ( b0 != NULL ) ? LORAMAC_MIC_BLOCK_B0_SIZE : 0;
+    uint16_t total = prefixSize + size;
+    uint16_t nBlocks = ( total + 15 ) / 16;
+    uint16_t pos = 0;
+
+    CryptoSetKey( key );
+    memset1( mac, 0, 16 );
+    if( nBlocks == 0 )
+    {
+        nBlocks = 1;
+    }
+
+    for( uint16_t n = 0; n < nBlocks; n++ )
+    {
+        uint8_t len = 0;
+        for( ; ( len < 16 ) && ( pos < total ); len++, pos++ )
+        {
+            block[len] = ( pos < prefixSize ) ? b0[pos] : buffer[pos - prefixSize];
+        }
+        if( n == ( nBlocks - 1 ) )
+        {
+            // last block, complete blocks use K1, padded ones K2
+            const uint8_t *subkey = CryptoCurrentKey->K1;
+            if( len < 16 )
+            {
+                block[len++] = 0x80;
+                for( ; len < 16; len++ )
+                {
+                    block[len] = 0;
+                }
+                subkey = CryptoCurrentKey->K2;
+            }
+            for( uint8_t i = 0; i < 16; i++ )
+            {
+                block[i] ^= subkey[i];
+            }
+        }
+        for( uint8_t i = 0; i < 16; i++ )
+        {
+            mac[i] ^= block[i];
+        }
+        CryptoEncryptBlock( mac, mac );
+    }
+}
+
+#else
+
+static void CryptoEncryptBlock( const uint8_t *in, uint8_t *out )
+{
+    aes_encrypt_lora( in, out, &AesContext );
+}
+
+static void CryptoSetKey( const uint8_t *key )
+{
+    memset1( AesContext.ksch, '\0', 240 );
+    aes_set_key_lora( key, 16, &AesContext );
+}
+
+static void CryptoCmac( const uint8_t *key, const uint8_t *b0, const uint8_t *buffer, uint16_t size, uint8_t *mac )
+{
+    AES_CMAC_Init( AesCmacCtx );
+
+    AES_CMAC_SetKey( AesCmacCtx, key );
+
+    if( b0 != NULL )
+    {
+        AES_CMAC_Update( AesCmacCtx, b0, LORAMAC_MIC_BLOCK_B0_SIZE );
+    }
+
+    AES_CMAC_Update( AesCmacCtx, buffer, size );
+
+    AES_CMAC_Final( mac, AesCmacCtx );
+}
+
+#endif
 
 /*!
  * \brief Computes the LoRaMAC frame MIC field
@@ -92,15 +269,7 @@ void LoRaMacComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t *key
 
     MicBlockB0[15] = size & 0xFF;
 
-    AES_CMAC_Init( AesCmacCtx );
-
-    AES_CMAC_SetKey( AesCmacCtx, key );
-
-    AES_CMAC_Update( AesCmacCtx, MicBlockB0, LORAMAC_MIC_BLOCK_B0_SIZE );
-
-    AES_CMAC_Update( AesCmacCtx, buffer, size & 0xFF );
-
-    AES_CMAC_Final( Mic, AesCmacCtx );
+    CryptoCmac( key, MicBlockB0, buffer, size & 0xFF, Mic );
 
     *mic = ( uint32_t )( ( uint32_t )Mic[3] << 24 | ( uint32_t )Mic[2] << 16 | ( uint32_t )Mic[1] << 8 | ( uint32_t )Mic[0] );
 }
@@ -111,8 +280,7 @@ void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t
     uint8_t bufferIndex = 0;
     uint16_t ctr = 1;
 
-    memset1( AesContext.ksch, '\0', 240 );
-    aes_set_key_lora( key, 16, &AesContext );
+    CryptoSetKey( key );
 
     aBlock[5] = dir;
 
@@ -130,7 +298,7 @@ void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t
     {
         aBlock[15] = ( ( ctr ) & 0xFF );
         ctr++;
-        aes_encrypt_lora( aBlock, sBlock, &AesContext );
+        CryptoEncryptBlock( aBlock, sBlock );
         for( i = 0; i < 16; i++ )
         {
             encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
@@ -142,7 +310,7 @@ void LoRaMacPayloadEncrypt( const uint8_t *buffer, uint16_t size, const uint8_t
     if( size > 0 )
     {
         aBlock[15] = ( ( ctr ) & 0xFF );
-        aes_encrypt_lora( aBlock, sBlock, &AesContext );
+        CryptoEncryptBlock( aBlock, sBlock );
         for( i = 0; i < size; i++ )
         {
             encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
@@ -157,26 +325,19 @@ void LoRaMacPayloadDecrypt( const uint8_t *buffer, uint16_t size, const uint8_t
 
 void LoRaMacJoinComputeMic( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t *mic )
 {
-    AES_CMAC_Init( AesCmacCtx );
-
-    AES_CMAC_SetKey( AesCmacCtx, key );
-
-    AES_CMAC_Update( AesCmacCtx, buffer, size & 0xFF );
-
-    AES_CMAC_Final( Mic, AesCmacCtx );
+    CryptoCmac( key, NULL, buffer, size & 0xFF, Mic );
 
     *mic = ( uint32_t )( ( uint32_t )Mic[3] << 24 | ( uint32_t )Mic[2] << 16 | ( uint32_t )Mic[1] << 8 | ( uint32_t )Mic[0] );
 }
 
 void LoRaMacJoinDecrypt( const uint8_t *buffer, uint16_t size, const uint8_t *key, uint8_t *decBuffer )
 {
-    memset1( AesContext.ksch, '\0', 240 );
-    aes_set_key_lora( key, 16, &AesContext );
-    aes_encrypt_lora( buffer, decBuffer, &AesContext );
+    CryptoSetKey( key );
+    CryptoEncryptBlock( buffer, decBuffer );
     // Check if optional CFList is included
     if( size >= 16 )
     {
-        aes_encrypt_lora( buffer + 16, decBuffer + 16, &AesContext );
+        CryptoEncryptBlock( buffer + 16, decBuffer + 16 );
     }
 }
 
@@ -185,18 +346,17 @@ void LoRaMacJoinComputeSKeys( const uint8_t *key, const uint8_t *appNonce, uint1
     uint8_t nonce[16];
     uint8_t *pDevNonce = ( uint8_t * )&devNonce;
 
-    memset1( AesContext.ksch, '\0', 240 );
-    aes_set_key_lora( key, 16, &AesContext );
+    CryptoSetKey( key );
 
     memset1( nonce, 0, sizeof( nonce ) );
     nonce[0] = 0x01;
     memcpy1( nonce + 1, appNonce, 6 );
     memcpy1( nonce + 7, pDevNonce, 2 );
-    aes_encrypt_lora( nonce, nwkSKey, &AesContext );
+    CryptoEncryptBlock( nonce, nwkSKey );
 
     memset1( nonce, 0, sizeof( nonce ) );
     nonce[0] = 0x02;
     memcpy1( nonce + 1, appNonce, 6 );
     memcpy1( nonce + 7, pDevNonce, 2 );
-    aes_encrypt_lora( nonce, appSKey, &AesContext );
+    CryptoEncryptBlock( nonce, appSKey );
 }
@@ -61,6 +61,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AS923_GET_CHANNELS( )                      else if(region == LORAMAC_REGION_AS923) { return RegionAS923GetChannels( channels, size ); }
 #define AS923_GET_CHANNEL_MASK( )                  else if(region == LORAMAC_REGION_AS923) { return RegionAS923GetChannelMask( channelmask, size ); }
 #define AS923_FORCE_JOIN_DATARATE( )               else if(region == LORAMAC_REGION_AS923) { return RegionAS923ForceJoinDataRate( joinDr, alternateDr ); }
+#define AS923_PHY_TABLE( )                         [LORAMAC_REGION_AS923] = &RegionAS923PhyTable,
+#define AS923_GET_BANDS( )                         else if(region == LORAMAC_REGION_AS923) { return RegionAS923GetBands( bands, nbBands ); }
 #else
 #define AS923_IS_ACTIVE( )
 #define AS923_GET_PHY_PARAM( )
@@ -90,6 +92,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AS923_GET_CHANNELS( )
 #define AS923_GET_CHANNEL_MASK( )
 #define AS923_FORCE_JOIN_DATARATE( )
+#define AS923_PHY_TABLE( )
+#define AS923_GET_BANDS( )
 #endif
 
 #ifdef REGION_AU915
@@ -123,6 +127,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AU915_GET_CHANNEL_MASK( )                  else if(region == LORAMAC_REGION_AU915) { return RegionAU915GetChannelMask( channelmask, size ); }
 #define AU915_GET_CHANNEL_MASK_REMAINING( )        else if(region == LORAMAC_REGION_AU915) { return RegionAU915GetChannelMaskRemaining( channelmask, size ); }
 #define AU915_FORCE_JOIN_DATARATE( )               else if(region == LORAMAC_REGION_AU915) { return RegionAU915ForceJoinDataRate( joinDr, alternateDr ); }
+#define AU915_PHY_TABLE( )                         [LORAMAC_REGION_AU915] = &RegionAU915PhyTable,
+#define AU915_GET_BANDS( )                         else if(region == LORAMAC_REGION_AU915) { return RegionAU915GetBands( bands, nbBands ); }
 #else
 #define AU915_IS_ACTIVE( )
 #define AU915_GET_PHY_PARAM( )
@@ -153,6 +159,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AU915_GET_CHANNEL_MASK( )
 #define AU915_GET_CHANNEL_MASK_REMAINING( )
 #define AU915_FORCE_JOIN_DATARATE( )
+#define AU915_PHY_TABLE( )
+#define AU915_GET_BANDS( )
 #endif
 
 #ifdef REGION_CN470
@@ -183,6 +191,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN470_SET_CONTINUOUS_WAVE( )               else if(region == LORAMAC_REGION_CN470) { RegionCN470SetContinuousWave( continuousWave );}
 #define CN470_APPLY_DR_OFFSET( )                   else if(region == LORAMAC_REGION_CN470) { return RegionCN470ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define CN470_FORCE_JOIN_DATARATE( )               else if(region == LORAMAC_REGION_CN470) { return RegionCN470ForceJoinDataRate( joinDr, alternateDr ); }
+#define CN470_PHY_TABLE( )                         [LORAMAC_REGION_CN470] = &RegionCN470PhyTable,
+#define CN470_GET_BANDS( )
 #else
 #define CN470_IS_ACTIVE( )
 #define CN470_GET_PHY_PARAM( )
@@ -210,6 +220,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN470_SET_CONTINUOUS_WAVE( )
 #define CN470_APPLY_DR_OFFSET( )
 #define CN470_FORCE_JOIN_DATARATE( )
+#define CN470_PHY_TABLE( )
+#define CN470_GET_BANDS( )
 #endif
 
 #ifdef REGION_CN779
@@ -237,6 +249,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN779_CHANNEL_REMOVE( )                    else if(region == LORAMAC_REGION_CN779) { return RegionCN779ChannelsRemove( channelRemove ); }
 #define CN779_SET_CONTINUOUS_WAVE( )               else if(region == LORAMAC_REGION_CN779) { RegionCN779SetContinuousWave( continuousWave );}
 #define CN779_APPLY_DR_OFFSET( )                   else if(region == LORAMAC_REGION_CN779) { return RegionCN779ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
+#define CN779_PHY_TABLE( )
+#define CN779_GET_BANDS( )
 #else
 #define CN779_IS_ACTIVE( )
 #define CN779_GET_PHY_PARAM( )
@@ -261,6 +275,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN779_CHANNEL_REMOVE( )
 #define CN779_SET_CONTINUOUS_WAVE( )
 #define CN779_APPLY_DR_OFFSET( )
+#define CN779_PHY_TABLE( )
+#define CN779_GET_BANDS( )
 #endif
 
 #ifdef REGION_EU433
@@ -288,6 +304,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU433_CHANNEL_REMOVE( )                    else if(region == LORAMAC_REGION_EU433) { return RegionEU433ChannelsRemove( channelRemove ); }
 #define EU433_SET_CONTINUOUS_WAVE( )               else if(region == LORAMAC_REGION_EU433) { RegionEU433SetContinuousWave( continuousWave );}
 #define EU433_APPLY_DR_OFFSET( )                   else if(region == LORAMAC_REGION_EU433) { return RegionEU433ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
+#define EU433_PHY_TABLE( )
+#define EU433_GET_BANDS( )
 #else
 #define EU433_IS_ACTIVE( )
 #define EU433_GET_PHY_PARAM( )
@@ -312,6 +330,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU433_CHANNEL_REMOVE( )
 #define EU433_SET_CONTINUOUS_WAVE( )
 #define EU433_APPLY_DR_OFFSET( )
+#define EU433_PHY_TABLE( )
+#define EU433_GET_BANDS( )
 #endif
 
 #ifdef REGION_EU868
@@ -344,6 +364,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU868_GET_CHANNELS( )                      else if(region == LORAMAC_REGION_EU868) { return RegionEU868GetChannels( channels, size ); }
 #define EU868_GET_CHANNEL_MASK( )                  else if(region == LORAMAC_REGION_EU868) { return RegionEU868GetChannelMask( channelmask, size ); }
 #define EU868_FORCE_JOIN_DATARATE( )               else if(region == LORAMAC_REGION_EU868) { return RegionEU868ForceJoinDataRate( joinDr, alternateDr ); }
+#define EU868_PHY_TABLE( )                         [LORAMAC_REGION_EU868] = &RegionEU868PhyTable,
+#define EU868_GET_BANDS( )                         else if(region == LORAMAC_REGION_EU868) { return RegionEU868GetBands( bands, nbBands ); }
 #else
 #define EU868_IS_ACTIVE( )
 #define EU868_GET_PHY_PARAM( )
@@ -373,6 +395,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU868_GET_CHANNELS( )
 #define EU868_GET_CHANNEL_MASK( )
 #define EU868_FORCE_JOIN_DATARATE( )
+#define EU868_PHY_TABLE( )
+#define EU868_GET_BANDS( )
 #endif
 
 #ifdef REGION_KR920
@@ -400,6 +424,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define KR920_CHANNEL_REMOVE( )                    else if(region == LORAMAC_REGION_KR920) { return RegionKR920ChannelsRemove( channelRemove ); }
 #define KR920_SET_CONTINUOUS_WAVE( )               else if(region == LORAMAC_REGION_KR920) { RegionKR920SetContinuousWave( continuousWave );}
 #define KR920_APPLY_DR_OFFSET( )                   else if(region == LORAMAC_REGION_KR920) { return RegionKR920ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
+#define KR920_PHY_TABLE( )
+#define KR920_GET_BANDS( )
 #else
 #define KR920_IS_ACTIVE( )
 #define KR920_GET_PHY_PARAM( )
@@ -424,6 +450,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define KR920_CHANNEL_REMOVE( )
 #define KR920_SET_CONTINUOUS_WAVE( )
 #define KR920_APPLY_DR_OFFSET( )
+#define KR920_PHY_TABLE( )
+#define KR920_GET_BANDS( )
 #endif
 
 #ifdef REGION_IN865
@@ -456,6 +484,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define IN865_GET_CHANNELS( )                     else if(region == LORAMAC_REGION_IN865) { return RegionIN865GetChannels( channels, size ); }
 #define IN865_GET_CHANNEL_MASK( )                 else if(region == LORAMAC_REGION_IN865) { return RegionIN865GetChannelMask( channelmask, size ); }
 #define IN865_FORCE_JOIN_DATARATE( )              else if(region == LORAMAC_REGION_IN865) { return RegionIN865ForceJoinDataRate( joinDr, alternateDr ); }
+#define IN865_PHY_TABLE( )                         [LORAMAC_REGION_IN865] = &RegionIN865PhyTable,
+#define IN865_GET_BANDS( )                         else if(region == LORAMAC_REGION_IN865) { return RegionIN865GetBands( bands, nbBands ); }
 #else
 #define IN865_IS_ACTIVE( )
 #define IN865_GET_PHY_PARAM( )
@@ -485,6 +515,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define IN865_GET_CHANNELS( )
 #define IN865_GET_CHANNEL_MASK( )
 #define IN865_FORCE_JOIN_DATARATE( )
+#define IN865_PHY_TABLE( )
+#define IN865_GET_BANDS( )
 #endif
 
 #ifdef REGION_US915
@@ -518,6 +550,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_GET_CHANNEL_MASK( )                  else if(region == LORAMAC_REGION_US915) { return RegionUS915GetChannelMask( channelmask, size ); }
 #define US915_GET_CHANNEL_MASK_REMAINING( )        else if(region == LORAMAC_REGION_US915) { return RegionUS915GetChannelMaskRemaining( channelmask, size ); }
 #define US915_FORCE_JOIN_DATARATE( )               else if(region == LORAMAC_REGION_US915) { return RegionUS915ForceJoinDataRate( joinDr, alternateDr ); }
+#define US915_PHY_TABLE( )                         [LORAMAC_REGION_US915] = &RegionUS915PhyTable,
+#define US915_GET_BANDS( )                         else if(region == LORAMAC_REGION_US915) { return RegionUS915GetBands( bands, nbBands ); }
 #else
 #define US915_IS_ACTIVE( )
 #define US915_GET_PHY_PARAM( )
@@ -548,6 +582,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_GET_CHANNEL_MASK( )
 #define US915_GET_CHANNEL_MASK_REMAINING( )
 #define US915_FORCE_JOIN_DATARATE( )
+#define US915_PHY_TABLE( )
+#define US915_GET_BANDS( )
 #endif
 
 #ifdef REGION_US915_HYBRID
@@ -581,6 +617,8 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_HYBRID_GET_CHANNEL_MASK( )                  else if(region == LORAMAC_REGION_US915_HYBRID) { return RegionUS915HybridGetChannelMask( channelmask, size ); }
 #define US915_HYBRID_GET_CHANNEL_MASK_REMAINING( )        else if(region == LORAMAC_REGION_US915_HYBRID) { return RegionUS915HybridGetChannelMaskRemaining( channelmask, size ); }
 #define US915_HYBRID_FORCE_JOIN_DATARATE( )               else if(region == LORAMAC_REGION_US915_HYBRID) { return RegionUS915HybridForceJoinDataRate( joinDr, alternateDr ); }
+#define US915_HYBRID_PHY_TABLE( )
+#define US915_HYBRID_GET_BANDS( )
 #else
 #define US915_HYBRID_IS_ACTIVE( )
 #define US915_HYBRID_GET_PHY_PARAM( )
@@ -611,8 +649,28 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_HYBRID_GET_CHANNEL_MASK( )
 #define US915_HYBRID_GET_CHANNEL_MASK_REMAINING( )
 #define US915_HYBRID_FORCE_JOIN_DATARATE( )
+#define US915_HYBRID_PHY_TABLE( )
+#define US915_HYBRID_GET_BANDS( )
 #endif
 
+/*!
+ * Constant PHY tables, indexed by region. Regions without tables use the
+ * generic RegionGetPhyParam dispatch.
+ */
+static const RegionPhyTable_t* const RegionPhyTables[LORAMAC_REGION_MAX] =
+{
+    AS923_PHY_TABLE( )
+    AU915_PHY_TABLE( )
+    CN470_PHY_TABLE( )
+    CN779_PHY_TABLE( )
+    EU433_PHY_TABLE( )
+    EU868_PHY_TABLE( )
+    KR920_PHY_TABLE( )
+    IN865_PHY_TABLE( )
+    US915_PHY_TABLE( )
+    US915_HYBRID_PHY_TABLE( )
+};
+
 bool RegionIsActive( LoRaMacRegion_t region )
 {
     if(region >= LORAMAC_REGION_MAX) {
@@ -655,6 +713,14 @@ IRAM_ATTR PhyParam_t RegionGetPhyParam( LoRaMacRegion_t region, GetPhyParams_t*
     }
 }
 
+const RegionPhyTable_t* RegionGetPhyTable( LoRaMacRegion_t region )
+{
+    if(region >= LORAMAC_REGION_MAX) {
+        return NULL;
+    }
+    return RegionPhyTables[region];
+}
+
 IRAM_ATTR void RegionSetBandTxDone( LoRaMacRegion_t region, SetBandTxDoneParams_t* txDone )
 {
     if(region >= LORAMAC_REGION_MAX) {
@@ -1133,6 +1199,22 @@ bool RegionGetChannels( LoRaMacRegion_t region, ChannelParams_t** channels, uint
     }
 }
 
+bool RegionGetBands( LoRaMacRegion_t region, Band_t** bands, uint8_t *nbBands )
+{
+
+    if(region >= LORAMAC_REGION_MAX) {
+        return false;
+    }
+    AS923_GET_BANDS( )
+    AU915_GET_BANDS( )
+    EU868_GET_BANDS( )
+    IN865_GET_BANDS( )
+    US915_GET_BANDS( )
+    else {
+        return false;
+    }
+}
+
 bool RegionGetChannelMask(LoRaMacRegion_t region, uint16_t **channelmask, uint32_t *size ) {
 
     if(region >= LORAMAC_REGION_MAX) {
@@ -1167,6 +1167,39 @@ typedef struct sContinuousWaveParams
     uint16_t Timeout;
 }ContinuousWaveParams_t;
 
+/*!
+ * Constant PHY tables of a region, for the lookups done on every uplink.
+ * The tables are indexed by datarate, the first dimension of the payload and
+ * minimum datarate entries is the uplink dwell time setting.
+ */
+typedef struct sRegionPhyTable
+{
+    /*!
+     * Maximum MAC payload size
+     */
+    const uint8_t* MaxPayload[2];
+    /*!
+     * Maximum MAC payload size with repeater support
+     */
+    const uint8_t* MaxPayloadRepeater[2];
+    /*!
+     * Symbol time in ms, evaluated at build time
+     */
+    const double* SymbolTimes;
+    /*!
+     * Number of entries of the tables above
+     */
+    uint8_t NbDatarates;
+    /*!
+     * Minimum TX datarate
+     */
+    int8_t TxMinDatarate[2];
+    /*!
+     * Maximum TX datarate
+     */
+    int8_t TxMaxDatarate;
+}RegionPhyTable_t;
+
 
 
 /*!
@@ -1190,6 +1223,16 @@ bool RegionIsActive( LoRaMacRegion_t region );
  */
 PhyParam_t RegionGetPhyParam( LoRaMacRegion_t region, GetPhyParams_t* getPhy );
 
+/*!
+ * \brief Returns the constant PHY tables of a region. The lookup is a direct
+ *        index, unlike RegionGetPhyParam which dispatches on region and attribute.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \retval Pointer to the tables, NULL if the region doesn't provide them.
+ */
+const RegionPhyTable_t* RegionGetPhyTable( LoRaMacRegion_t region );
+
 /*!
  * \brief Updates the last TX done parameters of the current channel.
  *
@@ -1491,6 +1534,8 @@ uint8_t RegionApplyDrOffset( LoRaMacRegion_t region, uint8_t downlinkDwellTime,
 
 bool RegionGetChannels( LoRaMacRegion_t region, ChannelParams_t** channels, uint32_t *size);
 
+bool RegionGetBands( LoRaMacRegion_t region, Band_t** bands, uint8_t *nbBands );
+
 bool RegionGetChannelMask(LoRaMacRegion_t region, uint16_t **channelmask, uint32_t *size );
 
 bool RegionGetChannelMaskRemaining(LoRaMacRegion_t region, uint16_t **channelmask, uint32_t *size );
@@ -59,6 +59,34 @@ static uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Symbol times of the datarates [ms]
+ */
+static const double SymbolTimesAS923[] =
+{
+    REGION_COMMON_SYMBOL_TIME_LORA( 12, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 11, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 250000 ),
+    REGION_COMMON_SYMBOL_TIME_FSK( 50 )
+};
+
+/*!
+ * Constant PHY tables
+ */
+const RegionPhyTable_t RegionAS923PhyTable =
+{
+    .MaxPayload = { MaxPayloadOfDatarateDwell0AS923, MaxPayloadOfDatarateDwell1UpAS923 },
+    .MaxPayloadRepeater = { MaxPayloadOfDatarateRepeaterDwell0AS923, MaxPayloadOfDatarateDwell1UpAS923 },
+    .SymbolTimes = SymbolTimesAS923,
+    .NbDatarates = sizeof( SymbolTimesAS923 ) / sizeof( SymbolTimesAS923[0] ),
+    .TxMinDatarate = { AS923_TX_MIN_DATARATE, AS923_DWELL_LIMIT_DATARATE },
+    .TxMaxDatarate = AS923_TX_MAX_DATARATE,
+};
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -575,14 +603,7 @@ void RegionAS923ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
     rxConfigParams->Datarate = MIN( datarate, AS923_RX_MAX_DATARATE );
     rxConfigParams->Bandwidth = GetBandwidth( rxConfigParams->Datarate );
 
-    if( rxConfigParams->Datarate == DR_7 )
-    { // FSK
-        tSymbol = RegionCommonComputeSymbolTimeFsk( DataratesAS923[rxConfigParams->Datarate] );
-    }
-    else
-    { // LoRa
-        tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesAS923[rxConfigParams->Datarate], BandwidthsAS923[rxConfigParams->Datarate] );
-    }
+    tSymbol = SymbolTimesAS923[rxConfigParams->Datarate];
 
     RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, RADIO_WAKEUP_TIME, &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
     rxConfigParams->WindowTimeout = rxConfigParams->WindowTimeout * 3;
@@ -1174,6 +1195,13 @@ bool RegionAS923GetChannels( ChannelParams_t** channels, uint32_t *size )
     return true;
 }
 
+bool RegionAS923GetBands( Band_t** bands, uint8_t *nbBands )
+{
+    *bands = Bands;
+    *nbBands = AS923_MAX_NB_BANDS;
+    return true;
+}
+
 bool RegionAS923GetChannelMask( uint16_t** channelmask, uint32_t *size )
 {
     *channelmask = ChannelsMask;
@@ -501,10 +501,17 @@ uint8_t RegionAS923ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
 
 bool RegionAS923GetChannels( ChannelParams_t** channels, uint32_t *size );
 
+bool RegionAS923GetBands( Band_t** bands, uint8_t *nbBands );
+
 bool RegionAS923GetChannelMask( uint16_t** channelmask, uint32_t *size );
 
 bool RegionAS923ForceJoinDataRate( int8_t joinDr, AlternateDrParams_t* alternateDr );
 
+/*!
+ * Constant PHY tables of the region, see RegionGetPhyTable
+ */
+extern const RegionPhyTable_t RegionAS923PhyTable;
+
 /*! \} defgroup REGIONAS923 */
 
 #endif // __REGION_AS923_H__
@@ -64,6 +64,42 @@ static uint16_t ChannelsMaskRemaining[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Symbol times of the datarates [ms]
+ */
+static const double SymbolTimesAU915[] =
+{
+    REGION_COMMON_SYMBOL_TIME_LORA( 12, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 11, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 500000 ),
+    0.0,
+    REGION_COMMON_SYMBOL_TIME_LORA( 12, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 11, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 500000 ),
+    0.0,
+    0.0
+};
+
+/*!
+ * Constant PHY tables
+ */
+const RegionPhyTable_t RegionAU915PhyTable =
+{
+    .MaxPayload = { MaxPayloadOfDatarateAU915, MaxPayloadOfDatarateAU915 },
+    .MaxPayloadRepeater = { MaxPayloadOfDatarateRepeaterAU915, MaxPayloadOfDatarateRepeaterAU915 },
+    .SymbolTimes = SymbolTimesAU915,
+    .NbDatarates = sizeof( SymbolTimesAU915 ) / sizeof( SymbolTimesAU915[0] ),
+    .TxMinDatarate = { AU915_TX_MIN_DATARATE, AU915_TX_MIN_DATARATE },
+    .TxMaxDatarate = AU915_TX_MAX_DATARATE,
+};
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -496,7 +532,7 @@ void RegionAU915ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
     rxConfigParams->Datarate = MIN( datarate, AU915_RX_MAX_DATARATE );
     rxConfigParams->Bandwidth = GetBandwidth( rxConfigParams->Datarate );
 
-    tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesAU915[rxConfigParams->Datarate], BandwidthsAU915[rxConfigParams->Datarate] );
+    tSymbol = SymbolTimesAU915[rxConfigParams->Datarate];
 
     RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, RADIO_WAKEUP_TIME, &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
     rxConfigParams->WindowTimeout = rxConfigParams->WindowTimeout * 3;
@@ -935,6 +971,13 @@ bool RegionAU915GetChannels( ChannelParams_t** channels, uint32_t *size )
     return true;
 }
 
+bool RegionAU915GetBands( Band_t** bands, uint8_t *nbBands )
+{
+    *bands = Bands;
+    *nbBands = AU915_MAX_NB_BANDS;
+    return true;
+}
+
 bool RegionAU915GetChannelMask( uint16_t** channelmask, uint32_t *size )
 {
     *channelmask = ChannelsMask;
@@ -454,12 +454,19 @@ uint8_t RegionAU915ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
 
 bool RegionAU915GetChannels( ChannelParams_t** channels, uint32_t *size );
 
+bool RegionAU915GetBands( Band_t** bands, uint8_t *nbBands );
+
 bool RegionAU915GetChannelMask( uint16_t** channelmask, uint32_t *size );
 
 bool RegionAU915GetChannelMaskRemaining( uint16_t** channelmask, uint32_t *size );
 
 bool RegionAU915ForceJoinDataRate( int8_t joinDr, AlternateDrParams_t* alternateDr );
 
+/*!
+ * Constant PHY tables of the region, see RegionGetPhyTable
+ */
+extern const RegionPhyTable_t RegionAU915PhyTable;
+
 /*! \} defgroup REGIONAU915 */
 
 #endif // __REGION_AU915_H__
@@ -59,6 +59,32 @@ static uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Symbol times of the datarates [ms]
+ */
+static const double SymbolTimesCN470[] =
+{
+    REGION_COMMON_SYMBOL_TIME_LORA( 12, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 11, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 125000 )
+};
+
+/*!
+ * Constant PHY tables
+ */
+const RegionPhyTable_t RegionCN470PhyTable =
+{
+    .MaxPayload = { MaxPayloadOfDatarateCN470, MaxPayloadOfDatarateCN470 },
+    .MaxPayloadRepeater = { MaxPayloadOfDatarateRepeaterCN470, MaxPayloadOfDatarateRepeaterCN470 },
+    .SymbolTimes = SymbolTimesCN470,
+    .NbDatarates = sizeof( SymbolTimesCN470 ) / sizeof( SymbolTimesCN470[0] ),
+    .TxMinDatarate = { CN470_TX_MIN_DATARATE, CN470_TX_MIN_DATARATE },
+    .TxMaxDatarate = CN470_TX_MAX_DATARATE,
+};
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -460,7 +486,7 @@ void RegionCN470ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
     rxConfigParams->Datarate = MIN( datarate, CN470_RX_MAX_DATARATE );
     rxConfigParams->Bandwidth = GetBandwidth( rxConfigParams->Datarate );
 
-    tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesCN470[rxConfigParams->Datarate], BandwidthsCN470[rxConfigParams->Datarate] );
+    tSymbol = SymbolTimesCN470[rxConfigParams->Datarate];
 
     RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, RADIO_WAKEUP_TIME, &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
 }
@@ -436,6 +436,11 @@ void RegionCN470SetContinuousWave( ContinuousWaveParams_t* continuousWave );
  */
 uint8_t RegionCN470ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset );
 
+/*!
+ * Constant PHY tables of the region, see RegionGetPhyTable
+ */
+extern const RegionPhyTable_t RegionCN470PhyTable;
+
 /*! \} defgroup REGIONCN470 */
 
 bool RegionCN470ForceJoinDataRate( int8_t joinDr, AlternateDrParams_t* alternateDr );
@@ -302,6 +302,16 @@ uint8_t RegionCommonParseLinkAdrReq( uint8_t* payload, RegionCommonLinkAdrParams
  */
 uint8_t RegionCommonLinkAdrReqVerifyParams( RegionCommonLinkAdrReqVerifyParams_t* verifyParams, int8_t* dr, int8_t* txPow, uint8_t* nbRep );
 
+/*!
+ * Symbol time in ms for LoRa modulation, usable in constant initializers
+ */
+#define REGION_COMMON_SYMBOL_TIME_LORA( phyDr, bandwidth )  ( ( ( double )( 1 << ( phyDr ) ) / ( double )( bandwidth ) ) * 1000 )
+
+/*!
+ * Symbol time in ms for FSK modulation, usable in constant initializers
+ */
+#define REGION_COMMON_SYMBOL_TIME_FSK( phyDr )              ( 8.0 / ( double )( phyDr ) )
+
 /*!
  * \brief Computes the symbol time for LoRa modulation.
  *
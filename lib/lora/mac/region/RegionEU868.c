@@ -63,6 +63,34 @@ static uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Symbol times of the datarates [ms]
+ */
+static const double SymbolTimesEU868[] =
+{
+    REGION_COMMON_SYMBOL_TIME_LORA( 12, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 11, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 250000 ),
+    REGION_COMMON_SYMBOL_TIME_FSK( 50 )
+};
+
+/*!
+ * Constant PHY tables
+ */
+const RegionPhyTable_t RegionEU868PhyTable =
+{
+    .MaxPayload = { MaxPayloadOfDatarateEU868, MaxPayloadOfDatarateEU868 },
+    .MaxPayloadRepeater = { MaxPayloadOfDatarateRepeaterEU868, MaxPayloadOfDatarateRepeaterEU868 },
+    .SymbolTimes = SymbolTimesEU868,
+    .NbDatarates = sizeof( SymbolTimesEU868 ) / sizeof( SymbolTimesEU868[0] ),
+    .TxMinDatarate = { EU868_TX_MIN_DATARATE, EU868_TX_MIN_DATARATE },
+    .TxMaxDatarate = EU868_TX_MAX_DATARATE,
+};
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -547,14 +575,7 @@ void RegionEU868ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
     rxConfigParams->Datarate = MIN( datarate, EU868_RX_MAX_DATARATE );
     rxConfigParams->Bandwidth = GetBandwidth( rxConfigParams->Datarate );
 
-    if( rxConfigParams->Datarate == DR_7 )
-    { // FSK
-        tSymbol = RegionCommonComputeSymbolTimeFsk( DataratesEU868[rxConfigParams->Datarate] );
-    }
-    else
-    { // LoRa
-        tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesEU868[rxConfigParams->Datarate], BandwidthsEU868[rxConfigParams->Datarate] );
-    }
+    tSymbol = SymbolTimesEU868[rxConfigParams->Datarate];
 
     RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, RADIO_WAKEUP_TIME, &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
     rxConfigParams->WindowTimeout = rxConfigParams->WindowTimeout * 3;
@@ -1151,6 +1172,13 @@ bool RegionEU868GetChannels( ChannelParams_t** channels, uint32_t *size )
     return true;
 }
 
+bool RegionEU868GetBands( Band_t** bands, uint8_t *nbBands )
+{
+    *bands = Bands;
+    *nbBands = EU868_MAX_NB_BANDS;
+    return true;
+}
+
 bool RegionEU868GetChannelMask( uint16_t** channelmask, uint32_t *size )
 {
     *channelmask = ChannelsMask;
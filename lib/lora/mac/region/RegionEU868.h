@@ -485,10 +485,17 @@ uint8_t RegionEU868ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
 
 bool RegionEU868GetChannels( ChannelParams_t** channels, uint32_t *size );
 
+bool RegionEU868GetBands( Band_t** bands, uint8_t *nbBands );
+
 bool RegionEU868GetChannelMask( uint16_t** channelmask, uint32_t *size );
 
 bool RegionEU868ForceJoinDataRate( int8_t joinDr, AlternateDrParams_t* alternateDr );
 
+/*!
+ * Constant PHY tables of the region, see RegionGetPhyTable
+ */
+extern const RegionPhyTable_t RegionEU868PhyTable;
+
 /*! \} defgroup REGIONEU868 */
 
 #endif // __REGION_EU868_H__
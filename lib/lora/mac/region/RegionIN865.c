@@ -59,6 +59,34 @@ static uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Symbol times of the datarates [ms]
+ */
+static const double SymbolTimesIN865[] =
+{
+    REGION_COMMON_SYMBOL_TIME_LORA( 12, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 11, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 250000 ),
+    REGION_COMMON_SYMBOL_TIME_FSK( 50 )
+};
+
+/*!
+ * Constant PHY tables
+ */
+const RegionPhyTable_t RegionIN865PhyTable =
+{
+    .MaxPayload = { MaxPayloadOfDatarateIN865, MaxPayloadOfDatarateIN865 },
+    .MaxPayloadRepeater = { MaxPayloadOfDatarateRepeaterIN865, MaxPayloadOfDatarateRepeaterIN865 },
+    .SymbolTimes = SymbolTimesIN865,
+    .NbDatarates = sizeof( SymbolTimesIN865 ) / sizeof( SymbolTimesIN865[0] ),
+    .TxMinDatarate = { IN865_TX_MIN_DATARATE, IN865_TX_MIN_DATARATE },
+    .TxMaxDatarate = IN865_TX_MAX_DATARATE,
+};
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -522,14 +550,7 @@ void RegionIN865ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
     rxConfigParams->Datarate = MIN( datarate, IN865_RX_MAX_DATARATE );
     rxConfigParams->Bandwidth = GetBandwidth( rxConfigParams->Datarate );
 
-    if( rxConfigParams->Datarate == DR_7 )
-    { // FSK
-        tSymbol = RegionCommonComputeSymbolTimeFsk( DataratesIN865[rxConfigParams->Datarate] );
-    }
-    else
-    { // LoRa
-        tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesIN865[rxConfigParams->Datarate], BandwidthsIN865[rxConfigParams->Datarate] );
-    }
+    tSymbol = SymbolTimesIN865[rxConfigParams->Datarate];
 
     RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, RADIO_WAKEUP_TIME, &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
 }
@@ -1119,6 +1140,13 @@ bool RegionIN865GetChannels( ChannelParams_t** channels, uint32_t *size )
     return true;
 }
 
+bool RegionIN865GetBands( Band_t** bands, uint8_t *nbBands )
+{
+    *bands = Bands;
+    *nbBands = IN865_MAX_NB_BANDS;
+    return true;
+}
+
 bool RegionIN865GetChannelMask( uint16_t** channelmask, uint32_t *size )
 {
     *channelmask = ChannelsMask;
@@ -471,8 +471,15 @@ bool RegionIN865ChannelsRemove( ChannelRemoveParams_t* channelRemove  );
 
 bool RegionIN865GetChannels( ChannelParams_t** channels, uint32_t *size );
 
+bool RegionIN865GetBands( Band_t** bands, uint8_t *nbBands );
+
 bool RegionIN865GetChannelMask( uint16_t** channelmask, uint32_t *size );
 
+/*!
+ * Constant PHY tables of the region, see RegionGetPhyTable
+ */
+extern const RegionPhyTable_t RegionIN865PhyTable;
+
 /*! \} defgroup REGIONIN865 */
 
 #endif // __REGION_IN865_H__
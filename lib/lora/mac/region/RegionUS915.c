@@ -64,6 +64,42 @@ static uint16_t ChannelsMaskRemaining[CHANNELS_MASK_SIZE];
  */
 static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
 
+/*!
+ * Symbol times of the datarates [ms]
+ */
+static const double SymbolTimesUS915[] =
+{
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 125000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 500000 ),
+    0.0,
+    0.0,
+    0.0,
+    REGION_COMMON_SYMBOL_TIME_LORA( 12, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 11, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 10, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 9, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 8, 500000 ),
+    REGION_COMMON_SYMBOL_TIME_LORA( 7, 500000 ),
+    0.0,
+    0.0
+};
+
+/*!
+ * Constant PHY tables
+ */
+const RegionPhyTable_t RegionUS915PhyTable =
+{
+    .MaxPayload = { MaxPayloadOfDatarateUS915, MaxPayloadOfDatarateUS915 },
+    .MaxPayloadRepeater = { MaxPayloadOfDatarateRepeaterUS915, MaxPayloadOfDatarateRepeaterUS915 },
+    .SymbolTimes = SymbolTimesUS915,
+    .NbDatarates = sizeof( SymbolTimesUS915 ) / sizeof( SymbolTimesUS915[0] ),
+    .TxMinDatarate = { US915_TX_MIN_DATARATE, US915_TX_MIN_DATARATE },
+    .TxMaxDatarate = US915_TX_MAX_DATARATE,
+};
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -504,7 +540,7 @@ void RegionUS915ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
     rxConfigParams->Datarate = MIN( datarate, US915_RX_MAX_DATARATE );
     rxConfigParams->Bandwidth = GetBandwidth( rxConfigParams->Datarate );
 
-    tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesUS915[rxConfigParams->Datarate], BandwidthsUS915[rxConfigParams->Datarate] );
+    tSymbol = SymbolTimesUS915[rxConfigParams->Datarate];
 
     RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, RADIO_WAKEUP_TIME, &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
     rxConfigParams->WindowTimeout = rxConfigParams->WindowTimeout * 3;
@@ -943,6 +979,13 @@ bool RegionUS915GetChannels( ChannelParams_t** channels, uint32_t *size )
     return true;
 }
 
+bool RegionUS915GetBands( Band_t** bands, uint8_t *nbBands )
+{
+    *bands = Bands;
+    *nbBands = US915_MAX_NB_BANDS;
+    return true;
+}
+
 bool RegionUS915GetChannelMask( uint16_t** channelmask, uint32_t *size )
 {
     *channelmask = ChannelsMask;
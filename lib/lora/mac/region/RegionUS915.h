@@ -447,12 +447,19 @@ uint8_t RegionUS915ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
 
 bool RegionUS915GetChannels( ChannelParams_t** channels, uint32_t *size );
 
+bool RegionUS915GetBands( Band_t** bands, uint8_t *nbBands );
+
 bool RegionUS915GetChannelMask( uint16_t** channelmask, uint32_t *size );
 
 bool RegionUS915GetChannelMaskRemaining( uint16_t** channelmask, uint32_t *size );
 
 bool RegionUS915ForceJoinDataRate( int8_t joinDr, AlternateDrParams_t* alternateDr );
 
+/*!
+ * Constant PHY tables of the region, see RegionGetPhyTable
+ */
+extern const RegionPhyTable_t RegionUS915PhyTable;
+
 /*! \} defgroup REGIONUS915 */
 
 #endif // __REGION_US915_H__
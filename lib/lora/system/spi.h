@@ -74,6 +74,23 @@ void SpiFrequency( Spi_t *obj, uint32_t hz );
  */
 #if defined(LOPY) || defined (LOPY4) || defined(FIPY)
 uint16_t SpiInOut( Spi_t *obj, uint16_t outData );
+
+/*!
+ * Largest transaction of SpiInOutBurst, the size of the W0..W15 buffer
+ */
+#define SPI_BURST_MAX_LEN                           64
+
+/*!
+ * \brief Sends addr followed by size bytes of outData (zeros when NULL) and
+ *        stores the bytes received after addr in inData (unless NULL)
+ *
+ * \param [IN]  obj     SPI object
+ * \param [IN]  addr    Register address byte
+ * \param [IN]  outData Bytes to be sent
+ * \param [OUT] inData  Received bytes
+ * \param [IN]  size    Number of data bytes
+ */
+void SpiInOutBurst( Spi_t *obj, uint8_t addr, const uint8_t *outData, uint8_t *inData, uint16_t size );
 #elif defined(SIPY)
 uint8_t SpiInOut(uint32_t spiNum, uint32_t outData);
 /*!
@@ -16,16 +16,305 @@ Maintainer: Miguel Luis and Gregory Cristian
 #include "timer-board.h"
 #include "modlora.h"
 
+/*!
+ * HeapIndex value of a timer that isn't running
+ */
+#define TIMER_HEAP_INDEX_NONE                   ( 0xFF )
+
 /*!
  * This flag is used to make sure we have looped through the main several time to avoid race issues
  */
 volatile uint8_t HasLoopedThroughMain = 0;
 
+void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) )
+{
+    obj->Timestamp = 0;
+    obj->ReloadValue = 0;
+    obj->IsRunning = false;
+    obj->HeapIndex = TIMER_HEAP_INDEX_NONE;
+    obj->Callback = callback;
+    obj->Next = NULL;
+}
+
+/*!
+ * Scheduler statistics
+ */
+static TimerStats_t TimerStats;
+
+/*!
+ * \brief Reads the CPU cycle counter
+ */
+static inline uint32_t TimerGetCycles( void )
+{
+    uint32_t r;
+    asm volatile ("rsr %0, ccount" : "=r"(r));
+    return r;
+}
+
+/*!
+ * \brief Accounts one scheduler operation started at cycle count "start"
+ */
+static IRAM_ATTR void TimerStatsUpdate( uint32_t start )
+{
+    uint32_t cycles = TimerGetCycles( ) - start;
+
+    TimerStats.Operations++;
+    TimerStats.TotalCycles += cycles;
+    if( cycles > TimerStats.MaxCycles )
+    {
+        TimerStats.MaxCycles = cycles;
+    }
+}
+
+/*!
+ * \brief Accounts the dispatch delay of a timer that was due at "dueTime"
+ */
+static IRAM_ATTR void TimerStatsLateness( TimerTime_t dueTime, TimerTime_t now )
+{
+    int32_t lateness = ( int32_t )( now - dueTime );
+
+    if( ( lateness > 0 ) && ( ( uint32_t )lateness > TimerStats.MaxLateness ) )
+    {
+        TimerStats.MaxLateness = lateness;
+    }
+}
+
+#if LORA_TIMER_USE_HEAP
+
+/*!
+ * Running timers, TimerHeap[0] is always the next one to expire
+ */
+static TimerEvent_t *TimerHeap[TIMER_HEAP_SIZE];
+static uint32_t TimerHeapCount = 0;
+
+/*!
+ * \brief Sets a timeout with the duration "timestamp"
+ *
+ * \param [IN] timestamp Delay duration
+ */
+static void TimerSetTimeout( TimerEvent_t *obj );
+
+/*!
+ * \brief Check if the Object to be added is already running
+ *
+ * \param [IN] obj Timer object
+ * \retval true (the object is already in the heap) or false
+ */
+static bool TimerExists( TimerEvent_t *obj );
+
+/*!
+ * \brief Compares the expiry time of two timers, taking the counter roll over into account
+ *
+ * \retval true if a expires before b
+ */
+static IRAM_ATTR bool TimerIsBefore( TimerEvent_t *a, TimerEvent_t *b )
+{
+    return ( int32_t )( a->Timestamp - b->Timestamp ) < 0;
+}
+
+static IRAM_ATTR void TimerHeapSet( uint32_t idx, TimerEvent_t *obj )
+{
+    TimerHeap[idx] = obj;
+    obj->HeapIndex = idx;
+}
+
+static IRAM_ATTR void TimerHeapSiftUp( uint32_t idx )
+{
+    TimerEvent_t *obj = TimerHeap[idx];
+
+    while( idx > 0 )
+    {
+        uint32_t parent = ( idx - 1 ) / 2;
+        if( TimerIsBefore( obj, TimerHeap[parent] ) == false )
+        {
+            break;
+        }
+        TimerHeapSet( idx, TimerHeap[parent] );
+        idx = parent;
+    }
+    TimerHeapSet( idx, obj );
+}
+
+static IRAM_ATTR void TimerHeapSiftDown( uint32_t idx )
+{
+    TimerEvent_t *obj = TimerHeap[idx];
+
+    while( true )
+    {
+        uint32_t child = ( 2 * idx ) + 1;
+        if( child >= TimerHeapCount )
+        {
+            break;
+        }
+        if( ( ( child + 1 ) < TimerHeapCount ) && TimerIsBefore( TimerHeap[child + 1], TimerHeap[child] ) )
+        {
+            child++;
+        }
+        if( TimerIsBefore( TimerHeap[child], obj ) == false )
+        {
+            break;
+        }
+        TimerHeapSet( idx, TimerHeap[child] );
+        idx = child;
+    }
+    TimerHeapSet( idx, obj );
+}
+
+static IRAM_ATTR void TimerHeapRemove( uint32_t idx )
+{
+    TimerEvent_t *last = TimerHeap[--TimerHeapCount];
+
+    TimerHeap[idx]->HeapIndex = TIMER_HEAP_INDEX_NONE;
+    if( idx < TimerHeapCount )
+    {
+        // move the last timer into the hole and restore the heap order
+        TimerHeapSet( idx, last );
+        TimerHeapSiftUp( idx );
+        TimerHeapSiftDown( last->HeapIndex );
+    }
+}
+
+/*!
+ * \brief Arms the hardware timer if the head of the heap has changed
+ *
+ * \remark Only the head is flagged as running, as with the list scheduler
+ *
+ * \param [IN]  prevHead Head of the heap before the last operation
+ */
+static IRAM_ATTR void TimerHeapUpdateHead( TimerEvent_t *prevHead )
+{
+    TimerEvent_t *head = ( TimerHeapCount > 0 ) ? TimerHeap[0] : NULL;
+
+    if( head == prevHead )
+    {
+        return;
+    }
+    if( prevHead != NULL )
+    {
+        prevHead->IsRunning = false;
+    }
+    if( head != NULL )
+    {
+        head->IsRunning = true;
+        TimerSetTimeout( head );
+    }
+}
+
+IRAM_ATTR void TimerStart( TimerEvent_t *obj )
+{
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t start = TimerGetCycles( );
+
+    if( ( obj == NULL ) || ( TimerExists( obj ) == true ) || ( TimerHeapCount >= TIMER_HEAP_SIZE ) )
+    {
+        MICROPY_END_ATOMIC_SECTION(ilevel);
+        return;
+    }
+
+    TimerEvent_t *prevHead = ( TimerHeapCount > 0 ) ? TimerHeap[0] : NULL;
+
+    obj->Timestamp = TimerHwGetTime( ) + obj->ReloadValue;
+    obj->IsRunning = false;
+    TimerHeapSet( TimerHeapCount, obj );
+    TimerHeapCount++;
+    TimerHeapSiftUp( TimerHeapCount - 1 );
+    TimerHeapUpdateHead( prevHead );
+
+    TimerStatsUpdate( start );
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
+
+IRAM_ATTR void TimerIrqHandler( void )
+{
+    TimerTime_t now;
+    uint32_t start;
+
+    // when all timers are stopped or expired, the heap is empty
+    if( TimerHeapCount == 0 )
+    {
+        return;
+    }
+
+    start = TimerGetCycles( );
+    now = TimerHwGetTime( );
+
+    while( ( TimerHeapCount > 0 ) && ( ( int32_t )( TimerHeap[0]->Timestamp - now ) <= 0 ) )
+    {
+        TimerEvent_t* elapsedTimer = TimerHeap[0];
+
+        TimerStatsLateness( elapsedTimer->Timestamp, now );
+        TimerHeapRemove( 0 );
+        elapsedTimer->IsRunning = false;
+
+        if( elapsedTimer->Callback != NULL )
+        {
+            // Callback will be processed out of the Interrupt context in a Thread
+            modlora_set_timer_callback(elapsedTimer->Callback);
+        }
+    }
+
+    // (re)start the next head if it exists
+    if( TimerHeapCount > 0 )
+    {
+        TimerHeap[0]->IsRunning = true;
+        TimerSetTimeout( TimerHeap[0] );
+    }
+
+    TimerStatsUpdate( start );
+}
+
+IRAM_ATTR void TimerStop( TimerEvent_t *obj )
+{
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t start = TimerGetCycles( );
+
+    // Heap is empty or the Obj to stop is not running
+    if( ( obj == NULL ) || ( TimerExists( obj ) == false ) )
+    {
+        MICROPY_END_ATOMIC_SECTION(ilevel);
+        return;
+    }
+
+    TimerEvent_t *prevHead = TimerHeap[0];
+
+    TimerHeapRemove( obj->HeapIndex );
+    obj->IsRunning = false;
+    TimerHeapUpdateHead( prevHead );
+
+    TimerStatsUpdate( start );
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
+
+static IRAM_ATTR bool TimerExists( TimerEvent_t *obj )
+{
+    return ( obj->HeapIndex < TimerHeapCount ) && ( TimerHeap[obj->HeapIndex] == obj );
+}
+
+static IRAM_ATTR void TimerSetTimeout( TimerEvent_t *obj )
+{
+    int32_t remaining = ( int32_t )( obj->Timestamp - TimerHwGetTime( ) );
+
+    HasLoopedThroughMain = 0;
+    TimerHwStart( ( remaining > 0 ) ? remaining : 0 );
+}
+
+static bool TimerIsHeadRunning( void )
+{
+    return ( TimerHeapCount > 0 ) && ( TimerHeap[0]->IsRunning == true );
+}
+
+#else
+
 /*!
  * Timers list head pointer
  */
 static TimerEvent_t *TimerListHead = NULL;
 
+/*!
+ * Time at which the running head of the list is due
+ */
+static TimerTime_t TimerHeadDueTime = 0;
+
 /*!
  * \brief Adds or replace the head timer of the list.
  *
@@ -71,21 +360,13 @@ static bool TimerExists( TimerEvent_t *obj );
 TimerTime_t TimerGetValue( void );
 
 
-void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) )
-{
-    obj->Timestamp = 0;
-    obj->ReloadValue = 0;
-    obj->IsRunning = false;
-    obj->Callback = callback;
-    obj->Next = NULL;
-}
-
 IRAM_ATTR void TimerStart( TimerEvent_t *obj )
 {
     uint32_t elapsedTime = 0;
     uint32_t remainingTime = 0;
 
     uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t start = TimerGetCycles( );
 
     if( ( obj == NULL ) || ( TimerExists( obj ) == true ) )
     {
@@ -125,6 +406,7 @@ IRAM_ATTR void TimerStart( TimerEvent_t *obj )
              TimerInsertTimer( obj, remainingTime );
         }
     }
+    TimerStatsUpdate( start );
     MICROPY_END_ATOMIC_SECTION(ilevel);
 }
 
@@ -201,6 +483,7 @@ static IRAM_ATTR void TimerInsertNewHeadTimer( TimerEvent_t *obj, uint32_t remai
 IRAM_ATTR void TimerIrqHandler( void )
 {
     uint32_t elapsedTime = 0;
+    uint32_t start;
 
     // when all timers are stopped or expired, TimerListHead is NULL
     if( TimerListHead == NULL )
@@ -208,6 +491,7 @@ IRAM_ATTR void TimerIrqHandler( void )
         return;
     }
 
+    start = TimerGetCycles( );
     elapsedTime = TimerGetValue( );
 
     if( elapsedTime >= TimerListHead->Timestamp )
@@ -221,6 +505,11 @@ IRAM_ATTR void TimerIrqHandler( void )
 
     TimerListHead->IsRunning = false;
 
+    if( TimerListHead->Timestamp == 0 )
+    {
+        TimerStatsLateness( TimerHeadDueTime, TimerHwGetTime( ) );
+    }
+
     while( ( TimerListHead != NULL ) && ( TimerListHead->Timestamp == 0 ) )
     {
         TimerEvent_t* elapsedTimer = TimerListHead;
@@ -242,11 +531,14 @@ IRAM_ATTR void TimerIrqHandler( void )
             TimerSetTimeout( TimerListHead );
         }
     }
+
+    TimerStatsUpdate( start );
 }
 
 IRAM_ATTR void TimerStop( TimerEvent_t *obj )
 {
     uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint32_t start = TimerGetCycles( );
 
     uint32_t elapsedTime = 0;
     uint32_t remainingTime = 0;
@@ -328,6 +620,7 @@ IRAM_ATTR void TimerStop( TimerEvent_t *obj )
             }
         }
     }
+    TimerStatsUpdate( start );
     MICROPY_END_ATOMIC_SECTION(ilevel);
 }
 
@@ -346,6 +639,25 @@ static IRAM_ATTR bool TimerExists( TimerEvent_t *obj )
     return false;
 }
 
+static IRAM_ATTR void TimerSetTimeout( TimerEvent_t *obj )
+{
+    HasLoopedThroughMain = 0;
+    TimerHeadDueTime = TimerHwGetTime( ) + obj->Timestamp;
+    TimerHwStart( obj->Timestamp );
+}
+
+IRAM_ATTR TimerTime_t TimerGetValue( void )
+{
+    return TimerHwGetElapsedTime( );
+}
+
+static bool TimerIsHeadRunning( void )
+{
+    return ( TimerListHead != NULL ) && ( TimerListHead->IsRunning == true );
+}
+
+#endif  // LORA_TIMER_USE_HEAP
+
 void TimerReset( TimerEvent_t *obj )
 {
     TimerStop( obj );
@@ -359,22 +671,11 @@ void IRAM_ATTR TimerSetValue( TimerEvent_t *obj, uint32_t value )
     obj->ReloadValue = value;
 }
 
-IRAM_ATTR TimerTime_t TimerGetValue( void )
-{
-    return TimerHwGetElapsedTime( );
-}
-
 IRAM_ATTR TimerTime_t TimerGetCurrentTime( void )
 {
     return TimerHwGetTime( );
 }
 
-static IRAM_ATTR void TimerSetTimeout( TimerEvent_t *obj )
-{
-    HasLoopedThroughMain = 0;
-    TimerHwStart( obj->Timestamp );
-}
-
 IRAM_ATTR TimerTime_t TimerGetElapsedTime( TimerTime_t savedTime )
 {
     return TimerHwComputeTimeDifference( savedTime );
@@ -382,7 +683,7 @@ IRAM_ATTR TimerTime_t TimerGetElapsedTime( TimerTime_t savedTime )
 
 void TimerLowPowerHandler( void )
 {
-    if( ( TimerListHead != NULL ) && ( TimerListHead->IsRunning == true ) )
+    if( TimerIsHeadRunning( ) == true )
     {
         if( HasLoopedThroughMain < 5 )
         {
@@ -395,3 +696,14 @@ void TimerLowPowerHandler( void )
         }
     }
 }
+
+void TimerGetStats( TimerStats_t *stats, bool reset )
+{
+    uint32_t ilevel = MICROPY_BEGIN_ATOMIC_SECTION();
+    *stats = TimerStats;
+    if( reset )
+    {
+        memset( &TimerStats, 0, sizeof( TimerStats ) );
+    }
+    MICROPY_END_ATOMIC_SECTION(ilevel);
+}
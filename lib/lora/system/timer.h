@@ -15,18 +15,44 @@ Maintainer: Miguel Luis and Gregory Cristian
 #ifndef __TIMER_H__
 #define __TIMER_H__
 
+/*!
+ * Selects the timer scheduler implementation
+ * 1: binary min-heap ordered by absolute expiry time, O(log n) start/stop
+ * 0: original sorted linked list with relative timestamps, O(n) start/stop
+ */
+#ifndef LORA_TIMER_USE_HEAP
+#define LORA_TIMER_USE_HEAP                     ( 1 )
+#endif
+
+/*!
+ * Maximum number of timers that can be running at the same time (heap scheduler only)
+ */
+#define TIMER_HEAP_SIZE                         ( 32 )
+
 /*!
  * \brief Timer object description
  */
 typedef struct TimerEvent_s
 {
-    uint32_t Timestamp;         //! Current timer value
+    uint32_t Timestamp;         //! Current timer value (absolute expiry time with the heap scheduler)
     uint32_t ReloadValue;       //! Timer delay value
     bool IsRunning;             //! Is the timer currently running
+    uint8_t HeapIndex;          //! Position in the timer heap
     void ( *Callback )( void ); //! Timer IRQ callback function
     struct TimerEvent_s *Next;  //! Pointer to the next Timer object.
 }TimerEvent_t;
 
+/*!
+ * \brief Timer scheduler statistics
+ */
+typedef struct TimerStats_s
+{
+    uint32_t Operations;        //! Number of TimerStart, TimerStop and TimerIrqHandler calls measured
+    uint64_t TotalCycles;       //! CPU cycles spent in them
+    uint32_t MaxCycles;         //! Longest single call in CPU cycles
+    uint32_t MaxLateness;       //! Worst delay between the expiry time of a timer and its dispatch in ms
+}TimerStats_t;
+
 /*!
  * \brief Timer time variable definition
  */
@@ -99,4 +125,12 @@ TimerTime_t TimerGetElapsedTime( TimerTime_t savedTime );
  */
 void TimerLowPowerHandler( void );
 
+/*!
+ * \brief Reads the timer scheduler statistics
+ *
+ * \param [OUT] stats   Copy of the statistics
+ * \param [IN]  reset   Clear the statistics after reading them
+ */
+void TimerGetStats( TimerStats_t *stats, bool reset );
+
 #endif  // __TIMER_H__
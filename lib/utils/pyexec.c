@@ -34,6 +34,7 @@
 #include "py/repl.h"
 #include "py/gc.h"
 #include "py/frozenmod.h"
+#include "py/persistentcode.h"
 #include "py/mphal.h"
 #if MICROPY_HW_ENABLE_USB
 #include "irq.h"
@@ -77,6 +78,11 @@ STATIC int parse_compile_execute(const void *source, mp_parse_input_kind_t input
             module_fun = mp_make_function_from_raw_code(source, MP_OBJ_NULL, MP_OBJ_NULL);
         } else
         #endif
+        #if MICROPY_PERSISTENT_CODE_CACHE
+        if (exec_flags & EXEC_FLAG_SOURCE_IS_FILENAME) {
+            module_fun = mp_make_function_from_raw_code(mp_raw_code_compile_file_cached(source), MP_OBJ_NULL, MP_OBJ_NULL);
+        } else
+        #endif
         {
             #if MICROPY_ENABLE_COMPILER
             mp_lexer_t *lex;
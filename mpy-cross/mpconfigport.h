@@ -38,6 +38,7 @@
 #define MICROPY_EMIT_INLINE_THUMB_FLOAT (1)
 #define MICROPY_EMIT_ARM            (1)
 #define MICROPY_EMIT_XTENSA         (1)
+#define MICROPY_EMIT_XTENSAWIN      (1)
 #define MICROPY_EMIT_INLINE_XTENSA  (1)
 
 #define MICROPY_DYNAMIC_COMPILER    (1)
@@ -0,0 +1,1497 @@
+Q(ARRAY)
+
+Q(ARRAY)
+
+Q(ArithmeticError)
+
+Q(ArithmeticError)
+
+Q(AssertionError)
+
+Q(AssertionError)
+
+Q(AssertionError)
+
+Q(AttributeError)
+
+Q(AttributeError)
+
+Q(BFINT16)
+
+Q(BFINT16)
+
+Q(BFINT32)
+
+Q(BFINT32)
+
+Q(BFINT8)
+
+Q(BFINT8)
+
+Q(BFUINT16)
+
+Q(BFUINT16)
+
+Q(BFUINT32)
+
+Q(BFUINT32)
+
+Q(BFUINT8)
+
+Q(BFUINT8)
+
+Q(BF_LEN)
+
+Q(BF_LEN)
+
+Q(BF_POS)
+
+Q(BF_POS)
+
+Q(BIG_ENDIAN)
+
+Q(BIG_ENDIAN)
+
+Q(BaseException)
+
+Q(BaseException)
+
+Q(BytesIO)
+
+Q(BytesIO)
+
+Q(DEBUG)
+
+Q(DEBUG)
+
+Q(EACCES)
+
+Q(EACCES)
+
+Q(EADDRINUSE)
+
+Q(EADDRINUSE)
+
+Q(EAGAIN)
+
+Q(EAGAIN)
+
+Q(EALREADY)
+
+Q(EALREADY)
+
+Q(EBADF)
+
+Q(EBADF)
+
+Q(ECONNABORTED)
+
+Q(ECONNABORTED)
+
+Q(ECONNREFUSED)
+
+Q(ECONNREFUSED)
+
+Q(ECONNRESET)
+
+Q(ECONNRESET)
+
+Q(EEXIST)
+
+Q(EEXIST)
+
+Q(EHOSTUNREACH)
+
+Q(EHOSTUNREACH)
+
+Q(EINPROGRESS)
+
+Q(EINPROGRESS)
+
+Q(EINVAL)
+
+Q(EINVAL)
+
+Q(EIO)
+
+Q(EIO)
+
+Q(EISDIR)
+
+Q(EISDIR)
+
+Q(EMSGSIZE)
+
+Q(EMSGSIZE)
+
+Q(ENETDOWN)
+
+Q(ENETDOWN)
+
+Q(ENOBUFS)
+
+Q(ENOBUFS)
+
+Q(ENODEV)
+
+Q(ENODEV)
+
+Q(ENOENT)
+
+Q(ENOENT)
+
+Q(ENOMEM)
+
+Q(ENOMEM)
+
+Q(ENOTCONN)
+
+Q(ENOTCONN)
+
+Q(EOFError)
+
+Q(EOFError)
+
+Q(EOPNOTSUPP)
+
+Q(EOPNOTSUPP)
+
+Q(EPERM)
+
+Q(EPERM)
+
+Q(ETIMEDOUT)
+
+Q(ETIMEDOUT)
+
+Q(Ellipsis)
+
+Q(Ellipsis)
+
+Q(Exception)
+
+Q(Exception)
+
+Q(FLOAT32)
+
+Q(FLOAT32)
+
+Q(FLOAT64)
+
+Q(FLOAT64)
+
+Q(GeneratorExit)
+
+Q(GeneratorExit)
+
+Q(INT)
+
+Q(INT)
+
+Q(INT16)
+
+Q(INT16)
+
+Q(INT32)
+
+Q(INT32)
+
+Q(INT64)
+
+Q(INT64)
+
+Q(INT8)
+
+Q(INT8)
+
+Q(ImportError)
+
+Q(ImportError)
+
+Q(IndentationError)
+
+Q(IndentationError)
+
+Q(IndexError)
+
+Q(IndexError)
+
+Q(KeyError)
+
+Q(KeyError)
+
+Q(KeyboardInterrupt)
+
+Q(KeyboardInterrupt)
+
+Q(LITTLE_ENDIAN)
+
+Q(LITTLE_ENDIAN)
+
+Q(LONG)
+
+Q(LONG)
+
+Q(LONGLONG)
+
+Q(LONGLONG)
+
+Q(LookupError)
+
+Q(LookupError)
+
+Q(MemoryError)
+
+Q(MemoryError)
+
+Q(NATIVE)
+
+Q(NATIVE)
+
+Q(NameError)
+
+Q(NameError)
+
+Q(NoneType)
+
+Q(NotImplementedError)
+
+Q(NotImplementedError)
+
+Q(OSError)
+
+Q(OSError)
+
+Q(OrderedDict)
+
+Q(OrderedDict)
+
+Q(OrderedDict)
+
+Q(OverflowError)
+
+Q(OverflowError)
+
+Q(PTR)
+
+Q(PTR)
+
+Q(RuntimeError)
+
+Q(RuntimeError)
+
+Q(SHORT)
+
+Q(SHORT)
+
+Q(StopIteration)
+
+Q(StopIteration)
+
+Q(StringIO)
+
+Q(StringIO)
+
+Q(Struct)
+
+Q(Struct)
+
+Q(SyntaxError)
+
+Q(SyntaxError)
+
+Q(SystemExit)
+
+Q(SystemExit)
+
+Q(TypeError)
+
+Q(TypeError)
+
+Q(UINT)
+
+Q(UINT)
+
+Q(UINT16)
+
+Q(UINT16)
+
+Q(UINT32)
+
+Q(UINT32)
+
+Q(UINT64)
+
+Q(UINT64)
+
+Q(UINT8)
+
+Q(UINT8)
+
+Q(ULONG)
+
+Q(ULONG)
+
+Q(ULONGLONG)
+
+Q(ULONGLONG)
+
+Q(USHORT)
+
+Q(USHORT)
+
+Q(VOID)
+
+Q(VOID)
+
+Q(ValueError)
+
+Q(ValueError)
+
+Q(ZeroDivisionError)
+
+Q(ZeroDivisionError)
+
+Q(_0x0a_)
+
+Q(__add__)
+
+Q(__bool__)
+
+Q(__build_class__)
+
+Q(__call__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__contains__)
+
+Q(__contains__)
+
+Q(__contains__)
+
+Q(__delitem__)
+
+Q(__delitem__)
+
+Q(__dict__)
+
+Q(__enter__)
+
+Q(__enter__)
+
+Q(__eq__)
+
+Q(__eq__)
+
+Q(__exit__)
+
+Q(__exit__)
+
+Q(__file__)
+
+Q(__file__)
+
+Q(__file__)
+
+Q(__ge__)
+
+Q(__getattr__)
+
+Q(__getattr__)
+
+Q(__getitem__)
+
+Q(__getitem__)
+
+Q(__getitem__)
+
+Q(__getitem__)
+
+Q(__gt__)
+
+Q(__hash__)
+
+Q(__iadd__)
+
+Q(__import__)
+
+Q(__init__)
+
+Q(__init__)
+
+Q(__init__)
+
+Q(__int__)
+
+Q(__isub__)
+
+Q(__iter__)
+
+Q(__le__)
+
+Q(__len__)
+
+Q(__lt__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__module__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__new__)
+
+Q(__new__)
+
+Q(__new__)
+
+Q(__next__)
+
+Q(__next__)
+
+Q(__next__)
+
+Q(__next__)
+
+Q(__path__)
+
+Q(__path__)
+
+Q(__path__)
+
+Q(__qualname__)
+
+Q(__repl_print__)
+
+Q(__repl_print__)
+
+Q(__repr__)
+
+Q(__repr__)
+
+Q(__reversed__)
+
+Q(__setitem__)
+
+Q(__setitem__)
+
+Q(__str__)
+
+Q(__sub__)
+
+Q(__traceback__)
+
+Q(_brace_open__colon__hash_b_brace_close_)
+
+Q(_lt_dictcomp_gt_)
+
+Q(_lt_genexpr_gt_)
+
+Q(_lt_lambda_gt_)
+
+Q(_lt_listcomp_gt_)
+
+Q(_lt_module_gt_)
+
+Q(_lt_setcomp_gt_)
+
+Q(_lt_string_gt_)
+
+Q(_percent__hash_o)
+
+Q(_percent__hash_x)
+
+Q(_slash_)
+
+Q(_slash_)
+
+Q(_slash_)
+
+Q(_slash_)
+
+Q(_space_)
+
+Q(_star_)
+
+Q(_star_)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(abs)
+
+Q(acos)
+
+Q(add)
+
+Q(add)
+
+Q(addressof)
+
+Q(addressof)
+
+Q(all)
+
+Q(any)
+
+Q(append)
+
+Q(append)
+
+Q(args)
+
+Q(array)
+
+Q(array)
+
+Q(array)
+
+Q(array)
+
+Q(asin)
+
+Q(atan)
+
+Q(atan2)
+
+Q(bin)
+
+Q(bool)
+
+Q(bool)
+
+Q(bound_method)
+
+Q(buffering)
+
+Q(builtins)
+
+Q(builtins)
+
+Q(bytearray)
+
+Q(bytearray)
+
+Q(bytearray_at)
+
+Q(bytearray_at)
+
+Q(bytecode)
+
+Q(bytes)
+
+Q(bytes)
+
+Q(bytes)
+
+Q(bytes_at)
+
+Q(bytes_at)
+
+Q(calcsize)
+
+Q(callable)
+
+Q(ceil)
+
+Q(chdir)
+
+Q(chdir)
+
+Q(chr)
+
+Q(classmethod)
+
+Q(classmethod)
+
+Q(clear)
+
+Q(clear)
+
+Q(clear)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(closure)
+
+Q(closure)
+
+Q(collect)
+
+Q(compile)
+
+Q(compile)
+
+Q(complex)
+
+Q(complex)
+
+Q(const)
+
+Q(copy)
+
+Q(copy)
+
+Q(copy)
+
+Q(copy)
+
+Q(copysign)
+
+Q(cos)
+
+Q(count)
+
+Q(count)
+
+Q(count)
+
+Q(decode)
+
+Q(decode)
+
+Q(default)
+
+Q(degrees)
+
+Q(delattr)
+
+Q(deleter)
+
+Q(dict)
+
+Q(dict)
+
+Q(dict_view)
+
+Q(difference)
+
+Q(difference)
+
+Q(difference_update)
+
+Q(dir)
+
+Q(disable)
+
+Q(discard)
+
+Q(divmod)
+
+Q(doc)
+
+Q(dot)
+
+Q(e)
+
+Q(enable)
+
+Q(encode)
+
+Q(encoding)
+
+Q(end)
+
+Q(endswith)
+
+Q(enumerate)
+
+Q(enumerate)
+
+Q(errorcode)
+
+Q(eval)
+
+Q(exec)
+
+Q(exp)
+
+Q(extend)
+
+Q(extend)
+
+Q(fabs)
+
+Q(fft)
+
+Q(file)
+
+Q(filter)
+
+Q(filter)
+
+Q(find)
+
+Q(fir)
+
+Q(float)
+
+Q(float)
+
+Q(floor)
+
+Q(flush)
+
+Q(fmod)
+
+Q(format)
+
+Q(format)
+
+Q(frexp)
+
+Q(from_bytes)
+
+Q(fromkeys)
+
+Q(frozenset)
+
+Q(frozenset)
+
+Q(fsformat)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(gc)
+
+Q(gc)
+
+Q(generator)
+
+Q(generator)
+
+Q(generator)
+
+Q(get)
+
+Q(getattr)
+
+Q(getcwd)
+
+Q(getfree)
+
+Q(getter)
+
+Q(getvalue)
+
+Q(globals)
+
+Q(group)
+
+Q(group)
+
+Q(groups)
+
+Q(groups)
+
+Q(hasattr)
+
+Q(hash)
+
+Q(heap_lock)
+
+Q(heap_unlock)
+
+Q(hex)
+
+Q(id)
+
+Q(ilistdir)
+
+Q(ilistdir)
+
+Q(im)
+
+Q(imag)
+
+Q(incremental)
+
+Q(index)
+
+Q(index)
+
+Q(index)
+
+Q(insert)
+
+Q(int)
+
+Q(int)
+
+Q(intersection)
+
+Q(intersection)
+
+Q(intersection_update)
+
+Q(inverse)
+
+Q(ioctl)
+
+Q(ioctl)
+
+Q(isalpha)
+
+Q(isdigit)
+
+Q(isdisjoint)
+
+Q(isdisjoint)
+
+Q(isenabled)
+
+Q(isfinite)
+
+Q(isinf)
+
+Q(isinstance)
+
+Q(islower)
+
+Q(isnan)
+
+Q(isspace)
+
+Q(issubclass)
+
+Q(issubset)
+
+Q(issubset)
+
+Q(issuperset)
+
+Q(issuperset)
+
+Q(isupper)
+
+Q(items)
+
+Q(iter)
+
+Q(iter_unpack)
+
+Q(iterable)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(join)
+
+Q(key)
+
+Q(key)
+
+Q(keys)
+
+Q(keys)
+
+Q(ldexp)
+
+Q(len)
+
+Q(list)
+
+Q(list)
+
+Q(little)
+
+Q(little)
+
+Q(little)
+
+Q(locals)
+
+Q(log)
+
+Q(lower)
+
+Q(lstrip)
+
+Q(magnitude)
+
+Q(map)
+
+Q(map)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match_into)
+
+Q(match_into)
+
+Q(match_into)
+
+Q(match_into)
+
+Q(math)
+
+Q(math)
+
+Q(max)
+
+Q(mean)
+
+Q(mem_alloc)
+
+Q(mem_free)
+
+Q(memoryview)
+
+Q(memoryview)
+
+Q(micropython)
+
+Q(micropython)
+
+Q(micropython)
+
+Q(min)
+
+Q(minmax)
+
+Q(mkdir)
+
+Q(mkfs)
+
+Q(mode)
+
+Q(modf)
+
+Q(module)
+
+Q(mount)
+
+Q(mount)
+
+Q(moving_average)
+
+Q(mul)
+
+Q(namedtuple)
+
+Q(next)
+
+Q(object)
+
+Q(object)
+
+Q(oct)
+
+Q(open)
+
+Q(open)
+
+Q(open)
+
+Q(opt_level)
+
+Q(ord)
+
+Q(pack)
+
+Q(pack)
+
+Q(pack_into)
+
+Q(pack_into)
+
+Q(password)
+
+Q(password)
+
+Q(pend_throw)
+
+Q(pi)
+
+Q(pop)
+
+Q(pop)
+
+Q(pop)
+
+Q(popitem)
+
+Q(pow)
+
+Q(pow)
+
+Q(print)
+
+Q(profile)
+
+Q(profile_data)
+
+Q(profile_dump)
+
+Q(property)
+
+Q(property)
+
+Q(r)
+
+Q(radians)
+
+Q(range)
+
+Q(range)
+
+Q(range)
+
+Q(rb)
+
+Q(rb)
+
+Q(re)
+
+Q(read)
+
+Q(read)
+
+Q(read)
+
+Q(read)
+
+Q(read)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readline)
+
+Q(readline)
+
+Q(readline)
+
+Q(readonly)
+
+Q(real)
+
+Q(remove)
+
+Q(remove)
+
+Q(remove)
+
+Q(rename)
+
+Q(replace)
+
+Q(repr)
+
+Q(reverse)
+
+Q(reverse)
+
+Q(reversed)
+
+Q(reversed)
+
+Q(rfind)
+
+Q(rindex)
+
+Q(rmdir)
+
+Q(rms)
+
+Q(round)
+
+Q(rsplit)
+
+Q(rstrip)
+
+Q(search)
+
+Q(search)
+
+Q(search)
+
+Q(search)
+
+Q(search_into)
+
+Q(search_into)
+
+Q(search_into)
+
+Q(search_into)
+
+Q(seek)
+
+Q(send)
+
+Q(send)
+
+Q(sep)
+
+Q(set)
+
+Q(set)
+
+Q(setattr)
+
+Q(setblocking)
+
+Q(setblocking)
+
+Q(setdefault)
+
+Q(setter)
+
+Q(sin)
+
+Q(size)
+
+Q(sizeof)
+
+Q(sizeof)
+
+Q(slice)
+
+Q(slice)
+
+Q(sort)
+
+Q(sorted)
+
+Q(split)
+
+Q(split)
+
+Q(split)
+
+Q(sqrt)
+
+Q(start)
+
+Q(start)
+
+Q(startswith)
+
+Q(stat)
+
+Q(stat)
+
+Q(staticmethod)
+
+Q(staticmethod)
+
+Q(stats)
+
+Q(statvfs)
+
+Q(step)
+
+Q(stop)
+
+Q(str)
+
+Q(str)
+
+Q(str)
+
+Q(str)
+
+Q(strip)
+
+Q(struct)
+
+Q(struct)
+
+Q(struct)
+
+Q(struct)
+
+Q(sub)
+
+Q(sub)
+
+Q(sub)
+
+Q(sub)
+
+Q(sub)
+
+Q(sum)
+
+Q(sum)
+
+Q(super)
+
+Q(super)
+
+Q(super)
+
+Q(symmetric_difference)
+
+Q(symmetric_difference)
+
+Q(symmetric_difference_update)
+
+Q(tan)
+
+Q(threshold)
+
+Q(threshold)
+
+Q(throw)
+
+Q(throw)
+
+Q(to_bytes)
+
+Q(to_dict)
+
+Q(to_dict)
+
+Q(to_float)
+
+Q(to_int16)
+
+Q(to_tuple)
+
+Q(to_tuple)
+
+Q(trunc)
+
+Q(tuple)
+
+Q(tuple)
+
+Q(type)
+
+Q(type)
+
+Q(ucollections)
+
+Q(ucollections)
+
+Q(uctypes)
+
+Q(uctypes)
+
+Q(uctypes)
+
+Q(udsp)
+
+Q(udsp)
+
+Q(uerrno)
+
+Q(uerrno)
+
+Q(uio)
+
+Q(uio)
+
+Q(umount)
+
+Q(union)
+
+Q(union)
+
+Q(unpack)
+
+Q(unpack)
+
+Q(unpack_from)
+
+Q(unpack_from)
+
+Q(update)
+
+Q(update)
+
+Q(upper)
+
+Q(ure)
+
+Q(ure)
+
+Q(ure)
+
+Q(ure)
+
+Q(ure)
+
+Q(ustruct)
+
+Q(ustruct)
+
+Q(utf_hyphen_8)
+
+Q(utf_hyphen_8)
+
+Q(uwebsocket)
+
+Q(uwebsocket)
+
+Q(uwebsocket)
+
+Q(value)
+
+Q(values)
+
+Q(wb)
+
+Q(wb)
+
+Q(wb)
+
+Q(websocket)
+
+Q(websocket)
+
+Q(websocket)
+
+Q(websocket)
+
+Q(write)
+
+Q(write)
+
+Q(write)
+
+Q(write)
+
+Q(write)
+
+Q(zip)
+
+Q(zip)
+
+Q(zip)
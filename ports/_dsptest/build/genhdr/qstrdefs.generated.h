@@ -0,0 +1,424 @@
+// This file was automatically generated by makeqstrdata.py
+
+QDEF(MP_QSTR_NULL, (const byte*)"\x00\x00" "")
+QDEF(MP_QSTR_, (const byte*)"\x05\x00" "")
+QDEF(MP_QSTR___dir__, (const byte*)"\x7a\x07" "__dir__")
+QDEF(MP_QSTR__0x0a_, (const byte*)"\xaf\x01" "\x0a")
+QDEF(MP_QSTR__space_, (const byte*)"\x85\x01" " ")
+QDEF(MP_QSTR__star_, (const byte*)"\x8f\x01" "*")
+QDEF(MP_QSTR__slash_, (const byte*)"\x8a\x01" "/")
+QDEF(MP_QSTR__lt_module_gt_, (const byte*)"\xbd\x08" "<module>")
+QDEF(MP_QSTR__, (const byte*)"\xfa\x01" "_")
+QDEF(MP_QSTR___call__, (const byte*)"\xa7\x08" "__call__")
+QDEF(MP_QSTR___class__, (const byte*)"\x2b\x09" "__class__")
+QDEF(MP_QSTR___delitem__, (const byte*)"\xfd\x0b" "__delitem__")
+QDEF(MP_QSTR___enter__, (const byte*)"\x6d\x09" "__enter__")
+QDEF(MP_QSTR___exit__, (const byte*)"\x45\x08" "__exit__")
+QDEF(MP_QSTR___getattr__, (const byte*)"\x40\x0b" "__getattr__")
+QDEF(MP_QSTR___getitem__, (const byte*)"\x26\x0b" "__getitem__")
+QDEF(MP_QSTR___hash__, (const byte*)"\xf7\x08" "__hash__")
+QDEF(MP_QSTR___init__, (const byte*)"\x5f\x08" "__init__")
+QDEF(MP_QSTR___int__, (const byte*)"\x16\x07" "__int__")
+QDEF(MP_QSTR___iter__, (const byte*)"\xcf\x08" "__iter__")
+QDEF(MP_QSTR___len__, (const byte*)"\xe2\x07" "__len__")
+QDEF(MP_QSTR___main__, (const byte*)"\x8e\x08" "__main__")
+QDEF(MP_QSTR___module__, (const byte*)"\xff\x0a" "__module__")
+QDEF(MP_QSTR___name__, (const byte*)"\xe2\x08" "__name__")
+QDEF(MP_QSTR___new__, (const byte*)"\x79\x07" "__new__")
+QDEF(MP_QSTR___next__, (const byte*)"\x02\x08" "__next__")
+QDEF(MP_QSTR___qualname__, (const byte*)"\x6b\x0c" "__qualname__")
+QDEF(MP_QSTR___repr__, (const byte*)"\x10\x08" "__repr__")
+QDEF(MP_QSTR___setitem__, (const byte*)"\x32\x0b" "__setitem__")
+QDEF(MP_QSTR___str__, (const byte*)"\xd0\x07" "__str__")
+QDEF(MP_QSTR_ArithmeticError, (const byte*)"\x2d\x0f" "ArithmeticError")
+QDEF(MP_QSTR_AssertionError, (const byte*)"\x97\x0e" "AssertionError")
+QDEF(MP_QSTR_AttributeError, (const byte*)"\x21\x0e" "AttributeError")
+QDEF(MP_QSTR_BaseException, (const byte*)"\x07\x0d" "BaseException")
+QDEF(MP_QSTR_EOFError, (const byte*)"\x91\x08" "EOFError")
+QDEF(MP_QSTR_Ellipsis, (const byte*)"\xf0\x08" "Ellipsis")
+QDEF(MP_QSTR_Exception, (const byte*)"\xf2\x09" "Exception")
+QDEF(MP_QSTR_GeneratorExit, (const byte*)"\x16\x0d" "GeneratorExit")
+QDEF(MP_QSTR_ImportError, (const byte*)"\x20\x0b" "ImportError")
+QDEF(MP_QSTR_IndentationError, (const byte*)"\x5c\x10" "IndentationError")
+QDEF(MP_QSTR_IndexError, (const byte*)"\x83\x0a" "IndexError")
+QDEF(MP_QSTR_KeyError, (const byte*)"\xea\x08" "KeyError")
+QDEF(MP_QSTR_KeyboardInterrupt, (const byte*)"\xaf\x11" "KeyboardInterrupt")
+QDEF(MP_QSTR_LookupError, (const byte*)"\xff\x0b" "LookupError")
+QDEF(MP_QSTR_MemoryError, (const byte*)"\xdc\x0b" "MemoryError")
+QDEF(MP_QSTR_NameError, (const byte*)"\xba\x09" "NameError")
+QDEF(MP_QSTR_NoneType, (const byte*)"\x17\x08" "NoneType")
+QDEF(MP_QSTR_NotImplementedError, (const byte*)"\xc6\x13" "NotImplementedError")
+QDEF(MP_QSTR_OSError, (const byte*)"\xa1\x07" "OSError")
+QDEF(MP_QSTR_OverflowError, (const byte*)"\x81\x0d" "OverflowError")
+QDEF(MP_QSTR_RuntimeError, (const byte*)"\x61\x0c" "RuntimeError")
+QDEF(MP_QSTR_StopIteration, (const byte*)"\xea\x0d" "StopIteration")
+QDEF(MP_QSTR_SyntaxError, (const byte*)"\x94\x0b" "SyntaxError")
+QDEF(MP_QSTR_SystemExit, (const byte*)"\x20\x0a" "SystemExit")
+QDEF(MP_QSTR_TypeError, (const byte*)"\x25\x09" "TypeError")
+QDEF(MP_QSTR_ValueError, (const byte*)"\x96\x0a" "ValueError")
+QDEF(MP_QSTR_ZeroDivisionError, (const byte*)"\xb6\x11" "ZeroDivisionError")
+QDEF(MP_QSTR_abs, (const byte*)"\x95\x03" "abs")
+QDEF(MP_QSTR_all, (const byte*)"\x44\x03" "all")
+QDEF(MP_QSTR_any, (const byte*)"\x13\x03" "any")
+QDEF(MP_QSTR_append, (const byte*)"\x6b\x06" "append")
+QDEF(MP_QSTR_args, (const byte*)"\xc2\x04" "args")
+QDEF(MP_QSTR_bool, (const byte*)"\xeb\x04" "bool")
+QDEF(MP_QSTR_builtins, (const byte*)"\xf7\x08" "builtins")
+QDEF(MP_QSTR_bytearray, (const byte*)"\x76\x09" "bytearray")
+QDEF(MP_QSTR_bytecode, (const byte*)"\x22\x08" "bytecode")
+QDEF(MP_QSTR_bytes, (const byte*)"\x5c\x05" "bytes")
+QDEF(MP_QSTR_callable, (const byte*)"\x0d\x08" "callable")
+QDEF(MP_QSTR_chr, (const byte*)"\xdc\x03" "chr")
+QDEF(MP_QSTR_classmethod, (const byte*)"\xb4\x0b" "classmethod")
+QDEF(MP_QSTR_clear, (const byte*)"\x7c\x05" "clear")
+QDEF(MP_QSTR_close, (const byte*)"\x33\x05" "close")
+QDEF(MP_QSTR_const, (const byte*)"\xc0\x05" "const")
+QDEF(MP_QSTR_copy, (const byte*)"\xe0\x04" "copy")
+QDEF(MP_QSTR_count, (const byte*)"\xa6\x05" "count")
+QDEF(MP_QSTR_dict, (const byte*)"\x3f\x04" "dict")
+QDEF(MP_QSTR_dir, (const byte*)"\xfa\x03" "dir")
+QDEF(MP_QSTR_divmod, (const byte*)"\xb8\x06" "divmod")
+QDEF(MP_QSTR_end, (const byte*)"\x0a\x03" "end")
+QDEF(MP_QSTR_endswith, (const byte*)"\x1b\x08" "endswith")
+QDEF(MP_QSTR_eval, (const byte*)"\x9b\x04" "eval")
+QDEF(MP_QSTR_exec, (const byte*)"\x1e\x04" "exec")
+QDEF(MP_QSTR_extend, (const byte*)"\x63\x06" "extend")
+QDEF(MP_QSTR_find, (const byte*)"\x01\x04" "find")
+QDEF(MP_QSTR_format, (const byte*)"\x26\x06" "format")
+QDEF(MP_QSTR_from_bytes, (const byte*)"\x35\x0a" "from_bytes")
+QDEF(MP_QSTR_get, (const byte*)"\x33\x03" "get")
+QDEF(MP_QSTR_getattr, (const byte*)"\xc0\x07" "getattr")
+QDEF(MP_QSTR_globals, (const byte*)"\x9d\x07" "globals")
+QDEF(MP_QSTR_hasattr, (const byte*)"\x8c\x07" "hasattr")
+QDEF(MP_QSTR_hash, (const byte*)"\xb7\x04" "hash")
+QDEF(MP_QSTR_id, (const byte*)"\x28\x02" "id")
+QDEF(MP_QSTR_index, (const byte*)"\x7b\x05" "index")
+QDEF(MP_QSTR_insert, (const byte*)"\x12\x06" "insert")
+QDEF(MP_QSTR_int, (const byte*)"\x16\x03" "int")
+QDEF(MP_QSTR_isalpha, (const byte*)"\xeb\x07" "isalpha")
+QDEF(MP_QSTR_isdigit, (const byte*)"\xa8\x07" "isdigit")
+QDEF(MP_QSTR_isinstance, (const byte*)"\xb6\x0a" "isinstance")
+QDEF(MP_QSTR_islower, (const byte*)"\xfc\x07" "islower")
+QDEF(MP_QSTR_isspace, (const byte*)"\x5b\x07" "isspace")
+QDEF(MP_QSTR_issubclass, (const byte*)"\xb5\x0a" "issubclass")
+QDEF(MP_QSTR_isupper, (const byte*)"\xdd\x07" "isupper")
+QDEF(MP_QSTR_items, (const byte*)"\xe3\x05" "items")
+QDEF(MP_QSTR_iter, (const byte*)"\x8f\x04" "iter")
+QDEF(MP_QSTR_join, (const byte*)"\xa7\x04" "join")
+QDEF(MP_QSTR_key, (const byte*)"\x32\x03" "key")
+QDEF(MP_QSTR_keys, (const byte*)"\x01\x04" "keys")
+QDEF(MP_QSTR_len, (const byte*)"\x62\x03" "len")
+QDEF(MP_QSTR_list, (const byte*)"\x27\x04" "list")
+QDEF(MP_QSTR_little, (const byte*)"\x89\x06" "little")
+QDEF(MP_QSTR_locals, (const byte*)"\x3b\x06" "locals")
+QDEF(MP_QSTR_lower, (const byte*)"\xc6\x05" "lower")
+QDEF(MP_QSTR_lstrip, (const byte*)"\xe5\x06" "lstrip")
+QDEF(MP_QSTR_main, (const byte*)"\xce\x04" "main")
+QDEF(MP_QSTR_map, (const byte*)"\xb9\x03" "map")
+QDEF(MP_QSTR_micropython, (const byte*)"\x0b\x0b" "micropython")
+QDEF(MP_QSTR_next, (const byte*)"\x42\x04" "next")
+QDEF(MP_QSTR_object, (const byte*)"\x90\x06" "object")
+QDEF(MP_QSTR_open, (const byte*)"\xd1\x04" "open")
+QDEF(MP_QSTR_ord, (const byte*)"\x1c\x03" "ord")
+QDEF(MP_QSTR_pop, (const byte*)"\x2a\x03" "pop")
+QDEF(MP_QSTR_popitem, (const byte*)"\xbf\x07" "popitem")
+QDEF(MP_QSTR_pow, (const byte*)"\x2d\x03" "pow")
+QDEF(MP_QSTR_print, (const byte*)"\x54\x05" "print")
+QDEF(MP_QSTR_range, (const byte*)"\x1a\x05" "range")
+QDEF(MP_QSTR_read, (const byte*)"\xb7\x04" "read")
+QDEF(MP_QSTR_readinto, (const byte*)"\x4b\x08" "readinto")
+QDEF(MP_QSTR_readline, (const byte*)"\xf9\x08" "readline")
+QDEF(MP_QSTR_remove, (const byte*)"\x63\x06" "remove")
+QDEF(MP_QSTR_replace, (const byte*)"\x49\x07" "replace")
+QDEF(MP_QSTR_repr, (const byte*)"\xd0\x04" "repr")
+QDEF(MP_QSTR_reverse, (const byte*)"\x25\x07" "reverse")
+QDEF(MP_QSTR_rfind, (const byte*)"\xd2\x05" "rfind")
+QDEF(MP_QSTR_rindex, (const byte*)"\xe9\x06" "rindex")
+QDEF(MP_QSTR_round, (const byte*)"\xe7\x05" "round")
+QDEF(MP_QSTR_rsplit, (const byte*)"\xa5\x06" "rsplit")
+QDEF(MP_QSTR_rstrip, (const byte*)"\x3b\x06" "rstrip")
+QDEF(MP_QSTR_self, (const byte*)"\x79\x04" "self")
+QDEF(MP_QSTR_send, (const byte*)"\xb9\x04" "send")
+QDEF(MP_QSTR_sep, (const byte*)"\x23\x03" "sep")
+QDEF(MP_QSTR_set, (const byte*)"\x27\x03" "set")
+QDEF(MP_QSTR_setattr, (const byte*)"\xd4\x07" "setattr")
+QDEF(MP_QSTR_setdefault, (const byte*)"\x6c\x0a" "setdefault")
+QDEF(MP_QSTR_sort, (const byte*)"\xbf\x04" "sort")
+QDEF(MP_QSTR_sorted, (const byte*)"\x5e\x06" "sorted")
+QDEF(MP_QSTR_split, (const byte*)"\xb7\x05" "split")
+QDEF(MP_QSTR_start, (const byte*)"\x85\x05" "start")
+QDEF(MP_QSTR_startswith, (const byte*)"\x74\x0a" "startswith")
+QDEF(MP_QSTR_staticmethod, (const byte*)"\x62\x0c" "staticmethod")
+QDEF(MP_QSTR_step, (const byte*)"\x57\x04" "step")
+QDEF(MP_QSTR_stop, (const byte*)"\x9d\x04" "stop")
+QDEF(MP_QSTR_str, (const byte*)"\x50\x03" "str")
+QDEF(MP_QSTR_strip, (const byte*)"\x29\x05" "strip")
+QDEF(MP_QSTR_sum, (const byte*)"\x2e\x03" "sum")
+QDEF(MP_QSTR_super, (const byte*)"\xc4\x05" "super")
+QDEF(MP_QSTR_throw, (const byte*)"\xb3\x05" "throw")
+QDEF(MP_QSTR_to_bytes, (const byte*)"\xd8\x08" "to_bytes")
+QDEF(MP_QSTR_tuple, (const byte*)"\xfd\x05" "tuple")
+QDEF(MP_QSTR_type, (const byte*)"\x9d\x04" "type")
+QDEF(MP_QSTR_update, (const byte*)"\xb4\x06" "update")
+QDEF(MP_QSTR_upper, (const byte*)"\x27\x05" "upper")
+QDEF(MP_QSTR_utf_hyphen_8, (const byte*)"\xb7\x05" "utf-8")
+QDEF(MP_QSTR_value, (const byte*)"\x4e\x05" "value")
+QDEF(MP_QSTR_values, (const byte*)"\x7d\x06" "values")
+QDEF(MP_QSTR_write, (const byte*)"\x98\x05" "write")
+QDEF(MP_QSTR_zip, (const byte*)"\xe6\x03" "zip")
+QDEF(MP_QSTR___add__, (const byte*)"\xc4\x07" "__add__")
+QDEF(MP_QSTR___bool__, (const byte*)"\x2b\x08" "__bool__")
+QDEF(MP_QSTR___build_class__, (const byte*)"\x42\x0f" "__build_class__")
+QDEF(MP_QSTR___contains__, (const byte*)"\xc6\x0c" "__contains__")
+QDEF(MP_QSTR___dict__, (const byte*)"\x7f\x08" "__dict__")
+QDEF(MP_QSTR___eq__, (const byte*)"\x71\x06" "__eq__")
+QDEF(MP_QSTR___file__, (const byte*)"\x03\x08" "__file__")
+QDEF(MP_QSTR___ge__, (const byte*)"\xa7\x06" "__ge__")
+QDEF(MP_QSTR___gt__, (const byte*)"\xb6\x06" "__gt__")
+QDEF(MP_QSTR___iadd__, (const byte*)"\x6d\x08" "__iadd__")
+QDEF(MP_QSTR___import__, (const byte*)"\x38\x0a" "__import__")
+QDEF(MP_QSTR___isub__, (const byte*)"\x08\x08" "__isub__")
+QDEF(MP_QSTR___le__, (const byte*)"\xcc\x06" "__le__")
+QDEF(MP_QSTR___lt__, (const byte*)"\x5d\x06" "__lt__")
+QDEF(MP_QSTR___path__, (const byte*)"\xc8\x08" "__path__")
+QDEF(MP_QSTR___repl_print__, (const byte*)"\x01\x0e" "__repl_print__")
+QDEF(MP_QSTR___reversed__, (const byte*)"\x61\x0c" "__reversed__")
+QDEF(MP_QSTR___sub__, (const byte*)"\x21\x07" "__sub__")
+QDEF(MP_QSTR___traceback__, (const byte*)"\x4f\x0d" "__traceback__")
+QDEF(MP_QSTR__percent__hash_o, (const byte*)"\x6c\x03" "%#o")
+QDEF(MP_QSTR__percent__hash_x, (const byte*)"\x7b\x03" "%#x")
+QDEF(MP_QSTR__brace_open__colon__hash_b_brace_close_, (const byte*)"\x58\x05" "{:#b}")
+QDEF(MP_QSTR_maximum_space_recursion_space_depth_space_exceeded, (const byte*)"\x73\x20" "maximum recursion depth exceeded")
+QDEF(MP_QSTR__lt_lambda_gt_, (const byte*)"\x80\x08" "<lambda>")
+QDEF(MP_QSTR__lt_listcomp_gt_, (const byte*)"\xd4\x0a" "<listcomp>")
+QDEF(MP_QSTR__lt_dictcomp_gt_, (const byte*)"\xcc\x0a" "<dictcomp>")
+QDEF(MP_QSTR__lt_setcomp_gt_, (const byte*)"\x54\x09" "<setcomp>")
+QDEF(MP_QSTR__lt_genexpr_gt_, (const byte*)"\x34\x09" "<genexpr>")
+QDEF(MP_QSTR__lt_string_gt_, (const byte*)"\x52\x08" "<string>")
+QDEF(MP_QSTR__lt_stdin_gt_, (const byte*)"\xe3\x07" "<stdin>")
+QDEF(MP_QSTR_ARRAY, (const byte*)"\x5c\x05" "ARRAY")
+QDEF(MP_QSTR_BFINT16, (const byte*)"\x95\x07" "BFINT16")
+QDEF(MP_QSTR_BFINT32, (const byte*)"\x53\x07" "BFINT32")
+QDEF(MP_QSTR_BFINT8, (const byte*)"\x4a\x06" "BFINT8")
+QDEF(MP_QSTR_BFUINT16, (const byte*)"\x40\x08" "BFUINT16")
+QDEF(MP_QSTR_BFUINT32, (const byte*)"\x06\x08" "BFUINT32")
+QDEF(MP_QSTR_BFUINT8, (const byte*)"\xbf\x07" "BFUINT8")
+QDEF(MP_QSTR_BF_LEN, (const byte*)"\x19\x06" "BF_LEN")
+QDEF(MP_QSTR_BF_POS, (const byte*)"\x52\x06" "BF_POS")
+QDEF(MP_QSTR_BIG_ENDIAN, (const byte*)"\xff\x0a" "BIG_ENDIAN")
+QDEF(MP_QSTR_BytesIO, (const byte*)"\x1a\x07" "BytesIO")
+QDEF(MP_QSTR_DEBUG, (const byte*)"\x34\x05" "DEBUG")
+QDEF(MP_QSTR_EACCES, (const byte*)"\x37\x06" "EACCES")
+QDEF(MP_QSTR_EADDRINUSE, (const byte*)"\x17\x0a" "EADDRINUSE")
+QDEF(MP_QSTR_EAGAIN, (const byte*)"\x20\x06" "EAGAIN")
+QDEF(MP_QSTR_EALREADY, (const byte*)"\x46\x08" "EALREADY")
+QDEF(MP_QSTR_EBADF, (const byte*)"\x61\x05" "EBADF")
+QDEF(MP_QSTR_ECONNABORTED, (const byte*)"\x27\x0c" "ECONNABORTED")
+QDEF(MP_QSTR_ECONNREFUSED, (const byte*)"\x3a\x0c" "ECONNREFUSED")
+QDEF(MP_QSTR_ECONNRESET, (const byte*)"\x19\x0a" "ECONNRESET")
+QDEF(MP_QSTR_EEXIST, (const byte*)"\x53\x06" "EEXIST")
+QDEF(MP_QSTR_EHOSTUNREACH, (const byte*)"\x86\x0c" "EHOSTUNREACH")
+QDEF(MP_QSTR_EINPROGRESS, (const byte*)"\x9a\x0b" "EINPROGRESS")
+QDEF(MP_QSTR_EINVAL, (const byte*)"\x5c\x06" "EINVAL")
+QDEF(MP_QSTR_EIO, (const byte*)"\x86\x03" "EIO")
+QDEF(MP_QSTR_EISDIR, (const byte*)"\xa5\x06" "EISDIR")
+QDEF(MP_QSTR_EMSGSIZE, (const byte*)"\xfc\x08" "EMSGSIZE")
+QDEF(MP_QSTR_ENETDOWN, (const byte*)"\x6d\x08" "ENETDOWN")
+QDEF(MP_QSTR_ENOBUFS, (const byte*)"\xe3\x07" "ENOBUFS")
+QDEF(MP_QSTR_ENODEV, (const byte*)"\xb6\x06" "ENODEV")
+QDEF(MP_QSTR_ENOENT, (const byte*)"\x5e\x06" "ENOENT")
+QDEF(MP_QSTR_ENOMEM, (const byte*)"\xa4\x06" "ENOMEM")
+QDEF(MP_QSTR_ENOTCONN, (const byte*)"\x79\x08" "ENOTCONN")
+QDEF(MP_QSTR_EOPNOTSUPP, (const byte*)"\xac\x0a" "EOPNOTSUPP")
+QDEF(MP_QSTR_EPERM, (const byte*)"\xea\x05" "EPERM")
+QDEF(MP_QSTR_ETIMEDOUT, (const byte*)"\xff\x09" "ETIMEDOUT")
+QDEF(MP_QSTR_FLOAT32, (const byte*)"\xb4\x07" "FLOAT32")
+QDEF(MP_QSTR_FLOAT64, (const byte*)"\x17\x07" "FLOAT64")
+QDEF(MP_QSTR_INT, (const byte*)"\x36\x03" "INT")
+QDEF(MP_QSTR_INT16, (const byte*)"\x91\x05" "INT16")
+QDEF(MP_QSTR_INT32, (const byte*)"\x57\x05" "INT32")
+QDEF(MP_QSTR_INT64, (const byte*)"\xf4\x05" "INT64")
+QDEF(MP_QSTR_INT8, (const byte*)"\xce\x04" "INT8")
+QDEF(MP_QSTR_LITTLE_ENDIAN, (const byte*)"\xbf\x0d" "LITTLE_ENDIAN")
+QDEF(MP_QSTR_LONG, (const byte*)"\x0f\x04" "LONG")
+QDEF(MP_QSTR_LONGLONG, (const byte*)"\x85\x08" "LONGLONG")
+QDEF(MP_QSTR_NATIVE, (const byte*)"\x04\x06" "NATIVE")
+QDEF(MP_QSTR_OrderedDict, (const byte*)"\xf0\x0b" "OrderedDict")
+QDEF(MP_QSTR_PTR, (const byte*)"\xb3\x03" "PTR")
+QDEF(MP_QSTR_SHORT, (const byte*)"\xf7\x05" "SHORT")
+QDEF(MP_QSTR_StringIO, (const byte*)"\x76\x08" "StringIO")
+QDEF(MP_QSTR_Struct, (const byte*)"\xf2\x06" "Struct")
+QDEF(MP_QSTR_UINT, (const byte*)"\x23\x04" "UINT")
+QDEF(MP_QSTR_UINT16, (const byte*)"\xc4\x06" "UINT16")
+QDEF(MP_QSTR_UINT32, (const byte*)"\x82\x06" "UINT32")
+QDEF(MP_QSTR_UINT64, (const byte*)"\x61\x06" "UINT64")
+QDEF(MP_QSTR_UINT8, (const byte*)"\xbb\x05" "UINT8")
+QDEF(MP_QSTR_ULONG, (const byte*)"\x7a\x05" "ULONG")
+QDEF(MP_QSTR_ULONGLONG, (const byte*)"\x70\x09" "ULONGLONG")
+QDEF(MP_QSTR_USHORT, (const byte*)"\xa2\x06" "USHORT")
+QDEF(MP_QSTR_VOID, (const byte*)"\x31\x04" "VOID")
+QDEF(MP_QSTR__webrepl, (const byte*)"\x21\x08" "_webrepl")
+QDEF(MP_QSTR_acos, (const byte*)"\x1b\x04" "acos")
+QDEF(MP_QSTR_add, (const byte*)"\x44\x03" "add")
+QDEF(MP_QSTR_addressof, (const byte*)"\x5a\x09" "addressof")
+QDEF(MP_QSTR_array, (const byte*)"\x7c\x05" "array")
+QDEF(MP_QSTR_asin, (const byte*)"\x50\x04" "asin")
+QDEF(MP_QSTR_atan, (const byte*)"\x1f\x04" "atan")
+QDEF(MP_QSTR_atan2, (const byte*)"\xcd\x05" "atan2")
+QDEF(MP_QSTR_bin, (const byte*)"\xe0\x03" "bin")
+QDEF(MP_QSTR_bound_method, (const byte*)"\x97\x0c" "bound_method")
+QDEF(MP_QSTR_buffering, (const byte*)"\x25\x09" "buffering")
+QDEF(MP_QSTR_bytearray_at, (const byte*)"\x9c\x0c" "bytearray_at")
+QDEF(MP_QSTR_bytes_at, (const byte*)"\xb6\x08" "bytes_at")
+QDEF(MP_QSTR_calcsize, (const byte*)"\x4d\x08" "calcsize")
+QDEF(MP_QSTR_ceil, (const byte*)"\x06\x04" "ceil")
+QDEF(MP_QSTR_chdir, (const byte*)"\xb1\x05" "chdir")
+QDEF(MP_QSTR_closure, (const byte*)"\x74\x07" "closure")
+QDEF(MP_QSTR_collect, (const byte*)"\x9b\x07" "collect")
+QDEF(MP_QSTR_compile, (const byte*)"\xf4\x07" "compile")
+QDEF(MP_QSTR_complex, (const byte*)"\xc5\x07" "complex")
+QDEF(MP_QSTR_copysign, (const byte*)"\x33\x08" "copysign")
+QDEF(MP_QSTR_cos, (const byte*)"\x7a\x03" "cos")
+QDEF(MP_QSTR_decode, (const byte*)"\xa9\x06" "decode")
+QDEF(MP_QSTR_default, (const byte*)"\xce\x07" "default")
+QDEF(MP_QSTR_degrees, (const byte*)"\x02\x07" "degrees")
+QDEF(MP_QSTR_delattr, (const byte*)"\xdb\x07" "delattr")
+QDEF(MP_QSTR_deleter, (const byte*)"\x6e\x07" "deleter")
+QDEF(MP_QSTR_dict_view, (const byte*)"\x2d\x09" "dict_view")
+QDEF(MP_QSTR_difference, (const byte*)"\x72\x0a" "difference")
+QDEF(MP_QSTR_difference_update, (const byte*)"\x9c\x11" "difference_update")
+QDEF(MP_QSTR_disable, (const byte*)"\x91\x07" "disable")
+QDEF(MP_QSTR_discard, (const byte*)"\x0f\x07" "discard")
+QDEF(MP_QSTR_doc, (const byte*)"\x2d\x03" "doc")
+QDEF(MP_QSTR_dot, (const byte*)"\x3a\x03" "dot")
+QDEF(MP_QSTR_e, (const byte*)"\xc0\x01" "e")
+QDEF(MP_QSTR_enable, (const byte*)"\x04\x06" "enable")
+QDEF(MP_QSTR_encode, (const byte*)"\x43\x06" "encode")
+QDEF(MP_QSTR_encoding, (const byte*)"\x06\x08" "encoding")
+QDEF(MP_QSTR_enumerate, (const byte*)"\x71\x09" "enumerate")
+QDEF(MP_QSTR_errorcode, (const byte*)"\x10\x09" "errorcode")
+QDEF(MP_QSTR_exp, (const byte*)"\xc8\x03" "exp")
+QDEF(MP_QSTR_fabs, (const byte*)"\x93\x04" "fabs")
+QDEF(MP_QSTR_fft, (const byte*)"\x91\x03" "fft")
+QDEF(MP_QSTR_file, (const byte*)"\xc3\x04" "file")
+QDEF(MP_QSTR_filter, (const byte*)"\x25\x06" "filter")
+QDEF(MP_QSTR_fir, (const byte*)"\xf8\x03" "fir")
+QDEF(MP_QSTR_float, (const byte*)"\x35\x05" "float")
+QDEF(MP_QSTR_floor, (const byte*)"\x7d\x05" "floor")
+QDEF(MP_QSTR_flush, (const byte*)"\x61\x05" "flush")
+QDEF(MP_QSTR_fmod, (const byte*)"\xe5\x04" "fmod")
+QDEF(MP_QSTR_frexp, (const byte*)"\x1c\x05" "frexp")
+QDEF(MP_QSTR_fromkeys, (const byte*)"\x37\x08" "fromkeys")
+QDEF(MP_QSTR_frozenset, (const byte*)"\xed\x09" "frozenset")
+QDEF(MP_QSTR_fsformat, (const byte*)"\x33\x08" "fsformat")
+QDEF(MP_QSTR_function, (const byte*)"\x27\x08" "function")
+QDEF(MP_QSTR_gc, (const byte*)"\x61\x02" "gc")
+QDEF(MP_QSTR_generator, (const byte*)"\x96\x09" "generator")
+QDEF(MP_QSTR_getcwd, (const byte*)"\x03\x06" "getcwd")
+QDEF(MP_QSTR_getfree, (const byte*)"\x87\x07" "getfree")
+QDEF(MP_QSTR_getter, (const byte*)"\x90\x06" "getter")
+QDEF(MP_QSTR_getvalue, (const byte*)"\x78\x08" "getvalue")
+QDEF(MP_QSTR_group, (const byte*)"\xba\x05" "group")
+QDEF(MP_QSTR_groups, (const byte*)"\x89\x06" "groups")
+QDEF(MP_QSTR_heap_lock, (const byte*)"\xad\x09" "heap_lock")
+QDEF(MP_QSTR_heap_unlock, (const byte*)"\x56\x0b" "heap_unlock")
+QDEF(MP_QSTR_hex, (const byte*)"\x70\x03" "hex")
+QDEF(MP_QSTR_ilistdir, (const byte*)"\x71\x08" "ilistdir")
+QDEF(MP_QSTR_im, (const byte*)"\x21\x02" "im")
+QDEF(MP_QSTR_imag, (const byte*)"\x47\x04" "imag")
+QDEF(MP_QSTR_incremental, (const byte*)"\xc9\x0b" "incremental")
+QDEF(MP_QSTR_intersection, (const byte*)"\x28\x0c" "intersection")
+QDEF(MP_QSTR_intersection_update, (const byte*)"\x06\x13" "intersection_update")
+QDEF(MP_QSTR_inverse, (const byte*)"\xd5\x07" "inverse")
+QDEF(MP_QSTR_ioctl, (const byte*)"\x78\x05" "ioctl")
+QDEF(MP_QSTR_isdisjoint, (const byte*)"\xf7\x0a" "isdisjoint")
+QDEF(MP_QSTR_isenabled, (const byte*)"\x9a\x09" "isenabled")
+QDEF(MP_QSTR_isfinite, (const byte*)"\xa6\x08" "isfinite")
+QDEF(MP_QSTR_isinf, (const byte*)"\x3e\x05" "isinf")
+QDEF(MP_QSTR_isnan, (const byte*)"\x9e\x05" "isnan")
+QDEF(MP_QSTR_issubset, (const byte*)"\xb9\x08" "issubset")
+QDEF(MP_QSTR_issuperset, (const byte*)"\xfc\x0a" "issuperset")
+QDEF(MP_QSTR_iter_unpack, (const byte*)"\xb2\x0b" "iter_unpack")
+QDEF(MP_QSTR_iterable, (const byte*)"\x25\x08" "iterable")
+QDEF(MP_QSTR_iterator, (const byte*)"\x47\x08" "iterator")
+QDEF(MP_QSTR_ldexp, (const byte*)"\x40\x05" "ldexp")
+QDEF(MP_QSTR_log, (const byte*)"\x21\x03" "log")
+QDEF(MP_QSTR_magnitude, (const byte*)"\x69\x09" "magnitude")
+QDEF(MP_QSTR_match, (const byte*)"\x96\x05" "match")
+QDEF(MP_QSTR_match_into, (const byte*)"\xb5\x0a" "match_into")
+QDEF(MP_QSTR_math, (const byte*)"\x35\x04" "math")
+QDEF(MP_QSTR_max, (const byte*)"\xb1\x03" "max")
+QDEF(MP_QSTR_mean, (const byte*)"\xc2\x04" "mean")
+QDEF(MP_QSTR_mem_alloc, (const byte*)"\x52\x09" "mem_alloc")
+QDEF(MP_QSTR_mem_free, (const byte*)"\xcb\x08" "mem_free")
+QDEF(MP_QSTR_memoryview, (const byte*)"\x69\x0a" "memoryview")
+QDEF(MP_QSTR_min, (const byte*)"\xaf\x03" "min")
+QDEF(MP_QSTR_minmax, (const byte*)"\xdb\x06" "minmax")
+QDEF(MP_QSTR_mkdir, (const byte*)"\x9c\x05" "mkdir")
+QDEF(MP_QSTR_mkfs, (const byte*)"\x76\x04" "mkfs")
+QDEF(MP_QSTR_mode, (const byte*)"\x26\x04" "mode")
+QDEF(MP_QSTR_modf, (const byte*)"\x25\x04" "modf")
+QDEF(MP_QSTR_module, (const byte*)"\xbf\x06" "module")
+QDEF(MP_QSTR_mount, (const byte*)"\xa8\x05" "mount")
+QDEF(MP_QSTR_moving_average, (const byte*)"\x8d\x0e" "moving_average")
+QDEF(MP_QSTR_mul, (const byte*)"\x31\x03" "mul")
+QDEF(MP_QSTR_namedtuple, (const byte*)"\x1e\x0a" "namedtuple")
+QDEF(MP_QSTR_oct, (const byte*)"\xfd\x03" "oct")
+QDEF(MP_QSTR_opt_level, (const byte*)"\x87\x09" "opt_level")
+QDEF(MP_QSTR_pack, (const byte*)"\xbc\x04" "pack")
+QDEF(MP_QSTR_pack_into, (const byte*)"\x1f\x09" "pack_into")
+QDEF(MP_QSTR_password, (const byte*)"\x9a\x08" "password")
+QDEF(MP_QSTR_pend_throw, (const byte*)"\xf3\x0a" "pend_throw")
+QDEF(MP_QSTR_pi, (const byte*)"\x1c\x02" "pi")
+QDEF(MP_QSTR_profile, (const byte*)"\x4e\x07" "profile")
+QDEF(MP_QSTR_profile_data, (const byte*)"\x41\x0c" "profile_data")
+QDEF(MP_QSTR_profile_dump, (const byte*)"\x3d\x0c" "profile_dump")
+QDEF(MP_QSTR_property, (const byte*)"\xc2\x08" "property")
+QDEF(MP_QSTR_r, (const byte*)"\xd7\x01" "r")
+QDEF(MP_QSTR_radians, (const byte*)"\x87\x07" "radians")
+QDEF(MP_QSTR_rb, (const byte*)"\xd5\x02" "rb")
+QDEF(MP_QSTR_re, (const byte*)"\xd2\x02" "re")
+QDEF(MP_QSTR_readonly, (const byte*)"\x03\x08" "readonly")
+QDEF(MP_QSTR_real, (const byte*)"\xbf\x04" "real")
+QDEF(MP_QSTR_rename, (const byte*)"\x35\x06" "rename")
+QDEF(MP_QSTR_reversed, (const byte*)"\xa1\x08" "reversed")
+QDEF(MP_QSTR_rmdir, (const byte*)"\x45\x05" "rmdir")
+QDEF(MP_QSTR_rms, (const byte*)"\x69\x03" "rms")
+QDEF(MP_QSTR_search, (const byte*)"\xab\x06" "search")
+QDEF(MP_QSTR_search_into, (const byte*)"\xa8\x0b" "search_into")
+QDEF(MP_QSTR_seek, (const byte*)"\x9d\x04" "seek")
+QDEF(MP_QSTR_setblocking, (const byte*)"\x6e\x0b" "setblocking")
+QDEF(MP_QSTR_setter, (const byte*)"\x04\x06" "setter")
+QDEF(MP_QSTR_sin, (const byte*)"\xb1\x03" "sin")
+QDEF(MP_QSTR_size, (const byte*)"\x20\x04" "size")
+QDEF(MP_QSTR_sizeof, (const byte*)"\x49\x06" "sizeof")
+QDEF(MP_QSTR_slice, (const byte*)"\xb5\x05" "slice")
+QDEF(MP_QSTR_sqrt, (const byte*)"\x21\x04" "sqrt")
+QDEF(MP_QSTR_stat, (const byte*)"\xd7\x04" "stat")
+QDEF(MP_QSTR_stats, (const byte*)"\xc4\x05" "stats")
+QDEF(MP_QSTR_statvfs, (const byte*)"\x14\x07" "statvfs")
+QDEF(MP_QSTR_struct, (const byte*)"\x12\x06" "struct")
+QDEF(MP_QSTR_sub, (const byte*)"\x21\x03" "sub")
+QDEF(MP_QSTR_symmetric_difference, (const byte*)"\xce\x14" "symmetric_difference")
+QDEF(MP_QSTR_symmetric_difference_update, (const byte*)"\x60\x1b" "symmetric_difference_update")
+QDEF(MP_QSTR_tan, (const byte*)"\xfe\x03" "tan")
+QDEF(MP_QSTR_threshold, (const byte*)"\xf2\x09" "threshold")
+QDEF(MP_QSTR_to_dict, (const byte*)"\x3b\x07" "to_dict")
+QDEF(MP_QSTR_to_float, (const byte*)"\xb1\x08" "to_float")
+QDEF(MP_QSTR_to_int16, (const byte*)"\x75\x08" "to_int16")
+QDEF(MP_QSTR_to_tuple, (const byte*)"\x79\x08" "to_tuple")
+QDEF(MP_QSTR_trunc, (const byte*)"\x5b\x05" "trunc")
+QDEF(MP_QSTR_ucollections, (const byte*)"\x15\x0c" "ucollections")
+QDEF(MP_QSTR_uctypes, (const byte*)"\xf8\x07" "uctypes")
+QDEF(MP_QSTR_udsp, (const byte*)"\x57\x04" "udsp")
+QDEF(MP_QSTR_uerrno, (const byte*)"\xb4\x06" "uerrno")
+QDEF(MP_QSTR_uio, (const byte*)"\xb6\x03" "uio")
+QDEF(MP_QSTR_umount, (const byte*)"\xdd\x06" "umount")
+QDEF(MP_QSTR_union, (const byte*)"\xf6\x05" "union")
+QDEF(MP_QSTR_unpack, (const byte*)"\x07\x06" "unpack")
+QDEF(MP_QSTR_unpack_from, (const byte*)"\x0e\x0b" "unpack_from")
+QDEF(MP_QSTR_ure, (const byte*)"\x87\x03" "ure")
+QDEF(MP_QSTR_ustruct, (const byte*)"\x47\x07" "ustruct")
+QDEF(MP_QSTR_uwebsocket, (const byte*)"\xe5\x0a" "uwebsocket")
+QDEF(MP_QSTR_wb, (const byte*)"\x70\x02" "wb")
+QDEF(MP_QSTR_websocket, (const byte*)"\x90\x09" "websocket")
@@ -0,0 +1,1818 @@
+# 0 "<stdin>"
+# 0 "<built-in>"
+# 0 "<command-line>"
+# 1 "/usr/include/stdc-predef.h" 1 3 4
+# 0 "<command-line>" 2
+# 1 "<stdin>"
+# 27 "<stdin>"
+# 1 "/root/repo/py/mpconfig.h" 1
+# 62 "/root/repo/py/mpconfig.h"
+# 1 "./mpconfigport.h" 1
+# 1 "/usr/lib/gcc/x86_64-linux-gnu/12/include/stdint.h" 1 3 4
+# 9 "/usr/lib/gcc/x86_64-linux-gnu/12/include/stdint.h" 3 4
+# 1 "/usr/include/stdint.h" 1 3 4
+# 26 "/usr/include/stdint.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/libc-header-start.h" 1 3 4
+# 33 "/usr/include/x86_64-linux-gnu/bits/libc-header-start.h" 3 4
+# 1 "/usr/include/features.h" 1 3 4
+# 392 "/usr/include/features.h" 3 4
+# 1 "/usr/include/features-time64.h" 1 3 4
+# 20 "/usr/include/features-time64.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1 3 4
+# 21 "/usr/include/features-time64.h" 2 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 1 3 4
+# 19 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1 3 4
+# 20 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 2 3 4
+# 22 "/usr/include/features-time64.h" 2 3 4
+# 393 "/usr/include/features.h" 2 3 4
+# 489 "/usr/include/features.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/sys/cdefs.h" 1 3 4
+# 561 "/usr/include/x86_64-linux-gnu/sys/cdefs.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1 3 4
+# 562 "/usr/include/x86_64-linux-gnu/sys/cdefs.h" 2 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/long-double.h" 1 3 4
+# 563 "/usr/include/x86_64-linux-gnu/sys/cdefs.h" 2 3 4
+# 490 "/usr/include/features.h" 2 3 4
+# 513 "/usr/include/features.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/gnu/stubs.h" 1 3 4
+# 10 "/usr/include/x86_64-linux-gnu/gnu/stubs.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/gnu/stubs-64.h" 1 3 4
+# 11 "/usr/include/x86_64-linux-gnu/gnu/stubs.h" 2 3 4
+# 514 "/usr/include/features.h" 2 3 4
+# 34 "/usr/include/x86_64-linux-gnu/bits/libc-header-start.h" 2 3 4
+# 27 "/usr/include/stdint.h" 2 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/types.h" 1 3 4
+# 27 "/usr/include/x86_64-linux-gnu/bits/types.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1 3 4
+# 28 "/usr/include/x86_64-linux-gnu/bits/types.h" 2 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 1 3 4
+# 19 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1 3 4
+# 20 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 2 3 4
+# 29 "/usr/include/x86_64-linux-gnu/bits/types.h" 2 3 4
+
+
+
+# 31 "/usr/include/x86_64-linux-gnu/bits/types.h" 3 4
+typedef unsigned char __u_char;
+typedef unsigned short int __u_short;
+typedef unsigned int __u_int;
+typedef unsigned long int __u_long;
+
+
+typedef signed char __int8_t;
+typedef unsigned char __uint8_t;
+typedef signed short int __int16_t;
+typedef unsigned short int __uint16_t;
+typedef signed int __int32_t;
+typedef unsigned int __uint32_t;
+
+typedef signed long int __int64_t;
+typedef unsigned long int __uint64_t;
+
+
+
+
+
+
+typedef __int8_t __int_least8_t;
+typedef __uint8_t __uint_least8_t;
+typedef __int16_t __int_least16_t;
+typedef __uint16_t __uint_least16_t;
+typedef __int32_t __int_least32_t;
+typedef __uint32_t __uint_least32_t;
+typedef __int64_t __int_least64_t;
+typedef __uint64_t __uint_least64_t;
+
+
+
+typedef long int __quad_t;
+typedef unsigned long int __u_quad_t;
+
+
+
+
+
+
+
+typedef long int __intmax_t;
+typedef unsigned long int __uintmax_t;
+# 141 "/usr/include/x86_64-linux-gnu/bits/types.h" 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/typesizes.h" 1 3 4
+# 142 "/usr/include/x86_64-linux-gnu/bits/types.h" 2 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/time64.h" 1 3 4
+# 143 "/usr/include/x86_64-linux-gnu/bits/types.h" 2 3 4
+
+
+typedef unsigned long int __dev_t;
+typedef unsigned int __uid_t;
+typedef unsigned int __gid_t;
+typedef unsigned long int __ino_t;
+typedef unsigned long int __ino64_t;
+typedef unsigned int __mode_t;
+typedef unsigned long int __nlink_t;
+typedef long int __off_t;
+typedef long int __off64_t;
+typedef int __pid_t;
+typedef struct { int __val[2]; } __fsid_t;
+typedef long int __clock_t;
+typedef unsigned long int __rlim_t;
+typedef unsigned long int __rlim64_t;
+typedef unsigned int __id_t;
+typedef long int __time_t;
+typedef unsigned int __useconds_t;
+typedef long int __suseconds_t;
+typedef long int __suseconds64_t;
+
+typedef int __daddr_t;
+typedef int __key_t;
+
+
+typedef int __clockid_t;
+
+
+typedef void * __timer_t;
+
+
+typedef long int __blksize_t;
+
+
+
+
+typedef long int __blkcnt_t;
+typedef long int __blkcnt64_t;
+
+
+typedef unsigned long int __fsblkcnt_t;
+typedef unsigned long int __fsblkcnt64_t;
+
+
+typedef unsigned long int __fsfilcnt_t;
+typedef unsigned long int __fsfilcnt64_t;
+
+
+typedef long int __fsword_t;
+
+typedef long int __ssize_t;
+
+
+typedef long int __syscall_slong_t;
+
+typedef unsigned long int __syscall_ulong_t;
+
+
+
+typedef __off64_t __loff_t;
+typedef char *__caddr_t;
+
+
+typedef long int __intptr_t;
+
+
+typedef unsigned int __socklen_t;
+
+
+
+
+typedef int __sig_atomic_t;
+# 28 "/usr/include/stdint.h" 2 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/wchar.h" 1 3 4
+# 29 "/usr/include/stdint.h" 2 3 4
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1 3 4
+# 30 "/usr/include/stdint.h" 2 3 4
+
+
+
+
+# 1 "/usr/include/x86_64-linux-gnu/bits/stdint-intn.h" 1 3 4
+# 24 "/usr/include/x86_64-linux-gnu/bits/stdint-intn.h" 3 4
+typedef __int8_t int8_t;
+typedef __int16_t int16_t;
+typedef __int32_t int32_t;
+typedef __int64_t int64_t;
+# 35 "/usr/include/stdint.h" 2 3 4
+
+
+# 1 "/usr/include/x86_64-linux-gnu/bits/stdint-uintn.h" 1 3 4
+# 24 "/usr/include/x86_64-linux-gnu/bits/stdint-uintn.h" 3 4
+typedef __uint8_t uint8_t;
+typedef __uint16_t uint16_t;
+typedef __uint32_t uint32_t;
+typedef __uint64_t uint64_t;
+# 38 "/usr/include/stdint.h" 2 3 4
+
+
+
+
+
+typedef __int_least8_t int_least8_t;
+typedef __int_least16_t int_least16_t;
+typedef __int_least32_t int_least32_t;
+typedef __int_least64_t int_least64_t;
+
+
+typedef __uint_least8_t uint_least8_t;
+typedef __uint_least16_t uint_least16_t;
+typedef __uint_least32_t uint_least32_t;
+typedef __uint_least64_t uint_least64_t;
+
+
+
+
+
+typedef signed char int_fast8_t;
+
+typedef long int int_fast16_t;
+typedef long int int_fast32_t;
+typedef long int int_fast64_t;
+# 71 "/usr/include/stdint.h" 3 4
+typedef unsigned char uint_fast8_t;
+
+typedef unsigned long int uint_fast16_t;
+typedef unsigned long int uint_fast32_t;
+typedef unsigned long int uint_fast64_t;
+# 87 "/usr/include/stdint.h" 3 4
+typedef long int intptr_t;
+
+
+typedef unsigned long int uintptr_t;
+# 101 "/usr/include/stdint.h" 3 4
+typedef __intmax_t intmax_t;
+typedef __uintmax_t uintmax_t;
+# 10 "/usr/lib/gcc/x86_64-linux-gnu/12/include/stdint.h" 2 3 4
+# 2 "./mpconfigport.h" 2
+# 93 "./mpconfigport.h"
+
+# 93 "./mpconfigport.h"
+typedef long mp_int_t;
+typedef unsigned long mp_uint_t;
+
+typedef long mp_off_t;
+# 105 "./mpconfigport.h"
+# 1 "/usr/include/alloca.h" 1 3 4
+# 24 "/usr/include/alloca.h" 3 4
+# 1 "/usr/lib/gcc/x86_64-linux-gnu/12/include/stddef.h" 1 3 4
+# 214 "/usr/lib/gcc/x86_64-linux-gnu/12/include/stddef.h" 3 4
+
+# 214 "/usr/lib/gcc/x86_64-linux-gnu/12/include/stddef.h" 3 4
+typedef long unsigned int size_t;
+# 25 "/usr/include/alloca.h" 2 3 4
+
+
+
+
+
+
+
+extern void *alloca (size_t __size) __attribute__ ((__nothrow__ , __leaf__));
+
+
+
+
+
+
+# 106 "./mpconfigport.h" 2
+# 123 "./mpconfigport.h"
+
+# 123 "./mpconfigport.h"
+extern const struct _mp_obj_module_t mp_module_udsp;
+# 63 "/root/repo/py/mpconfig.h" 2
+# 717 "/root/repo/py/mpconfig.h"
+typedef float mp_float_t;
+# 28 "<stdin>" 2
+
+
+
+
+
+QCFG(BYTES_IN_LEN, (1))
+QCFG(BYTES_IN_HASH, (1))
+QCFG(INDEX, (0))
+
+Q()
+Q(*)
+Q(_)
+Q(/)
+
+Q(%#o)
+Q(%#x)
+
+
+
+
+Q({:#b})
+Q( )
+Q(\n)
+Q(maximum recursion depth exceeded)
+Q(<module>)
+Q(<lambda>)
+Q(<listcomp>)
+Q(<dictcomp>)
+Q(<setcomp>)
+Q(<genexpr>)
+Q(<string>)
+Q(<stdin>)
+Q(utf-8)
+
+
+
+
+
+Q(ARRAY)
+
+Q(ARRAY)
+
+Q(ArithmeticError)
+
+Q(ArithmeticError)
+
+Q(AssertionError)
+
+Q(AssertionError)
+
+Q(AssertionError)
+
+Q(AttributeError)
+
+Q(AttributeError)
+
+Q(BFINT16)
+
+Q(BFINT16)
+
+Q(BFINT32)
+
+Q(BFINT32)
+
+Q(BFINT8)
+
+Q(BFINT8)
+
+Q(BFUINT16)
+
+Q(BFUINT16)
+
+Q(BFUINT32)
+
+Q(BFUINT32)
+
+Q(BFUINT8)
+
+Q(BFUINT8)
+
+Q(BF_LEN)
+
+Q(BF_LEN)
+
+Q(BF_POS)
+
+Q(BF_POS)
+
+Q(BIG_ENDIAN)
+
+Q(BIG_ENDIAN)
+
+Q(BaseException)
+
+Q(BaseException)
+
+Q(BytesIO)
+
+Q(BytesIO)
+
+Q(DEBUG)
+
+Q(DEBUG)
+
+Q(EACCES)
+
+Q(EACCES)
+
+Q(EADDRINUSE)
+
+Q(EADDRINUSE)
+
+Q(EAGAIN)
+
+Q(EAGAIN)
+
+Q(EALREADY)
+
+Q(EALREADY)
+
+Q(EBADF)
+
+Q(EBADF)
+
+Q(ECONNABORTED)
+
+Q(ECONNABORTED)
+
+Q(ECONNREFUSED)
+
+Q(ECONNREFUSED)
+
+Q(ECONNRESET)
+
+Q(ECONNRESET)
+
+Q(EEXIST)
+
+Q(EEXIST)
+
+Q(EHOSTUNREACH)
+
+Q(EHOSTUNREACH)
+
+Q(EINPROGRESS)
+
+Q(EINPROGRESS)
+
+Q(EINVAL)
+
+Q(EINVAL)
+
+Q(EIO)
+
+Q(EIO)
+
+Q(EISDIR)
+
+Q(EISDIR)
+
+Q(EMSGSIZE)
+
+Q(EMSGSIZE)
+
+Q(ENETDOWN)
+
+Q(ENETDOWN)
+
+Q(ENOBUFS)
+
+Q(ENOBUFS)
+
+Q(ENODEV)
+
+Q(ENODEV)
+
+Q(ENOENT)
+
+Q(ENOENT)
+
+Q(ENOMEM)
+
+Q(ENOMEM)
+
+Q(ENOTCONN)
+
+Q(ENOTCONN)
+
+Q(EOFError)
+
+Q(EOFError)
+
+Q(EOPNOTSUPP)
+
+Q(EOPNOTSUPP)
+
+Q(EPERM)
+
+Q(EPERM)
+
+Q(ETIMEDOUT)
+
+Q(ETIMEDOUT)
+
+Q(Ellipsis)
+
+Q(Ellipsis)
+
+Q(Exception)
+
+Q(Exception)
+
+Q(FLOAT32)
+
+Q(FLOAT32)
+
+Q(FLOAT64)
+
+Q(FLOAT64)
+
+Q(GeneratorExit)
+
+Q(GeneratorExit)
+
+Q(INT)
+
+Q(INT)
+
+Q(INT16)
+
+Q(INT16)
+
+Q(INT32)
+
+Q(INT32)
+
+Q(INT64)
+
+Q(INT64)
+
+Q(INT8)
+
+Q(INT8)
+
+Q(ImportError)
+
+Q(ImportError)
+
+Q(IndentationError)
+
+Q(IndentationError)
+
+Q(IndexError)
+
+Q(IndexError)
+
+Q(KeyError)
+
+Q(KeyError)
+
+Q(KeyboardInterrupt)
+
+Q(KeyboardInterrupt)
+
+Q(LITTLE_ENDIAN)
+
+Q(LITTLE_ENDIAN)
+
+Q(LONG)
+
+Q(LONG)
+
+Q(LONGLONG)
+
+Q(LONGLONG)
+
+Q(LookupError)
+
+Q(LookupError)
+
+Q(MemoryError)
+
+Q(MemoryError)
+
+Q(NATIVE)
+
+Q(NATIVE)
+
+Q(NameError)
+
+Q(NameError)
+
+Q(NoneType)
+
+Q(NotImplementedError)
+
+Q(NotImplementedError)
+
+Q(OSError)
+
+Q(OSError)
+
+Q(OrderedDict)
+
+Q(OrderedDict)
+
+Q(OrderedDict)
+
+Q(OverflowError)
+
+Q(OverflowError)
+
+Q(PTR)
+
+Q(PTR)
+
+Q(RuntimeError)
+
+Q(RuntimeError)
+
+Q(SHORT)
+
+Q(SHORT)
+
+Q(StopIteration)
+
+Q(StopIteration)
+
+Q(StringIO)
+
+Q(StringIO)
+
+Q(Struct)
+
+Q(Struct)
+
+Q(SyntaxError)
+
+Q(SyntaxError)
+
+Q(SystemExit)
+
+Q(SystemExit)
+
+Q(TypeError)
+
+Q(TypeError)
+
+Q(UINT)
+
+Q(UINT)
+
+Q(UINT16)
+
+Q(UINT16)
+
+Q(UINT32)
+
+Q(UINT32)
+
+Q(UINT64)
+
+Q(UINT64)
+
+Q(UINT8)
+
+Q(UINT8)
+
+Q(ULONG)
+
+Q(ULONG)
+
+Q(ULONGLONG)
+
+Q(ULONGLONG)
+
+Q(USHORT)
+
+Q(USHORT)
+
+Q(VOID)
+
+Q(VOID)
+
+Q(ValueError)
+
+Q(ValueError)
+
+Q(ZeroDivisionError)
+
+Q(ZeroDivisionError)
+
+Q(_0x0a_)
+
+Q(__add__)
+
+Q(__bool__)
+
+Q(__build_class__)
+
+Q(__call__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__class__)
+
+Q(__contains__)
+
+Q(__contains__)
+
+Q(__contains__)
+
+Q(__delitem__)
+
+Q(__delitem__)
+
+Q(__dict__)
+
+Q(__enter__)
+
+Q(__enter__)
+
+Q(__eq__)
+
+Q(__eq__)
+
+Q(__exit__)
+
+Q(__exit__)
+
+Q(__file__)
+
+Q(__file__)
+
+Q(__file__)
+
+Q(__ge__)
+
+Q(__getattr__)
+
+Q(__getattr__)
+
+Q(__getitem__)
+
+Q(__getitem__)
+
+Q(__getitem__)
+
+Q(__getitem__)
+
+Q(__gt__)
+
+Q(__hash__)
+
+Q(__iadd__)
+
+Q(__import__)
+
+Q(__init__)
+
+Q(__init__)
+
+Q(__init__)
+
+Q(__int__)
+
+Q(__isub__)
+
+Q(__iter__)
+
+Q(__le__)
+
+Q(__len__)
+
+Q(__lt__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__main__)
+
+Q(__module__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__name__)
+
+Q(__new__)
+
+Q(__new__)
+
+Q(__new__)
+
+Q(__next__)
+
+Q(__next__)
+
+Q(__next__)
+
+Q(__next__)
+
+Q(__path__)
+
+Q(__path__)
+
+Q(__path__)
+
+Q(__qualname__)
+
+Q(__repl_print__)
+
+Q(__repl_print__)
+
+Q(__repr__)
+
+Q(__repr__)
+
+Q(__reversed__)
+
+Q(__setitem__)
+
+Q(__setitem__)
+
+Q(__str__)
+
+Q(__sub__)
+
+Q(__traceback__)
+
+Q(_brace_open__colon__hash_b_brace_close_)
+
+Q(_lt_dictcomp_gt_)
+
+Q(_lt_genexpr_gt_)
+
+Q(_lt_lambda_gt_)
+
+Q(_lt_listcomp_gt_)
+
+Q(_lt_module_gt_)
+
+Q(_lt_setcomp_gt_)
+
+Q(_lt_string_gt_)
+
+Q(_percent__hash_o)
+
+Q(_percent__hash_x)
+
+Q(_slash_)
+
+Q(_slash_)
+
+Q(_slash_)
+
+Q(_slash_)
+
+Q(_space_)
+
+Q(_star_)
+
+Q(_star_)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(_webrepl)
+
+Q(abs)
+
+Q(acos)
+
+Q(add)
+
+Q(add)
+
+Q(addressof)
+
+Q(addressof)
+
+Q(all)
+
+Q(any)
+
+Q(append)
+
+Q(append)
+
+Q(args)
+
+Q(array)
+
+Q(array)
+
+Q(array)
+
+Q(array)
+
+Q(asin)
+
+Q(atan)
+
+Q(atan2)
+
+Q(bin)
+
+Q(bool)
+
+Q(bool)
+
+Q(bound_method)
+
+Q(buffering)
+
+Q(builtins)
+
+Q(builtins)
+
+Q(bytearray)
+
+Q(bytearray)
+
+Q(bytearray_at)
+
+Q(bytearray_at)
+
+Q(bytecode)
+
+Q(bytes)
+
+Q(bytes)
+
+Q(bytes)
+
+Q(bytes_at)
+
+Q(bytes_at)
+
+Q(calcsize)
+
+Q(callable)
+
+Q(ceil)
+
+Q(chdir)
+
+Q(chdir)
+
+Q(chr)
+
+Q(classmethod)
+
+Q(classmethod)
+
+Q(clear)
+
+Q(clear)
+
+Q(clear)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(close)
+
+Q(closure)
+
+Q(closure)
+
+Q(collect)
+
+Q(compile)
+
+Q(compile)
+
+Q(complex)
+
+Q(complex)
+
+Q(const)
+
+Q(copy)
+
+Q(copy)
+
+Q(copy)
+
+Q(copy)
+
+Q(copysign)
+
+Q(cos)
+
+Q(count)
+
+Q(count)
+
+Q(count)
+
+Q(decode)
+
+Q(decode)
+
+Q(default)
+
+Q(degrees)
+
+Q(delattr)
+
+Q(deleter)
+
+Q(dict)
+
+Q(dict)
+
+Q(dict_view)
+
+Q(difference)
+
+Q(difference)
+
+Q(difference_update)
+
+Q(dir)
+
+Q(disable)
+
+Q(discard)
+
+Q(divmod)
+
+Q(doc)
+
+Q(dot)
+
+Q(e)
+
+Q(enable)
+
+Q(encode)
+
+Q(encoding)
+
+Q(end)
+
+Q(endswith)
+
+Q(enumerate)
+
+Q(enumerate)
+
+Q(errorcode)
+
+Q(eval)
+
+Q(exec)
+
+Q(exp)
+
+Q(extend)
+
+Q(extend)
+
+Q(fabs)
+
+Q(fft)
+
+Q(file)
+
+Q(filter)
+
+Q(filter)
+
+Q(find)
+
+Q(fir)
+
+Q(float)
+
+Q(float)
+
+Q(floor)
+
+Q(flush)
+
+Q(fmod)
+
+Q(format)
+
+Q(format)
+
+Q(frexp)
+
+Q(from_bytes)
+
+Q(fromkeys)
+
+Q(frozenset)
+
+Q(frozenset)
+
+Q(fsformat)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(function)
+
+Q(gc)
+
+Q(gc)
+
+Q(generator)
+
+Q(generator)
+
+Q(generator)
+
+Q(get)
+
+Q(getattr)
+
+Q(getcwd)
+
+Q(getfree)
+
+Q(getter)
+
+Q(getvalue)
+
+Q(globals)
+
+Q(group)
+
+Q(group)
+
+Q(groups)
+
+Q(groups)
+
+Q(hasattr)
+
+Q(hash)
+
+Q(heap_lock)
+
+Q(heap_unlock)
+
+Q(hex)
+
+Q(id)
+
+Q(ilistdir)
+
+Q(ilistdir)
+
+Q(im)
+
+Q(imag)
+
+Q(incremental)
+
+Q(index)
+
+Q(index)
+
+Q(index)
+
+Q(insert)
+
+Q(int)
+
+Q(int)
+
+Q(intersection)
+
+Q(intersection)
+
+Q(intersection_update)
+
+Q(inverse)
+
+Q(ioctl)
+
+Q(ioctl)
+
+Q(isalpha)
+
+Q(isdigit)
+
+Q(isdisjoint)
+
+Q(isdisjoint)
+
+Q(isenabled)
+
+Q(isfinite)
+
+Q(isinf)
+
+Q(isinstance)
+
+Q(islower)
+
+Q(isnan)
+
+Q(isspace)
+
+Q(issubclass)
+
+Q(issubset)
+
+Q(issubset)
+
+Q(issuperset)
+
+Q(issuperset)
+
+Q(isupper)
+
+Q(items)
+
+Q(iter)
+
+Q(iter_unpack)
+
+Q(iterable)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(iterator)
+
+Q(join)
+
+Q(key)
+
+Q(key)
+
+Q(keys)
+
+Q(keys)
+
+Q(ldexp)
+
+Q(len)
+
+Q(list)
+
+Q(list)
+
+Q(little)
+
+Q(little)
+
+Q(little)
+
+Q(locals)
+
+Q(log)
+
+Q(lower)
+
+Q(lstrip)
+
+Q(magnitude)
+
+Q(map)
+
+Q(map)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match)
+
+Q(match_into)
+
+Q(match_into)
+
+Q(match_into)
+
+Q(match_into)
+
+Q(math)
+
+Q(math)
+
+Q(max)
+
+Q(mean)
+
+Q(mem_alloc)
+
+Q(mem_free)
+
+Q(memoryview)
+
+Q(memoryview)
+
+Q(micropython)
+
+Q(micropython)
+
+Q(micropython)
+
+Q(min)
+
+Q(minmax)
+
+Q(mkdir)
+
+Q(mkfs)
+
+Q(mode)
+
+Q(modf)
+
+Q(module)
+
+Q(mount)
+
+Q(mount)
+
+Q(moving_average)
+
+Q(mul)
+
+Q(namedtuple)
+
+Q(next)
+
+Q(object)
+
+Q(object)
+
+Q(oct)
+
+Q(open)
+
+Q(open)
+
+Q(open)
+
+Q(opt_level)
+
+Q(ord)
+
+Q(pack)
+
+Q(pack)
+
+Q(pack_into)
+
+Q(pack_into)
+
+Q(password)
+
+Q(password)
+
+Q(pend_throw)
+
+Q(pi)
+
+Q(pop)
+
+Q(pop)
+
+Q(pop)
+
+Q(popitem)
+
+Q(pow)
+
+Q(pow)
+
+Q(print)
+
+Q(profile)
+
+Q(profile_data)
+
+Q(profile_dump)
+
+Q(property)
+
+Q(property)
+
+Q(r)
+
+Q(radians)
+
+Q(range)
+
+Q(range)
+
+Q(range)
+
+Q(rb)
+
+Q(rb)
+
+Q(re)
+
+Q(read)
+
+Q(read)
+
+Q(read)
+
+Q(read)
+
+Q(read)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readinto)
+
+Q(readline)
+
+Q(readline)
+
+Q(readline)
+
+Q(readonly)
+
+Q(real)
+
+Q(remove)
+
+Q(remove)
+
+Q(remove)
+
+Q(rename)
+
+Q(replace)
+
+Q(repr)
+
+Q(reverse)
+
+Q(reverse)
+
+Q(reversed)
+
+Q(reversed)
+
+Q(rfind)
+
+Q(rindex)
+
+Q(rmdir)
+
+Q(rms)
+
+Q(round)
+
+Q(rsplit)
+
+Q(rstrip)
+
+Q(search)
+
+Q(search)
+
+Q(search)
+
+Q(search)
+
+Q(search_into)
+
+Q(search_into)
+
+Q(search_into)
+
+Q(search_into)
+
+Q(seek)
+
+Q(send)
+
+Q(send)
+
+Q(sep)
+
+Q(set)
+
+Q(set)
+
+Q(setattr)
+
+Q(setblocking)
+
+Q(setblocking)
+
+Q(setdefault)
+
+Q(setter)
+
+Q(sin)
+
+Q(size)
+
+Q(sizeof)
+
+Q(sizeof)
+
+Q(slice)
+
+Q(slice)
+
+Q(sort)
+
+Q(sorted)
+
+Q(split)
+
+Q(split)
+
+Q(split)
+
+Q(sqrt)
+
+Q(start)
+
+Q(start)
+
+Q(startswith)
+
+Q(stat)
+
+Q(stat)
+
+Q(staticmethod)
+
+Q(staticmethod)
+
+Q(stats)
+
+Q(statvfs)
+
+Q(step)
+
+Q(stop)
+
+Q(str)
+
+Q(str)
+
+Q(str)
+
+Q(str)
+
+Q(strip)
+
+Q(struct)
+
+Q(struct)
+
+Q(struct)
+
+Q(struct)
+
+Q(sub)
+
+Q(sub)
+
+Q(sub)
+
+Q(sub)
+
+Q(sub)
+
+Q(sum)
+
+Q(sum)
+
+Q(super)
+
+Q(super)
+
+Q(super)
+
+Q(symmetric_difference)
+
+Q(symmetric_difference)
+
+Q(symmetric_difference_update)
+
+Q(tan)
+
+Q(threshold)
+
+Q(threshold)
+
+Q(throw)
+
+Q(throw)
+
+Q(to_bytes)
+
+Q(to_dict)
+
+Q(to_dict)
+
+Q(to_float)
+
+Q(to_int16)
+
+Q(to_tuple)
+
+Q(to_tuple)
+
+Q(trunc)
+
+Q(tuple)
+
+Q(tuple)
+
+Q(type)
+
+Q(type)
+
+Q(ucollections)
+
+Q(ucollections)
+
+Q(uctypes)
+
+Q(uctypes)
+
+Q(uctypes)
+
+Q(udsp)
+
+Q(udsp)
+
+Q(uerrno)
+
+Q(uerrno)
+
+Q(uio)
+
+Q(uio)
+
+Q(umount)
+
+Q(union)
+
+Q(union)
+
+Q(unpack)
+
+Q(unpack)
+
+Q(unpack_from)
+
+Q(unpack_from)
+
+Q(update)
+
+Q(update)
+
+Q(upper)
+
+Q(ure)
+
+Q(ure)
+
+Q(ure)
+
+Q(ure)
+
+Q(ure)
+
+Q(ustruct)
+
+Q(ustruct)
+
+Q(utf_hyphen_8)
+
+Q(utf_hyphen_8)
+
+Q(uwebsocket)
+
+Q(uwebsocket)
+
+Q(uwebsocket)
+
+Q(value)
+
+Q(values)
+
+Q(wb)
+
+Q(wb)
+
+Q(wb)
+
+Q(websocket)
+
+Q(websocket)
+
+Q(websocket)
+
+Q(websocket)
+
+Q(write)
+
+Q(write)
+
+Q(write)
+
+Q(write)
+
+Q(write)
+
+Q(zip)
+
+Q(zip)
+
+Q(zip)
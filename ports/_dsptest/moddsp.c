@@ -0,0 +1,642 @@
+/*
+ * Copyright (c) 2020, Pycom Limited.
+ *
+ * This software is licensed under the GNU GPL version 3 or any
+ * later version, with permitted additional terms. For more information
+ * see the Pycom Licence v1.0 document supplied with this file, or
+ * available at https://www.pycom.io/opensource/licensing
+ */
+
+/*
+ * Kernels over sample blocks held in array('h'), array('H') and array('f')
+ * objects (or memoryviews of them), so the per-sample work of mean, RMS,
+ * filtering and FFT runs in C instead of bytecode. The functions take their
+ * output buffer first and never allocate, int16 results saturate. The int16
+ * multiply-accumulate loops (dot, RMS, FIR) run on the MAC16 accumulator.
+ */
+
+#include <stdint.h>
+#include <math.h>
+
+#include "py/runtime.h"
+#include "py/binary.h"
+#include "py/smallint.h"
+#include "py/objtuple.h"
+#include <xtensa/config/core-isa.h>
+
+/******************************************************************************
+ DEFINE CONSTANTS
+ ******************************************************************************/
+// the MAC16 accumulator has 40 bits, 256 full scale int16 products fit in it
+#define DSP_MAC16_CHUNK                         (256)
+
+#define DSP_PI                                  MICROPY_FLOAT_CONST(3.14159265358979323846)
+
+/******************************************************************************
+ DEFINE TYPES
+ ******************************************************************************/
+typedef struct {
+    void        *buf;
+    size_t      len;            // in samples
+    char        typecode;       // 'h', 'H' or 'f'
+} dsp_buf_t;
+
+typedef enum {
+    E_DSP_OP_ADD = 0,
+    E_DSP_OP_SUB,
+    E_DSP_OP_MUL
+} dsp_op_t;
+
+/******************************************************************************
+ DEFINE PRIVATE FUNCTIONS
+ ******************************************************************************/
+STATIC void dsp_get_buf (mp_obj_t obj, dsp_buf_t *b, mp_uint_t flags, const char *typecodes) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, flags);
+    for (; *typecodes != '\0'; typecodes++) {
+        if (bufinfo.typecode == *typecodes) {
+            b->buf = bufinfo.buf;
+            b->len = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL);
+            b->typecode = bufinfo.typecode;
+            return;
+        }
+    }
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "unsupported array type"));
+}
+
+STATIC void dsp_check_len (const dsp_buf_t *a, size_t len) {
+    if (a->len != len) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffer lengths differ"));
+    }
+}
+
+STATIC inline int16_t dsp_sat16 (int32_t v) {
+    return (v > INT16_MAX) ? INT16_MAX : ((v < INT16_MIN) ? INT16_MIN : v);
+}
+
+STATIC int32_t dsp_round (mp_float_t v, int32_t min, int32_t max) {
+    if (v >= max) {
+        return max;
+    } else if (v <= min) {
+        return min;
+    }
+    return (int32_t)(v + ((v >= 0) ? MICROPY_FLOAT_CONST(0.5) : MICROPY_FLOAT_CONST(-0.5)));
+}
+
+STATIC mp_float_t dsp_load (const dsp_buf_t *b, size_t i) {
+    switch (b->typecode) {
+    case 'h':
+        return ((int16_t *)b->buf)[i];
+    case 'H':
+        return ((uint16_t *)b->buf)[i];
+    default:
+        return ((float *)b->buf)[i];
+    }
+}
+
+STATIC void dsp_store (dsp_buf_t *b, size_t i, mp_float_t v) {
+    switch (b->typecode) {
+    case 'h':
+        ((int16_t *)b->buf)[i] = dsp_round(v, INT16_MIN, INT16_MAX);
+        break;
+    case 'H':
+        ((uint16_t *)b->buf)[i] = dsp_round(v, 0, UINT16_MAX);
+        break;
+    default:
+        ((float *)b->buf)[i] = v;
+        break;
+    }
+}
+
+STATIC mp_obj_t dsp_new_int (int64_t v) {
+    if (v >= MP_SMALL_INT_MIN && v <= MP_SMALL_INT_MAX) {
+        return MP_OBJ_NEW_SMALL_INT(v);
+    }
+    return mp_obj_new_int_from_ll(v);
+}
+
+// sum of a[i] * b[i * b_step], b_step is -1 for a convolution
+STATIC int64_t dsp_mac_s16 (const int16_t *a, const int16_t *b, int b_step, size_t n) {
+    int64_t total = 0;
+#if XCHAL_HAVE_MAC16
+    while (n > 0) {
+        size_t chunk = (n > DSP_MAC16_CHUNK) ? DSP_MAC16_CHUNK : n;
+        uint32_t lo, hi;
+        n -= chunk;
+        __asm__ volatile ("wsr %0, acclo\n\twsr %0, acchi" : : "r"(0));
+        for (; chunk > 0; chunk--) {
+            __asm__ volatile ("mula.aa.ll %0, %1" : : "r"((int32_t)*a), "r"((int32_t)*b));
+            a++;
+            b += b_step;
+        }
+        __asm__ volatile ("rsr %0, acclo\n\trsr %1, acchi" : "=r"(lo), "=r"(hi));
+        // acchi holds bits 39..32
+        total += (int64_t)(((uint64_t)(int64_t)(int8_t)hi << 32) | lo);
+    }
+#else
+    for (; n > 0; n--) {
+        total += (int32_t)*a * *b;
+        a++;
+        b += b_step;
+    }
+#endif
+    return total;
+}
+
+STATIC mp_float_t dsp_mac_f32 (const float *a, const float *b, int b_step, size_t n) {
+    mp_float_t total = 0;
+    for (; n > 0; n--) {
+        total += *a * *b;
+        a++;
+        b += b_step;
+    }
+    return total;
+}
+
+STATIC mp_obj_t dsp_elementwise (mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in, dsp_op_t op) {
+    dsp_buf_t dst, a, b;
+    dsp_get_buf(dst_in, &dst, MP_BUFFER_WRITE, "hf");
+    dsp_get_buf(a_in, &a, MP_BUFFER_READ, "hf");
+    if (a.typecode != dst.typecode) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "array types differ"));
+    }
+    dsp_check_len(&a, dst.len);
+
+    bool scalar = mp_obj_is_integer(b_in) || mp_obj_is_float(b_in);
+    if (!scalar) {
+        dsp_get_buf(b_in, &b, MP_BUFFER_READ, dst.typecode == 'h' ? "h" : "f");
+        dsp_check_len(&b, dst.len);
+    }
+
+    if (dst.typecode == 'h') {
+        int16_t *d = dst.buf;
+        const int16_t *x = a.buf;
+        const int16_t *y = b.buf;
+        if (scalar && op == E_DSP_OP_MUL) {
+            // a gain, int16 * int16 buffers are Q15 products
+            mp_float_t k = mp_obj_get_float(b_in);
+            for (size_t i = 0; i < dst.len; i++) {
+                d[i] = dsp_round(x[i] * k, INT16_MIN, INT16_MAX);
+            }
+        } else if (scalar) {
+            int32_t k = mp_obj_get_int(b_in);
+            if (op == E_DSP_OP_SUB) {
+                k = -k;
+            }
+            for (size_t i = 0; i < dst.len; i++) {
+                d[i] = dsp_sat16(x[i] + k);
+            }
+        } else {
+            for (size_t i = 0; i < dst.len; i++) {
+                switch (op) {
+                case E_DSP_OP_ADD:
+                    d[i] = dsp_sat16((int32_t)x[i] + y[i]);
+                    break;
+                case E_DSP_OP_SUB:
+                    d[i] = dsp_sat16((int32_t)x[i] - y[i]);
+                    break;
+                default:
+                    d[i] = dsp_sat16(((int32_t)x[i] * y[i] + (1 << 14)) >> 15);
+                    break;
+                }
+            }
+        }
+    } else {
+        float *d = dst.buf;
+        const float *x = a.buf;
+        const float *y = b.buf;
+        float k = scalar ? mp_obj_get_float(b_in) : 0;
+        for (size_t i = 0; i < dst.len; i++) {
+            float v = scalar ? k : y[i];
+            switch (op) {
+            case E_DSP_OP_ADD:
+                d[i] = x[i] + v;
+                break;
+            case E_DSP_OP_SUB:
+                d[i] = x[i] - v;
+                break;
+            default:
+                d[i] = x[i] * v;
+                break;
+            }
+        }
+    }
+    return mp_const_none;
+}
+
+STATIC void dsp_fft_f32 (float *re, float *im, size_t n, bool inverse) {
+    // bit reversed order first, then the butterflies in place
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t half = len >> 1;
+        // the twiddle factors come from a recurrence, two trig calls per stage
+        mp_float_t theta = (inverse ? 2 : -2) * DSP_PI / len;
+        mp_float_t s = MICROPY_FLOAT_C_FUN(sin)(theta / 2);
+        mp_float_t wpr = -2 * s * s;
+        mp_float_t wpi = MICROPY_FLOAT_C_FUN(sin)(theta);
+        mp_float_t wr = 1, wi = 0;
+        for (size_t k = 0; k < half; k++) {
+            for (size_t i = k; i < n; i += len) {
+                size_t j = i + half;
+                float tr = wr * re[j] - wi * im[j];
+                float ti = wr * im[j] + wi * re[j];
+                re[j] = re[i] - tr;
+                im[j] = im[i] - ti;
+                re[i] += tr;
+                im[i] += ti;
+            }
+            mp_float_t t = wr;
+            wr += wr * wpr - wi * wpi;
+            wi += wi * wpr + t * wpi;
+        }
+    }
+    if (inverse) {
+        float scale = MICROPY_FLOAT_CONST(1.0) / n;
+        for (size_t i = 0; i < n; i++) {
+            re[i] *= scale;
+            im[i] *= scale;
+        }
+    }
+}
+
+/******************************************************************************
+ DEFINE MODULE FUNCTIONS
+ ******************************************************************************/
+/// \function add(dst, a, b)
+/// dst = a + b, b is an array of the same type or a number
+STATIC mp_obj_t dsp_add (mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in) {
+    return dsp_elementwise(dst_in, a_in, b_in, E_DSP_OP_ADD);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(dsp_add_obj, dsp_add);
+
+/// \function sub(dst, a, b)
+STATIC mp_obj_t dsp_sub (mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in) {
+    return dsp_elementwise(dst_in, a_in, b_in, E_DSP_OP_SUB);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(dsp_sub_obj, dsp_sub);
+
+/// \function mul(dst, a, b)
+/// int16 arrays multiply as Q15 (a window), a number is a gain
+STATIC mp_obj_t dsp_mul (mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in) {
+    return dsp_elementwise(dst_in, a_in, b_in, E_DSP_OP_MUL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(dsp_mul_obj, dsp_mul);
+
+/// \function sum(buf)
+STATIC mp_obj_t dsp_sum (mp_obj_t buf_in) {
+    dsp_buf_t b;
+    dsp_get_buf(buf_in, &b, MP_BUFFER_READ, "hHf");
+    if (b.typecode == 'f') {
+        mp_float_t total = 0;
+        for (size_t i = 0; i < b.len; i++) {
+            total += ((float *)b.buf)[i];
+        }
+        return mp_obj_new_float(total);
+    }
+    int64_t total = 0;
+    if (b.typecode == 'h') {
+        for (size_t i = 0; i < b.len; i++) {
+            total += ((int16_t *)b.buf)[i];
+        }
+    } else {
+        for (size_t i = 0; i < b.len; i++) {
+            total += ((uint16_t *)b.buf)[i];
+        }
+    }
+    return dsp_new_int(total);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(dsp_sum_obj, dsp_sum);
+
+/// \function mean(buf)
+STATIC mp_obj_t dsp_mean (mp_obj_t buf_in) {
+    dsp_buf_t b;
+    dsp_get_buf(buf_in, &b, MP_BUFFER_READ, "hHf");
+    if (b.len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "empty buffer"));
+    }
+    return mp_obj_new_float(mp_obj_get_float(dsp_sum(buf_in)) / b.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(dsp_mean_obj, dsp_mean);
+
+/// \function rms(buf)
+STATIC mp_obj_t dsp_rms (mp_obj_t buf_in) {
+    dsp_buf_t b;
+    dsp_get_buf(buf_in, &b, MP_BUFFER_READ, "hHf");
+    if (b.len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "empty buffer"));
+    }
+    mp_float_t squares;
+    if (b.typecode == 'h') {
+        squares = dsp_mac_s16(b.buf, b.buf, 1, b.len);
+    } else if (b.typecode == 'H') {
+        uint64_t total = 0;
+        for (size_t i = 0; i < b.len; i++) {
+            uint32_t v = ((uint16_t *)b.buf)[i];
+            total += v * v;
+        }
+        squares = total;
+    } else {
+        squares = dsp_mac_f32(b.buf, b.buf, 1, b.len);
+    }
+    return mp_obj_new_float(MICROPY_FLOAT_C_FUN(sqrt)(squares / b.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(dsp_rms_obj, dsp_rms);
+
+/// \function minmax(buf)
+/// Returns (min, max)
+STATIC mp_obj_t dsp_minmax (mp_obj_t buf_in) {
+    dsp_buf_t b;
+    dsp_get_buf(buf_in, &b, MP_BUFFER_READ, "hHf");
+    if (b.len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "empty buffer"));
+    }
+    mp_obj_t tuple[2];
+    if (b.typecode == 'f') {
+        const float *x = b.buf;
+        float lo = x[0], hi = x[0];
+        for (size_t i = 1; i < b.len; i++) {
+            if (x[i] < lo) {
+                lo = x[i];
+            } else if (x[i] > hi) {
+                hi = x[i];
+            }
+        }
+        tuple[0] = mp_obj_new_float(lo);
+        tuple[1] = mp_obj_new_float(hi);
+    } else {
+        int32_t lo = dsp_load(&b, 0), hi = lo;
+        for (size_t i = 1; i < b.len; i++) {
+            int32_t v = (b.typecode == 'h') ? ((int16_t *)b.buf)[i] : ((uint16_t *)b.buf)[i];
+            if (v < lo) {
+                lo = v;
+            } else if (v > hi) {
+                hi = v;
+            }
+        }
+        tuple[0] = MP_OBJ_NEW_SMALL_INT(lo);
+        tuple[1] = MP_OBJ_NEW_SMALL_INT(hi);
+    }
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(dsp_minmax_obj, dsp_minmax);
+
+/// \function threshold(buf, level)
+/// Returns the number of samples above level
+STATIC mp_obj_t dsp_threshold (mp_obj_t buf_in, mp_obj_t level_in) {
+    dsp_buf_t b;
+    dsp_get_buf(buf_in, &b, MP_BUFFER_READ, "hHf");
+    size_t count = 0;
+    if (b.typecode == 'f') {
+        float level = mp_obj_get_float(level_in);
+        for (size_t i = 0; i < b.len; i++) {
+            count += ((float *)b.buf)[i] > level;
+        }
+    } else {
+        mp_int_t level = mp_obj_get_int(level_in);
+        for (size_t i = 0; i < b.len; i++) {
+            int32_t v = (b.typecode == 'h') ? ((int16_t *)b.buf)[i] : ((uint16_t *)b.buf)[i];
+            count += v > level;
+        }
+    }
+    return mp_obj_new_int_from_uint(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(dsp_threshold_obj, dsp_threshold);
+
+/// \function dot(a, b)
+STATIC mp_obj_t dsp_dot (mp_obj_t a_in, mp_obj_t b_in) {
+    dsp_buf_t a, b;
+    dsp_get_buf(a_in, &a, MP_BUFFER_READ, "hf");
+    dsp_get_buf(b_in, &b, MP_BUFFER_READ, a.typecode == 'h' ? "h" : "f");
+    dsp_check_len(&b, a.len);
+    if (a.typecode == 'h') {
+        return dsp_new_int(dsp_mac_s16(a.buf, b.buf, 1, a.len));
+    }
+    return mp_obj_new_float(dsp_mac_f32(a.buf, b.buf, 1, a.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(dsp_dot_obj, dsp_dot);
+
+/// \function moving_average(dst, src, n)
+/// dst[i] is the mean of src[i:i + n], dst holds len(src) - n + 1 samples
+STATIC mp_obj_t dsp_moving_average (mp_obj_t dst_in, mp_obj_t src_in, mp_obj_t n_in) {
+    dsp_buf_t dst, src;
+    dsp_get_buf(src_in, &src, MP_BUFFER_READ, "hHf");
+    dsp_get_buf(dst_in, &dst, MP_BUFFER_WRITE, "hHf");
+    mp_int_t n = mp_obj_get_int(n_in);
+    if (n < 1 || (size_t)n > src.len) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid window"));
+    }
+    dsp_check_len(&dst, src.len - n + 1);
+
+    // a running sum, exact for the integer types
+    if (src.typecode == 'f') {
+        mp_float_t total = 0;
+        for (size_t i = 0; i < src.len; i++) {
+            total += ((float *)src.buf)[i];
+            if (i + 1 >= (size_t)n) {
+                dsp_store(&dst, i + 1 - n, total / n);
+                total -= ((float *)src.buf)[i + 1 - n];
+            }
+        }
+    } else {
+        int64_t total = 0;
+        for (size_t i = 0; i < src.len; i++) {
+            total += dsp_load(&src, i);
+            if (i + 1 >= (size_t)n) {
+                dsp_store(&dst, i + 1 - n, (mp_float_t)total / n);
+                total -= dsp_load(&src, i + 1 - n);
+            }
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(dsp_moving_average_obj, dsp_moving_average);
+
+/// \function fir(dst, src, taps[, history])
+/// int16 taps are Q15. history holds the len(taps) - 1 samples before src (zeros
+/// without it) and is updated with the end of src, to filter a stream block by block.
+STATIC mp_obj_t dsp_fir (size_t n_args, const mp_obj_t *args) {
+    dsp_buf_t dst, src, taps, hist;
+    dsp_get_buf(args[1], &src, MP_BUFFER_READ, "hf");
+    const char *typecode = (src.typecode == 'h') ? "h" : "f";
+    dsp_get_buf(args[0], &dst, MP_BUFFER_WRITE, typecode);
+    dsp_get_buf(args[2], &taps, MP_BUFFER_READ, typecode);
+    dsp_check_len(&dst, src.len);
+    if (taps.len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "no taps"));
+    }
+    size_t h_len = taps.len - 1;
+    hist.buf = NULL;
+    if (n_args > 3 && args[3] != mp_const_none) {
+        dsp_get_buf(args[3], &hist, MP_BUFFER_WRITE, typecode);
+        dsp_check_len(&hist, h_len);
+    }
+    if (dst.buf == src.buf) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "dst can't be src"));
+    }
+
+    size_t n = src.len;
+    if (src.typecode == 'h') {
+        int16_t *d = dst.buf;
+        const int16_t *x = src.buf;
+        const int16_t *h = taps.buf;
+        const int16_t *prev = hist.buf;
+        for (size_t i = 0; i < n; i++) {
+            // taps[k] * x[i - k], the ones before src come from the history
+            size_t k_src = (i < h_len) ? i + 1 : taps.len;
+            int64_t acc = dsp_mac_s16(h, &x[i], -1, k_src);
+            if (prev != NULL && k_src < taps.len) {
+                acc += dsp_mac_s16(&h[k_src], &prev[h_len - 1], -1, taps.len - k_src);
+            }
+            d[i] = dsp_sat16((acc + (1 << 14)) >> 15);
+        }
+        if (prev != NULL) {
+            int16_t *p = hist.buf;
+            for (size_t j = 0; j < h_len; j++) {
+                // the last h_len samples of history + src
+                size_t pos = n + j;
+                p[j] = (pos < h_len) ? p[pos] : x[pos - h_len];
+            }
+        }
+    } else {
+        float *d = dst.buf;
+        const float *x = src.buf;
+        const float *h = taps.buf;
+        const float *prev = hist.buf;
+        for (size_t i = 0; i < n; i++) {
+            size_t k_src = (i < h_len) ? i + 1 : taps.len;
+            mp_float_t acc = dsp_mac_f32(h, &x[i], -1, k_src);
+            if (prev != NULL && k_src < taps.len) {
+                acc += dsp_mac_f32(&h[k_src], &prev[h_len - 1], -1, taps.len - k_src);
+            }
+            d[i] = acc;
+        }
+        if (prev != NULL) {
+            float *p = hist.buf;
+            for (size_t j = 0; j < h_len; j++) {
+                size_t pos = n + j;
+                p[j] = (pos < h_len) ? p[pos] : x[pos - h_len];
+            }
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(dsp_fir_obj, 3, 4, dsp_fir);
+
+/// \function fft(re, im, inverse=False)
+/// In place on two array('f') of the same power of 2 length, the inverse is scaled by 1/n
+STATIC mp_obj_t dsp_fft (size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_re,           MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_im,           MP_ARG_REQUIRED | MP_ARG_OBJ, },
+        { MP_QSTR_inverse,      MP_ARG_BOOL,                  {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    dsp_buf_t re, im;
+    dsp_get_buf(args[0].u_obj, &re, MP_BUFFER_RW, "f");
+    dsp_get_buf(args[1].u_obj, &im, MP_BUFFER_RW, "f");
+    dsp_check_len(&im, re.len);
+    if (re.len == 0 || (re.len & (re.len - 1)) != 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "length must be a power of 2"));
+    }
+    dsp_fft_f32(re.buf, im.buf, re.len, args[2].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(dsp_fft_obj, 2, dsp_fft);
+
+/// \function magnitude(dst, re, im)
+/// dst = sqrt(re * re + im * im), the spectrum after fft()
+STATIC mp_obj_t dsp_magnitude (mp_obj_t dst_in, mp_obj_t re_in, mp_obj_t im_in) {
+    dsp_buf_t dst, re, im;
+    dsp_get_buf(dst_in, &dst, MP_BUFFER_WRITE, "f");
+    dsp_get_buf(re_in, &re, MP_BUFFER_READ, "f");
+    dsp_get_buf(im_in, &im, MP_BUFFER_READ, "f");
+    dsp_check_len(&re, dst.len);
+    dsp_check_len(&im, dst.len);
+    float *d = dst.buf;
+    const float *r = re.buf;
+    const float *i = im.buf;
+    for (size_t k = 0; k < dst.len; k++) {
+        d[k] = MICROPY_FLOAT_C_FUN(sqrt)(r[k] * r[k] + i[k] * i[k]);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(dsp_magnitude_obj, dsp_magnitude);
+
+/// \function to_float(dst, src, scale=1.0)
+/// int16 or uint16 samples to float32, times scale
+STATIC mp_obj_t dsp_to_float (size_t n_args, const mp_obj_t *args) {
+    dsp_buf_t dst, src;
+    dsp_get_buf(args[0], &dst, MP_BUFFER_WRITE, "f");
+    dsp_get_buf(args[1], &src, MP_BUFFER_READ, "hH");
+    dsp_check_len(&src, dst.len);
+    float scale = (n_args > 2) ? mp_obj_get_float(args[2]) : 1;
+    float *d = dst.buf;
+    if (src.typecode == 'h') {
+        for (size_t i = 0; i < dst.len; i++) {
+            d[i] = ((int16_t *)src.buf)[i] * scale;
+        }
+    } else {
+        for (size_t i = 0; i < dst.len; i++) {
+            d[i] = ((uint16_t *)src.buf)[i] * scale;
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(dsp_to_float_obj, 2, 3, dsp_to_float);
+
+/// \function to_int16(dst, src, scale=1.0)
+/// float32 samples times scale to int16, rounded and saturated
+STATIC mp_obj_t dsp_to_int16 (size_t n_args, const mp_obj_t *args) {
+    dsp_buf_t dst, src;
+    dsp_get_buf(args[0], &dst, MP_BUFFER_WRITE, "h");
+    dsp_get_buf(args[1], &src, MP_BUFFER_READ, "f");
+    dsp_check_len(&src, dst.len);
+    float scale = (n_args > 2) ? mp_obj_get_float(args[2]) : 1;
+    int16_t *d = dst.buf;
+    for (size_t i = 0; i < dst.len; i++) {
+        d[i] = dsp_round(((float *)src.buf)[i] * scale, INT16_MIN, INT16_MAX);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(dsp_to_int16_obj, 2, 3, dsp_to_int16);
+
+STATIC const mp_map_elem_t dsp_module_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__),            MP_OBJ_NEW_QSTR(MP_QSTR_udsp) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_add),                 (mp_obj_t)&dsp_add_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sub),                 (mp_obj_t)&dsp_sub_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_mul),                 (mp_obj_t)&dsp_mul_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sum),                 (mp_obj_t)&dsp_sum_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_mean),                (mp_obj_t)&dsp_mean_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rms),                 (mp_obj_t)&dsp_rms_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_minmax),              (mp_obj_t)&dsp_minmax_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_threshold),           (mp_obj_t)&dsp_threshold_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dot),                 (mp_obj_t)&dsp_dot_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_moving_average),      (mp_obj_t)&dsp_moving_average_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fir),                 (mp_obj_t)&dsp_fir_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fft),                 (mp_obj_t)&dsp_fft_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_magnitude),           (mp_obj_t)&dsp_magnitude_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_to_float),            (mp_obj_t)&dsp_to_float_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_to_int16),            (mp_obj_t)&dsp_to_int16_obj },
+};
+STATIC MP_DEFINE_CONST_DICT(dsp_module_globals, dsp_module_globals_table);
+
+const mp_obj_module_t mp_module_udsp = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&dsp_module_globals,
+};
@@ -0,0 +1 @@
+#define XCHAL_HAVE_MAC16 0
@@ -0,0 +1,4 @@
+// This file was generated by py/makeversionhdr.py
+#define MICROPY_GIT_TAG "c0ca850-dirty"
+#define MICROPY_GIT_HASH "c0ca850-dirty"
+#define MICROPY_BUILD_DATE "2026-10-14"
@@ -0,0 +1 @@
+// qstrs specific to this port
@@ -70,6 +70,26 @@ const byte *mp_decode_uint_skip(const byte *ptr) {
     return ptr;
 }
 
+// name and source file of the function whose bytecode is given
+void mp_bytecode_get_names(const byte *code, qstr *name, qstr *file) {
+    if (code == NULL) {
+        *name = MP_QSTR_;
+        *file = MP_QSTR_;
+        return;
+    }
+    code = mp_decode_uint_skip(code); // skip n_state
+    code = mp_decode_uint_skip(code); // skip n_exc_stack
+    code += 4; // skip scope_params, n_pos_args, n_kwonly_args, n_def_pos_args
+    code = mp_decode_uint_skip(code); // skip code_info_size
+    #if MICROPY_PERSISTENT_CODE
+    *name = code[0] | (code[1] << 8);
+    *file = code[2] | (code[3] << 8);
+    #else
+    *name = mp_decode_uint_value(code);
+    *file = mp_decode_uint_value(mp_decode_uint_skip(code));
+    #endif
+}
+
 STATIC NORETURN void fun_pos_args_mismatch(mp_obj_fun_bc_t *f, size_t expected, size_t given) {
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE
     // generic message, used also for other argument issues
@@ -416,4 +436,25 @@ uint mp_opcode_format(const byte *ip, size_t *opcode_size, bool count_var_uint)
     return f;
 }
 
+size_t mp_bytecode_count_store_name(const byte *ip) {
+    ip = mp_decode_uint_skip(ip); // skip n_state
+    ip = mp_decode_uint_skip(ip); // skip n_exc_stack
+    ip += 4; // skip scope_flags, n_pos_args, n_kwonly_args, n_def_pos_args
+    ip += mp_decode_uint_value(ip); // skip code info
+    while (*ip++ != 255) { // skip closed over variables
+    }
+
+    // module code can't return before its end
+    size_t n = 0;
+    while (*ip != MP_BC_RETURN_VALUE) {
+        size_t sz;
+        if (*ip == MP_BC_STORE_NAME) {
+            n++;
+        }
+        mp_opcode_format(ip, &sz, true);
+        ip += sz;
+    }
+    return n;
+}
+
 #endif // MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
@@ -93,6 +93,7 @@ typedef struct _mp_code_state_t {
 mp_uint_t mp_decode_uint(const byte **ptr);
 mp_uint_t mp_decode_uint_value(const byte *ptr);
 const byte *mp_decode_uint_skip(const byte *ptr);
+void mp_bytecode_get_names(const byte *code, qstr *name, qstr *file);
 
 mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc);
 mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t func, size_t n_args, size_t n_kw, const mp_obj_t *args);
@@ -116,6 +117,8 @@ const byte *mp_bytecode_print_str(const byte *ip);
 #define MP_OPCODE_OFFSET (3)
 
 uint mp_opcode_format(const byte *ip, size_t *opcode_size, bool count_var_uint);
+// number of STORE_NAME in the module level bytecode given, names stored twice counted twice
+size_t mp_bytecode_count_store_name(const byte *ip);
 
 #endif
 
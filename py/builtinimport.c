@@ -35,6 +35,7 @@
 #include "py/runtime.h"
 #include "py/builtin.h"
 #include "py/frozenmod.h"
+#include "py/bc.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -155,6 +156,14 @@ STATIC void do_execute_raw_code(mp_obj_t module_obj, mp_raw_code_t *raw_code) {
     // execute the module in its context
     mp_obj_dict_t *mod_globals = mp_obj_module_get_globals(module_obj);
 
+    #if MICROPY_PERSISTENT_CODE_LOAD
+    // size the globals for all the names the module defines, the code may be in
+    // ROM but growing the dict one rehash at a time would still churn the heap
+    if (raw_code->kind == MP_CODE_BYTECODE) {
+        mp_map_reserve(&mod_globals->map, mod_globals->map.used + mp_bytecode_count_store_name(raw_code->fun_data));
+    }
+    #endif
+
     // save context
     mp_obj_dict_t *volatile old_globals = mp_globals_get();
     mp_obj_dict_t *volatile old_locals = mp_locals_get();
@@ -221,6 +230,18 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     }
     #endif
 
+    // If we cache compiled scripts then execute the cached code, compiling
+    // the file only if it changed since it was cached.
+    #if MICROPY_PERSISTENT_CODE_CACHE
+    {
+        #if MICROPY_PY___FILE__
+        mp_store_attr(module_obj, MP_QSTR___file__, MP_OBJ_NEW_QSTR(qstr_from_str(file_str)));
+        #endif
+        do_execute_raw_code(module_obj, mp_raw_code_compile_file_cached(file_str));
+        return;
+    }
+    #endif
+
     // If we can compile scripts then load the file and compile and execute it.
     #if MICROPY_ENABLE_COMPILER
     {
@@ -95,6 +95,7 @@ STATIC const emit_method_table_t *emit_native_table[] = {
     &emit_native_thumb_method_table,
     &emit_native_thumb_method_table,
     &emit_native_xtensa_method_table,
+    &emit_native_xtensawin_method_table,
 };
 
 #elif MICROPY_EMIT_NATIVE
@@ -109,6 +110,8 @@ STATIC const emit_method_table_t *emit_native_table[] = {
 #define NATIVE_EMITTER(f) emit_native_arm_##f
 #elif MICROPY_EMIT_XTENSA
 #define NATIVE_EMITTER(f) emit_native_xtensa_##f
+#elif MICROPY_EMIT_XTENSAWIN
+#define NATIVE_EMITTER(f) emit_native_xtensawin_##f
 #else
 #error "unknown native emitter"
 #endif
@@ -131,6 +134,7 @@ STATIC const emit_inline_asm_method_table_t *emit_asm_table[] = {
     &emit_inline_thumb_method_table,
     &emit_inline_thumb_method_table,
     &emit_inline_xtensa_method_table,
+    &emit_inline_xtensa_method_table,
 };
 
 #elif MICROPY_EMIT_INLINE_ASM
@@ -3507,7 +3511,8 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
             // TODO this can be improved by calculating it during SCOPE pass
             // but that requires some other structural changes to the asm emitters
             #if MICROPY_DYNAMIC_COMPILER
-            if (mp_dynamic_compiler.native_arch == MP_NATIVE_ARCH_XTENSA)
+            if (mp_dynamic_compiler.native_arch == MP_NATIVE_ARCH_XTENSA
+                || mp_dynamic_compiler.native_arch == MP_NATIVE_ARCH_XTENSAWIN)
             #endif
             {
                 compile_scope_inline_asm(comp, s, MP_PASS_CODE_SIZE);
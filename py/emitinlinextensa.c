@@ -32,9 +32,18 @@
 
 #include "py/emit.h"
 #include "py/asmxtensa.h"
+#include "py/mpstate.h"
+#include "py/persistentcode.h"
 
 #if MICROPY_EMIT_INLINE_XTENSA
 
+// runs with the windowed ABI of the ESP32, mpy-cross picks it with -march=xtensawin
+#if MICROPY_DYNAMIC_COMPILER
+#define EMIT_INLINE_XTENSA_WIN (mp_dynamic_compiler.native_arch == MP_NATIVE_ARCH_XTENSAWIN)
+#else
+#define EMIT_INLINE_XTENSA_WIN (MICROPY_EMIT_XTENSAWIN)
+#endif
+
 struct _emit_inline_asm_t {
     asm_xtensa_t as;
     uint16_t pass;
@@ -73,11 +82,20 @@ STATIC void emit_inline_xtensa_start_pass(emit_inline_asm_t *emit, pass_kind_t p
         memset(emit->label_lookup, 0, emit->max_num_labels * sizeof(qstr));
     }
     mp_asm_base_start_pass(&emit->as.base, pass == MP_PASS_EMIT ? MP_ASM_PASS_EMIT : MP_ASM_PASS_COMPUTE);
-    asm_xtensa_entry(&emit->as, 0);
+    if (EMIT_INLINE_XTENSA_WIN) {
+        // the port uses the windowed ABI, the arguments still arrive in a2-a5
+        asm_xtensa_entry_win(&emit->as, 0);
+    } else {
+        asm_xtensa_entry(&emit->as, 0);
+    }
 }
 
 STATIC void emit_inline_xtensa_end_pass(emit_inline_asm_t *emit, mp_uint_t type_sig) {
-    asm_xtensa_exit(&emit->as);
+    if (EMIT_INLINE_XTENSA_WIN) {
+        asm_xtensa_exit_win(&emit->as);
+    } else {
+        asm_xtensa_exit(&emit->as);
+    }
     asm_xtensa_end_pass(&emit->as);
 }
 
@@ -57,7 +57,33 @@
 #endif
 
 // wrapper around everything in this file
-#if N_X64 || N_X86 || N_THUMB || N_ARM || N_XTENSA
+#if N_X64 || N_X86 || N_THUMB || N_ARM || N_XTENSA || N_XTENSAWIN
+
+// Architectures with a windowed register ABI receive their arguments and return
+// their result in different registers to the ones used for the calls they make
+#ifndef REG_PARENT_RET
+#define REG_PARENT_RET REG_RET
+#define REG_PARENT_ARG_1 REG_ARG_1
+#define REG_PARENT_ARG_2 REG_ARG_2
+#define REG_PARENT_ARG_3 REG_ARG_3
+#define REG_PARENT_ARG_4 REG_ARG_4
+#endif
+
+// Whether nlr_push is the setjmp based one, made of a call to nlr_push_tail
+// followed by a call to setjmp from the native code itself
+#ifndef N_NLR_SETJMP
+#define N_NLR_SETJMP (0)
+#endif
+
+// Whether the prelude is stored in a bytes object in the const table, for the
+// architectures where executable memory can't be read byte-wise
+#ifndef N_PRELUDE_AS_BYTES_OBJ
+#define N_PRELUDE_AS_BYTES_OBJ (0)
+#endif
+
+#if N_PRELUDE_AS_BYTES_OBJ
+#include "py/objstr.h"
+#endif
 
 // C stack layout for native functions:
 //  0:                          nlr_buf_t [optional]
@@ -83,6 +109,13 @@
 // Word index of nlr_buf_t.ret_val
 #define NLR_BUF_IDX_RET_VAL (1)
 
+// Word index of nlr_buf_t.jmpbuf
+#define NLR_BUF_IDX_JMPBUF (2)
+
+// Index within the const table (after the qstr names of the arguments) of the
+// bytes object holding the prelude, it's the first constant object
+#define CONST_TABLE_IDX_PRELUDE (1)
+
 // Whether the viper function needs access to fun_obj
 #define NEED_FUN_OBJ(emit) ((emit)->scope->exc_stack_size > 0 \
     || ((emit)->scope->scope_flags & (MP_SCOPE_FLAG_REFGLOBALS | MP_SCOPE_FLAG_HASCONSTS)))
@@ -189,6 +222,9 @@ struct _emit_t {
     exc_stack_entry_t *exc_stack;
 
     int prelude_offset;
+    #if N_PRELUDE_AS_BYTES_OBJ
+    vstr_t prelude;
+    #endif
     int start_offset;
     int n_state;
     uint16_t code_state_start;
@@ -228,12 +264,18 @@ emit_t *EXPORT_FUN(new)(mp_obj_t *error_slot, uint *label_slot, mp_uint_t max_nu
     emit->exc_stack = m_new(exc_stack_entry_t, emit->exc_stack_alloc);
     emit->as = m_new0(ASM_T, 1);
     mp_asm_base_init(&emit->as->base, max_num_labels);
+    #if N_PRELUDE_AS_BYTES_OBJ
+    vstr_init(&emit->prelude, 16);
+    #endif
     return emit;
 }
 
 void EXPORT_FUN(free)(emit_t *emit) {
     mp_asm_base_deinit(&emit->as->base, false);
     m_del_obj(ASM_T, emit->as);
+    #if N_PRELUDE_AS_BYTES_OBJ
+    vstr_clear(&emit->prelude);
+    #endif
     m_del(exc_stack_entry_t, emit->exc_stack, emit->exc_stack_alloc);
     m_del(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc);
     m_del(stack_info_t, emit->stack_info, emit->stack_info_alloc);
@@ -311,6 +353,12 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
     emit->stack_size = 0;
     emit->const_table_cur_obj = 0;
     emit->const_table_cur_raw_code = 0;
+    #if N_PRELUDE_AS_BYTES_OBJ
+    if (!emit->do_viper_types) {
+        // Reserve the first constant object for the prelude
+        emit->const_table_cur_obj = CONST_TABLE_IDX_PRELUDE;
+    }
+    #endif
     #if MICROPY_PERSISTENT_CODE_SAVE
     emit->qstr_link_cur = 0;
     #endif
@@ -402,12 +450,12 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         #endif
 
         // Load REG_FUN_TABLE with a pointer to mp_fun_table, found in the const_table
-        ASM_LOAD_REG_REG_OFFSET(emit->as, REG_LOCAL_3, REG_ARG_1, offsetof(mp_obj_fun_bc_t, const_table) / sizeof(uintptr_t));
+        ASM_LOAD_REG_REG_OFFSET(emit->as, REG_LOCAL_3, REG_PARENT_ARG_1, offsetof(mp_obj_fun_bc_t, const_table) / sizeof(uintptr_t));
         ASM_LOAD_REG_REG_OFFSET(emit->as, REG_FUN_TABLE, REG_LOCAL_3, 0);
 
         // Store function object (passed as first arg) to stack if needed
         if (NEED_FUN_OBJ(emit)) {
-            ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_FUN_OBJ(emit), REG_ARG_1);
+            ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_FUN_OBJ(emit), REG_PARENT_ARG_1);
         }
 
         // Put n_args in REG_ARG_1, n_kw in REG_ARG_2, args array in REG_LOCAL_3
@@ -416,9 +464,9 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         asm_x86_mov_arg_to_r32(emit->as, 2, REG_ARG_2);
         asm_x86_mov_arg_to_r32(emit->as, 3, REG_LOCAL_3);
         #else
-        ASM_MOV_REG_REG(emit->as, REG_ARG_1, REG_ARG_2);
-        ASM_MOV_REG_REG(emit->as, REG_ARG_2, REG_ARG_3);
-        ASM_MOV_REG_REG(emit->as, REG_LOCAL_3, REG_ARG_4);
+        ASM_MOV_REG_REG(emit->as, REG_ARG_1, REG_PARENT_ARG_2);
+        ASM_MOV_REG_REG(emit->as, REG_ARG_2, REG_PARENT_ARG_3);
+        ASM_MOV_REG_REG(emit->as, REG_LOCAL_3, REG_PARENT_ARG_4);
         #endif
 
         // Check number of args matches this function, and call mp_arg_check_num_sig if not
@@ -459,7 +507,12 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         if (emit->scope->scope_flags & MP_SCOPE_FLAG_GENERATOR) {
             emit->code_state_start = 0;
             emit->stack_start = sizeof(mp_code_state_t) / sizeof(mp_uint_t);
+            #if N_PRELUDE_AS_BYTES_OBJ
+            // The generator wrapper finds the prelude in the const table at this index
+            mp_asm_base_data(&emit->as->base, ASM_WORD_SIZE, scope->num_pos_args + scope->num_kwonly_args + CONST_TABLE_IDX_PRELUDE);
+            #else
             mp_asm_base_data(&emit->as->base, ASM_WORD_SIZE, (uintptr_t)emit->prelude_offset);
+            #endif
             mp_asm_base_data(&emit->as->base, ASM_WORD_SIZE, (uintptr_t)emit->start_offset);
             ASM_ENTRY(emit->as, sizeof(nlr_buf_t) / sizeof(uintptr_t));
 
@@ -467,14 +520,14 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
             #if N_X86
             asm_x86_mov_arg_to_r32(emit->as, 0, REG_GENERATOR_STATE);
             #else
-            ASM_MOV_REG_REG(emit->as, REG_GENERATOR_STATE, REG_ARG_1);
+            ASM_MOV_REG_REG(emit->as, REG_GENERATOR_STATE, REG_PARENT_ARG_1);
             #endif
 
             // Put throw value into LOCAL_IDX_EXC_VAL slot, for yield/yield-from
             #if N_X86
-            asm_x86_mov_arg_to_r32(emit->as, 1, REG_ARG_2);
+            asm_x86_mov_arg_to_r32(emit->as, 1, REG_PARENT_ARG_2);
             #endif
-            ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_EXC_VAL(emit), REG_ARG_2);
+            ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_EXC_VAL(emit), REG_PARENT_ARG_2);
 
             // Load REG_FUN_TABLE with a pointer to mp_fun_table, found in the const_table
             ASM_LOAD_REG_REG_OFFSET(emit->as, REG_TEMP0, REG_GENERATOR_STATE, LOCAL_IDX_FUN_OBJ(emit));
@@ -497,15 +550,32 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
             #endif
 
             // Load REG_FUN_TABLE with a pointer to mp_fun_table, found in the const_table
-            ASM_LOAD_REG_REG_OFFSET(emit->as, REG_LOCAL_3, REG_ARG_1, offsetof(mp_obj_fun_bc_t, const_table) / sizeof(uintptr_t));
+            ASM_LOAD_REG_REG_OFFSET(emit->as, REG_LOCAL_3, REG_PARENT_ARG_1, offsetof(mp_obj_fun_bc_t, const_table) / sizeof(uintptr_t));
             ASM_LOAD_REG_REG_OFFSET(emit->as, REG_FUN_TABLE, REG_LOCAL_3, emit->scope->num_pos_args + emit->scope->num_kwonly_args);
 
             // Set code_state.fun_bc
-            ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_FUN_OBJ(emit), REG_ARG_1);
+            ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_FUN_OBJ(emit), REG_PARENT_ARG_1);
 
             // Set code_state.ip (offset from start of this function to prelude info)
+            #if N_PRELUDE_AS_BYTES_OBJ
+            // The prelude isn't part of the code, so work out its offset at run time
+            // (REG_ARG_2 is free, the incoming arguments are still in REG_PARENT_ARG_x)
+            ASM_LOAD_REG_REG_OFFSET(emit->as, REG_ARG_1, REG_LOCAL_3, emit->scope->num_pos_args + emit->scope->num_kwonly_args + CONST_TABLE_IDX_PRELUDE);
+            ASM_LOAD_REG_REG_OFFSET(emit->as, REG_ARG_1, REG_ARG_1, offsetof(mp_obj_str_t, data) / sizeof(uintptr_t));
+            ASM_LOAD_REG_REG_OFFSET(emit->as, REG_ARG_2, REG_PARENT_ARG_1, offsetof(mp_obj_fun_bc_t, bytecode) / sizeof(uintptr_t));
+            ASM_SUB_REG_REG(emit->as, REG_ARG_1, REG_ARG_2);
+            emit_native_mov_state_reg(emit, emit->code_state_start + offsetof(mp_code_state_t, ip) / sizeof(uintptr_t), REG_ARG_1);
+            #else
             // TODO this encoding may change size in the final pass, need to make it fixed
             emit_native_mov_state_imm_via(emit, emit->code_state_start + offsetof(mp_code_state_t, ip) / sizeof(uintptr_t), emit->prelude_offset, REG_ARG_1);
+            #endif
+
+            #if !N_X86 && REG_PARENT_ARG_2 != REG_ARG_2
+            // Move n_args, n_kw and args to where mp_setup_code_state expects them
+            ASM_MOV_REG_REG(emit->as, REG_ARG_2, REG_PARENT_ARG_2);
+            ASM_MOV_REG_REG(emit->as, REG_ARG_3, REG_PARENT_ARG_3);
+            ASM_MOV_REG_REG(emit->as, REG_ARG_4, REG_PARENT_ARG_4);
+            #endif
 
             // Put address of code_state into first arg
             ASM_MOV_REG_LOCAL_ADDR(emit->as, REG_ARG_1, emit->code_state_start);
@@ -556,28 +626,40 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
 
 }
 
+STATIC void emit_native_prelude_byte(emit_t *emit, byte b) {
+    #if N_PRELUDE_AS_BYTES_OBJ
+    vstr_add_byte(&emit->prelude, b);
+    #else
+    mp_asm_base_data(&emit->as->base, 1, b);
+    #endif
+}
+
 STATIC void emit_native_end_pass(emit_t *emit) {
     emit_native_global_exc_exit(emit);
 
     if (!emit->do_viper_types) {
+        #if N_PRELUDE_AS_BYTES_OBJ
+        vstr_reset(&emit->prelude);
+        #else
         emit->prelude_offset = mp_asm_base_get_code_pos(&emit->as->base);
-        mp_asm_base_data(&emit->as->base, 1, 0x80 | ((emit->n_state >> 7) & 0x7f));
-        mp_asm_base_data(&emit->as->base, 1, emit->n_state & 0x7f);
-        mp_asm_base_data(&emit->as->base, 1, 0); // n_exc_stack
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->scope_flags);
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->num_pos_args);
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->num_kwonly_args);
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->num_def_pos_args);
+        #endif
+        emit_native_prelude_byte(emit, 0x80 | ((emit->n_state >> 7) & 0x7f));
+        emit_native_prelude_byte(emit, emit->n_state & 0x7f);
+        emit_native_prelude_byte(emit, 0); // n_exc_stack
+        emit_native_prelude_byte(emit, emit->scope->scope_flags);
+        emit_native_prelude_byte(emit, emit->scope->num_pos_args);
+        emit_native_prelude_byte(emit, emit->scope->num_kwonly_args);
+        emit_native_prelude_byte(emit, emit->scope->num_def_pos_args);
 
         // write code info
         #if MICROPY_PERSISTENT_CODE
-        mp_asm_base_data(&emit->as->base, 1, 5);
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->simple_name);
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->simple_name >> 8);
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->source_file);
-        mp_asm_base_data(&emit->as->base, 1, emit->scope->source_file >> 8);
+        emit_native_prelude_byte(emit, 5);
+        emit_native_prelude_byte(emit, emit->scope->simple_name);
+        emit_native_prelude_byte(emit, emit->scope->simple_name >> 8);
+        emit_native_prelude_byte(emit, emit->scope->source_file);
+        emit_native_prelude_byte(emit, emit->scope->source_file >> 8);
         #else
-        mp_asm_base_data(&emit->as->base, 1, 1);
+        emit_native_prelude_byte(emit, 1);
         #endif
 
         // bytecode prelude: initialise closed over variables
@@ -585,10 +667,10 @@ STATIC void emit_native_end_pass(emit_t *emit) {
             id_info_t *id = &emit->scope->id_info[i];
             if (id->kind == ID_INFO_KIND_CELL) {
                 assert(id->local_num < 255);
-                mp_asm_base_data(&emit->as->base, 1, id->local_num); // write the local which should be converted to a cell
+                emit_native_prelude_byte(emit, id->local_num); // write the local which should be converted to a cell
             }
         }
-        mp_asm_base_data(&emit->as->base, 1, 255); // end of list sentinel
+        emit_native_prelude_byte(emit, 255); // end of list sentinel
     }
 
     ASM_END_PASS(emit->as);
@@ -621,6 +703,13 @@ STATIC void emit_native_end_pass(emit_t *emit) {
     }
 
     if (emit->pass == MP_PASS_EMIT) {
+        #if N_PRELUDE_AS_BYTES_OBJ
+        if (!emit->do_viper_types) {
+            size_t nqstr = emit->scope->num_pos_args + emit->scope->num_kwonly_args;
+            emit->const_table[nqstr + CONST_TABLE_IDX_PRELUDE] = (mp_uint_t)mp_obj_new_bytes((const byte*)emit->prelude.buf, emit->prelude.len);
+        }
+        #endif
+
         void *f = mp_asm_base_get_code(&emit->as->base);
         mp_uint_t f_len = mp_asm_base_get_code_size(&emit->as->base);
 
@@ -1106,6 +1195,10 @@ STATIC void emit_native_global_exc_entry(emit_t *emit) {
             // Wrap everything in an nlr context
             ASM_MOV_REG_LOCAL_ADDR(emit->as, REG_ARG_1, 0);
             emit_call(emit, MP_F_NLR_PUSH);
+            #if N_NLR_SETJMP
+            ASM_MOV_REG_LOCAL_ADDR(emit->as, REG_ARG_1, NLR_BUF_IDX_JMPBUF);
+            emit_call(emit, MP_F_SETJMP);
+            #endif
             ASM_JUMP_IF_REG_ZERO(emit->as, REG_RET, start_label, true);
         } else {
             // Clear the unwind state
@@ -1120,6 +1213,10 @@ STATIC void emit_native_global_exc_entry(emit_t *emit) {
             ASM_MOV_REG_LOCAL(emit->as, REG_LOCAL_2, LOCAL_IDX_EXC_HANDLER_UNWIND(emit));
             ASM_MOV_REG_LOCAL_ADDR(emit->as, REG_ARG_1, 0);
             emit_call(emit, MP_F_NLR_PUSH);
+            #if N_NLR_SETJMP
+            ASM_MOV_REG_LOCAL_ADDR(emit->as, REG_ARG_1, NLR_BUF_IDX_JMPBUF);
+            emit_call(emit, MP_F_SETJMP);
+            #endif
             ASM_MOV_LOCAL_REG(emit->as, LOCAL_IDX_EXC_HANDLER_UNWIND(emit), REG_LOCAL_2);
             ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, global_except_label, true);
 
@@ -1146,7 +1243,7 @@ STATIC void emit_native_global_exc_entry(emit_t *emit) {
             ASM_STORE_REG_REG_OFFSET(emit->as, REG_TEMP0, REG_GENERATOR_STATE, offsetof(mp_code_state_t, state) / sizeof(uintptr_t));
 
             // Load return kind
-            ASM_MOV_REG_IMM(emit->as, REG_RET, MP_VM_RETURN_EXCEPTION);
+            ASM_MOV_REG_IMM(emit->as, REG_PARENT_RET, MP_VM_RETURN_EXCEPTION);
 
             ASM_EXIT(emit->as);
         } else {
@@ -1201,7 +1298,11 @@ STATIC void emit_native_global_exc_exit(emit_t *emit) {
         }
 
         // Load return value
-        ASM_MOV_REG_LOCAL(emit->as, REG_RET, LOCAL_IDX_RET_VAL(emit));
+        ASM_MOV_REG_LOCAL(emit->as, REG_PARENT_RET, LOCAL_IDX_RET_VAL(emit));
+    } else {
+        #if REG_PARENT_RET != REG_RET
+        ASM_MOV_REG_REG(emit->as, REG_PARENT_RET, REG_RET);
+        #endif
     }
 
     ASM_EXIT(emit->as);
@@ -2312,7 +2413,7 @@ STATIC void emit_native_binary_op(emit_t *emit, mp_binary_op_t op) {
                 ASM_ARM_CC_NE,
             };
             asm_arm_setcc_reg(emit->as, REG_RET, ccs[op - MP_BINARY_OP_LESS]);
-            #elif N_XTENSA
+            #elif N_XTENSA || N_XTENSAWIN
             static uint8_t ccs[6] = {
                 ASM_XTENSA_CC_LT,
                 0x80 | ASM_XTENSA_CC_LT, // for GT we'll swap args
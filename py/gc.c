@@ -31,6 +31,9 @@
 
 #include "py/gc.h"
 #include "py/runtime.h"
+#if MICROPY_GC_INCREMENTAL
+#include "py/mphal.h"
+#endif
 
 #if MICROPY_ENABLE_GC
 
@@ -75,15 +78,22 @@
 #define ATB_3_IS_FREE(a) (((a) & ATB_MASK_3) == 0)
 
 #define BLOCK_SHIFT(block) (2 * ((block) & (BLOCKS_PER_ATB - 1)))
-#define ATB_GET_KIND(block) ((MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
-#define ATB_ANY_TO_FREE(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
-#define ATB_FREE_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
-#define ATB_FREE_TO_TAIL(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
-#define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
-#define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
-
-#define BLOCK_FROM_PTR(ptr) (((byte*)(ptr) - MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
-#define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (uintptr_t)MP_STATE_MEM(gc_pool_start)))
+#define ATB_GET_KIND(area, block) (((area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
+#define ATB_ANY_TO_FREE(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
+#define ATB_FREE_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
+#define ATB_FREE_TO_TAIL(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
+#define ATB_HEAD_TO_MARK(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
+#define ATB_MARK_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
+
+// a head not swept yet after the last collection is still marked if it is in use
+#if MICROPY_GC_INCREMENTAL
+#define ATB_IS_USED_HEAD(area, block) (ATB_GET_KIND(area, block) & AT_HEAD)
+#else
+#define ATB_IS_USED_HEAD(area, block) (ATB_GET_KIND(area, block) == AT_HEAD)
+#endif
+
+#define BLOCK_FROM_PTR(area, ptr) (((byte*)(ptr) - (area)->gc_pool_start) / BYTES_PER_BLOCK)
+#define PTR_FROM_BLOCK(area, block) (((block) * BYTES_PER_BLOCK + (uintptr_t)(area)->gc_pool_start))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
 
 #if MICROPY_ENABLE_FINALISER
@@ -92,9 +102,15 @@
 
 #define BLOCKS_PER_FTB (8)
 
-#define FTB_GET(block) ((MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
-#define FTB_SET(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
-#define FTB_CLEAR(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#define FTB_GET(area, block) (((area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
+#define FTB_SET(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
+#define FTB_CLEAR(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#endif
+
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
 #endif
 
 #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
@@ -106,7 +122,7 @@
 #endif
 
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
-void gc_init(void *start, void *end) {
+STATIC void gc_setup_area(mp_state_mem_area_t *area, void *start, void *end) {
     // align end pointer on block boundary
     end = (void*)((uintptr_t)end & (~(BYTES_PER_BLOCK - 1)));
     DEBUG_printf("Initializing GC heap: %p..%p = " UINT_FMT " bytes\n", start, end, (byte*)end - (byte*)start);
@@ -118,36 +134,56 @@ void gc_init(void *start, void *end) {
     // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
     size_t total_byte_len = (byte*)end - (byte*)start;
 #if MICROPY_ENABLE_FINALISER
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
 #else
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
 #endif
 
-    MP_STATE_MEM(gc_alloc_table_start) = (byte*)start;
+    area->gc_alloc_table_start = (byte*)start;
 
 #if MICROPY_ENABLE_FINALISER
-    size_t gc_finaliser_table_byte_len = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
-    MP_STATE_MEM(gc_finaliser_table_start) = MP_STATE_MEM(gc_alloc_table_start) + MP_STATE_MEM(gc_alloc_table_byte_len);
+    size_t gc_finaliser_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
+    area->gc_finaliser_table_start = area->gc_alloc_table_start + area->gc_alloc_table_byte_len;
 #endif
 
-    size_t gc_pool_block_len = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
-    MP_STATE_MEM(gc_pool_start) = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
-    MP_STATE_MEM(gc_pool_end) = end;
+    size_t gc_pool_block_len = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    area->gc_pool_start = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
+    area->gc_pool_end = end;
 
 #if MICROPY_ENABLE_FINALISER
-    assert(MP_STATE_MEM(gc_pool_start) >= MP_STATE_MEM(gc_finaliser_table_start) + gc_finaliser_table_byte_len);
+    assert(area->gc_pool_start >= area->gc_finaliser_table_start + gc_finaliser_table_byte_len);
 #endif
 
     // clear ATBs
-    memset(MP_STATE_MEM(gc_alloc_table_start), 0, MP_STATE_MEM(gc_alloc_table_byte_len));
+    memset(area->gc_alloc_table_start, 0, area->gc_alloc_table_byte_len);
 
 #if MICROPY_ENABLE_FINALISER
     // clear FTBs
-    memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
+    memset(area->gc_finaliser_table_start, 0, gc_finaliser_table_byte_len);
 #endif
 
     // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    area->gc_last_free_atb_index = 0;
+
+    #if MICROPY_GC_SPLIT_HEAP
+    area->next = NULL;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    // nothing to sweep in a new area
+    area->gc_sweep_block = gc_pool_block_len;
+    #endif
+
+    DEBUG_printf("GC layout:\n");
+    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_alloc_table_start, area->gc_alloc_table_byte_len, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+#if MICROPY_ENABLE_FINALISER
+    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_finaliser_table_start, gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#endif
+    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_pool_start, gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+}
+
+void gc_init(void *start, void *end) {
+    gc_setup_area(&MP_STATE_MEM(area), start, end);
 
     // unlock the GC
     MP_STATE_MEM(gc_lock_depth) = 0;
@@ -161,17 +197,40 @@ void gc_init(void *start, void *end) {
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
 
+    #if MICROPY_GC_INCREMENTAL
+    MP_STATE_MEM(gc_incremental) = false;
+    MP_STATE_MEM(gc_sweep_pending) = false;
+    memset(&MP_STATE_MEM(gc_stats), 0, sizeof(MP_STATE_MEM(gc_stats)));
+    #endif
+
+    #if MICROPY_GC_ALLOC_PROFILE
+    memset(&MP_STATE_MEM(gc_prof), 0, sizeof(MP_STATE_MEM(gc_prof)));
+    memset(MP_STATE_VM(gc_prof_sites), 0, sizeof(MP_STATE_VM(gc_prof_sites)));
+    #endif
+    #if MICROPY_PROF_CODE
+    MP_STATE_THREAD(prof_code) = NULL;
+    #endif
+
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
     #endif
+}
 
-    DEBUG_printf("GC layout:\n");
-    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-#if MICROPY_ENABLE_FINALISER
-    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_finaliser_table_start), gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
-#endif
-    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_pool_start), gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+#if MICROPY_GC_SPLIT_HEAP
+void gc_add(void *start, void *end) {
+    // the state of the new area is kept at the start of the memory given
+    mp_state_mem_area_t *area = (mp_state_mem_area_t*)start;
+    gc_setup_area(area, (byte*)start + sizeof(mp_state_mem_area_t), end);
+
+    GC_ENTER();
+    mp_state_mem_area_t *prev = &MP_STATE_MEM(area);
+    while (prev->next != NULL) {
+        prev = prev->next;
+    }
+    prev->next = area;
+    GC_EXIT();
 }
+#endif
 
 void gc_lock(void) {
     GC_ENTER();
@@ -190,12 +249,22 @@ bool gc_is_locked(void) {
 }
 
 // ptr should be of type void*
-#define VERIFY_PTR(ptr) ( \
+#define VERIFY_PTR(area, ptr) ( \
         ((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) == 0      /* must be aligned on a block */ \
-        && ptr >= (void*)MP_STATE_MEM(gc_pool_start)     /* must be above start of pool */ \
-        && ptr < (void*)MP_STATE_MEM(gc_pool_end)        /* must be below end of pool */ \
+        && ptr >= (void*)(area)->gc_pool_start     /* must be above start of pool */ \
+        && ptr < (void*)(area)->gc_pool_end        /* must be below end of pool */ \
     )
 
+// Returns the area holding the block ptr points to, NULL if it isn't a heap block.
+static inline mp_state_mem_area_t *gc_get_ptr_area(const void *ptr) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        if (VERIFY_PTR(area, ptr)) {
+            return area;
+        }
+    }
+    return NULL;
+}
+
 #ifndef TRACE_MARK
 #if DEBUG_PRINT
 #define TRACE_MARK(block, ptr) DEBUG_printf("gc_mark(%p)\n", ptr)
@@ -208,7 +277,7 @@ bool gc_is_locked(void) {
 // children: mark the unmarked child blocks and put those newly marked
 // blocks on the stack. When all children have been checked, pop off the
 // topmost block on the stack and repeat with that one.
-STATIC void gc_mark_subtree(size_t block) {
+STATIC void gc_mark_subtree(mp_state_mem_area_t *area, size_t block) {
     // Start with the block passed in the argument.
     size_t sp = 0;
     for (;;) {
@@ -216,20 +285,24 @@ STATIC void gc_mark_subtree(size_t block) {
         size_t n_blocks = 0;
         do {
             n_blocks += 1;
-        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+        } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
 
         // check this block's children
-        void **ptrs = (void**)PTR_FROM_BLOCK(block);
+        void **ptrs = (void**)PTR_FROM_BLOCK(area, block);
         for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
             void *ptr = *ptrs;
-            if (VERIFY_PTR(ptr)) {
+            mp_state_mem_area_t *ptr_area = gc_get_ptr_area(ptr);
+            if (ptr_area != NULL) {
                 // Mark and push this pointer
-                size_t childblock = BLOCK_FROM_PTR(ptr);
-                if (ATB_GET_KIND(childblock) == AT_HEAD) {
+                size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+                if (ATB_GET_KIND(ptr_area, childblock) == AT_HEAD) {
                     // an unmarked head, mark it, and push it on gc stack
                     TRACE_MARK(childblock, ptr);
-                    ATB_HEAD_TO_MARK(childblock);
+                    ATB_HEAD_TO_MARK(ptr_area, childblock);
                     if (sp < MICROPY_ALLOC_GC_STACK_SIZE) {
+                        #if MICROPY_GC_SPLIT_HEAP
+                        MP_STATE_MEM(gc_area_stack)[sp] = ptr_area;
+                        #endif
                         MP_STATE_MEM(gc_stack)[sp++] = childblock;
                     } else {
                         MP_STATE_MEM(gc_stack_overflow) = 1;
@@ -244,6 +317,9 @@ STATIC void gc_mark_subtree(size_t block) {
         }
 
         // pop the next block off the stack
+        #if MICROPY_GC_SPLIT_HEAP
+        area = MP_STATE_MEM(gc_area_stack)[sp - 1];
+        #endif
         block = MP_STATE_MEM(gc_stack)[--sp];
     }
 }
@@ -253,27 +329,30 @@ STATIC void gc_deal_with_stack_overflow(void) {
         MP_STATE_MEM(gc_stack_overflow) = 0;
 
         // scan entire memory looking for blocks which have been marked but not their children
-        for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-            // trace (again) if mark bit set
-            if (ATB_GET_KIND(block) == AT_MARK) {
-                gc_mark_subtree(block);
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+                // trace (again) if mark bit set
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    gc_mark_subtree(area, block);
+                }
             }
         }
     }
 }
 
-STATIC void gc_sweep(void) {
-    #if MICROPY_PY_GC_COLLECT_RETVAL
-    MP_STATE_MEM(gc_collected) = 0;
-    #endif
+// Sweep at least n_blocks, starting with the given one, and stop before the next
+// head so that no chain is left half swept. Returns the first block not swept.
+STATIC size_t gc_sweep_blocks(mp_state_mem_area_t *area, size_t block, size_t n_blocks) {
+    size_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    size_t end_block = (n_blocks < max_block - block) ? block + n_blocks : max_block;
     // free unmarked heads and their tails
     int free_tail = 0;
-    for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        switch (ATB_GET_KIND(block)) {
+    for (; block < max_block && (block < end_block || ATB_GET_KIND(area, block) == AT_TAIL); block++) {
+        switch (ATB_GET_KIND(area, block)) {
             case AT_HEAD:
 #if MICROPY_ENABLE_FINALISER
-                if (FTB_GET(block)) {
-                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(block);
+                if (FTB_GET(area, block)) {
+                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(area, block);
                     if (obj->type != NULL) {
                         // if the object has a type then see if it has a __del__ method
                         mp_obj_t dest[2];
@@ -290,11 +369,11 @@ STATIC void gc_sweep(void) {
                         }
                     }
                     // clear finaliser flag
-                    FTB_CLEAR(block);
+                    FTB_CLEAR(area, block);
                 }
 #endif
                 free_tail = 1;
-                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(block));
+                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(area, block));
                 #if MICROPY_PY_GC_COLLECT_RETVAL
                 MP_STATE_MEM(gc_collected)++;
                 #endif
@@ -302,23 +381,90 @@ STATIC void gc_sweep(void) {
 
             case AT_TAIL:
                 if (free_tail) {
-                    ATB_ANY_TO_FREE(block);
+                    ATB_ANY_TO_FREE(area, block);
                     #if CLEAR_ON_SWEEP
-                    memset((void*)PTR_FROM_BLOCK(block), 0, BYTES_PER_BLOCK);
+                    memset((void*)PTR_FROM_BLOCK(area, block), 0, BYTES_PER_BLOCK);
                     #endif
                 }
                 break;
 
             case AT_MARK:
-                ATB_MARK_TO_HEAD(block);
+                ATB_MARK_TO_HEAD(area, block);
                 free_tail = 0;
                 break;
         }
     }
+    return block;
 }
 
+STATIC void gc_sweep(void) {
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    MP_STATE_MEM(gc_collected) = 0;
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        gc_sweep_blocks(area, 0, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+    }
+}
+
+#if MICROPY_GC_INCREMENTAL
+// Carry on with the sweep left behind by the last collection, must be called
+// with the GC entered. Returns true if there is more to sweep.
+STATIC bool gc_sweep_continue(size_t n_blocks) {
+    if (!MP_STATE_MEM(gc_sweep_pending)) {
+        return false;
+    }
+    // finalisers run by the sweep must not allocate
+    MP_STATE_MEM(gc_lock_depth)++;
+    bool pending = false;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        size_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+        if (area->gc_sweep_block < max_block && n_blocks > 0) {
+            area->gc_sweep_block = gc_sweep_blocks(area, area->gc_sweep_block, n_blocks);
+            n_blocks = 0;
+        }
+        pending |= area->gc_sweep_block < max_block;
+    }
+    MP_STATE_MEM(gc_lock_depth)--;
+    MP_STATE_MEM(gc_sweep_pending) = pending;
+    return pending;
+}
+
+STATIC void gc_stats_add_pause(mp_uint_t start_us) {
+    mp_uint_t pause = mp_hal_ticks_us() - start_us;
+    MP_STATE_MEM(gc_stats).pauses++;
+    MP_STATE_MEM(gc_stats).last_pause_us = pause;
+    MP_STATE_MEM(gc_stats).total_pause_us += pause;
+    if (pause > MP_STATE_MEM(gc_stats).max_pause_us) {
+        MP_STATE_MEM(gc_stats).max_pause_us = pause;
+    }
+}
+
+bool gc_sweep_step(size_t n_blocks) {
+    GC_ENTER();
+    bool pending = false;
+    if (MP_STATE_MEM(gc_lock_depth) == 0) {
+        pending = gc_sweep_continue(n_blocks);
+    }
+    GC_EXIT();
+    return pending;
+}
+
+void gc_sweep_finish(void) {
+    while (gc_sweep_step((size_t)-1)) {
+    }
+}
+#endif
+
 void gc_collect_start(void) {
     GC_ENTER();
+    MICROPY_GC_HOOK_COLLECT_START
+    #if MICROPY_GC_INCREMENTAL
+    // the marks of the previous collection must be gone before marking again
+    while (gc_sweep_continue((size_t)-1)) {
+    }
+    MP_STATE_MEM(gc_stats).collections++;
+    MP_STATE_MEM(gc_pause_start_us) = mp_hal_ticks_us();
+    #endif
     MP_STATE_MEM(gc_lock_depth)++;
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) = 0;
@@ -343,13 +489,14 @@ void gc_collect_start(void) {
 void gc_collect_root(void **ptrs, size_t len) {
     for (size_t i = 0; i < len; i++) {
         void *ptr = ptrs[i];
-        if (VERIFY_PTR(ptr)) {
-            size_t block = BLOCK_FROM_PTR(ptr);
-            if (ATB_GET_KIND(block) == AT_HEAD) {
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        if (area != NULL) {
+            size_t block = BLOCK_FROM_PTR(area, ptr);
+            if (ATB_GET_KIND(area, block) == AT_HEAD) {
                 // An unmarked head: mark it, and mark all its children
                 TRACE_MARK(block, ptr);
-                ATB_HEAD_TO_MARK(block);
-                gc_mark_subtree(block);
+                ATB_HEAD_TO_MARK(area, block);
+                gc_mark_subtree(area, block);
             }
         }
     }
@@ -357,14 +504,42 @@ void gc_collect_root(void **ptrs, size_t len) {
 
 void gc_collect_end(void) {
     gc_deal_with_stack_overflow();
-    gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_incremental)) {
+        // leave the sweep to gc_alloc and to the idle hooks, meanwhile only the
+        // part of the heap already swept is handed out
+        #if MICROPY_PY_GC_COLLECT_RETVAL
+        MP_STATE_MEM(gc_collected) = 0;
+        #endif
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            area->gc_sweep_block = 0;
+        }
+        MP_STATE_MEM(gc_sweep_pending) = true;
+    } else
+    #endif
+    {
+        gc_sweep();
+    }
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        area->gc_last_free_atb_index = 0;
+    }
     MP_STATE_MEM(gc_lock_depth)--;
+    #if MICROPY_GC_INCREMENTAL
+    gc_stats_add_pause(MP_STATE_MEM(gc_pause_start_us));
+    #endif
+    MICROPY_GC_HOOK_COLLECT_END
     GC_EXIT();
 }
 
 void gc_sweep_all(void) {
     GC_ENTER();
+    #if MICROPY_GC_INCREMENTAL
+    // clear the marks left over, then everything goes now
+    while (gc_sweep_continue((size_t)-1)) {
+    }
+    MP_STATE_MEM(gc_incremental) = false;
+    MP_STATE_MEM(gc_pause_start_us) = mp_hal_ticks_us();
+    #endif
     MP_STATE_MEM(gc_lock_depth)++;
     MP_STATE_MEM(gc_stack_overflow) = 0;
     gc_collect_end();
@@ -372,69 +547,175 @@ void gc_sweep_all(void) {
 
 void gc_info(gc_info_t *info) {
     GC_ENTER();
-    info->total = MP_STATE_MEM(gc_pool_end) - MP_STATE_MEM(gc_pool_start);
+    info->total = 0;
     info->used = 0;
     info->free = 0;
     info->max_free = 0;
     info->num_1block = 0;
     info->num_2block = 0;
     info->max_block = 0;
-    bool finish = false;
-    for (size_t block = 0, len = 0, len_free = 0; !finish;) {
-        size_t kind = ATB_GET_KIND(block);
-        switch (kind) {
-            case AT_FREE:
-                info->free += 1;
-                len_free += 1;
-                len = 0;
-                break;
-
-            case AT_HEAD:
-                info->used += 1;
-                len = 1;
-                break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        info->total += area->gc_pool_end - area->gc_pool_start;
+        bool finish = false;
+        for (size_t block = 0, len = 0, len_free = 0; !finish;) {
+            size_t kind = ATB_GET_KIND(area, block);
+            switch (kind) {
+                case AT_FREE:
+                    info->free += 1;
+                    len_free += 1;
+                    len = 0;
+                    break;
+
+                case AT_HEAD:
+                    info->used += 1;
+                    len = 1;
+                    break;
+
+                case AT_TAIL:
+                    info->used += 1;
+                    len += 1;
+                    break;
+
+                case AT_MARK:
+                    // a head in use while a sweep is pending
+                    info->used += 1;
+                    len = 1;
+                    break;
+            }
 
-            case AT_TAIL:
-                info->used += 1;
-                len += 1;
-                break;
+            block++;
+            finish = (block == area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+            // Get next block type if possible
+            if (!finish) {
+                kind = ATB_GET_KIND(area, block);
+            }
 
-            case AT_MARK:
-                // shouldn't happen
-                break;
+            if (finish || kind == AT_FREE || kind == AT_HEAD || kind == AT_MARK) {
+                if (len == 1) {
+                    info->num_1block += 1;
+                } else if (len == 2) {
+                    info->num_2block += 1;
+                }
+                if (len > info->max_block) {
+                    info->max_block = len;
+                }
+                if (finish || kind == AT_HEAD || kind == AT_MARK) {
+                    if (len_free > info->max_free) {
+                        info->max_free = len_free;
+                    }
+                    len_free = 0;
+                }
+            }
         }
 
-        block++;
-        finish = (block == MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-        // Get next block type if possible
-        if (!finish) {
-            kind = ATB_GET_KIND(block);
+    }
+
+    info->used *= BYTES_PER_BLOCK;
+    info->free *= BYTES_PER_BLOCK;
+    GC_EXIT();
+}
+
+#if MICROPY_GC_ALLOC_PROFILE
+void gc_prof_enable(bool enable) {
+    GC_ENTER();
+    if (enable) {
+        memset(&MP_STATE_MEM(gc_prof), 0, sizeof(MP_STATE_MEM(gc_prof)));
+        memset(MP_STATE_VM(gc_prof_sites), 0, sizeof(MP_STATE_VM(gc_prof_sites)));
+        MP_STATE_MEM(gc_prof).countdown = MICROPY_GC_ALLOC_PROFILE_SAMPLE;
+    }
+    MP_STATE_MEM(gc_prof).enabled = enable;
+    GC_EXIT();
+}
+
+// Count the allocation in the size histogram and, if it is sampled, account
+// it to the function running. When all the sites are taken the least sampled
+// one is given to the new function.
+STATIC void gc_prof_record(size_t n_bytes, size_t n_blocks) {
+    gc_prof_t *prof = &MP_STATE_MEM(gc_prof);
+    size_t bucket = 0;
+    while ((n_blocks >>= 1) != 0 && bucket < GC_PROF_SIZE_BUCKETS - 1) {
+        bucket++;
+    }
+    prof->size_hist[bucket]++;
+
+    if (--prof->countdown > 0) {
+        return;
+    }
+    prof->countdown = MICROPY_GC_ALLOC_PROFILE_SAMPLE;
+
+    const byte *code = MP_STATE_THREAD(prof_code);
+    size_t site = 0;
+    for (size_t i = 0; i < MICROPY_GC_ALLOC_PROFILE_SITES; i++) {
+        if (MP_STATE_VM(gc_prof_sites)[i] == code && prof->samples[i] != 0) {
+            site = i;
+            goto found;
         }
+        if (prof->samples[i] < prof->samples[site]) {
+            site = i;
+        }
+    }
+    MP_STATE_VM(gc_prof_sites)[site] = code;
+    prof->samples[site] = 0;
+    prof->bytes[site] = 0;
+found:
+    prof->samples[site]++;
+    prof->bytes[site] += n_bytes;
+}
 
-        if (finish || kind == AT_FREE || kind == AT_HEAD) {
-            if (len == 1) {
-                info->num_1block += 1;
-            } else if (len == 2) {
-                info->num_2block += 1;
-            }
-            if (len > info->max_block) {
-                info->max_block = len;
+size_t gc_free_runs(size_t *hist, size_t n_buckets) {
+    GC_ENTER();
+    memset(hist, 0, n_buckets * sizeof(size_t));
+    size_t max_free = 0;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        size_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+        size_t len_free = 0;
+        for (size_t block = 0; block <= max_block; block++) {
+            if (block < max_block && ATB_GET_KIND(area, block) == AT_FREE) {
+                len_free++;
+                continue;
             }
-            if (finish || kind == AT_HEAD) {
-                if (len_free > info->max_free) {
-                    info->max_free = len_free;
+            if (len_free > 0) {
+                size_t bucket = 0;
+                for (size_t n = len_free; (n >>= 1) != 0 && bucket < n_buckets - 1;) {
+                    bucket++;
+                }
+                hist[bucket]++;
+                if (len_free > max_free) {
+                    max_free = len_free;
                 }
                 len_free = 0;
             }
         }
     }
-
-    info->used *= BYTES_PER_BLOCK;
-    info->free *= BYTES_PER_BLOCK;
     GC_EXIT();
+    return max_free * BYTES_PER_BLOCK;
+}
+#endif
+
+// Start the search for free blocks of each area from its first free ATB.
+STATIC void gc_alloc_scan_reset(void) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        area->gc_scan_atb_index = area->gc_last_free_atb_index;
+        area->gc_scan_n_free = 0;
+    }
 }
 
-void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
+#if MICROPY_GC_SPLIT_HEAP
+// Order in which gc_alloc() searches the areas, large blocks try the first one last.
+STATIC mp_state_mem_area_t *gc_alloc_next_area(mp_state_mem_area_t *area, bool large) {
+    if (large) {
+        if (area == &MP_STATE_MEM(area)) {
+            return NULL;
+        }
+        return area->next != NULL ? area->next : &MP_STATE_MEM(area);
+    }
+    return area->next;
+}
+#else
+#define gc_alloc_next_area(area, large) (NULL)
+#endif
+
+void *MICROPY_WRAP_GC_ALLOC(gc_alloc)(size_t n_bytes, unsigned int alloc_flags) {
     bool has_finaliser = alloc_flags & GC_ALLOC_FLAG_HAS_FINALISER;
     size_t n_blocks = ((n_bytes + BYTES_PER_BLOCK - 1) & (~(BYTES_PER_BLOCK - 1))) / BYTES_PER_BLOCK;
     DEBUG_printf("gc_alloc(" UINT_FMT " bytes -> " UINT_FMT " blocks)\n", n_bytes, n_blocks);
@@ -452,12 +733,19 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         return NULL;
     }
 
+    mp_state_mem_area_t *area;
     size_t i;
     size_t end_block;
     size_t start_block;
     size_t n_free;
     int collected = !MP_STATE_MEM(gc_auto_collect_enabled);
 
+    #if MICROPY_GC_SPLIT_HEAP
+    // large blocks are placed in the areas added by gc_add() first, so that
+    // the first area is kept for the small objects
+    bool large = n_bytes >= MICROPY_GC_SPLIT_HEAP_LARGE_BYTES && MP_STATE_MEM(area).next != NULL;
+    #endif
+
     #if MICROPY_GC_ALLOC_THRESHOLD
     if (!collected && MP_STATE_MEM(gc_alloc_amount) >= MP_STATE_MEM(gc_alloc_threshold)) {
         GC_EXIT();
@@ -467,18 +755,47 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
     }
     #endif
 
+    gc_alloc_scan_reset();
     for (;;) {
 
-        // look for a run of n_blocks available blocks
-        n_free = 0;
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
-            byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
-            if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
-            if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
-            if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
-            if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+        // look for a run of n_blocks available blocks, one area after the other
+        #if MICROPY_GC_SPLIT_HEAP
+        area = large ? MP_STATE_MEM(area).next : &MP_STATE_MEM(area);
+        #else
+        area = &MP_STATE_MEM(area);
+        #endif
+        for (; area != NULL; area = gc_alloc_next_area(area, large)) {
+            size_t end_atb = area->gc_alloc_table_byte_len;
+            #if MICROPY_GC_INCREMENTAL
+            if (MP_STATE_MEM(gc_sweep_pending)) {
+                // only the swept part of the heap is known to be free
+                end_atb = area->gc_sweep_block / BLOCKS_PER_ATB;
+            }
+            #endif
+            n_free = area->gc_scan_n_free;
+            for (i = area->gc_scan_atb_index; i < end_atb; i++) {
+                byte a = area->gc_alloc_table_start[i];
+                if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
+                if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
+                if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
+                if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+            }
+            // a sweep step may free more blocks right after these, carry on from here
+            area->gc_scan_atb_index = i;
+            area->gc_scan_n_free = n_free;
         }
 
+        #if MICROPY_GC_INCREMENTAL
+        if (MP_STATE_MEM(gc_sweep_pending)) {
+            // sweep some more and carry on looking from where we stopped, the run of free
+            // blocks found so far stays valid
+            mp_uint_t start_us = mp_hal_ticks_us();
+            gc_sweep_continue(MICROPY_GC_SWEEP_STEP_BLOCKS);
+            gc_stats_add_pause(start_us);
+            continue;
+        }
+        #endif
+
         GC_EXIT();
         // nothing found!
         if (collected) {
@@ -488,6 +805,7 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         gc_collect();
         collected = 1;
         GC_ENTER();
+        gc_alloc_scan_reset();
     }
 
     // found, ending at block i inclusive
@@ -502,27 +820,33 @@ found:
     // before this one.  Also, whenever we free or shink a block we must check
     // if this index needs adjusting (see gc_realloc and gc_free).
     if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
+        area->gc_last_free_atb_index = (i + 1) / BLOCKS_PER_ATB;
     }
 
     // mark first block as used head
-    ATB_FREE_TO_HEAD(start_block);
+    ATB_FREE_TO_HEAD(area, start_block);
 
     // mark rest of blocks as used tail
     // TODO for a run of many blocks can make this more efficient
     for (size_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+        ATB_FREE_TO_TAIL(area, bl);
     }
 
     // get pointer to first block
     // we must create this pointer before unlocking the GC so a collection can find it
-    void *ret_ptr = (void*)(MP_STATE_MEM(gc_pool_start) + start_block * BYTES_PER_BLOCK);
+    void *ret_ptr = (void*)(area->gc_pool_start + start_block * BYTES_PER_BLOCK);
     DEBUG_printf("gc_alloc(%p)\n", ret_ptr);
 
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) += n_blocks;
     #endif
 
+    #if MICROPY_GC_ALLOC_PROFILE
+    if (MP_STATE_MEM(gc_prof).enabled) {
+        gc_prof_record(n_bytes, n_blocks);
+    }
+    #endif
+
     GC_EXIT();
 
     #if MICROPY_GC_CONSERVATIVE_CLEAR
@@ -543,7 +867,7 @@ found:
         ((mp_obj_base_t*)ret_ptr)->type = NULL;
         // set mp_obj flag only if it has a finaliser
         GC_ENTER();
-        FTB_SET(start_block);
+        FTB_SET(area, start_block);
         GC_EXIT();
     }
     #else
@@ -583,24 +907,25 @@ void gc_free(void *ptr) {
         GC_EXIT();
     } else {
         // get the GC block number corresponding to this pointer
-        assert(VERIFY_PTR(ptr));
-        size_t block = BLOCK_FROM_PTR(ptr);
-        assert(ATB_GET_KIND(block) == AT_HEAD);
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        assert(area != NULL);
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        assert(ATB_IS_USED_HEAD(area, block));
 
         #if MICROPY_ENABLE_FINALISER
-        FTB_CLEAR(block);
+        FTB_CLEAR(area, block);
         #endif
 
         // set the last_free pointer to this block if it's earlier in the heap
-        if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
+        if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
         }
 
         // free head and all of its tail blocks
         do {
-            ATB_ANY_TO_FREE(block);
+            ATB_ANY_TO_FREE(area, block);
             block += 1;
-        } while (ATB_GET_KIND(block) == AT_TAIL);
+        } while (ATB_GET_KIND(area, block) == AT_TAIL);
 
         GC_EXIT();
 
@@ -612,14 +937,15 @@ void gc_free(void *ptr) {
 
 size_t gc_nbytes(const void *ptr) {
     GC_ENTER();
-    if (VERIFY_PTR(ptr)) {
-        size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_IS_USED_HEAD(area, block)) {
             // work out number of consecutive blocks in the chain starting with this on
             size_t n_blocks = 0;
             do {
                 n_blocks += 1;
-            } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+            } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
             GC_EXIT();
             return n_blocks * BYTES_PER_BLOCK;
         }
@@ -642,7 +968,7 @@ void *gc_realloc(void *ptr, mp_uint_t n_bytes) {
             has_finaliser = false;
         } else {
 #if MICROPY_ENABLE_FINALISER
-            has_finaliser = FTB_GET(BLOCK_FROM_PTR((mp_uint_t)ptr));
+            has_finaliser = FTB_GET(area, BLOCK_FROM_PTR(area, (mp_uint_t)ptr));
 #else
             has_finaliser = false;
 #endif
@@ -681,9 +1007,10 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     // get the GC block number corresponding to this pointer
-    assert(VERIFY_PTR(ptr));
-    size_t block = BLOCK_FROM_PTR(ptr);
-    assert(ATB_GET_KIND(block) == AT_HEAD);
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    assert(area != NULL);
+    size_t block = BLOCK_FROM_PTR(area, ptr);
+    assert(ATB_IS_USED_HEAD(area, block));
 
     // compute number of new blocks that are requested
     size_t new_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
@@ -696,9 +1023,9 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     // efficiently shrink it (see below for shrinking code).
     size_t n_free   = 0;
     size_t n_blocks = 1; // counting HEAD block
-    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
     for (size_t bl = block + n_blocks; bl < max_block; bl++) {
-        byte block_type = ATB_GET_KIND(bl);
+        byte block_type = ATB_GET_KIND(area, bl);
         if (block_type == AT_TAIL) {
             n_blocks++;
             continue;
@@ -724,12 +1051,12 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks < n_blocks) {
         // free unneeded tail blocks
         for (size_t bl = block + new_blocks, count = n_blocks - new_blocks; count > 0; bl++, count--) {
-            ATB_ANY_TO_FREE(bl);
+            ATB_ANY_TO_FREE(area, bl);
         }
 
         // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
+        if ((block + new_blocks) / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = (block + new_blocks) / BLOCKS_PER_ATB;
         }
 
         GC_EXIT();
@@ -745,8 +1072,8 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks <= n_blocks + n_free) {
         // mark few more blocks as used tail
         for (size_t bl = block + n_blocks; bl < block + new_blocks; bl++) {
-            assert(ATB_GET_KIND(bl) == AT_FREE);
-            ATB_FREE_TO_TAIL(bl);
+            assert(ATB_GET_KIND(area, bl) == AT_FREE);
+            ATB_FREE_TO_TAIL(area, bl);
         }
 
         GC_EXIT();
@@ -767,7 +1094,7 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     #if MICROPY_ENABLE_FINALISER
-    bool ftb_state = FTB_GET(block);
+    bool ftb_state = FTB_GET(area, block);
     #else
     bool ftb_state = false;
     #endif
@@ -806,108 +1133,110 @@ void gc_dump_info(void) {
 void gc_dump_alloc_table(void) {
     GC_ENTER();
     static const size_t DUMP_BYTES_PER_LINE = 64;
-    #if !EXTENSIVE_HEAP_PROFILING
-    // When comparing heap output we don't want to print the starting
-    // pointer of the heap because it changes from run to run.
-    mp_printf(&mp_plat_print, "GC memory layout; from %p:", MP_STATE_MEM(gc_pool_start));
-    #endif
-    for (size_t bl = 0; bl < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; bl++) {
-        if (bl % DUMP_BYTES_PER_LINE == 0) {
-            // a new line of blocks
-            {
-                // check if this line contains only free blocks
-                size_t bl2 = bl;
-                while (bl2 < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB && ATB_GET_KIND(bl2) == AT_FREE) {
-                    bl2++;
-                }
-                if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
-                    // there are at least 2 lines containing only free blocks, so abbreviate their printing
-                    mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
-                    bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
-                    if (bl >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
-                        // got to end of heap
-                        break;
-                    }
-                }
-            }
-            // print header for new line of blocks
-            // (the cast to uint32_t is for 16-bit ports)
-            //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
-        }
-        int c = ' ';
-        switch (ATB_GET_KIND(bl)) {
-            case AT_FREE: c = '.'; break;
-            /* this prints out if the object is reachable from BSS or STACK (for unix only)
-            case AT_HEAD: {
-                c = 'h';
-                void **ptrs = (void**)(void*)&mp_state_ctx;
-                mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
-                for (mp_uint_t i = 0; i < len; i++) {
-                    mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                    if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                        c = 'B';
-                        break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if !EXTENSIVE_HEAP_PROFILING
+        // When comparing heap output we don't want to print the starting
+        // pointer of the heap because it changes from run to run.
+        mp_printf(&mp_plat_print, "GC memory layout; from %p:", area->gc_pool_start);
+        #endif
+        for (size_t bl = 0; bl < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; bl++) {
+            if (bl % DUMP_BYTES_PER_LINE == 0) {
+                // a new line of blocks
+                {
+                    // check if this line contains only free blocks
+                    size_t bl2 = bl;
+                    while (bl2 < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB && ATB_GET_KIND(area, bl2) == AT_FREE) {
+                        bl2++;
                     }
-                }
-                if (c == 'h') {
-                    ptrs = (void**)&c;
-                    len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
-                    for (mp_uint_t i = 0; i < len; i++) {
-                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                            c = 'S';
+                    if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
+                        // there are at least 2 lines containing only free blocks, so abbreviate their printing
+                        mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
+                        bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
+                        if (bl >= area->gc_alloc_table_byte_len * BLOCKS_PER_ATB) {
+                            // got to end of heap
                             break;
                         }
                     }
                 }
-                break;
+                // print header for new line of blocks
+                // (the cast to uint32_t is for 16-bit ports)
+                //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(area, bl) & (uint32_t)0xfffff));
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
             }
-            */
-            /* this prints the uPy object type of the head block */
-            case AT_HEAD: {
-                void **ptr = (void**)(MP_STATE_MEM(gc_pool_start) + bl * BYTES_PER_BLOCK);
-                if (*ptr == &mp_type_tuple) { c = 'T'; }
-                else if (*ptr == &mp_type_list) { c = 'L'; }
-                else if (*ptr == &mp_type_dict) { c = 'D'; }
-                else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
-                #if MICROPY_PY_BUILTINS_BYTEARRAY
-                else if (*ptr == &mp_type_bytearray) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_ARRAY
-                else if (*ptr == &mp_type_array) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_BUILTINS_FLOAT
-                else if (*ptr == &mp_type_float) { c = 'F'; }
-                #endif
-                else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
-                else if (*ptr == &mp_type_module) { c = 'M'; }
-                else {
+            int c = ' ';
+            switch (ATB_GET_KIND(area, bl)) {
+                case AT_FREE: c = '.'; break;
+                /* this prints out if the object is reachable from BSS or STACK (for unix only)
+                case AT_HEAD: {
                     c = 'h';
-                    #if 0
-                    // This code prints "Q" for qstr-pool data, and "q" for qstr-str
-                    // data.  It can be useful to see how qstrs are being allocated,
-                    // but is disabled by default because it is very slow.
-                    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
-                        if ((qstr_pool_t*)ptr == pool) {
-                            c = 'Q';
+                    void **ptrs = (void**)(void*)&mp_state_ctx;
+                    mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
+                    for (mp_uint_t i = 0; i < len; i++) {
+                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                        if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                            c = 'B';
                             break;
                         }
-                        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-                            if ((const byte*)ptr == *q) {
-                                c = 'q';
+                    }
+                    if (c == 'h') {
+                        ptrs = (void**)&c;
+                        len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
+                        for (mp_uint_t i = 0; i < len; i++) {
+                            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                            if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                                c = 'S';
                                 break;
                             }
                         }
                     }
+                    break;
+                }
+                */
+                /* this prints the uPy object type of the head block */
+                case AT_HEAD: {
+                    void **ptr = (void**)(area->gc_pool_start + bl * BYTES_PER_BLOCK);
+                    if (*ptr == &mp_type_tuple) { c = 'T'; }
+                    else if (*ptr == &mp_type_list) { c = 'L'; }
+                    else if (*ptr == &mp_type_dict) { c = 'D'; }
+                    else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
+                    #if MICROPY_PY_BUILTINS_BYTEARRAY
+                    else if (*ptr == &mp_type_bytearray) { c = 'A'; }
+                    #endif
+                    #if MICROPY_PY_ARRAY
+                    else if (*ptr == &mp_type_array) { c = 'A'; }
                     #endif
+                    #if MICROPY_PY_BUILTINS_FLOAT
+                    else if (*ptr == &mp_type_float) { c = 'F'; }
+                    #endif
+                    else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
+                    else if (*ptr == &mp_type_module) { c = 'M'; }
+                    else {
+                        c = 'h';
+                        #if 0
+                        // This code prints "Q" for qstr-pool data, and "q" for qstr-str
+                        // data.  It can be useful to see how qstrs are being allocated,
+                        // but is disabled by default because it is very slow.
+                        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
+                            if ((qstr_pool_t*)ptr == pool) {
+                                c = 'Q';
+                                break;
+                            }
+                            for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+                                if ((const byte*)ptr == *q) {
+                                    c = 'q';
+                                    break;
+                                }
+                            }
+                        }
+                        #endif
+                    }
+                    break;
                 }
-                break;
+                case AT_TAIL: c = '='; break;
+                case AT_MARK: c = 'm'; break;
             }
-            case AT_TAIL: c = '='; break;
-            case AT_MARK: c = 'm'; break;
+            mp_printf(&mp_plat_print, "%c", c);
         }
-        mp_printf(&mp_plat_print, "%c", c);
     }
     mp_print_str(&mp_plat_print, "\n");
     GC_EXIT();
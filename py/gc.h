@@ -33,6 +33,19 @@
 
 void gc_init(void *start, void *end);
 
+#if MICROPY_GC_SPLIT_HEAP
+// Used to add an additional memory area to the heap.
+void gc_add(void *start, void *end);
+#endif
+
+#if MICROPY_GC_ALLOC_PROFILE
+// start (clearing the counts) or stop the allocation profiler
+void gc_prof_enable(bool enable);
+// count the free runs of the heap by power of two number of blocks, returns
+// the size in bytes of the largest one
+size_t gc_free_runs(size_t *hist, size_t n_buckets);
+#endif
+
 // These lock/unlock functions can be nested.
 // They can be used to prevent the GC from allocating/freeing.
 void gc_lock(void);
@@ -48,6 +61,13 @@ void gc_collect_end(void);
 // Use this function to sweep the whole heap and run all finalisers
 void gc_sweep_all(void);
 
+#if MICROPY_GC_INCREMENTAL
+// Sweep at least n_blocks of a pending sweep, returns true if more is left.
+// Meant to be called while the program is idle.
+bool gc_sweep_step(size_t n_blocks);
+void gc_sweep_finish(void);
+#endif
+
 enum {
     GC_ALLOC_FLAG_HAS_FINALISER = 1,
 };
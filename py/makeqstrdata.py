@@ -344,6 +344,27 @@ def print_qstr_data(qcfgs, qstrs):
         qbytes = make_bytes(cfg_bytes_len, cfg_bytes_hash, qstr)
         print('QDEF(MP_QSTR_%s, %s)' % (ident, qbytes))
 
+    if int(qcfgs.get('INDEX', '0')):
+        print_qstr_index(cfg_bytes_hash, qstrs)
+
+def print_qstr_index(cfg_bytes_hash, qstrs):
+    # open addressing hash index of the qstrs above, at most half full, the
+    # probing must match qstr_index_find in qstr.c
+    size = 1
+    while size < 2 * (len(qstrs) + 1):
+        size <<= 1
+    table = [None] * size
+    for order, ident, qstr in sorted(qstrs.values(), key=lambda x: x[0]):
+        slot = compute_hash(bytes_cons(qstr, 'utf8'), cfg_bytes_hash) & (size - 1)
+        while table[slot] is not None:
+            slot = (slot + 1) & (size - 1)
+        table[slot] = ident
+    print('')
+    print('#ifdef QINDEX')
+    for ident in table:
+        print('QINDEX(MP_QSTR_%s)' % (ident if ident is not None else 'NULL'))
+    print('#endif')
+
 def do_work(infiles):
     qcfgs, qstrs = parse_input_headers(infiles)
     print_qstr_data(qcfgs, qstrs)
@@ -118,10 +118,9 @@ void mp_map_clear(mp_map_t *map) {
     map->table = NULL;
 }
 
-STATIC void mp_map_rehash(mp_map_t *map) {
+STATIC void mp_map_resize(mp_map_t *map, size_t new_alloc) {
     size_t old_alloc = map->alloc;
-    size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->alloc + 1);
-    DEBUG_printf("mp_map_rehash(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
+    DEBUG_printf("mp_map_resize(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
     mp_map_elem_t *old_table = map->table;
     mp_map_elem_t *new_table = m_new0(mp_map_elem_t, new_alloc);
     // If we reach this point, table resizing succeeded, now we can edit the old map.
@@ -137,13 +136,36 @@ STATIC void mp_map_rehash(mp_map_t *map) {
     m_del(mp_map_elem_t, old_table, old_alloc);
 }
 
+STATIC void mp_map_rehash(mp_map_t *map) {
+    mp_map_resize(map, get_hash_alloc_greater_or_equal_to(map->alloc + 1));
+}
+
+// Make room for n entries at once, so that filling the map doesn't rehash it
+// again and again, leaving the old tables behind as garbage.
+void mp_map_reserve(mp_map_t *map, size_t n) {
+    if (!map->is_fixed && !map->is_ordered && n > map->alloc) {
+        mp_map_resize(map, get_hash_alloc_greater_or_equal_to(n));
+    }
+}
+
+#if MICROPY_OPT_MAP_LOOKUP_CACHE
+// The cache is shared by all the maps and only gives a hint: the slot it
+// points to is used only if it holds the very same key, anything else goes
+// through the normal lookup. The low bits of the key are the object tag.
+#define MAP_CACHE_ENTRY(index) (MP_STATE_VM(map_lookup_cache)[(((uintptr_t)(index)) >> 2) % MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE])
+#define MAP_CACHE_GET(map, index) (&(map)->table[MAP_CACHE_ENTRY(index) % (map)->alloc])
+#define MAP_CACHE_SET(index, pos) do { MAP_CACHE_ENTRY(index) = (pos) & 0xff; } while (0)
+#else
+#define MAP_CACHE_SET(index, pos)
+#endif
+
 // MP_MAP_LOOKUP behaviour:
 //  - returns NULL if not found, else the slot it was found in with key,value non-null
 // MP_MAP_LOOKUP_ADD_IF_NOT_FOUND behaviour:
 //  - returns slot, with key non-null and value=MP_OBJ_NULL if it was added
 // MP_MAP_LOOKUP_REMOVE_IF_FOUND behaviour:
 //  - returns NULL if not found, else the slot if was found in with key null and value non-null
-mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
+mp_map_elem_t *MICROPY_WRAP_MP_MAP_LOOKUP(mp_map_lookup)(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
     // If the map is a fixed array then we must only be called for a lookup
     assert(!map->is_fixed || lookup_kind == MP_MAP_LOOKUP);
 
@@ -166,6 +188,16 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
+    #if MICROPY_OPT_MAP_LOOKUP_CACHE
+    // a removal has to go through the normal path to update the map
+    if (lookup_kind != MP_MAP_LOOKUP_REMOVE_IF_FOUND && map->alloc != 0) {
+        mp_map_elem_t *slot = MAP_CACHE_GET(map, index);
+        if (slot->key == index) {
+            return slot;
+        }
+    }
+    #endif
+
     // if the map is an ordered array then we must do a brute force linear search
     if (map->is_ordered) {
         for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
@@ -180,8 +212,10 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     elem = &map->table[map->used];
                     elem->key = MP_OBJ_NULL;
                     elem->value = value;
+                    return elem;
                 }
                 #endif
+                MAP_CACHE_SET(index, elem - &map->table[0]);
                 return elem;
             }
         }
@@ -197,6 +231,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
         mp_map_elem_t *elem = map->table + map->used++;
         elem->key = index;
+        MAP_CACHE_SET(index, elem - &map->table[0]);
         if (!mp_obj_is_qstr(index)) {
             map->all_keys_are_qstrs = 0;
         }
@@ -241,6 +276,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                 if (!mp_obj_is_qstr(index)) {
                     map->all_keys_are_qstrs = 0;
                 }
+                MAP_CACHE_SET(index, avail_slot - &map->table[0]);
                 return avail_slot;
             } else {
                 return NULL;
@@ -263,6 +299,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     slot->key = MP_OBJ_SENTINEL;
                 }
                 // keep slot->value so that caller can access it if needed
+            } else {
+                MAP_CACHE_SET(index, pos);
             }
             return slot;
         }
@@ -281,6 +319,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     if (!mp_obj_is_qstr(index)) {
                         map->all_keys_are_qstrs = 0;
                     }
+                    MAP_CACHE_SET(index, avail_slot - &map->table[0]);
                     return avail_slot;
                 } else {
                     // not enough room in table, rehash it
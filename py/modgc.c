@@ -24,15 +24,22 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/mpstate.h"
 #include "py/obj.h"
 #include "py/gc.h"
+#include "py/bc.h"
+#include "py/mpprint.h"
 
 #if MICROPY_PY_GC && MICROPY_ENABLE_GC
 
 // collect(): run a garbage collection
 STATIC mp_obj_t py_gc_collect(void) {
     gc_collect();
+    #if MICROPY_GC_INCREMENTAL
+    gc_sweep_finish();
+    #endif
 #if MICROPY_PY_GC_COLLECT_RETVAL
     return MP_OBJ_NEW_SMALL_INT(MP_STATE_MEM(gc_collected));
 #else
@@ -95,6 +102,161 @@ STATIC mp_obj_t gc_threshold(size_t n_args, const mp_obj_t *args) {
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_threshold_obj, 0, 1, gc_threshold);
 #endif
 
+#if MICROPY_GC_INCREMENTAL
+// incremental([enable]): get or set whether automatic collections sweep lazily
+STATIC mp_obj_t gc_incremental(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_bool(MP_STATE_MEM(gc_incremental));
+    }
+    MP_STATE_MEM(gc_incremental) = mp_obj_is_true(args[0]);
+    if (!MP_STATE_MEM(gc_incremental)) {
+        gc_sweep_finish();
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_incremental_obj, 0, 1, gc_incremental);
+
+// stats(): (collections, pauses, last pause us, max pause us, total pause us)
+STATIC mp_obj_t gc_stats(void) {
+    gc_stats_t stats = MP_STATE_MEM(gc_stats);
+    mp_obj_t tuple[5] = {
+        mp_obj_new_int_from_uint(stats.collections),
+        mp_obj_new_int_from_uint(stats.pauses),
+        mp_obj_new_int_from_uint(stats.last_pause_us),
+        mp_obj_new_int_from_uint(stats.max_pause_us),
+        mp_obj_new_int_from_uint(stats.total_pause_us),
+    };
+    return mp_obj_new_tuple(5, tuple);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_stats_obj, gc_stats);
+#endif
+
+#if MICROPY_GC_ALLOC_PROFILE
+#define GC_PROF_FREE_BUCKETS (12)
+
+// profile([enable]): get whether the allocation profiler runs, start (clearing
+// the counts) or stop it
+STATIC mp_obj_t gc_profile(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_bool(MP_STATE_MEM(gc_prof).enabled);
+    }
+    gc_prof_enable(mp_obj_is_true(args[0]));
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_profile_obj, 0, 1, gc_profile);
+
+// the sites in use, the ones with most bytes first
+STATIC size_t gc_prof_sorted_sites(size_t *order) {
+    const gc_prof_t *prof = &MP_STATE_MEM(gc_prof);
+    size_t n = 0;
+    for (size_t i = 0; i < MICROPY_GC_ALLOC_PROFILE_SITES; i++) {
+        if (prof->samples[i] == 0) {
+            continue;
+        }
+        size_t j = n++;
+        for (; j > 0 && prof->bytes[order[j - 1]] < prof->bytes[i]; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    return n;
+}
+
+STATIC mp_obj_t gc_prof_hist_tuple(const size_t *hist, size_t n) {
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(n, NULL));
+    for (size_t i = 0; i < n; i++) {
+        t->items[i] = mp_obj_new_int_from_uint(hist[i]);
+    }
+    return MP_OBJ_FROM_PTR(t);
+}
+
+// profile_data(): (sites, sizes, largest free, free runs)
+// sites is a list of (function, file, allocations, bytes), estimated from the
+// samples, sizes counts all the allocations and free runs the free chunks of
+// the heap, both by power of two number of blocks
+STATIC mp_obj_t gc_profile_data(void) {
+    #if MICROPY_GC_INCREMENTAL
+    gc_sweep_finish();
+    #endif
+    size_t order[MICROPY_GC_ALLOC_PROFILE_SITES];
+    size_t size_hist[GC_PROF_SIZE_BUCKETS];
+    size_t samples[MICROPY_GC_ALLOC_PROFILE_SITES];
+    size_t bytes[MICROPY_GC_ALLOC_PROFILE_SITES];
+    size_t free_hist[GC_PROF_FREE_BUCKETS];
+    // take a copy first, the profiler counts the objects created below
+    const gc_prof_t *prof = &MP_STATE_MEM(gc_prof);
+    memcpy(size_hist, prof->size_hist, sizeof(size_hist));
+    memcpy(samples, prof->samples, sizeof(samples));
+    memcpy(bytes, prof->bytes, sizeof(bytes));
+    size_t n = gc_prof_sorted_sites(order);
+    size_t max_free = gc_free_runs(free_hist, GC_PROF_FREE_BUCKETS);
+
+    mp_obj_t sites = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < n; i++) {
+        qstr name, file;
+        mp_bytecode_get_names(MP_STATE_VM(gc_prof_sites)[order[i]], &name, &file);
+        mp_obj_t site[4] = {
+            MP_OBJ_NEW_QSTR(name),
+            MP_OBJ_NEW_QSTR(file),
+            mp_obj_new_int_from_uint(samples[order[i]] * MICROPY_GC_ALLOC_PROFILE_SAMPLE),
+            mp_obj_new_int_from_uint(bytes[order[i]] * MICROPY_GC_ALLOC_PROFILE_SAMPLE),
+        };
+        mp_obj_list_append(sites, mp_obj_new_tuple(4, site));
+    }
+    mp_obj_t tuple[4] = {
+        sites,
+        gc_prof_hist_tuple(size_hist, GC_PROF_SIZE_BUCKETS),
+        mp_obj_new_int_from_uint(max_free),
+        gc_prof_hist_tuple(free_hist, GC_PROF_FREE_BUCKETS),
+    };
+    return mp_obj_new_tuple(4, tuple);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_profile_data_obj, gc_profile_data);
+
+STATIC void gc_prof_print_hist(const char *title, const size_t *hist, size_t n) {
+    mp_printf(&mp_plat_print, "%s (blocks):", title);
+    for (size_t i = 0; i < n; i++) {
+        if (hist[i] != 0) {
+            if (i == 0) {
+                mp_printf(&mp_plat_print, " 1: %u", (uint)hist[i]);
+            } else if (i == n - 1) {
+                mp_printf(&mp_plat_print, " %u+: %u", 1 << i, (uint)hist[i]);
+            } else {
+                mp_printf(&mp_plat_print, " %u-%u: %u", 1 << i, (2 << i) - 1, (uint)hist[i]);
+            }
+        }
+    }
+    mp_print_str(&mp_plat_print, "\n");
+}
+
+// profile_dump(): print the allocation profile and the heap fragmentation
+STATIC mp_obj_t gc_profile_dump(void) {
+    #if MICROPY_GC_INCREMENTAL
+    gc_sweep_finish();
+    #endif
+    const gc_prof_t *prof = &MP_STATE_MEM(gc_prof);
+    size_t order[MICROPY_GC_ALLOC_PROFILE_SITES];
+    size_t n = gc_prof_sorted_sites(order);
+    mp_printf(&mp_plat_print, "allocations, 1 in %u sampled:\n", MICROPY_GC_ALLOC_PROFILE_SAMPLE);
+    mp_printf(&mp_plat_print, "%10s %8s  function\n", "bytes", "allocs");
+    for (size_t i = 0; i < n; i++) {
+        qstr name, file;
+        mp_bytecode_get_names(MP_STATE_VM(gc_prof_sites)[order[i]], &name, &file);
+        mp_printf(&mp_plat_print, "%10u %8u  %q (%q)\n",
+            (uint)(prof->bytes[order[i]] * MICROPY_GC_ALLOC_PROFILE_SAMPLE),
+            (uint)(prof->samples[order[i]] * MICROPY_GC_ALLOC_PROFILE_SAMPLE), name, file);
+    }
+    gc_prof_print_hist("allocation sizes", prof->size_hist, GC_PROF_SIZE_BUCKETS);
+
+    size_t free_hist[GC_PROF_FREE_BUCKETS];
+    size_t max_free = gc_free_runs(free_hist, GC_PROF_FREE_BUCKETS);
+    gc_prof_print_hist("free runs", free_hist, GC_PROF_FREE_BUCKETS);
+    mp_printf(&mp_plat_print, "largest free block: %u bytes\n", (uint)max_free);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_profile_dump_obj, gc_profile_dump);
+#endif
+
 STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_gc) },
     { MP_ROM_QSTR(MP_QSTR_collect), MP_ROM_PTR(&gc_collect_obj) },
@@ -106,6 +268,15 @@ STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     #if MICROPY_GC_ALLOC_THRESHOLD
     { MP_ROM_QSTR(MP_QSTR_threshold), MP_ROM_PTR(&gc_threshold_obj) },
     #endif
+    #if MICROPY_GC_INCREMENTAL
+    { MP_ROM_QSTR(MP_QSTR_incremental), MP_ROM_PTR(&gc_incremental_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&gc_stats_obj) },
+    #endif
+    #if MICROPY_GC_ALLOC_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile), MP_ROM_PTR(&gc_profile_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_data), MP_ROM_PTR(&gc_profile_data_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_dump), MP_ROM_PTR(&gc_profile_dump_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_gc_globals, mp_module_gc_globals_table);
@@ -31,6 +31,7 @@
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "py/mphal.h"
+#include "py/bc.h"
 
 // Various builtins specific to MicroPython runtime,
 // living in micropython module
@@ -155,6 +156,91 @@ STATIC mp_obj_t mp_micropython_kbd_intr(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_kbd_intr_obj, 1, 2, mp_micropython_kbd_intr);
 #endif
 
+#if MICROPY_PY_MICROPYTHON_PROFILE
+// profile(hz): start sampling at hz, dropping the previous profile, profile(0) stops
+STATIC mp_obj_t mp_micropython_profile(mp_obj_t hz_in) {
+    mp_int_t hz = mp_obj_get_int(hz_in);
+    if (hz == 0) {
+        mp_hal_prof_stop();
+    } else if (hz < 0 || !mp_hal_prof_start(hz)) {
+        mp_raise_ValueError("unsupported sampling rate");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_profile_obj, mp_micropython_profile);
+
+// the sites sampled, the ones with most samples first
+STATIC size_t mp_micropython_profile_read(const uint8_t **sites, size_t *samples, size_t *in_python, size_t *total) {
+    size_t n = mp_hal_prof_read(sites, samples, MICROPY_PY_MICROPYTHON_PROFILE_SITES, in_python, total);
+    for (size_t i = 1; i < n; i++) {
+        const uint8_t *site = sites[i];
+        size_t count = samples[i];
+        size_t j = i;
+        for (; j > 0 && samples[j - 1] < count; j--) {
+            sites[j] = sites[j - 1];
+            samples[j] = samples[j - 1];
+        }
+        sites[j] = site;
+        samples[j] = count;
+    }
+    return n;
+}
+
+// profile_data(): (sites, samples in python, samples), sites is a list of
+// (function, file, samples)
+STATIC mp_obj_t mp_micropython_profile_data(void) {
+    const uint8_t *sites[MICROPY_PY_MICROPYTHON_PROFILE_SITES];
+    size_t samples[MICROPY_PY_MICROPYTHON_PROFILE_SITES];
+    size_t in_python, total;
+    size_t n = mp_micropython_profile_read(sites, samples, &in_python, &total);
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < n; i++) {
+        qstr name, file;
+        mp_bytecode_get_names(sites[i], &name, &file);
+        mp_obj_t site[3] = {
+            MP_OBJ_NEW_QSTR(name),
+            MP_OBJ_NEW_QSTR(file),
+            mp_obj_new_int_from_uint(samples[i]),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(3, site));
+    }
+    mp_obj_t tuple[3] = {
+        list,
+        mp_obj_new_int_from_uint(in_python),
+        mp_obj_new_int_from_uint(total),
+    };
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_profile_data_obj, mp_micropython_profile_data);
+
+// profile_dump(): print the functions sampled, with their share of the time spent in Python
+STATIC mp_obj_t mp_micropython_profile_dump(void) {
+    const uint8_t *sites[MICROPY_PY_MICROPYTHON_PROFILE_SITES];
+    size_t samples[MICROPY_PY_MICROPYTHON_PROFILE_SITES];
+    size_t in_python, total;
+    size_t n = mp_micropython_profile_read(sites, samples, &in_python, &total);
+
+    mp_printf(&mp_plat_print, "samples: %u, in Python: %u\n", (uint)total, (uint)in_python);
+    mp_printf(&mp_plat_print, "%8s %6s  function\n", "samples", "%");
+    size_t others = in_python;
+    for (size_t i = 0; i < n; i++) {
+        qstr name, file;
+        mp_bytecode_get_names(sites[i], &name, &file);
+        uint share = (uint)((uint64_t)samples[i] * 1000 / in_python);
+        mp_printf(&mp_plat_print, "%8u %4u.%u  %q (%q)\n", (uint)samples[i], share / 10, share % 10, name, file);
+        others -= samples[i];
+    }
+    if (others > 0) {
+        // outside of any function, or in the functions that found the table full
+        uint share = (uint)((uint64_t)others * 1000 / in_python);
+        mp_printf(&mp_plat_print, "%8u %4u.%u  <other>\n", (uint)others, share / 10, share % 10);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_profile_dump_obj, mp_micropython_profile_dump);
+#endif
+
 #if MICROPY_ENABLE_SCHEDULER
 STATIC mp_obj_t mp_micropython_schedule(mp_obj_t function, mp_obj_t arg) {
     if (!mp_sched_schedule(function, arg)) {
@@ -196,6 +282,11 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     #if MICROPY_KBD_EXCEPTION
     { MP_ROM_QSTR(MP_QSTR_kbd_intr), MP_ROM_PTR(&mp_micropython_kbd_intr_obj) },
     #endif
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile), MP_ROM_PTR(&mp_micropython_profile_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_data), MP_ROM_PTR(&mp_micropython_profile_data_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_dump), MP_ROM_PTR(&mp_micropython_profile_dump_obj) },
+    #endif
     #if MICROPY_ENABLE_SCHEDULER
     { MP_ROM_QSTR(MP_QSTR_schedule), MP_ROM_PTR(&mp_micropython_schedule_obj) },
     #endif
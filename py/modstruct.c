@@ -248,6 +248,214 @@ STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_pack_into);
 
+#if MICROPY_PY_STRUCT_STRUCT
+
+// Struct(fmt) parses the format once into a list of ops, one per item of the
+// format with its repeat count, so packing and unpacking skip the parsing and
+// calcsize() done by the functions above on every call.
+
+typedef struct _struct_op_t {
+    char type;
+    mp_uint_t cnt; // repeat count, or the length of the data for 's'
+} struct_op_t;
+
+typedef struct _mp_obj_struct_t {
+    mp_obj_base_t base;
+    mp_obj_t format;
+    size_t size;
+    size_t num_items;
+    size_t num_ops;
+    char fmt_type;
+    struct_op_t ops[];
+} mp_obj_struct_t;
+
+STATIC void struct_obj_unpack_into(const mp_obj_struct_t *self, byte *p, mp_obj_t *items) {
+    for (size_t i = 0; i < self->num_ops; i++) {
+        const struct_op_t *op = &self->ops[i];
+        if (op->type == 's') {
+            *items++ = mp_obj_new_bytes(p, op->cnt);
+            p += op->cnt;
+        } else {
+            for (mp_uint_t n = op->cnt; n > 0; n--) {
+                *items++ = mp_binary_get_val(self->fmt_type, op->type, &p);
+            }
+        }
+    }
+}
+
+STATIC byte *struct_obj_get_buf(const mp_obj_struct_t *self, mp_obj_t buf_in, mp_int_t offset, mp_uint_t flags) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, flags);
+    if (offset < 0) {
+        // negative offsets are relative to the end of the buffer
+        offset = (mp_int_t)bufinfo.len + offset;
+    }
+    if (offset < 0 || (size_t)offset + self->size > bufinfo.len) {
+        mp_raise_ValueError("buffer too small");
+    }
+    return (byte*)bufinfo.buf + offset;
+}
+
+STATIC mp_obj_t struct_obj_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    const char *fmt = mp_obj_str_get_str(args[0]);
+
+    // count the ops first, then store them
+    const char *f = fmt;
+    get_fmt_type(&f);
+    size_t num_ops = 0;
+    for (; *f; f++) {
+        if (unichar_isdigit(*f)) {
+            get_fmt_num(&f);
+        }
+        num_ops++;
+    }
+
+    mp_obj_struct_t *self = m_new_obj_var(mp_obj_struct_t, struct_op_t, num_ops);
+    self->base.type = type;
+    self->format = args[0];
+    self->num_items = calc_size_items(fmt, &self->size);
+    self->num_ops = num_ops;
+    self->fmt_type = get_fmt_type(&fmt);
+    for (size_t i = 0; i < num_ops; i++, fmt++) {
+        struct_op_t *op = &self->ops[i];
+        op->cnt = 1;
+        if (unichar_isdigit(*fmt)) {
+            op->cnt = get_fmt_num(&fmt);
+        }
+        op->type = *fmt;
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t struct_obj_pack_into_internal(const mp_obj_struct_t *self, byte *p, size_t n_args, const mp_obj_t *args) {
+    if (n_args != self->num_items) {
+        mp_raise_TypeError("wrong number of values");
+    }
+    for (size_t i = 0; i < self->num_ops; i++) {
+        const struct_op_t *op = &self->ops[i];
+        if (op->type == 's') {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(*args++, &bufinfo, MP_BUFFER_READ);
+            mp_uint_t to_copy = MIN(bufinfo.len, op->cnt);
+            memcpy(p, bufinfo.buf, to_copy);
+            memset(p + to_copy, 0, op->cnt - to_copy);
+            p += op->cnt;
+        } else {
+            for (mp_uint_t n = op->cnt; n > 0; n--) {
+                mp_binary_set_val(self->fmt_type, op->type, *args++, &p);
+            }
+        }
+    }
+    return mp_const_none;
+}
+
+STATIC mp_obj_t struct_obj_pack(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    vstr_t vstr;
+    vstr_init_len(&vstr, self->size);
+    memset(vstr.buf, 0, self->size);
+    struct_obj_pack_into_internal(self, (byte*)vstr.buf, n_args - 1, &args[1]);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack);
+
+STATIC mp_obj_t struct_obj_pack_into(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    byte *p = struct_obj_get_buf(self, args[1], mp_obj_get_int(args[2]), MP_BUFFER_WRITE);
+    return struct_obj_pack_into_internal(self, p, n_args - 3, &args[3]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack_into);
+
+// relaxed to "big enough" for unpack as well, like the unpack() function
+STATIC mp_obj_t struct_obj_unpack_from(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    byte *p = struct_obj_get_buf(self, args[1], (n_args > 2) ? mp_obj_get_int(args[2]) : 0, MP_BUFFER_READ);
+    mp_obj_tuple_t *res = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->num_items, NULL));
+    struct_obj_unpack_into(self, p, res->items);
+    return MP_OBJ_FROM_PTR(res);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_unpack_from_obj, 2, 3, struct_obj_unpack_from);
+
+typedef struct _mp_obj_struct_iter_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_struct_t *st;
+    mp_obj_t buf;
+    size_t pos;
+    mp_obj_tuple_t *res;
+} mp_obj_struct_iter_t;
+
+STATIC mp_obj_t struct_obj_iter_unpack_iternext(mp_obj_t self_in) {
+    mp_obj_struct_iter_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(self->buf, &bufinfo, MP_BUFFER_READ);
+    if (self->pos + self->st->size > bufinfo.len) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    struct_obj_unpack_into(self->st, (byte*)bufinfo.buf + self->pos, self->res->items);
+    self->pos += self->st->size;
+    return MP_OBJ_FROM_PTR(self->res);
+}
+
+// The same tuple is refilled and returned for every record (as uselect.ipoll()
+// does), it must be unpacked or copied before the next one is read.
+STATIC mp_obj_t struct_obj_iter_unpack(mp_obj_t self_in, mp_obj_t buf_in) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (self->size == 0 || bufinfo.len % self->size != 0) {
+        mp_raise_ValueError("buffer size not a multiple of the struct size");
+    }
+    mp_obj_struct_iter_t *iter = m_new_obj(mp_obj_struct_iter_t);
+    iter->base.type = &mp_type_polymorph_iter;
+    iter->iternext = struct_obj_iter_unpack_iternext;
+    iter->st = self;
+    iter->buf = buf_in;
+    iter->pos = 0;
+    iter->res = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->num_items, NULL));
+    return MP_OBJ_FROM_PTR(iter);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(struct_obj_iter_unpack_obj, struct_obj_iter_unpack);
+
+STATIC const mp_rom_map_elem_t struct_obj_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_pack), MP_ROM_PTR(&struct_obj_pack_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_obj_pack_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_iter_unpack), MP_ROM_PTR(&struct_obj_iter_unpack_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(struct_obj_locals_dict, struct_obj_locals_dict_table);
+
+STATIC void struct_obj_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // not a load
+        return;
+    }
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    if (attr == MP_QSTR_size) {
+        dest[0] = MP_OBJ_NEW_SMALL_INT(self->size);
+    } else if (attr == MP_QSTR_format) {
+        dest[0] = self->format;
+    } else {
+        // a type with an attr handler doesn't get its locals looked up
+        mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&struct_obj_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            mp_convert_member_lookup(self_in, self->base.type, elem->value, dest);
+        }
+    }
+}
+
+STATIC const mp_obj_type_t struct_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Struct,
+    .make_new = struct_obj_make_new,
+    .attr = struct_obj_attr,
+    .locals_dict = (mp_obj_dict_t*)&struct_obj_locals_dict,
+};
+
+#endif // MICROPY_PY_STRUCT_STRUCT
+
 STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ustruct) },
     { MP_ROM_QSTR(MP_QSTR_calcsize), MP_ROM_PTR(&struct_calcsize_obj) },
@@ -255,6 +463,9 @@ STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_pack_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_unpack_from_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_unpack_from_obj) },
+    #if MICROPY_PY_STRUCT_STRUCT
+    { MP_ROM_QSTR(MP_QSTR_Struct), MP_ROM_PTR(&struct_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_struct_globals, mp_module_struct_globals_table);
@@ -140,6 +140,43 @@ STATIC mp_obj_t mod_thread_stack_size(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_thread_stack_size_obj, 0, 1, mod_thread_stack_size);
 
+#if MICROPY_PY_THREAD_CORE_AFFINITY
+STATIC int mod_thread_get_core_arg(mp_obj_t core_in) {
+    mp_int_t core = mp_obj_get_int(core_in);
+    if (core < MP_THREAD_CORE_ANY || core > 1) {
+        mp_raise_ValueError("invalid core");
+    }
+    return core;
+}
+
+STATIC mp_obj_t mod_thread_core_affinity(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return MP_OBJ_NEW_SMALL_INT(mp_thread_get_default_core());
+    }
+    mp_thread_set_default_core(mod_thread_get_core_arg(args[0]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_thread_core_affinity_obj, 0, 1, mod_thread_core_affinity);
+
+STATIC mp_obj_t mod_thread_get_core(void) {
+    return MP_OBJ_NEW_SMALL_INT(mp_thread_get_core());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_thread_get_core_obj, mod_thread_get_core);
+
+STATIC mp_obj_t mod_thread_gil_release(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_int_from_uint(mp_thread_gil_release_min);
+    }
+    mp_int_t min_len = mp_obj_get_int(args[0]);
+    if (min_len < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_thread_gil_release_min = min_len;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_thread_gil_release_obj, 0, 1, mod_thread_gil_release);
+#endif
+
 typedef struct _thread_entry_args_t {
     mp_obj_dict_t *dict_locals;
     mp_obj_dict_t *dict_globals;
@@ -161,6 +198,10 @@ STATIC void *thread_entry(void *args_in) {
     mp_stack_set_top(&ts + 1); // need to include ts in root-pointer scan
     mp_stack_set_limit(args->stack_size);
 
+    #if MICROPY_PROF_CODE
+    ts.prof_code = NULL;
+    #endif
+
     #if MICROPY_ENABLE_PYSTACK
     // TODO threading and pystack is not fully supported, for now just make a small stack
     mp_obj_t mini_pystack[128];
@@ -211,13 +252,33 @@ STATIC void *thread_entry(void *args_in) {
     return NULL;
 }
 
+#if MICROPY_PY_THREAD_CORE_AFFINITY
+STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+#else
 STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args) {
+#endif
     // This structure holds the Python function and arguments for thread entry.
     // We copy all arguments into this structure to keep ownership of them.
     // We must be very careful about root pointers because this pointer may
     // disappear from our address space before the thread is created.
     thread_entry_args_t *th_args;
 
+    #if MICROPY_PY_THREAD_CORE_AFFINITY
+    // only the core can be given as keyword, the thread's own ones come in a dict
+    if (n_args > 3) {
+        mp_raise_TypeError(NULL);
+    }
+    int core = mp_thread_get_default_core();
+    for (size_t i = 0; i < kw_args->alloc; ++i) {
+        if (mp_map_slot_is_filled(kw_args, i)) {
+            if (kw_args->table[i].key != MP_OBJ_NEW_QSTR(MP_QSTR_core)) {
+                mp_raise_TypeError("unexpected keyword argument");
+            }
+            core = mod_thread_get_core_arg(kw_args->table[i].value);
+        }
+    }
+    #endif
+
     // get positional arguments
     size_t pos_args_len;
     mp_obj_t *pos_args_items;
@@ -260,11 +321,19 @@ STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args)
     th_args->fun = args[0];
 
     // spawn the thread!
+    #if MICROPY_PY_THREAD_CORE_AFFINITY
+    mp_thread_create_on_core(thread_entry, th_args, &th_args->stack_size, core);
+    #else
     mp_thread_create(thread_entry, th_args, &th_args->stack_size);
+    #endif
 
     return mp_const_none;
 }
+#if MICROPY_PY_THREAD_CORE_AFFINITY
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_thread_start_new_thread_obj, 2, mod_thread_start_new_thread);
+#else
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_thread_start_new_thread_obj, 2, 3, mod_thread_start_new_thread);
+#endif
 
 STATIC mp_obj_t mod_thread_exit(void) {
     nlr_raise(mp_obj_new_exception(&mp_type_SystemExit));
@@ -286,6 +355,12 @@ STATIC const mp_rom_map_elem_t mp_module_thread_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_start_new_thread), MP_ROM_PTR(&mod_thread_start_new_thread_obj) },
     { MP_ROM_QSTR(MP_QSTR_exit), MP_ROM_PTR(&mod_thread_exit_obj) },
     { MP_ROM_QSTR(MP_QSTR_allocate_lock), MP_ROM_PTR(&mod_thread_allocate_lock_obj) },
+    #if MICROPY_PY_THREAD_CORE_AFFINITY
+    { MP_ROM_QSTR(MP_QSTR_core_affinity), MP_ROM_PTR(&mod_thread_core_affinity_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_core), MP_ROM_PTR(&mod_thread_get_core_obj) },
+    { MP_ROM_QSTR(MP_QSTR_gil_release), MP_ROM_PTR(&mod_thread_gil_release_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ANY_CORE), MP_ROM_INT(MP_THREAD_CORE_ANY) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_thread_globals, mp_module_thread_globals_table);
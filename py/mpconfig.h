@@ -148,6 +148,43 @@
 #define MICROPY_GC_ALLOC_THRESHOLD (1)
 #endif
 
+// Whether the sweep after a collection can be left to later allocations and to idle
+// time, enabled at runtime by gc.incremental(). Needs mp_hal_ticks_us().
+#ifndef MICROPY_GC_INCREMENTAL
+#define MICROPY_GC_INCREMENTAL (0)
+#endif
+
+// Whether the heap can be made of several areas, more are added by gc_add().
+// Allocations of at least MICROPY_GC_SPLIT_HEAP_LARGE_BYTES go preferably to the
+// areas added, the first one is kept for the small objects touched most.
+#ifndef MICROPY_GC_SPLIT_HEAP
+#define MICROPY_GC_SPLIT_HEAP (0)
+#endif
+
+#ifndef MICROPY_GC_SPLIT_HEAP_LARGE_BYTES
+#define MICROPY_GC_SPLIT_HEAP_LARGE_BYTES (256)
+#endif
+
+// Number of blocks swept by gc_alloc() at a time while looking for free memory
+#ifndef MICROPY_GC_SWEEP_STEP_BLOCKS
+#define MICROPY_GC_SWEEP_STEP_BLOCKS (1024)
+#endif
+
+// Whether to build the allocation profiler (gc.profile()): when started,
+// one allocation in MICROPY_GC_ALLOC_PROFILE_SAMPLE is accounted to the
+// bytecode function running, up to MICROPY_GC_ALLOC_PROFILE_SITES of them.
+#ifndef MICROPY_GC_ALLOC_PROFILE
+#define MICROPY_GC_ALLOC_PROFILE (0)
+#endif
+
+#ifndef MICROPY_GC_ALLOC_PROFILE_SAMPLE
+#define MICROPY_GC_ALLOC_PROFILE_SAMPLE (16)
+#endif
+
+#ifndef MICROPY_GC_ALLOC_PROFILE_SITES
+#define MICROPY_GC_ALLOC_PROFILE_SITES (16)
+#endif
+
 // Number of bytes to allocate initially when creating new chunks to store
 // interned string data.  Smaller numbers lead to more chunks being needed
 // and more wastage at the end of the chunk.  Larger numbers lead to wasted
@@ -236,6 +273,13 @@
 #define MICROPY_QSTR_BYTES_IN_HASH (2)
 #endif
 
+// Whether to look qstrs up through open addressing hash indexes instead of
+// scanning the pools: one generated by makeqstrdata.py for the ROM pool and
+// one on the heap for the interned strings, 2 bytes per slot at most half full
+#ifndef MICROPY_QSTR_INDEX
+#define MICROPY_QSTR_INDEX (0)
+#endif
+
 // Avoid using C stack when making Python function calls. C stack still
 // may be used if there's no free heap.
 #ifndef MICROPY_STACKLESS
@@ -272,6 +316,13 @@
 #define MICROPY_PERSISTENT_CODE_SAVE (0)
 #endif
 
+// Whether to cache the compiled code of the scripts executed and the modules
+// imported from the filesystem, as <dir>/__pycache__/<name>.mpy
+// Requires MICROPY_PERSISTENT_CODE_LOAD, MICROPY_PERSISTENT_CODE_SAVE and MICROPY_VFS
+#ifndef MICROPY_PERSISTENT_CODE_CACHE
+#define MICROPY_PERSISTENT_CODE_CACHE (0)
+#endif
+
 // Whether generated code can persist independently of the VM/runtime instance
 // This is enabled automatically when needed by other features
 #ifndef MICROPY_PERSISTENT_CODE
@@ -318,13 +369,22 @@
 #define MICROPY_EMIT_XTENSA (0)
 #endif
 
+// Whether to emit Xtensa-Windowed native code
+#ifndef MICROPY_EMIT_XTENSAWIN
+#define MICROPY_EMIT_XTENSAWIN (0)
+#endif
+
 // Whether to enable the Xtensa inline assembler
 #ifndef MICROPY_EMIT_INLINE_XTENSA
 #define MICROPY_EMIT_INLINE_XTENSA (0)
 #endif
 
 // Convenience definition for whether any native emitter is enabled
-#define MICROPY_EMIT_NATIVE (MICROPY_EMIT_X64 || MICROPY_EMIT_X86 || MICROPY_EMIT_THUMB || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA)
+#define MICROPY_EMIT_NATIVE (MICROPY_EMIT_X64 || MICROPY_EMIT_X86 || MICROPY_EMIT_THUMB || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA || MICROPY_EMIT_XTENSAWIN)
+
+// Whether native functions keep their prelude in a bytes object in the const table,
+// needed when executable memory can't be read byte-wise
+#define MICROPY_EMIT_NATIVE_PRELUDE_AS_BYTES_OBJ (MICROPY_EMIT_XTENSAWIN)
 
 // Convenience definition for whether any inline assembler emitter is enabled
 #define MICROPY_EMIT_INLINE_ASM (MICROPY_EMIT_INLINE_THUMB || MICROPY_EMIT_INLINE_XTENSA)
@@ -442,6 +502,19 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether mp_map_lookup() remembers, per key, the slot a key was last found
+// in, so that repeated lookups of the same names skip the hashing or the
+// linear search of ordered maps.  Unlike the option above the bytecode stays
+// untouched, so it works with frozen bytecode in ROM and with any .mpy file.
+// Uses MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE bytes of RAM.
+#ifndef MICROPY_OPT_MAP_LOOKUP_CACHE
+#define MICROPY_OPT_MAP_LOOKUP_CACHE (0)
+#endif
+
+#ifndef MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE
+#define MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE (128)
+#endif
+
 // Whether to use fast versions of bitwise operations (and, or, xor) when the
 // arguments are both positive.  Increases Thumb2 code size by about 250 bytes.
 #ifndef MICROPY_OPT_MPZ_BITWISE
@@ -500,6 +573,16 @@
 #define MICROPY_ENABLE_GC (0)
 #endif
 
+// Hooks for the GC at the start of a collection and just before it is finished
+// (called with the GC lock held)
+#ifndef MICROPY_GC_HOOK_COLLECT_START
+#define MICROPY_GC_HOOK_COLLECT_START
+#endif
+
+#ifndef MICROPY_GC_HOOK_COLLECT_END
+#define MICROPY_GC_HOOK_COLLECT_END
+#endif
+
 // Whether to enable finalisers in the garbage collector (ie call __del__)
 #ifndef MICROPY_ENABLE_FINALISER
 #define MICROPY_ENABLE_FINALISER (0)
@@ -1021,6 +1104,20 @@ typedef double mp_float_t;
 #define MICROPY_PY_MICROPYTHON_STACK_USE (MICROPY_PY_MICROPYTHON_MEM_INFO)
 #endif
 
+// Whether to provide "micropython.profile", a sampling profiler of the
+// bytecode functions running. The port takes the samples from a timer
+// interrupt and implements the mp_hal_prof_* functions of py/mphal.h.
+#ifndef MICROPY_PY_MICROPYTHON_PROFILE
+#define MICROPY_PY_MICROPYTHON_PROFILE (0)
+#endif
+
+#ifndef MICROPY_PY_MICROPYTHON_PROFILE_SITES
+#define MICROPY_PY_MICROPYTHON_PROFILE_SITES (32)
+#endif
+
+// Whether each thread records the bytecode function it is running
+#define MICROPY_PROF_CODE (MICROPY_GC_ALLOC_PROFILE || MICROPY_PY_MICROPYTHON_PROFILE)
+
 // Whether to provide "array" module. Note that large chunk of the
 // underlying code is shared with "bytearray" builtin type, so to
 // get real savings, it should be disabled too.
@@ -1131,6 +1228,11 @@ typedef double mp_float_t;
 #define MICROPY_PY_STRUCT (1)
 #endif
 
+// Whether to provide "struct.Struct" class, a format parsed once for repeated use
+#ifndef MICROPY_PY_STRUCT_STRUCT
+#define MICROPY_PY_STRUCT_STRUCT (0)
+#endif
+
 // Whether to provide "sys" module
 #ifndef MICROPY_PY_SYS
 #define MICROPY_PY_SYS (1)
@@ -1188,6 +1290,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_USELECT (0)
 #endif
 
+// Whether the port waits for the objects backed by a descriptor in a single call,
+// see extmod/moduselect.h
+#ifndef MICROPY_PY_USELECT_PORT_FDS
+#define MICROPY_PY_USELECT_PORT_FDS (0)
+#endif
+
 // Whether to provide "utime" module functions implementation
 // in terms of mp_hal_* functions.
 #ifndef MICROPY_PY_UTIME_MP_HAL
@@ -1221,6 +1329,26 @@ typedef double mp_float_t;
 #define MICROPY_PY_THREAD_GIL_VM_DIVISOR (32)
 #endif
 
+// Whether the VM only hands the GIL over when another thread is waiting for it, and
+// then only once the holder has run for MICROPY_PY_THREAD_GIL_SLICE_US microseconds.
+// Replaces MICROPY_PY_THREAD_GIL_VM_DIVISOR. The port must provide
+// mp_thread_gil_waiters, mp_thread_gil_enter(), mp_thread_gil_slice_expired() and
+// mp_thread_gil_yield().
+#ifndef MICROPY_PY_THREAD_GIL_ADAPTIVE
+#define MICROPY_PY_THREAD_GIL_ADAPTIVE (0)
+#endif
+
+#ifndef MICROPY_PY_THREAD_GIL_SLICE_US
+#define MICROPY_PY_THREAD_GIL_SLICE_US (1000)
+#endif
+
+// Whether threads can be pinned to a CPU core, and native builtins can release the GIL
+// while processing large buffers. The port must provide mp_thread_create_on_core(),
+// mp_thread_get/set_default_core(), mp_thread_get_core() and mp_thread_gil_release_min.
+#ifndef MICROPY_PY_THREAD_CORE_AFFINITY
+#define MICROPY_PY_THREAD_CORE_AFFINITY (0)
+#endif
+
 // Extended modules
 
 #ifndef MICROPY_PY_UCTYPES
@@ -1233,14 +1361,31 @@ typedef double mp_float_t;
 #define MICROPY_PY_UCTYPES_NATIVE_C_TYPES (1)
 #endif
 
+// Number of structure descriptors uctypes keeps compiled into a table of their
+// fields sorted by offset, which also provides uctypes.to_tuple() and to_dict().
+// 0 to look the fields up in the descriptor dict on every access.
+#ifndef MICROPY_PY_UCTYPES_LAYOUT_CACHE
+#define MICROPY_PY_UCTYPES_LAYOUT_CACHE (0)
+#endif
+
 #ifndef MICROPY_PY_UZLIB
 #define MICROPY_PY_UZLIB (0)
 #endif
 
+// Whether to provide uzlib.compress() and uzlib.CompIO, depends on MICROPY_PY_UZLIB
+#ifndef MICROPY_PY_UZLIB_COMPRESS
+#define MICROPY_PY_UZLIB_COMPRESS (0)
+#endif
+
 #ifndef MICROPY_PY_UJSON
 #define MICROPY_PY_UJSON (0)
 #endif
 
+// Size of the buffer ujson.load() reads a stream through (allocated on the C stack)
+#ifndef MICROPY_PY_UJSON_STREAM_BUF_SIZE
+#define MICROPY_PY_UJSON_STREAM_BUF_SIZE (64)
+#endif
+
 #ifndef MICROPY_PY_URE
 #define MICROPY_PY_URE (0)
 #endif
@@ -1257,6 +1402,18 @@ typedef double mp_float_t;
 #define MICROPY_PY_URE_SUB (0)
 #endif
 
+// Number of compiled patterns ure.compile() and the module functions keep for
+// reuse when given the same pattern again, 0 to compile every time
+#ifndef MICROPY_PY_URE_CACHE
+#define MICROPY_PY_URE_CACHE (0)
+#endif
+
+// Whether to provide the match_into() and search_into() methods, which store
+// the spans of a match in a buffer instead of creating a match object
+#ifndef MICROPY_PY_URE_MATCH_INTO
+#define MICROPY_PY_URE_MATCH_INTO (0)
+#endif
+
 #ifndef MICROPY_PY_UHEAPQ
 #define MICROPY_PY_UHEAPQ (0)
 #endif
@@ -1304,6 +1461,14 @@ typedef double mp_float_t;
 #define MICROPY_PY_UBINASCII_CRC32 (0)
 #endif
 
+// Whether to provide ubinascii.CRC, a table-driven CRC of any polynomial.  A port can also
+// define MICROPY_PY_UBINASCII_CRC32_LE(crc, buf, len) and MICROPY_PY_UBINASCII_CRC16_LE(crc,
+// buf, len) with the zlib CRC-32 and the X.25 CRC-16 (taking and returning a finished CRC)
+// to have them used for those two.
+#ifndef MICROPY_PY_UBINASCII_CRC
+#define MICROPY_PY_UBINASCII_CRC (0)
+#endif
+
 #ifndef MICROPY_PY_URANDOM
 #define MICROPY_PY_URANDOM (0)
 #endif
@@ -1340,6 +1505,15 @@ typedef double mp_float_t;
 #define MICROPY_PY_UWEBSOCKET (0)
 #endif
 
+#ifndef MICROPY_PY_WEBREPL
+#define MICROPY_PY_WEBREPL (0)
+#endif
+
+// Size of the static buffer WebREPL file transfers go through
+#ifndef MICROPY_PY_WEBREPL_FILE_BUF
+#define MICROPY_PY_WEBREPL_FILE_BUF (512)
+#endif
+
 #ifndef MICROPY_PY_FRAMEBUF
 #define MICROPY_PY_FRAMEBUF (0)
 #endif
@@ -1348,6 +1522,16 @@ typedef double mp_float_t;
 #define MICROPY_PY_BTREE (0)
 #endif
 
+// The page and cache sizes btree.open() uses when they're not given, 0 leaves them to
+// berkeley-db.  The modified pages stay in the cache until flush(), close() or until the
+// cache needs room, so a cache that holds the working set batches the writes.
+#ifndef MICROPY_PY_BTREE_PAGESIZE
+#define MICROPY_PY_BTREE_PAGESIZE (0)
+#endif
+#ifndef MICROPY_PY_BTREE_CACHESIZE
+#define MICROPY_PY_BTREE_CACHESIZE (0)
+#endif
+
 /*****************************************************************************/
 /* Hooks for a port to add builtins                                          */
 
@@ -1387,6 +1571,24 @@ typedef double mp_float_t;
 #define MICROPY_OBJ_BASE_ALIGNMENT
 #endif
 
+// Wrap the hottest functions of the interpreter, for example to place them in
+// fast RAM instead of running them from a flash behind an instruction cache
+#ifndef MICROPY_WRAP_MP_EXECUTE_BYTECODE
+#define MICROPY_WRAP_MP_EXECUTE_BYTECODE(f) f
+#endif
+
+#ifndef MICROPY_WRAP_MP_MAP_LOOKUP
+#define MICROPY_WRAP_MP_MAP_LOOKUP(f) f
+#endif
+
+#ifndef MICROPY_WRAP_GC_ALLOC
+#define MICROPY_WRAP_GC_ALLOC(f) f
+#endif
+
+#ifndef MICROPY_WRAP_MP_OBJ_GET_TYPE
+#define MICROPY_WRAP_MP_OBJ_GET_TYPE(f) f
+#endif
+
 // On embedded platforms, these will typically enable/disable irqs.
 #ifndef MICROPY_BEGIN_ATOMIC_SECTION
 #define MICROPY_BEGIN_ATOMIC_SECTION() (0)
@@ -26,6 +26,7 @@
 #ifndef MICROPY_INCLUDED_PY_MPHAL_H
 #define MICROPY_INCLUDED_PY_MPHAL_H
 
+#include <stdbool.h>
 #include "py/mpconfig.h"
 
 #ifdef MICROPY_MPHALPORT_H
@@ -70,6 +71,13 @@ mp_uint_t mp_hal_ticks_us(void);
 mp_uint_t mp_hal_ticks_cpu(void);
 #endif
 
+#if MICROPY_PY_MICROPYTHON_PROFILE
+// sampling profiler, a site is the bytecode of a function
+bool mp_hal_prof_start(mp_uint_t hz);
+void mp_hal_prof_stop(void);
+size_t mp_hal_prof_read(const uint8_t **sites, size_t *samples, size_t max, size_t *in_python, size_t *total);
+#endif
+
 // If port HAL didn't define its own pin API, use generic
 // "virtual pin" API from the core.
 #ifndef mp_hal_pin_obj_t
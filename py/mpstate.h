@@ -61,12 +61,36 @@ typedef struct _mp_sched_item_t {
     mp_obj_t arg;
 } mp_sched_item_t;
 
-// This structure hold information about the memory allocation system.
-typedef struct _mp_state_mem_t {
-    #if MICROPY_MEM_STATS
-    size_t total_bytes_allocated;
-    size_t current_bytes_allocated;
-    size_t peak_bytes_allocated;
+#if MICROPY_GC_INCREMENTAL
+// time the program has been stopped by the GC, a sweep step on demand counts as a pause
+typedef struct _gc_stats_t {
+    size_t collections;
+    size_t pauses;
+    mp_uint_t last_pause_us;
+    mp_uint_t max_pause_us;
+    mp_uint_t total_pause_us;
+} gc_stats_t;
+#endif
+
+#if MICROPY_GC_ALLOC_PROFILE
+#define GC_PROF_SIZE_BUCKETS (8)
+
+// allocation profile, site i is the bytecode in MP_STATE_VM(gc_prof_sites)[i]
+typedef struct _gc_prof_t {
+    bool enabled;
+    uint16_t countdown;
+    size_t samples[MICROPY_GC_ALLOC_PROFILE_SITES];
+    size_t bytes[MICROPY_GC_ALLOC_PROFILE_SITES];
+    // all allocations, by power of two number of blocks
+    size_t size_hist[GC_PROF_SIZE_BUCKETS];
+} gc_prof_t;
+#endif
+
+// One contiguous piece of memory managed by the GC. With MICROPY_GC_SPLIT_HEAP
+// more of them can be added by gc_add(), each one holding its own tables.
+typedef struct _mp_state_mem_area_t {
+    #if MICROPY_GC_SPLIT_HEAP
+    struct _mp_state_mem_area_t *next;
     #endif
 
     byte *gc_alloc_table_start;
@@ -77,8 +101,34 @@ typedef struct _mp_state_mem_t {
     byte *gc_pool_start;
     byte *gc_pool_end;
 
+    size_t gc_last_free_atb_index;
+
+    #if MICROPY_GC_INCREMENTAL
+    // blocks below this one have been swept since the last collection
+    size_t gc_sweep_block;
+    #endif
+
+    // where gc_alloc() has got to, only valid during one call
+    size_t gc_scan_atb_index;
+    size_t gc_scan_n_free;
+} mp_state_mem_area_t;
+
+// This structure hold information about the memory allocation system.
+typedef struct _mp_state_mem_t {
+    #if MICROPY_MEM_STATS
+    size_t total_bytes_allocated;
+    size_t current_bytes_allocated;
+    size_t peak_bytes_allocated;
+    #endif
+
+    mp_state_mem_area_t area;
+
     int gc_stack_overflow;
     MICROPY_GC_STACK_ENTRY_TYPE gc_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    // area of each block on gc_stack
+    mp_state_mem_area_t *gc_area_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #endif
     uint16_t gc_lock_depth;
 
     // This variable controls auto garbage collection.  If set to 0 then the
@@ -91,12 +141,22 @@ typedef struct _mp_state_mem_t {
     size_t gc_alloc_threshold;
     #endif
 
-    size_t gc_last_free_atb_index;
-
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
     #endif
 
+    #if MICROPY_GC_INCREMENTAL
+    // set if collections leave the sweep to later gc_alloc calls and idle time
+    bool gc_incremental;
+    bool gc_sweep_pending;
+    mp_uint_t gc_pause_start_us;
+    gc_stats_t gc_stats;
+    #endif
+
+    #if MICROPY_GC_ALLOC_PROFILE
+    gc_prof_t gc_prof;
+    #endif
+
     #if MICROPY_PY_THREAD
     // This is a global mutex used to make the GC thread-safe.
     mp_thread_mutex_t gc_mutex;
@@ -115,6 +175,11 @@ typedef struct _mp_state_vm_t {
 
     qstr_pool_t *last_pool;
 
+    #if MICROPY_QSTR_INDEX
+    // hash index of the qstrs interned at runtime, see qstr.c
+    uint16_t *qstr_index;
+    #endif
+
     // non-heap memory for creating an exception if we can't allocate RAM
     mp_obj_exception_t mp_emergency_exception_obj;
 
@@ -178,11 +243,26 @@ typedef struct _mp_state_vm_t {
     mp_obj_t lwip_slip_stream;
     #endif
 
+    #if MICROPY_PY_UCTYPES_LAYOUT_CACHE
+    // compiled structure descriptors, the most recently used first
+    struct _uctypes_layout_t *uctypes_layouts[MICROPY_PY_UCTYPES_LAYOUT_CACHE];
+    #endif
+
+    #if MICROPY_PY_URE_CACHE
+    // pattern and compiled regex pairs, the most recently used first
+    mp_obj_t ure_cache[MICROPY_PY_URE_CACHE * 2];
+    #endif
+
     #if MICROPY_VFS
     struct _mp_vfs_mount_t *vfs_cur;
     struct _mp_vfs_mount_t *vfs_mount_table;
     #endif
 
+    #if MICROPY_GC_ALLOC_PROFILE
+    // bytecode of the functions profiled, kept alive for the report
+    const byte *gc_prof_sites[MICROPY_GC_ALLOC_PROFILE_SITES];
+    #endif
+
     //
     // END ROOT POINTER SECTION
     ////////////////////////////////////////////////////////////
@@ -191,8 +271,22 @@ typedef struct _mp_state_vm_t {
     // (qstr_last_chunk can be root pointer but is also stored in qstr pool)
     byte *qstr_last_chunk;
     size_t qstr_last_alloc;
+
+    #if MICROPY_OPT_MAP_LOOKUP_CACHE
+    // slot each key was last found in, whatever the map
+    uint8_t map_lookup_cache[MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE];
+    #endif
     size_t qstr_last_used;
 
+    #if MICROPY_QSTR_INDEX
+    size_t qstr_index_alloc;
+    size_t qstr_index_len;
+    // qstrs from qstr_index_base up to qstr_index_top are in the index, any
+    // after that (once it couldn't grow) are found by scanning their pools
+    qstr qstr_index_base;
+    qstr qstr_index_top;
+    #endif
+
     #if MICROPY_PY_THREAD
     // This is a global mutex used to make qstr interning thread-safe.
     mp_thread_mutex_t qstr_mutex;
@@ -235,6 +329,11 @@ typedef struct _mp_state_thread_t {
     uint8_t *pystack_cur;
     #endif
 
+    #if MICROPY_PROF_CODE
+    // bytecode of the function running, for the allocation and sampling profilers
+    const byte *prof_code;
+    #endif
+
     ////////////////////////////////////////////////////////////
     // START ROOT POINTER SECTION
     // Everything that needs GC scanning must start here, and
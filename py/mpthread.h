@@ -49,7 +49,17 @@ void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex);
 
 #endif // MICROPY_PY_THREAD
 
-#if MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL
+#if MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL && MICROPY_PY_THREAD_GIL_ADAPTIVE
+#include "py/mpstate.h"
+// number of threads blocked in mp_thread_gil_enter(), maintained by the port
+extern volatile uint32_t mp_thread_gil_waiters;
+void mp_thread_gil_enter(void);
+bool mp_thread_gil_slice_expired(void);
+void mp_thread_gil_yield(void);
+#define MP_THREAD_GIL_ENTER() mp_thread_gil_enter()
+#define MP_THREAD_GIL_EXIT() mp_thread_mutex_unlock(&MP_STATE_VM(gil_mutex))
+#define MP_THREAD_GIL_SHOULD_YIELD() (mp_thread_gil_waiters != 0 && mp_thread_gil_slice_expired())
+#elif MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL
 #include "py/mpstate.h"
 #define MP_THREAD_GIL_ENTER() mp_thread_mutex_lock(&MP_STATE_VM(gil_mutex), 1)
 #define MP_THREAD_GIL_EXIT() mp_thread_mutex_unlock(&MP_STATE_VM(gil_mutex))
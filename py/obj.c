@@ -37,7 +37,7 @@
 #include "py/stackctrl.h"
 #include "py/stream.h" // for mp_obj_print
 
-mp_obj_type_t *mp_obj_get_type(mp_const_obj_t o_in) {
+mp_obj_type_t *MICROPY_WRAP_MP_OBJ_GET_TYPE(mp_obj_get_type)(mp_const_obj_t o_in) {
     if (mp_obj_is_small_int(o_in)) {
         return (mp_obj_type_t*)&mp_type_int;
     } else if (mp_obj_is_qstr(o_in)) {
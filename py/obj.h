@@ -392,6 +392,7 @@ mp_map_t *mp_map_new(size_t n);
 void mp_map_deinit(mp_map_t *map);
 void mp_map_free(mp_map_t *map);
 mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind);
+void mp_map_reserve(mp_map_t *map, size_t n);
 void mp_map_clear(mp_map_t *map);
 void mp_map_dump(mp_map_t *map);
 
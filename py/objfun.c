@@ -284,7 +284,14 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
 
     // execute the byte code with the correct globals context
     mp_globals_set(self->globals);
+    #if MICROPY_PROF_CODE
+    const byte *prof_code = MP_STATE_THREAD(prof_code);
+    MP_STATE_THREAD(prof_code) = self->bytecode;
+    #endif
     mp_vm_return_kind_t vm_return_kind = mp_execute_bytecode(code_state, MP_OBJ_NULL);
+    #if MICROPY_PROF_CODE
+    MP_STATE_THREAD(prof_code) = prof_code;
+    #endif
     mp_globals_set(code_state->old_globals);
 
     #if MICROPY_DEBUG_VM_STACK_OVERFLOW
@@ -83,7 +83,14 @@ STATIC mp_obj_t native_gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_k
     mp_obj_fun_bc_t *self_fun = MP_OBJ_TO_PTR(self_in);
 
     // Determine start of prelude, and extract n_state from it
+    #if MICROPY_EMIT_NATIVE_PRELUDE_AS_BYTES_OBJ
+    // The first word holds the index in the const table of the bytes object with the prelude
+    size_t prelude_len;
+    const byte *prelude = (const byte*)mp_obj_str_get_data((mp_obj_t)self_fun->const_table[((uintptr_t*)self_fun->bytecode)[0]], &prelude_len);
+    uintptr_t prelude_offset = prelude - self_fun->bytecode;
+    #else
     uintptr_t prelude_offset = ((uintptr_t*)self_fun->bytecode)[0];
+    #endif
     size_t n_state = mp_decode_uint_value(self_fun->bytecode + prelude_offset);
     size_t n_exc_stack = 0;
 
@@ -178,7 +185,14 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
     #endif
     {
         // A bytecode generator
+        #if MICROPY_PROF_CODE
+        const byte *prof_code = MP_STATE_THREAD(prof_code);
+        MP_STATE_THREAD(prof_code) = self->code_state.fun_bc->bytecode;
+        #endif
         ret_kind = mp_execute_bytecode(&self->code_state, throw_value);
+        #if MICROPY_PROF_CODE
+        MP_STATE_THREAD(prof_code) = prof_code;
+        #endif
     }
 
     self->globals = mp_globals_get();
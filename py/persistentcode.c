@@ -71,6 +71,8 @@
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_ARMV6)
 #elif MICROPY_EMIT_XTENSA
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_XTENSA)
+#elif MICROPY_EMIT_XTENSAWIN
+#define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_XTENSAWIN)
 #else
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_NONE)
 #endif
@@ -81,6 +83,15 @@
 #define MPY_FEATURE_ARCH_DYNAMIC MPY_FEATURE_ARCH
 #endif
 
+// The Xtensa windowed emitter keeps the prelude of native functions in a bytes object,
+// the first of their constant objects.  In a .mpy file it follows the machine code as
+// for the other architectures.
+#if MICROPY_DYNAMIC_COMPILER
+#define MPY_NATIVE_PRELUDE_AS_BYTES_OBJ (mp_dynamic_compiler.native_arch == MP_NATIVE_ARCH_XTENSAWIN)
+#else
+#define MPY_NATIVE_PRELUDE_AS_BYTES_OBJ (MICROPY_EMIT_NATIVE_PRELUDE_AS_BYTES_OBJ)
+#endif
+
 #if MICROPY_PERSISTENT_CODE_LOAD || (MICROPY_PERSISTENT_CODE_SAVE && !MICROPY_DYNAMIC_COMPILER)
 // The bytecode will depend on the number of bits in a small-int, and
 // this function computes that (could make it a fixed constant, but it
@@ -200,7 +211,7 @@ STATIC void arch_link_qstr(uint8_t *pc, bool is_obj, qstr qst) {
     if (is_obj) {
         val = (mp_uint_t)MP_OBJ_NEW_QSTR(qst);
     }
-    #if MICROPY_EMIT_X86 || MICROPY_EMIT_X64 || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA
+    #if MICROPY_EMIT_X86 || MICROPY_EMIT_X64 || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA || MICROPY_EMIT_XTENSAWIN
     pc[0] = val & 0xff;
     pc[1] = (val >> 8) & 0xff;
     pc[2] = (val >> 16) & 0xff;
@@ -405,18 +416,25 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     }
 
     mp_uint_t *const_table = NULL;
+    size_t n_obj = 0;
+    size_t n_raw_code = 0;
     if (kind != MP_CODE_NATIVE_ASM) {
         // Load constant table for bytecode, native and viper
 
         // Number of entries in constant table
-        size_t n_obj = read_uint(reader, NULL);
-        size_t n_raw_code = read_uint(reader, NULL);
+        n_obj = read_uint(reader, NULL);
+        n_raw_code = read_uint(reader, NULL);
 
         // Allocate constant table
         size_t n_alloc = prelude.n_pos_args + prelude.n_kwonly_args + n_obj + n_raw_code;
         if (kind != MP_CODE_BYTECODE) {
             ++n_alloc; // additional entry for mp_fun_table
         }
+        #if MICROPY_EMIT_NATIVE_PRELUDE_AS_BYTES_OBJ
+        if (kind == MP_CODE_NATIVE_PY) {
+            ++n_alloc; // additional entry for the prelude
+        }
+        #endif
         const_table = m_new(mp_uint_t, n_alloc);
         mp_uint_t *ct = const_table;
 
@@ -433,6 +451,14 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
         }
         #endif
 
+        #if MICROPY_EMIT_NATIVE_PRELUDE_AS_BYTES_OBJ
+        if (kind == MP_CODE_NATIVE_PY) {
+            // The code can't be read byte-wise once committed, so the prelude (with its
+            // qstrs linked above) moves out of it to the first constant object
+            *ct++ = (mp_uint_t)mp_obj_new_bytes(fun_data + prelude_offset, fun_data_len - prelude_offset);
+        }
+        #endif
+
         // Load constant objects and raw code children
         for (size_t i = 0; i < n_obj; ++i) {
             *ct++ = (mp_uint_t)load_obj(reader);
@@ -440,6 +466,13 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
         for (size_t i = 0; i < n_raw_code; ++i) {
             *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader, qw);
         }
+
+        #if MICROPY_EMIT_NATIVE_PRELUDE_AS_BYTES_OBJ
+        if (kind == MP_CODE_NATIVE_PY) {
+            fun_data_len = prelude_offset;
+            ++n_obj;
+        }
+        #endif
     }
 
     // Create raw_code and return it
@@ -609,9 +642,30 @@ STATIC void save_bytecode(mp_print_t *print, qstr_window_t *qw, const byte *ip,
     }
 }
 
+#if MICROPY_EMIT_NATIVE
+// The prelude object comes right after the mp_fun_table entry, past the argument names
+STATIC mp_obj_t native_prelude_obj(const mp_raw_code_t *rc) {
+    const mp_uint_t *ct = rc->const_table;
+    while (*ct != (mp_uint_t)(uintptr_t)mp_fun_table) {
+        ++ct;
+    }
+    return (mp_obj_t)ct[1];
+}
+#endif
+
 STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *qstr_window) {
+    const byte *prelude_data = NULL;
+    size_t prelude_len = 0;
+    size_t n_obj = rc->n_obj;
+    #if MICROPY_EMIT_NATIVE
+    if (rc->kind == MP_CODE_NATIVE_PY && MPY_NATIVE_PRELUDE_AS_BYTES_OBJ) {
+        prelude_data = (const byte*)mp_obj_str_get_data(native_prelude_obj(rc), &prelude_len);
+        --n_obj;
+    }
+    #endif
+
     // Save function kind and data length
-    mp_print_uint(print, (rc->fun_data_len << 2) | (rc->kind - MP_CODE_BYTECODE));
+    mp_print_uint(print, ((rc->fun_data_len + prelude_len) << 2) | (rc->kind - MP_CODE_BYTECODE));
 
     const byte *ip2;
     bytecode_prelude_t prelude;
@@ -626,9 +680,13 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
 
         // Save bytecode
         save_bytecode(print, qstr_window, ip, ip_top);
+    #if MICROPY_EMIT_NATIVE || MICROPY_EMIT_INLINE_ASM
     } else {
-        // Save native code
+        // Save native code, followed by the prelude if it's kept apart
         mp_print_bytes(print, rc->fun_data, rc->fun_data_len);
+        if (prelude_data != NULL) {
+            mp_print_bytes(print, prelude_data, prelude_len);
+        }
 
         if (rc->kind == MP_CODE_NATIVE_PY || rc->kind == MP_CODE_NATIVE_VIPER) {
             // Save qstr link table for native code
@@ -641,8 +699,14 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
 
         if (rc->kind == MP_CODE_NATIVE_PY) {
             // Save prelude size, and extract prelude for later use
-            mp_print_uint(print, rc->prelude_offset);
-            const byte *ip = (const byte*)rc->fun_data + rc->prelude_offset;
+            const byte *ip;
+            if (prelude_data != NULL) {
+                mp_print_uint(print, rc->fun_data_len);
+                ip = prelude_data;
+            } else {
+                mp_print_uint(print, rc->prelude_offset);
+                ip = (const byte*)rc->fun_data + rc->prelude_offset;
+            }
             extract_prelude(&ip, &ip2, &prelude);
         } else {
             // Save basic scope info for viper and asm
@@ -654,6 +718,7 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
                 mp_print_uint(print, rc->type_sig);
             }
         }
+    #endif
     }
 
     if (rc->kind == MP_CODE_BYTECODE || rc->kind == MP_CODE_NATIVE_PY) {
@@ -666,7 +731,7 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
         // Save constant table for bytecode, native and viper
 
         // Number of entries in constant table
-        mp_print_uint(print, rc->n_obj);
+        mp_print_uint(print, n_obj);
         mp_print_uint(print, rc->n_raw_code);
 
         const mp_uint_t *const_table = rc->const_table;
@@ -682,9 +747,13 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
             // Skip saving mp_fun_table entry
             ++const_table;
         }
+        if (prelude_data != NULL) {
+            // Saved with the code
+            ++const_table;
+        }
 
         // Save constant objects and raw code children
-        for (size_t i = 0; i < rc->n_obj; ++i) {
+        for (size_t i = 0; i < n_obj; ++i) {
             save_obj(print, (mp_obj_t)*const_table++);
         }
         for (size_t i = 0; i < rc->n_raw_code; ++i) {
@@ -745,10 +814,188 @@ void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
     save_raw_code(print, rc, &qw);
 }
 
+#if defined(__i386__) || defined(__x86_64__) || defined(__unix__)
+#define SAVE_FILE_POSIX (1)
+#else
+#define SAVE_FILE_POSIX (0)
+#endif
+
+#if MICROPY_VFS && (MICROPY_PERSISTENT_CODE_CACHE || !SAVE_FILE_POSIX)
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "extmod/vfs.h"
+
+STATIC void vfs_write_file(mp_obj_t filename, const vstr_t *data) {
+    mp_obj_t args[2] = { filename, MP_OBJ_NEW_QSTR(MP_QSTR_wb) };
+    mp_obj_t file = mp_vfs_open(2, args, (mp_map_t*)&mp_const_empty_map);
+    int errcode;
+    mp_uint_t n = mp_stream_rw(file, data->buf, data->len, &errcode, MP_STREAM_RW_WRITE);
+    mp_stream_close(file);
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    if (n != data->len) {
+        mp_raise_OSError(MP_ENOSPC);
+    }
+}
+
+#endif
+
+#if MICROPY_PERSISTENT_CODE_CACHE
+
+#include "py/compile.h"
+
+#if !MICROPY_PERSISTENT_CODE_LOAD || !MICROPY_PERSISTENT_CODE_SAVE || !MICROPY_VFS
+#error MICROPY_PERSISTENT_CODE_CACHE requires MICROPY_PERSISTENT_CODE_LOAD, MICROPY_PERSISTENT_CODE_SAVE and MICROPY_VFS
+#endif
+
+// A cache entry is the .mpy data preceded by the size and the modification time
+// of the source it was compiled from, an entry not matching them is rebuilt, and
+// by the size of the entry itself, the loader can't tell a truncated .mpy apart.
+#define CACHE_DIR "__pycache__"
+#define CACHE_KEY_LEN (8)
+#define CACHE_HDR_LEN (CACHE_KEY_LEN + 4)
+
+// <dir>/__pycache__ and <dir>/__pycache__/<name>.mpy for <dir>/<name>.py
+STATIC void cache_paths(const char *filename, vstr_t *dir, vstr_t *path) {
+    const char *base = strrchr(filename, '/');
+    base = (base == NULL) ? filename : base + 1;
+    const char *ext = strrchr(base, '.');
+    if (ext == NULL) {
+        ext = base + strlen(base);
+    }
+    vstr_add_strn(dir, filename, base - filename);
+    vstr_add_str(dir, CACHE_DIR);
+    vstr_add_strn(path, dir->buf, dir->len);
+    vstr_add_char(path, '/');
+    vstr_add_strn(path, base, ext - base);
+    vstr_add_str(path, ".mpy");
+}
+
+STATIC void cache_put_uint32(byte *buf, uint32_t val) {
+    for (size_t i = 0; i < 4; i++) {
+        buf[i] = val >> (8 * i);
+    }
+}
+
+// size and modification time of the file given, raises if it doesn't exist
+STATIC uint32_t cache_stat(const char *filename, uint32_t *mtime) {
+    size_t len;
+    mp_obj_t *st;
+    mp_obj_tuple_get(mp_vfs_stat(mp_obj_new_str(filename, strlen(filename))), &len, &st);
+    *mtime = mp_obj_get_int_truncated(st[8]);
+    return mp_obj_get_int_truncated(st[6]);
+}
+
+STATIC bool cache_key(const char *filename, byte *key) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        uint32_t mtime;
+        cache_put_uint32(key, cache_stat(filename, &mtime));
+        cache_put_uint32(key + 4, mtime);
+        nlr_pop();
+        // without a timestamp an edit keeping the size can't be told apart
+        return mtime != 0;
+    }
+    return false;
+}
+
+STATIC mp_raw_code_t *cache_load(const char *path, const byte *key) {
+    mp_raw_code_t *rc = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        byte hdr[CACHE_HDR_LEN];
+        uint32_t mtime;
+        memcpy(hdr, key, CACHE_KEY_LEN);
+        cache_put_uint32(hdr + CACHE_KEY_LEN, cache_stat(path, &mtime));
+        mp_reader_t reader;
+        mp_reader_new_file(&reader, path);
+        bool match = true;
+        for (size_t i = 0; i < CACHE_HDR_LEN; i++) {
+            if (reader.readbyte(reader.data) != hdr[i]) {
+                match = false;
+            }
+        }
+        if (match) {
+            rc = mp_raw_code_load(&reader);
+        } else {
+            reader.close(reader.data);
+        }
+        nlr_pop();
+    }
+    return rc;
+}
+
+STATIC void cache_save(const vstr_t *dir, const vstr_t *path, const byte *key, mp_raw_code_t *rc) {
+    // native code can't be relocated when loaded back
+    if (mp_raw_code_has_native(rc)) {
+        return;
+    }
+    vstr_t data;
+    mp_print_t print;
+    vstr_init_print(&data, 256, &print);
+    mp_print_bytes(&print, key, CACHE_KEY_LEN);
+    vstr_add_len(&data, 4);
+    mp_raw_code_save(rc, &print);
+    cache_put_uint32((byte*)data.buf + CACHE_KEY_LEN, data.len);
+
+    // a full or read-only filesystem only costs compiling the source again
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        if (mp_vfs_import_stat(dir->buf) != MP_IMPORT_STAT_DIR) {
+            mp_vfs_mkdir(mp_obj_new_str(dir->buf, dir->len));
+        }
+        // written aside and renamed, an interrupted write can't leave a truncated entry behind
+        mp_obj_t path_obj = mp_obj_new_str(path->buf, path->len);
+        vstr_t tmp;
+        vstr_init(&tmp, path->len + 1);
+        vstr_add_strn(&tmp, path->buf, path->len);
+        vstr_add_char(&tmp, '~');
+        mp_obj_t tmp_obj = mp_obj_new_str_from_vstr(&mp_type_str, &tmp);
+        vfs_write_file(tmp_obj, &data);
+        if (mp_vfs_import_stat(path->buf) == MP_IMPORT_STAT_FILE) {
+            mp_vfs_remove(path_obj);
+        }
+        mp_vfs_rename(tmp_obj, path_obj);
+        nlr_pop();
+    }
+    vstr_clear(&data);
+}
+
+mp_raw_code_t *mp_raw_code_compile_file_cached(const char *filename) {
+    vstr_t dir, path;
+    vstr_init(&dir, 32);
+    vstr_init(&path, 32);
+    cache_paths(filename, &dir, &path);
+
+    byte key[CACHE_KEY_LEN];
+    bool cacheable = cache_key(filename, key);
+    mp_raw_code_t *rc = NULL;
+    if (cacheable) {
+        rc = cache_load(vstr_null_terminated_str(&path), key);
+    }
+    if (rc == NULL) {
+        mp_lexer_t *lex = mp_lexer_new_from_file(filename);
+        qstr source_name = lex->source_name;
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        rc = mp_compile_to_raw_code(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        if (cacheable) {
+            vstr_null_terminated_str(&dir);
+            cache_save(&dir, &path, key, rc);
+        }
+    }
+    vstr_clear(&dir);
+    vstr_clear(&path);
+    return rc;
+}
+
+#endif // MICROPY_PERSISTENT_CODE_CACHE
+
 // here we define mp_raw_code_save_file depending on the port
 // TODO abstract this away properly
 
-#if defined(__i386__) || defined(__x86_64__) || defined(__unix__)
+#if SAVE_FILE_POSIX
 
 #include <unistd.h>
 #include <sys/stat.h>
@@ -767,6 +1014,18 @@ void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
     close(fd);
 }
 
+#elif MICROPY_VFS
+
+void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
+    // built in RAM first so that the file gets written with a single call
+    vstr_t data;
+    mp_print_t print;
+    vstr_init_print(&data, 256, &print);
+    mp_raw_code_save(rc, &print);
+    vfs_write_file(mp_obj_new_str(filename, strlen(filename)), &data);
+    vstr_clear(&data);
+}
+
 #else
 #error mp_raw_code_save_file not implemented for this platform
 #endif
@@ -44,6 +44,7 @@ enum {
     MP_NATIVE_ARCH_ARMV7EMSP,
     MP_NATIVE_ARCH_ARMV7EMDP,
     MP_NATIVE_ARCH_XTENSA,
+    MP_NATIVE_ARCH_XTENSAWIN,
 };
 
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader);
@@ -53,4 +54,7 @@ mp_raw_code_t *mp_raw_code_load_file(const char *filename);
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print);
 void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename);
 
+// compiles the given script, or loads it from the cache when it was compiled before
+mp_raw_code_t *mp_raw_code_compile_file_cached(const char *filename);
+
 #endif // MICROPY_INCLUDED_PY_PERSISTENTCODE_H
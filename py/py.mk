@@ -183,6 +183,7 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	emitnarm.o \
 	asmxtensa.o \
 	emitnxtensa.o \
+	emitnxtensawin.o \
 	emitinlinextensa.o \
 	formatfloat.o \
 	parsenumbase.o \
@@ -32,8 +32,8 @@
 #include "py/qstr.h"
 #include "py/gc.h"
 
-// NOTE: we are using linear arrays to store and search for qstr's (unique strings, interned strings)
-// ultimately we will replace this with a static hash table of some kind
+// NOTE: we are using linear arrays to store qstr's (unique strings, interned strings), with
+// MICROPY_QSTR_INDEX they are also found through hash indexes rather than by scanning them
 // also probably need to include the length in the string data, to allow null bytes in the string
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
@@ -120,10 +120,32 @@ extern const qstr_pool_t MICROPY_QSTR_EXTRA_POOL;
 #define CONST_POOL mp_qstr_const_pool
 #endif
 
+#if MICROPY_QSTR_INDEX
+// Slots hold a qstr, or 0 when empty, and a string is looked for from the slot
+// of its hash on until an empty one. The tables are never more than half full.
+STATIC const uint16_t qstr_const_index[] = {
+#ifndef NO_QSTR
+#define QDEF(id, str)
+#define QINDEX(id) id,
+#include "genhdr/qstrdefs.generated.h"
+#undef QINDEX
+#undef QDEF
+#endif
+};
+#endif
+
 void qstr_init(void) {
     MP_STATE_VM(last_pool) = (qstr_pool_t*)&CONST_POOL; // we won't modify the const_pool since it has no allocated room left
     MP_STATE_VM(qstr_last_chunk) = NULL;
 
+    #if MICROPY_QSTR_INDEX
+    MP_STATE_VM(qstr_index) = NULL;
+    MP_STATE_VM(qstr_index_alloc) = 0;
+    MP_STATE_VM(qstr_index_len) = 0;
+    MP_STATE_VM(qstr_index_base) = QSTR_TOTAL();
+    MP_STATE_VM(qstr_index_top) = QSTR_TOTAL();
+    #endif
+
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_VM(qstr_mutex));
     #endif
@@ -139,6 +161,63 @@ STATIC const byte *find_qstr(qstr q) {
     return pool->qstrs[q - pool->total_prev_len];
 }
 
+#if MICROPY_QSTR_INDEX
+
+STATIC qstr qstr_index_find(const uint16_t *index, size_t alloc, mp_uint_t hash, const char *str, size_t len) {
+    for (size_t slot = hash & (alloc - 1);; slot = (slot + 1) & (alloc - 1)) {
+        qstr q = index[slot];
+        if (q == 0) {
+            return 0;
+        }
+        const byte *qd = q < MP_QSTRnumber_of ? mp_qstr_const_pool.qstrs[q] : find_qstr(q);
+        if (Q_GET_HASH(qd) == hash && Q_GET_LENGTH(qd) == len && memcmp(Q_GET_DATA(qd), str, len) == 0) {
+            return q;
+        }
+    }
+}
+
+STATIC void qstr_index_insert(uint16_t *index, size_t alloc, qstr q) {
+    size_t slot = Q_GET_HASH(find_qstr(q)) & (alloc - 1);
+    while (index[slot] != 0) {
+        slot = (slot + 1) & (alloc - 1);
+    }
+    index[slot] = q;
+}
+
+// qstr_mutex must be taken while in this function
+STATIC void qstr_index_add(qstr q) {
+    if (q > 0xffff) {
+        // the index can't hold this id
+        return;
+    }
+    size_t len = q - MP_STATE_VM(qstr_index_base) + 1;
+    if (2 * len > MP_STATE_VM(qstr_index_alloc)) {
+        // rehash into a table twice the size, if that fails carry on without it
+        // and let qstr_find_strn scan for the qstrs from here on, the next
+        // qstr retries it and picks up the ones missed
+        size_t new_alloc = MAX(64, MP_STATE_VM(qstr_index_alloc) * 2);
+        while (new_alloc < 2 * len) {
+            new_alloc *= 2;
+        }
+        uint16_t *new_index = m_new_maybe(uint16_t, new_alloc);
+        if (new_index == NULL) {
+            return;
+        }
+        memset(new_index, 0, new_alloc * sizeof(uint16_t));
+        for (qstr i = MP_STATE_VM(qstr_index_base); i < q; i++) {
+            qstr_index_insert(new_index, new_alloc, i);
+        }
+        m_del(uint16_t, MP_STATE_VM(qstr_index), MP_STATE_VM(qstr_index_alloc));
+        MP_STATE_VM(qstr_index) = new_index;
+        MP_STATE_VM(qstr_index_alloc) = new_alloc;
+    }
+    qstr_index_insert(MP_STATE_VM(qstr_index), MP_STATE_VM(qstr_index_alloc), q);
+    MP_STATE_VM(qstr_index_len) = len;
+    MP_STATE_VM(qstr_index_top) = q + 1;
+}
+
+#endif
+
 // qstr_mutex must be taken while in this function
 STATIC qstr qstr_add(const byte *q_ptr) {
     DEBUG_printf("QSTR: add hash=%d len=%d data=%.*s\n", Q_GET_HASH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_DATA(q_ptr));
@@ -165,18 +244,27 @@ STATIC qstr qstr_add(const byte *q_ptr) {
 
     // add the new qstr
     MP_STATE_VM(last_pool)->qstrs[MP_STATE_VM(last_pool)->len++] = q_ptr;
+    qstr q = MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+
+    #if MICROPY_QSTR_INDEX
+    qstr_index_add(q);
+    #endif
 
     // return id for the newly-added qstr
-    return MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
+    return q;
 }
 
-qstr qstr_find_strn(const char *str, size_t str_len) {
-    // work out hash of str
-    mp_uint_t str_hash = qstr_compute_hash((const byte*)str, str_len);
-
-    // search pools for the data
-    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
-        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+// searches pool and the ones before it for the qstrs with an id from q_first on
+STATIC qstr qstr_scan(qstr_pool_t *pool, mp_uint_t str_hash, const char *str, size_t str_len, qstr q_first) {
+    for (; pool != NULL; pool = pool->prev) {
+        if (pool->total_prev_len + pool->len <= q_first) {
+            break;
+        }
+        const byte **q = pool->qstrs;
+        if (q_first > pool->total_prev_len) {
+            q += q_first - pool->total_prev_len;
+        }
+        for (const byte **q_top = pool->qstrs + pool->len; q < q_top; q++) {
             if (Q_GET_HASH(*q) == str_hash && Q_GET_LENGTH(*q) == str_len && memcmp(Q_GET_DATA(*q), str, str_len) == 0) {
                 return pool->total_prev_len + (q - pool->qstrs);
             }
@@ -187,6 +275,34 @@ qstr qstr_find_strn(const char *str, size_t str_len) {
     return 0;
 }
 
+qstr qstr_find_strn(const char *str, size_t str_len) {
+    // work out hash of str
+    mp_uint_t str_hash = qstr_compute_hash((const byte*)str, str_len);
+
+    #if MICROPY_QSTR_INDEX
+    qstr q = qstr_index_find(qstr_const_index, MP_ARRAY_SIZE(qstr_const_index), str_hash, str, str_len);
+    if (q == 0) {
+        #ifdef MICROPY_QSTR_EXTRA_POOL
+        // the frozen pool sits between the ROM pool and the runtime ones
+        q = qstr_scan((qstr_pool_t*)&CONST_POOL, str_hash, str, str_len, MP_QSTRnumber_of);
+        if (q != 0) {
+            return q;
+        }
+        #endif
+        if (MP_STATE_VM(qstr_index_len) != 0) {
+            q = qstr_index_find(MP_STATE_VM(qstr_index), MP_STATE_VM(qstr_index_alloc), str_hash, str, str_len);
+        }
+        if (q == 0) {
+            q = qstr_scan(MP_STATE_VM(last_pool), str_hash, str, str_len, MP_STATE_VM(qstr_index_top));
+        }
+    }
+    return q;
+    #else
+    // search pools for the data
+    return qstr_scan(MP_STATE_VM(last_pool), str_hash, str, str_len, 0);
+    #endif
+}
+
 qstr qstr_from_str(const char *str) {
     return qstr_from_strn(str, strlen(str));
 }
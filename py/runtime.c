@@ -112,6 +112,18 @@ void mp_init(void) {
     }
     #endif
 
+    #if MICROPY_PY_UCTYPES_LAYOUT_CACHE
+    for (size_t i = 0; i < MICROPY_PY_UCTYPES_LAYOUT_CACHE; ++i) {
+        MP_STATE_VM(uctypes_layouts[i]) = NULL;
+    }
+    #endif
+
+    #if MICROPY_PY_URE_CACHE
+    for (size_t i = 0; i < MICROPY_PY_URE_CACHE * 2; ++i) {
+        MP_STATE_VM(ure_cache[i]) = MP_OBJ_NULL;
+    }
+    #endif
+
     #if MICROPY_VFS
     // initialise the VFS sub-system
     MP_STATE_VM(vfs_cur) = NULL;
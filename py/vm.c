@@ -114,7 +114,7 @@
 //  MP_VM_RETURN_NORMAL, sp valid, return value in *sp
 //  MP_VM_RETURN_YIELD, ip, sp valid, yielded value in *sp
 //  MP_VM_RETURN_EXCEPTION, exception in state[0]
-mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc) {
+mp_vm_return_kind_t MICROPY_WRAP_MP_EXECUTE_BYTECODE(mp_execute_bytecode)(mp_code_state_t *code_state, volatile mp_obj_t inject_exc) {
 #define SELECTIVE_EXC_IP (0)
 #if SELECTIVE_EXC_IP
 #define MARK_EXC_IP_SELECTIVE() { code_state->ip = ip; } /* stores ip 1 byte past last opcode */
@@ -161,7 +161,7 @@ run_code_state: ;
     // variables that are visible to the exception handler (declared volatile)
     mp_exc_stack_t *volatile exc_sp = MP_TAGPTR_PTR(code_state->exc_sp); // stack grows up, exc_sp points to top of stack
 
-    #if MICROPY_PY_THREAD_GIL && MICROPY_PY_THREAD_GIL_VM_DIVISOR
+    #if MICROPY_PY_THREAD_GIL && MICROPY_PY_THREAD_GIL_VM_DIVISOR && !MICROPY_PY_THREAD_GIL_ADAPTIVE
     // This needs to be volatile and outside the VM loop so it persists across handling
     // of any exceptions.  Otherwise it's possible that the VM never gives up the GIL.
     volatile int gil_divisor = MICROPY_PY_THREAD_GIL_VM_DIVISOR;
@@ -1302,11 +1302,13 @@ pending_exception_check:
                 #endif
 
                 #if MICROPY_PY_THREAD_GIL
-                #if MICROPY_PY_THREAD_GIL_VM_DIVISOR
+                #if MICROPY_PY_THREAD_GIL_ADAPTIVE
+                if (MP_THREAD_GIL_SHOULD_YIELD())
+                #elif MICROPY_PY_THREAD_GIL_VM_DIVISOR
                 if (--gil_divisor == 0)
                 #endif
                 {
-                    #if MICROPY_PY_THREAD_GIL_VM_DIVISOR
+                    #if MICROPY_PY_THREAD_GIL_VM_DIVISOR && !MICROPY_PY_THREAD_GIL_ADAPTIVE
                     gil_divisor = MICROPY_PY_THREAD_GIL_VM_DIVISOR;
                     #endif
                     #if MICROPY_ENABLE_SCHEDULER
@@ -1314,8 +1316,12 @@ pending_exception_check:
                     if (MP_STATE_VM(sched_state) == MP_SCHED_IDLE)
                     #endif
                     {
+                    #if MICROPY_PY_THREAD_GIL_ADAPTIVE
+                    mp_thread_gil_yield();
+                    #else
                     MP_THREAD_GIL_EXIT();
                     MP_THREAD_GIL_ENTER();
+                    #endif
                     }
                 }
                 #endif
@@ -0,0 +1,54 @@
+# test ustruct.Struct, a format parsed once
+
+try:
+    import ustruct as struct
+except:
+    try:
+        import struct
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+if not hasattr(struct, 'Struct'):
+    print("SKIP")
+    raise SystemExit
+
+s = struct.Struct('<BhI2s')
+print(s.size, s.format)
+print(s.pack(1, -2, 3, b'ab'))
+print(s.unpack(b'\x01\xfe\xff\x03\x00\x00\x00ab'))
+
+buf = bytearray(12)
+s.pack_into(buf, 2, 255, 1000, 123456, b'x')
+print(buf)
+print(s.unpack_from(buf, 2))
+print(s.unpack_from(buf, -9))
+
+# same output as the module functions
+for fmt in ('>HH', '<3h', '@bI', '4s2B', '0s', 'q'):
+    st = struct.Struct(fmt)
+    values = struct.unpack(fmt, bytes(range(1, st.size + 1)))
+    print(fmt, st.size == struct.calcsize(fmt), values, st.pack(*values) == struct.pack(fmt, *values))
+
+# one record after the other
+for v in struct.Struct('>bH').iter_unpack(b'\x01\x00\x02\xff\x00\x03'):
+    print(v)
+
+for args in ((), (1, 2, 3, b'', 5)):
+    try:
+        s.pack(*args)
+    except:
+        print('struct.error')
+
+try:
+    s.unpack_from(b'\x00' * 8)
+except:
+    print('struct.error')
+try:
+    s.pack_into(buf, 4, 1, 2, 3, b'')
+except:
+    print('struct.error')
+try:
+    struct.Struct('>bH').iter_unpack(b'\x00' * 5)
+except:
+    print('struct.error')
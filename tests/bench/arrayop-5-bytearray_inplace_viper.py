@@ -0,0 +1,16 @@
+# Array operation
+# Type: bytearray, inplace operation using for, through a viper pointer
+import bench
+
+@micropython.viper
+def inc(arr):
+    p = ptr8(arr)
+    for i in range(1000):
+        p[i] += 1
+
+def test(num):
+    for i in iter(range(num//10000)):
+        arr = bytearray(b"\0" * 1000)
+        inc(arr)
+
+bench.run(test)
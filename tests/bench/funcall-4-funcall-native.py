@@ -0,0 +1,14 @@
+# Function call overhead test
+# Same as funcall-2, with both functions compiled by the native emitter
+import bench
+
+@micropython.native
+def f(x):
+    return x + 1
+
+@micropython.native
+def test(num):
+    for i in iter(range(num)):
+        a = f(i)
+
+bench.run(test)
@@ -0,0 +1,9 @@
+# Same loop as loop_count-5, compiled by the native emitter
+import bench
+
+@micropython.native
+def test(num):
+    while num != 0:
+        num -= 1
+
+bench.run(test)
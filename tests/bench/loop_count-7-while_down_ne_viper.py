@@ -0,0 +1,9 @@
+# Same loop as loop_count-5, with a machine int counter from the viper emitter
+import bench
+
+@micropython.viper
+def test(num: int):
+    while num != 0:
+        num -= 1
+
+bench.run(test)
@@ -0,0 +1,13 @@
+# Packing with the format string parsed on every call
+# A LoRa payload: status byte, two int16 readings, uint16 and uint32
+import bench
+import ustruct as struct
+
+FMT = '<BhhHI'
+
+def test(num):
+    buf = bytearray(struct.calcsize(FMT))
+    for i in iter(range(num // 20)):
+        struct.pack_into(FMT, buf, 0, 1, -2, 3, 4, 5)
+
+bench.run(test)
@@ -0,0 +1,14 @@
+# Packing with a Struct, parsed once
+# A LoRa payload: status byte, two int16 readings, uint16 and uint32
+import bench
+import ustruct as struct
+
+FMT = '<BhhHI'
+
+def test(num):
+    buf = bytearray(struct.calcsize(FMT))
+    s = struct.Struct(FMT)
+    for i in iter(range(num // 20)):
+        s.pack_into(buf, 0, 1, -2, 3, 4, 5)
+
+bench.run(test)
@@ -0,0 +1,13 @@
+# Unpacking with the format string parsed on every call
+# A LoRa payload: status byte, two int16 readings, uint16 and uint32
+import bench
+import ustruct as struct
+
+FMT = '<BhhHI'
+
+def test(num):
+    buf = bytearray(struct.calcsize(FMT))
+    for i in iter(range(num // 20)):
+        struct.unpack_from(FMT, buf, 0)
+
+bench.run(test)
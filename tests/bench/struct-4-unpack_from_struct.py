@@ -0,0 +1,14 @@
+# Unpacking with a Struct, parsed once
+# A LoRa payload: status byte, two int16 readings, uint16 and uint32
+import bench
+import ustruct as struct
+
+FMT = '<BhhHI'
+
+def test(num):
+    buf = bytearray(struct.calcsize(FMT))
+    s = struct.Struct(FMT)
+    for i in iter(range(num // 20)):
+        s.unpack_from(buf, 0)
+
+bench.run(test)
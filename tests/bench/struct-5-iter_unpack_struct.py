@@ -0,0 +1,15 @@
+# Unpacking a block of records with Struct.iter_unpack, the result tuple is reused
+# A LoRa payload: status byte, two int16 readings, uint16 and uint32
+import bench
+import ustruct as struct
+
+FMT = '<BhhHI'
+
+def test(num):
+    s = struct.Struct(FMT)
+    buf = bytearray(s.size * 100)
+    for i in iter(range(num // 2000)):
+        for rec in s.iter_unpack(buf):
+            pass
+
+bench.run(test)
@@ -0,0 +1,10 @@
+import bench
+import time
+
+def test(num):
+    i = 0
+    while i < num:
+        f = time.time
+        i += 1
+
+bench.run(test)
@@ -15,3 +15,39 @@ apin = adc.channel(0)
 print(apin)
 apin = adc.channel(id=0)
 print(apin)
+
+# timed reads through I2S DMA, P16 and P13 interleaved
+import array
+import time
+p16 = adc.channel(pin='P16')
+samples = array.array('H', [0xFFFF] * 2000)
+print(adc.read_timed(samples, 100000, channels=(p16, apin)) == 2000)
+print(max(samples) < 4096)
+
+start = time.ticks_ms()
+adc.read_timed(samples, 200000, channels=(p16,))
+print('OK' if time.ticks_diff(time.ticks_ms(), start) < 100 else 'SLOW')
+
+# streaming
+adc.start(100000, channels=(p16,))
+try:
+    p16.value()
+except OSError:
+    print('OSError')
+for i in range(10):
+    adc.readinto(samples)
+print(max(samples) < 4096)
+adc.stop()
+print(p16.value() > -1)
+
+# calibrated and filtered in C
+mv = array.array('H', [0xFFFF] * 100)
+print(p16.voltages(mv, oversample=64) == 100)
+print(max(mv) < 1200)
+print(p16.voltages(mv, filter=machine.ADC.MEDIAN, oversample=5) == 100)
+print(max(mv) < 1200)
+
+try:
+    adc.read_timed(bytearray(6), 100000)
+except ValueError:
+    print('ValueError')
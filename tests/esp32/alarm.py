@@ -178,3 +178,17 @@ print("4 seconds have expired!")
 #Callback of alarm5 should be called after this point
 #Wait until end
 time.sleep(2)
+
+# A periodic alarm is scheduled from its previous expiry, the callback latency must not add up
+stamps = []
+def cb_stamp(a):
+    stamps.append(utime.ticks_us())
+    if len(stamps) == 100:
+        a.cancel()
+
+start = utime.ticks_us()
+alarm1 = Timer.Alarm(handler=cb_stamp, ms=10, periodic=True)
+time.sleep(1.2)
+print(len(stamps))
+drift = utime.ticks_diff(stamps[-1], start) - 100 * 10000
+print("drift OK" if abs(drift) < 2000 else "drift %d us" % drift)
@@ -0,0 +1,74 @@
+"""
+BLE notification rate of the GATT server.
+This benchmark needs a second board running this same script with PEER = True,
+it connects to the board under test and subscribes to the characteristic.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+from network import Bluetooth
+import time
+
+PEER = False
+NAME = 'PyNotifyBench'
+SRV_UUID = 0x3000
+CHR_UUID = 0x3001
+NOTIFICATIONS = 500
+SIZE = 20
+WAIT_S = 30
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+bt = Bluetooth()
+
+if PEER:
+    received = [0]
+    def on_notify(chr):
+        received[0] += 1
+    bt.start_scan(-1)
+    conn = None
+    while conn is None:
+        adv = bt.get_adv()
+        if adv and bt.resolve_adv_data(adv.data, Bluetooth.ADV_NAME_CMPL) == NAME:
+            bt.stop_scan()
+            conn = bt.connect(adv.mac)
+    for srv in conn.services():
+        if srv.uuid() == SRV_UUID:
+            for chr in srv.characteristics():
+                if chr.uuid() == CHR_UUID:
+                    chr.callback(trigger=Bluetooth.CHAR_NOTIFY_EVENT, handler=on_notify)
+    while conn.isconnected():
+        time.sleep(1)
+    print('received', received[0])
+    import sys
+    sys.exit()
+
+subscribed = [False]
+def on_subscribe(chr):
+    if chr.events() & Bluetooth.CHAR_SUBSCRIBE_EVENT:
+        subscribed[0] = True
+
+bt.set_advertisement(name=NAME)
+srv = bt.service(uuid=SRV_UUID, isprimary=True)
+chr = srv.characteristic(uuid=CHR_UUID, value=0)
+chr.callback(trigger=Bluetooth.CHAR_SUBSCRIBE_EVENT, handler=on_subscribe)
+bt.advertise(True)
+
+deadline = time.ticks_add(time.ticks_ms(), WAIT_S * 1000)
+while not subscribed[0] and time.ticks_diff(deadline, time.ticks_ms()) > 0:
+    time.sleep_ms(100)
+if not subscribed[0]:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+payload = bytearray(SIZE)
+start = time.ticks_us()
+for i in range(NOTIFICATIONS):
+    payload[0] = i & 0xFF
+    chr.value(payload)
+elapsed = max(time.ticks_diff(time.ticks_us(), start), 1)
+report('ble_notify_rate', NOTIFICATIONS * 1000000 // elapsed, 'msg/s')
+report('ble_notify_throughput', NOTIFICATIONS * SIZE * 1000000 // elapsed, 'B/s')
+
+bt.disconnect_client()
+bt.advertise(False)
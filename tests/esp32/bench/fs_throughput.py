@@ -0,0 +1,67 @@
+"""
+File system throughput of /flash, and of /sd when a card is mounted.
+The metrics carry the file system type, flash a board with the other one
+to compare LittleFS against FatFS.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import os
+import time
+import pycom
+
+CHUNK = 1024
+CHUNKS = 128
+RANDOM_OPS = 128
+RANDOM_SIZE = 64
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+def elapsed_us(start):
+    return max(time.ticks_diff(time.ticks_us(), start), 1)
+
+def bench(prefix, path):
+    data = bytearray(CHUNK)
+    for i in range(CHUNK):
+        data[i] = i & 0xFF
+    buf = bytearray(CHUNK)
+    small = memoryview(buf)[:RANDOM_SIZE]
+
+    start = time.ticks_us()
+    with open(path, 'wb') as f:
+        for i in range(CHUNKS):
+            f.write(data)
+    report(prefix + '_seq_write', CHUNK * CHUNKS * 1000000 // elapsed_us(start), 'B/s')
+
+    start = time.ticks_us()
+    with open(path, 'rb') as f:
+        for i in range(CHUNKS):
+            f.readinto(buf)
+    report(prefix + '_seq_read', CHUNK * CHUNKS * 1000000 // elapsed_us(start), 'B/s')
+
+    size = CHUNK * CHUNKS
+    start = time.ticks_us()
+    with open(path, 'rb') as f:
+        for i in range(RANDOM_OPS):
+            f.seek((i * 7919 * RANDOM_SIZE) % (size - RANDOM_SIZE))
+            f.readinto(small)
+    report(prefix + '_random_read', RANDOM_OPS * 1000000 // elapsed_us(start), 'op/s')
+
+    start = time.ticks_us()
+    with open(path, 'r+b') as f:
+        for i in range(RANDOM_OPS):
+            f.seek((i * 7919 * RANDOM_SIZE) % (size - RANDOM_SIZE))
+            f.write(small)
+    report(prefix + '_random_write', RANDOM_OPS * 1000000 // elapsed_us(start), 'op/s')
+
+    start = time.ticks_us()
+    for i in range(RANDOM_OPS):
+        os.stat(path)
+    report(prefix + '_stat', elapsed_us(start) // RANDOM_OPS, 'us')
+
+    os.remove(path)
+
+fs_type = 'lfs' if pycom.bootmgr()[1] == 'LittleFS' else 'fat'
+bench('fs_%s_flash' % fs_type, '/flash/fs_bench.bin')
+
+if 'sd' in os.listdir('/'):
+    bench('fs_fat_sd', '/sd/fs_bench.bin')
@@ -0,0 +1,48 @@
+"""
+Distribution of the GC pauses, both the explicit collections and the ones
+triggered by the allocations of a typical mixed workload.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import gc
+import time
+
+COLLECTIONS = 50
+ALLOCATIONS = 2000
+LIVE = 64
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+def percentiles(prefix, samples):
+    samples.sort()
+    n = len(samples)
+    report(prefix + '_min', samples[0], 'us')
+    report(prefix + '_p50', samples[n // 2], 'us')
+    report(prefix + '_p95', samples[min(n - 1, n * 95 // 100)], 'us')
+    report(prefix + '_max', samples[-1], 'us')
+
+# keeps part of the heap alive, so the mark phase has something to walk
+live = [None] * LIVE
+
+gc.collect()
+samples = []
+for i in range(COLLECTIONS):
+    for j in range(LIVE):
+        live[j] = [j] * (j % 16 + 1)
+    start = time.ticks_us()
+    gc.collect()
+    samples.append(time.ticks_diff(time.ticks_us(), start))
+percentiles('gc_collect', samples)
+
+# the slowest allocations are the ones that had to collect first
+samples = [0] * ALLOCATIONS
+gc.collect()
+start_all = time.ticks_us()
+for i in range(ALLOCATIONS):
+    start = time.ticks_us()
+    live[i % LIVE] = bytearray(64 + (i % 8) * 128)
+    samples[i] = time.ticks_diff(time.ticks_us(), start)
+total = time.ticks_diff(time.ticks_us(), start_all)
+percentiles('gc_alloc', samples)
+report('gc_alloc_total', total, 'us')
+report('gc_mem_free', gc.mem_free(), 'B')
@@ -0,0 +1,40 @@
+"""
+I2C master read throughput from the first device answering the scan.
+Only reads are done, the device's registers are never written.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+from machine import I2C
+import time
+
+BAUDRATES = (100000, 400000)
+CHUNK = 32
+ITERATIONS = 64
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+i2c = I2C(0, I2C.MASTER, baudrate=BAUDRATES[0])
+devices = i2c.scan()
+if not devices:
+    print("SKIP")
+    import sys
+    sys.exit()
+addr = devices[0]
+
+buf = bytearray(CHUNK)
+for baudrate in BAUDRATES:
+    i2c.init(I2C.MASTER, baudrate=baudrate)
+    khz = baudrate // 1000
+
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        i2c.readfrom_into(addr, buf)
+    elapsed = max(time.ticks_diff(time.ticks_us(), start), 1)
+    report('i2c_read_%dkhz' % khz, CHUNK * ITERATIONS * 1000000 // elapsed, 'B/s')
+
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        i2c.scan()
+    report('i2c_scan_%dkhz' % khz, time.ticks_diff(time.ticks_us(), start) // ITERATIONS, 'us')
+
+i2c.deinit()
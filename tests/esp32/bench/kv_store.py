@@ -0,0 +1,70 @@
+"""
+A few counters updated many times, kept in NVS and in a btree file on /flash.
+The *_batch metrics commit or flush once at the end instead of after every
+round of updates. The btree module needs a build with MICROPY_PY_BTREE=1.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import os
+import time
+import pycom
+
+try:
+    import btree
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+FILE = '/flash/kv_bench.db'
+UPDATES = 256
+KEYS = 8
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+def elapsed_us(start):
+    return max(time.ticks_diff(time.ticks_us(), start), 1)
+
+start = time.ticks_us()
+for i in range(UPDATES):
+    pycom.nvs_set('kv_%d' % (i % KEYS), i)
+report('kv_nvs_update', elapsed_us(start) // UPDATES, 'us')
+
+start = time.ticks_us()
+for i in range(UPDATES):
+    pycom.nvs_set('kv_%d' % (i % KEYS), i, commit=False)
+pycom.nvs_commit()
+report('kv_nvs_update_batch', elapsed_us(start) // UPDATES, 'us')
+
+for k in range(KEYS):
+    pycom.nvs_erase('kv_%d' % k)
+
+f = open(FILE, 'w+b')
+db = btree.open(f)
+start = time.ticks_us()
+for i in range(UPDATES):
+    db[b'kv_%d' % (i % KEYS)] = b'%d' % i
+    if i % KEYS == KEYS - 1:
+        db.flush()
+report('kv_btree_update', elapsed_us(start) // UPDATES, 'us')
+
+start = time.ticks_us()
+for i in range(UPDATES):
+    db[b'kv_%d' % (i % KEYS)] = b'%d' % i
+db.flush()
+report('kv_btree_update_batch', elapsed_us(start) // UPDATES, 'us')
+
+start = time.ticks_us()
+for i in range(UPDATES):
+    db[b'kv_%d' % (i % KEYS)]
+report('kv_btree_get', elapsed_us(start) // UPDATES, 'us')
+db.close()
+f.close()
+
+start = time.ticks_us()
+f = open(FILE, 'r+b')
+db = btree.open(f)
+report('kv_btree_open', elapsed_us(start), 'us')
+db.close()
+f.close()
+os.remove(FILE)
@@ -0,0 +1,56 @@
+"""
+LoRa (raw mode) latency from send() to the TX_PACKET_EVENT callback, per
+spreading factor. It transmits on 868.1 MHz, an antenna must be connected.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import os
+import socket
+import time
+
+if os.uname().sysname not in ('LoPy', 'LoPy4', 'FiPy'):
+    print("SKIP")
+    import sys
+    sys.exit()
+from network import LoRa
+
+SPREADING_FACTORS = (7, 9, 12)
+PAYLOAD = bytes(range(16))
+ITERATIONS = 3
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+done = [0]
+def on_tx(lora):
+    if lora.events() & LoRa.TX_PACKET_EVENT:
+        done[0] = time.ticks_us()
+
+lora = LoRa(mode=LoRa.LORA, region=LoRa.EU868, frequency=868100000)
+lora.callback(trigger=LoRa.TX_PACKET_EVENT, handler=on_tx)
+s = socket.socket(socket.AF_LORA, socket.SOCK_RAW)
+s.setblocking(False)
+
+for sf in SPREADING_FACTORS:
+    lora.sf(sf)
+    send_us = []
+    done_us = []
+    for i in range(ITERATIONS):
+        done[0] = 0
+        start = time.ticks_us()
+        s.send(PAYLOAD)
+        send_us.append(time.ticks_diff(time.ticks_us(), start))
+        deadline = time.ticks_add(time.ticks_ms(), 5000)
+        while not done[0] and time.ticks_diff(deadline, time.ticks_ms()) > 0:
+            time.sleep_ms(1)
+        if done[0]:
+            done_us.append(time.ticks_diff(done[0], start))
+        # the duty cycle of the sub-band
+        time.sleep_ms(500)
+    report('lora_send_call_sf%d' % sf, max(send_us), 'us')
+    if done_us:
+        done_us.sort()
+        report('lora_tx_done_sf%d' % sf, done_us[len(done_us) // 2], 'us')
+    report('lora_tx_missed_sf%d' % sf, ITERATIONS - len(done_us), '')
+
+lora.callback(trigger=0)
+s.close()
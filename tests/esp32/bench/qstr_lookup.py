@@ -0,0 +1,45 @@
+"""
+Cost of looking up interned strings: getattr by name for built in and runtime
+names, and compiling a snippet full of identifiers.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import time
+
+ROUNDS = 2000
+RUNTIME_NAMES = 300
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+class Obj:
+    pass
+
+obj = Obj()
+for i in range(RUNTIME_NAMES):
+    setattr(obj, 'bench_attr_%d' % i, i)
+
+# every new string is checked against the interned ones, so building a name
+# is a lookup even before it's used as an attribute
+rom_parts = [n.split(' ') for n in ('app end', 'ext end', 'starts with', 'to_ bytes')]
+ram_parts = [('bench_attr_', str(i)) for i in range(0, RUNTIME_NAMES, 37)]
+
+start = time.ticks_us()
+for i in range(ROUNDS):
+    for p in rom_parts:
+        hasattr([], ''.join(p))
+elapsed = max(time.ticks_diff(time.ticks_us(), start), 1)
+report('qstr_getattr_rom', ROUNDS * len(rom_parts) * 1000000 // elapsed, 'lookup/s')
+
+start = time.ticks_us()
+for i in range(ROUNDS):
+    for p in ram_parts:
+        getattr(obj, ''.join(p))
+elapsed = max(time.ticks_diff(time.ticks_us(), start), 1)
+report('qstr_getattr_ram', ROUNDS * len(ram_parts) * 1000000 // elapsed, 'lookup/s')
+
+src = '\n'.join('bench_attr_%d = len(str(bytearray(%d)))' % (i, i) for i in range(50))
+start = time.ticks_us()
+for i in range(20):
+    compile(src, '<bench>', 'exec')
+elapsed = max(time.ticks_diff(time.ticks_us(), start), 1)
+report('qstr_compile', 20 * 1000000 // elapsed, 'compile/s')
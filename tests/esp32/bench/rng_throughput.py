@@ -0,0 +1,36 @@
+"""
+Hardware RNG throughput, into a preallocated buffer and through os.urandom().
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import machine
+import os
+import time
+
+SIZES = (16, 256, 4096)
+ITERATIONS = 32
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+def rate(nbytes, start):
+    return nbytes * 1000000 // max(time.ticks_diff(time.ticks_us(), start), 1)
+
+report('rng_strong', machine.rng_into(bytearray(4)), '')
+
+for size in SIZES:
+    buf = bytearray(size)
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        machine.rng_into(buf)
+    report('rng_into_%db' % size, rate(size * ITERATIONS, start), 'B/s')
+
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        os.urandom(size)
+    report('urandom_%db' % size, rate(size * ITERATIONS, start), 'B/s')
+
+# the call by call way this replaces, 3 bytes per machine.rng()
+start = time.ticks_us()
+for i in range(4096 // 3):
+    machine.rng()
+report('rng_calls_4096b', rate(4096, start), 'B/s')
@@ -0,0 +1,100 @@
+"""
+TCP and UDP throughput against the sink started by 'run-bench-tests --target esp32',
+over whichever interface is connected. Set BENCH_HOST and BENCH_PORT below when
+running it by hand.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import socket
+import struct
+import time
+
+try:
+    BENCH_HOST
+except NameError:
+    BENCH_HOST = None
+    BENCH_PORT = 8765
+
+CHUNK = 1460
+TCP_BYTES = 256 * 1024
+UDP_DATAGRAMS = 200
+UDP_SIZE = 1024
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+def elapsed_us(start):
+    return max(time.ticks_diff(time.ticks_us(), start), 1)
+
+def connected_interface():
+    from network import WLAN
+    if WLAN().isconnected():
+        return 'wlan'
+    try:
+        from network import LTE
+        if LTE().isconnected():
+            return 'lte'
+    except ImportError:
+        pass
+    return None
+
+iface = connected_interface()
+if BENCH_HOST is None or iface is None:
+    print("SKIP")
+    import sys
+    sys.exit()
+addr = socket.getaddrinfo(BENCH_HOST, BENCH_PORT)[0][-1]
+prefix = 'socket_' + iface
+
+def recv_exact(s, n):
+    data = b''
+    while len(data) < n:
+        chunk = s.recv(n - len(data))
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+# upload, the sink answers with the number of bytes it got
+buf = bytearray(CHUNK)
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(addr)
+s.send(b'U' + struct.pack('>I', TCP_BYTES))
+sent = 0
+start = time.ticks_us()
+while sent < TCP_BYTES:
+    sent += s.send(memoryview(buf)[:min(CHUNK, TCP_BYTES - sent)])
+got = struct.unpack('>I', recv_exact(s, 4))[0]
+report(prefix + '_tcp_tx', got * 1000000 // elapsed_us(start), 'B/s')
+s.close()
+
+# download
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.connect(addr)
+s.send(b'D' + struct.pack('>I', TCP_BYTES))
+got = 0
+mv = memoryview(buf)
+start = time.ticks_us()
+while got < TCP_BYTES:
+    n = s.recv_into(mv)
+    if not n:
+        break
+    got += n
+report(prefix + '_tcp_rx', got * 1000000 // elapsed_us(start), 'B/s')
+s.close()
+
+# the rate the datagrams leave at, and how many of them survived
+payload = bytes(UDP_SIZE)
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+s.settimeout(2)
+start = time.ticks_us()
+for i in range(UDP_DATAGRAMS):
+    s.sendto(payload, addr)
+report(prefix + '_udp_tx', UDP_DATAGRAMS * UDP_SIZE * 1000000 // elapsed_us(start), 'B/s')
+time.sleep_ms(200)
+s.sendto(b'END', addr)
+try:
+    got = int(s.recv(16))
+except OSError:
+    got = 0
+report(prefix + '_udp_loss', 100 - got * 100 // (UDP_DATAGRAMS * UDP_SIZE), '%')
+s.close()
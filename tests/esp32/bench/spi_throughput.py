@@ -0,0 +1,43 @@
+"""
+SPI master throughput, nothing has to be connected to the bus.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+from machine import SPI
+import time
+
+BAUDRATES = (1000000, 10000000, 20000000)
+CHUNK = 1024
+ITERATIONS = 64
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+def rate(nbytes, start):
+    return nbytes * 1000000 // max(time.ticks_diff(time.ticks_us(), start), 1)
+
+tx = bytearray(CHUNK)
+rx = bytearray(CHUNK)
+for i in range(CHUNK):
+    tx[i] = i & 0xFF
+
+for baudrate in BAUDRATES:
+    spi = SPI(0, SPI.MASTER, baudrate=baudrate, polarity=0, phase=0)
+    mhz = baudrate // 1000000
+
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        spi.write(tx)
+    report('spi_write_%dmhz' % mhz, rate(CHUNK * ITERATIONS, start), 'B/s')
+
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        spi.write_readinto(tx, rx)
+    report('spi_write_readinto_%dmhz' % mhz, rate(CHUNK * ITERATIONS, start), 'B/s')
+
+    # the per call overhead dominates the short transfers
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        spi.write(tx[:4])
+    report('spi_write_4b_%dmhz' % mhz, time.ticks_diff(time.ticks_us(), start) // ITERATIONS, 'us')
+
+    spi.deinit()
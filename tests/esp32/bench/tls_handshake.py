@@ -0,0 +1,56 @@
+"""
+TLS handshake time, full and resumed, against BENCH_TLS_HOST (set by
+'run-bench-tests --target esp32 --tls-host', or below when running it by hand).
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+import socket
+import ssl
+import time
+from network import WLAN
+
+try:
+    BENCH_TLS_HOST
+except NameError:
+    BENCH_TLS_HOST = ('www.pycom.io', 443)
+
+ITERATIONS = 5
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+if not WLAN().isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+host, port = BENCH_TLS_HOST
+addr = socket.getaddrinfo(host, port)[0][-1]
+
+def handshake(session=None):
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.connect(addr)
+    start = time.ticks_ms()
+    ss = ssl.wrap_socket(s, server_hostname=host, session=session)
+    elapsed = time.ticks_diff(time.ticks_ms(), start)
+    return ss, elapsed
+
+full = []
+resumed = []
+session = None
+for i in range(ITERATIONS):
+    ss, elapsed = handshake()
+    full.append(elapsed)
+    session = ss.session
+    ss.close()
+    ss, elapsed = handshake(session)
+    # a server without session tickets or ids does a full handshake again
+    if ss.session_reused:
+        resumed.append(elapsed)
+    ss.close()
+
+full.sort()
+report('tls_handshake_full_p50', full[len(full) // 2], 'ms')
+report('tls_handshake_full_max', full[-1], 'ms')
+if resumed:
+    resumed.sort()
+    report('tls_handshake_resumed_p50', resumed[len(resumed) // 2], 'ms')
@@ -0,0 +1,57 @@
+"""
+UART throughput, P9 and P23 (TX and RX of UART 1) must be connected together.
+Prints one '<metric> <value> <unit>' line per measurement.
+"""
+from machine import UART
+import time
+
+BAUDRATES = (115200, 1000000)
+CHUNK = 256
+ITERATIONS = 16
+
+def report(name, value, unit):
+    print('%s %d %s' % (name, value, unit))
+
+tx = bytearray(CHUNK)
+rx = bytearray(CHUNK)
+for i in range(CHUNK):
+    tx[i] = i & 0xFF
+
+uart = UART(1, BAUDRATES[0], pins=('P23', 'P9'), rx_buffer_size=4096)
+uart.write(b'\x55')
+uart.wait_tx_done(100)
+time.sleep_ms(10)
+if uart.read() != b'\x55':
+    print("SKIP")
+    import sys
+    sys.exit()
+
+for baudrate in BAUDRATES:
+    uart.init(baudrate, pins=('P23', 'P9'), rx_buffer_size=4096)
+    uart.read()
+
+    # the line rate bounds this one, the difference is the driver overhead
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        uart.write(tx)
+    uart.wait_tx_done(5000)
+    elapsed = max(time.ticks_diff(time.ticks_us(), start), 1)
+    report('uart_write_%d' % baudrate, CHUNK * ITERATIONS * 1000000 // elapsed, 'B/s')
+    uart.read()
+
+    lost = 0
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        uart.write(tx)
+        got = 0
+        deadline = time.ticks_add(time.ticks_ms(), 1000)
+        while got < CHUNK and time.ticks_diff(deadline, time.ticks_ms()) > 0:
+            n = uart.readinto(memoryview(rx)[got:])
+            if n:
+                got += n
+        lost += CHUNK - got
+    elapsed = max(time.ticks_diff(time.ticks_us(), start), 1)
+    report('uart_loopback_%d' % baudrate, CHUNK * ITERATIONS * 1000000 // elapsed, 'B/s')
+    report('uart_loopback_lost_%d' % baudrate, lost, 'B')
+
+uart.deinit()
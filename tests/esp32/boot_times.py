@@ -0,0 +1,14 @@
+import pycom
+
+# boot phase timestamps recorded since the last hard reset
+
+times = pycom.boot_times()
+names = [t[0] for t in times]
+for name in ('app_main', 'mp_task', 'gc_init', 'mp_init', 'fs_mount', '_boot.py'):
+    print(name, name in names)
+
+# phases are listed in the order they're reached
+print(all(times[i][1] <= times[i + 1][1] for i in range(len(times) - 1)))
+print(all(isinstance(t[1], int) and t[1] > 0 for t in times))
+# a second call returns the same values
+print(pycom.boot_times() == times)
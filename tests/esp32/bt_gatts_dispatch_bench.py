@@ -0,0 +1,61 @@
+"""
+GATTS event dispatch benchmark.
+This test needs a second board running this same script with SERVER = True,
+the board running the test acts as the client and measures the write round trips.
+"""
+from network import Bluetooth
+import time
+
+SERVER = False
+NAME = 'PyGattsBench'
+SMALL_UUID = 0x1000
+LARGE_UUID = 0x2000
+SMALL_CHARS = 2
+LARGE_CHARS = 60
+ITERATIONS = 50
+# the write to the last attribute of the large table can't be slower than this
+# fraction of the write to the first attribute of the small table
+TOLERANCE = 1.25
+
+bt = Bluetooth()
+
+if SERVER:
+    bt.set_advertisement(name=NAME)
+    chars = []
+    for uuid, nbr in ((SMALL_UUID, SMALL_CHARS), (LARGE_UUID, LARGE_CHARS)):
+        srv = bt.service(uuid=uuid, isprimary=True, nbr_chars=nbr)
+        for i in range(nbr):
+            chars.append(srv.characteristic(uuid=uuid + 1 + i, value=0))
+    bt.advertise(True)
+    while True:
+        time.sleep(1)
+
+print('Starting GATTS dispatch benchmark')
+
+bt.start_scan(10)
+conn = None
+while bt.isscanning() and conn is None:
+    adv = bt.get_adv()
+    if adv and bt.resolve_adv_data(adv.data, Bluetooth.ADV_NAME_CMPL) == NAME:
+        bt.stop_scan()
+        conn = bt.connect(adv.mac)
+print(conn is not None)
+
+tables = {}
+for srv in conn.services():
+    if srv.uuid() in (SMALL_UUID, LARGE_UUID):
+        tables[srv.uuid()] = srv.characteristics()
+print(len(tables[SMALL_UUID]), len(tables[LARGE_UUID]))
+
+def write_time(chr):
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        chr.write(bytes([i]))
+    return time.ticks_diff(time.ticks_us(), start) // ITERATIONS
+
+small = write_time(tables[SMALL_UUID][0])
+large = write_time(tables[LARGE_UUID][-1])
+print('dispatch:', 'OK' if large < small * TOLERANCE else 'SLOW (%d us vs %d us)' % (large, small))
+
+conn.disconnect()
+bt.deinit()
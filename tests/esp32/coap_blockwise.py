@@ -0,0 +1,60 @@
+import os
+from network import WLAN
+from network import Coap
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+SIZE = 3000
+BLOCK_SIZE = 256
+FILE = '/flash/coap_block.bin'
+
+print('Starting CoAP block-wise test')
+
+ip = wlan.ifconfig()[0]
+Coap.init(ip, service_discovery=False, block_size=BLOCK_SIZE)
+
+value = bytes((i & 0x3F) + 0x30 for i in range(SIZE))
+res = Coap.add_resource('block', media_type=Coap.MEDIATYPE_APP_OCTET_STREAM, value=value)
+res.callback(Coap.REQUEST_GET | Coap.REQUEST_PUT, True)
+
+responses = []
+
+def response_callback(code, id_param, type_param, token, payload):
+    responses.append((code, payload))
+
+Coap.register_response_handler(response_callback)
+
+def request(method, **kwargs):
+    del responses[:]
+    Coap.send_request(ip, method, uri_path='block', token='b', **kwargs)
+    # the requests and their responses are all served by this socket
+    while not responses:
+        Coap.read()
+    return responses[0]
+
+# Block2: the value is served in blocks and collected by the client
+code, payload = request(Coap.REQUEST_GET)
+print(code, payload == value)
+
+# Block2 with a smaller size negotiated by the client, written to a file
+with open(FILE, 'wb') as f:
+    code, payload = request(Coap.REQUEST_GET, block_size=64, response_stream=f)
+print(code, payload)
+with open(FILE, 'rb') as f:
+    print(f.read() == value)
+
+# Block1: the payload is streamed from the file
+with open(FILE, 'wb') as f:
+    f.write(value[::-1])
+with open(FILE, 'rb') as f:
+    code, payload = request(Coap.REQUEST_PUT, payload=f)
+print(code, payload)
+print(res.value() == value[::-1])
+
+os.remove(FILE)
+Coap.remove_resource('block')
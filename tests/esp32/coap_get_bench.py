@@ -0,0 +1,54 @@
+import time
+from network import WLAN
+from network import Coap
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+RESOURCES = 300
+REQUESTS = 20
+# the lookup must not depend on how many resources were registered before the requested one
+LATENCY_RATIO_MAX = 1.5
+
+print('Starting CoAP GET benchmark')
+
+ip = wlan.ifconfig()[0]
+Coap.init(ip, service_discovery=False)
+
+for i in range(RESOURCES):
+    Coap.add_resource('bench/%d' % i, media_type=Coap.MEDIATYPE_TEXT_PLAIN, value='%d' % i)
+print(Coap.get_resource('bench/%d' % (RESOURCES - 1)) is not None)
+
+responses = []
+
+def response_callback(code, id_param, type_param, token, payload):
+    responses.append(payload)
+
+Coap.register_response_handler(response_callback)
+
+def get_latency(path):
+    total = 0
+    for _ in range(REQUESTS):
+        del responses[:]
+        start = time.ticks_us()
+        Coap.send_request(ip, Coap.REQUEST_GET, uri_path=path)
+        # the request and then its response are both served by this socket
+        while not responses:
+            Coap.read()
+        total += time.ticks_diff(time.ticks_us(), start)
+    return total // REQUESTS, responses[0]
+
+first, payload = get_latency('bench/0')
+print(payload)
+last, payload = get_latency('bench/%d' % (RESOURCES - 1))
+print(payload)
+
+print('latency:', 'OK' if last <= first * LATENCY_RATIO_MAX else 'SLOW')
+
+for i in range(RESOURCES):
+    Coap.remove_resource('bench/%d' % i)
+print(Coap.get_resource('bench/0') is None)
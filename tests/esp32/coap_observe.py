@@ -0,0 +1,44 @@
+from network import WLAN
+from network import Coap
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+UPDATES = 3
+
+print('Starting CoAP observe test')
+
+ip = wlan.ifconfig()[0]
+Coap.init(ip, service_discovery=False)
+
+res = Coap.add_resource('observed', media_type=Coap.MEDIATYPE_TEXT_PLAIN, value='0', observable=True)
+res.callback(Coap.REQUEST_GET, True)
+
+responses = []
+
+def response_callback(code, id_param, type_param, token, payload):
+    responses.append(payload)
+
+Coap.register_response_handler(response_callback)
+
+def wait_for(count):
+    # the requests, notifications and their acknowledgements are all served by this socket
+    while len(responses) < count:
+        Coap.read()
+
+# the response of the registration is the first notification
+Coap.send_request(ip, Coap.REQUEST_GET, uri_path='observed', token='o', observe=True)
+wait_for(1)
+
+# every update is pushed to the observer without polling
+for i in range(1, UPDATES + 1):
+    res.value(str(i))
+    wait_for(i + 1)
+
+print(responses)
+
+Coap.remove_resource('observed')
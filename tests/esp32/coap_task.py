@@ -0,0 +1,48 @@
+import time
+from network import WLAN
+from network import Coap
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+TIMEOUT_MS = 2000
+
+print('Starting CoAP server task test')
+
+ip = wlan.ifconfig()[0]
+# nothing calls Coap.read(), the dedicated task serves the socket
+Coap.init(ip, service_discovery=False, dedicated_task=True)
+
+res = Coap.add_resource('task', media_type=Coap.MEDIATYPE_TEXT_PLAIN, value='native')
+res.callback(Coap.REQUEST_GET | Coap.REQUEST_PUT, True)
+
+responses = []
+
+def response_callback(code, id_param, type_param, token, payload):
+    responses.append((code, payload))
+
+Coap.register_response_handler(response_callback)
+
+def request(method, **kwargs):
+    del responses[:]
+    Coap.send_request(ip, method, uri_path='task', **kwargs)
+    start = time.ticks_ms()
+    while not responses and time.ticks_diff(time.ticks_ms(), start) < TIMEOUT_MS:
+        time.sleep_ms(10)
+    return responses[0] if responses else None
+
+# the GET is answered by the task, the response is delivered to Python
+print(request(Coap.REQUEST_GET))
+
+# the PUT is handed over to the interpreter, its response has no payload to be reported
+Coap.send_request(ip, Coap.REQUEST_PUT, uri_path='task', payload='updated')
+start = time.ticks_ms()
+while res.value() != b'updated' and time.ticks_diff(time.ticks_ms(), start) < TIMEOUT_MS:
+    time.sleep_ms(10)
+print(res.value())
+
+Coap.remove_resource('task')
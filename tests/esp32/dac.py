@@ -46,3 +46,31 @@ try:
     dac.tone(21000,0)
 except Exception:
     print("Exception")
+
+# waveforms through I2S DMA, a 1kHz sawtooth at 64kHz
+import time
+wave = bytearray(range(0, 256, 4))
+dac = DAC('P22')
+dac.play(wave, 64000, loop=True)
+print(dac.playing())
+time.sleep_ms(50)
+print(dac.playing())
+dac.stop()
+print(dac.playing())
+
+# double buffered, the second play() only waits for the first buffer
+a = bytearray(range(256)) * 16
+b = bytearray(reversed(range(256))) * 16
+start = time.ticks_ms()
+dac.play(a, 100000)
+dac.play(b, 100000)
+print(time.ticks_diff(time.ticks_ms(), start) < 60)
+while dac.playing():
+    time.sleep_ms(1)
+print(time.ticks_diff(time.ticks_ms(), start) >= 80)
+
+try:
+    dac.play(wave, 10)
+except ValueError:
+    print("ValueError")
+dac.deinit()
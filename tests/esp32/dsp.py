@@ -0,0 +1,88 @@
+'''
+Kernels of the udsp module against the same computations in Python
+'''
+
+import math
+import udsp
+from array import array
+
+def zeros(typecode, n):
+    return array(typecode, [0] * n)
+
+x = array('h', [100, -200, 300, -400, 32767, -32768, 0, 7])
+y = array('h', [1, 2, 3, 4, 5, 6, 7, 8])
+d = zeros('h', len(x))
+
+print(udsp.sum(x) == sum(x), udsp.minmax(x))
+print(abs(udsp.mean(x) - sum(x) / len(x)) < 1e-3)
+print(abs(udsp.rms(x) - math.sqrt(sum(v * v for v in x) / len(x))) < 0.5)
+print(udsp.dot(x, y) == sum(a * b for a, b in zip(x, y)))
+print(udsp.threshold(x, 0), udsp.threshold(array('H', [10, 4000, 3000]), 2000))
+
+# int16 saturates, arrays multiply as Q15
+udsp.add(d, x, y)
+print(list(d))
+udsp.sub(d, x, 1000)
+print(list(d))
+udsp.mul(d, x, array('h', [16384] * len(x)))
+print(list(d))
+udsp.mul(d, x, 2)
+print(list(d))
+
+f = array('f', [1.5, -2.0, 4.0, 0.5])
+g = zeros('f', len(f))
+udsp.mul(g, f, f)
+print(list(g), udsp.sum(f), udsp.minmax(f))
+
+m = zeros('f', 3)
+udsp.moving_average(m, f, 2)
+print(list(m))
+a = zeros('H', 4)
+udsp.moving_average(a, array('H', [10, 20, 30, 40, 50]), 2)
+print(list(a))
+
+# a block by block FIR gives the same output as the whole signal at once
+taps = array('h', [8192, 16384, 8192])
+sig = array('h', [i * 1000 for i in range(-8, 8)])
+whole = zeros('h', len(sig))
+udsp.fir(whole, sig, taps)
+hist = zeros('h', 2)
+out = []
+for i in range(0, len(sig), 4):
+    part = zeros('h', 4)
+    udsp.fir(part, sig[i:i + 4], taps, hist)
+    out.extend(part)
+print(list(whole) == out, list(whole[:4]))
+ftaps = array('f', [0.25, 0.5, 0.25])
+fsig = array('f', sig)
+fout = zeros('f', len(sig))
+udsp.fir(fout, fsig, ftaps)
+print(all(abs(a - b) <= 1 for a, b in zip(fout, whole)))
+
+# a tone in bin 3, then back again
+N = 64
+re = array('f', [math.cos(2 * math.pi * 3 * i / N) for i in range(N)])
+im = zeros('f', N)
+orig = array('f', re)
+udsp.fft(re, im)
+mag = zeros('f', N)
+udsp.magnitude(mag, re, im)
+peak = max(range(N // 2), key=lambda i: mag[i])
+print(peak, abs(mag[peak] - N / 2) < 1e-2)
+udsp.fft(re, im, inverse=True)
+print(max(abs(a - b) for a, b in zip(re, orig)) < 1e-4)
+
+fl = zeros('f', 3)
+udsp.to_float(fl, array('h', [-32768, 0, 16384]), 1 / 32768)
+print(list(fl))
+h = zeros('h', 3)
+udsp.to_int16(h, array('f', [-1.5, 0.4, 2.0]), 20000)
+print(list(h))
+
+for bad in (lambda: udsp.sum(zeros('i', 3)),
+            lambda: udsp.add(d, x, zeros('h', 2)),
+            lambda: udsp.fft(zeros('f', 6), zeros('f', 6))):
+    try:
+        bad()
+    except ValueError as e:
+        print('ValueError', e)
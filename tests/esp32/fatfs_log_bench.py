@@ -0,0 +1,44 @@
+import os
+import time
+import pycom
+
+# the write-back block cache only serves FatFS on /flash
+if pycom.bootmgr()[1] != 'FAT':
+    print("SKIP")
+    import sys
+    sys.exit()
+
+FILE = '/flash/fat_log.txt'
+LINES = 400
+LINE = 'temperature=21.5 humidity=48 battery=3.87\n'
+# with a single cached block the data, FAT and directory sectors evicted each other and
+# every switch between them cost a 4 KB erase/program cycle
+LINES_PER_S_MIN = 200
+
+print('Starting FatFS logging benchmark')
+
+try:
+    os.remove(FILE)
+except OSError:
+    pass
+
+start = time.ticks_ms()
+with open(FILE, 'w') as f:
+    for i in range(LINES):
+        f.write(LINE)
+elapsed = max(time.ticks_diff(time.ticks_ms(), start), 1)
+print('logging:', 'OK' if LINES * 1000 // elapsed >= LINES_PER_S_MIN else 'SLOW')
+
+# close must have written everything back
+print(os.stat(FILE)[6] == LINES * len(LINE))
+with open(FILE, 'r') as f:
+    print(f.readline() == LINE)
+
+# flushing every line writes each touched block back once
+with open(FILE, 'a') as f:
+    for i in range(LINES // 10):
+        f.write(LINE)
+        f.flush()
+print(os.stat(FILE)[6] == (LINES + LINES // 10) * len(LINE))
+
+os.remove(FILE)
@@ -0,0 +1,44 @@
+import gc
+import pycom
+
+# the unused 'dummy' data partition only exists in the 4MB layout
+try:
+    pycom.flash_mmap('dummy', 0, 1)
+except ValueError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+BLOB = bytes(range(256)) * 32
+
+pycom.flash_write('dummy', 4096, BLOB)
+gc.collect()
+free = gc.mem_free()
+m = pycom.flash_mmap('dummy', 4096, len(BLOB))
+# mapping costs only the memoryview object, not the data
+used = free - gc.mem_free()
+print(len(m), m[0], m[255], m[-1])
+print(bytes(m[256:260]))
+print(bytes(m) == BLOB)
+print(used < 256)
+
+try:
+    m[0] = 1
+except TypeError:
+    print('TypeError')
+
+for part in ('fs', 'config', 'factory'):
+    try:
+        pycom.flash_write(part, 0, b'x')
+    except ValueError:
+        print('ValueError')
+
+try:
+    pycom.flash_mmap('dummy', 0, 0x100000)
+except ValueError:
+    print('ValueError')
+
+try:
+    pycom.flash_write('dummy', 1, b'x')
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,96 @@
+import os
+import socket
+from network import WLAN
+from network import Server
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+USER = 'micro'
+PASS = 'python'
+DIR = '/flash/ftp_list'
+# enough entries to need several listing buffers
+FILES = 200
+
+server = Server(login=(USER, PASS), timeout=60)
+ip = wlan.ifconfig()[0]
+
+print('Starting FTP listing test')
+
+def reply(s):
+    lines = []
+    while True:
+        line = b''
+        while not line.endswith(b'\r\n'):
+            line += s.recv(1)
+        lines.append(line)
+        # multi-line replies end with 'NNN '
+        if line[3:4] == b' ' and line[:3].isdigit():
+            return int(line[:3]), lines
+
+def pasv(s):
+    s.send('PASV\r\n')
+    _, lines = reply(s)
+    line = lines[0]
+    fields = line[line.index(b'(') + 1:line.index(b')')].split(b',')
+    d = socket.socket()
+    d.connect(socket.getaddrinfo(ip, (int(fields[4]) << 8) + int(fields[5]))[0][-1])
+    return d
+
+def listing(s, cmd):
+    d = pasv(s)
+    s.send(cmd + '\r\n')
+    code = reply(s)[0]
+    data = b''
+    while True:
+        chunk = d.recv(1024)
+        if not chunk:
+            break
+        data += chunk
+    d.close()
+    return code, reply(s)[0], data.split(b'\r\n')[:-1]
+
+os.mkdir(DIR)
+for i in range(FILES):
+    with open('%s/f%d' % (DIR, i), 'w') as f:
+        f.write('x' * i)
+
+s = socket.socket()
+s.connect(socket.getaddrinfo(ip, 21)[0][-1])
+reply(s)
+s.send('USER %s\r\n' % USER)
+reply(s)
+s.send('PASS %s\r\n' % PASS)
+print(reply(s)[0])
+
+s.send('FEAT\r\n')
+code, lines = reply(s)
+print(code, any(b'MLST' in l for l in lines))
+
+s.send('CWD %s\r\n' % DIR)
+print(reply(s)[0])
+
+code, end, entries = listing(s, 'LIST')
+print(code, end, len(entries))
+
+code, end, entries = listing(s, 'MLSD')
+print(code, end, len(entries))
+sizes = {}
+for entry in entries:
+    facts, name = entry.split(b' ', 1)
+    for fact in facts.split(b';'):
+        if fact.startswith(b'size='):
+            sizes[name] = int(fact[5:])
+print(all(sizes[b'f%d' % i] == i for i in range(FILES)))
+
+s.send('QUIT\r\n')
+reply(s)
+s.close()
+
+for i in range(FILES):
+    os.remove('%s/f%d' % (DIR, i))
+os.rmdir(DIR)
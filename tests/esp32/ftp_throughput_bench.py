@@ -0,0 +1,95 @@
+import os
+import time
+import socket
+from network import WLAN
+from network import Server
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+USER = 'micro'
+PASS = 'python'
+FILE = '/flash/ftp_bench.bin'
+CHUNK = 1024
+CHUNKS = 128
+# the old server moved 512 bytes per 4 ms servers cycle, i.e. ~128 KB/s at best
+THROUGHPUT_MIN = 128 * 1024
+
+server = Server(login=(USER, PASS), timeout=60)
+ip = wlan.ifconfig()[0]
+
+print('Starting FTP throughput benchmark')
+
+def reply(s):
+    line = b''
+    while not line.endswith(b'\r\n'):
+        line += s.recv(1)
+    return int(line[:3])
+
+def login():
+    s = socket.socket()
+    s.connect(socket.getaddrinfo(ip, 21)[0][-1])
+    reply(s)
+    s.send('USER %s\r\n' % USER)
+    reply(s)
+    s.send('PASS %s\r\n' % PASS)
+    return s, reply(s)
+
+def pasv(s):
+    s.send('PASV\r\n')
+    line = b''
+    while not line.endswith(b'\r\n'):
+        line += s.recv(1)
+    fields = line[line.index(b'(') + 1:line.index(b')')].split(b',')
+    d = socket.socket()
+    d.connect(socket.getaddrinfo(ip, (int(fields[4]) << 8) + int(fields[5]))[0][-1])
+    return d
+
+# several sessions can be logged in at the same time
+sessions = [login() for _ in range(3)]
+print([code for _, code in sessions])
+for s, _ in sessions[1:]:
+    s.send('QUIT\r\n')
+    reply(s)
+    s.close()
+s = sessions[0][0]
+
+buf = bytes(range(256)) * (CHUNK // 256)
+
+d = pasv(s)
+start = time.ticks_ms()
+s.send('STOR %s\r\n' % FILE)
+print(reply(s))
+for _ in range(CHUNKS):
+    d.send(buf)
+d.close()
+print(reply(s))
+up = time.ticks_diff(time.ticks_ms(), start)
+print(os.stat(FILE)[6] == CHUNK * CHUNKS)
+
+d = pasv(s)
+start = time.ticks_ms()
+s.send('RETR %s\r\n' % FILE)
+print(reply(s))
+received = 0
+while True:
+    data = d.recv(CHUNK)
+    if not data:
+        break
+    received += len(data)
+d.close()
+print(reply(s))
+down = time.ticks_diff(time.ticks_ms(), start)
+print(received == CHUNK * CHUNKS)
+
+s.send('QUIT\r\n')
+reply(s)
+s.close()
+os.remove(FILE)
+
+print('upload:', 'OK' if (CHUNK * CHUNKS * 1000) // max(up, 1) >= THROUGHPUT_MIN else 'SLOW')
+print('download:', 'OK' if (CHUNK * CHUNKS * 1000) // max(down, 1) >= THROUGHPUT_MIN else 'SLOW')
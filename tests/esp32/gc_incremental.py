@@ -0,0 +1,26 @@
+# test the lazy sweep: objects kept across incremental collections stay intact
+
+import gc
+import time
+
+gc.incremental(True)
+print(gc.incremental())
+
+keep = [None] * 64
+for i in range(5000):
+    b = bytearray(200)
+    b[0] = b[-1] = i & 0xff
+    keep[i % 64] = b
+    # idle time sweeps too
+    if i % 1000 == 0:
+        time.sleep_ms(5)
+
+print(all(b[0] == b[-1] for b in keep))
+s = gc.stats()
+print(len(s), s[0] > 0, s[1] >= s[0], s[3] >= s[2], s[4] >= s[3])
+
+# an explicit collection returns with the heap swept
+gc.collect()
+free = gc.mem_free()
+gc.incremental(False)
+print(gc.incremental(), gc.mem_free() == free)
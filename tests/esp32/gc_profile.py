@@ -0,0 +1,29 @@
+# test the allocation profiler: sites are the functions allocating, histograms add up
+
+import gc
+
+def make_bufs(n):
+    return [bytearray(400) for i in range(n)]
+
+def strings(n):
+    for i in range(n):
+        yield str(i) * 10
+
+print(gc.profile())
+gc.profile(True)
+print(gc.profile())
+b = make_bufs(100)
+c = list(strings(100))
+gc.profile(False)
+
+sites, sizes, largest, runs = gc.profile_data()
+names = [s[0] for s in sites]
+print('<listcomp>' in names, 'strings' in names)
+print(all(s[2] > 0 and s[3] > 0 for s in sites))
+print(len(sizes), sum(sizes) >= 200)
+print(largest > 0, sum(runs) > 0)
+
+# starting again clears the counts
+gc.profile(True)
+gc.profile(False)
+print(gc.profile_data()[0])
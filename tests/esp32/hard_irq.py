@@ -0,0 +1,34 @@
+'''
+Hard callbacks of the timer alarms, they run ahead of the others with the heap locked
+'''
+
+import time
+from machine import Timer
+
+counts = bytearray(2)
+
+def tick(alarm):
+    counts[0] += 1
+
+alarm = Timer.Alarm(tick, ms=10, periodic=True, hard=True)
+time.sleep_ms(105)
+alarm.cancel()
+print(9 <= counts[0] <= 11)
+
+# an allocation raises instead of reaching the heap
+def alloc(alarm):
+    try:
+        [1, 2, 3]
+        counts[1] = 1
+    except MemoryError:
+        counts[1] = 2
+
+alarm = Timer.Alarm(alloc, ms=5, hard=True)
+time.sleep_ms(30)
+print(counts[1])
+
+# back to a regular callback, it can allocate again
+counts[1] = 0
+alarm.callback(alloc)
+time.sleep_ms(30)
+print(counts[1])
@@ -0,0 +1,30 @@
+# HMAC-SHA256 and file digests
+import hashlib
+import ubinascii
+import uos
+
+# RFC 4231 test cases 2 and 6
+h = hashlib.hmac_sha256(b'Jefe')
+h.update(b'what do ya ')
+h.update(b'want for nothing?')
+print(ubinascii.hexlify(h.digest()))
+h = hashlib.hmac_sha256(b'\xaa' * 131, b'Test Using Larger Than Block-Size Key - Hash Key First')
+print(ubinascii.hexlify(h.digest()))
+
+# a file longer than a chunk, and not a multiple of it
+data = bytes(range(256)) * 41
+with open('/flash/hash.bin', 'wb') as f:
+    f.write(data)
+print(hashlib.file_digest('/flash/hash.bin') == hashlib.sha256(data).digest())
+print(hashlib.file_digest('/flash/hash.bin', 'md5') == hashlib.md5(data).digest())
+print(hashlib.file_digest('/flash/hash.bin', hashlib.sha512) == hashlib.sha512(data).digest())
+uos.remove('/flash/hash.bin')
+
+try:
+    hashlib.file_digest('/flash/hash.bin')
+except OSError:
+    print('OSError')
+try:
+    hashlib.file_digest('/flash/hash.bin', 'sha3')
+except ValueError:
+    print('ValueError')
@@ -1,11 +1,14 @@
-# test single hash operation lock
+# test several hash operations at a time, the ones not holding the hardware unit run in software
 
 import hashlib
 
-try:
-    h1 = hashlib.sha256()
-    h2 = hashlib.sha256()
-except OSError as e:
-    print(e)
-finally:
-    h1.digest()
+h1 = hashlib.sha256()
+h2 = hashlib.sha256()
+h1.update(b'pycom')
+h2.update(b'pycom')
+print(h1.digest() == h2.digest() == hashlib.sha256(b'pycom').digest())
+
+# a hash dropped before its digest doesn't keep the unit
+h3 = hashlib.sha1(b'pycom')
+h3 = None
+print(hashlib.sha1(b'pycom').digest())
@@ -0,0 +1,28 @@
+import pycom
+import time
+
+hb = pycom.heartbeat()
+
+pycom.heartbeat(True)
+print(pycom.heartbeat())
+try:
+    pycom.rgbled(0x000010)
+except OSError:
+    print('OSError')
+time.sleep_ms(200)
+
+pycom.heartbeat(False)
+print(pycom.heartbeat())
+pycom.rgbled(0x001000)
+time.sleep_ms(100)
+
+# off releases the led, the next color takes it back
+pycom.rgbled(None)
+pycom.rgbled(None)
+pycom.rgbled(0x100000)
+time.sleep_ms(100)
+pycom.rgbled(None)
+
+pycom.heartbeat(True)
+print(pycom.heartbeat())
+pycom.heartbeat(hb)
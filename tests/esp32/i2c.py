@@ -119,6 +119,20 @@ print(2 == i2c.writeto(addr, reg2)) # write the register address and the data
 i2c.readfrom_mem_into(addr, 107, reg) # check it back
 print(reg[0] == 0)
 
+# batched transactions, register reads with repeated starts
+who = bytearray(1)
+pwr = bytearray(2)
+i2c.transaction([(I2C.WRITE, addr, b'\x75'), I2C.RESTART, (I2C.READ, addr, who),
+                 (I2C.WRITE, addr, b'\x6b'), I2C.RESTART, (I2C.READ, addr, pwr)])
+print(who[0] == 0x68)
+print(pwr == b'\x00\x00')
+i2c.transaction([(I2C.WRITE, addr, b'\x6b\x40'), (I2C.WRITE, addr, b'\x6b'), I2C.RESTART, (I2C.READ, addr, reg)])
+print(reg[0] == 0x40)
+try:
+    i2c.transaction([(I2C.READ, addr, bytearray(0))])
+except ValueError:
+    print("ValueError")
+
 
 # check for memory leaks...
 for i in range (0, 1000):
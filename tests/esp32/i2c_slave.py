@@ -0,0 +1,47 @@
+'''
+I2C0 is the master on P9 (SDA) and P10 (SCL), wired to I2C1 as the slave on P11 (SDA) and P12 (SCL)
+'''
+
+from machine import I2C
+import time
+
+regs = bytearray(range(16))
+slave = I2C(1, I2C.SLAVE, pins=('P11', 'P12'), addr=0x42, buf=regs)
+print(slave)
+master = I2C(0, I2C.MASTER, pins=('P9', 'P10'), baudrate=400000)
+print(0x42 in master.scan())
+
+# reads are served from the buffer, the pointer goes on from the last byte read
+print(master.readfrom_mem(0x42, 4, 4) == bytes([4, 5, 6, 7]))
+print(master.readfrom(0x42, 2) == bytes([8, 9]))
+# and wraps around at the end of the map
+print(master.readfrom_mem(0x42, 14, 4) == bytes([14, 15, 0, 1]))
+
+writes = []
+slave.irq(handler=lambda i2c: writes.append(bytes(regs[0:2])))
+master.writeto_mem(0x42, 0, b'\xaa\x55')
+time.sleep_ms(10)
+print(regs[0:2] == b'\xaa\x55', writes)
+
+# Python updates the snapshot in place
+regs[8] = 0x99
+print(master.readfrom_mem(0x42, 8, 1))
+slave.irq(handler=None)
+
+# bytes can't be written by the host
+slave.init(I2C.SLAVE, pins=('P11', 'P12'), addr=0x42, buf=b'\x01\x02')
+master.writeto_mem(0x42, 0, b'\xff')
+print(master.readfrom_mem(0x42, 0, 2))
+
+try:
+    I2C(2, I2C.SLAVE, addr=0x42, buf=regs)
+except ValueError:
+    print("ValueError")
+try:
+    I2C(1, I2C.SLAVE, pins=('P11', 'P12'), addr=0x42)
+except ValueError:
+    print("ValueError")
+
+slave.deinit()
+print(slave)
+print(0x42 in master.scan())
@@ -0,0 +1,53 @@
+'''
+I2S master without any device attached, P10/P11/P12 are clock, word select and data
+'''
+
+import time
+from machine import I2S, DAC
+
+# 16 kHz mono 16 bit, 4096 bytes of DMA ring in 8 buffers of 256 frames
+tx = I2S(1, mode=I2S.TX, sck='P10', ws='P11', sd='P12', rate=16000, ibuf=4096)
+print(tx)
+
+calls = []
+tx.irq(handler=lambda i2s: calls.append(time.ticks_ms()))
+# it doesn't wait with a timeout of 0, the ring only takes what's free in it
+print(tx.write(bytearray(8192), 0) <= 8192)
+print(tx.write(bytearray(1024)))
+time.sleep_ms(300)
+# every half of the ring, 64 ms at this rate
+print(len(calls) >= 3)
+tx.irq(handler=None)
+
+try:
+    tx.readinto(bytearray(16))
+except OSError:
+    print("OSError")
+tx.deinit()
+print(tx)
+
+rx = I2S(1, mode=I2S.RX, sck='P10', ws='P11', sd='P12', rate=16000, bits=32, format=I2S.STEREO)
+buf = bytearray(12800)
+start = time.ticks_ms()
+print(rx.readinto(buf))
+# 1600 frames of 8 bytes are 100 ms
+print(time.ticks_diff(time.ticks_ms(), start) >= 90)
+print(rx.readinto(buf, 0) <= len(buf))
+rx.deinit()
+
+# I2S0 is shared with DAC.play()
+i2s = I2S(0, mode=I2S.TX, sck='P10', ws='P11', sd='P12')
+try:
+    DAC('P22').play(bytearray(64), 8000)
+except OSError:
+    print("OSError")
+i2s.deinit()
+
+try:
+    I2S(1, mode=I2S.TX, sck='P10', ws='P11', sd='P12', bits=8)
+except ValueError:
+    print("ValueError")
+try:
+    I2S(1, mode=I2S.TX)
+except ValueError:
+    print("ValueError")
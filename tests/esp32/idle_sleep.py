@@ -0,0 +1,26 @@
+import machine
+import time
+from network import WLAN, Bluetooth
+
+# the radios keep the chip awake, switch them off for the test
+WLAN().deinit()
+Bluetooth().deinit()
+
+print(machine.idle_sleep())
+machine.idle_sleep(True, min_ms=10)
+print(machine.idle_sleep())
+
+# the waits last as long as asked even when spent in light sleep
+t = time.ticks_ms()
+for i in range(10):
+    time.sleep_ms(50)
+dt = time.ticks_diff(time.ticks_ms(), t)
+print(500 <= dt < 600)
+
+# shorter than min_ms, just a delay
+t = time.ticks_ms()
+time.sleep_ms(5)
+print(5 <= time.ticks_diff(time.ticks_ms(), t) < 20)
+
+machine.idle_sleep(False)
+print(machine.idle_sleep())
@@ -0,0 +1,50 @@
+import gc
+import sys
+import time
+
+# only the Pybytes firmware freezes the Pybytes library
+try:
+    import _pybytes
+except ImportError:
+    print("SKIP")
+    sys.exit()
+
+MODULE = '_pybytes'
+RUNS = 8
+# frozen modules run their bytecode from flash, what's left on the heap is the
+# module globals, the classes and the function objects
+IMPORT_US_MAX = 20000
+HEAP_DELTA_MAX = 8 * 1024
+ALLOCS_MAX = 400
+
+print('Starting frozen import benchmark')
+
+def check(name, value, maximum):
+    print('%s: %s' % (name, 'OK' if value <= maximum else 'SLOW'))
+
+def import_once():
+    del sys.modules[MODULE]
+    gc.collect()
+    before = gc.mem_alloc()
+    start = time.ticks_us()
+    __import__(MODULE)
+    elapsed = time.ticks_diff(time.ticks_us(), start)
+    gc.collect()
+    return elapsed, gc.mem_alloc() - before
+
+best = None
+delta = 0
+for i in range(RUNS):
+    elapsed, delta = import_once()
+    if best is None or elapsed < best:
+        best = elapsed
+check('import time', best, IMPORT_US_MAX)
+check('heap delta', delta, HEAP_DELTA_MAX)
+
+gc.profile(True)
+import_once()
+allocs = sum(gc.profile_data()[1])
+gc.profile(False)
+check('allocations', allocs, ALLOCS_MAX)
+
+print(hasattr(sys.modules[MODULE], 'Pybytes'))
@@ -0,0 +1,83 @@
+import os
+import time
+import pycom
+
+# the page granular read/prog paths only exist on LittleFS
+if pycom.bootmgr()[1] != 'LittleFS':
+    print("SKIP")
+    import sys
+    sys.exit()
+
+FILE = '/flash/lfs_bench.bin'
+CHUNK = 1024
+CHUNKS = 128
+RANDOM_OPS = 256
+RANDOM_SIZE = 64
+# with whole block read/prog every small access moved 4 KB through the flash
+SEQ_WRITE_MIN = 32 * 1024
+SEQ_READ_MIN = 256 * 1024
+RANDOM_READ_MIN = 64
+RANDOM_WRITE_MIN = 16
+
+print('Starting LittleFS throughput benchmark')
+
+def check(name, value, minimum):
+    print('%s: %s' % (name, 'OK' if value >= minimum else 'SLOW'))
+
+def rate(nbytes, start):
+    return nbytes * 1000 // max(time.ticks_diff(time.ticks_ms(), start), 1)
+
+def ops_rate(nops, start):
+    return nops * 1000 // max(time.ticks_diff(time.ticks_ms(), start), 1)
+
+data = bytearray(CHUNK)
+for i in range(CHUNK):
+    data[i] = i & 0xFF
+
+start = time.ticks_ms()
+with open(FILE, 'wb') as f:
+    for i in range(CHUNKS):
+        f.write(data)
+check('sequential write', rate(CHUNK * CHUNKS, start), SEQ_WRITE_MIN)
+
+print(os.stat(FILE)[6] == CHUNK * CHUNKS)
+
+buf = bytearray(CHUNK)
+good = True
+start = time.ticks_ms()
+with open(FILE, 'rb') as f:
+    for i in range(CHUNKS):
+        f.readinto(buf)
+        good = good and (buf == data)
+check('sequential read', rate(CHUNK * CHUNKS, start), SEQ_READ_MIN)
+print(good)
+
+# deterministic offsets spread over the whole file
+small = bytearray(RANDOM_SIZE)
+offsets = [((i * 7919) % (CHUNK * CHUNKS - RANDOM_SIZE)) & ~3 for i in range(RANDOM_OPS)]
+
+good = True
+start = time.ticks_ms()
+with open(FILE, 'rb') as f:
+    for off in offsets:
+        f.seek(off)
+        f.readinto(small)
+        good = good and (small[0] == off & 0xFF)
+check('random read', ops_rate(RANDOM_OPS, start), RANDOM_READ_MIN)
+print(good)
+
+patch = bytes(RANDOM_SIZE)
+start = time.ticks_ms()
+with open(FILE, 'r+b') as f:
+    for off in offsets[:RANDOM_OPS // 4]:
+        f.seek(off)
+        f.write(patch)
+check('random write', ops_rate(RANDOM_OPS // 4, start), RANDOM_WRITE_MIN)
+
+# buffering=0 syncs every write through to the flash
+with open(FILE, 'wb', 0) as f:
+    f.write(data)
+    f.write(data)
+print(os.stat(FILE)[6] == 2 * CHUNK)
+
+os.remove(FILE)
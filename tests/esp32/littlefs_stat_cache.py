@@ -0,0 +1,71 @@
+import os
+import sys
+import time
+import pycom
+
+# the lookup cache only exists on LittleFS
+if pycom.bootmgr()[1] != 'LittleFS':
+    print("SKIP")
+    sys.exit()
+
+DIR = '/flash/lfs_cache'
+MOD = 'lfs_cache_mod'
+IMPORTS = 50
+# an import probing /flash/lib for a missing module must not hit the flash every time
+IMPORT_MS_MAX = 20
+
+def exists(path):
+    try:
+        os.stat(path)
+        return True
+    except OSError:
+        return False
+
+try:
+    os.mkdir(DIR)
+except OSError:
+    pass
+sys.path.append(DIR)
+
+# negative results must go away as soon as the module is written
+try:
+    __import__(MOD)
+except ImportError:
+    print('missing')
+
+with open(DIR + '/' + MOD + '.py', 'w') as f:
+    f.write('VALUE = 1\n')
+print(__import__(MOD).VALUE)
+
+# positive results must go away as soon as the module is removed
+del sys.modules[MOD]
+os.remove(DIR + '/' + MOD + '.py')
+try:
+    __import__(MOD)
+except ImportError:
+    print('missing')
+
+# chdir into a directory created and removed behind the cache
+os.mkdir(DIR + '/sub')
+os.chdir(DIR)
+os.chdir('sub')
+print(os.getcwd())
+os.chdir('/flash')
+os.rmdir(DIR + '/sub')
+try:
+    os.chdir(DIR + '/sub')
+except OSError:
+    print('no sub')
+
+start = time.ticks_ms()
+for i in range(IMPORTS):
+    try:
+        __import__(MOD)
+    except ImportError:
+        pass
+elapsed = time.ticks_diff(time.ticks_ms(), start)
+print('missing import:', 'OK' if elapsed // IMPORTS <= IMPORT_MS_MAX else 'SLOW')
+
+sys.path.remove(DIR)
+os.rmdir(DIR)
+print(exists(DIR))
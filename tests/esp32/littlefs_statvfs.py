@@ -0,0 +1,30 @@
+import os
+import time
+import pycom
+
+# the free space cache only exists on LittleFS
+if pycom.bootmgr()[1] != 'LittleFS':
+    print("SKIP")
+    import sys
+    sys.exit()
+
+FILE = '/flash/lfs_statvfs.bin'
+CALLS = 20
+# without writes in between statvfs must not traverse the file system again
+CALL_MS_MAX = 5
+
+os.statvfs('/flash')
+start = time.ticks_ms()
+for i in range(CALLS):
+    before = os.statvfs('/flash')
+elapsed = time.ticks_diff(time.ticks_ms(), start)
+print('statvfs:', 'OK' if elapsed // CALLS <= CALL_MS_MAX else 'SLOW')
+
+# writing invalidates the cached count
+with open(FILE, 'wb') as f:
+    f.write(bytearray(8 * before[0]))
+after = os.statvfs('/flash')
+print(before[3] - after[3] >= 8)
+
+os.remove(FILE)
+print(os.statvfs('/flash')[3] == before[3])
@@ -0,0 +1,59 @@
+import os
+import socket
+
+# only execute this test on the boards with a LoRa radio
+if os.uname().sysname not in ('LoPy', 'LoPy4', 'FiPy'):
+    print("SKIP")
+    import sys
+    sys.exit()
+else:
+    from network import LoRa
+
+import uio
+import lorabulk
+
+lora = LoRa(mode=LoRa.FSK, region=LoRa.EU868, bitrate=250000, fdev=100000,
+            sync_word=b'\x2d\xd4', crc=True, whitening=True)
+s = socket.socket(socket.AF_LORA, socket.SOCK_RAW)
+s.setblocking(True)
+
+# one full FIFO goes out, one byte more doesn't fit
+print(s.send(bytes(63)))
+try:
+    s.send(bytes(64))
+except OSError as e:
+    print('EMSGSIZE')
+
+for args in ({'bitrate': 600}, {'bitrate': 300000, 'fdev': 150000}, {'sync_word': b''}):
+    try:
+        lora.init(mode=LoRa.FSK, region=LoRa.EU868, **args)
+    except ValueError:
+        print('ValueError')
+
+# the transfer protocol against a receiver in memory, dropping every 5th frame each way
+class Link:
+    def __init__(self, rx):
+        self.rx = rx
+        self.n = 0
+        self.replies = []
+    def settimeout(self, t):
+        pass
+    def send(self, frame):
+        self.n += 1
+        if self.n % 5:
+            reply = self.rx.feed(frame)
+            self.n += 1
+            if reply and self.n % 5:
+                self.replies.append(reply)
+    def recv(self, n):
+        if not self.replies:
+            raise OSError(11)
+        return self.replies.pop(0)
+
+data = bytes(range(256)) * 20
+out = uio.BytesIO()
+rx = lorabulk.Receiver(out)
+print(lorabulk.send(Link(rx), data, timeout=0.01, retries=50))
+print(out.getvalue() == data, rx.ok)
+
+lora.init(mode=LoRa.LORA, region=LoRa.EU868)
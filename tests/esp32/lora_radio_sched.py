@@ -0,0 +1,42 @@
+'''
+LoRa radio arbitration: raw frames are accounted to their owner and
+re-applying the same configuration doesn't rewrite the radio
+'''
+
+import os
+import socket
+
+# only execute this test on the boards with a LoRa radio
+if os.uname().sysname not in ('LoPy', 'LoPy4', 'FiPy'):
+    print("SKIP")
+    import sys
+    sys.exit()
+else:
+    from network import LoRa
+
+lora = LoRa(mode=LoRa.LORA, region=LoRa.EU868)
+if not hasattr(lora, 'radio_stats'):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+lora.radio_stats(True)
+s = socket.socket(socket.AF_LORA, socket.SOCK_RAW)
+s.setblocking(True)
+for i in range(3):
+    s.send(bytes(8))
+
+st = lora.radio_stats()
+print(st.lora.grants, st.lora.missed, st.lora.airtime > 0)
+print(st.lorawan.grants, st.mesh.grants)
+
+# the same settings a second time only go out where they differ
+before = lora.radio_stats()
+lora.init(mode=LoRa.LORA, region=LoRa.EU868, sf=7)
+lora.sf(7)
+after = lora.radio_stats()
+print(after.reg_writes >= before.reg_writes, after.reg_skipped >= before.reg_skipped)
+if os.uname().sysname == 'LoPy4':
+    print(after.reg_skipped > before.reg_skipped)
+else:
+    print(True)
@@ -0,0 +1,39 @@
+'''
+LoRaWAN data rate statistics and the fast ADR policy settings, no network needed
+'''
+
+import os
+
+# only execute this test on the boards with a LoRa radio
+if os.uname().sysname not in ('LoPy', 'LoPy4', 'FiPy'):
+    print("SKIP")
+    import sys
+    sys.exit()
+else:
+    from network import LoRa
+
+lora = LoRa(mode=LoRa.LORAWAN, region=LoRa.EU868, adr=False)
+if not hasattr(lora, 'adr_stats'):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+st = lora.adr_stats(True)
+print(st.adr, st.per_dr, st.fast_dr, st.last_margin)
+print(lora.adr_policy())
+
+lora.adr_policy(fast=True, margin=6, dr_max=4)
+print(lora.adr_policy())
+for kw in ({'margin': -1}, {'frames': 0}, {'dr_max': 16}):
+    try:
+        lora.adr_policy(**kw)
+    except ValueError:
+        print('ValueError')
+print(lora.adr_policy().margin)
+
+lora.adr_policy(fast=False)
+lora.init(mode=LoRa.LORA, region=LoRa.EU868)
+try:
+    lora.adr_stats()
+except OSError:
+    print('OSError')
@@ -0,0 +1,51 @@
+import binascii
+import socket
+import struct
+import time
+import os
+
+# only execute this test on the LoPy
+if os.uname().sysname != 'LoPy' and os.uname().sysname != 'FiPy':
+    print("SKIP")
+    import sys
+    sys.exit()
+else:
+    from network import LoRa
+
+# CPU time budgets in microseconds
+SO_DR_BUDGET_US = 100
+SEND_BUDGET_US = 20000
+ITERATIONS = 1000
+
+print('Starting LoRaWAN send path benchmark')
+
+lora = LoRa(mode=LoRa.LORAWAN, region=LoRa.EU868, adr=False)
+
+dev_addr = struct.unpack(">l", binascii.unhexlify('26 01 14 7D'.replace(' ','')))[0]
+nwk_swkey = binascii.unhexlify('3C 74 F4 F4 0C AE A0 21 30 3B C2 42 84 FC F3 AF'.replace(' ',''))
+app_swkey = binascii.unhexlify('0F FA 70 72 CC 6F F6 9A 10 2A 0F 39 BE B0 88 0F'.replace(' ',''))
+lora.join(activation=LoRa.ABP, auth=(dev_addr, nwk_swkey, app_swkey))
+print(lora.has_joined())
+
+s = socket.socket(socket.AF_LORA, socket.SOCK_RAW)
+s.setblocking(False)
+s.bind(1)
+
+# data rate validation, done on every SO_DR change
+start = time.ticks_us()
+for i in range(ITERATIONS):
+    s.setsockopt(socket.SOL_LORA, socket.SO_DR, i % 6)
+per_call = time.ticks_diff(time.ticks_us(), start) // ITERATIONS
+print('SO_DR:', 'OK' if per_call < SO_DR_BUDGET_US else 'SLOW (%d us)' % per_call)
+
+# hand over one frame per data rate to the MAC, the TX itself happens in the background
+for dr in range(6):
+    s.setsockopt(socket.SOL_LORA, socket.SO_DR, dr)
+    start = time.ticks_us()
+    s.send(bytes([dr] * 10))
+    elapsed = time.ticks_diff(time.ticks_us(), start)
+    print('DR%d send:' % dr, 'OK' if elapsed < SEND_BUDGET_US else 'SLOW (%d us)' % elapsed)
+    # wait for the TX and both RX windows
+    time.sleep(4)
+
+s.close()
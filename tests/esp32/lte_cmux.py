@@ -0,0 +1,35 @@
+import socket
+import time
+import os
+
+# only execute this test on the GPy and the FiPy
+if os.uname().sysname != 'GPy' and os.uname().sysname != 'FiPy':
+    print("SKIP")
+    import sys
+    sys.exit()
+else:
+    from network import LTE
+
+HOST = 'httpbin.org'
+
+# AT commands go on their own channel, the PPP session isn't paused for them
+lte = LTE(cmux=True)
+lte.attach()
+while not lte.isattached():
+    time.sleep(0.5)
+lte.connect()
+while not lte.isconnected():
+    time.sleep(0.5)
+
+addr = socket.getaddrinfo(HOST, 80)[0][-1]
+s = socket.socket()
+s.connect(addr)
+print('+CSQ:' in lte.send_at_cmd('AT+CSQ'))
+print(lte.isconnected())
+s.send(b'GET /get HTTP/1.0\r\nHost: %s\r\n\r\n' % bytes(HOST, 'latin'))
+print(s.recv(12))
+s.close()
+
+lte.disconnect()
+lte.detach()
+lte.deinit()
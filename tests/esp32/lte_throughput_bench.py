@@ -0,0 +1,51 @@
+import socket
+import time
+import os
+
+# only execute this test on the GPy and the FiPy
+if os.uname().sysname != 'GPy' and os.uname().sysname != 'FiPy':
+    print("SKIP")
+    import sys
+    sys.exit()
+else:
+    from network import LTE
+
+HOST = 'httpbin.org'
+DOWNLOAD = 100 * 1024
+CHUNK = 1460
+# sustained payload rate in bytes/s, the modem UART at its base rate is the bottleneck below this
+RATE_MIN = 24 * 1024
+
+print('Starting LTE throughput benchmark')
+
+lte = LTE()
+lte.attach()
+while not lte.isattached():
+    time.sleep(0.5)
+lte.connect()
+while not lte.isconnected():
+    time.sleep(0.5)
+print(lte.isconnected())
+
+addr = socket.getaddrinfo(HOST, 80)[0][-1]
+s = socket.socket()
+s.connect(addr)
+s.send(b'GET /stream-bytes/%d?chunk_size=%d HTTP/1.0\r\nHost: %s\r\n\r\n' % (DOWNLOAD, CHUNK, bytes(HOST, 'latin')))
+print(s.recv(12))
+
+buf = bytearray(CHUNK)
+total = 0
+start = time.ticks_ms()
+while True:
+    n = s.readinto(buf)
+    if not n:
+        break
+    total += n
+elapsed = time.ticks_diff(time.ticks_ms(), start)
+s.close()
+
+print(total >= DOWNLOAD)
+print('throughput:', 'OK' if total * 1000 // max(elapsed, 1) >= RATE_MIN else 'SLOW')
+
+lte.disconnect()
+lte.detach()
@@ -53,3 +53,18 @@ rtc.memory(b'')
 print(rtc.memory())
 rtc.memory(b'10101010')
 print(rtc.memory())
+
+# Test machine.irq_stats(), the alarm callbacks run at the high priority level
+import time
+from machine import Timer
+
+fired = []
+before = machine.irq_stats()
+alarm = Timer.Alarm(lambda a: fired.append(1), ms=10, periodic=True)
+time.sleep_ms(105)
+alarm.cancel()
+time.sleep_ms(20)
+after = machine.irq_stats()
+print(len(after))
+print(after[0][0] - before[0][0] >= len(fired) > 0)
+print(after[0][1] == before[0][1])
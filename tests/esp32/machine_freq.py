@@ -0,0 +1,27 @@
+import machine
+import time
+
+f = machine.freq()
+print(f in (80000000, 160000000, 240000000))
+
+for hz in (80000000, 160000000, 240000000):
+    machine.freq(hz)
+    print(machine.freq() == hz)
+    # the tick and the delays follow the new clock
+    t = time.ticks_ms()
+    time.sleep_ms(100)
+    print(100 <= time.ticks_diff(time.ticks_ms(), t) < 120)
+
+try:
+    machine.freq(100000000)
+except ValueError:
+    print('ValueError')
+
+# waits drop to the low frequency, the rest stays at hz
+machine.freq(160000000, auto=(80000000, 240000000))
+time.sleep_ms(20)
+print(machine.freq() == 160000000)
+machine.freq(auto=False)
+
+machine.freq(f)
+print(machine.freq() == f)
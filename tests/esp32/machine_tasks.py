@@ -0,0 +1,20 @@
+import machine
+import time
+
+machine.tasks()
+# keep this task busy, it's the one running every sample of its core
+start = time.ticks_ms()
+while time.ticks_diff(time.ticks_ms(), start) < 200:
+    pass
+tasks = machine.tasks()
+
+names = [t.name for t in tasks]
+print('MicroPy' in names)
+print(len([n for n in names if n.startswith('IDLE')]) >= 1)
+
+mp = tasks[names.index('MicroPy')]
+print(mp.state)
+print(mp.core in (0, 1))
+print(mp.cpu > 50)
+print(0 < mp.stack_free < mp.stack_size)
+print(all(0 <= t.cpu <= 100 for t in tasks))
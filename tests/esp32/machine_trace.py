@@ -0,0 +1,30 @@
+import machine
+import gc
+import os
+import ujson
+
+machine.trace(machine.TRACE_GC, size=64)
+gc.collect()
+gc.collect()
+machine.trace(0)
+
+with open('/flash/trace.json', 'w') as f:
+    machine.trace_dump(f)
+with open('/flash/trace.json') as f:
+    trace = ujson.load(f)
+os.remove('/flash/trace.json')
+
+events = [e for e in trace['traceEvents'] if e['name'] == 'gc_collect']
+print(len(events))
+print([e['ph'] for e in events])
+print(events[0]['ts'] <= events[1]['ts'] <= events[2]['ts'])
+print(trace['otherData']['lost'])
+print(any(e['ph'] == 'M' and e['args']['name'] == 'MicroPy' for e in trace['traceEvents']))
+
+# the dump cleared the ring
+with open('/flash/trace.json', 'w') as f:
+    machine.trace_dump(f)
+with open('/flash/trace.json') as f:
+    trace = ujson.load(f)
+os.remove('/flash/trace.json')
+print(len([e for e in trace['traceEvents'] if e['ph'] != 'M']))
@@ -0,0 +1,59 @@
+'''
+The metrics registry, its binary snapshot and the periodic exporter
+'''
+
+import machine
+import time
+import ustruct
+
+if not hasattr(machine, 'metrics'):
+    print('SKIP')
+    raise SystemExit
+
+def varints(buf):
+    out = []
+    v = shift = 0
+    for b in buf:
+        v |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            out.append(v)
+            v = shift = 0
+    return out
+
+metrics = machine.metrics()
+names = [m.name for m in metrics]
+print('gc.used' in names, 'irq.high_dispatched' in names, 'metrics.exports' in names)
+used = metrics[names.index('gc.used')]
+print(used.kind, used.value > 0)
+print(all(len(m.value) == 8 for m in metrics if m.kind == 'histogram'))
+
+snap = machine.metrics(True)
+version, flags, seq, schema, uptime = ustruct.unpack('<BBHII', snap)
+n_values = sum(len(m.value) if m.kind == 'histogram' else 1 for m in metrics)
+print(version, flags, seq, schema == machine.metrics_export().schema)
+print(len(varints(snap[12:])) == n_values)
+
+sent = []
+machine.metrics_export(sent.append, period=1000)
+print(machine.metrics_export().running)
+time.sleep_ms(2500)
+machine.metrics_export(None)
+print(len(sent) >= 2, machine.metrics_export().running)
+print(sent[0][1] & 1, ustruct.unpack('<H', sent[1][2:4])[0] == ustruct.unpack('<H', sent[0][2:4])[0] + 1)
+print(machine.metrics_export().exports >= 2)
+
+# publish(topic, msg) is used when the target has it
+class Client:
+    def publish(self, topic, msg):
+        print('publish', topic, msg[0])
+machine.metrics_export(Client(), topic='dev/metrics', period=1000, delta=False)
+time.sleep_ms(1500)
+machine.metrics_export(None)
+
+for bad in (lambda: machine.metrics_export(print, period=10),
+            lambda: machine.metrics_export(42)):
+    try:
+        bad()
+    except ValueError:
+        print('ValueError')
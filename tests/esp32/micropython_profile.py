@@ -0,0 +1,32 @@
+# test the sampling profiler: the busy function gets most of the samples
+
+import micropython
+import time
+
+def busy(ms):
+    start = time.ticks_ms()
+    n = 0
+    while time.ticks_diff(time.ticks_ms(), start) < ms:
+        n += 1
+    return n
+
+micropython.profile(500)
+busy(500)
+micropython.profile(0)
+
+sites, in_python, total = micropython.profile_data()
+names = [s[0] for s in sites]
+print(names[0])
+print(sites[0][2] > in_python // 2)
+print(0 < in_python <= total)
+print(sum(s[2] for s in sites) <= in_python)
+
+try:
+    micropython.profile(5000)
+except ValueError:
+    print('ValueError')
+
+# starting again clears the counts
+micropython.profile(100)
+micropython.profile(0)
+print(micropython.profile_data()[0])
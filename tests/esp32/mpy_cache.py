@@ -0,0 +1,39 @@
+# test the compile cache of imported modules: an entry is written on the first
+# import and rebuilt when the source changes
+import os
+import sys
+import time
+
+MOD = 'cache_test_mod'
+SRC = '/flash/%s.py' % MOD
+CACHE = '/flash/__pycache__/%s.mpy' % MOD
+
+def write_source(value):
+    with open(SRC, 'w') as f:
+        f.write('def f():\n    return %r\n' % value)
+
+def cleanup():
+    for p in (SRC, CACHE):
+        try:
+            os.remove(p)
+        except OSError:
+            pass
+
+def reimport():
+    sys.modules.pop(MOD, None)
+    return __import__(MOD)
+
+cleanup()
+write_source('first')
+print(reimport().f())
+print(os.stat(CACHE)[6] > 0)
+
+# loaded from the cache this time
+print(reimport().f())
+
+# same size, later timestamp
+time.sleep(2)
+write_source('again')
+print(reimport().f())
+
+cleanup()
@@ -0,0 +1,94 @@
+import time
+import socket
+import _thread
+from network import WLAN
+from network import MQTT
+
+client = MQTT('test', keepalive=2, window=2)
+try:
+    client.publish('t', b'x')
+except OSError as e:
+    print('OSError', e.args[0] == 107)
+try:
+    MQTT('test', window=0)
+except ValueError:
+    print('ValueError')
+
+# needs the board to be connected to an AP already, it's the broker too
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+ip = wlan.ifconfig()[0]
+received = []
+broker_log = []
+
+def recv_exact(s, n):
+    data = b''
+    while len(data) < n:
+        data += s.recv(n - len(data))
+    return data
+
+def recv_packet(s):
+    cmd = recv_exact(s, 1)[0]
+    length, shift = 0, 0
+    while True:
+        b = recv_exact(s, 1)[0]
+        length |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            break
+    return cmd, recv_exact(s, length)
+
+def broker(server):
+    conn, _ = server.accept()
+    while True:
+        cmd, body = recv_packet(conn)
+        kind = cmd & 0xF0
+        broker_log.append(kind)
+        if kind == 0x10:
+            conn.send(b'\x20\x02\x00\x00')
+        elif kind == 0x30 and cmd & 0x02:
+            tlen = (body[0] << 8) | body[1]
+            conn.send(b'\x40\x02' + body[2 + tlen:4 + tlen])
+        elif kind == 0x80:
+            conn.send(b'\x90\x03' + body[:2] + b'\x01')
+            # a message for the subscription
+            conn.send(b'\x30\x07\x00\x01s' + b'down')
+        elif kind == 0xC0:
+            conn.send(b'\xd0\x00')
+        elif kind == 0xE0:
+            break
+    conn.close()
+
+server = socket.socket()
+server.bind((ip, 1883))
+server.listen(1)
+_thread.start_new_thread(broker, (server,))
+
+client.set_callback(lambda topic, msg: received.append((topic, msg)))
+sock = socket.socket()
+sock.connect((ip, 1883))
+client.connect(sock)
+print(client.isconnected())
+
+client.publish('t', b'qos0')
+payload = bytearray(b'qos1')
+print(type(client.publish('t', payload, 1)))
+print(client.subscribe('s', 1))
+
+start = time.ticks_ms()
+while (not received or client.pending()) and time.ticks_diff(time.ticks_ms(), start) < 2000:
+    time.sleep_ms(10)
+print(received, client.pending())
+
+# the keepalive task pings without the script doing anything
+time.sleep(3)
+print(0xC0 in broker_log, client.isconnected())
+
+client.disconnect()
+print(client.isconnected())
+sock.close()
+server.close()
@@ -0,0 +1,29 @@
+'''
+Default route failover settings, FiPy/GPy only: no link is brought up so nothing becomes active
+'''
+import network
+from network import WLAN, LTE
+
+if not hasattr(network, 'failover'):
+    print('SKIP')
+    raise SystemExit
+
+st = network.failover()
+print(st.enabled, st.active, st.priority == (WLAN, LTE), st.probe, st.period, st.fails)
+
+network.failover(enable=True, priority=(LTE, WLAN), probe=('8.8.8.8', 53), period=1000, fails=2)
+st = network.failover()
+print(st.enabled, st.priority == (LTE, WLAN), st.probe, st.period, st.fails)
+print(st.lte.link, st.lte.healthy)
+
+network.failover(probe=None)
+print(network.failover().probe)
+
+for bad in ({'priority': (WLAN, WLAN)}, {'priority': (WLAN,)}, {'period': 10}, {'fails': 0}):
+    try:
+        network.failover(**bad)
+    except ValueError:
+        print('ValueError')
+
+network.failover(enable=False, priority=(WLAN, LTE))
+print(network.failover().enabled)
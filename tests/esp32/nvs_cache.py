@@ -0,0 +1,33 @@
+import pycom
+import time
+
+pycom.nvs_set('nc_str', 'hello')
+pycom.nvs_set('nc_int', 42)
+print(pycom.nvs_get('nc_str'), pycom.nvs_get('nc_int'))
+
+# bulk set and get, one commit
+pycom.nvs_set({'nc_a': 1, 'nc_b': 'two'})
+print(pycom.nvs_get(['nc_a', 'nc_b', 'nc_none'], None))
+
+# counter increments stay in RAM until committed
+t = time.ticks_us()
+for i in range(200):
+    pycom.nvs_set('nc_cnt', i, commit=False)
+ram = time.ticks_diff(time.ticks_us(), t)
+print(pycom.nvs_get('nc_cnt'))
+pycom.nvs_commit()
+print(ram < 200 * 500)
+
+# a value never committed is just forgotten
+pycom.nvs_set('nc_tmp', 7, commit=False)
+pycom.nvs_erase('nc_tmp')
+print(pycom.nvs_get('nc_tmp', 'gone'))
+
+try:
+    pycom.nvs_set('nc_key_far_too_long', 1)
+except ValueError:
+    print('ValueError')
+
+for k in ('nc_str', 'nc_int', 'nc_a', 'nc_b', 'nc_cnt'):
+    pycom.nvs_erase(k)
+print(pycom.nvs_get('nc_cnt', None))
@@ -0,0 +1,30 @@
+'''
+P22 must be connected to the onewire sensor via 4K7 pull-up resistor
+'''
+
+import _onewire as ow
+from machine import Pin, RMT
+
+# the example ROM of the Maxim application note
+print(hex(ow.crc8(b'\x02\x1c\xb8\x01\x00\x00\x00')))
+print(ow.crc8(b'\x02\x1c\xb8\x01\x00\x00\x00\xa2'))
+
+pin = Pin('P22', mode=Pin.OPEN_DRAIN, pull=Pin.PULL_UP)
+print(ow.reset(pin))
+
+# READ ROM, only one device on the bus
+ow.writebyte(pin, 0x33)
+rom = bytearray(8)
+ow.readinto(pin, rom)
+print(ow.crc8(rom) == 0, rom[0] in (0x10, 0x28))
+
+# the same again byte by byte
+print(ow.reset(pin))
+ow.write(pin, b'\x33')
+print(bytes(ow.readbyte(pin) for _ in range(8)) == rom)
+
+# the bus holds the two highest free RMT channels
+try:
+    RMT(channel=7, gpio='P21', tx_idle_level=0)
+except ValueError:
+    print("ValueError")
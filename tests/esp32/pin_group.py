@@ -0,0 +1,42 @@
+'''
+PinGroup writes and reads back a group of output pins, no wiring needed
+'''
+
+import machine
+from machine import Pin
+from array import array
+
+if not hasattr(machine, 'PinGroup'):
+    print("SKIP")
+    import sys
+    sys.exit()
+
+pins = [Pin(n, mode=Pin.OUT) for n in ('P19', 'P20', 'P21', 'P22')]
+g = machine.PinGroup(pins, Pin.OUT, value=0b0101)
+print(g)
+print(bin(g.value()), [p.value() for p in pins])
+
+g.value(0b1010)
+print(bin(g.value()), [p.value() for p in pins])
+g.set(0b0001)
+print(bin(g.value()))
+g.clear(0b1000)
+print(bin(g.value()))
+
+# the last word stays on the bus, the strobe ends up released
+strobe = Pin('P23', mode=Pin.OUT, value=1)
+g.write_seq(b'\x0f\x00\x03', strobe='P23', delay_us=1)
+print(bin(g.value()), strobe.value())
+g.write_seq(array('H', [0x0106]))
+print(bin(g.value()))
+g.write_seq(b'')
+print(bin(g.value()))
+
+for bad in (lambda: machine.PinGroup([]),
+            lambda: machine.PinGroup(('P19', 'P19')),
+            lambda: g.write_seq(b'\x01', strobe='P19'),
+            lambda: g.write_seq(array('f', [1.0]))):
+    try:
+        bad()
+    except ValueError:
+        print('ValueError')
@@ -30,3 +30,36 @@ try:
     pwm_c = pwm.channel(8, pin='P12', duty_cycle=0.0)
 except Exception:
     print("Exception")
+
+# hardware fade, the handler comes from the completion check
+import time
+done = []
+pwm = PWM(0, frequency=5000)
+pwm_c = pwm.channel(0, pin='P12', duty_cycle=0.0)
+pwm_c.fade(0.8, 100, handler=lambda c: done.append(c))
+print(pwm_c.fading())
+try:
+    pwm_c.duty_cycle(0.5)
+except OSError:
+    print("busy")
+time.sleep_ms(300)
+print(pwm_c.fading(), len(done), done[0] is pwm_c)
+
+try:
+    pwm_c.fade(0.5, 0)
+except ValueError:
+    print("ValueError")
+
+# grouped update of channels sharing a timer
+pwm_d = pwm.channel(1, pin='P11', duty_cycle=0.5)
+pwm.duty_cycle((pwm_c, pwm_d), (0.25, 1.0))
+pwm.duty_cycle([pwm_c, pwm_d], [0.75, 0.0])
+try:
+    pwm.duty_cycle((pwm_c, pwm_d), (0.5,))
+except ValueError:
+    print("ValueError")
+other = PWM(1, frequency=5000).channel(2, pin='P10', duty_cycle=0.5)
+try:
+    pwm.duty_cycle((pwm_c, other), (0.5, 0.5))
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,25 @@
+import pycom
+
+hb = pycom.heartbeat_on_boot()
+wdt = pycom.wdt_on_boot()
+
+# dropped changes leave the config as it was
+pycom.config_begin()
+pycom.heartbeat_on_boot(not hb)
+pycom.wdt_on_boot(not wdt)
+print(pycom.heartbeat_on_boot() != hb)
+pycom.config_abort()
+print(pycom.heartbeat_on_boot() == hb, pycom.wdt_on_boot() == wdt)
+
+# both written with a single erase
+pycom.config_begin()
+pycom.heartbeat_on_boot(not hb)
+pycom.wdt_on_boot(not wdt)
+pycom.config_commit()
+print(pycom.heartbeat_on_boot() != hb, pycom.wdt_on_boot() != wdt)
+
+pycom.config_begin()
+pycom.heartbeat_on_boot(hb)
+pycom.wdt_on_boot(wdt)
+pycom.config_commit()
+print(pycom.heartbeat_on_boot() == hb, pycom.wdt_on_boot() == wdt)
@@ -0,0 +1,74 @@
+import os
+import time
+from reclog import Log
+
+DIR = '/flash/reclog_test'
+RECORDS = 500
+RECORDS_PER_S_MIN = 500
+
+def cleanup():
+    try:
+        for name in os.listdir(DIR):
+            os.remove(DIR + '/' + name)
+        os.rmdir(DIR)
+    except OSError:
+        pass
+
+cleanup()
+
+print('Starting record log test')
+
+log = Log(DIR, segment_size=1024, segments=3, buffer_size=256)
+for i in range(10):
+    log.append(('record %d' % i).encode())
+recs = log.read()
+print(len(recs), recs[0], recs[-1])
+print(log.read(8))
+print(log.read(2, 3))
+
+# old segments are dropped once more than `segments` exist
+for i in range(10, 200):
+    log.append(('record %d' % i).encode())
+print(len(os.listdir(DIR)))
+recs = log.read()
+print(recs[-1], len(recs) < 200)
+log.close()
+
+# reopening resumes after the last record
+with Log(DIR, segment_size=1024, segments=3) as log:
+    n = len(log.read())
+    log.append(b'after reopen')
+    recs = log.read()
+    print(len(recs) == n + 1, recs[-1])
+
+# a torn record ends its segment
+names = sorted(os.listdir(DIR))
+with open(DIR + '/' + names[-1], 'ab') as f:
+    f.write(b'\xa5\x5a\x10\x00garbage')
+log = Log(DIR, segment_size=1024, segments=3)
+log.append(b'after tear')
+recs = log.read()
+print(recs[-2], recs[-1])
+
+log.clear()
+print(log.read())
+try:
+    log.append(bytes(1024))
+except ValueError:
+    print('ValueError')
+
+# batched appends cost one flash write per buffer
+start = time.ticks_ms()
+for i in range(RECORDS):
+    log.append(b'temperature=21.5 humidity=48')
+log.flush()
+elapsed = max(time.ticks_diff(time.ticks_ms(), start), 1)
+print('append:', 'OK' if RECORDS * 1000 // elapsed >= RECORDS_PER_S_MIN else 'SLOW')
+log.close()
+
+try:
+    log.append(b'closed')
+except OSError:
+    print('OSError')
+
+cleanup()
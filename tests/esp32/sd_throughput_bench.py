@@ -0,0 +1,54 @@
+import os
+import time
+from machine import SD
+
+# needs an SD card in the slot
+try:
+    sd = SD()
+except OSError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+FILE = '/sd/sd_bench.bin'
+CHUNK = 4096
+CHUNKS = 64
+# bytearrays live on the MicroPython heap, the driver used to bounce them one sector per command
+WRITE_MIN = 256 * 1024
+READ_MIN = 512 * 1024
+
+os.mount(sd, '/sd')
+print('Starting SD throughput benchmark')
+
+def rate(nbytes, start):
+    return nbytes * 1000 // max(time.ticks_diff(time.ticks_ms(), start), 1)
+
+data = bytearray(CHUNK)
+for i in range(CHUNK):
+    data[i] = i & 0xFF
+
+start = time.ticks_ms()
+with open(FILE, 'wb') as f:
+    for i in range(CHUNKS):
+        f.write(data)
+print('write:', 'OK' if rate(CHUNK * CHUNKS, start) >= WRITE_MIN else 'SLOW')
+
+buf = bytearray(CHUNK)
+good = True
+start = time.ticks_ms()
+with open(FILE, 'rb') as f:
+    for i in range(CHUNKS):
+        f.readinto(buf)
+        good = good and (buf == data)
+print('read:', 'OK' if rate(CHUNK * CHUNKS, start) >= READ_MIN else 'SLOW')
+print(good)
+
+os.remove(FILE)
+os.umount('/sd')
+
+# an invalid bus width is refused
+try:
+    sd.init(width=2)
+except ValueError:
+    print('ValueError')
+sd.deinit()
@@ -0,0 +1,64 @@
+'''
+Soak test of BLE: a 1 s scan every round, plus a connection, the discovery of its
+services and a disconnection when SOAK_BLE_PEER is set to the MAC of an advertising device.
+The free heaps and their largest blocks after the warm-up rounds are the reference, every
+check compares them to it. Raise SOAK_ROUNDS for a long run, with pyboard.py then.
+'''
+
+import gc
+import pycom
+import time
+from network import Bluetooth
+
+try:
+    SOAK_ROUNDS
+except NameError:
+    SOAK_ROUNDS = 30
+WARMUP = 3
+CHECK_EVERY = 3
+try:
+    SOAK_BLE_PEER
+except NameError:
+    SOAK_BLE_PEER = None
+
+bt = Bluetooth()
+
+NAMES = ('gc free', 'gc largest', 'heap free', 'heap largest')
+# the most each one may drop below its reference, in bytes
+DROP_MAX = (4096, 8192, 4096, 8192)
+
+def heap():
+    gc.collect()
+    return (gc.mem_free(), gc.profile_data()[2], pycom.get_free_heap()[0], pycom.get_largest_free_block()[0])
+
+def check(n, ref):
+    now = heap()
+    bad = ['%s %d -> %d' % (NAMES[i], ref[i], now[i]) for i in range(len(NAMES)) if ref[i] - now[i] > DROP_MAX[i]]
+    print('check %d %s' % (n, ', '.join(bad) if bad else 'ok'))
+    return not bad
+
+def one_round():
+    bt.start_scan(1)
+    while bt.isscanning():
+        while bt.get_adv():
+            pass
+        time.sleep_ms(50)
+    while bt.get_adv():
+        pass
+    if SOAK_BLE_PEER is not None:
+        conn = bt.connect(SOAK_BLE_PEER)
+        try:
+            conn.services()
+        finally:
+            conn.disconnect()
+
+passed = True
+ref = None
+for r in range(1, SOAK_ROUNDS + 1):
+    one_round()
+    if r == WARMUP:
+        ref = heap()
+        print('warmed up')
+    elif r > WARMUP and (r - WARMUP) % CHECK_EVERY == 0:
+        passed = check((r - WARMUP) // CHECK_EVERY, ref) and passed
+print('PASS' if passed else 'FAIL')
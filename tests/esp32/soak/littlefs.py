@@ -0,0 +1,61 @@
+'''
+Soak test of LittleFS: write, append, read back and remove a few files in /flash every
+round.
+The free heaps and their largest blocks after the warm-up rounds are the reference, every
+check compares them to it. Raise SOAK_ROUNDS for a long run, with pyboard.py then.
+'''
+
+import gc
+import os
+import pycom
+import sys
+
+if pycom.bootmgr()[1] != 'LittleFS':
+    print("SKIP")
+    sys.exit()
+
+try:
+    SOAK_ROUNDS
+except NameError:
+    SOAK_ROUNDS = 105
+WARMUP = 5
+CHECK_EVERY = 10
+FILES = ['/flash/soak_%d.bin' % i for i in range(2)]
+DATA = bytes(range(256)) * 16
+
+NAMES = ('gc free', 'gc largest', 'heap free', 'heap largest')
+# the most each one may drop below its reference, in bytes
+DROP_MAX = (2048, 4096, 2048, 4096)
+
+def heap():
+    gc.collect()
+    return (gc.mem_free(), gc.profile_data()[2], pycom.get_free_heap()[0], pycom.get_largest_free_block()[0])
+
+def check(n, ref):
+    now = heap()
+    bad = ['%s %d -> %d' % (NAMES[i], ref[i], now[i]) for i in range(len(NAMES)) if ref[i] - now[i] > DROP_MAX[i]]
+    print('check %d %s' % (n, ', '.join(bad) if bad else 'ok'))
+    return not bad
+
+def one_round():
+    for name in FILES:
+        with open(name, 'wb') as f:
+            f.write(DATA)
+        with open(name, 'ab') as f:
+            f.write(DATA[:100])
+    for name in FILES:
+        with open(name, 'rb') as f:
+            if f.read() != DATA + DATA[:100]:
+                raise OSError('%s read back wrong' % name)
+        os.remove(name)
+
+passed = True
+ref = None
+for r in range(1, SOAK_ROUNDS + 1):
+    one_round()
+    if r == WARMUP:
+        ref = heap()
+        print('warmed up')
+    elif r > WARMUP and (r - WARMUP) % CHECK_EVERY == 0:
+        passed = check((r - WARMUP) // CHECK_EVERY, ref) and passed
+print('PASS' if passed else 'FAIL')
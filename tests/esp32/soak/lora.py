@@ -0,0 +1,60 @@
+'''
+Soak test of raw LoRa: a send and a non-blocking receive every round, no gateway or
+second board needed, an antenna must be attached.
+The free heaps and their largest blocks after the warm-up rounds are the reference, every
+check compares them to it. Raise SOAK_ROUNDS for a long run, with pyboard.py then.
+'''
+
+import gc
+import os
+import pycom
+import socket
+import sys
+
+if os.uname().sysname not in ('LoPy', 'LoPy4', 'FiPy'):
+    print("SKIP")
+    sys.exit()
+
+from network import LoRa
+
+try:
+    SOAK_ROUNDS
+except NameError:
+    SOAK_ROUNDS = 220
+WARMUP = 20
+CHECK_EVERY = 20
+PAYLOAD = bytes(range(32))
+
+lora = LoRa(mode=LoRa.LORA, region=LoRa.EU868, frequency=868100000)
+s = socket.socket(socket.AF_LORA, socket.SOCK_RAW)
+
+NAMES = ('gc free', 'gc largest', 'heap free', 'heap largest')
+# the most each one may drop below its reference, in bytes
+DROP_MAX = (2048, 4096, 2048, 4096)
+
+def heap():
+    gc.collect()
+    return (gc.mem_free(), gc.profile_data()[2], pycom.get_free_heap()[0], pycom.get_largest_free_block()[0])
+
+def check(n, ref):
+    now = heap()
+    bad = ['%s %d -> %d' % (NAMES[i], ref[i], now[i]) for i in range(len(NAMES)) if ref[i] - now[i] > DROP_MAX[i]]
+    print('check %d %s' % (n, ', '.join(bad) if bad else 'ok'))
+    return not bad
+
+def one_round():
+    s.setblocking(True)
+    s.send(PAYLOAD)
+    s.setblocking(False)
+    s.recv(64)
+
+passed = True
+ref = None
+for r in range(1, SOAK_ROUNDS + 1):
+    one_round()
+    if r == WARMUP:
+        ref = heap()
+        print('warmed up')
+    elif r > WARMUP and (r - WARMUP) % CHECK_EVERY == 0:
+        passed = check((r - WARMUP) // CHECK_EVERY, ref) and passed
+print('PASS' if passed else 'FAIL')
@@ -0,0 +1,61 @@
+'''
+Soak test of TLS: a full handshake with SOAK_TLS_HOST and a close every round, with the
+WLAN already connected. mbedTLS allocates its contexts and record buffers from the system
+heap, a leak or a growing fragmentation shows in the heap figures.
+The free heaps and their largest blocks after the warm-up rounds are the reference, every
+check compares them to it. Raise SOAK_ROUNDS for a long run, with pyboard.py then.
+'''
+
+import gc
+import pycom
+import socket
+import ssl
+import sys
+from network import WLAN
+
+if not WLAN().isconnected():
+    print("SKIP")
+    sys.exit()
+
+try:
+    SOAK_ROUNDS
+except NameError:
+    SOAK_ROUNDS = 40
+WARMUP = 2
+CHECK_EVERY = 2
+SOAK_TLS_HOST = ('www.pycom.io', 443)
+
+NAMES = ('gc free', 'gc largest', 'heap free', 'heap largest')
+# the most each one may drop below its reference, in bytes
+DROP_MAX = (4096, 8192, 4096, 8192)
+
+def heap():
+    gc.collect()
+    return (gc.mem_free(), gc.profile_data()[2], pycom.get_free_heap()[0], pycom.get_largest_free_block()[0])
+
+def check(n, ref):
+    now = heap()
+    bad = ['%s %d -> %d' % (NAMES[i], ref[i], now[i]) for i in range(len(NAMES)) if ref[i] - now[i] > DROP_MAX[i]]
+    print('check %d %s' % (n, ', '.join(bad) if bad else 'ok'))
+    return not bad
+
+def one_round():
+    addr = socket.getaddrinfo(SOAK_TLS_HOST[0], SOAK_TLS_HOST[1])[0][-1]
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    try:
+        s.settimeout(10)
+        s.connect(addr)
+        s = ssl.wrap_socket(s, server_hostname=SOAK_TLS_HOST[0])
+    finally:
+        s.close()
+
+passed = True
+ref = None
+for r in range(1, SOAK_ROUNDS + 1):
+    one_round()
+    if r == WARMUP:
+        ref = heap()
+        print('warmed up')
+    elif r > WARMUP and (r - WARMUP) % CHECK_EVERY == 0:
+        passed = check((r - WARMUP) // CHECK_EVERY, ref) and passed
+print('PASS' if passed else 'FAIL')
@@ -0,0 +1,62 @@
+'''
+Soak test of the TCP sockets: resolve, connect, send, read to the end and close, over and
+over, with the WLAN already connected to a network reaching SOAK_HOST.
+The free heaps and their largest blocks after the warm-up rounds are the reference, every
+check compares them to it. Raise SOAK_ROUNDS for a long run, with pyboard.py then.
+'''
+
+import gc
+import pycom
+import socket
+import sys
+from network import WLAN
+
+if not WLAN().isconnected():
+    print("SKIP")
+    sys.exit()
+
+try:
+    SOAK_ROUNDS
+except NameError:
+    SOAK_ROUNDS = 100
+SOAK_HOST = ('www.pycom.io', 80)
+WARMUP = 10
+CHECK_EVERY = 10
+REQUEST = ('HEAD / HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n' % SOAK_HOST[0]).encode()
+
+NAMES = ('gc free', 'gc largest', 'heap free', 'heap largest')
+# the most each one may drop below its reference, in bytes
+DROP_MAX = (4096, 8192, 4096, 8192)
+
+def heap():
+    gc.collect()
+    return (gc.mem_free(), gc.profile_data()[2], pycom.get_free_heap()[0], pycom.get_largest_free_block()[0])
+
+def check(n, ref):
+    now = heap()
+    bad = ['%s %d -> %d' % (NAMES[i], ref[i], now[i]) for i in range(len(NAMES)) if ref[i] - now[i] > DROP_MAX[i]]
+    print('check %d %s' % (n, ', '.join(bad) if bad else 'ok'))
+    return not bad
+
+def one_round():
+    addr = socket.getaddrinfo(SOAK_HOST[0], SOAK_HOST[1])[0][-1]
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    try:
+        s.settimeout(5)
+        s.connect(addr)
+        s.send(REQUEST)
+        while s.recv(512):
+            pass
+    finally:
+        s.close()
+
+passed = True
+ref = None
+for r in range(1, SOAK_ROUNDS + 1):
+    one_round()
+    if r == WARMUP:
+        ref = heap()
+        print('warmed up')
+    elif r > WARMUP and (r - WARMUP) % CHECK_EVERY == 0:
+        passed = check((r - WARMUP) // CHECK_EVERY, ref) and passed
+print('PASS' if passed else 'FAIL')
@@ -0,0 +1,47 @@
+import socket
+import time
+import _thread
+from network import WLAN
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+# nothing answers on this address, every connect must time out
+ADDRESS = ('10.255.255.1', 80)
+CONNECTS = 6
+TIMEOUT_S = 2
+
+print('Starting parallel connect test')
+
+lock = _thread.allocate_lock()
+results = []
+
+def connect(n):
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.settimeout(TIMEOUT_S)
+    try:
+        s.connect(ADDRESS)
+        res = 'connected'
+    except TimeoutError:
+        res = 'timeout'
+    except OSError as e:
+        res = 'error'
+    s.close()
+    with lock:
+        results.append(res)
+
+start = time.ticks_ms()
+for n in range(CONNECTS):
+    _thread.start_new_thread(connect, (n,))
+
+while len(results) < CONNECTS and time.ticks_diff(time.ticks_ms(), start) < CONNECTS * TIMEOUT_S * 1000 + 5000:
+    time.sleep_ms(50)
+elapsed = time.ticks_diff(time.ticks_ms(), start)
+
+print(len(results), results.count('timeout'))
+# the connects time out together, not one after the other
+print('parallel:', 'OK' if elapsed < 2 * TIMEOUT_S * 1000 else 'SLOW')
@@ -0,0 +1,16 @@
+import socket
+
+st = socket.netstats(reset=True)
+print(st.tcp.limit > 0, st.udp.limit > 0, st.sockets.limit > 0)
+print(st.memory.free > 0, st.memory.min_free <= st.memory.free)
+
+used = st.sockets.used
+udp = st.udp.used
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+st = socket.netstats()
+print(st.sockets.used == used + 1, st.sockets.peak >= used + 1)
+print(st.udp.used == udp + 1)
+s.close()
+st = socket.netstats()
+print(st.sockets.used == used, st.udp.used == udp)
+print(st.tcp.retransmitting <= st.tcp.active)
@@ -0,0 +1,56 @@
+import socket
+import time
+import gc
+from network import WLAN
+
+# needs the board to be connected to an AP already
+wlan = WLAN()
+if not wlan.isconnected():
+    print("SKIP")
+    import sys
+    sys.exit()
+
+ADDRESS = ('127.0.0.1', 8811)
+CHUNK = 256
+ITERATIONS = 200
+
+print('Starting recv_into benchmark')
+
+rx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+rx.bind(ADDRESS)
+rx.settimeout(1)
+tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+payload = bytes(range(256)) * (CHUNK // 256)
+
+# the fragments of sendmsg() leave as a single datagram
+tx.sendmsg([b'abc', memoryview(b'defgh')[1:], b''], ADDRESS)
+print(rx.recvfrom(64)[0])
+
+def run(into):
+    buf = bytearray(CHUNK)
+    mv = memoryview(buf)
+    total = 0
+    gc.collect()
+    free = gc.mem_free()
+    start = time.ticks_us()
+    for i in range(ITERATIONS):
+        tx.sendto(payload, ADDRESS)
+        if into:
+            n, addr = rx.recvfrom_into(mv)
+        else:
+            n = len(rx.recvfrom(CHUNK)[0])
+        total += n
+    elapsed = time.ticks_diff(time.ticks_us(), start)
+    return total, total * 1000000 // max(elapsed, 1), free - gc.mem_free()
+
+total, rate_copy, used_copy = run(False)
+print(total)
+total, rate_into, used_into = run(True)
+print(total)
+
+# recvfrom() allocates the payload every time, recvfrom_into() only the address tuple
+print('heap:', 'OK' if used_into < used_copy - ITERATIONS * CHUNK // 2 else 'SLOW')
+print('rate:', 'OK' if rate_into >= rate_copy * 9 // 10 else 'SLOW')
+
+rx.close()
+tx.close()
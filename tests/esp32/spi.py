@@ -72,6 +72,30 @@ spi.init(SPI.MASTER, baudrate=10000000, bits=32, polarity=0, phase=0, pins=spi_p
 print(spi.write_readinto(buffer_w, buffer_r) == 12)
 print(buffer_w == buffer_r)
 
+# large transfers go through DMA
+import time
+spi.init(SPI.MASTER, baudrate=20000000, bits=8, polarity=0, phase=0, pins=spi_pins)
+buffer_w = bytearray(range(256)) * 32
+buffer_r = bytearray(len(buffer_w))
+print(spi.write_readinto(buffer_w, buffer_r) == len(buffer_w))
+print(buffer_w == buffer_r)
+
+start = time.ticks_us()
+for i in range(10):
+    spi.write(buffer_w)
+elapsed = time.ticks_diff(time.ticks_us(), start)
+# 20Mbit/s on the wire, at least half of it must reach the bus
+print('OK' if 10 * len(buffer_w) * 8 * 1000000 // elapsed > 10000000 else 'SLOW')
+
+buffer_r = bytearray(len(buffer_w))
+spi.readinto_async(buffer_r, write=0xA5)
+while not spi.done():
+    pass
+print(buffer_r == bytearray([0xA5]) * len(buffer_r))
+spi.write_async(buffer_w)
+spi.write(b'1')                 # waits for the previous transfer
+print(spi.done())
+
 # check for memory leaks...
 for i in range (0, 1000):
     spi = SPI(0, SPI.MASTER, baudrate=1000000)
@@ -0,0 +1,53 @@
+# SPI devices sharing one bus, run with MOSI looped back to MISO
+from machine import SPI
+import time
+
+spi_pins = ('P5', 'P9', 'P23')
+
+spi = SPI(0, SPI.MASTER, baudrate=1000000, pins=spi_pins)
+fast = spi.device('P8', baudrate=20000000)
+slow = spi.device('P11', baudrate=400000, polarity=1, phase=1)
+print(fast)
+print(slow)
+
+buffer_w = bytearray(range(100))
+buffer_r = bytearray(100)
+print(fast.write_readinto(buffer_w, buffer_r) == 100)
+print(buffer_w == buffer_r)
+buffer_r = bytearray(10)
+print(slow.readinto(buffer_r, write=0x3C) == 10)
+print(buffer_r == bytearray([0x3C]) * 10)
+
+# the bus keeps its own configuration
+buffer_r = bytearray(10)
+spi.write_readinto(buffer_w[:10], buffer_r)
+print(buffer_w[:10] == buffer_r)
+
+cmd = b'\x03\x00\x10'
+data = bytearray(200)
+fast.transaction([cmd, (None, data), (cmd, bytearray(3))])
+print(data == bytearray(200))
+
+try:
+    fast.transaction([(None, None)])
+except ValueError:
+    print('ValueError')
+
+try:
+    spi.device('P8', baudrate=1000000, polarity=2)
+except ValueError:
+    print('ValueError')
+
+# switching devices shouldn't cost more than a transfer
+start = time.ticks_us()
+for i in range(200):
+    fast.write(b'ab')
+    slow.write(b'ab')
+elapsed = time.ticks_diff(time.ticks_us(), start)
+print('OK' if elapsed // 400 < 200 else 'SLOW')
+
+spi.deinit()
+try:
+    fast.write(b'a')
+except OSError:
+    print('OSError')
@@ -0,0 +1,52 @@
+'''
+SPI0 is the master on P10 (CLK), P11 (MOSI) and P14 (MISO) with P9 as chip select,
+wired to SPI1 as the slave on P19 (CLK), P20 (MOSI), P21 (MISO) and P22 (CS).
+SPI1 is only there on the WiPy and the GPy.
+'''
+
+from machine import SPI, Pin
+import os
+import time
+
+if os.uname().sysname not in ('WiPy', 'GPy'):
+    print("SKIP")
+    raise SystemExit
+
+slave = SPI(1, SPI.SLAVE, pins=('P19', 'P20', 'P21', 'P22'), nbytes=16)
+print(slave)
+master = SPI(0, SPI.MASTER, baudrate=4000000)
+cs = Pin('P9', mode=Pin.OUT, value=1)
+
+done = []
+slave.irq(handler=lambda spi: done.append(1))
+
+def transfer(data):
+    r = bytearray(len(data))
+    cs(0)
+    master.write_readinto(data, r)
+    cs(1)
+    time.sleep_ms(5)
+    return r
+
+# what the slave stages goes out in the transactions after the ones already queued
+print(slave.write(b'snapshot-1'))
+transfer(bytearray(16))
+transfer(bytearray(16))
+print(transfer(b'ping'.ljust(16, b'\x00'))[:10])
+
+buf = bytearray(16)
+print(slave.readinto(buf), buf[:4])
+print(len(done) >= 3)
+slave.irq(handler=None)
+
+try:
+    slave.write_readinto(b'x', bytearray(1))
+except OSError:
+    print("OSError")
+try:
+    SPI(1, SPI.SLAVE, bits=16, pins=('P19', 'P20', 'P21', 'P22'))
+except ValueError:
+    print("ValueError")
+
+slave.deinit()
+print(slave)
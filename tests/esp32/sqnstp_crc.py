@@ -0,0 +1,31 @@
+'''
+The native CRCs of the modem upgrade against their Python versions
+'''
+try:
+    import usqnstp
+except ImportError:
+    print('SKIP')
+    raise SystemExit
+
+data = bytes(range(256)) * 8 + b'\x55'
+
+# CRC-16/CCITT, initial value 0
+crc = 0
+for ch in data:
+    crc ^= ch << 8
+    for _ in range(8):
+        crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        crc &= 0xFFFF
+print(usqnstp.crc16(data) == crc)
+print(usqnstp.crc16(data[100:], usqnstp.crc16(data[:100])) == crc)
+print(usqnstp.crc16(b'123456789') == 0x31C3)
+
+# Fletcher-32 over big endian words
+s1 = s2 = 0xFFFF
+for i in range(0, len(data) - 1, 2):
+    s1 = (s1 + (data[i] << 8 | data[i + 1])) % 0xFFFF
+    s2 = (s2 + s1) % 0xFFFF
+s1 = (s1 + (data[-1] << 8)) % 0xFFFF
+s2 = (s2 + s1) % 0xFFFF
+f32 = usqnstp.fletcher32(data)
+print((f32 & 0xFFFF) % 0xFFFF == s1 and (f32 >> 16) % 0xFFFF == s2)
@@ -0,0 +1,23 @@
+import machine
+import time
+
+if not hasattr(machine, 'task_health'):
+    print('SKIP')
+    raise SystemExit
+
+time.sleep_ms(100)
+tasks = machine.task_health()
+names = [t.name for t in tasks]
+# the servers task runs on every board, LoRa and LTE only where there's a radio
+print('Servers' in names)
+print('TaskMon' in [t.name for t in machine.tasks()])
+print(all(t.deadline > 0 and len(t.hist) == 8 and not t.overdue for t in tasks))
+
+machine.task_health(True)
+t = machine.task_health()[names.index('Servers')]
+print(t.name, t.overruns, sum(t.hist) <= t.beats, t.last_seen >= 0)
+
+# no WDT here, the guard only changes what feed() does
+machine.task_health(guard=True)
+machine.task_health(guard=False)
+print('done')
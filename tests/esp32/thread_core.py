@@ -0,0 +1,47 @@
+# test pinning threads to a core and hashing with the GIL released
+
+import _thread
+import hashlib
+import time
+
+print(_thread.core_affinity())
+
+cores = []
+def worker(n):
+    cores.append((n, _thread.get_core()))
+
+_thread.start_new_thread(worker, (0,), core=0)
+time.sleep_ms(100)
+_thread.start_new_thread(worker, (1,), core=1)
+time.sleep_ms(100)
+_thread.start_new_thread(worker, (2,), core=_thread.ANY_CORE)
+time.sleep_ms(100)
+print(sorted(cores)[:2], len(cores))
+
+try:
+    _thread.start_new_thread(worker, (3,), core=2)
+except ValueError:
+    print('ValueError')
+
+_thread.core_affinity(0)
+cores = []
+_thread.start_new_thread(worker, (4,))
+time.sleep_ms(100)
+print(cores)
+_thread.core_affinity(1)
+
+# hash a large buffer on core 0 while this thread keeps running
+data = bytes(range(256)) * 256
+_thread.gil_release(4096)
+print(_thread.gil_release())
+digest = []
+def hasher():
+    digest.append(hashlib.sha256(data).digest())
+
+_thread.start_new_thread(hasher, (), core=0)
+n = 0
+while not digest:
+    n += 1
+    time.sleep_ms(1)
+print(digest[0] == hashlib.sha256(data).digest())
+_thread.gil_release(0)
@@ -82,3 +82,15 @@ time.sleep_us(900)
 t2 = time.ticks_us()
 irqs = machine.enable_irq(irqs)
 print((abs(t2 - t1 - 900)) < 100)
+
+# Timer.ticks() counts the main timer, a Chrono can be built from two counts
+from machine import Timer
+t1 = Timer.ticks()
+time.sleep_ms(100)
+t2 = Timer.ticks()
+print(abs(Timer.Chrono(t1, t2).read_ms() - 100) < 10)
+print(abs((t2 - t1) / Timer.CLOCK_FREQ - 0.1) < 0.01)
+try:
+    Timer.Chrono(t2, t1)
+except ValueError:
+    print('ValueError')
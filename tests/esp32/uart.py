@@ -85,6 +85,67 @@ for uart_id in uart_id_range:
     r = uart.readall()
     r = uart.readall()
     print(r)
+    print(uart.rx_overflows() > 0)
     print(uart.write(b'123456') == 6)
     print(uart.read() == b'123456')
     uart.deinit()
+
+# buffered TX and bulk reads
+for uart_id in uart_id_range:
+    uart = UART(uart_id, 1000000, pins=('P9', 'P23'), rx_buffer_size=4096, tx_buffer_size=1024, rx_threshold=64)
+    print(uart.rx_overflows())
+    buf = bytes(range(256)) * 8
+    print(uart.write(buf) == len(buf))
+    uart.wait_tx_done(100)
+    time.sleep_ms(10)
+    rx = bytearray(len(buf))
+    print(uart.readinto(rx) == len(buf) and rx == buf)
+    print(uart.rx_overflows())
+    uart.deinit()
+
+try:
+    UART(1, 9600, tx_buffer_size=64)
+except ValueError:
+    print('ValueError')
+try:
+    UART(1, 9600, rx_threshold=128)
+except ValueError:
+    print('ValueError')
+
+# frame mode
+uart = UART(1, 115200, pins=('P9', 'P23'))
+uart.frame_mode(end=b'\r\n')
+uart.write(b'abc\r\ndef\r\n')
+uart.wait_tx_done(100)
+print(uart.read_frame(100))
+print(uart.read_frame(100))
+print(uart.read_frame())
+uart.frame_mode(idle=4)
+frames = []
+uart.callback(UART.RX_FRAME, handler=lambda u: frames.append(u.read_frame()))
+uart.write(b'\x01\x03\x00\x00')
+time.sleep_ms(20)
+uart.write(b'\x01\x06')
+time.sleep_ms(50)
+print(frames)
+print(uart.frames_dropped())
+uart.callback(None)
+uart.frame_mode()
+uart.deinit()
+
+# buffered writes return before the data is sent, TX_DONE tells when it is
+import uselect
+uart = UART(1, 115200, pins=('P9', 'P23'))
+done = []
+uart.callback(UART.TX_DONE, handler=lambda u: done.append(u.any()))
+poll = uselect.poll()
+poll.register(uart, uselect.POLLOUT)
+print(poll.poll(100) != [])
+t = time.ticks_ms()
+print(uart.write(b'x' * 400) == 400)
+print(time.ticks_diff(time.ticks_ms(), t) < 10)
+time.sleep_ms(100)
+print(len(done) == 1 and done[0] == 400)
+print(uart.read(400) == b'x' * 400)
+uart.callback(None)
+uart.deinit()
@@ -0,0 +1,31 @@
+import machine
+import ustruct
+
+ulp = machine.ULP()
+print(ulp is machine.ULP())
+
+# a 'halt' instruction followed by one data word and one bss word
+HALT = 0xb0000000
+prog = ustruct.pack('<IHHHHII', 0x00706c75, 12, 4, 4, 4, HALT, 0x1234)
+
+ulp.write(2, 0xffff)
+ulp.load_binary(0, prog)
+print(hex(ulp.read(1)), ulp.read(2))
+
+ulp.write(10, 0x12345)
+print(hex(ulp.read(10)))
+
+ulp.set_wakeup_period(0, 20000)
+ulp.run(0)
+ulp.stop()
+
+for bad in (prog[:8], b'xlp\x00' + prog[4:]):
+    try:
+        ulp.load_binary(0, bad)
+    except ValueError:
+        print('ValueError')
+
+try:
+    ulp.read(ulp.MEM_WORDS)
+except ValueError:
+    print('ValueError')
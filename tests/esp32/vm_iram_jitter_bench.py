@@ -0,0 +1,45 @@
+import os
+import time
+import _thread
+
+FILE = '/flash/jitter_bench.bin'
+CHUNK = bytes(4096)
+LOOPS = 20000
+# worst gap between two iterations of a busy Python loop, the SPI flash stalls
+# both CPUs while a sector is erased or written
+MAX_GAP_IDLE_US = 2000
+MAX_GAP_WRITING_US = 60000
+
+print('Starting VM jitter benchmark')
+
+def check(name, value, maximum):
+    print('%s: %s' % (name, 'OK' if value <= maximum else 'SLOW'))
+
+def worst_gap():
+    gap = 0
+    last = time.ticks_us()
+    for i in range(LOOPS):
+        now = time.ticks_us()
+        gap = max(gap, time.ticks_diff(now, last))
+        last = now
+    return gap
+
+writing = [True]
+
+def writer():
+    with open(FILE, 'wb') as f:
+        while writing[0]:
+            f.write(CHUNK)
+            f.flush()
+            f.seek(0)
+    writing[0] = None
+
+check('idle', worst_gap(), MAX_GAP_IDLE_US)
+
+_thread.start_new_thread(writer, ())
+time.sleep_ms(50)
+check('flash writes', worst_gap(), MAX_GAP_WRITING_US)
+writing[0] = False
+while writing[0] is not None:
+    time.sleep_ms(10)
+os.remove(FILE)
@@ -0,0 +1,17 @@
+import machine
+
+# the deep sleep itself can't be tested here, only the configuration
+skips, value = machine.wake_stub_stats()
+print(isinstance(skips, int), isinstance(value, int))
+
+machine.wake_stub(True, adc='P13', low=100, high=3000, pins=('P10',), level=0, max_skips=5)
+machine.wake_stub(True, max_skips=3)
+
+# P10 is not an ADC1 pad, P1 (UART TX) can't be read from the RTC domain
+for kwargs in ({'adc': 'P10'}, {'pins': ('P1',)}, {'low': 10, 'high': 5}, {'high': 4096}):
+    try:
+        machine.wake_stub(True, **kwargs)
+    except ValueError:
+        print('ValueError')
+
+machine.wake_stub(False)
@@ -0,0 +1,36 @@
+'''
+Soft-AP settings test, a single device: no station joins so the list stays empty
+'''
+from network import WLAN
+
+wlan = WLAN(mode=WLAN.AP, ssid='test-ap')
+if not hasattr(wlan, 'ap_config'):
+    print('SKIP')
+    raise SystemExit
+
+print(wlan.ap_config())
+
+wlan = WLAN(mode=WLAN.AP, ssid='test-ap', max_clients=8, beacon_interval=200, inactive_time=60, tx_buffers=(0, 64))
+print(wlan.ap_config())
+
+wlan.ap_config(max_clients=2, inactive_time=0)
+cfg = wlan.ap_config()
+print(cfg.max_clients, cfg.beacon_interval, cfg.inactive_time)
+print(wlan.ap_sta_list())
+
+for bad in ({'max_clients': 0}, {'max_clients': 11}, {'beacon_interval': 50}, {'inactive_time': -1}):
+    try:
+        wlan.ap_config(**bad)
+    except ValueError:
+        print('ValueError')
+
+try:
+    WLAN(mode=WLAN.AP, ssid='test-ap', tx_buffers=(2, 0))
+except ValueError as e:
+    print(e)
+
+wlan = WLAN(mode=WLAN.STA)
+try:
+    wlan.ap_sta_list()
+except OSError:
+    print('OSError')
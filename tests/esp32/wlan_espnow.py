@@ -0,0 +1,55 @@
+'''
+ESP-NOW API test, a single device: broadcasts are always reported as sent
+'''
+from network import WLAN
+import time
+
+wlan = WLAN(mode=WLAN.STA)
+if not hasattr(wlan, 'espnow_init'):
+    print('SKIP')
+    raise SystemExit
+
+BCAST = b'\xff' * 6
+
+wlan.espnow_init()
+wlan.espnow_add_peer(BCAST, channel=1)
+peers = wlan.espnow_peers()
+print(len(peers), peers[0].mac == BCAST, peers[0].encrypt)
+
+wlan.events()
+wlan.espnow_send(BCAST, b'hello')
+time.sleep_ms(100)
+print(wlan.events() & WLAN.ESPNOW_TX == WLAN.ESPNOW_TX)
+print(wlan.espnow_stats().tx_ok)
+
+buf = bytearray(250)
+print(wlan.espnow_recv_into(buf))
+
+for args in ((BCAST, b''), (BCAST, bytes(251))):
+    try:
+        wlan.espnow_send(*args)
+    except OSError:
+        print('OSError')
+
+try:
+    wlan.espnow_add_peer(b'\x01\x02')
+except ValueError:
+    print('ValueError')
+
+try:
+    wlan.espnow_init(b'short')
+except ValueError:
+    print('ValueError')
+
+wlan.espnow_del_peer(BCAST)
+print(len(wlan.espnow_peers()))
+try:
+    wlan.espnow_del_peer(BCAST)
+except OSError:
+    print('OSError')
+
+wlan.espnow_deinit()
+try:
+    wlan.espnow_peers()
+except OSError:
+    print('OSError')
@@ -0,0 +1,53 @@
+try:
+    import framebuf
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+w = 9
+h = 5
+buf = bytearray(w * h * 2)
+fbuf = framebuf.FrameBuffer(buf, w, h, framebuf.RGB565)
+
+# a new framebuffer is all dirty
+print(fbuf.dirty(True))
+print(fbuf.dirty())
+
+fbuf.pixel(3, 2, 0x1234)
+print(fbuf.dirty())
+fbuf.fill_rect(6, 1, 10, 2, 0xabcd)
+print(fbuf.dirty(True))
+fbuf.line(8, 4, 7, 0, 1)
+print(fbuf.dirty(True))
+fbuf.text("A", -4, 1, 2)
+print(fbuf.dirty(True))
+
+# word wide fill from odd and even offsets
+fbuf.fill(0)
+fbuf.fill_rect(1, 0, 6, 1, 0xaa55)
+fbuf.fill_rect(0, 1, 3, 1, 0x1111)
+print(buf[:w * 4])
+
+# same format blits, with and without key, and onto itself
+src = framebuf.FrameBuffer(bytearray(3 * 2 * 2), 3, 2, framebuf.RGB565)
+src.fill(0x0102)
+src.pixel(1, 1, 0)
+fbuf.fill(0)
+_ = fbuf.dirty(True)
+fbuf.blit(src, 7, 3)
+print(fbuf.dirty(True))
+fbuf.blit(src, 0, 0, 0)
+fbuf.blit(fbuf, 1, 1)
+for y in range(h):
+    print([fbuf.pixel(x, y) for x in range(w)])
+
+# mono formats are widened to whole bytes
+fbuf = framebuf.FrameBuffer(bytearray(16 * 2), 16, 16, framebuf.MONO_VLSB)
+_ = fbuf.dirty(True)
+fbuf.pixel(3, 9, 1)
+print(fbuf.dirty(True))
+fbuf = framebuf.FrameBuffer(bytearray(16 * 2), 16, 16, framebuf.MONO_HLSB)
+_ = fbuf.dirty(True)
+fbuf.hline(3, 9, 7, 1)
+print(fbuf.dirty(True))
+print(fbuf.dirty())
@@ -0,0 +1,25 @@
+# test ubinascii.CRC, with the check values of the catalogue of CRC parameters
+try:
+    import ubinascii as binascii
+    CRC = binascii.CRC
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+data = b'123456789'
+for width, poly, kw in (
+    (8, 0x07, {}),
+    (8, 0x31, {'refin': True, 'refout': True}),
+    (16, 0x8005, {'init': 0xffff, 'refin': True, 'refout': True}),
+    (16, 0x1021, {'init': 0xffff}),
+    (16, 0x1021, {'init': 0xffff, 'refin': True, 'refout': True, 'xorout': 0xffff}),
+    (32, 0x04c11db7, {'init': 0xffffffff, 'xorout': 0xffffffff}),
+    (32, 0x04c11db7, {'init': 0xffffffff, 'refin': True, 'refout': True, 'xorout': 0xffffffff}),
+):
+    crc = CRC(width, poly, **kw)
+    print(width, hex(crc.calc(data)), crc.calc(data[4:], crc.calc(data[:4])) == crc.calc(data))
+
+try:
+    CRC(4, 0x3)
+except ValueError:
+    print('ValueError')
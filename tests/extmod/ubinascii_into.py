@@ -0,0 +1,21 @@
+# test the uPy ubinascii functions writing into a buffer
+try:
+    import ubinascii as binascii
+    hexlify_into = binascii.hexlify_into
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+buf = bytearray(16)
+print(binascii.hexlify_into(b'\x12\x34\xab\xcd\xef', buf), buf[:10])
+print(binascii.unhexlify_into(b'414243', buf), buf[:3])
+print(binascii.b2a_base64_into(b'foob', buf), buf[:9])
+print(binascii.a2b_base64_into(b'Zm9v\nYmFy', buf), buf[:6])
+
+# the buffer must be big enough
+for f, data in ((binascii.hexlify_into, b'12345'), (binascii.b2a_base64_into, b'12345'),
+    (binascii.a2b_base64_into, b'MTIzNDU2Nzg=')):
+    try:
+        f(data, bytearray(4))
+    except ValueError:
+        print('ValueError')
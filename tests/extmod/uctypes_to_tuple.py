@@ -0,0 +1,59 @@
+# test bulk decoding of uctypes structures with to_tuple() and to_dict()
+
+try:
+    import uctypes
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(uctypes, 'to_tuple'):
+    print("SKIP")
+    raise SystemExit
+
+# a LoRa style frame, the fields given out of order
+FRAME = {
+    "temp": 3 | uctypes.INT16,
+    "port": 0 | uctypes.UINT8,
+    "count": 1 | uctypes.UINT16,
+    "flags": (5, {
+        "lo": 0 | uctypes.BFUINT8 | 0 << uctypes.BF_POS | 4 << uctypes.BF_LEN,
+        "hi": 0 | uctypes.BFUINT8 | 4 << uctypes.BF_POS | 4 << uctypes.BF_LEN,
+    }),
+    "tail": (uctypes.ARRAY | 6, uctypes.UINT8 | 2),
+}
+
+data = bytearray(b"\x07\x34\x12\xfe\xff\xa5\x01\x02")
+s = uctypes.struct(uctypes.addressof(data), FRAME, uctypes.LITTLE_ENDIAN)
+
+t = uctypes.to_tuple(s)
+print(t[:3], uctypes.to_tuple(t[3]), list(t[4]))
+d = uctypes.to_dict(s)
+print(sorted((k, v) for k, v in d.items() if k in ("port", "count", "temp")))
+print(uctypes.to_dict(s.flags) == {"lo": 5, "hi": 10})
+
+# the values follow the buffer and writes still go through
+data[0] = 9
+s.count = 0x5678
+print(uctypes.to_tuple(s)[:3], s.temp, s.flags.hi)
+
+b = uctypes.struct(uctypes.addressof(data), FRAME, uctypes.BIG_ENDIAN)
+print(uctypes.to_tuple(b)[:3])
+
+# more descriptors than the layouts kept, and one gaining a field
+descs = [{"f%d" % i: i | uctypes.UINT8} for i in range(8)]
+for i, desc in enumerate(descs):
+    print(uctypes.to_tuple(uctypes.struct(uctypes.addressof(data), desc))[0], end=" ")
+print()
+desc = {"a": 0 | uctypes.UINT8}
+print(uctypes.to_tuple(uctypes.struct(uctypes.addressof(data), desc)))
+desc["b"] = 1 | uctypes.UINT8
+print(uctypes.to_tuple(uctypes.struct(uctypes.addressof(data), desc)))
+
+try:
+    s.missing
+except KeyError:
+    print("KeyError")
+try:
+    uctypes.to_tuple(s.tail)
+except TypeError:
+    print("TypeError")
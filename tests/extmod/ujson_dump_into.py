@@ -0,0 +1,28 @@
+# test uPy ujson.dump_into() and the sharing of repeated dict keys
+try:
+    import ujson as json
+    dump_into = json.dump_into
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+buf = bytearray(32)
+n = json.dump_into({"a": [1, None]}, buf)
+print(n, buf[:n])
+
+n = json.dump_into("abc", memoryview(buf)[4:])
+print(n, buf[4:4 + n])
+
+# buffer too small
+try:
+    json.dump_into([1, 2, 3, 4, 5, 6], bytearray(8))
+except ValueError:
+    print('ValueError')
+
+# the same key in many objects is the same object
+l = json.loads('[{"not_a_qstr_key": 1}, {"not_a_qstr_key": 2}]')
+print(l)
+print(list(l[0])[0] is list(l[1])[0])
+
+# parse from a bytes object
+print(json.loads(b'{"a": 1}'))
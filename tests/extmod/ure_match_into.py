@@ -0,0 +1,32 @@
+# test the match_into() and search_into() methods, spans without a match object
+
+try:
+    import ure as re
+    import array
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(re, 'match_into'):
+    print("SKIP")
+    raise SystemExit
+
+spans = array.array('h', [0] * 8)
+
+# an AT response and an NMEA sentence
+r = re.compile(r'\+CSQ: (\d+),(\d+)')
+line = '+CSQ: 17,99'
+print(r.match_into(line, spans), list(spans[:6]))
+print(line[spans[2]:spans[3]], line[spans[4]:spans[5]])
+print(r.match_into('OK', spans))
+print(r.search_into('\r\n' + line, spans), list(spans[:2]))
+
+# a group not taking part gets -1
+print(re.match_into('(a)|(b)', 'b', spans), list(spans[:6]))
+
+# the pairs that don't fit are dropped
+short = array.array('i', [7, 7, 7])
+print(re.match_into(r'\$(GP)(GGA)', b'$GPGGA,123', short), list(short))
+
+# the same pattern string gives back the same regex while it's cached
+print(re.compile('x+y') is re.compile('x+y'))
@@ -0,0 +1,39 @@
+# test uzlib.compress() and uzlib.CompIO against the decompressor
+try:
+    import uzlib as zlib
+    import uio as io
+    compress = zlib.compress
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+data = b'hello world, hello world, hello hello hello ' * 20 + bytes(range(256))
+
+# zlib, raw deflate and gzip output of several window sizes
+for wbits in (8, 10, 15):
+    print(wbits, zlib.decompress(zlib.compress(data, wbits)) == data)
+print(zlib.decompress(zlib.compress(data, -9), -9) == data)
+print(zlib.DecompIO(io.BytesIO(zlib.compress(data, 26)), 26).read() == data)
+print(len(zlib.compress(data)) < len(data) // 2)
+print(zlib.decompress(zlib.compress(b'')))
+
+# streaming, with a flush in the middle
+buf = io.BytesIO()
+z = zlib.CompIO(buf, 9)
+for i in range(50):
+    n = z.write(b'line %d\n' % i)
+    if i == 25:
+        z.flush()
+        part = len(buf.getvalue())
+z.close()
+print(part > 0, len(buf.getvalue()) > part)
+print(zlib.decompress(buf.getvalue()) == b''.join(b'line %d\n' % i for i in range(50)))
+try:
+    z.write(b'x')
+except OSError:
+    print('OSError')
+
+try:
+    zlib.compress(b'x', 7)
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,41 @@
+try:
+    import uio
+    import uwebsocket
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def mask(data, key):
+    return bytes(data[i] ^ key[i & 3] for i in range(len(data)))
+
+def frame(data, key):
+    n = len(data)
+    if n < 126:
+        hdr = bytes([0x82, 0x80 | n])
+    else:
+        hdr = bytes([0x82, 0x80 | 126, n >> 8, n & 0xff])
+    return hdr + key + mask(data, key)
+
+key = b"\x12\x34\x56\x78"
+data = bytes(range(256)) * 2
+
+# the payload read in pieces of every size, so the mask is picked up at
+# every phase and the unmasking starts from unaligned buffer offsets
+for step in (1, 3, 4, 5, 7, 64, 300, 512):
+    ws = uwebsocket.websocket(uio.BytesIO(frame(data, key)))
+    buf = bytearray(step + 3)
+    out = b""
+    while len(out) < len(data):
+        mv = memoryview(buf)[len(out) & 3:]
+        n = ws.readinto(mv[:step])
+        out += bytes(mv[:n])
+    print(step, out == data)
+
+# short frames, shorter than a word
+for n in range(6):
+    ws = uwebsocket.websocket(uio.BytesIO(frame(data[:n], key)))
+    print(ws.read(n))
+
+# an unmasked frame is left as is
+ws = uwebsocket.websocket(uio.BytesIO(b"\x82\x05hello"))
+print(ws.read(5))
@@ -0,0 +1,49 @@
+# upload throughput over TCP with the buffer and Nagle options
+try:
+    import usocket as socket
+    import utime as time
+    ticks_ms = time.ticks_ms
+    ticks_diff = time.ticks_diff
+except ImportError:
+    import socket
+    import time
+    ticks_ms = lambda: int(time.time() * 1000)
+    ticks_diff = lambda a, b: a - b
+
+HOST = 'httpbin.org'
+UPLOAD = 64 * 1024
+CHUNK = 128
+
+
+def upload(nodelay, rcvbuf):
+    addr = socket.getaddrinfo(HOST, 80)[0][-1]
+    s = socket.socket()
+    s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, nodelay)
+    if rcvbuf:
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, rcvbuf)
+    s.connect(addr)
+    s.send(b'POST /anything HTTP/1.0\r\nHost: %s\r\nContent-Length: %d\r\n\r\n' % (bytes(HOST, 'latin'), UPLOAD))
+    data = bytes(CHUNK)
+    start = ticks_ms()
+    sent = 0
+    while sent < UPLOAD:
+        sent += s.send(data)
+    status = s.recv(12)
+    elapsed = ticks_diff(ticks_ms(), start)
+    s.close()
+    return status, UPLOAD * 1000 // max(elapsed, 1)
+
+
+s = socket.socket()
+s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+print('nodelay', s.getsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY) != 0)
+s.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, 8192)
+print('sndbuf', s.getsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF) > 0)
+s.close()
+
+status, rate_nagle = upload(0, 0)
+print(status)
+status, rate_nodelay = upload(1, 8192)
+print(status)
+# small writes must not wait for the ACK of the previous one once Nagle is off
+print('throughput:', 'OK' if rate_nodelay >= rate_nagle * 9 // 10 else 'SLOW')
@@ -0,0 +1,55 @@
+# TLS handshake on a non-blocking socket, driven by poll, and by a timed connect
+try:
+    import usocket as socket
+    import ussl as ssl
+    import uselect as select
+    ssl.SSL_WANT_READ
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+HOST = 'www.google.com'
+
+
+def get(ss):
+    ss.write(b'GET / HTTP/1.0\r\nHost: %s\r\n\r\n' % bytes(HOST, 'latin'))
+    return ss.read(4)
+
+
+def nonblocking(addr):
+    ss = ssl.wrap_socket(socket.socket(), server_hostname=HOST)
+    ss.setblocking(False)
+    try:
+        ss.connect(addr)
+    except OSError:
+        pass
+    poller = select.poll()
+    poller.register(ss, select.POLLOUT)
+    steps = 0
+    while True:
+        if not poller.poll(10000):
+            print('handshake timed out')
+            break
+        want = ss.do_handshake()
+        if want is None:
+            break
+        steps += 1
+        poller.modify(ss, select.POLLIN if want == ssl.SSL_WANT_READ else select.POLLOUT)
+    print('steps', steps > 0)
+    ss.setblocking(True)
+    print(get(ss))
+    ss.close()
+
+
+def timed(addr):
+    s = socket.socket()
+    ss = ssl.wrap_socket(s, server_hostname=HOST)
+    ss.settimeout(10)
+    ss.connect(addr)
+    print(get(ss))
+    ss.close()
+
+
+addr = socket.getaddrinfo(HOST, 443)[0][-1]
+nonblocking(addr)
+timed(addr)
@@ -0,0 +1,70 @@
+# test that threads blocked in socket calls don't stall the other threads
+
+try:
+    import utime
+    sleep_ms = utime.sleep_ms
+    ticks_ms = utime.ticks_ms
+    ticks_diff = utime.ticks_diff
+except ImportError:
+    import time
+    sleep_ms = lambda t: time.sleep(t / 1000)
+    ticks_ms = lambda: int(time.time() * 1000)
+    ticks_diff = lambda a, b: a - b
+
+try:
+    import usocket as socket
+except ImportError:
+    import socket
+
+import _thread
+
+BLOCK_MS = 1000
+n_thread = 3
+
+lock = _thread.allocate_lock()
+n_blocked = 0
+n_finished = 0
+
+try:
+    socks = []
+    for i in range(n_thread):
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.bind(('127.0.0.1', 8900 + i))
+        s.settimeout(BLOCK_MS / 1000)
+        socks.append(s)
+except OSError:
+    print('SKIP')
+    raise SystemExit
+
+def thread_entry(s):
+    global n_blocked, n_finished
+    with lock:
+        n_blocked += 1
+    try:
+        # nothing is ever sent to this socket, the call blocks until the timeout
+        s.recv(16)
+    except OSError:
+        pass
+    with lock:
+        n_finished += 1
+
+for s in socks:
+    _thread.start_new_thread(thread_entry, (s,))
+
+while n_blocked < n_thread:
+    sleep_ms(1)
+
+# this thread must keep running while the others sit in recv()
+ticks = 0
+start = ticks_ms()
+while ticks < 20:
+    sleep_ms(10)
+    ticks += 1
+elapsed = ticks_diff(ticks_ms(), start)
+print('progress', ticks, elapsed < BLOCK_MS // 2)
+
+while n_finished < n_thread:
+    sleep_ms(50)
+for s in socks:
+    s.close()
+print('done', n_finished)
@@ -0,0 +1,49 @@
+# microbenchmark of the GIL handover: a thread running on its own must not be slowed
+# down by it, two busy threads must both get their time-slices
+#
+# MIT license; Copyright (c) 2020, Pycom Limited.
+
+import time
+import _thread
+
+try:
+    ticks_ms = time.ticks_ms
+    ticks_diff = time.ticks_diff
+except AttributeError:
+    ticks_ms = lambda: int(time.time() * 1000)
+    ticks_diff = lambda a, b: a - b
+
+N = 100000
+
+progress = [0, 0]
+seen = []
+lock = _thread.allocate_lock()
+
+def count(k):
+    i = 0
+    while i < N:
+        i += 1
+        progress[k] = i
+    with lock:
+        # how far the other thread got meanwhile
+        seen.append(progress[1 - k])
+
+# single thread: nobody waits for the GIL
+t = ticks_ms()
+count(0)
+single = ticks_diff(ticks_ms(), t)
+
+# two threads contending for the GIL
+progress[0] = progress[1] = 0
+seen = []
+t = ticks_ms()
+_thread.start_new_thread(count, (1,))
+count(0)
+while len(seen) < 2:
+    time.sleep(0.01)
+contended = ticks_diff(ticks_ms(), t)
+
+print(seen[1] == N)
+# the first thread to finish must have shared the interpreter with the other one
+print(seen[0] > 0 and seen[1] > 0)
+print(single >= 0 and contended >= single)
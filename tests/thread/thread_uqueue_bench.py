@@ -0,0 +1,60 @@
+# microbenchmark of a producer and a consumer thread exchanging items through a
+# uqueue.Queue, one item per call against batches of them
+#
+# MIT license; Copyright (c) 2020, Pycom Limited.
+
+import time
+import _thread
+
+try:
+    import uqueue
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+N = 2000
+BATCH = 16
+QUEUE_SIZE = 64
+
+def producer_single(q):
+    for i in range(N):
+        q.put(i)
+
+def producer_many(q):
+    items = list(range(BATCH))
+    for i in range(N // BATCH):
+        sent = 0
+        while sent < BATCH:
+            sent += q.put_many(items[sent:] if sent else items)
+
+def run(producer, consume):
+    q = uqueue.Queue(QUEUE_SIZE)
+    t = time.ticks_ms()
+    _thread.start_new_thread(producer, (q,))
+    n = consume(q)
+    dt = max(time.ticks_diff(time.ticks_ms(), t), 1)
+    return n, N * 1000 // dt
+
+def consume_single(q):
+    n = 0
+    while n < N:
+        q.get()
+        n += 1
+    return n
+
+def consume_many(q):
+    n = 0
+    while n < N:
+        n += len(q.get_many(BATCH))
+    return n
+
+n_single, single = run(producer_single, consume_single)
+n_many, many = run(producer_many, consume_many)
+
+print(n_single == N, n_many == N)
+print(many >= single)
+
+# a timed out get with a default neither raises nor allocates an exception
+q = uqueue.Queue(1)
+print(q.get(timeout=10, default=None))
+print(q.get_many(4, block=False))
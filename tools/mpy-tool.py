@@ -102,6 +102,7 @@ MP_NATIVE_ARCH_ARMV7EM = 6
 MP_NATIVE_ARCH_ARMV7EMSP = 7
 MP_NATIVE_ARCH_ARMV7EMDP = 8
 MP_NATIVE_ARCH_XTENSA = 9
+MP_NATIVE_ARCH_XTENSAWIN = 10
 
 MP_OPCODE_BYTE = 0
 MP_OPCODE_QSTR = 1